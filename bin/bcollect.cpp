@@ -0,0 +1,101 @@
+#include "collect.hpp"
+#include "getopt.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+void showHelp()
+{
+  std::cout <<
+    "bcollect -- receive binary log streams of TcpSink producers over the network\n"
+    "\n"
+    "Synopsis:\n"
+    "  bcollect [-p port] [-o directory]\n"
+    "\n"
+    "Examples:\n"
+    "  bcollect -p 7350 -o /var/log/collected" "\n"
+    "  bmerge /var/log/collected/*.blog | bread" "\n"
+    "\n"
+    "Options:\n"
+    "  -p port        TCP port to listen on, on every interface (default: 7350)\n"
+    "  -o directory   Write the stream of each producer to directory/name.blog (default: .)\n"
+    "  -h             Show this help\n"
+    "\n"
+    "Notes:\n"
+    "  The name of a producer is set by TcpSink (default: hostname.pid).\n"
+    "  The streams are appended to the files as they are, only complete entries\n"
+    "  (or compressed frames) are written. Each connection starts with the metadata,\n"
+    "  therefore a reconnecting producer appends a valid stream to the same file.\n"
+    "  To get a single stream, ordered by time, merge the files using bmerge.\n"
+    "\n"
+    "Report bugs to:\n"
+    "  https://github.com/Morgan-Stanley/binlog/issues\n";
+}
+
+} // namespace
+
+int main(int argc, /*const*/ char* argv[])
+{
+  std::uint16_t port = 7350;
+  std::string directory = ".";
+
+  int opt;
+  while ((opt = getopt(argc, argv, "p:o:h")) != -1) // NOLINT(concurrency-mt-unsafe)
+  {
+    switch (opt)
+    {
+    case 'p':
+      try
+      {
+        const unsigned long value = std::stoul(optarg);
+        if (value > 65535) { throw std::out_of_range("port"); }
+        port = std::uint16_t(value);
+      }
+      catch (const std::exception&)
+      {
+        std::cerr << "[bcollect] Invalid port: '" << optarg << "'\n";
+        return 1;
+      }
+      break;
+    case 'o':
+      directory = optarg;
+      break;
+    case 'h':
+      showHelp();
+      return 0;
+    default:
+      // getopt prints a useful error message by default (opterr is set)
+      showHelp();
+      return 1;
+    }
+  }
+
+  int listenFd = -1;
+  try
+  {
+    listenFd = listenTcp(port);
+  }
+  catch (const std::runtime_error& ex)
+  {
+    std::cerr << "[bcollect] " << ex.what() << "\n";
+    return 2;
+  }
+
+  try
+  {
+    const std::atomic<bool> stop{false}; // runs until killed
+    collect(listenFd, directory, stop);
+  }
+  catch (const std::exception& ex)
+  {
+    std::cerr << "[bcollect] Exception: " << ex.what() << "\n";
+    return 3;
+  }
+
+  return 0;
+}
@@ -0,0 +1,259 @@
+#include "compact.hpp"
+#include "getopt.hpp"
+
+#include <binlog/CompressedStream.hpp>
+#include <binlog/EntryStream.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+void showHelp()
+{
+  std::cout <<
+    "bcompact -- rewrite binary logfiles in the compact encoding, with a time index\n"
+    "\n"
+    "Synopsis:\n"
+    "  bcompact [-j threads] [-s] [-z level] [-B bytes] [-f bits] [-T] [-I] -o output filename...\n"
+    "\n"
+    "Examples:\n"
+    "  bcompact -f 4096 -o compact.blog logfile.blog" "\n"
+    "  bcompact -j 8 -z 6 -o archive/ logs/*.blog" "\n"
+    "\n"
+    "Arguments:\n"
+    "  filename       Path to a logfile, plain or compressed\n"
+    "\n"
+    "Options:\n"
+    "  -o output      Path of the logfile to write, or if multiple logfiles are given,\n"
+    "                 path of an existing directory: each logfile is written to a file of the same name in it\n"
+    "  -j threads     Rewrite this many logfiles concurrently (default: 1)\n"
+    "  -s             Order the events by time (the logfile is read to memory, see bmerge).\n"
+    "                 The output of many concurrent writers gets larger: each change of the writer is recorded\n"
+    "  -z level       Compress the output with the given zlib level (1-9). No time index is written\n"
+    "  -B bytes       Size of the blocks of the time index, and of the compressed frames (default: 1048576)\n"
+    "  -f bits        Write a Bloom filter of the argument values of each block to the index, of this many bits (see bread -F)\n"
+    "  -T             Do not front code the event sources (for readers of compact events, but not of source tables)\n"
+    "  -I             Do not write a time index\n"
+    "  -h             Show this help\n"
+    "\n"
+    "Notes:\n"
+    "  The events and metadata of the logfiles are kept, only their encoding changes:\n"
+    "  bread prints the same text, faster, from smaller files.\n"
+    "  The time index of 'output' is written to 'output.idx', used by bread -b/-e/-F and bquery.\n"
+    "\n"
+    "Report bugs to:\n"
+    "  https://github.com/Morgan-Stanley/binlog/issues\n";
+}
+
+/** @returns the positive number in `str`, or 0, if `str` is not such a number */
+std::size_t parseCount(const char* str)
+{
+  std::size_t result = 0;
+  for (const char* p = str; *p != '\0'; ++p)
+  {
+    if (*p < '0' || *p > '9' || result > (std::size_t{1} << 40)) { return 0; }
+    result = result * 10 + std::size_t(*p - '0');
+  }
+  return result;
+}
+
+/** @returns the path of the file named as `inputPath` in `outputDirectory` */
+std::string outputPathOf(const std::string& inputPath, const std::string& outputDirectory)
+{
+  const std::size_t slash = inputPath.find_last_of('/');
+  const std::string name = (slash == std::string::npos) ? inputPath : inputPath.substr(slash + 1);
+  return outputDirectory + "/" + name;
+}
+
+/** @returns an entry stream of `file`, decompressed if needed */
+std::unique_ptr<binlog::EntryStream> openEntryStream(std::ifstream& file)
+{
+  std::uint32_t magic = 0;
+  file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+  file.clear();
+  file.seekg(0);
+
+  #ifdef BINLOG_HAS_ZLIB
+    if (magic == binlog::compressedFrameMagic)
+    {
+      return std::unique_ptr<binlog::EntryStream>(new binlog::CompressedEntryStream(file));
+    }
+  #endif
+  return std::unique_ptr<binlog::EntryStream>(new binlog::ReadaheadEntryStream(file));
+}
+
+/**
+ * Rewrite the logfile at `inputPath` to `outputPath`, see compactEntries.
+ *
+ * @returns the size of the input and the output
+ * @throws std::runtime_error on error
+ */
+std::pair<std::uint64_t, std::uint64_t> compactFile(
+  const std::string& inputPath, const std::string& outputPath,
+  bool writeIndex, const CompactOptions& options
+)
+{
+  std::ifstream inputFile(inputPath, std::ios_base::in | std::ios_base::binary | std::ios_base::ate);
+  if (! inputFile)
+  {
+    throw std::runtime_error("Failed to open '" + inputPath + "' for reading");
+  }
+  const std::uint64_t inputSize = std::uint64_t(inputFile.tellg());
+  inputFile.seekg(0);
+
+  std::ofstream outputFile(outputPath, std::ios_base::out | std::ios_base::binary);
+  if (! outputFile)
+  {
+    throw std::runtime_error("Failed to open '" + outputPath + "' for writing");
+  }
+
+  std::ofstream indexFile;
+  if (writeIndex && options.compressionLevel == 0)
+  {
+    indexFile.open(outputPath + ".idx", std::ios_base::out | std::ios_base::binary);
+    if (! indexFile)
+    {
+      throw std::runtime_error("Failed to open '" + outputPath + ".idx' for writing");
+    }
+  }
+
+  const std::unique_ptr<binlog::EntryStream> input = openEntryStream(inputFile);
+  compactEntries(*input, outputFile, indexFile.is_open() ? &indexFile : nullptr, options);
+
+  outputFile.flush();
+  indexFile.flush();
+  if (! outputFile || (indexFile.is_open() && ! indexFile))
+  {
+    throw std::runtime_error("Failed to write '" + outputPath + "'");
+  }
+
+  return {inputSize, std::uint64_t(outputFile.tellp())};
+}
+
+} // namespace
+
+int main(int argc, /*const*/ char* argv[])
+{
+  std::string outputPath;
+  std::size_t threadCount = 1;
+  bool writeIndex = true;
+  CompactOptions options;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "o:j:sz:B:f:TIh")) != -1) // NOLINT(concurrency-mt-unsafe)
+  {
+    switch (opt)
+    {
+    case 'o':
+      outputPath = optarg;
+      break;
+    case 'j':
+      threadCount = parseCount(optarg);
+      if (threadCount == 0 || threadCount > 1024)
+      {
+        std::cerr << "[bcompact] Invalid thread count: '" << optarg << "'\n";
+        return 1;
+      }
+      break;
+    case 's':
+      options.sortByTime = true;
+      break;
+    case 'z':
+      options.compressionLevel = int(parseCount(optarg));
+      if (options.compressionLevel < 1 || options.compressionLevel > 9)
+      {
+        std::cerr << "[bcompact] Invalid compression level: '" << optarg << "'\n";
+        return 1;
+      }
+      break;
+    case 'B':
+      options.blockSize = parseCount(optarg);
+      if (options.blockSize == 0)
+      {
+        std::cerr << "[bcompact] Invalid block size: '" << optarg << "'\n";
+        return 1;
+      }
+      break;
+    case 'f':
+      options.filterBits = parseCount(optarg);
+      if (options.filterBits == 0)
+      {
+        std::cerr << "[bcompact] Invalid filter size: '" << optarg << "'\n";
+        return 1;
+      }
+      break;
+    case 'T':
+      options.eventSourceTables = false;
+      break;
+    case 'I':
+      writeIndex = false;
+      break;
+    case 'h':
+      showHelp();
+      return 0;
+    default:
+      // getopt prints a useful error message by default (opterr is set)
+      showHelp();
+      return 1;
+    }
+  }
+
+  if (optind == argc || outputPath.empty())
+  {
+    showHelp();
+    return 1;
+  }
+
+  #ifndef BINLOG_HAS_ZLIB
+    if (options.compressionLevel != 0)
+    {
+      std::cerr << "[bcompact] Compression is not supported, bcompact is built without zlib\n";
+      return 1;
+    }
+  #endif
+
+  const std::vector<std::string> inputPaths(argv + optind, argv + argc);
+  const bool toDirectory = inputPaths.size() > 1;
+
+  std::atomic<std::size_t> next{0};
+  std::atomic<bool> failed{false};
+  std::mutex reportMutex;
+  const auto work = [&]()
+  {
+    for (std::size_t i = next++; i < inputPaths.size(); i = next++)
+    {
+      const std::string& inputPath = inputPaths[i];
+      const std::string path = toDirectory ? outputPathOf(inputPath, outputPath) : outputPath;
+      try
+      {
+        const std::pair<std::uint64_t, std::uint64_t> sizes = compactFile(inputPath, path, writeIndex, options);
+        std::lock_guard<std::mutex> lock(reportMutex);
+        std::cerr << "[bcompact] " << inputPath << ": " << sizes.first << " -> " << sizes.second << " bytes\n";
+      }
+      catch (const std::exception& ex)
+      {
+        failed = true;
+        std::lock_guard<std::mutex> lock(reportMutex);
+        std::cerr << "[bcompact] " << inputPath << ": Exception: " << ex.what() << "\n";
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (std::size_t t = 1; t < threadCount && t < inputPaths.size(); ++t) { threads.emplace_back(work); }
+  work();
+  for (std::thread& thread : threads) { thread.join(); }
+
+  return failed ? 3 : 0;
+}
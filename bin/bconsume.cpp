@@ -0,0 +1,157 @@
+#include <binlog/SharedMemoryStream.hpp>
+
+#include "getopt.hpp"
+
+#include <algorithm> // min
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace {
+
+void showHelp()
+{
+  std::cout <<
+    "bconsume -- drain the binlog stream of an other process from shared memory\n"
+    "\n"
+    "Synopsis:\n"
+    "  bconsume [-o outputfile] [-w] [-k] segment\n"
+    "\n"
+    "Arguments:\n"
+    "  segment         Name of the shared memory segment, e.g: /myapp.binlog\n"
+    "\n"
+    "Options:\n"
+    "  -o outputfile   Path of the binary logfile to write. If '-' or unspecified, write to stdout\n"
+    "  -w              Wait for the segment to be created, instead of failing if it does not exist\n"
+    "  -k              Keep the segment after the writer is closed (by default, it is removed)\n"
+    "  -h              Show this help\n"
+    "\n"
+    "Notes:\n"
+    "  The logging process writes the segment using binlog::SharedMemoryOutputStream.\n"
+    "  bconsume copies the data from the segment to the output as it arrives,\n"
+    "  and exits when the writer is closed, or the logging process is no longer running,\n"
+    "  and every written byte is consumed. The output can be read using bread:\n"
+    "\n"
+    "    $ bconsume -o logfile.blog /myapp.binlog\n"
+    "    $ bread logfile.blog\n"
+    "\n"
+    "Report bugs to:\n"
+    "  https://github.com/Morgan-Stanley/binlog/issues\n";
+}
+
+std::unique_ptr<binlog::SharedMemoryInputStream> openSegment(const std::string& name, bool wait)
+{
+  while (true)
+  {
+    try
+    {
+      return std::unique_ptr<binlog::SharedMemoryInputStream>(new binlog::SharedMemoryInputStream(name));
+    }
+    catch (const std::runtime_error&)
+    {
+      if (! wait) { throw; }
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+}
+
+} // namespace
+
+int main(int argc, /*const*/ char* argv[])
+{
+  std::string outputPath = "-";
+  bool wait = false;
+  bool keep = false;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "o:wkh")) != -1) // NOLINT(concurrency-mt-unsafe)
+  {
+    switch (opt)
+    {
+    case 'o':
+      outputPath = optarg;
+      break;
+    case 'w':
+      wait = true;
+      break;
+    case 'k':
+      keep = true;
+      break;
+    case 'h':
+      showHelp();
+      return 0;
+    default:
+      // getopt prints a useful error message by default (opterr is set)
+      showHelp();
+      return 1;
+    }
+  }
+
+  if (optind >= argc)
+  {
+    std::cerr << "[bconsume] Missing segment name\n";
+    showHelp();
+    return 1;
+  }
+  const std::string name = argv[optind];
+
+  std::ofstream outputFile;
+  if (outputPath != "-")
+  {
+    outputFile.open(outputPath, std::ofstream::out | std::ofstream::binary);
+    if (! outputFile)
+    {
+      std::cerr << "[bconsume] Failed to open '" << outputPath << "' for writing\n";
+      return 2;
+    }
+  }
+  std::ostream& output = (outputFile.is_open()) ? outputFile : std::cout;
+
+  std::unique_ptr<binlog::SharedMemoryInputStream> input;
+  try
+  {
+    input = openSegment(name, wait);
+  }
+  catch (const std::runtime_error& ex)
+  {
+    std::cerr << "[bconsume] " << ex.what() << "\n";
+    return 3;
+  }
+
+  // poll, back off while the writer is idle
+  const std::chrono::milliseconds maxPollInterval(10);
+  std::chrono::microseconds pollInterval(10);
+
+  while (true)
+  {
+    // check before consuming: data written before closing is not lost
+    const bool closed = input->writerClosed();
+
+    if (input->consume(output) != 0)
+    {
+      output.flush();
+      pollInterval = std::chrono::microseconds(10);
+      continue;
+    }
+
+    if (closed) { break; }
+
+    std::this_thread::sleep_for(pollInterval);
+    pollInterval = (std::min)(std::chrono::microseconds(pollInterval * 2), std::chrono::microseconds(maxPollInterval));
+  }
+
+  if (! keep) { input->unlink(); }
+
+  if (! output)
+  {
+    std::cerr << "[bconsume] Failed to write output\n";
+    return 4;
+  }
+
+  return 0;
+}
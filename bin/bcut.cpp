@@ -0,0 +1,157 @@
+#include "cut.hpp"
+#include "getopt.hpp"
+#include "mapfile.hpp"
+#include "printers.hpp"
+#include "where.hpp"
+
+#include <binlog/EntryStream.hpp>
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+void showHelp()
+{
+  std::cout <<
+    "bcut -- write the selected events of a binary logfile to a smaller binary logfile\n"
+    "\n"
+    "Synopsis:\n"
+    "  bcut [-b begin] [-e end] [-w expression] [-n writer] [-o outputfile] filename\n"
+    "\n"
+    "Examples:\n"
+    "  bcut -b 2026-01-02T10:00:00 -e 2026-01-02T10:05:00 -o slice.blog logfile.blog" "\n"
+    "  bcut -w 'category==orders' -n Router -o orders.blog logfile.blog" "\n"
+    "\n"
+    "Arguments:\n"
+    "  filename       Path to a logfile. If '-' or unspecified, read from stdin\n"
+    "\n"
+    "Options:\n"
+    "  -b             Only write events at or after the given UTC time (YYYY-MM-DDTHH:MM:SS[.fraction])\n"
+    "  -e             Only write events at or before the given UTC time (YYYY-MM-DDTHH:MM:SS[.fraction])\n"
+    "  -w             Only write events matching the given expression, see 'bread -h'\n"
+    "  -n             Only write events of writers whose name contains the given string\n"
+    "  -o outputfile  Path of the logfile to write. If '-' or unspecified, write to stdout\n"
+    "  -h             Show this help\n"
+    "\n"
+    "Notes:\n"
+    "  The arguments of the events are not decoded, the selected events are copied.\n"
+    "  Only the event sources, writer properties and clock syncs needed\n"
+    "  by the selected events are written. Events before the first clock sync\n"
+    "  are not written if -b or -e is given.\n"
+    "\n"
+    "Report bugs to:\n"
+    "  https://github.com/Morgan-Stanley/binlog/issues\n";
+}
+
+} // namespace
+
+int main(int argc, /*const*/ char* argv[])
+{
+  std::string inputPath = "-";
+  std::string outputPath = "-";
+  CutSelection selection;
+  std::unique_ptr<WherePredicate> where;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "b:e:w:n:o:h")) != -1) // NOLINT(concurrency-mt-unsafe)
+  {
+    switch (opt)
+    {
+    case 'b':
+    case 'e':
+      if (! parseTime(optarg, (opt == 'b') ? selection.window.from : selection.window.to))
+      {
+        std::cerr << "[bcut] Invalid time: '" << optarg << "', expected: YYYY-MM-DDTHH:MM:SS[.fraction]\n";
+        return 1;
+      }
+      break;
+    case 'w':
+      try
+      {
+        where.reset(new WherePredicate(optarg));
+        selection.where = where.get();
+      }
+      catch (const std::runtime_error& ex)
+      {
+        std::cerr << "[bcut] " << ex.what() << "\n";
+        return 1;
+      }
+      break;
+    case 'n':
+      selection.writerName = optarg;
+      break;
+    case 'o':
+      outputPath = optarg;
+      break;
+    case 'h':
+      showHelp();
+      return 0;
+    default:
+      // getopt prints a useful error message by default (opterr is set)
+      showHelp();
+      return 1;
+    }
+  }
+
+  if (optind < argc)
+  {
+    inputPath = argv[optind];
+  }
+
+  std::ofstream outputFile;
+  if (outputPath != "-")
+  {
+    outputFile.open(outputPath, std::ofstream::out | std::ofstream::binary);
+    if (! outputFile)
+    {
+      std::cerr << "[bcut] Failed to open '" << outputPath << "' for writing\n";
+      return 2;
+    }
+  }
+  std::ostream& output = (outputFile.is_open()) ? outputFile : std::cout;
+
+  std::ifstream inputFile;
+  std::unique_ptr<binlog::MmapEntryStream> mappedInput = mapFile(inputPath);
+  if (! mappedInput && inputPath != "-")
+  {
+    inputFile.open(inputPath, std::ios_base::in | std::ios_base::binary);
+    if (! inputFile)
+    {
+      std::cerr << "[bcut] Failed to open '" << inputPath << "' for reading\n";
+      return 2;
+    }
+  }
+  std::istream& input = (inputFile.is_open()) ? inputFile : std::cin;
+
+  try
+  {
+    if (mappedInput)
+    {
+      cutEvents(*mappedInput, output, selection);
+    }
+    else
+    {
+      binlog::ReadaheadEntryStream entryStream(input);
+      cutEvents(entryStream, output, selection);
+    }
+  }
+  catch (const std::exception& ex)
+  {
+    std::cerr << "[bcut] Exception: " << ex.what() << "\n";
+    return 3;
+  }
+
+  output.flush();
+  if (! output)
+  {
+    std::cerr << "[bcut] Failed to write output\n";
+    return 4;
+  }
+
+  return 0;
+}
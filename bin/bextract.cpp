@@ -0,0 +1,139 @@
+#include "extract.hpp"
+#include "getopt.hpp"
+#include "mapfile.hpp"
+
+#include <binlog/EntryStream.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+void showHelp()
+{
+  std::cout <<
+    "bextract -- write the arguments of selected events of a binary logfile in columns\n"
+    "\n"
+    "Synopsis:\n"
+    "  bextract [-c category] [-m function] [-p format] [-o outputfile] filename\n"
+    "\n"
+    "Examples:\n"
+    "  bextract -c orders -p 'Fill: ' -o fills.blcol logfile.blog" "\n"
+    "\n"
+    "Arguments:\n"
+    "  filename       Path to a logfile. If '-' or unspecified, read from stdin\n"
+    "\n"
+    "Options:\n"
+    "  -c             Select the events whose category contains the given string\n"
+    "  -m             Select the events whose function contains the given string\n"
+    "  -p             Select the events whose format string contains the given string\n"
+    "  -o outputfile  Path of the column file to write. If '-' or unspecified, write to stdout\n"
+    "  -h             Show this help\n"
+    "\n"
+    "Notes:\n"
+    "  Every selected event is written as a row, every argument position as a typed column,\n"
+    "  preceded by the clock, time, writer_id, writer_name and source_id columns.\n"
+    "  The arguments of the selected events must have the same types.\n"
+    "  Numbers are stored as is, strings as offsets and characters,\n"
+    "  other arguments are converted to text, as bread shows them.\n"
+    "  The format of the output is documented in bin/extract.hpp.\n"
+    "\n"
+    "Report bugs to:\n"
+    "  https://github.com/Morgan-Stanley/binlog/issues\n";
+}
+
+} // namespace
+
+int main(int argc, /*const*/ char* argv[])
+{
+  std::string inputPath = "-";
+  std::string outputPath = "-";
+  SourceSelector selector;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "c:m:p:o:h")) != -1) // NOLINT(concurrency-mt-unsafe)
+  {
+    switch (opt)
+    {
+    case 'c':
+      selector.category = optarg;
+      break;
+    case 'm':
+      selector.function = optarg;
+      break;
+    case 'p':
+      selector.formatString = optarg;
+      break;
+    case 'o':
+      outputPath = optarg;
+      break;
+    case 'h':
+      showHelp();
+      return 0;
+    default:
+      // getopt prints a useful error message by default (opterr is set)
+      showHelp();
+      return 1;
+    }
+  }
+
+  if (optind < argc)
+  {
+    inputPath = argv[optind];
+  }
+
+  std::ofstream outputFile;
+  if (outputPath != "-")
+  {
+    outputFile.open(outputPath, std::ofstream::out | std::ofstream::binary);
+    if (! outputFile)
+    {
+      std::cerr << "[bextract] Failed to open '" << outputPath << "' for writing\n";
+      return 2;
+    }
+  }
+  std::ostream& output = (outputFile.is_open()) ? outputFile : std::cout;
+
+  std::ifstream inputFile;
+  std::unique_ptr<binlog::MmapEntryStream> mappedInput = mapFile(inputPath);
+  if (! mappedInput && inputPath != "-")
+  {
+    inputFile.open(inputPath, std::ios_base::in | std::ios_base::binary);
+    if (! inputFile)
+    {
+      std::cerr << "[bextract] Failed to open '" << inputPath << "' for reading\n";
+      return 2;
+    }
+  }
+  std::istream& input = (inputFile.is_open()) ? inputFile : std::cin;
+
+  try
+  {
+    if (mappedInput)
+    {
+      extractColumns(*mappedInput, output, selector);
+    }
+    else
+    {
+      binlog::ReadaheadEntryStream entryStream(input);
+      extractColumns(entryStream, output, selector);
+    }
+  }
+  catch (const std::exception& ex)
+  {
+    std::cerr << "[bextract] Exception: " << ex.what() << "\n";
+    return 3;
+  }
+
+  output.flush();
+  if (! output)
+  {
+    std::cerr << "[bextract] Failed to write output\n";
+    return 4;
+  }
+
+  return 0;
+}
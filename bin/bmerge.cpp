@@ -0,0 +1,150 @@
+#include "getopt.hpp"
+#include "mapfile.hpp"
+#include "merge.hpp"
+
+#include <binlog/EntryStream.hpp>
+
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+void showHelp()
+{
+  std::cout <<
+    "bmerge -- merge binary logfiles to a single binary logfile, ordered by time\n"
+    "\n"
+    "Synopsis:\n"
+    "  bmerge [-m megabytes] [-o outputfile] filename...\n"
+    "\n"
+    "Examples:\n"
+    "  bmerge -o all.blog client.blog server.blog" "\n"
+    "  bmerge host*/*.blog | bread" "\n"
+    "\n"
+    "Arguments:\n"
+    "  filename       Path to a logfile. If '-', read from stdin\n"
+    "\n"
+    "Options:\n"
+    "  -m megabytes   Memory limit of the events waiting to be written (default: 1024)\n"
+    "  -o outputfile  Path of the logfile to write. If '-' or unspecified, write to stdout\n"
+    "  -h             Show this help\n"
+    "\n"
+    "Notes:\n"
+    "  The clocks of the events are converted to nanoseconds since the epoch,\n"
+    "  event sources get new ids, the arguments of the events are copied.\n"
+    "  Every event must be preceded by a clock sync in its logfile.\n"
+    "  The events are buffered until the end of the logfiles, and written ordered by time.\n"
+    "  If the memory limit is reached, the earliest event is written early,\n"
+    "  and the output might not be perfectly ordered.\n"
+    "\n"
+    "Report bugs to:\n"
+    "  https://github.com/Morgan-Stanley/binlog/issues\n";
+}
+
+} // namespace
+
+int main(int argc, /*const*/ char* argv[])
+{
+  std::string outputPath = "-";
+  std::size_t memoryLimit = std::size_t{1} << 30;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "m:o:h")) != -1) // NOLINT(concurrency-mt-unsafe)
+  {
+    switch (opt)
+    {
+    case 'm':
+      try
+      {
+        memoryLimit = std::size_t(std::stoull(optarg)) << 20;
+      }
+      catch (const std::exception&)
+      {
+        std::cerr << "[bmerge] Invalid memory limit: '" << optarg << "'\n";
+        return 1;
+      }
+      break;
+    case 'o':
+      outputPath = optarg;
+      break;
+    case 'h':
+      showHelp();
+      return 0;
+    default:
+      // getopt prints a useful error message by default (opterr is set)
+      showHelp();
+      return 1;
+    }
+  }
+
+  if (optind >= argc)
+  {
+    showHelp();
+    return 1;
+  }
+
+  std::ofstream outputFile;
+  if (outputPath != "-")
+  {
+    outputFile.open(outputPath, std::ofstream::out | std::ofstream::binary);
+    if (! outputFile)
+    {
+      std::cerr << "[bmerge] Failed to open '" << outputPath << "' for writing\n";
+      return 2;
+    }
+  }
+  std::ostream& output = (outputFile.is_open()) ? outputFile : std::cout;
+
+  std::vector<std::unique_ptr<binlog::EntryStream>> entryStreams;
+  std::vector<std::unique_ptr<std::ifstream>> inputFiles;
+  std::vector<binlog::EntryStream*> inputs;
+
+  for (int i = optind; i < argc; ++i)
+  {
+    const std::string inputPath = argv[i];
+    std::unique_ptr<binlog::MmapEntryStream> mappedInput = mapFile(inputPath);
+    if (mappedInput)
+    {
+      entryStreams.emplace_back(std::move(mappedInput));
+    }
+    else if (inputPath == "-")
+    {
+      entryStreams.emplace_back(new binlog::ReadaheadEntryStream(std::cin));
+    }
+    else
+    {
+      inputFiles.emplace_back(new std::ifstream(inputPath, std::ios_base::in | std::ios_base::binary));
+      if (! *inputFiles.back())
+      {
+        std::cerr << "[bmerge] Failed to open '" << inputPath << "' for reading\n";
+        return 2;
+      }
+      entryStreams.emplace_back(new binlog::ReadaheadEntryStream(*inputFiles.back()));
+    }
+    inputs.push_back(entryStreams.back().get());
+  }
+
+  try
+  {
+    mergeEvents(inputs, output, memoryLimit);
+  }
+  catch (const std::exception& ex)
+  {
+    std::cerr << "[bmerge] Exception: " << ex.what() << "\n";
+    return 3;
+  }
+
+  output.flush();
+  if (! output)
+  {
+    std::cerr << "[bmerge] Failed to write output\n";
+    return 4;
+  }
+
+  return 0;
+}
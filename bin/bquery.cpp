@@ -0,0 +1,296 @@
+#include "getopt.hpp"
+#include "mapfile.hpp"
+#include "printers.hpp"
+#include "query.hpp"
+
+#include <binlog/BlockStream.hpp>
+#include <binlog/CompressedStream.hpp>
+#include <binlog/EntryStream.hpp>
+#include <binlog/TimeIndex.hpp>
+
+#include <algorithm> // sort, min
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring> // memcpy
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+  #include <dirent.h> // NOLINT opendir, readdir
+  #include <sys/stat.h> // NOLINT stat
+#endif
+
+namespace {
+
+void showHelp()
+{
+  std::cout <<
+    "bquery -- aggregate the events of binary logfiles\n"
+    "\n"
+    "Synopsis:\n"
+    "  bquery [-j threads] [-b begin] [-e end] query path...\n"
+    "\n"
+    "Examples:\n"
+    "  bquery 'select time(60), category, count where severity>=error' logs/" "\n"
+    "  bquery 'select writer, count, max(arg0) where format~\"latency\"' a.blog b.blog" "\n"
+    "  bquery -b 2026-01-02T00:00:00 -e 2026-01-09T00:00:00 'select count where value==42 group by time(3600)' logs/" "\n"
+    "\n"
+    "Arguments:\n"
+    "  query          select item,... [where expression] [group by key,...]\n"
+    "                 item: a key or an aggregate\n"
+    "                 key: severity, category, function, file, line, format, id, writer or time(seconds)\n"
+    "                 aggregate: count, min(argN), max(argN) or sum(argN)\n"
+    "                 expression: as bread -w, see 'bread -h'\n"
+    "  path           Path to a logfile, or to a directory of logfiles (*.blog, not recursive)\n"
+    "\n"
+    "Options:\n"
+    "  -j threads     Query this many files at once (default: the number of CPUs)\n"
+    "  -b             Only consider events at or after the given UTC time (YYYY-MM-DDTHH:MM:SS[.fraction])\n"
+    "  -e             Only consider events at or before the given UTC time (YYYY-MM-DDTHH:MM:SS[.fraction])\n"
+    "  -h             Show this help\n"
+    "\n"
+    "Notes:\n"
+    "  The events are grouped by the keys, and the aggregates of each group\n"
+    "  are printed tab separated, ordered by the keys. Times are shown in UTC.\n"
+    "  The arguments of the events are never formatted: events of sources\n"
+    "  rejected by the source fields of the expression are skipped without decoding.\n"
+    "  If a logfile has a time index (filename.idx), it is used to skip the blocks\n"
+    "  outside of -b and -e, and if it has filters, the blocks without the value\n"
+    "  of a 'value==x' term of the expression.\n"
+    "\n"
+    "Report bugs to:\n"
+    "  https://github.com/Morgan-Stanley/binlog/issues\n";
+}
+
+/** @returns the positive number in `str`, at most 1024, or 0, if `str` is not such a number */
+std::size_t parseThreadCount(const char* str)
+{
+  std::size_t result = 0;
+  for (const char* p = str; *p != '\0'; ++p)
+  {
+    if (*p < '0' || *p > '9' || result > 1024) { return 0; }
+    result = result * 10 + std::size_t(*p - '0');
+  }
+  return result;
+}
+
+/** @returns the files ending with .blog in `path`, if it is a directory, or `path` itself */
+std::vector<std::string> expandPath(const std::string& path)
+{
+  std::vector<std::string> result;
+
+  #ifndef _WIN32
+    struct stat st = {};
+    if (stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode))
+    {
+      DIR* dir = opendir(path.c_str());
+      if (dir == nullptr) { throw std::runtime_error("Failed to open directory '" + path + "'"); }
+
+      const std::string extension = ".blog";
+      while (const dirent* entry = readdir(dir)) // NOLINT(concurrency-mt-unsafe)
+      {
+        const std::string name = entry->d_name;
+        if (name.size() > extension.size() && name.compare(name.size() - extension.size(), extension.size(), extension) == 0)
+        {
+          result.push_back(path + "/" + name);
+        }
+      }
+      closedir(dir);
+
+      std::sort(result.begin(), result.end());
+      return result;
+    }
+  #endif
+
+  result.push_back(path);
+  return result;
+}
+
+/** @returns the time index of the logfile at `path`, or nullptr, if it has no valid index */
+std::unique_ptr<binlog::TimeIndex> readIndex(const std::string& path)
+{
+  std::ifstream file(path + ".idx", std::ios_base::in | std::ios_base::binary);
+  if (! file) { return nullptr; }
+
+  try
+  {
+    return std::unique_ptr<binlog::TimeIndex>(new binlog::TimeIndex(binlog::TimeIndex::read(file)));
+  }
+  catch (const std::runtime_error&)
+  {
+    return nullptr; // fall back to reading every event
+  }
+}
+
+/** @returns the first four bytes of `input`, or 0, if it is shorter */
+std::uint32_t magicOf(const binlog::MmapEntryStream& input)
+{
+  std::uint32_t magic = 0;
+  if (input.size() >= sizeof(magic)) { memcpy(&magic, input.data(), sizeof(magic)); }
+  return magic;
+}
+
+/** @returns the result of `query` on the logfile at `path` */
+QueryResult queryFile(const Query& query, const std::string& path, const TimeWindow* window)
+{
+  const std::unique_ptr<binlog::MmapEntryStream> mapped = mapFile(path);
+  const std::uint32_t magic = mapped ? magicOf(*mapped) : 0;
+
+  if (magic == binlog::blockMagic)
+  {
+    binlog::BlockEntryStream blocks(binlog::Range{mapped->data(), mapped->size()});
+    return runQuery(query, blocks, window);
+  }
+
+  if (mapped && magic != binlog::compressedFrameMagic)
+  {
+    const WherePredicate* where = query.where();
+    const bool indexUseful = window != nullptr || (where != nullptr && where->requiredValue() != nullptr);
+    const std::unique_ptr<binlog::TimeIndex> index = indexUseful ? readIndex(path) : nullptr;
+    if (index)
+    {
+      return runQuery(query, mapped->data(), mapped->size(), *index, window);
+    }
+    return runQuery(query, *mapped, window);
+  }
+
+  std::ifstream file(path, std::ios_base::in | std::ios_base::binary);
+  if (! file) { throw std::runtime_error("Failed to open '" + path + "' for reading"); }
+
+  if (magic == binlog::compressedFrameMagic)
+  {
+  #ifdef BINLOG_HAS_ZLIB
+    binlog::CompressedEntryStream entryStream(file);
+    return runQuery(query, entryStream, window);
+  #else
+    throw std::runtime_error("Compressed input is not supported, bquery is built without zlib");
+  #endif
+  }
+
+  binlog::ReadaheadEntryStream entryStream(file);
+  return runQuery(query, entryStream, window);
+}
+
+} // namespace
+
+int main(int argc, /*const*/ char* argv[])
+{
+  std::size_t threadCount = (std::max)(1u, std::thread::hardware_concurrency());
+  TimeWindow window{std::chrono::nanoseconds::min(), std::chrono::nanoseconds::max()};
+  bool hasWindow = false;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "j:b:e:h")) != -1) // NOLINT(concurrency-mt-unsafe)
+  {
+    switch (opt)
+    {
+    case 'j':
+      threadCount = parseThreadCount(optarg);
+      if (threadCount == 0)
+      {
+        std::cerr << "[bquery] Invalid thread count: '" << optarg << "'\n";
+        return 1;
+      }
+      break;
+    case 'b':
+    case 'e':
+      if (! parseTime(optarg, (opt == 'b') ? window.from : window.to))
+      {
+        std::cerr << "[bquery] Invalid time: '" << optarg << "', expected: YYYY-MM-DDTHH:MM:SS[.fraction]\n";
+        return 1;
+      }
+      hasWindow = true;
+      break;
+    case 'h':
+      showHelp();
+      return 0;
+    default:
+      // getopt prints a useful error message by default (opterr is set)
+      showHelp();
+      return 1;
+    }
+  }
+
+  if (argc - optind < 2)
+  {
+    showHelp();
+    return 1;
+  }
+
+  std::unique_ptr<Query> query;
+  try
+  {
+    query.reset(new Query(argv[optind]));
+  }
+  catch (const std::runtime_error& ex)
+  {
+    std::cerr << "[bquery] " << ex.what() << "\n";
+    return 1;
+  }
+
+  std::vector<std::string> paths;
+  try
+  {
+    for (int i = optind + 1; i < argc; ++i)
+    {
+      const std::vector<std::string> expanded = expandPath(argv[i]);
+      paths.insert(paths.end(), expanded.begin(), expanded.end());
+    }
+  }
+  catch (const std::runtime_error& ex)
+  {
+    std::cerr << "[bquery] " << ex.what() << "\n";
+    return 2;
+  }
+
+  // each file is queried by one of the threads, the results are merged at the end
+  const TimeWindow* windowPtr = (hasWindow) ? &window : nullptr;
+  std::vector<QueryResult> results(paths.size());
+  std::vector<std::string> errors(paths.size());
+  std::atomic<std::size_t> nextFile{0};
+  const auto work = [&]()
+  {
+    for (std::size_t i = nextFile++; i < paths.size(); i = nextFile++)
+    {
+      try
+      {
+        results[i] = queryFile(*query, paths[i], windowPtr);
+      }
+      catch (const std::exception& ex)
+      {
+        errors[i] = ex.what();
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (std::size_t t = 1; t < (std::min)(threadCount, paths.size()); ++t)
+  {
+    threads.emplace_back(work);
+  }
+  work();
+  for (std::thread& thread : threads) { thread.join(); }
+
+  int result = 0;
+  QueryResult total;
+  for (std::size_t i = 0; i < paths.size(); ++i)
+  {
+    if (! errors[i].empty())
+    {
+      std::cerr << "[bquery] Failed to query '" << paths[i] << "': " << errors[i] << "\n";
+      result = 3;
+    }
+    total.merge(results[i], *query);
+  }
+
+  printQueryResult(*query, total, std::cout);
+  return result;
+}
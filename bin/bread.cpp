@@ -1,9 +1,42 @@
+#include "chunks.hpp"
+#include "fdoutput.hpp"
+#include "find.hpp"
 #include "getopt.hpp"
+#include "json.hpp"
+#include "mapfile.hpp"
+#include "outputs.hpp"
 #include "printers.hpp"
+#include "trace.hpp"
+#include "where.hpp"
 
+#include <binlog/BlockStream.hpp>
+#include <binlog/CompressedStream.hpp>
+#include <binlog/Dictionary.hpp>
+#include <binlog/EntryStream.hpp>
+#include <binlog/FollowEntryStream.hpp>
+#include <binlog/SeriesEntryStream.hpp>
+#include <binlog/TimeIndex.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring> // memcpy
 #include <fstream>
 #include <iostream>
+#include <iterator> // istreambuf_iterator
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifndef _WIN32
+  #include <unistd.h> // STDOUT_FILENO
+#endif
 
 #define BINLOG_DEFAULT_FORMAT "%S %C [%d] %n %m (%G:%L)"
 #define BINLOG_DEFAULT_DATE_FORMAT "%Y-%m-%d %H:%M:%S.%N"
@@ -21,22 +54,614 @@ std::istream& openFile(const std::string& path, std::ifstream& file)
   return file;
 }
 
+/** @returns the time index of the logfile at `path`, or nullptr, if it has no valid index */
+std::unique_ptr<binlog::TimeIndex> readIndex(const std::string& path)
+{
+  std::ifstream file(path + ".idx", std::ios_base::in | std::ios_base::binary);
+  if (! file) { return nullptr; }
+
+  try
+  {
+    return std::unique_ptr<binlog::TimeIndex>(new binlog::TimeIndex(binlog::TimeIndex::read(file)));
+  }
+  catch (const std::runtime_error&)
+  {
+    return nullptr; // fall back to reading every event
+  }
+}
+
+/** How to convert logfiles to text, as set by the command line options */
+struct Options
+{
+  std::string format;
+  std::string dateFormat;
+  bool sorted = false;
+  const ReorderWindow* reorderWindow = nullptr; // if set, sort the events as they are read, see printStreamSortedEvents
+  bool follow = false;                          // the input is followed, see FollowEntryStream
+  std::size_t threadCount = 1;    // for a single logfile: format its events on this many threads
+  const TimeWindow* window = nullptr;     // if set, only print the events in this window
+  bool compressed = false;
+  std::vector<std::string> compressionDictionaries; // of compressed frames, see CompressedEntryStream::addDictionary
+  bool trace = false;
+  bool json = false;                      // write the events as JSON lines, see writeJsonEvents
+  const WherePredicate* where = nullptr;  // if set, only print the events matching this
+  const std::string* findValue = nullptr; // if set, use the filters of the time index to find this value
+  std::string dictionaryDirectory;        // if empty, the directory of the logfile
+  bool split = false;                     // write the events to separate files, see printSplitEvents
+  SplitBy splitBy = SplitBy::writer;
+  std::string splitDirectory;
+  std::size_t splitBufferSize = 1 << 16;
+  const std::vector<Output>* outputs = nullptr; // if set, write the events to these instead, see writeOutputs
+};
+
+/** @returns the directory of the logfile at `path`, where RotatingFileSink writes the dictionaries */
+std::string directoryOf(const std::string& path)
+{
+  const std::size_t slash = path.find_last_of('/');
+  return (path == "-" || slash == std::string::npos) ? "."
+    : (slash == 0) ? "/" : path.substr(0, slash);
+}
+
+/** Print the events of `input`, resolving the dictionaries of `dictionaryDirectory` (if not empty), matching `where` (if set) */
+void print(
+  binlog::EntryStream& input, std::ostream& output, const Options& options,
+  const std::string& dictionaryDirectory, const WherePredicate* where
+)
+{
+  const std::string& format = options.format;
+  const std::string& dateFormat = options.dateFormat;
+
+  if (! dictionaryDirectory.empty())
+  {
+    // resolve the dictionaries first, the filter of -w needs the event sources
+    binlog::DictionaryEntryStream resolved(input, dictionaryDirectory);
+    print(resolved, output, options, std::string(), where);
+  }
+  else if (where != nullptr)
+  {
+    WhereEntryStream filtered(input, *where);
+    print(filtered, output, options, std::string(), nullptr);
+  }
+  else if (options.outputs != nullptr)
+  {
+    writeOutputs(input, *options.outputs, format, dateFormat);
+  }
+  else if (options.json)
+  {
+    writeJsonEvents(input, output);
+  }
+  else if (options.split)
+  {
+    printSplitEvents(input, options.splitDirectory, options.splitBy, format, dateFormat, options.splitBufferSize);
+  }
+  else if (options.reorderWindow != nullptr)
+  {
+    printStreamSortedEvents(input, output, format, dateFormat, *options.reorderWindow, options.follow);
+  }
+  else if (options.sorted)
+  {
+    printSortedEvents(input, output, format, dateFormat);
+  }
+  else if (options.window != nullptr)
+  {
+    printEvents(input, output, format, dateFormat, *options.window);
+  }
+  else if (options.threadCount > 1)
+  {
+    printEvents(input, output, format, dateFormat, options.threadCount);
+  }
+  else
+  {
+    printEvents(input, output, format, dateFormat);
+  }
+}
+
+/** @returns the positive number in `str`, or 0, if `str` is not such a number */
+std::size_t parseThreadCount(const char* str)
+{
+  std::size_t result = 0;
+  for (const char* p = str; *p != '\0'; ++p)
+  {
+    if (*p < '0' || *p > '9' || result > 1024) { return 0; }
+    result = result * 10 + std::size_t(*p - '0');
+  }
+  return result;
+}
+
+/** @returns the positive number in `str`, at most 1 GiB, or 0, if `str` is not such a number */
+std::size_t parseBufferSize(const char* str)
+{
+  std::size_t result = 0;
+  for (const char* p = str; *p != '\0'; ++p)
+  {
+    if (*p < '0' || *p > '9' || result > (std::size_t(1) << 30) / 10) { return 0; }
+    result = result * 10 + std::size_t(*p - '0');
+  }
+  return result;
+}
+
+/**
+ * Parse a duration (e.g: 500ms, 2s; units: ns, us, ms, s) or an event count (a number without unit).
+ * @returns true and sets `result` if `str` is valid
+ */
+bool parseReorderWindow(const std::string& str, ReorderWindow& result)
+{
+  std::size_t end = 0;
+  std::uint64_t value = 0;
+  for (; end < str.size() && str[end] >= '0' && str[end] <= '9'; ++end)
+  {
+    if (value > (std::uint64_t(1) << 40)) { return false; }
+    value = value * 10 + std::uint64_t(str[end] - '0');
+  }
+  if (end == 0 || value == 0) { return false; }
+
+  const std::string unit = str.substr(end);
+  const std::int64_t v = std::int64_t(value);
+  result = ReorderWindow{};
+  if (unit.empty()) { result.eventCount = std::size_t(value); }
+  else if (unit == "ns") { result.time = std::chrono::nanoseconds{v}; }
+  else if (unit == "us") { result.time = std::chrono::microseconds{v}; }
+  else if (unit == "ms") { result.time = std::chrono::milliseconds{v}; }
+  else if (unit == "s") { result.time = std::chrono::seconds{v}; }
+  else { return false; }
+  return true;
+}
+
+/**
+ * Parse `path[@base]`, base in hex, with an optional 0x prefix, 0 if omitted.
+ * @returns true and sets `path` and `base` if `str` is valid
+ */
+bool parseAddressModule(const std::string& str, std::string& path, std::uint64_t& base)
+{
+  const std::size_t at = str.rfind('@');
+  path = str.substr(0, at);
+  base = 0;
+  if (path.empty()) { return false; }
+  if (at == std::string::npos) { return true; }
+
+  std::size_t begin = at + 1;
+  if (str.compare(begin, 2, "0x") == 0 || str.compare(begin, 2, "0X") == 0) { begin += 2; }
+  if (begin == str.size() || str.size() - begin > 16) { return false; }
+
+  for (std::size_t i = begin; i < str.size(); ++i)
+  {
+    const char c = str[i];
+    const int digit = (c >= '0' && c <= '9') ? c - '0'
+      : (c >= 'a' && c <= 'f') ? c - 'a' + 10
+      : (c >= 'A' && c <= 'F') ? c - 'A' + 10
+      : -1;
+    if (digit < 0) { return false; }
+    base = base * 16 + std::uint64_t(digit);
+  }
+  return true;
+}
+
+/** @returns true and sets `result` if `str` names a field of SplitBy */
+bool parseSplitBy(const std::string& str, SplitBy& result)
+{
+  if (str == "writer") { result = SplitBy::writer; }
+  else if (str == "category") { result = SplitBy::category; }
+  else if (str == "severity") { result = SplitBy::severity; }
+  else { return false; }
+  return true;
+}
+
+#ifdef BINLOG_HAS_ZLIB
+
+/** Make the frames compressed with the dictionaries of -Z readable */
+void addCompressionDictionaries(binlog::CompressedEntryStream& input, const Options& options)
+{
+  for (const std::string& dictionary : options.compressionDictionaries)
+  {
+    input.addDictionary(dictionary);
+  }
+}
+
+#endif // BINLOG_HAS_ZLIB
+
+/** Print the entries of `input`, a stream, possibly compressed */
+void print(
+  std::istream& input, std::ostream& output, const Options& options,
+  const std::string& dictionaryDirectory, bool compressed
+)
+{
+  if (compressed)
+  {
+  #ifdef BINLOG_HAS_ZLIB
+    binlog::CompressedEntryStream entryStream(input);
+    addCompressionDictionaries(entryStream, options);
+    print(entryStream, output, options, dictionaryDirectory, options.where);
+  #else
+    throw std::runtime_error("Compressed input is not supported, bread is built without zlib");
+  #endif
+  }
+  else
+  {
+    binlog::ReadaheadEntryStream entryStream(input);
+    print(entryStream, output, options, dictionaryDirectory, options.where);
+  }
+}
+
+/** Write the events of `input` as Chrome trace JSON, see writeChromeTrace */
+void writeTrace(binlog::EntryStream& input, std::ostream& output, const WherePredicate* where)
+{
+  if (where != nullptr)
+  {
+    WhereEntryStream filtered(input, *where);
+    writeChromeTrace(filtered, output);
+  }
+  else
+  {
+    writeChromeTrace(input, output);
+  }
+}
+
+/** @returns true if `input` begins with a compressed frame */
+bool isCompressed(const binlog::MmapEntryStream& input)
+{
+  std::uint32_t magic = 0;
+  if (input.size() < sizeof(magic)) { return false; }
+  memcpy(&magic, input.data(), sizeof(magic));
+  return magic == binlog::compressedFrameMagic;
+}
+
+/** @returns true if `input` begins with a block, see BlockOutputStream */
+bool isBlockFramed(const binlog::MmapEntryStream& input)
+{
+  std::uint32_t magic = 0;
+  if (input.size() < sizeof(magic)) { return false; }
+  memcpy(&magic, input.data(), sizeof(magic));
+  return magic == binlog::blockMagic;
+}
+
+/** Print the events of the logfile at `path`, waiting for new ones forever, see FollowEntryStream */
+int followFile(const std::string& path, const Options& options)
+{
+#ifdef _WIN32
+  (void)path; (void)options;
+  std::cerr << "[bread] -t is not supported on this platform\n";
+  return 1;
+#else
+  if (! std::ifstream(path))
+  {
+    std::cerr << "[bread] Failed to open '" << path << "' for reading\n";
+    return 2;
+  }
+
+  try
+  {
+    // show the events as soon as they are read
+    std::cout << std::unitbuf;
+    binlog::FollowEntryStream::Options followOptions;
+    followOptions.beforeWait = []() { std::cout.flush(); };
+    if (options.reorderWindow != nullptr)
+    {
+      // print the events held back by the reorder window if the file does not grow
+      const std::chrono::nanoseconds time = options.reorderWindow->time;
+      followOptions.idleTimeout = (time.count() > 0)
+        ? (std::max)(std::chrono::duration_cast<std::chrono::milliseconds>(time), std::chrono::milliseconds{1})
+        : std::chrono::milliseconds{500};
+    }
+    binlog::FollowEntryStream input(path, followOptions);
+    const std::string dictionaryDirectory = (options.dictionaryDirectory.empty())
+      ? directoryOf(path) : options.dictionaryDirectory;
+    print(input, std::cout, options, dictionaryDirectory, options.where);
+  }
+  catch (const std::exception& ex)
+  {
+    std::cerr << "[bread] Exception: " << ex.what() << "\n";
+    return 3;
+  }
+
+  return 0;
+#endif
+}
+
+/**
+ * Print the events of the logfiles at `paths` as a single logfile, see SeriesEntryStream.
+ * A single path is expanded to the files rotated by RotatingFileSink.
+ *
+ * @returns the exit code of bread, see convertFile
+ */
+int convertSeries(const std::vector<std::string>& paths, std::ostream& output, const Options& options)
+{
+  const std::vector<std::string> series = (paths.size() == 1)
+    ? binlog::SeriesEntryStream::rotatedFiles(paths.front()) : paths;
+  if (series.empty())
+  {
+    std::cerr << "[bread] Failed to open '" << paths.front() << "' for reading\n";
+    return 2;
+  }
+
+  try
+  {
+    binlog::SeriesEntryStream input(series);
+    if (options.trace)
+    {
+      writeTrace(input, output, options.where);
+    }
+    else
+    {
+      const std::string dictionaryDirectory = (options.dictionaryDirectory.empty())
+        ? directoryOf(series.front()) : options.dictionaryDirectory;
+      print(input, output, options, dictionaryDirectory, options.where);
+    }
+  }
+  catch (const std::exception& ex)
+  {
+    std::cerr << "[bread] Exception: " << ex.what() << "\n";
+    return 3;
+  }
+
+  return 0;
+}
+
+/**
+ * Convert the logfile at `inputPath` (or stdin, if "-") to `output`,
+ * print errors to stderr.
+ *
+ * @returns the exit code of bread: 0 on success, 2 if the logfile can not be opened, 3 on invalid input
+ */
+int convertFile(const std::string& inputPath, std::ostream& output, const Options& options)
+{
+  const std::string& format = options.format;
+  const std::string& dateFormat = options.dateFormat;
+  const std::string dictionaryDirectory = (options.dictionaryDirectory.empty())
+    ? directoryOf(inputPath) : options.dictionaryDirectory;
+  const WherePredicate* where = options.where;
+  bool compressed = options.compressed;
+
+  // regular files are mapped, to avoid copying entries,
+  // other inputs (e.g: pipes, stdin) are read as a stream,
+  // in large blocks, on a background thread
+  std::unique_ptr<binlog::MmapEntryStream> mappedInput = mapFile(inputPath);
+
+  // compressed files are decompressed frame by frame, while reading
+  if (mappedInput && isCompressed(*mappedInput))
+  {
+    compressed = true;
+    mappedInput.reset();
+  }
+
+  std::ifstream inputFile;
+  std::istream& input = (mappedInput) ? inputFile : openFile(inputPath, inputFile);
+  if (! mappedInput && ! input)
+  {
+    std::cerr << "[bread] Failed to open '" << inputPath << "' for reading\n";
+    return 2;
+  }
+
+  try
+  {
+    // the indexed printer reads the mapped logfile directly, bypassing the filter of -w
+    const std::unique_ptr<binlog::TimeIndex> index = (mappedInput && (options.window || options.findValue)) ? readIndex(inputPath) : nullptr;
+
+    if (options.trace)
+    {
+      if (compressed)
+      {
+      #ifdef BINLOG_HAS_ZLIB
+        binlog::CompressedEntryStream entryStream(input);
+        addCompressionDictionaries(entryStream, options);
+        writeTrace(entryStream, output, where);
+      #else
+        throw std::runtime_error("Compressed input is not supported, bread is built without zlib");
+      #endif
+      }
+      else if (mappedInput && isBlockFramed(*mappedInput))
+      {
+        binlog::BlockEntryStream blocks(binlog::Range{mappedInput->data(), mappedInput->size()});
+        writeTrace(blocks, output, where);
+      }
+      else if (mappedInput)
+      {
+        writeTrace(*mappedInput, output, where);
+      }
+      else
+      {
+        binlog::ReadaheadEntryStream entryStream(input);
+        writeTrace(entryStream, output, where);
+      }
+    }
+    else if (compressed)
+    {
+      print(input, output, options, dictionaryDirectory, compressed);
+    }
+    else if (mappedInput && isBlockFramed(*mappedInput))
+    {
+      std::size_t skippedBytes = 0;
+      if (options.window && ! where)
+      {
+        // find the blocks of the window by binary search
+        skippedBytes = printBlockEvents(mappedInput->data(), mappedInput->size(), output, format, dateFormat, *options.window);
+      }
+      else
+      {
+        binlog::BlockEntryStream blocks(binlog::Range{mappedInput->data(), mappedInput->size()});
+        print(blocks, output, options, dictionaryDirectory, where);
+        skippedBytes = blocks.skippedBytes();
+      }
+      if (skippedBytes != 0)
+      {
+        std::cerr << "[bread] Skipped " << skippedBytes << " bytes of damaged blocks in '" << inputPath << "'\n";
+      }
+    }
+    else if (index && options.findValue && index->hasFilters())
+    {
+      FindEntryStream candidates(mappedInput->data(), mappedInput->size(), *index, *options.findValue);
+      print(candidates, output, options, dictionaryDirectory, where);
+    }
+    else if (index && ! where)
+    {
+      printEvents(mappedInput->data(), mappedInput->size(), *index, output, format, dateFormat, *options.window);
+    }
+    else if (mappedInput && options.threadCount > 1 && ! where && ! options.sorted && ! options.window
+      && ! options.json && ! options.split && options.outputs == nullptr)
+    {
+      // split the logfile concurrently, instead of reading the entries sequentially
+      const char* data = mappedInput->data();
+      const std::vector<EntryChunk> chunks = splitEntries(data, mappedInput->size(), std::size_t{4} << 20, options.threadCount);
+      if (hasMetadata(data, chunks, binlog::DictionaryReference::Tag))
+      {
+        print(*mappedInput, output, options, dictionaryDirectory, where); // resolves the dictionaries
+      }
+      else
+      {
+        printEvents(data, mappedInput->size(), chunks, output, format, dateFormat, options.threadCount);
+      }
+    }
+    else if (mappedInput)
+    {
+      print(*mappedInput, output, options, dictionaryDirectory, where);
+    }
+    else
+    {
+      print(input, output, options, dictionaryDirectory, compressed);
+    }
+  }
+  catch (const std::exception& ex)
+  {
+    std::cerr << "[bread] Exception: " << ex.what() << "\n";
+    return 3;
+  }
+
+  return 0;
+}
+
+/** @returns the path `outputDirectory`/`inputPath` would be converted to: the file name with .blog replaced by .txt */
+std::string outputPathOf(const std::string& inputPath, const std::string& outputDirectory)
+{
+  const std::size_t slash = inputPath.find_last_of('/');
+  std::string name = (slash == std::string::npos) ? inputPath : inputPath.substr(slash + 1);
+  const std::string extension = ".blog";
+  if (name.size() > extension.size() && name.compare(name.size() - extension.size(), extension.size(), extension) == 0)
+  {
+    name.resize(name.size() - extension.size());
+  }
+  return outputDirectory + "/" + name + ".txt";
+}
+
+/**
+ * Convert each of `inputPaths` on `threadCount` threads, one logfile per thread at a time.
+ *
+ * If `outputDirectory` is empty, the outputs are concatenated to stdout in the order of `inputPaths`:
+ * the text of a logfile is kept in memory until the logfiles before it are written.
+ * A logfile is only started if there are less than `threadCount` converted logfiles waiting to be written.
+ * Otherwise, each logfile is converted to its own file in `outputDirectory`, see outputPathOf.
+ *
+ * @returns the largest exit code of the conversions, see convertFile
+ */
+int convertFiles(const std::vector<std::string>& inputPaths, const std::string& outputDirectory, std::size_t threadCount, const Options& options)
+{
+  struct Result
+  {
+    bool done = false;
+    std::string text;
+    int exitCode = 0;
+  };
+
+  std::vector<Result> results(inputPaths.size());
+  std::mutex mutex; // guards the variables below and `results`
+  std::condition_variable cv;
+  std::size_t next = 0;    // the index of the next logfile to convert
+  std::size_t written = 0; // the number of results written to stdout
+
+  const auto convert = [&](std::size_t i)
+  {
+    if (! outputDirectory.empty())
+    {
+      const std::string outputPath = outputPathOf(inputPaths[i], outputDirectory);
+      std::ofstream output(outputPath, std::ios_base::out | std::ios_base::binary);
+      if (! output)
+      {
+        std::cerr << "[bread] Failed to open '" << outputPath << "' for writing\n";
+        return 2;
+      }
+      return convertFile(inputPaths[i], output, options);
+    }
+
+    std::ostringstream output;
+    const int exitCode = convertFile(inputPaths[i], output, options);
+    results[i].text = output.str();
+    return exitCode;
+  };
+
+  const auto work = [&]()
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+      // in concatenated mode, do not get too far ahead of the writer
+      cv.wait(lock, [&]() { return next == inputPaths.size() || ! outputDirectory.empty() || next < written + threadCount; });
+      if (next == inputPaths.size()) { return; }
+
+      const std::size_t i = next++;
+      lock.unlock();
+      const int exitCode = convert(i);
+      lock.lock();
+
+      results[i].exitCode = exitCode;
+      results[i].done = true;
+      cv.notify_all();
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (std::size_t t = 0; t < threadCount && t < inputPaths.size(); ++t) { threads.emplace_back(work); }
+
+  int exitCode = 0;
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (; written < results.size(); ++written)
+    {
+      Result& result = results[written];
+      cv.wait(lock, [&]() { return result.done; });
+
+      std::string text = std::move(result.text);
+      lock.unlock();
+      std::cout.write(text.data(), std::streamsize(text.size()));
+      lock.lock();
+
+      if (result.exitCode > exitCode) { exitCode = result.exitCode; }
+      cv.notify_all(); // a worker might wait for this
+    }
+  }
+
+  for (std::thread& thread : threads) { thread.join(); }
+  return exitCode;
+}
+
 void showHelp()
 {
   std::cout <<
     "bread -- convert binary logfiles to human readable text\n"
     "\n"
     "Synopsis:\n"
-    "  bread [-f format] [-d date-format] [-s] filename\n"
+    "  bread [-f format] [-d date-format] [-s] [-W window] [-j threads] [-b begin] [-e end] [-w expression] [-F value] [-g text] [-D directory] [-o directory] [-S field] [-B bytes] [-A module] [-P plugin] [-O kind:path] [-z] [-Z dictionary] [-t] [-T] [-J] [-R] filename...\n"
     "\n"
     "Examples:\n"
     "  bread logfile.blog"                                 "\n"
     "  bread -f '%S %m (%G:%L)' logfile.blog"              "\n"
     "  zcat logfile.blog.gz | bread -f '%S %m (%G:%L)' -"  "\n"
     "  tail -c +0 -F logfile.blog | bread"                 "\n"
+    "  bread -t logfile.blog"                              "\n"
+    "  bread -t -W 200ms logfile.blog"                     "\n"
+    "  bread -j 8 logfile.blog"                            "\n"
+    "  bread -j 4 logfile-*.blog > all.txt"                "\n"
+    "  bread -j 4 -o text/ logfile-*.blog"                 "\n"
+    "  bread -S writer -o threads/ logfile.blog"           "\n"
+    "  bread -b 2026-01-02T10:00:00 -e 2026-01-02T10:05:00 logfile.blog" "\n"
+    "  bread -w 'severity>=warning && category==orders && file~\"Router\"' logfile.blog" "\n"
+    "  bread -F 123456789 logfile.blog"                    "\n"
+    "  bread -g 'connection refused' logfile.blog"         "\n"
+    "  bread -T logfile.blog > trace.json"                 "\n"
+    "  bread -J -w 'severity>=error' logfile.blog > errors.ndjson" "\n"
+    "  bread -R logfile.blog"                              "\n"
+    "  bread -O text:logfile.txt -O json:logfile.ndjson -O stats:stats.txt logfile.blog" "\n"
     "\n"
     "Arguments:\n"
     "  filename       Path to a logfile. If '-' or unspecified, read from stdin\n"
+    "                 If multiple logfiles are given, their text is written in the given order\n"
     "  format         Arbitrary string with optional placeholders, see 'Event Format'\n"
     "  date-format    Arbitrary string with optional placeholders, see 'Date Format'\n"
     "\n"
@@ -45,6 +670,48 @@ void showHelp()
     "  -f             Set a custom format string to write events, see 'Event Format'\n"
     "  -d             Set a custom format string to write timestamps, see 'Date Format'\n"
     "  -s             Sort events by time\n"
+    "  -W             Sort events by time as they are read, in the given reorder window: a duration (e.g: 500ms, 2s,\n"
+    "                 units: ns, us, ms, s) or an event count (e.g: 10000). An event is printed if it is out of\n"
+    "                 the window, or if the input ends or gets idle. Can be combined with -t, implies -s\n"
+    "  -j             Format events on the given number of threads (default: 1, ignored if -s, -b or -e is set)\n"
+    "                 Regular files are also split to chunks concurrently, at entry boundaries found by scanning\n"
+    "                 If multiple logfiles are given, convert that many logfiles concurrently instead\n"
+    "  -b             Only print events at or after the given UTC time (YYYY-MM-DDTHH:MM:SS[.fraction])\n"
+    "  -e             Only print events at or before the given UTC time (YYYY-MM-DDTHH:MM:SS[.fraction])\n"
+    "                 If the logfile has a time index (filename.idx), it is used to skip irrelevant parts,\n"
+    "                 logfiles written by BlockOutputStream are searched by binary search\n"
+    "  -w             Only print events matching the given expression, see 'Where Expression'\n"
+    "  -F             Only print events having an argument equal to the given value, same as -w 'value==\"value\"'\n"
+    "                 If the time index of the logfile (filename.idx) has filters, it is used to skip irrelevant blocks\n"
+    "  -g             Only print events whose message contains the given text, same as -w 'message~\"text\"'\n"
+    "                 Sources with the text in their format string are accepted, others are rejected if the text\n"
+    "                 cannot be in their messages, events are formatted only if the string arguments do not contain it\n"
+    "  -D             Read the dictionaries referenced by the logfile from the given directory\n"
+    "                 (default: the directory of the logfile, see RotatingFileSink)\n"
+    "  -o             Write the text of each logfile to the given directory, as filename.txt (.blog replaced)\n"
+    "  -S             Split the events to separate files in the directory of -o, by the given field:\n"
+    "                 writer (writerid_writername.txt), category (category.txt) or severity (e.g: INFO.txt)\n"
+    "                 The logfile is read once, each file is written through its own buffer\n"
+    "  -B             Size of the buffer of each file of -S, in bytes (default: 65536)\n"
+    "  -A             Show the function pointed by binlog::address arguments, that point into the given\n"
+    "                 executable or shared library, loaded at the given base address (path[@base], base in hex,\n"
+    "                 default: 0, for non-PIE executables). Can be repeated, the symbol tables are read once\n"
+    "  -P             Load the given printer plugin (shared library), that adds custom printers of structs and enums,\n"
+    "                 see PrettyPrinter::loadPrinterPlugin. Can be repeated\n"
+    "  -O             Write the events to the given file instead of stdout, as kind: text (see -f and -d),\n"
+    "                 json (as -J) or stats (as bstat). Can be repeated, the logfile is read and decoded once,\n"
+    "                 each file is written by its own thread\n"
+    "  -z             Read frames compressed by CompressedOutputStream (detected automatically for regular files)\n"
+    "  -Z             Read the frames compressed with the given dictionary (e.g: trained by btrain). Can be repeated\n"
+    "                 Regular files written by BlockOutputStream are detected automatically, damaged blocks are skipped\n"
+    "  -t             Follow the logfile: wait for new entries, reopen it if it is rotated (like tail -F)\n"
+    "  -T             Write the events in Chrome trace JSON format (for chrome://tracing or the Perfetto UI),\n"
+    "                 events of BINLOG_SCOPE become spans, the other events instants, on the timeline of their writer\n"
+    "  -J             Write the events as JSON lines: an object per line, with the fields of the event\n"
+    "                 (time, clock, writer, writer_id, severity, category, function, file, line, format, message)\n"
+    "                 and its arguments (args) as JSON values. -f and -d are ignored\n"
+    "  -R             Read the logfiles as a single logfile, in the given order, metadata repeated by later files is skipped.\n"
+    "                 A single filename is read with the files rotated by RotatingFileSink: filename.1, filename.2, ..., filename\n"
     "\n"
     "Event Format\n"
     "  Log events are transformed to text by substituting placeholders"
@@ -61,14 +728,35 @@ void showHelp()
     "  %T \t Argument tags\n"
     "  %n \t Writer (thread) name\n"
     "  %t \t Writer (thread) id\n"
+    "  %c \t Writer context (e.g: trace id)\n"
     "  %d \t Timestamp, in producer timezone\n"
     "  %u \t Timestamp, in UTC\n"
     "  %r \t Timestamp, raw clock value\n"
     "  %m \t Message (format string with arguments substituted)\n"
+    "  %h \t Message, byte (uint8_t) sequences as hexadecimal digits, e.g: 0x0a1bff\n"
     "  %% \t Literal %\n"
     "\n"
     "  Default format string: \"" BINLOG_DEFAULT_FORMAT "\"\n"
     "\n"
+    "Where Expression\n"
+    "  Comparisons of event fields, combined by && (and), || (or), ! (not) and parentheses.\n"
+    "  A comparison is: field op value, where op is one of: == != < <= > >= ~ (contains).\n"
+    "  Values are words or \"quoted strings\". Available fields:\n"
+    "\n"
+    "  severity \t Severity, compared by rank (e.g: severity>=warning)\n"
+    "  category \t Category\n"
+    "  function \t Function\n"
+    "  file     \t File, full path\n"
+    "  line     \t Line\n"
+    "  format   \t Format string\n"
+    "  id       \t Source id\n"
+    "  argN     \t The N'th argument (N = 0, 1, ...), if it is a number (e.g: arg0>100)\n"
+    "  value    \t Any integer or string argument, only == and != (e.g: value==123456789)\n"
+    "  message  \t The message, only ~ (e.g: message~\"refused\")\n"
+    "\n"
+    "  Events are selected by their source, without formatting them,\n"
+    "  numeric arguments are compared without formatting the other arguments.\n"
+    "\n"
     "Date Format\n"
     "  Timestamps are transformed to text by substituting placeholders"
     " of the date format string by date components. Available placeholders:\n"
@@ -94,13 +782,34 @@ void showHelp()
 
 int main(int argc, /*const*/ char* argv[])
 {
-  std::string inputPath = "-";
   std::string format = BINLOG_DEFAULT_FORMAT "\n";
   std::string dateFormat = BINLOG_DEFAULT_DATE_FORMAT;
   bool sorted = false;
+  ReorderWindow reorderWindow;
+  bool hasReorderWindow = false;
+  std::size_t threadCount = 1;
+  TimeWindow window{std::chrono::nanoseconds::min(), std::chrono::nanoseconds::max()};
+  bool hasWindow = false;
+  bool compressed = false;
+  std::vector<std::string> compressionDictionaries;
+  bool follow = false;
+  bool trace = false;
+  bool json = false;
+  bool series = false;
+  std::string whereExpression;
+  std::string findValue;
+  bool hasFind = false;
+  std::string grepText;
+  bool hasGrep = false;
+  std::string dictionaryDirectory;
+  std::string outputDirectory;
+  bool split = false;
+  SplitBy splitBy = SplitBy::writer;
+  std::size_t splitBufferSize = 1 << 16;
+  std::vector<OutputSpec> outputSpecs;
 
   int opt;
-  while ((opt = getopt(argc, argv, "f:d:sh")) != -1) // NOLINT(concurrency-mt-unsafe)
+  while ((opt = getopt(argc, argv, "f:d:sW:j:b:e:w:F:g:D:o:S:B:A:P:O:zZ:tTJRh")) != -1) // NOLINT(concurrency-mt-unsafe)
   {
     switch (opt)
     {
@@ -114,6 +823,132 @@ int main(int argc, /*const*/ char* argv[])
     case 's':
       sorted = true;
       break;
+    case 'W':
+      if (! parseReorderWindow(optarg, reorderWindow))
+      {
+        std::cerr << "[bread] Invalid reorder window: '" << optarg << "', expected: a duration (e.g: 500ms) or an event count\n";
+        return 1;
+      }
+      sorted = true;
+      hasReorderWindow = true;
+      break;
+    case 'j':
+      threadCount = parseThreadCount(optarg);
+      if (threadCount == 0)
+      {
+        std::cerr << "[bread] Invalid thread count: '" << optarg << "'\n";
+        return 1;
+      }
+      break;
+    case 'b':
+    case 'e':
+      if (! parseTime(optarg, (opt == 'b') ? window.from : window.to))
+      {
+        std::cerr << "[bread] Invalid time: '" << optarg << "', expected: YYYY-MM-DDTHH:MM:SS[.fraction]\n";
+        return 1;
+      }
+      hasWindow = true;
+      break;
+    case 'w':
+      whereExpression = optarg;
+      break;
+    case 'F':
+      findValue = optarg;
+      hasFind = true;
+      if (findValue.find('"') != std::string::npos)
+      {
+        std::cerr << "[bread] Invalid value: '" << optarg << "', must not contain '\"'\n";
+        return 1;
+      }
+      break;
+    case 'g':
+      grepText = optarg;
+      hasGrep = true;
+      if (grepText.find('"') != std::string::npos)
+      {
+        std::cerr << "[bread] Invalid text: '" << optarg << "', must not contain '\"'\n";
+        return 1;
+      }
+      break;
+    case 'D':
+      dictionaryDirectory = optarg;
+      break;
+    case 'o':
+      outputDirectory = optarg;
+      break;
+    case 'S':
+      if (! parseSplitBy(optarg, splitBy))
+      {
+        std::cerr << "[bread] Invalid split field: '" << optarg << "', expected: writer, category or severity\n";
+        return 1;
+      }
+      split = true;
+      break;
+    case 'B':
+      splitBufferSize = parseBufferSize(optarg);
+      if (splitBufferSize == 0)
+      {
+        std::cerr << "[bread] Invalid buffer size: '" << optarg << "'\n";
+        return 1;
+      }
+      break;
+    case 'A':
+    {
+      std::string path;
+      std::uint64_t base = 0;
+      if (! parseAddressModule(optarg, path, base))
+      {
+        std::cerr << "[bread] Invalid module: '" << optarg << "', expected: path[@base]\n";
+        return 1;
+      }
+      addAddressModule(std::move(path), base);
+      break;
+    }
+    case 'P':
+      try
+      {
+        addPrinterPlugin(optarg);
+      }
+      catch (const std::runtime_error& ex)
+      {
+        std::cerr << "[bread] " << ex.what() << "\n";
+        return 1;
+      }
+      break;
+    case 'O':
+      outputSpecs.emplace_back();
+      if (! parseOutputSpec(optarg, outputSpecs.back()))
+      {
+        std::cerr << "[bread] Invalid output: '" << optarg << "', expected: text:path, json:path or stats:path\n";
+        return 1;
+      }
+      break;
+    case 'z':
+      compressed = true;
+      break;
+    case 'Z':
+    {
+      std::ifstream file(optarg, std::ios_base::in | std::ios_base::binary);
+      if (! file)
+      {
+        std::cerr << "[bread] Failed to open compression dictionary '" << optarg << "'\n";
+        return 1;
+      }
+      compressionDictionaries.emplace_back(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+      break;
+    }
+    case 't':
+      follow = true;
+      break;
+    case 'T':
+      trace = true;
+      break;
+    case 'J':
+      json = true;
+      break;
+    case 'R':
+      series = true;
+      break;
     case 'h':
       showHelp();
       return 0;
@@ -124,37 +959,143 @@ int main(int argc, /*const*/ char* argv[])
     }
   }
 
-  if (optind < argc)
+  std::vector<std::string> inputPaths(argv + optind, argv + argc);
+  if (inputPaths.empty()) { inputPaths.push_back("-"); }
+  const std::string& inputPath = inputPaths.front();
+
+  if (hasFind)
   {
-    inputPath = argv[optind];
+    const std::string value = "value==\"" + findValue + "\"";
+    whereExpression = (whereExpression.empty()) ? value : "(" + whereExpression + ") && " + value;
   }
 
-  std::ifstream inputFile;
-  std::istream& input = openFile(inputPath, inputFile);
-  if (! input)
+  if (hasGrep)
   {
-    std::cerr << "[bread] Failed to open '" << inputPath << "' for reading\n";
-    return 2;
+    const std::string message = "message~\"" + grepText + "\"";
+    whereExpression = (whereExpression.empty()) ? message : "(" + whereExpression + ") && " + message;
+  }
+
+  std::unique_ptr<WherePredicate> where;
+  if (! whereExpression.empty())
+  {
+    try
+    {
+      where.reset(new WherePredicate(whereExpression));
+    }
+    catch (const std::runtime_error& ex)
+    {
+      std::cerr << "[bread] " << ex.what() << "\n";
+      return 1;
+    }
   }
 
+  if (sorted && hasWindow)
+  {
+    std::cerr << "[bread] -s can not be combined with -b or -e\n";
+    return 1;
+  }
+
+  if (trace && (sorted || hasWindow || follow))
+  {
+    std::cerr << "[bread] -T can not be combined with -s, -b, -e or -t\n";
+    return 1;
+  }
+
+  if (json && (sorted || hasWindow || split || trace))
+  {
+    std::cerr << "[bread] -J can not be combined with -s, -b, -e, -S or -T\n";
+    return 1;
+  }
+
+  if (split && (outputDirectory.empty() || inputPaths.size() > 1 || sorted || hasWindow || follow || trace))
+  {
+    std::cerr << "[bread] -S requires -o and a single logfile, it can not be combined with -s, -b, -e, -t or -T\n";
+    return 1;
+  }
+
+  if (! outputSpecs.empty() && (sorted || hasWindow || split || trace || json || follow || ! outputDirectory.empty() || (inputPaths.size() > 1 && ! series)))
+  {
+    std::cerr << "[bread] -O can not be combined with -s, -b, -e, -S, -T, -J, -t, -o or multiple logfiles without -R\n";
+    return 1;
+  }
+
+  // the files of -O, open until the end of main
+  std::vector<std::unique_ptr<std::ofstream>> outputFiles;
+  std::vector<Output> outputs;
+  for (const OutputSpec& spec : outputSpecs)
+  {
+    outputFiles.emplace_back(new std::ofstream(spec.path, std::ios_base::out | std::ios_base::binary));
+    if (! *outputFiles.back())
+    {
+      std::cerr << "[bread] Failed to open '" << spec.path << "' for writing\n";
+      return 2;
+    }
+    outputs.push_back(Output{spec.kind, outputFiles.back().get()});
+  }
+
+#ifndef _WIN32
+  // write stdout directly, in large chunks, see FdStreambuf
+  FdStreambuf stdoutBuffer(STDOUT_FILENO);
+  const StreambufReplacement stdoutReplacement(std::cout, stdoutBuffer);
+#endif
+
+  if (inputPaths.size() > 1 && ! series && (follow || (trace && outputDirectory.empty())))
+  {
+    std::cerr << "[bread] Multiple logfiles can not be combined with -t, or -T without -o\n";
+    return 1;
+  }
+
+  Options options;
+  options.format = format;
+  options.dateFormat = dateFormat;
+  options.sorted = sorted;
+  options.reorderWindow = (hasReorderWindow) ? &reorderWindow : nullptr;
+  options.follow = follow;
+  options.window = (hasWindow) ? &window : nullptr;
+  options.compressed = compressed;
+  options.compressionDictionaries = std::move(compressionDictionaries);
+  options.trace = trace;
+  options.json = json;
+  options.where = where.get();
+  options.findValue = (hasFind) ? &findValue : nullptr;
+  options.dictionaryDirectory = dictionaryDirectory;
+  options.split = split;
+  options.splitBy = splitBy;
+  options.splitDirectory = outputDirectory;
+  options.splitBufferSize = splitBufferSize;
+  options.outputs = (outputs.empty()) ? nullptr : &outputs;
+
   std::ostream::sync_with_stdio(false);
 
-  try
+  if (follow)
   {
-    if (sorted)
+    if ((sorted && ! hasReorderWindow) || compressed || series || inputPath == "-" || ! outputDirectory.empty())
     {
-      printSortedEvents(input, std::cout, format, dateFormat);
+      std::cerr << "[bread] -t can not be combined with -s (use -W), -z, -o, -R or reading stdin\n";
+      return 1;
     }
-    else
+
+    return followFile(inputPath, options);
+  }
+
+  if (series)
+  {
+    if (compressed || split || inputPath == "-" || ! outputDirectory.empty())
     {
-      printEvents(input, std::cout, format, dateFormat);
+      std::cerr << "[bread] -R can not be combined with -z, -o, -S or reading stdin\n";
+      return 1;
     }
+
+    options.threadCount = threadCount;
+    return convertSeries(inputPaths, std::cout, options);
   }
-  catch (const std::exception& ex)
+
+  if (inputPaths.size() == 1 && (outputDirectory.empty() || split))
   {
-    std::cerr << "[bread] Exception: " << ex.what() << "\n";
-    return 3;
+    options.threadCount = threadCount;
+    return convertFile(inputPath, std::cout, options);
   }
 
-  return 0;
+  // convert the logfiles concurrently, each on a single thread
+  return convertFiles(inputPaths, outputDirectory, threadCount, options);
 }
@@ -1,16 +1,28 @@
 #include <binlog/binlog.hpp>
 
+#include <binlog/EntryStream.hpp>
 #include <binlog/TextOutputStream.hpp>
 
+#include <algorithm> // sort, min
 #include <array>
+#include <atomic>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <fstream>
 #include <iostream>
-#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
 #include <type_traits>
+#include <vector>
+
+#ifndef _WIN32
+  #include <dirent.h> // NOLINT opendir, readdir
+  #include <sys/stat.h> // NOLINT stat
+#endif
 
 enum class BufferType
 {
@@ -27,6 +39,23 @@ struct RecoveredBuffer
   std::vector<char> buffer;
 };
 
+/** A magic number found in the input, and the result of reading the buffer following it */
+struct Candidate
+{
+  std::size_t offset;     // of the magic number in the input
+  std::size_t end;        // end of the structure following the magic, if recovered
+  bool recovered;
+  std::string message;    // describes the recovered buffer, or the reason of failure
+  RecoveredBuffer buffer;
+};
+
+/** A range of the input to search for magic numbers */
+struct Segment
+{
+  std::size_t begin;
+  std::size_t end;
+};
+
 namespace {
 
 void printLogs()
@@ -47,7 +76,8 @@ void showHelp()
     "  brecovery corefile [outputfile]\n"
     "\n"
     "Arguments:\n"
-    "  corefile        Path to a corefile (memory dump)\n"
+    "  corefile        Path to a corefile (memory dump), or to a directory\n"
+    "                  of queue and metadata files, see MmapChannelAllocator::Options::directory\n"
     "  outputfile      Path to write recovered data. If '-' or unspecified, read from stdin\n"
     "\n"
     "Notes:\n"
@@ -60,6 +90,14 @@ void showHelp()
     "    $ brecovery app.core recovered.blog\n"
     "    $ bread recovered.blog\n"
     "\n"
+    "  If the corefile is an ELF core dump, only its writable segments are searched.\n"
+    "  The corefile is searched by multiple threads, in parallel.\n"
+    "\n"
+    "  If the channels of the crashed process were backed by files,\n"
+    "  no memory dump is needed, the directory of the files can be recovered:\n"
+    "\n"
+    "    $ brecovery /var/lib/app/queues recovered.blog\n"
+    "\n"
     "Report bugs to:\n"
     "  https://github.com/Morgan-Stanley/binlog/issues\n";
     ;
@@ -83,6 +121,15 @@ std::array<unsigned char, 8> toArray(std::uint64_t n)
   return result;
 }
 
+template <typename T>
+T readAt(const char* input, std::size_t offset)
+{
+  static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+  T result;
+  memcpy(&result, input + offset, sizeof(T));
+  return result;
+}
+
 bool checkEntryBuffer(const std::vector<char>& buffer)
 {
   binlog::Range range(buffer.data(), buffer.size());
@@ -96,229 +143,457 @@ bool checkEntryBuffer(const std::vector<char>& buffer)
   }
   catch (const std::runtime_error&)
   {
-    STDERR_ERROR("  Buffer contains invalid entry");
     return false;
   }
 
   return true;
 }
 
-std::size_t remainingSize(std::istream& input)
+/**
+ * Read the session metadata following the magic number, that ends at `pos`.
+ *
+ * Layout: [u64 magic|ptr session|u64 size][...size bytes of data...]
+ */
+bool readMetadata(const char* input, std::size_t inputSize, std::size_t pos, Candidate& candidate)
 {
-  const auto pos = input.tellg();
-  input.seekg(0, std::ios_base::end);
-  const auto end = input.tellg();
-  const std::size_t size = std::size_t(end - pos);
-  input.seekg(pos);
-  return size;
-}
+  if (inputSize - pos < sizeof(void*) + sizeof(std::uint64_t))
+  {
+    candidate.message = "Input ends in the metadata header";
+    return false;
+  }
 
-bool readMetadata(std::istream& input, std::vector<RecoveredBuffer>& output)
-{
   // get session ptr as a number
-  void* sessionptr = nullptr;
-  input.read(reinterpret_cast<char*>(&sessionptr), sizeof(void*));
-  const std::uintptr_t session = reinterpret_cast<std::uintptr_t>(sessionptr);
+  const std::uintptr_t session = readAt<std::uintptr_t>(input, pos);
+  pos += sizeof(void*);
 
   // get the size of the metadata in the buffer
-  std::size_t size = 0;
-  input.read(reinterpret_cast<char*>(&size), sizeof(size));
+  const std::uint64_t size = readAt<std::uint64_t>(input, pos);
+  pos += sizeof(std::uint64_t);
 
-  // get the buffer
-  if (size > remainingSize(input))
+  if (size > inputSize - pos)
   {
-    STDERR_ERROR("  Input doesn't have {} bytes", size);
+    candidate.message = "Input doesn't have " + std::to_string(size) + " bytes";
     return false;
   }
 
   std::vector<char> metadata;
   try
   {
-    metadata.resize(size);
+    metadata.assign(input + pos, input + pos + size);
   }
   catch (const std::bad_alloc&)
   {
-    STDERR_ERROR("  Failed to allocate {} bytes for metadata", size);
+    candidate.message = "Failed to allocate " + std::to_string(size) + " bytes for metadata";
     return false;
   }
-  input.read(metadata.data(), std::streamsize(size));
 
-  if (! input)
+  if (! checkEntryBuffer(metadata))
   {
-    STDERR_ERROR("  Failed to read {} bytes of metadata from input", size);
+    candidate.message = "Buffer contains invalid entry";
     return false;
   }
 
-  if (! checkEntryBuffer(metadata)) { return false; }
-
-  STDERR_INFO("  Recovered {} bytes of metadata from session={}", metadata.size(), session);
-
-  output.push_back(RecoveredBuffer{BufferType::Metadata, session, std::move(metadata)});
+  candidate.message = "Recovered " + std::to_string(metadata.size())
+    + " bytes of metadata from session=" + std::to_string(session);
+  candidate.end = pos + std::size_t(size);
+  candidate.buffer = RecoveredBuffer{BufferType::Metadata, session, std::move(metadata)};
   return true;
 }
 
-bool checkQueueInvariants(binlog::detail::Queue& queue)
+std::string checkQueueInvariants(const binlog::detail::Queue& queue)
 {
   if (queue.writeIndex > queue.capacity)
   {
-    BINLOG_ERROR("  Queue invariant violated: writer={} > capacity={}", queue.writeIndex.load(), queue.capacity);
-    return false;
+    return "Queue invariant violated: writer=" + std::to_string(queue.writeIndex.load())
+      + " > capacity=" + std::to_string(queue.capacity);
   }
 
   if (queue.dataEnd > queue.capacity)
   {
-    BINLOG_ERROR("  Queue invariant violated: dataEnd={} > capacity={}", queue.dataEnd, queue.capacity);
-    return false;
+    return "Queue invariant violated: dataEnd=" + std::to_string(queue.dataEnd)
+      + " > capacity=" + std::to_string(queue.capacity);
   }
 
   if (queue.readIndex > queue.capacity)
   {
-    BINLOG_ERROR("  Queue invariant violated: reader={} > capacity={}", queue.readIndex.load(), queue.capacity);
-    return false;
+    return "Queue invariant violated: reader=" + std::to_string(queue.readIndex.load())
+      + " > capacity=" + std::to_string(queue.capacity);
   }
 
-  return true;
+  return {};
 }
 
-bool readData(std::istream& input, std::vector<RecoveredBuffer>& output)
+/**
+ * Read the channel following the magic number, that ends at `pos`.
+ *
+ * Layout: [u64 magic|ptr session|Queue][...capacity bytes of queue buffer...]
+ */
+bool readData(const char* input, std::size_t inputSize, std::size_t pos, Candidate& candidate)
 {
+  if (inputSize - pos < sizeof(void*) + sizeof(binlog::detail::Queue))
+  {
+    candidate.message = "Input ends in the queue header";
+    return false;
+  }
+
   // get session ptr as a number
-  void* sessionptr = nullptr;
-  input.read(reinterpret_cast<char*>(&sessionptr), sizeof(void*));
-  const std::uintptr_t session = reinterpret_cast<std::uintptr_t>(sessionptr);
+  const std::uintptr_t session = readAt<std::uintptr_t>(input, pos);
+  pos += sizeof(void*);
 
   // get queue with writer and reader positions
-  // Depending on the standard/compiler, the assert below is invalid
+  // Depending on the standard/compiler, memcpy below is invalid
   // because of the std::atomic inside Queue - but we do not care.
-  // static_assert(std::is_trivially_copyable<binlog::detail::Queue>::value, "Queue must be trivial");
   binlog::detail::Queue queue(nullptr, 0);
-  input.read(reinterpret_cast<char*>(&queue), sizeof(queue));
+  memcpy(static_cast<void*>(&queue), input + pos, sizeof(queue));
+  pos += sizeof(queue);
 
-  if (! checkQueueInvariants(queue)) { return false; }
+  const std::string error = checkQueueInvariants(queue);
+  if (! error.empty())
+  {
+    candidate.message = error;
+    return false;
+  }
 
-  STDERR_INFO("  Queue state is valid: capacity={} windex={} rindex={} dataend={}",
-    queue.capacity, queue.writeIndex.load(), queue.readIndex.load(), queue.dataEnd);
+  std::string state = "capacity=" + std::to_string(queue.capacity)
+    + " windex=" + std::to_string(queue.writeIndex.load())
+    + " rindex=" + std::to_string(queue.readIndex.load())
+    + " dataend=" + std::to_string(queue.dataEnd);
 
   // get queue buffer
-  if (queue.capacity > remainingSize(input))
+  if (queue.capacity > inputSize - pos)
   {
-    STDERR_ERROR("  Input doesn't have {} bytes", queue.capacity);
+    candidate.message = "Input doesn't have " + std::to_string(queue.capacity) + " bytes, queue state: " + state;
     return false;
   }
 
-  std::vector<char> queueBuffer;
+  // create a reader, get the unread data from the buffer.
+  // The buffer is not written, only Queue::buffer is needed to be non-const.
+  // The mirror of a mirrored queue is not assumed to follow the buffer in the input:
+  // its dataEnd is the capacity, it is read as a regular queue, in two parts.
+  queue.buffer = const_cast<char*>(input + pos); // NOLINT(cppcoreguidelines-pro-type-const-cast)
+  queue.mirrored = false;
+  binlog::detail::QueueReader reader(queue);
+  const binlog::detail::QueueReader::ReadResult dataview = reader.beginRead();
+
+  std::vector<char> data;
   try
   {
-    queueBuffer.resize(queue.capacity);
+    data.reserve(dataview.size());
   }
   catch (const std::bad_alloc&)
   {
-    STDERR_ERROR("  Failed to allocate {} bytes for queue data", queue.capacity);
+    candidate.message = "Failed to allocate " + std::to_string(dataview.size()) + " bytes for queue data";
     return false;
   }
-  input.read(queueBuffer.data(), std::streamsize(queueBuffer.size()));
-
-  if (! input) { return false; }
-
-  // create a reader, get the unread data from the buffer
-  queue.buffer = queueBuffer.data();
-  binlog::detail::QueueReader reader(queue);
-  const binlog::detail::QueueReader::ReadResult dataview = reader.beginRead();
-
-  std::vector<char> data;
-  data.reserve(dataview.size());
   data.insert(data.end(), dataview.buffer1, dataview.buffer1 + dataview.size1);
   data.insert(data.end(), dataview.buffer2, dataview.buffer2 + dataview.size2);
 
-  if (! checkEntryBuffer(data)) { return false; }
-
-  STDERR_INFO("  Recovered {} bytes of data from session={}", data.size(), session);
+  if (! checkEntryBuffer(data))
+  {
+    candidate.message = "Buffer contains invalid entry, queue state: " + state;
+    return false;
+  }
 
-  output.push_back(RecoveredBuffer{BufferType::Data, session, std::move(data)});
+  candidate.message = "Recovered " + std::to_string(data.size())
+    + " bytes of data from session=" + std::to_string(session) + ", queue state: " + state;
+  candidate.end = pos + queue.capacity;
+  candidate.buffer = RecoveredBuffer{BufferType::Data, session, std::move(data)};
   return true;
 }
 
-} // namespace
+/**
+ * Search the magic numbers which start in [begin, end) of `input`,
+ * read the structures following them.
+ * The structures (and the magic numbers) might extend beyond `end`.
+ */
+void searchRange(const char* input, std::size_t inputSize, std::size_t begin, std::size_t end, std::vector<Candidate>& result)
+{
+  // do not initialize arrays directly to remain endianness agnostic
+  const std::array<unsigned char, 8> metadataMagic = toArray(0xFE214F726E35BDBC);
+  const std::array<unsigned char, 8> dataMagic = toArray(0xFE213F716D34BCBC);
 
-int main(int argc, const char* argv[])
+  // magic numbers start with the same byte, makes searching easier:
+  // memchr is vectorized by the standard library
+  assert(metadataMagic[0] == dataMagic[0]);
+  const int firstMagicByte = metadataMagic[0];
+
+  const std::size_t lastMagicPos = (inputSize < sizeof(std::uint64_t)) ? 0 : inputSize - sizeof(std::uint64_t) + 1;
+  end = (std::min)(end, lastMagicPos);
+
+  std::size_t pos = begin;
+  while (pos < end)
+  {
+    const void* found = memchr(input + pos, firstMagicByte, end - pos);
+    if (found == nullptr) { break; }
+
+    pos = std::size_t(static_cast<const char*>(found) - input);
+    const char* magic = input + pos;
+    const std::size_t afterMagicPos = pos + sizeof(std::uint64_t);
+
+    if (memcmp(magic, metadataMagic.data(), metadataMagic.size()) == 0)
+    {
+      Candidate candidate{pos, 0, false, {}, RecoveredBuffer{BufferType::Metadata, 0, {}}};
+      candidate.recovered = readMetadata(input, inputSize, afterMagicPos, candidate);
+      result.push_back(std::move(candidate));
+    }
+    else if (memcmp(magic, dataMagic.data(), dataMagic.size()) == 0)
+    {
+      Candidate candidate{pos, 0, false, {}, RecoveredBuffer{BufferType::Data, 0, {}}};
+      candidate.recovered = readData(input, inputSize, afterMagicPos, candidate);
+      result.push_back(std::move(candidate));
+    }
+
+    ++pos;
+  }
+}
+
+/**
+ * @returns the file ranges of the writable PT_LOAD segments,
+ * if `input` is a 64 bit ELF core dump of the same byte order as the host,
+ * otherwise the whole input.
+ *
+ * Binlog queues and metadata are always in writable memory:
+ * read-only segments (e.g: mapped code) are not worth searching.
+ */
+std::vector<Segment> searchedSegments(const char* input, std::size_t inputSize)
 {
-  if (argc < 2)
+  const std::vector<Segment> whole{Segment{0, inputSize}};
+
+  // Elf64_Ehdr
+  constexpr std::size_t ehdrSize = 64;
+  if (inputSize < ehdrSize || memcmp(input, "\x7f" "ELF", 4) != 0) { return whole; }
+
+  const unsigned char elfClass = static_cast<unsigned char>(input[4]);
+  const unsigned char elfData = static_cast<unsigned char>(input[5]);
+  const std::uint16_t one = 1;
+  const bool hostIsLittleEndian = *reinterpret_cast<const unsigned char*>(&one) == 1;
+  const unsigned char hostData = hostIsLittleEndian ? 1 : 2; // ELFDATA2LSB : ELFDATA2MSB
+  if (elfClass != 2 /* ELFCLASS64 */ || elfData != hostData) { return whole; }
+
+  const std::uint16_t type = readAt<std::uint16_t>(input, 16);
+  if (type != 4 /* ET_CORE */) { return whole; }
+
+  const std::uint64_t phoff = readAt<std::uint64_t>(input, 32);
+  const std::uint64_t shoff = readAt<std::uint64_t>(input, 40);
+  const std::uint16_t phentsize = readAt<std::uint16_t>(input, 54);
+  std::uint64_t phnum = readAt<std::uint16_t>(input, 56);
+
+  // a core of many mappings stores the real number of segments in the first section header
+  constexpr std::uint16_t pnXnum = 0xFFFF;
+  constexpr std::size_t shdrSize = 64;
+  if (phnum == pnXnum && shoff != 0 && shoff <= inputSize - shdrSize)
   {
-    showHelp();
-    return 1;
+    phnum = readAt<std::uint32_t>(input, std::size_t(shoff) + 44); // sh_info
   }
 
-  std::ifstream input(argv[1], std::ios_base::in|std::ios_base::binary);
-  if (! input)
+  // Elf64_Phdr
+  constexpr std::size_t phdrSize = 56;
+  if (phentsize < phdrSize || phoff > inputSize || phnum > (inputSize - phoff) / phentsize) { return whole; }
+
+  std::vector<Segment> result;
+  for (std::uint64_t i = 0; i < phnum; ++i)
   {
-    STDERR_ERROR("Failed to open {} for reading", argv[1]);
-    showHelp();
-    return 2;
+    const std::size_t phdr = std::size_t(phoff + i * phentsize);
+    const std::uint32_t ptype = readAt<std::uint32_t>(input, phdr);
+    const std::uint32_t pflags = readAt<std::uint32_t>(input, phdr + 4);
+    const std::uint64_t poffset = readAt<std::uint64_t>(input, phdr + 8);
+    const std::uint64_t pfilesz = readAt<std::uint64_t>(input, phdr + 32);
+
+    const bool isLoad = ptype == 1;  // PT_LOAD
+    const bool isWritable = (pflags & 2) != 0; // PF_W
+    if (! isLoad || ! isWritable || pfilesz == 0 || poffset >= inputSize) { continue; }
+
+    const std::size_t begin = std::size_t(poffset);
+    const std::size_t end = std::size_t((std::min)(std::uint64_t(inputSize), poffset + pfilesz));
+
+    // adjacent segments are merged, to search fewer, larger ranges
+    if (! result.empty() && result.back().end == begin)
+    {
+      result.back().end = end;
+    }
+    else
+    {
+      result.push_back(Segment{begin, end});
+    }
   }
 
-  const std::string outputPath = (argc > 2) ? argv[2] : "-";
-  std::ofstream outputFile;
-  std::ostream& output = openFile(outputPath, outputFile);
-  if (! output)
+  return result;
+}
+
+/**
+ * Search `segments` of `input` for magic numbers using `threadCount` threads.
+ * The segments are split to chunks, taken by the threads one by one.
+ * @returns the candidates found, ordered by offset
+ */
+std::vector<Candidate> searchSegments(const char* input, std::size_t inputSize, const std::vector<Segment>& segments, std::size_t threadCount)
+{
+  constexpr std::size_t chunkSize = std::size_t{64} << 20;
+
+  std::vector<Segment> chunks;
+  for (const Segment& segment : segments)
   {
-    STDERR_ERROR("Failed to open {} for writing", argv[2]);
-    showHelp();
-    return 3;
+    for (std::size_t begin = segment.begin; begin < segment.end; begin += chunkSize)
+    {
+      chunks.push_back(Segment{begin, (std::min)(segment.end, begin + chunkSize)});
+    }
   }
 
-  std::vector<RecoveredBuffer> buffers;
+  threadCount = (std::max)(std::size_t{1}, (std::min)(threadCount, chunks.size()));
+  std::vector<std::vector<Candidate>> results(threadCount);
+  std::atomic<std::size_t> nextChunk{0};
 
-  // do not initialize arrays directly to remain endianness agnostic
-  const std::array<unsigned char, 8> metadataMagic = toArray(0xFE214F726E35BDBC);
-  const std::array<unsigned char, 8> dataMagic = toArray(0xFE213F716D34BCBC);
+  const auto search = [&](std::vector<Candidate>& result)
+  {
+    for (std::size_t i = nextChunk++; i < chunks.size(); i = nextChunk++)
+    {
+      searchRange(input, inputSize, chunks[i].begin, chunks[i].end, result);
+    }
+  };
 
-  // magic numbers start with the same byte, makes searching easier
-  assert(metadataMagic[0] == dataMagic[0]);
-  const unsigned char firstMagicByte = metadataMagic[0];
+  std::vector<std::thread> threads;
+  for (std::size_t t = 1; t < threadCount; ++t)
+  {
+    threads.emplace_back(search, std::ref(results[t]));
+  }
+  search(results[0]);
+  for (std::thread& thread : threads) { thread.join(); }
 
-  STDERR_INFO("Read input from {}", argv[1]);
+  std::vector<Candidate> candidates;
+  for (std::vector<Candidate>& result : results)
+  {
+    std::move(result.begin(), result.end(), std::back_inserter(candidates));
+  }
+
+  std::sort(candidates.begin(), candidates.end(),
+    [](const Candidate& a, const Candidate& b) { return a.offset < b.offset; }
+  );
+
+  return candidates;
+}
 
-  while (input.ignore(std::numeric_limits<std::streamsize>::max(), firstMagicByte).good())
+/** Search the file at `path` for magic numbers, read the metadata and data buffers following them */
+bool recoverBuffers(const std::string& path, std::size_t threadCount, std::vector<RecoveredBuffer>& buffers)
+{
+  std::unique_ptr<binlog::MmapEntryStream> mapping;
+  try
   {
-    std::array<unsigned char, 8> magic{firstMagicByte, 0, 0, 0, 0, 0, 0, 0};
-    input.read(reinterpret_cast<char*>(magic.data()+1), 7);
+    mapping.reset(new binlog::MmapEntryStream(path));
+  }
+  catch (const std::runtime_error& ex)
+  {
+    STDERR_ERROR("Failed to read {}: {}", path, std::string(ex.what()));
+    return false;
+  }
+
+  const char* input = mapping->data();
+  const std::size_t inputSize = mapping->size();
+
+  const std::vector<Segment> segments = searchedSegments(input, inputSize);
+  std::size_t searchedSize = 0;
+  for (const Segment& segment : segments) { searchedSize += segment.end - segment.begin; }
+  STDERR_INFO("Read input from {}, search {} bytes in {} segments, using {} threads",
+    path, searchedSize, segments.size(), threadCount);
 
-    const auto afterMagicPos = std::streamoff{input.tellg()};
+  const std::vector<Candidate> candidates = searchSegments(input, inputSize, segments, threadCount);
+
+  // as a sequential search would do, skip the magic numbers
+  // inside an already recovered structure
+  std::size_t recoveredEnd = 0;
+  for (const Candidate& candidate : candidates)
+  {
+    if (candidate.offset < recoveredEnd) { continue; }
 
-    if (magic == metadataMagic)
+    if (candidate.recovered)
     {
-      STDERR_INFO("Magic number found, read metadata at tellg={}", afterMagicPos);
-      if (! readMetadata(input, buffers))
-      {
-        STDERR_ERROR("  Failed to read metadata, continue searching at tellg={}", afterMagicPos);
-        input.clear();
-        input.seekg(afterMagicPos);
-      }
+      STDERR_INFO("Magic number found at offset={}, {}", candidate.offset, candidate.message);
+      buffers.push_back(candidate.buffer);
+      recoveredEnd = candidate.end;
     }
-    else if (magic == dataMagic)
+    else
     {
-      STDERR_INFO("Magic number found, read data at tellg={}", afterMagicPos);
-      if (! readData(input, buffers))
-      {
-        STDERR_ERROR("  Failed to read data, continue searching at tellg={}", afterMagicPos);
-        input.clear();
-        input.seekg(afterMagicPos);
-      }
+      STDERR_ERROR("Magic number found at offset={}, but failed to read {}: {}",
+        candidate.offset, candidate.buffer.type, candidate.message);
     }
-    else
+  }
+
+  STDERR_INFO("Done reading input");
+  return true;
+}
+
+/**
+ * @returns the paths of the queue and metadata files in `path`,
+ * if it is a directory, see MmapChannelAllocator::Options::directory
+ */
+std::vector<std::string> channelFiles(const std::string& path)
+{
+  std::vector<std::string> result;
+
+  #ifndef _WIN32
+    struct stat st = {};
+    if (stat(path.c_str(), &st) != 0 || ! S_ISDIR(st.st_mode)) { return result; }
+
+    DIR* dir = opendir(path.c_str());
+    if (dir == nullptr) { return result; }
+
+    const auto endsWith = [](const std::string& str, const std::string& suffix)
     {
-      // not a magic number, seek back
-      input.seekg(-7, std::ios_base::cur);
+      return str.size() > suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+    };
+
+    while (const dirent* entry = readdir(dir)) // NOLINT(concurrency-mt-unsafe)
+    {
+      const std::string name = entry->d_name;
+      if (endsWith(name, ".queue") || endsWith(name, ".metadata"))
+      {
+        result.push_back(path + "/" + name);
+      }
     }
+    closedir(dir);
+
+    std::sort(result.begin(), result.end());
+  #else
+    static_cast<void>(path);
+  #endif
+
+  return result;
+}
+
+} // namespace
+
+int main(int argc, const char* argv[])
+{
+  if (argc < 2)
+  {
+    showHelp();
+    return 1;
   }
 
-  if (input.eof())
+  std::vector<std::string> inputPaths = channelFiles(argv[1]);
+  const bool isDirectory = ! inputPaths.empty();
+  if (! isDirectory) { inputPaths.push_back(argv[1]); }
+
+  const std::string outputPath = (argc > 2) ? argv[2] : "-";
+  std::ofstream outputFile;
+  std::ostream& output = openFile(outputPath, outputFile);
+  if (! output)
   {
-    STDERR_INFO("Done reading input");
+    STDERR_ERROR("Failed to open {} for writing", argv[2]);
+    showHelp();
+    return 3;
   }
-  else
+
+  const std::size_t threadCount = (std::max)(1u, std::thread::hardware_concurrency());
+
+  std::vector<RecoveredBuffer> buffers;
+
+  for (const std::string& path : inputPaths)
   {
-    STDERR_ERROR("Failure while reading input, continue anyway");
+    if (! recoverBuffers(path, threadCount, buffers))
+    {
+      if (isDirectory) { continue; } // removed meanwhile
+      showHelp();
+      return 2;
+    }
   }
 
   STDERR_INFO("Write output");
@@ -328,7 +603,7 @@ int main(int argc, const char* argv[])
   {
     return a.session == b.session ? a.type < b.type : a.session < b.session;
   };
-  std::sort(buffers.begin(), buffers.end(), cmp);
+  std::stable_sort(buffers.begin(), buffers.end(), cmp);
 
   std::size_t offset = 0;
   for (const RecoveredBuffer& buffer : buffers)
@@ -0,0 +1,148 @@
+#include "getopt.hpp"
+#include "mapfile.hpp"
+#include "replay.hpp"
+
+#include <binlog/EntryStream.hpp>
+
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+void showHelp()
+{
+  std::cout <<
+    "breplay -- re-emit the events of a binary logfile, to load test consumers and sinks\n"
+    "\n"
+    "Synopsis:\n"
+    "  breplay [-s speed] [-q capacity] [-o outputfile] filename\n"
+    "\n"
+    "Examples:\n"
+    "  breplay -o /dev/null logfile.blog" "\n"
+    "  breplay -s 0 -o replayed.blog logfile.blog" "\n"
+    "  breplay -s 10 logfile.blog | bread" "\n"
+    "\n"
+    "Arguments:\n"
+    "  filename       Path to a logfile. If '-' or unspecified, read from stdin\n"
+    "\n"
+    "Options:\n"
+    "  -s speed       Pace of the replay relative to the original (default: 1).\n"
+    "                 e.g: 2 replays twice as fast, 0 replays as fast as possible\n"
+    "  -q capacity    Queue capacity of the writers in bytes (default: 1048576)\n"
+    "  -o outputfile  Path of the binary logfile to write. If '-' or unspecified, write to stdout\n"
+    "  -h             Show this help\n"
+    "\n"
+    "Notes:\n"
+    "  Each writer of the logfile gets a SessionWriter with the same id and name,\n"
+    "  the events are added with their original event source and serialized arguments,\n"
+    "  timestamped by the time of the replay, and consumed on a background thread.\n"
+    "  Writers block if their queue is full. When done, replay statistics\n"
+    "  (event rate, consumed bytes per second) are printed to stderr.\n"
+    "  Interned strings, compact and compressed logfiles are not supported.\n"
+    "\n"
+    "Report bugs to:\n"
+    "  https://github.com/Morgan-Stanley/binlog/issues\n";
+}
+
+} // namespace
+
+int main(int argc, /*const*/ char* argv[])
+{
+  std::string inputPath = "-";
+  std::string outputPath = "-";
+  double speed = 1;
+  std::size_t queueCapacity = std::size_t(1) << 20;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "s:q:o:h")) != -1) // NOLINT(concurrency-mt-unsafe)
+  {
+    switch (opt)
+    {
+    case 's':
+      speed = std::stod(optarg);
+      break;
+    case 'q':
+      queueCapacity = std::size_t(std::stoul(optarg));
+      if (queueCapacity < 1024)
+      {
+        std::cerr << "[breplay] Queue capacity must be at least 1024 bytes\n";
+        return 1;
+      }
+      break;
+    case 'o':
+      outputPath = optarg;
+      break;
+    case 'h':
+      showHelp();
+      return 0;
+    default:
+      // getopt prints a useful error message by default (opterr is set)
+      showHelp();
+      return 1;
+    }
+  }
+
+  if (optind < argc)
+  {
+    inputPath = argv[optind];
+  }
+
+  std::ifstream inputFile;
+  std::unique_ptr<binlog::MmapEntryStream> mappedInput = mapFile(inputPath);
+  if (! mappedInput && inputPath != "-")
+  {
+    inputFile.open(inputPath, std::ios_base::in | std::ios_base::binary);
+    if (! inputFile)
+    {
+      std::cerr << "[breplay] Failed to open '" << inputPath << "' for reading\n";
+      return 2;
+    }
+  }
+  std::istream& input = (inputFile.is_open()) ? inputFile : std::cin;
+
+  std::ofstream outputFile;
+  if (outputPath != "-")
+  {
+    outputFile.open(outputPath, std::ofstream::out | std::ofstream::binary);
+    if (! outputFile)
+    {
+      std::cerr << "[breplay] Failed to open '" << outputPath << "' for writing\n";
+      return 2;
+    }
+  }
+  std::ostream& output = (outputFile.is_open()) ? outputFile : std::cout;
+
+  try
+  {
+    ReplayStats stats;
+    if (mappedInput)
+    {
+      stats = replay(*mappedInput, output, speed, queueCapacity);
+    }
+    else
+    {
+      binlog::ReadaheadEntryStream entryStream(input);
+      stats = replay(entryStream, output, speed, queueCapacity);
+    }
+
+    output.flush();
+    printReplayStats(stats, std::cerr);
+  }
+  catch (const std::exception& ex)
+  {
+    std::cerr << "[breplay] Exception: " << ex.what() << "\n";
+    return 3;
+  }
+
+  if (! output)
+  {
+    std::cerr << "[breplay] Failed to write output\n";
+    return 4;
+  }
+
+  return 0;
+}
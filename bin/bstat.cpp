@@ -0,0 +1,121 @@
+#include "getopt.hpp"
+#include "mapfile.hpp"
+#include "stats.hpp"
+
+#include <binlog/EntryStream.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+void showHelp()
+{
+  std::cout <<
+    "bstat -- show which event sources and writers produced a binary logfile\n"
+    "\n"
+    "Synopsis:\n"
+    "  bstat [-n count] [-i interval] filename\n"
+    "\n"
+    "Examples:\n"
+    "  bstat logfile.blog" "\n"
+    "  bstat -n 5 -i 60 logfile.blog" "\n"
+    "\n"
+    "Arguments:\n"
+    "  filename       Path to a logfile. If '-' or unspecified, read from stdin\n"
+    "\n"
+    "Options:\n"
+    "  -n count       Show the top `count` sources and writers (default: 20)\n"
+    "  -i interval    Count events per `interval` seconds, fractions allowed (default: 1)\n"
+    "  -h             Show this help\n"
+    "\n"
+    "Notes:\n"
+    "  The arguments of the events are not formatted, bytes are\n"
+    "  the size of the serialized arguments of the events.\n"
+    "  Total bytes is the size of every entry, including metadata.\n"
+    "  The time of the events is shown in UTC.\n"
+    "\n"
+    "Report bugs to:\n"
+    "  https://github.com/Morgan-Stanley/binlog/issues\n";
+}
+
+} // namespace
+
+int main(int argc, /*const*/ char* argv[])
+{
+  std::string inputPath = "-";
+  std::size_t top = 20;
+  std::chrono::nanoseconds interval = std::chrono::seconds{1};
+
+  int opt;
+  while ((opt = getopt(argc, argv, "n:i:h")) != -1) // NOLINT(concurrency-mt-unsafe)
+  {
+    switch (opt)
+    {
+    case 'n':
+      top = std::size_t(std::stoul(optarg));
+      break;
+    case 'i':
+      interval = std::chrono::nanoseconds{static_cast<std::int64_t>(std::stod(optarg) * 1e9)};
+      if (interval.count() <= 0)
+      {
+        std::cerr << "[bstat] Interval must be positive\n";
+        return 1;
+      }
+      break;
+    case 'h':
+      showHelp();
+      return 0;
+    default:
+      // getopt prints a useful error message by default (opterr is set)
+      showHelp();
+      return 1;
+    }
+  }
+
+  if (optind < argc)
+  {
+    inputPath = argv[optind];
+  }
+
+  std::ifstream inputFile;
+  std::unique_ptr<binlog::MmapEntryStream> mappedInput = mapFile(inputPath);
+  if (! mappedInput && inputPath != "-")
+  {
+    inputFile.open(inputPath, std::ios_base::in | std::ios_base::binary);
+    if (! inputFile)
+    {
+      std::cerr << "[bstat] Failed to open '" << inputPath << "' for reading\n";
+      return 2;
+    }
+  }
+  std::istream& input = (inputFile.is_open()) ? inputFile : std::cin;
+
+  try
+  {
+    Statistics stats;
+    if (mappedInput)
+    {
+      stats = collectStatistics(*mappedInput, interval);
+    }
+    else
+    {
+      binlog::ReadaheadEntryStream entryStream(input);
+      stats = collectStatistics(entryStream, interval);
+    }
+
+    printStatistics(stats, std::cout, top, interval);
+  }
+  catch (const std::exception& ex)
+  {
+    std::cerr << "[bstat] Exception: " << ex.what() << "\n";
+    return 3;
+  }
+
+  return 0;
+}
@@ -0,0 +1,182 @@
+#include "getopt.hpp"
+
+#include <binlog/CompressedStream.hpp>
+#include <binlog/EntryStream.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring> // memcpy
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+void showHelp()
+{
+  std::cout <<
+    "btrain -- train a compression dictionary for small compressed frames\n"
+    "\n"
+    "Synopsis:\n"
+    "  btrain [-s size] [-n bytes] [-o dictionary] filename...\n"
+    "\n"
+    "Examples:\n"
+    "  btrain -o app.dict sample1.blog sample2.blog" "\n"
+    "  bread -Z app.dict compressed.blog" "\n"
+    "\n"
+    "Arguments:\n"
+    "  filename       Path to a representative logfile, plain or compressed\n"
+    "\n"
+    "Options:\n"
+    "  -s size        Maximum size of the dictionary, in bytes (default: 32768, the most deflate uses)\n"
+    "  -n bytes       Read at most this many bytes of each logfile (default: 16777216)\n"
+    "  -o dictionary  Path of the dictionary to write. If '-' or unspecified, write to stdout\n"
+    "  -h             Show this help\n"
+    "\n"
+    "Notes:\n"
+    "  Frames written by CompressedOutputStream (or TcpSink, with Options::compress)\n"
+    "  are compressed independently. If they are small (e.g: consume is called frequently),\n"
+    "  the dictionary gives them the context of the typical content of the logfiles:\n"
+    "  writer properties, source ids, clocks and common arguments.\n"
+    "  The id of the dictionary is recorded in each frame compressed with it,\n"
+    "  the frames can be read by giving the same dictionary to bread (-Z).\n"
+    "\n"
+    "Report bugs to:\n"
+    "  https://github.com/Morgan-Stanley/binlog/issues\n";
+}
+
+#ifdef BINLOG_HAS_ZLIB
+
+/** @returns the first entries of `input`, about `maxSize` bytes, as a regular binlog stream */
+std::string readEntries(binlog::EntryStream& input, std::size_t maxSize)
+{
+  std::string result;
+  while (result.size() < maxSize)
+  {
+    binlog::Range payload = input.nextEntryPayload();
+    if (payload.empty()) { break; }
+
+    const std::uint32_t size = std::uint32_t(payload.size());
+    char sizePrefix[sizeof(size)];
+    memcpy(sizePrefix, &size, sizeof(size));
+    result.append(sizePrefix, sizeof(size));
+    result.append(payload.view(payload.size()), size);
+  }
+  return result;
+}
+
+/** @returns the first `maxSize` bytes of the logfile at `path`, decompressed if needed */
+std::string readSample(const std::string& path, std::size_t maxSize)
+{
+  std::ifstream file(path, std::ios_base::in | std::ios_base::binary);
+  if (! file)
+  {
+    throw std::runtime_error("Failed to open '" + path + "' for reading");
+  }
+
+  std::uint32_t magic = 0;
+  file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+  file.clear();
+  file.seekg(0);
+
+  if (magic == binlog::compressedFrameMagic)
+  {
+    binlog::CompressedEntryStream entryStream(file);
+    return readEntries(entryStream, maxSize);
+  }
+
+  std::string result(maxSize, '\0');
+  file.read(&result[0], std::streamsize(maxSize));
+  result.resize(std::size_t(file.gcount()));
+  return result;
+}
+
+#endif // BINLOG_HAS_ZLIB
+
+} // namespace
+
+int main(int argc, /*const*/ char* argv[])
+{
+  std::string outputPath = "-";
+  std::size_t dictionarySize = std::size_t{1} << 15;
+  std::size_t sampleSize = std::size_t{16} << 20;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "s:n:o:h")) != -1) // NOLINT(concurrency-mt-unsafe)
+  {
+    switch (opt)
+    {
+    case 's':
+      dictionarySize = std::size_t(std::stoul(optarg));
+      break;
+    case 'n':
+      sampleSize = std::size_t(std::stoull(optarg));
+      break;
+    case 'o':
+      outputPath = optarg;
+      break;
+    case 'h':
+      showHelp();
+      return 0;
+    default:
+      // getopt prints a useful error message by default (opterr is set)
+      showHelp();
+      return 1;
+    }
+  }
+
+  if (optind == argc)
+  {
+    showHelp();
+    return 1;
+  }
+
+#ifdef BINLOG_HAS_ZLIB
+  try
+  {
+    std::vector<std::string> samples;
+    std::size_t totalSize = 0;
+    for (int i = optind; i < argc; ++i)
+    {
+      samples.push_back(readSample(argv[i], sampleSize));
+      totalSize += samples.back().size();
+    }
+
+    const std::string dictionary = binlog::trainCompressionDictionary(samples, dictionarySize);
+    if (dictionary.empty())
+    {
+      std::cerr << "[btrain] The logfiles have no repeated content to train on\n";
+      return 3;
+    }
+
+    std::ofstream outputFile;
+    if (outputPath != "-")
+    {
+      outputFile.open(outputPath, std::ios_base::out | std::ios_base::binary);
+      if (! outputFile)
+      {
+        std::cerr << "[btrain] Failed to open '" << outputPath << "' for writing\n";
+        return 2;
+      }
+    }
+    std::ostream& output = (outputFile.is_open()) ? outputFile : std::cout;
+    output.write(dictionary.data(), std::streamsize(dictionary.size()));
+    output.flush();
+
+    std::cerr << "[btrain] Trained a dictionary of " << dictionary.size() << " bytes on "
+      << totalSize << " bytes of samples, id: " << binlog::compressionDictionaryId(dictionary) << "\n";
+  }
+  catch (const std::exception& ex)
+  {
+    std::cerr << "[btrain] Exception: " << ex.what() << "\n";
+    return 3;
+  }
+
+  return 0;
+#else
+  std::cerr << "[btrain] Compression is not supported, btrain is built without zlib\n";
+  return 1;
+#endif
+}
@@ -0,0 +1,171 @@
+#include "chunks.hpp"
+
+#include <binlog/Entries.hpp>
+#include <binlog/detail/EagerSourceRegistry.hpp>
+#include <binlog/detail/StableSourceId.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring> // memcpy
+#include <thread>
+
+namespace {
+
+constexpr std::size_t sizePrefixSize = sizeof(std::uint32_t);
+
+/** The entry at `offset`, if it fits the logfile */
+struct EntryHeader
+{
+  std::uint64_t tag = 0;
+  std::size_t end = 0; // offset after the entry
+};
+
+/** @returns true and sets `header` if the entry at `offset` has a tag and fits [0, size) */
+bool readHeader(const char* data, std::size_t size, std::size_t offset, EntryHeader& header)
+{
+  if (size - offset < sizePrefixSize) { return false; }
+  std::uint32_t payloadSize = 0;
+  memcpy(&payloadSize, data + offset, sizeof(payloadSize));
+  if (payloadSize < sizeof(header.tag) || payloadSize > size - offset - sizePrefixSize) { return false; }
+
+  memcpy(&header.tag, data + offset + sizePrefixSize, sizeof(header.tag));
+  header.end = offset + sizePrefixSize + payloadSize;
+  return true;
+}
+
+/** @returns true if `header` looks like an entry written by a Session */
+bool plausible(const EntryHeader& header, std::size_t offset)
+{
+  const std::uint64_t tag = header.tag;
+  if (tag >= std::uint64_t(-16)) { return true; } // special entry
+
+  // event: source id of a range assigned by Session, followed by a clock
+  const std::uint64_t eager = binlog::detail::EagerSourceRegistry::firstId;
+  const bool validId = (tag != 0 && tag < (std::uint64_t(1) << 32))
+    || binlog::detail::isStableSourceId(tag)
+    || (tag >= eager && tag - eager < (std::uint64_t(1) << 32));
+  return validId && header.end - offset - sizePrefixSize >= 2 * sizeof(std::uint64_t);
+}
+
+/** Read the entries of [begin, size) until `until` is reached, or an invalid entry is found */
+EntryChunk readChunk(const char* data, std::size_t size, std::size_t begin, std::size_t until)
+{
+  EntryChunk chunk;
+  chunk.begin = begin;
+
+  std::size_t offset = begin;
+  EntryHeader header;
+  while (offset < until)
+  {
+    if (! readHeader(data, size, offset, header))
+    {
+      chunk.complete = false;
+      break;
+    }
+
+    const bool special = (header.tag & (std::uint64_t(1) << 63)) != 0;
+    if (special && header.tag != binlog::CompactEvents::Tag) { chunk.metadata.push_back(offset); }
+    offset = header.end;
+  }
+
+  chunk.end = offset;
+  return chunk;
+}
+
+/** Call `f(i)` for each i in [0, count), on `threadCount` threads */
+template <typename F>
+void parallelFor(std::size_t count, std::size_t threadCount, F f)
+{
+  std::atomic<std::size_t> next{0};
+  const auto work = [&]()
+  {
+    for (std::size_t i = next++; i < count; i = next++) { f(i); }
+  };
+
+  std::vector<std::thread> threads;
+  for (std::size_t t = 1; t < (std::min)(threadCount, count); ++t)
+  {
+    threads.emplace_back(work);
+  }
+  work();
+  for (std::thread& thread : threads) { thread.join(); }
+}
+
+} // namespace
+
+std::size_t findEntryBoundary(const char* data, std::size_t size, std::size_t from, std::size_t verifyCount)
+{
+  for (std::size_t candidate = from; candidate < size; ++candidate)
+  {
+    std::size_t offset = candidate;
+    std::size_t verified = 0;
+    EntryHeader header;
+    while (verified < verifyCount && offset != size && readHeader(data, size, offset, header) && plausible(header, offset))
+    {
+      offset = header.end;
+      ++verified;
+    }
+
+    if (verified == verifyCount || (verified != 0 && offset == size)) { return candidate; }
+  }
+
+  return size;
+}
+
+std::vector<EntryChunk> splitEntries(const char* data, std::size_t size, std::size_t chunkSize, std::size_t threadCount)
+{
+  const std::size_t chunkCount = (std::max)(std::size_t{1}, (size + chunkSize - 1) / chunkSize);
+
+  // speculative: where the chunks might start, and the entries from there
+  std::vector<std::size_t> starts(chunkCount + 1, size);
+  starts[0] = 0;
+  parallelFor(chunkCount - 1, threadCount, [&](std::size_t i)
+  {
+    starts[i + 1] = findEntryBoundary(data, size, (i + 1) * chunkSize);
+  });
+
+  std::vector<EntryChunk> chunks(chunkCount);
+  parallelFor(chunkCount, threadCount, [&](std::size_t i)
+  {
+    chunks[i] = readChunk(data, size, starts[i], starts[i + 1]);
+  });
+
+  // stitch: keep the chunks that start where the previous one ends
+  std::vector<EntryChunk> result;
+  std::size_t offset = 0;
+  for (std::size_t i = 0; i < chunkCount; ++i)
+  {
+    EntryChunk& chunk = chunks[i];
+    if (chunk.begin != offset)
+    {
+      // misdetected boundary, or the previous chunk ended after it
+      chunk = readChunk(data, size, offset, starts[i + 1]);
+    }
+
+    offset = chunk.end;
+    const bool complete = chunk.complete;
+    if (chunk.end != chunk.begin || ! complete) { result.push_back(std::move(chunk)); }
+    if (! complete) { break; }
+  }
+
+  return result;
+}
+
+bool hasMetadata(const char* data, const std::vector<EntryChunk>& chunks, std::uint64_t tag)
+{
+  for (const EntryChunk& chunk : chunks)
+  {
+    for (const std::size_t offset : chunk.metadata)
+    {
+      if (entryTag(data, offset) == tag) { return true; }
+    }
+  }
+  return false;
+}
+
+std::uint64_t entryTag(const char* data, std::size_t offset)
+{
+  std::uint64_t tag = 0;
+  memcpy(&tag, data + offset + sizePrefixSize, sizeof(tag));
+  return tag;
+}
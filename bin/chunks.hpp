@@ -0,0 +1,56 @@
+#ifndef BINLOG_BIN_CHUNKS_HPP
+#define BINLOG_BIN_CHUNKS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/** A part of a flat (not block framed) logfile: a sequence of complete entries */
+struct EntryChunk
+{
+  std::size_t begin = 0; // NOLINT offset of the first entry
+  std::size_t end = 0;   // NOLINT offset after the last entry
+
+  /** Offsets of the special entries of the chunk (tag with the highest bit set), except CompactEvents */
+  std::vector<std::size_t> metadata; // NOLINT
+
+  /** False if an invalid or incomplete entry follows the chunk (only the last chunk) */
+  bool complete = true; // NOLINT
+};
+
+/**
+ * @returns the offset of the first plausible entry boundary in [from, size)
+ *          of the flat logfile in [data, data+size), or size, if there is none.
+ *
+ * A boundary is plausible if the `verifyCount` entries starting there
+ * (or every entry until the end of the logfile) look valid:
+ * the size prefix fits the logfile, and the tag is a special entry tag,
+ * or the id of an event source of a range assigned by Session, followed by a clock.
+ */
+std::size_t findEntryBoundary(const char* data, std::size_t size, std::size_t from, std::size_t verifyCount = 8);
+
+/**
+ * Split the flat logfile in [data, data+size) to chunks of about `chunkSize` bytes,
+ * on `threadCount` threads, without reading the logfile from the beginning.
+ *
+ * Each chunk is started at a plausible entry boundary (see findEntryBoundary)
+ * near a multiple of `chunkSize`, and read concurrently until the start of the next chunk.
+ * Then the chunks are stitched: a chunk is confirmed if the confirmed chunk
+ * before it ends exactly where it starts, otherwise it is read again from there.
+ * Therefore the chunks are the same as if the entries were read sequentially,
+ * even if a boundary is misdetected (e.g: in the arguments of an event).
+ *
+ * The chunks cover [data, data+end) without gaps, where `end` is the end of the
+ * last valid entry. If it is not `size`, the last chunk is not complete.
+ *
+ * @pre chunkSize > 0, threadCount > 0
+ */
+std::vector<EntryChunk> splitEntries(const char* data, std::size_t size, std::size_t chunkSize, std::size_t threadCount);
+
+/** @returns true if the metadata of `chunks` of the logfile at `data` has an entry of `tag` */
+bool hasMetadata(const char* data, const std::vector<EntryChunk>& chunks, std::uint64_t tag);
+
+/** @returns the tag of the entry at `offset` of the logfile at `data`, @pre it is valid */
+std::uint64_t entryTag(const char* data, std::size_t offset);
+
+#endif // BINLOG_BIN_CHUNKS_HPP
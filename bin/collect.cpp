@@ -0,0 +1,217 @@
+#include "collect.hpp"
+
+#ifndef _WIN32 // assume POSIX
+
+#include <binlog/CompressedStream.hpp>
+#include <binlog/TcpSink.hpp>
+
+#include <cerrno>
+#include <cstring> // memcpy, strerror
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+
+#include <netinet/in.h> // NOLINT sockaddr_in6
+#include <poll.h> // NOLINT poll
+#include <sys/socket.h> // NOLINT socket, bind, listen, accept
+#include <unistd.h> // NOLINT close, read
+
+namespace {
+
+constexpr std::size_t helloSize = 3 * sizeof(std::uint32_t);
+constexpr std::size_t frameHeaderSize = 4 * sizeof(std::uint32_t);
+constexpr std::size_t maxNameSize = 1024;
+
+std::uint32_t readU32(const char* data)
+{
+  std::uint32_t result;
+  memcpy(&result, data, sizeof(result));
+  return result;
+}
+
+[[noreturn]] void throwError(const std::string& what)
+{
+  throw std::runtime_error(what + ": " + std::strerror(errno)); // NOLINT(concurrency-mt-unsafe)
+}
+
+struct Connection
+{
+  int fd;
+  CollectorStream stream;
+  std::ofstream output;
+
+  explicit Connection(int fd_) :fd(fd_) {}
+  ~Connection() { close(fd); }
+
+  Connection(const Connection&) = delete;
+  void operator=(const Connection&) = delete;
+};
+
+/** @returns false if the connection is closed */
+bool receive(Connection& connection, const std::string& directory)
+{
+  char buffer[1 << 16];
+  const ssize_t size = read(connection.fd, buffer, sizeof(buffer));
+  if (size < 0 && errno == EINTR) { return true; }
+  if (size <= 0) { return false; }
+
+  try
+  {
+    connection.stream.receive(buffer, std::size_t(size));
+  }
+  catch (const std::runtime_error&)
+  {
+    return false; // not a TcpSink, drop the connection
+  }
+
+  if (connection.stream.hasName() && ! connection.output.is_open())
+  {
+    const std::string path = directory + "/" + sanitizeName(connection.stream.name()) + ".blog";
+    connection.output.open(path, std::ios_base::out | std::ios_base::binary | std::ios_base::app);
+    if (! connection.output)
+    {
+      throw std::runtime_error("Failed to open '" + path + "' for writing");
+    }
+  }
+
+  if (connection.stream.unitSize() != 0)
+  {
+    connection.output.write(connection.stream.unitData(), std::streamsize(connection.stream.unitSize()));
+    connection.output.flush();
+    connection.stream.takeUnits();
+  }
+
+  return true;
+}
+
+} // namespace
+
+void CollectorStream::receive(const char* data, std::size_t size)
+{
+  _buffer.insert(_buffer.end(), data, data + size);
+
+  if (! _hasName)
+  {
+    if (_buffer.size() < helloSize) { return; }
+    if (readU32(_buffer.data()) != binlog::tcpSinkMagic || readU32(_buffer.data() + 4) != binlog::tcpSinkVersion)
+    {
+      throw std::runtime_error("Connection does not start with a TcpSink hello of a supported version");
+    }
+    const std::size_t nameSize = readU32(_buffer.data() + 8);
+    if (nameSize > maxNameSize) { throw std::runtime_error("Name of the producer is too long"); }
+    if (_buffer.size() < helloSize + nameSize) { return; }
+
+    _name.assign(_buffer.data() + helloSize, nameSize);
+    _hasName = true;
+    _buffer.erase(_buffer.begin(), _buffer.begin() + std::ptrdiff_t(helloSize + nameSize));
+  }
+
+  // find the complete units: entries or compressed frames
+  while (_buffer.size() - _unitSize >= sizeof(std::uint32_t))
+  {
+    const char* unit = _buffer.data() + _unitSize;
+    const std::size_t available = _buffer.size() - _unitSize;
+    std::size_t unitSize = 0;
+    if (readU32(unit) == binlog::compressedFrameMagic)
+    {
+      if (available < frameHeaderSize) { break; }
+      unitSize = frameHeaderSize + readU32(unit + 8);
+    }
+    else
+    {
+      unitSize = sizeof(std::uint32_t) + readU32(unit);
+    }
+
+    if (available < unitSize) { break; }
+    _unitSize += unitSize;
+  }
+}
+
+void CollectorStream::takeUnits()
+{
+  _buffer.erase(_buffer.begin(), _buffer.begin() + std::ptrdiff_t(_unitSize));
+  _unitSize = 0;
+}
+
+std::string sanitizeName(const std::string& name)
+{
+  std::string result = name;
+  for (char& c : result)
+  {
+    const bool valid = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')
+                    || c == '.' || c == '_' || c == '-';
+    if (! valid) { c = '_'; }
+  }
+  if (result.empty() || result[0] == '.') { result.insert(0, 1, '_'); }
+  return result;
+}
+
+int listenTcp(std::uint16_t port)
+{
+  const int fd = socket(AF_INET6, SOCK_STREAM, 0);
+  if (fd < 0) { throwError("Failed to create socket"); }
+
+  const int yes = 1;
+  const int no = 0;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+  setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &no, sizeof(no)); // accept IPv4 as well
+
+  sockaddr_in6 address = {};
+  address.sin6_family = AF_INET6;
+  address.sin6_addr = in6addr_any;
+  address.sin6_port = htons(port);
+  if (bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || listen(fd, 64) != 0)
+  {
+    const int error = errno;
+    close(fd);
+    errno = error;
+    throwError("Failed to listen on port " + std::to_string(port));
+  }
+
+  return fd;
+}
+
+std::uint16_t localPort(int fd)
+{
+  sockaddr_in6 address = {};
+  socklen_t size = sizeof(address);
+  if (getsockname(fd, reinterpret_cast<sockaddr*>(&address), &size) != 0) { throwError("Failed to get socket name"); }
+  return ntohs(address.sin6_port);
+}
+
+void collect(int listenFd, const std::string& directory, const std::atomic<bool>& stop)
+{
+  std::vector<std::unique_ptr<Connection>> connections;
+  std::vector<pollfd> fds;
+
+  while (! stop.load(std::memory_order_relaxed))
+  {
+    fds.clear();
+    fds.push_back(pollfd{listenFd, POLLIN, 0});
+    for (const auto& connection : connections)
+    {
+      fds.push_back(pollfd{connection->fd, POLLIN, 0});
+    }
+
+    // wake up periodically to check stop
+    if (poll(fds.data(), nfds_t(fds.size()), 100) <= 0) { continue; }
+
+    // receive first: fds and connections are parallel, from index 1
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < connections.size(); ++i)
+    {
+      const bool open = (fds[i + 1].revents == 0) || receive(*connections[i], directory);
+      if (open && kept != i) { connections[kept] = std::move(connections[i]); }
+      if (open) { ++kept; }
+    }
+    connections.resize(kept);
+
+    if ((fds[0].revents & POLLIN) != 0)
+    {
+      const int fd = accept(listenFd, nullptr, nullptr);
+      if (fd >= 0) { connections.emplace_back(new Connection(fd)); }
+    }
+  }
+}
+
+#endif // _WIN32
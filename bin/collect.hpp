@@ -0,0 +1,74 @@
+#ifndef BINLOG_BIN_COLLECT_HPP
+#define BINLOG_BIN_COLLECT_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32 // assume POSIX
+
+/**
+ * Parses the bytes received on a TcpSink connection:
+ * the hello (see binlog::tcpSinkMagic), then the stream,
+ * split to complete units: entries, or compressed frames.
+ * Units are written as they are, therefore an output
+ * never ends with a partial unit of a lost connection.
+ */
+class CollectorStream
+{
+public:
+  /**
+   * Append `size` bytes received on the connection.
+   *
+   * @throws std::runtime_error if the connection does not start with a valid hello
+   */
+  void receive(const char* data, std::size_t size);
+
+  /** @returns true if the hello is received */
+  bool hasName() const { return _hasName; }
+
+  /** @returns the name of the producer, sent in the hello */
+  const std::string& name() const { return _name; }
+
+  /** @returns the size of the complete units at the beginning of unitData() */
+  std::size_t unitSize() const { return _unitSize; }
+
+  const char* unitData() const { return _buffer.data(); }
+
+  /** Drop the complete units, after they are written */
+  void takeUnits();
+
+private:
+  std::vector<char> _buffer; // received, not yet taken
+  std::size_t _unitSize = 0; // size of the complete units in _buffer
+  bool _hasName = false;
+  std::string _name;
+};
+
+/** @returns `name` with characters other than [A-Za-z0-9._-] replaced by '_', a leading '.' as well */
+std::string sanitizeName(const std::string& name);
+
+/**
+ * @returns a socket listening on `port` of every interface (0: an unused port)
+ * @throws std::runtime_error on error
+ */
+int listenTcp(std::uint16_t port);
+
+/** @returns the port `fd` is bound to */
+std::uint16_t localPort(int fd);
+
+/**
+ * Accept TcpSink producers connecting to `listenFd`, and append the stream of each
+ * to `directory/name.blog`, where name is the sanitized name of the producer,
+ * until `stop` is set. Reconnecting producers append to the same file,
+ * the stream of each connection starts with the metadata.
+ *
+ * @throws std::runtime_error if an output file can not be opened
+ */
+void collect(int listenFd, const std::string& directory, const std::atomic<bool>& stop);
+
+#endif // _WIN32
+
+#endif // BINLOG_BIN_COLLECT_HPP
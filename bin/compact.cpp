@@ -0,0 +1,89 @@
+#include "compact.hpp"
+#include "merge.hpp"
+
+#include <binlog/CompactOutputStream.hpp>
+#include <binlog/CompressedStream.hpp>
+#include <binlog/EntryStream.hpp>
+#include <binlog/Range.hpp>
+#include <binlog/TimeIndex.hpp>
+
+#include <cstdint>
+#include <cstring> // memcpy
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+void compactEntries(binlog::EntryStream& input, std::ostream& output, std::ostream* index, const CompactOptions& options)
+{
+  if (options.sortByTime)
+  {
+    std::stringstream sorted;
+    mergeEvents({&input}, sorted);
+
+    binlog::IstreamEntryStream sortedInput(sorted);
+    CompactOptions unsorted = options;
+    unsorted.sortByTime = false;
+    compactEntries(sortedInput, output, index, unsorted);
+    return;
+  }
+
+  #ifdef BINLOG_HAS_ZLIB
+    std::unique_ptr<binlog::CompressedOutputStream> compressed;
+    if (options.compressionLevel != 0)
+    {
+      compressed.reset(new binlog::CompressedOutputStream(output, options.compressionLevel));
+    }
+  #else
+    if (options.compressionLevel != 0)
+    {
+      throw std::runtime_error("Compression is not supported, built without zlib");
+    }
+  #endif
+
+  std::unique_ptr<binlog::IndexedOutputStream> indexed;
+  if (index != nullptr && options.compressionLevel == 0)
+  {
+    indexed.reset(new binlog::IndexedOutputStream(output, *index, options.blockSize, options.filterBits));
+  }
+
+  // the input is transcoded in batches of entries of about blockSize bytes,
+  // each batch is written as a compressed frame, if compressed
+  std::ostringstream transcoded;
+  binlog::CompactOutputStream compact(transcoded);
+  compact.setEventSourceTables(options.eventSourceTables);
+
+  std::string batch;
+  const auto writeBatch = [&]()
+  {
+    compact.write(batch.data(), std::streamsize(batch.size()));
+    compact.flush();
+    batch.clear();
+
+    const std::string data = transcoded.str();
+    transcoded.str({});
+
+    #ifdef BINLOG_HAS_ZLIB
+      if (compressed)
+      {
+        compressed->write(data.data(), std::streamsize(data.size()));
+        compressed->flush();
+        return;
+      }
+    #endif
+    if (indexed) { indexed->write(data.data(), std::streamsize(data.size())); }
+    else { output.write(data.data(), std::streamsize(data.size())); }
+  };
+
+  for (binlog::Range payload = input.nextEntryPayload(); ! payload.empty(); payload = input.nextEntryPayload())
+  {
+    const std::uint32_t size = std::uint32_t(payload.size());
+    char sizePrefix[sizeof(size)];
+    memcpy(sizePrefix, &size, sizeof(size));
+    batch.append(sizePrefix, sizeof(size));
+    batch.append(payload.view(payload.size()), size);
+
+    if (batch.size() >= options.blockSize) { writeBatch(); }
+  }
+  writeBatch();
+}
@@ -0,0 +1,53 @@
+#ifndef BINLOG_BIN_COMPACT_HPP
+#define BINLOG_BIN_COMPACT_HPP
+
+#include <cstddef>
+#include <iosfwd>
+
+namespace binlog {
+class EntryStream;
+} // namespace binlog
+
+/** How compactEntries writes the logfile */
+struct CompactOptions
+{
+  /**
+   * Order the events by time first, see mergeEvents. The whole input is buffered.
+   * If the events of writers interleave, the output gets larger, as
+   * a WriterProp entry is written before each change of the writer.
+   */
+  bool sortByTime = false; // NOLINT
+
+  /** Front code the event sources, see CompactOutputStream::setEventSourceTables */
+  bool eventSourceTables = true; // NOLINT
+
+  /** If not zero, compress the output with this zlib level (1-9), see CompressedOutputStream */
+  int compressionLevel = 0; // NOLINT
+
+  /** Size of the blocks of the time index, and of the compressed frames */
+  std::size_t blockSize = std::size_t{1} << 20; // NOLINT
+
+  /** Size of the Bloom filter of each block of the time index, in bits, see IndexedOutputStream */
+  std::size_t filterBits = 0; // NOLINT
+};
+
+/**
+ * Write the entries of `input` to `output`, transcoded to the
+ * compact (binlog format v2) encoding, see CompactOutputStream.
+ *
+ * The events and metadata are kept, only their encoding changes:
+ * printing the output gives the same text as printing `input`
+ * (if `options.sortByTime` is false, in the same order).
+ *
+ * If `index` is not nullptr, and the output is not compressed,
+ * a time index of the output is written to `index`, see IndexedOutputStream.
+ * Compressed frames can not be indexed, as the readers of the index
+ * read the logfile in place.
+ *
+ * @throws std::runtime_error if `input` contains an invalid entry,
+ *         if `options.sortByTime` is set, and an event precedes the first clock sync,
+ *         or if compression is requested but not supported
+ */
+void compactEntries(binlog::EntryStream& input, std::ostream& output, std::ostream* index, const CompactOptions& options);
+
+#endif // BINLOG_BIN_COMPACT_HPP
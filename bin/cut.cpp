@@ -0,0 +1,269 @@
+#include "cut.hpp"
+#include "where.hpp"
+
+#include <binlog/Entries.hpp>
+#include <binlog/EntryStream.hpp>
+#include <binlog/Range.hpp>
+#include <binlog/Time.hpp>
+#include <binlog/detail/CompactEvents.hpp>
+#include <binlog/detail/EventSourceTable.hpp>
+#include <binlog/detail/ForEachEntry.hpp>
+#include <binlog/detail/SegmentedMap.hpp>
+
+#include <mserialize/deserialize.hpp>
+
+#include <cstdint>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+/** A metadata entry, written before the first event that needs it */
+struct PendingEntry
+{
+  std::string payload;        // without the size prefix
+  std::string writtenPayload; // the entry last written, in effect in the output
+  bool written = false;       // payload == writtenPayload
+
+  /** Replace the entry by `newPayload`, @returns true if it is different */
+  bool update(binlog::Range newPayload)
+  {
+    const std::size_t size = newPayload.size();
+    if (payload.size() == size && payload.compare(0, size, newPayload.view(0), size) == 0)
+    {
+      return false; // repeated as is, e.g: a WriterProp before each batch
+    }
+
+    payload.assign(newPayload.view(0), size);
+    written = payload == writtenPayload; // e.g: switching back to a writer
+    return true;
+  }
+};
+
+struct Source
+{
+  PendingEntry entry;
+  WherePredicate::SourcePredicate predicate;
+};
+
+class Cutter
+{
+public:
+  Cutter(std::ostream& output, const CutSelection& selection)
+    :_output(output),
+     _selection(selection),
+     _windowed(selection.window.from != std::chrono::nanoseconds::min()
+            || selection.window.to != std::chrono::nanoseconds::max())
+  {}
+
+  void cut(binlog::EntryStream& input)
+  {
+    while (true)
+    {
+      const binlog::Range payload = input.nextEntryPayload();
+      if (payload.empty()) { break; }
+
+      binlog::Range entry = payload;
+      const std::uint64_t tag = entry.read<std::uint64_t>();
+
+      switch (tag)
+      {
+        case binlog::EventSource::Tag:   readEventSource(payload, entry); break;
+        case binlog::EventSourceTable::Tag: readEventSourceTable(entry); break;
+        case binlog::WriterProp::Tag:    readWriterProp(payload, entry); break;
+        case binlog::ClockSync::Tag:     readClockSync(payload, entry); break;
+        case binlog::CompactEvents::Tag: readCompactEvents(entry); break;
+        case binlog::InternedString::Tag:
+          write(payload);
+          break;
+        case binlog::DroppedEvents::Tag:
+          if (_writerSelected) { writeMetadata(_writerProp); write(payload); }
+          break;
+        case binlog::RepeatedEvents::Tag:
+          if (_lastEventWritten) { write(payload); }
+          break;
+        default:
+          if (! binlog::detail::isSpecialEntryTag(tag))
+          {
+            const std::uint64_t clock = entry.read<std::uint64_t>();
+            if (selected(tag, clock, entry))
+            {
+              writeMetadataOf(tag);
+              write(payload);
+            }
+          }
+          // else: unknown special entry, not written, as it is unknown what it references
+          break;
+      }
+    }
+  }
+
+  std::size_t eventCount() const { return _eventCount; }
+
+private:
+  void readEventSource(const binlog::Range& payload, binlog::Range entry)
+  {
+    binlog::EventSource eventSource;
+    mserialize::deserialize(eventSource, entry);
+    addEventSource(eventSource, payload);
+  }
+
+  /** The sources of the table are written as EventSource entries, only the ones needed */
+  void readEventSourceTable(binlog::Range entry)
+  {
+    binlog::detail::readEventSourceTable(entry, [this](binlog::EventSource&& eventSource)
+    {
+      std::ostringstream stream;
+      binlog::serializeSizePrefixedTagged(eventSource, stream);
+      const std::string sizePrefixed = stream.str();
+      const std::size_t prefixSize = sizeof(std::uint32_t);
+      addEventSource(eventSource, binlog::Range(sizePrefixed.data() + prefixSize, sizePrefixed.size() - prefixSize));
+    });
+  }
+
+  /** `payload` is the EventSource entry of `eventSource`, without the size prefix */
+  void addEventSource(const binlog::EventSource& eventSource, const binlog::Range& payload)
+  {
+    const std::size_t* index = _sourceIndices.find(eventSource.id);
+    if (index == _sourceIndices.end())
+    {
+      _sources.emplace_back();
+      _sourceIndices.emplace(eventSource.id, _sources.size() - 1);
+      index = _sourceIndices.find(eventSource.id);
+    }
+
+    Source* source = &_sources[*index];
+    if (source->entry.update(payload) && _selection.where != nullptr)
+    {
+      source->predicate = _selection.where->bind(eventSource);
+    }
+  }
+
+  void readWriterProp(const binlog::Range& payload, binlog::Range entry)
+  {
+    binlog::WriterProp writerProp;
+    mserialize::deserialize(writerProp, entry);
+
+    if (_writerProp.update(payload))
+    {
+      _writerSelected = writerProp.name.find(_selection.writerName) != std::string::npos;
+    }
+    _lastEventWritten = false;
+  }
+
+  void readClockSync(const binlog::Range& payload, binlog::Range entry)
+  {
+    binlog::ClockSync clockSync;
+    mserialize::deserialize(clockSync, entry);
+
+    _clockSync.update(payload);
+    _clockSyncValue = clockSync;
+  }
+
+  void readCompactEvents(binlog::Range entry)
+  {
+    const std::uint8_t version = entry.read<std::uint8_t>();
+    if (! binlog::detail::isSupportedCompactVersion(version))
+    {
+      throw std::runtime_error("Unsupported CompactEvents version: " + std::to_string(version));
+    }
+
+    binlog::detail::CompactDecoder decoder(version);
+    while (! entry.empty())
+    {
+      const binlog::detail::CompactEvent event = binlog::detail::nextCompactEvent(entry, decoder);
+      if (! selected(event.sourceId, event.clockValue, event.arguments)) { continue; }
+
+      writeMetadataOf(event.sourceId);
+
+      // as a regular event entry
+      const std::size_t argumentsSize = event.arguments.size();
+      const std::uint32_t size = std::uint32_t(2 * sizeof(std::uint64_t) + argumentsSize);
+      _output.write(reinterpret_cast<const char*>(&size), sizeof(size));
+      _output.write(reinterpret_cast<const char*>(&event.sourceId), sizeof(event.sourceId));
+      _output.write(reinterpret_cast<const char*>(&event.clockValue), sizeof(event.clockValue));
+      binlog::Range arguments = event.arguments;
+      _output.write(arguments.view(argumentsSize), std::streamsize(argumentsSize));
+    }
+  }
+
+  /** @returns true if the event is selected, sets _lastEventWritten accordingly */
+  bool selected(std::uint64_t sourceId, std::uint64_t clock, const binlog::Range& arguments)
+  {
+    const std::size_t* index = _sourceIndices.find(sourceId);
+    if (index == _sourceIndices.end())
+    {
+      throw std::runtime_error("Event has invalid source id: " + std::to_string(sourceId));
+    }
+    const Source* source = &_sources[*index];
+
+    _lastEventWritten = _writerSelected && inWindow(clock)
+      && (_selection.where == nullptr || accepts(source->predicate, arguments));
+    if (_lastEventWritten) { ++_eventCount; }
+    return _lastEventWritten;
+  }
+
+  static bool accepts(const WherePredicate::SourcePredicate& predicate, const binlog::Range& arguments)
+  {
+    if (predicate.alwaysTrue()) { return true; }
+    if (predicate.alwaysFalse()) { return false; }
+    return predicate.matches(arguments);
+  }
+
+  bool inWindow(std::uint64_t clock) const
+  {
+    if (! _windowed) { return true; }
+    if (_clockSyncValue.clockFrequency == 0) { return false; }
+
+    const std::chrono::nanoseconds time = binlog::clockToNsSinceEpoch(_clockSyncValue, clock);
+    return _selection.window.from <= time && time <= _selection.window.to;
+  }
+
+  void writeMetadataOf(std::uint64_t sourceId)
+  {
+    writeMetadata(_clockSync);
+    writeMetadata(_writerProp);
+    writeMetadata(_sources[*_sourceIndices.find(sourceId)].entry);
+  }
+
+  void writeMetadata(PendingEntry& entry)
+  {
+    if (entry.written || entry.payload.empty()) { return; }
+    write(binlog::Range(entry.payload.data(), entry.payload.size()));
+    entry.writtenPayload = entry.payload;
+    entry.written = true;
+  }
+
+  void write(binlog::Range payload)
+  {
+    const std::uint32_t size = std::uint32_t(payload.size());
+    _output.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    _output.write(payload.view(size), std::streamsize(size));
+  }
+
+  std::ostream& _output;
+  const CutSelection& _selection;
+  const bool _windowed;
+
+  std::vector<Source> _sources;
+  binlog::detail::SegmentedMap<std::size_t> _sourceIndices; // of _sources, by id
+  PendingEntry _writerProp;
+  bool _writerSelected = true; // events before the first WriterProp are selected
+  PendingEntry _clockSync;
+  binlog::ClockSync _clockSyncValue;
+  bool _lastEventWritten = false;
+  std::size_t _eventCount = 0;
+};
+
+} // namespace
+
+std::size_t cutEvents(binlog::EntryStream& input, std::ostream& output, const CutSelection& selection)
+{
+  Cutter cutter(output, selection);
+  cutter.cut(input);
+  return cutter.eventCount();
+}
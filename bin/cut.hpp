@@ -0,0 +1,48 @@
+#ifndef BINLOG_BIN_CUT_HPP
+#define BINLOG_BIN_CUT_HPP
+
+#include "printers.hpp" // TimeWindow
+
+#include <chrono>
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+
+namespace binlog {
+class EntryStream;
+} // namespace binlog
+
+class WherePredicate;
+
+/** Selects the events written by cutEvents */
+struct CutSelection
+{
+  /** Events at or after `from` and at or before `to`. Events without a clock sync are not in a restricted window. */
+  TimeWindow window{std::chrono::nanoseconds::min(), std::chrono::nanoseconds::max()}; // NOLINT
+
+  /** Events accepted by the predicate, or every event, if nullptr */
+  const WherePredicate* where = nullptr; // NOLINT
+
+  /** Events of writers whose name contains this string */
+  std::string writerName; // NOLINT
+};
+
+/**
+ * Write the events in `input` selected by `selection` to `output`,
+ * as a valid binlog stream.
+ *
+ * Only the metadata referenced by the written events is written:
+ * the EventSource of each written event, the WriterProp and the ClockSync
+ * in effect at the event, each once, before the first event that needs it.
+ * InternedString entries are always written, as the arguments are not decoded.
+ * DroppedEvents entries are written if their writer is selected,
+ * RepeatedEvents entries if the event they repeat is written.
+ *
+ * Events of CompactEvents entries are written as regular event entries.
+ *
+ * @returns the number of events written
+ * @throws std::runtime_error if `input` contains an invalid entry
+ */
+std::size_t cutEvents(binlog::EntryStream& input, std::ostream& output, const CutSelection& selection);
+
+#endif // BINLOG_BIN_CUT_HPP
@@ -0,0 +1,332 @@
+#include "extract.hpp"
+
+#include <binlog/Entries.hpp>
+#include <binlog/EntryStream.hpp>
+#include <binlog/EventStream.hpp>
+#include <binlog/Range.hpp>
+#include <binlog/Time.hpp>
+#include <binlog/ToStringVisitor.hpp>
+#include <binlog/detail/FormatSpec.hpp>
+#include <binlog/detail/OstreamBuffer.hpp>
+#include <binlog/detail/SegmentedMap.hpp>
+
+#include <mserialize/detail/packed_integer.hpp>
+#include <mserialize/detail/tag_util.hpp>
+#include <mserialize/string_view.hpp>
+#include <mserialize/visit.hpp>
+
+#include <cstring> // memcpy
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+bool SourceSelector::matches(const binlog::EventSource& source) const
+{
+  return source.category.find(category) != std::string::npos
+      && source.function.find(function) != std::string::npos
+      && source.formatString.find(formatString) != std::string::npos;
+}
+
+namespace {
+
+/** How an argument is converted to a column value */
+enum class ArgumentKind { fixed, string, packed, interned, text };
+
+/** A column of the row group being built */
+struct Column
+{
+  std::string name;
+  std::string tag;                  // of the values
+  std::size_t width = 0;            // of the fixed size values, 0 for strings
+  std::vector<char> data;           // fixed size values, or concatenated strings
+  std::vector<std::uint64_t> ends;  // end offsets of the strings in `data`
+
+  Column(std::string name_, std::string tag_, std::size_t width_)
+    :name(std::move(name_)),
+     tag(std::move(tag_)),
+     width(width_)
+  {}
+
+  void addFixed(const void* value)
+  {
+    const char* p = static_cast<const char*>(value);
+    data.insert(data.end(), p, p + width);
+  }
+
+  void addString(const char* str, std::size_t size)
+  {
+    data.insert(data.end(), str, str + size);
+    ends.push_back(data.size());
+  }
+};
+
+/** An argument position of the selected events */
+struct Argument
+{
+  ArgumentKind kind;
+  std::string tag; // mserialize tag of the argument
+};
+
+/** The properties of a source the cached selection depends on */
+struct SourceCache
+{
+  std::string category;
+  std::string function;
+  std::string formatString;
+  std::string argumentTags;
+  bool selected = false;
+
+  bool matches(const binlog::EventSource& source) const
+  {
+    return category == source.category && function == source.function
+        && formatString == source.formatString && argumentTags == source.argumentTags;
+  }
+};
+
+/** @returns the size of the arithmetic type of `tag`, or 0, if it is not one of the stored types */
+std::size_t fixedWidth(const std::string& tag)
+{
+  if (tag.size() != 1) { return 0; }
+  switch (tag[0])
+  {
+    case 'b': case 'c': case 'y': case 'B': return 1;
+    case 's': case 'S': return 2;
+    case 'i': case 'I': case 'f': return 4;
+    case 'l': case 'L': case 'd': return 8;
+    default: return 0;
+  }
+}
+
+Argument makeArgument(const std::string& tag)
+{
+  if (fixedWidth(tag) != 0) { return Argument{ArgumentKind::fixed, tag}; }
+  if (tag == "[c") { return Argument{ArgumentKind::string, tag}; }
+  if (tag == "q" || tag == "Q") { return Argument{ArgumentKind::packed, tag}; }
+  if (tag == "{binlog::InternedStringId`id'L}") { return Argument{ArgumentKind::interned, tag}; }
+  return Argument{ArgumentKind::text, tag};
+}
+
+template <typename T>
+void writeValue(std::ostream& out, T value)
+{
+  out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void writeString(std::ostream& out, const std::string& str)
+{
+  writeValue(out, std::uint32_t(str.size()));
+  out.write(str.data(), std::streamsize(str.size()));
+}
+
+class ColumnWriter
+{
+public:
+  ColumnWriter(std::ostream& out, std::size_t rowGroupSize)
+    :_out(out),
+     _rowGroupSize(rowGroupSize)
+  {
+    _columns.emplace_back("clock", "L", 8);
+    _columns.emplace_back("time", "l", 8);
+    _columns.emplace_back("writer_id", "L", 8);
+    _columns.emplace_back("writer_name", "[c", 0);
+    _columns.emplace_back("source_id", "L", 8);
+  }
+
+  /**
+   * Set the argument columns, according to `argumentTags`,
+   * named by `argumentNames` (see placeholder_names), write the header
+   */
+  void begin(const std::string& argumentTags, const std::vector<std::string>& argumentNames)
+  {
+    mserialize::string_view tags(argumentTags.data(), argumentTags.size());
+    while (! tags.empty())
+    {
+      const mserialize::string_view tag = mserialize::detail::tag_pop(tags);
+      _arguments.push_back(makeArgument(std::string(tag.data(), tag.size())));
+
+      const Argument& arg = _arguments.back();
+      const std::size_t index = _arguments.size() - 1;
+      const std::string name = (index < argumentNames.size() && ! argumentNames[index].empty())
+        ? argumentNames[index] : "arg" + std::to_string(index);
+      switch (arg.kind)
+      {
+        case ArgumentKind::fixed:  _columns.emplace_back(name, arg.tag, fixedWidth(arg.tag)); break;
+        case ArgumentKind::packed: _columns.emplace_back(name, arg.tag == "q" ? "l" : "L", 8); break;
+        default:                   _columns.emplace_back(name, "[c", 0); break;
+      }
+    }
+
+    _argumentTags = argumentTags;
+    writeHeader();
+  }
+
+  bool hasBegun() const { return _hasBegun; }
+
+  const std::string& argumentTags() const { return _argumentTags; }
+
+  void addRow(const binlog::Event& event, const binlog::WriterProp& writerProp, const binlog::ClockSync& clockSync)
+  {
+    const std::int64_t time = (clockSync.clockFrequency != 0)
+      ? binlog::clockToNsSinceEpoch(clockSync, event.clockValue).count()
+      : 0;
+
+    _columns[0].addFixed(&event.clockValue);
+    _columns[1].addFixed(&time);
+    _columns[2].addFixed(&writerProp.id);
+    _columns[3].addString(writerProp.name.data(), writerProp.name.size());
+    _columns[4].addFixed(&event.source->id);
+
+    binlog::Range arguments = event.arguments;
+    for (std::size_t i = 0; i < _arguments.size(); ++i)
+    {
+      addArgument(_arguments[i], event, arguments, _columns[firstArgumentColumn + i]);
+    }
+
+    if (++_rowCount == _rowGroupSize) { writeRowGroup(); }
+  }
+
+  /** Write the pending rows, and the header, if not yet written */
+  void end()
+  {
+    if (! _hasBegun) { writeHeader(); }
+    writeRowGroup();
+  }
+
+private:
+  static constexpr std::size_t firstArgumentColumn = 5;
+
+  void addArgument(const Argument& arg, const binlog::Event& event, binlog::Range& input, Column& column)
+  {
+    switch (arg.kind)
+    {
+      case ArgumentKind::fixed:
+        column.addFixed(input.view(column.width));
+        break;
+      case ArgumentKind::string:
+      {
+        const std::uint32_t size = input.read<std::uint32_t>();
+        column.addString(input.view(size), size);
+        break;
+      }
+      case ArgumentKind::packed:
+      {
+        const std::uint64_t value = mserialize::detail::deserialize_packed(input);
+        column.addFixed(&value);
+        break;
+      }
+      case ArgumentKind::interned:
+      {
+        const std::uint64_t id = input.read<std::uint64_t>();
+        const std::string* value = (event.internedStrings != nullptr) ? event.internedStrings->find(id) : nullptr;
+        const std::string text = (value != nullptr) ? *value : "unknown interned string " + std::to_string(id);
+        column.addString(text.data(), text.size());
+        break;
+      }
+      case ArgumentKind::text:
+      {
+        _text.str(std::string());
+        {
+          binlog::detail::OstreamBuffer buffer(_text);
+          binlog::ToStringVisitor visitor(buffer);
+          mserialize::visit(arg.tag, visitor, input);
+        }
+        const std::string text = _text.str();
+        column.addString(text.data(), text.size());
+        break;
+      }
+    }
+  }
+
+  void writeHeader()
+  {
+    writeValue(_out, columnFileMagic);
+    writeValue(_out, std::uint64_t{1});
+    writeValue(_out, std::uint64_t(_columns.size()));
+    for (const Column& column : _columns)
+    {
+      writeString(_out, column.name);
+      writeString(_out, column.tag);
+    }
+    _hasBegun = true;
+  }
+
+  void writeRowGroup()
+  {
+    if (_rowCount == 0) { return; }
+
+    writeValue(_out, std::uint64_t(_rowCount));
+    for (Column& column : _columns)
+    {
+      const std::size_t endsSize = column.ends.size() * sizeof(std::uint64_t);
+      writeValue(_out, std::uint64_t(endsSize + column.data.size()));
+      _out.write(reinterpret_cast<const char*>(column.ends.data()), std::streamsize(endsSize));
+      _out.write(column.data.data(), std::streamsize(column.data.size()));
+
+      column.data.clear();
+      column.ends.clear();
+    }
+    _rowCount = 0;
+  }
+
+  std::ostream& _out;
+  std::size_t _rowGroupSize;
+  std::vector<Column> _columns;
+  std::vector<Argument> _arguments;
+  std::string _argumentTags;
+  bool _hasBegun = false;
+  std::size_t _rowCount = 0; // rows of the current row group
+  std::ostringstream _text;  // reused to convert text arguments
+};
+
+constexpr std::size_t ColumnWriter::firstArgumentColumn;
+
+} // namespace
+
+std::size_t extractColumns(
+  binlog::EntryStream& input, std::ostream& output,
+  const SourceSelector& selector, std::size_t rowGroupSize
+)
+{
+  binlog::EventStream eventStream;
+  ColumnWriter writer(output, rowGroupSize);
+  binlog::detail::SegmentedMap<SourceCache> sources; // by source id
+  std::size_t rowCount = 0;
+
+  while (const binlog::Event* event = eventStream.nextEvent(input))
+  {
+    // ids can be reused by different sources (e.g: concatenated logfiles),
+    // the cached properties are compared to the source of each event
+    const binlog::EventSource& source = *event->source;
+    const SourceCache* cache = sources.find(source.id);
+    if (cache == sources.end() || ! cache->matches(source))
+    {
+      sources.emplace(source.id, SourceCache{
+        source.category, source.function, source.formatString, source.argumentTags, selector.matches(source)
+      });
+      cache = sources.find(source.id);
+    }
+
+    if (! cache->selected) { continue; }
+
+    if (! writer.hasBegun())
+    {
+      const bool names = binlog::detail::names_are_placeholders(source.formatString, source.argumentTags);
+      writer.begin(source.argumentTags, names ? binlog::detail::placeholder_names(source.formatString) : std::vector<std::string>{});
+    }
+    else if (source.argumentTags != writer.argumentTags())
+    {
+      throw std::runtime_error(
+        "Selected event source " + std::to_string(source.id) + " has argument tags '" + source.argumentTags
+        + "', different from the tags of the first selected event: '" + writer.argumentTags() + "'"
+      );
+    }
+
+    writer.addRow(*event, eventStream.writerProp(), eventStream.clockSync());
+    ++rowCount;
+  }
+
+  writer.end();
+  return rowCount;
+}
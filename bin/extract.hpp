@@ -0,0 +1,78 @@
+#ifndef BINLOG_BIN_EXTRACT_HPP
+#define BINLOG_BIN_EXTRACT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+namespace binlog {
+class EntryStream;
+struct EventSource;
+} // namespace binlog
+
+/**
+ * Selects event sources by their properties.
+ * A source is selected if each non-empty member of the selector
+ * is a substring of the corresponding property of the source.
+ */
+struct SourceSelector
+{
+  std::string category;     // NOLINT
+  std::string function;     // NOLINT
+  std::string formatString; // NOLINT
+
+  bool matches(const binlog::EventSource& source) const;
+};
+
+/** The first 8 bytes of a column file, "BLColumn" */
+constexpr std::uint64_t columnFileMagic = 0x6e6d756c6f434c42;
+
+/**
+ * Write the events in `input` produced by the sources selected by `selector`
+ * to `output`, in a columnar format: each event is a row, and every
+ * argument position is a typed column, preceded by the columns:
+ *
+ *    clock        L    raw clock value
+ *    time         l    nanoseconds since the UNIX epoch in UTC, 0 if there's no clock sync
+ *    writer_id    L
+ *    writer_name  [c
+ *    source_id    L
+ *    argN         the type of the N'th argument (N = 0, 1, ...),
+ *                 named after its {name} placeholder in the first selected source, if it has one
+ *
+ * Arithmetic arguments (mserialize tags y, c, b, B, s, S, i, I, l, L, f, d)
+ * are stored as is, packed integers (q, Q) as l and L, strings and interned strings as [c.
+ * Arguments of other types are converted to text, as bread shows them, and stored as [c.
+ *
+ * The output is little endian, and consists of a header and row groups:
+ *
+ *    u64 magic              // columnFileMagic
+ *    u64 version            // 1
+ *    u64 columnCount
+ *    {
+ *      u32 nameSize, name
+ *      u32 tagSize, tag     // mserialize tag of a column value
+ *    }[columnCount]
+ *    {
+ *      u64 rowCount         // of the row group, at most `rowGroupSize`
+ *      {
+ *        u64 dataSize
+ *        data               // fixed size values: rowCount values, back to back
+ *                           // [c: rowCount u64 end offsets, followed by the concatenated strings
+ *      }[columnCount]
+ *    }...
+ *
+ * The columns are given by the first selected event.
+ *
+ * @pre rowGroupSize > 0
+ * @returns the number of rows written
+ * @throws std::runtime_error if `input` contains an invalid entry,
+ *         or the arguments of the selected sources have different tags.
+ */
+std::size_t extractColumns(
+  binlog::EntryStream& input, std::ostream& output,
+  const SourceSelector& selector, std::size_t rowGroupSize = 65536
+);
+
+#endif // BINLOG_BIN_EXTRACT_HPP
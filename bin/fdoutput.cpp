@@ -0,0 +1,90 @@
+#include "fdoutput.hpp"
+
+#include <cerrno>
+#include <cstring> // memcpy
+
+#include <unistd.h> // write
+
+FdStreambuf::FdStreambuf(int fd, std::size_t bufferSize)
+  :_fd(fd),
+   _buffer(bufferSize)
+{
+  setp(_buffer.data(), _buffer.data() + _buffer.size());
+}
+
+FdStreambuf::~FdStreambuf()
+{
+  writeBuffer();
+}
+
+FdStreambuf::int_type FdStreambuf::overflow(int_type c)
+{
+  if (! writeBuffer()) { return traits_type::eof(); }
+  if (! traits_type::eq_int_type(c, traits_type::eof()))
+  {
+    *pptr() = traits_type::to_char_type(c);
+    pbump(1);
+  }
+  return traits_type::not_eof(c);
+}
+
+std::streamsize FdStreambuf::xsputn(const char* data, std::streamsize size)
+{
+  const std::size_t n = std::size_t(size);
+  const std::size_t available = std::size_t(epptr() - pptr());
+  if (n <= available)
+  {
+    memcpy(pptr(), data, n);
+    pbump(int(size));
+    return size;
+  }
+
+  // larger than the free space: write what is buffered, then buffer or write `data`
+  if (! writeBuffer()) { return 0; }
+  if (n < _buffer.size())
+  {
+    memcpy(pptr(), data, n);
+    pbump(int(size));
+    return size;
+  }
+  return writeAll(data, n) ? size : 0;
+}
+
+int FdStreambuf::sync()
+{
+  return writeBuffer() ? 0 : -1;
+}
+
+bool FdStreambuf::writeBuffer()
+{
+  const bool result = writeAll(pbase(), std::size_t(pptr() - pbase()));
+  setp(_buffer.data(), _buffer.data() + _buffer.size());
+  return result;
+}
+
+bool FdStreambuf::writeAll(const char* data, std::size_t size)
+{
+  while (size != 0)
+  {
+    const ssize_t written = ::write(_fd, data, size);
+    if (written < 0)
+    {
+      if (errno == EINTR) { continue; }
+      return false;
+    }
+    data += written;
+    size -= std::size_t(written);
+  }
+  return true;
+}
+
+StreambufReplacement::StreambufReplacement(std::ostream& stream, std::streambuf& buf)
+  :_stream(stream),
+   _original(stream.rdbuf(&buf))
+{}
+
+StreambufReplacement::~StreambufReplacement()
+{
+  _stream.flush();
+  _stream.rdbuf(_original);
+}
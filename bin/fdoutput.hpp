@@ -0,0 +1,68 @@
+#ifndef BINLOG_BIN_FDOUTPUT_HPP
+#define BINLOG_BIN_FDOUTPUT_HPP
+
+#include <cstddef>
+#include <ostream>
+#include <streambuf>
+#include <vector>
+
+/**
+ * Stream buffer writing a file descriptor directly, using write(2).
+ *
+ * Collects the output in a large buffer, and writes it
+ * when the buffer is full, or flushed (pubsync, std::flush).
+ * Compared to the stdio backed buffer of std::cout, there is
+ * no locale conversion, and fewer, larger writes.
+ *
+ * Does not close the file descriptor.
+ * Partial and interrupted writes are retried.
+ * If write fails, the buffer signals an error to the stream (badbit is set).
+ *
+ * POSIX only.
+ */
+class FdStreambuf : public std::streambuf
+{
+public:
+  explicit FdStreambuf(int fd, std::size_t bufferSize = std::size_t{1} << 20);
+
+  /** Writes the buffered output */
+  ~FdStreambuf() override;
+
+  FdStreambuf(const FdStreambuf&) = delete;
+  void operator=(const FdStreambuf&) = delete;
+
+protected:
+  int_type overflow(int_type c) override;
+  std::streamsize xsputn(const char* data, std::streamsize size) override;
+  int sync() override;
+
+private:
+  /** @returns false if writing the buffered output failed */
+  bool writeBuffer();
+
+  /** @returns false if writing [data, data+size) failed */
+  bool writeAll(const char* data, std::size_t size);
+
+  int _fd;
+  std::vector<char> _buffer;
+};
+
+/**
+ * Replaces the stream buffer of `stream` with `buf`,
+ * until destructed, then flushes `stream` and restores the original buffer.
+ */
+class StreambufReplacement
+{
+public:
+  StreambufReplacement(std::ostream& stream, std::streambuf& buf);
+  ~StreambufReplacement();
+
+  StreambufReplacement(const StreambufReplacement&) = delete;
+  void operator=(const StreambufReplacement&) = delete;
+
+private:
+  std::ostream& _stream;
+  std::streambuf* _original;
+};
+
+#endif // BINLOG_BIN_FDOUTPUT_HPP
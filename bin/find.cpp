@@ -0,0 +1,98 @@
+#include "find.hpp"
+
+#include <binlog/TimeIndex.hpp>
+
+#include <cstdint>
+#include <stdexcept>
+
+FindEntryStream::FindEntryStream(const char* data, std::size_t size, const binlog::TimeIndex& index, const std::string& value)
+  :FindEntryStream(data, size, index, filterBlocks(index, value))
+{}
+
+FindEntryStream::FindEntryStream(const char* data, std::size_t size, const binlog::TimeIndex& index, const std::vector<bool>& candidateBlocks)
+  :_current(binlog::Range{})
+{
+  const auto checkBounds = [size](std::uint64_t offset, std::uint64_t entrySize)
+  {
+    if (offset > size || entrySize > size - offset)
+    {
+      throw std::runtime_error("Time index does not match the logfile");
+    }
+  };
+
+  std::uint64_t segmentBegin = 0; // of the segment being extended
+  std::uint64_t segmentEnd = 0;
+  const auto addSegment = [&](std::uint64_t offset, std::uint64_t segmentSize)
+  {
+    if (offset != segmentEnd)
+    {
+      if (segmentEnd != segmentBegin)
+      {
+        _segments.emplace_back(data + segmentBegin, std::size_t(segmentEnd - segmentBegin));
+      }
+      segmentBegin = offset;
+    }
+    segmentEnd = offset + segmentSize;
+  };
+
+  std::uint64_t indexedEnd = 0;
+  auto metadata = index.metadata.begin();
+  for (std::size_t i = 0; i < index.blocks.size(); ++i)
+  {
+    const binlog::TimeIndex::Block& block = index.blocks[i];
+    checkBounds(block.offset, block.size);
+    if (block.offset != indexedEnd)
+    {
+      throw std::runtime_error("Time index does not match the logfile");
+    }
+    indexedEnd = block.offset + block.size;
+
+    // blocks without events are read, to keep the non-metadata entries (e.g: DroppedEvents)
+    const bool candidate = block.minClock > block.maxClock || i >= candidateBlocks.size() || candidateBlocks[i];
+    if (candidate)
+    {
+      addSegment(block.offset, block.size);
+    }
+    else
+    {
+      ++_skippedBlockCount;
+    }
+
+    for (; metadata != index.metadata.end() && metadata->offset < indexedEnd; ++metadata)
+    {
+      if (! candidate)
+      {
+        checkBounds(metadata->offset, metadata->size);
+        addSegment(metadata->offset, metadata->size);
+      }
+    }
+  }
+
+  // entries after the indexed blocks are always read
+  if (indexedEnd < size) { addSegment(indexedEnd, size - indexedEnd); }
+
+  if (segmentEnd != segmentBegin)
+  {
+    _segments.emplace_back(data + segmentBegin, std::size_t(segmentEnd - segmentBegin));
+  }
+}
+
+std::vector<bool> FindEntryStream::filterBlocks(const binlog::TimeIndex& index, const std::string& value)
+{
+  std::vector<bool> result(index.blocks.size());
+  for (std::size_t i = 0; i < result.size(); ++i)
+  {
+    result[i] = index.blockMayContain(i, value);
+  }
+  return result;
+}
+
+binlog::Range FindEntryStream::nextEntryPayload()
+{
+  while (true)
+  {
+    binlog::Range payload = _current.nextEntryPayload();
+    if (! payload.empty() || _nextSegment == _segments.size()) { return payload; }
+    _current = binlog::RangeEntryStream(_segments[_nextSegment++]);
+  }
+}
@@ -0,0 +1,59 @@
+#ifndef BINLOG_BIN_FIND_HPP
+#define BINLOG_BIN_FIND_HPP
+
+#include <binlog/EntryStream.hpp>
+#include <binlog/Range.hpp>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace binlog {
+class TimeIndex;
+} // namespace binlog
+
+/**
+ * Reads the entries of the logfile in [data, data+size),
+ * that might contain events with an argument equal to a given value,
+ * using the filters of a TimeIndex of the logfile.
+ *
+ * Blocks whose filter rules out the value are skipped,
+ * except their metadata entries, using the index.
+ * Other blocks, and the entries after the last indexed block are read as they are.
+ * The returned events are candidates only: use a `value==` WherePredicate
+ * to select the events actually having the value.
+ */
+class FindEntryStream : public binlog::EntryStream
+{
+public:
+  /**
+   * The logfile and `index` must remain valid as long as *this is valid.
+   *
+   * @throws std::runtime_error if `index` does not match the logfile
+   */
+  FindEntryStream(const char* data, std::size_t size, const binlog::TimeIndex& index, const std::string& value);
+
+  /**
+   * Same as above, but read the blocks of the index with `candidateBlocks[i]` set,
+   * instead of the ones whose filter allows a value.
+   * Blocks without events, and blocks after the end of `candidateBlocks` are always read.
+   */
+  FindEntryStream(const char* data, std::size_t size, const binlog::TimeIndex& index, const std::vector<bool>& candidateBlocks);
+
+  /** @see EntryStream::nextEntryPayload */
+  binlog::Range nextEntryPayload() override;
+
+  /** @returns the number of blocks ruled out by their filter */
+  std::size_t skippedBlockCount() const { return _skippedBlockCount; }
+
+private:
+  /** @returns the filter of each block of `index`: may it contain `value` */
+  static std::vector<bool> filterBlocks(const binlog::TimeIndex& index, const std::string& value);
+
+  std::vector<binlog::Range> _segments; // parts of the logfile to read, in order
+  std::size_t _nextSegment = 0;
+  binlog::RangeEntryStream _current;
+  std::size_t _skippedBlockCount = 0;
+};
+
+#endif // BINLOG_BIN_FIND_HPP
@@ -0,0 +1,504 @@
+#include "json.hpp"
+#include "printers.hpp"
+
+#include <binlog/Entries.hpp>
+#include <binlog/EntryStream.hpp>
+#include <binlog/EventStream.hpp>
+#include <binlog/PrettyPrinter.hpp>
+#include <binlog/Range.hpp>
+#include <binlog/Severity.hpp>
+#include <binlog/Time.hpp>
+#include <binlog/detail/FormatSpec.hpp>
+#include <binlog/detail/OstreamBuffer.hpp>
+#include <binlog/detail/SegmentedMap.hpp>
+
+#include <mserialize/Visitor.hpp>
+#include <mserialize/VisitPlan.hpp>
+#include <mserialize/string_view.hpp>
+#include <mserialize/visit.hpp>
+
+#include <algorithm> // any_of
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio> // snprintf
+#include <ios>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace {
+
+/** Appends to a string, to precompile parts of the output by the same functions that write the output */
+struct StringWriter
+{
+  std::string& str;
+
+  void put(char c) { str.push_back(c); }
+  void write(const char* data, std::size_t size) { str.append(data, size); }
+};
+
+/**
+ * An ostream that appends to a string, without copying the string out:
+ * the text printed by PrettyPrinter is escaped from `str`,
+ * the capacity of `str` is reused by the next event.
+ */
+class StringOstream : private std::streambuf, public std::ostream
+{
+public:
+  StringOstream() :std::ostream(this) {}
+
+  std::string str;
+
+private:
+  using Traits = std::streambuf::traits_type;
+
+  std::streambuf::int_type overflow(std::streambuf::int_type c) override
+  {
+    if (! Traits::eq_int_type(c, Traits::eof())) { str.push_back(Traits::to_char_type(c)); }
+    return Traits::not_eof(c);
+  }
+
+  std::streamsize xsputn(const char* data, std::streamsize size) override
+  {
+    str.append(data, std::size_t(size));
+    return size;
+  }
+};
+
+/**
+ * Write [data, data+size) escaped as the contents of a JSON string literal.
+ * Runs of characters that need no escaping are written at once.
+ */
+template <typename Output>
+void writeJsonChars(Output& out, const char* data, std::size_t size)
+{
+  static const char hex[] = "0123456789abcdef";
+
+  const char* run = data; // the beginning of the characters not written yet
+  const char* const end = data + size;
+  for (const char* p = data; p != end; ++p)
+  {
+    const unsigned char c = static_cast<unsigned char>(*p);
+    if (c >= 0x20 && c != '"' && c != '\\') { continue; }
+
+    out.write(run, std::size_t(p - run));
+    run = p + 1;
+
+    switch (c)
+    {
+    case '"':  out.write("\\\"", 2); break;
+    case '\\': out.write("\\\\", 2); break;
+    case '\n': out.write("\\n", 2); break;
+    case '\r': out.write("\\r", 2); break;
+    case '\t': out.write("\\t", 2); break;
+    default:
+    {
+      const char escaped[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 15]};
+      out.write(escaped, sizeof(escaped));
+    }
+    }
+  }
+  out.write(run, std::size_t(end - run));
+}
+
+/** Write `str` as a JSON string literal */
+template <typename Output>
+void writeJsonString(Output& out, mserialize::string_view str)
+{
+  out.put('"');
+  writeJsonChars(out, str.data(), str.size());
+  out.put('"');
+}
+
+/**
+ * Writes deserialized values as JSON values, see mserialize::visit.
+ * Elements of arrays and fields of objects are separated by commas:
+ * `_needComma` is set if the next value is not the first one in its container.
+ */
+class JsonVisitor
+{
+public:
+  JsonVisitor(binlog::detail::OstreamBuffer& out, const binlog::PrettyPrinter& printer, StringOstream& structStream, binlog::detail::OstreamBuffer& structBuffer)
+    :_out(out),
+     _printer(printer),
+     _structStream(structStream),
+     _structBuffer(structBuffer)
+  {}
+
+  template <typename T>
+  void visit(T v)
+  {
+    beginValue();
+    _out << v;
+  }
+
+  void visit(bool v)
+  {
+    beginValue();
+    _out << v;
+  }
+
+  void visit(char c)
+  {
+    beginValue();
+    writeJsonString(_out, mserialize::string_view(&c, 1));
+  }
+
+  void visit(float v) { visitFloat(v); }
+  void visit(double v) { visitFloat(v); }
+  void visit(long double v) { visitFloat(v); }
+
+  bool visit(mserialize::Visitor::SequenceBegin sb, binlog::Range& input)
+  {
+    beginValue();
+    if (sb.tag == "c")
+    {
+      writeJsonString(_out, mserialize::string_view(input.view(sb.size), sb.size));
+      return true;
+    }
+
+    _out.put('[');
+    _needComma = false;
+    return false;
+  }
+
+  void visit(mserialize::Visitor::SequenceEnd) { endContainer(']'); }
+
+  bool visit(mserialize::Visitor::TupleBegin, const binlog::Range&)
+  {
+    beginValue();
+    _out.put('[');
+    _needComma = false;
+    return false;
+  }
+
+  void visit(mserialize::Visitor::TupleEnd) { endContainer(']'); }
+
+  bool visit(mserialize::Visitor::VariantBegin vb, const binlog::Range&)
+  {
+    // an out of range discriminator has no value
+    if (vb.tag.empty()) { visit(mserialize::Visitor::Null{}); }
+    return false;
+  }
+
+  void visit(mserialize::Visitor::VariantEnd) {}
+
+  void visit(mserialize::Visitor::Null)
+  {
+    beginValue();
+    _out << "null";
+  }
+
+  void visit(mserialize::Visitor::Enum e)
+  {
+    beginValue();
+
+    // enums with a printer (e.g: added by a plugin) become strings
+    _structStream.str.clear();
+    if (_printer.printEnum(_structBuffer, e))
+    {
+      _structBuffer.flush();
+      writeJsonString(_out, _structStream.str);
+      return;
+    }
+
+    if (e.enumerator.empty())
+    {
+      _out << "\"0x" << e.value << '"';
+    }
+    else
+    {
+      writeJsonString(_out, e.enumerator);
+    }
+  }
+
+  bool visit(mserialize::Visitor::StructBegin sb, binlog::Range& input)
+  {
+    beginValue();
+
+    // structs with a printer (e.g: durations, time points) become strings
+    _structStream.str.clear();
+    if (_printer.printStruct(_structBuffer, sb, input))
+    {
+      _structBuffer.flush();
+      writeJsonString(_out, _structStream.str);
+      return true;
+    }
+
+    _out.put('{');
+    _needComma = false;
+    return false;
+  }
+
+  void visit(mserialize::Visitor::StructEnd) { endContainer('}'); }
+
+  void visit(mserialize::Visitor::FieldBegin fb)
+  {
+    if (_needComma) { _out.put(','); }
+    writeJsonString(_out, fb.name);
+    _out.put(':');
+    _needComma = false;
+  }
+
+  void visit(mserialize::Visitor::FieldEnd) {}
+
+  void visit(mserialize::Visitor::RepeatBegin rb)
+  {
+    beginValue();
+    _out << "{\"repeat\":" << rb.size << ",\"value\":";
+    _needComma = false;
+  }
+
+  void visit(mserialize::Visitor::RepeatEnd) { endContainer('}'); }
+
+private:
+  void beginValue()
+  {
+    if (_needComma) { _out.put(','); }
+    _needComma = true;
+  }
+
+  void endContainer(char c)
+  {
+    _out.put(c);
+    _needComma = true;
+  }
+
+  template <typename T>
+  void visitFloat(T v)
+  {
+    beginValue();
+    if (std::isnan(v)) { _out << "\"nan\""; }
+    else if (std::isinf(v)) { _out << ((v < 0) ? "\"-inf\"" : "\"inf\""); }
+    else { _out << v; }
+  }
+
+  binlog::detail::OstreamBuffer& _out;
+  const binlog::PrettyPrinter& _printer;
+  StringOstream& _structStream;
+  binlog::detail::OstreamBuffer& _structBuffer; // writes _structStream
+  bool _needComma = false;
+};
+
+/** The parts of the output computed once per event source */
+struct SourceTemplate
+{
+  // the source properties the template was computed from
+  binlog::EventSource source;
+
+  // ,"severity":...,"format":"..." - the keys of the source, escaped
+  std::string keys;
+
+  // the arguments, as a tuple: visited as an array
+  mserialize::VisitPlan argumentsPlan;
+
+  // ,"arg_names":[...] - if the format string has named placeholders
+  std::string argumentNames;
+};
+
+bool sameSource(const binlog::EventSource& a, const binlog::EventSource& b)
+{
+  return a.severity == b.severity
+    && a.line == b.line
+    && a.formatString == b.formatString
+    && a.argumentTags == b.argumentTags
+    && a.file == b.file
+    && a.function == b.function
+    && a.category == b.category;
+}
+
+SourceTemplate makeSourceTemplate(const binlog::EventSource& source)
+{
+  SourceTemplate result;
+  result.source = source;
+
+  StringWriter keys{result.keys};
+  keys.write(",\"severity\":", 12);
+  writeJsonString(keys, mserialize::string_view(binlog::severityToString(source.severity).data()));
+  keys.write(",\"category\":", 12);
+  writeJsonString(keys, source.category);
+  keys.write(",\"function\":", 12);
+  writeJsonString(keys, source.function);
+  keys.write(",\"file\":", 8);
+  writeJsonString(keys, source.file);
+  result.keys += ",\"line\":" + std::to_string(source.line) + ",\"format\":";
+  writeJsonString(keys, source.formatString);
+
+  result.argumentsPlan = mserialize::VisitPlan("(" + source.argumentTags + ")");
+
+  const std::vector<std::string> names = binlog::detail::names_are_placeholders(source.formatString, source.argumentTags)
+    ? binlog::detail::placeholder_names(source.formatString) : std::vector<std::string>{};
+  if (std::any_of(names.begin(), names.end(), [](const std::string& name) { return ! name.empty(); }))
+  {
+    StringWriter argumentNames{result.argumentNames};
+    result.argumentNames = ",\"arg_names\":[";
+    for (std::size_t i = 0; i < names.size(); ++i)
+    {
+      if (i != 0) { result.argumentNames += ','; }
+      if (names[i].empty()) { result.argumentNames += "null"; }
+      else { writeJsonString(argumentNames, names[i]); }
+    }
+    result.argumentNames += ']';
+  }
+  return result;
+}
+
+/** Writes the events as JSON objects, with the templates of the sources and writers cached */
+class JsonWriter
+{
+public:
+  explicit JsonWriter(std::ostream& out)
+    :_out(out),
+     _printer("%m", "%Y-%m-%d %H:%M:%S.%N"),
+     _messageBuffer(_messageStream),
+     _structBuffer(_structStream),
+     _flushEachEvent((out.flags() & std::ios_base::unitbuf) != 0) // e.g: when following a file
+  {
+    setupPrinter(_printer);
+  }
+
+  void writeEvent(const binlog::Event& event, const binlog::WriterProp& writer, const binlog::ClockSync& clockSync)
+  {
+    // the message first: the struct printers of the arguments depend on it
+    _messageStream.str.clear();
+    _printer.printEvent(_messageBuffer, event, writer, clockSync);
+    _messageBuffer.flush();
+
+    _out << "{\"time\":";
+    writeTime(event.clockValue, clockSync);
+    _out << ",\"clock\":" << event.clockValue;
+
+    if (writer.id != _writerId || writer.name != _writerName || _writerKeys.empty())
+    {
+      _writerId = writer.id;
+      _writerName = writer.name;
+      _writerKeys.clear();
+      StringWriter keys{_writerKeys};
+      keys.write(",\"writer\":", 10);
+      writeJsonString(keys, writer.name);
+      _writerKeys += ",\"writer_id\":" + std::to_string(writer.id);
+    }
+    _out << _writerKeys;
+
+    const SourceTemplate& source = sourceTemplate(*event.source);
+    _out << source.keys;
+
+    _out << ",\"message\":";
+    writeJsonString(_out, _messageStream.str);
+
+    _out << ",\"args\":";
+    JsonVisitor visitor(_out, _printer, _structStream, _structBuffer);
+    binlog::Range arguments = event.arguments;
+    mserialize::visit(source.argumentsPlan, visitor, arguments);
+    _out << source.argumentNames;
+
+    _out << "}\n";
+    if (_flushEachEvent) { _out.flush(); }
+  }
+
+  void flush() { _out.flush(); }
+
+private:
+  const SourceTemplate& sourceTemplate(const binlog::EventSource& source)
+  {
+    const SourceTemplate* cached = _sources.find(source.id);
+    if (cached != _sources.end() && sameSource(cached->source, source))
+    {
+      return *cached;
+    }
+
+    _sources.emplace(source.id, makeSourceTemplate(source));
+    return *_sources.find(source.id);
+  }
+
+  /** Write the time of `clockValue` as "YYYY-MM-DDTHH:MM:SS.NNNNNNNNNZ" (UTC), or null if there is no clock sync */
+  void writeTime(std::uint64_t clockValue, const binlog::ClockSync& clockSync)
+  {
+    if (std::int64_t(clockSync.clockFrequency) <= 0)
+    {
+      _out << "null";
+      return;
+    }
+
+    const std::int64_t ns = binlog::clockToNsSinceEpoch(clockSync, clockValue).count();
+    std::int64_t seconds = ns / 1000000000;
+    std::int64_t nanoseconds = ns % 1000000000;
+    if (nanoseconds < 0) { --seconds; nanoseconds += 1000000000; }
+
+    // the date and time are formatted once per second
+    if (seconds != _timeSeconds || _timePrefix.empty())
+    {
+      binlog::BrokenDownTime bdt{};
+      binlog::nsSinceEpochToBrokenDownTimeUTC(std::chrono::seconds{seconds}, bdt);
+      char buf[64] = {};
+      const int size = std::snprintf(buf, sizeof(buf), "\"%04d-%02d-%02dT%02d:%02d:%02d.",
+        bdt.tm_year + 1900, bdt.tm_mon + 1, bdt.tm_mday, bdt.tm_hour, bdt.tm_min, bdt.tm_sec);
+      _timePrefix.assign(buf, (size > 0) ? std::size_t(size) : 0);
+      _timeSeconds = seconds;
+    }
+    _out << _timePrefix;
+
+    char fraction[11] = {'0', '0', '0', '0', '0', '0', '0', '0', '0', 'Z', '"'};
+    for (int i = 8; i >= 0; --i)
+    {
+      fraction[i] = char('0' + nanoseconds % 10);
+      nanoseconds /= 10;
+    }
+    _out.write(fraction, sizeof(fraction));
+  }
+
+  binlog::detail::OstreamBuffer _out;
+  binlog::PrettyPrinter _printer;
+  StringOstream _messageStream;
+  binlog::detail::OstreamBuffer _messageBuffer; // writes _messageStream
+  StringOstream _structStream;
+  binlog::detail::OstreamBuffer _structBuffer;  // writes _structStream
+  bool _flushEachEvent;
+
+  binlog::detail::SegmentedMap<SourceTemplate> _sources;
+
+  std::uint64_t _writerId = 0;
+  std::string _writerName;
+  std::string _writerKeys; // ,"writer":"...","writer_id":N
+
+  std::int64_t _timeSeconds = 0;
+  std::string _timePrefix; // "YYYY-MM-DDTHH:MM:SS. of _timeSeconds
+};
+
+} // namespace
+
+void writeJsonEvents(binlog::EntryStream& input, std::ostream& out)
+{
+  binlog::EventStream eventStream;
+  JsonWriter writer(out);
+
+  while (const binlog::Event* event = eventStream.nextEvent(input))
+  {
+    writer.writeEvent(*event, eventStream.writerProp(), eventStream.clockSync());
+  }
+}
+
+struct JsonEventWriter::Impl
+{
+  explicit Impl(std::ostream& out) :writer(out) {}
+  JsonWriter writer;
+};
+
+JsonEventWriter::JsonEventWriter(std::ostream& out)
+  :_impl(new Impl(out))
+{}
+
+JsonEventWriter::~JsonEventWriter() = default;
+
+void JsonEventWriter::writeEvent(const binlog::Event& event, const binlog::WriterProp& writer, const binlog::ClockSync& clockSync)
+{
+  _impl->writer.writeEvent(event, writer, clockSync);
+}
+
+void JsonEventWriter::flush()
+{
+  _impl->writer.flush();
+}
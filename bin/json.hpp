@@ -0,0 +1,60 @@
+#ifndef BINLOG_BIN_JSON_HPP
+#define BINLOG_BIN_JSON_HPP
+
+#include <iosfwd>
+#include <memory>
+
+namespace binlog {
+class EntryStream;
+struct Event;
+struct WriterProp;
+struct ClockSync;
+} // namespace binlog
+
+/**
+ * Write the events of `input` to `out`, as JSON lines (NDJSON):
+ * a JSON object per event, terminated by a newline.
+ *
+ * Each object has the following keys:
+ * time (UTC, ISO 8601, with nanoseconds, null if there is no clock sync),
+ * clock (raw clock value), writer, writer_id, severity, category,
+ * function, file, line, format (the format string),
+ * message (the format string with the arguments substituted),
+ * and args: the arguments of the event as JSON values.
+ *
+ * Arithmetic arguments become numbers (or true/false),
+ * non-finite floating point values the strings "nan", "inf" and "-inf".
+ * Strings and characters become strings, other sequences and tuples arrays,
+ * structures objects, keyed by their field names, enums the name of the enumerator.
+ * Structures and enums that have a printer in PrettyPrinter (e.g: time points,
+ * durations, interned strings, or added by a plugin) become strings, printed by that printer.
+ */
+void writeJsonEvents(binlog::EntryStream& input, std::ostream& out);
+
+/**
+ * Writes events one by one, in the format of writeJsonEvents,
+ * e.g: if the events are also written to other outputs.
+ * The templates of the sources and writers are cached.
+ */
+class JsonEventWriter
+{
+public:
+  /** `out` must remain valid as long as *this is valid */
+  explicit JsonEventWriter(std::ostream& out);
+  ~JsonEventWriter();
+
+  JsonEventWriter(const JsonEventWriter&) = delete;
+  void operator=(const JsonEventWriter&) = delete;
+
+  /** Write `event` as a JSON object, followed by a newline */
+  void writeEvent(const binlog::Event& event, const binlog::WriterProp& writer, const binlog::ClockSync& clockSync);
+
+  /** Write the buffered output to `out` */
+  void flush();
+
+private:
+  struct Impl;
+  std::unique_ptr<Impl> _impl;
+};
+
+#endif // BINLOG_BIN_JSON_HPP
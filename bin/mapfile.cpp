@@ -0,0 +1,19 @@
+#include "mapfile.hpp"
+
+#include <binlog/EntryStream.hpp>
+
+#include <stdexcept>
+
+std::unique_ptr<binlog::MmapEntryStream> mapFile(const std::string& path)
+{
+  if (path == "-") { return nullptr; }
+
+  try
+  {
+    return std::unique_ptr<binlog::MmapEntryStream>(new binlog::MmapEntryStream(path));
+  }
+  catch (const std::runtime_error&)
+  {
+    return nullptr; // fall back to reading a stream
+  }
+}
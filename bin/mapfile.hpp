@@ -0,0 +1,20 @@
+#ifndef BINLOG_BIN_MAPFILE_HPP
+#define BINLOG_BIN_MAPFILE_HPP
+
+#include <memory>
+#include <string>
+
+namespace binlog {
+class MmapEntryStream;
+} // namespace binlog
+
+/**
+ * Map the logfile at `path` to memory, to read it without copying.
+ *
+ * @returns the mapped file at `path`, or nullptr, if it is not a regular file
+ *          (e.g: "-", standard input) or can not be mapped.
+ *          The caller is expected to fall back to reading a stream.
+ */
+std::unique_ptr<binlog::MmapEntryStream> mapFile(const std::string& path);
+
+#endif // BINLOG_BIN_MAPFILE_HPP
@@ -0,0 +1,383 @@
+#include "merge.hpp"
+
+#include <binlog/Entries.hpp>
+#include <binlog/EntryStream.hpp>
+#include <binlog/EventStream.hpp>
+#include <binlog/Range.hpp>
+#include <binlog/Time.hpp>
+#include <binlog/detail/EventSourceTable.hpp>
+#include <binlog/detail/SegmentedMap.hpp>
+
+#include <mserialize/deserialize.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct BufferedEvent
+{
+  std::int64_t time;      // nanoseconds since epoch
+  std::size_t input;      // index of the input
+  std::uint64_t sequence; // in the input
+  std::uint64_t sourceId; // in the output
+  std::size_t writer;     // index of the writer in the output
+  std::size_t context;    // index of the writer context in the output
+  binlog::ClockCorrection correction; // of the input, in effect at the event
+  std::string arguments;
+};
+
+/** Order of std::push_heap: the earliest event at the top */
+bool later(const BufferedEvent& a, const BufferedEvent& b)
+{
+  return std::tie(a.time, a.input, a.sequence) > std::tie(b.time, b.input, b.sequence);
+}
+
+class Merger;
+
+/** Forwards the entries of an input to its EventStream, and maps the metadata to the output */
+class InputEntryStream : public binlog::EntryStream
+{
+public:
+  InputEntryStream(binlog::EntryStream& input, Merger& merger)
+    :_input(input),
+     _merger(merger)
+  {}
+
+  binlog::Range nextEntryPayload() override;
+
+  bool writerChanged = true;                                // NOLINT
+  binlog::detail::SegmentedMap<std::uint64_t> sourceIds;    // NOLINT output source ids by input source id
+
+private:
+  binlog::EntryStream& _input;
+  Merger& _merger;
+};
+
+struct Input
+{
+  Input(binlog::EntryStream& input, Merger& merger)
+    :entryStream(input, merger)
+  {}
+
+  InputEntryStream entryStream;
+  binlog::EventStream eventStream;
+  bool exhausted = false;
+  std::uint64_t sequence = 0;
+  std::size_t writer = 0;                         // index of the current writer in the output
+  std::size_t context = 0;                        // index of the current writer context in the output
+  std::map<std::size_t, std::int64_t> writerTimes; // the latest event time by writer
+  std::multiset<std::int64_t> latestTimes;         // values of writerTimes
+
+  /**
+   * @returns the earliest latest event time of the writers seen so far:
+   * how far the input is read, if its writers are busy.
+   * Not a lower bound of the future events: a writer might appear later,
+   * with earlier events (e.g: a channel consumed late).
+   */
+  std::int64_t watermark() const
+  {
+    if (exhausted) { return (std::numeric_limits<std::int64_t>::max)(); }
+    if (latestTimes.empty()) { return (std::numeric_limits<std::int64_t>::min)(); }
+    return *latestTimes.begin();
+  }
+
+  void updateWriterTime(std::size_t writerIndex, std::int64_t time)
+  {
+    auto it = writerTimes.find(writerIndex);
+    if (it == writerTimes.end())
+    {
+      writerTimes.emplace(writerIndex, time);
+      latestTimes.insert(time);
+    }
+    else if (it->second < time)
+    {
+      latestTimes.erase(latestTimes.find(it->second));
+      latestTimes.insert(time);
+      it->second = time;
+    }
+  }
+};
+
+class Merger
+{
+public:
+  Merger(const std::vector<binlog::EntryStream*>& inputs, std::ostream& output, std::size_t memoryLimit)
+    :_output(output),
+     _memoryLimit(memoryLimit)
+  {
+    for (binlog::EntryStream* input : inputs)
+    {
+      _inputs.emplace_back(new Input(*input, *this));
+    }
+  }
+
+  std::size_t merge()
+  {
+    while (true)
+    {
+      // read the input lagging behind the most, to keep the inputs
+      // in step if the memory limit forces writing events early
+      std::int64_t watermark = (std::numeric_limits<std::int64_t>::max)();
+      std::size_t next = _inputs.size();
+      for (std::size_t i = 0; i < _inputs.size(); ++i)
+      {
+        const std::int64_t w = _inputs[i]->watermark();
+        if (! _inputs[i]->exhausted && (next == _inputs.size() || w < watermark))
+        {
+          watermark = w;
+          next = i;
+        }
+      }
+
+      if (next == _inputs.size()) { break; } // every input is exhausted
+
+      readEvent(next);
+
+      while (_memoryUsage > _memoryLimit && ! _buffer.empty()) { writeEarliest(); }
+    }
+
+    while (! _buffer.empty()) { writeEarliest(); }
+
+    writeCounters();
+    return _eventCount;
+  }
+
+  /** Map the id of `source` in the input of `entryStream` to an output id */
+  void addSource(InputEntryStream& entryStream, const binlog::EventSource& source)
+  {
+    std::string key;
+    key += std::to_string(std::uint16_t(source.severity));
+    for (const std::string* field : {&source.category, &source.function, &source.file, &source.formatString, &source.argumentTags})
+    {
+      key += '\0';
+      key += *field;
+    }
+    key += '\0';
+    key += std::to_string(source.line);
+
+    auto it = _sourceIdsByKey.find(key);
+    if (it == _sourceIdsByKey.end())
+    {
+      binlog::EventSource outputSource = source;
+      outputSource.id = _sources.size();
+      _sources.push_back(std::move(outputSource));
+      _sourceWritten.push_back(false);
+      it = _sourceIdsByKey.emplace(std::move(key), _sources.back().id).first;
+    }
+
+    entryStream.sourceIds.emplace(source.id, it->second);
+  }
+
+  void writeEntry(binlog::Range payload)
+  {
+    const std::uint32_t size = std::uint32_t(payload.size());
+    _output.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    _output.write(payload.view(size), std::streamsize(size));
+  }
+
+private:
+  void readEvent(std::size_t index)
+  {
+    Input& input = *_inputs[index];
+    const binlog::Event* event = input.eventStream.nextEvent(input.entryStream);
+    if (event == nullptr)
+    {
+      input.exhausted = true;
+      _droppedEventCount += input.eventStream.droppedEventCount();
+      _repeatedEventCount += input.eventStream.repeatedEventCount();
+      return;
+    }
+
+    if (input.entryStream.writerChanged)
+    {
+      input.writer = writerIndex(input.eventStream.writerProp());
+      input.context = contextIndex(input.eventStream.writerProp().context);
+      input.entryStream.writerChanged = false;
+    }
+
+    const binlog::ClockSync& clockSync = input.eventStream.clockSync();
+    if (clockSync.clockFrequency == 0)
+    {
+      throw std::runtime_error("Event before the first clock sync in input #" + std::to_string(index));
+    }
+    if (_timeZone.clockFrequency == 0) { _timeZone = clockSync; }
+
+    const std::int64_t time = input.eventStream.clockConverter().toNsSinceEpoch(event->clockValue).count();
+    input.updateWriterTime(input.writer, time);
+
+    const std::uint64_t* sourceId = input.entryStream.sourceIds.find(event->source->id);
+    binlog::Range arguments = event->arguments;
+    const std::size_t argumentsSize = arguments.size();
+
+    _buffer.push_back(BufferedEvent{
+      time, index, input.sequence++, *sourceId, input.writer, input.context,
+      input.eventStream.clockCorrection(),
+      std::string(arguments.view(argumentsSize), argumentsSize)
+    });
+    std::push_heap(_buffer.begin(), _buffer.end(), later);
+    _memoryUsage += sizeof(BufferedEvent) + argumentsSize;
+  }
+
+  std::size_t writerIndex(const binlog::WriterProp& writerProp)
+  {
+    const auto key = std::make_pair(writerProp.id, writerProp.name);
+    auto it = _writerIndices.find(key);
+    if (it == _writerIndices.end())
+    {
+      binlog::WriterProp outputProp = writerProp;
+      outputProp.batchSize = 0; // batches are not kept together
+      _writerProps.push_back(std::move(outputProp));
+      it = _writerIndices.emplace(key, _writerProps.size() - 1).first;
+    }
+    return it->second;
+  }
+
+  /** Writer contexts are indexed separately: the end of a context (e.g: a trace) must not hold back the others */
+  std::size_t contextIndex(const std::string& context)
+  {
+    auto it = _contextIndices.find(context);
+    if (it == _contextIndices.end())
+    {
+      _contexts.push_back(context);
+      it = _contextIndices.emplace(context, _contexts.size() - 1).first;
+    }
+    return it->second;
+  }
+
+  void writeEarliest()
+  {
+    std::pop_heap(_buffer.begin(), _buffer.end(), later);
+    BufferedEvent event = std::move(_buffer.back());
+    _buffer.pop_back();
+    _memoryUsage -= sizeof(BufferedEvent) + event.arguments.size();
+
+    if (! _clockSyncWritten)
+    {
+      // clock values of the output are nanoseconds since the epoch
+      const binlog::ClockSync clockSync{0, 1000000000, 0, _timeZone.tzOffset, _timeZone.tzName};
+      binlog::serializeSizePrefixedTagged(clockSync, _output);
+      _clockSyncWritten = true;
+    }
+
+    if (event.correction.offset != _lastCorrection.offset
+        || event.correction.uncertainty != _lastCorrection.uncertainty)
+    {
+      binlog::serializeSizePrefixedTagged(event.correction, _output);
+      _lastCorrection = event.correction;
+    }
+
+    if (event.writer != _lastWriter || event.context != _lastContext)
+    {
+      // the WriterProp entry clears the context
+      binlog::serializeSizePrefixedTagged(_writerProps[event.writer], _output);
+      const std::string& context = _contexts[event.context];
+      if (! context.empty()) { binlog::serializeSizePrefixedTagged(binlog::WriterContext{context}, _output); }
+      _lastWriter = event.writer;
+      _lastContext = event.context;
+    }
+
+    const std::size_t sourceIndex = std::size_t(event.sourceId);
+    if (! _sourceWritten[sourceIndex])
+    {
+      binlog::serializeSizePrefixedTagged(_sources[sourceIndex], _output);
+      _sourceWritten[sourceIndex] = true;
+    }
+
+    const std::uint32_t size = std::uint32_t(2 * sizeof(std::uint64_t) + event.arguments.size());
+    const std::uint64_t clock = std::uint64_t(event.time);
+    _output.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    _output.write(reinterpret_cast<const char*>(&event.sourceId), sizeof(event.sourceId));
+    _output.write(reinterpret_cast<const char*>(&clock), sizeof(clock));
+    _output.write(event.arguments.data(), std::streamsize(event.arguments.size()));
+
+    _lastClock = clock;
+    ++_eventCount;
+  }
+
+  void writeCounters()
+  {
+    if (_droppedEventCount != 0)
+    {
+      binlog::serializeSizePrefixedTagged(binlog::DroppedEvents{_droppedEventCount}, _output);
+    }
+    if (_repeatedEventCount != 0)
+    {
+      binlog::serializeSizePrefixedTagged(binlog::RepeatedEvents{_repeatedEventCount, _lastClock}, _output);
+    }
+  }
+
+  std::ostream& _output;
+  std::size_t _memoryLimit;
+  std::vector<std::unique_ptr<Input>> _inputs;
+
+  std::vector<BufferedEvent> _buffer; // heap, see `later`
+  std::size_t _memoryUsage = 0;       // of _buffer
+
+  std::map<std::string, std::uint64_t> _sourceIdsByKey;
+  std::vector<binlog::EventSource> _sources; // by output id
+  std::vector<bool> _sourceWritten;          // by output id
+
+  std::map<std::pair<std::uint64_t, std::string>, std::size_t> _writerIndices;
+  std::vector<binlog::WriterProp> _writerProps;
+  std::size_t _lastWriter = std::size_t(-1);
+
+  std::map<std::string, std::size_t> _contextIndices;
+  std::vector<std::string> _contexts;
+  std::size_t _lastContext = std::size_t(-1);
+
+  binlog::ClockSync _timeZone; // the first clock sync read
+  bool _clockSyncWritten = false;
+  binlog::ClockCorrection _lastCorrection; // the latest written, initially none
+  std::uint64_t _lastClock = 0;
+  std::uint64_t _droppedEventCount = 0;
+  std::uint64_t _repeatedEventCount = 0;
+  std::size_t _eventCount = 0;
+};
+
+binlog::Range InputEntryStream::nextEntryPayload()
+{
+  const binlog::Range payload = _input.nextEntryPayload();
+  if (payload.size() < sizeof(std::uint64_t)) { return payload; } // end of input, or let EventStream report the error
+
+  binlog::Range entry = payload;
+  const std::uint64_t tag = entry.read<std::uint64_t>();
+  if (tag == binlog::EventSource::Tag)
+  {
+    binlog::EventSource source;
+    mserialize::deserialize(source, entry);
+    _merger.addSource(*this, source);
+  }
+  else if (tag == binlog::EventSourceTable::Tag)
+  {
+    binlog::detail::readEventSourceTable(entry, [this](binlog::EventSource&& source) { _merger.addSource(*this, source); });
+  }
+  else if (tag == binlog::WriterProp::Tag || tag == binlog::WriterContext::Tag)
+  {
+    writerChanged = true;
+  }
+  else if (tag == binlog::InternedString::Tag)
+  {
+    _merger.writeEntry(payload);
+  }
+
+  return payload;
+}
+
+} // namespace
+
+std::size_t mergeEvents(const std::vector<binlog::EntryStream*>& inputs, std::ostream& output, std::size_t memoryLimit)
+{
+  Merger merger(inputs, output, memoryLimit);
+  return merger.merge();
+}
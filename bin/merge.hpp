@@ -0,0 +1,52 @@
+#ifndef BINLOG_BIN_MERGE_HPP
+#define BINLOG_BIN_MERGE_HPP
+
+#include <cstddef>
+#include <iosfwd>
+#include <vector>
+
+namespace binlog {
+class EntryStream;
+} // namespace binlog
+
+/**
+ * Merge the events of `inputs` to `output`, as a single binlog stream,
+ * ordered by wall clock time.
+ *
+ * The clock of each event is converted to nanoseconds since the UNIX epoch,
+ * using the ClockSync of its input in effect at the event.
+ * The output has a single ClockSync, with nanosecond resolution,
+ * in the time zone of the first input.
+ * Clock corrections (e.g: the offsets of the hosts of the inputs to a reference clock,
+ * see Session::setClockCorrection) are already applied by the ClockSyncs of each input,
+ * therefore events of different hosts are ordered by the corrected time.
+ * A ClockCorrection entry is written before each event whose correction differs
+ * from the one of the previous event, to keep the uncertainty of the event times.
+ *
+ * Event sources are assigned new ids by their properties:
+ * sources with the same properties in different inputs (say, of the same program)
+ * get the same id, different sources with the same id are assigned different ids.
+ * Writer properties and contexts are kept as they are.
+ *
+ * The inputs are read event by event, to a time ordered buffer.
+ * A writer might first appear late in an input, with events earlier
+ * than the events read before, therefore the events are written only
+ * at the end of the inputs, and the output is ordered by time.
+ * If the buffered events take more than `memoryLimit` bytes,
+ * the earliest buffered event is written early, and the output
+ * might not be perfectly ordered. To keep the inputs in step, the next
+ * event is read from the input whose writers lag behind the most.
+ *
+ * InternedString entries are written as they are, their ids are not remapped.
+ * DroppedEvents and RepeatedEvents are summed, and written at the end.
+ *
+ * @returns the number of events written
+ * @throws std::runtime_error if an input contains an invalid entry,
+ *         or an event before the first ClockSync of its input.
+ */
+std::size_t mergeEvents(
+  const std::vector<binlog::EntryStream*>& inputs, std::ostream& output,
+  std::size_t memoryLimit = std::size_t{1} << 30
+);
+
+#endif // BINLOG_BIN_MERGE_HPP
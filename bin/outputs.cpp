@@ -0,0 +1,175 @@
+#include "outputs.hpp"
+
+#include "json.hpp"
+#include "printers.hpp"
+#include "stats.hpp"
+
+#include <binlog/AsyncOutputStream.hpp>
+#include <binlog/Entries.hpp>
+#include <binlog/EntryStream.hpp>
+#include <binlog/EventStream.hpp>
+#include <binlog/PrettyPrinter.hpp>
+#include <binlog/detail/OstreamBuffer.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <streambuf>
+#include <vector>
+
+namespace {
+
+/** Stream buffer writing an AsyncOutputStream in large chunks: the output is written by its own thread */
+class AsyncStreambuf : public std::streambuf
+{
+public:
+  explicit AsyncStreambuf(std::ostream& out)
+    :_async(out),
+     _buffer(std::size_t{1} << 16)
+  {
+    setp(_buffer.data(), _buffer.data() + _buffer.size());
+  }
+
+  /** Wait until the buffered output is written, then flush the output */
+  void close()
+  {
+    writeBuffer();
+    _async.flush();
+  }
+
+protected:
+  int_type overflow(int_type c) override
+  {
+    writeBuffer();
+    if (! traits_type::eq_int_type(c, traits_type::eof()))
+    {
+      *pptr() = traits_type::to_char_type(c);
+      pbump(1);
+    }
+    return traits_type::not_eof(c);
+  }
+
+  int sync() override
+  {
+    writeBuffer();
+    return 0;
+  }
+
+private:
+  void writeBuffer()
+  {
+    const std::ptrdiff_t size = pptr() - pbase();
+    if (size != 0) { _async.write(pbase(), std::streamsize(size)); }
+    setp(_buffer.data(), _buffer.data() + _buffer.size());
+  }
+
+  binlog::AsyncOutputStream<std::ostream> _async;
+  std::vector<char> _buffer;
+};
+
+/** Writes the events to an Output, according to its kind */
+class OutputWriter
+{
+public:
+  OutputWriter(const Output& output, const std::string& format, const std::string& dateFormat)
+    :_kind(output.kind),
+     _buffer(*output.out),
+     _stream(&_buffer),
+     _out(_stream),
+     _printer(format, dateFormat)
+  {
+    setupPrinter(_printer);
+    if (_kind == OutputKind::json) { _json.reset(new JsonEventWriter(_stream)); }
+  }
+
+  void writeEvent(const binlog::Event& event, const binlog::EventStream& eventStream)
+  {
+    if (_kind == OutputKind::text)
+    {
+      _printer.printEvent(_out, event, eventStream.writerProp(), eventStream.clockSync());
+    }
+    else if (_json)
+    {
+      _json->writeEvent(event, eventStream.writerProp(), eventStream.clockSync());
+    }
+  }
+
+  /** Write `stats`, if this is a stats output, then wait until everything is written */
+  void close(const Statistics& stats)
+  {
+    if (_json) { _json->flush(); }
+    _out.flush();
+
+    if (_kind == OutputKind::stats)
+    {
+      printStatistics(stats, _stream, 20, std::chrono::seconds{1});
+    }
+
+    _stream.flush();
+    if (! _stream) { throw std::runtime_error("Failed to write output"); }
+    _buffer.close();
+  }
+
+private:
+  OutputKind _kind;
+  AsyncStreambuf _buffer;
+  std::ostream _stream;              // writes _buffer
+  binlog::detail::OstreamBuffer _out; // writes _stream
+  binlog::PrettyPrinter _printer;
+  std::unique_ptr<JsonEventWriter> _json; // writes _stream
+};
+
+} // namespace
+
+bool parseOutputSpec(const std::string& str, OutputSpec& result)
+{
+  const std::size_t colon = str.find(':');
+  if (colon == std::string::npos || colon + 1 == str.size()) { return false; }
+
+  const std::string kind = str.substr(0, colon);
+  if (kind == "text") { result.kind = OutputKind::text; }
+  else if (kind == "json") { result.kind = OutputKind::json; }
+  else if (kind == "stats") { result.kind = OutputKind::stats; }
+  else { return false; }
+
+  result.path = str.substr(colon + 1);
+  return true;
+}
+
+void writeOutputs(
+  binlog::EntryStream& input, const std::vector<Output>& outputs,
+  const std::string& format, const std::string& dateFormat
+)
+{
+  std::vector<std::unique_ptr<OutputWriter>> writers;
+  bool hasStats = false;
+  for (const Output& output : outputs)
+  {
+    writers.emplace_back(new OutputWriter(output, format, dateFormat));
+    hasStats = hasStats || output.kind == OutputKind::stats;
+  }
+
+  // the statistics are collected once, for every stats output
+  StatisticsCollector collector(std::chrono::seconds{1});
+  StatisticsEntryStream countedInput(input, collector);
+  binlog::EntryStream& entryStream = (hasStats) ? static_cast<binlog::EntryStream&>(countedInput) : input;
+
+  binlog::EventStream eventStream;
+  while (const binlog::Event* event = eventStream.nextEvent(entryStream))
+  {
+    if (hasStats) { collector.addEvent(*event, eventStream); }
+
+    for (const std::unique_ptr<OutputWriter>& writer : writers)
+    {
+      writer->writeEvent(*event, eventStream);
+    }
+  }
+
+  const Statistics stats = collector.statistics(eventStream);
+  for (const std::unique_ptr<OutputWriter>& writer : writers)
+  {
+    writer->close(stats);
+  }
+}
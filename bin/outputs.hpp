@@ -0,0 +1,54 @@
+#ifndef BINLOG_BIN_OUTPUTS_HPP
+#define BINLOG_BIN_OUTPUTS_HPP
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace binlog {
+class EntryStream;
+} // namespace binlog
+
+/** What an output of writeOutputs gets */
+enum class OutputKind
+{
+  text,  // events formatted by PrettyPrinter, see printEvents
+  json,  // events as JSON lines, see writeJsonEvents
+  stats, // statistics of the events, see printStatistics
+};
+
+/** The output named by the command line, kind:path */
+struct OutputSpec
+{
+  OutputKind kind = OutputKind::text; // NOLINT
+  std::string path;                   // NOLINT
+};
+
+/** @returns true and sets `result` if `str` is kind:path, kind is one of text, json or stats */
+bool parseOutputSpec(const std::string& str, OutputSpec& result);
+
+/** An output stream of writeOutputs */
+struct Output
+{
+  OutputKind kind;     // NOLINT
+  std::ostream* out;   // NOLINT
+};
+
+/**
+ * Write the events of `input` to each of `outputs`, reading and decoding them once:
+ * each event is read by a single EventStream, and passed to the writer of each output.
+ * Text outputs use `format` and `dateFormat`, see PrettyPrinter.
+ * Stats outputs are written after the last event, counted per second, top 20 shown.
+ *
+ * The outputs are written by one thread each (see AsyncOutputStream),
+ * while the events are formatted on the calling thread.
+ *
+ * @throws std::runtime_error if invalid binlog entry found in `input`,
+ *         or the exception thrown by writing an output.
+ */
+void writeOutputs(
+  binlog::EntryStream& input, const std::vector<Output>& outputs,
+  const std::string& format, const std::string& dateFormat
+);
+
+#endif // BINLOG_BIN_OUTPUTS_HPP
@@ -1,53 +1,1416 @@
 #include "printers.hpp"
 
+#include "chunks.hpp"
+
+#include <binlog/BlockStream.hpp>
 #include <binlog/Entries.hpp> // Event
 #include <binlog/EntryStream.hpp>
 #include <binlog/EventStream.hpp>
 #include <binlog/PrettyPrinter.hpp>
+#include <binlog/Time.hpp>
+#include <binlog/TimeIndex.hpp>
+#include <binlog/detail/CompactEvents.hpp>
+#include <binlog/detail/ForEachEntry.hpp>
+#include <binlog/detail/OstreamBuffer.hpp>
+#include <binlog/detail/SegmentedMap.hpp>
+
+#include <mserialize/deserialize.hpp>
 
 #include <algorithm>
+#include <cassert>
+#include <condition_variable>
+#include <cstddef> // offsetof
 #include <cstdint>
+#include <cstdio>
+#include <cstring> // memcpy
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <functional> // greater
+#include <future>
 #include <istream>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <ostream>
+#include <queue>
 #include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
 #include <utility>
 #include <vector>
 
+namespace {
+
+/** (path, base) of the modules set by addAddressModule */
+std::vector<std::pair<std::string, std::uint64_t>>& addressModules()
+{
+  static std::vector<std::pair<std::string, std::uint64_t>> modules;
+  return modules;
+}
+
+/** Paths of the plugins set by addPrinterPlugin */
+std::vector<std::string>& printerPlugins()
+{
+  static std::vector<std::string> plugins;
+  return plugins;
+}
+
+/**
+ * Formats chunks of entries on a background thread.
+ *
+ * Chunks given to the same worker must be in stream order:
+ * the EventStream of the worker keeps the event sources
+ * of the previous chunks, only the new ones are sent.
+ */
+class PrintWorker
+{
+public:
+  PrintWorker(const std::string& format, const std::string& dateFormat)
+    :_pp(format, dateFormat),
+     _thread([this]() { run(); })
+  {}
+
+  ~PrintWorker()
+  {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _stop = true;
+    }
+    _cv.notify_one();
+    _thread.join();
+  }
+
+  PrintWorker(const PrintWorker&) = delete;
+  void operator=(const PrintWorker&) = delete;
+
+  struct Result
+  {
+    std::string text; // the events formatted before the error, if any
+    std::exception_ptr error;
+  };
+
+  /**
+   * @returns the formatted events of `chunk`, then of `mapped`,
+   * sequences of complete entries. `mapped` must remain valid until the result is ready.
+   */
+  std::future<Result> print(std::string chunk, binlog::Range mapped = binlog::Range())
+  {
+    std::promise<Result> promise;
+    std::future<Result> result = promise.get_future();
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _jobs.push_back(Job{std::move(chunk), mapped, std::move(promise)});
+    }
+    _cv.notify_one();
+    return result;
+  }
+
+  /** The number of event sources already sent to this worker */
+  std::size_t eventSourceCount = 0; // NOLINT
+
+private:
+  void run()
+  {
+    setupPrinter(_pp);
+    std::ostringstream output;
+
+    while (true)
+    {
+      Job job;
+      {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _cv.wait(lock, [this]() { return _stop || ! _jobs.empty(); });
+        if (_jobs.empty()) { return; } // stopped
+
+        job = std::move(_jobs.front());
+        _jobs.pop_front();
+      }
+
+      Result result;
+      output.str({});
+      try
+      {
+        binlog::detail::OstreamBuffer out(output); // flushed when leaving the scope
+        binlog::RangeEntryStream chunkStream(binlog::Range(job.chunk.data(), job.chunk.size()));
+        binlog::RangeEntryStream mappedStream(job.mapped);
+        for (binlog::EntryStream* entryStream : {&chunkStream, &mappedStream})
+        {
+          while (const binlog::Event* event = _eventStream.nextEvent(*entryStream))
+          {
+            _pp.printEvent(out, *event, _eventStream.writerProp(), _eventStream.clockSync());
+          }
+        }
+      }
+      catch (...)
+      {
+        result.error = std::current_exception();
+      }
+      result.text = output.str();
+      job.result.set_value(std::move(result));
+    }
+  }
+
+  struct Job
+  {
+    std::string chunk;
+    binlog::Range mapped;
+    std::promise<Result> result;
+  };
+
+  binlog::EventStream _eventStream;
+  binlog::PrettyPrinter _pp;
+
+  std::mutex _mutex; // guards the members below
+  std::condition_variable _cv;
+  std::deque<Job> _jobs;
+  bool _stop = false;
+
+  std::thread _thread; // last member, started after the others are initialized
+};
+
+/**
+ * Distinct pairs of writer properties and clock syncs,
+ * the context of the events to be sorted.
+ *
+ * The batch size of the writer properties is not stored,
+ * as it is not printed: otherwise it would make almost
+ * every writer property distinct.
+ */
+class ContextSet
+{
+public:
+  using Context = std::pair<binlog::WriterProp, binlog::ClockSync>;
+
+  /** @returns the index of the context made of `wp` and `cs` */
+  std::uint32_t add(const binlog::WriterProp& wp, const binlog::ClockSync& cs)
+  {
+    Key key(wp.id, wp.name, wp.context, cs.clockValue, cs.clockFrequency, cs.nsSinceEpoch, cs.tzOffset, cs.tzName);
+    const auto it = _indices.find(key);
+    if (it != _indices.end()) { return it->second; }
+
+    const std::uint32_t index = std::uint32_t(_contexts.size());
+    _contexts.emplace_back(binlog::WriterProp{wp.id, wp.name, 0, wp.context}, cs);
+    _indices.emplace(std::move(key), index);
+    return index;
+  }
+
+  const Context& get(std::uint32_t index) const { return _contexts[index]; }
+
+private:
+  using Key = std::tuple<
+    std::uint64_t, std::string, std::string,
+    std::uint64_t, std::uint64_t, std::uint64_t, std::int32_t, std::string
+  >;
+
+  std::vector<Context> _contexts;
+  std::map<Key, std::uint32_t> _indices;
+};
+
+/**
+ * A sequence of events sorted by clock, in memory or in a temporary file.
+ *
+ * Events are stored compactly: instead of the formatted text,
+ * only the clock, the source id, the index of the context and the
+ * serialized arguments are kept.
+ */
+class SortedRun
+{
+public:
+  struct Record
+  {
+    std::uint64_t clockValue;
+    std::uint64_t sourceId;
+    std::uint32_t context;
+    std::uint32_t argumentsSize;
+    std::size_t argumentsOffset; // in _arguments, unused if spilled
+  };
+
+  SortedRun() = default;
+
+  SortedRun(SortedRun&& rhs) noexcept
+    :_records(std::move(rhs._records)),
+     _arguments(std::move(rhs._arguments)),
+     _next(rhs._next),
+     _file(rhs._file)
+  {
+    rhs._file = nullptr;
+  }
+
+  SortedRun& operator=(SortedRun&& rhs) noexcept
+  {
+    SortedRun tmp(std::move(rhs));
+    std::swap(_records, tmp._records);
+    std::swap(_arguments, tmp._arguments);
+    std::swap(_next, tmp._next);
+    std::swap(_file, tmp._file);
+    return *this;
+  }
+
+  ~SortedRun()
+  {
+    if (_file != nullptr) { (void)std::fclose(_file); }
+  }
+
+  void add(std::uint64_t clockValue, std::uint64_t sourceId, std::uint32_t context, binlog::Range arguments)
+  {
+    const std::uint32_t size = std::uint32_t(arguments.size());
+    _records.push_back(Record{clockValue, sourceId, context, size, _arguments.size()});
+    const char* data = arguments.view(size);
+    _arguments.insert(_arguments.end(), data, data + size);
+  }
+
+  std::size_t memoryUsage() const
+  {
+    return _records.size() * sizeof(Record) + _arguments.size();
+  }
+
+  /** Sort the records by clock, keep the order of equal clocks */
+  void sort()
+  {
+    // events of a writer are mostly sorted already, which makes stable_sort cheap
+    std::stable_sort(_records.begin(), _records.end(), [](const Record& a, const Record& b)
+    {
+      return a.clockValue < b.clockValue;
+    });
+  }
+
+  /**
+   * Write the records to a temporary file, release the memory.
+   *
+   * @pre sort was called
+   * @returns the run in the temporary file
+   * @throws std::runtime_error if the file can not be written
+   */
+  SortedRun spill()
+  {
+    SortedRun result;
+    result._file = std::tmpfile();
+    if (result._file == nullptr)
+    {
+      throw std::runtime_error("Failed to create temporary file to sort events");
+    }
+
+    for (const Record& record : _records)
+    {
+      result.write(&record, offsetof(Record, argumentsOffset));
+      result.write(_arguments.data() + record.argumentsOffset, record.argumentsSize);
+    }
+
+    if (std::fflush(result._file) != 0 || std::fseek(result._file, 0, SEEK_SET) != 0)
+    {
+      throw std::runtime_error("Failed to write temporary file to sort events");
+    }
+
+    *this = SortedRun{};
+    return result;
+  }
+
+  /** Make the next record current. @returns false if there are no more records */
+  bool next()
+  {
+    if (_file == nullptr)
+    {
+      if (_next == _records.size()) { return false; }
+      _current = _records[_next++];
+      return true;
+    }
+
+    if (std::fread(&_current, offsetof(Record, argumentsOffset), 1, _file) != 1) { return false; }
+    _current.argumentsOffset = 0;
+    _arguments.resize(_current.argumentsSize);
+    if (_current.argumentsSize != 0 && std::fread(_arguments.data(), _current.argumentsSize, 1, _file) != 1)
+    {
+      throw std::runtime_error("Failed to read temporary file to sort events");
+    }
+    return true;
+  }
+
+  /** @pre next returned true */
+  const Record& current() const { return _current; }
+
+  /** @pre next returned true */
+  binlog::Range arguments() const
+  {
+    return binlog::Range(_arguments.data() + _current.argumentsOffset, _current.argumentsSize);
+  }
+
+private:
+  void write(const void* data, std::size_t size)
+  {
+    if (size != 0 && std::fwrite(data, size, 1, _file) != 1)
+    {
+      throw std::runtime_error("Failed to write temporary file to sort events");
+    }
+  }
+
+  std::vector<Record> _records; // not used if spilled
+  std::vector<char> _arguments; // arguments of _records, or of _current if spilled
+  std::size_t _next = 0; // index of the next record in _records
+  Record _current = {};
+  std::FILE* _file = nullptr; // the temporary file, if spilled
+};
+
+/**
+ * True if each event must be written to `output` as soon as it is printed,
+ * e.g: when following a file. Otherwise the text of consecutive events
+ * is collected in a buffer, and written in large chunks.
+ */
+bool unbuffered(const std::ostream& output)
+{
+  return (output.flags() & std::ios_base::unitbuf) != 0;
+}
+
+void printEventsInWindow(
+  binlog::EventStream& eventStream, binlog::EntryStream& entryStream,
+  binlog::PrettyPrinter& pp, std::ostream& output, TimeWindow window
+)
+{
+  binlog::detail::OstreamBuffer out(output);
+  const bool flushEachEvent = unbuffered(output);
+
+  while (const binlog::Event* event = eventStream.nextEvent(entryStream))
+  {
+    const binlog::ClockSync& clockSync = eventStream.clockSync();
+    if (clockSync.clockFrequency == 0)
+    {
+      throw std::runtime_error("No clock sync found before event, failed to compute its time");
+    }
+
+    const std::chrono::nanoseconds time = eventStream.clockConverter().toNsSinceEpoch(event->clockValue);
+    if (window.from <= time && time <= window.to)
+    {
+      pp.printEvent(out, *event, eventStream.writerProp(), clockSync);
+      if (flushEachEvent) { out.flush(); }
+    }
+  }
+}
+
+/** Deserialize the metadata entry referenced by `metadata` from the logfile at `data` */
+template <typename Entry>
+void readMetadata(const char* data, const binlog::TimeIndex::Metadata& metadata, Entry& entry)
+{
+  constexpr std::size_t headerSize = sizeof(std::uint32_t) + sizeof(std::uint64_t);
+  if (metadata.size < headerSize)
+  {
+    throw std::runtime_error("Time index does not match the logfile");
+  }
+
+  binlog::Range range(data + metadata.offset + headerSize, std::size_t(metadata.size - headerSize));
+  mserialize::deserialize(entry, range);
+}
+
+void appendEntry(std::string& out, const char* payload, std::uint32_t size)
+{
+  out.append(reinterpret_cast<const char*>(&size), sizeof(size));
+  out.append(payload, size);
+}
+
+} // namespace
+
 void printEvents(std::istream& input, std::ostream& output, const std::string& format, const std::string& dateFormat)
 {
   binlog::IstreamEntryStream entryStream(input);
+  printEvents(entryStream, output, format, dateFormat);
+}
+
+void printEvents(binlog::EntryStream& entryStream, std::ostream& output, const std::string& format, const std::string& dateFormat)
+{
   binlog::EventStream eventStream;
   binlog::PrettyPrinter pp(format, dateFormat);
+  setupPrinter(pp);
+  binlog::detail::OstreamBuffer out(output);
+  const bool flushEachEvent = unbuffered(output);
 
   while (const binlog::Event* event = eventStream.nextEvent(entryStream))
   {
-    pp.printEvent(output, *event, eventStream.writerProp(), eventStream.clockSync());
+    pp.printEvent(out, *event, eventStream.writerProp(), eventStream.clockSync());
+    if (flushEachEvent) { out.flush(); }
+  }
+}
+
+void printEvents(
+  binlog::EntryStream& entryStream, std::ostream& output,
+  const std::string& format, const std::string& dateFormat,
+  std::size_t threadCount
+)
+{
+  assert(threadCount > 0);
+
+  // a chunk is closed when it gets larger than this
+  constexpr std::size_t chunkSize = 1 << 20;
+  // at most this many chunks are formatted or waiting to be written
+  const std::size_t maxPendingChunks = 2 * threadCount;
+
+  std::vector<std::unique_ptr<PrintWorker>> workers;
+  for (std::size_t i = 0; i < threadCount; ++i)
+  {
+    workers.emplace_back(new PrintWorker(format, dateFormat));
+  }
+
+  std::vector<std::string> eventSources; // every event source (and interned string) entry seen so far
+  std::string writerProp; // the most recent writer prop entry
+  std::string clockSync; // the most recent clock sync entry
+
+  std::deque<std::future<PrintWorker::Result>> pending;
+  std::size_t nextWorker = 0;
+  std::string chunk;
+  bool chunkHasEntries = false;
+
+  const auto writeFirstPending = [&]()
+  {
+    const PrintWorker::Result result = pending.front().get();
+    pending.pop_front();
+    output.write(result.text.data(), std::streamsize(result.text.size()));
+    if (result.error) { std::rethrow_exception(result.error); }
+  };
+
+  const auto beginChunk = [&]()
+  {
+    // bring the worker up to date: the event sources it has not seen,
+    // and the context in effect at the beginning of the chunk
+    PrintWorker& worker = *workers[nextWorker];
+    for (std::size_t i = worker.eventSourceCount; i < eventSources.size(); ++i)
+    {
+      chunk += eventSources[i];
+    }
+    chunk += writerProp;
+    chunk += clockSync;
+  };
+
+  const auto sendChunk = [&]()
+  {
+    PrintWorker& worker = *workers[nextWorker];
+    nextWorker = (nextWorker + 1) % workers.size();
+
+    // the event sources of the chunk are seen by the worker as well
+    worker.eventSourceCount = eventSources.size();
+
+    if (pending.size() >= maxPendingChunks) { writeFirstPending(); }
+    pending.push_back(worker.print(std::move(chunk)));
+
+    chunk.clear();
+    chunkHasEntries = false;
+    beginChunk();
+  };
+
+  beginChunk();
+
+  std::exception_ptr readError;
+  while (true)
+  {
+    binlog::Range range;
+    try
+    {
+      range = entryStream.nextEntryPayload();
+    }
+    catch (...)
+    {
+      // print the events before the invalid entry first, as printEvents does
+      readError = std::current_exception();
+      break;
+    }
+    if (range.empty()) { break; }
+
+    const std::uint32_t size = std::uint32_t(range.size());
+    const char* payload = range.view(size);
+
+    appendEntry(chunk, payload, size);
+    chunkHasEntries = true;
+
+    std::uint64_t tag = 0;
+    if (size >= sizeof(tag)) { memcpy(&tag, payload, sizeof(tag)); }
+
+    switch (tag)
+    {
+    case binlog::EventSource::Tag:
+    case binlog::InternedString::Tag:
+      eventSources.emplace_back();
+      appendEntry(eventSources.back(), payload, size);
+      break;
+    case binlog::WriterProp::Tag:
+      writerProp.clear();
+      appendEntry(writerProp, payload, size);
+      break;
+    case binlog::ClockSync::Tag:
+      clockSync.clear();
+      appendEntry(clockSync, payload, size);
+      break;
+    }
+
+    if (chunk.size() >= chunkSize) { sendChunk(); }
+  }
+
+  if (chunkHasEntries) { sendChunk(); }
+  while (! pending.empty()) { writeFirstPending(); }
+
+  if (readError) { std::rethrow_exception(readError); }
+}
+
+void printEvents(
+  const char* data, std::size_t size, const std::vector<EntryChunk>& chunks,
+  std::ostream& output, const std::string& format, const std::string& dateFormat,
+  std::size_t threadCount
+)
+{
+  assert(threadCount > 0);
+  const std::size_t maxPendingChunks = 2 * threadCount;
+
+  std::vector<std::unique_ptr<PrintWorker>> workers;
+  for (std::size_t i = 0; i < threadCount; ++i)
+  {
+    workers.emplace_back(new PrintWorker(format, dateFormat));
+  }
+
+  // the metadata in effect at the beginning of the next chunk, by offset
+  std::vector<std::size_t> eventSources; // every event source (and interned string) entry seen so far
+  std::size_t writerProp = size;
+  std::size_t clockSync = size;
+  std::size_t clockCorrection = size;
+
+  const auto appendEntryAt = [&](std::string& out, std::size_t offset)
+  {
+    std::uint32_t entrySize = 0;
+    memcpy(&entrySize, data + offset, sizeof(entrySize));
+    out.append(data + offset, sizeof(entrySize) + entrySize);
+  };
+
+  std::deque<std::future<PrintWorker::Result>> pending;
+  const auto writeFirstPending = [&]()
+  {
+    const PrintWorker::Result result = pending.front().get();
+    pending.pop_front();
+    output.write(result.text.data(), std::streamsize(result.text.size()));
+    if (result.error) { std::rethrow_exception(result.error); }
+  };
+
+  std::size_t nextWorker = 0;
+  for (const EntryChunk& chunk : chunks)
+  {
+    // bring the worker up to date, the entries of the chunk are not copied
+    PrintWorker& worker = *workers[nextWorker];
+    nextWorker = (nextWorker + 1) % workers.size();
+
+    std::string replay;
+    for (std::size_t i = worker.eventSourceCount; i < eventSources.size(); ++i)
+    {
+      appendEntryAt(replay, eventSources[i]);
+    }
+    worker.eventSourceCount = eventSources.size();
+    for (const std::size_t offset : {clockCorrection, writerProp, clockSync})
+    {
+      if (offset != size) { appendEntryAt(replay, offset); }
+    }
+
+    // the invalid entry after an incomplete chunk is read by the worker, to report the same error as printEvents
+    const std::size_t end = (chunk.complete) ? chunk.end : size;
+    if (pending.size() >= maxPendingChunks) { writeFirstPending(); }
+    pending.push_back(worker.print(std::move(replay), binlog::Range(data + chunk.begin, end - chunk.begin)));
+
+    for (const std::size_t offset : chunk.metadata)
+    {
+      switch (entryTag(data, offset))
+      {
+      case binlog::EventSource::Tag:
+      case binlog::EventSourceTable::Tag:
+      case binlog::InternedString::Tag:
+        eventSources.push_back(offset);
+        break;
+      case binlog::WriterProp::Tag:
+        writerProp = offset;
+        break;
+      case binlog::ClockSync::Tag:
+        clockSync = offset;
+        break;
+      case binlog::ClockCorrection::Tag:
+        clockCorrection = offset;
+        break;
+      }
+    }
   }
+
+  while (! pending.empty()) { writeFirstPending(); }
+}
+
+void printEvents(
+  binlog::EntryStream& entryStream, std::ostream& output,
+  const std::string& format, const std::string& dateFormat,
+  TimeWindow window
+)
+{
+  binlog::EventStream eventStream;
+  binlog::PrettyPrinter pp(format, dateFormat);
+  setupPrinter(pp);
+  printEventsInWindow(eventStream, entryStream, pp, output, window);
+}
+
+void printEvents(
+  const char* data, std::size_t size, const binlog::TimeIndex& index,
+  std::ostream& output, const std::string& format, const std::string& dateFormat,
+  TimeWindow window
+)
+{
+  const auto checkBounds = [size](std::uint64_t offset, std::uint64_t entrySize)
+  {
+    if (offset > size || entrySize > size - offset)
+    {
+      throw std::runtime_error("Time index does not match the logfile");
+    }
+  };
+
+  // find the blocks which might have events in the window
+  std::uint64_t begin = 0; // first byte to read
+  bool foundBlock = false;
+  std::uint64_t end = 0;   // last byte to read, exclusive
+  std::uint64_t indexedEnd = 0;
+
+  binlog::ClockSync clockSync;
+  auto metadata = index.metadata.begin();
+  for (const binlog::TimeIndex::Block& block : index.blocks)
+  {
+    checkBounds(block.offset, block.size);
+    if (block.offset != indexedEnd)
+    {
+      throw std::runtime_error("Time index does not match the logfile");
+    }
+    indexedEnd = block.offset + block.size;
+
+    // find the clock sync in effect at the end of the block
+    for (; metadata != index.metadata.end() && metadata->offset < indexedEnd; ++metadata)
+    {
+      if (metadata->tag == binlog::ClockSync::Tag)
+      {
+        checkBounds(metadata->offset, metadata->size);
+        readMetadata(data, *metadata, clockSync);
+      }
+    }
+
+    if (block.minClock > block.maxClock) { continue; } // no events in the block
+
+    // without clock sync, the block can not be ruled out
+    const bool inWindow = clockSync.clockFrequency == 0 || (
+      binlog::clockToNsSinceEpoch(clockSync, block.minClock) <= window.to &&
+      binlog::clockToNsSinceEpoch(clockSync, block.maxClock) >= window.from
+    );
+
+    if (inWindow)
+    {
+      if (! foundBlock) { begin = block.offset; }
+      foundBlock = true;
+      end = indexedEnd;
+    }
+  }
+
+  // entries after the indexed blocks are always read
+  if (indexedEnd < size)
+  {
+    if (! foundBlock) { begin = indexedEnd; }
+    end = size;
+  }
+  else if (! foundBlock)
+  {
+    return;
+  }
+
+  // replay the metadata in effect at the beginning of the first block read
+  std::string replay;
+  const binlog::TimeIndex::Metadata* writerProp = nullptr;
+  const binlog::TimeIndex::Metadata* lastClockSync = nullptr;
+  for (const binlog::TimeIndex::Metadata& entry : index.metadata)
+  {
+    if (entry.offset >= begin) { break; }
+    checkBounds(entry.offset, entry.size);
+
+    switch (entry.tag)
+    {
+    case binlog::EventSource::Tag:
+    case binlog::EventSourceTable::Tag:
+    case binlog::InternedString::Tag:
+      replay.append(data + entry.offset, entry.size);
+      break;
+    case binlog::WriterProp::Tag:
+      writerProp = &entry;
+      break;
+    case binlog::ClockSync::Tag:
+      lastClockSync = &entry;
+      break;
+    }
+  }
+  if (writerProp != nullptr) { replay.append(data + writerProp->offset, writerProp->size); }
+  if (lastClockSync != nullptr) { replay.append(data + lastClockSync->offset, lastClockSync->size); }
+
+  binlog::EventStream eventStream;
+  binlog::RangeEntryStream replayStream(binlog::Range(replay.data(), replay.size()));
+  if (eventStream.nextEvent(replayStream) != nullptr)
+  {
+    throw std::runtime_error("Time index does not match the logfile");
+  }
+
+  binlog::PrettyPrinter pp(format, dateFormat);
+  setupPrinter(pp);
+  binlog::RangeEntryStream entryStream(binlog::Range(data + begin, std::size_t(end - begin)));
+  printEventsInWindow(eventStream, entryStream, pp, output, window);
+}
+
+namespace {
+
+/** Forwards the metadata entries of an underlying stream, drops the events */
+class MetadataEntryStream : public binlog::EntryStream
+{
+public:
+  explicit MetadataEntryStream(binlog::EntryStream& input)
+    :_input(input)
+  {}
+
+  binlog::Range nextEntryPayload() override
+  {
+    while (true)
+    {
+      const binlog::Range payload = _input.nextEntryPayload();
+      if (payload.size() < sizeof(std::uint64_t)) { return payload; } // end of input, or let EventStream report the error
+
+      binlog::Range entry = payload;
+      const std::uint64_t tag = entry.read<std::uint64_t>();
+      if (binlog::detail::isSpecialEntryTag(tag) && tag != binlog::CompactEvents::Tag) { return payload; }
+    }
+  }
+
+private:
+  binlog::EntryStream& _input;
+};
+
+/** @returns the first ClockSync of the block framed logfile, or a ClockSync of zero frequency, if there is none before the first event */
+binlog::ClockSync firstClockSync(const char* data, std::size_t size)
+{
+  binlog::BlockEntryStream entryStream(binlog::Range(data, size));
+  while (true)
+  {
+    binlog::Range entry = entryStream.nextEntryPayload();
+    if (entry.size() < sizeof(std::uint64_t)) { break; }
+
+    const std::uint64_t tag = entry.read<std::uint64_t>();
+    if (tag == binlog::ClockSync::Tag)
+    {
+      binlog::ClockSync clockSync;
+      mserialize::deserialize(clockSync, entry);
+      return clockSync;
+    }
+    if (! binlog::detail::isSpecialEntryTag(tag) || tag == binlog::CompactEvents::Tag) { break; }
+  }
+  return binlog::ClockSync{};
+}
+
+/**
+ * @returns the beginning of the first block in [begin, end)
+ *          with events, that is not `isBefore` the searched position,
+ *          or `end`, if there is no such block.
+ *
+ * `begin` must be at a block boundary.
+ * Assuming the blocks are ordered by time, a block `isBefore` the
+ * searched position if every following block with events is too.
+ */
+template <typename IsBefore>
+std::size_t bisectBlocks(const char* data, std::size_t begin, std::size_t end, IsBefore isBefore)
+{
+  std::size_t lo = begin; // blocks before lo are before the searched position, lo is a block boundary
+  std::size_t hi = end;   // the first block with events at or after hi is not
+  while (lo < hi)
+  {
+    const std::size_t mid = lo + (hi - lo) / 2;
+
+    // the first block with events at or after mid, the clocks of blocks without events are 0
+    std::size_t pos = binlog::findBlock(data, end, mid);
+    binlog::BlockHeader header;
+    while (pos < hi && binlog::readBlockHeader(binlog::Range(data + pos, end - pos), header)
+           && header.firstClock == 0 && header.lastClock == 0)
+    {
+      pos = binlog::findBlock(data, end, pos + binlog::blockHeaderSize + header.size);
+    }
+
+    if (pos < hi && isBefore(header))
+    {
+      lo = pos + binlog::blockHeaderSize + header.size;
+    }
+    else
+    {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+} // namespace
+
+std::size_t printBlockEvents(
+  const char* data, std::size_t size,
+  std::ostream& output, const std::string& format, const std::string& dateFormat,
+  TimeWindow window
+)
+{
+  std::size_t begin = binlog::findBlock(data, size, 0);
+  std::size_t end = size;
+
+  const binlog::ClockSync clockSync = firstClockSync(data, size);
+  if (clockSync.clockFrequency != 0)
+  {
+    begin = bisectBlocks(data, begin, size, [&](const binlog::BlockHeader& header)
+    {
+      return binlog::clockToNsSinceEpoch(clockSync, header.lastClock) < window.from;
+    });
+    end = bisectBlocks(data, begin, size, [&](const binlog::BlockHeader& header)
+    {
+      return binlog::clockToNsSinceEpoch(clockSync, header.firstClock) <= window.to;
+    });
+  }
+
+  // load the metadata before the first block read
+  binlog::EventStream eventStream;
+  binlog::BlockEntryStream prefix(binlog::Range(data, begin));
+  MetadataEntryStream metadata(prefix);
+  eventStream.loadMetadata(metadata);
+
+  binlog::PrettyPrinter pp(format, dateFormat);
+  setupPrinter(pp);
+  binlog::BlockEntryStream entryStream(binlog::Range(data + begin, end - begin));
+  printEventsInWindow(eventStream, entryStream, pp, output, window);
+
+  return prefix.skippedBytes() + entryStream.skippedBytes();
 }
 
 void printSortedEvents(std::istream& input, std::ostream& output, const std::string& format, const std::string& dateFormat)
 {
   binlog::IstreamEntryStream entryStream(input);
+  printSortedEvents(entryStream, output, format, dateFormat);
+}
+
+void printSortedEvents(binlog::EntryStream& entryStream, std::ostream& output, const std::string& format, const std::string& dateFormat)
+{
+  // lots of events fit into this, but it is still well below the memory of a typical box
+  constexpr std::size_t defaultMemoryLimit = std::size_t{1} << 30;
+  printSortedEvents(entryStream, output, format, dateFormat, defaultMemoryLimit);
+}
+
+void printSortedEvents(
+  binlog::EntryStream& entryStream, std::ostream& output,
+  const std::string& format, const std::string& dateFormat,
+  std::size_t memoryLimit
+)
+{
+  binlog::detail::SegmentedMap<binlog::EventSource> eventSources;
+  binlog::detail::SegmentedMap<std::string> internedStrings;
+  ContextSet contexts;
+  binlog::WriterProp writerProp;
+  binlog::ClockSync clockSync;
+  std::uint32_t context = contexts.add(writerProp, clockSync);
+
+  std::vector<std::unique_ptr<SortedRun>> spilledRuns;
+  SortedRun run;
+
+  const auto addEvent = [&](std::uint64_t sourceId, std::uint64_t clockValue, binlog::Range arguments)
+  {
+    if (eventSources.find(sourceId) == eventSources.end())
+    {
+      throw std::runtime_error("Event has invalid source id: " + std::to_string(sourceId));
+    }
+
+    run.add(clockValue, sourceId, context, arguments);
+
+    if (run.memoryUsage() >= memoryLimit)
+    {
+      run.sort();
+      spilledRuns.emplace_back(new SortedRun(run.spill()));
+    }
+  };
+
+  // buffer every event, spill sorted runs to temporary files if memory runs out
+  while (true)
+  {
+    binlog::Range range = entryStream.nextEntryPayload();
+    if (range.empty()) { break; }
+
+    const std::uint64_t tag = range.read<std::uint64_t>();
+    switch (tag)
+    {
+    case binlog::EventSource::Tag:
+    {
+      binlog::EventSource eventSource;
+      mserialize::deserialize(eventSource, range);
+      eventSources.emplace(eventSource.id, std::move(eventSource));
+      break;
+    }
+    case binlog::InternedString::Tag:
+    {
+      binlog::InternedString internedString;
+      mserialize::deserialize(internedString, range);
+      internedStrings.emplace(internedString.id, std::move(internedString.value));
+      break;
+    }
+    case binlog::WriterProp::Tag:
+      mserialize::deserialize(writerProp, range);
+      context = contexts.add(writerProp, clockSync);
+      break;
+    case binlog::ClockSync::Tag:
+      mserialize::deserialize(clockSync, range);
+      context = contexts.add(writerProp, clockSync);
+      break;
+    case binlog::CompactEvents::Tag:
+    {
+      const std::uint8_t version = range.read<std::uint8_t>();
+      if (! binlog::detail::isSupportedCompactVersion(version))
+      {
+        throw std::runtime_error("Unsupported CompactEvents version");
+      }
+      binlog::detail::CompactDecoder decoder(version);
+      while (! range.empty())
+      {
+        const binlog::detail::CompactEvent ce = binlog::detail::nextCompactEvent(range, decoder);
+        addEvent(ce.sourceId, ce.clockValue, ce.arguments);
+      }
+      break;
+    }
+    default:
+      if ((tag & (std::uint64_t(1) << 63)) != 0) { break; } // ignore unknown special entries
+
+      const std::uint64_t clockValue = range.read<std::uint64_t>();
+      addEvent(tag, clockValue, range);
+    }
+  }
+
+  run.sort();
+
+  // merge the sorted runs, on equal clocks, the earlier run comes first,
+  // to keep the order of the events of the input
+  std::vector<SortedRun*> runs;
+  for (const std::unique_ptr<SortedRun>& spilledRun : spilledRuns) { runs.push_back(spilledRun.get()); }
+  runs.push_back(&run);
+
+  using HeapItem = std::pair<std::uint64_t /* clock */, std::size_t /* run index */>;
+  std::priority_queue<HeapItem, std::vector<HeapItem>, std::greater<HeapItem>> heap;
+  for (std::size_t i = 0; i < runs.size(); ++i)
+  {
+    if (runs[i]->next()) { heap.emplace(runs[i]->current().clockValue, i); }
+  }
+
+  binlog::PrettyPrinter pp(format, dateFormat);
+  setupPrinter(pp);
+  binlog::detail::OstreamBuffer out(output);
+  binlog::Event event;
+  event.internedStrings = &internedStrings;
+
+  while (! heap.empty())
+  {
+    const std::size_t i = heap.top().second;
+    heap.pop();
+
+    SortedRun& top = *runs[i];
+    const SortedRun::Record& record = top.current();
+    const ContextSet::Context& ctx = contexts.get(record.context);
+
+    event.source = eventSources.find(record.sourceId);
+    event.clockValue = record.clockValue;
+    event.arguments = top.arguments();
+    pp.printEvent(out, event, ctx.first, ctx.second);
+
+    if (top.next()) { heap.emplace(top.current().clockValue, i); }
+  }
+}
+
+namespace {
+
+/** An event buffered by printStreamSortedEvents */
+struct BufferedEvent
+{
+  std::uint64_t clockValue;
+  std::uint64_t sequence; // in the input, orders events of equal clock
+  std::uint64_t sourceId;
+  std::uint32_t context;
+  std::string arguments;
+};
+
+/** The buffered events of a writer, sorted by clock */
+struct WriterRun
+{
+  std::deque<BufferedEvent> events;
+};
+
+} // namespace
+
+void printStreamSortedEvents(
+  binlog::EntryStream& entryStream, std::ostream& output,
+  const std::string& format, const std::string& dateFormat,
+  ReorderWindow window, bool follow
+)
+{
+  binlog::detail::SegmentedMap<binlog::EventSource> eventSources;
+  binlog::detail::SegmentedMap<std::string> internedStrings;
+  ContextSet contexts;
+  binlog::WriterProp writerProp;
+  binlog::ClockSync clockSync;
+  std::uint32_t context = contexts.add(writerProp, clockSync);
+
+  // the runs of the writers, by writer id and name: writers without id are told apart by name
+  std::deque<WriterRun> runs;
+  std::map<std::pair<std::uint64_t, std::string>, std::size_t> runIndices;
+  const auto runIndex = [&]()
+  {
+    const auto it = runIndices.emplace(std::make_pair(writerProp.id, writerProp.name), runs.size()).first;
+    if (it->second == runs.size()) { runs.emplace_back(); }
+    return it->second;
+  };
+  std::size_t currentRun = runIndex();
+
+  // the first event of each run, by clock, sequence and run index.
+  // An item is stale if the run has a different first event: it was printed,
+  // or an earlier event of the writer was inserted before it.
+  using HeapItem = std::tuple<std::uint64_t, std::uint64_t, std::uint64_t>;
+  std::priority_queue<HeapItem, std::vector<HeapItem>, std::greater<HeapItem>> heap;
+
+  std::uint64_t sequence = 0;
+  std::size_t bufferedCount = 0;
+  std::uint64_t latestClock = 0;
+
+  binlog::PrettyPrinter pp(format, dateFormat);
+  setupPrinter(pp);
+  binlog::detail::OstreamBuffer out(output);
+  const bool flushEachEvent = unbuffered(output);
+  binlog::Event event;
+  event.internedStrings = &internedStrings;
+
+  const auto addEvent = [&](std::uint64_t sourceId, std::uint64_t clockValue, binlog::Range arguments)
+  {
+    if (eventSources.find(sourceId) == eventSources.end())
+    {
+      throw std::runtime_error("Event has invalid source id: " + std::to_string(sourceId));
+    }
+
+    const std::size_t size = arguments.size();
+    BufferedEvent buffered{clockValue, sequence++, sourceId, context, std::string(arguments.view(size), size)};
+
+    WriterRun& run = runs[currentRun];
+    if (run.events.empty() || run.events.back().clockValue <= clockValue)
+    {
+      run.events.push_back(std::move(buffered));
+    }
+    else
+    {
+      // the writer went back in time: keep the run sorted
+      const auto pos = std::upper_bound(run.events.begin(), run.events.end(), clockValue,
+        [](std::uint64_t clock, const BufferedEvent& e) { return clock < e.clockValue; }
+      );
+      run.events.insert(pos, std::move(buffered));
+    }
+
+    const BufferedEvent& first = run.events.front();
+    if (first.sequence == sequence - 1) { heap.emplace(first.clockValue, first.sequence, currentRun); }
+
+    ++bufferedCount;
+    latestClock = (std::max)(latestClock, clockValue);
+  };
+
+  // @returns the run of the earliest buffered event, or nullptr, if no event is buffered
+  const auto earliestRun = [&]() -> WriterRun*
+  {
+    while (! heap.empty())
+    {
+      const HeapItem& top = heap.top();
+      WriterRun& run = runs[std::size_t(std::get<2>(top))];
+      if (! run.events.empty() && run.events.front().sequence == std::get<1>(top)) { return &run; }
+      heap.pop();
+    }
+    return nullptr;
+  };
+
+  // @pre run is the result of earliestRun
+  const auto printEarliest = [&](WriterRun& run)
+  {
+    const std::size_t index = std::size_t(std::get<2>(heap.top()));
+    heap.pop();
+
+    const BufferedEvent& buffered = run.events.front();
+    const ContextSet::Context& ctx = contexts.get(buffered.context);
+    event.source = eventSources.find(buffered.sourceId);
+    event.clockValue = buffered.clockValue;
+    event.arguments = binlog::Range(buffered.arguments.data(), buffered.arguments.size());
+    pp.printEvent(out, event, ctx.first, ctx.second);
+
+    run.events.pop_front();
+    --bufferedCount;
+    if (! run.events.empty())
+    {
+      const BufferedEvent& next = run.events.front();
+      heap.emplace(next.clockValue, next.sequence, index);
+    }
+  };
+
+  const auto printReady = [&]()
+  {
+    // the window in clock ticks, clocks without frequency are taken as nanoseconds
+    const std::uint64_t windowTicks = (clockSync.clockFrequency == 0)
+      ? std::uint64_t(window.time.count())
+      : std::uint64_t(double(window.time.count()) * double(clockSync.clockFrequency) / 1e9);
+
+    while (WriterRun* run = earliestRun())
+    {
+      const std::uint64_t clock = run->events.front().clockValue;
+      const bool outOfWindow = (window.eventCount != 0 && bufferedCount > window.eventCount)
+        || (window.time.count() > 0 && latestClock - clock > windowTicks);
+
+      // any writer, even one not seen yet, might write an earlier event
+      if (! outOfWindow) { break; }
+
+      printEarliest(*run);
+    }
+  };
+
+  while (true)
+  {
+    binlog::Range range = entryStream.nextEntryPayload();
+    if (range.empty())
+    {
+      // the input ended, or it is idle: the writers are not waited for
+      while (WriterRun* run = earliestRun()) { printEarliest(*run); }
+      out.flush();
+      if (follow) { continue; }
+      break;
+    }
+
+    const std::uint64_t tag = range.read<std::uint64_t>();
+    switch (tag)
+    {
+    case binlog::EventSource::Tag:
+    {
+      binlog::EventSource eventSource;
+      mserialize::deserialize(eventSource, range);
+      eventSources.emplace(eventSource.id, std::move(eventSource));
+      break;
+    }
+    case binlog::InternedString::Tag:
+    {
+      binlog::InternedString internedString;
+      mserialize::deserialize(internedString, range);
+      internedStrings.emplace(internedString.id, std::move(internedString.value));
+      break;
+    }
+    case binlog::WriterProp::Tag:
+      mserialize::deserialize(writerProp, range);
+      currentRun = runIndex();
+      context = contexts.add(writerProp, clockSync);
+      break;
+    case binlog::ClockSync::Tag:
+      mserialize::deserialize(clockSync, range);
+      context = contexts.add(writerProp, clockSync);
+      break;
+    case binlog::CompactEvents::Tag:
+    {
+      const std::uint8_t version = range.read<std::uint8_t>();
+      if (! binlog::detail::isSupportedCompactVersion(version))
+      {
+        throw std::runtime_error("Unsupported CompactEvents version");
+      }
+      binlog::detail::CompactDecoder decoder(version);
+      while (! range.empty())
+      {
+        const binlog::detail::CompactEvent ce = binlog::detail::nextCompactEvent(range, decoder);
+        addEvent(ce.sourceId, ce.clockValue, ce.arguments);
+      }
+      printReady();
+      break;
+    }
+    default:
+      if ((tag & (std::uint64_t(1) << 63)) != 0) { break; } // ignore unknown special entries
+
+      const std::uint64_t clockValue = range.read<std::uint64_t>();
+      addEvent(tag, clockValue, range);
+      printReady();
+    }
+
+    if (flushEachEvent) { out.flush(); }
+  }
+}
+
+namespace {
+
+/** A file of printSplitEvents, written through its own buffer */
+class SplitOutput
+{
+public:
+  SplitOutput(const std::string& path, std::size_t bufferSize)
+    :_buffer(bufferSize)
+  {
+    // the buffer must be set before opening the file
+    if (! _buffer.empty()) { _file.rdbuf()->pubsetbuf(_buffer.data(), std::streamsize(_buffer.size())); }
+    _file.open(path, std::ios_base::out | std::ios_base::binary);
+    if (! _file)
+    {
+      throw std::runtime_error("Failed to open '" + path + "' for writing");
+    }
+    _out.reset(new binlog::detail::OstreamBuffer(_file));
+  }
+
+  binlog::detail::OstreamBuffer& out() { return *_out; }
+
+private:
+  std::vector<char> _buffer; // outlives _file
+  std::ofstream _file;
+  std::unique_ptr<binlog::detail::OstreamBuffer> _out; // flushed before _file is closed
+};
+
+/** @returns `value`, with characters not allowed in file names replaced by '_' */
+std::string toFileName(std::string value)
+{
+  for (char& c : value)
+  {
+    const bool allowed = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')
+      || c == '-' || c == '_' || c == '.';
+    if (! allowed) { c = '_'; }
+  }
+  if (value.empty() || value == "." || value == "..") { value.insert(0, "_"); }
+  return value;
+}
+
+std::string splitKey(SplitBy splitBy, const binlog::Event& event, const binlog::WriterProp& writerProp)
+{
+  switch (splitBy)
+  {
+    case SplitBy::writer:   return std::to_string(writerProp.id) + "_" + writerProp.name;
+    case SplitBy::category: return event.source->category;
+    case SplitBy::severity: break;
+  }
+
+  const auto severity = binlog::severityToString(event.source->severity);
+  return std::string(severity.data(), severity.size());
+}
+
+} // namespace
+
+std::size_t printSplitEvents(
+  binlog::EntryStream& input, const std::string& outputDirectory, SplitBy splitBy,
+  const std::string& format, const std::string& dateFormat,
+  std::size_t bufferSize
+)
+{
   binlog::EventStream eventStream;
   binlog::PrettyPrinter pp(format, dateFormat);
+  setupPrinter(pp);
 
-  using Pair = std::pair<std::uint64_t /* clock */, std::string /* pretty printed event */>;
-  std::vector<Pair> buffer;
-  std::ostringstream stream;
+  // distinct values with the same file name share the file
+  std::map<std::string, std::unique_ptr<SplitOutput>> outputs;
 
-  // buffer every event in input
-  while (const binlog::Event* event = eventStream.nextEvent(entryStream))
+  // consecutive events often go to the same file: skip the lookup then
+  // (sources and writers can be redefined, compare the values, not the pointers)
+  binlog::EventSource lastSource;
+  binlog::WriterProp lastWriter;
+  SplitOutput* lastOutput = nullptr;
+
+  while (const binlog::Event* event = eventStream.nextEvent(input))
+  {
+    const binlog::WriterProp& writerProp = eventStream.writerProp();
+    const bool same = lastOutput != nullptr && (
+      (splitBy == SplitBy::writer) ? writerProp.id == lastWriter.id && writerProp.name == lastWriter.name
+      : (splitBy == SplitBy::category) ? event->source->category == lastSource.category
+      : event->source->severity == lastSource.severity
+    );
+
+    if (! same)
+    {
+      const std::string fileName = toFileName(splitKey(splitBy, *event, writerProp));
+      std::unique_ptr<SplitOutput>& output = outputs[fileName];
+      if (! output)
+      {
+        output.reset(new SplitOutput(outputDirectory + "/" + fileName + ".txt", bufferSize));
+      }
+
+      lastSource.severity = event->source->severity;
+      lastSource.category = event->source->category;
+      lastWriter.id = writerProp.id;
+      lastWriter.name = writerProp.name;
+      lastOutput = output.get();
+    }
+
+    pp.printEvent(lastOutput->out(), *event, writerProp, eventStream.clockSync());
+  }
+
+  return outputs.size();
+}
+
+bool parseTime(const char* str, std::chrono::nanoseconds& result)
+{
+  const auto number = [&str](int digits, std::int64_t& out)
+  {
+    out = 0;
+    for (int i = 0; i < digits; ++i, ++str)
+    {
+      if (*str < '0' || *str > '9') { return false; }
+      out = out * 10 + (*str - '0');
+    }
+    return true;
+  };
+  const auto separator = [&str](char c1, char c2)
+  {
+    if (*str != c1 && *str != c2) { return false; }
+    ++str;
+    return true;
+  };
+
+  std::int64_t y, m, d, hh, mm, ss;
+  if (! (number(4, y) && separator('-', '-') && number(2, m) && separator('-', '-') && number(2, d)
+      && separator('T', ' ') && number(2, hh) && separator(':', ':') && number(2, mm)
+      && separator(':', ':') && number(2, ss)))
   {
-    stream.str({}); // reset stream
-    pp.printEvent(stream, *event, eventStream.writerProp(), eventStream.clockSync());
-    buffer.emplace_back(event->clockValue, stream.str());
+    return false;
   }
 
-  // sort and print the the buffer
-  const auto cmpClock = [](const Pair& p1, const Pair& p2) { return p1.first < p2.first; };
-  std::stable_sort(buffer.begin(), buffer.end(), cmpClock);
-  for (const Pair& p : buffer)
+  if (m < 1 || m > 12 || d < 1 || d > 31 || hh > 23 || mm > 59 || ss > 60) { return false; }
+
+  std::int64_t ns = 0;
+  if (*str == '.')
+  {
+    ++str;
+    std::int64_t scale = 100000000;
+    for (; *str >= '0' && *str <= '9'; ++str, scale /= 10)
+    {
+      ns += (*str - '0') * scale;
+    }
+  }
+  if (*str != '\0') { return false; }
+
+  // days since epoch of the civil date, see: http://howardhinnant.github.io/date_algorithms.html
+  y -= (m <= 2) ? 1 : 0;
+  const std::int64_t era = (y >= 0 ? y : y - 399) / 400;
+  const std::int64_t yoe = y - era * 400;
+  const std::int64_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  const std::int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  const std::int64_t days = era * 146097 + doe - 719468;
+
+  const std::int64_t seconds = ((days * 24 + hh) * 60 + mm) * 60 + ss;
+  result = std::chrono::nanoseconds(seconds * 1000000000 + ns);
+  return true;
+}
+
+void addAddressModule(std::string path, std::uint64_t base)
+{
+  addressModules().emplace_back(std::move(path), base);
+}
+
+void addPrinterPlugin(std::string path)
+{
+  // fail early, not when the first printer is created
+  binlog::PrettyPrinter pp("", "");
+  pp.loadPrinterPlugin(path);
+
+  printerPlugins().push_back(std::move(path));
+}
+
+void setupPrinter(binlog::PrettyPrinter& pp)
+{
+  for (const auto& module : addressModules())
+  {
+    pp.addAddressModule(module.first, module.second);
+  }
+  for (const std::string& plugin : printerPlugins())
   {
-    output << p.second;
+    pp.loadPrinterPlugin(plugin);
   }
 }
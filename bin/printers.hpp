@@ -1,8 +1,56 @@
 #ifndef BINLOG_BIN_PRINTERS_HPP
 #define BINLOG_BIN_PRINTERS_HPP
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <iosfwd>
 #include <string>
+#include <vector>
+
+struct EntryChunk;
+
+namespace binlog {
+class EntryStream;
+class PrettyPrinter;
+class TimeIndex;
+} // namespace binlog
+
+/** Time points of [from, to], inclusive, in nanoseconds since the UNIX epoch */
+struct TimeWindow
+{
+  std::chrono::nanoseconds from; // NOLINT
+  std::chrono::nanoseconds to;   // NOLINT
+};
+
+/**
+ * Parse a UTC timestamp of the form: YYYY-MM-DDTHH:MM:SS[.fraction]
+ *
+ * @returns true and sets `result` to nanoseconds since the UNIX epoch,
+ *          if `str` is such a timestamp.
+ */
+bool parseTime(const char* str, std::chrono::nanoseconds& result);
+
+/**
+ * Show the function pointed by binlog::address arguments
+ * printed by the functions below (and by the printers created after this call),
+ * if they point into the module at `path`, loaded at `base`.
+ *
+ * @see binlog::PrettyPrinter::addAddressModule
+ */
+void addAddressModule(std::string path, std::uint64_t base);
+
+/**
+ * Load the printer plugin at `path` into the printers
+ * created by the functions below (and by the printers created after this call).
+ *
+ * @see binlog::PrettyPrinter::loadPrinterPlugin
+ * @throws std::runtime_error if the plugin can not be loaded
+ */
+void addPrinterPlugin(std::string path);
+
+/** Add the modules set by addAddressModule and the plugins set by addPrinterPlugin to `pp` */
+void setupPrinter(binlog::PrettyPrinter& pp);
 
 /**
  * Print the events in `input` to output, according to
@@ -13,15 +61,193 @@
  */
 void printEvents(std::istream& input, std::ostream& output, const std::string& format, const std::string& dateFormat);
 
+/** Same as above, but read entries from `input` */
+void printEvents(binlog::EntryStream& input, std::ostream& output, const std::string& format, const std::string& dateFormat);
+
+/**
+ * Same as above, but format the events on `threadCount` threads.
+ *
+ * Entries are read sequentially, and split to chunks.
+ * The chunks are formatted concurrently, each chunk
+ * preceded by the metadata (event sources, writer properties
+ * and clock sync) in effect at its beginning.
+ * The formatted chunks are written to `output` in the original order,
+ * the output is the same as of the single threaded printEvents.
+ *
+ * @pre threadCount > 0
+ */
+void printEvents(
+  binlog::EntryStream& input, std::ostream& output,
+  const std::string& format, const std::string& dateFormat,
+  std::size_t threadCount
+);
+
+/**
+ * Same as above, but read the events of the flat (not block framed) logfile
+ * in [data, data+size), split to `chunks` by splitEntries.
+ *
+ * The chunks are not read sequentially and copied, but passed to the threads directly,
+ * each preceded by the metadata (event sources, writer properties, clock sync
+ * and clock correction) in effect at its beginning, as found by splitEntries.
+ * The output is the same as of the single threaded printEvents.
+ * DictionaryReference entries are not resolved.
+ *
+ * @pre threadCount > 0
+ */
+void printEvents(
+  const char* data, std::size_t size, const std::vector<EntryChunk>& chunks,
+  std::ostream& output, const std::string& format, const std::string& dateFormat,
+  std::size_t threadCount
+);
+
+/**
+ * Same as above, but print only the events in `window`.
+ *
+ * The time of the events is calculated using the clock sync
+ * in effect at the event.
+ *
+ * @throws std::runtime_error if there's no clock sync before an event
+ */
+void printEvents(
+  binlog::EntryStream& input, std::ostream& output,
+  const std::string& format, const std::string& dateFormat,
+  TimeWindow window
+);
+
+/**
+ * Same as above, but read the events from the logfile
+ * in [data, data+size), using `index` to skip the
+ * blocks of the logfile which are known to have no events in `window`.
+ *
+ * The metadata entries (event sources, writer properties and clock sync)
+ * before the first block read are replayed from the logfile, using `index`.
+ * Entries after the last block of the index are always read.
+ *
+ * @throws std::runtime_error if `index` does not match the logfile
+ */
+void printEvents(
+  const char* data, std::size_t size, const binlog::TimeIndex& index,
+  std::ostream& output, const std::string& format, const std::string& dateFormat,
+  TimeWindow window
+);
+
+/**
+ * Same as above, but read the events from the block framed logfile
+ * in [data, data+size) (see binlog::BlockOutputStream),
+ * using binary search on the clock range of the blocks to find
+ * the first block that might have events in `window`, and the block
+ * after the last one. The blocks are assumed to be ordered by time,
+ * which holds for logfiles written by a single consumer,
+ * up to the events of concurrent writers consumed in the same batch.
+ *
+ * The times of the blocks are computed using the first clock sync of the logfile.
+ * The metadata before the first block read is loaded by reading
+ * the preceding blocks, skipping the events without looking at them.
+ *
+ * @returns the number of bytes skipped, because they are not part of a valid block
+ * @throws std::runtime_error if there's no clock sync before an event
+ */
+std::size_t printBlockEvents(
+  const char* data, std::size_t size,
+  std::ostream& output, const std::string& format, const std::string& dateFormat,
+  TimeWindow window
+);
+
 /**
  * Print the events in `input` to output, according to
  * `format` and `dateFormat`, sorted by event clock.
  *
  * First buffer every event in `input`, then sort and print them.
+ * Events of equal clock are printed in the order of `input`.
  *
  * @see PrettyPrinter on `format` and `dateFormat`.
  * @throws std::runtime_error if invalid binlog entry found in `input`.
  */
 void printSortedEvents(std::istream& input, std::ostream& output, const std::string& format, const std::string& dateFormat);
 
+/** Same as above, but read entries from `input` */
+void printSortedEvents(binlog::EntryStream& input, std::ostream& output, const std::string& format, const std::string& dateFormat);
+
+/**
+ * Same as above, but use at most about `memoryLimit` bytes to buffer the events.
+ *
+ * Events are buffered in a compact form: the clock, source id,
+ * context and serialized arguments of each event are kept.
+ * If the buffer grows larger than `memoryLimit`, it is sorted
+ * and written to a temporary file. When the input ends,
+ * the sorted runs are merged and printed.
+ * The default limit of the overload above is 1 GiB.
+ *
+ * @throws std::runtime_error if a temporary file can not be written
+ */
+void printSortedEvents(
+  binlog::EntryStream& input, std::ostream& output,
+  const std::string& format, const std::string& dateFormat,
+  std::size_t memoryLimit
+);
+
+/**
+ * How long printStreamSortedEvents holds back an event, waiting for earlier ones.
+ * If both are zero, events are held back until the input ends or gets idle.
+ */
+struct ReorderWindow
+{
+  std::chrono::nanoseconds time{0}; // if not zero, print events this much older than the latest one
+  std::size_t eventCount = 0;       // if not zero, print the earliest event if more are buffered
+};
+
+/**
+ * Print the events in `input` to output, according to
+ * `format` and `dateFormat`, sorted by event clock, as they are read.
+ *
+ * Unlike printSortedEvents, the input is not buffered until the end:
+ * each writer (by WriterProp id) writes its events in clock order,
+ * therefore the buffered events are kept in a queue of each writer,
+ * and merged by a heap of the first events of the writers.
+ * The earliest event is printed once it is out of `window`: it is older
+ * than the latest event read by `window.time`, or more than `window.eventCount`
+ * events are buffered. A writer seen earlier does not bound the future events,
+ * as a writer might first appear late, with earlier events.
+ * Events that arrive after a later event was printed (i.e: later than the window)
+ * are printed in the order of their arrival.
+ *
+ * If `input` returns an empty payload, every buffered event is printed.
+ * If `follow` is true, it means the input is idle (see FollowEntryStream::Options::idleTimeout),
+ * and reading continues, otherwise it means the input ended.
+ *
+ * @throws std::runtime_error if invalid binlog entry found in `input`.
+ */
+void printStreamSortedEvents(
+  binlog::EntryStream& input, std::ostream& output,
+  const std::string& format, const std::string& dateFormat,
+  ReorderWindow window, bool follow
+);
+
+/** The event field printSplitEvents groups the events by */
+enum class SplitBy
+{
+  writer,   // writer (thread) id and name
+  category,
+  severity,
+};
+
+/**
+ * Print the events in `input` according to `format` and `dateFormat`,
+ * to a separate file in `outputDirectory` for each distinct value of `splitBy`.
+ *
+ * The files are named after the value: <writer id>_<writer name>.txt,
+ * <category>.txt or <severity>.txt (e.g: INFO.txt), characters not
+ * allowed in file names replaced by '_'. The input is decoded once,
+ * each file is written through a buffer of `bufferSize` bytes.
+ *
+ * @returns the number of files written
+ * @throws std::runtime_error if invalid binlog entry found in `input`,
+ *         or if an output file can not be opened.
+ */
+std::size_t printSplitEvents(
+  binlog::EntryStream& input, const std::string& outputDirectory, SplitBy splitBy,
+  const std::string& format, const std::string& dateFormat,
+  std::size_t bufferSize = 1 << 16
+);
+
 #endif // BINLOG_BIN_PRINTERS_HPP
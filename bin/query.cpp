@@ -0,0 +1,704 @@
+#include "query.hpp"
+
+#include "find.hpp"
+
+#include <binlog/Entries.hpp>
+#include <binlog/EntryStream.hpp>
+#include <binlog/EventStream.hpp>
+#include <binlog/Range.hpp>
+#include <binlog/Severity.hpp>
+#include <binlog/Time.hpp>
+#include <binlog/TimeIndex.hpp>
+#include <binlog/detail/EventSourceTable.hpp>
+#include <binlog/detail/SegmentedMap.hpp>
+
+#include <mserialize/deserialize.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring> // memcpy
+#include <exception>
+#include <iomanip>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <tuple>
+
+namespace {
+
+constexpr std::uint64_t untimed = std::uint64_t(-1); // time key of events without clock sync
+
+[[noreturn]] void invalidQuery(const std::string& message, const std::string& text)
+{
+  throw std::runtime_error("Invalid query: " + message + " in: " + text);
+}
+
+std::string trim(const std::string& s)
+{
+  const std::size_t begin = s.find_first_not_of(" \t\r\n");
+  if (begin == std::string::npos) { return {}; }
+  const std::size_t end = s.find_last_not_of(" \t\r\n");
+  return s.substr(begin, end - begin + 1);
+}
+
+bool isWordChar(char c)
+{
+  return std::isalnum(static_cast<unsigned char>(c)) != 0 || c == '_';
+}
+
+/** A word of the query, outside of quoted strings */
+struct Word
+{
+  std::size_t begin;
+  std::size_t end;
+  std::string text; // lowercase
+};
+
+std::vector<Word> splitWords(const std::string& text)
+{
+  std::vector<Word> result;
+  for (std::size_t i = 0; i < text.size();)
+  {
+    if (text[i] == '"')
+    {
+      for (++i; i < text.size() && text[i] != '"'; ++i)
+      {
+        if (text[i] == '\\') { ++i; }
+      }
+      ++i;
+    }
+    else if (isWordChar(text[i]))
+    {
+      Word word{i, i, {}};
+      for (; i < text.size() && isWordChar(text[i]); ++i)
+      {
+        word.text.push_back(char(std::tolower(static_cast<unsigned char>(text[i]))));
+      }
+      word.end = i;
+      result.push_back(std::move(word));
+    }
+    else
+    {
+      ++i;
+    }
+  }
+  return result;
+}
+
+std::vector<std::string> splitList(const std::string& list)
+{
+  std::vector<std::string> result;
+  std::size_t begin = 0;
+  while (true)
+  {
+    const std::size_t comma = list.find(',', begin);
+    result.push_back(trim(list.substr(begin, comma - begin)));
+    if (comma == std::string::npos) { break; }
+    begin = comma + 1;
+  }
+  return result;
+}
+
+/** Parse `name(param)` or `name` to name and param, lowercase, without spaces */
+void splitCall(const std::string& item, std::string& name, std::string& param, bool& hasParam)
+{
+  std::string compact;
+  for (const char c : item)
+  {
+    if (c != ' ' && c != '\t') { compact.push_back(char(std::tolower(static_cast<unsigned char>(c)))); }
+  }
+
+  const std::size_t open = compact.find('(');
+  hasParam = open != std::string::npos;
+  if (! hasParam)
+  {
+    name = compact;
+    return;
+  }
+
+  if (compact.back() != ')') { throw std::runtime_error("missing ')' after '" + item + "'"); }
+  name = compact.substr(0, open);
+  param = compact.substr(open + 1, compact.size() - open - 2);
+}
+
+Query::Column parseKey(const std::string& item)
+{
+  std::string name;
+  std::string param;
+  bool hasParam = false;
+  splitCall(item, name, param, hasParam);
+
+  static const std::pair<const char*, Query::Field> fields[] = {
+    {"severity", Query::Field::severity}, {"category", Query::Field::category},
+    {"function", Query::Field::function}, {"file", Query::Field::file},
+    {"line", Query::Field::line}, {"format", Query::Field::format},
+    {"id", Query::Field::id}, {"writer", Query::Field::writer},
+  };
+
+  Query::Column column;
+  column.name = item;
+  if (name == "time" && hasParam)
+  {
+    double seconds = 0;
+    try { seconds = std::stod(param); } catch (const std::exception&) {} // NOLINT(bugprone-empty-catch) checked below
+    column.field = Query::Field::time;
+    column.interval = std::chrono::nanoseconds{std::int64_t(seconds * 1e9)};
+    if (column.interval.count() <= 0) { throw std::runtime_error("time interval must be positive: '" + item + "'"); }
+    return column;
+  }
+
+  for (const auto& field : fields)
+  {
+    if (name == field.first && ! hasParam)
+    {
+      column.field = field.second;
+      return column;
+    }
+  }
+
+  throw std::runtime_error("unknown key '" + item + "'");
+}
+
+Query::Column parseItem(const std::string& item)
+{
+  std::string name;
+  std::string param;
+  bool hasParam = false;
+  splitCall(item, name, param, hasParam);
+
+  Query::Column column;
+  column.name = item;
+  if (name == "count" && (! hasParam || param.empty()))
+  {
+    column.aggregate = Query::Aggregate::count;
+    return column;
+  }
+
+  const bool isAggregate = name == "min" || name == "max" || name == "sum";
+  if (isAggregate && hasParam)
+  {
+    column.aggregate = (name == "min") ? Query::Aggregate::min
+                     : (name == "max") ? Query::Aggregate::max
+                     :                   Query::Aggregate::sum;
+
+    if (param.size() > 4 && param.compare(0, 4, "arg.") == 0)
+    {
+      column.argumentName = param.substr(4);
+      return column;
+    }
+
+    const bool isArgument = param.size() > 3 && param.compare(0, 3, "arg") == 0
+      && std::all_of(param.begin() + 3, param.end(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)) != 0; });
+    if (! isArgument) { throw std::runtime_error("expected argN or arg.name in '" + item + "'"); }
+    column.argumentIndex = std::size_t(std::stoul(param.substr(3)));
+    return column;
+  }
+
+  return parseKey(item);
+}
+
+bool sameKey(const Query::Column& a, const Query::Column& b)
+{
+  return a.field == b.field && a.interval == b.interval;
+}
+
+bool isNumericKey(Query::Field field)
+{
+  return field == Query::Field::severity || field == Query::Field::line
+      || field == Query::Field::id || field == Query::Field::time;
+}
+
+/** The key and the aggregated arguments of an event source */
+struct SourceInfo
+{
+  std::size_t keyIndex = 0;                // of QueryEntryStream::keys
+  std::vector<NumericArgument> arguments;  // of the min, max and sum columns
+};
+
+/**
+ * Forwards the entries of an underlying stream, while
+ * computing the SourceInfo of each event source, and watching
+ * for writer changes.
+ */
+class QueryEntryStream : public binlog::EntryStream
+{
+public:
+  QueryEntryStream(binlog::EntryStream& input, const Query& query)
+    :_input(input),
+     _query(query)
+  {}
+
+  binlog::Range nextEntryPayload() override
+  {
+    const binlog::Range payload = _input.nextEntryPayload();
+    if (payload.size() < sizeof(std::uint64_t)) { return payload; }
+
+    binlog::Range entry = payload;
+    const std::uint64_t tag = entry.read<std::uint64_t>();
+    try
+    {
+      if (tag == binlog::EventSource::Tag)
+      {
+        binlog::EventSource source;
+        mserialize::deserialize(source, entry);
+        addSource(source);
+      }
+      else if (tag == binlog::EventSourceTable::Tag)
+      {
+        binlog::detail::readEventSourceTable(entry, [this](binlog::EventSource&& source) { addSource(source); });
+      }
+      else if (tag == binlog::WriterProp::Tag)
+      {
+        writerChanged = true;
+      }
+    }
+    catch (const std::exception&) {} // NOLINT(bugprone-empty-catch) EventStream reports the error
+
+    return payload;
+  }
+
+  const SourceInfo* source(std::uint64_t id) const
+  {
+    const SourceInfo* result = _sources.find(id);
+    return (result != _sources.end()) ? result : nullptr;
+  }
+
+  /** The distinct keys of the sources, the writer and time keys are set per event */
+  std::vector<QueryKey> keys; // NOLINT
+
+  bool writerChanged = true; // NOLINT
+
+private:
+  void addSource(const binlog::EventSource& source)
+  {
+    QueryKey key;
+    SourceInfo info;
+    for (const Query::Column& column : _query.columns())
+    {
+      switch (column.aggregate)
+      {
+        case Query::Aggregate::none:  key.push_back(sourceKey(column.field, source)); break;
+        case Query::Aggregate::count: break;
+        case Query::Aggregate::min:
+        case Query::Aggregate::max:
+        case Query::Aggregate::sum:
+          if (column.argumentName.empty()) { info.arguments.emplace_back(source, column.argumentIndex); }
+          else { info.arguments.emplace_back(source, column.argumentName); }
+          break;
+      }
+    }
+
+    // sources are repeated (e.g: by rotated logfiles), or redefined (e.g: by concatenated logfiles)
+    const auto it = _keyIndices.emplace(std::move(key), keys.size()).first;
+    if (it->second == keys.size()) { keys.push_back(it->first); }
+    info.keyIndex = it->second;
+
+    _sources.emplace(source.id, std::move(info));
+  }
+
+  static std::pair<std::uint64_t, std::string> sourceKey(Query::Field field, const binlog::EventSource& source)
+  {
+    switch (field)
+    {
+      case Query::Field::severity: return {std::uint64_t(source.severity), {}};
+      case Query::Field::category: return {0, source.category};
+      case Query::Field::function: return {0, source.function};
+      case Query::Field::file:     return {0, source.file};
+      case Query::Field::line:     return {source.line, {}};
+      case Query::Field::format:   return {0, source.formatString};
+      case Query::Field::id:       return {source.id, {}};
+      case Query::Field::writer:   break;
+      case Query::Field::time:     break;
+    }
+    return {}; // set per event
+  }
+
+  binlog::EntryStream& _input;
+  const Query& _query;
+  binlog::detail::SegmentedMap<SourceInfo> _sources; // by id
+  std::map<QueryKey, std::size_t> _keyIndices;        // index of each key in `keys`
+};
+
+std::int64_t floorDiv(std::int64_t a, std::int64_t b)
+{
+  const std::int64_t q = a / b;
+  return (a % b != 0 && a < 0) ? q - 1 : q;
+}
+
+void printTime(std::ostream& output, std::uint64_t ns)
+{
+  if (ns == untimed)
+  {
+    output << '-';
+    return;
+  }
+
+  binlog::BrokenDownTime bdt{};
+  binlog::nsSinceEpochToBrokenDownTimeUTC(std::chrono::nanoseconds{std::int64_t(ns)}, bdt);
+  output << std::setfill('0')
+    << std::setw(4) << bdt.tm_year + 1900 << '-' << std::setw(2) << bdt.tm_mon + 1 << '-' << std::setw(2) << bdt.tm_mday
+    << 'T' << std::setw(2) << bdt.tm_hour << ':' << std::setw(2) << bdt.tm_min << ':' << std::setw(2) << bdt.tm_sec
+    << std::setfill(' ') << 'Z';
+}
+
+void printNumber(std::ostream& output, double value)
+{
+  if (std::floor(value) == value && std::fabs(value) < 9007199254740992.0) // 2^53
+  {
+    output << std::int64_t(value);
+  }
+  else
+  {
+    output << std::setprecision(std::numeric_limits<double>::digits10) << value;
+  }
+}
+
+} // namespace
+
+Query::Query(const std::string& text)
+{
+  const std::vector<Word> words = splitWords(text);
+  if (words.empty() || words[0].text != "select") { invalidQuery("expected 'select'", text); }
+
+  // find the clauses, outside of quoted strings
+  std::size_t whereBegin = std::string::npos;
+  std::size_t groupBegin = std::string::npos; // of 'group'
+  std::size_t groupByEnd = std::string::npos; // after 'by'
+  for (std::size_t i = 1; i < words.size(); ++i)
+  {
+    if (words[i].text == "where" && whereBegin == std::string::npos && groupBegin == std::string::npos)
+    {
+      whereBegin = words[i].begin;
+    }
+    else if (words[i].text == "group" && i + 1 < words.size() && words[i + 1].text == "by" && groupBegin == std::string::npos)
+    {
+      groupBegin = words[i].begin;
+      groupByEnd = words[i + 1].end;
+    }
+  }
+
+  const std::size_t selectEnd = (std::min)(whereBegin, groupBegin);
+  const std::string select = text.substr(words[0].end, selectEnd - words[0].end);
+
+  try
+  {
+    std::vector<Column> keys;
+    if (groupBegin != std::string::npos)
+    {
+      for (const std::string& item : splitList(text.substr(groupByEnd)))
+      {
+        keys.push_back(parseKey(item));
+      }
+    }
+
+    for (const std::string& item : splitList(select))
+    {
+      if (item.empty()) { throw std::runtime_error("empty item in the select list"); }
+      _columns.push_back(parseItem(item));
+    }
+
+    // the group by keys not selected precede the select list
+    std::vector<Column> unselected;
+    for (const Column& key : keys)
+    {
+      const bool selected = std::any_of(_columns.begin(), _columns.end(), [&key](const Column& c)
+      {
+        return c.aggregate == Aggregate::none && sameKey(c, key);
+      });
+      if (! selected) { unselected.push_back(key); }
+    }
+    _columns.insert(_columns.begin(), unselected.begin(), unselected.end());
+
+    // writer and time are single values of each event
+    std::size_t writerKeys = 0;
+    std::size_t timeKeys = 0;
+    for (std::size_t i = 0; i < _columns.size(); ++i)
+    {
+      const Column& column = _columns[i];
+      if (column.aggregate != Aggregate::none) { continue; }
+      writerKeys += (column.field == Field::writer) ? 1 : 0;
+      timeKeys += (column.field == Field::time) ? 1 : 0;
+      for (std::size_t j = 0; j < i; ++j)
+      {
+        if (_columns[j].aggregate == Aggregate::none && sameKey(_columns[j], column))
+        {
+          throw std::runtime_error("duplicate key '" + column.name + "'");
+        }
+      }
+    }
+    if (writerKeys > 1 || timeKeys > 1) { throw std::runtime_error("at most one writer and one time key is allowed"); }
+  }
+  catch (const std::runtime_error& ex)
+  {
+    invalidQuery(ex.what(), text);
+  }
+
+  if (whereBegin != std::string::npos)
+  {
+    const std::size_t predicateBegin = whereBegin + 5;
+    const std::size_t predicateEnd = (groupBegin == std::string::npos) ? text.size() : groupBegin;
+    const std::string predicate = trim(text.substr(predicateBegin, predicateEnd - predicateBegin));
+    if (predicate.empty()) { invalidQuery("empty where clause", text); }
+    _where = std::make_shared<const WherePredicate>(predicate);
+  }
+}
+
+void QueryResult::merge(const QueryResult& other, const Query& query)
+{
+  for (const auto& entry : other.rows)
+  {
+    auto it = rows.find(entry.first);
+    if (it == rows.end())
+    {
+      rows.insert(entry);
+      continue;
+    }
+
+    QueryRow& row = it->second;
+    const QueryRow& src = entry.second;
+    row.count += src.count;
+
+    std::size_t v = 0;
+    for (const Query::Column& column : query.columns())
+    {
+      if (column.aggregate == Query::Aggregate::none || column.aggregate == Query::Aggregate::count) { continue; }
+
+      if (src.valueCounts[v] != 0)
+      {
+        double& value = row.values[v];
+        switch (column.aggregate)
+        {
+          case Query::Aggregate::min: value = (row.valueCounts[v] != 0) ? (std::min)(value, src.values[v]) : src.values[v]; break;
+          case Query::Aggregate::max: value = (row.valueCounts[v] != 0) ? (std::max)(value, src.values[v]) : src.values[v]; break;
+          default:                    value += src.values[v]; break;
+        }
+        row.valueCounts[v] += src.valueCounts[v];
+      }
+      ++v;
+    }
+  }
+
+  eventCount += other.eventCount;
+  skippedBlockCount += other.skippedBlockCount;
+}
+
+QueryResult runQuery(const Query& query, binlog::EntryStream& input, const TimeWindow* window)
+{
+  std::unique_ptr<WhereEntryStream> where;
+  if (query.where() != nullptr) { where.reset(new WhereEntryStream(input, *query.where())); }
+
+  QueryEntryStream entryStream(where ? *where : input, query);
+  binlog::EventStream eventStream;
+
+  // the position of the writer and time keys in QueryKey
+  std::size_t writerPos = std::size_t(-1);
+  std::size_t timePos = std::size_t(-1);
+  std::int64_t interval = 0;
+  std::vector<Query::Aggregate> aggregates; // of the values
+  std::size_t keyCount = 0;
+  for (const Query::Column& column : query.columns())
+  {
+    if (column.aggregate == Query::Aggregate::none)
+    {
+      if (column.field == Query::Field::writer) { writerPos = keyCount; }
+      if (column.field == Query::Field::time) { timePos = keyCount; interval = column.interval.count(); }
+      ++keyCount;
+    }
+    else if (column.aggregate != Query::Aggregate::count)
+    {
+      aggregates.push_back(column.aggregate);
+    }
+  }
+  const bool needsTime = window != nullptr || timePos != std::size_t(-1);
+
+  // groups are found by (source key, writer, time), the full key is made at the end
+  using GroupId = std::tuple<std::size_t, std::size_t, std::uint64_t>;
+  std::map<GroupId, QueryRow> groups;
+  std::vector<std::string> writers; // names, by writer index
+  std::size_t currentWriter = 0;
+
+  QueryResult result;
+  while (const binlog::Event* event = eventStream.nextEvent(entryStream))
+  {
+    const SourceInfo* info = entryStream.source(event->source->id);
+    if (info == nullptr) { continue; } // unreachable, EventStream knows the source
+
+    std::uint64_t time = 0;
+    if (needsTime)
+    {
+      const binlog::ClockSync& clockSync = eventStream.clockSync();
+      if (clockSync.clockFrequency != 0)
+      {
+        const std::chrono::nanoseconds ns = eventStream.clockConverter().toNsSinceEpoch(event->clockValue);
+        if (window != nullptr && (ns < window->from || ns > window->to)) { continue; }
+        if (interval != 0) { time = std::uint64_t(floorDiv(ns.count(), interval) * interval); }
+      }
+      else
+      {
+        if (window != nullptr) { continue; }
+        time = untimed;
+      }
+    }
+
+    if (entryStream.writerChanged)
+    {
+      entryStream.writerChanged = false;
+      if (writerPos != std::size_t(-1))
+      {
+        const std::string& name = eventStream.writerProp().name;
+        const auto it = std::find(writers.begin(), writers.end(), name);
+        currentWriter = std::size_t(it - writers.begin());
+        if (it == writers.end()) { writers.push_back(name); }
+      }
+    }
+
+    QueryRow& row = groups[GroupId{info->keyIndex, currentWriter, time}];
+    if (row.count == 0)
+    {
+      row.values.resize(aggregates.size());
+      row.valueCounts.resize(aggregates.size());
+    }
+    ++row.count;
+    ++result.eventCount;
+
+    for (std::size_t i = 0; i < aggregates.size(); ++i)
+    {
+      const NumericArgument& argument = info->arguments[i];
+      if (! argument.valid()) { continue; }
+
+      double value = 0;
+      try
+      {
+        value = argument.read(event->arguments);
+      }
+      catch (const std::runtime_error&)
+      {
+        continue; // invalid arguments
+      }
+
+      double& aggregate = row.values[i];
+      const bool first = row.valueCounts[i] == 0;
+      switch (aggregates[i])
+      {
+        case Query::Aggregate::min: aggregate = first ? value : (std::min)(aggregate, value); break;
+        case Query::Aggregate::max: aggregate = first ? value : (std::max)(aggregate, value); break;
+        default:                    aggregate += value; break;
+      }
+      ++row.valueCounts[i];
+    }
+  }
+
+  for (auto& group : groups)
+  {
+    QueryKey key = entryStream.keys[std::get<0>(group.first)];
+    if (writerPos < key.size()) { key[writerPos].second = writers[std::get<1>(group.first)]; }
+    if (timePos < key.size()) { key[timePos].first = std::get<2>(group.first); }
+
+    QueryResult partial;
+    partial.rows.emplace(std::move(key), std::move(group.second));
+    result.merge(partial, query);
+  }
+
+  return result;
+}
+
+QueryResult runQuery(
+  const Query& query, const char* data, std::size_t size,
+  const binlog::TimeIndex& index, const TimeWindow* window
+)
+{
+  const std::string* value = (query.where() != nullptr) ? query.where()->requiredValue() : nullptr;
+  const bool useFilters = value != nullptr && index.hasFilters();
+
+  std::vector<bool> candidateBlocks(index.blocks.size(), true);
+  binlog::ClockSync clockSync;
+  auto metadata = index.metadata.begin();
+  for (std::size_t i = 0; i < index.blocks.size(); ++i)
+  {
+    const binlog::TimeIndex::Block& block = index.blocks[i];
+    const std::uint64_t blockEnd = block.offset + block.size;
+
+    // find the clock sync in effect at the end of the block
+    for (; metadata != index.metadata.end() && metadata->offset < blockEnd; ++metadata)
+    {
+      if (metadata->tag != binlog::ClockSync::Tag) { continue; }
+      const std::size_t headerSize = sizeof(std::uint32_t) + sizeof(std::uint64_t);
+      if (metadata->offset > size || metadata->size > size - metadata->offset || metadata->size < headerSize)
+      {
+        throw std::runtime_error("Time index does not match the logfile");
+      }
+
+      binlog::Range entry(data + metadata->offset + headerSize, std::size_t(metadata->size - headerSize));
+      mserialize::deserialize(clockSync, entry);
+    }
+
+    if (window != nullptr && clockSync.clockFrequency != 0 && block.minClock <= block.maxClock)
+    {
+      candidateBlocks[i] =
+        binlog::clockToNsSinceEpoch(clockSync, block.minClock) <= window->to &&
+        binlog::clockToNsSinceEpoch(clockSync, block.maxClock) >= window->from;
+    }
+
+    if (useFilters && candidateBlocks[i])
+    {
+      candidateBlocks[i] = index.blockMayContain(i, *value);
+    }
+  }
+
+  FindEntryStream candidates(data, size, index, candidateBlocks);
+  QueryResult result = runQuery(query, candidates, window);
+  result.skippedBlockCount += candidates.skippedBlockCount();
+  return result;
+}
+
+void printQueryResult(const Query& query, const QueryResult& result, std::ostream& output)
+{
+  const std::vector<Query::Column>& columns = query.columns();
+  for (std::size_t i = 0; i < columns.size(); ++i)
+  {
+    output << (i == 0 ? "" : "\t") << columns[i].name;
+  }
+  output << "\n";
+
+  for (const auto& entry : result.rows)
+  {
+    const QueryKey& key = entry.first;
+    const QueryRow& row = entry.second;
+    std::size_t k = 0;
+    std::size_t v = 0;
+    for (std::size_t i = 0; i < columns.size(); ++i)
+    {
+      if (i != 0) { output << '\t'; }
+
+      const Query::Column& column = columns[i];
+      switch (column.aggregate)
+      {
+        case Query::Aggregate::none:
+        {
+          const std::pair<std::uint64_t, std::string>& value = key[k++];
+          if (column.field == Query::Field::time) { printTime(output, value.first); }
+          else if (column.field == Query::Field::severity) { output << binlog::severityToString(binlog::Severity(value.first)); }
+          else if (isNumericKey(column.field)) { output << value.first; }
+          else { output << value.second; }
+          break;
+        }
+        case Query::Aggregate::count:
+          output << row.count;
+          break;
+        default:
+          if (row.valueCounts[v] != 0 || column.aggregate == Query::Aggregate::sum)
+          {
+            printNumber(output, row.values[v]);
+          }
+          else
+          {
+            output << '-';
+          }
+          ++v;
+          break;
+      }
+    }
+    output << "\n";
+  }
+}
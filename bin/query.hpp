@@ -0,0 +1,133 @@
+#ifndef BINLOG_BIN_QUERY_HPP
+#define BINLOG_BIN_QUERY_HPP
+
+#include "printers.hpp"
+#include "where.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace binlog {
+class EntryStream;
+class TimeIndex;
+} // namespace binlog
+
+/**
+ * An aggregating query of events, parsed from text, e.g:
+ *
+ *    select time(60), category, count where severity>=error
+ *    select writer, count, max(arg0), sum(arg1) where format~"latency" group by time(3600)
+ *    select category, max(arg.px) group by time(60)
+ *
+ * Grammar:
+ *
+ *    query     := 'select' item (',' item)* ['where' predicate] ['group' 'by' key (',' key)*]
+ *    item      := key | aggregate
+ *    key       := severity | category | function | file | line | format | id | writer | 'time(' seconds ')'
+ *    aggregate := count | ('min' | 'max' | 'sum') '(' ('arg' N | 'arg.' name) ')'
+ *
+ * The events are grouped by the keys: the keys of the select list,
+ * and the keys of `group by` (the ones not selected are shown first).
+ * `time(s)` is the beginning of the `s` seconds long interval of the event (UTC),
+ * `writer` is the name of the writer. `predicate` is a WherePredicate:
+ * to use `where` or `group` as a value in it, quote it.
+ * min, max and sum consider the events which have an arithmetic argument
+ * at position N (0, 1, ...), or of the {name} placeholder, converted to double.
+ */
+class Query
+{
+public:
+  enum class Field : std::uint8_t { severity, category, function, file, line, format, id, writer, time };
+  enum class Aggregate : std::uint8_t { none, count, min, max, sum };
+
+  struct Column
+  {
+    Aggregate aggregate = Aggregate::none;
+    Field field = Field::severity;         // of a key
+    std::chrono::nanoseconds interval{0};  // of a time key
+    std::size_t argumentIndex = 0;         // of min, max and sum
+    std::string argumentName;              // of min, max and sum of arg.name, if not empty
+    std::string name;                      // e.g: max(arg0)
+  };
+
+  /** @throws std::runtime_error if `text` is not a valid query */
+  explicit Query(const std::string& text);
+
+  /** The keys and aggregates, in the order of the result */
+  const std::vector<Column>& columns() const { return _columns; }
+
+  /** @returns the predicate of the where clause, or nullptr, if there's none */
+  const WherePredicate* where() const { return _where.get(); }
+
+private:
+  std::vector<Column> _columns;
+  std::shared_ptr<const WherePredicate> _where;
+};
+
+/**
+ * The value of each key column of a group: numeric keys
+ * (severity, line, id, time) use `first`, the others `second`.
+ */
+using QueryKey = std::vector<std::pair<std::uint64_t, std::string>>;
+
+/** The aggregates of a group of events */
+struct QueryRow
+{
+  std::uint64_t count = 0;                // NOLINT
+  std::vector<double> values;             // NOLINT of the min, max and sum columns, in order
+  std::vector<std::uint64_t> valueCounts; // NOLINT number of events contributing to each value
+};
+
+struct QueryResult
+{
+  std::map<QueryKey, QueryRow> rows; // NOLINT
+  std::uint64_t eventCount = 0;      // NOLINT events read, accepted by the predicate
+  std::size_t skippedBlockCount = 0; // NOLINT blocks ruled out by the time index
+
+  /** Add the groups of `other`, a result of the same `query` */
+  void merge(const QueryResult& other, const Query& query);
+};
+
+/**
+ * Run `query` on the events of `input`.
+ *
+ * Events of sources rejected by the predicate of the query are skipped
+ * by their tag, see WhereEntryStream. The arguments of the events
+ * are never formatted, the keys are computed once per source and writer.
+ * If `window` is not null, only the events in it are considered
+ * (events without clock sync are not).
+ *
+ * @throws std::runtime_error if invalid binlog entry found in `input`.
+ */
+QueryResult runQuery(const Query& query, binlog::EntryStream& input, const TimeWindow* window);
+
+/**
+ * Same as above, but read the events from the logfile
+ * in [data, data+size), using `index` to skip the blocks
+ * of the logfile which are known to have no events in `window`,
+ * or no events with the value required by the predicate of the query,
+ * (see WherePredicate::requiredValue and FindEntryStream).
+ *
+ * @throws std::runtime_error if `index` does not match the logfile
+ */
+QueryResult runQuery(
+  const Query& query, const char* data, std::size_t size,
+  const binlog::TimeIndex& index, const TimeWindow* window
+);
+
+/**
+ * Print `result` to `output`, tab separated:
+ * the names of the columns, then a line for each group, ordered by the keys.
+ * Times are shown as YYYY-MM-DDTHH:MM:SSZ, "-" if unknown.
+ * min and max of no values are shown as "-".
+ */
+void printQueryResult(const Query& query, const QueryResult& result, std::ostream& output);
+
+#endif // BINLOG_BIN_QUERY_HPP
@@ -0,0 +1,144 @@
+#include "replay.hpp"
+
+#include <binlog/BackgroundConsumer.hpp>
+#include <binlog/Entries.hpp>
+#include <binlog/EntryStream.hpp>
+#include <binlog/Range.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/StreamRelay.hpp> // RawArguments
+#include <binlog/Time.hpp>
+#include <binlog/detail/ForEachEntry.hpp> // isSpecialEntryTag
+
+#include <mserialize/deserialize.hpp>
+
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+namespace {
+
+/** @returns the time of `clock` in nanoseconds since the UNIX epoch, according to `clockSync` */
+double clockToNs(std::uint64_t clock, const binlog::ClockSync& clockSync)
+{
+  const double ticks = double(clock) - double(clockSync.clockValue);
+  return double(clockSync.nsSinceEpoch) + ticks * 1e9 / double(clockSync.clockFrequency);
+}
+
+} // namespace
+
+ReplayStats replay(binlog::EntryStream& input, std::ostream& output, double speed, std::size_t queueCapacity)
+{
+  using Clock = std::chrono::steady_clock;
+
+  ReplayStats stats;
+  const Clock::time_point start = Clock::now();
+
+  binlog::Session session;
+  binlog::BackgroundConsumer consumer(session, output);
+
+  // SessionWriter by the id and name of the writers of the input
+  std::map<std::pair<std::uint64_t, std::string>, std::unique_ptr<binlog::SessionWriter>> writers;
+  const auto getWriter = [&](std::uint64_t id, const std::string& name) -> binlog::SessionWriter&
+  {
+    std::unique_ptr<binlog::SessionWriter>& writer = writers[std::make_pair(id, name)];
+    if (! writer)
+    {
+      writer.reset(new binlog::SessionWriter(session, queueCapacity, id, name));
+      writer->setOverflowPolicy(binlog::SessionWriter::OverflowPolicy::block);
+      writer->setWakeupWatermark(queueCapacity / 4);
+    }
+    return *writer;
+  };
+
+  // events before the first WriterProp are attributed to an unnamed writer
+  binlog::SessionWriter* writer = &getWriter(0, {});
+
+  std::unordered_map<std::uint64_t, std::uint64_t> sourceIds; // session id by input id
+  binlog::ClockSync clockSync;
+  bool paced = false;
+  double firstEventNs = 0;
+  Clock::time_point paceStart;
+
+  for (binlog::Range payload = input.nextEntryPayload(); ! payload.empty(); payload = input.nextEntryPayload())
+  {
+    const std::uint64_t tag = payload.read<std::uint64_t>();
+
+    if (! binlog::detail::isSpecialEntryTag(tag))
+    {
+      const std::uint64_t eventClock = payload.read<std::uint64_t>();
+
+      if (speed > 0 && clockSync.clockFrequency != 0)
+      {
+        const double eventNs = clockToNs(eventClock, clockSync);
+        if (! paced)
+        {
+          firstEventNs = eventNs;
+          paceStart = Clock::now();
+          paced = true;
+        }
+
+        const std::chrono::nanoseconds offset(std::int64_t((eventNs - firstEventNs) / speed));
+        const Clock::time_point due = paceStart + std::chrono::duration_cast<Clock::duration>(offset);
+        if (due > Clock::now()) { std::this_thread::sleep_until(due); }
+      }
+
+      const auto it = sourceIds.find(tag);
+      const std::size_t argumentsSize = payload.size();
+      const binlog::detail::RawArguments arguments{payload.view(argumentsSize), argumentsSize};
+
+      if (it != sourceIds.end() && writer->addEvent(it->second, binlog::clockNow(), arguments))
+      {
+        ++stats.eventCount;
+      }
+      else
+      {
+        ++stats.droppedEventCount;
+      }
+    }
+    else if (tag == binlog::EventSource::Tag)
+    {
+      binlog::EventSource source;
+      mserialize::deserialize(source, payload);
+      const std::uint64_t id = source.id;
+      sourceIds[id] = session.addEventSource(std::move(source));
+    }
+    else if (tag == binlog::WriterProp::Tag)
+    {
+      binlog::WriterProp writerProp;
+      mserialize::deserialize(writerProp, payload);
+      writer = &getWriter(writerProp.id, writerProp.name);
+    }
+    else if (tag == binlog::ClockSync::Tag)
+    {
+      mserialize::deserialize(clockSync, payload);
+    }
+    // other metadata is not replayed, the session writes its own
+  }
+
+  consumer.stop(); // consume the remaining events
+
+  stats.byteCount = consumer.totalBytesConsumed();
+  stats.elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+  return stats;
+}
+
+void printReplayStats(const ReplayStats& stats, std::ostream& output)
+{
+  const double seconds = double(stats.elapsed.count()) / 1e9;
+  const double eventRate = (seconds > 0) ? double(stats.eventCount) / seconds : 0;
+  const double byteRate = (seconds > 0) ? double(stats.byteCount) / seconds : 0;
+
+  output << std::fixed << std::setprecision(3)
+         << "Replayed events: " << stats.eventCount << "\n"
+         << "Dropped events:  " << stats.droppedEventCount << "\n"
+         << "Consumed bytes:  " << stats.byteCount << "\n"
+         << "Elapsed time:    " << seconds << " s\n"
+         << "Event rate:      " << std::setprecision(0) << eventRate << " events/s\n"
+         << "Throughput:      " << std::setprecision(3) << byteRate / (1 << 20) << " MiB/s\n";
+}
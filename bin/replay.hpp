@@ -0,0 +1,46 @@
+#ifndef BINLOG_BIN_REPLAY_HPP
+#define BINLOG_BIN_REPLAY_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+
+namespace binlog {
+class EntryStream;
+} // namespace binlog
+
+struct ReplayStats
+{
+  std::uint64_t eventCount = 0;        // NOLINT replayed events
+  std::uint64_t droppedEventCount = 0; // NOLINT events of unknown sources, or larger than half of the queue
+  std::uint64_t byteCount = 0;         // NOLINT written to the output by the consumer, including metadata
+  std::chrono::nanoseconds elapsed{0}; // NOLINT wall time of the replay, until the last event is consumed
+};
+
+/**
+ * Re-emit the events of `input` through a new Session,
+ * consumed to `output` by a BackgroundConsumer.
+ *
+ * The event sources of `input` are added to the session (with new ids),
+ * and each writer of `input` gets a SessionWriter with the same id and name,
+ * and a queue of `queueCapacity` bytes. The serialized arguments of the events
+ * are copied to the queues as they are, without decoding them.
+ * The events are timestamped by the time of the replay.
+ *
+ * If `speed` is positive, the original pace of the events is kept (according to
+ * the clock sync of `input`), scaled by `speed`: e.g: 2 replays twice as fast.
+ * Otherwise, or if `input` has no clock sync, events are replayed as fast as possible.
+ * Writers block if their queue is full, until the consumer makes space.
+ *
+ * Only plain logfiles are replayed: interned strings, compact and
+ * compressed entries are not supported.
+ *
+ * @throws std::runtime_error if invalid binlog entry found in `input`.
+ */
+ReplayStats replay(binlog::EntryStream& input, std::ostream& output, double speed, std::size_t queueCapacity);
+
+/** Print the counts of `stats` and the resulting throughput to `output` */
+void printReplayStats(const ReplayStats& stats, std::ostream& output);
+
+#endif // BINLOG_BIN_REPLAY_HPP
@@ -0,0 +1,268 @@
+#include "stats.hpp"
+
+#include <binlog/Entries.hpp>
+#include <binlog/EntryStream.hpp>
+#include <binlog/EventStream.hpp>
+#include <binlog/Range.hpp>
+#include <binlog/Severity.hpp>
+#include <binlog/Time.hpp>
+#include <binlog/detail/SegmentedMap.hpp>
+
+#include <mserialize/deserialize.hpp>
+
+#include <algorithm>
+#include <ctime>
+#include <iomanip>
+#include <exception>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+/** @returns floor(a / b) */
+std::int64_t floorDiv(std::int64_t a, std::int64_t b)
+{
+  const std::int64_t q = a / b;
+  return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
+
+std::size_t writerIndex(Statistics& stats, std::map<std::pair<std::uint64_t, std::string>, std::size_t>& writers, const binlog::WriterProp& writerProp)
+{
+  const auto key = std::make_pair(writerProp.id, writerProp.name);
+  const auto it = writers.find(key);
+  if (it != writers.end()) { return it->second; }
+
+  WriterStats writer;
+  writer.id = writerProp.id;
+  writer.name = writerProp.name;
+  stats.writers.push_back(std::move(writer));
+  writers.emplace(key, stats.writers.size() - 1);
+  return stats.writers.size() - 1;
+}
+
+SourceStats makeSourceStats(const binlog::EventSource& source)
+{
+  SourceStats result;
+  result.id = source.id;
+  result.severity = binlog::severityToString(source.severity).data();
+  result.category = source.category;
+  result.function = source.function;
+  result.file = source.file;
+  result.line = source.line;
+  result.formatString = source.formatString;
+  return result;
+}
+
+bool sameSource(const SourceStats& stats, const binlog::EventSource& source)
+{
+  return stats.line == source.line
+      && stats.severity == binlog::severityToString(source.severity).data()
+      && stats.category == source.category
+      && stats.function == source.function
+      && stats.file == source.file
+      && stats.formatString == source.formatString;
+}
+
+std::string percent(std::uint64_t part, std::uint64_t total)
+{
+  if (total == 0) { return "-"; }
+  std::ostringstream str;
+  str << std::fixed << std::setprecision(1) << 100.0 * double(part) / double(total) << '%';
+  return str.str();
+}
+
+/** @returns the indices of `items` in descending order of byteCount, at most `top` */
+template <typename Items>
+std::vector<std::size_t> topIndices(const Items& items, std::size_t top)
+{
+  std::vector<std::size_t> result(items.size());
+  for (std::size_t i = 0; i < result.size(); ++i) { result[i] = i; }
+
+  std::stable_sort(result.begin(), result.end(), [&items](std::size_t a, std::size_t b)
+  {
+    return items[a].byteCount > items[b].byteCount
+       || (items[a].byteCount == items[b].byteCount && items[a].eventCount > items[b].eventCount);
+  });
+
+  result.resize((std::min)(top, result.size()));
+  return result;
+}
+
+void printTime(std::ostream& output, std::int64_t nsSinceEpoch, bool printFraction)
+{
+  binlog::BrokenDownTime bdt{};
+  binlog::nsSinceEpochToBrokenDownTimeUTC(std::chrono::nanoseconds{nsSinceEpoch}, bdt);
+
+  char buffer[32] = {0};
+  std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &bdt);
+  output << buffer;
+  if (printFraction)
+  {
+    output << '.' << std::setw(9) << std::setfill('0') << bdt.tm_nsec << std::setfill(' ');
+  }
+  output << 'Z';
+}
+
+} // namespace
+
+Statistics collectStatistics(binlog::EntryStream& input, std::chrono::nanoseconds interval)
+{
+  StatisticsCollector collector(interval);
+  StatisticsEntryStream entryStream(input, collector);
+  binlog::EventStream eventStream;
+
+  while (const binlog::Event* event = eventStream.nextEvent(entryStream))
+  {
+    collector.addEvent(*event, eventStream);
+  }
+
+  return collector.statistics(eventStream);
+}
+
+StatisticsCollector::StatisticsCollector(std::chrono::nanoseconds interval)
+  :_intervalNs(interval.count())
+{}
+
+void StatisticsCollector::addEntry(binlog::Range payload)
+{
+  _stats.entryByteCount += sizeof(std::uint32_t) + payload.size();
+
+  if (payload.size() < sizeof(std::uint64_t)) { return; } // let EventStream report the error
+
+  const std::uint64_t tag = payload.read<std::uint64_t>();
+  if (tag == binlog::EventSource::Tag)
+  {
+    try
+    {
+      binlog::EventSource source;
+      mserialize::deserialize(source, payload);
+      _redefinedSources.push_back(std::move(source));
+    }
+    catch (const std::exception&) {} // NOLINT(bugprone-empty-catch) EventStream reports the error
+  }
+  else if (tag == binlog::WriterProp::Tag)
+  {
+    _writerChanged = true;
+  }
+}
+
+void StatisticsCollector::addEvent(const binlog::Event& event, const binlog::EventStream& eventStream)
+{
+  const binlog::EventSource& source = *event.source;
+
+  // ids can be reused by different sources (e.g: concatenated logfiles),
+  // while sources are also repeated as they are (e.g: rotated logfiles)
+  for (const binlog::EventSource& redefined : _redefinedSources)
+  {
+    const std::size_t* index = _sourceIndices.find(redefined.id);
+    if (index != _sourceIndices.end() && *index != 0 && ! sameSource(_stats.sources[*index - 1], redefined))
+    {
+      _sourceIndices.emplace(redefined.id, std::size_t{0});
+    }
+  }
+  _redefinedSources.clear();
+
+  const std::size_t* index = _sourceIndices.find(source.id);
+  if (index == _sourceIndices.end() || *index == 0)
+  {
+    _stats.sources.push_back(makeSourceStats(source));
+    _sourceIndices.emplace(source.id, _stats.sources.size());
+    index = _sourceIndices.find(source.id);
+  }
+
+  if (_writerChanged)
+  {
+    _currentWriter = writerIndex(_stats, _writerIndices, eventStream.writerProp());
+    _writerChanged = false;
+  }
+
+  const std::uint64_t size = event.arguments.size();
+
+  SourceStats& sourceStats = _stats.sources[*index - 1];
+  sourceStats.eventCount++;
+  sourceStats.byteCount += size;
+
+  WriterStats& writerStats = _stats.writers[_currentWriter];
+  writerStats.eventCount++;
+  writerStats.byteCount += size;
+
+  _stats.eventCount++;
+  _stats.byteCount += size;
+
+  const binlog::ClockSync& clockSync = eventStream.clockSync();
+  if (clockSync.clockFrequency != 0)
+  {
+    const std::int64_t ns = eventStream.clockConverter().toNsSinceEpoch(event.clockValue).count();
+    const std::int64_t start = floorDiv(ns, _intervalNs) * _intervalNs;
+    if (_currentRate == nullptr || start != _currentInterval)
+    {
+      _currentInterval = start;
+      _currentRate = &_stats.rate[start];
+    }
+    ++*_currentRate;
+  }
+  else
+  {
+    _stats.untimedEventCount++;
+  }
+}
+
+Statistics StatisticsCollector::statistics(const binlog::EventStream& eventStream) const
+{
+  Statistics result = _stats;
+  result.droppedEventCount = eventStream.droppedEventCount();
+  result.repeatedEventCount = eventStream.repeatedEventCount();
+  return result;
+}
+
+void printStatistics(const Statistics& stats, std::ostream& output, std::size_t top, std::chrono::nanoseconds interval)
+{
+  output
+    << "Events: " << stats.eventCount
+    << ", argument bytes: " << stats.byteCount
+    << ", total bytes: " << stats.entryByteCount
+    << ", dropped events: " << stats.droppedEventCount
+    << ", repeated events: " << stats.repeatedEventCount
+    << "\n";
+
+  output << "\nSources by bytes:\n"
+    << std::setw(12) << "Events" << std::setw(14) << "Bytes" << std::setw(8) << "Share"
+    << "  Id Sev Category Location Function Format\n";
+  for (const std::size_t i : topIndices(stats.sources, top))
+  {
+    const SourceStats& s = stats.sources[i];
+    output
+      << std::setw(12) << s.eventCount << std::setw(14) << s.byteCount
+      << std::setw(8) << percent(s.byteCount, stats.byteCount)
+      << "  " << s.id << ' ' << s.severity << ' ' << s.category << ' '
+      << s.file << ':' << s.line << ' ' << s.function << ' ' << s.formatString << "\n";
+  }
+
+  output << "\nWriters by bytes:\n"
+    << std::setw(12) << "Events" << std::setw(14) << "Bytes" << std::setw(8) << "Share"
+    << "  Id Name\n";
+  for (const std::size_t i : topIndices(stats.writers, top))
+  {
+    const WriterStats& w = stats.writers[i];
+    output
+      << std::setw(12) << w.eventCount << std::setw(14) << w.byteCount
+      << std::setw(8) << percent(w.byteCount, stats.byteCount)
+      << "  " << w.id << ' ' << w.name << "\n";
+  }
+
+  output << "\nEvents per " << interval.count() << "ns:\n";
+  const bool printFraction = interval.count() % 1000000000 != 0;
+  for (const auto& countAtTime : stats.rate)
+  {
+    output << "  ";
+    printTime(output, countAtTime.first, printFraction);
+    output << std::setw(12) << countAtTime.second << "\n";
+  }
+  if (stats.untimedEventCount != 0)
+  {
+    output << "  without clock sync: " << stats.untimedEventCount << "\n";
+  }
+}
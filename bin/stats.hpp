@@ -0,0 +1,141 @@
+#ifndef BINLOG_BIN_STATS_HPP
+#define BINLOG_BIN_STATS_HPP
+
+#include <binlog/Entries.hpp>
+#include <binlog/EntryStream.hpp>
+#include <binlog/Range.hpp>
+#include <binlog/detail/SegmentedMap.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace binlog {
+class EventStream;
+} // namespace binlog
+
+/** Statistics of the events of an event source */
+struct SourceStats
+{
+  std::uint64_t id = 0;          // NOLINT
+  std::string severity;          // NOLINT
+  std::string category;          // NOLINT
+  std::string function;          // NOLINT
+  std::string file;              // NOLINT
+  std::uint64_t line = 0;        // NOLINT
+  std::string formatString;      // NOLINT
+  std::uint64_t eventCount = 0;  // NOLINT
+  std::uint64_t byteCount = 0;   // NOLINT serialized arguments of the events
+};
+
+/** Statistics of the events of a writer */
+struct WriterStats
+{
+  std::uint64_t id = 0;          // NOLINT
+  std::string name;              // NOLINT
+  std::uint64_t eventCount = 0;  // NOLINT
+  std::uint64_t byteCount = 0;   // NOLINT serialized arguments of the events
+};
+
+struct Statistics
+{
+  std::uint64_t eventCount = 0;         // NOLINT
+  std::uint64_t byteCount = 0;          // NOLINT serialized arguments of the events
+  std::uint64_t entryByteCount = 0;     // NOLINT size of every entry, including metadata, size prefix and tag
+  std::uint64_t droppedEventCount = 0;  // NOLINT see DroppedEvents
+  std::uint64_t repeatedEventCount = 0; // NOLINT see RepeatedEvents
+  std::uint64_t untimedEventCount = 0;  // NOLINT events without a clock sync, not counted in `rate`
+
+  /** In the order of appearance. A redefined source id gets a new element. */
+  std::vector<SourceStats> sources;     // NOLINT
+
+  /** In the order of appearance. Writers with the same id and name are merged. */
+  std::vector<WriterStats> writers;     // NOLINT
+
+  /** Number of events by the start of the interval, in nanoseconds since the UNIX epoch */
+  std::map<std::int64_t, std::uint64_t> rate; // NOLINT
+};
+
+/**
+ * Collect per source and per writer event counts and byte counts
+ * of the events in `input`, and the number of events per `interval`.
+ *
+ * The arguments of the events are never visited,
+ * the byte count of an event is the size of its serialized arguments.
+ *
+ * @pre interval > 0
+ * @throws std::runtime_error if invalid binlog entry found in `input`.
+ */
+Statistics collectStatistics(binlog::EntryStream& input, std::chrono::nanoseconds interval);
+
+/**
+ * Collects Statistics while the events are read by an other consumer,
+ * e.g: while they are printed. collectStatistics in steps:
+ * every entry must be added, in the order of reading (see StatisticsEntryStream),
+ * and every event read from those entries.
+ */
+class StatisticsCollector
+{
+public:
+  /** @pre interval > 0 */
+  explicit StatisticsCollector(std::chrono::nanoseconds interval);
+
+  /** Count `payload`, an entry without its size prefix, and watch for metadata */
+  void addEntry(binlog::Range payload);
+
+  /** Count `event`, the last event read by `eventStream` */
+  void addEvent(const binlog::Event& event, const binlog::EventStream& eventStream);
+
+  /** @returns the statistics of the added entries and events, read by `eventStream` */
+  Statistics statistics(const binlog::EventStream& eventStream) const;
+
+private:
+  Statistics _stats;
+
+  std::vector<binlog::EventSource> _redefinedSources; // sources read since the last event
+  bool _writerChanged = true;
+
+  // index+1 of the stats of the source in _stats.sources by id, 0 if not yet seen
+  binlog::detail::SegmentedMap<std::size_t> _sourceIndices;
+
+  std::map<std::pair<std::uint64_t, std::string>, std::size_t> _writerIndices;
+  std::size_t _currentWriter = 0;
+
+  std::int64_t _intervalNs;
+  std::int64_t _currentInterval = 0;
+  std::uint64_t* _currentRate = nullptr; // in _stats.rate
+};
+
+/** Forwards the entries of an underlying stream, and adds them to a StatisticsCollector */
+class StatisticsEntryStream : public binlog::EntryStream
+{
+public:
+  StatisticsEntryStream(binlog::EntryStream& input, StatisticsCollector& collector)
+    :_input(input),
+     _collector(collector)
+  {}
+
+  binlog::Range nextEntryPayload() override
+  {
+    const binlog::Range payload = _input.nextEntryPayload();
+    if (! payload.empty()) { _collector.addEntry(payload); }
+    return payload;
+  }
+
+private:
+  binlog::EntryStream& _input;
+  StatisticsCollector& _collector;
+};
+
+/**
+ * Print `stats` to `output`: the totals, the `top` sources
+ * and writers with the most bytes, and the number of events per interval.
+ */
+void printStatistics(const Statistics& stats, std::ostream& output, std::size_t top, std::chrono::nanoseconds interval);
+
+#endif // BINLOG_BIN_STATS_HPP
@@ -0,0 +1,178 @@
+#include "trace.hpp"
+
+#include <binlog/Entries.hpp>
+#include <binlog/EntryStream.hpp>
+#include <binlog/EventStream.hpp>
+#include <binlog/PrettyPrinter.hpp>
+#include <binlog/Range.hpp>
+#include <binlog/Time.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio> // snprintf
+#include <map>
+#include <ostream>
+#include <sstream>
+#include <string>
+
+namespace {
+
+/** The format string suffix and the argument tag added by BINLOG_SCOPE_WC */
+const std::string scopeFormatSuffix = " ({})";
+const std::string scopeDurationTag = "{binlog::ScopeDuration`ticks'L}";
+
+bool endsWith(const std::string& str, const std::string& suffix)
+{
+  return str.size() >= suffix.size()
+    && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+bool isScope(const binlog::EventSource& source)
+{
+  return endsWith(source.formatString, scopeFormatSuffix)
+    && endsWith(source.argumentTags, scopeDurationTag);
+}
+
+/** Write `str` as a JSON string literal */
+void writeJsonString(std::ostream& out, const std::string& str)
+{
+  out << '"';
+  for (const char c : str)
+  {
+    switch (c)
+    {
+    case '"':  out << "\\\""; break;
+    case '\\': out << "\\\\"; break;
+    case '\n': out << "\\n"; break;
+    case '\r': out << "\\r"; break;
+    case '\t': out << "\\t"; break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20)
+      {
+        char buf[8] = {};
+        std::snprintf(buf, sizeof(buf), "\\u%04x", unsigned(static_cast<unsigned char>(c)));
+        out << buf;
+      }
+      else
+      {
+        out << c;
+      }
+    }
+  }
+  out << '"';
+}
+
+/** Write `ns` nanoseconds as (possibly fractional) microseconds */
+void writeMicroseconds(std::ostream& out, std::int64_t ns)
+{
+  const char* sign = (ns < 0) ? "-" : "";
+  const std::uint64_t abs = (ns < 0) ? std::uint64_t(0) - std::uint64_t(ns) : std::uint64_t(ns);
+  char buf[32] = {};
+  std::snprintf(buf, sizeof(buf), "%s%llu.%03u", sign,
+    static_cast<unsigned long long>(abs / 1000), unsigned(abs % 1000)); // NOLINT(google-runtime-int)
+  out << buf;
+}
+
+/** Caches the message printers, and the sources of scope events, without the duration */
+class MessagePrinter
+{
+public:
+  MessagePrinter() :_printer("%m", "%Y-%m-%d %H:%M:%S.%N") {}
+
+  std::string message(const binlog::Event& event, const binlog::WriterProp& writer, const binlog::ClockSync& clockSync)
+  {
+    _buffer.str(std::string());
+    _printer.printEvent(_buffer, event, writer, clockSync);
+    return _buffer.str();
+  }
+
+  /** @returns `source` without the scope suffix of the format string, and the duration tag */
+  const binlog::EventSource& withoutDuration(const binlog::EventSource& source)
+  {
+    binlog::EventSource& result = _scopeSources[source.id];
+    if (result.formatString.size() + scopeFormatSuffix.size() != source.formatString.size()
+      || result.function != source.function || result.file != source.file || result.line != source.line)
+    {
+      result = source;
+      result.formatString.resize(source.formatString.size() - scopeFormatSuffix.size());
+      result.argumentTags.resize(source.argumentTags.size() - scopeDurationTag.size());
+    }
+    return result;
+  }
+
+private:
+  binlog::PrettyPrinter _printer;
+  std::ostringstream _buffer;
+  std::map<std::uint64_t, binlog::EventSource> _scopeSources;
+};
+
+} // namespace
+
+void writeChromeTrace(binlog::EntryStream& input, std::ostream& out)
+{
+  binlog::EventStream eventStream;
+  MessagePrinter printer;
+  std::map<std::uint64_t, std::string> writerNames; // of the thread_name events written
+
+  out << "{\"traceEvents\":[";
+  const char* separator = "\n";
+
+  while (const binlog::Event* event = eventStream.nextEvent(input))
+  {
+    const binlog::WriterProp& writer = eventStream.writerProp();
+    const binlog::ClockSync& clockSync = eventStream.clockSync();
+
+    auto name = writerNames.find(writer.id);
+    if (name == writerNames.end() || name->second != writer.name)
+    {
+      writerNames[writer.id] = writer.name;
+      out << separator << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << writer.id << ",\"args\":{\"name\":";
+      writeJsonString(out, writer.name);
+      out << "}}";
+      separator = ",\n";
+    }
+
+    const bool hasClock = std::int64_t(clockSync.clockFrequency) > 0;
+    const std::int64_t ts = hasClock
+      ? binlog::clockToNsSinceEpoch(clockSync, event->clockValue).count()
+      : std::int64_t(event->clockValue);
+
+    const bool scope = isScope(*event->source) && event->arguments.size() >= sizeof(std::uint64_t);
+    std::uint64_t ticks = 0;
+    std::string message;
+    if (scope)
+    {
+      binlog::Range durationRange = event->arguments;
+      durationRange.view(durationRange.size() - sizeof(std::uint64_t));
+      ticks = durationRange.read<std::uint64_t>();
+
+      binlog::Event withoutDuration = *event;
+      withoutDuration.source = &printer.withoutDuration(*event->source);
+      message = printer.message(withoutDuration, writer, clockSync);
+    }
+    else
+    {
+      message = printer.message(*event, writer, clockSync);
+    }
+
+    out << separator << "{\"name\":";
+    writeJsonString(out, message);
+    out << ",\"cat\":";
+    writeJsonString(out, event->source->category);
+    out << ",\"ph\":\"" << (scope ? 'X' : 'i') << "\",\"ts\":";
+    writeMicroseconds(out, ts);
+    if (scope)
+    {
+      out << ",\"dur\":";
+      writeMicroseconds(out, hasClock ? binlog::ticksToNanoseconds(clockSync.clockFrequency, std::int64_t(ticks)).count() : std::int64_t(ticks));
+    }
+    else
+    {
+      out << ",\"s\":\"t\"";
+    }
+    out << ",\"pid\":1,\"tid\":" << writer.id << "}";
+    separator = ",\n";
+  }
+
+  out << "\n]}\n";
+}
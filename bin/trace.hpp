@@ -0,0 +1,25 @@
+#ifndef BINLOG_BIN_TRACE_HPP
+#define BINLOG_BIN_TRACE_HPP
+
+#include <iosfwd>
+
+namespace binlog {
+class EntryStream;
+} // namespace binlog
+
+/**
+ * Write the events of `input` to `out`, in the Chrome trace
+ * JSON format (as loaded by chrome://tracing, or the Perfetto UI).
+ *
+ * Scope events (see BINLOG_SCOPE_WC) become complete events ("ph":"X"),
+ * with the duration of the scope, other events become instant events ("ph":"i").
+ * The name of a trace event is the message of the log event (without the duration),
+ * its category is the category of the log event. The timeline of each writer
+ * is a thread (tid is the writer id), named by the writer name.
+ *
+ * Timestamps are converted to microseconds since the UNIX epoch,
+ * if there is a clock sync, otherwise, the raw clock value is used.
+ */
+void writeChromeTrace(binlog::EntryStream& input, std::ostream& out);
+
+#endif // BINLOG_BIN_TRACE_HPP
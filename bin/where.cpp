@@ -0,0 +1,959 @@
+#include "where.hpp"
+
+#include "printers.hpp"
+
+#include <binlog/PrettyPrinter.hpp>
+#include <binlog/Severity.hpp>
+#include <binlog/detail/CompactEvents.hpp>
+#include <binlog/detail/EventSourceTable.hpp>
+#include <binlog/detail/ForEachEntry.hpp>
+#include <binlog/detail/FormatSpec.hpp>
+#include <binlog/detail/IndexedValues.hpp>
+
+#include <mserialize/deserialize.hpp>
+#include <mserialize/detail/packed_integer.hpp>
+#include <mserialize/detail/tag_util.hpp>
+#include <mserialize/string_view.hpp>
+#include <mserialize/skip.hpp>
+
+#include <cstring> // memchr, memcmp, memcpy
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+/** @returns the size of the arithmetic `tag`, or 0, if it is not one of the comparable tags */
+std::size_t fixedWidth(mserialize::string_view tag)
+{
+  if (tag.size() != 1) { return 0; }
+  switch (tag[0])
+  {
+    case 'y': case 'c': case 'b': case 'B': return 1;
+    case 's': case 'S': return 2;
+    case 'i': case 'I': case 'f': return 4;
+    case 'l': case 'L': case 'd': return 8;
+    default: return 0;
+  }
+}
+
+/** @returns the position of the argument of the {name} placeholder of `source`, or size_t(-1) */
+std::size_t argumentIndexOf(const binlog::EventSource& source, const std::string& name)
+{
+  if (! binlog::detail::names_are_placeholders(source.formatString, source.argumentTags)) { return std::size_t(-1); }
+  return binlog::detail::find_placeholder(source.formatString.c_str(), name.data(), name.size());
+}
+
+bool isSignedTag(char tag)
+{
+  return tag == 'b' || tag == 's' || tag == 'i' || tag == 'l' || tag == 'q'
+      || (tag == 'c' && std::numeric_limits<char>::is_signed);
+}
+
+/** @returns the rank of the severity named `name`, or 0, if there's no such severity */
+std::uint64_t severityRank(const std::string& name)
+{
+  static const std::pair<const char*, binlog::Severity> severities[] = {
+    {"trace", binlog::Severity::trace}, {"TRAC", binlog::Severity::trace},
+    {"debug", binlog::Severity::debug}, {"DEBG", binlog::Severity::debug},
+    {"info", binlog::Severity::info}, {"INFO", binlog::Severity::info},
+    {"warning", binlog::Severity::warning}, {"WARN", binlog::Severity::warning},
+    {"error", binlog::Severity::error}, {"ERRO", binlog::Severity::error},
+    {"critical", binlog::Severity::critical}, {"CRIT", binlog::Severity::critical},
+  };
+
+  for (const auto& severity : severities)
+  {
+    if (name == severity.first) { return std::uint64_t(severity.second); }
+  }
+  return 0;
+}
+
+} // namespace
+
+/** Parses an expression to the nodes of a WherePredicate */
+class WherePredicate::Parser
+{
+public:
+  Parser(const std::string& expression, std::vector<Node>& nodes)
+    :_expr(expression),
+     _nodes(nodes)
+  {}
+
+  void parse()
+  {
+    next();
+    parseOr();
+    if (! _token.empty() || _quoted)
+    {
+      error("unexpected '" + _token + "'");
+    }
+  }
+
+private:
+  std::size_t parseOr()
+  {
+    std::size_t lhs = parseAnd();
+    while (accept("||"))
+    {
+      const std::size_t rhs = parseAnd();
+      lhs = pushLogical(Kind::logicalOr, lhs, rhs);
+    }
+    return lhs;
+  }
+
+  std::size_t parseAnd()
+  {
+    std::size_t lhs = parseUnary();
+    while (accept("&&"))
+    {
+      const std::size_t rhs = parseUnary();
+      lhs = pushLogical(Kind::logicalAnd, lhs, rhs);
+    }
+    return lhs;
+  }
+
+  std::size_t parseUnary()
+  {
+    if (accept("!"))
+    {
+      const std::size_t operand = parseUnary();
+      return pushLogical(Kind::logicalNot, operand, 0);
+    }
+
+    if (accept("("))
+    {
+      const std::size_t result = parseOr();
+      if (! accept(")")) { error("expected ')'"); }
+      return result;
+    }
+
+    return parseComparison();
+  }
+
+  std::size_t parseComparison()
+  {
+    Node node;
+    node.kind = Kind::source;
+
+    const std::string field = word("field");
+    if (field == "severity") { node.field = Field::severity; }
+    else if (field == "category") { node.field = Field::category; }
+    else if (field == "function") { node.field = Field::function; }
+    else if (field == "file") { node.field = Field::file; }
+    else if (field == "line") { node.field = Field::line; }
+    else if (field == "format") { node.field = Field::format; }
+    else if (field == "id") { node.field = Field::id; }
+    else if (field.size() > 3 && field.compare(0, 3, "arg") == 0 && parseIndex(field.substr(3), node.argumentIndex))
+    {
+      node.kind = Kind::argument;
+      node.field = Field::argument;
+    }
+    else if (field.size() > 4 && field.compare(0, 4, "arg.") == 0)
+    {
+      node.kind = Kind::argument;
+      node.field = Field::argument;
+      node.argumentName = field.substr(4);
+    }
+    else if (field == "value")
+    {
+      node.kind = Kind::anyValue;
+      node.field = Field::value;
+    }
+    else if (field == "message")
+    {
+      node.kind = Kind::message;
+      node.field = Field::message;
+    }
+    else { error("unknown field '" + field + "'"); }
+
+    if (accept("==")) { node.op = Op::eq; }
+    else if (accept("!=")) { node.op = Op::ne; }
+    else if (accept("<=")) { node.op = Op::le; }
+    else if (accept(">=")) { node.op = Op::ge; }
+    else if (accept("<")) { node.op = Op::lt; }
+    else if (accept(">")) { node.op = Op::gt; }
+    else if (accept("~")) { node.op = Op::contains; }
+    else { error("expected comparison after '" + field + "'"); }
+
+    if (_token.empty() && ! _quoted) { error("expected value after '" + field + "'"); }
+    if (! _quoted && isOperator(_token)) { error("unexpected '" + _token + "'"); }
+    node.text = _token;
+    next();
+
+    const bool isString = node.field == Field::category || node.field == Field::function
+                       || node.field == Field::file || node.field == Field::format;
+    if (node.field == Field::value)
+    {
+      if (node.op != Op::eq && node.op != Op::ne) { error("'value' can only be compared by == and !="); }
+    }
+    else if (node.field == Field::message)
+    {
+      if (node.op != Op::contains) { error("'message' can only be compared by ~"); }
+    }
+    else if (! isString)
+    {
+      if (node.op == Op::contains) { error("'~' can only be applied to strings"); }
+
+      if (node.field == Field::severity)
+      {
+        node.number.magnitude = severityRank(node.text);
+        node.number.real = double(node.number.magnitude);
+        node.number.integral = true;
+        if (node.number.magnitude == 0) { error("unknown severity '" + node.text + "'"); }
+      }
+      else if (! parseNumber(node.text, node.number))
+      {
+        error("expected number, got '" + node.text + "'");
+      }
+    }
+
+    _nodes.push_back(std::move(node));
+    return _nodes.size() - 1;
+  }
+
+  std::size_t pushLogical(Kind kind, std::size_t lhs, std::size_t rhs)
+  {
+    Node node;
+    node.kind = kind;
+    node.lhs = lhs;
+    node.rhs = rhs;
+    _nodes.push_back(std::move(node));
+    return _nodes.size() - 1;
+  }
+
+  static bool parseIndex(const std::string& str, std::size_t& result)
+  {
+    if (str.empty() || str.size() > 9) { return false; }
+    result = 0;
+    for (const char c : str)
+    {
+      if (c < '0' || c > '9') { return false; }
+      result = result * 10 + std::size_t(c - '0');
+    }
+    return true;
+  }
+
+  static bool parseNumber(const std::string& str, Number& result)
+  {
+    if (str.empty()) { return false; }
+
+    try
+    {
+      std::size_t end = 0;
+      result.real = std::stod(str, &end);
+      if (end != str.size()) { return false; }
+    }
+    catch (const std::exception&)
+    {
+      return false;
+    }
+
+    const std::size_t begin = (str[0] == '-' || str[0] == '+') ? 1 : 0;
+    result.negative = str[0] == '-';
+    result.integral = begin < str.size();
+    result.magnitude = 0;
+    for (std::size_t i = begin; i < str.size() && result.integral; ++i)
+    {
+      const char c = str[i];
+      const std::uint64_t digit = std::uint64_t(c - '0');
+      if (c < '0' || c > '9' || result.magnitude > (std::numeric_limits<std::uint64_t>::max() - digit) / 10)
+      {
+        result.integral = false; // compared as a floating point number
+      }
+      else
+      {
+        result.magnitude = result.magnitude * 10 + digit;
+      }
+    }
+
+    return true;
+  }
+
+  static bool isOperatorChar(char c)
+  {
+    return c == '(' || c == ')' || c == '!' || c == '=' || c == '<' || c == '>'
+        || c == '~' || c == '&' || c == '|' || c == '"';
+  }
+
+  static bool isOperator(const std::string& token)
+  {
+    return ! token.empty() && isOperatorChar(token[0]);
+  }
+
+  /** Read the next token to _token */
+  void next()
+  {
+    _token.clear();
+    _quoted = false;
+
+    while (_pos < _expr.size() && (_expr[_pos] == ' ' || _expr[_pos] == '\t')) { ++_pos; }
+    if (_pos == _expr.size()) { return; }
+
+    const char c = _expr[_pos];
+    if (c == '"')
+    {
+      _quoted = true;
+      for (++_pos; _pos < _expr.size() && _expr[_pos] != '"'; ++_pos)
+      {
+        if (_expr[_pos] == '\\' && _pos + 1 < _expr.size()) { ++_pos; }
+        _token += _expr[_pos];
+      }
+      if (_pos == _expr.size()) { error("unterminated string"); }
+      ++_pos;
+    }
+    else if (isOperatorChar(c))
+    {
+      static const char* const twoCharOperators[] = {"&&", "||", "==", "!=", "<=", ">="};
+      for (const char* op : twoCharOperators)
+      {
+        if (_expr.compare(_pos, 2, op) == 0)
+        {
+          _token = op;
+          _pos += 2;
+          return;
+        }
+      }
+      if (c == '&' || c == '|' || c == '=') { error(std::string("unexpected '") + c + "'"); }
+      _token = c;
+      ++_pos;
+    }
+    else
+    {
+      while (_pos < _expr.size() && _expr[_pos] != ' ' && _expr[_pos] != '\t' && ! isOperatorChar(_expr[_pos]))
+      {
+        _token += _expr[_pos++];
+      }
+    }
+  }
+
+  bool accept(const char* op)
+  {
+    if (_quoted || _token != op) { return false; }
+    next();
+    return true;
+  }
+
+  std::string word(const char* what)
+  {
+    if (_quoted || _token.empty() || isOperator(_token)) { error(std::string("expected ") + what); }
+    std::string result = std::move(_token);
+    next();
+    return result;
+  }
+
+  [[noreturn]] void error(const std::string& message) const
+  {
+    throw std::runtime_error("Invalid expression: " + message + " at position " + std::to_string(_pos) + " of: " + _expr);
+  }
+
+  const std::string& _expr;
+  std::vector<Node>& _nodes;
+  std::size_t _pos = 0;
+  std::string _token;
+  bool _quoted = false;
+};
+
+WherePredicate::WherePredicate(const std::string& expression)
+{
+  Parser(expression, _nodes).parse();
+}
+
+WherePredicate::SourcePredicate WherePredicate::bind(const binlog::EventSource& source) const
+{
+  SourcePredicate result;
+  result._root = bindNode(_nodes.size() - 1, source, result._nodes);
+  return result;
+}
+
+namespace {
+
+/** @returns the sign of `a - b`, or 2, if they are unordered */
+int compareReal(double a, double b)
+{
+  if (a < b) { return -1; }
+  if (a > b) { return 1; }
+  if (a == b) { return 0; }
+  return 2;
+}
+
+template <typename Number>
+int compareUnsigned(std::uint64_t a, const Number& b)
+{
+  if (! b.integral) { return compareReal(double(a), b.real); }
+  if (b.negative && b.magnitude != 0) { return 1; }
+  return (a < b.magnitude) ? -1 : (a > b.magnitude) ? 1 : 0;
+}
+
+template <typename Number>
+int compareSigned(std::int64_t a, const Number& b)
+{
+  if (! b.integral) { return compareReal(double(a), b.real); }
+
+  const std::uint64_t limit = std::uint64_t(std::numeric_limits<std::int64_t>::max());
+  if (! b.negative && b.magnitude > limit) { return -1; }
+  if (b.negative && b.magnitude > limit + 1) { return 1; }
+
+  const std::int64_t bv = b.negative ? -std::int64_t(b.magnitude - 1) - 1 : std::int64_t(b.magnitude);
+  return (a < bv) ? -1 : (a > bv) ? 1 : 0;
+}
+
+template <typename T>
+T readArithmetic(binlog::Range& input)
+{
+  T result;
+  memcpy(&result, input.view(sizeof(T)), sizeof(T));
+  return result;
+}
+
+/** @returns true if [data, data+size) contains `pattern`, candidates are found by memchr */
+bool containsText(const char* data, std::size_t size, const std::string& pattern)
+{
+  if (pattern.empty()) { return true; }
+
+  const char* const end = data + size;
+  for (const char* p = data; std::size_t(end - p) >= pattern.size(); ++p)
+  {
+    p = static_cast<const char*>(memchr(p, pattern[0], std::size_t(end - p) - pattern.size() + 1));
+    if (p == nullptr) { return false; }
+    if (memcmp(p + 1, pattern.data() + 1, pattern.size() - 1) == 0) { return true; }
+  }
+  return false;
+}
+
+/**
+ * @returns false if no message of `source` can contain `pattern`:
+ * the arguments are numbers (or bools), and the pattern has a character
+ * that is neither in the format string, nor in any formatted number.
+ */
+bool messageMayContain(const binlog::EventSource& source, const std::string& pattern)
+{
+  mserialize::string_view tags(source.argumentTags.data(), source.argumentTags.size());
+  while (! tags.empty())
+  {
+    const mserialize::string_view tag = mserialize::detail::tag_pop(tags);
+    if (tag.size() != 1 || mserialize::string_view("ybsilBSILfdqQ").find(tag[0]) == mserialize::string_view::npos)
+    {
+      return true; // strings, chars, structures, etc. can have any character
+    }
+  }
+
+  // digits, hex digits, prefixes, signs, exponents, inf, nan, true and false
+  static const std::string numberChars = "0123456789abcdefABCDEFxXbinINtruls+-. ";
+  for (const char c : pattern)
+  {
+    if (numberChars.find(c) == std::string::npos && source.formatString.find(c) == std::string::npos)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+class WherePredicate::MessageMatcher
+{
+public:
+  MessageMatcher(const binlog::EventSource& source, std::string pattern)
+    :_source(source),
+     _pattern(std::move(pattern)),
+     _printer("%m", "%Y-%m-%d %H:%M:%S.%N")
+  {
+    setupPrinter(_printer);
+
+    // the string arguments printed as they are: placeholders without precision
+    std::vector<bool> verbatim;
+    binlog::detail::FormatSpec spec;
+    bool invalid = false;
+    std::size_t nameSize = 0;
+    const bool names = binlog::detail::names_are_placeholders(_source.formatString, _source.argumentTags);
+    const char* format = _source.formatString.c_str();
+    for (const char* p = format; *p != 0;)
+    {
+      const char* end = binlog::detail::parse_placeholder(p, spec, invalid, nameSize, names);
+      if (end == nullptr) { ++p; continue; }
+      verbatim.push_back(spec.precision < 0);
+      p = end;
+    }
+
+    mserialize::string_view tags(_source.argumentTags.data(), _source.argumentTags.size());
+    while (! tags.empty())
+    {
+      const mserialize::string_view tag = mserialize::detail::tag_pop(tags);
+      Argument arg;
+      arg.verbatimString = tag == "[c" && _arguments.size() < verbatim.size() && verbatim[_arguments.size()];
+      arg.width = fixedWidth(tag);
+      if (! arg.verbatimString && arg.width == 0)
+      {
+        const std::string tuple = "(" + std::string(tag.data(), tag.size()) + ")";
+        arg.skipPlan = std::make_shared<const mserialize::VisitPlan>(mserialize::string_view(tuple.data(), tuple.size()));
+      }
+      _arguments.push_back(std::move(arg));
+    }
+  }
+
+  /** @throws std::runtime_error if `arguments` does not match the argument tags */
+  bool matches(binlog::Range arguments)
+  {
+    // the pattern is found in a string argument
+    binlog::Range input = arguments;
+    for (const Argument& arg : _arguments)
+    {
+      if (arg.verbatimString)
+      {
+        const std::uint32_t size = readArithmetic<std::uint32_t>(input);
+        if (containsText(input.view(size), size, _pattern)) { return true; }
+      }
+      else if (arg.skipPlan)
+      {
+        mserialize::skip(*arg.skipPlan, input);
+      }
+      else
+      {
+        input.view(arg.width);
+      }
+    }
+
+    // the pattern might span literal text and arguments, or be in a formatted argument
+    binlog::Event event;
+    event.source = &_source;
+    event.arguments = arguments;
+    _message.str(std::string());
+    _printer.printEvent(_message, event);
+    const std::string message = _message.str();
+    return containsText(message.data(), message.size(), _pattern);
+  }
+
+private:
+  struct Argument
+  {
+    bool verbatimString = false;
+    std::size_t width = 0; // if arithmetic
+    std::shared_ptr<const mserialize::VisitPlan> skipPlan; // if neither
+  };
+
+  binlog::EventSource _source;
+  std::string _pattern;
+  std::vector<Argument> _arguments;
+  binlog::PrettyPrinter _printer;
+  std::ostringstream _message;
+};
+
+std::size_t WherePredicate::bindNode(std::size_t index, const binlog::EventSource& source, std::vector<Node>& out) const
+{
+  const Node& node = _nodes[index];
+
+  const auto pushConstant = [&out](bool value)
+  {
+    Node constant;
+    constant.kind = Kind::constant;
+    constant.value = value;
+    out.push_back(std::move(constant));
+    return out.size() - 1;
+  };
+
+  const auto isConstant = [&out](std::size_t i, bool value)
+  {
+    return out[i].kind == Kind::constant && out[i].value == value;
+  };
+
+  switch (node.kind)
+  {
+    case Kind::constant:
+      return pushConstant(node.value);
+
+    case Kind::logicalNot:
+    {
+      const std::size_t operand = bindNode(node.lhs, source, out);
+      if (out[operand].kind == Kind::constant) { return pushConstant(! out[operand].value); }
+      Node result = node;
+      result.lhs = operand;
+      out.push_back(std::move(result));
+      return out.size() - 1;
+    }
+
+    case Kind::logicalAnd:
+    case Kind::logicalOr:
+    {
+      // x && false = false, x || true = true
+      const bool dominant = node.kind == Kind::logicalOr;
+      const std::size_t lhs = bindNode(node.lhs, source, out);
+      if (isConstant(lhs, dominant)) { return lhs; }
+      const std::size_t rhs = bindNode(node.rhs, source, out);
+      if (isConstant(rhs, dominant) || isConstant(lhs, ! dominant)) { return rhs; }
+      if (isConstant(rhs, ! dominant)) { return lhs; }
+      Node result = node;
+      result.lhs = lhs;
+      result.rhs = rhs;
+      out.push_back(std::move(result));
+      return out.size() - 1;
+    }
+
+    case Kind::source:
+    {
+      switch (node.field)
+      {
+        case Field::severity: return pushConstant(compare(node.op, compareUnsigned(std::uint64_t(source.severity), node.number)));
+        case Field::line:     return pushConstant(compare(node.op, compareUnsigned(source.line, node.number)));
+        case Field::id:       return pushConstant(compare(node.op, compareUnsigned(source.id, node.number)));
+        default: break;
+      }
+
+      const std::string& value =
+          (node.field == Field::category) ? source.category
+        : (node.field == Field::function) ? source.function
+        : (node.field == Field::file)     ? source.file
+        :                                   source.formatString;
+
+      if (node.op == Op::contains) { return pushConstant(value.find(node.text) != std::string::npos); }
+      const int cmp = value.compare(node.text);
+      return pushConstant(compare(node.op, (cmp < 0) ? -1 : (cmp > 0) ? 1 : 0));
+    }
+
+    case Kind::argument:
+    {
+      const std::size_t argumentIndex = (node.argumentName.empty()) ? node.argumentIndex
+        : argumentIndexOf(source, node.argumentName);
+
+      mserialize::string_view tags(source.argumentTags.data(), source.argumentTags.size());
+      const char* prefixBegin = tags.data();
+      std::size_t offset = 0;
+      bool fixedOffset = true;
+      for (std::size_t i = 0; i < argumentIndex; ++i)
+      {
+        if (tags.empty()) { return pushConstant(false); } // no such argument
+        const std::size_t width = fixedWidth(mserialize::detail::tag_pop(tags));
+        offset += width;
+        fixedOffset = fixedOffset && width != 0;
+      }
+      const char* prefixEnd = tags.data();
+
+      if (tags.empty()) { return pushConstant(false); } // no such argument
+      const mserialize::string_view tag = mserialize::detail::tag_pop(tags);
+      if (fixedWidth(tag) == 0 && tag != "q" && tag != "Q") { return pushConstant(false); } // not comparable
+
+      Node result = node;
+      result.argumentTag = tag[0];
+      result.argumentOffset = offset;
+      if (! fixedOffset)
+      {
+        const std::string prefix = "(" + std::string(prefixBegin, std::size_t(prefixEnd - prefixBegin)) + ")";
+        result.skipPlan = std::make_shared<const mserialize::VisitPlan>(mserialize::string_view(prefix.data(), prefix.size()));
+      }
+      out.push_back(std::move(result));
+      return out.size() - 1;
+    }
+
+    case Kind::anyValue:
+    {
+      Node result = node;
+      result.argumentTags = source.argumentTags;
+      out.push_back(std::move(result));
+      return out.size() - 1;
+    }
+
+    case Kind::message:
+    {
+      // decided by the literal text of the format string, without the arguments?
+      binlog::detail::FormatSpec spec;
+      bool invalid = false;
+      std::size_t nameSize = 0;
+      const bool names = binlog::detail::names_are_placeholders(source.formatString, source.argumentTags);
+      bool hasPlaceholder = false;
+      const char* literal = source.formatString.c_str();
+      for (const char* p = literal;;)
+      {
+        const char* end = (*p != 0) ? binlog::detail::parse_placeholder(p, spec, invalid, nameSize, names) : nullptr;
+        if (*p != 0 && end == nullptr) { ++p; continue; }
+
+        // [literal, p) is text between placeholders
+        if (std::string(literal, p).find(node.text) != std::string::npos) { return pushConstant(true); }
+        if (*p == 0) { break; }
+
+        hasPlaceholder = true;
+        literal = p = end;
+      }
+      if (! hasPlaceholder || ! messageMayContain(source, node.text)) { return pushConstant(false); }
+
+      Node result = node;
+      result.message = std::make_shared<MessageMatcher>(source, node.text);
+      out.push_back(std::move(result));
+      return out.size() - 1;
+    }
+  }
+
+  return pushConstant(false);
+}
+
+const std::string* WherePredicate::requiredValue() const
+{
+  return requiredValue(_nodes.size() - 1);
+}
+
+const std::string* WherePredicate::requiredValue(std::size_t index) const
+{
+  const Node& node = _nodes[index];
+  if (node.kind == Kind::anyValue && node.op == Op::eq) { return &node.text; }
+  if (node.kind == Kind::logicalAnd)
+  {
+    const std::string* lhs = requiredValue(node.lhs);
+    return (lhs != nullptr) ? lhs : requiredValue(node.rhs);
+  }
+  return nullptr;
+}
+
+bool WherePredicate::compare(Op op, int cmp)
+{
+  switch (op)
+  {
+    case Op::eq: return cmp == 0;
+    case Op::ne: return cmp != 0;
+    case Op::lt: return cmp == -1;
+    case Op::le: return cmp == -1 || cmp == 0;
+    case Op::gt: return cmp == 1;
+    case Op::ge: return cmp == 1 || cmp == 0;
+    case Op::contains: return false;
+  }
+  return false;
+}
+
+int WherePredicate::compareNumber(const binlog::Range& arguments, const Node& node)
+{
+  binlog::Range input = arguments;
+  if (node.skipPlan)
+  {
+    mserialize::skip(*node.skipPlan, input);
+  }
+  else
+  {
+    input.view(node.argumentOffset);
+  }
+
+  const Number& b = node.number;
+  switch (node.argumentTag)
+  {
+    case 'y': return compareUnsigned(std::uint64_t{readArithmetic<bool>(input) ? 1u : 0u}, b);
+    case 'c':
+    {
+      const char c = readArithmetic<char>(input);
+      return isSignedTag('c') ? compareSigned(c, b) : compareUnsigned(std::uint64_t(static_cast<unsigned char>(c)), b);
+    }
+    case 'b': return compareSigned(readArithmetic<std::int8_t>(input), b);
+    case 's': return compareSigned(readArithmetic<std::int16_t>(input), b);
+    case 'i': return compareSigned(readArithmetic<std::int32_t>(input), b);
+    case 'l': return compareSigned(readArithmetic<std::int64_t>(input), b);
+    case 'B': return compareUnsigned(readArithmetic<std::uint8_t>(input), b);
+    case 'S': return compareUnsigned(readArithmetic<std::uint16_t>(input), b);
+    case 'I': return compareUnsigned(readArithmetic<std::uint32_t>(input), b);
+    case 'L': return compareUnsigned(readArithmetic<std::uint64_t>(input), b);
+    case 'f': return compareReal(double(readArithmetic<float>(input)), b.real);
+    case 'd': return compareReal(readArithmetic<double>(input), b.real);
+    case 'q': return compareSigned(std::int64_t(mserialize::detail::deserialize_packed(input)), b);
+    case 'Q': return compareUnsigned(mserialize::detail::deserialize_packed(input), b);
+    default: return 2;
+  }
+}
+
+bool WherePredicate::SourcePredicate::alwaysTrue() const
+{
+  return _nodes[_root].kind == Kind::constant && _nodes[_root].value;
+}
+
+bool WherePredicate::SourcePredicate::alwaysFalse() const
+{
+  return _nodes[_root].kind == Kind::constant && ! _nodes[_root].value;
+}
+
+bool WherePredicate::SourcePredicate::matches(binlog::Range arguments) const
+{
+  return evaluate(_root, arguments);
+}
+
+bool WherePredicate::SourcePredicate::evaluate(std::size_t index, const binlog::Range& arguments) const
+{
+  const Node& node = _nodes[index];
+  switch (node.kind)
+  {
+    case Kind::constant:   return node.value;
+    case Kind::logicalNot: return ! evaluate(node.lhs, arguments);
+    case Kind::logicalAnd: return evaluate(node.lhs, arguments) && evaluate(node.rhs, arguments);
+    case Kind::logicalOr:  return evaluate(node.lhs, arguments) || evaluate(node.rhs, arguments);
+    case Kind::argument:
+      try
+      {
+        return WherePredicate::compare(node.op, WherePredicate::compareNumber(arguments, node));
+      }
+      catch (const std::runtime_error&)
+      {
+        return false; // invalid arguments, let the reader of the accepted events report them
+      }
+    case Kind::anyValue:
+      try
+      {
+        bool found = false;
+        binlog::detail::forEachIndexedValue(
+          mserialize::string_view(node.argumentTags.data(), node.argumentTags.size()), arguments,
+          [&](const char* value, std::size_t size)
+          {
+            found = found || (size == node.text.size() && memcmp(value, node.text.data(), size) == 0);
+          }
+        );
+        return found == (node.op == Op::eq);
+      }
+      catch (const std::runtime_error&)
+      {
+        return false;
+      }
+    case Kind::message:
+      try
+      {
+        return node.message->matches(arguments);
+      }
+      catch (const std::runtime_error&)
+      {
+        return false;
+      }
+    case Kind::source:     return false; // unreachable, bound to a constant
+  }
+  return false;
+}
+
+NumericArgument::NumericArgument(const binlog::EventSource& source, const std::string& name)
+  :NumericArgument(source, argumentIndexOf(source, name))
+{}
+
+NumericArgument::NumericArgument(const binlog::EventSource& source, std::size_t index)
+{
+  mserialize::string_view tags(source.argumentTags.data(), source.argumentTags.size());
+  const char* prefixBegin = tags.data();
+  bool fixedOffset = true;
+  for (std::size_t i = 0; i < index; ++i)
+  {
+    if (tags.empty()) { return; } // no such argument
+    const std::size_t width = fixedWidth(mserialize::detail::tag_pop(tags));
+    _offset += width;
+    fixedOffset = fixedOffset && width != 0;
+  }
+  const char* prefixEnd = tags.data();
+
+  if (tags.empty()) { return; } // no such argument
+  const mserialize::string_view tag = mserialize::detail::tag_pop(tags);
+  if (fixedWidth(tag) == 0 && tag != "q" && tag != "Q") { return; } // not arithmetic
+
+  _tag = tag[0];
+  if (! fixedOffset)
+  {
+    const std::string prefix = "(" + std::string(prefixBegin, std::size_t(prefixEnd - prefixBegin)) + ")";
+    _skipPlan = std::make_shared<const mserialize::VisitPlan>(mserialize::string_view(prefix.data(), prefix.size()));
+  }
+}
+
+double NumericArgument::read(binlog::Range arguments) const
+{
+  if (_skipPlan)
+  {
+    mserialize::skip(*_skipPlan, arguments);
+  }
+  else
+  {
+    arguments.view(_offset);
+  }
+
+  switch (_tag)
+  {
+    case 'y': return readArithmetic<bool>(arguments) ? 1 : 0;
+    case 'c':
+    {
+      const char c = readArithmetic<char>(arguments);
+      return isSignedTag('c') ? double(c) : double(static_cast<unsigned char>(c));
+    }
+    case 'b': return readArithmetic<std::int8_t>(arguments);
+    case 's': return readArithmetic<std::int16_t>(arguments);
+    case 'i': return readArithmetic<std::int32_t>(arguments);
+    case 'l': return double(readArithmetic<std::int64_t>(arguments));
+    case 'B': return readArithmetic<std::uint8_t>(arguments);
+    case 'S': return readArithmetic<std::uint16_t>(arguments);
+    case 'I': return readArithmetic<std::uint32_t>(arguments);
+    case 'L': return double(readArithmetic<std::uint64_t>(arguments));
+    case 'f': return double(readArithmetic<float>(arguments));
+    case 'd': return readArithmetic<double>(arguments);
+    case 'q': return double(std::int64_t(mserialize::detail::deserialize_packed(arguments)));
+    case 'Q': return double(mserialize::detail::deserialize_packed(arguments));
+    default: return 0;
+  }
+}
+
+WhereEntryStream::WhereEntryStream(binlog::EntryStream& input, const WherePredicate& predicate)
+  :_input(input),
+   _predicate(predicate)
+{}
+
+binlog::Range WhereEntryStream::nextEntryPayload()
+{
+  while (true)
+  {
+    if (! _compactEvents.empty())
+    {
+      binlog::detail::CompactEvent event = binlog::detail::nextCompactEvent(_compactEvents, _compactDecoder);
+      if (! accepts(event.sourceId, event.arguments)) { continue; }
+
+      // return the event as a regular event entry, without the size prefix
+      const std::size_t argumentsSize = event.arguments.size();
+      _buffer.resize(2 * sizeof(std::uint64_t) + argumentsSize);
+      memcpy(_buffer.data(), &event.sourceId, sizeof(std::uint64_t));
+      memcpy(_buffer.data() + sizeof(std::uint64_t), &event.clockValue, sizeof(std::uint64_t));
+      memcpy(_buffer.data() + 2 * sizeof(std::uint64_t), event.arguments.view(0), argumentsSize);
+      return binlog::Range(_buffer.data(), _buffer.size());
+    }
+
+    const binlog::Range payload = _input.nextEntryPayload();
+    if (payload.size() < sizeof(std::uint64_t)) { return payload; } // end of input, or invalid entry
+
+    binlog::Range entry = payload;
+    const std::uint64_t tag = entry.read<std::uint64_t>();
+
+    if (tag == binlog::EventSource::Tag)
+    {
+      binlog::EventSource source;
+      mserialize::deserialize(source, entry);
+      _sources.emplace(source.id, _predicate.bind(source));
+    }
+    else if (tag == binlog::EventSourceTable::Tag)
+    {
+      binlog::detail::readEventSourceTable(entry, [this](binlog::EventSource&& source)
+      {
+        _sources.emplace(source.id, _predicate.bind(source));
+      });
+    }
+    else if (tag == binlog::CompactEvents::Tag)
+    {
+      const std::uint8_t version = entry.empty() ? 0 : entry.read<std::uint8_t>();
+      if (binlog::detail::isSupportedCompactVersion(version))
+      {
+        _compactEvents = entry;
+        _compactDecoder = binlog::detail::CompactDecoder(version);
+        continue;
+      }
+      // else: let the reader report the unsupported version
+    }
+    else if (! binlog::detail::isSpecialEntryTag(tag) && entry.size() >= sizeof(std::uint64_t))
+    {
+      entry.read<std::uint64_t>(); // clock
+      if (! accepts(tag, entry)) { continue; }
+    }
+
+    return payload;
+  }
+}
+
+bool WhereEntryStream::accepts(std::uint64_t sourceId, binlog::Range arguments) const
+{
+  const WherePredicate::SourcePredicate* source = _sources.find(sourceId);
+  if (source == _sources.end()) { return true; } // let the reader report the invalid source id
+
+  if (source->alwaysTrue()) { return true; }
+  if (source->alwaysFalse()) { return false; }
+  return source->matches(arguments);
+}
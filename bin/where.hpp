@@ -0,0 +1,205 @@
+#ifndef BINLOG_BIN_WHERE_HPP
+#define BINLOG_BIN_WHERE_HPP
+
+#include <binlog/Entries.hpp>
+#include <binlog/EntryStream.hpp>
+#include <binlog/Range.hpp>
+#include <binlog/detail/CompactEvents.hpp>
+#include <binlog/detail/SegmentedMap.hpp>
+
+#include <mserialize/VisitPlan.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * A predicate of events, parsed from an expression, e.g:
+ *
+ *    severity>=warning && category==orders && file~"Router" && arg0>100
+ *
+ * Grammar:
+ *
+ *    expression := and ('||' and)*
+ *    and        := unary ('&&' unary)*
+ *    unary      := '!' unary | '(' expression ')' | field op value
+ *    field      := severity | category | function | file | line | format | id | argN | arg.name | value | message
+ *    op         := '==' | '!=' | '<' | '<=' | '>' | '>=' | '~' (contains)
+ *    value      := word | "quoted string"
+ *
+ * `severity` is compared by rank, values are severity names (e.g: warning or WARN).
+ * `line`, `id` (the source id) and `argN` (the N'th argument, N = 0, 1, ...) are compared as numbers.
+ * `arg.name` is the argument of the {name} placeholder, resolved once per event source.
+ * `value==x` is true if any integer argument (in decimal) or string argument
+ * of the event, also the nested ones, equals x, it only supports '==' and '!='.
+ * `message~x` is true if the message of the event (the format string with the
+ * arguments substituted) contains x, it only supports '~'. The message is formatted
+ * only if the literal text of the format string and the string arguments do not decide it.
+ * Other fields are compared as strings.
+ *
+ * The comparisons of source fields are evaluated once per event source (see bind),
+ * the comparisons of arguments are evaluated on the serialized arguments of each event.
+ * Only arithmetic arguments can be compared: comparisons of other arguments,
+ * or of argument positions the event does not have, are false.
+ */
+class WherePredicate
+{
+  // the nodes of the parsed expression, defined first, as SourcePredicate stores them
+  enum class Kind : std::uint8_t { constant, logicalAnd, logicalOr, logicalNot, source, argument, anyValue, message };
+  enum class Field : std::uint8_t { severity, category, function, file, line, format, id, argument, value, message };
+
+  /** Searches the messages of the events of a source, see Kind::message */
+  class MessageMatcher;
+  enum class Op : std::uint8_t { eq, ne, lt, le, gt, ge, contains };
+
+  /** A numeric literal */
+  struct Number
+  {
+    double real = 0;
+    bool integral = false;
+    bool negative = false;
+    std::uint64_t magnitude = 0; // if integral
+  };
+
+  struct Node
+  {
+    Kind kind = Kind::constant;
+    bool value = false;            // of a constant
+    std::size_t lhs = 0;           // operand of not, and, or
+    std::size_t rhs = 0;           // operand of and, or
+    Field field = Field::severity; // of a comparison
+    Op op = Op::eq;                // of a comparison
+    std::string text;              // right side of a comparison
+    Number number;                 // right side of a numeric comparison
+    std::size_t argumentIndex = 0; // of an argument comparison
+    std::string argumentName;      // of an argument comparison by name (arg.name), if not empty
+
+    // of a bound argument comparison:
+    char argumentTag = 0;          // arithmetic tag, or q, Q
+    std::size_t argumentOffset = 0;
+    std::shared_ptr<const mserialize::VisitPlan> skipPlan; // of the preceding arguments, if not of fixed size
+
+    std::string argumentTags;      // of a bound value comparison
+
+    std::shared_ptr<MessageMatcher> message; // of a bound message comparison
+  };
+
+public:
+  /** The predicate, partially evaluated for an event source */
+  class SourcePredicate
+  {
+  public:
+    /** @returns true if events of the source can be accepted without looking at the arguments */
+    bool alwaysTrue() const;
+
+    /** @returns true if events of the source are rejected without looking at the arguments */
+    bool alwaysFalse() const;
+
+    /** @returns true if the event with the serialized `arguments` is accepted */
+    bool matches(binlog::Range arguments) const;
+
+  private:
+    friend class WherePredicate;
+
+    bool evaluate(std::size_t node, const binlog::Range& arguments) const;
+
+    std::vector<Node> _nodes;
+    std::size_t _root = 0;
+  };
+
+  /** @throws std::runtime_error if `expression` is invalid */
+  explicit WherePredicate(const std::string& expression);
+
+  SourcePredicate bind(const binlog::EventSource& source) const;
+
+  /**
+   * @returns a value which every accepted event has as an argument
+   *          (a `value==x` term, required by the top level conjunction),
+   *          or nullptr, if there's no such value.
+   *
+   * Allows skipping parts of a logfile without the value, see FindEntryStream.
+   */
+  const std::string* requiredValue() const;
+
+private:
+  class Parser;
+
+  std::size_t bindNode(std::size_t node, const binlog::EventSource& source, std::vector<Node>& out) const;
+
+  const std::string* requiredValue(std::size_t node) const;
+
+  static bool compare(Op op, int cmp);
+
+  static int compareNumber(const binlog::Range& arguments, const Node& node);
+
+  std::vector<Node> _nodes; // root is the last one
+};
+
+/**
+ * Reads an arithmetic argument of the events of an event source, by position.
+ *
+ * The position of the argument is computed once per source: if the preceding
+ * arguments are of fixed size, it is read at a fixed offset, otherwise
+ * the preceding arguments are skipped (without visiting them) on each read.
+ */
+class NumericArgument
+{
+public:
+  /** Bind to the `index`-th argument of the events of `source` */
+  NumericArgument(const binlog::EventSource& source, std::size_t index);
+
+  /** Bind to the argument of the {name} placeholder of `source`, if any */
+  NumericArgument(const binlog::EventSource& source, const std::string& name);
+
+  /** @returns false if the events of the source have no such arithmetic (or packed integer) argument */
+  bool valid() const { return _tag != 0; }
+
+  /**
+   * @returns the argument of the event with the serialized `arguments`, converted to double
+   * @pre valid()
+   * @throws std::runtime_error if `arguments` is too short
+   */
+  double read(binlog::Range arguments) const;
+
+private:
+  char _tag = 0;
+  std::size_t _offset = 0;
+  std::shared_ptr<const mserialize::VisitPlan> _skipPlan; // of the preceding arguments, if not of fixed size
+};
+
+/**
+ * Forwards the entries of an underlying stream, except
+ * the events rejected by a WherePredicate.
+ *
+ * Events of a source are rejected by the entry tag if the
+ * source comparisons alone decide the predicate, without
+ * reading the arguments. Events of CompactEvents entries
+ * are decoded, and the accepted ones are returned as regular event entries.
+ */
+class WhereEntryStream : public binlog::EntryStream
+{
+public:
+  /** Stores references to `input` and `predicate`: they must remain valid as long as *this */
+  WhereEntryStream(binlog::EntryStream& input, const WherePredicate& predicate);
+
+  /**
+   * @see EntryStream::nextEntryPayload
+   *
+   * The returned payload is valid until the next call.
+   */
+  binlog::Range nextEntryPayload() override;
+
+private:
+  bool accepts(std::uint64_t sourceId, binlog::Range arguments) const;
+
+  binlog::EntryStream& _input;
+  const WherePredicate& _predicate;
+  binlog::detail::SegmentedMap<WherePredicate::SourcePredicate> _sources; // by id
+  binlog::Range _compactEvents;    // the remaining events of the current CompactEvents entry
+  binlog::detail::CompactDecoder _compactDecoder; // of _compactEvents
+  std::vector<char> _buffer;       // a decoded compact event, as a regular event entry
+};
+
+#endif // BINLOG_BIN_WHERE_HPP
@@ -0,0 +1,368 @@
+#ifndef BINLOG_ARGUMENT_FILTER_HPP
+#define BINLOG_ARGUMENT_FILTER_HPP
+
+#include <binlog/Entries.hpp> // EventSource
+#include <binlog/Range.hpp>
+#include <binlog/detail/ForEachEntry.hpp>
+#include <binlog/detail/SourceIdMap.hpp>
+
+#include <mserialize/VisitPlan.hpp>
+#include <mserialize/deserialize.hpp>
+#include <mserialize/skip.hpp>
+
+#include <algorithm> // min
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib> // strtoll, strtoull, strtod
+#include <cstring> // memcmp
+#include <functional>
+#include <ios> // streamsize
+#include <memory>
+#include <string>
+#include <utility> // move
+#include <vector>
+
+namespace binlog {
+
+/**
+ * From a stream of entries, pass through events whose arguments
+ * satisfy the conditions set for their event source, e.g:
+ * drop the heartbeat events of status "OK", or keep only the orders of an account.
+ *
+ * The conditions are compiled once per event source, when its EventSource entry is read:
+ * the value of the condition is parsed as the type of the argument,
+ * and if the arguments before it are of fixed size (e.g: numbers),
+ * the byte offset of the argument is computed. Events are checked
+ * directly on their serialized arguments, other arguments are not visited.
+ *
+ * Example:
+ *
+ *    binlog::ArgumentFilter filter({
+ *      // drop heartbeats of status OK, i.e: keep the others
+ *      {[](const binlog::EventSource& s) { return s.category == "heartbeat"; }, 0, binlog::ArgumentFilter::Comparison::notEqual, "OK"},
+ *      // keep orders of account 42 only
+ *      {[](const binlog::EventSource& s) { return s.formatString == "Order {} of account {}"; }, 1, binlog::ArgumentFilter::Comparison::equal, "42"},
+ *    });
+ *    // in the write(buffer, size) of the consumed OutputStream:
+ *    filter.writeAllowed(buffer, size, logfile);
+ */
+class ArgumentFilter
+{
+public:
+  enum class Comparison { equal, notEqual, less, lessEqual, greater, greaterEqual };
+
+  /** Keep the events of the selected sources only if their argument compares to `value` */
+  struct Condition
+  {
+    std::function<bool(const EventSource&)> appliesTo; /**< Selects the sources, called once per source */
+    std::size_t argument = 0;                  /**< Zero based position of the argument */
+    Comparison comparison = Comparison::equal;
+    std::string value; /**< A number or a string, as the argument. Chars compare as one character strings */
+  };
+
+  /**
+   * If an event source is selected by multiple conditions, its events must satisfy each.
+   * If the argument is missing, is not a number, char or string (e.g: a structure),
+   * or the value is not valid for its type (e.g: "abc" for an int),
+   * only the notEqual comparison holds.
+   */
+  explicit ArgumentFilter(std::vector<Condition> conditions);
+
+  /**
+   * From the sequence of entries in [buffer, buffer+bufferSize),
+   * write special entries, and events satisfying the conditions of their source to `out`.
+   * Events of sources without conditions are written.
+   *
+   * @requires OutputStream must model the mserialize::OutputStream concept
+   * @throws std::runtime_error if `buffer` contains an invalid entry
+   * @returns the number of bytes written to `out`
+   */
+  template <typename OutputStream>
+  std::size_t writeAllowed(const char* buffer, std::size_t bufferSize, OutputStream& out);
+
+  /** @returns the number of events dropped so far */
+  std::uint64_t droppedEvents() const { return _droppedEvents; }
+
+private:
+  /** How an argument is compared */
+  enum class Kind { constant, signedInteger, unsignedInteger, floating, string };
+
+  /** A Condition, compiled for an event source */
+  struct Check
+  {
+    Kind kind = Kind::constant;
+    Comparison comparison = Comparison::equal;
+    bool constant = false;      // the result, if kind is constant
+    std::uint32_t offset = 0;   // of the argument, if not variableOffset
+    std::uint32_t op = 0;       // of the argument in the plan of the source
+    char tag = 0;               // arithmetic tag of the argument
+    bool negative = false;      // the value is a negative integer (in `i`), else in `u`
+    std::int64_t i = 0;
+    std::uint64_t u = 0;
+    double d = 0;
+    std::string s;
+  };
+
+  struct CompiledSource
+  {
+    std::vector<Check> checks;
+    std::shared_ptr<mserialize::VisitPlan> plan; // "(argumentTags)", to skip variable sized arguments
+  };
+
+  static constexpr std::uint32_t variableOffset = ~std::uint32_t(0);
+
+  void compileSource(const EventSource& source);
+
+  static Check compileCheck(const Condition& condition, const mserialize::VisitPlan& plan);
+
+  /** @returns true if `arguments` satisfy every check of `source` */
+  static bool isAllowed(const CompiledSource& source, Range arguments);
+
+  static bool evaluate(const Check& check, const mserialize::VisitPlan& plan, Range arguments);
+
+  /** @returns -1, 0 or 1, as a is less, equal or greater than b */
+  template <typename T>
+  static int compare(T a, T b) { return (a < b) ? -1 : (b < a) ? 1 : 0; }
+
+  static bool holds(Comparison comparison, int cmp);
+
+  std::vector<Condition> _conditions;
+  std::vector<CompiledSource> _sources;
+  detail::SourceIdMap<std::uint32_t> _sourceIndices; // index in _sources + 1 by id, 0 if no conditions
+  std::uint64_t _droppedEvents = 0;
+};
+
+inline ArgumentFilter::ArgumentFilter(std::vector<Condition> conditions)
+  :_conditions(std::move(conditions))
+{}
+
+inline void ArgumentFilter::compileSource(const EventSource& source)
+{
+  CompiledSource compiled;
+  for (const Condition& condition : _conditions)
+  {
+    if (! condition.appliesTo(source)) { continue; }
+    if (! compiled.plan)
+    {
+      compiled.plan = std::make_shared<mserialize::VisitPlan>("(" + source.argumentTags + ")");
+    }
+    compiled.checks.push_back(compileCheck(condition, *compiled.plan));
+  }
+
+  std::uint32_t index = 0;
+  if (! compiled.checks.empty())
+  {
+    _sources.push_back(std::move(compiled));
+    index = std::uint32_t(_sources.size());
+  }
+
+  _sourceIndices.set(source.id, index);
+}
+
+inline ArgumentFilter::Check ArgumentFilter::compileCheck(const Condition& condition, const mserialize::VisitPlan& plan)
+{
+  using OpCode = mserialize::VisitPlan::OpCode;
+  const std::vector<mserialize::VisitPlan::Op>& ops = plan.ops();
+
+  Check check;
+  check.comparison = condition.comparison;
+  check.constant = condition.comparison == Comparison::notEqual;
+
+  // find the argument, and its offset, if the arguments before it are of fixed size
+  if (ops.empty() || ops[0].code != OpCode::Tuple) { return check; }
+  std::uint32_t op = 1;
+  std::uint32_t offset = 0;
+  for (std::size_t i = 0; i < condition.argument; ++i)
+  {
+    if (op == ops[0].end) { return check; }
+    offset = (offset == variableOffset || ops[op].fixed_size == mserialize::VisitPlan::variable_size)
+      ? variableOffset : offset + ops[op].fixed_size;
+    op = ops[op].end;
+  }
+  if (op == ops[0].end) { return check; }
+
+  const std::string& value = condition.value;
+  const char* const end = value.data() + value.size();
+  char* parsedEnd = nullptr;
+  errno = 0;
+
+  const mserialize::VisitPlan::Op& arg = ops[op];
+  if (arg.code == OpCode::Sequence && ops[op + 1].code == OpCode::Arithmetic && ops[op + 1].arithmetic == 'c')
+  {
+    check.kind = Kind::string;
+    check.s = value;
+  }
+  else if (arg.code != OpCode::Arithmetic)
+  {
+    return check;
+  }
+  else if (arg.arithmetic == 'c')
+  {
+    if (value.size() != 1) { return check; }
+    check.kind = Kind::string;
+    check.s = value;
+  }
+  else if (arg.arithmetic == 'y')
+  {
+    if (value != "true" && value != "false" && value != "0" && value != "1") { return check; }
+    check.kind = Kind::unsignedInteger;
+    check.u = (value == "true" || value == "1") ? 1 : 0;
+  }
+  else if (arg.arithmetic == 'f' || arg.arithmetic == 'd')
+  {
+    check.d = std::strtod(value.c_str(), &parsedEnd);
+    if (value.empty() || parsedEnd != end) { return check; }
+    check.kind = Kind::floating;
+  }
+  else if (std::string("bsilBSIL").find(arg.arithmetic) != std::string::npos)
+  {
+    // the value is compared as a 64 bit integer, of either sign
+    check.negative = ! value.empty() && value.front() == '-';
+    if (check.negative) { check.i = std::strtoll(value.c_str(), &parsedEnd, 10); }
+    else                { check.u = std::strtoull(value.c_str(), &parsedEnd, 10); }
+    if (value.empty() || parsedEnd != end || errno == ERANGE) { return check; }
+    check.kind = (mserialize::detail::is_signed_integer_tag(arg.arithmetic)) ? Kind::signedInteger : Kind::unsignedInteger;
+  }
+  else
+  {
+    return check; // long double, packed integers
+  }
+
+  check.offset = offset;
+  check.op = op;
+  check.tag = arg.arithmetic;
+  return check;
+}
+
+inline bool ArgumentFilter::isAllowed(const CompiledSource& source, Range arguments)
+{
+  for (const Check& check : source.checks)
+  {
+    if (! evaluate(check, *source.plan, arguments)) { return false; }
+  }
+  return true;
+}
+
+inline bool ArgumentFilter::evaluate(const Check& check, const mserialize::VisitPlan& plan, Range arguments)
+{
+  if (check.kind == Kind::constant) { return check.constant; }
+
+  if (check.offset != variableOffset)
+  {
+    arguments.view(check.offset);
+  }
+  else
+  {
+    // skip the arguments before the checked one
+    const std::vector<mserialize::VisitPlan::Op>& ops = plan.ops();
+    for (std::uint32_t op = 1; op != check.op; op = ops[op].end)
+    {
+      mserialize::detail::skip_plan_impl(plan, op, arguments, plan.max_recursion());
+    }
+  }
+
+  int cmp = 0;
+  switch (check.kind)
+  {
+  case Kind::signedInteger:
+  {
+    std::int64_t a = 0;
+    switch (check.tag)
+    {
+      case 'b': a = arguments.read<std::int8_t>(); break;
+      case 's': a = arguments.read<std::int16_t>(); break;
+      case 'i': a = arguments.read<std::int32_t>(); break;
+      default:  a = arguments.read<std::int64_t>(); break;
+    }
+    cmp = (check.negative) ? compare(a, check.i) : (a < 0) ? -1 : compare(std::uint64_t(a), check.u);
+    break;
+  }
+  case Kind::unsignedInteger:
+  {
+    std::uint64_t a = 0;
+    switch (check.tag)
+    {
+      case 'y':
+      case 'B': a = arguments.read<std::uint8_t>(); break;
+      case 'S': a = arguments.read<std::uint16_t>(); break;
+      case 'I': a = arguments.read<std::uint32_t>(); break;
+      default:  a = arguments.read<std::uint64_t>(); break;
+    }
+    cmp = (check.negative) ? 1 : compare(a, check.u);
+    break;
+  }
+  case Kind::floating:
+  {
+    const double a = (check.tag == 'f') ? double(arguments.read<float>()) : arguments.read<double>();
+    if (a != a) { return check.comparison == Comparison::notEqual; } // NaN
+    cmp = compare(a, check.d);
+    break;
+  }
+  case Kind::string:
+  {
+    const std::uint32_t size = (check.tag == 'c') ? 1 : arguments.read<std::uint32_t>();
+    const char* data = arguments.view(size);
+    const std::size_t common = (std::min)(std::size_t(size), check.s.size());
+    cmp = (common != 0) ? std::memcmp(data, check.s.data(), common) : 0;
+    cmp = (cmp != 0) ? (cmp < 0 ? -1 : 1) : compare(std::size_t(size), check.s.size());
+    break;
+  }
+  case Kind::constant:
+    break;
+  }
+
+  return holds(check.comparison, cmp);
+}
+
+inline bool ArgumentFilter::holds(Comparison comparison, int cmp)
+{
+  switch (comparison)
+  {
+    case Comparison::equal:        return cmp == 0;
+    case Comparison::notEqual:     return cmp != 0;
+    case Comparison::less:         return cmp < 0;
+    case Comparison::lessEqual:    return cmp <= 0;
+    case Comparison::greater:      return cmp > 0;
+    case Comparison::greaterEqual: return cmp >= 0;
+  }
+  return false;
+}
+
+template <typename OutputStream>
+std::size_t ArgumentFilter::writeAllowed(const char* buffer, std::size_t bufferSize, OutputStream& out)
+{
+  std::size_t totalWriteSize = 0;
+
+  detail::forEachEntry(buffer, bufferSize, [&](Range entry, std::uint64_t tag, Range payload)
+  {
+    if (detail::isSpecialEntryTag(tag))
+    {
+      if (tag == EventSource::Tag)
+      {
+        EventSource eventSource;
+        mserialize::deserialize(eventSource, payload);
+        compileSource(eventSource);
+      }
+    }
+    else if (const std::size_t index = _sourceIndices.get(tag))
+    {
+      payload.read<std::uint64_t>(); // clock
+      if (! isAllowed(_sources[index - 1], payload))
+      {
+        ++_droppedEvents;
+        return;
+      }
+    }
+
+    const std::size_t sizePrefixedSize = entry.size();
+    out.write(entry.view(sizePrefixedSize), std::streamsize(sizePrefixedSize));
+    totalWriteSize += sizePrefixedSize;
+  });
+
+  return totalWriteSize;
+}
+
+} // namespace binlog
+
+#endif // BINLOG_ARGUMENT_FILTER_HPP
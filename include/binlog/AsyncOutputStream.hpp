@@ -0,0 +1,240 @@
+#ifndef BINLOG_ASYNC_OUTPUT_STREAM_HPP
+#define BINLOG_ASYNC_OUTPUT_STREAM_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <ios> // streamsize
+#include <mutex>
+#include <thread>
+#include <utility> // swap
+#include <vector>
+
+namespace binlog {
+
+/**
+ * Write a binlog stream to `out` asynchronously, by a dedicated thread.
+ *
+ * Models mserialize::OutputStream. write only copies the given data
+ * to a staging buffer, the writing of `out` is done by the writer thread.
+ * Session::consume releases the queue space of a channel
+ * when the write of its data returns: with this stream,
+ * producers get their space back after a memcpy,
+ * even if `out` is slow (e.g: a disk or network hiccup),
+ * and their channels do not need to grow.
+ *
+ * Double buffered: while the writer thread writes the data
+ * taken by its last swap, the next consume fills the other buffer.
+ * The capacity of both buffers is kept, to avoid allocations.
+ * If the writer thread falls behind by more than Options::maxPendingBytes,
+ * write blocks until it catches up.
+ *
+ * Example:
+ *
+ *    binlog::AsyncOutputStream<std::ofstream> output(logfile);
+ *    session.consume(output); // returns once the data is copied
+ *    output.flush(); // wait until the consumed data is written, then flush logfile
+ */
+template <typename OutputStream>
+class AsyncOutputStream
+{
+public:
+  struct Options
+  {
+    /** write blocks if more data is waiting to be written */
+    std::size_t maxPendingBytes = 16 << 20;
+  };
+
+  /**
+   * Will write to `out` by a new thread.
+   *
+   * `out` must remain valid as long as *this is valid,
+   * and must not be accessed by others, but in flush.
+   */
+  explicit AsyncOutputStream(OutputStream& out);
+
+  /** Same as above, with the specified options */
+  AsyncOutputStream(OutputStream& out, Options options);
+
+  /** Same as close(), but errors are ignored */
+  ~AsyncOutputStream();
+
+  AsyncOutputStream(const AsyncOutputStream&) = delete;
+  void operator=(const AsyncOutputStream&) = delete;
+
+  /**
+   * Copy [data, data+size) to the staging buffer,
+   * to be written to `out` by the writer thread.
+   * Blocks while the staging buffer is full.
+   *
+   * @throw the exception thrown by an earlier write of `out`.
+   *        The error is reported only once, the data of that write is lost,
+   *        the writing of the subsequent data continues.
+   */
+  AsyncOutputStream& write(const char* data, std::streamsize size);
+
+  /**
+   * Wait until every written byte is written to `out`, then flush `out`.
+   *
+   * @requires OutputStream must have a flush member function
+   * @throw the exception thrown by an earlier write of `out`
+   */
+  void flush();
+
+  /**
+   * Write the pending data, stop the writer thread.
+   * Subsequent calls do nothing. No member function
+   * but close and the destructor may be called after close.
+   *
+   * @throw the exception thrown by an earlier write of `out`
+   */
+  void close();
+
+  /** @returns the number of bytes written but not yet taken by the writer thread */
+  std::size_t pendingBytes();
+
+private:
+  /** @pre _mutex is locked by the caller */
+  void throwIfFailed();
+
+  /** Writer thread */
+  void run();
+
+  OutputStream& _out; // only accessed by the writer thread after start, but in flush
+  Options _options;
+
+  std::mutex _mutex; // guards the members below
+  std::condition_variable _cv;
+  std::vector<char> _pending; // written, not yet taken by the writer thread
+  bool _busy = false;         // true if the writer thread is writing `out`
+  bool _stop = false;
+  std::exception_ptr _error;
+
+  std::thread _thread; // last member, started after the others are initialized
+};
+
+template <typename OutputStream>
+AsyncOutputStream<OutputStream>::AsyncOutputStream(OutputStream& out)
+  :AsyncOutputStream(out, Options{})
+{}
+
+template <typename OutputStream>
+AsyncOutputStream<OutputStream>::AsyncOutputStream(OutputStream& out, Options options)
+  :_out(out),
+   _options(options),
+   _thread([this]() { run(); })
+{}
+
+template <typename OutputStream>
+AsyncOutputStream<OutputStream>::~AsyncOutputStream()
+{
+  try
+  {
+    close();
+  }
+  catch (...) {} // NOLINT(bugprone-empty-catch) destructor must not throw
+}
+
+template <typename OutputStream>
+AsyncOutputStream<OutputStream>& AsyncOutputStream<OutputStream>::write(const char* data, std::streamsize ssize)
+{
+  const std::size_t size = std::size_t(ssize);
+  if (size == 0) { return *this; }
+
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    // a single write larger than the limit is accepted if nothing else is pending
+    _cv.wait(lock, [&]() { return _pending.empty() || _pending.size() + size <= _options.maxPendingBytes; });
+    throwIfFailed();
+    _pending.insert(_pending.end(), data, data + size);
+  }
+  _cv.notify_all();
+
+  return *this;
+}
+
+template <typename OutputStream>
+void AsyncOutputStream<OutputStream>::flush()
+{
+  std::unique_lock<std::mutex> lock(_mutex);
+  _cv.wait(lock, [this]() { return _pending.empty() && ! _busy; });
+
+  // the writer thread does not touch _out while the lock is held and nothing is pending
+  _out.flush();
+  throwIfFailed();
+}
+
+template <typename OutputStream>
+void AsyncOutputStream<OutputStream>::close()
+{
+  if (! _thread.joinable()) { return; }
+
+  // the writer thread writes the pending data before stopping
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stop = true;
+  }
+  _cv.notify_all();
+  _thread.join();
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  throwIfFailed();
+}
+
+template <typename OutputStream>
+std::size_t AsyncOutputStream<OutputStream>::pendingBytes()
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _pending.size();
+}
+
+template <typename OutputStream>
+void AsyncOutputStream<OutputStream>::throwIfFailed()
+{
+  if (_error)
+  {
+    std::exception_ptr error = _error;
+    _error = nullptr;
+    std::rethrow_exception(error);
+  }
+}
+
+template <typename OutputStream>
+void AsyncOutputStream<OutputStream>::run()
+{
+  std::vector<char> work;
+
+  while (true)
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _cv.wait(lock, [this]() { return ! _pending.empty() || _stop; });
+    if (_pending.empty()) { break; } // stop
+
+    // keep the capacity of both buffers, to avoid allocations
+    std::swap(work, _pending);
+    _busy = true;
+    lock.unlock();
+    _cv.notify_all(); // writers waiting for space
+
+    std::exception_ptr error;
+    try
+    {
+      _out.write(work.data(), std::streamsize(work.size()));
+    }
+    catch (...)
+    {
+      error = std::current_exception();
+    }
+    work.clear();
+
+    lock.lock();
+    if (error) { _error = error; }
+    _busy = false;
+    lock.unlock();
+    _cv.notify_all();
+  }
+}
+
+} // namespace binlog
+
+#endif // BINLOG_ASYNC_OUTPUT_STREAM_HPP
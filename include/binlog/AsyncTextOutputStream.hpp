@@ -0,0 +1,129 @@
+#ifndef BINLOG_ASYNC_TEXT_OUTPUT_STREAM_HPP
+#define BINLOG_ASYNC_TEXT_OUTPUT_STREAM_HPP
+
+#include <binlog/TextOutputStream.hpp>
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <ios> // streamsize
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace binlog {
+
+/**
+ * Convert a binlog stream to text, asynchronously, by a dedicated thread.
+ *
+ * Models mserialize::OutputStream. Same as TextOutputStream,
+ * but write only copies the given data to a pending buffer,
+ * the conversion and the writing of `out` is done by the formatter thread.
+ * This makes Session::consume return quickly,
+ * even if formatting or the underlying stream (e.g: a console) is slow.
+ *
+ * Example:
+ *
+ *    binlog::AsyncTextOutputStream text(std::cerr);
+ *    session.consume(text); // returns once the data is copied
+ *    text.flush(); // wait until the consumed events are written to std::cerr
+ *
+ * The events are converted by a single thread, in order of writing,
+ * as converting an event depends on the preceding event sources and writer properties.
+ * If the formatter thread falls behind by more than Options::maxPendingBytes,
+ * write blocks until it catches up.
+ */
+class AsyncTextOutputStream
+{
+public:
+  struct Options
+  {
+    /** write blocks if more data is waiting to be converted */
+    std::size_t maxPendingBytes = 16 << 20;
+  };
+
+  /**
+   * Will write events converted to text to `out`,
+   * according to the specified formats, by a new thread.
+   *
+   * @see PrettyPrinter.hpp on the available placeholders.
+   *
+   * `out` must remain valid as long as *this is valid,
+   * and must not be accessed by others, but in flush.
+   */
+  explicit AsyncTextOutputStream(
+    std::ostream& out,
+    std::string eventFormat = "%S %C [%d] %n %m (%G:%L)\n",
+    std::string dateFormat = "%Y-%m-%d %H:%M:%S.%N"
+  );
+
+  /** Same as above, with the specified options */
+  AsyncTextOutputStream(
+    std::ostream& out,
+    std::string eventFormat,
+    std::string dateFormat,
+    Options options
+  );
+
+  /** Same as close(), but errors are ignored */
+  ~AsyncTextOutputStream();
+
+  AsyncTextOutputStream(const AsyncTextOutputStream&) = delete;
+  void operator=(const AsyncTextOutputStream&) = delete;
+
+  /**
+   * Copy the binlog entries in [data, data+size)
+   * to the pending buffer, to be converted by the formatter thread.
+   * Blocks while the pending buffer is full.
+   *
+   * The entries in the buffer must be complete,
+   * no partial entry is allowed.
+   *
+   * @throw std::runtime_error if the conversion of earlier data failed,
+   *        because of invalid input. The error is reported only once,
+   *        the conversion of the subsequent data continues.
+   */
+  AsyncTextOutputStream& write(const char* data, std::streamsize size);
+
+  /**
+   * Wait until every written entry is converted, then flush `out`.
+   *
+   * @throw std::runtime_error if the conversion of earlier data failed
+   */
+  void flush();
+
+  /**
+   * Convert the pending data, stop the formatter thread.
+   * Subsequent calls do nothing. No member function
+   * but close and the destructor may be called after close.
+   *
+   * @throw std::runtime_error if the conversion of earlier data failed
+   */
+  void close();
+
+private:
+  /** @pre _mutex is locked by the caller */
+  void throwIfFailed();
+
+  /** Formatter thread */
+  void run();
+
+  std::ostream& _out;
+  TextOutputStream _text; // only accessed by the formatter thread after start
+  Options _options;
+
+  std::mutex _mutex; // guards the members below
+  std::condition_variable _cv;
+  std::vector<char> _pending; // written, not yet taken by the formatter thread
+  bool _busy = false;         // true if the formatter thread is converting data
+  bool _stop = false;
+  std::exception_ptr _error;
+
+  std::thread _thread; // last member, started after the others are initialized
+};
+
+} // namespace binlog
+
+#endif // BINLOG_ASYNC_TEXT_OUTPUT_STREAM_HPP
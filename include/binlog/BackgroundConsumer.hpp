@@ -0,0 +1,410 @@
+#ifndef BINLOG_BACKGROUND_CONSUMER_HPP
+#define BINLOG_BACKGROUND_CONSUMER_HPP
+
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/Severity.hpp>
+#include <binlog/Time.hpp>
+#include <binlog/create_source_and_event.hpp>
+
+#include <algorithm> // min
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+  #include <pthread.h> // NOLINT pthread_setaffinity_np
+  #include <sched.h> // NOLINT cpu_set_t
+#endif
+
+namespace binlog {
+
+/**
+ * Consume a Session to an OutputStream on a background thread.
+ *
+ * Replaces the usual `while (running) { session.consume(out); sleep(x); }` loop.
+ * The thread polls the session with an adaptive interval:
+ * after consuming some data, it polls again after `minPollInterval`,
+ * while nothing is consumed, the interval is doubled, up to `maxPollInterval`.
+ *
+ * Writers can wake the consumer up before the interval elapses,
+ * if their queue fills up, see SessionWriter::setWakeupWatermark.
+ * The consumer registers itself using Session::setConsumerWakeup,
+ * therefore a session should have at most one BackgroundConsumer at a time.
+ *
+ * Usage:
+ *
+ *     binlog::Session session;
+ *     std::ofstream logfile("logfile.blog", std::ofstream::out|std::ofstream::binary);
+ *     binlog::BackgroundConsumer consumer(session, logfile);
+ *
+ *     binlog::SessionWriter writer(session);
+ *     writer.setWakeupWatermark(writer queue capacity / 4);
+ *     BINLOG_INFO_W(writer, "Hello"); // consumed in the background
+ *
+ *     consumer.stop(); // consume the remaining events, join the thread
+ *
+ * If the output is slower than the writers, the queues fill up, and get replaced by larger ones,
+ * or events are dropped. With load shedding enabled (see Options::shedQueueFill),
+ * the consumer raises the min severity of the session while the queues are filled,
+ * and restores it after the backlog clears. The transitions are logged by warning events
+ * of category `binlog`.
+ */
+class BackgroundConsumer
+{
+public:
+  struct Options
+  {
+    /** The shortest time between two polls, if data is consumed */
+    std::chrono::microseconds minPollInterval{100};
+
+    /** The longest time between two polls, if no data is consumed */
+    std::chrono::microseconds maxPollInterval{100000};
+
+    /** If true, call `out.flush()` after each consume that writes data, if `out` has flush */
+    bool flushAfterConsume = false;
+
+    /** If non-negative, bind the consumer thread to this CPU (Linux only, best effort) */
+    int cpu = -1;
+
+    /**
+     * If non-zero, start load shedding when a consume reads at least this fraction (0..1]
+     * of a queue: raise the min severity of the session to `shedMinSeverity`,
+     * and of the categories in `shedCategoryMinSeverity` to their severity.
+     * Severities are only raised, never lowered.
+     */
+    double shedQueueFill = 0;
+
+    /** Min severity of the session (and of the overridden categories) while shedding */
+    Severity shedMinSeverity = Severity::warning;
+
+    /** Min severity of specific categories while shedding, e.g: {"net", Severity::error} */
+    std::map<std::string, Severity> shedCategoryMinSeverity;
+
+    /**
+     * Stop load shedding if the consumes read less than this fraction
+     * of every queue for `restoreDelay`: restore the severities set before shedding.
+     */
+    double restoreQueueFill = 0.1;
+    std::chrono::milliseconds restoreDelay{1000};
+  };
+
+  /**
+   * Start consuming `session` to `out` on a new thread.
+   *
+   * `session` and `out` must remain valid as long as *this is valid.
+   *
+   * @requires OutputStream must model the mserialize::OutputStream concept
+   */
+  template <typename OutputStream>
+  BackgroundConsumer(Session& session, OutputStream& out, Options options);
+
+  /** Start consuming `session` to `out` using default Options */
+  template <typename OutputStream>
+  BackgroundConsumer(Session& session, OutputStream& out);
+
+  /** Same as stop(), but errors of the consumer are ignored */
+  ~BackgroundConsumer();
+
+  BackgroundConsumer(const BackgroundConsumer&) = delete;
+  void operator=(const BackgroundConsumer&) = delete;
+
+  /** Make the consumer poll the session now. Can be called from any thread */
+  void wakeup();
+
+  /**
+   * Consume every event added before this call, flush the output
+   * (if it has flush), then stop and join the consumer thread.
+   *
+   * Subsequent calls do nothing.
+   *
+   * @throws the exception thrown by consume (or flush), if any,
+   *         after which the consumer stopped polling.
+   */
+  void stop();
+
+  /** @returns the total number of bytes consumed by *this */
+  std::size_t totalBytesConsumed() const;
+
+  /** @returns true if load shedding is active, see Options::shedQueueFill */
+  bool isShedding() const;
+
+private:
+  template <typename OutputStream>
+  static auto flushOutput(OutputStream& out, int) -> decltype(out.flush(), void()) { out.flush(); }
+
+  template <typename OutputStream>
+  static void flushOutput(OutputStream&, long) {}
+
+  void run();
+
+  void setAffinity();
+
+  /** Start or stop load shedding, given the largest queue fill of the last consume */
+  void updateLoadShedding(SessionWriter& writer, double queueFill);
+  void startShedding(SessionWriter& writer, double queueFill);
+  void stopShedding(SessionWriter* writer);
+  static std::string severityName(Severity severity);
+
+  Session& _session;
+  std::function<Session::ConsumeResult()> _consume;
+  std::function<void()> _flush;
+  Options _options;
+
+  mutable std::mutex _mutex; // guards the members below
+  std::condition_variable _cv;
+  bool _wakeup = false;
+  bool _stop = false;
+  std::size_t _totalBytesConsumed = 0;
+  bool _shedding = false;
+  std::exception_ptr _error;
+
+  // used by the consumer thread only
+  std::chrono::steady_clock::time_point _calmSince; // of the consumes below restoreQueueFill
+  Severity _savedMinSeverity = Severity::info;
+  std::map<std::string, Severity> _savedCategoryMinSeverity;
+
+  std::thread _thread; // last member, started after the others are initialized
+};
+
+template <typename OutputStream>
+BackgroundConsumer::BackgroundConsumer(Session& session, OutputStream& out, Options options)
+  :_session(session),
+   _consume([&session, &out]() { return session.consume(out); }),
+   _flush([&out]() { flushOutput(out, 0); }),
+   _options(options),
+   _thread([this]() { run(); })
+{
+  _session.setConsumerWakeup([this]() { wakeup(); });
+}
+
+template <typename OutputStream>
+BackgroundConsumer::BackgroundConsumer(Session& session, OutputStream& out)
+  :BackgroundConsumer(session, out, Options{})
+{}
+
+inline BackgroundConsumer::~BackgroundConsumer()
+{
+  try
+  {
+    stop();
+  }
+  catch (...) {} // NOLINT(bugprone-empty-catch) destructor must not throw
+}
+
+inline void BackgroundConsumer::wakeup()
+{
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _wakeup = true;
+  }
+  _cv.notify_one();
+}
+
+inline void BackgroundConsumer::stop()
+{
+  if (! _thread.joinable()) { return; }
+
+  _session.setConsumerWakeup({});
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stop = true;
+  }
+  _cv.notify_one();
+  _thread.join();
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  if (_error)
+  {
+    std::exception_ptr error = _error;
+    _error = nullptr;
+    std::rethrow_exception(error);
+  }
+}
+
+inline std::size_t BackgroundConsumer::totalBytesConsumed() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _totalBytesConsumed;
+}
+
+inline bool BackgroundConsumer::isShedding() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _shedding;
+}
+
+inline void BackgroundConsumer::run()
+{
+  setAffinity();
+
+  std::chrono::microseconds interval = _options.minPollInterval;
+  bool stopping = false;
+
+  // logs the transitions of load shedding
+  std::unique_ptr<SessionWriter> writer;
+  if (_options.shedQueueFill > 0) { writer.reset(new SessionWriter(_session, 4096, 0, "binlog-consumer")); }
+
+  try
+  {
+    while (true)
+    {
+      const Session::ConsumeResult result = _consume();
+      const std::size_t bytesConsumed = result.bytesConsumed;
+      if (writer && ! stopping) { updateLoadShedding(*writer, result.maxQueueFill); }
+
+      if (bytesConsumed != 0)
+      {
+        interval = _options.minPollInterval;
+        if (_options.flushAfterConsume) { _flush(); }
+      }
+      else
+      {
+        interval = (std::min)(2 * interval, _options.maxPollInterval);
+      }
+
+      std::unique_lock<std::mutex> lock(_mutex);
+      _totalBytesConsumed += bytesConsumed;
+
+      // on stop, consume until a consume finds nothing to consume
+      if (stopping && bytesConsumed == 0) { break; }
+
+      _cv.wait_for(lock, interval, [this]() { return _wakeup || _stop; });
+      _wakeup = false;
+      stopping = _stop;
+    }
+
+    _flush();
+  }
+  catch (...)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _error = std::current_exception();
+  }
+
+  stopShedding(nullptr);
+}
+
+inline void BackgroundConsumer::updateLoadShedding(SessionWriter& writer, double queueFill)
+{
+  const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+  bool shedding = false;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    shedding = _shedding;
+  }
+
+  if (! shedding)
+  {
+    if (queueFill >= _options.shedQueueFill)
+    {
+      startShedding(writer, queueFill);
+      _calmSince = now;
+    }
+  }
+  else if (queueFill >= _options.restoreQueueFill)
+  {
+    _calmSince = now;
+  }
+  else if (now - _calmSince >= _options.restoreDelay)
+  {
+    stopShedding(&writer);
+  }
+}
+
+inline void BackgroundConsumer::startShedding(SessionWriter& writer, double queueFill)
+{
+  _savedMinSeverity = _session.minSeverity();
+  _savedCategoryMinSeverity = _session.categoryMinSeverities();
+
+  _session.setMinSeverity((std::max)(_savedMinSeverity, _options.shedMinSeverity));
+
+  // the overrides would keep the categories below the raised min severity
+  for (const auto& category : _savedCategoryMinSeverity)
+  {
+    if (_options.shedCategoryMinSeverity.count(category.first) == 0)
+    {
+      _session.setCategoryMinSeverity(category.first, (std::max)(category.second, _options.shedMinSeverity));
+    }
+  }
+  for (const auto& category : _options.shedCategoryMinSeverity)
+  {
+    const auto saved = _savedCategoryMinSeverity.find(category.first);
+    const Severity current = (saved != _savedCategoryMinSeverity.end()) ? saved->second : _savedMinSeverity;
+    _session.setCategoryMinSeverity(category.first, (std::max)(current, category.second));
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _shedding = true;
+  }
+
+  BINLOG_CREATE_SOURCE_AND_EVENT(writer, Severity::warning, binlog, clockNow(),
+    "Load shedding started, a queue was {}% full, min severity raised to {}",
+    int(queueFill * 100), severityName(_session.minSeverity())
+  );
+}
+
+inline std::string BackgroundConsumer::severityName(Severity severity)
+{
+  const auto name = severityToString(severity);
+  return std::string(name.data(), name.size());
+}
+
+inline void BackgroundConsumer::stopShedding(SessionWriter* writer)
+{
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (! _shedding) { return; }
+    _shedding = false;
+  }
+
+  _session.setMinSeverity(_savedMinSeverity);
+  for (const auto& category : _session.categoryMinSeverities())
+  {
+    const auto saved = _savedCategoryMinSeverity.find(category.first);
+    if (saved != _savedCategoryMinSeverity.end())
+    {
+      _session.setCategoryMinSeverity(category.first, saved->second);
+    }
+    else if (_options.shedCategoryMinSeverity.count(category.first) != 0)
+    {
+      _session.resetCategoryMinSeverity(category.first);
+    }
+  }
+
+  if (writer != nullptr)
+  {
+    SessionWriter& w = *writer;
+    BINLOG_CREATE_SOURCE_AND_EVENT(w, Severity::warning, binlog, clockNow(),
+      "Load shedding stopped, min severity restored to {}",
+      severityName(_savedMinSeverity)
+    );
+  }
+}
+
+inline void BackgroundConsumer::setAffinity()
+{
+  #ifdef __linux__
+    if (_options.cpu >= 0 && _options.cpu < CPU_SETSIZE)
+    {
+      cpu_set_t cpus;
+      CPU_ZERO(&cpus);
+      CPU_SET(std::size_t(_options.cpu), &cpus);
+      (void)pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    }
+  #endif
+}
+
+} // namespace binlog
+
+#endif // BINLOG_BACKGROUND_CONSUMER_HPP
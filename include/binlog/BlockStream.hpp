@@ -0,0 +1,152 @@
+#ifndef BINLOG_BLOCK_STREAM_HPP
+#define BINLOG_BLOCK_STREAM_HPP
+
+#include <binlog/EntryStream.hpp>
+#include <binlog/Range.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+namespace binlog {
+
+/**
+ * Block framed binlog streams are sequence of blocks.
+ * Each block holds complete entries, and is checksummed independently:
+ * a reader can verify blocks in parallel, find the next block
+ * from an arbitrary offset, and drop only a damaged block. A block is:
+ *
+ *    u32 magic              // blockMagic
+ *    u32 size               // size of the payload
+ *    u32 crc                // CRC32C of the bytes after this field: the rest of the header and the payload
+ *    u32 reserved           // zero
+ *    u64 firstClock         // smallest clock value of the events in the payload, or 0
+ *    u64 lastClock          // largest clock value of the events in the payload, or 0
+ *    u64 writerId           // id of the WriterProp the payload starts with, or noWriterId
+ *    char[size]             // payload: complete entries
+ *
+ * The payloads, concatenated, give a regular binlog stream.
+ * Like compressedFrameMagic, the magic is an unlikely beginning
+ * of a regular binlog stream: an entry of about 3.2 GB.
+ */
+constexpr std::uint32_t blockMagic = 0xC2424C42; // "BLB\xC2"
+
+/** Size of a serialized BlockHeader, the payload follows it */
+constexpr std::size_t blockHeaderSize = 40;
+
+/** BlockHeader::writerId of blocks not starting with a WriterProp */
+constexpr std::uint64_t noWriterId = std::uint64_t(-1);
+
+/** Header of a block, see blockMagic */
+struct BlockHeader
+{
+  std::uint32_t magic = 0;
+  std::uint32_t size = 0;
+  std::uint32_t crc = 0;
+  std::uint32_t reserved = 0;
+  std::uint64_t firstClock = 0;
+  std::uint64_t lastClock = 0;
+  std::uint64_t writerId = 0;
+};
+
+/**
+ * Read the header of the block at the beginning of `input`.
+ *
+ * @returns true if `input` begins with a complete block,
+ *          with valid magic and checksum.
+ */
+bool readBlockHeader(Range input, BlockHeader& header);
+
+/**
+ * @returns the offset of the first valid block in [data+offset, data+size),
+ *          or `size`, if there is no such block.
+ */
+std::size_t findBlock(const char* data, std::size_t size, std::size_t offset);
+
+/**
+ * Write entries consumed from a Session in checksummed blocks.
+ *
+ * Models mserialize::OutputStream.
+ * Written bytes are buffered until flush is called,
+ * then written in blocks: a new block begins at each WriterProp entry,
+ * therefore the events of a block are produced by a single writer.
+ *
+ * Example:
+ *
+ *    binlog::BlockOutputStream output(logfile);
+ *    session.consume(output);
+ *    output.flush();
+ *
+ * @see blockMagic for the format
+ */
+class BlockOutputStream
+{
+public:
+  /** `out` must remain valid as long as *this is valid */
+  explicit BlockOutputStream(std::ostream& out);
+
+  /** Write what remains in the buffer */
+  ~BlockOutputStream();
+
+  BlockOutputStream(const BlockOutputStream&) = delete;
+  void operator=(const BlockOutputStream&) = delete;
+
+  /** Buffer [data, data+size) */
+  BlockOutputStream& write(const char* data, std::streamsize size);
+
+  /**
+   * Write the complete entries of the buffer to the output, in blocks.
+   * An incomplete entry at the end of the buffer remains buffered.
+   */
+  void flush();
+
+private:
+  /** Write the entries in [begin, end) of _buffer as a block */
+  void writeBlock(std::size_t begin, std::size_t end, std::uint64_t writerId,
+                  std::uint64_t firstClock, std::uint64_t lastClock);
+
+  std::ostream& _out;
+  std::vector<char> _buffer; // entries of the next blocks
+};
+
+/**
+ * Entry stream with blocks in a buffer as the underlying device.
+ *
+ * Damaged blocks (with invalid magic, size or checksum) are skipped:
+ * reading continues at the next valid block.
+ *
+ * @see blockMagic for the format
+ */
+class BlockEntryStream : public EntryStream
+{
+public:
+  /**
+   * The buffer referenced by `input` (e.g: the data of a MmapEntryStream)
+   * must remain valid as long as *this is valid.
+   */
+  explicit BlockEntryStream(Range input);
+
+  /**
+   * @see EntryStream::nextEntryPayload
+   *
+   * The returned range remains valid as long as the input is valid.
+   *
+   * @throws std::runtime_error if a valid block contains an incomplete entry
+   */
+  Range nextEntryPayload() override;
+
+  /** @returns the number of bytes skipped so far, because they are not part of a valid block */
+  std::size_t skippedBytes() const { return _skippedBytes; }
+
+private:
+  const char* _data;
+  std::size_t _size;
+  std::size_t _pos = 0;      // position of the next block
+  RangeEntryStream _entries; // the remaining entries of the current block
+  std::size_t _skippedBytes = 0;
+};
+
+} // namespace binlog
+
+#endif // BINLOG_BLOCK_STREAM_HPP
@@ -0,0 +1,175 @@
+#ifndef BINLOG_CALL_SITE_PROFILE_HPP
+#define BINLOG_CALL_SITE_PROFILE_HPP
+
+#include <binlog/Entries.hpp> // StaticEventSource
+#include <binlog/detail/Rdtsc.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace binlog {
+
+/**
+ * Producer side cost of a log statement: the time it took
+ * to add its events to the writer (serializing the arguments,
+ * and replacing the queue, if needed), measured by detail::rdtsc.
+ *
+ * Collected if BINLOG_CALL_SITE_PROFILING is defined,
+ * see callSiteProfiles.
+ */
+struct CallSiteProfile
+{
+  static constexpr std::size_t histogramSize = 32;
+
+  /** [0]: number of events that took 0 ticks, [i]: [2^(i-1), 2^i) ticks, the last bucket is open */
+  using Histogram = std::array<std::uint64_t, histogramSize>;
+
+  const StaticEventSource* source = nullptr; // NOLINT the log statement
+  std::uint64_t count = 0;                   // NOLINT number of events added
+  std::uint64_t totalTicks = 0;              // NOLINT sum of the ticks of the events
+  std::uint64_t maxTicks = 0;                // NOLINT of the most expensive event
+  Histogram histogram = {};                  // NOLINT of the ticks of the events
+};
+
+namespace detail {
+
+/**
+ * Process wide collection of CallSiteProfiles.
+ *
+ * Each thread adds to its own table, guarded by a mutex that is only
+ * contended while profiles() is running. The table of an exiting
+ * thread is merged into the retired profiles.
+ */
+class CallSiteProfiler
+{
+public:
+  static CallSiteProfiler& instance()
+  {
+    static CallSiteProfiler profiler;
+    return profiler;
+  }
+
+  /** Add an event of `source` that took `ticks` to the profile of the calling thread */
+  void add(const StaticEventSource& source, std::uint64_t ticks)
+  {
+    static thread_local ThreadTable threadTable(*this);
+    Table& table = *threadTable.table;
+
+    std::lock_guard<std::mutex> lock(table.mutex);
+    CallSiteProfile& profile = table.profiles[&source];
+    profile.source = &source;
+    ++profile.count;
+    profile.totalTicks += ticks;
+    profile.maxTicks = (std::max)(profile.maxTicks, ticks);
+    ++profile.histogram[histogramBucket(ticks)];
+  }
+
+  /** @returns the profiles of every thread, summed by source, the most expensive (by totalTicks) first */
+  std::vector<CallSiteProfile> profiles() const
+  {
+    Map sum;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      merge(_retired, sum);
+      for (const Table* table : _tables)
+      {
+        std::lock_guard<std::mutex> tableLock(table->mutex);
+        merge(table->profiles, sum);
+      }
+    }
+
+    std::vector<CallSiteProfile> result;
+    result.reserve(sum.size());
+    for (const auto& entry : sum) { result.push_back(entry.second); }
+    std::sort(result.begin(), result.end(), [](const CallSiteProfile& a, const CallSiteProfile& b)
+    {
+      return a.totalTicks > b.totalTicks;
+    });
+    return result;
+  }
+
+private:
+  using Map = std::unordered_map<const StaticEventSource*, CallSiteProfile>;
+
+  struct Table
+  {
+    mutable std::mutex mutex;
+    Map profiles;
+  };
+
+  /** Registers the table of a thread on construction, retires it on destruction */
+  struct ThreadTable
+  {
+    explicit ThreadTable(CallSiteProfiler& profiler_)
+      :profiler(profiler_),
+       table(new Table())
+    {
+      std::lock_guard<std::mutex> lock(profiler._mutex);
+      profiler._tables.push_back(table.get());
+    }
+
+    ThreadTable(const ThreadTable&) = delete;
+    void operator=(const ThreadTable&) = delete;
+
+    ~ThreadTable()
+    {
+      std::lock_guard<std::mutex> lock(profiler._mutex);
+      {
+        std::lock_guard<std::mutex> tableLock(table->mutex);
+        merge(table->profiles, profiler._retired);
+      }
+      profiler._tables.erase(std::find(profiler._tables.begin(), profiler._tables.end(), table.get()));
+    }
+
+    CallSiteProfiler& profiler;
+    std::unique_ptr<Table> table;
+  };
+
+  static void merge(const Map& from, Map& to)
+  {
+    for (const auto& entry : from)
+    {
+      const CallSiteProfile& a = entry.second;
+      CallSiteProfile& b = to[entry.first];
+      b.source = a.source;
+      b.count += a.count;
+      b.totalTicks += a.totalTicks;
+      b.maxTicks = (std::max)(b.maxTicks, a.maxTicks);
+      for (std::size_t i = 0; i < a.histogram.size(); ++i) { b.histogram[i] += a.histogram[i]; }
+    }
+  }
+
+  static std::size_t histogramBucket(std::uint64_t value)
+  {
+    std::size_t result = 0;
+    for (; value != 0 && result + 1 < CallSiteProfile::histogramSize; value >>= 1) { ++result; }
+    return result;
+  }
+
+  mutable std::mutex _mutex; // guards _tables and _retired
+  std::vector<Table*> _tables;
+  Map _retired;
+};
+
+} // namespace detail
+
+/**
+ * @returns the profiles of the log statements reached so far,
+ * summed over the threads, the most expensive (by totalTicks) first.
+ *
+ * Empty, unless BINLOG_CALL_SITE_PROFILING is defined.
+ */
+inline std::vector<CallSiteProfile> callSiteProfiles()
+{
+  return detail::CallSiteProfiler::instance().profiles();
+}
+
+} // namespace binlog
+
+#endif // BINLOG_CALL_SITE_PROFILE_HPP
@@ -0,0 +1,99 @@
+#ifndef BINLOG_CHANNEL_ALLOCATOR_HPP
+#define BINLOG_CHANNEL_ALLOCATOR_HPP
+
+#include <cstddef>
+#include <memory>
+
+namespace binlog {
+
+/**
+ * Provides memory for the channels of a Session.
+ *
+ * Each channel requests a single, contiguous block,
+ * which holds the queue and its buffer.
+ * Implementations must be thread-safe:
+ * channels are created by the writers, and destroyed
+ * by the consumer, concurrently.
+ *
+ * @see Session::Session(std::shared_ptr<ChannelAllocator>)
+ */
+class ChannelAllocator
+{
+public:
+  virtual ~ChannelAllocator() = default;
+
+  /**
+   * Allocate a block of at least `size` bytes.
+   *
+   * The returned block must be aligned for any scalar type.
+   *
+   * @throws std::bad_alloc if the block can not be allocated
+   * @returns pointer to the first byte of the block
+   */
+  virtual char* allocate(std::size_t size) = 0;
+
+  /**
+   * Release `block`, previously returned by `allocate(size)`.
+   *
+   * @pre `block` was returned by allocate(size) of *this
+   */
+  virtual void deallocate(char* block, std::size_t size) noexcept = 0;
+
+  /**
+   * Called by `session` when metadata (ClockSync, EventSources) is added,
+   * with the serialized entries in [data, data+size).
+   *
+   * Allows keeping the metadata next to the channels,
+   * to make the unconsumed data of the channels recoverable.
+   * Called with the mutex of the session held.
+   * The default implementation does nothing.
+   *
+   * @param session identifies the session, same as the Session* in the channel blocks
+   */
+  virtual void addMetadata(const void* session, const char* data, std::size_t size) noexcept
+  {
+    static_cast<void>(session);
+    static_cast<void>(data);
+    static_cast<void>(size);
+  }
+
+  /** Called when `session` is destroyed, its metadata is no longer needed */
+  virtual void removeMetadata(const void* session) noexcept
+  {
+    static_cast<void>(session);
+  }
+
+  /**
+   * @returns non-zero, if the blocks of this allocator map the queue buffer twice,
+   * back to back (see MirroredChannelAllocator). The queue capacities of the
+   * channels are then rounded up to the multiple of the returned value,
+   * and their queues use the mirror. The default implementation returns 0.
+   */
+  virtual std::size_t mirrorGranularity() const { return 0; }
+};
+
+/** Allocate blocks on the free store, using new[] */
+class HeapChannelAllocator : public ChannelAllocator
+{
+public:
+  char* allocate(std::size_t size) override
+  {
+    return new char[size];
+  }
+
+  void deallocate(char* block, std::size_t /* size */) noexcept override
+  {
+    delete[] block;
+  }
+};
+
+/** @returns a shared HeapChannelAllocator */
+inline const std::shared_ptr<ChannelAllocator>& heapChannelAllocator()
+{
+  static const std::shared_ptr<ChannelAllocator> allocator = std::make_shared<HeapChannelAllocator>();
+  return allocator;
+}
+
+} // namespace binlog
+
+#endif // BINLOG_CHANNEL_ALLOCATOR_HPP
@@ -0,0 +1,232 @@
+#ifndef BINLOG_CHANNEL_POOL_HPP
+#define BINLOG_CHANNEL_POOL_HPP
+
+#include <binlog/ChannelAllocator.hpp>
+#include <binlog/Session.hpp>
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new> // bad_alloc
+#include <utility> // move
+#include <vector>
+
+namespace binlog {
+
+/**
+ * ChannelAllocator which recycles the blocks of destroyed channels.
+ *
+ * Blocks are grouped into size classes: the queue capacity
+ * of class `i` is `minQueueCapacity << i`. Allocation requests
+ * are served by the smallest class that fits, from the free blocks
+ * of the class, if there's any, from `upstream` otherwise.
+ * A deallocated block of a class is kept for reuse,
+ * blocks larger than any class are allocated and
+ * deallocated by `upstream` directly.
+ * If `upstream` mirrors the queues (see MirroredChannelAllocator),
+ * the class capacities are rounded up to its granularity,
+ * and a class serves only requests of its exact size,
+ * as the mirror must begin at the end of the queue.
+ *
+ * The blocks of each class are preallocated and pre-faulted
+ * (every page is written) on construction, therefore writers
+ * creating a channel, or replacing a full one, do not pay
+ * for allocation or page faults, as long as the pool has a fitting free block.
+ *
+ * Usage:
+ *
+ *    auto pool = std::make_shared<binlog::ChannelPool>(1 << 20, 2, 16);
+ *    binlog::Session session(pool);
+ *    binlog::SessionWriter writer(session, 1 << 20); // takes a block from the pool
+ *
+ * Members of this class are thread-safe.
+ */
+class ChannelPool : public ChannelAllocator
+{
+public:
+  /**
+   * @param minQueueCapacity queue capacity of the smallest size class
+   * @param classCount number of size classes
+   * @param blocksPerClass number of blocks to preallocate for each class
+   * @param upstream allocates the blocks of the pool
+   * @pre upstream != nullptr
+   */
+  ChannelPool(
+    std::size_t minQueueCapacity,
+    std::size_t classCount,
+    std::size_t blocksPerClass,
+    std::shared_ptr<ChannelAllocator> upstream = heapChannelAllocator()
+  );
+
+  /** Deallocate the free blocks of the pool, using `upstream` */
+  ~ChannelPool() override;
+
+  ChannelPool(const ChannelPool&) = delete;
+  void operator=(const ChannelPool&) = delete;
+
+  char* allocate(std::size_t size) override;
+
+  void deallocate(char* block, std::size_t size) noexcept override;
+
+  /** Forwarded to `upstream` */
+  void addMetadata(const void* session, const char* data, std::size_t size) noexcept override
+  {
+    _upstream->addMetadata(session, data, size);
+  }
+
+  /** Forwarded to `upstream` */
+  void removeMetadata(const void* session) noexcept override
+  {
+    _upstream->removeMetadata(session);
+  }
+
+  /** Forwarded to `upstream` */
+  std::size_t mirrorGranularity() const override
+  {
+    return _granularity;
+  }
+
+  /** @returns the number of blocks available for reuse */
+  std::size_t freeBlockCount() const;
+
+private:
+  struct SizeClass
+  {
+    std::size_t blockSize;
+    std::vector<char*> freeBlocks;
+  };
+
+  /** @returns the smallest class which can hold `size` bytes, or nullptr if there's none */
+  SizeClass* sizeClass(std::size_t size);
+
+  void releaseFreeBlocks() noexcept;
+
+  std::shared_ptr<ChannelAllocator> _upstream;
+  std::size_t _granularity; // of upstream, const after construction
+
+  mutable std::mutex _mutex; // guards the freeBlocks of _classes
+  std::vector<SizeClass> _classes;
+};
+
+inline ChannelPool::ChannelPool(
+  std::size_t minQueueCapacity,
+  std::size_t classCount,
+  std::size_t blocksPerClass,
+  std::shared_ptr<ChannelAllocator> upstream
+)
+  :_upstream(std::move(upstream)),
+   _granularity(_upstream->mirrorGranularity())
+{
+  _classes.reserve(classCount);
+  for (std::size_t i = 0; i < classCount; ++i)
+  {
+    std::size_t queueCapacity = minQueueCapacity << i;
+    if (_granularity != 0) { queueCapacity = (queueCapacity + _granularity - 1) / _granularity * _granularity; }
+    const std::size_t blockSize = Session::Channel::allocationSize(queueCapacity);
+    _classes.push_back(SizeClass{blockSize, {}});
+    _classes.back().freeBlocks.reserve(blocksPerClass);
+  }
+
+  try
+  {
+    for (SizeClass& sc : _classes)
+    {
+      for (std::size_t j = 0; j < blocksPerClass; ++j)
+      {
+        char* block = _upstream->allocate(sc.blockSize);
+        memset(block, 0, sc.blockSize); // pre-fault
+        sc.freeBlocks.push_back(block);
+      }
+    }
+  }
+  catch (...)
+  {
+    releaseFreeBlocks();
+    throw;
+  }
+}
+
+inline ChannelPool::~ChannelPool()
+{
+  releaseFreeBlocks();
+}
+
+inline char* ChannelPool::allocate(std::size_t size)
+{
+  SizeClass* sc = sizeClass(size);
+  if (sc == nullptr)
+  {
+    return _upstream->allocate(size);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (! sc->freeBlocks.empty())
+    {
+      char* block = sc->freeBlocks.back();
+      sc->freeBlocks.pop_back();
+      return block;
+    }
+  }
+
+  // the class is exhausted, make a new block, which will be recycled later
+  return _upstream->allocate(sc->blockSize);
+}
+
+inline void ChannelPool::deallocate(char* block, std::size_t size) noexcept
+{
+  SizeClass* sc = sizeClass(size);
+  if (sc == nullptr)
+  {
+    _upstream->deallocate(block, size);
+    return;
+  }
+
+  try
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    sc->freeBlocks.push_back(block);
+  }
+  catch (const std::bad_alloc&)
+  {
+    _upstream->deallocate(block, sc->blockSize);
+  }
+}
+
+inline std::size_t ChannelPool::freeBlockCount() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  std::size_t result = 0;
+  for (const SizeClass& sc : _classes)
+  {
+    result += sc.freeBlocks.size();
+  }
+  return result;
+}
+
+inline ChannelPool::SizeClass* ChannelPool::sizeClass(std::size_t size)
+{
+  for (SizeClass& sc : _classes)
+  {
+    if (size == sc.blockSize || (size < sc.blockSize && _granularity == 0)) { return &sc; }
+  }
+  return nullptr;
+}
+
+inline void ChannelPool::releaseFreeBlocks() noexcept
+{
+  for (SizeClass& sc : _classes)
+  {
+    for (char* block : sc.freeBlocks)
+    {
+      _upstream->deallocate(block, sc.blockSize);
+    }
+    sc.freeBlocks.clear();
+  }
+}
+
+} // namespace binlog
+
+#endif // BINLOG_CHANNEL_POOL_HPP
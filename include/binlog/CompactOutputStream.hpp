@@ -0,0 +1,122 @@
+#ifndef BINLOG_COMPACT_OUTPUT_STREAM_HPP
+#define BINLOG_COMPACT_OUTPUT_STREAM_HPP
+
+#include <binlog/Entries.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace binlog {
+
+/**
+ * Transcode entries consumed from a Session to the compact
+ * (binlog format v2) encoding, see CompactEvents.
+ *
+ * Models mserialize::OutputStream.
+ * Consecutive events are replaced by CompactEvents entries,
+ * with varint sizes and source ids, and delta encoded clocks.
+ * The values of counter events (see BINLOG_COUNTER_WC) are delta encoded
+ * against the previous value of the same counter, in the same entry.
+ * Other entries are written unchanged, except the batchSize of WriterProp
+ * entries, which is adjusted to the size of the transcoded events.
+ * An event of a single int argument takes 24 bytes in a regular
+ * stream, and about 8 in a compact one.
+ *
+ * Written bytes are buffered until flush is called.
+ * Entries can be split between write calls.
+ *
+ * Example:
+ *
+ *    binlog::CompactOutputStream output(logfile);
+ *    session.consume(output);
+ *    output.flush();
+ *
+ * The result can be read by EventStream (and therefore by bread),
+ * and indexed by IndexedOutputStream, but not by tools which
+ * process the events as regular entries, e.g: EventFilter and EventRouter.
+ *
+ * Optionally, consecutive EventSource entries are replaced
+ * by EventSourceTable entries, see setEventSourceTables.
+ */
+class CompactOutputStream
+{
+public:
+  /** `out` must remain valid as long as *this is valid */
+  explicit CompactOutputStream(std::ostream& out);
+
+  /** Write what remains in the buffer */
+  ~CompactOutputStream();
+
+  CompactOutputStream(const CompactOutputStream&) = delete;
+  void operator=(const CompactOutputStream&) = delete;
+
+  /** Transcode the complete entries of [data, data+size) to the buffer */
+  CompactOutputStream& write(const char* data, std::streamsize size);
+
+  /**
+   * Write the transcoded entries to the output.
+   * An incomplete entry, if any, remains buffered.
+   */
+  void flush();
+
+  /**
+   * If `enable` is true, replace consecutive EventSource entries
+   * by EventSourceTable entries: strings shared by the sources
+   * (e.g: file names, categories, argument tags) are written once,
+   * front coded. Typically halves the size of the metadata, which is
+   * significant if it is repeated, e.g: at the beginning of each rotated file.
+   *
+   * Disabled by default, as only EventStream, IndexedOutputStream and the tools
+   * reading compact events (e.g: bread, bcut, bmerge) read EventSourceTable entries.
+   */
+  void setEventSourceTables(bool enable) { _eventSourceTables = enable; }
+
+private:
+  /** Transcode the complete entries of [data, data+size), @returns the size of them */
+  std::size_t writeEntries(const char* data, std::size_t size);
+
+  /** Transcode an entry, `payload` is the entry without the size prefix */
+  void writeEntry(const char* payload, std::uint32_t size);
+
+  /** Append an event to the current CompactEvents entry, begin one if needed */
+  void writeEvent(const char* payload, std::uint32_t size);
+
+  /**
+   * Deserialize the EventSource entry `payload` to `source`,
+   * remember if it defines a counter source.
+   *
+   * @returns false if the entry is invalid
+   */
+  bool readEventSource(const char* payload, std::uint32_t size, EventSource& source);
+
+  /** Write the sources of the current EventSourceTable entry, if any */
+  void endEventSourceTable();
+
+  /** Set the size of the current CompactEvents entry, if any */
+  void endCompactEvents();
+
+  /** Set the batchSize of the most recent WriterProp entry, if not set yet */
+  void endWriterPropBatch();
+
+  std::ostream& _out;
+  std::vector<char> _buffer;  // transcoded entries
+  std::vector<char> _partial; // incomplete entry of the previous write
+  std::size_t _compactBegin = noPos;    // offset of the current CompactEvents entry in _buffer
+  std::size_t _writerPropEnd = noPos;   // offset after the WriterProp entry to adjust in _buffer
+  std::uint64_t _clock = 0;             // clock of the previous event of the current CompactEvents entry
+  std::unordered_set<std::uint64_t> _counterSources; // ids of the sources of counter events
+  std::unordered_map<std::uint64_t, std::uint64_t> _counterValues; // of the current CompactEvents entry, by source id
+  bool _eventSourceTables = false;
+  std::vector<EventSource> _tableSources; // of the current EventSourceTable entry
+  std::size_t _tableSourcesSize = 0;      // the size of the replaced EventSource entries
+
+  static constexpr std::size_t noPos = std::size_t(-1);
+};
+
+} // namespace binlog
+
+#endif // BINLOG_COMPACT_OUTPUT_STREAM_HPP
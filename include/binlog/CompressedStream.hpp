@@ -0,0 +1,179 @@
+#ifndef BINLOG_COMPRESSED_STREAM_HPP
+#define BINLOG_COMPRESSED_STREAM_HPP
+
+#include <binlog/EntryStream.hpp>
+#include <binlog/Range.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace binlog {
+
+/**
+ * Compressed binlog streams are sequence of frames.
+ * Each frame is compressed independently, and can be decoded
+ * without the previous frames. A frame is:
+ *
+ *    u32 magic              // compressedFrameMagic
+ *    u32 codec              // compression method of payload
+ *    u32 compressedSize     // size of the payload
+ *    u32 uncompressedSize   // size of the decompressed payload
+ *    char[compressedSize]   // payload
+ *
+ * The decompressed payloads, concatenated, give a regular binlog stream.
+ * If frames are produced by CompressedOutputStream, flushed after each
+ * Session::consume, every frame contains complete entries.
+ *
+ * The magic is chosen to be an unlikely beginning
+ * of a regular binlog stream: an entry of about 3.2 GB.
+ *
+ * A deflate payload can be compressed with a preset dictionary
+ * (see trainCompressionDictionary), its id (see compressionDictionaryId)
+ * is recorded in the zlib header of the payload. Readers must be given
+ * the same dictionary to decompress such frames.
+ *
+ * Available if binlog is built with zlib (BINLOG_HAS_ZLIB is defined).
+ */
+constexpr std::uint32_t compressedFrameMagic = 0xC25A4C42; // "BLZ\xC2"
+
+/** Codecs of compressed frames */
+enum class CompressionCodec : std::uint32_t
+{
+  deflate = 1, /**< zlib format */
+};
+
+/**
+ * @returns a preset dictionary of at most `maxSize` bytes, trained on `samples`,
+ *          each a regular binlog stream, e.g: the content of a representative logfile.
+ *
+ * Small frames (e.g: frequent consume calls) compress poorly, because
+ * each frame is compressed independently, without the context of the previous ones.
+ * A dictionary made of the byte sequences frequent in the samples
+ * (the repeated WriterProp entries, source ids, clock prefixes and common arguments)
+ * gives that context to every frame, without making them dependent on each other.
+ *
+ * The samples are split to epochs, and from each epoch the segment with the most
+ * frequent (in every sample) substrings, not yet covered by the dictionary, is taken.
+ * The most valuable segments are put at the end of the dictionary,
+ * nearest to the compressed data. deflate uses at most the last 32 KiB of it.
+ *
+ * @returns an empty string, if the samples have no repeated content
+ */
+std::string trainCompressionDictionary(const std::vector<std::string>& samples, std::size_t maxSize = std::size_t{1} << 15);
+
+/** @returns the id of `dictionary` recorded in the frames it compressed (Adler-32, as by zlib) */
+std::uint32_t compressionDictionaryId(const std::string& dictionary);
+
+/**
+ * Append a frame of the compressed [data, data+size) to `frame`,
+ * compressed with level `level`, see CompressedOutputStream.
+ *
+ * With decompressFrame, it can be the codec of Session::setFlightRecorderHistory.
+ *
+ * @throws std::runtime_error if compression fails
+ */
+void compressFrame(const char* data, std::size_t size, std::vector<char>& frame, int level = 1);
+
+/**
+ * Append the decompressed payload of the frame [data, data+size) to `out`.
+ *
+ * @throws std::runtime_error if the frame is invalid, incomplete,
+ *         or compressed with a dictionary
+ */
+void decompressFrame(const char* data, std::size_t size, std::vector<char>& out);
+
+/**
+ * Compress entries consumed from a Session, frame by frame.
+ *
+ * Models mserialize::OutputStream.
+ * Written bytes are buffered until flush is called,
+ * then compressed into a single frame.
+ *
+ * Example:
+ *
+ *    binlog::CompressedOutputStream output(logfile);
+ *    session.consume(output);
+ *    output.flush();
+ *
+ * @see compressedFrameMagic for the format
+ */
+class CompressedOutputStream
+{
+public:
+  /**
+   * Write frames to `out`, compressing with level `level`
+   * (1 is the fastest, 9 gives the best compression),
+   * and `dictionary`, if not empty (see trainCompressionDictionary).
+   *
+   * `out` must remain valid as long as *this is valid.
+   */
+  explicit CompressedOutputStream(std::ostream& out, int level = 1, std::string dictionary = {});
+
+  /** Compress and write what remains in the buffer */
+  ~CompressedOutputStream();
+
+  CompressedOutputStream(const CompressedOutputStream&) = delete;
+  void operator=(const CompressedOutputStream&) = delete;
+
+  /** Buffer [data, data+size) */
+  CompressedOutputStream& write(const char* data, std::streamsize size);
+
+  /**
+   * Compress the buffered bytes to a frame, and write it to the output.
+   * Does nothing if the buffer is empty.
+   *
+   * @throws std::runtime_error if compression fails
+   */
+  void flush();
+
+private:
+  std::ostream& _out;
+  int _level;
+  std::string _dictionary;
+  std::vector<char> _buffer; // uncompressed bytes of the next frame
+  std::vector<char> _frame;  // compressed frame, reused
+};
+
+/**
+ * Entry stream with compressed frames in a std::istream
+ * as the underlying device.
+ *
+ * @see compressedFrameMagic for the format
+ */
+class CompressedEntryStream : public EntryStream
+{
+public:
+  /** `input` must remain valid as long as *this is valid */
+  explicit CompressedEntryStream(std::istream& input);
+
+  /** Decompress the frames compressed with `dictionary` (see CompressedOutputStream) */
+  void addDictionary(std::string dictionary);
+
+  /**
+   * @see EntryStream::nextEntryPayload
+   *
+   * The returned range remains valid until the next call.
+   * Entries spanning frames are supported.
+   *
+   * @throws std::runtime_error if a frame is invalid, or compressed
+   *         with a dictionary not added, or the input ends with an incomplete frame or entry.
+   */
+  Range nextEntryPayload() override;
+
+private:
+  /** @returns false if there are no more frames in the input */
+  bool readFrame();
+
+  std::istream& _input;
+  std::vector<std::string> _dictionaries;
+  std::vector<char> _buffer; // decompressed bytes
+  std::size_t _pos = 0;      // position of the next entry in _buffer
+  std::vector<char> _frame;  // compressed payload, reused
+};
+
+} // namespace binlog
+
+#endif // BINLOG_COMPRESSED_STREAM_HPP
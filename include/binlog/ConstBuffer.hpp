@@ -0,0 +1,45 @@
+#ifndef BINLOG_CONST_BUFFER_HPP
+#define BINLOG_CONST_BUFFER_HPP
+
+#include <mserialize/detail/type_traits.hpp>
+
+#include <cstddef>
+#include <type_traits>
+#include <utility> // declval
+
+namespace binlog {
+
+/**
+ * A read-only range of bytes, an element of a gather write.
+ *
+ * An OutputStream can optionally provide a member function:
+ *
+ *     void writev(const binlog::ConstBuffer* buffers, std::size_t count);
+ *
+ * that writes the `count` buffers, in order, in one go.
+ * If present, Session::consume collects the data to be written
+ * (queue data, metadata, special entries) and calls writev once,
+ * instead of calling write for each piece of data.
+ *
+ * @see FileOutputStream
+ */
+struct ConstBuffer
+{
+  const char* data; // NOLINT
+  std::size_t size; // NOLINT
+};
+
+namespace detail {
+
+template <typename OutputStream, typename = void>
+struct has_writev : std::false_type {};
+
+template <typename OutputStream>
+struct has_writev<OutputStream, mserialize::detail::void_t<decltype(
+  std::declval<OutputStream&>().writev(std::declval<const ConstBuffer*>(), std::size_t{})
+)>> : std::true_type {};
+
+} // namespace detail
+} // namespace binlog
+
+#endif // BINLOG_CONST_BUFFER_HPP
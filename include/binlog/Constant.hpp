@@ -0,0 +1,198 @@
+#ifndef BINLOG_CONSTANT_HPP
+#define BINLOG_CONSTANT_HPP
+
+#include <binlog/Entries.hpp>
+#include <binlog/detail/FormatSpec.hpp>
+
+#include <mserialize/cx_string.hpp>
+#include <mserialize/serialize.hpp>
+#include <mserialize/string_view.hpp>
+#include <mserialize/tag.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <utility> // pair
+
+namespace binlog {
+
+/**
+ * A log argument that has the same value on every call of the log statement,
+ * e.g: a string literal, or a constexpr value.
+ *
+ * The value of a constant argument is not added to the events: it is written
+ * to the format string of the event source instead (in place of its {} placeholder),
+ * when the event source is added to the session, by the first call
+ * of the log statement. It makes the events smaller, and faster to add.
+ *
+ * Example:
+ *
+ *    BINLOG_INFO("Mode: {}, x: {}", binlog::constant("fast"), x);
+ *    // is logged as if it was
+ *    BINLOG_INFO("Mode: fast, x: {}", x);
+ *
+ * The value must be a bool, a character, an integer or a string
+ * (`const char*`, character array, or any type with contiguous `data()` and `size()` members),
+ * rendered the same way bread would print it, and it must not contain "{}" or "{:".
+ * The spec of the placeholder of a constant (e.g: {:x}) is ignored.
+ * Constant arguments are supported by the log macros, except the scope macros.
+ * If the value changes, the events keep
+ * the value of the first call (per session).
+ *
+ * @see constant
+ */
+template <typename T>
+struct Constant
+{
+  const T& value; // NOLINT
+};
+
+/** @returns `value` wrapped as a Constant log argument */
+template <typename T>
+Constant<T> constant(const T& value)
+{
+  return Constant<T>{value};
+}
+
+namespace detail {
+
+template <typename T>
+struct IsConstant : std::false_type {};
+
+template <typename T>
+struct IsConstant<Constant<T>> : std::true_type {};
+
+/** True if any of T... is a Constant (ignoring cv and ref qualifiers) */
+template <typename... T>
+struct AnyConstant : std::false_type {};
+
+template <typename T, typename... U>
+struct AnyConstant<T, U...>
+  : std::integral_constant<bool, IsConstant<typename std::decay<T>::type>::value || AnyConstant<U...>::value>
+{};
+
+inline void appendConstant(std::string& out, bool value)
+{
+  out += value ? "true" : "false";
+}
+
+inline void appendConstant(std::string& out, char value)
+{
+  out += value;
+}
+
+inline void appendConstant(std::string& out, const char* value)
+{
+  out += (value != nullptr) ? value : "{null}";
+}
+
+template <typename T>
+auto appendConstant(std::string& out, const T& value)
+  -> typename std::enable_if<std::is_integral<T>::value>::type
+{
+  out += std::is_signed<T>::value
+    ? std::to_string(std::int64_t(value))
+    : std::to_string(std::uint64_t(value));
+}
+
+template <typename String>
+auto appendConstant(std::string& out, const String& value) -> decltype(out.append(value.data(), std::size_t(value.size())), void())
+{
+  out.append(value.data(), std::size_t(value.size()));
+}
+
+// Copy the format string up to the placeholder of the next argument:
+// the placeholder of a Constant is replaced by its value
+
+/**
+ * @returns the (begin, end) position of the first placeholder ({} or {:spec}) of `fmt`
+ * @pre `fmt` contains a placeholder, and is a suffix of a null terminated string
+ */
+inline std::pair<std::size_t, std::size_t> findPlaceholder(mserialize::string_view fmt)
+{
+  FormatSpec spec;
+  bool invalid = false;
+  for (std::size_t p = 0;; ++p)
+  {
+    const char* end = parse_placeholder(fmt.data() + p, spec, invalid);
+    if (end != nullptr) { return {p, std::size_t(end - fmt.data())}; }
+  }
+}
+
+template <typename T>
+void appendArgument(std::string& out, mserialize::string_view& fmt, const T&)
+{
+  const std::size_t end = findPlaceholder(fmt).second;
+  out.append(fmt.data(), end);
+  fmt.remove_prefix(end);
+}
+
+template <typename T>
+void appendArgument(std::string& out, mserialize::string_view& fmt, const Constant<T>& c)
+{
+  const std::pair<std::size_t, std::size_t> p = findPlaceholder(fmt);
+  out.append(fmt.data(), p.first);
+  fmt.remove_prefix(p.second);
+  appendConstant(out, c.value);
+}
+
+/**
+ * @returns `formatString`,
+ *          the placeholders of the Constant arguments replaced by their value.
+ * @pre the number of placeholders in the format string equals sizeof...(T)
+ */
+template <typename... T>
+std::string foldConstants(const char* formatString, const T&... args)
+{
+  std::string result;
+  mserialize::string_view fmt(formatString);
+  using expand = int[];
+  static_cast<void>(expand{0, (appendArgument(result, fmt, args), 0)...});
+  result.append(fmt.data(), fmt.size());
+  return result;
+}
+
+/**
+ * @returns `source` as an EventSource, with the format string
+ *          folded by the values of the Constant arguments `args`.
+ *
+ * The argument tags of `source` already omit the Constant arguments.
+ */
+template <typename... T>
+EventSource foldedEventSource(const StaticEventSource& source, const T&... args)
+{
+  return EventSource{
+    0, source.severity, source.category, source.function, source.file, source.line,
+    foldConstants(source.formatString, args...), source.argumentTags
+  };
+}
+
+} // namespace detail
+} // namespace binlog
+
+namespace mserialize {
+
+// Constant arguments are not serialized: their values are in the event source
+
+template <typename T>
+struct CustomSerializer<binlog::Constant<T>>
+{
+  template <typename OutputStream>
+  static void serialize(const binlog::Constant<T>&, OutputStream&) {}
+
+  static std::size_t serialized_size(const binlog::Constant<T>&) { return 0; }
+};
+
+template <typename T>
+struct CustomTag<binlog::Constant<T>>
+{
+  static constexpr auto tag_string()
+  {
+    return make_cx_string("");
+  }
+};
+
+} // namespace mserialize
+
+#endif // BINLOG_CONSTANT_HPP
@@ -0,0 +1,183 @@
+#ifndef BINLOG_CRASH_HANDLER_HPP
+#define BINLOG_CRASH_HANDLER_HPP
+
+#include <binlog/Session.hpp>
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+#ifndef _WIN32 // assume POSIX
+
+#include <csignal> // NOLINT sigaction, raise
+#include <unistd.h> // NOLINT write
+
+namespace binlog {
+
+/**
+ * Writes the unconsumed data of a session to a file descriptor,
+ * if the process receives a fatal signal (SIGSEGV, SIGBUS, SIGILL, SIGFPE or SIGABRT).
+ *
+ * Without a handler, the events added since the last consume are lost on a crash,
+ * unless a core dump is taken and processed by brecovery.
+ * The handler writes the metadata and the unconsumed data of each channel
+ * to `fd` (opened in advance, e.g: a file next to the logfile) with write(2),
+ * see Session::writeUnconsumed. The written file is a binlog stream, readable by bread.
+ *
+ * The handler does not lock or allocate, but reads the queues while writers
+ * and consumers might be running: it is best effort, like brecovery.
+ * After writing, the previous handler of the signal is restored, and the signal is raised again,
+ * e.g: to terminate the process with a core dump, or to run the handler of a crash reporter.
+ * To handle stack overflows, the thread must have an alternate signal stack (see sigaltstack),
+ * the handler is installed with SA_ONSTACK.
+ *
+ * Only one CrashHandler can be alive at a time.
+ * The session must outlive the handler. `fd` is not closed.
+ *
+ * Example:
+ *
+ *    const int fd = open("crash.blog", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+ *    binlog::CrashHandler crashHandler(session, fd);
+ *
+ * Available on POSIX systems.
+ */
+class CrashHandler
+{
+public:
+  /**
+   * Install the handler of the fatal signals.
+   * @throws std::runtime_error if another CrashHandler is alive, or sigaction fails
+   */
+  CrashHandler(Session& session, int fd);
+
+  /** Restore the previous handlers of the signals */
+  ~CrashHandler();
+
+  CrashHandler(const CrashHandler&) = delete;
+  void operator=(const CrashHandler&) = delete;
+
+  CrashHandler(CrashHandler&&) = delete;
+  void operator=(CrashHandler&&) = delete;
+
+private:
+  static constexpr std::size_t signalCount = 5;
+
+  struct State
+  {
+    std::atomic<Session*> session{nullptr}; // taken by the first signal
+    int fd = -1;
+    struct sigaction previous[signalCount]; // NOLINT
+  };
+
+  static const int (&signals())[signalCount];
+
+  /** First called by the constructor: initialized before the signal handler can access it */
+  static State& state();
+
+  static void handleSignal(int signo);
+
+  /** Write [data, data+size) to `fd`, retry on EINTR and short writes, give up on error */
+  static void writeAll(int fd, const char* data, std::size_t size);
+
+  void restore(std::size_t count);
+};
+
+inline CrashHandler::CrashHandler(Session& session, int fd)
+{
+  State& st = state();
+  Session* expected = nullptr;
+  if (st.fd >= 0 || ! st.session.compare_exchange_strong(expected, &session))
+  {
+    throw std::runtime_error("Another CrashHandler is already installed");
+  }
+  st.fd = fd;
+
+  struct sigaction action = {}; // NOLINT
+  action.sa_handler = &CrashHandler::handleSignal; // NOLINT(cppcoreguidelines-pro-type-union-access)
+  action.sa_flags = SA_ONSTACK;
+  sigemptyset(&action.sa_mask);
+
+  for (std::size_t i = 0; i < signalCount; ++i)
+  {
+    if (sigaction(signals()[i], &action, &st.previous[i]) != 0)
+    {
+      restore(i);
+      throw std::runtime_error("Failed to install the crash handler, errno=" + std::to_string(errno));
+    }
+  }
+}
+
+inline CrashHandler::~CrashHandler()
+{
+  restore(signalCount);
+}
+
+inline const int (&CrashHandler::signals())[CrashHandler::signalCount]
+{
+  static const int result[signalCount] = {SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT};
+  return result;
+}
+
+inline CrashHandler::State& CrashHandler::state()
+{
+  static State result;
+  return result;
+}
+
+inline void CrashHandler::handleSignal(int signo)
+{
+  State& st = state();
+
+  // write once, even if the handler crashes, or another thread crashes concurrently
+  Session* session = st.session.exchange(nullptr);
+  if (session != nullptr)
+  {
+    const int fd = st.fd;
+    session->writeUnconsumed([fd](const char* data, std::size_t size) { writeAll(fd, data, size); });
+  }
+
+  for (std::size_t i = 0; i < signalCount; ++i)
+  {
+    if (signals()[i] == signo)
+    {
+      sigaction(signo, &st.previous[i], nullptr);
+      break;
+    }
+  }
+
+  // blocked until the handler returns, then handled by the previous handler
+  raise(signo);
+}
+
+inline void CrashHandler::writeAll(int fd, const char* data, std::size_t size)
+{
+  while (size != 0)
+  {
+    const ssize_t written = ::write(fd, data, size);
+    if (written < 0 && errno == EINTR) { continue; }
+    if (written <= 0) { return; }
+
+    data += written;
+    size -= std::size_t(written);
+  }
+}
+
+inline void CrashHandler::restore(std::size_t count)
+{
+  State& st = state();
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    sigaction(signals()[i], &st.previous[i], nullptr);
+  }
+
+  st.session.store(nullptr);
+  st.fd = -1;
+}
+
+} // namespace binlog
+
+#endif // _WIN32
+
+#endif // BINLOG_CRASH_HANDLER_HPP
@@ -0,0 +1,94 @@
+#ifndef BINLOG_DECIMAL_HPP
+#define BINLOG_DECIMAL_HPP
+
+#include <mserialize/cx_string.hpp>
+#include <mserialize/serialize.hpp>
+#include <mserialize/tag.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace binlog {
+
+/**
+ * A fixed-point decimal number: `value` * 10^-Scale.
+ *
+ * Only the integer `value` is serialized, the scale is part
+ * of the argument tag. bread shows the number exactly,
+ * computed by integer arithmetic, e.g: decimal<2>(12345) as 123.45.
+ *
+ * Example:
+ *
+ *    // price is in hundredths
+ *    BINLOG_INFO("Price: {}", binlog::decimal<2>(price));
+ */
+template <unsigned Scale>
+struct Decimal
+{
+  static_assert(Scale <= 18, "Scale of binlog::Decimal must be at most 18");
+
+  std::int64_t value; // NOLINT
+};
+
+/** @returns `value` * 10^-Scale, see Decimal */
+template <unsigned Scale>
+Decimal<Scale> decimal(std::int64_t value)
+{
+  return Decimal<Scale>{value};
+}
+
+namespace detail {
+
+/** @returns the decimal digits of `Scale` */
+template <unsigned Scale>
+constexpr std::enable_if_t<(Scale < 10), mserialize::cx_string<1>> decimalScaleString()
+{
+  const char digits[] = {char('0' + Scale), '\0'};
+  return mserialize::cx_string<1>(digits);
+}
+
+template <unsigned Scale>
+constexpr std::enable_if_t<(Scale >= 10), mserialize::cx_string<2>> decimalScaleString()
+{
+  const char digits[] = {char('0' + Scale / 10), char('0' + Scale % 10), '\0'};
+  return mserialize::cx_string<2>(digits);
+}
+
+} // namespace detail
+
+} // namespace binlog
+
+namespace mserialize {
+
+template <unsigned Scale>
+struct CustomSerializer<binlog::Decimal<Scale>>
+{
+  template <typename OutputStream>
+  static void serialize(binlog::Decimal<Scale> d, OutputStream& ostream)
+  {
+    mserialize::serialize(d.value, ostream);
+  }
+
+  static constexpr std::size_t serialized_size(binlog::Decimal<Scale>)
+  {
+    return sizeof(std::int64_t);
+  }
+};
+
+template <unsigned Scale>
+struct CustomTag<binlog::Decimal<Scale>>
+{
+  static constexpr auto tag_string()
+  {
+    return cx_strcat(
+      make_cx_string("{binlog::Decimal<"),
+      binlog::detail::decimalScaleString<Scale>(),
+      make_cx_string(">`value'l}")
+    );
+  }
+};
+
+} // namespace mserialize
+
+#endif // BINLOG_DECIMAL_HPP
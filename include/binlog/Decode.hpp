@@ -0,0 +1,58 @@
+#ifndef BINLOG_DECODE_HPP
+#define BINLOG_DECODE_HPP
+
+#include <binlog/Entries.hpp>
+#include <binlog/Range.hpp>
+
+#include <mserialize/cx_string.hpp>
+#include <mserialize/deserialize.hpp>
+#include <mserialize/tag.hpp>
+
+#include <cstring> // memcmp
+#include <stdexcept>
+#include <string>
+#include <tuple>
+
+namespace binlog {
+
+/**
+ * Deserialize the arguments of `event` as `T...`.
+ *
+ * The argumentTags of the event source must be equal to the
+ * concatenated tags of T... (e.g: the arguments were logged as T...),
+ * which is checked by a single string comparison.
+ * The arguments are deserialized as by mserialize::deserialize,
+ * without interpreting the tag per argument, as mserialize::visit does.
+ *
+ * Example:
+ *
+ *    // BINLOG_INFO("Fill: {} @ {}", quantity, price);
+ *    const auto args = binlog::decode<int, double>(*event);
+ *    total += std::get<0>(args) * std::get<1>(args);
+ *
+ * @pre event.source must be valid
+ * @throws std::runtime_error if the tags do not match, or the arguments are invalid
+ */
+template <typename... T>
+std::tuple<T...> decode(const Event& event)
+{
+  constexpr auto tags = mserialize::cx_strcat(mserialize::tag<T>()...);
+
+  const std::string& sourceTags = event.source->argumentTags;
+  if (sourceTags.size() != tags.size() || memcmp(sourceTags.data(), tags.data(), tags.size()) != 0)
+  {
+    throw std::runtime_error(
+      "Arguments of event source " + std::to_string(event.source->id)
+      + " have tag '" + sourceTags + "', expected: '" + tags.data() + "'"
+    );
+  }
+
+  std::tuple<T...> result;
+  Range arguments = event.arguments;
+  mserialize::deserialize(result, arguments);
+  return result;
+}
+
+} // namespace binlog
+
+#endif // BINLOG_DECODE_HPP
@@ -0,0 +1,101 @@
+#ifndef BINLOG_DEFERRED_VIEW_HPP
+#define BINLOG_DEFERRED_VIEW_HPP
+
+#include <mserialize/serialize.hpp>
+#include <mserialize/string_view.hpp>
+#include <mserialize/tag.hpp>
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <ios> // streamsize
+#include <type_traits>
+
+namespace binlog {
+
+class DeferredView
+{
+public:
+  DeferredView(const char* data, std::size_t size)
+    :_data(data),
+     _size(size)
+  {}
+
+  const char* data() const { return _data; }
+  std::size_t size() const { return _size; }
+
+private:
+  const char* _data;
+  std::size_t _size;
+};
+
+/**
+ * Create a loggable reference to the bytes [data, data+size).
+ *
+ * When an event is added by a SessionWriter, only the address
+ * and the size of the buffer is written to the queue.
+ * The bytes are copied to the output by Session::consume,
+ * moving the cost of the copy from the writer to the consumer.
+ * The bytes are logged as a sequence of chars (like std::string).
+ *
+ * Lifetime contract: the referenced buffer must remain valid and
+ * unchanged until the event is consumed, i.e: the next
+ * `Session::consume` call, which starts after the event is added, returns.
+ * In debug mode (if NDEBUG is not defined), the writer stores a checksum
+ * of the buffer, and consume asserts it did not change.
+ *
+ * Events with deferred arguments can not be recovered by brecovery,
+ * as memory dumps do not include the referenced buffers.
+ *
+ * Example:
+ *
+ *    // snapshot is immutable, and outlives the next consume
+ *    BINLOG_INFO("Snapshot: {}", binlog::deferred_view(snapshot.data(), snapshot.size()));
+ *
+ * @pre [data, data+size) must be valid until the event is consumed.
+ */
+inline DeferredView deferred_view(const void* data, std::size_t size)
+{
+  return DeferredView(static_cast<const char*>(data), size);
+}
+
+namespace detail {
+
+template <typename T>
+struct is_deferred_view : std::false_type {};
+
+template <>
+struct is_deferred_view<DeferredView> : std::true_type {};
+
+} // namespace detail
+
+} // namespace binlog
+
+namespace mserialize {
+
+// Outside of SessionWriter, DeferredView is serialized by value
+template <>
+struct CustomSerializer<binlog::DeferredView>
+{
+  template <typename OutputStream>
+  static void serialize(const binlog::DeferredView& view, OutputStream& ostream)
+  {
+    const std::uint32_t size32 = std::uint32_t(view.size());
+    assert(size32 == view.size() && "sequence size must fit on 32 bits");
+
+    mserialize::serialize(size32, ostream);
+    ostream.write(view.data(), std::streamsize(view.size()));
+  }
+
+  static std::size_t serialized_size(const binlog::DeferredView& view)
+  {
+    return sizeof(std::uint32_t) + view.size();
+  }
+};
+
+template <>
+struct CustomTag<binlog::DeferredView> : detail::Tag<string_view>::type {};
+
+} // namespace mserialize
+
+#endif // BINLOG_DEFERRED_VIEW_HPP
@@ -0,0 +1,67 @@
+#ifndef BINLOG_DICTIONARY_HPP
+#define BINLOG_DICTIONARY_HPP
+
+#include <binlog/EntryStream.hpp>
+#include <binlog/Range.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace binlog {
+
+/** @returns the FNV-1a hash of [data, data+size), the content of a dictionary */
+std::uint64_t dictionaryHash(const char* data, std::size_t size);
+
+/** @returns the path of the dictionary of `hash` in `directory`: directory/<16 hex digits>.bdict */
+std::string dictionaryPath(const std::string& directory, std::uint64_t hash);
+
+/**
+ * Entry stream that resolves the DictionaryReference entries of `input`.
+ *
+ * Returns the entries of `input`, but in place of each DictionaryReference,
+ * returns the entries of the referenced dictionary, read from `directory`.
+ * Each dictionary is read only once: referencing it again has no effect.
+ *
+ * Example:
+ *
+ *    binlog::MmapEntryStream logfile("logfile.blog.7");
+ *    binlog::DictionaryEntryStream input(logfile, "."); // dictionaries written by RotatingFileSink
+ *    binlog::EventStream eventStream;
+ *    while (const binlog::Event* event = eventStream.nextEvent(input)) { ... }
+ */
+class DictionaryEntryStream : public EntryStream
+{
+public:
+  /**
+   * Stores a reference to `input`: it must remain valid
+   * as long as *this is valid
+   */
+  DictionaryEntryStream(EntryStream& input, std::string directory);
+
+  /**
+   * @see EntryStream::nextEntryPayload
+   *
+   * The returned range remains valid until the next call.
+   *
+   * @throws std::runtime_error if a referenced dictionary can not be read,
+   *         or its content does not match the hash of the reference.
+   */
+  Range nextEntryPayload() override;
+
+private:
+  /** Read the dictionary of the DictionaryReference entry `reference` to _dictionary */
+  void loadDictionary(Range reference);
+
+  EntryStream& _input;
+  std::string _directory;
+  std::set<std::uint64_t> _loadedHashes;
+  std::vector<char> _dictionary;      // content of the dictionary being read
+  RangeEntryStream _dictionaryEntries; // the remaining entries of _dictionary
+};
+
+} // namespace binlog
+
+#endif // BINLOG_DICTIONARY_HPP
@@ -0,0 +1,276 @@
+#ifndef BINLOG_DYNAMIC_EVENT_HPP
+#define BINLOG_DYNAMIC_EVENT_HPP
+
+#include <binlog/Entries.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/detail/FormatSpec.hpp>
+
+#include <mserialize/serialize.hpp>
+#include <mserialize/string_view.hpp>
+#include <mserialize/detail/tag_util.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <ios> // streamsize
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility> // move
+
+namespace binlog {
+
+/**
+ * A type-erased log argument of a DynamicEventSource,
+ * e.g: a value of an embedded scripting language.
+ *
+ * Holds a bool, an integer, a floating point number, or a string.
+ * Strings are not copied: the referenced characters must remain
+ * valid until the event is added.
+ */
+class DynamicArgument
+{
+public:
+  enum class Type : std::uint8_t { Bool, Signed, Unsigned, Float, String };
+
+  DynamicArgument(bool value) // NOLINT(google-explicit-constructor)
+    :_type(Type::Bool)
+  {
+    _value.b = value;
+  }
+
+  template <typename T, typename std::enable_if<std::is_integral<T>::value && ! std::is_same<T, bool>::value, int>::type = 0>
+  DynamicArgument(T value) // NOLINT(google-explicit-constructor)
+    :_type(std::is_signed<T>::value ? Type::Signed : Type::Unsigned)
+  {
+    if (std::is_signed<T>::value) { _value.i = static_cast<std::int64_t>(value); }
+    else { _value.u = static_cast<std::uint64_t>(value); }
+  }
+
+  DynamicArgument(double value) // NOLINT(google-explicit-constructor)
+    :_type(Type::Float)
+  {
+    _value.f = value;
+  }
+
+  DynamicArgument(mserialize::string_view value) // NOLINT(google-explicit-constructor)
+    :_type(Type::String),
+     _data(value.data()),
+     _size(value.size())
+  {}
+
+  DynamicArgument(const char* value) // NOLINT(google-explicit-constructor)
+    :DynamicArgument(mserialize::string_view(value))
+  {}
+
+  DynamicArgument(const std::string& value) // NOLINT(google-explicit-constructor)
+    :DynamicArgument(mserialize::string_view(value))
+  {}
+
+  Type type() const { return _type; }
+
+  /** @returns the number converted to T, as static_cast does. @pre type() != Type::String */
+  template <typename T>
+  T as() const
+  {
+    switch (_type)
+    {
+    case Type::Bool:     return static_cast<T>(_value.b);
+    case Type::Signed:   return static_cast<T>(_value.i);
+    case Type::Unsigned: return static_cast<T>(_value.u);
+    case Type::Float:    return static_cast<T>(_value.f);
+    case Type::String:   break;
+    }
+    return T{};
+  }
+
+  /** @pre type() == Type::String */
+  mserialize::string_view string() const { return mserialize::string_view(_data, _size); }
+
+private:
+  Type _type;
+  union
+  {
+    bool b;
+    std::int64_t i;
+    std::uint64_t u;
+    double f;
+  } _value = {};
+  const char* _data = nullptr;
+  std::size_t _size = 0;
+};
+
+namespace detail {
+
+/** The arguments of a dynamic event, serialized according to the tags of the source */
+struct DynamicArguments
+{
+  const char* tags; // one arithmetic tag per argument, or '[' for strings ([c)
+  const DynamicArgument* args;
+  std::size_t count;
+};
+
+} // namespace detail
+
+/**
+ * An event source created at runtime, and the way to add its events.
+ *
+ * The log macros create event sources at compile time, from the types of the arguments.
+ * An embedded scripting language (e.g: Lua or Python) only knows the format string
+ * and the types of the arguments at runtime: a DynamicEventSource can be created
+ * for each call site of the script, and reused for each call.
+ * The arguments are serialized directly to the queue of the writer,
+ * according to the tags of the source, without converting them to a string first.
+ *
+ * Supported argument tags: arithmetic types (e.g: `i`, `L`, `d`, `y`) and strings (`[c`).
+ * Numeric arguments (bool, integer, floating point) are converted to the arithmetic
+ * tag of the source as static_cast does, strings are only accepted by `[c`.
+ *
+ * Example:
+ *
+ *    // once per script call site
+ *    binlog::DynamicEventSource source(session, binlog::EventSource{
+ *      0, binlog::Severity::info, "lua", "on_order", "orders.lua", 12,
+ *      "Order {} of {} at {}", "L[cd"
+ *    });
+ *
+ *    // on each call
+ *    const binlog::DynamicArgument args[] = {orderId, symbol, price};
+ *    source.addEvent(writer, binlog::clockNow(), args, 3);
+ */
+class DynamicEventSource
+{
+public:
+  /**
+   * Add `source` to `session`.
+   *
+   * @throws std::invalid_argument if `source.argumentTags` contains an unsupported tag,
+   *         or the format string has an invalid placeholder, or the number of
+   *         placeholders does not match the number of tags.
+   */
+  DynamicEventSource(Session& session, EventSource source)
+  {
+    mserialize::string_view tags = source.argumentTags;
+    while (! tags.empty())
+    {
+      const mserialize::string_view tag = mserialize::detail::tag_pop(tags);
+      if (tag == mserialize::string_view("[c"))
+      {
+        _tags.push_back('[');
+      }
+      else if (tag.size() == 1 && mserialize::string_view("ycbsilBSILfd").find(tag[0]) != mserialize::string_view::npos)
+      {
+        _tags.push_back(tag[0]);
+      }
+      else
+      {
+        throw std::invalid_argument("Unsupported argument tag of dynamic event source: " + tag.to_string());
+      }
+    }
+
+    const char* format = source.formatString.c_str();
+    if (! detail::placeholders_valid(format))
+    {
+      throw std::invalid_argument("Invalid placeholder in format string: " + source.formatString);
+    }
+    if (detail::count_placeholders(format) != _tags.size())
+    {
+      throw std::invalid_argument("Number of placeholders in format string must match number of argument tags");
+    }
+
+    _id = session.addEventSource(std::move(source));
+  }
+
+  /** @returns the id of the event source, assigned by the session */
+  std::uint64_t id() const { return _id; }
+
+  /**
+   * Add an event of this source to `writer` (a SessionWriter or TaskWriter).
+   *
+   * @pre `writer` must write the session this source was added to.
+   * @throws std::invalid_argument if the number or types of `args` do not match the argument tags
+   * @returns the value returned by writer.addEvent
+   */
+  template <typename Writer>
+  bool addEvent(Writer& writer, std::uint64_t clock, const DynamicArgument* args, std::size_t count) const
+  {
+    if (count != _tags.size())
+    {
+      throw std::invalid_argument("Number of dynamic arguments must match number of argument tags");
+    }
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      if ((_tags[i] == '[') != (args[i].type() == DynamicArgument::Type::String))
+      {
+        throw std::invalid_argument("Type of dynamic argument #" + std::to_string(i) + " does not match its tag");
+      }
+    }
+
+    return writer.addEvent(_id, clock, detail::DynamicArguments{_tags.data(), args, count});
+  }
+
+private:
+  std::uint64_t _id = 0;
+  std::string _tags;
+};
+
+} // namespace binlog
+
+namespace mserialize {
+
+template <>
+struct CustomSerializer<binlog::detail::DynamicArguments>
+{
+  template <typename OutputStream>
+  static void serialize(const binlog::detail::DynamicArguments& a, OutputStream& ostream)
+  {
+    for (std::size_t i = 0; i < a.count; ++i)
+    {
+      const binlog::DynamicArgument& arg = a.args[i];
+      switch (a.tags[i])
+      {
+      case 'y': mserialize::serialize(arg.as<bool>(), ostream); break;
+      case 'c': mserialize::serialize(arg.as<char>(), ostream); break;
+      case 'b': mserialize::serialize(arg.as<std::int8_t>(), ostream); break;
+      case 's': mserialize::serialize(arg.as<std::int16_t>(), ostream); break;
+      case 'i': mserialize::serialize(arg.as<std::int32_t>(), ostream); break;
+      case 'l': mserialize::serialize(arg.as<std::int64_t>(), ostream); break;
+      case 'B': mserialize::serialize(arg.as<std::uint8_t>(), ostream); break;
+      case 'S': mserialize::serialize(arg.as<std::uint16_t>(), ostream); break;
+      case 'I': mserialize::serialize(arg.as<std::uint32_t>(), ostream); break;
+      case 'L': mserialize::serialize(arg.as<std::uint64_t>(), ostream); break;
+      case 'f': mserialize::serialize(arg.as<float>(), ostream); break;
+      case 'd': mserialize::serialize(arg.as<double>(), ostream); break;
+      case '[':
+      {
+        const mserialize::string_view str = arg.string();
+        mserialize::serialize(std::uint32_t(str.size()), ostream);
+        ostream.write(str.data(), std::streamsize(str.size()));
+        break;
+      }
+      default: break;
+      }
+    }
+  }
+
+  static std::size_t serialized_size(const binlog::detail::DynamicArguments& a)
+  {
+    std::size_t result = 0;
+    for (std::size_t i = 0; i < a.count; ++i)
+    {
+      switch (a.tags[i])
+      {
+      case 'y': case 'c': case 'b': case 'B': result += 1; break;
+      case 's': case 'S': result += 2; break;
+      case 'i': case 'I': case 'f': result += 4; break;
+      case 'l': case 'L': case 'd': result += 8; break;
+      case '[': result += sizeof(std::uint32_t) + a.args[i].string().size(); break;
+      default: break;
+      }
+    }
+    return result;
+  }
+};
+
+} // namespace mserialize
+
+#endif // BINLOG_DYNAMIC_EVENT_HPP
@@ -4,11 +4,15 @@
 #include <binlog/Range.hpp>
 #include <binlog/Severity.hpp>
 
+#include <binlog/detail/SegmentedMap.hpp>
+
 #include <mserialize/make_struct_deserializable.hpp>
 #include <mserialize/make_struct_serializable.hpp>
 #include <mserialize/serialize.hpp>
 
 #include <cstdint>
+#include <cstring> // strlen
+#include <ios> // streamsize
 #include <string>
 
 /*
@@ -46,6 +50,25 @@ struct EventSource
   std::string argumentTags; /**< mserialize::tag of the arguments */
 };
 
+/**
+ * The static properties of an EventSource, referenced by a call site.
+ *
+ * Constant initialized by the log macros, the strings
+ * are string literals with static storage duration.
+ * Serialized as an EventSource (with an id assigned by the Session),
+ * without copying the strings, see serializeSizePrefixedTagged.
+ */
+struct StaticEventSource
+{
+  Severity severity;        // NOLINT
+  const char* category;     // NOLINT
+  const char* function;     // NOLINT
+  const char* file;         // NOLINT
+  std::uint64_t line;       // NOLINT
+  const char* formatString; // NOLINT
+  const char* argumentTags; // NOLINT
+};
+
 /**
  * Represents a writer (thread, fiber, coroutine, task)
  * that triggers EventSources to produce events.
@@ -68,7 +91,26 @@ struct WriterProp
 
   std::uint64_t id = {};
   std::string name;
-  std::uint64_t batchSize = {};
+  std::uint64_t batchSize = {}; // last field: Session patches it in the serialized entry
+
+  /** Set by readers from the WriterContext entries of the writer, not serialized */
+  std::string context = {}; // initializer: keeps WriterProp{id, name, batchSize} warning free
+};
+
+/**
+ * Represents the context of the following events of a writer,
+ * e.g: the id of the trace or session they belong to, see SessionWriter::setContext.
+ *
+ * In effect for the events following this entry, until the next
+ * WriterContext or WriterProp entry. An empty `context` clears it.
+ * The context is attributed to the events by readers (see EventStream),
+ * instead of being carried by each event as an argument.
+ */
+struct WriterContext
+{
+  static constexpr std::uint64_t Tag = std::uint64_t(-13);
+
+  std::string context;
 };
 
 /**
@@ -107,6 +149,175 @@ struct ClockSync
   std::string tzName;                /**< Time zone name */
 };
 
+/**
+ * Represents events lost by a writer.
+ *
+ * `count` is the number of events the writer of the
+ * most recent WriterProp did not write to its queue,
+ * since the previous DroppedEvents entry of the same writer,
+ * e.g: because the queue was full, see SessionWriter::OverflowPolicy.
+ */
+struct DroppedEvents
+{
+  static constexpr std::uint64_t Tag = std::uint64_t(-4);
+
+  std::uint64_t count = {};
+};
+
+/**
+ * Represents a sequence of events in a compact encoding (binlog format v2).
+ *
+ * Regular events carry a 32 bit size, a 64 bit source id and
+ * a 64 bit clock value each. In a CompactEvents entry, the events
+ * are serialized after the tag as:
+ *
+ *     u8 version                     // formatVersion
+ *     {
+ *       varint size                  // of the remaining fields of the event
+ *       varint eventSourceId << 1 | c // c is 1 for counter events (since version 3)
+ *       varint zigzag(clock delta)   // clock - clock of the previous event of the entry, or 0
+ *       arguments                    // as in regular events, except counters
+ *     }...
+ *
+ * where varints are unsigned LEB128 integers, and the zigzag encoding
+ * maps small negative numbers to small positive ones.
+ * The arguments of counter events (the argument tags of their source
+ * are detail::counterArgumentTags, see BINLOG_COUNTER_WC) are a single
+ * varint zigzag(value delta): the value minus the previous value of the
+ * same source in the entry, or 0. In version 2, the source id is not shifted,
+ * and there are no counter events.
+ * Each entry is self contained: the first clock delta is relative to 0.
+ * The events are produced by the writer of the most recent WriterProp,
+ * as regular events.
+ *
+ * Written by CompactOutputStream, read by EventStream.
+ */
+struct CompactEvents
+{
+  static constexpr std::uint64_t Tag = std::uint64_t(-6);
+  static constexpr std::uint8_t formatVersion = 3;     // since delta encoded counters
+  static constexpr std::uint8_t minFormatVersion = 2;  // readable, without counters
+};
+
+/**
+ * Represents events collapsed by RepeatCollapsingStream.
+ *
+ * `count` is the number of events the writer of the
+ * most recent WriterProp produced after its latest event,
+ * since the previous RepeatedEvents entry of the same writer,
+ * which are identical to that event (same source, same arguments),
+ * and therefore not written to the stream.
+ * `lastClockValue` is the clock value of the last of them.
+ */
+struct RepeatedEvents
+{
+  static constexpr std::uint64_t Tag = std::uint64_t(-8);
+
+  std::uint64_t count = {};
+  std::uint64_t lastClockValue = {};
+};
+
+/**
+ * Represents a string interned by a Session, see binlog::interned.
+ *
+ * Events refer to the string by `id`, instead of carrying a copy of it:
+ * the argument is serialized as a binlog::InternedStringId.
+ * Like EventSources, interned strings are metadata,
+ * always consumed before the events referring to them.
+ */
+struct InternedString
+{
+  static constexpr std::uint64_t Tag = std::uint64_t(-7);
+
+  std::uint64_t id = {};
+  std::string value;
+};
+
+/**
+ * References a dictionary: a file of EventSource and InternedString entries,
+ * written once, and shared by many logfiles, instead of repeating
+ * the metadata at the beginning of each.
+ *
+ * `hash` is the FNV-1a hash of the content of the dictionary,
+ * which also names the file, see dictionaryPath.
+ * The entries of the dictionary are in effect after this entry,
+ * as if they were written in its place, see DictionaryEntryStream.
+ */
+struct DictionaryReference
+{
+  static constexpr std::uint64_t Tag = std::uint64_t(-9);
+
+  std::uint64_t hash = {};
+};
+
+/**
+ * The correction applied to the wall clock time of the events after this entry,
+ * e.g: the offset of the local clock to a reference, measured by PTP or NTP.
+ *
+ * `offset` (nanoseconds) is already added to the nsSinceEpoch member
+ * of the ClockSync entries following this entry, readers need not apply it.
+ * The corrected time of the events is accurate to +/- `uncertainty` nanoseconds,
+ * 0 if unknown. In effect until the next ClockCorrection entry.
+ */
+struct ClockCorrection
+{
+  static constexpr std::uint64_t Tag = std::uint64_t(-10);
+
+  std::int64_t offset = {};
+  std::uint64_t uncertainty = {};
+};
+
+/**
+ * Closes a checkpoint of an EventStream, see EventStream::writeCheckpoint.
+ *
+ * A checkpoint is a binlog stream of metadata entries (the state of the reader),
+ * followed by this entry. `offset` is the position of the input stream
+ * the reader reached when the checkpoint was written, in bytes.
+ */
+struct Checkpoint
+{
+  static constexpr std::uint64_t Tag = std::uint64_t(-11);
+
+  std::uint64_t offset = {};
+};
+
+/**
+ * Represents a sequence of event sources, with their strings deduplicated.
+ *
+ * The strings of the sources (category, function, file, format string
+ * and argument tags) are stored once, sorted and front coded
+ * (each string as the length of the prefix shared with the previous
+ * one and the rest of it), the sources refer to them by index.
+ * Serialized after the tag as:
+ *
+ *     u8 version                     // formatVersion
+ *     varint stringCount
+ *     {
+ *       varint sharedPrefixSize      // with the previous string, or 0
+ *       varint suffixSize
+ *       char[suffixSize] suffix
+ *     }...
+ *     varint sourceCount
+ *     {
+ *       varint id
+ *       varint severity
+ *       varint category, function, file   // string indices
+ *       varint line
+ *       varint formatString, argumentTags // string indices
+ *     }...
+ *
+ * where varints are as in CompactEvents. Each entry is self contained.
+ * The sources are in effect after this entry, as if they were
+ * written as EventSource entries in its place.
+ *
+ * Written by CompactOutputStream (see setEventSourceTables), read by EventStream.
+ */
+struct EventSourceTable
+{
+  static constexpr std::uint64_t Tag = std::uint64_t(-12);
+  static constexpr std::uint8_t formatVersion = 1;
+};
+
 /**
  * Represents a log event (one line in a logfile).
  *
@@ -116,12 +327,16 @@ struct ClockSync
  * `clockValue` marks the time when the event was created.
  * It can be interpreted together with a ClockSync.
  * `clockValue` is zero if the event is not timestamped.
+ *
+ * `internedStrings` maps the ids of InternedString entries read so far
+ * to their values, to resolve interned arguments, or is nullptr.
  */
 struct Event
 {
   const EventSource* source = nullptr;
   std::uint64_t clockValue = {};
   Range arguments;
+  const detail::SegmentedMap<std::string>* internedStrings = nullptr;
 };
 
 /**
@@ -147,6 +362,55 @@ std::size_t serializeSizePrefixedTagged(const Entry& entry, OutputStream& out)
   return size + sizeof(size);
 }
 
+namespace detail {
+
+template <typename OutputStream>
+void serializeCString(const char* str, std::uint32_t size, OutputStream& out)
+{
+  mserialize::serialize(size, out);
+  out.write(str, std::streamsize(size));
+}
+
+} // namespace detail
+
+/**
+ * Serialize `source` to `out` as an EventSource with `id`,
+ * prefixed with size and tag.
+ *
+ * The result is the same as of serializing the equivalent EventSource.
+ *
+ * @returns total number of bytes written to `out`
+ */
+template <typename OutputStream>
+std::size_t serializeSizePrefixedTagged(std::uint64_t id, const StaticEventSource& source, OutputStream& out)
+{
+  const std::uint32_t categorySize = std::uint32_t(std::strlen(source.category));
+  const std::uint32_t functionSize = std::uint32_t(std::strlen(source.function));
+  const std::uint32_t fileSize = std::uint32_t(std::strlen(source.file));
+  const std::uint32_t formatStringSize = std::uint32_t(std::strlen(source.formatString));
+  const std::uint32_t argumentTagsSize = std::uint32_t(std::strlen(source.argumentTags));
+
+  const std::uint64_t tag = EventSource::Tag;
+  const std::uint32_t size = std::uint32_t(
+    sizeof(tag) + sizeof(id) + sizeof(source.severity) + sizeof(source.line)
+    + 5 * sizeof(std::uint32_t)
+    + categorySize + functionSize + fileSize + formatStringSize + argumentTagsSize
+  );
+
+  mserialize::serialize(size, out);
+  mserialize::serialize(tag, out);
+  mserialize::serialize(id, out);
+  mserialize::serialize(source.severity, out);
+  detail::serializeCString(source.category, categorySize, out);
+  detail::serializeCString(source.function, functionSize, out);
+  detail::serializeCString(source.file, fileSize, out);
+  mserialize::serialize(source.line, out);
+  detail::serializeCString(source.formatString, formatStringSize, out);
+  detail::serializeCString(source.argumentTags, argumentTagsSize, out);
+
+  return size + sizeof(size);
+}
+
 } // namespace binlog
 
 MSERIALIZE_MAKE_STRUCT_SERIALIZABLE(  binlog::EventSource, id, severity, category, function, file, line, formatString, argumentTags)
@@ -155,7 +419,28 @@ MSERIALIZE_MAKE_STRUCT_DESERIALIZABLE(binlog::EventSource, id, severity, categor
 MSERIALIZE_MAKE_STRUCT_SERIALIZABLE(  binlog::WriterProp, id, name, batchSize)
 MSERIALIZE_MAKE_STRUCT_DESERIALIZABLE(binlog::WriterProp, id, name, batchSize)
 
+MSERIALIZE_MAKE_STRUCT_SERIALIZABLE(  binlog::WriterContext, context)
+MSERIALIZE_MAKE_STRUCT_DESERIALIZABLE(binlog::WriterContext, context)
+
 MSERIALIZE_MAKE_STRUCT_SERIALIZABLE(  binlog::ClockSync, clockValue, clockFrequency, nsSinceEpoch, tzOffset, tzName)
 MSERIALIZE_MAKE_STRUCT_DESERIALIZABLE(binlog::ClockSync, clockValue, clockFrequency, nsSinceEpoch, tzOffset, tzName)
 
+MSERIALIZE_MAKE_STRUCT_SERIALIZABLE(  binlog::DroppedEvents, count)
+MSERIALIZE_MAKE_STRUCT_DESERIALIZABLE(binlog::DroppedEvents, count)
+
+MSERIALIZE_MAKE_STRUCT_SERIALIZABLE(  binlog::RepeatedEvents, count, lastClockValue)
+MSERIALIZE_MAKE_STRUCT_DESERIALIZABLE(binlog::RepeatedEvents, count, lastClockValue)
+
+MSERIALIZE_MAKE_STRUCT_SERIALIZABLE(  binlog::InternedString, id, value)
+MSERIALIZE_MAKE_STRUCT_DESERIALIZABLE(binlog::InternedString, id, value)
+
+MSERIALIZE_MAKE_STRUCT_SERIALIZABLE(  binlog::DictionaryReference, hash)
+MSERIALIZE_MAKE_STRUCT_DESERIALIZABLE(binlog::DictionaryReference, hash)
+
+MSERIALIZE_MAKE_STRUCT_SERIALIZABLE(  binlog::ClockCorrection, offset, uncertainty)
+MSERIALIZE_MAKE_STRUCT_DESERIALIZABLE(binlog::ClockCorrection, offset, uncertainty)
+
+MSERIALIZE_MAKE_STRUCT_SERIALIZABLE(  binlog::Checkpoint, offset)
+MSERIALIZE_MAKE_STRUCT_DESERIALIZABLE(binlog::Checkpoint, offset)
+
 #endif // BINLOG_ENTRIES_HPP
@@ -3,7 +3,11 @@
 
 #include <binlog/Range.hpp>
 
+#include <cstddef>
 #include <iosfwd>
+#include <memory>
+#include <string>
+#include <thread>
 #include <vector>
 
 namespace binlog {
@@ -56,6 +60,71 @@ private:
   std::istream& _input;
 };
 
+/**
+ * Entry stream with a std::istream as the underlying device,
+ * read in large blocks by a background thread.
+ *
+ * Unlike IstreamEntryStream, it never seeks the input,
+ * therefore suitable for pipes and stdin.
+ * While the entries of a block are processed, the next
+ * block is read concurrently. A block is handed over as soon as
+ * the input has no more bytes readily available, thus
+ * entries written to a slow pipe (e.g: `tail -F`) are not delayed
+ * until a whole block is filled.
+ * Entries spanning blocks are assembled in a separate buffer.
+ */
+class ReadaheadEntryStream : public EntryStream
+{
+public:
+  /**
+   * Start reading `input` on a background thread, in blocks of `blockSize` bytes.
+   *
+   * Stores a reference to `input`: it must remain valid
+   * as long as *this is valid. If *this is destroyed before
+   * the end of the input is reached, the destructor waits
+   * until the pending read of the input returns.
+   *
+   * @pre input must not be accessed by others while *this is valid
+   */
+  explicit ReadaheadEntryStream(std::istream& input, std::size_t blockSize = 1 << 20);
+
+  /** Stop and join the background thread */
+  ~ReadaheadEntryStream() override;
+
+  ReadaheadEntryStream(const ReadaheadEntryStream&) = delete;
+  void operator=(const ReadaheadEntryStream&) = delete;
+
+  /**
+   * @see EntryStream::nextEntryPayload
+   *
+   * The returned range remains valid until the next call.
+   * Blocks until a complete entry, or the end of the input is available.
+   * If the input ends with an incomplete entry, an exception is thrown,
+   * and the incomplete entry is dropped.
+   */
+  Range nextEntryPayload() override;
+
+private:
+  struct Shared;
+
+  /**
+   * Get the next block from the background thread, if it has any.
+   *
+   * @returns false if there are no more blocks
+   */
+  bool nextBlock();
+
+  /** Read `input` to blocks of `shared`, until eof, error or stop */
+  static void readBlocks(Shared& shared, std::istream& input, std::size_t blockSize);
+
+  std::shared_ptr<Shared> _shared;
+  std::thread _thread;
+
+  std::vector<char> _block; // the block being processed
+  std::size_t _blockPos = 0;
+  std::vector<char> _entry; // an entry spanning blocks
+};
+
 /** Entry stream with a Range (sequence of bytes) as the underlying device */
 class RangeEntryStream : public EntryStream
 {
@@ -71,12 +140,57 @@ public:
    *
    * On error, *this remains in an unspecified but valid state.
    */
-  Range nextEntryPayload() override;
+  Range nextEntryPayload() final;
 
 private:
   Range _input;
 };
 
+/**
+ * Entry stream with a memory mapped file as the underlying device.
+ *
+ * The returned payloads point directly into the mapping:
+ * entries are not copied.
+ * The file is mapped as a whole when *this is constructed,
+ * data appended to the file later is not visible.
+ */
+class MmapEntryStream : public EntryStream
+{
+public:
+  /**
+   * Map the file at `path` for reading.
+   *
+   * @throws std::runtime_error if `path` can not be opened,
+   *         it is not a regular file, or can not be mapped.
+   */
+  explicit MmapEntryStream(const std::string& path);
+
+  /** Unmaps the file - ranges returned by nextEntryPayload are invalidated */
+  ~MmapEntryStream() override;
+
+  MmapEntryStream(const MmapEntryStream&) = delete;
+  void operator=(const MmapEntryStream&) = delete;
+
+  /**
+   * @see EntryStream::nextEntryPayload
+   *
+   * The returned range remains valid as long as *this is valid.
+   * On error, *this remains unchanged.
+   */
+  Range nextEntryPayload() final;
+
+  /** @returns the beginning of the mapped file */
+  const char* data() const { return _data; }
+
+  /** @returns the size of the mapped file */
+  std::size_t size() const { return _size; }
+
+private:
+  const char* _data = nullptr;
+  std::size_t _size = 0;
+  std::size_t _pos = 0;
+};
+
 } // namespace binlog
 
 #endif // BINLOG_ENTRY_STREAM_HPP
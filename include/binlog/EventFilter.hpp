@@ -3,6 +3,8 @@
 
 #include <binlog/Entries.hpp> // EventSource
 #include <binlog/Range.hpp>
+#include <binlog/detail/ForEachEntry.hpp>
+#include <binlog/detail/SourceIdMap.hpp>
 
 #include <mserialize/deserialize.hpp>
 
@@ -10,7 +12,6 @@
 #include <cstdint>
 #include <functional>
 #include <ios> // streamsize
-#include <set>
 #include <stdexcept> // runtime_error
 #include <utility> // move
 
@@ -50,7 +51,7 @@ public:
 
 private:
   Predicate _isAllowed;
-  std::set<std::uint64_t> _allowedSourceIds; // TODO(benedek) perf: use a more efficient set
+  detail::SourceIdMap<bool> _allowedSourceIds;
 };
 
 inline EventFilter::EventFilter(Predicate isAllowed)
@@ -62,17 +63,9 @@ std::size_t EventFilter::writeAllowed(const char* buffer, std::size_t bufferSize
 {
   std::size_t totalWriteSize = 0;
 
-  Range entries(buffer, bufferSize);
-
-  while (! entries.empty())
+  detail::forEachEntry(buffer, bufferSize, [&](Range entry, std::uint64_t tag, Range payload)
   {
-    Range entry = entries;
-    const std::uint32_t size = entries.read<std::uint32_t>();
-    Range payload(entries.view(size), size);
-    const std::uint64_t tag = payload.read<std::uint64_t>();
-    const bool special = (tag & (std::uint64_t(1) << 63)) != 0;
-
-    if (special)
+    if (detail::isSpecialEntryTag(tag))
     {
       // event sources are inspected to populate _allowedSourceIds
       if (tag == EventSource::Tag)
@@ -81,24 +74,24 @@ std::size_t EventFilter::writeAllowed(const char* buffer, std::size_t bufferSize
         mserialize::deserialize(eventSource, payload);
         if (_isAllowed(eventSource))
         {
-          _allowedSourceIds.insert(eventSource.id);
+          _allowedSourceIds.set(eventSource.id, true);
         }
         // else: event source is not allowed, events referencing it
         // will not be written.
       }
     }
-    else if (_allowedSourceIds.count(tag) == 0)
+    else if (! _allowedSourceIds.get(tag))
     {
       // event is produced by a disallowed source, ignore it
-      continue;
+      return;
     }
 
     // either special entry or event produced by an allowed source, write it
     // TODO(benedek) perf: batch contiguous entries into one out.write
-    const std::size_t sizePrefixedSize = size + sizeof(size);
+    const std::size_t sizePrefixedSize = entry.size();
     out.write(entry.view(sizePrefixedSize), std::streamsize(sizePrefixedSize));
     totalWriteSize += sizePrefixedSize;
-  }
+  });
 
   return totalWriteSize;
 }
@@ -0,0 +1,152 @@
+#ifndef BINLOG_EVENT_INDEX_HPP
+#define BINLOG_EVENT_INDEX_HPP
+
+#include <binlog/Entries.hpp>
+#include <binlog/EventStream.hpp>
+#include <binlog/PrettyPrinter.hpp>
+#include <binlog/Range.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace binlog {
+
+/**
+ * Random access to the events of a logfile, e.g: for an interactive viewer,
+ * that shows any part of a large file, without reading it from the beginning.
+ *
+ * The index is built by a single scan of the logfile: only the size, tag and clock
+ * of the events are read, their arguments are skipped. For each event, the index stores
+ * its offset (8 bytes). The writer properties and clock syncs are stored
+ * once, and referenced by the events where they change. Other metadata
+ * (event sources, interned strings) is loaded once, as by EventStream.
+ *
+ * Only plain logfiles are supported, not compact or compressed ones.
+ *
+ * Example:
+ *
+ *    binlog::MmapEntryStream file(path);
+ *    binlog::EventIndex index(binlog::Range(file.data(), file.size()));
+ *
+ *    const binlog::Event& event = index.eventAt(index.size() / 2);
+ *    printer.printEvent(out, event, index.writerPropAt(index.size() / 2), index.clockSyncAt(index.size() / 2));
+ */
+class EventIndex
+{
+public:
+  /**
+   * Index the events of `input`, a sequence of size prefixed entries.
+   * The buffer referenced by `input` must remain valid as long as *this is valid.
+   *
+   * @throws std::runtime_error if `input` contains an invalid entry,
+   *         or a CompactEvents or DictionaryReference entry.
+   */
+  explicit EventIndex(Range input);
+
+  /** @returns the number of events in the input */
+  std::size_t size() const { return _offsets.size(); }
+
+  /**
+   * Decode the event at position `i`.
+   *
+   * The returned reference is valid until the next call of eventAt,
+   * the objects reachable from it as long as *this and the input is valid.
+   *
+   * @pre i < size()
+   */
+  const Event& eventAt(std::size_t i);
+
+  /** @returns the writer properties of the event at position `i`. @pre i < size() */
+  const WriterProp& writerPropAt(std::size_t i) const;
+
+  /** @returns the clock sync of the event at position `i`. @pre i < size() */
+  const ClockSync& clockSyncAt(std::size_t i) const;
+
+  /** @returns the offset of the event at position `i` in the input. @pre i < size() */
+  std::uint64_t offsetAt(std::size_t i) const { return _offsets[i]; }
+
+  /**
+   * @returns the position of the first event with clock value not less than `clockValue`,
+   *          or size() if there's no such event.
+   *
+   * Uses the largest clock value of the preceding events (stored per block of events),
+   * to find the event in logarithmic time, even if the events of different writers
+   * are slightly out of order.
+   */
+  std::size_t findClock(std::uint64_t clockValue) const;
+
+private:
+  /** The writer properties and clock sync of the events starting at `firstEvent` */
+  struct Context
+  {
+    std::uint64_t firstEvent;
+    std::uint32_t writerProp; // index in _writerProps
+    std::uint32_t clockSync;  // index in _clockSyncs
+  };
+
+  void setContext(std::uint32_t writerProp, std::uint32_t clockSync);
+
+  const Context& contextAt(std::size_t i) const;
+
+  std::uint64_t clockAt(std::size_t i) const;
+
+  static constexpr std::size_t clockBlockSize = 256;
+
+  const char* _data; // the beginning of the input
+  std::vector<std::uint64_t> _offsets;    // of the events, pointing to the size field
+  std::vector<std::uint64_t> _maxClocks;  // largest clock value of the events [0, (b+1)*clockBlockSize)
+  std::vector<Context> _contexts;         // ordered by firstEvent
+  std::vector<WriterProp> _writerProps;   // batchSize is zero
+  std::vector<ClockSync> _clockSyncs;
+  EventStream _eventStream; // event sources and interned strings of the input
+  Event _event;
+};
+
+/**
+ * Pretty printed events of an EventIndex, for display,
+ * with the most recently used lines cached.
+ *
+ * Example:
+ *
+ *    binlog::PrettyPrinter printer("%S %m", "%Y-%m-%d %H:%M:%S");
+ *    binlog::EventLineCache lines(index, printer);
+ *    for (std::size_t i = first; i < first + rowsOnScreen; ++i)
+ *    {
+ *      drawText(lines.line(i));
+ *    }
+ */
+class EventLineCache
+{
+public:
+  /**
+   * `index` and `printer` must remain valid as long as *this is valid.
+   * At most `capacity` lines are cached.
+   */
+  EventLineCache(EventIndex& index, PrettyPrinter& printer, std::size_t capacity = 4096);
+
+  /**
+   * @returns the event at position `i`, pretty printed, without the trailing newline.
+   * The returned reference is valid until the next call of line.
+   *
+   * @pre i < index.size()
+   */
+  const std::string& line(std::size_t i);
+
+private:
+  using Lines = std::list<std::pair<std::size_t, std::string>>; // most recently used first
+
+  EventIndex& _index;
+  PrettyPrinter& _printer;
+  std::size_t _capacity;
+  Lines _lines;
+  std::unordered_map<std::size_t, Lines::iterator> _positions;
+};
+
+} // namespace binlog
+
+#endif // BINLOG_EVENT_INDEX_HPP
@@ -0,0 +1,287 @@
+#ifndef BINLOG_EVENT_QUOTA_HPP
+#define BINLOG_EVENT_QUOTA_HPP
+
+#include <binlog/Entries.hpp> // EventSource
+#include <binlog/Range.hpp>
+#include <binlog/Severity.hpp>
+#include <binlog/detail/ForEachEntry.hpp>
+#include <binlog/detail/SourceIdMap.hpp>
+
+#include <mserialize/deserialize.hpp>
+#include <mserialize/serialize.hpp>
+
+#include <algorithm> // min
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ios> // streamsize
+#include <string>
+#include <utility> // move
+#include <vector>
+
+namespace binlog {
+
+/**
+ * From a stream of entries, pass through events within the byte quota
+ * of the class of their event source (e.g: category or severity),
+ * drop (or sample) the excess events, and add summary events of the dropped ones.
+ *
+ * Each class has a token bucket of `bytesPerSecond` capacity, refilled
+ * continuously by `bytesPerSecond` per second of consume time.
+ * An event is written if the bucket of its class holds its size,
+ * otherwise it is dropped, unless `sampleOneIn` is set: then every
+ * sampleOneIn'th event over the quota is written.
+ *
+ * The dropped events are summarized by events of a source added by EventQuota
+ * ("Over quota {}: dropped {} events, {} bytes", category "binlog"),
+ * at most once per second per class, and by writeSummaries.
+ *
+ * Example, limit the "net" category to 1 MB/s:
+ *
+ *    binlog::EventQuota quota(
+ *      {{"net", 1 << 20, 0}},
+ *      [](const binlog::EventSource& source) {
+ *        return source.category == "net" ? 0 : binlog::EventQuota::noLimit;
+ *      }
+ *    );
+ *    // in the write(buffer, size) of the consumed OutputStream:
+ *    quota.writeAllowed(buffer, size, logfile);
+ */
+class EventQuota
+{
+public:
+  /** The quota of a class of event sources */
+  struct Limit
+  {
+    std::string name;                 /**< Shown by the summary events */
+    std::uint64_t bytesPerSecond = 0; /**< Sustained rate, and burst size */
+    std::uint32_t sampleOneIn = 0;    /**< If non-zero, write every n'th event over the quota */
+  };
+
+  /** @returns the index of the Limit of the source, or noLimit */
+  using Classifier = std::function<std::size_t(const EventSource&)>;
+
+  static constexpr std::size_t noLimit = ~std::size_t(0);
+
+  /** Id of the event source of the summary events, not used by Session */
+  static constexpr std::uint64_t summarySourceId = std::uint64_t(1) << 62;
+
+  /** @param classify is called once for each EventSource */
+  EventQuota(std::vector<Limit> limits, Classifier classify);
+
+  /**
+   * From the sequence of entries in [buffer, buffer+bufferSize),
+   * write special entries, and events within the quota to `out`.
+   * Events of sources not seen by *this, and of sources of noLimit, are written.
+   * The summaries of dropped events are written after the entries,
+   * if the last summary of the class was written at least a second before `now`.
+   *
+   * @requires OutputStream must model the mserialize::OutputStream concept
+   * @throws std::runtime_error if `buffer` contains an invalid entry
+   * @returns the number of bytes written to `out`
+   */
+  template <typename OutputStream>
+  std::size_t writeAllowed(
+    const char* buffer, std::size_t bufferSize, OutputStream& out,
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now()
+  );
+
+  /**
+   * Write the summaries of every class that dropped events since its last summary,
+   * e.g: before closing the output.
+   *
+   * @returns the number of bytes written to `out`
+   */
+  template <typename OutputStream>
+  std::size_t writeSummaries(OutputStream& out);
+
+  /** @returns the number of events dropped so far */
+  std::uint64_t droppedEvents() const { return _droppedEvents; }
+
+  /** @returns the number of bytes dropped so far */
+  std::uint64_t droppedBytes() const { return _droppedBytes; }
+
+private:
+  struct Bucket
+  {
+    Limit limit;
+    double tokens = 0; // available bytes
+    std::chrono::steady_clock::time_point lastRefill;
+    bool started = false;
+    std::uint64_t overCount = 0; // events over the quota, to sample them
+
+    // dropped since the last summary
+    std::uint64_t droppedEvents = 0;
+    std::uint64_t droppedBytes = 0;
+    std::uint64_t lastDroppedClock = 0;
+    std::chrono::steady_clock::time_point lastSummary;
+    bool summarized = false;
+  };
+
+  void classifySource(const EventSource& source);
+
+  /** @returns true if the event of `size` bytes is within the quota of `bucket` */
+  static bool take(Bucket& bucket, std::size_t size, std::chrono::steady_clock::time_point now);
+
+  template <typename OutputStream>
+  std::size_t writeSummary(Bucket& bucket, OutputStream& out);
+
+  Classifier _classify;
+  std::vector<Bucket> _buckets; // by the index of their Limit
+  detail::SourceIdMap<std::uint32_t> _sourceBuckets; // bucket index + 1 by id, 0 if unlimited
+
+  bool _summarySourceWritten = false;
+  std::uint64_t _droppedEvents = 0;
+  std::uint64_t _droppedBytes = 0;
+};
+
+inline EventQuota::EventQuota(std::vector<Limit> limits, Classifier classify)
+  :_classify(std::move(classify))
+{
+  for (Limit& limit : limits)
+  {
+    _buckets.emplace_back();
+    _buckets.back().limit = std::move(limit);
+  }
+}
+
+inline void EventQuota::classifySource(const EventSource& source)
+{
+  const std::size_t index = _classify(source);
+  const std::uint32_t bucket = (index < _buckets.size()) ? std::uint32_t(index + 1) : 0;
+
+  _sourceBuckets.set(source.id, bucket);
+}
+
+inline bool EventQuota::take(Bucket& bucket, std::size_t size, std::chrono::steady_clock::time_point now)
+{
+  const double capacity = double(bucket.limit.bytesPerSecond);
+  if (! bucket.started)
+  {
+    bucket.tokens = capacity;
+    bucket.lastRefill = now;
+    bucket.started = true;
+  }
+  else if (now > bucket.lastRefill)
+  {
+    const double elapsed = std::chrono::duration<double>(now - bucket.lastRefill).count();
+    bucket.tokens = (std::min)(capacity, bucket.tokens + capacity * elapsed);
+    bucket.lastRefill = now;
+  }
+
+  if (bucket.tokens >= double(size))
+  {
+    bucket.tokens -= double(size);
+    return true;
+  }
+
+  // over the quota
+  ++bucket.overCount;
+  return bucket.limit.sampleOneIn != 0 && bucket.overCount % bucket.limit.sampleOneIn == 0;
+}
+
+template <typename OutputStream>
+std::size_t EventQuota::writeAllowed(
+  const char* buffer, std::size_t bufferSize, OutputStream& out,
+  std::chrono::steady_clock::time_point now
+)
+{
+  std::size_t totalWriteSize = 0;
+
+  detail::forEachEntry(buffer, bufferSize, [&](Range entry, std::uint64_t tag, Range payload)
+  {
+    const std::size_t sizePrefixedSize = entry.size();
+
+    if (detail::isSpecialEntryTag(tag))
+    {
+      if (tag == EventSource::Tag)
+      {
+        EventSource eventSource;
+        mserialize::deserialize(eventSource, payload);
+        classifySource(eventSource);
+      }
+    }
+    else if (const std::size_t bucketIndex = _sourceBuckets.get(tag))
+    {
+      Bucket& bucket = _buckets[bucketIndex - 1];
+      if (! take(bucket, sizePrefixedSize, now))
+      {
+        ++bucket.droppedEvents;
+        bucket.droppedBytes += sizePrefixedSize;
+        bucket.lastDroppedClock = payload.read<std::uint64_t>();
+        ++_droppedEvents;
+        _droppedBytes += sizePrefixedSize;
+        return;
+      }
+    }
+
+    out.write(entry.view(sizePrefixedSize), std::streamsize(sizePrefixedSize));
+    totalWriteSize += sizePrefixedSize;
+  });
+
+  for (Bucket& bucket : _buckets)
+  {
+    if (bucket.droppedEvents != 0 && (! bucket.summarized || now - bucket.lastSummary >= std::chrono::seconds(1)))
+    {
+      totalWriteSize += writeSummary(bucket, out);
+      bucket.lastSummary = now;
+      bucket.summarized = true;
+    }
+  }
+
+  return totalWriteSize;
+}
+
+template <typename OutputStream>
+std::size_t EventQuota::writeSummaries(OutputStream& out)
+{
+  std::size_t totalWriteSize = 0;
+  for (Bucket& bucket : _buckets)
+  {
+    if (bucket.droppedEvents != 0)
+    {
+      totalWriteSize += writeSummary(bucket, out);
+    }
+  }
+  return totalWriteSize;
+}
+
+template <typename OutputStream>
+std::size_t EventQuota::writeSummary(Bucket& bucket, OutputStream& out)
+{
+  std::size_t totalWriteSize = 0;
+
+  if (! _summarySourceWritten)
+  {
+    const EventSource summarySource{
+      summarySourceId, Severity::warning, "binlog", "EventQuota", "", 0,
+      "Over quota {}: dropped {} events, {} bytes", "[cLL"
+    };
+    totalWriteSize += serializeSizePrefixedTagged(summarySource, out);
+    _summarySourceWritten = true;
+  }
+
+  // timestamped by the last dropped event
+  const std::uint64_t tag = summarySourceId;
+  const std::uint32_t size = std::uint32_t(
+    sizeof(tag) + sizeof(bucket.lastDroppedClock)
+    + mserialize::serialized_size(bucket.limit.name)
+    + sizeof(bucket.droppedEvents) + sizeof(bucket.droppedBytes)
+  );
+  mserialize::serialize(size, out);
+  mserialize::serialize(tag, out);
+  mserialize::serialize(bucket.lastDroppedClock, out);
+  mserialize::serialize(bucket.limit.name, out);
+  mserialize::serialize(bucket.droppedEvents, out);
+  mserialize::serialize(bucket.droppedBytes, out);
+  totalWriteSize += sizeof(size) + size;
+
+  bucket.droppedEvents = 0;
+  bucket.droppedBytes = 0;
+  return totalWriteSize;
+}
+
+} // namespace binlog
+
+#endif // BINLOG_EVENT_QUOTA_HPP
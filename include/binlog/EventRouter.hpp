@@ -0,0 +1,182 @@
+#ifndef BINLOG_EVENT_ROUTER_HPP
+#define BINLOG_EVENT_ROUTER_HPP
+
+#include <binlog/Entries.hpp> // EventSource
+#include <binlog/Range.hpp>
+#include <binlog/detail/SourceIdMap.hpp>
+
+#include <mserialize/deserialize.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ios> // streamsize
+#include <stdexcept> // runtime_error
+#include <utility> // move
+#include <vector>
+
+namespace binlog {
+
+/**
+ * Route the entries of a stream to several outputs, in a single pass.
+ *
+ * Models mserialize::OutputStream. Each output has a predicate,
+ * that selects the EventSources whose events are written to the output.
+ * Special entries (metadata) are written to every output.
+ *
+ * Unlike using an EventFilter for each output, the written buffer
+ * is parsed only once: the predicates are evaluated once per EventSource,
+ * the result is stored as a bitmask, and every event is routed
+ * by looking up the bitmask of its source. Consecutive entries
+ * routed to the same output are written by a single write call.
+ *
+ * Example:
+ *
+ *    binlog::EventRouter router;
+ *    router.addOutput([](const binlog::EventSource&) { return true; }, logfile);
+ *    router.addOutput([](const binlog::EventSource& s) { return s.category == "net"; }, netfile);
+ *    session.consume(router);
+ *
+ * As EventFilter, the router expects complete entries in each write call,
+ * as written by Session::consume (without deferred events).
+ */
+class EventRouter
+{
+public:
+  using Predicate = std::function<bool(const EventSource&)>;
+
+  /** The maximum number of outputs */
+  static constexpr std::size_t maxOutputCount = 64;
+
+  /**
+   * Add an output: events of sources accepted by `isAllowed`,
+   * and special entries will be written to `out`.
+   *
+   * `out` must remain valid as long as *this is valid.
+   *
+   * @requires OutputStream must model the mserialize::OutputStream concept
+   * @pre must be called before the first write
+   * @throws std::runtime_error if there are already maxOutputCount outputs
+   */
+  template <typename OutputStream>
+  void addOutput(Predicate isAllowed, OutputStream& out);
+
+  /**
+   * Parse the entries in [buffer, buffer+size),
+   * write each to the outputs it is routed to.
+   *
+   * @throws std::runtime_error if `buffer` contains an invalid entry
+   */
+  EventRouter& write(const char* buffer, std::streamsize size);
+
+private:
+  struct Output
+  {
+    Predicate isAllowed;
+    std::function<void(const char*, std::streamsize)> write;
+  };
+
+  std::vector<Output> _outputs;
+  std::uint64_t _allOutputs = 0;                    // bitmask of every output
+  detail::SourceIdMap<std::uint64_t> _sourceMasks;  // the outputs of the events of each source, as a bitmask
+  std::vector<const char*> _runBegin;               // per output, the beginning of the pending run
+  std::vector<const char*> _runEnd;                 // per output, the end of the pending run
+};
+
+template <typename OutputStream>
+void EventRouter::addOutput(Predicate isAllowed, OutputStream& out)
+{
+  if (_outputs.size() == maxOutputCount)
+  {
+    throw std::runtime_error("EventRouter supports at most 64 outputs");
+  }
+
+  _outputs.push_back(Output{
+    std::move(isAllowed),
+    [&out](const char* buffer, std::streamsize size) { out.write(buffer, size); }
+  });
+  _allOutputs |= std::uint64_t(1) << (_outputs.size() - 1);
+  _runBegin.push_back(nullptr);
+  _runEnd.push_back(nullptr);
+}
+
+inline EventRouter& EventRouter::write(const char* buffer, std::streamsize size)
+{
+  Range entries(buffer, std::size_t(size));
+
+  // write the pending run of output `i`
+  const auto flush = [this](std::size_t i)
+  {
+    if (_runBegin[i] != _runEnd[i])
+    {
+      _outputs[i].write(_runBegin[i], std::streamsize(_runEnd[i] - _runBegin[i]));
+    }
+    _runBegin[i] = _runEnd[i] = nullptr;
+  };
+
+  const auto flushAll = [&]()
+  {
+    for (std::size_t i = 0; i < _outputs.size(); ++i) { flush(i); }
+  };
+
+  try
+  {
+    while (! entries.empty())
+    {
+      const char* entryBegin = entries.view(0);
+      const std::uint32_t entrySize = entries.read<std::uint32_t>();
+      Range payload(entries.view(entrySize), entrySize);
+      const char* entryEnd = entries.view(0);
+      const std::uint64_t tag = payload.read<std::uint64_t>();
+      const bool special = (tag & (std::uint64_t(1) << 63)) != 0;
+
+      std::uint64_t mask = _allOutputs;
+      if (special)
+      {
+        if (tag == EventSource::Tag)
+        {
+          EventSource eventSource;
+          mserialize::deserialize(eventSource, payload);
+
+          std::uint64_t allowedBy = 0;
+          for (std::size_t i = 0; i < _outputs.size(); ++i)
+          {
+            if (_outputs[i].isAllowed(eventSource)) { allowedBy |= std::uint64_t(1) << i; }
+          }
+          _sourceMasks.set(eventSource.id, allowedBy);
+        }
+      }
+      else
+      {
+        mask = _sourceMasks.get(tag);
+      }
+
+      // extend the pending runs of the selected outputs
+      for (std::size_t i = 0; mask != 0; ++i, mask >>= 1)
+      {
+        if ((mask & 1) == 0) { continue; }
+
+        if (_runEnd[i] != entryBegin)
+        {
+          flush(i);
+          _runBegin[i] = entryBegin;
+        }
+        _runEnd[i] = entryEnd;
+      }
+    }
+  }
+  catch (...)
+  {
+    // write the entries routed before the invalid one, like EventFilter
+    flushAll();
+    throw;
+  }
+
+  flushAll();
+
+  return *this;
+}
+
+} // namespace binlog
+
+#endif // BINLOG_EVENT_ROUTER_HPP
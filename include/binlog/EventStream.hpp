@@ -4,15 +4,33 @@
 #include <binlog/Entries.hpp>
 #include <binlog/EntryStream.hpp>
 #include <binlog/Range.hpp>
+#include <binlog/Time.hpp>
 
+#include <binlog/detail/CompactEvents.hpp>
 #include <binlog/detail/SegmentedMap.hpp>
 
+#include <cstddef>
+#include <cstdint>
 #include <istream>
 #include <map>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 namespace binlog {
 
-/** Convert a binlog stream to events. */
+/**
+ * Convert a binlog stream to events.
+ *
+ * Both the regular and the compact (binlog format v2) encoding
+ * of events are supported, see CompactEvents.
+ *
+ * EventSource entries of ids assigned by a Session (dense, from 1)
+ * are validated, and kept serialized, until an event of the source is read.
+ * Logfiles of many sources are read faster, and take less memory,
+ * if only some of the sources have events to read (e.g: a filtered stream).
+ */
 class EventStream
 {
 public:
@@ -26,6 +44,8 @@ public:
    * If an entry given by `input` is invalid,
    * it is droppend, *this remains unchanged
    * and an exception is thrown.
+   * If an event of a CompactEvents entry is invalid,
+   * the event is dropped, the next call continues with the next event of the entry.
    *
    * @param input contains binlog entries
    * @returns pointer to the next event
@@ -34,10 +54,73 @@ public:
    */
   const Event* nextEvent(EntryStream& input);
 
+  /**
+   * Call `f(event)` for each event of the entries in `input`,
+   * a sequence of size prefixed entries, as in a binlog stream,
+   * e.g: a memory mapped file (see MmapEntryStream::data),
+   * or a decompressed buffer.
+   *
+   * Unlike nextEvent, the entries are read by an inlined loop,
+   * without virtual calls. During the call of `f`, the accessors
+   * of *this (e.g: writerProp, clockSync) refer to the state of the event.
+   * The event is valid only during the call.
+   *
+   * @throws std::runtime_error on an invalid entry, like nextEvent,
+   *         the events before the invalid entry are already passed to `f`.
+   *         Exceptions thrown by `f` are propagated.
+   */
+  template <typename F>
+  void forEachEvent(Range input, F&& f);
+
+  /**
+   * Like forEachEvent, but the entries are taken from `input`,
+   * until it returns an empty entry.
+   *
+   * `Stream` must have a `Range nextEntryPayload()` member.
+   * If the member is not virtual, or it is final (e.g: MmapEntryStream),
+   * it is called directly.
+   */
+  template <typename Stream, typename F>
+  void readAll(Stream& input, F&& f);
+
+  /**
+   * Read the metadata entries of `input`, e.g: the entries of
+   * a dictionary (see DictionaryReference), before the events of an other stream.
+   *
+   * @throws std::runtime_error if `input` contains an event, or an invalid entry.
+   */
+  void loadMetadata(EntryStream& input);
+
+  /**
+   * Write the state of *this to `out`: every event source and interned string,
+   * the most recent writer properties, clock sync and clock correction,
+   * and the event counters, followed by a Checkpoint entry of `offset`.
+   *
+   * A reader of a growing file can write a checkpoint after an event,
+   * with `offset` being the position of the next entry in the file
+   * (e.g: `tellg()` of the input of IstreamEntryStream), and after a restart,
+   * continue reading from `offset`, instead of reading the file again
+   * from the beginning, see readCheckpoint.
+   *
+   * @throws std::runtime_error if an entry of compact events is partially read,
+   *         as the checkpoint can only refer to the end of an entry.
+   */
+  void writeCheckpoint(std::ostream& out, std::uint64_t offset) const;
+
+  /**
+   * Replace the state of *this with the state in `input`, written by writeCheckpoint.
+   *
+   * @returns the offset of the checkpoint
+   * @throws std::runtime_error if `input` is invalid, contains an event,
+   *         or ends before the Checkpoint entry. *this remains unchanged then.
+   */
+  std::uint64_t readCheckpoint(EntryStream& input);
+
   /**
    * @return the most recent writer properties consumed from
    *         the stream or a default constructed
    *         object if no such entry was found.
+   *         The context is set by the WriterContext entries following it.
    */
   const WriterProp& writerProp() const { return _writerProp; }
 
@@ -48,21 +131,170 @@ public:
    */
   const ClockSync& clockSync() const { return _clockSync; }
 
+  /**
+   * @return a converter of the most recent clock sync,
+   *         to compute the time of many events cheaply.
+   *         Not valid() if no clock sync was found.
+   */
+  const ClockConverter& clockConverter() const { return _clockConverter; }
+
+  /**
+   * @return the most recent clock correction consumed
+   *         from the stream, or a default constructed
+   *         object if no such entry was found.
+   */
+  const ClockCorrection& clockCorrection() const { return _clockCorrection; }
+
+  /**
+   * @return the sum of the DroppedEvents entries consumed
+   *         from the stream, i.e: the number of events
+   *         lost by the writers, or zero if no such entry was found.
+   */
+  std::uint64_t droppedEventCount() const { return _droppedEventCount; }
+
+  /**
+   * @return the sum of the RepeatedEvents entries consumed
+   *         from the stream, i.e: the number of events
+   *         collapsed by a RepeatCollapsingStream, or zero if no such entry was found.
+   */
+  std::uint64_t repeatedEventCount() const { return _repeatedEventCount; }
+
 private:
+  /** Read a special (non-event) entry of `tag` */
+  void readSpecialEntry(std::uint64_t tag, Range range);
+
   void readEventSource(Range range);
 
+  /** Deserialize the pending source at `_denseEventSources[index]`, see readEventSource */
+  void readPendingEventSource(std::size_t index);
+
+  void readEventSourceTable(Range range);
+
   void readWriterProp(Range range);
 
+  void readWriterContext(Range range);
+
   void readClockSync(Range range);
 
+  void readClockCorrection(Range range);
+
+  void readDroppedEvents(Range range);
+
+  void readRepeatedEvents(Range range);
+
+  void readInternedString(Range range);
+
   void readEvent(std::uint64_t eventSourceId, Range range);
 
-  detail::SegmentedMap<EventSource> _eventSources;
+  void addEventSource(EventSource&& eventSource);
+
+  /** @throws std::runtime_error if no source has `id` */
+  const EventSource& findEventSource(std::uint64_t id);
+
+  /** Read the entry `payload`, call `f` for each event of it */
+  template <typename F>
+  void readEntry(Range payload, F& f);
+
+  /** Call `f` for the events of the partially read CompactEvents entry, if any */
+  template <typename F>
+  void readRemainingCompactEvents(F& f);
+
+  void readCompactEvents(Range range);
+
+  void readCompactEvent();
+
+  // of ids [1, size], as assigned by Session. A source with id 0 is pending:
+  // its category is the serialized source, deserialized when first needed.
+  std::vector<EventSource> _denseEventSources;
+  detail::SegmentedMap<EventSource> _eventSources; // of every other id
   WriterProp _writerProp;
   ClockSync _clockSync;
+  ClockConverter _clockConverter; // of _clockSync
+  ClockCorrection _clockCorrection;
+  std::uint64_t _droppedEventCount = 0;
+  std::uint64_t _repeatedEventCount = 0;
+  detail::SegmentedMap<std::string> _internedStrings;
   Event _event;
+  Range _compactEvents;           // the remaining events of the current CompactEvents entry
+  detail::CompactDecoder _compactDecoder; // of _compactEvents
 };
 
+template <typename F>
+void EventStream::forEachEvent(Range input, F&& f)
+{
+  readRemainingCompactEvents(f);
+
+  while (! input.empty())
+  {
+    const std::uint32_t size = input.read<std::uint32_t>();
+    readEntry(Range{input.view(size), size}, f);
+  }
+}
+
+template <typename Stream, typename F>
+void EventStream::readAll(Stream& input, F&& f)
+{
+  readRemainingCompactEvents(f);
+
+  while (true)
+  {
+    const Range payload = input.nextEntryPayload();
+    if (payload.empty()) { return; }
+    readEntry(payload, f);
+  }
+}
+
+template <typename F>
+void EventStream::readEntry(Range payload, F& f)
+{
+  const std::uint64_t tag = payload.read<std::uint64_t>();
+  if ((tag & (std::uint64_t(1) << 63)) == 0)
+  {
+    readEvent(tag, payload);
+    f(static_cast<const Event&>(_event));
+    return;
+  }
+
+  readSpecialEntry(tag, payload);
+  readRemainingCompactEvents(f);
+}
+
+template <typename F>
+void EventStream::readRemainingCompactEvents(F& f)
+{
+  while (! _compactEvents.empty())
+  {
+    readCompactEvent();
+    f(static_cast<const Event&>(_event));
+  }
+}
+
+inline const EventSource& EventStream::findEventSource(std::uint64_t id)
+{
+  // id 0 wraps around, and goes to the slow path
+  if (id - 1 < _denseEventSources.size())
+  {
+    const std::size_t index = std::size_t(id - 1);
+    if (_denseEventSources[index].id == 0) { readPendingEventSource(index); }
+    return _denseEventSources[index];
+  }
+
+  const EventSource* source = _eventSources.find(id);
+  if (source == _eventSources.end())
+  {
+    throw std::runtime_error("Event has invalid source id: " + std::to_string(id));
+  }
+  return *source;
+}
+
+inline void EventStream::readEvent(std::uint64_t eventSourceId, Range range)
+{
+  _event.source = &findEventSource(eventSourceId);
+  _event.clockValue = range.read<std::uint64_t>();
+  _event.arguments = range;
+  _event.internedStrings = &_internedStrings;
+}
+
 } // namespace binlog
 
 #endif // BINLOG_EVENT_STREAM_HPP
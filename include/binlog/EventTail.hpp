@@ -0,0 +1,250 @@
+#ifndef BINLOG_EVENT_TAIL_HPP
+#define BINLOG_EVENT_TAIL_HPP
+
+#include <binlog/Entries.hpp>
+#include <binlog/Range.hpp>
+#include <binlog/detail/ForEachEntry.hpp>
+#include <binlog/detail/VectorOutputStream.hpp>
+
+#include <algorithm> // min
+#include <cstddef>
+#include <cstdint>
+#include <cstring> // memcpy, memset
+#include <deque>
+#include <ios> // streamsize
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace binlog {
+
+/**
+ * Keeps the most recent events of a consumed stream in memory,
+ * e.g: to show them on a debug endpoint of the process, without
+ * consuming the session separately, and without file I/O.
+ *
+ * Models mserialize::OutputStream: consume a session to it directly,
+ * or through tee(out), to keep the tail of the data written to `out`.
+ * The last `maxEvents` events are kept, up to `maxBytes`,
+ * with the metadata needed to read them (event sources, clock sync, writers).
+ *
+ * snapshot() returns a self contained binlog stream, readable
+ * by EventStream (or bread), any time, from any thread.
+ *
+ * Usage:
+ *
+ *     binlog::EventTail tail(1000);
+ *     auto output = tail.tee(logfile);
+ *     session.consume(output); // writes logfile, keeps the last 1000 events
+ *
+ *     // e.g: on an other thread
+ *     const std::vector<char> recent = tail.snapshot();
+ *     binlog::RangeEntryStream input(binlog::Range(recent.data(), recent.size()));
+ *     binlog::EventStream eventStream;
+ *     while (const binlog::Event* event = eventStream.nextEvent(input)) { ... }
+ */
+class EventTail
+{
+public:
+  /** Writes to `out` and to the tail */
+  template <typename OutputStream>
+  class Tee
+  {
+  public:
+    Tee(EventTail& tail, OutputStream& out) :_tail(&tail), _out(&out) {}
+
+    Tee& write(const char* buffer, std::streamsize size)
+    {
+      _out->write(buffer, size);
+      _tail->write(buffer, size);
+      return *this;
+    }
+
+  private:
+    EventTail* _tail;
+    OutputStream* _out;
+  };
+
+  explicit EventTail(std::size_t maxEvents, std::size_t maxBytes = std::size_t(1) << 20);
+
+  /**
+   * Keep the metadata and the events of the complete
+   * binlog entries in [buffer, buffer+size), as consume writes them.
+   *
+   * @throws std::runtime_error if `buffer` contains an invalid entry
+   */
+  EventTail& write(const char* buffer, std::streamsize size);
+
+  /** @returns an OutputStream, writing `out` and *this */
+  template <typename OutputStream>
+  Tee<OutputStream> tee(OutputStream& out) { return Tee<OutputStream>(*this, out); }
+
+  /**
+   * Write the metadata and the recent events to `out`, oldest first.
+   * The events are preceded by the WriterProp of their writer.
+   */
+  template <typename OutputStream>
+  void writeSnapshot(OutputStream& out) const;
+
+  /** @returns the result of writeSnapshot, as a binlog stream */
+  std::vector<char> snapshot() const;
+
+  /** @returns the number of events kept */
+  std::size_t eventCount() const;
+
+private:
+  struct Event
+  {
+    std::size_t begin; // in _events, as a ring buffer
+    std::size_t size;
+    std::size_t writer; // index in _writerProps
+  };
+
+  void addEvent(Range entry);
+
+  /** Write the bytes [begin, begin+size) of the ring buffer to `out` */
+  template <typename OutputStream>
+  void writeEventBytes(std::size_t begin, std::size_t size, OutputStream& out) const;
+
+  std::size_t _maxEvents;
+  std::size_t _maxBytes;
+
+  mutable std::mutex _mutex; // guards the members below
+  detail::VectorOutputStream _metadata; // special entries, but writer props and event-like ones
+  std::vector<std::string> _writerProps; // serialized, with zero batchSize
+  std::map<std::string, std::size_t> _writerPropIndex;
+  std::size_t _writer = 0; // of the events being added
+  std::vector<char> _events; // ring buffer of size _maxBytes
+  std::deque<Event> _eventIndex;
+  std::size_t _eventBytes = 0; // sum of the sizes of _eventIndex
+};
+
+inline EventTail::EventTail(std::size_t maxEvents, std::size_t maxBytes)
+  :_maxEvents(maxEvents),
+   _maxBytes(maxBytes)
+{
+  // events written before the first WriterProp are attributed to an unnamed writer
+  detail::VectorOutputStream unnamed;
+  serializeSizePrefixedTagged(WriterProp{}, unnamed);
+  _writerProps.emplace_back(unnamed.data(), unnamed.vector.size());
+  _writerPropIndex.emplace(_writerProps.back(), 0);
+}
+
+inline EventTail& EventTail::write(const char* buffer, std::streamsize size)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  detail::forEachEntry(buffer, std::size_t(size), [this](Range entry, std::uint64_t tag, Range)
+  {
+    const std::size_t entrySize = entry.size();
+    const char* entryData = entry.view(entrySize);
+
+    if (! detail::isSpecialEntryTag(tag))
+    {
+      addEvent(Range(entryData, entrySize));
+    }
+    else if (tag == WriterProp::Tag)
+    {
+      // batchSize is the last field, not valid in the snapshot
+      std::string writerProp(entryData, entrySize);
+      if (writerProp.size() >= sizeof(std::uint64_t))
+      {
+        std::memset(&writerProp[writerProp.size() - sizeof(std::uint64_t)], 0, sizeof(std::uint64_t));
+      }
+
+      const auto it = _writerPropIndex.find(writerProp);
+      if (it != _writerPropIndex.end())
+      {
+        _writer = it->second;
+      }
+      else
+      {
+        _writer = _writerProps.size();
+        _writerProps.push_back(writerProp);
+        _writerPropIndex.emplace(std::move(writerProp), _writer);
+      }
+    }
+    else if (tag != DroppedEvents::Tag && tag != RepeatedEvents::Tag
+          && tag != CompactEvents::Tag && tag != Checkpoint::Tag)
+    {
+      // event sources, clock sync, interned strings, etc.
+      _metadata.write(entryData, std::streamsize(entrySize));
+    }
+  });
+
+  return *this;
+}
+
+inline void EventTail::addEvent(Range entry)
+{
+  const std::size_t size = entry.size();
+  if (size > _maxBytes || _maxEvents == 0) { return; }
+  if (_events.empty()) { _events.resize(_maxBytes); }
+
+  while (! _eventIndex.empty() && (_eventIndex.size() >= _maxEvents || _eventBytes + size > _maxBytes))
+  {
+    _eventBytes -= _eventIndex.front().size;
+    _eventIndex.pop_front();
+  }
+
+  // the oldest byte is at the begin of the first event, the free space follows the last
+  const std::size_t begin = _eventIndex.empty() ? 0
+    : (_eventIndex.back().begin + _eventIndex.back().size) % _maxBytes;
+
+  const char* data = entry.view(size);
+  const std::size_t size1 = (std::min)(size, _maxBytes - begin);
+  std::memcpy(_events.data() + begin, data, size1);
+  std::memcpy(_events.data(), data + size1, size - size1);
+
+  _eventIndex.push_back(Event{begin, size, _writer});
+  _eventBytes += size;
+}
+
+template <typename OutputStream>
+void EventTail::writeEventBytes(std::size_t begin, std::size_t size, OutputStream& out) const
+{
+  const std::size_t size1 = (std::min)(size, _maxBytes - begin);
+  out.write(_events.data() + begin, std::streamsize(size1));
+  if (size1 != size)
+  {
+    out.write(_events.data(), std::streamsize(size - size1));
+  }
+}
+
+template <typename OutputStream>
+void EventTail::writeSnapshot(OutputStream& out) const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  out.write(_metadata.data(), _metadata.ssize());
+
+  std::size_t writer = ~std::size_t(0);
+  for (const Event& event : _eventIndex)
+  {
+    if (event.writer != writer)
+    {
+      writer = event.writer;
+      const std::string& writerProp = _writerProps[writer];
+      out.write(writerProp.data(), std::streamsize(writerProp.size()));
+    }
+    writeEventBytes(event.begin, event.size, out);
+  }
+}
+
+inline std::vector<char> EventTail::snapshot() const
+{
+  detail::VectorOutputStream out;
+  writeSnapshot(out);
+  return std::move(out.vector);
+}
+
+inline std::size_t EventTail::eventCount() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _eventIndex.size();
+}
+
+} // namespace binlog
+
+#endif // BINLOG_EVENT_TAIL_HPP
@@ -0,0 +1,86 @@
+#ifndef BINLOG_FILE_OUTPUT_STREAM_HPP
+#define BINLOG_FILE_OUTPUT_STREAM_HPP
+
+#include <binlog/ConstBuffer.hpp>
+
+#include <cstddef>
+#include <ios> // streamsize
+#include <string>
+
+namespace binlog {
+
+/**
+ * Unbuffered output to a file, with gather writes.
+ *
+ * Models mserialize::OutputStream, and has `writev`:
+ * Session::consume writes the consumed data to the file
+ * by a single writev call (per IOV_MAX buffers), directly
+ * from the writer queues, without copying it to a streambuf.
+ *
+ * Example:
+ *
+ *    binlog::FileOutputStream logfile("logfile.blog");
+ *    session.consume(logfile);
+ *
+ * On Windows, the buffers are written one by one, by WriteFile.
+ * The file is opened sharing read and write access, as setDirectIo
+ * opens it a second time for writing.
+ */
+class FileOutputStream
+{
+public:
+  /**
+   * Open `path` for writing. The file is created if
+   * it does not exist. If `append` is false, the file is truncated.
+   *
+   * @throws std::runtime_error if the file can not be opened
+   */
+  explicit FileOutputStream(const std::string& path, bool append = false);
+
+  /** Close the file */
+  ~FileOutputStream();
+
+  FileOutputStream(const FileOutputStream&) = delete;
+  void operator=(const FileOutputStream&) = delete;
+
+  /**
+   * Write [data, data+size) to the file.
+   *
+   * @throws std::runtime_error on write error
+   */
+  FileOutputStream& write(const char* data, std::streamsize size);
+
+  /**
+   * Write `count` buffers to the file, in order.
+   *
+   * @throws std::runtime_error on write error
+   */
+  void writev(const ConstBuffer* buffers, std::size_t count);
+
+  /**
+   * Enable or disable direct I/O (O_DIRECT), bypassing the page cache.
+   * On Windows, the file is reopened with or without FILE_FLAG_NO_BUFFERING,
+   * writing continues at the current position.
+   *
+   * With direct I/O enabled, the address and size of written buffers,
+   * and the file offset must be aligned to the logical block size
+   * of the underlying device (usually 512 or 4096).
+   *
+   * @returns true if the requested mode is in effect,
+   *          false if not supported by the platform or the file system.
+   */
+  bool setDirectIo(bool enable);
+
+private:
+  #ifdef _WIN32
+    void* _handle = nullptr;
+    unsigned long _access = 0; // desired access of _handle, to reopen it
+    bool _directIo = false;
+  #else
+    int _fd = -1;
+  #endif
+};
+
+} // namespace binlog
+
+#endif // BINLOG_FILE_OUTPUT_STREAM_HPP
@@ -0,0 +1,165 @@
+#ifndef BINLOG_FILE_SINK_HPP
+#define BINLOG_FILE_SINK_HPP
+
+#include <binlog/FileOutputStream.hpp>
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <ios> // streamsize
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace binlog {
+
+/**
+ * Buffered file output, written asynchronously by a dedicated thread.
+ *
+ * Models mserialize::OutputStream. Written data is copied to
+ * one of Options::bufferCount aligned buffers. When a buffer is full, it is handed over
+ * to the I/O thread, and writing continues in the next free buffer:
+ * the writer (usually the consumer of a Session) blocks only
+ * if every other buffer is still waiting to be written.
+ * More buffers absorb longer stalls of the disk (e.g: caused by
+ * virus scanners or cloud sync on desktops), at the cost of memory.
+ *
+ * Example:
+ *
+ *    binlog::FileSink logfile("logfile.blog");
+ *    session.consume(logfile); // returns once the data is copied
+ *
+ * If Options::directIo is set, the file is written using O_DIRECT
+ * (on Windows: FILE_FLAG_NO_BUFFERING, if supported), bypassing the page cache. In this mode,
+ * flush writes only whole blocks, the last incomplete block
+ * of a file is written when the file is closed (by rotate, close or the destructor).
+ */
+class FileSink
+{
+public:
+  struct Options
+  {
+    /** Size of each buffer, rounded up to a multiple of `alignment` */
+    std::size_t bufferSize = 1 << 20;
+
+    /** Number of buffers, at least 2: one being filled, the others handed over to the I/O thread */
+    std::size_t bufferCount = 2;
+
+    /** Write the file bypassing the page cache, if supported (best effort) */
+    bool directIo = false;
+  };
+
+  /** Alignment of the buffers, and of direct I/O writes */
+  static constexpr std::size_t alignment = 4096;
+
+  /**
+   * Open (create or truncate) `path` for writing,
+   * start the I/O thread.
+   *
+   * @throws std::runtime_error if the file can not be opened
+   */
+  FileSink(const std::string& path, Options options);
+
+  /** Open `path` for writing, using default Options */
+  explicit FileSink(const std::string& path);
+
+  /** Same as close(), but errors are ignored */
+  ~FileSink();
+
+  FileSink(const FileSink&) = delete;
+  void operator=(const FileSink&) = delete;
+
+  /**
+   * Copy [data, data+size) to the buffer. If the buffer gets full,
+   * hand it over to the I/O thread, possibly waiting for a free buffer.
+   *
+   * @throws std::runtime_error if an earlier asynchronous write failed
+   */
+  FileSink& write(const char* data, std::streamsize size);
+
+  /**
+   * Hand over the buffered data to the I/O thread,
+   * and wait until every handed over buffer is written.
+   *
+   * @throws std::runtime_error if writing failed
+   */
+  void flush();
+
+  /**
+   * Write the buffered data to the current file, close it,
+   * rename it to `renameClosedTo` (if not empty),
+   * then continue writing to `path` (created or truncated).
+   *
+   * The new file is opened asynchronously, by the I/O thread:
+   * if it fails, the error is reported by the next write, flush or close.
+   * Metadata is not copied to the new file, see Session::reconsumeMetadata,
+   * or RotatingFileSink.
+   *
+   * @throws std::runtime_error if an earlier asynchronous write failed
+   */
+  void rotate(const std::string& path, const std::string& renameClosedTo = {});
+
+  /**
+   * Write the buffered data, close the file and stop the I/O thread.
+   * Subsequent calls do nothing. No member function
+   * but close and the destructor may be called after close.
+   *
+   * @throws std::runtime_error if writing failed
+   */
+  void close();
+
+private:
+  struct Job
+  {
+    char* data;
+    std::size_t size;
+    bool closeFile;         // if true, close the file after writing the data
+    std::string renamePath; // if not empty, rename the file after closing it
+    std::string nextPath;   // if not empty, open after closing the file
+  };
+
+  /**
+   * Hand over the first `size` bytes of the current buffer to the I/O thread,
+   * keep the rest of the buffered data in the next buffer.
+   */
+  void handOver(std::size_t size, bool closeFile, std::string renamePath, std::string nextPath);
+
+  /** Wait until every handed over job is done */
+  void waitIdle();
+
+  /** @pre _mutex is locked by the caller */
+  void throwIfFailed();
+
+  /** I/O thread */
+  void run();
+
+  void runJob(const Job& job);
+
+  void openFile(const std::string& path);
+
+  Options _options;
+  std::unique_ptr<FileOutputStream> _file; // only accessed by the I/O thread after start
+  std::string _path;                       // path of _file
+  bool _directIo = false;                  // true if _file is in direct I/O mode
+
+  std::vector<std::unique_ptr<char[]>> _storage; // the memory of the buffers
+  char* _current = nullptr;                      // the buffer being filled
+  std::size_t _size = 0;                         // bytes in _current
+
+  std::mutex _mutex; // guards the members below
+  std::condition_variable _cv;
+  std::deque<Job> _jobs;
+  std::vector<char*> _freeBuffers;
+  bool _busy = false; // true if the I/O thread is running a job
+  bool _stop = false;
+  std::exception_ptr _error;
+
+  std::thread _thread; // started by the constructor, after the file is opened
+};
+
+} // namespace binlog
+
+#endif // BINLOG_FILE_SINK_HPP
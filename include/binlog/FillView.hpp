@@ -0,0 +1,117 @@
+#ifndef BINLOG_FILL_VIEW_HPP
+#define BINLOG_FILL_VIEW_HPP
+
+#include <mserialize/serialize.hpp>
+#include <mserialize/string_view.hpp>
+#include <mserialize/tag.hpp>
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <ios> // streamsize
+#include <memory>
+#include <type_traits>
+#include <utility> // declval, move
+
+namespace binlog {
+
+template <typename Fill>
+class FillView
+{
+public:
+  FillView(std::size_t size, Fill fill)
+    :_size(size),
+     _fill(std::move(fill))
+  {}
+
+  std::size_t size() const { return _size; }
+
+  /** Write size() bytes to `dst` */
+  void fill(char* dst) const { _fill(dst, _size); }
+
+private:
+  std::size_t _size;
+  Fill _fill;
+};
+
+/**
+ * Create a loggable sequence of `size` bytes, written by `fill`.
+ *
+ * When the event is added, `fill(dst, size)` is called
+ * to write the bytes directly into the queue of the writer:
+ * no intermediate buffer is required. Useful if a large
+ * payload is produced by a copy or a decoder anyway.
+ * The bytes are logged as a sequence of chars (like std::string).
+ *
+ * Example:
+ *
+ *    const auto payload = binlog::fill_view(packet.size(), [&packet](char* dst, std::size_t size)
+ *    {
+ *      packet.copyTo(dst, size);
+ *    });
+ *    BINLOG_INFO("Packet: {}", payload);
+ *
+ * @requires `fill` must not throw, and must write exactly `size` bytes.
+ */
+template <typename Fill>
+FillView<Fill> fill_view(std::size_t size, Fill fill)
+{
+  return FillView<Fill>(size, std::move(fill));
+}
+
+namespace detail {
+
+template <typename OutputStream, typename = void>
+struct has_reserve_buffer : std::false_type {};
+
+template <typename OutputStream>
+struct has_reserve_buffer<OutputStream, decltype(void(std::declval<OutputStream&>().reserveBuffer(std::size_t{})))>
+  : std::true_type {};
+
+// fill directly the buffer of the stream, e.g: QueueWriter
+template <typename Fill, typename OutputStream>
+void fillStream(std::true_type, const FillView<Fill>& view, OutputStream& ostream)
+{
+  view.fill(ostream.reserveBuffer(view.size()));
+}
+
+// fill a temporary buffer first, then write it to the stream
+template <typename Fill, typename OutputStream>
+void fillStream(std::false_type, const FillView<Fill>& view, OutputStream& ostream)
+{
+  std::unique_ptr<char[]> buffer(new char[view.size()]);
+  view.fill(buffer.get());
+  ostream.write(buffer.get(), std::streamsize(view.size()));
+}
+
+} // namespace detail
+
+} // namespace binlog
+
+namespace mserialize {
+
+template <typename Fill>
+struct CustomSerializer<binlog::FillView<Fill>>
+{
+  template <typename OutputStream>
+  static void serialize(const binlog::FillView<Fill>& view, OutputStream& ostream)
+  {
+    const std::uint32_t size32 = std::uint32_t(view.size());
+    assert(size32 == view.size() && "sequence size must fit on 32 bits");
+
+    mserialize::serialize(size32, ostream);
+    binlog::detail::fillStream(binlog::detail::has_reserve_buffer<OutputStream>{}, view, ostream);
+  }
+
+  static std::size_t serialized_size(const binlog::FillView<Fill>& view)
+  {
+    return sizeof(std::uint32_t) + view.size();
+  }
+};
+
+template <typename Fill>
+struct CustomTag<binlog::FillView<Fill>> : detail::Tag<string_view>::type {};
+
+} // namespace mserialize
+
+#endif // BINLOG_FILL_VIEW_HPP
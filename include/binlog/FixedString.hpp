@@ -0,0 +1,111 @@
+#ifndef BINLOG_FIXED_STRING_HPP
+#define BINLOG_FIXED_STRING_HPP
+
+#include <mserialize/cx_string.hpp>
+#include <mserialize/detail/Serializer.hpp>
+#include <mserialize/tag.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring> // memcpy, memset, strlen
+
+namespace binlog {
+
+/**
+ * A string of at most `N` bytes, stored inline.
+ *
+ * Serialized as exactly N+1 bytes: the size of the string,
+ * followed by N bytes of data, the first `size` of them valid.
+ * As the serialized size does not depend on the value,
+ * events of arithmetic and FixedString arguments only
+ * are serialized by a single copy, see SessionWriter::addEvent.
+ *
+ * Example:
+ *
+ *    BINLOG_INFO("Order on {}", binlog::fixedString<16>(symbol));
+ *
+ * @see fixedString
+ */
+template <std::size_t N>
+struct FixedString
+{
+  static_assert(N > 0 && N <= 255, "Capacity of binlog::FixedString must be in [1, 255]");
+
+  std::uint8_t size; // NOLINT
+  char data[N];      // NOLINT
+};
+
+/**
+ * @returns the first `N` bytes of [data, data+size) as a FixedString,
+ *          the unused bytes are zeroed.
+ */
+template <std::size_t N>
+FixedString<N> fixedString(const char* data, std::size_t size)
+{
+  FixedString<N> result;
+  result.size = std::uint8_t((std::min)(size, N));
+  memcpy(result.data, data, result.size);
+  memset(result.data + result.size, 0, N - result.size);
+  return result;
+}
+
+/**
+ * @returns the first `N` bytes of `str` as a FixedString
+ *
+ * @param str std::string, std::string_view, or any other type
+ *            with contiguous `data()` and `size()` members.
+ */
+template <std::size_t N, typename String>
+auto fixedString(const String& str) -> decltype(str.data(), str.size(), FixedString<N>{})
+{
+  return fixedString<N>(str.data(), std::size_t(str.size()));
+}
+
+/** Like fixedString(const String&), but `str` is a null terminated string */
+template <std::size_t N>
+FixedString<N> fixedString(const char* str)
+{
+  return fixedString<N>(str, strlen(str));
+}
+
+namespace detail {
+
+/** @returns the tag of the data of FixedString<N>: a tuple of N chars */
+template <std::size_t N>
+constexpr mserialize::cx_string<N + 2> fixedStringDataTag()
+{
+  char tag[N + 3] = {0};
+  tag[0] = '(';
+  for (std::size_t i = 1; i <= N; ++i) { tag[i] = 'c'; }
+  tag[N + 1] = ')';
+  return mserialize::cx_string<N + 2>(tag);
+}
+
+} // namespace detail
+
+} // namespace binlog
+
+namespace mserialize {
+
+template <std::size_t N>
+struct CustomSerializer<binlog::FixedString<N>>
+  :detail::TrivialSerializer<binlog::FixedString<N>>
+{};
+
+template <std::size_t N>
+struct CustomTag<binlog::FixedString<N>>
+{
+  static constexpr auto tag_string()
+  {
+    return cx_strcat(
+      make_cx_string("{binlog::FixedString`size'B`data'"),
+      binlog::detail::fixedStringDataTag<N>(),
+      make_cx_string("}")
+    );
+  }
+};
+
+} // namespace mserialize
+
+#endif // BINLOG_FIXED_STRING_HPP
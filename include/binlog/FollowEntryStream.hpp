@@ -0,0 +1,99 @@
+#ifndef BINLOG_FOLLOW_ENTRY_STREAM_HPP
+#define BINLOG_FOLLOW_ENTRY_STREAM_HPP
+
+#include <binlog/EntryStream.hpp>
+#include <binlog/Range.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32 // assume POSIX
+
+namespace binlog {
+
+/**
+ * Entry stream reading a logfile that is being written, like `tail -F`.
+ *
+ * The file is read directly (not through a pipe): only complete entries
+ * are returned, an incomplete entry at the end of the file is kept
+ * until the rest of it is written. If no complete entry is available,
+ * nextEntryPayload waits for the file to grow: on Linux, it is woken up
+ * by inotify as soon as the file is modified, elsewhere it polls the file.
+ *
+ * If the file at `path` is replaced (e.g: rotated by RotatingFileSink)
+ * or truncated, the rest of the old file is read, then the new file is opened,
+ * and read from the beginning. Files written by RotatingFileSink
+ * start with the metadata, consumed by EventStream as usual.
+ *
+ * Example:
+ *
+ *    binlog::FollowEntryStream input("logfile.blog");
+ *    binlog::EventStream eventStream;
+ *    while (const binlog::Event* event = eventStream.nextEvent(input)) { print(*event); } // never ends
+ */
+class FollowEntryStream : public EntryStream
+{
+public:
+  struct Options
+  {
+    /** Return an empty payload (end of input) if the file does not grow for this long */
+    std::chrono::milliseconds idleTimeout = (std::chrono::milliseconds::max)();
+
+    /** If set, called before waiting for the file to grow, e.g: to flush the output */
+    std::function<void()> beforeWait;
+  };
+
+  /** @throws std::runtime_error if `path` can not be opened for reading */
+  FollowEntryStream(std::string path, Options options);
+
+  /** Follow `path` forever */
+  explicit FollowEntryStream(std::string path);
+
+  ~FollowEntryStream() override;
+
+  FollowEntryStream(const FollowEntryStream&) = delete;
+  void operator=(const FollowEntryStream&) = delete;
+
+  /**
+   * @see EntryStream::nextEntryPayload
+   *
+   * The returned payload is valid until the next call.
+   * After the idle timeout expires, the next call waits again.
+   *
+   * @throws std::runtime_error if the file can not be read
+   */
+  Range nextEntryPayload() override;
+
+  /** @returns the number of times the file was reopened, because it was replaced or truncated */
+  std::size_t reopenCount() const { return _reopenCount; }
+
+private:
+  /** @returns true if bytes were appended to _buffer */
+  bool readAvailable();
+
+  /** @returns true if the file was reopened or rewound */
+  bool reopenIfReplaced();
+
+  void open();
+
+  /** Wait at most `timeout` for the file to be modified */
+  void wait(std::chrono::milliseconds timeout);
+
+  std::string _path;
+  Options _options;
+  int _fd = -1;
+  int _inotify = -1; // watching the directory of _path, or -1, if not supported
+  std::size_t _reopenCount = 0;
+
+  std::vector<char> _buffer; // read from the file
+  std::size_t _begin = 0;    // the first byte of _buffer not yet returned
+};
+
+} // namespace binlog
+
+#endif // _WIN32
+
+#endif // BINLOG_FOLLOW_ENTRY_STREAM_HPP
@@ -0,0 +1,152 @@
+#ifndef BINLOG_FRAME_SINK_HPP
+#define BINLOG_FRAME_SINK_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ios> // streamsize
+#include <vector>
+
+namespace binlog {
+
+/**
+ * A FrameSink splits the consumed stream to fixed size frames,
+ * each starts with a header:
+ *
+ *    u32 sequence           // incremented by one for each frame, also for the dropped ones
+ *    u32 size               // size of the payload
+ *    u32 firstEntry         // offset of the first entry beginning in the payload, or noEntryStart
+ *    char[size]             // payload
+ *
+ * Entries are split at frame boundaries: the payload of a frame starts
+ * with the continuation of the last entry of the previous frame (if any),
+ * that ends at `firstEntry`. After a lost frame (a gap in the sequence),
+ * a receiver can continue at `firstEntry` (see FrameReassembler).
+ */
+constexpr std::size_t frameHeaderSize = 3 * sizeof(std::uint32_t);
+
+/** Frame header firstEntry of frames that contain the middle of an entry only */
+constexpr std::uint32_t noEntryStart = std::uint32_t(-1);
+
+/**
+ * Write entries consumed from a Session directly to caller provided buffers,
+ * e.g: the packet buffers of a kernel bypass network stack,
+ * without going through a byte stream or a system call.
+ *
+ * Models mserialize::OutputStream.
+ * Buffers are requested by calling `acquire`, on demand, filled with
+ * frames (see frameHeaderSize for the format), then handed to `transmit`,
+ * when full, or when flush is called. A buffer is owned by the caller
+ * after it is transmitted. If `acquire` returns no buffer (e.g: the pool is exhausted),
+ * the bytes written until the end of the current write call are dropped.
+ *
+ * Example:
+ *
+ *    binlog::FrameSink sink(
+ *      [&pool]() { char* buf = pool.get(); return binlog::FrameSink::Buffer{buf, 1024}; },
+ *      [&nic](char* buf, std::size_t size) { nic.send(buf, size); }
+ *    );
+ *    session.consume(sink);
+ *    sink.flush();
+ *
+ * `acquire` and `transmit` are called on the consumer thread,
+ * exceptions thrown by them are propagated to the caller of write or flush.
+ */
+class FrameSink
+{
+public:
+  /** A caller provided buffer of `size` bytes */
+  struct Buffer
+  {
+    char* data;       // NOLINT
+    std::size_t size; // NOLINT
+  };
+
+  /** @returns a buffer, larger than frameHeaderSize, to write the next frame to, or {nullptr, 0} */
+  using Acquire = std::function<Buffer()>;
+
+  /** Takes the buffer `data`, returned by Acquire, that holds a frame of `size` bytes */
+  using Transmit = std::function<void(char* data, std::size_t size)>;
+
+  FrameSink(Acquire acquire, Transmit transmit);
+
+  /** Write [data, data+size) to the current frame, transmit the frames filled */
+  FrameSink& write(const char* data, std::streamsize size);
+
+  /** Transmit the current frame, if not empty */
+  void flush();
+
+  /** @returns the number of frames transmitted so far */
+  std::size_t frameCount() const { return _frameCount; }
+
+  /** @returns the number of bytes dropped so far, because `acquire` returned no buffer */
+  std::size_t droppedBytes() const { return _droppedBytes; }
+
+private:
+  /** @returns true if there is a current frame, with free space */
+  bool openFrame();
+
+  /** Fill the header of the current frame and transmit it */
+  void transmitFrame();
+
+  Acquire _acquire;
+  Transmit _transmit;
+
+  Buffer _buffer = {nullptr, 0}; // of the current frame
+  std::size_t _used = 0;         // bytes of _buffer used, including the header
+  std::uint32_t _firstEntry = noEntryStart; // of the current frame
+  std::uint32_t _sequence = 0;   // of the next frame
+  std::size_t _frameCount = 0;
+  std::size_t _droppedBytes = 0;
+
+  // the entry being written
+  char _sizePrefix[sizeof(std::uint32_t)] = {};
+  std::size_t _sizePrefixBytes = 0;   // bytes of _sizePrefix already written
+  std::uint64_t _entryRemaining = 0;  // bytes of the entry to write after the size prefix
+};
+
+/**
+ * Restore the entries of a stream from the frames of a FrameSink.
+ *
+ * Frames must be added in order. If a frame is lost, the incomplete
+ * entry it is part of is discarded, and the entries continue at the
+ * first entry of the next frame.
+ *
+ * Example:
+ *
+ *    binlog::FrameReassembler reassembler;
+ *    reassembler.add(frame, frameSize);
+ *    std::vector<char> entries = reassembler.takeEntries();
+ *    binlog::RangeEntryStream stream(binlog::Range(entries.data(), entries.size()));
+ */
+class FrameReassembler
+{
+public:
+  /**
+   * Add a frame of `size` bytes, as transmitted by FrameSink.
+   *
+   * @returns false if the frame is invalid (incomplete), and ignored
+   */
+  bool add(const char* frame, std::size_t size);
+
+  /** @returns the complete entries of the frames added so far, not yet taken */
+  std::vector<char> takeEntries();
+
+  /** @returns the number of frames lost so far (gaps in the sequence) */
+  std::size_t lostFrameCount() const { return _lostFrameCount; }
+
+private:
+  /** Move the complete entries at the beginning of _pending to _entries */
+  void completeEntries();
+
+  bool _started = false;       // true if a frame was added
+  bool _synced = false;        // true if _pending starts at the beginning of an entry
+  std::uint32_t _sequence = 0; // of the next frame expected
+  std::size_t _lostFrameCount = 0;
+  std::vector<char> _pending;  // incomplete entry
+  std::vector<char> _entries;  // complete entries
+};
+
+} // namespace binlog
+
+#endif // BINLOG_FRAME_SINK_HPP
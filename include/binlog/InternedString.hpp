@@ -0,0 +1,100 @@
+#ifndef BINLOG_INTERNED_STRING_HPP
+#define BINLOG_INTERNED_STRING_HPP
+
+#include <mserialize/cx_string.hpp>
+#include <mserialize/serialize.hpp>
+#include <mserialize/tag.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring> // strlen
+
+namespace binlog {
+
+/** A string to be interned by the SessionWriter adding the event, see interned */
+struct InternedStringRef
+{
+  const char* data; // NOLINT
+  std::size_t size; // NOLINT
+};
+
+/** The serialized form of an InternedStringRef: the id of an InternedString entry */
+struct InternedStringId
+{
+  std::uint64_t id; // NOLINT
+};
+
+/**
+ * Create a loggable string, which is interned by the Session.
+ *
+ * Each distinct string is assigned an id, and added to the
+ * session metadata once, as an InternedString entry.
+ * Events carry only the 8 byte id of the string, instead
+ * of a copy of it. The SessionWriter caches the ids of the strings
+ * it has seen, the session-wide table is only consulted (and locked)
+ * when a writer logs a string the first time.
+ * bread and PrettyPrinter show the original string.
+ *
+ * Useful for strings drawn from a small set that are logged very frequently,
+ * e.g: instrument symbols or venue names. Interning a unique string
+ * is more expensive than copying it, and the interned strings
+ * are kept by the session until it is destroyed.
+ *
+ * Interned strings can be logged by SessionWriter (and the writers using it,
+ * e.g: TaskWriter and PerCpuWriter), but not by a SharedWriter.
+ *
+ * Example:
+ *
+ *    BINLOG_INFO("Order on {}", binlog::interned(symbol));
+ *
+ * @param str std::string, std::string_view, or any other type
+ *            with contiguous `data()` and `size()` members.
+ *            Must remain valid until the event is created.
+ */
+template <typename String>
+auto interned(const String& str) -> decltype(str.data(), str.size(), InternedStringRef{})
+{
+  return InternedStringRef{str.data(), std::size_t(str.size())};
+}
+
+/** Like interned(const String&), but `str` is a null terminated string */
+inline InternedStringRef interned(const char* str)
+{
+  return InternedStringRef{str, strlen(str)};
+}
+
+} // namespace binlog
+
+namespace mserialize {
+
+template <>
+struct CustomSerializer<binlog::InternedStringId>
+{
+  template <typename OutputStream>
+  static void serialize(binlog::InternedStringId s, OutputStream& ostream)
+  {
+    mserialize::serialize(s.id, ostream);
+  }
+
+  static std::size_t serialized_size(binlog::InternedStringId)
+  {
+    return sizeof(std::uint64_t);
+  }
+};
+
+template <>
+struct CustomTag<binlog::InternedStringId>
+{
+  static constexpr auto tag_string()
+  {
+    return make_cx_string("{binlog::InternedStringId`id'L}");
+  }
+};
+
+// InternedStringRef is replaced by an InternedStringId by SessionWriter::addEvent
+template <>
+struct CustomTag<binlog::InternedStringRef> : CustomTag<binlog::InternedStringId> {};
+
+} // namespace mserialize
+
+#endif // BINLOG_INTERNED_STRING_HPP
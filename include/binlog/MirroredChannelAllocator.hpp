@@ -0,0 +1,135 @@
+#ifndef BINLOG_MIRRORED_CHANNEL_ALLOCATOR_HPP
+#define BINLOG_MIRRORED_CHANNEL_ALLOCATOR_HPP
+
+#include <binlog/ChannelAllocator.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <new> // bad_alloc
+#include <string>
+
+#ifndef _WIN32 // assume POSIX
+
+#include <fcntl.h> // NOLINT shm_open
+#include <sys/mman.h> // NOLINT mmap, munmap, memfd_create
+#include <unistd.h> // NOLINT sysconf, ftruncate, close, getpid
+
+namespace binlog {
+
+/**
+ * ChannelAllocator which maps the queue buffer of each block twice, back to back.
+ *
+ * The queues of the channels (see Queue) then never wrap:
+ * a write or read crossing the end of the buffer continues in the mirror,
+ * therefore no capacity is wasted at the end of the buffer by large events,
+ * and the consumer gets the readable data of a channel as a single span.
+ *
+ * The queue capacities of the channels are rounded up to the multiple
+ * of the page size (see mirrorGranularity). Each block is a mapping of
+ * a memory file (memfd on Linux, a POSIX shared memory object otherwise):
+ *
+ *     [...header page...][queue buffer][mirror of the buffer]
+ *
+ * The header of the channel (the magic, Session* and Queue) is placed
+ * at the end of the first page, right before the buffer.
+ * The blocks are pre-faulted. The unconsumed data of a mirrored queue
+ * remains recoverable from memory dumps by brecovery, if the dump includes
+ * the shared mappings of the process (it does by default on Linux).
+ *
+ * To avoid mapping a new block each time a channel is created,
+ * use it as the upstream allocator of a ChannelPool.
+ *
+ * Available on POSIX systems.
+ */
+class MirroredChannelAllocator : public ChannelAllocator
+{
+public:
+  MirroredChannelAllocator()
+    :_pageSize(std::size_t(sysconf(_SC_PAGESIZE)))
+  {}
+
+  /**
+   * @pre `size` is the size of a channel block, whose queue capacity
+   *      is a non-zero multiple of mirrorGranularity()
+   * @throws std::bad_alloc if the block can not be mapped
+   */
+  char* allocate(std::size_t size) override;
+
+  void deallocate(char* block, std::size_t size) noexcept override;
+
+  /** @returns the page size */
+  std::size_t mirrorGranularity() const override { return _pageSize; }
+
+private:
+  /** @returns a file descriptor of a new, unnamed memory file, or -1 */
+  int createMemoryFile();
+
+  std::size_t _pageSize;
+  std::atomic<std::size_t> _nextFileIndex{0};
+};
+
+inline char* MirroredChannelAllocator::allocate(std::size_t size)
+{
+  // the channel header is smaller than a page, the queue buffer is the page aligned rest
+  const std::size_t capacity = size / _pageSize * _pageSize;
+  const std::size_t headerSize = size - capacity;
+  if (capacity == 0) { throw std::bad_alloc(); }
+
+  const int fd = createMemoryFile();
+  if (fd < 0) { throw std::bad_alloc(); }
+
+  const std::size_t fileSize = _pageSize + capacity;
+  const std::size_t length = fileSize + capacity;
+  const int protection = PROT_READ | PROT_WRITE;
+
+  // reserve the address range of the block, then map the file over it twice
+  void* block = MAP_FAILED;
+  if (ftruncate(fd, off_t(fileSize)) == 0)
+  {
+    block = mmap(nullptr, length, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  }
+
+  char* base = static_cast<char*>(block);
+  const bool mapped = block != MAP_FAILED
+    && mmap(base, fileSize, protection, MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED
+    && mmap(base + fileSize, capacity, protection, MAP_SHARED | MAP_FIXED, fd, off_t(_pageSize)) != MAP_FAILED;
+  close(fd); // the mappings keep the file open
+
+  if (! mapped)
+  {
+    if (block != MAP_FAILED) { munmap(block, length); }
+    throw std::bad_alloc();
+  }
+
+  // pre-fault the pages of both views
+  memset(base, 0, length);
+
+  return base + _pageSize - headerSize;
+}
+
+inline void MirroredChannelAllocator::deallocate(char* block, std::size_t size) noexcept
+{
+  const std::size_t capacity = size / _pageSize * _pageSize;
+  const std::size_t headerSize = size - capacity;
+  munmap(block + headerSize - _pageSize, _pageSize + 2 * capacity);
+}
+
+inline int MirroredChannelAllocator::createMemoryFile()
+{
+  #if defined(__linux__) && defined(MFD_CLOEXEC)
+    return memfd_create("binlog-queue", MFD_CLOEXEC);
+  #else
+    const std::string name = "/binlog-" + std::to_string(getpid()) + "-"
+      + std::to_string(_nextFileIndex.fetch_add(1)) + ".queue";
+    const int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600); // NOLINT(cppcoreguidelines-pro-type-vararg)
+    if (fd >= 0) { shm_unlink(name.c_str()); } // the mappings keep the object alive
+    return fd;
+  #endif
+}
+
+} // namespace binlog
+
+#endif // _WIN32
+
+#endif // BINLOG_MIRRORED_CHANNEL_ALLOCATOR_HPP
@@ -0,0 +1,357 @@
+#ifndef BINLOG_MMAP_CHANNEL_ALLOCATOR_HPP
+#define BINLOG_MMAP_CHANNEL_ALLOCATOR_HPP
+
+#include <binlog/ChannelAllocator.hpp>
+
+#include <algorithm> // max
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <new> // bad_alloc
+#include <string>
+#include <utility> // move
+
+#ifndef _WIN32 // assume POSIX
+
+#include <fcntl.h> // NOLINT open
+#include <sys/mman.h> // NOLINT mmap, munmap, madvise, mlock
+#include <unistd.h> // NOLINT sysconf, ftruncate, pwrite, unlink, getpid
+
+#ifdef __linux__
+  #include <linux/mempolicy.h> // NOLINT MPOL_BIND
+  #include <sys/syscall.h> // NOLINT SYS_mbind
+#endif
+
+namespace binlog {
+
+/**
+ * ChannelAllocator which maps each block directly, using mmap.
+ *
+ * Depending on the options, the mapping can be backed by huge pages,
+ * pre-faulted, locked to the memory and bound to a NUMA node.
+ * Blocks are allocated by the thread creating the channel,
+ * e.g: the thread constructing a SessionWriter or adding an event to a full queue.
+ * Pre-faulted pages are placed on the NUMA node of that thread
+ * by the default first-touch policy of the system, if no node is specified.
+ *
+ * If Options::directory is set, each block is backed by a file
+ * in that directory (MAP_SHARED), instead of anonymous memory,
+ * and the metadata of the sessions using the allocator is also written
+ * to a file in that directory, when added (see ChannelAllocator::addMetadata).
+ * The queue data written by the writers is then kept by the page cache,
+ * even if the process crashes, without a core dump.
+ * The unconsumed data can be recovered from the directory by brecovery.
+ * The file of a block is removed when the block is deallocated,
+ * the metadata file of a session is removed when the session is destroyed.
+ *
+ * To avoid mapping a new block each time a channel is created,
+ * use it as the upstream allocator of a ChannelPool.
+ *
+ * Available on Linux, and partially (no huge pages or NUMA binding)
+ * on other POSIX systems.
+ */
+class MmapChannelAllocator : public ChannelAllocator
+{
+public:
+  struct Options
+  {
+    /**
+     * Map blocks with MAP_HUGETLB, using pre-reserved huge pages.
+     * If the mapping fails (e.g: no huge pages are reserved),
+     * regular pages are used.
+     */
+    bool hugeTlb = false;
+
+    /** Advise transparent huge pages for the blocks with MADV_HUGEPAGE */
+    bool transparentHugePages = false;
+
+    /** Write every page of the block before returning it */
+    bool prefault = true;
+
+    /** Lock the block into memory with mlock (best effort, limited by RLIMIT_MEMLOCK) */
+    bool lock = false;
+
+    /** If non-negative, bind the block to this NUMA node with mbind (best effort) */
+    int numaNode = -1;
+
+    /** Size of a huge page. Block sizes are rounded up to this, if hugeTlb is set */
+    std::size_t hugePageSize = std::size_t{2} << 20;
+
+    /**
+     * If not empty, blocks are backed by files created in this existing directory,
+     * named binlog-<pid>-<n>.queue, and metadata is written to binlog-<pid>-<n>.metadata.
+     * hugeTlb is ignored for file backed blocks.
+     */
+    std::string directory;
+  };
+
+  MmapChannelAllocator() : MmapChannelAllocator(Options{}) {}
+
+  explicit MmapChannelAllocator(Options options)
+    :_options(std::move(options)),
+     _pageSize(std::size_t(sysconf(_SC_PAGESIZE)))
+  {}
+
+  /** Close the metadata files not removed yet */
+  ~MmapChannelAllocator() override;
+
+  MmapChannelAllocator(const MmapChannelAllocator&) = delete;
+  void operator=(const MmapChannelAllocator&) = delete;
+
+  /** @throws std::bad_alloc if the block (or its file) can not be mapped */
+  char* allocate(std::size_t size) override;
+
+  void deallocate(char* block, std::size_t size) noexcept override;
+
+  /** Append the metadata to the metadata file of `session`, if Options::directory is set (best effort) */
+  void addMetadata(const void* session, const char* data, std::size_t size) noexcept override;
+
+  /** Remove the metadata file of `session`, if any */
+  void removeMetadata(const void* session) noexcept override;
+
+  const Options& options() const { return _options; }
+
+private:
+  /** @returns `size` rounded up to page or huge page boundary */
+  std::size_t mappingSize(std::size_t size) const;
+
+  /**
+   * Recoverable metadata of a session, the same layout as
+   * the metadata buffer of the session in memory:
+   *
+   *     [u64 magic|ptr session|u64 size][...size bytes of data...]
+   */
+  struct MetadataFile
+  {
+    int fd;
+    std::string path;
+    std::uint64_t size;
+  };
+
+  /** @returns a new path in _options.directory */
+  std::string nextPath(const char* extension);
+
+  /** Create a new file in _options.directory, and map it. @returns MAP_FAILED on error */
+  void* mapFile(std::size_t length);
+
+  /** @pre _filesMutex is locked by the caller */
+  MetadataFile* metadataFile(const void* session);
+
+  Options _options;
+  std::size_t _pageSize;
+
+  std::atomic<std::size_t> _nextFileIndex{0};
+  std::mutex _filesMutex;                                // guards the members below
+  std::map<const char*, std::string> _files;             // block -> path of the backing file
+  std::map<const void*, MetadataFile> _metadataFiles;    // session -> its metadata file
+};
+
+inline MmapChannelAllocator::~MmapChannelAllocator()
+{
+  // sessions share the ownership of *this, the remaining files belong to no session
+  for (auto& item : _metadataFiles)
+  {
+    close(item.second.fd);
+    ::unlink(item.second.path.c_str());
+  }
+}
+
+inline char* MmapChannelAllocator::allocate(std::size_t size)
+{
+  const std::size_t length = mappingSize(size);
+  const int protection = PROT_READ | PROT_WRITE;
+  const int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+  void* block = MAP_FAILED;
+
+  if (! _options.directory.empty())
+  {
+    block = mapFile(length);
+    if (block == MAP_FAILED) { throw std::bad_alloc(); }
+  }
+
+  #ifdef MAP_HUGETLB
+    if (_options.hugeTlb && block == MAP_FAILED)
+    {
+      block = mmap(nullptr, length, protection, flags | MAP_HUGETLB, -1, 0);
+    }
+  #endif
+
+  if (block == MAP_FAILED)
+  {
+    block = mmap(nullptr, length, protection, flags, -1, 0);
+  }
+
+  if (block == MAP_FAILED)
+  {
+    throw std::bad_alloc();
+  }
+
+  #ifdef MADV_HUGEPAGE
+    if (_options.transparentHugePages)
+    {
+      madvise(block, length, MADV_HUGEPAGE);
+    }
+  #endif
+
+  #if defined(__linux__) && defined(SYS_mbind)
+    if (_options.numaNode >= 0 && std::size_t(_options.numaNode) < sizeof(unsigned long) * 8)
+    {
+      const unsigned long nodeMask = 1UL << _options.numaNode;
+      // the kernel ignores the last bit of maxnode, pass one more
+      syscall(SYS_mbind, block, length, MPOL_BIND, &nodeMask, sizeof(nodeMask) * 8 + 1, MPOL_MF_MOVE);
+    }
+  #endif
+
+  if (_options.lock)
+  {
+    mlock(block, length); // also faults the pages in
+  }
+
+  if (_options.prefault)
+  {
+    memset(block, 0, length);
+  }
+
+  return static_cast<char*>(block);
+}
+
+inline void MmapChannelAllocator::deallocate(char* block, std::size_t size) noexcept
+{
+  // munmap also unlocks the pages
+  munmap(block, mappingSize(size));
+
+  if (! _options.directory.empty())
+  {
+    std::lock_guard<std::mutex> lock(_filesMutex);
+    auto it = _files.find(block);
+    if (it != _files.end())
+    {
+      // the channel is consumed and closed, nothing to recover
+      ::unlink(it->second.c_str());
+      _files.erase(it);
+    }
+  }
+}
+
+inline std::size_t MmapChannelAllocator::mappingSize(std::size_t size) const
+{
+  const bool hugeTlb = _options.hugeTlb && _options.directory.empty();
+  const std::size_t alignment = hugeTlb ? (std::max)(_options.hugePageSize, _pageSize) : _pageSize;
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+inline void MmapChannelAllocator::addMetadata(const void* session, const char* data, std::size_t size) noexcept
+{
+  if (_options.directory.empty() || size == 0) { return; }
+
+  constexpr std::size_t sizeOffset = sizeof(std::uint64_t) + sizeof(void*);
+  constexpr std::size_t headerSize = sizeOffset + sizeof(std::uint64_t);
+
+  std::lock_guard<std::mutex> lock(_filesMutex);
+  MetadataFile* file = metadataFile(session);
+  if (file == nullptr) { return; }
+
+  // append the data first, then make it valid by updating the size
+  const off_t offset = off_t(headerSize + file->size);
+  if (pwrite(file->fd, data, size, offset) == ssize_t(size))
+  {
+    file->size += size;
+    pwrite(file->fd, &file->size, sizeof(file->size), off_t(sizeOffset));
+  }
+}
+
+inline void MmapChannelAllocator::removeMetadata(const void* session) noexcept
+{
+  std::lock_guard<std::mutex> lock(_filesMutex);
+  auto it = _metadataFiles.find(session);
+  if (it != _metadataFiles.end())
+  {
+    close(it->second.fd);
+    ::unlink(it->second.path.c_str());
+    _metadataFiles.erase(it);
+  }
+}
+
+inline MmapChannelAllocator::MetadataFile* MmapChannelAllocator::metadataFile(const void* session)
+{
+  auto it = _metadataFiles.find(session);
+  if (it != _metadataFiles.end()) { return &it->second; }
+
+  try
+  {
+    std::string path = nextPath(".metadata");
+    const int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600); // NOLINT(cppcoreguidelines-pro-type-vararg)
+    if (fd < 0) { return nullptr; }
+
+    // magic of the session metadata, see RecoverableVectorOutputStream
+    char header[sizeof(std::uint64_t) + sizeof(void*) + sizeof(std::uint64_t)] = {};
+    const std::uint64_t magic = 0xFE214F726E35BDBC;
+    memcpy(header, &magic, sizeof(magic));
+    memcpy(header + sizeof(magic), &session, sizeof(session));
+    if (pwrite(fd, header, sizeof(header), 0) != ssize_t(sizeof(header)))
+    {
+      close(fd);
+      ::unlink(path.c_str());
+      return nullptr;
+    }
+
+    it = _metadataFiles.emplace(session, MetadataFile{fd, std::move(path), 0}).first;
+    return &it->second;
+  }
+  catch (...)
+  {
+    return nullptr; // best effort: metadata is not recoverable
+  }
+}
+
+inline std::string MmapChannelAllocator::nextPath(const char* extension)
+{
+  return _options.directory + "/binlog-"
+    + std::to_string(getpid()) + "-"
+    + std::to_string(_nextFileIndex.fetch_add(1)) + extension;
+}
+
+inline void* MmapChannelAllocator::mapFile(std::size_t length)
+{
+  const std::string path = nextPath(".queue");
+
+  const int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600); // NOLINT(cppcoreguidelines-pro-type-vararg)
+  if (fd < 0) { return MAP_FAILED; }
+
+  void* block = MAP_FAILED;
+  if (ftruncate(fd, off_t(length)) == 0)
+  {
+    block = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  close(fd); // the mapping keeps the file open
+
+  if (block == MAP_FAILED)
+  {
+    ::unlink(path.c_str());
+    return MAP_FAILED;
+  }
+
+  try
+  {
+    std::lock_guard<std::mutex> lock(_filesMutex);
+    _files.emplace(static_cast<const char*>(block), path);
+  }
+  catch (...)
+  {
+    munmap(block, length);
+    ::unlink(path.c_str());
+    return MAP_FAILED;
+  }
+
+  return block;
+}
+
+} // namespace binlog
+
+#endif // _WIN32
+
+#endif // BINLOG_MMAP_CHANNEL_ALLOCATOR_HPP
@@ -15,12 +15,7 @@
 #pragma once
 
 #include <cstdint>
-#include <cstring>
 
-#include <algorithm>
-#include <iostream>
-#include <utility>
-#include <vector>
  /***
   * This file contains all the C++17 constexpr/templated magic that makes
   * the non-preprocessor version of NanoLog work.
@@ -33,6 +28,8 @@
   *      (3) compress functions to take the raw arguments from the buffers
   *          and produce a more compact encoding that's compatible with the
   *          NanoLog decompressor.
+  *
+  * Only (1) is declared here, and restricted to C++14 constexpr.
   */
 namespace NanoLogInternal {
 
@@ -61,23 +58,200 @@ namespace NanoLogInternal {
 		STRING = 0
 	};
 
+	/**
+	 * Checks whether a character is with the terminal set of format specifier
+	 * characters according to the printf specification:
+	 * http://www.cplusplus.com/reference/cstdio/printf/
+	 *
+	 * \param c
+	 *      character to check
+	 * \return
+	 *      true if the character is in the set, indicating the end of the specifier
+	 */
+	constexpr bool isTerminal(char c)
+	{
+		return c == 'd' || c == 'i'
+			|| c == 'u' || c == 'o'
+			|| c == 'x' || c == 'X'
+			|| c == 'f' || c == 'F'
+			|| c == 'e' || c == 'E'
+			|| c == 'g' || c == 'G'
+			|| c == 'a' || c == 'A'
+			|| c == 'c' || c == 'p'
+			|| c == '%' || c == 's'
+			|| c == 'n';
+	}
+
+	/**
+	 * Checks whether a character is in the set of characters that specifies
+	 * a flag according to the printf specification:
+	 * http://www.cplusplus.com/reference/cstdio/printf/
+	 *
+	 * \param c
+	 *      character to check
+	 * \return
+	 *      true if the character is in the set
+	 */
+	constexpr bool isFlag(char c)
+	{
+		return c == '-' || c == '+' || c == ' ' || c == '#' || c == '0';
+	}
+
+	/**
+	 * Checks whether a character is in the set of characters that specifies
+	 * a length field according to the printf specification:
+	 * http://www.cplusplus.com/reference/cstdio/printf/
+	 *
+	 * \param c
+	 *      character to check
+	 * \return
+	 *      true if the character is in the set
+	 */
+	constexpr bool isLength(char c)
+	{
+		return c == 'h' || c == 'l' || c == 'j'
+			|| c == 'z' || c == 't' || c == 'L';
+	}
+
+	/**
+	 * Checks whether a character is a digit (0-9) or not.
+	 *
+	 * \param c
+	 *      character to check
+	 * \return
+	 *      true if the character is a digit
+	 */
+	constexpr bool isDigit(char c) {
+		return (c >= '0' && c <= '9');
+	}
 
 	/**
 	 * Analyzes a static printf style format string and extracts type information
 	 * about the p-th parameter that would be used in a corresponding NANO_LOG()
 	 * invocation.
 	 *
-	 * \tparam N
-	 *      Length of the static format string (automatically deduced)
 	 * \param fmt
-	 *      Format string to parse
+	 *      Null terminated format string to parse
 	 * \param paramNum
 	 *      p-th parameter to return type information for (starts from zero)
 	 * \return
-	 *      Returns an ParamType enum describing the type of the parameter
+	 *      Returns an ParamType enum describing the type of the parameter,
+	 *      INVALID if the specifier is malformed, or there is no such parameter
 	 */
-	std::vector<ParamType> getParamInfo(const char* fmt, int N);
+	constexpr ParamType getParamInfo(const char* fmt, int paramNum = 0)
+	{
+		int pos = 0;
+		while (fmt[pos] != 0) {
 
+			// The code below searches for something that looks like a printf
+			// specifier (i.e. something that follows the format of
+			// %<flags><width>.<precision><length><terminal>). We only care
+			// about precision and type, so everything else is ignored.
+			if (fmt[pos] != '%') {
+				++pos;
+				continue;
+			}
+			else {
+				// Note: gcc++ 5,6,7,8 seems to hang whenever one uses the construct
+				// "if (...) {... continue; }" without an else in constexpr
+				// functions. Hence, we have the code here wrapped in an else {...}
+				// I reported this bug to the developers here
+				// https://gcc.gnu.org/bugzilla/show_bug.cgi?id=86767
+				++pos;
 
-} /* Namespace NanoLogInternal */
+				// Two %'s in a row => Comment
+				if (fmt[pos] == '%') {
+					++pos;
+					continue;
+				}
+				else {
+
+					// Consume flags
+					while (isFlag(fmt[pos]))
+						++pos;
+
+					// Consume width
+					if (fmt[pos] == '*') {
+						if (paramNum == 0)
+							return ParamType::DYNAMIC_WIDTH;
+
+						--paramNum;
+						++pos;
+					}
+					else {
+						while (isDigit(fmt[pos]))
+							++pos;
+					}
+
+					// Consume precision
+					bool hasDynamicPrecision = false;
+					int precision = -1;
+					if (fmt[pos] == '.') {
+						++pos;  // consume '.'
+
+						if (fmt[pos] == '*') {
+							if (paramNum == 0)
+								return ParamType::DYNAMIC_PRECISION;
+
+							hasDynamicPrecision = true;
+							--paramNum;
+							++pos;
+						}
+						else {
+							precision = 0;
+							while (isDigit(fmt[pos])) {
+								precision = 10 * precision + (fmt[pos] - '0');
+								++pos;
+							}
+						}
+					}
+
+					// consume length
+					while (isLength(fmt[pos]))
+						++pos;
+
+					// Fail on unrecognized specifiers, and on %n specifiers
+					// (i.e. store position to address) since we cannot know
+					// the position without formatting. Parsing cannot continue.
+					if (!isTerminal(fmt[pos]) || fmt[pos] == 'n' || fmt[pos] == '%')
+						return ParamType::INVALID;
+
+					if (paramNum == 0) {
+						if (fmt[pos] != 's')
+							return ParamType::NON_STRING;
+						else if (hasDynamicPrecision)
+							return ParamType::STRING_WITH_DYNAMIC_PRECISION;
+						else if (precision == -1)
+							return ParamType::STRING_WITH_NO_PRECISION;
+						else
+							return ParamType(precision);
+					}
 
+					--paramNum;
+					++pos;
+				}
+			}
+		}
+
+		return ParamType::INVALID;
+	}
+
+	/**
+	 * Counts the parameters a printf style format string expects,
+	 * including the dynamic widths and precisions (i.e. the '*' in %*.*d).
+	 *
+	 * \param fmt
+	 *      Null terminated format string to parse
+	 * \return
+	 *      Number of parameters, the last valid paramNum of getParamInfo plus one
+	 */
+	constexpr int getNumParams(const char* fmt)
+	{
+		int count = 0;
+		while (getParamInfo(fmt, count) != ParamType::INVALID)
+			++count;
+
+		return count;
+	}
+
+} /* Namespace NanoLogInternal */
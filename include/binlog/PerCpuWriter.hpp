@@ -0,0 +1,150 @@
+#ifndef BINLOG_PER_CPU_WRITER_HPP
+#define BINLOG_PER_CPU_WRITER_HPP
+
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+
+#include <algorithm> // max
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional> // hash
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility> // forward
+#include <vector>
+
+#ifdef __linux__
+  #include <sched.h> // NOLINT sched_getcpu
+#endif
+
+namespace binlog {
+
+/**
+ * Add events to a Session through a fixed number of channels,
+ * one for each CPU, shared by the threads running on that CPU.
+ *
+ * Every SessionWriter has its own channel, therefore
+ * an application with thousands of threads using thread local writers
+ * allocates thousands of mostly idle queues. A PerCpuWriter
+ * creates `cpuCount` SessionWriters: memory usage and the cost of consume
+ * scale with the number of CPUs instead of the number of threads.
+ *
+ * addEvent selects the writer of the CPU the calling thread runs on
+ * (sched_getcpu on Linux, a hash of the thread id elsewhere),
+ * and locks it by an uncontended atomic exchange. If a thread was
+ * preempted or migrated while holding the writer of the CPU,
+ * the next unlocked writer is taken instead.
+ *
+ * Events of a thread can be added to different channels,
+ * if the thread migrates between CPUs: such events
+ * are consumed in clock order only if the reader sorts them.
+ *
+ * Usage:
+ *
+ *     binlog::PerCpuWriter writer(session);
+ *     BINLOG_INFO_W(writer, "Hello from any thread");
+ */
+class PerCpuWriter
+{
+public:
+  /**
+   * Create `cpuCount` writers of `session`, each with a queue
+   * of `queueCapacity` bytes, named `name` followed by the CPU index.
+   *
+   * @param cpuCount if 0, std::thread::hardware_concurrency is used
+   */
+  explicit PerCpuWriter(Session& session, std::size_t queueCapacity = 1 << 20, std::size_t cpuCount = 0, const std::string& name = "cpu");
+
+  PerCpuWriter(const PerCpuWriter&) = delete;
+  PerCpuWriter& operator=(const PerCpuWriter&) = delete;
+
+  Session& session() { return *_session; }
+
+  /** @returns the number of underlying writers */
+  std::size_t writerCount() const { return _slots.size(); }
+
+  /**
+   * Add an event to the writer of the current CPU.
+   *
+   * @see SessionWriter::addEvent
+   */
+  template <typename... Args>
+  bool addEvent(std::uint64_t eventSourceId, std::uint64_t clock, Args&&... args) noexcept;
+
+private:
+  struct Slot
+  {
+    std::atomic<bool> locked{false};
+    SessionWriter writer;
+
+    Slot(Session& session, std::size_t queueCapacity, std::uint64_t id, std::string name)
+      :writer(session, queueCapacity, id, std::move(name))
+    {}
+  };
+
+  /** Lock and @returns the writer of the current CPU, or the next unlocked one */
+  Slot& lockSlot() noexcept;
+
+  /** @returns the index of the CPU the calling thread runs on */
+  static std::size_t currentCpu() noexcept;
+
+  Session* _session;
+  std::vector<std::unique_ptr<Slot>> _slots; // allocated separately, to avoid false sharing
+};
+
+inline PerCpuWriter::PerCpuWriter(Session& session, std::size_t queueCapacity, std::size_t cpuCount, const std::string& name)
+  :_session(&session)
+{
+  if (cpuCount == 0) { cpuCount = (std::max)(std::thread::hardware_concurrency(), 1u); }
+
+  _slots.reserve(cpuCount);
+  for (std::size_t i = 0; i < cpuCount; ++i)
+  {
+    _slots.emplace_back(new Slot(session, queueCapacity, std::uint64_t(i), name + std::to_string(i)));
+  }
+}
+
+template <typename... Args>
+bool PerCpuWriter::addEvent(std::uint64_t eventSourceId, std::uint64_t clock, Args&&... args) noexcept
+{
+  Slot& slot = lockSlot();
+  const bool result = slot.writer.addEvent(eventSourceId, clock, std::forward<Args>(args)...);
+  slot.locked.store(false, std::memory_order_release);
+  return result;
+}
+
+inline PerCpuWriter::Slot& PerCpuWriter::lockSlot() noexcept
+{
+  const std::size_t first = currentCpu() % _slots.size();
+  for (;;)
+  {
+    for (std::size_t i = 0; i < _slots.size(); ++i)
+    {
+      Slot& slot = *_slots[(first + i) % _slots.size()];
+      if (! slot.locked.load(std::memory_order_relaxed)
+          && ! slot.locked.exchange(true, std::memory_order_acquire))
+      {
+        return slot;
+      }
+    }
+
+    // every writer is taken, more threads are running than writers
+    std::this_thread::yield();
+  }
+}
+
+inline std::size_t PerCpuWriter::currentCpu() noexcept
+{
+  #ifdef __linux__
+    const int cpu = sched_getcpu();
+    if (cpu >= 0) { return std::size_t(cpu); }
+  #endif
+
+  return std::hash<std::thread::id>{}(std::this_thread::get_id());
+}
+
+} // namespace binlog
+
+#endif // BINLOG_PER_CPU_WRITER_HPP
@@ -4,13 +4,24 @@
 #include <binlog/Entries.hpp>
 #include <binlog/Range.hpp>
 #include <binlog/Time.hpp>
+#include <binlog/detail/FormatSpec.hpp>
 #include <binlog/detail/OstreamBuffer.hpp>
+#include <binlog/detail/SegmentedMap.hpp>
+#include <binlog/detail/Symbolizer.hpp>
 
+#include <mserialize/VisitPlan.hpp>
 #include <mserialize/Visitor.hpp>
+#include <mserialize/string_view.hpp>
 
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <iosfwd>
+#include <map>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace binlog {
 
@@ -30,10 +41,12 @@ namespace binlog {
  *    %T Argument tags
  *    %n Writer (thread) name
  *    %t Writer (thread) id
+ *    %c Writer context, see SessionWriter::setContext
  *    %d Timestamp, in producer timezone
  *    %u Timestamp, in UTC
  *    %r Timestamp, raw clock value
  *    %m Message (format string with arguments substituted)
+ *    %h Message, sequences of std::uint8_t as hexadecimal digits (e.g: 0x0a1bff)
  *    %% Literal %
  *
  * Time format placeholders (used by %d and %u):
@@ -46,6 +59,68 @@ class PrettyPrinter
 public:
   PrettyPrinter(std::string eventFormat, std::string timeFormat);
 
+  /**
+   * Prints a struct argument instead of its fields:
+   * deserializes the struct from `input`, prints it to `out`, and returns true.
+   * Returning false (leaving `input` unchanged) prints the fields as usual.
+   */
+  using StructPrinter = std::function<bool(detail::OstreamBuffer& out, Range& input)>;
+
+  /**
+   * Print the structs of `name` and `fieldTags` (the tag of the struct after the name,
+   * e.g: "`price'l" for `{Price`price'l}`) using `printer`.
+   *
+   * Replaces the built-in printer of the given struct (e.g: of "binlog::address"),
+   * or the one added before. Printers are matched to the argument tags
+   * once per event source, not on each event.
+   */
+  void addStructPrinter(std::string name, std::string fieldTags, StructPrinter printer);
+
+  /**
+   * Prints an enum argument instead of its enumerator name:
+   * `value` is the value of the enum (unsigned values above INT64_MAX wrap around),
+   * `enumerator` is the name of the enumerator, or empty if `value` has no name.
+   * Returning false (without printing) prints the enumerator as usual.
+   */
+  using EnumPrinter = std::function<bool(detail::OstreamBuffer& out, std::int64_t value, mserialize::string_view enumerator)>;
+
+  /**
+   * Print the enums of `name` (e.g: "Color" for `/i`Color'0`red'\`) using `printer`,
+   * e.g: to show the combination of bitflags, or a symbol looked up by its id.
+   * Replaces the printer added before for the same name.
+   */
+  void addEnumPrinter(std::string name, EnumPrinter printer);
+
+  /**
+   * Load the shared library (plugin) at `path`, and call its
+   *
+   *    extern "C" void binlog_printer_plugin(binlog::PrettyPrinter& printer)
+   *
+   * function with this printer, to add struct and enum printers
+   * (see addStructPrinter and addEnumPrinter).
+   * This way producers can log raw values, and leave the formatting to the readers.
+   *
+   * The plugin must be built by the same compiler and binlog version as the reader,
+   * it is never unloaded (the printers added by it refer to its code).
+   * The symbols of binlog it uses are resolved from the loading program:
+   * the program must export them (e.g: linked with -rdynamic).
+   *
+   * @throws std::runtime_error if the plugin can not be loaded,
+   *         or it does not define binlog_printer_plugin.
+   */
+  void loadPrinterPlugin(const std::string& path);
+
+  /**
+   * Show the function pointed by binlog::address arguments that point into
+   * the module (executable or shared library) at `path`, loaded at `base`
+   * (0 for non-PIE executables), e.g: `0x5581e2a4 (handler()+0x4)`.
+   *
+   * An address is looked up in the module of the greatest base not greater than it.
+   * The symbol tables of the module are read once, when first needed,
+   * each distinct address is looked up once.
+   */
+  void addAddressModule(std::string path, std::uint64_t base);
+
   /**
    * Print `event` using `writerProp` and `clockSync`
    * to `ostr`, according to the format specified in the consturctor.
@@ -65,8 +140,21 @@ public:
   );
 
   /**
-   * If the type indicated by `sb` is known, deserialize it from `input`,
-   * and print it to `out`, then return true.
+   * Same as above, but append the text to `out`, without flushing it.
+   *
+   * Printing many events to the same buffer, and flushing it
+   * when done, results in fewer, larger writes of the underlying stream.
+   */
+  void printEvent(
+    detail::OstreamBuffer& out,
+    const Event& event,
+    const WriterProp& writerProp = {},
+    const ClockSync& clockSync = {}
+  );
+
+  /**
+   * If the type indicated by `sb` has a printer (built-in or added by addStructPrinter),
+   * deserialize it from `input`, and print it to `out`, then return true.
    *
    * If the type is not known, `input` remains unchanged and the method returns false.
    *
@@ -74,7 +162,99 @@ public:
    */
   bool printStruct(detail::OstreamBuffer& out, mserialize::Visitor::StructBegin sb, Range& input) const;
 
+  /**
+   * If the enum of `e` has a printer added by addEnumPrinter,
+   * and it prints `e` to `out`, return true, otherwise false.
+   */
+  bool printEnum(detail::OstreamBuffer& out, mserialize::Visitor::Enum e) const;
+
 private:
+  /** A piece of a compiled format string: a literal, or a placeholder */
+  struct FormatOp
+  {
+    char spec;         // the placeholder character, or 0 if literal
+    std::size_t begin; // position of the literal in the format string
+    std::size_t size;  // size of the literal
+  };
+
+  /** The built-in struct printers, and the custom one */
+  enum class StructPrinterKind : std::uint8_t
+  {
+    address,
+    timePoint,
+    duration,   // count is int64_t
+    duration32, // count is int32_t, e.g: minutes and hours on MSVC
+    counter,
+    scopeDuration,
+    truncatedString,
+    internedString,
+    string,     // the first field, a string, e.g: std::filesystem::path
+    decimal,    // binlog::Decimal<scale>
+    fixedString, // binlog::FixedString<N>, N is taken from the tag
+    stacktrace, // binlog::Stacktrace, symbolized using the interned module map
+    custom,
+  };
+
+  struct StructPrinterEntry
+  {
+    StructPrinterKind kind;
+    const char* suffix; // of durations
+    unsigned scale;     // of decimals
+    StructPrinter custom;
+  };
+
+  static constexpr std::uint32_t noStructPrinter = ~std::uint32_t(0);
+
+  void addBuiltinStructPrinters();
+
+  /** @returns the index of the printer of `name` and `tag` in _structPrinters, or noStructPrinter */
+  std::uint32_t findStructPrinter(mserialize::string_view name, mserialize::string_view tag) const;
+
+  bool printStruct(const StructPrinterEntry& printer, mserialize::Visitor::StructBegin sb, detail::OstreamBuffer& out, Range& input) const;
+
+  /** A line of detail::loadedModules */
+  struct LoadedModule
+  {
+    std::uint64_t begin; // of the address range
+    std::uint64_t end;
+    std::uint64_t base;  // load address
+    std::string path;
+  };
+
+  /** @returns the modules of the interned module map `id`, parsed once, or nullptr if unknown */
+  const std::vector<LoadedModule>* loadedModules(std::uint64_t id) const;
+
+  void printStacktrace(detail::OstreamBuffer& out, Range& input) const;
+  void printAddress(detail::OstreamBuffer& out, std::uint64_t address) const;
+
+  /** Split `format` to literals and placeholders (%x) */
+  static std::vector<FormatOp> compileFormat(const std::string& format);
+
+  /** The parts of an EventSource needed to print its events, computed once per source */
+  struct SourceCache
+  {
+    // the source properties the cache was computed from
+    std::string formatString;
+    std::string argumentTags;
+    std::string file;
+
+    std::size_t filenameBegin = 0; // position of the file name in `file`
+
+    // formatString split on placeholders ({} or {:spec}):
+    // literals[i] precedes the i'th placeholder, literals.back() is the last
+    std::vector<std::pair<std::size_t, std::size_t>> literals; // (begin, size) in formatString
+    std::vector<mserialize::VisitPlan> argumentPlans;         // compiled tag of the argument of each placeholder
+    std::vector<detail::FormatSpec> specs;                    // spec of each placeholder, empty for {}
+
+    // (position of the name in the tag of the plan, index of the printer or noStructPrinter)
+    // of each struct of argumentPlans[i], sorted by position
+    using StructPrinterIds = std::vector<std::pair<std::uint32_t, std::uint32_t>>;
+    std::vector<StructPrinterIds> structPrinters;
+  };
+
+  /** @returns the SourceCache of event.source, computed if needed */
+  const SourceCache& sourceCache(const Event& event) const;
+
   void printEventField(
     detail::OstreamBuffer& out,
     char spec,
@@ -82,18 +262,71 @@ private:
     const WriterProp& writerProp
   ) const;
 
-  void printEventMessage(detail::OstreamBuffer& out, const Event& event) const;
+  void printEventMessage(detail::OstreamBuffer& out, const Event& event, bool hexBytes) const;
+
+  /** Print the next argument of `args`, described by `plan`, according to the non-empty `spec` */
+  void printFormattedArgument(
+    detail::OstreamBuffer& out,
+    const detail::FormatSpec& spec,
+    const mserialize::VisitPlan& plan,
+    Range& args,
+    bool hexBytes
+  ) const;
 
   void printProducerLocalTime(detail::OstreamBuffer& out, std::uint64_t clockValue) const;
   void printUTCTime(detail::OstreamBuffer& out, std::uint64_t clockValue) const;
 
+  /** The time format rendered for a given second, see printTime */
+  struct TimeCache
+  {
+    std::int64_t second = -1; // rendered second since epoch, -1 if none
+    int tzoffset = 0;
+    std::string tzname;
+    std::string text; // time format rendered, with zeros in place of %N
+    std::vector<std::size_t> nanosecondPositions; // positions of %N in text
+  };
+
+  /**
+   * Print `sinceEpoch` (with `tzoffset` already added) according to the time format.
+   * The result is computed once per second, stored in `cache`, only %N is printed per call.
+   */
+  void printTime(detail::OstreamBuffer& out, std::chrono::nanoseconds sinceEpoch, int tzoffset, const char* tzname, TimeCache& cache) const;
+  void updateTimeCache(TimeCache& cache, std::int64_t second, int tzoffset, const char* tzname) const;
+
   void printTime(detail::OstreamBuffer& out, BrokenDownTime& bdt, int tzoffset, const char* tzname) const;
   void printTimeField(detail::OstreamBuffer& out, char spec, BrokenDownTime& bdt, int tzoffset, const char* tzname) const;
 
   std::string _eventFormat;
   std::string _timeFormat;
+  std::vector<FormatOp> _eventFormatOps;
+  std::vector<FormatOp> _timeFormatOps;
   bool _useLocaltime; // true if timestamps in messages should be rendered in producer-localtime
   const ClockSync* _clockSync;
+  const detail::SegmentedMap<std::string>* _internedStrings = nullptr; // of the event being printed
+
+  mutable TimeCache _localTimeCache;
+  mutable TimeCache _utcTimeCache;
+
+  // by source id. Ids can be reused by different sources (e.g: concatenated logfiles),
+  // the cached properties are compared to the source of each event.
+  mutable detail::SegmentedMap<SourceCache> _sourceCaches;
+  mutable const SourceCache* _eventSourceCache = nullptr; // of the event being printed
+
+  // by (name, field tags) of the struct
+  std::map<std::pair<std::string, std::string>, std::uint32_t> _structPrinterIds;
+  std::vector<StructPrinterEntry> _structPrinters;
+  std::uint32_t _fixedStringPrinter = noStructPrinter; // matches any capacity, not in _structPrinterIds
+
+  std::map<std::string, EnumPrinter> _enumPrinters; // by enum name
+
+  // by the text of the interned module map
+  mutable std::map<std::string, std::vector<LoadedModule>> _loadedModules;
+  mutable detail::Symbolizer _symbolizer;
+  std::vector<std::pair<std::uint64_t, std::string>> _addressModules; // (base, path), sorted
+
+  // the argument being printed, to find the printer of its structs without comparing names
+  mutable const mserialize::VisitPlan* _visitedPlan = nullptr;
+  mutable const SourceCache::StructPrinterIds* _visitedStructPrinters = nullptr;
 };
 
 } // namespace binlog
@@ -98,6 +98,22 @@ public:
     return *this;
   }
 
+  /**
+   * Copy `size` bytes from the viewed bytes to `dst`,
+   * without checking the size of the view.
+   *
+   * Used by mserialize::visit to read the fields of objects of fixed size,
+   * after it checked the size of the whole object once.
+   *
+   * @pre size() >= size
+   * @post size() == old_size - size
+   */
+  void read_unchecked(char* dst, std::size_t size)
+  {
+    memcpy(dst, _begin, size);
+    _begin += size;
+  }
+
   /**
    * Drop `size` bytes from the view.
    *
@@ -0,0 +1,243 @@
+#ifndef BINLOG_REPEAT_COLLAPSING_STREAM_HPP
+#define BINLOG_REPEAT_COLLAPSING_STREAM_HPP
+
+#include <binlog/Entries.hpp>
+#include <binlog/Range.hpp>
+#include <binlog/detail/ForEachEntry.hpp>
+
+#include <mserialize/deserialize.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring> // memcmp
+#include <ios> // streamsize
+#include <map>
+#include <string>
+#include <utility> // move, pair
+
+namespace binlog {
+
+/**
+ * Collapse consecutive identical events of a writer,
+ * written by Session::consume, before writing them to `out`.
+ *
+ * Models mserialize::OutputStream.
+ * If an event of a writer has the same source and the same
+ * arguments as the previous event of the same writer,
+ * it is not written, only counted. The count, and the clock value
+ * of the last collapsed event, is written as a RepeatedEvents entry,
+ * before the next different event of the writer, or by flush.
+ * The first event of a run is kept with its original timestamp.
+ *
+ * Writers are identified by their WriterProp entries (id and name).
+ * WriterProp entries are written only before an entry of their writer,
+ * with zero (unknown) batchSize, as the size of the events is changed.
+ * Other special entries are written unchanged. Events are not collapsed
+ * across a WriterContext entry that changes the context of their writer.
+ *
+ * Each write must consist of complete entries, as written by Session::consume.
+ *
+ * Example:
+ *
+ *    binlog::RepeatCollapsingStream<std::ofstream> output(logfile);
+ *    session.consume(output);
+ *    output.flush(); // optional, write the pending counts
+ *
+ * EventStream (and therefore bread) shows the first event of each run,
+ * and sums the counts, see EventStream::repeatedEventCount.
+ */
+template <typename OutputStream>
+class RepeatCollapsingStream
+{
+public:
+  /** `out` must remain valid as long as *this is valid */
+  explicit RepeatCollapsingStream(OutputStream& out);
+
+  /**
+   * Write the entries of [buffer, buffer+size) to the output,
+   * except the events identical to the previous event of their writer.
+   *
+   * @throws std::runtime_error if `buffer` contains an invalid entry
+   */
+  RepeatCollapsingStream& write(const char* buffer, std::streamsize size);
+
+  /**
+   * Write a RepeatedEvents entry for each writer
+   * with collapsed events not yet counted in the output.
+   */
+  void flush();
+
+  /** @returns the number of events not written so far */
+  std::uint64_t collapsedEventCount() const { return _collapsedEventCount; }
+
+private:
+  struct Writer
+  {
+    WriterProp writerProp;          // batchSize is zero
+    bool hasWriterProp = false;     // false for the events before the first WriterProp
+    bool hasLastEvent = false;
+    std::uint64_t lastSourceId = 0; // of the last event written
+    std::string lastArguments;      // of the last event written
+    RepeatedEvents repeats;         // identical to the last event written, not yet in the output
+    std::string context;            // of the last WriterContext
+  };
+
+  void writeWriterProp(Range payload);
+
+  void writeWriterContext(Range entry, Range payload);
+
+  void writeEvent(Range entry, std::uint64_t sourceId, Range payload);
+
+  /** Write `writer.repeats`, if not empty */
+  void writeRepeats(Writer& writer);
+
+  /** Make `writer` the writer of the next entries in the output */
+  void selectWriter(Writer& writer);
+
+  void writeEntry(Range entry);
+
+  OutputStream& _out;
+  std::map<std::pair<std::uint64_t, std::string>, Writer> _writers; // by WriterProp id and name
+  Writer* _inputWriter;  // the writer of the entries being written
+  Writer* _outputWriter; // the writer of the most recent WriterProp in the output
+  std::uint64_t _collapsedEventCount = 0;
+};
+
+template <typename OutputStream>
+RepeatCollapsingStream<OutputStream>::RepeatCollapsingStream(OutputStream& out)
+  :_out(out),
+   _inputWriter(&_writers[{0, std::string{}}]),
+   _outputWriter(_inputWriter)
+{}
+
+template <typename OutputStream>
+RepeatCollapsingStream<OutputStream>& RepeatCollapsingStream<OutputStream>::write(const char* buffer, std::streamsize size)
+{
+  detail::forEachEntry(buffer, std::size_t(size), [this](Range entry, std::uint64_t tag, Range payload)
+  {
+    if (! detail::isSpecialEntryTag(tag))
+    {
+      writeEvent(entry, tag, payload);
+    }
+    else if (tag == WriterProp::Tag)
+    {
+      writeWriterProp(payload);
+    }
+    else if (tag == WriterContext::Tag)
+    {
+      writeWriterContext(entry, payload);
+    }
+    else if (tag == EventSource::Tag || tag == ClockSync::Tag || tag == InternedString::Tag)
+    {
+      writeEntry(entry); // metadata, independent of writers
+    }
+    else
+    {
+      // e.g: DroppedEvents, belongs to the writer of the most recent WriterProp
+      selectWriter(*_inputWriter);
+      writeEntry(entry);
+    }
+  });
+
+  return *this;
+}
+
+template <typename OutputStream>
+void RepeatCollapsingStream<OutputStream>::flush()
+{
+  for (auto& item : _writers)
+  {
+    writeRepeats(item.second);
+  }
+}
+
+template <typename OutputStream>
+void RepeatCollapsingStream<OutputStream>::writeWriterProp(Range payload)
+{
+  WriterProp writerProp;
+  mserialize::deserialize(writerProp, payload);
+  writerProp.batchSize = 0;
+
+  Writer& writer = _writers[{writerProp.id, writerProp.name}];
+  writer.writerProp = std::move(writerProp);
+  writer.hasWriterProp = true;
+  _inputWriter = &writer;
+}
+
+template <typename OutputStream>
+void RepeatCollapsingStream<OutputStream>::writeWriterContext(Range entry, Range payload)
+{
+  WriterContext writerContext;
+  mserialize::deserialize(writerContext, payload);
+
+  // Session::consume repeats the context in each batch, it breaks the run only if changed
+  Writer& writer = *_inputWriter;
+  if (writerContext.context != writer.context)
+  {
+    writeRepeats(writer);
+    writer.hasLastEvent = false;
+    writer.context = std::move(writerContext.context);
+  }
+
+  selectWriter(writer);
+  writeEntry(entry);
+}
+
+template <typename OutputStream>
+void RepeatCollapsingStream<OutputStream>::writeEvent(Range entry, std::uint64_t sourceId, Range payload)
+{
+  Writer& writer = *_inputWriter;
+
+  const std::uint64_t clockValue = payload.read<std::uint64_t>();
+  const std::size_t argumentsSize = payload.size();
+  const char* arguments = payload.view(argumentsSize);
+
+  if (writer.hasLastEvent
+   && writer.lastSourceId == sourceId
+   && writer.lastArguments.size() == argumentsSize
+   && (argumentsSize == 0 || memcmp(writer.lastArguments.data(), arguments, argumentsSize) == 0))
+  {
+    ++writer.repeats.count;
+    writer.repeats.lastClockValue = clockValue;
+    ++_collapsedEventCount;
+    return;
+  }
+
+  writeRepeats(writer);
+  selectWriter(writer);
+  writeEntry(entry);
+
+  writer.hasLastEvent = true;
+  writer.lastSourceId = sourceId;
+  writer.lastArguments.assign(arguments, argumentsSize);
+}
+
+template <typename OutputStream>
+void RepeatCollapsingStream<OutputStream>::writeRepeats(Writer& writer)
+{
+  if (writer.repeats.count == 0) { return; }
+
+  selectWriter(writer);
+  serializeSizePrefixedTagged(writer.repeats, _out);
+  writer.repeats = RepeatedEvents{};
+}
+
+template <typename OutputStream>
+void RepeatCollapsingStream<OutputStream>::selectWriter(Writer& writer)
+{
+  if (&writer == _outputWriter) { return; }
+
+  if (writer.hasWriterProp) { serializeSizePrefixedTagged(writer.writerProp, _out); }
+  _outputWriter = &writer;
+}
+
+template <typename OutputStream>
+void RepeatCollapsingStream<OutputStream>::writeEntry(Range entry)
+{
+  const std::size_t size = entry.size();
+  _out.write(entry.view(size), std::streamsize(size));
+}
+
+} // namespace binlog
+
+#endif // BINLOG_REPEAT_COLLAPSING_STREAM_HPP
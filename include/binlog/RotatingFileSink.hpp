@@ -0,0 +1,177 @@
+#ifndef BINLOG_ROTATING_FILE_SINK_HPP
+#define BINLOG_ROTATING_FILE_SINK_HPP
+
+#include <binlog/FileSink.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ios> // streamsize
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace binlog {
+
+/**
+ * A FileSink, that rotates the logfile when it gets too large or too old,
+ * and makes every file self contained, without Session::reconsumeMetadata.
+ *
+ * Models mserialize::OutputStream. Entries written to this sink are parsed:
+ * the latest ClockSync (and ClockCorrection), every EventSource and InternedString is kept,
+ * and copied to the beginning of each new file. Rotation happens only at the boundary
+ * of consumed channels (before a metadata or WriterProp entry),
+ * therefore the events of a writer batch are never split between files.
+ *
+ * The file being written is always `path`. At rotation it is renamed to
+ * `path.N`, where N is the number of rotations so far (path.1 is the oldest).
+ *
+ * Example:
+ *
+ *    binlog::RotatingFileSink::Options options;
+ *    options.maxFileSize = 64 << 20;
+ *    binlog::RotatingFileSink logfile("logfile.blog", options);
+ *    session.consume(logfile); // write to logfile.blog, rename it to logfile.blog.1 when full
+ *
+ * If Options::onlyReferencedSources is set, a file contains only
+ * the EventSources referenced by its events: each source is written just
+ * before the first event of the file referencing it.
+ *
+ * If Options::dictionaryDirectory is set, the metadata is not copied
+ * to the new files: at rotation, the EventSource and InternedString entries
+ * seen so far are written to a dictionary file in that directory
+ * (named by the hash of its content, and written only if it does not exist yet),
+ * and the new file starts with a DictionaryReference to it.
+ * Such files are read by DictionaryEntryStream.
+ */
+class RotatingFileSink
+{
+public:
+  struct Options
+  {
+    /** Rotate if the file is at least this large (bytes). 0: no limit */
+    std::uint64_t maxFileSize = 0;
+
+    /** Rotate if the file was opened at least this long ago. 0: no limit */
+    std::chrono::seconds maxFileAge{0};
+
+    /** Write only the EventSources referenced by the events of the file */
+    bool onlyReferencedSources = false;
+
+    /** If not empty, write the metadata of rotated files to dictionaries in this directory */
+    std::string dictionaryDirectory;
+
+    /** Options of the underlying FileSink */
+    FileSink::Options sink;
+  };
+
+  /**
+   * Open (create or truncate) `path` for writing.
+   *
+   * @throws std::runtime_error if the file can not be opened
+   */
+  RotatingFileSink(std::string path, Options options);
+
+  /** Write entries to `path` using default Options: no rotation */
+  explicit RotatingFileSink(std::string path);
+
+  /** Write [data, data+size) to the current file. */
+  RotatingFileSink& write(const char* data, std::streamsize size);
+
+  /** @see FileSink::flush */
+  void flush() { _sink.flush(); }
+
+  /** @see FileSink::close */
+  void close() { _sink.close(); }
+
+  /**
+   * Rotate the file before the next metadata or WriterProp entry,
+   * regardless the size and age of the current file.
+   */
+  void requestRotation() { _rotationRequested = true; }
+
+  /** @returns the number of rotations so far */
+  std::size_t rotationCount() const { return _rotationCount; }
+
+private:
+  /** Called when the header (size and tag) of the current entry is complete */
+  void entryHeader();
+
+  /** Called when the current entry is complete */
+  void entryEnd();
+
+  /** Write `size` bytes of the current entry to the file */
+  void writeEntryData(const char* data, std::size_t size);
+
+  bool shouldRotate() const;
+
+  /** Rotate the file, write the metadata to the new one */
+  void rotate();
+
+  /**
+   * Write the metadata seen so far to a dictionary, if not yet written.
+   *
+   * @returns the hash of the dictionary
+   * @throws std::runtime_error if the dictionary can not be written
+   */
+  std::uint64_t writeDictionary();
+
+  /** Write the EventSource `id` to the current file, if not yet written */
+  void writeSource(std::uint64_t id);
+
+  void writeToFile(const char* data, std::size_t size);
+
+  enum class EntryKind { other, event, eventSource, clockSync, clockCorrection, internedString };
+
+  /** @returns true if entries of `kind` are kept, to be copied to the new files */
+  static bool isKept(EntryKind kind)
+  {
+    return kind == EntryKind::eventSource || kind == EntryKind::clockSync
+        || kind == EntryKind::clockCorrection || kind == EntryKind::internedString;
+  }
+
+  /** Location of an EventSource entry in _sources */
+  struct SourceRange
+  {
+    std::size_t offset;
+    std::size_t size;
+  };
+
+  FileSink _sink;
+  std::string _path;
+  Options _options;
+  bool _rotationRequested = false;
+  std::size_t _rotationCount = 0;
+
+  // state of the current file
+  std::chrono::steady_clock::time_point _fileOpened;
+  std::uint64_t _fileSize = 0;
+  std::uint64_t _metadataSize = 0; // bytes written by rotate (replayed metadata)
+  std::unordered_set<std::uint64_t> _writtenSources; // if onlyReferencedSources
+
+  // metadata seen so far
+  std::vector<char> _clockSync; // the latest ClockSync entry
+  std::vector<char> _clockCorrection; // the latest ClockCorrection entry
+  std::vector<char> _sources;   // EventSource entries
+  std::unordered_map<std::uint64_t, SourceRange> _sourceRanges; // by source id
+  std::vector<char> _internedStrings; // InternedString entries
+  std::unordered_set<std::uint64_t> _internedStringIds; // of _internedStrings
+
+  // the dictionary last written, if dictionaryDirectory is set
+  std::size_t _dictionarySize = 0; // _sources.size() + _internedStrings.size() when written
+  std::uint64_t _dictionaryHash = 0;
+
+  // the entry being written: size and tag
+  char _header[sizeof(std::uint32_t) + sizeof(std::uint64_t)] = {};
+  std::size_t _headerSize = 0;   // bytes of _header already written
+  std::size_t _headerTarget = sizeof(std::uint32_t); // bytes of _header needed
+  std::uint64_t _remaining = 0;  // bytes of the entry to write after the header
+  EntryKind _kind = EntryKind::other;
+  bool _writeEntry = true;       // false if the current entry is kept, but not written (yet)
+  std::vector<char> _entry;      // the current entry, if it is metadata
+};
+
+} // namespace binlog
+
+#endif // BINLOG_ROTATING_FILE_SINK_HPP
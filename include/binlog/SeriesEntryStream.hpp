@@ -0,0 +1,95 @@
+#ifndef BINLOG_SERIES_ENTRY_STREAM_HPP
+#define BINLOG_SERIES_ENTRY_STREAM_HPP
+
+#include <binlog/EntryStream.hpp>
+#include <binlog/Range.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace binlog {
+
+/**
+ * Entry stream reading a series of logfiles as a single stream,
+ * e.g: the files written by RotatingFileSink.
+ *
+ * The files are mapped and read one after the other, see MmapEntryStream.
+ * While the entries of a file are read, the next file is mapped,
+ * and its pages are loaded on a background thread.
+ *
+ * Each file written by RotatingFileSink starts with the metadata
+ * of the previous files (event sources, interned strings, clock sync).
+ * Metadata entries equal to an entry already returned (same id, same bytes)
+ * are skipped: the reader gets the metadata once, followed by the events
+ * of each file, as if they were written to a single file.
+ *
+ * Example:
+ *
+ *    binlog::SeriesEntryStream input(binlog::SeriesEntryStream::rotatedFiles("logfile.blog"));
+ *    binlog::EventStream eventStream;
+ *    while (const binlog::Event* event = eventStream.nextEvent(input)) { print(*event); }
+ */
+class SeriesEntryStream : public EntryStream
+{
+public:
+  /**
+   * Read the files at `paths`, in the given order.
+   *
+   * @throws std::runtime_error if the first file can not be mapped
+   */
+  explicit SeriesEntryStream(std::vector<std::string> paths);
+
+  /** Waits for the background mapping of the next file, if any */
+  ~SeriesEntryStream() override;
+
+  SeriesEntryStream(const SeriesEntryStream&) = delete;
+  void operator=(const SeriesEntryStream&) = delete;
+
+  /**
+   * @see EntryStream::nextEntryPayload
+   *
+   * The returned range is valid until the next call.
+   *
+   * @throws std::runtime_error if the next file can not be mapped,
+   *         or a file ends with an incomplete entry.
+   */
+  Range nextEntryPayload() override;
+
+  /** @returns the number of files opened so far */
+  std::size_t fileCount() const { return _next; }
+
+  /** @returns the number of metadata entries skipped, because they were returned before */
+  std::size_t skippedEntryCount() const { return _skippedEntryCount; }
+
+  /**
+   * @returns the existing files written by RotatingFileSink to `path`,
+   *          oldest first: path.1, path.2, ... (while they exist), then `path`.
+   */
+  static std::vector<std::string> rotatedFiles(const std::string& path);
+
+private:
+  /** Start mapping the next file on a background thread, if any */
+  void prefetch();
+
+  /** @returns true if `payload` is a metadata entry equal to one returned before */
+  bool isDuplicate(Range payload);
+
+  std::vector<std::string> _paths;
+  std::size_t _next = 0; // the index of the next file in _paths
+  std::unique_ptr<MmapEntryStream> _current;
+  std::future<std::unique_ptr<MmapEntryStream>> _prefetched; // the file at _paths[_next], if valid
+
+  std::unordered_map<std::uint64_t, std::string> _sources; // payload of the returned EventSource entries, by id
+  std::unordered_map<std::uint64_t, std::string> _internedStrings; // payload of the returned InternedString entries, by id
+  std::string _clockSync; // payload of the last returned ClockSync entry
+  std::size_t _skippedEntryCount = 0;
+};
+
+} // namespace binlog
+
+#endif // BINLOG_SERIES_ENTRY_STREAM_HPP
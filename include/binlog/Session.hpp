@@ -1,19 +1,45 @@
 #ifndef BINLOG_SESSION_HPP
 #define BINLOG_SESSION_HPP
 
+#include <binlog/ChannelAllocator.hpp>
+#include <binlog/ConstBuffer.hpp>
 #include <binlog/Entries.hpp>
 #include <binlog/Severity.hpp>
 #include <binlog/Time.hpp>
+#include <binlog/detail/CallSite.hpp>
+#include <binlog/detail/Concurrency.hpp>
+#include <binlog/detail/DeferredEvent.hpp>
+#include <binlog/detail/EagerSourceRegistry.hpp>
+#include <binlog/detail/MpscQueue.hpp>
+#include <binlog/detail/NonTemporal.hpp>
+#include <binlog/detail/Probes.hpp>
 #include <binlog/detail/Queue.hpp>
 #include <binlog/detail/QueueReader.hpp>
+#include <binlog/detail/StableSourceId.hpp>
 #include <binlog/detail/VectorOutputStream.hpp>
 
-#include <algorithm> // remove_if
+#include <mserialize/cx_string.hpp>
+#include <mserialize/serialize.hpp>
+#include <mserialize/tag.hpp>
+
+#include <algorithm> // find, max, rotate, stable_partition
+#include <array>
 #include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <cstring> // memcpy
 #include <deque>
+#include <functional>
+#include <initializer_list>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <string>
+#include <thread> // yield
+#include <type_traits>
+#include <unordered_set>
 #include <utility> // move
 #include <vector>
 
@@ -35,7 +61,16 @@ namespace binlog {
  * added using SessionWriter.
  *
  * Readers can read metadata and data, via consume.
- * Concurrent reads are serialized by a mutex.
+ * Concurrent reads of the same shard are serialized by a mutex.
+ * The consumer takes a snapshot of the metadata
+ * and the channels in a short critical section,
+ * and writes the output without holding the mutex of the writers:
+ * adding event sources or channels never waits for the OutputStream.
+ * Channels can be split into shards, different shards
+ * can be consumed concurrently, into different outputs.
+ *
+ * If BINLOG_SINGLE_THREADED is defined, members are not thread-safe,
+ * see detail/Concurrency.hpp.
  *
  * Session responsibilities:
  *  - Assign unique ids to event sources
@@ -47,9 +82,16 @@ namespace binlog {
 class Session
 {
 public:
+  struct FlightRecorderHistory;
+
   struct Channel
   {
-    explicit Channel(Session& session, std::size_t queueCapacity, WriterProp writerProp_ = {});
+    explicit Channel(
+      Session& session,
+      std::size_t queueCapacity,
+      WriterProp writerProp_ = {},
+      std::shared_ptr<ChannelAllocator> allocator = heapChannelAllocator()
+    );
     ~Channel();
 
     Channel(const Channel&) = delete;
@@ -60,10 +102,112 @@ public:
 
     detail::Queue& queue();
 
+    /** @returns the queue of a multi producer channel, or nullptr, see createMultiProducerChannel */
+    detail::MpscQueue* mpscQueue() { return _mpscQueue.get(); }
+
+    /** @returns the size of the block holding a queue of `queueCapacity` bytes, see ChannelAllocator */
+    static std::size_t allocationSize(std::size_t queueCapacity);
+
     WriterProp writerProp;      /**< Describes the writer of this channel (optional) */ // NOLINT
 
+    /** Number of events the writer dropped, not yet consumed, see DroppedEvents */
+    std::atomic<std::uint64_t> droppedEventCount{0}; // NOLINT
+
+    /** If true, the writer added events with deferred arguments, see DeferredView */
+    std::atomic<bool> hasDeferredEvents{false}; // NOLINT
+
+    /** If true, the writer added WriterProp or WriterContext entries to the queue, see SessionWriter::addTaskEvent and setContext */
+    std::atomic<bool> hasTaskContexts{false}; // NOLINT
+
+    /** Number of times the writer replaced its channel before this one, e.g: to grow the queue, see Metrics */
+    std::atomic<std::uint64_t> replacementCount{0}; // NOLINT
+
+    /** Set by the consumer if the queue was nearly empty for a while, see setShrinkPolicy */
+    std::atomic<bool> shrinkRequested{false}; // NOLINT
+
+    /**
+     * Flight recorder channels only: set by the consumer while reading the queue.
+     * The writer discards the oldest entries only if neither flag of the other side is set.
+     */
+    std::atomic<bool> isReading{false}; // NOLINT
+
+    /** Flight recorder channels only: set by the writer while discarding the oldest entries */
+    std::atomic<bool> isOverwriting{false}; // NOLINT
+
+    /** @returns true if the channel is consumed only when the flight recorder is triggered */
+    bool isFlightRecorder() const { return _flightRecorder; }
+
+    /** @returns true if the channel is consumed before the other channels, see createPriorityChannel */
+    bool isPriority() const { return _priority; }
+
+    /**
+     * Tell the consumer that the channel has new data (or dropped events).
+     *
+     * Session::consume polls only the channels notified since the last consume,
+     * (and every channel periodically), idle channels are skipped.
+     * Writers call it after committing data: it costs a relaxed load
+     * if the consumer did not poll the channel since the last notification.
+     * Channels never notified are polled by every consume:
+     * writers that notify, call it also when creating the channel,
+     * to have it skipped while idle.
+     */
+    void notifyConsumer() noexcept
+    {
+      if (! _ready.load(std::memory_order_relaxed))
+      {
+        _ready.store(true, std::memory_order_relaxed);
+        detail::atomicOr(*_readyWord, _readyMask, detail::memoryOrderRelease);
+      }
+    }
+
+    /** Like notifyConsumer, but unconditional: writers call it before releasing the channel */
+    void notifyClosing() noexcept
+    {
+      _ready.store(true, std::memory_order_relaxed);
+      detail::atomicOr(*_readyWord, _readyMask, detail::memoryOrderAcqRel);
+    }
+
   private:
-    std::unique_ptr<char[]> _queue; /**< Magic, Queue, and the underlying buffer of `queue` */
+    friend class Session;
+
+    // Set by the writer, cleared by the consumer, see notifyConsumer
+    std::atomic<bool> _ready{false};
+    std::shared_ptr<std::atomic<std::uint64_t>> _readyWord; /**< Part of the ready bitmap of the session, holding the bit of this channel */
+    std::uint64_t _readyMask = 0;   /**< The bit of this channel in _readyWord */
+    std::size_t _readySlot = 0;     /**< Index of the bit of this channel in the ready bitmap */
+    std::size_t _liveIndex = 0;     /**< Index of _readySlot in Shard::liveSlots */
+
+    std::shared_ptr<ChannelAllocator> _allocator; /**< Provides _queue */
+    char* _queue;                   /**< Magic, Queue, and the underlying buffer of `queue` */
+
+    // Members below are used by Session only
+    std::size_t _shardKey = 0;      /**< Selects the consumer shard of this channel */
+    bool _flightRecorder = false;   /**< If true, consumed only when triggered, see triggerFlightRecorder */
+    bool _priority = false;         /**< If true, consumed before the other channels of the shard */
+    bool _writerPropChanged = true; /**< If true, writerProp must be copied to _consumedWriterProp (guarded by Session::_mutex) */
+    WriterProp _consumedWriterProp; /**< The consumer side copy of writerProp (guarded by Shard::mutex) */
+    detail::VectorOutputStream _writerPropEntry; /**< _consumedWriterProp serialized, followed by its WriterContext, if any, batchSize is patched by consume (guarded by Shard::mutex) */
+
+    // Multi producer channels only
+    std::unique_ptr<detail::MpscQueue> _mpscQueue; /**< Uses the buffer of `queue`, which remains empty */
+    std::vector<char> _mpscReadBuffer; /**< The entries copied by the last read (guarded by Shard::mutex) */
+    std::uint64_t _mpscReadEnd = 0;    /**< End of the entries copied by the last read (guarded by Shard::mutex) */
+
+    // Flight recorder channels only, see setFlightRecorderHistory (guarded by Shard::mutex)
+    std::deque<std::vector<char>> _history; /**< Compressed segments, oldest first */
+    std::size_t _historySize = 0;       /**< Sum of the sizes of _history */
+    std::shared_ptr<const FlightRecorderHistory> _historyCodec; /**< Compressed _history */
+    std::vector<char> _historyBuffer;   /**< The decompressed _history, while written by consume */
+    bool _dumpHistory = false;          /**< If true, the current consume writes _history */
+
+    std::uint64_t _lastBusyConsume = 0; /**< Shard::consumeCount when the queue was last found busy, see ShrinkPolicy */
+    std::uint64_t _polledAt = 0;    /**< The last consume of the shard that polled this channel (guarded by Shard::mutex) */
+    bool _notifies = false;         /**< Set when the consumer first finds the channel notified, see Shard::silentSlots (guarded by Shard::mutex) */
+
+    // Consumer side counters, see Metrics (guarded by Shard::mutex)
+    std::size_t _highWaterMark = 0;     /**< The most bytes read from the queue by a single consume */
+    std::uint64_t _bytesConsumed = 0;   /**< Bytes read from the queue so far */
+    std::uint64_t _droppedEvents = 0;   /**< Sum of the droppedEventCount taken so far */
   };
 
   /** Describe the result of a consume call */
@@ -73,10 +217,102 @@ public:
     std::size_t totalBytesConsumed = 0; /**< Total number of bytes written to the output stream in the lifetime of this session */
     std::size_t channelsPolled = 0;     /**< Number of channels polled to get log data from */
     std::size_t channelsRemoved = 0;    /**< Number of channels removed because they are empty and closed */
+    double maxQueueFill = 0;            /**< The largest fraction (0..1) of a single producer queue read by this call */
+  };
+
+  /**
+   * The data read from a channel, passed to the callback of consumeInPlace.
+   *
+   * The buffers point into the queue of the channel (or
+   * to a temporary buffer, if deferred arguments were expanded),
+   * and remain valid only until the callback returns.
+   */
+  struct ChannelData
+  {
+    std::size_t size() const { return size1 + size2; }
+
+    const WriterProp* writerProp;    /**< Writer of the channel, writerProp->batchSize == size(), with its context at the first entry */
+    const char* buffer1;             /**< First part of the entries, possibly empty */
+    std::size_t size1;
+    const char* buffer2;             /**< Second part of the entries, if they wrap around the end of the queue */
+    std::size_t size2;
+    std::uint64_t droppedEventCount; /**< Number of events the writer dropped since the last consume */
+  };
+
+  /**
+   * Counters of the session, to tell how close the logger is to become a bottleneck.
+   *
+   * The writers count without additional synchronization,
+   * the consumer aggregates the counters of the channels it consumes.
+   */
+  struct Metrics
+  {
+    /** Counters of a channel, not yet removed */
+    struct ChannelMetrics
+    {
+      WriterProp writerProp;            /**< The consumed properties of the writer of the channel */ // NOLINT
+      std::size_t capacity = 0;         /**< Size of the queue (bytes) */ // NOLINT
+      std::size_t highWaterMark = 0;    /**< The most bytes read from the queue by a single consume */ // NOLINT
+      std::uint64_t bytesConsumed = 0;  /**< Bytes read from the queue so far */ // NOLINT
+      std::uint64_t droppedEventCount = 0; /**< Number of events the writer dropped (failed to add) so far */ // NOLINT
+      std::uint64_t replacementCount = 0;  /**< Number of times the writer replaced its channel before this one */ // NOLINT
+    };
+
+    /** Number of buckets of the histograms */
+    static constexpr std::size_t histogramSize = 32;
+
+    /** Bucket 0 counts the zero values, bucket i>0 counts the values in [2^(i-1), 2^i), the last one the larger values */
+    using Histogram = std::array<std::uint64_t, histogramSize>;
+
+    std::vector<ChannelMetrics> channels;   /**< One element for each channel consumed at least once */ // NOLINT
+    std::uint64_t consumeCount = 0;         /**< Number of consume calls */ // NOLINT
+    std::uint64_t droppedEventCount = 0;    /**< Number of events dropped by the writers so far, including removed channels */ // NOLINT
+    std::size_t totalBytesConsumed = 0;     /**< See ConsumeResult::totalBytesConsumed */ // NOLINT
+    Histogram consumeDurations = {};        /**< Duration of the consume calls (microseconds), see histogramSize */ // NOLINT
+    Histogram consumeBytes = {};            /**< ConsumeResult::bytesConsumed of the consume calls, see histogramSize */ // NOLINT
+  };
+
+  /**
+   * Memory held by the session, in bytes, see memoryUsage.
+   *
+   * Buffers are counted by their capacity, containers by the size of their elements,
+   * without the bookkeeping overhead of the allocator and the containers.
+   * Blocks kept by the channel allocator for reuse (e.g: ChannelPool) are not included.
+   */
+  struct MemoryUsage
+  {
+    std::size_t channelCount = 0;        /**< Number of channels, not yet removed */ // NOLINT
+    std::size_t channelBytes = 0;        /**< Channel objects and their queues, see Channel::allocationSize */ // NOLINT
+    std::size_t writerPropBytes = 0;     /**< Names of the writers, their consumed and serialized copies */ // NOLINT
+    std::size_t sourceBytes = 0;         /**< Serialized event sources and interned strings, the severities of the sources */ // NOLINT
+    std::size_t internedStringBytes = 0; /**< Index of the interned strings, see addInternedString */ // NOLINT
+    std::size_t consumerBytes = 0;       /**< Buffers of the consumer: shard buffers, multi producer reads, flight recorder history */ // NOLINT
+
+    std::size_t totalBytes() const
+    {
+      return channelBytes + writerPropBytes + sourceBytes + internedStringBytes + consumerBytes;
+    }
   };
 
+  /** Create a session which allocates channels on the heap */
   Session();
 
+  /**
+   * Create a session which allocates channels using `channelAllocator`.
+   *
+   * Channels can outlive the session, they share
+   * the ownership of the allocator.
+   *
+   * @pre channelAllocator != nullptr
+   */
+  explicit Session(std::shared_ptr<ChannelAllocator> channelAllocator);
+
+  /** Reset the cached state of the registered call sites */
+  ~Session();
+
+  Session(const Session&) = delete;
+  void operator=(const Session&) = delete;
+
   /**
    * Create a channel with a queue of `queueCapacity` bytes.
    *
@@ -85,9 +321,49 @@ public:
    * (i.e: there are no more outstanding shared pointers)
    * and the channel is empty - by the next `consume` call.
    *
+   * If `predecessor` is specified, the created channel
+   * is consumed by the same consumer shard as `predecessor`,
+   * i.e: the events of the two channels are written to the same output,
+   * in order. Useful if a writer replaces its channel.
+   *
+   * If `flightRecorder` is true, the channel is consumed only
+   * when triggered, see triggerFlightRecorder.
+   *
+   * @pre `predecessor` must be nullptr or owned by *this
    * @return a shared pointer to the created channel
    */
-  std::shared_ptr<Channel> createChannel(std::size_t queueCapacity, WriterProp writerProp = {});
+  std::shared_ptr<Channel> createChannel(
+    std::size_t queueCapacity,
+    WriterProp writerProp = {},
+    const Channel* predecessor = nullptr,
+    bool flightRecorder = false
+  );
+
+  /**
+   * Create a channel with a queue of `queueCapacity` bytes,
+   * which can be written by multiple threads concurrently, without locking.
+   *
+   * The channel must be written through `channel.mpscQueue()`,
+   * each entry is a complete event (without the size prefix).
+   * Consuming a multi producer channel copies its data,
+   * and it cannot be recovered by brecovery.
+   *
+   * @see createChannel
+   */
+  std::shared_ptr<Channel> createMultiProducerChannel(std::size_t queueCapacity, WriterProp writerProp = {});
+
+  /**
+   * Create a channel, which is consumed before the other channels of its shard,
+   * by each consume call. Useful for events which must not wait behind others,
+   * see SessionWriter::setPriorityLane.
+   *
+   * @see createChannel
+   */
+  std::shared_ptr<Channel> createPriorityChannel(
+    std::size_t queueCapacity,
+    WriterProp writerProp = {},
+    const Channel* predecessor = nullptr
+  );
 
   /**
    * Thread-safe way to set the writer id of `channel` to `id`.
@@ -120,6 +396,66 @@ public:
    */
   std::uint64_t addEventSource(EventSource eventSource);
 
+  /**
+   * Add an event source described by `eventSource` to the session.
+   *
+   * Same as addEventSource(EventSource), but the strings of `eventSource`
+   * are serialized directly, no EventSource needs to be instantiated.
+   * Used by the log macros.
+   *
+   * @returns the id assigned to the added event source
+   */
+  std::uint64_t addEventSource(const StaticEventSource& eventSource);
+
+  /**
+   * Add the `count` event sources of `eventSources` to the session at once.
+   *
+   * Same as calling addEventSource for each, but the mutex is locked once,
+   * and the sources are added to the metadata in a single append.
+   * The sources get consecutive ids, e.g: generated code can register
+   * all of its call sites upfront, and use `firstId + index` as the id of a call site,
+   * without checking whether it is registered on each call.
+   *
+   * @pre [eventSources, eventSources+count) must be valid
+   * @returns the id assigned to eventSources[0],
+   *          eventSources[i] gets `firstId + i`.
+   */
+  std::uint64_t addEventSources(const StaticEventSource* eventSources, std::size_t count);
+
+  /**
+   * Derive the id of each event source added later (by addEventSource)
+   * from its content (severity, category, function, file, line, format string
+   * and argument tags, see detail::stableSourceId), instead of assigning
+   * ids in first-hit order. The same call site gets the same id
+   * in every run and process, readers can cache the sources by id.
+   *
+   * Adding a source equal to one added before returns the id of it,
+   * without adding it again. If the id is taken by a different source
+   * (hash collision), the source gets an id in first-hit order.
+   * Sources added by addEventSources get consecutive ids regardless.
+   *
+   * Stable ids are large numbers: CompactOutputStream spends more bytes on them.
+   */
+  void setStableSourceIds(bool enable);
+
+  /**
+   * Intern `value`: add it to the metadata as an InternedString entry,
+   * unless the session already has it.
+   *
+   * Like EventSources, interned strings are consumed
+   * before the events created after the call.
+   * Used by SessionWriter, to serialize binlog::interned arguments.
+   *
+   * @returns the id of the InternedString entry of `value`
+   */
+  std::uint64_t addInternedString(std::string value);
+
+  /**
+   * @returns the severity of the event source `sourceId`,
+   * or Severity::no_logs, if there's no such source.
+   */
+  Severity eventSourceSeverity(std::uint64_t sourceId);
+
   /** @returns Severity below writers should not add events */
   Severity minSeverity() const;
 
@@ -129,9 +465,47 @@ public:
    * This is advisory only: writers are encouraged
    * not to add new events with severity below the given limit,
    * but not required to.
+   *
+   * Updates the registered call sites, see isEnabled.
    */
   void setMinSeverity(Severity severity);
 
+  /**
+   * Set the minimum severity of the call sites of `category`,
+   * overriding minSeverity for them. E.g: enable debug
+   * events of a single category, while minSeverity is info.
+   *
+   * Honored by BINLOG_CREATE_SOURCE_AND_EVENT_IF (and therefore the log macros).
+   */
+  void setCategoryMinSeverity(const std::string& category, Severity severity);
+
+  /** Remove the override of `category`: its call sites follow minSeverity again */
+  void resetCategoryMinSeverity(const std::string& category);
+
+  /** @returns the categories overridden by setCategoryMinSeverity, and their min severity */
+  std::map<std::string, Severity> categoryMinSeverities();
+
+  /**
+   * Enable or disable the call site of the event source `sourceId`,
+   * regardless the severity rules.
+   *
+   * Honored by BINLOG_CREATE_SOURCE_AND_EVENT_IF (and therefore the log macros).
+   */
+  void setSourceEnabled(std::uint64_t sourceId, bool enabled);
+
+  /** Remove the override of `sourceId`: its call site follows the severity rules again */
+  void resetSourceEnabled(std::uint64_t sourceId);
+
+  /**
+   * @returns true if events of `site` should be added to this session,
+   * according to the severity rules and the source overrides.
+   *
+   * The check is a single relaxed load, if the state of `site`
+   * is cached for this session. Otherwise, the call site is registered:
+   * later rule changes update the cached state of `site`.
+   */
+  bool isEnabled(detail::CallSite& site);
+
   /**
    * Add `clockSync` to the set of managed metadata.
    *
@@ -140,6 +514,167 @@ public:
    */
   void setClockSync(const ClockSync& clockSync);
 
+  /**
+   * Make consume periodically refresh the clock sync of the session:
+   * if at least `interval` elapsed since the last refresh,
+   * consume calls `makeClockSync`, and sets the result as
+   * the clock sync of the session (see setClockSync), before consuming
+   * the metadata. The first refresh is done by the first consume after this call.
+   *
+   * Useful for clocks that drift from the system clock, e.g: the TSC
+   * (see binlog::TscClockSyncSource): readers convert each event using the most
+   * recent ClockSync consumed before it. Writers are not affected.
+   *
+   * `makeClockSync` is called on the consumer thread, exceptions thrown
+   * by it are propagated by consume. An empty function disables refresh.
+   */
+  void setClockSyncRefresh(std::function<ClockSync()> makeClockSync, std::chrono::nanoseconds interval);
+
+  /**
+   * Correct the wall clock time of the consumed clock syncs by `offset`,
+   * e.g: the offset of the local clock to the reference clock, measured by PTP or NTP,
+   * with the given `uncertainty`.
+   *
+   * `offset` is added to the nsSinceEpoch member of the current clock sync,
+   * and of the ones set later (see setClockSync, setClockSyncRefresh),
+   * and each consumed clock sync is preceded by a ClockCorrection entry.
+   * Affects Events consumed after this call. Thread safe: can be called
+   * periodically, by the thread that measures the offset.
+   */
+  void setClockCorrection(std::chrono::nanoseconds offset, std::chrono::nanoseconds uncertainty);
+
+  /**
+   * @returns the current counters of the session and its channels.
+   *
+   * Waits for the ongoing consume calls to finish (one shard at a time),
+   * thread safe: can be called periodically, e.g: by a monitoring thread.
+   */
+  Metrics metrics();
+
+  /**
+   * @returns the memory currently held by the session and its channels.
+   *
+   * Waits for the ongoing consume calls to finish (one shard at a time),
+   * thread safe: can be called periodically, e.g: by a monitoring thread.
+   */
+  MemoryUsage memoryUsage();
+
+  /**
+   * Make every `consumeInterval`-th consume call of each shard write telemetry events
+   * to the output, after the consumed data (0 disables telemetry):
+   *
+   *  - For each channel of the shard: the counters of the channel, see Metrics::ChannelMetrics
+   *  - For the shard: the consume count, the total consumed bytes, the dropped events,
+   *    and the largest lag since the previous telemetry event:
+   *    the age of the oldest event read by a consume call, in nanoseconds.
+   *
+   * The events are written by a writer named "binlog", with category "binlog",
+   * and are timestamped by `clock`, that must be the clock of the clock sync of the session
+   * (e.g: binlog::clockNow, the default). consumeInPlace does not write telemetry events.
+   */
+  void setTelemetry(std::uint64_t consumeInterval, std::uint64_t (*clock)() = &clockNow);
+
+  /**
+   * Set the function to be called when a writer asks
+   * for its queue to be consumed, see SessionWriter::setWakeupWatermark.
+   *
+   * `wakeup` is called on the writer thread: it must be fast, and must not throw.
+   * An empty function disables wakeups. After this call returns,
+   * the previous function is not called anymore.
+   */
+  void setConsumerWakeup(std::function<void()> wakeup);
+
+  /** Call the function set by setConsumerWakeup, if any */
+  void wakeupConsumer();
+
+  /** When writers should give back the memory of their grown queues, see setShrinkPolicy */
+  struct ShrinkPolicy
+  {
+    /** Number of consume calls the queue must be nearly empty for, 0 disables shrinking */
+    std::uint64_t idleConsumeCount = 0;
+
+    /** The queue is nearly empty, if consume reads less than `capacity / usageDivisor` bytes of it */
+    std::size_t usageDivisor = 8;
+  };
+
+  /**
+   * Ask the writers to shrink their queues, after being nearly empty
+   * for `policy.idleConsumeCount` consume calls of their shard.
+   *
+   * A writer whose queue has grown (see SessionWriter::setOverflowPolicy)
+   * replaces its channel with one of the initial capacity,
+   * when it adds the next event. The buffers are allocated
+   * by the channel allocator of the session, e.g: a ChannelPool.
+   * Channels skipped by consume (not notified, see fullPollInterval)
+   * count as empty.
+   */
+  void setShrinkPolicy(ShrinkPolicy policy);
+
+  /**
+   * Prefetch the first `bytes` bytes of the data of the next channel,
+   * while consume writes the data of the current one to the output.
+   *
+   * Useful if the writers bypass the cache (see SessionWriter::setNonTemporalThreshold),
+   * and the consumer would otherwise wait for the memory, channel by channel.
+   *
+   * @param bytes 0 (the default) disables prefetching
+   */
+  void setConsumerPrefetch(std::size_t bytes);
+
+  /** Keeps the older events of the flight recorders compressed, see setFlightRecorderHistory */
+  struct FlightRecorderHistory
+  {
+    /** The most bytes of compressed segments kept for each flight recorder channel, 0 disables the history */
+    std::size_t maxBytes = 0;
+
+    /** Append the compressed [data, data+size) to `out`, e.g: by binlog::compressFrame */
+    std::function<void(const char* data, std::size_t size, std::vector<char>& out)> compress;
+
+    /** Append the decompressed [data, data+size), produced by `compress`, to `out`, e.g: by binlog::decompressFrame */
+    std::function<void(const char* data, std::size_t size, std::vector<char>& out)> decompress;
+  };
+
+  /**
+   * Keep a compressed history of the flight recorder channels, longer than their queues.
+   *
+   * If the flight recorders are not triggered, consume reads the queue of each
+   * flight recorder that is at least half full, compresses the read entries
+   * (framed by WriterProp and DroppedEvents entries, as if consumed) to a segment,
+   * and releases the queue space: the writer discards its oldest events only
+   * if the consumer falls behind. The segments of each channel are kept
+   * in memory, the oldest ones are discarded to keep at most `history.maxBytes`.
+   * If triggered, the segments are decompressed and written before the data of the queue.
+   *
+   * The consumer must run often enough (e.g: by a BackgroundConsumer) to read
+   * the queues before they are full. While a queue is compressed, the events that
+   * do not fit are dropped. The history of a channel is discarded with the channel,
+   * if the writer is destroyed before the next trigger.
+   * consumeInPlace writes the history to `metadataOut`, writeUnconsumed does not write it.
+   * Changing the codec drops the kept history: the segments compressed before this call
+   * are decompressed by the previous `history.decompress` if a trigger comes first,
+   * but discarded when the channel compresses its next segment by the new codec.
+   *
+   * Example:
+   *
+   *    session.setFlightRecorderHistory({64 << 20,
+   *      [](const char* data, std::size_t size, std::vector<char>& out) { binlog::compressFrame(data, size, out); },
+   *      [](const char* data, std::size_t size, std::vector<char>& out) { binlog::decompressFrame(data, size, out); }
+   *    });
+   */
+  void setFlightRecorderHistory(FlightRecorderHistory history);
+
+  /**
+   * Make the next consume call of each shard consume
+   * the flight recorder channels (see SessionWriter::setFlightRecorder).
+   *
+   * The flight recorder channels are not consumed otherwise:
+   * their writers keep the most recent events only, discarding the oldest ones.
+   *
+   * Async-signal-safe: can be called from a signal handler.
+   * Does not wake the consumer, see wakeupConsumer.
+   */
+  void triggerFlightRecorder() noexcept;
+
   /**
    * Move metadata and data from the session to `out`.
    *
@@ -152,7 +687,21 @@ public:
    *
    * After that, each channel is polled for log data,
    * and consumed together with an WriterProp entry, if data is found.
+   * If the writer of the channel dropped events, a DroppedEvents
+   * entry is consumed after the data.
+   * Deferred arguments of the events (see DeferredView) are
+   * replaced by a copy of the referenced buffers.
    * Closed and empty channels are removed.
+   * Flight recorder channels are consumed only if
+   * triggerFlightRecorder was called since the last consume of the shard,
+   * closed flight recorder channels are removed without consuming them otherwise.
+   * If OutputStream has a `writev` member (see ConstBuffer),
+   * the data is written by a single writev call, directly from
+   * the writer queues, without intermediate copies.
+   * The queue space is released only after writev returns.
+   * To release the queue space before a slow output is written,
+   * consume into an AsyncOutputStream.
+   *
    * Because data is consumed in batches, it is possible
    * that concurrently added events consumed from different channels
    * appear out of order. Events consumed from a single channel
@@ -169,6 +718,94 @@ public:
   template <typename OutputStream>
   ConsumeResult consume(OutputStream& out);
 
+  /**
+   * Move metadata and the data of one shard of the channels to `out`.
+   *
+   * Channels are split into `shardCount` shards, each
+   * channel belongs to exactly one shard.
+   * Like `consume(out)`, but polls only the channels of shard `shardIndex`.
+   * Different shards can be consumed concurrently, by different threads,
+   * each to its own output. Every output receives the clock sync
+   * and every event source, before the events referencing them.
+   * Events added by a SessionWriter are always consumed
+   * by the same shard, even if the writer replaces its channel.
+   *
+   * `consume(out)` is equivalent to `consume(out, 0, 1)`.
+   *
+   * @pre shardIndex < shardCount
+   * @pre shardCount must be the same in every consume call of *this
+   * @requires OutputStream must model the mserialize::OutputStream concept
+   * @param out where the binary data will be written to.
+   *
+   * @returns description of the job done, see ConsumeResult.
+   */
+  template <typename OutputStream>
+  ConsumeResult consume(OutputStream& out, std::size_t shardIndex, std::size_t shardCount);
+
+  /**
+   * Like `consume(out)`, but reads at most `maxBytes` bytes of the channels.
+   *
+   * Bounds the time a single call takes, if some writers produce a lot of data:
+   * the data of a channel which does not fit into `maxBytes` remains
+   * in its queue, for the next call. The complete entries are consumed,
+   * at least one, even if it is larger than `maxBytes`.
+   * The polled channels are visited starting from a different channel
+   * by each call, so every channel gets its turn, even if the
+   * budget is used up by the first visited channels every time.
+   * The metadata, the WriterProp and DroppedEvents entries,
+   * and the data of triggered flight recorders are not limited.
+   *
+   * @see consume(out, shardIndex, shardCount, maxBytes)
+   */
+  template <typename OutputStream>
+  ConsumeResult consume(OutputStream& out, std::size_t maxBytes);
+
+  /**
+   * Like `consume(out, shardIndex, shardCount)`, but reads at most
+   * `maxBytes` bytes of the channels, see consume(out, maxBytes).
+   *
+   * @pre shardIndex < shardCount
+   * @pre shardCount must be the same in every consume call of *this
+   */
+  template <typename OutputStream>
+  ConsumeResult consume(OutputStream& out, std::size_t shardIndex, std::size_t shardCount, std::size_t maxBytes);
+
+  /**
+   * Like `consume`, but the data of the channels is not written,
+   * but passed to `callback` in place, without copying.
+   *
+   * The metadata (ClockSync, EventSources) not yet consumed
+   * is written to `metadataOut` first, as by consume.
+   * Then, `callback(const ChannelData&)` is called for each
+   * channel that has data or dropped events, in order.
+   * Deferred arguments of the events are expanded to a temporary
+   * buffer, the data of other channels is not copied.
+   *
+   * The queue space of a channel is released when the callback returns.
+   * If the callback throws, the read of the current and the remaining channels
+   * is not committed: their data is passed again by the next consume.
+   *
+   * The entries given to the callback are unframed: no WriterProp
+   * or DroppedEvents entry is added, the callback gets them as ChannelData members.
+   *
+   * @requires OutputStream must model the mserialize::OutputStream concept
+   * @param metadataOut where the metadata will be written to.
+   * @param callback function invoked with the data of each channel
+   * @returns description of the job done, see ConsumeResult.
+   */
+  template <typename OutputStream, typename Callback>
+  ConsumeResult consumeInPlace(OutputStream& metadataOut, Callback&& callback);
+
+  /**
+   * Like `consumeInPlace(metadataOut, callback)`, but polls only the channels of shard `shardIndex`.
+   *
+   * @see consume(out, shardIndex, shardCount)
+   * @pre shardIndex < shardCount
+   * @pre shardCount must be the same in every consume call of *this
+   */
+  template <typename OutputStream, typename Callback>
+  ConsumeResult consumeInPlace(OutputStream& metadataOut, Callback&& callback, std::size_t shardIndex, std::size_t shardCount);
+
   /**
    * Move already consumed metadata again to `out`.
    *
@@ -186,248 +823,2156 @@ public:
   template <typename OutputStream>
   ConsumeResult reconsumeMetadata(OutputStream& out);
 
-private:
-  template <typename Entry, typename OutputStream>
-  std::size_t consumeSpecialEntry(const Entry& entry, OutputStream& out);
+  /**
+   * Move the metadata already consumed by shard `shardIndex` again to `out`.
+   *
+   * @see reconsumeMetadata(out) and consume(out, shardIndex, shardCount)
+   * @pre shardIndex < shardCount
+   */
+  template <typename OutputStream>
+  ConsumeResult reconsumeMetadata(OutputStream& out, std::size_t shardIndex, std::size_t shardCount);
 
-  std::mutex _mutex;
+  /**
+   * Write the metadata (ClockSync, EventSources) and the unconsumed
+   * data of every channel, by calling `write(const char* data, std::size_t size)`,
+   * without taking any lock, allocating memory, or releasing queue space.
+   *
+   * Async-signal-safe if `write` is: meant to be called by a crash handler
+   * (see CrashHandler), when the process is about to terminate,
+   * and the consumer might never run again. The written bytes form a self contained
+   * binlog stream, readable by bread, as if the crashed process consumed the session.
+   *
+   * Writers, consumers, and channel creation are not synchronized with:
+   * if they run concurrently, their changes might be partially visible.
+   * Data being consumed at the time of the call might also be written by the consumer.
+   * The data of multi producer channels (see createMultiProducerChannel) is not written.
+   * The contexts of the writers (see SessionWriter::setContext) are not repeated:
+   * events are written without context, until it changes in the unconsumed data.
+   */
+  template <typename Write>
+  void writeUnconsumed(Write&& write) noexcept;
 
-  std::vector<std::shared_ptr<Channel>> _channels;
-  detail::RecoverableVectorOutputStream _clockSync = {0xFE214F726E35BDBC, this};
-  detail::RecoverableVectorOutputStream _sources = {0xFE214F726E35BDBC, this};
-  std::streamsize _sourcesConsumePos = 0;
-  std::uint64_t _nextSourceId = 1;
+  /**
+   * consume polls the channels notified by their writers (see Channel::notifyConsumer),
+   * the channels never notified, and every channel in every `fullPollInterval`th consume
+   * of a shard, to find the channels changed without notification.
+   */
+  static constexpr std::uint64_t fullPollInterval = 64;
 
-  std::size_t _totalConsumedBytes = 0;
+private:
+  /** The state of a channel between beginRead and endRead in consume */
+  struct ChannelRead
+  {
+    Channel* channel;
+    bool isClosed;
+    detail::QueueReader reader;
+    detail::QueueReader::ReadResult data;
+  };
 
-  std::atomic<Severity> _minSeverity = {Severity::trace};
+  /** See setTelemetry */
+  struct Telemetry
+  {
+    std::uint64_t consumeInterval = 0;
+    std::uint64_t (*clock)() = nullptr;
+    std::uint64_t channelSourceId = 0; // the EventSource of the channel events
+    std::uint64_t shardSourceId = 0;   // the EventSource of the shard events
+  };
 
-  bool _consumeClockSync = true;
+  /** Consumer side state of a subset of the channels */
+  struct Shard
+  {
+    // Ensures only a single consumer is running at a time
+    // on this shard, guards the members below.
+    detail::Mutex mutex;
+
+    std::vector<std::shared_ptr<Channel>> channels; // indexed by Channel::_readySlot, nullptr if the slot is not used by this shard
+    std::vector<std::size_t> liveSlots;    // the non-null slots of `channels`, unordered
+    std::vector<ChannelRead> channelReads;
+    std::vector<std::shared_ptr<std::atomic<std::uint64_t>>> readyWords; // copy of Session::_readyWords
+    std::vector<std::size_t> pollSlots;    // the slots to poll by the current consume
+    std::vector<std::size_t> pollNext;     // the slots to poll by the next consume, even if not notified
+    std::vector<std::size_t> silentSlots;  // the slots of the channels never notified (e.g: written without notifyConsumer), polled by every consume
+    std::vector<std::size_t> removedSlots; // the slots of the channels removed by the current consume
+    std::uint64_t consumeCount = 0;
+    std::uint64_t writerPropVersion = 0;   // value of Session::_writerPropVersion at the last snapshot
+    detail::VectorOutputStream metadataBuffer;
+    detail::VectorOutputStream specialEntryBuffer;
+    std::vector<ConstBuffer> gatherBuffers; // data == nullptr: copied to specialEntryBuffer
+    std::size_t sourcesConsumePos = 0;
+    std::uint64_t flightRecorderTriggers = 0; // value of Session::_flightRecorderTriggers at the last consume
+    ShrinkPolicy shrinkPolicy;          // copy of Session::_shrinkPolicy
+    std::size_t prefetchBytes = 0;      // copy of Session::_prefetchBytes
+    std::shared_ptr<const FlightRecorderHistory> flightRecorderHistory; // copy of Session::_flightRecorderHistory
+    detail::VectorOutputStream historySegment; // the uncompressed segment, see archiveFlightRecorders
+    bool consumeClockSync = true;       // guarded by Session::_mutex
+    Telemetry telemetry;                // copy of Session::_telemetry
+    std::uint64_t clockFrequency = 0;   // of the clock sync of the session, copied with `telemetry`
+    std::uint64_t maxLag = 0;           // the largest lag (clock ticks) since the last telemetry, if enabled
+    detail::VectorOutputStream telemetryBuffer;
+
+    // aggregated counters, see Metrics
+    std::uint64_t droppedEventCount = 0;
+    Metrics::Histogram consumeDurations = {};
+    Metrics::Histogram consumeBytes = {};
+  };
 
-  detail::VectorOutputStream _specialEntryBuffer;
-};
+  /**
+   * Collects the ranges written during consume, to be
+   * written by a single OutputStream::writev call.
+   *
+   * Written ranges must remain valid until the data is endRead.
+   * Small ranges are copied (to `shard.specialEntryBuffer`):
+   * that is cheaper than an additional buffer, and
+   * expandDeferredEvents writes entry sizes from temporaries.
+   */
+  class GatherStream
+  {
+  public:
+    static constexpr std::streamsize copyThreshold = 64;
 
-inline Session::Channel::Channel(Session& session, std::size_t queueCapacity, WriterProp writerProp_)
-  :writerProp(std::move(writerProp_)),
-   _queue(new char[sizeof(std::uint64_t) + sizeof(Session*) + sizeof(detail::Queue) + queueCapacity])
-{
-  // To be able to recover unconsumed queue data from memory dumps,
-  // put a magic number, a pointer to the owning session, the queue and the queue buffer
-  // next to each other.
-  char* buffer = _queue.get();
+    explicit GatherStream(Shard& shard)
+      :_shard(shard)
+    {
+      _shard.specialEntryBuffer.clear();
+      _shard.gatherBuffers.clear();
+    }
 
-  // The magic number is used to indentify the queue in the memory dump
-  new (buffer) std::uint64_t(0xFE213F716D34BCBC);
-  buffer += sizeof(std::uint64_t);
+    GatherStream& write(const char* data, std::streamsize size)
+    {
+      if (size < copyThreshold)
+      {
+        _shard.specialEntryBuffer.write(data, size);
+        addCopied(std::size_t(size));
+      }
+      else if (! _shard.gatherBuffers.empty()
+        && _shard.gatherBuffers.back().data != nullptr
+        && _shard.gatherBuffers.back().data + _shard.gatherBuffers.back().size == data)
+      {
+        _shard.gatherBuffers.back().size += std::size_t(size);
+      }
+      else
+      {
+        _shard.gatherBuffers.push_back(ConstBuffer{data, std::size_t(size)});
+      }
+      return *this;
+    }
 
-  // Session* is used to separate the queues of different sessions of the program
-  new (buffer) Session*(&session);
-  buffer += sizeof(Session*);
+    /** Add the last `size` bytes of `shard.specialEntryBuffer` */
+    void addCopied(std::size_t size)
+    {
+      if (! _shard.gatherBuffers.empty() && _shard.gatherBuffers.back().data == nullptr)
+      {
+        _shard.gatherBuffers.back().size += size;
+      }
+      else
+      {
+        _shard.gatherBuffers.push_back(ConstBuffer{nullptr, size});
+      }
+    }
 
-  // Queue is used normally to store log events, and also during recovery,
-  // to determine the unconsumed parts of the buffer.
-  static_assert(alignof(detail::Queue) <= alignof(std::uint64_t), "");
-  static_assert(alignof(detail::Queue) <= alignof(Session*), "");
-  char* queueBuffer = buffer + sizeof(detail::Queue);
-  new (buffer) detail::Queue(queueBuffer, queueCapacity);
-}
+    /** Point the copied buffers to `shard.specialEntryBuffer`, which no longer changes */
+    void resolve()
+    {
+      const char* copied = _shard.specialEntryBuffer.data();
+      for (ConstBuffer& buffer : _shard.gatherBuffers)
+      {
+        if (buffer.data == nullptr)
+        {
+          buffer.data = copied;
+          copied += buffer.size;
+        }
+      }
+    }
+
+    Shard& shard() { return _shard; }
+
+  private:
+    Shard& _shard;
+  };
+
+  /** Assign a ready slot and a shard to `channel`, make it available to consume */
+  void addChannel(const std::shared_ptr<Channel>& channel, const Channel* predecessor);
+
+  /**
+   * Get the shard `shardIndex`, create it if needed.
+   *
+   * @pre shardIndex < shardCount
+   */
+  Shard& shard(std::size_t shardIndex, std::size_t shardCount);
+
+  /**
+   * Move the channels of `shard`
+   * created since the last call to `shard.channels`.
+   *
+   * @pre shard.mutex is locked by the caller
+   */
+  void takeNewChannels(Shard& shard, std::size_t shardIndex, std::size_t shardCount);
+
+  /**
+   * Take the new channels, begin reading each channel of `shard`,
+   * then take a snapshot of the metadata.
+   *
+   * @pre shard.mutex is locked by the caller
+   * @param maxBytes the number of bytes to read from the channels, see consume(out, maxBytes)
+   */
+  void beginReads(Shard& shard, std::size_t shardIndex, std::size_t shardCount, std::size_t maxBytes);
+
+  /**
+   * Remove the channels of `shard` reset by finishRead.
+   *
+   * @pre shard.mutex is locked by the caller
+   */
+  void removeClosedChannels(Shard& shard);
+
+  /**
+   * Select the channels of `shard` to poll: the new, the notified,
+   * and the recently active channels - or every channel if `pollAll` is true.
+   *
+   * @pre shard.mutex is locked by the caller
+   */
+  void selectPolledChannels(Shard& shard, bool pollAll);
+
+  /**
+   * Let the writers of the flight recorder channels of `shard`
+   * discard entries again, after consume failed before finishRead.
+   *
+   * @pre shard.mutex is locked by the caller
+   */
+  static void abortFlightRecorderReads(Shard& shard) noexcept;
+
+  /**
+   * Compress the data of the flight recorder channels of `shard`
+   * which are at least half full, add it to their history, see setFlightRecorderHistory.
+   *
+   * @pre shard.mutex is locked by the caller, shard.flightRecorderHistory != nullptr
+   */
+  void archiveFlightRecorders(Shard& shard);
+
+  /**
+   * Compress the readable data of `ch`, with its WriterProp and DroppedEvents entries,
+   * to a segment of its history, release the queue space.
+   *
+   * @pre shard.mutex is locked by the caller, `ch.isReading` is set
+   */
+  void archiveFlightRecorder(Shard& shard, Channel& ch);
+
+  /** Decompress the history of `ch`, write it to `out`, @returns the number of bytes written */
+  template <typename OutputStream>
+  static std::size_t writeHistory(Channel& ch, OutputStream& out);
+
+  /**
+   * Take a snapshot of the writer side metadata of *this.
+   *
+   * Copies the metadata not yet consumed by `shard` to `shard.metadataBuffer`,
+   * and updates the consumer side copies of the changed channel writerProps.
+   *
+   * @pre shard.mutex is locked by the caller
+   * @param withClockSync if true, copy the clock sync to `shard.metadataBuffer`, even if not changed
+   * @param allSources if true, copy the already consumed sources to `shard.metadataBuffer`, instead of the new ones
+   */
+  void snapshotMetadata(Shard& shard, bool withClockSync, bool allSources);
+
+  /** Write the metadata and the data read from the channels of `shard` to `out` */
+  template <typename OutputStream>
+  void consumeData(Shard& shard, OutputStream& out, ConsumeResult& result, std::false_type /* has writev */);
+
+  /** Write the metadata and the data read from the channels of `shard` to `out`, by a single writev */
+  template <typename OutputStream>
+  void consumeData(Shard& shard, OutputStream& out, ConsumeResult& result, std::true_type /* has writev */);
+
+  /**
+   * Write `shard.metadataBuffer` and the data of `shard.channelReads` to `out`.
+   *
+   * @param finishReads if true, call finishRead after each channel is written
+   */
+  template <typename OutputStream>
+  void writeData(Shard& shard, OutputStream& out, ConsumeResult& result, bool finishReads);
+
+  /** Request `ch` to shrink, if it was nearly empty for a while, see setShrinkPolicy */
+  static void checkShrink(const Shard& sh, Channel& ch, std::size_t readSize);
+
+  /** Copy the committed entries of a multi producer channel, see limitRead, @returns a view of the copy */
+  static detail::QueueReader::ReadResult beginMpscRead(Channel& ch, std::size_t maxSize, bool atLeastOne);
+
+  /**
+   * @returns the complete entries of `data` that fit into `maxSize` bytes,
+   *          but at least one entry, if `atLeastOne` is true.
+   */
+  static detail::QueueReader::ReadResult limitRead(const detail::QueueReader::ReadResult& data, std::size_t maxSize, bool atLeastOne);
+
+  /** @returns the size of the complete entries in [buffer,buffer+size) that fit into `maxSize` */
+  static std::size_t entriesPrefix(const char* buffer, std::size_t size, std::size_t maxSize, bool atLeastOne);
+
+  /** Release the data read from channel `i`, reset the channel if closed */
+  void finishRead(Shard& shard, std::size_t i, ConsumeResult& result);
+
+  /** @returns the number of events dropped by the writer of `ch` since the last call, count them */
+  static std::uint64_t takeDroppedEvents(Shard& shard, Channel& ch);
+
+  /** Add a consume call, that started at `start`, and consumed `bytes`, to the histograms of `shard` */
+  static void countConsume(Shard& shard, std::chrono::steady_clock::time_point start, std::size_t bytes);
+
+  /** @returns the metrics histogram bucket of `value` */
+  static std::size_t histogramBucket(std::uint64_t value);
+
+  /** @returns the concatenated tags of T... */
+  template <typename... T>
+  static std::string argumentTags()
+  {
+    const auto tags = mserialize::cx_strcat(mserialize::tag<T>()...);
+    return std::string(tags.data(), tags.size());
+  }
+
+  /** If telemetry is enabled, update `shard.maxLag` by the age of the first event of `data` */
+  static void measureLag(Shard& shard, const detail::QueueReader::ReadResult& data);
+
+  /** Write the telemetry events of `shard` to `out`, if due, see setTelemetry */
+  template <typename OutputStream>
+  void consumeTelemetry(Shard& shard, OutputStream& out, ConsumeResult& result);
+
+  /**
+   * Copy writerProp of `ch` to its consumed copy, and serialize it.
+   *
+   * @pre _mutex and the mutex of the shard of `ch` are locked by the caller
+   */
+  static void updateConsumedWriterProp(Channel& ch);
+
+  /** Serialize the consumed WriterProp of `ch` */
+  static void serializeConsumedWriterProp(Channel& ch);
+
+  /**
+   * If the consumed `data` of `ch` has WriterProp entries, make the last one
+   * the consumed WriterProp of the channel: the next batch continues in its context.
+   * Likewise, the last WriterContext entry (if not followed by a WriterProp)
+   * becomes the context of the consumed WriterProp, repeated by the next batch.
+   */
+  static void takeTaskContext(Channel& ch, const detail::QueueReader::ReadResult& data);
+
+  /**
+   * Write the serialized WriterProp of `ch` (and its context, if any) to `out`,
+   * with the given batchSize, increased by the size of the context entry.
+   */
+  template <typename OutputStream>
+  static std::size_t consumeWriterProp(Channel& ch, std::uint64_t batchSize, OutputStream& out);
+
+  /** Copy the WriterProp to `out`, as takeTaskContext can change it before the data is written */
+  static std::size_t consumeWriterProp(Channel& ch, std::uint64_t batchSize, GatherStream& out);
+
+  template <typename Entry, typename OutputStream>
+  std::size_t consumeSpecialEntry(Shard& shard, const Entry& entry, OutputStream& out);
+
+  template <typename Entry>
+  std::size_t consumeSpecialEntry(Shard& shard, const Entry& entry, GatherStream& out);
+
+  /** Register `site`, cache its state, @returns true if enabled */
+  bool registerCallSite(detail::CallSite& site);
+
+  /**
+   * Compute and cache the state of `site`.
+   *
+   * @pre _mutex is locked by the caller
+   */
+  bool updateCallSite(detail::CallSite& site);
+
+  /** @pre _mutex is locked by the caller */
+  void updateCallSites();
+
+  /**
+   * @returns the id of an event source of the given fields, see setStableSourceIds.
+   * Sets `added` to false if an equal source has the stable id already.
+   *
+   * @pre _mutex is locked by the caller
+   */
+  std::uint64_t assignSourceId(
+    Severity severity, const char* category, const char* function,
+    const char* file, std::uint64_t line, const char* formatString, const char* argumentTags,
+    bool& added
+  );
+
+  /**
+   * Add the sources of the EagerSourceRegistry not yet taken to _sources,
+   * register their call sites.
+   *
+   * @pre _mutex is locked by the caller (or *this is being constructed)
+   */
+  void takeEagerSources();
+
+  /**
+   * Serialize an entry of `args` to _sources, see serializeSizePrefixedTagged.
+   * The entry is written at once, not to be split between segments.
+   *
+   * @pre _mutex is locked by the caller (or *this is being constructed)
+   */
+  template <typename... Args>
+  void addSourcesEntry(const Args&... args);
+
+  /**
+   * Pass the bytes of _sources after `oldSize` to the channel allocator,
+   * see ChannelAllocator::addMetadata.
+   *
+   * @pre _mutex is locked by the caller (or *this is being constructed)
+   */
+  void addSourcesMetadata(std::size_t oldSize);
+
+  /** Call _makeClockSync and setClockSync, if the refresh interval elapsed */
+  void refreshClockSync();
+
+  /**
+   * Serialize _uncorrectedClockSync, corrected by _clockCorrection, to _clockSync,
+   * make every shard consume it.
+   *
+   * @pre _mutex is locked by the caller (or *this is being constructed)
+   */
+  void updateClockSync();
+
+  /** @returns the size of `data` when deferred events are expanded */
+  static std::size_t expandedSize(const detail::QueueReader::ReadResult& data);
+
+  std::shared_ptr<ChannelAllocator> _channelAllocator; // const after construction
+
+  // Guards the members modified by the writers:
+  // _newChannels, _clockSync, _uncorrectedClockSync, _clockCorrection,
+  // _sources, _nextSourceId, _nextShardKey, _shards (but not their elements),
+  // Shard::consumeClockSync, Channel::writerProp and Channel::_writerPropChanged.
+  // Never held while writing the OutputStream.
+  detail::Mutex _mutex;
+
+  std::vector<std::shared_ptr<Channel>> _newChannels;
+  std::uint64_t _writerPropVersion = 0; // incremented if the writerProp of a channel changes
+
+  // Ready bitmap: a bit for each channel, see Channel::notifyConsumer.
+  // Words are shared with the channels, they might outlive the session.
+  std::vector<std::shared_ptr<std::atomic<std::uint64_t>>> _readyWords;
+  std::vector<std::size_t> _freeReadySlots;
+  std::size_t _nextReadySlot = 0;
+  detail::RecoverableVectorOutputStream _clockSync = {0xFE214F726E35BDBC, this};
+  ClockSync _uncorrectedClockSync;      // as set by setClockSync
+  ClockCorrection _clockCorrection;
+  bool _hasClockCorrection = false;     // if setClockCorrection was called
+  detail::SegmentedRecoverableOutputStream _sources = {0xFE214F726E35BDBC, this};
+  detail::VectorOutputStream _sourceEntry; // the entry being added to _sources, see addSourcesEntry
+  std::uint64_t _nextSourceId = 1;
+  bool _stableSourceIds = false; // see setStableSourceIds
+  std::map<std::uint64_t, std::string> _stableSources; // the content of each stable id taken, to detect collisions
+  std::size_t _eagerSourcesTaken = 0; // number of EagerSourceRegistry sources in _sources
+  std::size_t _nextShardKey = 0;
+
+  std::deque<Shard> _shards; // deque: references remain valid on emplace_back
+
+  std::atomic<bool> _hasClockSyncRefresh{false};
+  detail::Mutex _clockSyncRefreshMutex; // guards the members below
+  std::function<ClockSync()> _makeClockSync;
+  std::chrono::nanoseconds _clockSyncRefreshInterval{0};
+  std::chrono::steady_clock::time_point _lastClockSyncRefresh;
+
+  std::atomic<bool> _hasConsumerWakeup{false};
+  detail::Mutex _consumerWakeupMutex; // guards _consumerWakeup
+  std::function<void()> _consumerWakeup;
+
+  std::atomic<std::size_t> _totalConsumedBytes = {0};
+
+  std::atomic<std::uint64_t> _flightRecorderTriggers = {0};
+  static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "triggerFlightRecorder must be async-signal-safe");
+
+  std::map<std::uint64_t, Severity> _sourceSeverities; // guarded by _mutex
+
+  std::map<std::string, std::uint64_t> _internedStrings; // id by value, guarded by _mutex
+
+  ShrinkPolicy _shrinkPolicy; // guarded by _mutex
+  std::size_t _prefetchBytes = 0; // guarded by _mutex, see setConsumerPrefetch
+  std::shared_ptr<const FlightRecorderHistory> _flightRecorderHistory; // guarded by _mutex, nullptr if disabled
+  Telemetry _telemetry;       // guarded by _mutex
+
+  std::atomic<Severity> _minSeverity = {Severity::trace};
+
+  // Severity rules and registered call sites, guarded by _mutex
+  std::map<std::string, Severity> _categoryMinSeverity;
+  std::map<std::uint64_t, bool> _sourceEnabled; // overrides by source id
+  std::unordered_set<detail::CallSite*> _callSites;
+};
+
+inline Session::Channel::Channel(
+  Session& session,
+  std::size_t queueCapacity,
+  WriterProp writerProp_,
+  std::shared_ptr<ChannelAllocator> allocator
+)
+  :writerProp(std::move(writerProp_)),
+   _allocator(std::move(allocator)),
+   _queue(nullptr)
+{
+  // A mirroring allocator maps the buffer twice, the mirror must begin at the end of the queue
+  const std::size_t granularity = _allocator->mirrorGranularity();
+  if (granularity != 0)
+  {
+    assert(allocationSize(0) < granularity);
+    queueCapacity = ((std::max)(queueCapacity, std::size_t{1}) + granularity - 1) / granularity * granularity;
+  }
+  _queue = _allocator->allocate(allocationSize(queueCapacity));
+
+  // To be able to recover unconsumed queue data from memory dumps,
+  // put a magic number, a pointer to the owning session, the queue and the queue buffer
+  // next to each other.
+  char* buffer = _queue;
+
+  // The magic number is used to indentify the queue in the memory dump
+  new (buffer) std::uint64_t(0xFE213F716D34BCBC);
+  buffer += sizeof(std::uint64_t);
+
+  // Session* is used to separate the queues of different sessions of the program
+  new (buffer) Session*(&session);
+  buffer += sizeof(Session*);
+
+  // Queue is used normally to store log events, and also during recovery,
+  // to determine the unconsumed parts of the buffer.
+  static_assert(alignof(detail::Queue) <= alignof(std::uint64_t), "");
+  static_assert(alignof(detail::Queue) <= alignof(Session*), "");
+  char* queueBuffer = buffer + sizeof(detail::Queue);
+  new (buffer) detail::Queue(queueBuffer, queueCapacity, granularity != 0);
+}
+
+inline Session::Channel::~Channel()
+{
+  // clear magic number - do not recover invalid data
+  std::uint64_t magic = 0;
+  memcpy(_queue, &magic, sizeof(magic));
+
+  // destroy queue
+  const std::size_t size = allocationSize(queue().capacity);
+  queue().~Queue();
+
+  _allocator->deallocate(_queue, size);
+}
+
+inline detail::Queue& Session::Channel::queue()
+{
+  return *reinterpret_cast<detail::Queue*>(_queue + sizeof(std::uint64_t) + sizeof(Session*));
+}
+
+inline std::size_t Session::Channel::allocationSize(std::size_t queueCapacity)
+{
+  return sizeof(std::uint64_t) + sizeof(Session*) + sizeof(detail::Queue) + queueCapacity;
+}
+
+inline Session::Session()
+  :Session(heapChannelAllocator())
+{}
+
+inline Session::Session(std::shared_ptr<ChannelAllocator> channelAllocator)
+  :_channelAllocator(std::move(channelAllocator))
+{
+  assert(_channelAllocator != nullptr);
+
+  _uncorrectedClockSync = systemClockSync();
+  updateClockSync();
+
+  takeEagerSources();
+}
+
+inline Session::~Session()
+{
+  // a later session at the same address must not see the cached states
+  std::lock_guard<detail::Mutex> lock(_mutex);
+  _channelAllocator->removeMetadata(this);
+
+  const std::uintptr_t self = reinterpret_cast<std::uintptr_t>(this);
+  for (detail::CallSite* site : _callSites)
+  {
+    std::uintptr_t state = self;
+    if (! site->state.compare_exchange_strong(state, 0))
+    {
+      state = self | 1;
+      site->state.compare_exchange_strong(state, 0);
+    }
+  }
+}
+
+inline std::shared_ptr<Session::Channel> Session::createChannel(
+  std::size_t queueCapacity,
+  WriterProp writerProp,
+  const Channel* predecessor,
+  bool flightRecorder
+)
+{
+  std::shared_ptr<Channel> channel = std::make_shared<Channel>(*this, queueCapacity, std::move(writerProp), _channelAllocator);
+  channel->_flightRecorder = flightRecorder;
+  addChannel(channel, predecessor);
+  return channel;
+}
+
+inline std::shared_ptr<Session::Channel> Session::createMultiProducerChannel(std::size_t queueCapacity, WriterProp writerProp)
+{
+  std::shared_ptr<Channel> channel = std::make_shared<Channel>(*this, queueCapacity, std::move(writerProp), _channelAllocator);
+  detail::Queue& queue = channel->queue();
+  channel->_mpscQueue.reset(new detail::MpscQueue(queue.buffer, queue.capacity));
+  addChannel(channel, nullptr);
+  return channel;
+}
+
+inline std::shared_ptr<Session::Channel> Session::createPriorityChannel(
+  std::size_t queueCapacity,
+  WriterProp writerProp,
+  const Channel* predecessor
+)
+{
+  std::shared_ptr<Channel> channel = std::make_shared<Channel>(*this, queueCapacity, std::move(writerProp), _channelAllocator);
+  channel->_priority = true;
+  addChannel(channel, predecessor);
+  return channel;
+}
+
+inline void Session::addChannel(const std::shared_ptr<Channel>& channel, const Channel* predecessor)
+{
+  std::lock_guard<detail::Mutex> lock(_mutex);
+  channel->_shardKey = (predecessor != nullptr) ? predecessor->_shardKey : _nextShardKey++;
+
+  std::size_t slot = _nextReadySlot;
+  if (_freeReadySlots.empty())
+  {
+    if (slot % 64 == 0) { _readyWords.push_back(std::make_shared<std::atomic<std::uint64_t>>(0)); }
+    ++_nextReadySlot;
+  }
+  else
+  {
+    slot = _freeReadySlots.back();
+    _freeReadySlots.pop_back();
+  }
+  channel->_readySlot = slot;
+  channel->_readyWord = _readyWords[slot / 64];
+  channel->_readyMask = std::uint64_t{1} << (slot % 64);
+
+  _newChannels.push_back(channel);
+}
+
+inline void Session::setChannelWriterId(Channel& channel, std::uint64_t id)
+{
+  std::lock_guard<detail::Mutex> lock(_mutex);
+
+  channel.writerProp.id = id;
+  channel._writerPropChanged = true;
+  ++_writerPropVersion;
+}
+
+inline void Session::setChannelWriterName(Channel& channel, std::string name)
+{
+  std::lock_guard<detail::Mutex> lock(_mutex);
+
+  channel.writerProp.name = std::move(name);
+  channel._writerPropChanged = true;
+  ++_writerPropVersion;
+}
+
+inline std::size_t Session::expandedSize(const detail::QueueReader::ReadResult& data)
+{
+  std::size_t result = 0;
+  const auto count = [&result](const char*, std::size_t size) { result += size; };
+  detail::expandDeferredEvents(data.buffer1, data.buffer1 + data.size1, count);
+  if (data.size2)
+  {
+    detail::expandDeferredEvents(data.buffer2, data.buffer2 + data.size2, count);
+  }
+  return result;
+}
+
+inline std::uint64_t Session::addEventSource(EventSource eventSource)
+{
+  std::lock_guard<detail::Mutex> lock(_mutex);
+
+  bool added = true;
+  eventSource.id = assignSourceId(
+    eventSource.severity, eventSource.category.c_str(), eventSource.function.c_str(),
+    eventSource.file.c_str(), eventSource.line, eventSource.formatString.c_str(),
+    eventSource.argumentTags.c_str(), added
+  );
+  if (! added) { return eventSource.id; }
+
+  _sourceSeverities[eventSource.id] = eventSource.severity;
+  const std::size_t oldSize = _sources.size();
+  addSourcesEntry(eventSource);
+  addSourcesMetadata(oldSize);
+  return eventSource.id;
+}
+
+inline std::uint64_t Session::addEventSource(const StaticEventSource& eventSource)
+{
+  std::lock_guard<detail::Mutex> lock(_mutex);
+
+  bool added = true;
+  const std::uint64_t id = assignSourceId(
+    eventSource.severity, eventSource.category, eventSource.function,
+    eventSource.file, eventSource.line, eventSource.formatString,
+    eventSource.argumentTags, added
+  );
+  if (! added) { return id; }
+
+  _sourceSeverities[id] = eventSource.severity;
+  const std::size_t oldSize = _sources.size();
+  addSourcesEntry(id, eventSource);
+  addSourcesMetadata(oldSize);
+  return id;
+}
+
+inline std::uint64_t Session::addEventSources(const StaticEventSource* eventSources, std::size_t count)
+{
+  std::lock_guard<detail::Mutex> lock(_mutex);
+
+  const std::uint64_t firstId = _nextSourceId;
+  const std::size_t oldSize = _sources.size();
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    _sourceSeverities.emplace_hint(_sourceSeverities.end(), _nextSourceId, eventSources[i].severity);
+    addSourcesEntry(_nextSourceId, eventSources[i]);
+    ++_nextSourceId;
+  }
+  addSourcesMetadata(oldSize);
+  return firstId;
+}
+
+inline std::uint64_t Session::addInternedString(std::string value)
+{
+  std::lock_guard<detail::Mutex> lock(_mutex);
+
+  const auto it = _internedStrings.find(value);
+  if (it != _internedStrings.end()) { return it->second; }
+
+  const InternedString entry{_internedStrings.size() + 1, std::move(value)};
+  const std::size_t oldSize = _sources.size();
+  addSourcesEntry(entry);
+  addSourcesMetadata(oldSize);
+  _internedStrings.emplace(entry.value, entry.id);
+  return entry.id;
+}
+
+inline Severity Session::eventSourceSeverity(std::uint64_t sourceId)
+{
+  std::lock_guard<detail::Mutex> lock(_mutex);
+  takeEagerSources();
+
+  const auto it = _sourceSeverities.find(sourceId);
+  return (it != _sourceSeverities.end()) ? it->second : Severity::no_logs;
+}
+
+inline Severity Session::minSeverity() const
+{
+  return _minSeverity.load(detail::memoryOrderAcquire);
+}
+
+inline void Session::setMinSeverity(Severity severity)
+{
+  std::lock_guard<detail::Mutex> lock(_mutex);
+  _minSeverity.store(severity, detail::memoryOrderRelease);
+  updateCallSites();
+}
+
+inline void Session::setCategoryMinSeverity(const std::string& category, Severity severity)
+{
+  std::lock_guard<detail::Mutex> lock(_mutex);
+  _categoryMinSeverity[category] = severity;
+  updateCallSites();
+}
+
+inline void Session::resetCategoryMinSeverity(const std::string& category)
+{
+  std::lock_guard<detail::Mutex> lock(_mutex);
+  _categoryMinSeverity.erase(category);
+  updateCallSites();
+}
+
+inline std::map<std::string, Severity> Session::categoryMinSeverities()
+{
+  std::lock_guard<detail::Mutex> lock(_mutex);
+  return _categoryMinSeverity;
+}
+
+inline void Session::setSourceEnabled(std::uint64_t sourceId, bool enabled)
+{
+  std::lock_guard<detail::Mutex> lock(_mutex);
+  _sourceEnabled[sourceId] = enabled;
+  updateCallSites();
+}
+
+inline void Session::resetSourceEnabled(std::uint64_t sourceId)
+{
+  std::lock_guard<detail::Mutex> lock(_mutex);
+  _sourceEnabled.erase(sourceId);
+  updateCallSites();
+}
+
+inline bool Session::isEnabled(detail::CallSite& site)
+{
+  const std::uintptr_t state = site.state.load(std::memory_order_relaxed);
+  const std::uintptr_t self = reinterpret_cast<std::uintptr_t>(this);
+  if (state == self) { return true; }
+  if (state == (self | 1)) { return false; }
+  return registerCallSite(site);
+}
+
+inline bool Session::registerCallSite(detail::CallSite& site)
+{
+  std::lock_guard<detail::Mutex> lock(_mutex);
+  _callSites.insert(&site);
+  return updateCallSite(site);
+}
+
+inline bool Session::updateCallSite(detail::CallSite& site)
+{
+  bool enabled = false;
+
+  const auto sourceIt = _sourceEnabled.find(site.sourceId.load(std::memory_order_relaxed));
+  if (sourceIt != _sourceEnabled.end())
+  {
+    enabled = sourceIt->second;
+  }
+  else
+  {
+    const auto categoryIt = _categoryMinSeverity.find(site.category);
+    const Severity minSeverity = (categoryIt != _categoryMinSeverity.end())
+      ? categoryIt->second
+      : _minSeverity.load(std::memory_order_relaxed);
+    enabled = site.severity >= minSeverity;
+  }
+
+  const std::uintptr_t self = reinterpret_cast<std::uintptr_t>(this);
+  site.state.store(enabled ? self : (self | 1), std::memory_order_relaxed);
+  return enabled;
+}
+
+inline void Session::updateCallSites()
+{
+  for (detail::CallSite* site : _callSites)
+  {
+    updateCallSite(*site);
+  }
+}
+
+inline void Session::setClockSync(const ClockSync& clockSync)
+{
+  std::lock_guard<detail::Mutex> lock(_mutex);
+  _uncorrectedClockSync = clockSync;
+  updateClockSync();
+}
+
+inline void Session::setClockCorrection(std::chrono::nanoseconds offset, std::chrono::nanoseconds uncertainty)
+{
+  std::lock_guard<detail::Mutex> lock(_mutex);
+  _clockCorrection.offset = std::int64_t(offset.count());
+  _clockCorrection.uncertainty = std::uint64_t((std::max)(uncertainty.count(), decltype(uncertainty.count()){0}));
+  _hasClockCorrection = true;
+  updateClockSync();
+}
+
+inline void Session::updateClockSync()
+{
+  _clockSync.clear();
+  if (_hasClockCorrection)
+  {
+    ClockSync corrected = _uncorrectedClockSync;
+    corrected.nsSinceEpoch += std::uint64_t(_clockCorrection.offset); // wraps around if negative
+    serializeSizePrefixedTagged(_clockCorrection, _clockSync);
+    serializeSizePrefixedTagged(corrected, _clockSync);
+  }
+  else
+  {
+    serializeSizePrefixedTagged(_uncorrectedClockSync, _clockSync);
+  }
+
+  _channelAllocator->addMetadata(this, _clockSync.data(), _clockSync.size());
+  for (Shard& shard : _shards)
+  {
+    shard.consumeClockSync = true;
+  }
+}
+
+inline void Session::setClockSyncRefresh(std::function<ClockSync()> makeClockSync, std::chrono::nanoseconds interval)
+{
+  std::lock_guard<detail::Mutex> lock(_clockSyncRefreshMutex);
+  _hasClockSyncRefresh.store(bool(makeClockSync), std::memory_order_relaxed);
+  _makeClockSync = std::move(makeClockSync);
+  _clockSyncRefreshInterval = interval;
+  _lastClockSyncRefresh = {};
+}
+
+inline void Session::refreshClockSync()
+{
+  if (! _hasClockSyncRefresh.load(std::memory_order_relaxed)) { return; }
+
+  std::lock_guard<detail::Mutex> lock(_clockSyncRefreshMutex);
+  if (! _makeClockSync) { return; }
+
+  const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  if (_lastClockSyncRefresh != std::chrono::steady_clock::time_point{}
+      && now - _lastClockSyncRefresh < _clockSyncRefreshInterval)
+  {
+    return;
+  }
+
+  setClockSync(_makeClockSync());
+  _lastClockSyncRefresh = now;
+}
+
+inline void Session::setConsumerWakeup(std::function<void()> wakeup)
+{
+  std::lock_guard<detail::Mutex> lock(_consumerWakeupMutex);
+  _hasConsumerWakeup.store(bool(wakeup), std::memory_order_relaxed);
+  _consumerWakeup = std::move(wakeup);
+}
+
+inline void Session::setShrinkPolicy(ShrinkPolicy policy)
+{
+  std::lock_guard<detail::Mutex> lock(_mutex);
+  _shrinkPolicy = policy;
+}
+
+inline void Session::setConsumerPrefetch(std::size_t bytes)
+{
+  std::lock_guard<detail::Mutex> lock(_mutex);
+  _prefetchBytes = bytes;
+}
+
+inline void Session::setFlightRecorderHistory(FlightRecorderHistory history)
+{
+  std::shared_ptr<const FlightRecorderHistory> ptr;
+  if (history.maxBytes != 0) { ptr = std::make_shared<const FlightRecorderHistory>(std::move(history)); }
+
+  std::lock_guard<detail::Mutex> lock(_mutex);
+  _flightRecorderHistory = std::move(ptr);
+}
+
+inline void Session::setStableSourceIds(bool enable)
+{
+  std::lock_guard<detail::Mutex> lock(_mutex);
+  _stableSourceIds = enable;
+}
+
+inline void Session::triggerFlightRecorder() noexcept
+{
+  _flightRecorderTriggers.fetch_add(1, detail::memoryOrderRelease);
+}
+
+inline void Session::wakeupConsumer()
+{
+  if (! _hasConsumerWakeup.load(std::memory_order_relaxed)) { return; }
+
+  std::lock_guard<detail::Mutex> lock(_consumerWakeupMutex);
+  if (_consumerWakeup) { _consumerWakeup(); }
+}
+
+template <typename OutputStream>
+Session::ConsumeResult Session::consume(OutputStream& out)
+{
+  return consume(out, 0, 1);
+}
+
+template <typename OutputStream>
+Session::ConsumeResult Session::consume(OutputStream& out, std::size_t shardIndex, std::size_t shardCount)
+{
+  return consume(out, shardIndex, shardCount, std::size_t(-1));
+}
+
+template <typename OutputStream>
+Session::ConsumeResult Session::consume(OutputStream& out, std::size_t maxBytes)
+{
+  return consume(out, 0, 1, maxBytes);
+}
+
+template <typename OutputStream>
+Session::ConsumeResult Session::consume(OutputStream& out, std::size_t shardIndex, std::size_t shardCount, std::size_t maxBytes)
+{
+  refreshClockSync();
+  updateCachedClock(); // see cachedClockNow
+
+  Shard& sh = shard(shardIndex, shardCount);
+
+  // Only a single consumer is running at a time on a shard.
+  // Writers are not blocked by this lock: they use _mutex,
+  // which is held only while the snapshots below are taken.
+  std::lock_guard<detail::Mutex> shardLock(sh.mutex);
+
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  ConsumeResult result;
+
+  beginReads(sh, shardIndex, shardCount, maxBytes);
+
+  try
+  {
+    consumeData(sh, out, result, detail::has_writev<OutputStream>{});
+  }
+  catch (...)
+  {
+    abortFlightRecorderReads(sh);
+    throw;
+  }
+
+  removeClosedChannels(sh);
+  consumeTelemetry(sh, out, result);
+
+  result.totalBytesConsumed = _totalConsumedBytes.fetch_add(result.bytesConsumed) + result.bytesConsumed;
+  countConsume(sh, start, result.bytesConsumed);
+  BINLOG_DETAIL_PROBE2(consume, result.channelsPolled, result.bytesConsumed);
+
+  return result;
+}
+
+template <typename OutputStream, typename Callback>
+Session::ConsumeResult Session::consumeInPlace(OutputStream& metadataOut, Callback&& callback)
+{
+  return consumeInPlace(metadataOut, callback, 0, 1);
+}
+
+template <typename OutputStream, typename Callback>
+Session::ConsumeResult Session::consumeInPlace(OutputStream& metadataOut, Callback&& callback, std::size_t shardIndex, std::size_t shardCount)
+{
+  refreshClockSync();
+  updateCachedClock(); // see cachedClockNow
+
+  Shard& sh = shard(shardIndex, shardCount);
+  std::lock_guard<detail::Mutex> shardLock(sh.mutex);
+
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  ConsumeResult result;
+
+  beginReads(sh, shardIndex, shardCount, std::size_t(-1));
+
+  if (sh.metadataBuffer.ssize() != 0)
+  {
+    metadataOut.write(sh.metadataBuffer.data(), sh.metadataBuffer.ssize());
+    result.bytesConsumed += std::size_t(sh.metadataBuffer.ssize());
+  }
+
+  try
+  {
+    for (std::size_t i = 0; i < sh.channelReads.size(); ++i)
+    {
+      const detail::QueueReader::ReadResult& data = sh.channelReads[i].data;
+      Channel& ch = *sh.channelReads[i].channel;
+
+      const std::uint64_t droppedEventCount = takeDroppedEvents(sh, ch);
+
+      // the history of a triggered flight recorder is framed, it can not be passed to the callback
+      if (ch._dumpHistory) { result.bytesConsumed += writeHistory(ch, metadataOut); }
+
+      if (data.size() || droppedEventCount)
+      {
+        ChannelData channelData{
+          &ch._consumedWriterProp,
+          data.buffer1, data.size1,
+          data.buffer2, data.size2,
+          droppedEventCount
+        };
+
+        // set before the data is committed, made visible by beginRead
+        if (data.size() && ch.hasDeferredEvents.load(std::memory_order_relaxed))
+        {
+          // replace deferred arguments with the referenced buffers
+          sh.specialEntryBuffer.clear();
+          const auto write = [&sh](const char* buffer, std::size_t size)
+          {
+            sh.specialEntryBuffer.write(buffer, std::streamsize(size));
+          };
+          detail::expandDeferredEvents(data.buffer1, data.buffer1 + data.size1, write);
+          if (data.size2)
+          {
+            detail::expandDeferredEvents(data.buffer2, data.buffer2 + data.size2, write);
+          }
+
+          channelData.buffer1 = sh.specialEntryBuffer.data();
+          channelData.size1 = std::size_t(sh.specialEntryBuffer.ssize());
+          channelData.buffer2 = nullptr;
+          channelData.size2 = 0;
+        }
+
+        ch._consumedWriterProp.batchSize = channelData.size();
+
+        try
+        {
+          callback(channelData);
+        }
+        catch (...)
+        {
+          // not consumed, report them again
+          ch.droppedEventCount.fetch_add(droppedEventCount, std::memory_order_relaxed);
+          throw;
+        }
+
+        result.bytesConsumed += channelData.size();
+        if (data.size() && ch.hasTaskContexts.load(std::memory_order_relaxed)) { takeTaskContext(ch, data); }
+      }
+
+      finishRead(sh, i, result);
+      result.channelsPolled++;
+    }
+  }
+  catch (...)
+  {
+    // the channels already finished might be reset
+    abortFlightRecorderReads(sh);
+    removeClosedChannels(sh);
+    throw;
+  }
+
+  removeClosedChannels(sh);
+
+  result.totalBytesConsumed = _totalConsumedBytes.fetch_add(result.bytesConsumed) + result.bytesConsumed;
+  countConsume(sh, start, result.bytesConsumed);
+  BINLOG_DETAIL_PROBE2(consume, result.channelsPolled, result.bytesConsumed);
+
+  return result;
+}
+
+inline void Session::beginReads(Shard& sh, std::size_t shardIndex, std::size_t shardCount, std::size_t maxBytes)
+{
+  ++sh.consumeCount;
+
+  // take new channels, select the ones to poll, remember which ones are closed, and which data is readable
+  sh.pollSlots.clear();
+  takeNewChannels(sh, shardIndex, shardCount);
+
+  const std::uint64_t triggers = _flightRecorderTriggers.load(detail::memoryOrderAcquire);
+  const bool readFlightRecorders = triggers != sh.flightRecorderTriggers;
+  sh.flightRecorderTriggers = triggers;
+
+  if (! readFlightRecorders && sh.flightRecorderHistory) { archiveFlightRecorders(sh); }
+
+  selectPolledChannels(sh, readFlightRecorders || sh.consumeCount % fullPollInterval == 0);
+
+  // with a limited budget, start from a different channel each time, to be fair
+  const bool limited = maxBytes != std::size_t(-1);
+  if (limited && ! sh.pollSlots.empty())
+  {
+    const std::size_t first = std::size_t(sh.consumeCount % sh.pollSlots.size());
+    std::rotate(sh.pollSlots.begin(), sh.pollSlots.begin() + std::ptrdiff_t(first), sh.pollSlots.end());
+  }
+  std::size_t budget = maxBytes;
+
+  sh.channelReads.clear();
+  for (const std::size_t slot : sh.pollSlots)
+  {
+    const std::shared_ptr<Channel>& channelptr = sh.channels[slot];
+    if (! channelptr || channelptr->_polledAt == sh.consumeCount) { continue; } // removed, or already polled
+    channelptr->_polledAt = sh.consumeCount;
+
+    // Important to check if channel is closed before beginRead,
+    // otherwise the following race becomes possible:
+    //  - Consumer finds queue is empty
+    //  - Producer adds data
+    //  - Producer closes the queue
+    //  - Consumer finds queue is closed, removes it -> data loss
+    bool isClosed = (channelptr.use_count() == 1);
+
+    detail::QueueReader reader(channelptr->queue());
+
+    if (channelptr->_flightRecorder)
+    {
+      if (! readFlightRecorders)
+      {
+        // keep the recorded events, or drop them if the writer is gone
+        if (isClosed) { sh.channelReads.push_back(ChannelRead{channelptr.get(), isClosed, reader, {}}); }
+        continue;
+      }
+
+      // stop the writer discarding entries, wait for the ongoing discard.
+      // Both flags are seq_cst: either this side sees isOverwriting,
+      // or the writer sees isReading.
+      channelptr->isReading.store(true);
+      while (channelptr->isOverwriting.load()) { std::this_thread::yield(); }
+      channelptr->_dumpHistory = ! channelptr->_history.empty();
+    }
+
+    // flight recorders are read completely, the rest is read until the budget allows
+    const std::size_t maxSize = (channelptr->_flightRecorder) ? std::size_t(-1) : budget;
+    const bool atLeastOne = (budget == maxBytes);
+    detail::QueueReader::ReadResult data;
+    bool partial = false;
+    if (channelptr->_mpscQueue)
+    {
+      data = beginMpscRead(*channelptr, maxSize, atLeastOne);
+      partial = limited && ! channelptr->_mpscQueue->readAll(channelptr->_mpscReadEnd);
+    }
+    else
+    {
+      data = reader.beginRead();
+      if (data.size() > maxSize)
+      {
+        data = limitRead(data, maxSize, atLeastOne);
+        partial = true;
+      }
+    }
+
+    // the rest of the data is consumed by a later call, the channel is not removed until then
+    if (partial) { isClosed = false; }
+    if (! channelptr->_flightRecorder) { budget -= (std::min)(budget, data.size()); }
+
+    sh.channelReads.push_back(ChannelRead{channelptr.get(), isClosed, reader, data});
+    if (sh.telemetry.consumeInterval != 0) { measureLag(sh, data); }
+
+    // the writer might not notify the next commit, if it raced with clearing _ready: poll again
+    if (data.size() != 0 || partial) { sh.pollNext.push_back(slot); }
+
+    if (sh.shrinkPolicy.idleConsumeCount != 0) { checkShrink(sh, *channelptr, partial ? channelptr->queue().capacity : data.size()); }
+  }
+
+  // move the reads of the priority channels to the front, without allocation
+  std::size_t priorityCount = 0;
+  for (std::size_t i = 0; i < sh.channelReads.size(); ++i)
+  {
+    if (sh.channelReads[i].channel->_priority)
+    {
+      auto first = sh.channelReads.begin();
+      std::rotate(first + std::ptrdiff_t(priorityCount), first + std::ptrdiff_t(i), first + std::ptrdiff_t(i + 1));
+      ++priorityCount;
+    }
+  }
+
+  // Important to take the metadata snapshot after beginRead,
+  // otherwise the following race becomes possible:
+  //  - Consumer takes the snapshot of _sources
+  //  - Producer1 adds a new elem (ES123) to sources
+  //  - Producer2 finds that ES123 is already added
+  //  - Producer2 adds a new event using ES123
+  //  - Consumer reads the event added by Producer2
+  // This would result in a corrupt stream, as the event source
+  // must precede every event referencing it. If the snapshot is taken
+  // after beginRead, every source referenced by the read data is part of it.
+  snapshotMetadata(sh, false, false);
+}
+
+inline void Session::selectPolledChannels(Shard& sh, bool pollAll)
+{
+  // poll the channels active in the previous consume again
+  sh.pollSlots.insert(sh.pollSlots.end(), sh.pollNext.begin(), sh.pollNext.end());
+  sh.pollNext.clear();
+
+  // visit the set bits of the ready bitmap, clear the bits of this shard
+  for (std::size_t w = 0; w < sh.readyWords.size(); ++w)
+  {
+    std::atomic<std::uint64_t>& word = *sh.readyWords[w];
+    std::uint64_t bits = word.load(detail::memoryOrderAcquire);
+    if (bits == 0) { continue; }
+
+    std::uint64_t ownBits = 0;
+    for (std::size_t bit = 0; bits != 0; ++bit, bits >>= 1)
+    {
+      const std::size_t slot = w * 64 + bit;
+      if ((bits & 1) && slot < sh.channels.size() && sh.channels[slot])
+      {
+        ownBits |= std::uint64_t{1} << bit;
+        sh.channels[slot]->_ready.store(false, std::memory_order_relaxed);
+        sh.channels[slot]->_notifies = true;
+        sh.pollSlots.push_back(slot);
+        sh.pollNext.push_back(slot);
+      }
+    }
+
+    // seq_cst: the cleared _ready flags are visible before the queues are read
+    if (ownBits != 0) { word.fetch_and(~ownBits); }
+  }
+
+  // poll the channels never notified every time, drop the ones notified since
+  std::size_t silentCount = 0;
+  for (const std::size_t slot : sh.silentSlots)
+  {
+    if (sh.channels[slot]->_notifies) { continue; }
+    sh.silentSlots[silentCount++] = slot;
+    sh.pollSlots.push_back(slot);
+  }
+  sh.silentSlots.resize(silentCount);
+
+  if (pollAll)
+  {
+    sh.pollSlots.insert(sh.pollSlots.end(), sh.liveSlots.begin(), sh.liveSlots.end());
+  }
+}
+
+inline void Session::abortFlightRecorderReads(Shard& sh) noexcept
+{
+  for (const std::size_t slot : sh.liveSlots)
+  {
+    Channel& ch = *sh.channels[slot];
+    if (ch._flightRecorder)
+    {
+      ch._dumpHistory = false;
+      ch.isReading.store(false, detail::memoryOrderRelease);
+    }
+  }
+}
+
+inline void Session::archiveFlightRecorders(Shard& sh)
+{
+  for (const std::size_t slot : sh.liveSlots)
+  {
+    const std::shared_ptr<Channel>& channelptr = sh.channels[slot];
+    if (! channelptr->_flightRecorder || channelptr.use_count() == 1) { continue; } // closed, removed by beginReads
+
+    // compress full segments: half of the queue, the writer keeps writing the other half
+    if (detail::QueueReader(channelptr->queue()).beginRead().size() < channelptr->queue().capacity / 2) { continue; }
+
+    // stop the writer discarding entries, see beginReads
+    channelptr->isReading.store(true);
+    while (channelptr->isOverwriting.load()) { std::this_thread::yield(); }
+
+    try
+    {
+      archiveFlightRecorder(sh, *channelptr);
+    }
+    catch (...)
+    {
+      channelptr->isReading.store(false, detail::memoryOrderRelease);
+      throw;
+    }
+
+    channelptr->isReading.store(false, detail::memoryOrderRelease);
+  }
+}
+
+inline void Session::archiveFlightRecorder(Shard& sh, Channel& ch)
+{
+  detail::QueueReader reader(ch.queue());
+  const detail::QueueReader::ReadResult data = reader.beginRead();
+  const std::uint64_t droppedEventCount = takeDroppedEvents(sh, ch);
+  if (data.size() == 0 && droppedEventCount == 0) { return; }
+
+  // frame the segment as consume would, to be written as is when triggered
+  detail::VectorOutputStream& segment = sh.historySegment;
+  segment.clear();
+  const bool hasDeferredEvents = ch.hasDeferredEvents.load(std::memory_order_relaxed);
+  consumeWriterProp(ch, hasDeferredEvents ? expandedSize(data) : data.size(), segment);
+  if (hasDeferredEvents)
+  {
+    const auto write = [&segment](const char* buffer, std::size_t size)
+    {
+      segment.write(buffer, std::streamsize(size));
+    };
+    detail::expandDeferredEvents(data.buffer1, data.buffer1 + data.size1, write);
+    if (data.size2) { detail::expandDeferredEvents(data.buffer2, data.buffer2 + data.size2, write); }
+  }
+  else
+  {
+    segment.write(data.buffer1, std::streamsize(data.size1));
+    if (data.size2) { segment.write(data.buffer2, std::streamsize(data.size2)); }
+  }
+  if (droppedEventCount) { consumeSpecialEntry(sh, DroppedEvents{droppedEventCount}, segment); }
+
+  const FlightRecorderHistory& history = *sh.flightRecorderHistory;
+  std::vector<char> compressed;
+  try
+  {
+    history.compress(segment.data(), std::size_t(segment.ssize()), compressed);
+  }
+  catch (...)
+  {
+    // not archived, report them again
+    ch.droppedEventCount.fetch_add(droppedEventCount, std::memory_order_relaxed);
+    throw;
+  }
+
+  // segments compressed by a different codec are discarded, see setFlightRecorderHistory
+  if (ch._historyCodec != sh.flightRecorderHistory)
+  {
+    ch._history.clear();
+    ch._historySize = 0;
+    ch._historyCodec = sh.flightRecorderHistory;
+  }
+
+  ch._historySize += compressed.size();
+  ch._history.push_back(std::move(compressed));
+  while (ch._historySize > history.maxBytes)
+  {
+    ch._historySize -= ch._history.front().size();
+    ch._history.pop_front();
+  }
+
+  if (data.size() && ch.hasTaskContexts.load(std::memory_order_relaxed)) { takeTaskContext(ch, data); }
+  reader.endRead(data.size());
+}
+
+template <typename OutputStream>
+std::size_t Session::writeHistory(Channel& ch, OutputStream& out)
+{
+  ch._historyBuffer.clear();
+  for (const std::vector<char>& segment : ch._history)
+  {
+    ch._historyCodec->decompress(segment.data(), segment.size(), ch._historyBuffer);
+  }
+
+  // the buffer remains valid until finishRead, see GatherStream
+  if (! ch._historyBuffer.empty())
+  {
+    out.write(ch._historyBuffer.data(), std::streamsize(ch._historyBuffer.size()));
+  }
+  return ch._historyBuffer.size();
+}
+
+inline void Session::removeClosedChannels(Shard& sh)
+{
+  // the slots of the removed channels can be reused
+  if (sh.removedSlots.empty()) { return; }
+
+  std::lock_guard<detail::Mutex> lock(_mutex);
+  _freeReadySlots.insert(_freeReadySlots.end(), sh.removedSlots.begin(), sh.removedSlots.end());
+  sh.removedSlots.clear();
+}
+
+template <typename OutputStream>
+void Session::consumeData(Shard& shard, OutputStream& out, ConsumeResult& result, std::false_type)
+{
+  writeData(shard, out, result, true);
+}
+
+template <typename OutputStream>
+void Session::consumeData(Shard& shard, OutputStream& out, ConsumeResult& result, std::true_type)
+{
+  GatherStream gather(shard);
+  writeData(shard, gather, result, false);
+  gather.resolve();
+
+  if (! shard.gatherBuffers.empty())
+  {
+    out.writev(shard.gatherBuffers.data(), shard.gatherBuffers.size());
+  }
+
+  // the written data is no longer referenced, release it
+  for (std::size_t i = 0; i < shard.channelReads.size(); ++i)
+  {
+    finishRead(shard, i, result);
+  }
+}
+
+template <typename OutputStream>
+void Session::writeData(Shard& shard, OutputStream& out, ConsumeResult& result, bool finishReads)
+{
+  // consume clock sync (if changed) and event sources before events
+  if (shard.metadataBuffer.ssize() != 0)
+  {
+    out.write(shard.metadataBuffer.data(), shard.metadataBuffer.ssize());
+    result.bytesConsumed += std::size_t(shard.metadataBuffer.ssize());
+  }
+
+  // consume some events
+  for (std::size_t i = 0; i < shard.channelReads.size(); ++i)
+  {
+    const ChannelRead& read = shard.channelReads[i];
+    Channel& ch = *read.channel;
+
+    if (shard.prefetchBytes != 0 && i + 1 < shard.channelReads.size())
+    {
+      const detail::QueueReader::ReadResult& next = shard.channelReads[i + 1].data;
+      detail::prefetchRange(next.buffer1, (std::min)(next.size1, shard.prefetchBytes));
+    }
+
+    const detail::QueueReader::ReadResult& data = read.data;
+    const std::uint64_t droppedEventCount = takeDroppedEvents(shard, ch);
+
+    // the history of a triggered flight recorder precedes the data of its queue
+    if (ch._dumpHistory) { result.bytesConsumed += writeHistory(ch, out); }
+
+    // set before the data is committed, made visible by beginRead
+    const bool hasDeferredEvents = ch.hasDeferredEvents.load(std::memory_order_relaxed);
+
+    if (data.size() || droppedEventCount)
+    {
+      // consume writerProp entry
+      const std::size_t batchSize = hasDeferredEvents ? expandedSize(data) : data.size();
+      result.bytesConsumed += consumeWriterProp(ch, batchSize, out);
+    }
+
+    if (data.size() && hasDeferredEvents)
+    {
+      // consume queue data, replace deferred arguments with the referenced buffers
+      const auto write = [&out, &result](const char* buffer, std::size_t size)
+      {
+        out.write(buffer, std::streamsize(size));
+        result.bytesConsumed += size;
+      };
+      detail::expandDeferredEvents(data.buffer1, data.buffer1 + data.size1, write);
+      if (data.size2)
+      {
+        detail::expandDeferredEvents(data.buffer2, data.buffer2 + data.size2, write);
+      }
+    }
+    else if (data.size())
+    {
+      // consume queue data
+      out.write(data.buffer1, std::streamsize(data.size1));
+      if (data.size2)
+      {
+        // data wraps around the end of the queue, consume the second half as well
+        out.write(data.buffer2, std::streamsize(data.size2));
+      }
 
-inline Session::Channel::~Channel()
-{
-  // clear magic number - do not recover invalid data
-  std::uint64_t magic = 0;
-  memcpy(_queue.get(), &magic, sizeof(magic));
+      result.bytesConsumed += data.size();
+    }
 
-  // destroy queue
-  queue().~Queue();
+    if (data.size() && ch.hasTaskContexts.load(std::memory_order_relaxed))
+    {
+      // the WriterProp of the next batch, already written
+      takeTaskContext(ch, data);
+    }
+
+    if (droppedEventCount)
+    {
+      result.bytesConsumed += consumeSpecialEntry(shard, DroppedEvents{droppedEventCount}, out);
+    }
+
+    if (finishReads) { finishRead(shard, i, result); }
+
+    result.channelsPolled++;
+  }
 }
 
-inline detail::Queue& Session::Channel::queue()
+inline void Session::checkShrink(const Shard& sh, Channel& ch, std::size_t readSize)
 {
-  return *reinterpret_cast<detail::Queue*>(_queue.get() + sizeof(std::uint64_t) + sizeof(Session*));
+  if (readSize >= ch.queue().capacity / (std::max)(sh.shrinkPolicy.usageDivisor, std::size_t{1}))
+  {
+    ch._lastBusyConsume = sh.consumeCount;
+  }
+  else if (sh.consumeCount - ch._lastBusyConsume >= sh.shrinkPolicy.idleConsumeCount)
+  {
+    // the writer clears it, if the queue is already at its initial size
+    ch._lastBusyConsume = sh.consumeCount;
+    if (! ch.shrinkRequested.load(std::memory_order_relaxed))
+    {
+      ch.shrinkRequested.store(true, std::memory_order_relaxed);
+    }
+  }
 }
 
-inline Session::Session()
+inline detail::QueueReader::ReadResult Session::beginMpscRead(Channel& ch, std::size_t maxSize, bool atLeastOne)
 {
-  const ClockSync clockSync = systemClockSync();
-  serializeSizePrefixedTagged(clockSync, _clockSync);
+  ch._mpscReadBuffer.clear();
+  ch._mpscReadEnd = ch._mpscQueue->beginRead(ch._mpscReadBuffer, maxSize, atLeastOne);
+  return detail::QueueReader::ReadResult{ch._mpscReadBuffer.data(), ch._mpscReadBuffer.size(), nullptr, 0};
 }
 
-inline std::shared_ptr<Session::Channel> Session::createChannel(std::size_t queueCapacity, WriterProp writerProp)
+inline detail::QueueReader::ReadResult Session::limitRead(const detail::QueueReader::ReadResult& data, std::size_t maxSize, bool atLeastOne)
 {
-  std::lock_guard<std::mutex> lock(_mutex);
+  // entries do not span the two parts
+  const std::size_t size1 = entriesPrefix(data.buffer1, data.size1, maxSize, atLeastOne);
+  if (size1 < data.size1 || data.size2 == 0)
+  {
+    return detail::QueueReader::ReadResult{data.buffer1, size1, nullptr, 0};
+  }
 
-  _channels.push_back(std::make_shared<Channel>(*this, queueCapacity, std::move(writerProp)));
-  return _channels.back();
+  const std::size_t size2 = entriesPrefix(data.buffer2, data.size2, maxSize - size1, atLeastOne && size1 == 0);
+  return detail::QueueReader::ReadResult{data.buffer1, size1, (size2 != 0) ? data.buffer2 : nullptr, size2};
 }
 
-inline void Session::setChannelWriterId(Channel& channel, std::uint64_t id)
+inline std::size_t Session::entriesPrefix(const char* buffer, std::size_t size, std::size_t maxSize, bool atLeastOne)
 {
-  std::lock_guard<std::mutex> lock(_mutex);
+  std::size_t pos = 0;
+  while (pos < size)
+  {
+    std::uint32_t entrySize = 0;
+    memcpy(&entrySize, buffer + pos, sizeof(entrySize));
+    const std::size_t next = pos + sizeof(entrySize) + entrySize;
+    if (next > maxSize && ! (atLeastOne && pos == 0)) { break; }
+    pos = next;
+  }
+  return pos;
+}
 
-  channel.writerProp.id = id;
+inline void Session::finishRead(Shard& shard, std::size_t i, ConsumeResult& result)
+{
+  ChannelRead& read = shard.channelReads[i];
+  Channel& ch = *read.channel;
+  if (read.data.size())
+  {
+    ch._highWaterMark = (std::max)(ch._highWaterMark, read.data.size());
+    if (! ch._mpscQueue)
+    {
+      result.maxQueueFill = (std::max)(result.maxQueueFill, double(read.data.size()) / double(ch.queue().capacity));
+    }
+    ch._bytesConsumed += read.data.size();
+    if (ch._mpscQueue) { ch._mpscQueue->endRead(ch._mpscReadEnd); }
+    else { read.reader.endRead(read.data.size()); }
+  }
+
+  if (ch._flightRecorder) { ch.isReading.store(false, detail::memoryOrderRelease); }
+
+  if (ch._dumpHistory)
+  {
+    ch._dumpHistory = false;
+    ch._history.clear();
+    ch._historySize = 0;
+    std::vector<char>().swap(ch._historyBuffer);
+  }
+
+  if (read.isClosed)
+  {
+    // queue is empty and closed, remove it, the slot is released by removeClosedChannels
+    const std::size_t slot = ch._readySlot;
+    ch._readyWord->fetch_and(~ch._readyMask, std::memory_order_relaxed);
+    shard.removedSlots.push_back(slot);
+    if (! ch._notifies && ! ch._flightRecorder)
+    {
+      shard.silentSlots.erase(std::find(shard.silentSlots.begin(), shard.silentSlots.end(), slot));
+    }
+
+    // swap with the last live slot, to remove it in constant time
+    const std::size_t lastSlot = shard.liveSlots.back();
+    shard.liveSlots[ch._liveIndex] = lastSlot;
+    shard.channels[lastSlot]->_liveIndex = ch._liveIndex;
+    shard.liveSlots.pop_back();
+
+    shard.channels[slot].reset();
+    result.channelsRemoved++;
+  }
 }
 
-inline void Session::setChannelWriterName(Channel& channel, std::string name)
+inline std::uint64_t Session::takeDroppedEvents(Shard& shard, Channel& ch)
+{
+  const std::uint64_t result = (ch.droppedEventCount.load(std::memory_order_relaxed) != 0)
+    ? ch.droppedEventCount.exchange(0, std::memory_order_relaxed)
+    : 0;
+  ch._droppedEvents += result;
+  shard.droppedEventCount += result;
+  return result;
+}
+
+inline void Session::countConsume(Shard& shard, std::chrono::steady_clock::time_point start, std::size_t bytes)
 {
-  std::lock_guard<std::mutex> lock(_mutex);
+  const auto duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+  ++shard.consumeDurations[histogramBucket(std::uint64_t(duration.count()))];
+  ++shard.consumeBytes[histogramBucket(bytes)];
+}
 
-  channel.writerProp.name = std::move(name);
+inline std::size_t Session::histogramBucket(std::uint64_t value)
+{
+  std::size_t result = 0;
+  for (; value != 0 && result + 1 < Metrics::histogramSize; value >>= 1) { ++result; }
+  return result;
 }
 
-inline std::uint64_t Session::addEventSource(EventSource eventSource)
+inline void Session::setTelemetry(std::uint64_t consumeInterval, std::uint64_t (*clock)())
 {
-  std::lock_guard<std::mutex> lock(_mutex);
+  std::uint64_t channelSourceId = 0;
+  std::uint64_t shardSourceId = 0;
+  {
+    std::lock_guard<detail::Mutex> lock(_mutex);
+    channelSourceId = _telemetry.channelSourceId;
+    shardSourceId = _telemetry.shardSourceId;
+  }
+
+  if (consumeInterval != 0 && channelSourceId == 0)
+  {
+    channelSourceId = addEventSource(EventSource{
+      0, Severity::info, "binlog", "telemetry", __FILE__, __LINE__,
+      "writer={} {} capacity={} highWaterMark={} bytesConsumed={} droppedEvents={} replacements={}",
+      argumentTags<std::uint64_t, std::string, std::uint64_t, std::uint64_t, std::uint64_t, std::uint64_t, std::uint64_t>()
+    });
+
+    shardSourceId = addEventSource(EventSource{
+      0, Severity::info, "binlog", "telemetry", __FILE__, __LINE__,
+      "consumeCount={} totalBytesConsumed={} droppedEvents={} maxLagNs={}",
+      argumentTags<std::uint64_t, std::uint64_t, std::uint64_t, std::uint64_t>()
+    });
+  }
 
-  eventSource.id = _nextSourceId;
-  serializeSizePrefixedTagged(eventSource, _sources);
-  return _nextSourceId++;
+  std::lock_guard<detail::Mutex> lock(_mutex);
+  _telemetry = Telemetry{consumeInterval, clock, channelSourceId, shardSourceId};
 }
 
-inline Severity Session::minSeverity() const
+inline void Session::measureLag(Shard& shard, const detail::QueueReader::ReadResult& data)
 {
-  return _minSeverity.load(std::memory_order_acquire);
+  // the first entry is the oldest one, if it is an event: size, source id, clock
+  constexpr std::size_t headerSize = sizeof(std::uint32_t) + 2 * sizeof(std::uint64_t);
+  if (data.size1 < headerSize) { return; }
+
+  std::uint64_t tag = 0;
+  std::uint64_t clock = 0;
+  memcpy(&tag, data.buffer1 + sizeof(std::uint32_t), sizeof(tag));
+  memcpy(&clock, data.buffer1 + sizeof(std::uint32_t) + sizeof(tag), sizeof(clock));
+  if ((tag >> 63) != 0) { return; } // special entry
+
+  const std::uint64_t now = shard.telemetry.clock();
+  if (now > clock) { shard.maxLag = (std::max)(shard.maxLag, now - clock); }
 }
 
-inline void Session::setMinSeverity(Severity severity)
+template <typename OutputStream>
+void Session::consumeTelemetry(Shard& shard, OutputStream& out, ConsumeResult& result)
 {
-  _minSeverity.store(severity, std::memory_order_release);
+  const Telemetry& telemetry = shard.telemetry;
+  if (telemetry.consumeInterval == 0 || shard.consumeCount % telemetry.consumeInterval != 0) { return; }
+
+  detail::VectorOutputStream& buffer = shard.telemetryBuffer;
+  buffer.clear();
+  const std::uint64_t clock = telemetry.clock();
+
+  const auto writeEvent = [&buffer, clock](std::uint64_t sourceId, const auto&... args)
+  {
+    std::size_t size = sizeof(sourceId) + sizeof(clock);
+    (void)std::initializer_list<int>{(size += mserialize::serialized_size(args), 0)...};
+    mserialize::serialize(std::uint32_t(size), buffer);
+    mserialize::serialize(sourceId, buffer);
+    mserialize::serialize(clock, buffer);
+    (void)std::initializer_list<int>{(mserialize::serialize(args, buffer), 0)...};
+  };
+
+  for (const std::size_t slot : shard.liveSlots)
+  {
+    Channel& ch = *shard.channels[slot];
+    writeEvent(telemetry.channelSourceId,
+      ch._consumedWriterProp.id, ch._consumedWriterProp.name, std::uint64_t(ch.queue().capacity),
+      std::uint64_t(ch._highWaterMark), ch._bytesConsumed, ch._droppedEvents,
+      ch.replacementCount.load(std::memory_order_relaxed)
+    );
+  }
+
+  const std::uint64_t maxLagNs = (shard.clockFrequency != 0)
+    ? std::uint64_t(double(shard.maxLag) * 1e9 / double(shard.clockFrequency))
+    : shard.maxLag;
+  writeEvent(telemetry.shardSourceId,
+    shard.consumeCount, std::uint64_t(_totalConsumedBytes.load() + result.bytesConsumed),
+    shard.droppedEventCount, maxLagNs
+  );
+  shard.maxLag = 0;
+
+  const WriterProp writerProp{0, "binlog", std::uint64_t(buffer.ssize())};
+  result.bytesConsumed += serializeSizePrefixedTagged(writerProp, out);
+  out.write(buffer.data(), buffer.ssize());
+  result.bytesConsumed += std::size_t(buffer.ssize());
 }
 
-inline void Session::setClockSync(const ClockSync& clockSync)
+inline Session::Metrics Session::metrics()
+{
+  Metrics result;
+
+  // do not lock the shards while holding _mutex, see consume
+  std::vector<Shard*> shards;
+  {
+    std::lock_guard<detail::Mutex> lock(_mutex);
+    for (Shard& sh : _shards) { shards.push_back(&sh); }
+  }
+  result.totalBytesConsumed = _totalConsumedBytes.load();
+
+  for (Shard* sh : shards)
+  {
+    std::lock_guard<detail::Mutex> shardLock(sh->mutex);
+    result.consumeCount += sh->consumeCount;
+    result.droppedEventCount += sh->droppedEventCount;
+    for (std::size_t b = 0; b < Metrics::histogramSize; ++b)
+    {
+      result.consumeDurations[b] += sh->consumeDurations[b];
+      result.consumeBytes[b] += sh->consumeBytes[b];
+    }
+
+    for (const std::size_t slot : sh->liveSlots)
+    {
+      Channel& ch = *sh->channels[slot];
+      Metrics::ChannelMetrics cm;
+      cm.writerProp = ch._consumedWriterProp;
+      cm.capacity = ch.queue().capacity;
+      cm.highWaterMark = ch._highWaterMark;
+      cm.bytesConsumed = ch._bytesConsumed;
+      cm.droppedEventCount = ch._droppedEvents;
+      cm.replacementCount = ch.replacementCount.load(std::memory_order_relaxed);
+      result.channels.push_back(std::move(cm));
+    }
+  }
+
+  return result;
+}
+
+inline Session::MemoryUsage Session::memoryUsage()
 {
-  std::lock_guard<std::mutex> lock(_mutex);
+  MemoryUsage result;
+
+  const auto channelBytes = [&result](Channel& ch)
+  {
+    ++result.channelCount;
+    result.channelBytes += sizeof(Channel) + Channel::allocationSize(ch.queue().capacity);
+    result.writerPropBytes += ch.writerProp.name.capacity();
+  };
+
+  // do not lock the shards while holding _mutex, see consume
+  std::vector<Shard*> shards;
+  {
+    std::lock_guard<detail::Mutex> lock(_mutex);
+    for (Shard& sh : _shards) { shards.push_back(&sh); }
+    for (const std::shared_ptr<Channel>& ch : _newChannels) { channelBytes(*ch); }
 
-  serializeSizePrefixedTagged(clockSync, _clockSync);
-  _consumeClockSync = true;
+    result.sourceBytes = _sources.size()
+      + _sourceSeverities.size() * sizeof(decltype(_sourceSeverities)::value_type);
+    for (const auto& entry : _internedStrings)
+    {
+      result.internedStringBytes += sizeof(entry) + entry.first.capacity();
+    }
+  }
+
+  for (Shard* sh : shards)
+  {
+    std::lock_guard<detail::Mutex> shardLock(sh->mutex);
+    result.consumerBytes += sh->metadataBuffer.vector.capacity()
+      + sh->specialEntryBuffer.vector.capacity()
+      + sh->telemetryBuffer.vector.capacity()
+      + sh->channels.capacity() * sizeof(std::shared_ptr<Channel>)
+      + sh->channelReads.capacity() * sizeof(ChannelRead)
+      + sh->gatherBuffers.capacity() * sizeof(ConstBuffer)
+      + sh->historySegment.vector.capacity();
+
+    std::lock_guard<detail::Mutex> lock(_mutex); // guards Channel::writerProp
+    for (const std::size_t slot : sh->liveSlots)
+    {
+      Channel& ch = *sh->channels[slot];
+      channelBytes(ch);
+      result.writerPropBytes += ch._consumedWriterProp.name.capacity() + ch._consumedWriterProp.context.capacity()
+        + ch._writerPropEntry.vector.capacity();
+      result.consumerBytes += ch._mpscReadBuffer.capacity() + ch._historySize;
+    }
+  }
+
+  return result;
 }
 
 template <typename OutputStream>
-Session::ConsumeResult Session::consume(OutputStream& out)
+Session::ConsumeResult Session::reconsumeMetadata(OutputStream& out)
 {
-  // This lock:
-  //  - Ensures only a single consumer is running at a time
-  //  - Ensures safe read of _channels
-  //  - Ensures safe read of Channel::writerProp (written by setChannelWriterName)
-  //  - Ensures safe read of _sources
-  //  - Ensures no new EventSource can be added to _sources while consuming
-  //
-  // Without this lock, the following becomes possible:
-  //  - Consumer starts, consumes _sources
-  //  - Producer1 adds a new elem (ES123) to sources
-  //  - Producer2 finds that ES123 is already added
-  //  - Producer2 adds a new event using ES123
-  //  - Consumer continues, consumes the event added by Producer2
-  // This would result in a corrupt stream, as the event source
-  // must precede every event referencing it. This is solved by the lock
-  // that blocks P1 *and* P2 while adding ES123.
-  std::lock_guard<std::mutex> lock(_mutex);
+  return reconsumeMetadata(out, 0, 1);
+}
+
+template <typename OutputStream>
+Session::ConsumeResult Session::reconsumeMetadata(OutputStream& out, std::size_t shardIndex, std::size_t shardCount)
+{
+  Shard& sh = shard(shardIndex, shardCount);
+  std::lock_guard<detail::Mutex> shardLock(sh.mutex);
 
   ConsumeResult result;
 
-  // add a clock sync if not yet added
-  if (_consumeClockSync)
+  // add clock sync and consumed sources
+  snapshotMetadata(sh, true, true);
+  out.write(sh.metadataBuffer.data(), sh.metadataBuffer.ssize());
+  result.bytesConsumed += std::size_t(sh.metadataBuffer.ssize());
+
+  result.totalBytesConsumed = _totalConsumedBytes.fetch_add(result.bytesConsumed) + result.bytesConsumed;
+  return result;
+}
+
+template <typename Write>
+void Session::writeUnconsumed(Write&& write) noexcept
+{
+  write(_clockSync.data(), _clockSync.size());
+  _sources.forEachPiece(0, _sources.size(), write);
+
+  const auto writeChannel = [&write](Channel& ch)
+  {
+    if (ch.mpscQueue() != nullptr) { return; }
+
+    detail::QueueReader reader(ch.queue()); // beginRead does not change the queue
+    const detail::QueueReader::ReadResult data = reader.beginRead();
+    if (data.size() == 0) { return; }
+
+    const bool hasDeferredEvents = ch.hasDeferredEvents.load(std::memory_order_relaxed);
+    const std::uint64_t batchSize = hasDeferredEvents ? expandedSize(data) : data.size();
+
+    // WriterProp entry, field by field, as writerProp can not be serialized without allocation:
+    // [size][tag][id][name size][name][batchSize], see Entries.hpp
+    const std::string& name = ch.writerProp.name;
+    const std::uint64_t tag = WriterProp::Tag;
+    const std::uint32_t nameSize = std::uint32_t(name.size());
+    const std::uint32_t size = std::uint32_t(sizeof(tag) + sizeof(ch.writerProp.id) + sizeof(nameSize) + nameSize + sizeof(batchSize));
+    char header[sizeof(size) + sizeof(tag) + sizeof(ch.writerProp.id) + sizeof(nameSize)];
+    memcpy(header, &size, sizeof(size));
+    memcpy(header + sizeof(size), &tag, sizeof(tag));
+    memcpy(header + sizeof(size) + sizeof(tag), &ch.writerProp.id, sizeof(ch.writerProp.id));
+    memcpy(header + sizeof(size) + sizeof(tag) + sizeof(ch.writerProp.id), &nameSize, sizeof(nameSize));
+    write(static_cast<const char*>(header), sizeof(header));
+    write(name.data(), name.size());
+    write(reinterpret_cast<const char*>(&batchSize), sizeof(batchSize)); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+
+    if (hasDeferredEvents)
+    {
+      detail::expandDeferredEvents(data.buffer1, data.buffer1 + data.size1, write);
+      if (data.size2) { detail::expandDeferredEvents(data.buffer2, data.buffer2 + data.size2, write); }
+    }
+    else
+    {
+      write(data.buffer1, data.size1);
+      if (data.size2) { write(data.buffer2, data.size2); }
+    }
+  };
+
+  // channels taken by a consumer, and the ones not yet taken
+  for (Shard& sh : _shards)
+  {
+    for (const std::shared_ptr<Channel>& ch : sh.channels)
+    {
+      if (ch) { writeChannel(*ch); }
+    }
+  }
+  for (const std::shared_ptr<Channel>& ch : _newChannels)
   {
-    out.write(_clockSync.data(), _clockSync.ssize());
-    result.bytesConsumed += std::size_t(_clockSync.ssize());
-    _consumeClockSync = false;
+    writeChannel(*ch);
   }
+}
 
-  // consume event sources before events
-  const std::streamsize sourceWriteSize = _sources.ssize() - _sourcesConsumePos;
-  out.write(_sources.data() + _sourcesConsumePos, sourceWriteSize);
-  _sourcesConsumePos += sourceWriteSize;
-  result.bytesConsumed += std::size_t(sourceWriteSize);
+inline Session::Shard& Session::shard(std::size_t shardIndex, std::size_t shardCount)
+{
+  assert(shardIndex < shardCount);
 
-  // consume some events
-  for (std::shared_ptr<Channel>& channelptr : _channels)
+  std::lock_guard<detail::Mutex> lock(_mutex);
+
+  while (_shards.size() < shardCount)
   {
-    // Important to check if channel is closed before beginRead,
-    // otherwise the following race becomes possible:
-    //  - Consumer finds queue is empty
-    //  - Producer adds data
-    //  - Producer closes the queue
-    //  - Consumer finds queue is closed, removes it -> data loss
-    const bool isClosed = (channelptr.use_count() == 1);
+    _shards.emplace_back();
+  }
 
-    Channel& ch = *channelptr;
+  return _shards[shardIndex];
+}
 
-    detail::QueueReader reader(ch.queue());
-    const detail::QueueReader::ReadResult data = reader.beginRead();
-    if (data.size())
+inline void Session::takeNewChannels(Shard& shard, std::size_t shardIndex, std::size_t shardCount)
+{
+  std::lock_guard<detail::Mutex> lock(_mutex);
+
+  auto it = std::stable_partition(
+    _newChannels.begin(), _newChannels.end(),
+    [shardIndex, shardCount](const std::shared_ptr<Channel>& channelptr)
     {
-      // consume writerProp entry
-      ch.writerProp.batchSize = data.size();
-      result.bytesConsumed += consumeSpecialEntry(ch.writerProp, out);
+      return channelptr->_shardKey % shardCount != shardIndex;
+    }
+  );
 
-      // consume queue data
-      out.write(data.buffer1, std::streamsize(data.size1));
-      if (data.size2)
-      {
-        // data wraps around the end of the queue, consume the second half as well
-        out.write(data.buffer2, std::streamsize(data.size2));
-      }
+  for (auto newIt = it; newIt != _newChannels.end(); ++newIt)
+  {
+    Channel& ch = **newIt;
+    const std::size_t slot = ch._readySlot;
+    if (slot >= shard.channels.size()) { shard.channels.resize(slot + 1); }
+    shard.channels[slot] = std::move(*newIt);
+    ch._liveIndex = shard.liveSlots.size();
+    shard.liveSlots.push_back(slot);
+    ch._lastBusyConsume = shard.consumeCount;
+    shard.pollSlots.push_back(slot); // new channels are polled once, notified or not
+    if (! ch._flightRecorder) { shard.silentSlots.push_back(slot); }
+
+    // snapshotMetadata copies the changed writer props only if the version changes
+    updateConsumedWriterProp(ch);
+  }
+  _newChannels.erase(it, _newChannels.end());
 
-      reader.endRead();
-      result.bytesConsumed += data.size();
-    }
+  if (shard.readyWords.size() != _readyWords.size())
+  {
+    shard.readyWords = _readyWords;
+  }
+
+  shard.shrinkPolicy = _shrinkPolicy;
+  shard.prefetchBytes = _prefetchBytes;
+  if (shard.flightRecorderHistory != _flightRecorderHistory) { shard.flightRecorderHistory = _flightRecorderHistory; }
+  shard.telemetry = _telemetry;
+  shard.clockFrequency = _uncorrectedClockSync.clockFrequency;
+}
 
-    if (isClosed)
+inline void Session::snapshotMetadata(Shard& shard, bool withClockSync, bool allSources)
+{
+  shard.metadataBuffer.clear();
+
+  std::lock_guard<detail::Mutex> lock(_mutex);
+
+  // writer props rarely change, do not visit every channel otherwise
+  if (shard.writerPropVersion != _writerPropVersion)
+  {
+    for (const std::size_t slot : shard.liveSlots)
     {
-      // queue is empty and closed, remove it
-      channelptr.reset();
-      result.channelsRemoved++;
+      Channel& ch = *shard.channels[slot];
+      if (ch._writerPropChanged) { updateConsumedWriterProp(ch); }
     }
+    shard.writerPropVersion = _writerPropVersion;
+  }
 
-    result.channelsPolled++;
+  takeEagerSources();
+
+  if (withClockSync || shard.consumeClockSync)
+  {
+    shard.metadataBuffer.write(_clockSync.data(), _clockSync.ssize());
+    shard.consumeClockSync = false;
   }
 
-  // remove empty and closed channels
-  _channels.erase(
-    std::remove_if(
-      _channels.begin(), _channels.end(),
-      [](const std::shared_ptr<Channel>& channelptr) { return !channelptr; }
-    ),
-    _channels.end()
+  if (allSources)
+  {
+    _sources.copyTo(0, shard.sourcesConsumePos, shard.metadataBuffer);
+  }
+  else
+  {
+    _sources.copyTo(shard.sourcesConsumePos, _sources.size(), shard.metadataBuffer);
+    shard.sourcesConsumePos = _sources.size();
+  }
+}
+
+inline void Session::takeEagerSources()
+{
+  const detail::EagerSourceRegistry& registry = detail::EagerSourceRegistry::instance();
+  if (registry.size() == _eagerSourcesTaken) { return; }
+
+  const std::size_t oldSize = _sources.size();
+  _eagerSourcesTaken = registry.forEach(_eagerSourcesTaken,
+    [this](std::uint64_t id, const StaticEventSource& source, detail::CallSite* site)
+    {
+      addSourcesEntry(id, source);
+      _sourceSeverities[id] = source.severity;
+      if (site != nullptr)
+      {
+        _callSites.insert(site);
+        updateCallSite(*site);
+      }
+    }
   );
+  addSourcesMetadata(oldSize);
+}
+
+inline std::uint64_t Session::assignSourceId(
+  Severity severity, const char* category, const char* function,
+  const char* file, std::uint64_t line, const char* formatString, const char* argumentTags,
+  bool& added
+)
+{
+  added = true;
+  if (! _stableSourceIds) { return _nextSourceId++; }
 
-  _totalConsumedBytes += result.bytesConsumed;
-  result.totalBytesConsumed = _totalConsumedBytes;
+  const std::uint64_t id = detail::stableSourceId(severity, category, function, file, line, formatString, argumentTags);
 
-  return result;
+  std::string content = std::to_string(std::uint64_t(severity));
+  for (const char* field : {category, function, file, formatString, argumentTags})
+  {
+    content += '\0';
+    content += field;
+  }
+  content += '\0';
+  content += std::to_string(line);
+
+  const auto it = _stableSources.find(id);
+  if (it == _stableSources.end())
+  {
+    _stableSources.emplace(id, std::move(content));
+    return id;
+  }
+  if (it->second == content)
+  {
+    added = false;
+    return id;
+  }
+  return _nextSourceId++; // collision
 }
 
-template <typename OutputStream>
-Session::ConsumeResult Session::reconsumeMetadata(OutputStream& out)
+template <typename... Args>
+void Session::addSourcesEntry(const Args&... args)
 {
-  std::lock_guard<std::mutex> lock(_mutex);
+  _sourceEntry.clear();
+  serializeSizePrefixedTagged(args..., _sourceEntry);
+  _sources.write(_sourceEntry.data(), _sourceEntry.ssize());
+}
 
-  ConsumeResult result;
+inline void Session::addSourcesMetadata(std::size_t oldSize)
+{
+  _sources.forEachPiece(oldSize, _sources.size(), [this](const char* data, std::size_t size)
+  {
+    _channelAllocator->addMetadata(this, data, size);
+  });
+}
+
+inline void Session::updateConsumedWriterProp(Channel& ch)
+{
+  ch._consumedWriterProp.id = ch.writerProp.id;
+  ch._consumedWriterProp.name = ch.writerProp.name;
+  ch._writerPropChanged = false;
+  serializeConsumedWriterProp(ch);
+}
+
+inline void Session::serializeConsumedWriterProp(Channel& ch)
+{
+  // serialized once, as the prop rarely changes, but it is consumed with every batch
+  ch._writerPropEntry.clear();
+  serializeSizePrefixedTagged(ch._consumedWriterProp, ch._writerPropEntry);
+  if (! ch._consumedWriterProp.context.empty())
+  {
+    serializeSizePrefixedTagged(WriterContext{ch._consumedWriterProp.context}, ch._writerPropEntry);
+  }
+}
+
+inline void Session::takeTaskContext(Channel& ch, const detail::QueueReader::ReadResult& data)
+{
+  // find the last WriterProp entry, and the last WriterContext entry after it
+  const char* last = nullptr;
+  const char* lastContext = nullptr;
+  bool contextChanged = false;
+  const auto findLast = [&](const char* p, const char* end)
+  {
+    while (p != end)
+    {
+      const std::uint32_t size = detail::readUnaligned<std::uint32_t>(p);
+      const std::uint64_t tag = detail::readUnaligned<std::uint64_t>(p + sizeof(size));
+      if (tag == WriterProp::Tag) { last = p; lastContext = nullptr; contextChanged = true; }
+      else if (tag == WriterContext::Tag) { lastContext = p; contextChanged = true; }
+      p += sizeof(size) + size;
+    }
+  };
+  findLast(data.buffer1, data.buffer1 + data.size1);
+  if (data.size2) { findLast(data.buffer2, data.buffer2 + data.size2); }
 
-  // add clock sync
-  out.write(_clockSync.data(), _clockSync.ssize());
-  result.bytesConsumed += std::size_t(_clockSync.ssize());
+  if (! contextChanged) { return; }
 
-  // add consumed sources
-  out.write(_sources.data(), _sourcesConsumePos);
-  result.bytesConsumed += std::size_t(_sourcesConsumePos);
+  if (last != nullptr)
+  {
+    // [size][tag][id][name size][name][batchSize]
+    const char* p = last + sizeof(std::uint32_t) + sizeof(std::uint64_t);
+    ch._consumedWriterProp.id = detail::readUnaligned<std::uint64_t>(p);
+    p += sizeof(std::uint64_t);
+    const std::uint32_t nameSize = detail::readUnaligned<std::uint32_t>(p);
+    p += sizeof(nameSize);
+    ch._consumedWriterProp.name.assign(p, nameSize);
+  }
 
-  _totalConsumedBytes += result.bytesConsumed;
-  result.totalBytesConsumed = _totalConsumedBytes;
-  return result;
+  if (lastContext != nullptr)
+  {
+    // [size][tag][context size][context]
+    const char* p = lastContext + sizeof(std::uint32_t) + sizeof(std::uint64_t);
+    const std::uint32_t contextSize = detail::readUnaligned<std::uint32_t>(p);
+    ch._consumedWriterProp.context.assign(p + sizeof(contextSize), contextSize);
+  }
+  else
+  {
+    ch._consumedWriterProp.context.clear();
+  }
+
+  serializeConsumedWriterProp(ch);
+}
+
+template <typename OutputStream>
+std::size_t Session::consumeWriterProp(Channel& ch, std::uint64_t batchSize, OutputStream& out)
+{
+  // batchSize is the last field of the WriterProp entry, see Entries.hpp,
+  // the events follow the context entry
+  std::vector<char>& entry = ch._writerPropEntry.vector;
+  const std::size_t propSize = sizeof(std::uint32_t) + detail::readUnaligned<std::uint32_t>(entry.data());
+  batchSize += entry.size() - propSize;
+  memcpy(entry.data() + propSize - sizeof(batchSize), &batchSize, sizeof(batchSize));
+  out.write(entry.data(), std::streamsize(entry.size()));
+  return entry.size();
+}
+
+inline std::size_t Session::consumeWriterProp(Channel& ch, std::uint64_t batchSize, GatherStream& out)
+{
+  const std::size_t size = consumeWriterProp(ch, batchSize, out.shard().specialEntryBuffer);
+  out.addCopied(size);
+  return size;
 }
 
 template <typename Entry, typename OutputStream>
-std::size_t Session::consumeSpecialEntry(const Entry& entry, OutputStream& out)
+std::size_t Session::consumeSpecialEntry(Shard& shard, const Entry& entry, OutputStream& out)
 {
-  // Write entry to `_specialEntryBuffer` first, only then to `out` in one go.
+  // Write entry to `shard.specialEntryBuffer` first, only then to `out` in one go.
   // This makes OutputStream logic simpler (if it parses the stream),
   // as it does not have to deal with partial entries.
   // (serializeSizePrefixedTagged serializes Entry field by field)
   // This is also more efficient if OutputStream does unbuffered I/O.
-  _specialEntryBuffer.clear();
-  const std::size_t size = serializeSizePrefixedTagged(entry, _specialEntryBuffer);
-  out.write(_specialEntryBuffer.data(), _specialEntryBuffer.ssize());
+  shard.specialEntryBuffer.clear();
+  const std::size_t size = serializeSizePrefixedTagged(entry, shard.specialEntryBuffer);
+  out.write(shard.specialEntryBuffer.data(), shard.specialEntryBuffer.ssize());
+  return size;
+}
+
+template <typename Entry>
+std::size_t Session::consumeSpecialEntry(Shard& shard, const Entry& entry, GatherStream& out)
+{
+  // `shard.specialEntryBuffer` holds the copied ranges of `out`, append the entry
+  const std::size_t size = serializeSizePrefixedTagged(entry, shard.specialEntryBuffer);
+  out.addCopied(size);
   return size;
 }
 
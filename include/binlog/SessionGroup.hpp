@@ -0,0 +1,340 @@
+#ifndef BINLOG_SESSION_GROUP_HPP
+#define BINLOG_SESSION_GROUP_HPP
+
+#include <binlog/Entries.hpp>
+#include <binlog/Range.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/detail/Concurrency.hpp>
+#include <binlog/detail/SegmentedMap.hpp>
+#include <binlog/detail/VectorOutputStream.hpp>
+
+#include <mserialize/Visitor.hpp>
+#include <mserialize/deserialize.hpp>
+#include <mserialize/string_view.hpp>
+#include <mserialize/visit.hpp>
+
+#include <algorithm> // max
+#include <cstddef>
+#include <cstdint>
+#include <cstring> // memcpy
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace binlog {
+
+/**
+ * Consumes multiple sessions into a single output stream.
+ *
+ * Components (e.g: shared libraries) might own a session each,
+ * to remain independent from each other. Instead of running a consumer thread
+ * and writing a logfile for each of them, a SessionGroup polls every session
+ * of the group in a single consume call, and writes one stream.
+ *
+ * The event source ids and interned string ids of the sessions overlap:
+ * they are mapped to a common id space of the output, the event entries are
+ * updated accordingly (including the interned strings referenced by the arguments,
+ * see InternedString.hpp and Stacktrace.hpp).
+ * If the sessions use different clocks, the ClockSync of a session is repeated
+ * before its events if the events of another session were written in between.
+ * The sessions remain usable on their own, but should be consumed only by the group.
+ *
+ * Members are thread-safe, but calls are serialized by a mutex.
+ */
+class SessionGroup
+{
+public:
+  /**
+   * Consume `session` by subsequent consume calls, after the sessions added before.
+   *
+   * @pre `session` must outlive *this, and must not be added twice
+   */
+  void add(Session& session);
+
+  /**
+   * Consume each session of the group to `out`, in the order they were added.
+   *
+   * The data of the sessions is collected and mapped first,
+   * then written to `out` by a single write call.
+   *
+   * @requires OutputStream must model the mserialize::OutputStream concept
+   * @returns the sum of the results of the sessions,
+   *          bytesConsumed and totalBytesConsumed are the bytes written to `out` by the group
+   */
+  template <typename OutputStream>
+  Session::ConsumeResult consume(OutputStream& out);
+
+  /**
+   * Move already consumed metadata of each session again to `out`,
+   * using the output ids assigned before, see Session::reconsumeMetadata.
+   */
+  template <typename OutputStream>
+  Session::ConsumeResult reconsumeMetadata(OutputStream& out);
+
+private:
+  /** The output id of an EventSource of a session */
+  struct MappedSource
+  {
+    std::uint64_t id;
+    std::string argumentTuple; // "(argumentTags)", if the arguments might refer to interned strings, empty otherwise
+  };
+
+  struct Member
+  {
+    Session* session;
+    detail::SegmentedMap<MappedSource> sources;  // by session source id
+    detail::SegmentedMap<std::uint64_t> interned; // output id by session interned string id
+    std::string clockSync;       // the last ClockSync entry of the session, size prefixed
+    std::string clockCorrection; // the last ClockCorrection entry of the session, size prefixed
+  };
+
+  /** Records the position of the interned string ids in the arguments of an event */
+  class InternedIdVisitor
+  {
+  public:
+    InternedIdVisitor(const char* base, std::vector<std::size_t>& positions)
+      :_base(base),
+       _positions(positions)
+    {}
+
+    template <typename T>
+    void visit(T) {}
+
+    template <typename T>
+    bool visit(T, Range&) { return false; }
+
+    bool visit(mserialize::Visitor::StructBegin sb, Range& input);
+
+  private:
+    const char* _base;
+    std::vector<std::size_t>& _positions;
+  };
+
+  /** Map the entries of _input, read from `member`, to _output */
+  void mapEntries(Member& member);
+
+  void mapEventSource(Member& member, Range entry);
+  void mapInternedString(Member& member, Range entry);
+  void mapEvent(Member& member, std::uint64_t tag, Range entry);
+
+  /** Write the clock entries of `member` if the last written ones are of another member */
+  void switchClock(const Member& member);
+
+  void write(Range entry) { _output.write(entry.view(entry.size()), std::streamsize(entry.size())); }
+
+  detail::Mutex _mutex; // guards the members below
+
+  std::vector<Member> _members;
+  std::uint64_t _nextSourceId = 1;
+  std::uint64_t _nextInternedId = 1;
+  const Session* _clockOwner = nullptr; // the session of the last written clock entries
+  std::size_t _totalBytesConsumed = 0;
+
+  detail::VectorOutputStream _input;  // the data consumed from a session
+  detail::VectorOutputStream _output; // the mapped data of every session
+  std::vector<std::size_t> _positions; // of interned string ids in an event
+};
+
+inline void SessionGroup::add(Session& session)
+{
+  std::lock_guard<detail::Mutex> lock(_mutex);
+  _members.push_back(Member{&session, {}, {}, {}, {}});
+}
+
+template <typename OutputStream>
+Session::ConsumeResult SessionGroup::consume(OutputStream& out)
+{
+  std::lock_guard<detail::Mutex> lock(_mutex);
+
+  Session::ConsumeResult result;
+  _output.clear();
+  for (Member& member : _members)
+  {
+    _input.clear();
+    const Session::ConsumeResult cr = member.session->consume(_input);
+    result.channelsPolled += cr.channelsPolled;
+    result.channelsRemoved += cr.channelsRemoved;
+    result.maxQueueFill = (std::max)(result.maxQueueFill, cr.maxQueueFill);
+    mapEntries(member);
+  }
+
+  out.write(_output.data(), _output.ssize());
+  result.bytesConsumed = _output.vector.size();
+  _totalBytesConsumed += result.bytesConsumed;
+  result.totalBytesConsumed = _totalBytesConsumed;
+  return result;
+}
+
+template <typename OutputStream>
+Session::ConsumeResult SessionGroup::reconsumeMetadata(OutputStream& out)
+{
+  std::lock_guard<detail::Mutex> lock(_mutex);
+
+  Session::ConsumeResult result;
+  _output.clear();
+  _clockOwner = nullptr; // `out` might be a new file: write the clock sync
+  for (Member& member : _members)
+  {
+    _input.clear();
+    member.session->reconsumeMetadata(_input);
+    mapEntries(member);
+  }
+
+  out.write(_output.data(), _output.ssize());
+  result.bytesConsumed = _output.vector.size();
+  _totalBytesConsumed += result.bytesConsumed;
+  result.totalBytesConsumed = _totalBytesConsumed;
+  return result;
+}
+
+inline void SessionGroup::mapEntries(Member& member)
+{
+  Range input(_input.data(), _input.vector.size());
+  while (! input.empty())
+  {
+    const std::uint32_t size = input.read<std::uint32_t>();
+    const char* entryBegin = input.view(size);
+    const Range entry(entryBegin, size);
+
+    Range payload = entry;
+    const std::uint64_t tag = payload.read<std::uint64_t>();
+    switch (tag)
+    {
+    case EventSource::Tag:
+      mapEventSource(member, entry);
+      break;
+    case InternedString::Tag:
+      mapInternedString(member, entry);
+      break;
+    case ClockSync::Tag:
+      member.clockSync.assign(entryBegin - sizeof(size), sizeof(size) + size);
+      _output.write(member.clockSync.data(), std::streamsize(member.clockSync.size()));
+      _clockOwner = member.session;
+      break;
+    case ClockCorrection::Tag:
+      member.clockCorrection.assign(entryBegin - sizeof(size), sizeof(size) + size);
+      _output.write(member.clockCorrection.data(), std::streamsize(member.clockCorrection.size()));
+      _clockOwner = member.session;
+      break;
+    default:
+      if ((tag & (std::uint64_t(1) << 63)) == 0)
+      {
+        mapEvent(member, tag, entry);
+      }
+      else
+      {
+        // other special entries (e.g: WriterProp) refer to no ids
+        _output.write(reinterpret_cast<const char*>(&size), sizeof(size)); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+        write(entry);
+      }
+    }
+  }
+}
+
+inline void SessionGroup::mapEventSource(Member& member, Range entry)
+{
+  entry.read<std::uint64_t>(); // tag
+  EventSource source;
+  mserialize::deserialize(source, entry);
+
+  // reconsumed metadata keeps the id assigned first
+  const MappedSource* mapped = member.sources.find(source.id);
+  if (mapped == member.sources.end())
+  {
+    const bool refersToInterned =
+         source.argumentTags.find("binlog::InternedStringId") != std::string::npos
+      || source.argumentTags.find("binlog::Stacktrace") != std::string::npos;
+    member.sources.emplace(source.id, MappedSource{_nextSourceId++, refersToInterned ? "(" + source.argumentTags + ")" : std::string()});
+    mapped = member.sources.find(source.id);
+  }
+
+  source.id = mapped->id;
+  serializeSizePrefixedTagged(source, _output);
+}
+
+inline void SessionGroup::mapInternedString(Member& member, Range entry)
+{
+  const char* begin = entry.view(0);
+  entry.read<std::uint64_t>(); // tag
+  const std::uint64_t sessionId = entry.read<std::uint64_t>();
+
+  const std::uint64_t* mapped = member.interned.find(sessionId);
+  if (mapped == member.interned.end())
+  {
+    member.interned.emplace(sessionId, _nextInternedId++);
+    mapped = member.interned.find(sessionId);
+  }
+
+  // [size][tag][id][value]
+  const std::uint32_t size = std::uint32_t(entry.view(0) + entry.size() - begin);
+  _output.write(reinterpret_cast<const char*>(&size), sizeof(size)); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+  _output.write(begin, sizeof(std::uint64_t));
+  _output.write(reinterpret_cast<const char*>(mapped), sizeof(*mapped)); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+  write(entry);
+}
+
+inline void SessionGroup::mapEvent(Member& member, std::uint64_t tag, Range entry)
+{
+  if (_clockOwner != member.session) { switchClock(member); }
+
+  const std::uint32_t size = std::uint32_t(entry.size());
+  _output.write(reinterpret_cast<const char*>(&size), sizeof(size)); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+  const std::size_t begin = _output.vector.size();
+  write(entry);
+
+  const MappedSource* source = member.sources.find(tag);
+  if (source == member.sources.end()) { return; } // let the reader report the unknown source
+
+  // [tag][clock][arguments]
+  char* output = _output.vector.data() + begin;
+  memcpy(output, &source->id, sizeof(source->id));
+  if (source->argumentTuple.empty()) { return; }
+
+  const std::size_t argumentsOffset = 2 * sizeof(std::uint64_t);
+  Range arguments(output + argumentsOffset, size - argumentsOffset);
+  _positions.clear();
+  InternedIdVisitor visitor(output, _positions);
+  mserialize::visit(mserialize::string_view(source->argumentTuple.data(), source->argumentTuple.size()), visitor, arguments);
+
+  for (const std::size_t position : _positions)
+  {
+    std::uint64_t id = 0;
+    memcpy(&id, output + position, sizeof(id));
+    const std::uint64_t* mapped = member.interned.find(id);
+    if (mapped != member.interned.end())
+    {
+      memcpy(output + position, mapped, sizeof(*mapped));
+    }
+  }
+}
+
+inline void SessionGroup::switchClock(const Member& member)
+{
+  _output.write(member.clockCorrection.data(), std::streamsize(member.clockCorrection.size()));
+  _output.write(member.clockSync.data(), std::streamsize(member.clockSync.size()));
+  _clockOwner = member.session;
+}
+
+inline bool SessionGroup::InternedIdVisitor::visit(mserialize::Visitor::StructBegin sb, Range& input)
+{
+  if (sb.name == "binlog::InternedStringId" && sb.tag == "`id'L")
+  {
+    _positions.push_back(std::size_t(input.view(sizeof(std::uint64_t)) - _base));
+    return true;
+  }
+
+  if (sb.name == "binlog::Stacktrace" && sb.tag == "`modules'L`frames'[L")
+  {
+    _positions.push_back(std::size_t(input.view(sizeof(std::uint64_t)) - _base));
+    const std::uint32_t frameCount = input.read<std::uint32_t>();
+    input.view(frameCount * sizeof(std::uint64_t));
+    return true;
+  }
+
+  return false;
+}
+
+} // namespace binlog
+
+#endif // BINLOG_SESSION_GROUP_HPP
@@ -1,15 +1,33 @@
 #ifndef BINLOG_SESSION_WRITER_HPP
 #define BINLOG_SESSION_WRITER_HPP
 
+#include <binlog/DeferredView.hpp>
+#include <binlog/InternedString.hpp>
 #include <binlog/Session.hpp>
+#include <binlog/Stacktrace.hpp>
+#include <binlog/detail/Attributes.hpp>
+#include <binlog/detail/BoundedOutputStream.hpp>
+#include <binlog/detail/DeferredEvent.hpp>
+#include <binlog/detail/InternCache.hpp>
+#include <binlog/detail/ModuleMap.hpp>
+#include <binlog/detail/Probes.hpp>
 #include <binlog/detail/QueueWriter.hpp>
+#include <binlog/detail/SerializationView.hpp>
 
 #include <mserialize/serialize.hpp>
 
 #include <algorithm> // max
+#include <cassert>
 #include <cstddef>
+#include <cstdint>
+#include <cstring> // memcpy
+#include <initializer_list>
+#include <map>
 #include <memory> // shared_ptr
-#include <utility> // move
+#include <string>
+#include <thread> // yield
+#include <type_traits>
+#include <utility> // forward, move
 
 namespace binlog {
 
@@ -24,6 +42,57 @@ namespace binlog {
 class SessionWriter
 {
 public:
+  /** Selects what addEvent does if the queue is full */
+  enum class OverflowPolicy
+  {
+    grow,  /**< Create a new, larger channel (allocates, locks a mutex) */
+    drop,  /**< Drop the new event */
+    spin,  /**< Retry a limited number of times, then drop the new event */
+    block, /**< Retry until the consumer makes enough space */
+  };
+
+  /**
+   * Defers the commit of the events added by a SessionWriter.
+   *
+   * While a Batch is alive, the events added to the writer
+   * are not made available to the consumer one by one,
+   * but together, when the batch is destroyed.
+   * This saves a release store per event.
+   *
+   * If the reserved space of the queue runs out,
+   * the events added so far are committed before the next event
+   * is added, so the batch will be consumed in multiple parts.
+   *
+   * @see SessionWriter::beginBatch
+   */
+  class Batch
+  {
+  public:
+    Batch(const Batch&) = delete;
+    Batch& operator=(const Batch&) = delete;
+
+    Batch(Batch&& rhs) noexcept
+      :_writer(rhs._writer)
+    {
+      rhs._writer = nullptr;
+    }
+
+    Batch& operator=(Batch&&) = delete;
+
+    /** Commit the events added since the batch began */
+    ~Batch()
+    {
+      if (_writer != nullptr) { _writer->endBatch(); }
+    }
+
+  private:
+    friend class SessionWriter;
+
+    explicit Batch(SessionWriter& writer) :_writer(&writer) {}
+
+    SessionWriter* _writer;
+  };
+
   /**
    * Construct a SessionWriter attached to `session`.
    *
@@ -35,15 +104,17 @@ public:
    */
   explicit SessionWriter(Session& session, std::size_t queueCapacity = 1 << 20, std::uint64_t id = {}, std::string name = {});
 
-  /** Marks the underlying channel closed. */
-  ~SessionWriter() = default;
+  /** Marks the underlying channel closed, and notifies the consumer to remove it. */
+  ~SessionWriter();
 
   SessionWriter(const SessionWriter&) = delete;
   SessionWriter& operator=(const SessionWriter&) = delete;
 
   // Moved-from objects can be assigned to or destructed
   SessionWriter(SessionWriter&& rhs) noexcept = default;
-  SessionWriter& operator=(SessionWriter&& rhs) noexcept = default;
+
+  /** Like the destructor, marks the replaced channels closed, then takes the channels of `rhs`. */
+  SessionWriter& operator=(SessionWriter&& rhs) noexcept;
 
   /** @return a reference to the session it is attached to */
   Session& session() { return *_session; }
@@ -80,6 +151,135 @@ public:
    */
   void setName(std::string name);
 
+  /**
+   * Set what addEvent does if the queue is full.
+   *
+   * By default, the writer grows: it creates a new channel
+   * with a larger queue, which requires memory allocation
+   * and locking a mutex of the session.
+   * Other policies never allocate: they either drop
+   * the new event immediately (`drop`), after `spinCount` failed
+   * attempts to find space in the queue (`spin`),
+   * or keep trying until the consumer makes space (`block`).
+   * Events larger than half of the queue are dropped by every policy but `grow`.
+   *
+   * Dropped events are counted, and the count is consumed
+   * as a DroppedEvents entry, see Session::consume.
+   *
+   * @param spinCount number of retries, used by OverflowPolicy::spin only
+   */
+  void setOverflowPolicy(OverflowPolicy policy, std::size_t spinCount = 1024);
+
+  /**
+   * Write events that do not fit into the initial queue to a temporary channel.
+   *
+   * By default, the `grow` policy makes the queue large enough for the largest
+   * event added so far, and the writer keeps the large queue (unless the session
+   * has a shrink policy, see Session::setShrinkPolicy), even if the event was a rare outlier.
+   * If `enabled`, an event larger than half of the initial queue is written to
+   * a new channel, sized for the event, and the next event replaces that channel
+   * with one of the previous capacity again. The events remain in order.
+   * Useful if large events are rare: each of them allocates two channels.
+   * Events of the priority lane (see setPriorityLane) are not affected.
+   */
+  void setSpillOversizedEvents(bool enabled) { _spillOversizedEvents = enabled; }
+
+  /**
+   * Copy arguments of at least `bytes` bytes (e.g: large strings)
+   * to the queue by non-temporal stores, see detail::nonTemporalCopy.
+   *
+   * A plain copy pulls the written queue lines into the cache of the writer,
+   * evicting the working set of the application. Non-temporal stores bypass the cache,
+   * but the consumer then reads the data from memory (see Session::setConsumerPrefetch).
+   * Useful if large payloads are logged from a latency sensitive thread.
+   * Effective on x86-64, ignored elsewhere.
+   *
+   * @param bytes 0 (the default) disables non-temporal copies
+   */
+  void setNonTemporalThreshold(std::size_t bytes);
+
+  /**
+   * Wake the consumer (see Session::setConsumerWakeup),
+   * if less than `freeBytes` remains free in the queue after adding an event.
+   *
+   * The consumer is woken up once per crossing of the watermark,
+   * and also each time the queue is found full by addEvent.
+   * The free space is only checked if the contiguous writable
+   * space known by the writer falls below `freeBytes`, therefore
+   * the watermark costs a single comparison per event otherwise.
+   *
+   * @param freeBytes 0 (the default) disables the watermark
+   */
+  void setWakeupWatermark(std::size_t freeBytes) { _wakeupWatermark = freeBytes; }
+
+  /**
+   * Turn the writer into a flight recorder, or back to a normal writer.
+   *
+   * A flight recorder keeps the most recent events in its queue:
+   * if the queue is full, the oldest events are discarded to make space
+   * for the new one, instead of applying the overflow policy.
+   * The queue is consumed by Session::consume only if the flight recorder
+   * is triggered, see Session::triggerFlightRecorder, therefore
+   * events can be added at every severity, without I/O cost.
+   * While the consumer reads the queue, events that do not fit are dropped.
+   *
+   * Adding an event with severity >= `triggerSeverity` triggers the flight recorder,
+   * and wakes the consumer, see Session::setConsumerWakeup.
+   * The first event of each event source looks up the severity
+   * from the session, locking a mutex.
+   * Events of a flight recorder are not consumed if the writer is destroyed
+   * before the next trigger.
+   *
+   * Replaces the underlying channel with a channel of the same capacity:
+   * the events added before this call are consumed as before.
+   *
+   * @param triggerSeverity Severity::no_logs disables the severity trigger
+   */
+  void setFlightRecorder(bool enabled, Severity triggerSeverity = Severity::error);
+
+  /**
+   * Add events with severity >= `minSeverity` to a separate, priority channel.
+   *
+   * The priority channel has a queue of `queueCapacity` bytes,
+   * and it is consumed before the other channels by each consume call:
+   * a flood of low severity events can not delay or drop
+   * the high severity ones. The events of the two channels
+   * are consumed out of order, readers can sort them by clock.
+   * Priority events are committed immediately, even in a batch,
+   * and they are not added to the queue of a flight recorder.
+   * Events added by addTaskEvent are not prioritized.
+   *
+   * The first event of each event source looks up the severity
+   * from the session, locking a mutex.
+   *
+   * @param queueCapacity 0 disables the priority lane
+   */
+  void setPriorityLane(std::size_t queueCapacity, Severity minSeverity = Severity::error);
+
+  /**
+   * Set the context of the following events, e.g: the id of the trace
+   * or session they belong to, to correlate them when read.
+   *
+   * Instead of being added to each event as an argument,
+   * the context is added to the queue as a WriterContext entry,
+   * only if it changes, and readers attribute it to the following events
+   * (see the %c placeholder of PrettyPrinter). The consumer repeats it
+   * after the WriterProp entry of each batch, therefore a batch
+   * can be read without the earlier ones (see Session::consume).
+   *
+   * An empty `context` clears it. Events added by addTaskEvent
+   * and priority events (see setPriorityLane) have no context.
+   * In a flight recorder, the entry can be overwritten with the oldest events,
+   * the events following it are then read without the context.
+   *
+   * @returns true on success, false if there's not enough space in the queue:
+   *          the context is not changed.
+   */
+  bool setContext(std::string context) noexcept;
+
+  /** @returns the context set by setContext */
+  const std::string& context() const { return _writerContext; }
+
   /**
    * Add a log event to the queue of the underlying channel.
    *
@@ -87,6 +287,12 @@ public:
    * then allocates memory in the queue, then
    * serializes the event, and finally commits the write.
    *
+   * If every argument is serialized trivially (e.g: arithmetic types and enums),
+   * the size is known at compile time, and the event is
+   * copied to the queue in one step.
+   * If an argument is a DeferredView, only its address is added to the queue,
+   * the referenced buffer is copied by Session::consume.
+   *
    * As size is computed separately from serialization,
    * some getters of serializable types (e.g: which return a string)
    * will be called twice. It is important to always
@@ -94,8 +300,8 @@ public:
    * otherwise undefined behaviour might be invoked.
    *
    * If the queue is full (it has not enough space for the event),
-   * a new channel is created, suitable to hold this event,
-   * and the old one is closed.
+   * by default, a new channel is created, suitable to hold this event,
+   * and the old one is closed. See setOverflowPolicy.
    *
    * @pre `eventSourceId` must be the id of an event source added to `session()`,
    *      see Session::addEventSource.
@@ -107,41 +313,436 @@ public:
    *        mserialize tag of `Args` must match `argumentTags` of the event source.
    *
    * @returns true on success, false if there's not enough space in the queue
-   *          and failed to create a new channel.
+   *          and the event was dropped (see setOverflowPolicy).
    */
   template <typename... Args>
   bool addEvent(std::uint64_t eventSourceId, std::uint64_t clock, Args&&... args) noexcept;
 
+  /**
+   * Add a log event on behalf of a task, e.g: a coroutine migrating between threads.
+   *
+   * Like addEvent, but the event is attributed to `context`:
+   * it is shown with the id and name of `context` when pretty printed,
+   * instead of the id and name of this writer.
+   * Tasks can use the writer of the thread they currently run on
+   * (e.g: default_thread_local_writer()), there is no need
+   * to create a writer or a channel for each task.
+   *
+   * If the context of the previous event differs, a WriterProp entry
+   * is added to the queue first: the stream of a task can be reconstructed
+   * by the readers, by filtering on the writer id.
+   * The following addEvent call switches back to the props of this writer.
+   *
+   * @see TaskWriter
+   */
+  template <typename... Args>
+  bool addTaskEvent(const WriterProp& context, std::uint64_t eventSourceId, std::uint64_t clock, Args&&... args) noexcept;
+
+  /**
+   * Begin a batch of events, committed together.
+   *
+   * Events added to *this (e.g: by log macros) while the
+   * returned Batch is alive are made visible to `Session::consume`
+   * at once, when the batch is destroyed.
+   * Tries to reserve `estimatedSize` bytes in the queue,
+   * to make room for the events of the batch.
+   * If the batch does not fit, it is committed in multiple parts.
+   * Batches can be nested, the outermost one commits.
+   *
+   * Usage:
+   *
+   *     {
+   *       auto batch = writer.beginBatch(levels.size() * 32);
+   *       for (const Level& level : levels)
+   *       {
+   *         BINLOG_INFO_W(writer, "Price: {} Qty: {}", level.price, level.qty);
+   *       }
+   *     } // events are committed here
+   *
+   * @pre *this is not moved or destroyed while the returned batch is alive
+   */
+  Batch beginBatch(std::size_t estimatedSize = 0) noexcept;
+
 private:
-  bool replaceChannel(std::size_t minQueueCapacity) noexcept;
+  struct DynamicSizeEvent {};
+  struct FixedSizeEvent {};
+  struct DeferredEvent {};
+
+  /** addEvent, without switching the context */
+  template <typename... Args>
+  bool addEventInContext(std::uint64_t eventSourceId, std::uint64_t clock, Args&&... args) noexcept;
+
+  /** @returns what to serialize in place of `arg`, see detail::serialization_view */
+  template <typename T>
+  decltype(auto) argumentView(const T& arg) noexcept { return detail::serialization_view(arg); }
+
+  /**
+   * @returns the id of `arg`, interned by the session, or 0 on error.
+   * The session is consulted only if `arg` is not found in _internCache.
+   */
+  InternedStringId argumentView(const InternedStringRef& arg) noexcept;
+
+  /**
+   * @returns `arg` with the id of the map of the loaded modules, interned by the session.
+   * The map is interned again only if a module was loaded or unloaded since the last call.
+   */
+  StacktraceView argumentView(const Stacktrace& arg) noexcept;
+
+  /**
+   * Add `context` to the queue as a WriterProp entry, with zero batchSize.
+   *
+   * @returns true on success, false if there's not enough space in the queue
+   */
+  bool writeContext(const WriterProp& context) noexcept;
+
+  /**
+   * Add `context` to the queue as a WriterContext entry.
+   *
+   * @returns true on success, false if there's not enough space in the queue
+   */
+  bool writeWriterContext(const std::string& context) noexcept;
+
+  /**
+   * Switch back to the props of this writer after addTaskEvent:
+   * add its WriterProp, and its context, if any, to the queue, in a single write:
+   * a WriterProp without the context would clear the context of the readers.
+   *
+   * @returns true on success, false if there's not enough space in the queue,
+   *          and the events are still added in the context of the task
+   */
+  bool switchToOwnProps() noexcept;
+
+  /** Serialize `context` as a WriterProp entry, to the space reserved by the caller */
+  void serializeContext(const WriterProp& context) noexcept;
+
+  /** Serialize `context` as a WriterContext entry, to the space reserved by the caller */
+  void serializeWriterContext(const std::string& context) noexcept;
+
+  /** @returns the serialized size of the WriterProp entry of `context`, see serializeContext */
+  static std::size_t contextSize(const WriterProp& context) noexcept;
+
+  /** @returns the serialized size of the WriterContext entry of `context`, see serializeWriterContext */
+  static std::size_t writerContextSize(const std::string& context) noexcept;
 
+  /** Selects the implementation of addEvent */
+  template <typename... Args>
+  using EventKind = std::conditional_t<
+    mserialize::detail::conjunction<
+      mserialize::detail::has_trivial_serializer<mserialize::detail::remove_cvref_t<Args>>...
+    >::value,
+    FixedSizeEvent,
+    std::conditional_t<
+      mserialize::detail::conjunction<
+        mserialize::detail::negation<detail::is_deferred_view<mserialize::detail::remove_cvref_t<Args>>>...
+      >::value,
+      DynamicSizeEvent,
+      DeferredEvent
+    >
+  >;
+
+  /** addEvent, if the size of the event depends on the runtime value of the arguments */
+  template <typename... Args>
+  bool addEventImpl(DynamicSizeEvent, std::uint64_t eventSourceId, std::uint64_t clock, Args&&... args) noexcept;
+
+  /**
+   * Serialize the event directly to the free space of the queue,
+   * without computing its size first, see detail::has_expensive_size.
+   *
+   * @returns true on success, false if the event does not fit:
+   * nothing is committed then, the event is to be added the regular way.
+   */
+  template <typename... Args>
+  bool writeInPlace(std::uint64_t eventSourceId, std::uint64_t clock, const Args&... args) noexcept;
+
+  /** addEvent, if the size of the event is known at compile time */
+  template <typename... Args>
+  bool addEventImpl(FixedSizeEvent, std::uint64_t eventSourceId, std::uint64_t clock, Args&&... args) noexcept;
+
+  /** addEvent, if some of the arguments are DeferredView, see detail::deferredEventTag */
+  template <typename... Args>
+  bool addEventImpl(DeferredEvent, std::uint64_t eventSourceId, std::uint64_t clock, Args&&... args) noexcept;
+
+  /** @returns the size of `arg` in the queue */
+  template <typename T>
+  static std::size_t queueSize(const T& arg) { return mserialize::serialized_size(arg); }
+  static std::size_t queueSize(const DeferredView&) { return detail::deferredArgumentSize; }
+
+  /** Serialize `arg` to the queue, see detail::deferredEventTag */
+  template <typename T>
+  void queueSerialize(const T& arg) { mserialize::serialize(arg, _qw); }
+  void queueSerialize(const DeferredView& arg);
+
+  /**
+   * Make sure `totalSize` bytes can be written.
+   *
+   * @returns true on success, false if the event must be dropped
+   */
+  bool reserve(std::size_t totalSize) noexcept;
+
+  /** Commit the written event, or mark it pending, if there's an alive batch */
+  void endWrite() noexcept;
+
+  /** Wake the consumer, if the watermark is crossed, see setWakeupWatermark */
+  void checkWakeup() noexcept;
+
+  /** @returns the sum of `sizes` */
+  static constexpr std::size_t sizeSum(std::initializer_list<std::size_t> sizes);
+
+  /** Commit the events added by a batch, if any */
+  void commitBatch() noexcept;
+
+  void endBatch() noexcept;
+
+  /**
+   * Handle a full queue according to the overflow policy.
+   *
+   * @returns true if `size` bytes can be written, false if the event is dropped.
+   */
+  bool handleOverflow(std::size_t size) noexcept;
+
+  /**
+   * Replace the channel with a new one, with a queue of `queueCapacity` bytes.
+   * Rarely called, kept out of the inlined addEvent.
+   */
+  bool replaceChannel(std::size_t queueCapacity) noexcept;
+
+  /**
+   * Replace the grown channel with one of the initial capacity, see Session::setShrinkPolicy,
+   * or the channel of an oversized event with one of the previous capacity, see setSpillOversizedEvents
+   */
+  void shrink() noexcept;
+
+  /**
+   * Make space for `size` bytes by discarding the oldest events, see setFlightRecorder.
+   *
+   * @returns true if `size` bytes can be written, false if the event must be dropped.
+   */
+  bool overwriteOldest(std::size_t size) noexcept;
+
+  /** Trigger the flight recorder, if the source `eventSourceId` has severity >= _triggerSeverity */
+  void checkTrigger(std::uint64_t eventSourceId) noexcept;
+
+  /**
+   * @returns the severity of the source `eventSourceId`, cached.
+   * @throws std::bad_alloc or std::system_error
+   */
+  Severity sourceSeverity(std::uint64_t eventSourceId);
+
+  /** @returns true if the event of source `eventSourceId` belongs to the priority lane */
+  bool isPriorityEvent(std::uint64_t eventSourceId) noexcept;
+
+  /** addEventImpl, writing the priority channel, as if it was the only one */
+  template <typename Kind, typename... Args>
+  bool addPriorityEvent(Kind kind, std::uint64_t eventSourceId, std::uint64_t clock, Args&&... args) noexcept;
+
+  /** Swap the state of the channel and the priority channel */
+  void swapLanes() noexcept;
+
+  // moved one by one by operator=(SessionWriter&&)
   Session* _session;
   std::shared_ptr<Session::Channel> _channel;
   detail::QueueWriter _qw;
+  std::size_t _initialCapacity;
+  OverflowPolicy _overflowPolicy = OverflowPolicy::grow;
+  std::size_t _spinCount = 0;
+  bool _spillOversizedEvents = false;
+  std::size_t _nonTemporalThreshold = 0; /**< See setNonTemporalThreshold */
+  std::size_t _spillReturnCapacity = 0; /**< If not 0, the channel holds an oversized event, see setSpillOversizedEvents */
+  std::size_t _batchDepth = 0;  /**< Number of alive batches */
+  bool _batchPending = false;   /**< If true, *this has uncommitted events */
+  std::size_t _wakeupWatermark = 0;
+  bool _wakeupSent = false;     /**< If true, the consumer was woken up since the queue crossed the watermark */
+  bool _flightRecorder = false;
+  Severity _triggerSeverity = Severity::no_logs;
+  std::map<std::uint64_t, Severity> _sourceSeverities; /**< Cached for checkTrigger */
+  std::shared_ptr<Session::Channel> _priorityChannel; /**< See setPriorityLane */
+  detail::QueueWriter _priorityQw;
+  bool _priorityWakeupSent = false;
+  Severity _prioritySeverity = Severity::no_logs;
+  const WriterProp* _context = nullptr; /**< The context of the current addTaskEvent call */
+  bool _inContext = false;      /**< If true, the last event was added by addTaskEvent, in the context of `_contextId` */
+  std::uint64_t _contextId = 0;
+  std::string _writerContext;   /**< See setContext */
+  detail::InternCache _internCache; /**< Ids of the strings interned by *this */
+  std::uint64_t _moduleGeneration = 0; /**< detail::moduleGeneration when _moduleMapId was interned */
+  std::uint64_t _moduleMapId = 0;      /**< Id of the interned detail::loadedModules, or 0 */
 };
 
 inline SessionWriter::SessionWriter(Session& session, std::size_t queueCapacity, std::uint64_t id, std::string name)
   :_session(& session),
    _channel(session.createChannel(queueCapacity)),
-   _qw(_channel->queue())
+   _qw(_channel->queue()),
+   _initialCapacity(queueCapacity),
+   _priorityQw(_channel->queue()) // unused until setPriorityLane
 {
+  _channel->notifyConsumer(); // skipped by consume while idle, see Channel::notifyConsumer
   if (id != 0) { setId(id); }
   if (! name.empty()) { setName(std::move(name)); }
 }
 
+inline SessionWriter::~SessionWriter()
+{
+  if (_channel) { _channel->notifyClosing(); } // moved-from objects have no channel
+  if (_priorityChannel) { _priorityChannel->notifyClosing(); }
+}
+
+inline SessionWriter& SessionWriter::operator=(SessionWriter&& rhs) noexcept
+{
+  if (this == &rhs) { return *this; }
+
+  if (_channel) { _channel->notifyClosing(); }
+  if (_priorityChannel) { _priorityChannel->notifyClosing(); }
+
+  _session = rhs._session;
+  _channel = std::move(rhs._channel);
+  _qw = std::move(rhs._qw);
+  _initialCapacity = rhs._initialCapacity;
+  _overflowPolicy = rhs._overflowPolicy;
+  _spinCount = rhs._spinCount;
+  _spillOversizedEvents = rhs._spillOversizedEvents;
+  _nonTemporalThreshold = rhs._nonTemporalThreshold;
+  _spillReturnCapacity = rhs._spillReturnCapacity;
+  _batchDepth = rhs._batchDepth;
+  _batchPending = rhs._batchPending;
+  _wakeupWatermark = rhs._wakeupWatermark;
+  _wakeupSent = rhs._wakeupSent;
+  _flightRecorder = rhs._flightRecorder;
+  _triggerSeverity = rhs._triggerSeverity;
+  _sourceSeverities = std::move(rhs._sourceSeverities);
+  _priorityChannel = std::move(rhs._priorityChannel);
+  _priorityQw = std::move(rhs._priorityQw);
+  _priorityWakeupSent = rhs._priorityWakeupSent;
+  _prioritySeverity = rhs._prioritySeverity;
+  _context = rhs._context;
+  _inContext = rhs._inContext;
+  _contextId = rhs._contextId;
+  _writerContext = std::move(rhs._writerContext);
+  _internCache = std::move(rhs._internCache);
+  _moduleGeneration = rhs._moduleGeneration;
+  _moduleMapId = rhs._moduleMapId;
+  return *this;
+}
+
 inline void SessionWriter::setId(std::uint64_t id)
 {
   _session->setChannelWriterId(*_channel, id);
+  if (_priorityChannel) { _session->setChannelWriterId(*_priorityChannel, id); }
 }
 
 inline void SessionWriter::setName(std::string name)
 {
+  if (_priorityChannel) { _session->setChannelWriterName(*_priorityChannel, name); }
   _session->setChannelWriterName(*_channel, std::move(name));
 }
 
+inline void SessionWriter::setOverflowPolicy(OverflowPolicy policy, std::size_t spinCount)
+{
+  _overflowPolicy = policy;
+  _spinCount = spinCount;
+}
+
+inline void SessionWriter::setNonTemporalThreshold(std::size_t bytes)
+{
+  _nonTemporalThreshold = bytes;
+  _qw.setNonTemporalThreshold(bytes);
+  _priorityQw.setNonTemporalThreshold(bytes);
+}
+
+inline void SessionWriter::setFlightRecorder(bool enabled, Severity triggerSeverity)
+{
+  if (enabled != _flightRecorder)
+  {
+    _channel->notifyClosing();
+    WriterProp wp{_channel->writerProp.id, _channel->writerProp.name, 0}; // avoid racing on the last field
+    _channel = _session->createChannel(_qw.capacity(), std::move(wp), _channel.get(), enabled);
+    if (! enabled) { _channel->notifyConsumer(); }
+    _qw = detail::QueueWriter(_channel->queue());
+    _qw.setNonTemporalThreshold(_nonTemporalThreshold);
+    _flightRecorder = enabled;
+    _inContext = false; // the new channel starts with the props of this writer
+    if (! _writerContext.empty() && ! writeWriterContext(_writerContext)) { _writerContext.clear(); }
+  }
+
+  _triggerSeverity = enabled ? triggerSeverity : Severity::no_logs;
+}
+
+inline void SessionWriter::setPriorityLane(std::size_t queueCapacity, Severity minSeverity)
+{
+  if (_priorityChannel)
+  {
+    _priorityChannel->notifyClosing();
+    _priorityChannel.reset();
+  }
+
+  if (queueCapacity != 0)
+  {
+    WriterProp wp{_channel->writerProp.id, _channel->writerProp.name, 0}; // avoid racing on the last field
+    _priorityChannel = _session->createPriorityChannel(queueCapacity, std::move(wp), _channel.get());
+    _priorityChannel->notifyConsumer();
+    _priorityQw = detail::QueueWriter(_priorityChannel->queue());
+    _priorityQw.setNonTemporalThreshold(_nonTemporalThreshold);
+    _priorityWakeupSent = false;
+  }
+
+  _prioritySeverity = (queueCapacity != 0) ? minSeverity : Severity::no_logs;
+}
+
+inline bool SessionWriter::setContext(std::string context) noexcept
+{
+  // switch back to the props of this writer, then change its context
+  if (_inContext && ! switchToOwnProps()) { return false; }
+
+  if (context == _writerContext) { return true; }
+  if (! writeWriterContext(context)) { return false; }
+  _writerContext = std::move(context);
+  return true;
+}
+
 template <typename... Args>
 bool SessionWriter::addEvent(std::uint64_t eventSourceId, std::uint64_t clock, Args&&... args) noexcept
 {
+  if (_inContext && ! switchToOwnProps()) { return false; }
+
+  return addEventInContext(eventSourceId, clock, std::forward<Args>(args)...);
+}
+
+template <typename... Args>
+bool SessionWriter::addTaskEvent(const WriterProp& context, std::uint64_t eventSourceId, std::uint64_t clock, Args&&... args) noexcept
+{
+  _context = &context;
+  if (! _inContext || _contextId != context.id)
+  {
+    _inContext = false;
+    if (! writeContext(context)) { return false; }
+    _inContext = true;
+    _contextId = context.id;
+  }
+
+  return addEventInContext(eventSourceId, clock, std::forward<Args>(args)...);
+}
+
+template <typename... Args>
+bool SessionWriter::addEventInContext(std::uint64_t eventSourceId, std::uint64_t clock, Args&&... args) noexcept
+{
+  if (_channel->shrinkRequested.load(std::memory_order_relaxed)) { shrink(); }
+
+  // arguments with a serialization view (e.g: const char*) are measured once,
+  // interned strings are replaced by their id
+  const bool result = (_prioritySeverity != Severity::no_logs && ! _inContext && isPriorityEvent(eventSourceId))
+    ? addPriorityEvent(EventKind<Args...>{}, eventSourceId, clock, argumentView(args)...)
+    : addEventImpl(EventKind<Args...>{}, eventSourceId, clock, argumentView(args)...);
+  if (_triggerSeverity != Severity::no_logs) { checkTrigger(eventSourceId); }
+  return result;
+}
+
+template <typename... Args>
+bool SessionWriter::addEventImpl(DynamicSizeEvent, std::uint64_t eventSourceId, std::uint64_t clock, Args&&... args) noexcept
+{
+  using SinglePass = mserialize::detail::negation<mserialize::detail::conjunction<
+    mserialize::detail::negation<detail::has_expensive_size<mserialize::detail::remove_cvref_t<Args>>>...
+  >>;
+  if (SinglePass::value && writeInPlace(eventSourceId, clock, args...)) { return true; }
+
   // compute size (excludes size field)
   std::size_t size = 0;
   const std::size_t sizes[] = {sizeof(eventSourceId), sizeof(clock), mserialize::serialized_size(args)...};
@@ -149,12 +750,7 @@ bool SessionWriter::addEvent(std::uint64_t eventSourceId, std::uint64_t clock, A
 
   // allocate space (totalSize includes size field)
   const std::size_t totalSize = size + sizeof(std::uint32_t);
-  if (! _qw.beginWrite(totalSize))
-  {
-    // not enough space in queue, create a new channel
-    replaceChannel(totalSize);
-    if (! _qw.beginWrite(totalSize)) { return false; }
-  }
+  if (! reserve(totalSize)) { return false; }
 
   // serialize fields
   using swallow = int[];
@@ -165,28 +761,522 @@ bool SessionWriter::addEvent(std::uint64_t eventSourceId, std::uint64_t clock, A
     (mserialize::serialize(args, _qw), int{})...
   };
 
-  _qw.endWrite();
+  endWrite();
+  BINLOG_DETAIL_PROBE2(add_event, eventSourceId, totalSize);
+  return true;
+}
+
+template <typename... Args>
+bool SessionWriter::writeInPlace(std::uint64_t eventSourceId, std::uint64_t clock, const Args&... args) noexcept
+{
+  const std::size_t capacity = _qw.writeCapacity();
+  if (capacity <= sizeof(std::uint32_t)) { return false; }
+
+  // serialize after the size field, backpatch the size if everything fits
+  char* const begin = _qw.writeBegin();
+  detail::BoundedOutputStream out(begin + sizeof(std::uint32_t), capacity - sizeof(std::uint32_t));
+
+  using swallow = int[];
+  (void)swallow{
+    (mserialize::serialize(eventSourceId, out), int{}),
+    (mserialize::serialize(clock, out), int{}),
+    (mserialize::serialize(args, out), int{})...
+  };
+
+  if (out.overflow() || out.size() > std::uint32_t(-1)) { return false; }
+
+  const std::uint32_t size32 = std::uint32_t(out.size());
+  memcpy(begin, &size32, sizeof(size32));
+  _qw.reserveBuffer(sizeof(size32) + out.size());
+
+  endWrite();
+  BINLOG_DETAIL_PROBE2(add_event, eventSourceId, sizeof(size32) + out.size());
+  return true;
+}
+
+template <typename... Args>
+bool SessionWriter::addEventImpl(FixedSizeEvent, std::uint64_t eventSourceId, std::uint64_t clock, Args&&... args) noexcept
+{
+  // size is known at compile time (excludes size field)
+  constexpr std::size_t size = sizeSum({sizeof(eventSourceId), sizeof(clock), sizeof(mserialize::detail::remove_cvref_t<Args>)...});
+  constexpr std::size_t totalSize = size + sizeof(std::uint32_t);
+  static_assert(size <= std::uint32_t(-1), "Event too large");
+
+  if (! reserve(totalSize)) { return false; }
+
+  // build the serialized event on the stack, the compiler can
+  // keep it in registers, then copy to the queue at once
+  char event[totalSize];
+  char* p = event;
+  const std::uint32_t size32 = std::uint32_t(size);
+
+  using swallow = int[];
+  (void)swallow{
+    (memcpy(p, &size32, sizeof(size32)), p += sizeof(size32), int{}),
+    (memcpy(p, &eventSourceId, sizeof(eventSourceId)), p += sizeof(eventSourceId), int{}),
+    (memcpy(p, &clock, sizeof(clock)), p += sizeof(clock), int{}),
+    (memcpy(p, &args, sizeof(args)), p += sizeof(args), int{})...
+  };
+
+  _qw.writeBuffer(event, totalSize);
+
+  endWrite();
+  BINLOG_DETAIL_PROBE2(add_event, eventSourceId, totalSize);
   return true;
 }
 
-inline bool SessionWriter::replaceChannel(std::size_t minQueueCapacity) noexcept
+template <typename... Args>
+bool SessionWriter::addEventImpl(DeferredEvent, std::uint64_t eventSourceId, std::uint64_t clock, Args&&... args) noexcept
+{
+  constexpr std::uint32_t deferredCount = std::uint32_t(sizeSum({std::size_t(detail::is_deferred_view<mserialize::detail::remove_cvref_t<Args>>::value)...}));
+
+  // compute size of the payload and the offsets of the deferred arguments
+  std::uint32_t offsets[deferredCount];
+  std::size_t payloadSize = sizeof(eventSourceId) + sizeof(clock);
+  std::size_t deferredIndex = 0;
+  using swallow = int[];
+  (void)swallow{
+    (
+      detail::is_deferred_view<mserialize::detail::remove_cvref_t<Args>>::value
+        ? (offsets[deferredIndex++] = std::uint32_t(payloadSize), int{})
+        : int{},
+      payloadSize += queueSize(args),
+      int{}
+    )...
+  };
+
+  // allocate space (totalSize includes size field)
+  const std::size_t size = sizeof(detail::deferredEventTag) + sizeof(deferredCount) + sizeof(offsets) + payloadSize;
+  const std::size_t totalSize = size + sizeof(std::uint32_t);
+  if (! reserve(totalSize)) { return false; }
+
+  // serialize fields
+  mserialize::serialize(std::uint32_t(size), _qw);
+  mserialize::serialize(detail::deferredEventTag, _qw);
+  mserialize::serialize(deferredCount, _qw);
+  _qw.writeBuffer(offsets, sizeof(offsets));
+  mserialize::serialize(eventSourceId, _qw);
+  mserialize::serialize(clock, _qw);
+  (void)swallow{(queueSerialize(args), int{})...};
+
+  // make consume look for deferred events, before they can be read
+  _channel->hasDeferredEvents.store(true, std::memory_order_relaxed);
+
+  endWrite();
+  BINLOG_DETAIL_PROBE2(add_event, eventSourceId, totalSize);
+  return true;
+}
+
+inline void SessionWriter::queueSerialize(const DeferredView& arg)
+{
+  const std::uint32_t size32 = std::uint32_t(arg.size());
+  assert(size32 == arg.size() && "sequence size must fit on 32 bits");
+  mserialize::serialize(size32, _qw);
+
+  const std::uint64_t address = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(arg.data()));
+  mserialize::serialize(address, _qw);
+
+  #ifdef NDEBUG
+    const std::uint64_t checksum = 0;
+  #else
+    const std::uint64_t checksum = detail::deferredChecksum(arg.data(), arg.size());
+  #endif
+  mserialize::serialize(checksum, _qw);
+}
+
+inline bool SessionWriter::reserve(std::size_t totalSize) noexcept
 {
-  const std::size_t newCapacity = (std::max)(_qw.capacity(), 2 * minQueueCapacity);
+  if (totalSize <= _qw.writeCapacity()) { return true; }
+
+  // beginWrite might reset the write buffer, losing uncommitted events of a batch
+  commitBatch();
+
+  return _qw.beginWrite(totalSize) || handleOverflow(totalSize);
+}
+
+inline InternedStringId SessionWriter::argumentView(const InternedStringRef& arg) noexcept
+{
+  std::uint64_t id = _internCache.find(arg.data, arg.size);
+  if (id != 0) { return InternedStringId{id}; }
+
+  try
+  {
+    id = _session->addInternedString(std::string(arg.data, arg.size));
+    _internCache.insert(arg.data, arg.size, id);
+  }
+  catch (...) {} // NOLINT(bugprone-empty-catch) addEvent must not throw, log the invalid id 0 instead
+
+  return InternedStringId{id};
+}
+
+inline StacktraceView SessionWriter::argumentView(const Stacktrace& arg) noexcept
+{
+  const std::uint64_t generation = detail::moduleGeneration();
+  if (_moduleMapId == 0 || generation != _moduleGeneration)
+  {
+    try
+    {
+      const std::string modules = detail::loadedModules();
+      _moduleMapId = modules.empty() ? 0 : _session->addInternedString(modules);
+      _moduleGeneration = generation;
+    }
+    catch (...) {} // NOLINT(bugprone-empty-catch) addEvent must not throw, log the frames without modules
+  }
+
+  return StacktraceView{_moduleMapId, &arg};
+}
+
+inline bool SessionWriter::writeContext(const WriterProp& context) noexcept
+{
+  if (! reserve(contextSize(context))) { return false; }
+
+  serializeContext(context);
+
+  // make consume look for the last context of the batch, before it can be read
+  _channel->hasTaskContexts.store(true, std::memory_order_relaxed);
+
+  endWrite();
+  return true;
+}
+
+inline bool SessionWriter::writeWriterContext(const std::string& context) noexcept
+{
+  if (! reserve(writerContextSize(context))) { return false; }
+
+  serializeWriterContext(context);
+
+  // make consume repeat the context in the next batch, see Session::takeTaskContext
+  _channel->hasTaskContexts.store(true, std::memory_order_relaxed);
+
+  endWrite();
+  return true;
+}
+
+inline bool SessionWriter::switchToOwnProps() noexcept
+{
+  // if reserve replaces the channel, the new one starts with the props of this writer
+  _inContext = false;
+  const Session::Channel* channel = _channel.get();
+
+  const std::size_t contextsSize = contextSize(_channel->writerProp)
+    + (_writerContext.empty() ? 0 : writerContextSize(_writerContext));
+  if (! reserve(contextsSize))
+  {
+    _inContext = (_channel.get() == channel);
+    return false;
+  }
+
+  serializeContext(_channel->writerProp);
+  if (! _writerContext.empty()) { serializeWriterContext(_writerContext); }
+
+  // make consume look for the last context of the batch, before it can be read
+  _channel->hasTaskContexts.store(true, std::memory_order_relaxed);
+
+  endWrite();
+  return true;
+}
+
+inline void SessionWriter::serializeContext(const WriterProp& context) noexcept
+{
+  // serialize a WriterProp, without copying the name
+  const std::uint64_t tag = WriterProp::Tag;
+  const std::uint64_t batchSize = 0;
+  mserialize::serialize(std::uint32_t(contextSize(context) - sizeof(std::uint32_t)), _qw);
+  mserialize::serialize(tag, _qw);
+  mserialize::serialize(context.id, _qw);
+  mserialize::serialize(context.name, _qw);
+  mserialize::serialize(batchSize, _qw);
+}
+
+inline void SessionWriter::serializeWriterContext(const std::string& context) noexcept
+{
+  const std::uint64_t tag = WriterContext::Tag;
+  mserialize::serialize(std::uint32_t(writerContextSize(context) - sizeof(std::uint32_t)), _qw);
+  mserialize::serialize(tag, _qw);
+  mserialize::serialize(context, _qw);
+}
+
+inline std::size_t SessionWriter::contextSize(const WriterProp& context) noexcept
+{
+  // [size][tag][id][name][batchSize]
+  return sizeof(std::uint32_t) + sizeof(WriterProp::Tag) + sizeof(context.id)
+    + mserialize::serialized_size(context.name) + sizeof(context.batchSize);
+}
+
+inline std::size_t SessionWriter::writerContextSize(const std::string& context) noexcept
+{
+  // [size][tag][context]
+  return sizeof(std::uint32_t) + sizeof(WriterContext::Tag) + mserialize::serialized_size(context);
+}
+
+inline void SessionWriter::endWrite() noexcept
+{
+  if (_batchDepth == 0)
+  {
+    _qw.endWrite();
+    if (! _flightRecorder) { _channel->notifyConsumer(); }
+    if (_qw.writeCapacity() < _wakeupWatermark) { checkWakeup(); }
+  }
+  else
+  {
+    _batchPending = true;
+  }
+}
+
+constexpr std::size_t SessionWriter::sizeSum(std::initializer_list<std::size_t> sizes)
+{
+  std::size_t result = 0;
+  for (const std::size_t size : sizes) { result += size; }
+  return result;
+}
+
+inline SessionWriter::Batch SessionWriter::beginBatch(std::size_t estimatedSize) noexcept
+{
+  if (_batchDepth++ == 0 && estimatedSize > _qw.writeCapacity())
+  {
+    // no uncommitted events, the write buffer can be reset
+    _qw.beginWrite(estimatedSize);
+  }
+
+  return Batch(*this);
+}
+
+inline void SessionWriter::commitBatch() noexcept
+{
+  if (_batchPending)
+  {
+    _qw.endWrite();
+    _batchPending = false;
+    if (! _flightRecorder) { _channel->notifyConsumer(); }
+    if (_qw.writeCapacity() < _wakeupWatermark) { checkWakeup(); }
+  }
+}
+
+inline void SessionWriter::checkWakeup() noexcept
+{
+  const std::size_t freeBytes = _qw.capacity() - _qw.unreadWriteSize();
+  if (freeBytes >= _wakeupWatermark)
+  {
+    _wakeupSent = false;
+  }
+  else if (! _wakeupSent)
+  {
+    _wakeupSent = true;
+    try
+    {
+      _session->wakeupConsumer();
+    }
+    catch (...) {} // NOLINT(bugprone-empty-catch) locking the mutex can throw, but addEvent is noexcept
+  }
+}
+
+inline void SessionWriter::endBatch() noexcept
+{
+  if (--_batchDepth == 0) { commitBatch(); }
+}
+
+inline bool SessionWriter::handleOverflow(std::size_t size) noexcept
+{
+  // Depending on the position of the read and write indices,
+  // the largest contiguous free space of an empty queue
+  // can be as small as (capacity-1)/2.
+  // Larger events might never fit, do not wait for them.
+  const bool fits = 2 * size < _qw.capacity();
+
+  if (_flightRecorder)
+  {
+    // nothing to consume until triggered: do not wake the consumer
+    if (fits && overwriteOldest(size)) { return true; }
+    _channel->droppedEventCount.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  try
+  {
+    _session->wakeupConsumer();
+  }
+  catch (...) {} // NOLINT(bugprone-empty-catch) see checkWakeup
+
+  switch (_overflowPolicy)
+  {
+  case OverflowPolicy::grow:
+    if (_spillOversizedEvents && 2 * size >= _initialCapacity && ! _channel->isPriority())
+    {
+      // write the event to a temporary channel,
+      // the next event returns to the current capacity, see shrink
+      const std::size_t capacity = _qw.capacity();
+      if (replaceChannel(2 * size))
+      {
+        if (_spillReturnCapacity == 0) { _spillReturnCapacity = capacity; }
+        _channel->shrinkRequested.store(true, std::memory_order_relaxed);
+        if (_qw.beginWrite(size)) { return true; }
+      }
+      break;
+    }
+
+    // not enough space in queue, create a new channel
+    replaceChannel((std::max)(_qw.capacity(), 2 * size));
+    if (_qw.beginWrite(size)) { return true; }
+    break;
+  case OverflowPolicy::drop:
+    break;
+  case OverflowPolicy::spin:
+    for (std::size_t i = 0; fits && i < _spinCount; ++i)
+    {
+      if (_qw.beginWrite(size)) { return true; }
+    }
+    break;
+  case OverflowPolicy::block:
+    while (fits)
+    {
+      if (_qw.beginWrite(size)) { return true; }
+      std::this_thread::yield();
+    }
+    break;
+  }
+
+  _channel->droppedEventCount.fetch_add(1, std::memory_order_relaxed);
+  _channel->notifyConsumer();
+  return false;
+}
+
+inline bool SessionWriter::overwriteOldest(std::size_t size) noexcept
+{
+  // Both flags are seq_cst: either the consumer sees isOverwriting (and waits),
+  // or this side sees isReading (and drops the event), see Session::beginReads
+  Session::Channel& ch = *_channel;
+  ch.isOverwriting.store(true);
+  const bool result = ! ch.isReading.load() && _qw.beginOverwrite(size);
+  ch.isOverwriting.store(false, detail::memoryOrderRelease);
+  return result;
+}
+
+inline Severity SessionWriter::sourceSeverity(std::uint64_t eventSourceId)
+{
+  auto it = _sourceSeverities.find(eventSourceId);
+  if (it == _sourceSeverities.end())
+  {
+    it = _sourceSeverities.emplace(eventSourceId, _session->eventSourceSeverity(eventSourceId)).first;
+  }
+  return it->second;
+}
+
+inline bool SessionWriter::isPriorityEvent(std::uint64_t eventSourceId) noexcept
+{
+  try
+  {
+    const Severity severity = sourceSeverity(eventSourceId);
+    return severity >= _prioritySeverity && severity != Severity::no_logs;
+  }
+  catch (...)
+  {
+    return false; // allocation and locking can throw, but addEvent is noexcept
+  }
+}
+
+template <typename Kind, typename... Args>
+bool SessionWriter::addPriorityEvent(Kind kind, std::uint64_t eventSourceId, std::uint64_t clock, Args&&... args) noexcept
+{
+  // commit the priority event immediately, grow instead of overwriting
+  const std::size_t batchDepth = _batchDepth;
+  const bool batchPending = _batchPending;
+  const bool flightRecorder = _flightRecorder;
+  _batchDepth = 0;
+  _batchPending = false;
+  _flightRecorder = false;
+
+  swapLanes();
+  const bool result = addEventImpl(kind, eventSourceId, clock, std::forward<Args>(args)...);
+  swapLanes();
+
+  _batchDepth = batchDepth;
+  _batchPending = batchPending;
+  _flightRecorder = flightRecorder;
+  return result;
+}
+
+inline void SessionWriter::swapLanes() noexcept
+{
+  std::swap(_channel, _priorityChannel);
+  std::swap(_qw, _priorityQw);
+  std::swap(_wakeupSent, _priorityWakeupSent);
+}
+
+inline void SessionWriter::checkTrigger(std::uint64_t eventSourceId) noexcept
+{
+  try
+  {
+    const Severity severity = sourceSeverity(eventSourceId);
+    if (severity >= _triggerSeverity && severity != Severity::no_logs)
+    {
+      // make the events of a batch available to the dump
+      commitBatch();
+      _session->triggerFlightRecorder();
+      _session->wakeupConsumer();
+    }
+  }
+  catch (...) {} // NOLINT(bugprone-empty-catch) allocation and locking can throw, but addEvent is noexcept
+}
+
+BINLOG_DETAIL_COLD inline void SessionWriter::shrink() noexcept
+{
+  // uncommitted events of a batch would be lost, try again later
+  if (_batchDepth != 0) { return; }
+
+  _channel->shrinkRequested.store(false, std::memory_order_relaxed);
+
+  // after an oversized event, return to the capacity before it, see setSpillOversizedEvents
+  const std::size_t capacity = (_spillReturnCapacity != 0) ? _spillReturnCapacity : _initialCapacity;
+  _spillReturnCapacity = 0;
+
+  if (! _flightRecorder && _qw.capacity() > capacity)
+  {
+    replaceChannel(capacity);
+  }
+}
+
+BINLOG_DETAIL_COLD inline bool SessionWriter::replaceChannel(std::size_t queueCapacity) noexcept
+{
+  const std::size_t oldCapacity = _qw.capacity();
+  static_cast<void>(oldCapacity); // used by the probes only
 
   try
   {
     WriterProp wp{_channel->writerProp.id, _channel->writerProp.name, 0}; // avoid racing on the last field
-    _channel = _session->createChannel(newCapacity, std::move(wp));
+    const std::uint64_t replacementCount = _channel->replacementCount.load(std::memory_order_relaxed) + 1;
+    _channel->notifyClosing();
+    _channel = (_channel->isPriority())
+      ? _session->createPriorityChannel(queueCapacity, std::move(wp), _channel.get())
+      : _session->createChannel(queueCapacity, std::move(wp), _channel.get());
+    _channel->replacementCount.store(replacementCount, std::memory_order_relaxed);
+    _channel->notifyConsumer();
     _qw = detail::QueueWriter(_channel->queue());
+    _qw.setNonTemporalThreshold(_nonTemporalThreshold);
   }
   catch (...)
   {
     // allocation and mutex lock in createChannel can throw,
     // but addEvent is more efficient if noexcept:
     // indicate failure by return value instead.
+    BINLOG_DETAIL_PROBE3(replace_channel, oldCapacity, queueCapacity, 0);
     return false;
   }
 
+  BINLOG_DETAIL_PROBE3(replace_channel, oldCapacity, queueCapacity, 1);
+
+  if (_inContext)
+  {
+    // the new channel starts with the props of this writer,
+    // the event being added belongs to the current context
+    _inContext = false;
+    _inContext = writeContext(*_context);
+  }
+  else if (! _writerContext.empty() && ! _channel->isPriority())
+  {
+    // the new channel starts without the context of this writer
+    if (! writeWriterContext(_writerContext)) { _writerContext.clear(); }
+  }
+
   return true;
 }
 
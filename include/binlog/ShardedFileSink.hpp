@@ -0,0 +1,133 @@
+#ifndef BINLOG_SHARDED_FILE_SINK_HPP
+#define BINLOG_SHARDED_FILE_SINK_HPP
+
+#include <binlog/FileSink.hpp>
+#include <binlog/Session.hpp>
+
+#include <algorithm> // max
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace binlog {
+
+/**
+ * Writes the channels of a session to multiple logfiles, one for each consumer shard.
+ *
+ * Each writer is assigned to one of the shards (round-robin, by the order
+ * of channel creation), and its events are always written to the same file,
+ * see Session::consume(out, shardIndex, shardCount).
+ * Every file gets its own copy of the metadata (clock sync, event sources,
+ * interned strings) it needs: the files can be read, indexed or converted
+ * independently, e.g: by parallel workers, and merged by time using bmerge.
+ *
+ * The file of shard `i` is `shardPath(path, i)`, e.g: logfile-0.blog, logfile-1.blog, ...
+ *
+ * Example:
+ *
+ *    binlog::ShardedFileSink logfiles("logfile.blog", 4);
+ *    logfiles.consume(session); // writes logfile-0.blog ... logfile-3.blog
+ *
+ * Not thread-safe: the shards are consumed by the calling thread,
+ * each file is written by the I/O thread of its FileSink.
+ */
+class ShardedFileSink
+{
+public:
+  /**
+   * Open (create or truncate) the files of `shardCount` shards for writing.
+   *
+   * @throws std::runtime_error if shardCount is 0, or a file can not be opened
+   */
+  ShardedFileSink(const std::string& path, std::size_t shardCount, FileSink::Options options = {});
+
+  /**
+   * Consume each shard of `session` to its file.
+   *
+   * @pre the channels of `session` must not be consumed otherwise
+   * @returns the sum of the results of the shards
+   */
+  Session::ConsumeResult consume(Session& session);
+
+  /** Flush the file of each shard, see FileSink::flush */
+  void flush();
+
+  /** Close the file of each shard, see FileSink::close */
+  void close();
+
+  std::size_t shardCount() const { return _shards.size(); }
+
+  /** @pre shardIndex < shardCount() */
+  FileSink& shard(std::size_t shardIndex) { return *_shards[shardIndex]; }
+
+  /**
+   * @returns the path of the file of shard `shardIndex`:
+   *          `path` with -shardIndex inserted before its extension,
+   *          e.g: logfile.blog -> logfile-3.blog, logfile -> logfile-3
+   */
+  static std::string shardPath(const std::string& path, std::size_t shardIndex);
+
+private:
+  std::vector<std::unique_ptr<FileSink>> _shards;
+  std::size_t _totalBytesConsumed = 0;
+};
+
+inline ShardedFileSink::ShardedFileSink(const std::string& path, std::size_t shardCount, FileSink::Options options)
+{
+  if (shardCount == 0)
+  {
+    throw std::runtime_error("ShardedFileSink requires at least one shard");
+  }
+
+  _shards.reserve(shardCount);
+  for (std::size_t i = 0; i < shardCount; ++i)
+  {
+    _shards.emplace_back(new FileSink(shardPath(path, i), options));
+  }
+}
+
+inline Session::ConsumeResult ShardedFileSink::consume(Session& session)
+{
+  Session::ConsumeResult result;
+  for (std::size_t i = 0; i < _shards.size(); ++i)
+  {
+    const Session::ConsumeResult cr = session.consume(*_shards[i], i, _shards.size());
+    result.bytesConsumed += cr.bytesConsumed;
+    result.channelsPolled += cr.channelsPolled;
+    result.channelsRemoved += cr.channelsRemoved;
+    result.maxQueueFill = (std::max)(result.maxQueueFill, cr.maxQueueFill);
+  }
+
+  _totalBytesConsumed += result.bytesConsumed;
+  result.totalBytesConsumed = _totalBytesConsumed;
+  return result;
+}
+
+inline void ShardedFileSink::flush()
+{
+  for (const std::unique_ptr<FileSink>& shard : _shards) { shard->flush(); }
+}
+
+inline void ShardedFileSink::close()
+{
+  for (const std::unique_ptr<FileSink>& shard : _shards) { shard->close(); }
+}
+
+inline std::string ShardedFileSink::shardPath(const std::string& path, std::size_t shardIndex)
+{
+  const std::size_t slash = path.find_last_of("/\\");
+  const std::size_t dot = path.find_last_of('.');
+  const bool hasExtension = dot != std::string::npos && dot != 0
+    && (slash == std::string::npos || dot > slash + 1);
+  const std::size_t insertAt = hasExtension ? dot : path.size();
+
+  std::string result = path;
+  result.insert(insertAt, "-" + std::to_string(shardIndex));
+  return result;
+}
+
+} // namespace binlog
+
+#endif // BINLOG_SHARDED_FILE_SINK_HPP
@@ -0,0 +1,166 @@
+#ifndef BINLOG_SHARED_MEMORY_STREAM_HPP
+#define BINLOG_SHARED_MEMORY_STREAM_HPP
+
+#include <binlog/ConstBuffer.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <ios> // streamsize
+#include <string>
+
+#ifndef _WIN32 // assume POSIX
+
+namespace binlog {
+
+/**
+ * Models mserialize::OutputStream, writes a named shared memory segment.
+ *
+ * The segment holds a single producer, single consumer byte queue,
+ * drained by an other process (e.g: bconsume) using SharedMemoryInputStream.
+ * This moves the file I/O (and formatting, if the logs are converted to text)
+ * out of the logging process: consuming the session costs a copy only,
+ * no system calls. Data copied to the segment is not lost if the
+ * logging process crashes, the consumer process still drains it.
+ *
+ * Example:
+ *
+ *    binlog::SharedMemoryOutputStream shm("/myapp.binlog", 64 << 20);
+ *    binlog::BackgroundConsumer consumer(session, shm);
+ *
+ *    // in a different process:
+ *    $ bconsume -o logfile.blog /myapp.binlog
+ *
+ * If the segment is full, write blocks until the consumer process makes space.
+ */
+class SharedMemoryOutputStream
+{
+public:
+  /**
+   * Create the shared memory segment `name`,
+   * with a queue of `capacity` bytes.
+   * If a segment with the same name exists, it is replaced.
+   *
+   * @param name name of the segment, see shm_open, e.g: "/myapp.binlog"
+   * @throws std::runtime_error if the segment can not be created
+   */
+  SharedMemoryOutputStream(std::string name, std::size_t capacity);
+
+  /** Mark the segment closed, unmap it. The segment is not removed, see SharedMemoryInputStream */
+  ~SharedMemoryOutputStream();
+
+  SharedMemoryOutputStream(const SharedMemoryOutputStream&) = delete;
+  void operator=(const SharedMemoryOutputStream&) = delete;
+
+  /** Copy [data, data+size) to the segment, wait for free space if needed */
+  SharedMemoryOutputStream& write(const char* data, std::streamsize size);
+
+  /** @returns the name of the segment */
+  const std::string& name() const { return _name; }
+
+  /** @returns the number of bytes the segment can store */
+  std::size_t capacity() const;
+
+private:
+  std::string _name;
+  char* _segment;
+  std::size_t _segmentSize;
+};
+
+/**
+ * Reads the data written by a SharedMemoryOutputStream,
+ * possibly in a different process.
+ *
+ * Example:
+ *
+ *    binlog::SharedMemoryInputStream shm("/myapp.binlog");
+ *    std::ofstream logfile("logfile.blog", std::ofstream::binary);
+ *    while (shm.consume(logfile) != 0 || ! shm.writerClosed())
+ *    {
+ *      // sleep if nothing was consumed
+ *    }
+ *
+ * Only a single reader is allowed at a time per segment.
+ */
+class SharedMemoryInputStream
+{
+public:
+  /**
+   * Open the existing shared memory segment `name`.
+   *
+   * @throws std::runtime_error if the segment does not exist,
+   *         or it is not created by SharedMemoryOutputStream.
+   */
+  explicit SharedMemoryInputStream(std::string name);
+
+  /** Unmap the segment */
+  ~SharedMemoryInputStream();
+
+  SharedMemoryInputStream(const SharedMemoryInputStream&) = delete;
+  void operator=(const SharedMemoryInputStream&) = delete;
+
+  /**
+   * Write the data available in the segment to `out`,
+   * then release the space it occupied.
+   *
+   * The written data is a byte stream: a binlog entry
+   * might be split between two calls.
+   *
+   * @requires OutputStream must model the mserialize::OutputStream concept
+   * @returns the number of bytes written to `out`
+   */
+  template <typename OutputStream>
+  std::size_t consume(OutputStream& out);
+
+  /**
+   * @returns true if the writer of the segment is destroyed,
+   * or the process that created the segment no longer exists.
+   * Data still might be available to consume.
+   */
+  bool writerClosed() const;
+
+  /** @returns the name of the segment */
+  const std::string& name() const { return _name; }
+
+  /**
+   * Remove the name of the segment, see shm_unlink, unless
+   * the name refers to a different segment (i.e: the writer was restarted).
+   * The mapping remains valid.
+   */
+  void unlink();
+
+private:
+  /**
+   * Get the available data, which might wrap around
+   * the end of the queue, therefore it is in two parts.
+   */
+  void beginRead(ConstBuffer& first, ConstBuffer& second);
+
+  /** Release `size` bytes, previously returned by beginRead */
+  void endRead(std::size_t size);
+
+  std::string _name;
+  char* _segment;
+  std::size_t _segmentSize;
+  std::uint64_t _inode;  // identifies the segment, if its name is reused
+};
+
+template <typename OutputStream>
+std::size_t SharedMemoryInputStream::consume(OutputStream& out)
+{
+  ConstBuffer first{nullptr, 0};
+  ConstBuffer second{nullptr, 0};
+  beginRead(first, second);
+
+  if (first.size != 0) { out.write(first.data, std::streamsize(first.size)); }
+  if (second.size != 0) { out.write(second.data, std::streamsize(second.size)); }
+
+  const std::size_t size = first.size + second.size;
+  if (size != 0) { endRead(size); }
+  return size;
+}
+
+} // namespace binlog
+
+#endif // _WIN32
+
+#endif // BINLOG_SHARED_MEMORY_STREAM_HPP
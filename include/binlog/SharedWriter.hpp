@@ -0,0 +1,131 @@
+#ifndef BINLOG_SHARED_WRITER_HPP
+#define BINLOG_SHARED_WRITER_HPP
+
+#include <binlog/Session.hpp>
+#include <binlog/detail/MpscQueue.hpp>
+
+#include <mserialize/serialize.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring> // memcpy
+#include <ios> // streamsize
+#include <memory>
+#include <string>
+#include <utility> // forward
+
+namespace binlog {
+
+/**
+ * Add events to a Session from multiple threads, through a single channel.
+ *
+ * SessionWriter is single threaded: each thread (or task)
+ * needs its own writer, and its own channel.
+ * A SharedWriter can be used by any number of threads concurrently,
+ * without locking, e.g: by tasks migrating between threads,
+ * which are too short lived to create a writer for each.
+ *
+ * The channel is created by Session::createMultiProducerChannel.
+ * The queue of the channel does not grow: if it is full,
+ * the event is dropped, and the number of dropped events
+ * is written to the log.
+ *
+ * The events of the writer are consumed in the order of their reservation,
+ * which might differ from the order of their clock values.
+ * Deferred arguments (see DeferredView) are not supported.
+ */
+class SharedWriter
+{
+public:
+  /**
+   * Construct a SharedWriter attached to `session`.
+   *
+   * @param queueCapacity capacity in bytes of the channel queue
+   * @param id see SessionWriter::setId
+   * @param name see SessionWriter::setName
+   */
+  explicit SharedWriter(Session& session, std::size_t queueCapacity = 1 << 20, std::uint64_t id = {}, std::string name = {});
+
+  /** Marks the underlying channel closed, and notifies the consumer to remove it. */
+  ~SharedWriter();
+
+  SharedWriter(const SharedWriter&) = delete;
+  void operator=(const SharedWriter&) = delete;
+
+  Session& session() { return *_session; }
+
+  /**
+   * Add an event to the channel, thread-safe.
+   *
+   * @see SessionWriter::addEvent
+   * @returns true on success, false if the queue is full
+   */
+  template <typename... Args>
+  bool addEvent(std::uint64_t eventSourceId, std::uint64_t clock, Args&&... args) noexcept;
+
+private:
+  /** Serializes an event to the reserved entry */
+  struct EntryOutputStream
+  {
+    char* pos;
+
+    EntryOutputStream& write(const char* buffer, std::streamsize size)
+    {
+      memcpy(pos, buffer, std::size_t(size));
+      pos += size;
+      return *this;
+    }
+  };
+
+  Session* _session;
+  std::shared_ptr<Session::Channel> _channel;
+  detail::MpscQueue* _queue;
+};
+
+inline SharedWriter::SharedWriter(Session& session, std::size_t queueCapacity, std::uint64_t id, std::string name)
+  :_session(&session),
+   _channel(session.createMultiProducerChannel(queueCapacity, WriterProp{id, std::move(name), 0})),
+   _queue(_channel->mpscQueue())
+{
+  _channel->notifyConsumer(); // skipped by consume while idle, see Session::Channel::notifyConsumer
+}
+
+inline SharedWriter::~SharedWriter()
+{
+  _channel->notifyClosing();
+}
+
+template <typename... Args>
+bool SharedWriter::addEvent(std::uint64_t eventSourceId, std::uint64_t clock, Args&&... args) noexcept
+{
+  // compute size (excludes size field)
+  std::size_t size = 0;
+  const std::size_t sizes[] = {sizeof(eventSourceId), sizeof(clock), mserialize::serialized_size(args)...};
+  for (auto s : sizes) { size += s; }
+
+  char* entry = (size < std::uint32_t(-1)) ? _queue->beginWrite(std::uint32_t(size)) : nullptr;
+  if (entry == nullptr)
+  {
+    _channel->droppedEventCount.fetch_add(1, std::memory_order_relaxed);
+    _channel->notifyConsumer();
+    return false;
+  }
+
+  // serialize fields
+  EntryOutputStream out{entry};
+  using swallow = int[];
+  (void)swallow{
+    (mserialize::serialize(eventSourceId, out), int{}),
+    (mserialize::serialize(clock, out), int{}),
+    (mserialize::serialize(args, out), int{})...
+  };
+
+  _queue->endWrite(entry, std::uint32_t(size));
+  _channel->notifyConsumer();
+  return true;
+}
+
+} // namespace binlog
+
+#endif // BINLOG_SHARED_WRITER_HPP
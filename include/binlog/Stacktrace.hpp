@@ -0,0 +1,160 @@
+#ifndef BINLOG_STACKTRACE_HPP
+#define BINLOG_STACKTRACE_HPP
+
+#include <mserialize/cx_string.hpp>
+#include <mserialize/serialize.hpp>
+#include <mserialize/tag.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__GNUC__) && ! defined(_WIN32)
+  #define BINLOG_DETAIL_HAS_UNWIND
+  #include <unwind.h> // _Unwind_Backtrace
+#endif
+
+namespace binlog {
+
+/**
+ * The return addresses of the call stack, see stacktrace.
+ *
+ * When logged by a SessionWriter, the event also refers to the
+ * map of the loaded modules (their address ranges and paths),
+ * added to the session as an InternedString once per writer,
+ * and again if a module is loaded or unloaded.
+ * bread and PrettyPrinter show each frame as `function+offset (module+offset)`,
+ * reading the symbols from the module files, when printing.
+ * The log must be read on a host where the modules are available.
+ *
+ * Logged by other writers (e.g: SharedWriter),
+ * the frames are shown as plain addresses.
+ */
+struct Stacktrace
+{
+  static constexpr std::size_t maxDepth = 32;
+
+  std::uint32_t size = 0;               // NOLINT number of valid frames
+  std::uint64_t frames[maxDepth] = {};  // NOLINT return addresses, innermost first
+};
+
+/** The serialized form of a Stacktrace: refers to the module map, see SessionWriter::addEvent */
+struct StacktraceView
+{
+  std::uint64_t modules;  // NOLINT id of the InternedString of detail::loadedModules, or 0
+  const Stacktrace* trace; // NOLINT
+};
+
+namespace detail {
+
+#ifdef BINLOG_DETAIL_HAS_UNWIND
+
+struct UnwindState
+{
+  Stacktrace* trace;
+  std::size_t skip;
+};
+
+inline _Unwind_Reason_Code unwindFrame(_Unwind_Context* context, void* data)
+{
+  UnwindState& state = *static_cast<UnwindState*>(data);
+  if (state.skip != 0)
+  {
+    --state.skip;
+    return _URC_NO_REASON;
+  }
+
+  Stacktrace& trace = *state.trace;
+  const std::uint64_t ip = std::uint64_t(_Unwind_GetIP(context));
+  if (ip == 0 || trace.size == Stacktrace::maxDepth) { return _URC_END_OF_STACK; }
+  trace.frames[trace.size++] = ip;
+  return _URC_NO_REASON;
+}
+
+#endif // BINLOG_DETAIL_HAS_UNWIND
+
+} // namespace detail
+
+/**
+ * Capture the return addresses of the current call stack,
+ * at most Stacktrace::maxDepth frames, without symbolizing them.
+ *
+ * Uses _Unwind_Backtrace (reads the unwind tables, does not need frame pointers).
+ * The first call might take longer, as the unwinder finds the tables.
+ * Empty on platforms without <unwind.h>.
+ *
+ * Example:
+ *
+ *    BINLOG_ERROR("Unexpected state: {}, at {}", state, binlog::stacktrace());
+ *
+ * @param skip number of innermost frames to omit (the caller of stacktrace is the first frame)
+ */
+#ifdef BINLOG_DETAIL_HAS_UNWIND
+__attribute__((noinline)) // the frame skipped below must be this function
+#endif
+inline Stacktrace stacktrace(std::size_t skip = 0)
+{
+  Stacktrace result;
+#ifdef BINLOG_DETAIL_HAS_UNWIND
+  detail::UnwindState state{&result, skip + 1}; // skip this function
+  _Unwind_Backtrace(&detail::unwindFrame, &state);
+#else
+  static_cast<void>(skip);
+#endif
+  return result;
+}
+
+} // namespace binlog
+
+namespace mserialize {
+
+template <>
+struct CustomSerializer<binlog::StacktraceView>
+{
+  template <typename OutputStream>
+  static void serialize(const binlog::StacktraceView& s, OutputStream& ostream)
+  {
+    mserialize::serialize(s.modules, ostream);
+    mserialize::serialize(s.trace->size, ostream);
+    for (std::uint32_t i = 0; i < s.trace->size; ++i)
+    {
+      mserialize::serialize(s.trace->frames[i], ostream);
+    }
+  }
+
+  static std::size_t serialized_size(const binlog::StacktraceView& s)
+  {
+    return sizeof(std::uint64_t) + sizeof(std::uint32_t) + s.trace->size * sizeof(std::uint64_t);
+  }
+};
+
+// Logged without a SessionWriter: no module map
+template <>
+struct CustomSerializer<binlog::Stacktrace>
+{
+  template <typename OutputStream>
+  static void serialize(const binlog::Stacktrace& s, OutputStream& ostream)
+  {
+    CustomSerializer<binlog::StacktraceView>::serialize(binlog::StacktraceView{0, &s}, ostream);
+  }
+
+  static std::size_t serialized_size(const binlog::Stacktrace& s)
+  {
+    return CustomSerializer<binlog::StacktraceView>::serialized_size(binlog::StacktraceView{0, &s});
+  }
+};
+
+template <>
+struct CustomTag<binlog::StacktraceView>
+{
+  static constexpr auto tag_string()
+  {
+    return make_cx_string("{binlog::Stacktrace`modules'L`frames'[L}");
+  }
+};
+
+template <>
+struct CustomTag<binlog::Stacktrace> : CustomTag<binlog::StacktraceView> {};
+
+} // namespace mserialize
+
+#endif // BINLOG_STACKTRACE_HPP
@@ -0,0 +1,229 @@
+#ifndef BINLOG_STREAM_RELAY_HPP
+#define BINLOG_STREAM_RELAY_HPP
+
+#include <binlog/Entries.hpp>
+#include <binlog/Range.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/detail/ForEachEntry.hpp> // isSpecialEntryTag
+#include <binlog/detail/SourceIdMap.hpp>
+
+#include <mserialize/deserialize.hpp>
+
+#include <algorithm> // min
+#include <cstddef>
+#include <cstdint>
+#include <cstring> // memcpy
+#include <ios> // streamsize
+#include <string>
+#include <utility> // move
+#include <vector>
+
+namespace binlog {
+namespace detail {
+
+/** Already serialized event arguments, copied to the queue as they are */
+struct RawArguments
+{
+  const char* data;
+  std::size_t size;
+};
+
+} // namespace detail
+
+/**
+ * Inject the binlog stream of an other process (e.g: a worker subprocess)
+ * into a Session, without decoding the events.
+ *
+ * The event sources of the injected stream are added to the session,
+ * with new ids, and the events are added to a writer of the relay,
+ * with the source ids remapped, the clock and the arguments copied
+ * as they are. The writers of the injected stream are kept:
+ * events are attributed to the id and the name of their original writer,
+ * the name prefixed by `writerNamePrefix`, e.g: "worker1/".
+ * The events are consumed by Session::consume, as the events of any other writer,
+ * the parent needs a single logfile.
+ *
+ * Models mserialize::OutputStream: the stream can be written in arbitrary chunks,
+ * e.g: as read from a pipe, incomplete entries are kept until the rest arrives.
+ *
+ * Requirements and limitations:
+ *
+ *  - The producer must use the clock of the session (e.g: binlog::clockNow,
+ *    on the same host), as ClockSync entries of the stream are not injected.
+ *  - The stream must be a plain, uncompressed stream, as written by Session::consume,
+ *    CompactEvents and EventSourceTable entries are skipped.
+ *  - InternedString entries are skipped, interned arguments of
+ *    the injected events are not resolved by the readers.
+ *  - Events of sources not (yet) seen are dropped.
+ *
+ * Usage:
+ *
+ *     binlog::StreamRelay relay(session, "worker1/");
+ *     while ((n = read(pipefd, buffer, sizeof(buffer))) > 0)
+ *     {
+ *       relay.write(buffer, n);
+ *     }
+ *     session.consume(logfile); // events of the parent and the worker
+ *
+ * Not thread safe: each input stream needs its own relay.
+ */
+class StreamRelay
+{
+public:
+  /**
+   * @param queueCapacity the queue capacity of the writer of the relay.
+   *        Events not fitting into the queue are dropped, see droppedEvents.
+   */
+  StreamRelay(Session& session, std::string writerNamePrefix, std::size_t queueCapacity = 1 << 20);
+
+  /**
+   * Inject the entries of [buffer, buffer+size),
+   * and the incomplete entry of the previous write call, if any.
+   * The last entry of the buffer may be incomplete.
+   *
+   * @throws std::runtime_error if `buffer` contains an invalid entry
+   */
+  StreamRelay& write(const char* buffer, std::streamsize size);
+
+  /** @returns the number of events injected so far */
+  std::uint64_t injectedEvents() const { return _injectedEvents; }
+
+  /** @returns the number of events dropped so far: the source is unknown or the queue is full */
+  std::uint64_t droppedEvents() const { return _droppedEvents; }
+
+  /** @returns the number of special entries skipped so far, see the limitations */
+  std::uint64_t skippedEntries() const { return _skippedEntries; }
+
+private:
+  /** Inject the complete entry [size][tag][payload] */
+  void injectEntry(const char* entry, std::uint32_t size);
+
+  Session* _session;
+  SessionWriter _writer;
+  std::string _writerNamePrefix;
+  WriterProp _context; // the writer of the injected events, name prefixed
+
+  detail::SourceIdMap<std::uint64_t> _sourceIds; // session id by injected id, 0 if unknown
+
+  std::vector<char> _partial; // incomplete entry of the previous write
+
+  std::uint64_t _injectedEvents = 0;
+  std::uint64_t _droppedEvents = 0;
+  std::uint64_t _skippedEntries = 0;
+};
+
+inline StreamRelay::StreamRelay(Session& session, std::string writerNamePrefix, std::size_t queueCapacity)
+  :_session(&session),
+   _writer(session, queueCapacity, 0, writerNamePrefix),
+   _writerNamePrefix(std::move(writerNamePrefix))
+{
+  _context.name = _writerNamePrefix;
+}
+
+inline StreamRelay& StreamRelay::write(const char* buffer, std::streamsize size)
+{
+  const char* p = buffer;
+  const char* const end = buffer + size;
+
+  // complete the entry of the previous write first
+  const auto missing = [this]() -> std::size_t
+  {
+    if (_partial.size() < sizeof(std::uint32_t)) { return sizeof(std::uint32_t) - _partial.size(); }
+    std::uint32_t entrySize = 0;
+    memcpy(&entrySize, _partial.data(), sizeof(entrySize));
+    return sizeof(entrySize) + entrySize - _partial.size();
+  };
+
+  while (! _partial.empty() && p != end)
+  {
+    const std::size_t n = (std::min)(missing(), std::size_t(end - p));
+    _partial.insert(_partial.end(), p, p + n);
+    p += n;
+
+    if (missing() == 0)
+    {
+      injectEntry(_partial.data(), std::uint32_t(_partial.size() - sizeof(std::uint32_t)));
+      _partial.clear();
+    }
+  }
+
+  if (! _partial.empty()) { return *this; } // still incomplete, the input is used up
+
+  while (end - p >= std::ptrdiff_t(sizeof(std::uint32_t)))
+  {
+    std::uint32_t entrySize = 0;
+    memcpy(&entrySize, p, sizeof(entrySize));
+    if (std::size_t(end - p) - sizeof(entrySize) < entrySize) { break; }
+
+    injectEntry(p, entrySize);
+    p += sizeof(entrySize) + entrySize;
+  }
+
+  _partial.assign(p, end);
+  return *this;
+}
+
+inline void StreamRelay::injectEntry(const char* entry, std::uint32_t size)
+{
+  Range payload(entry + sizeof(size), size);
+  const std::uint64_t tag = payload.read<std::uint64_t>();
+
+  if (! detail::isSpecialEntryTag(tag))
+  {
+    const std::uint64_t sourceId = _sourceIds.get(tag);
+    const std::uint64_t clock = payload.read<std::uint64_t>();
+    const std::size_t argumentsSize = payload.size();
+    const detail::RawArguments arguments{payload.view(argumentsSize), argumentsSize};
+
+    if (sourceId != 0 && _writer.addTaskEvent(_context, sourceId, clock, arguments))
+    {
+      ++_injectedEvents;
+    }
+    else
+    {
+      ++_droppedEvents;
+    }
+  }
+  else if (tag == EventSource::Tag)
+  {
+    EventSource source;
+    mserialize::deserialize(source, payload);
+    const std::uint64_t id = source.id;
+    _sourceIds.set(id, _session->addEventSource(std::move(source)));
+  }
+  else if (tag == WriterProp::Tag)
+  {
+    WriterProp writerProp;
+    mserialize::deserialize(writerProp, payload);
+    _context.id = writerProp.id;
+    _context.name = _writerNamePrefix + writerProp.name;
+  }
+  else if (tag != ClockSync::Tag && tag != Checkpoint::Tag)
+  {
+    ++_skippedEntries;
+  }
+}
+
+} // namespace binlog
+
+namespace mserialize {
+
+template <>
+struct CustomSerializer<binlog::detail::RawArguments>
+{
+  template <typename OutputStream>
+  static void serialize(const binlog::detail::RawArguments& a, OutputStream& ostream)
+  {
+    ostream.write(a.data, std::streamsize(a.size));
+  }
+
+  static std::size_t serialized_size(const binlog::detail::RawArguments& a)
+  {
+    return a.size;
+  }
+};
+
+} // namespace mserialize
+
+#endif // BINLOG_STREAM_RELAY_HPP
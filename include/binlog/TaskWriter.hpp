@@ -0,0 +1,55 @@
+#ifndef BINLOG_TASK_WRITER_HPP
+#define BINLOG_TASK_WRITER_HPP
+
+#include <binlog/Entries.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+
+#include <cstdint>
+#include <utility> // forward
+
+namespace binlog {
+
+/**
+ * Binds the context of a task (e.g: a coroutine) to a SessionWriter,
+ * to be used with the log macros.
+ *
+ * Events added by a TaskWriter are added to the queue of the underlying
+ * SessionWriter, attributed to `context`, see SessionWriter::addTaskEvent.
+ * Constructing a TaskWriter is free: a task hopping between threads
+ * can bind its context to the writer of the current thread after each resume.
+ *
+ * Usage:
+ *
+ *     const binlog::WriterProp context{taskId, "task-name", 0}; // lives as long as the task
+ *
+ *     // in the task, on any thread:
+ *     binlog::TaskWriter writer(binlog::default_thread_local_writer(), context);
+ *     BINLOG_INFO_W(writer, "Hello from task");
+ */
+class TaskWriter
+{
+public:
+  /** @pre `writer` and `context` must remain valid as long as *this is used */
+  TaskWriter(SessionWriter& writer, const WriterProp& context)
+    :_writer(&writer),
+     _context(&context)
+  {}
+
+  Session& session() { return _writer->session(); }
+
+  /** @see SessionWriter::addTaskEvent */
+  template <typename... Args>
+  bool addEvent(std::uint64_t eventSourceId, std::uint64_t clock, Args&&... args) noexcept
+  {
+    return _writer->addTaskEvent(*_context, eventSourceId, clock, std::forward<Args>(args)...);
+  }
+
+private:
+  SessionWriter* _writer;
+  const WriterProp* _context;
+};
+
+} // namespace binlog
+
+#endif // BINLOG_TASK_WRITER_HPP
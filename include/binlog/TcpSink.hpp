@@ -0,0 +1,142 @@
+#ifndef BINLOG_TCP_SINK_HPP
+#define BINLOG_TCP_SINK_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ios> // streamsize
+#include <string>
+#include <vector>
+
+#ifndef _WIN32 // assume POSIX
+
+namespace binlog {
+
+class Session;
+
+/**
+ * A TcpSink connection starts with a hello, that names the producer:
+ *
+ *    u32 magic              // tcpSinkMagic
+ *    u32 version            // tcpSinkVersion
+ *    u32 nameSize
+ *    char[nameSize]         // name of the producer, e.g: host.pid
+ *
+ * followed by a regular binlog stream, or compressed frames (see compressedFrameMagic).
+ * The stream of each connection starts with the metadata (see Session::reconsumeMetadata),
+ * therefore a receiver can process it independently of the previous connections.
+ */
+constexpr std::uint32_t tcpSinkMagic = 0xC2434C42; // "BLC\xC2"
+constexpr std::uint32_t tcpSinkVersion = 1;
+
+/**
+ * Send entries consumed from a Session to a collector (e.g: bcollect), over TCP,
+ * without writing them to the local disk.
+ *
+ * Models mserialize::OutputStream.
+ * Written bytes are buffered until flush is called,
+ * then sent (optionally compressed to a single frame).
+ * If the connection is lost, it is reestablished by a later flush,
+ * and the new connection starts with the metadata of the session.
+ * Batches not sent are kept, up to Options::maxBufferSize bytes, then dropped.
+ * A batch that was being sent when the connection was lost is resent entirely:
+ * some of its events might be received twice.
+ *
+ * Example:
+ *
+ *    binlog::TcpSink sink(session, "collector.example.com", 7350);
+ *    session.consume(sink);
+ *    sink.flush();
+ *
+ * Sending blocks the consumer, if the collector does not keep up.
+ *
+ * @see tcpSinkMagic for the protocol
+ */
+class TcpSink
+{
+public:
+  struct Options
+  {
+    /** Name of the producer sent to the collector. Empty: hostname.pid */
+    std::string name;
+
+    /** Compress each batch to a frame (requires zlib, see CompressedOutputStream) */
+    bool compress = false;
+
+    /** If not empty, compress with this preset dictionary (see trainCompressionDictionary) */
+    std::string compressionDictionary;
+
+    /** Keep at most this many bytes of batches to resend while disconnected */
+    std::size_t maxBufferSize = std::size_t{64} << 20;
+
+    /** Wait at least this long between connection attempts */
+    std::chrono::milliseconds reconnectInterval{1000};
+  };
+
+  /**
+   * Send to `host`:`port`, connect on the first flush.
+   * `session` must remain valid as long as *this is valid,
+   * and must not be consumed by an other thread concurrently with flush.
+   *
+   * @throws std::runtime_error if compression is requested without zlib
+   */
+  TcpSink(Session& session, std::string host, std::uint16_t port, Options options);
+
+  /** Send to `host`:`port` using default Options */
+  TcpSink(Session& session, std::string host, std::uint16_t port);
+
+  /** Close the connection, without sending the buffered bytes */
+  ~TcpSink();
+
+  TcpSink(const TcpSink&) = delete;
+  void operator=(const TcpSink&) = delete;
+
+  /** Buffer [data, data+size) */
+  TcpSink& write(const char* data, std::streamsize size);
+
+  /**
+   * Send the buffered batches to the collector,
+   * connecting first, if not connected. Errors are not reported,
+   * the batches are kept to be sent later, see Options.
+   */
+  void flush();
+
+  /** @returns true if the last flush left the connection open */
+  bool connected() const { return _fd >= 0; }
+
+  /** @returns the number of connections established so far */
+  std::size_t connectionCount() const { return _connectionCount; }
+
+  /** @returns the number of bytes dropped because the collector was not reachable */
+  std::uint64_t droppedBytes() const { return _droppedBytes; }
+
+private:
+  bool connect();
+
+  void disconnect();
+
+  /** Move the bytes of the current batch to _pending, compressed if requested */
+  void addBatch(const char* data, std::size_t size, bool front);
+
+  /** @returns false on error */
+  bool sendAll(const char* data, std::size_t size);
+
+  Session& _session;
+  std::string _host;
+  std::uint16_t _port;
+  Options _options;
+
+  int _fd = -1;
+  std::chrono::steady_clock::time_point _nextConnect;
+  std::size_t _connectionCount = 0;
+  std::uint64_t _droppedBytes = 0;
+
+  std::vector<char> _batch;   // bytes written since the last flush
+  std::vector<char> _pending; // batches to send
+};
+
+} // namespace binlog
+
+#endif // _WIN32
+
+#endif // BINLOG_TCP_SINK_HPP
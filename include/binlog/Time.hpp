@@ -3,7 +3,9 @@
 
 #include <binlog/Entries.hpp> // ClockSync
 
+#include <atomic>
 #include <chrono>
+#include <cstddef>
 #include <cstdint>
 #include <ctime>
 
@@ -48,6 +50,110 @@ std::chrono::nanoseconds ticksToNanoseconds(std::uint64_t frequency, std::int64_
  */
 std::chrono::nanoseconds clockToNsSinceEpoch(const ClockSync& clockSync, std::uint64_t clockValue);
 
+/**
+ * Converts clock values to nanoseconds since the Unix Epoch,
+ * with the same result as clockToNsSinceEpoch(clockSync, clockValue),
+ * but without dividing by the clock frequency for each value:
+ * the reciprocal of the frequency is computed once, by the constructor,
+ * and the divisions are replaced by a multiplication and a shift.
+ * Clocks of nanosecond frequency (e.g: clockNow) are converted by an addition.
+ *
+ * Used by readers converting many events of the same clock sync,
+ * see EventStream::clockConverter.
+ *
+ * Example:
+ *
+ *    binlog::ClockConverter converter(clockSync);
+ *    const std::chrono::nanoseconds time = converter.toNsSinceEpoch(event.clockValue);
+ */
+class ClockConverter
+{
+public:
+  /** Converts nothing, see valid() */
+  ClockConverter() = default;
+
+  explicit ClockConverter(const ClockSync& clockSync);
+
+  /** @returns true if clockSync.clockFrequency is not zero, the conversion is defined */
+  bool valid() const { return _mode != Mode::invalid; }
+
+  /** @pre valid() */
+  std::chrono::nanoseconds toNsSinceEpoch(std::uint64_t clockValue) const
+  {
+    return std::chrono::nanoseconds{std::int64_t(std::uint64_t(_nsSinceEpoch) + ticksToNs(clockValue - _clockValue))};
+  }
+
+  /**
+   * Convert `count` clock values at `clockValues` to nanoseconds since the Unix Epoch, to `result`.
+   * Clocks of nanosecond frequency are converted by a loop the compiler can vectorize.
+   *
+   * @pre valid()
+   */
+  void toNsSinceEpoch(const std::uint64_t* clockValues, std::size_t count, std::int64_t* result) const;
+
+private:
+  enum class Mode : std::uint8_t
+  {
+    invalid,
+    nanoseconds, // frequency is 1 GHz
+    reciprocal,  // divide by multiplying with _magic
+    division,    // no 128 bit multiplication, or frequency above 9.2 GHz: use ticksToNanoseconds
+  };
+
+  /** @returns the nanoseconds of `ticks`, as int64_t, wrapped */
+  std::uint64_t ticksToNs(std::uint64_t ticks) const;
+
+  /** @returns n / _frequency, @pre _mode == Mode::reciprocal */
+  std::uint64_t divide(std::uint64_t n) const;
+
+  Mode _mode = Mode::invalid;
+  std::uint64_t _clockValue = 0;
+  std::uint64_t _frequency = 0;
+  std::int64_t _nsSinceEpoch = 0;
+
+  // division by invariant integers, see: Granlund, Montgomery:
+  // Division by Invariant Integers using Multiplication, and libdivide
+  std::uint64_t _magic = 0; // if zero, the frequency is a power of two
+  unsigned _shift = 0;
+  bool _add = false;
+};
+
+inline std::uint64_t ClockConverter::divide(std::uint64_t n) const
+{
+#ifdef __SIZEOF_INT128__
+  if (_magic == 0) { return n >> _shift; }
+  __extension__ typedef unsigned __int128 uint128; // NOLINT(modernize-use-using)
+  const std::uint64_t q = std::uint64_t((uint128(_magic) * n) >> 64);
+  return (_add) ? (((n - q) >> 1) + q) >> _shift : q >> _shift;
+#else
+  return n / _frequency;
+#endif
+}
+
+inline std::uint64_t ClockConverter::ticksToNs(std::uint64_t ticks) const
+{
+  switch (_mode)
+  {
+  case Mode::nanoseconds:
+    return ticks;
+  case Mode::reciprocal:
+  {
+    // as ticksToNanoseconds: q * 10^9 + r * 10^9 / f, rounded towards zero, on the magnitude
+    const bool negative = std::int64_t(ticks) < 0;
+    const std::uint64_t magnitude = (negative) ? 0 - ticks : ticks;
+    const std::uint64_t q = divide(magnitude);
+    const std::uint64_t r = magnitude - q * _frequency;
+    const std::uint64_t ns = q * std::nano::den + divide(r * std::nano::den);
+    return (negative) ? 0 - ns : ns;
+  }
+  case Mode::division:
+    return std::uint64_t(ticksToNanoseconds(_frequency, std::int64_t(ticks)).count());
+  case Mode::invalid:
+    break;
+  }
+  return 0;
+}
+
 /**
  * Converts the time point given by `sinceEpoch` to BrokenDownTime,
  * expressed in UTC.
@@ -133,6 +239,61 @@ inline std::uint64_t clockNow()
   #endif
 }
 
+/**
+ * Same as clockNow(), but cheaper and less precise:
+ * on linux, CLOCK_REALTIME_COARSE is read, which is updated
+ * at every timer tick (typically 1-4 ms), and never needs the slow
+ * clock_gettime path (e.g: on virtual machines without vDSO clocksource).
+ * Uses the same ClockSync as clockNow (systemClockSync).
+ * On other platforms, it is clockNow().
+ */
+inline std::uint64_t coarseClockNow()
+{
+  #if defined(__linux__) && defined(CLOCK_REALTIME_COARSE)
+    struct timespec ts{};
+    clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+    const std::chrono::nanoseconds nanos{
+      std::chrono::seconds{ts.tv_sec} + std::chrono::nanoseconds{ts.tv_nsec}
+    };
+    return std::uint64_t(nanos.count());
+  #else
+    return clockNow();
+  #endif
+}
+
+namespace detail {
+
+/** The value of clockNow() at the last updateCachedClock, 0 if none */
+inline std::atomic<std::uint64_t>& cachedClock()
+{
+  static std::atomic<std::uint64_t> value{0};
+  return value;
+}
+
+} // namespace detail
+
+/** Set the value returned by cachedClockNow() to clockNow(). Called by Session::consume. */
+inline void updateCachedClock()
+{
+  detail::cachedClock().store(clockNow(), std::memory_order_relaxed);
+}
+
+/**
+ * @returns the value of clockNow() at the last updateCachedClock(),
+ * or clockNow() if it was not called yet.
+ *
+ * A relaxed atomic load: the cheapest clock, precise only
+ * to the interval of the updates, i.e: to the consume interval
+ * of the session (e.g: BackgroundConsumer). Events are timestamped
+ * by the last consume before them, in the same units as clockNow
+ * (the ClockSync of clockNow applies, events of the two clocks can be mixed).
+ */
+inline std::uint64_t cachedClockNow()
+{
+  const std::uint64_t value = detail::cachedClock().load(std::memory_order_relaxed);
+  return (value != 0) ? value : clockNow();
+}
+
 } // namespace binlog
 
 #endif // BINLOG_TIME_HPP
@@ -0,0 +1,193 @@
+#ifndef BINLOG_TIME_INDEX_HPP
+#define BINLOG_TIME_INDEX_HPP
+
+#include <binlog/Range.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace binlog {
+
+/**
+ * Position of entries in a logfile, to find events of a time range
+ * without reading the complete file.
+ *
+ * The logfile is divided to blocks of complete entries.
+ * For each block, the index stores the smallest and largest
+ * event clock value found in the block (including the events of
+ * CompactEvents entries). For each metadata entry
+ * (EventSource, EventSourceTable, WriterProp, ClockSync, InternedString) the index stores
+ * its position, to allow a reader to replay the
+ * metadata in effect at the beginning of any block.
+ *
+ * The index is a sequence of records. Each record is five u64 values:
+ *
+ *    kind    // magicRecord, blockRecord, metadataRecord or filterRecord
+ *    offset  // position of the block/entry in the logfile
+ *    size    // size of the block/entry in the logfile
+ *    minClock or tag
+ *    maxClock or 0
+ *
+ * The first record is a magic record, with version as offset.
+ * Blocks are in logfile order, and they are contiguous.
+ * Entries after the last block are not indexed.
+ * A block without events has minClock > maxClock.
+ *
+ * Optionally, a block record is preceded by filter records:
+ * a Bloom filter of the integer and string arguments of the events
+ * in the block (see detail::forEachIndexedValue), 256 bits per record,
+ * stored in the four fields after the kind. It allows a reader
+ * to skip the blocks that certainly do not contain a given value.
+ * Readers not aware of filter records ignore them.
+ */
+class TimeIndex
+{
+public:
+  static constexpr std::uint64_t magicRecord = 0x7865646e49544c42; // "BLTIndex"
+  static constexpr std::uint64_t blockRecord = 1;
+  static constexpr std::uint64_t metadataRecord = 2;
+  static constexpr std::uint64_t filterRecord = 3;
+  static constexpr std::uint64_t version = 1;
+
+  struct Block
+  {
+    std::uint64_t offset;
+    std::uint64_t size;
+    std::uint64_t minClock;
+    std::uint64_t maxClock;
+  };
+
+  struct Metadata
+  {
+    std::uint64_t offset;
+    std::uint64_t size; // including the size and tag fields
+    std::uint64_t tag;
+  };
+
+  /**
+   * Read the index records from `input`.
+   *
+   * A trailing incomplete record is ignored,
+   * e.g: if the index is still being written.
+   *
+   * @throws std::runtime_error if `input` is not a valid index
+   */
+  static TimeIndex read(std::istream& input);
+
+  /**
+   * @returns false if the events of blocks[block] certainly
+   *          do not have an argument equal to `value`,
+   *          true if they might have, or if the block has no filter.
+   *
+   * Integer arguments are compared by their decimal representation, e.g: "-42".
+   */
+  bool blockMayContain(std::size_t block, const std::string& value) const;
+
+  /** @returns true if at least one block has a filter */
+  bool hasFilters() const;
+
+  std::vector<Block> blocks;      // NOLINT
+  std::vector<Metadata> metadata; // NOLINT
+  std::vector<std::vector<std::uint64_t>> filters; // NOLINT filter of each block, empty if the block has none
+};
+
+/**
+ * Write entries consumed from a Session to a logfile,
+ * and a TimeIndex of the written entries to an index file.
+ *
+ * Models mserialize::OutputStream.
+ * Entries can be split arbitrarily between write calls.
+ *
+ * Example:
+ *
+ *    std::ofstream logfile("logfile.blog", std::ofstream::out|std::ofstream::binary);
+ *    std::ofstream indexfile("logfile.blog.idx", std::ofstream::out|std::ofstream::binary);
+ *    binlog::IndexedOutputStream output(logfile, indexfile);
+ *    session.consume(output);
+ *
+ * The index of the entries written since the last completed block
+ * is written by the destructor.
+ *
+ * If `filterBits` is not zero, a Bloom filter of the argument values
+ * is written for each block (see TimeIndex). This requires parsing every event,
+ * and keeping the argument tags of every event source.
+ * Blocks with events that can not be parsed (e.g: of an unknown source)
+ * are written without a filter.
+ */
+class IndexedOutputStream
+{
+public:
+  /**
+   * `output` and `index` must remain valid as long as *this is valid.
+   * A block is closed if it gets larger than `blockSize`.
+   *
+   * The index is written relative to the beginning of `output`:
+   * `output` is expected to be empty.
+   *
+   * `filterBits` is the size of the filter of a block,
+   * rounded up to a multiple of 256, 0 to write no filters.
+   */
+  IndexedOutputStream(std::ostream& output, std::ostream& index, std::size_t blockSize = 1 << 20, std::size_t filterBits = 0);
+
+  /** Write the index of the last, incomplete block */
+  ~IndexedOutputStream();
+
+  IndexedOutputStream(const IndexedOutputStream&) = delete;
+  void operator=(const IndexedOutputStream&) = delete;
+
+  /** Write [data, data+size) to the output, and update the index */
+  IndexedOutputStream& write(const char* data, std::streamsize size);
+
+private:
+  /** Called when the header of the current entry is complete */
+  void entryHeader();
+
+  /** Called when the current entry is complete */
+  void entryEnd();
+
+  /**
+   * Read the current entry (_entry): add its argument values to the filter,
+   * the clocks of its events to the clock range of the block, if it is a CompactEvents entry.
+   */
+  void readEntry();
+
+  /** Add the argument values of an event to the filter */
+  void filterEvent(std::uint64_t sourceId, Range arguments);
+
+  /** Write the block ending at `end` to the index, start a new one */
+  void closeBlock(std::uint64_t end);
+
+  void writeRecord(std::uint64_t kind, std::uint64_t offset, std::uint64_t size, std::uint64_t a, std::uint64_t b);
+
+  std::ostream& _output;
+  std::ostream& _index;
+  std::size_t _blockSize;
+
+  std::uint64_t _offset = 0; // bytes written to _output
+  std::uint64_t _blockOffset = 0;
+  std::uint64_t _minClock = std::uint64_t(-1); // of the current block
+  std::uint64_t _maxClock = 0;
+
+  // the entry being written: size, tag and clock
+  char _header[sizeof(std::uint32_t) + 2 * sizeof(std::uint64_t)] = {};
+  std::size_t _headerSize = 0;   // bytes of _header already written
+  std::size_t _headerTarget = 0; // bytes of _header needed, 0 if the size is not yet known
+  std::uint64_t _entryOffset = 0;
+  std::uint64_t _remaining = 0; // bytes of the entry to write after the header
+
+  // filter of the current block, if filterBits is not zero
+  std::vector<std::uint64_t> _filter;
+  bool _filterValid = true; // false if an event of the block could not be added
+  std::unordered_map<std::uint64_t, std::string> _argumentTags; // by source id
+
+  bool _copyEntry = false;   // true if the current entry is copied to _entry
+  std::vector<char> _entry;  // the current entry, without the size
+};
+
+} // namespace binlog
+
+#endif // BINLOG_TIME_INDEX_HPP
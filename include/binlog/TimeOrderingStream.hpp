@@ -0,0 +1,370 @@
+#ifndef BINLOG_TIME_ORDERING_STREAM_HPP
+#define BINLOG_TIME_ORDERING_STREAM_HPP
+
+#include <binlog/Entries.hpp>
+#include <binlog/Range.hpp>
+#include <binlog/detail/ForEachEntry.hpp>
+
+#include <mserialize/deserialize.hpp>
+
+#include <algorithm> // push_heap, pop_heap
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring> // memcpy
+#include <deque>
+#include <ios> // streamsize
+#include <map>
+#include <string>
+#include <utility> // move, pair
+#include <vector>
+
+namespace binlog {
+
+/**
+ * Reorder the events written by Session::consume by their clock value,
+ * across writers, before writing them to `out`.
+ *
+ * Models mserialize::OutputStream.
+ * Session::consume writes the events channel by channel,
+ * therefore events of different writers are not in time order.
+ * This stream buffers the events, and writes them in the order
+ * of their clock value, once they are older than the most recent
+ * event seen by at least `window`. The output is in time order,
+ * if every event is written to this stream within `window`
+ * of the most recent event, e.g: if the window is larger than
+ * the consume interval (plus the time it takes to consume).
+ * Events arriving later are written as soon as possible,
+ * and counted by lateEventCount.
+ *
+ * Events of the same writer are never reordered,
+ * and events with equal clock values are written in input order.
+ *
+ * Writers are identified by their WriterProp entries (id and name).
+ * WriterProp entries are written only before an entry of their writer,
+ * with zero (unknown) batchSize, as the batches are interleaved,
+ * followed by the WriterContext of the writer, if any.
+ * WriterContext entries that repeat the context of the writer are not buffered.
+ * The first ClockSync entry is written immediately,
+ * the later ones are ordered as events, by their clock value.
+ * EventSource and InternedString entries are written immediately,
+ * other special entries (e.g: DroppedEvents) are ordered after
+ * the previous event of their writer.
+ *
+ * The clock ticks of `window` are computed using the frequency
+ * of the most recent ClockSync: ClockSync entries must be
+ * written to the same instance, as Session::consume does.
+ *
+ * Each write must consist of complete entries, as written by Session::consume.
+ *
+ * Example:
+ *
+ *    binlog::TimeOrderingStream<std::ofstream> output(logfile, std::chrono::seconds(1));
+ *    session.consume(output);
+ *    // ...
+ *    output.flush(); // before closing logfile, write the pending events
+ */
+template <typename OutputStream>
+class TimeOrderingStream
+{
+public:
+  /** `out` must remain valid as long as *this is valid */
+  TimeOrderingStream(OutputStream& out, std::chrono::nanoseconds window);
+
+  /**
+   * Buffer the entries of [buffer, buffer+size),
+   * then write the buffered entries older than the window, in time order.
+   *
+   * @throws std::runtime_error if `buffer` contains an invalid entry
+   */
+  TimeOrderingStream& write(const char* buffer, std::streamsize size);
+
+  /** Write every buffered entry, in time order */
+  void flush();
+
+  /** @returns the number of entries of writers written after an entry with greater clock value */
+  std::uint64_t lateEventCount() const { return _lateEventCount; }
+
+  /** @returns the total size of the buffered entries, in bytes */
+  std::size_t bufferedBytes() const { return _bufferedBytes; }
+
+private:
+  struct Item
+  {
+    std::uint64_t clockValue;
+    std::uint64_t sequence; // in the input, orders items of equal clock value
+    std::uint32_t size;     // of the entry
+  };
+
+  struct Writer
+  {
+    WriterProp writerProp;       // batchSize is zero
+    std::string inputContext;    // in effect after the last buffered item
+    std::string outputContext;   // in effect after the last written item
+    bool hasWriterProp = false;  // false for the events before the first WriterProp, and for clockSyncs
+    std::vector<char> entries;   // buffered, back to back
+    std::size_t readPos = 0;     // in entries, of the first item
+    std::deque<Item> items;      // of entries, the clock value of each is not less than the previous one's
+    std::uint64_t lastClockValue = 0; // of the last event buffered
+  };
+
+  void writeWriterProp(Range payload);
+
+  void writeWriterContext(Range entry, Range payload);
+
+  /** If the entries of the input writer follow its WriterProp, without a WriterContext, clear its context */
+  void clearInputContext();
+
+  void writeClockSync(Range entry, Range payload);
+
+  void push(Writer& writer, Range entry, std::uint64_t clockValue);
+
+  /** Write the items with a clock value not greater than `maxClockValue` */
+  void writeUntil(std::uint64_t maxClockValue);
+
+  /** Heap order: the writer with the oldest first item is the front */
+  static bool newer(const Writer* a, const Writer* b);
+
+  void writeEntry(Range entry);
+
+  OutputStream& _out;
+  std::chrono::nanoseconds _window;
+  std::uint64_t _windowClockTicks;
+  std::map<std::pair<std::uint64_t, std::string>, Writer> _writers; // by WriterProp id and name
+  Writer _clockSyncs;
+  Writer* _inputWriter;  // the writer of the entries being written
+  Writer* _outputWriter; // the writer of the most recent WriterProp in the output
+  std::vector<Writer*> _heap; // writers with buffered items
+  std::uint64_t _maxClockValue = 0;     // of the events seen
+  std::uint64_t _writtenClockValue = 0; // of the last event written
+  std::uint64_t _sequence = 0;
+  std::uint64_t _lateEventCount = 0;
+  std::size_t _bufferedBytes = 0;
+  bool _hasClockSync = false; // written to the output
+  bool _inputContextCleared = false; // by the most recent WriterProp, see clearInputContext
+};
+
+template <typename OutputStream>
+TimeOrderingStream<OutputStream>::TimeOrderingStream(OutputStream& out, std::chrono::nanoseconds window)
+  :_out(out),
+   _window(window),
+   _windowClockTicks(std::uint64_t(window.count())), // until the first ClockSync, assume nanoseconds
+   _inputWriter(&_writers[{0, std::string{}}]),
+   _outputWriter(_inputWriter)
+{}
+
+template <typename OutputStream>
+TimeOrderingStream<OutputStream>& TimeOrderingStream<OutputStream>::write(const char* buffer, std::streamsize size)
+{
+  detail::forEachEntry(buffer, std::size_t(size), [this](Range entry, std::uint64_t tag, Range payload)
+  {
+    if (! detail::isSpecialEntryTag(tag))
+    {
+      const std::uint64_t clockValue = payload.read<std::uint64_t>();
+      _maxClockValue = (std::max)(_maxClockValue, clockValue);
+      clearInputContext();
+      push(*_inputWriter, entry, clockValue);
+    }
+    else if (tag == WriterProp::Tag)
+    {
+      writeWriterProp(payload);
+    }
+    else if (tag == WriterContext::Tag)
+    {
+      writeWriterContext(entry, payload);
+    }
+    else if (tag == ClockSync::Tag)
+    {
+      writeClockSync(entry, payload);
+    }
+    else if (tag == EventSource::Tag || tag == InternedString::Tag)
+    {
+      writeEntry(entry); // metadata, must precede the events referring to it
+    }
+    else
+    {
+      // e.g: DroppedEvents, belongs to the writer of the most recent WriterProp
+      clearInputContext();
+      push(*_inputWriter, entry, _inputWriter->lastClockValue);
+    }
+  });
+
+  if (_maxClockValue >= _windowClockTicks)
+  {
+    writeUntil(_maxClockValue - _windowClockTicks);
+  }
+
+  return *this;
+}
+
+template <typename OutputStream>
+void TimeOrderingStream<OutputStream>::flush()
+{
+  writeUntil(std::uint64_t(-1));
+}
+
+template <typename OutputStream>
+void TimeOrderingStream<OutputStream>::writeWriterProp(Range payload)
+{
+  WriterProp writerProp;
+  mserialize::deserialize(writerProp, payload);
+  writerProp.batchSize = 0;
+
+  Writer& writer = _writers[{writerProp.id, writerProp.name}];
+  writer.writerProp = std::move(writerProp);
+  writer.hasWriterProp = true;
+  _inputWriter = &writer;
+  _inputContextCleared = true;
+}
+
+template <typename OutputStream>
+void TimeOrderingStream<OutputStream>::writeWriterContext(Range entry, Range payload)
+{
+  WriterContext writerContext;
+  mserialize::deserialize(writerContext, payload);
+
+  // Session::consume repeats the context after the WriterProp of each batch
+  _inputContextCleared = false;
+  if (writerContext.context != _inputWriter->inputContext)
+  {
+    _inputWriter->inputContext = std::move(writerContext.context);
+    push(*_inputWriter, entry, _inputWriter->lastClockValue);
+  }
+}
+
+template <typename OutputStream>
+void TimeOrderingStream<OutputStream>::clearInputContext()
+{
+  if (! _inputContextCleared) { return; }
+  _inputContextCleared = false;
+  if (_inputWriter->inputContext.empty()) { return; }
+
+  // [size][tag][context size], of an empty context
+  const std::uint64_t tag = WriterContext::Tag;
+  const std::uint32_t size = sizeof(tag) + sizeof(std::uint32_t);
+  char entry[sizeof(size) + size] = {};
+  memcpy(entry, &size, sizeof(size));
+  memcpy(entry + sizeof(size), &tag, sizeof(tag));
+
+  _inputWriter->inputContext.clear();
+  push(*_inputWriter, Range(entry, sizeof(entry)), _inputWriter->lastClockValue);
+}
+
+template <typename OutputStream>
+void TimeOrderingStream<OutputStream>::writeClockSync(Range entry, Range payload)
+{
+  ClockSync clockSync;
+  mserialize::deserialize(clockSync, payload);
+
+  if (clockSync.clockFrequency != 0)
+  {
+    // window * frequency / 1e9, avoid overflow for long windows
+    const std::uint64_t ns = std::uint64_t(_window.count());
+    const std::uint64_t f = clockSync.clockFrequency;
+    _windowClockTicks = ns / 1000000000 * f + ns % 1000000000 * f / 1000000000;
+  }
+
+  if (_hasClockSync)
+  {
+    push(_clockSyncs, entry, clockSync.clockValue);
+  }
+  else
+  {
+    writeEntry(entry); // needed by every event
+    _hasClockSync = true;
+  }
+}
+
+template <typename OutputStream>
+void TimeOrderingStream<OutputStream>::push(Writer& writer, Range entry, std::uint64_t clockValue)
+{
+  // never reorder the entries of a writer
+  clockValue = (std::max)(clockValue, writer.lastClockValue);
+  writer.lastClockValue = clockValue;
+
+  const std::size_t size = entry.size();
+  const char* data = entry.view(size);
+  writer.entries.insert(writer.entries.end(), data, data + size);
+  writer.items.push_back(Item{clockValue, _sequence++, std::uint32_t(size)});
+  _bufferedBytes += size;
+
+  if (writer.items.size() == 1)
+  {
+    _heap.push_back(&writer);
+    std::push_heap(_heap.begin(), _heap.end(), &newer);
+  }
+}
+
+template <typename OutputStream>
+void TimeOrderingStream<OutputStream>::writeUntil(std::uint64_t maxClockValue)
+{
+  while (! _heap.empty() && _heap.front()->items.front().clockValue <= maxClockValue)
+  {
+    std::pop_heap(_heap.begin(), _heap.end(), &newer);
+    Writer& writer = *_heap.back();
+    const Item item = writer.items.front();
+    writer.items.pop_front();
+
+    if (&writer != &_clockSyncs)
+    {
+      if (&writer != _outputWriter)
+      {
+        if (writer.hasWriterProp) { serializeSizePrefixedTagged(writer.writerProp, _out); }
+        if (! writer.outputContext.empty()) { serializeSizePrefixedTagged(WriterContext{writer.outputContext}, _out); }
+        _outputWriter = &writer;
+      }
+
+      if (item.clockValue < _writtenClockValue) { ++_lateEventCount; }
+      _writtenClockValue = (std::max)(_writtenClockValue, item.clockValue);
+    }
+
+    Range entry(writer.entries.data() + writer.readPos, item.size);
+    writeEntry(entry);
+    writer.readPos += item.size;
+
+    entry.read<std::uint32_t>(); // size
+    if (entry.read<std::uint64_t>() == WriterContext::Tag)
+    {
+      WriterContext writerContext;
+      mserialize::deserialize(writerContext, entry);
+      writer.outputContext = std::move(writerContext.context);
+    }
+    _bufferedBytes -= item.size;
+
+    if (writer.items.empty())
+    {
+      writer.entries.clear();
+      writer.readPos = 0;
+      _heap.pop_back();
+    }
+    else
+    {
+      if (writer.readPos > writer.entries.size() / 2)
+      {
+        // do not let a writer that always has buffered items grow without bound
+        writer.entries.erase(writer.entries.begin(), writer.entries.begin() + std::ptrdiff_t(writer.readPos));
+        writer.readPos = 0;
+      }
+      std::push_heap(_heap.begin(), _heap.end(), &newer);
+    }
+  }
+}
+
+template <typename OutputStream>
+bool TimeOrderingStream<OutputStream>::newer(const Writer* a, const Writer* b)
+{
+  const Item& ia = a->items.front();
+  const Item& ib = b->items.front();
+  return (ia.clockValue != ib.clockValue) ? ia.clockValue > ib.clockValue : ia.sequence > ib.sequence;
+}
+
+template <typename OutputStream>
+void TimeOrderingStream<OutputStream>::writeEntry(Range entry)
+{
+  const std::size_t size = entry.size();
+  _out.write(entry.view(size), std::streamsize(size));
+}
+
+} // namespace binlog
+
+#endif // BINLOG_TIME_ORDERING_STREAM_HPP
@@ -28,7 +28,12 @@ class PrettyPrinter;
 class ToStringVisitor
 {
 public:
-  explicit ToStringVisitor(detail::OstreamBuffer& out, const PrettyPrinter* pp = nullptr);
+  /**
+   * If `hexBytes` is true, non-empty sequences of std::uint8_t
+   * (e.g: std::vector<std::uint8_t>, array_view<std::uint8_t>)
+   * are written as hexadecimal digits, e.g: 0x0a1bff instead of [10, 27, 255].
+   */
+  explicit ToStringVisitor(detail::OstreamBuffer& out, const PrettyPrinter* pp = nullptr, bool hexBytes = false);
 
   // catch all for arithmetic types
   template <typename T>
@@ -76,6 +81,7 @@ private:
   State _state;
   int _seqDepth;
   bool _emptyStruct;
+  bool _hexBytes;
   detail::OstreamBuffer& _out;
   const PrettyPrinter* _pp;
 };
@@ -0,0 +1,89 @@
+#ifndef BINLOG_TRUNCATED_STRING_HPP
+#define BINLOG_TRUNCATED_STRING_HPP
+
+#include <mserialize/cx_string.hpp>
+#include <mserialize/serialize.hpp>
+#include <mserialize/tag.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring> // strlen
+#include <ios> // streamsize
+
+namespace binlog {
+
+template <std::size_t N>
+struct TruncatedString
+{
+  const char* data; // NOLINT
+  std::size_t size; // NOLINT size of the string before truncation
+};
+
+/**
+ * Create a loggable string, which is truncated to
+ * its first `N` bytes when the event is created.
+ *
+ * Only the prefix is copied into the queue, followed by
+ * the size of the original string. bread shows truncated strings
+ * as the prefix followed by "..." and the original size,
+ * e.g: `GET /index.html HTTP/1.1... (4096 bytes)`.
+ *
+ * Example:
+ *
+ *    BINLOG_INFO("Request: {}", binlog::truncate<32>(request));
+ *
+ * @param str std::string, std::string_view, or any other type
+ *            with contiguous `data()` and `size()` members.
+ *            Must remain valid until the event is created.
+ */
+template <std::size_t N, typename String>
+auto truncate(const String& str) -> decltype(str.data(), str.size(), TruncatedString<N>{})
+{
+  return TruncatedString<N>{str.data(), std::size_t(str.size())};
+}
+
+/**
+ * Like truncate(const String&), but `str` is a null terminated string.
+ * The whole string is read by strlen, to get its original size.
+ */
+template <std::size_t N>
+TruncatedString<N> truncate(const char* str)
+{
+  return TruncatedString<N>{str, strlen(str)};
+}
+
+} // namespace binlog
+
+namespace mserialize {
+
+template <std::size_t N>
+struct CustomSerializer<binlog::TruncatedString<N>>
+{
+  template <typename OutputStream>
+  static void serialize(binlog::TruncatedString<N> s, OutputStream& ostream)
+  {
+    const std::uint32_t prefixSize = std::uint32_t((std::min)(s.size, N));
+    mserialize::serialize(prefixSize, ostream);
+    ostream.write(s.data, std::streamsize(prefixSize));
+    mserialize::serialize(std::uint64_t(s.size), ostream);
+  }
+
+  static std::size_t serialized_size(binlog::TruncatedString<N> s)
+  {
+    return sizeof(std::uint32_t) + (std::min)(s.size, N) + sizeof(std::uint64_t);
+  }
+};
+
+template <std::size_t N>
+struct CustomTag<binlog::TruncatedString<N>>
+{
+  static constexpr auto tag_string()
+  {
+    return make_cx_string("{binlog::TruncatedString`value'[c`size'L}");
+  }
+};
+
+} // namespace mserialize
+
+#endif // BINLOG_TRUNCATED_STRING_HPP
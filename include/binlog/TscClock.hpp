@@ -0,0 +1,247 @@
+#ifndef BINLOG_TSC_CLOCK_HPP
+#define BINLOG_TSC_CLOCK_HPP
+
+#include <binlog/Entries.hpp> // ClockSync
+#include <binlog/Severity.hpp>
+#include <binlog/Time.hpp>
+#include <binlog/create_source_and_event_if.hpp>
+#include <binlog/default_session.hpp> // default_thread_local_writer
+#include <binlog/detail/Rdtsc.hpp> // BINLOG_DETAIL_HAS_RDTSC
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+/**
+ * Timestamp events with the Time Stamp Counter of the CPU,
+ * instead of std::chrono::system_clock.
+ *
+ * Reading the TSC is considerably cheaper than clock_gettime,
+ * but it requires the TSC to be invariant (constant rate, not stopped
+ * in deep C-states, synchronized across cores), see hasInvariantTsc,
+ * and the session to have a matching ClockSync:
+ *
+ *     binlog::default_session().setClockSync(binlog::tscClockSync());
+ *     BINLOG_INFO_TSC("Hello {}", "TSC");
+ *
+ * Every event of the session must be timestamped by the same clock:
+ * do not mix BINLOG_<SEVERITY> and BINLOG_<SEVERITY>_TSC macros
+ * writing the same session.
+ *
+ * On platforms without a TSC, tscNow() is clockNow(),
+ * and tscClockSync() is systemClockSync().
+ */
+
+/**
+ * BINLOG_<SEVERITY>_TSC_WC(writer, category, format, args...)
+ *
+ * Same as BINLOG_<SEVERITY>_WC, but the event is timestamped by binlog::tscNow().
+ */
+
+#define BINLOG_TRACE_TSC_WC(writer, category, ...)                              \
+  BINLOG_CREATE_SOURCE_AND_EVENT_IF(                                            \
+    writer, binlog::Severity::trace, category,                                  \
+    binlog::tscNow(),                                                           \
+    __VA_ARGS__                                                                 \
+  )                                                                             \
+  /**/
+
+#define BINLOG_DEBUG_TSC_WC(writer, category, ...)                              \
+  BINLOG_CREATE_SOURCE_AND_EVENT_IF(                                            \
+    writer, binlog::Severity::debug, category,                                  \
+    binlog::tscNow(),                                                           \
+    __VA_ARGS__                                                                 \
+  )                                                                             \
+  /**/
+
+#define BINLOG_INFO_TSC_WC(writer, category, ...)                               \
+  BINLOG_CREATE_SOURCE_AND_EVENT_IF(                                            \
+    writer, binlog::Severity::info, category,                                   \
+    binlog::tscNow(),                                                           \
+    __VA_ARGS__                                                                 \
+  )                                                                             \
+  /**/
+
+#define BINLOG_WARN_TSC_WC(writer, category, ...)                               \
+  BINLOG_CREATE_SOURCE_AND_EVENT_IF(                                            \
+    writer, binlog::Severity::warning, category,                                \
+    binlog::tscNow(),                                                           \
+    __VA_ARGS__                                                                 \
+  )                                                                             \
+  /**/
+
+#define BINLOG_ERROR_TSC_WC(writer, category, ...)                              \
+  BINLOG_CREATE_SOURCE_AND_EVENT_IF(                                            \
+    writer, binlog::Severity::error, category,                                  \
+    binlog::tscNow(),                                                           \
+    __VA_ARGS__                                                                 \
+  )                                                                             \
+  /**/
+
+#define BINLOG_CRITICAL_TSC_WC(writer, category, ...)                           \
+  BINLOG_CREATE_SOURCE_AND_EVENT_IF(                                            \
+    writer, binlog::Severity::critical, category,                               \
+    binlog::tscNow(),                                                           \
+    __VA_ARGS__                                                                 \
+  )                                                                             \
+  /**/
+
+/**
+ * BINLOG_<SEVERITY>_TSC(format, args...)
+ *
+ * Same as BINLOG_<SEVERITY>, but the event is timestamped by binlog::tscNow().
+ */
+
+#define BINLOG_TRACE_TSC(...)    BINLOG_TRACE_TSC_WC(binlog::default_thread_local_writer(), main, __VA_ARGS__)
+#define BINLOG_DEBUG_TSC(...)    BINLOG_DEBUG_TSC_WC(binlog::default_thread_local_writer(), main, __VA_ARGS__)
+#define BINLOG_INFO_TSC(...)     BINLOG_INFO_TSC_WC(binlog::default_thread_local_writer(), main, __VA_ARGS__)
+#define BINLOG_WARN_TSC(...)     BINLOG_WARN_TSC_WC(binlog::default_thread_local_writer(), main, __VA_ARGS__)
+#define BINLOG_ERROR_TSC(...)    BINLOG_ERROR_TSC_WC(binlog::default_thread_local_writer(), main, __VA_ARGS__)
+#define BINLOG_CRITICAL_TSC(...) BINLOG_CRITICAL_TSC_WC(binlog::default_thread_local_writer(), main, __VA_ARGS__)
+
+namespace binlog {
+
+/** @returns the current value of the Time Stamp Counter, or clockNow() if there is no TSC */
+inline std::uint64_t tscNow()
+{
+  #ifdef BINLOG_DETAIL_HAS_RDTSC
+    return detail::rdtsc();
+  #else
+    return clockNow();
+  #endif
+}
+
+/**
+ * @returns true if the CPU reports an invariant TSC:
+ * the TSC ticks at a constant rate, regardless of frequency scaling
+ * and power states. Otherwise, TSC timestamps are not reliable.
+ */
+inline bool hasInvariantTsc()
+{
+  // CPUID.80000007H:EDX[8]
+  #if defined(BINLOG_DETAIL_HAS_RDTSC) && defined(_MSC_VER)
+    int regs[4] = {};
+    __cpuid(regs, int(0x80000000));
+    if (unsigned(regs[0]) < 0x80000007u) { return false; }
+    __cpuid(regs, int(0x80000007));
+    return (unsigned(regs[3]) & (1u << 8)) != 0;
+  #elif defined(BINLOG_DETAIL_HAS_RDTSC)
+    unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) == 0) { return false; }
+    return (edx & (1u << 8)) != 0;
+  #else
+    return false;
+  #endif
+}
+
+/**
+ * Measure the frequency of tscNow(), by comparing it
+ * to std::chrono::steady_clock for `duration`.
+ *
+ * Blocks the calling thread for `duration`.
+ * Longer durations give more precise results.
+ *
+ * @returns the number of TSC ticks in a second
+ */
+inline std::uint64_t calibrateTscFrequency(std::chrono::nanoseconds duration = std::chrono::milliseconds(20))
+{
+  #ifdef BINLOG_DETAIL_HAS_RDTSC
+    using Clock = std::chrono::steady_clock;
+
+    // take the tsc right before and after the steady clock, use the midpoint
+    auto sample = [](std::uint64_t& tsc, Clock::time_point& time)
+    {
+      const std::uint64_t before = tscNow();
+      time = Clock::now();
+      const std::uint64_t after = tscNow();
+      tsc = before + (after - before) / 2;
+    };
+
+    std::uint64_t tsc0 = 0, tsc1 = 0;
+    Clock::time_point t0, t1;
+
+    sample(tsc0, t0);
+    std::this_thread::sleep_for(duration);
+    sample(tsc1, t1);
+
+    const double elapsedNs = double(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+    if (elapsedNs <= 0) { return 0; }
+    return std::uint64_t(double(tsc1 - tsc0) * 1e9 / elapsedNs);
+  #else
+    static_cast<void>(duration);
+    return systemClockSync().clockFrequency;
+  #endif
+}
+
+/**
+ * @returns the frequency of tscNow(), measured by calibrateTscFrequency
+ * on the first call, then cached for the lifetime of the process.
+ */
+inline std::uint64_t tscFrequency()
+{
+  static const std::uint64_t frequency = calibrateTscFrequency();
+  return frequency;
+}
+
+/**
+ * Create a ClockSync corresponding to tscNow(),
+ * with the frequency given by tscFrequency().
+ *
+ * Time zone is set according to std::localtime.
+ */
+inline ClockSync tscClockSync()
+{
+  #ifdef BINLOG_DETAIL_HAS_RDTSC
+    ClockSync result = systemClockSync(); // for the time zone
+    result.clockFrequency = tscFrequency();
+
+    // take the tsc right before and after the system clock, use the midpoint
+    const std::uint64_t before = tscNow();
+    result.nsSinceEpoch = clockNow();
+    const std::uint64_t after = tscNow();
+    result.clockValue = before + (after - before) / 2;
+
+    return result;
+  #else
+    return systemClockSync();
+  #endif
+}
+
+/**
+ * Creates ClockSyncs of tscNow(), for Session::setClockSyncRefresh:
+ *
+ *     session.setClockSyncRefresh(binlog::TscClockSyncSource{}, std::chrono::minutes(1));
+ *
+ * Each created ClockSync re-anchors the TSC to the system clock,
+ * and the frequency is refined, measured between the first ClockSync
+ * and the current one, once they are at least one second apart:
+ * the longer the process runs, the more precise the frequency gets.
+ */
+class TscClockSyncSource
+{
+public:
+  ClockSync operator()()
+  {
+    ClockSync result = tscClockSync();
+
+    if (_first.clockFrequency == 0)
+    {
+      _first = result;
+    }
+    else if (result.nsSinceEpoch >= _first.nsSinceEpoch + 1'000'000'000 && result.clockValue > _first.clockValue)
+    {
+      const double elapsedNs = double(result.nsSinceEpoch - _first.nsSinceEpoch);
+      const double elapsedTicks = double(result.clockValue - _first.clockValue);
+      result.clockFrequency = std::uint64_t(elapsedTicks * 1e9 / elapsedNs);
+    }
+
+    return result;
+  }
+
+private:
+  ClockSync _first;
+};
+
+} // namespace binlog
+
+#endif // BINLOG_TSC_CLOCK_HPP
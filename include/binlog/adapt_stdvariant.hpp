@@ -3,6 +3,8 @@
 
 // Make std::variant loggable by including this file
 
+#include <binlog/detail/BoundedOutputStream.hpp>
+
 #include <mserialize/cx_string.hpp>
 #include <mserialize/serialize.hpp>
 #include <mserialize/tag.hpp>
@@ -95,4 +97,14 @@ struct CustomTag<std::monostate>
 
 } // namespace mserialize
 
+namespace binlog {
+namespace detail {
+
+// serialized_size visits the variant, as serialize does
+template <typename... T>
+struct has_expensive_size<std::variant<T...>> : std::true_type {};
+
+} // namespace detail
+} // namespace binlog
+
 #endif // BINLOG_ADAPT_STDVARIANT_HPP
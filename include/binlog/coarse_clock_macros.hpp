@@ -0,0 +1,160 @@
+#ifndef BINLOG_COARSE_CLOCK_MACROS_HPP
+#define BINLOG_COARSE_CLOCK_MACROS_HPP
+
+#include <binlog/Severity.hpp>
+#include <binlog/Time.hpp>
+#include <binlog/create_source_and_event_if.hpp>
+#include <binlog/default_session.hpp> // default_thread_local_writer
+
+/**
+ * Timestamp events with a cheaper, less precise clock
+ * than binlog::clockNow():
+ *
+ *  - BINLOG_<SEVERITY>_COARSE: binlog::coarseClockNow(),
+ *    CLOCK_REALTIME_COARSE on linux, precise to the timer tick.
+ *  - BINLOG_<SEVERITY>_CACHED: binlog::cachedClockNow(),
+ *    a relaxed atomic load of the time of the last Session::consume call,
+ *    precise to the consume interval.
+ *
+ * Both clocks count nanoseconds since the epoch, like clockNow():
+ * the default ClockSync of the session (systemClockSync) applies,
+ * and these macros can be mixed with BINLOG_<SEVERITY> in the same session.
+ * Events of a writer are not reordered, but their timestamps
+ * of different clocks might not be monotonic.
+ *
+ * For a cheap and precise clock, see TscClock.hpp.
+ */
+
+/**
+ * BINLOG_<SEVERITY>_COARSE_WC(writer, category, format, args...)
+ *
+ * Same as BINLOG_<SEVERITY>_WC, but the event is timestamped by binlog::coarseClockNow().
+ */
+#define BINLOG_TRACE_COARSE_WC(writer, category, ...)                           \
+  BINLOG_CREATE_SOURCE_AND_EVENT_IF(                                            \
+    writer, binlog::Severity::trace, category,                                  \
+    binlog::coarseClockNow(),                                                   \
+    __VA_ARGS__                                                                 \
+  )                                                                             \
+  /**/
+
+#define BINLOG_DEBUG_COARSE_WC(writer, category, ...)                           \
+  BINLOG_CREATE_SOURCE_AND_EVENT_IF(                                            \
+    writer, binlog::Severity::debug, category,                                  \
+    binlog::coarseClockNow(),                                                   \
+    __VA_ARGS__                                                                 \
+  )                                                                             \
+  /**/
+
+#define BINLOG_INFO_COARSE_WC(writer, category, ...)                            \
+  BINLOG_CREATE_SOURCE_AND_EVENT_IF(                                            \
+    writer, binlog::Severity::info, category,                                   \
+    binlog::coarseClockNow(),                                                   \
+    __VA_ARGS__                                                                 \
+  )                                                                             \
+  /**/
+
+#define BINLOG_WARN_COARSE_WC(writer, category, ...)                            \
+  BINLOG_CREATE_SOURCE_AND_EVENT_IF(                                            \
+    writer, binlog::Severity::warning, category,                                \
+    binlog::coarseClockNow(),                                                   \
+    __VA_ARGS__                                                                 \
+  )                                                                             \
+  /**/
+
+#define BINLOG_ERROR_COARSE_WC(writer, category, ...)                           \
+  BINLOG_CREATE_SOURCE_AND_EVENT_IF(                                            \
+    writer, binlog::Severity::error, category,                                  \
+    binlog::coarseClockNow(),                                                   \
+    __VA_ARGS__                                                                 \
+  )                                                                             \
+  /**/
+
+#define BINLOG_CRITICAL_COARSE_WC(writer, category, ...)                        \
+  BINLOG_CREATE_SOURCE_AND_EVENT_IF(                                            \
+    writer, binlog::Severity::critical, category,                               \
+    binlog::coarseClockNow(),                                                   \
+    __VA_ARGS__                                                                 \
+  )                                                                             \
+  /**/
+
+/**
+ * BINLOG_<SEVERITY>_COARSE(format, args...)
+ *
+ * Same as BINLOG_<SEVERITY>, but the event is timestamped by binlog::coarseClockNow().
+ */
+
+#define BINLOG_TRACE_COARSE(...)    BINLOG_TRACE_COARSE_WC(binlog::default_thread_local_writer(), main, __VA_ARGS__)
+#define BINLOG_DEBUG_COARSE(...)    BINLOG_DEBUG_COARSE_WC(binlog::default_thread_local_writer(), main, __VA_ARGS__)
+#define BINLOG_INFO_COARSE(...)     BINLOG_INFO_COARSE_WC(binlog::default_thread_local_writer(), main, __VA_ARGS__)
+#define BINLOG_WARN_COARSE(...)     BINLOG_WARN_COARSE_WC(binlog::default_thread_local_writer(), main, __VA_ARGS__)
+#define BINLOG_ERROR_COARSE(...)    BINLOG_ERROR_COARSE_WC(binlog::default_thread_local_writer(), main, __VA_ARGS__)
+#define BINLOG_CRITICAL_COARSE(...) BINLOG_CRITICAL_COARSE_WC(binlog::default_thread_local_writer(), main, __VA_ARGS__)
+
+/**
+ * BINLOG_<SEVERITY>_CACHED_WC(writer, category, format, args...)
+ *
+ * Same as BINLOG_<SEVERITY>_WC, but the event is timestamped by binlog::cachedClockNow().
+ */
+#define BINLOG_TRACE_CACHED_WC(writer, category, ...)                           \
+  BINLOG_CREATE_SOURCE_AND_EVENT_IF(                                            \
+    writer, binlog::Severity::trace, category,                                  \
+    binlog::cachedClockNow(),                                                   \
+    __VA_ARGS__                                                                 \
+  )                                                                             \
+  /**/
+
+#define BINLOG_DEBUG_CACHED_WC(writer, category, ...)                           \
+  BINLOG_CREATE_SOURCE_AND_EVENT_IF(                                            \
+    writer, binlog::Severity::debug, category,                                  \
+    binlog::cachedClockNow(),                                                   \
+    __VA_ARGS__                                                                 \
+  )                                                                             \
+  /**/
+
+#define BINLOG_INFO_CACHED_WC(writer, category, ...)                            \
+  BINLOG_CREATE_SOURCE_AND_EVENT_IF(                                            \
+    writer, binlog::Severity::info, category,                                   \
+    binlog::cachedClockNow(),                                                   \
+    __VA_ARGS__                                                                 \
+  )                                                                             \
+  /**/
+
+#define BINLOG_WARN_CACHED_WC(writer, category, ...)                            \
+  BINLOG_CREATE_SOURCE_AND_EVENT_IF(                                            \
+    writer, binlog::Severity::warning, category,                                \
+    binlog::cachedClockNow(),                                                   \
+    __VA_ARGS__                                                                 \
+  )                                                                             \
+  /**/
+
+#define BINLOG_ERROR_CACHED_WC(writer, category, ...)                           \
+  BINLOG_CREATE_SOURCE_AND_EVENT_IF(                                            \
+    writer, binlog::Severity::error, category,                                  \
+    binlog::cachedClockNow(),                                                   \
+    __VA_ARGS__                                                                 \
+  )                                                                             \
+  /**/
+
+#define BINLOG_CRITICAL_CACHED_WC(writer, category, ...)                        \
+  BINLOG_CREATE_SOURCE_AND_EVENT_IF(                                            \
+    writer, binlog::Severity::critical, category,                               \
+    binlog::cachedClockNow(),                                                   \
+    __VA_ARGS__                                                                 \
+  )                                                                             \
+  /**/
+
+/**
+ * BINLOG_<SEVERITY>_CACHED(format, args...)
+ *
+ * Same as BINLOG_<SEVERITY>, but the event is timestamped by binlog::cachedClockNow().
+ */
+
+#define BINLOG_TRACE_CACHED(...)    BINLOG_TRACE_CACHED_WC(binlog::default_thread_local_writer(), main, __VA_ARGS__)
+#define BINLOG_DEBUG_CACHED(...)    BINLOG_DEBUG_CACHED_WC(binlog::default_thread_local_writer(), main, __VA_ARGS__)
+#define BINLOG_INFO_CACHED(...)     BINLOG_INFO_CACHED_WC(binlog::default_thread_local_writer(), main, __VA_ARGS__)
+#define BINLOG_WARN_CACHED(...)     BINLOG_WARN_CACHED_WC(binlog::default_thread_local_writer(), main, __VA_ARGS__)
+#define BINLOG_ERROR_CACHED(...)    BINLOG_ERROR_CACHED_WC(binlog::default_thread_local_writer(), main, __VA_ARGS__)
+#define BINLOG_CRITICAL_CACHED(...) BINLOG_CRITICAL_CACHED_WC(binlog::default_thread_local_writer(), main, __VA_ARGS__)
+
+#endif // BINLOG_COARSE_CLOCK_MACROS_HPP
@@ -48,7 +48,7 @@ struct CustomSerializer<const char*>
     return mserialize::serialized_size(view(str));
   }
 
-private:
+  /** Measure the string once, see binlog::detail::has_serialization_view */
   static string_view view(const char* str)
   {
     return string_view(str != nullptr ? str : "{null}");
@@ -0,0 +1,68 @@
+#ifndef BINLOG_COUNTER_MACROS_HPP
+#define BINLOG_COUNTER_MACROS_HPP
+
+#include <binlog/Severity.hpp>
+#include <binlog/Time.hpp>
+#include <binlog/create_source_and_event_if.hpp>
+#include <binlog/default_session.hpp> // default_thread_local_writer
+
+#include <mserialize/make_struct_serializable.hpp>
+#include <mserialize/make_struct_tag.hpp>
+
+#include <cstdint>
+
+/**
+ * BINLOG_COUNTER_WC(writer, category, name, value)
+ *
+ * Add an event to `writer` that records the current `value`
+ * (an integer, e.g: a queue depth, or a position) of the counter `name`,
+ * a string literal. The format string of the event is `name`"={}",
+ * the argument is a binlog::Counter.
+ *
+ * Counter events are added and consumed as regular events, with severity info.
+ * CompactOutputStream encodes the value of a counter event as a varint delta
+ * of the previous value of the same counter, of the same writer:
+ * a slowly changing counter takes about 4 bytes per event.
+ *
+ * Example:
+ *
+ *    BINLOG_COUNTER_C(queues, "depth", queue.size()); // -> depth=12
+ *
+ * @param writer binlog::SessionWriter
+ * @param category arbitrary valid symbol name
+ * @param name string literal
+ * @param value integer, converted to std::int64_t
+ */
+#define BINLOG_COUNTER_WC(writer, category, name, value)                        \
+  BINLOG_CREATE_SOURCE_AND_EVENT_IF(                                            \
+    writer, binlog::Severity::info, category,                                   \
+    binlog::clockNow(),                                                         \
+    name "={}", binlog::Counter{std::int64_t(value)}                            \
+  )                                                                             \
+  /**/
+
+/** Same as BINLOG_COUNTER_WC, using the default writer */
+#define BINLOG_COUNTER_C(category, name, value) BINLOG_COUNTER_WC(binlog::default_thread_local_writer(), category, name, value)
+
+/** Same as BINLOG_COUNTER_WC, using the default writer and the main category */
+#define BINLOG_COUNTER(name, value) BINLOG_COUNTER_WC(binlog::default_thread_local_writer(), main, name, value)
+
+namespace binlog {
+
+/**
+ * The value of a counter, see BINLOG_COUNTER_WC.
+ *
+ * The argument tags of a counter event are exactly
+ * detail::counterArgumentTags, bread shows the value only.
+ */
+struct Counter
+{
+  std::int64_t value; // NOLINT
+};
+
+} // namespace binlog
+
+MSERIALIZE_MAKE_STRUCT_SERIALIZABLE(binlog::Counter, value)
+MSERIALIZE_MAKE_STRUCT_TAG(binlog::Counter, value)
+
+#endif // BINLOG_COUNTER_MACROS_HPP
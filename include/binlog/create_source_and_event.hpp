@@ -1,8 +1,14 @@
 #ifndef BINLOG_CREATE_SOURCE_AND_EVENT_HPP
 #define BINLOG_CREATE_SOURCE_AND_EVENT_HPP
 
+#include <binlog/CallSiteProfile.hpp>
+#include <binlog/Constant.hpp>
 #include <binlog/Session.hpp>
 #include <binlog/SessionWriter.hpp>
+#include <binlog/detail/Attributes.hpp>
+#include <binlog/detail/CallSite.hpp>
+#include <binlog/detail/EagerSourceRegistry.hpp>
+#include <binlog/detail/FormatSpec.hpp> // count_placeholders
 
 #include <mserialize/cx_string.hpp>
 #include <mserialize/detail/preprocessor.hpp>
@@ -33,55 +39,143 @@
  *
  * The number of arguments must match the number of {} placeholders in `format`.
  *
- * TODO(benedek) perf: do not instantiate a full EventSource
+ * The static properties of the event source are constant initialized data
+ * (see StaticEventSource), the argument tags are computed compile time:
+ * adding the event source does not allocate.
  */
 #define BINLOG_CREATE_SOURCE_AND_EVENT(writer, severity, category, clock, /* format, */ ...) \
+  do {                                                                                       \
+    static std::atomic<std::uint64_t> _binlog_sid{0};                                        \
+    BINLOG_DETAIL_CREATE_SOURCE_AND_EVENT(_binlog_sid, nullptr, writer, severity, category, clock, __VA_ARGS__); \
+  } while (false)                                                                            \
+  /**/
+
+/**
+ * Like BINLOG_CREATE_SOURCE_AND_EVENT, but the id of the event source
+ * is cached in `sid`, a std::atomic<std::uint64_t> initialized to 0.
+ * `site` is the binlog::detail::CallSite* of the call site, or nullptr.
+ */
+#define BINLOG_DETAIL_CREATE_SOURCE_AND_EVENT(sid, site, writer, severity, category, clock, /* format, */ ...) \
+  BINLOG_DETAIL_CREATE_SOURCE_AND_EVENT_WITH_FORMAT(                                         \
+    sid, site, writer, severity, category, clock, MSERIALIZE_FIRST(__VA_ARGS__), __VA_ARGS__ \
+  )                                                                                          \
+  /**/
+
+/**
+ * Like BINLOG_DETAIL_CREATE_SOURCE_AND_EVENT, but the format string
+ * of the event source is `format`, a constant expression,
+ * instead of the first element of __VA_ARGS__, which is ignored.
+ */
+#define BINLOG_DETAIL_CREATE_SOURCE_AND_EVENT_WITH_FORMAT(sid, site, writer, severity, category, clock, format, /* ignored, */ ...) \
   do {                                                                                       \
     static_assert(                                                                           \
-      binlog::detail::count_placeholders(MSERIALIZE_FIRST(__VA_ARGS__))+1 ==                 \
+      binlog::detail::count_placeholders(format)+1 ==                                        \
       decltype(binlog::detail::count_arguments(__VA_ARGS__))::value,                         \
       "Number of {} placeholders in format string must match number of arugments"            \
     );                                                                                       \
-    static std::atomic<std::uint64_t> _binlog_sid{0};                                        \
-    std::uint64_t _binlog_sid_v = _binlog_sid.load(std::memory_order_relaxed);               \
-    if (_binlog_sid_v == 0)                                                                  \
+    static_assert(                                                                           \
+      binlog::detail::placeholders_valid(format),                                            \
+      "Invalid or duplicate placeholder in format string, expected: {[name][:[[fill]align][sign][#][0][width][.precision][type]]}" \
+    );                                                                                       \
+    using _binlog_arguments = decltype(binlog::detail::argument_tags(__VA_ARGS__));          \
+    static const binlog::StaticEventSource _binlog_source{                                   \
+      severity, #category, __func__, __FILE__, std::uint64_t(__LINE__), format, /* NOLINT */ \
+      _binlog_arguments::value.data()                                                        \
+    };                                                                                       \
+    BINLOG_DETAIL_EAGER_SOURCE(sid, site);                                                   \
+    std::uint64_t _binlog_sid_v = sid.load(std::memory_order_relaxed);                       \
+    if (_binlog_sid_v == 0 && ! _binlog_arguments::hasConstant)                              \
     {                                                                                        \
-      _binlog_sid_v = writer.session().addEventSource(binlog::EventSource{                   \
-        0, severity, #category, __func__, __FILE__, std::uint64_t(__LINE__), MSERIALIZE_FIRST(__VA_ARGS__), /* NOLINT */ \
-        binlog::detail::concatenated_tags(__VA_ARGS__).data()                                /* NOLINT */ \
-      });                                                                                    \
-      _binlog_sid.store(_binlog_sid_v);                                                      \
+      _binlog_sid_v = writer.session().addEventSource(_binlog_source);                       \
+      sid.store(_binlog_sid_v);                                                              \
     }                                                                                        \
-    binlog::detail::addEventIgnoreFirst(writer, _binlog_sid_v, clock, __VA_ARGS__);          \
+    BINLOG_DETAIL_ADD_EVENT(_binlog_source, writer,                                          \
+      (binlog::detail::CachedSourceId{_binlog_sid_v, sid, _binlog_source}),                  \
+      clock, __VA_ARGS__);                                                                   \
   } while (false)                                                                            \
   /**/
 
+/**
+ * If BINLOG_EAGER_SOURCE_REGISTRATION is defined (before this header is included,
+ * e.g: by the build system for the whole program), the event sources of the log
+ * macros are added to the EagerSourceRegistry during static initialization,
+ * and the sessions take them on construction: the first call of a log statement
+ * does not need to add the event source, or to register its call site.
+ * Every registered source is consumed, even if the call site is never reached.
+ * Sources of log statements with Constant arguments are not registered eagerly,
+ * as their format string depends on the argument values, see Constant.hpp.
+ */
+#ifdef BINLOG_EAGER_SOURCE_REGISTRATION
+  #define BINLOG_DETAIL_EAGER_SOURCE(sid, site)                                              \
+    struct _binlog_eager_tag                                                                 \
+    {                                                                                        \
+      static const binlog::StaticEventSource& source() { return _binlog_source; }            \
+      static std::atomic<std::uint64_t>& cachedId() { return sid; }                          \
+      static binlog::detail::CallSite* callSite() { return site; }                           \
+    };                                                                                       \
+    static_cast<void>(&binlog::detail::EagerSource<_binlog_eager_tag, ! _binlog_arguments::hasConstant>::id) \
+    /**/
+#else
+  #define BINLOG_DETAIL_EAGER_SOURCE(sid, site) static_cast<void>(0)
+#endif
+
+/**
+ * If BINLOG_CALL_SITE_PROFILING is defined (for the whole program, like
+ * BINLOG_EAGER_SOURCE_REGISTRATION), the time it takes to add each event
+ * is measured by detail::rdtsc, and added to the CallSiteProfile of the
+ * log statement, see binlog::callSiteProfiles.
+ * This adds two TSC reads and an uncontended lock to each event.
+ */
+#ifdef BINLOG_CALL_SITE_PROFILING
+  #define BINLOG_DETAIL_ADD_EVENT(source, writer, sid, clock, ...)                             \
+    do {                                                                                     \
+      const std::uint64_t _binlog_start = binlog::detail::rdtsc();                           \
+      BINLOG_DETAIL_ADD_EVENT_IGNORE_FIRST(writer, sid, clock, __VA_ARGS__);                 \
+      binlog::detail::CallSiteProfiler::instance().add(source, binlog::detail::rdtsc() - _binlog_start); \
+    } while (false)                                                                          \
+    /**/
+#else
+  #define BINLOG_DETAIL_ADD_EVENT(source, writer, sid, clock, ...)                             \
+    BINLOG_DETAIL_ADD_EVENT_IGNORE_FIRST(writer, sid, clock, __VA_ARGS__)                    \
+    /**/
+#endif
+
+/**
+ * If BINLOG_OUTLINE_EVENTS is defined (for the whole program, like
+ * BINLOG_EAGER_SOURCE_REGISTRATION), the log macros do not inline SessionWriter::addEvent
+ * (computing the size, reserving space, handling a full queue, serializing the arguments),
+ * but call a non-inlined function, instantiated once per list of argument types
+ * (and writer type), see detail::addOutlinedEvent. Log statements of the same argument types
+ * share the instance: the code of the call site is smaller, at the cost of a function call.
+ */
+#ifdef BINLOG_OUTLINE_EVENTS
+  #define BINLOG_DETAIL_ADD_EVENT_IGNORE_FIRST binlog::detail::addOutlinedEventIgnoreFirst
+#else
+  #define BINLOG_DETAIL_ADD_EVENT_IGNORE_FIRST binlog::detail::addEventIgnoreFirst
+#endif
+
 namespace binlog {
 namespace detail {
 
-// The first argument is dropped because __VA_ARGS__ cannot be empty,
-// therefore it is always combined with something unrelated.
-template <typename Unused, typename... T>
-constexpr auto concatenated_tags(Unused&&, T&&...)
+/** The concatenated tags of T..., computed compile time */
+template <typename... T>
+struct ArgumentTags
 {
-  return mserialize::cx_strcat(mserialize::tag<T>()...);
-}
+  using type = decltype(mserialize::cx_strcat(mserialize::tag<T>()...));
+  static constexpr type value = mserialize::cx_strcat(mserialize::tag<T>()...);
 
-/** @return the number of "{}" substrings in `str` */
-constexpr std::size_t count_placeholders(const char* str)
-{
-  std::size_t result = 0;
-  for (std::size_t i = 0; str[i] != 0; ++i)
-  {
-    if (str[i] == '{' && str[i+1] == '}')
-    {
-      ++result;
-      ++i;
-    }
-  }
+  /** True if any of T... is a Constant: the event source is folded by the argument values */
+  static constexpr bool hasConstant = AnyConstant<T...>::value;
+};
 
-  return result;
-}
+template <typename... T>
+constexpr typename ArgumentTags<T...>::type ArgumentTags<T...>::value;
+
+// Only used in unevaluated context, the arguments are not evaluated.
+// The first argument is dropped because __VA_ARGS__ cannot be empty,
+// therefore it is always combined with something unrelated.
+template <typename Unused, typename... T>
+constexpr ArgumentTags<T...> argument_tags(Unused&&, T&&...) { return {}; } // Implementation should be omitted but cannot be on MSVC
 
 template <typename... T>
 constexpr std::integral_constant<std::size_t, sizeof...(T)>
@@ -95,6 +189,62 @@ void addEventIgnoreFirst(Writer& writer, std::uint64_t eventSourceId, std::uint6
   writer.addEvent(eventSourceId, clock, std::forward<T>(t)...);
 }
 
+/**
+ * The event source id of a call site:
+ * `value` is the id loaded from `cache`, or 0, if `source` is not yet added.
+ */
+struct CachedSourceId
+{
+  std::uint64_t value;
+  std::atomic<std::uint64_t>& cache;
+  const StaticEventSource& source;
+};
+
+template <typename Writer, typename... T>
+void addFoldedEvent(std::false_type /* no Constant */, Writer& writer, CachedSourceId id, std::uint64_t clock, T&&... t)
+{
+  writer.addEvent(id.value, clock, std::forward<T>(t)...);
+}
+
+// The event source can be added only here, as the arguments must not be evaluated twice
+template <typename Writer, typename... T>
+void addFoldedEvent(std::true_type /* Constant */, Writer& writer, CachedSourceId id, std::uint64_t clock, T&&... t)
+{
+  if (id.value == 0)
+  {
+    id.value = writer.session().addEventSource(foldedEventSource(id.source, t...));
+    id.cache.store(id.value);
+  }
+  writer.addEvent(id.value, clock, std::forward<T>(t)...);
+}
+
+// If `t...` has a Constant argument, and the event source of the call site
+// is not yet added, add it with the format string folded by the argument values.
+template <typename Writer, typename Unused, typename... T>
+void addEventIgnoreFirst(Writer& writer, CachedSourceId id, std::uint64_t clock, Unused&&, T&&... t)
+{
+  addFoldedEvent(AnyConstant<T...>{}, writer, id, clock, std::forward<T>(t)...);
+}
+
+/**
+ * addEventIgnoreFirst, not inlined.
+ *
+ * The arguments are taken by const reference, the instance depends only on
+ * the types of the arguments, not on the call site.
+ */
+template <typename Writer, typename Id, typename... T>
+BINLOG_DETAIL_NOINLINE void addOutlinedEvent(Writer& writer, Id id, std::uint64_t clock, const T&... t)
+{
+  addEventIgnoreFirst(writer, id, clock, 0, t...);
+}
+
+// The first argument is dropped, like addEventIgnoreFirst
+template <typename Writer, typename Id, typename Unused, typename... T>
+void addOutlinedEventIgnoreFirst(Writer& writer, Id id, std::uint64_t clock, Unused&&, T&&... t)
+{
+  addOutlinedEvent(writer, id, clock, t...);
+}
+
 } // namespace detail
 } // namespace binlog
 
@@ -4,23 +4,36 @@
 #include <binlog/Session.hpp>
 #include <binlog/SessionWriter.hpp>
 #include <binlog/create_source_and_event.hpp>
+#include <binlog/detail/CompileTimeSeverity.hpp>
 
 /**
  * Call BINLOG_CREATE_SOURCE_AND_EVENT with the given
- * arguments if `severity` >= the minimum severity
- * configured for `writer`.
+ * arguments if the call site is enabled in the session of `writer`:
+ * by default, if `severity` >= the minimum severity
+ * configured for the session. The severity can be also
+ * configured per category, and call sites can be enabled or disabled
+ * by the id of their event source, see Session::isEnabled.
  *
- * If `severity` is below the configured minimum severity,
- * no event will be created, and the event arguments
- * will not be evaluated.
+ * If the call site is disabled, no event will be created,
+ * and the event arguments will not be evaluated.
+ * The check is a single relaxed load of the static state of the call site,
+ * except on the first call (per session), when the call site is registered.
+ *
+ * `severity` must be a constant expression.
+ * If it is below the compile time minimum severity of `category`,
+ * the statement is removed, see detail/CompileTimeSeverity.hpp.
  *
  * @see BINLOG_CREATE_SOURCE_AND_EVENT
  */
 #define BINLOG_CREATE_SOURCE_AND_EVENT_IF(writer, severity, category, clock, ...)     \
   do {                                                               \
-    if (severity >= writer.session().minSeverity())                  \
+    BINLOG_DETAIL_IF_COMPILED_IN(severity, category)                 \
     {                                                                \
-      BINLOG_CREATE_SOURCE_AND_EVENT(writer, severity, category, clock, __VA_ARGS__); \
+      static binlog::detail::CallSite _binlog_site{severity, #category}; \
+      if (writer.session().isEnabled(_binlog_site))                  \
+      {                                                              \
+        BINLOG_DETAIL_CREATE_SOURCE_AND_EVENT(_binlog_site.sourceId, &_binlog_site, writer, severity, category, clock, __VA_ARGS__); \
+      }                                                              \
     }                                                                \
   } while (false)                                                    \
   /**/
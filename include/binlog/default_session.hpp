@@ -4,6 +4,8 @@
 #include <binlog/Session.hpp>
 #include <binlog/SessionWriter.hpp>
 
+#include <binlog/detail/Attributes.hpp>
+
 #include <sstream>
 #include <thread>
 
@@ -43,6 +45,23 @@ inline Session& default_session()
   return s_session;
 }
 
+namespace detail {
+
+/** Create the writer of default_thread_local_writer on this thread, set `cache` to it */
+BINLOG_DETAIL_COLD inline SessionWriter& init_default_thread_local_writer(SessionWriter*& cache)
+{
+  static thread_local SessionWriter s_writer(
+    default_session(),
+    1 << 20, // queue capacity
+    0,       // writer id
+    detail::this_thread_id_string() // writer name
+  );
+  cache = &s_writer;
+  return s_writer;
+}
+
+} // namespace detail
+
 /**
  * Get a thread-local writer for default_session().
  *
@@ -51,16 +70,17 @@ inline Session& default_session()
  * The implementation uses a function local static,
  * avoid using the returned reference in the context
  * of global destructors.
+ *
+ * The writer is created on first use, and cached in a thread local pointer.
+ * The pointer is constant initialized, it needs no initialization guard,
+ * and uses the initial-exec TLS model where available (see BINLOG_DETAIL_TLS_INITIAL_EXEC):
+ * the basic log macros find the writer by a single load, even in shared libraries.
  */
 inline SessionWriter& default_thread_local_writer()
 {
-  static thread_local SessionWriter s_writer(
-    default_session(),
-    1 << 20, // queue capacity
-    0,       // writer id
-    detail::this_thread_id_string() // writer name
-  );
-  return s_writer;
+  static thread_local SessionWriter* s_writer BINLOG_DETAIL_TLS_INITIAL_EXEC = nullptr;
+  if (s_writer == nullptr) { return detail::init_default_thread_local_writer(s_writer); }
+  return *s_writer;
 }
 
 /**
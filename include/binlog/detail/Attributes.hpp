@@ -0,0 +1,33 @@
+#ifndef BINLOG_DETAIL_ATTRIBUTES_HPP
+#define BINLOG_DETAIL_ATTRIBUTES_HPP
+
+/**
+ * BINLOG_DETAIL_NOINLINE: the function is never inlined.
+ * BINLOG_DETAIL_COLD: the function is never inlined, and rarely called:
+ * the compiler can place it away from the hot code, and optimize it for size.
+ */
+#if defined(__GNUC__) || defined(__clang__)
+  #define BINLOG_DETAIL_NOINLINE __attribute__((noinline))
+  #define BINLOG_DETAIL_COLD __attribute__((noinline, cold))
+#elif defined(_MSC_VER)
+  #define BINLOG_DETAIL_NOINLINE __declspec(noinline)
+  #define BINLOG_DETAIL_COLD __declspec(noinline)
+#else
+  #define BINLOG_DETAIL_NOINLINE
+  #define BINLOG_DETAIL_COLD
+#endif
+
+/**
+ * BINLOG_DETAIL_TLS_INITIAL_EXEC: the thread local variable uses the initial-exec TLS model:
+ * it is accessed at a fixed offset from the thread pointer, even in a shared library,
+ * instead of calling __tls_get_addr. The variable takes space in the static TLS block,
+ * which is small: a library loaded by dlopen might fail to load if too many libraries
+ * use this model. Define BINLOG_NO_INITIAL_EXEC_TLS to use the default model.
+ */
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__ELF__) && ! defined(BINLOG_NO_INITIAL_EXEC_TLS)
+  #define BINLOG_DETAIL_TLS_INITIAL_EXEC __attribute__((tls_model("initial-exec")))
+#else
+  #define BINLOG_DETAIL_TLS_INITIAL_EXEC
+#endif
+
+#endif // BINLOG_DETAIL_ATTRIBUTES_HPP
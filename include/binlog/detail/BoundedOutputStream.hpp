@@ -0,0 +1,82 @@
+#ifndef BINLOG_DETAIL_BOUNDED_OUTPUT_STREAM_HPP
+#define BINLOG_DETAIL_BOUNDED_OUTPUT_STREAM_HPP
+
+#include <mserialize/detail/sequence_traits.hpp>
+#include <mserialize/detail/type_traits.hpp>
+
+#include <cstddef>
+#include <cstring> // memcpy
+#include <ios> // streamsize
+#include <type_traits>
+
+namespace binlog {
+namespace detail {
+
+/**
+ * Adapts a fixed size buffer to mserialize::OutputStream.
+ *
+ * Writes beyond the end of the buffer are dropped,
+ * and make overflow() return true.
+ */
+class BoundedOutputStream
+{
+public:
+  BoundedOutputStream(char* begin, std::size_t size)
+    :_begin(begin),
+     _pos(begin),
+     _end(begin + size)
+  {}
+
+  BoundedOutputStream& write(const char* buffer, std::streamsize size)
+  {
+    if (std::size_t(size) <= std::size_t(_end - _pos))
+    {
+      memcpy(_pos, buffer, std::size_t(size));
+      _pos += size;
+    }
+    else
+    {
+      _overflow = true;
+      _pos = _end;
+    }
+    return *this;
+  }
+
+  /** @returns the number of bytes written */
+  std::size_t size() const { return std::size_t(_pos - _begin); }
+
+  /** @returns true if a write did not fit */
+  bool overflow() const { return _overflow; }
+
+private:
+  char* _begin;
+  char* _pos;
+  char* _end;
+  bool _overflow = false;
+};
+
+/**
+ * True if computing the serialized size of T requires
+ * a traversal of the object, as expensive as serializing it,
+ * e.g: for sequences of strings, std::map or std::list.
+ *
+ * SessionWriter serializes events with such arguments
+ * directly into the queue, without computing the size first,
+ * if the queue has enough space.
+ *
+ * Can be specialized for other types, e.g: std::variant.
+ */
+template <typename T, typename = void>
+struct has_expensive_size : std::false_type {};
+
+template <typename Sequence>
+struct has_expensive_size<Sequence, mserialize::detail::enable_spec_if<
+  mserialize::detail::is_serializable_iterator<mserialize::detail::sequence_iterator_t<Sequence>>
+>> : mserialize::detail::negation<
+  std::is_arithmetic<mserialize::detail::sequence_value_t<Sequence>>
+> {};
+
+} // namespace detail
+} // namespace binlog
+
+#endif // BINLOG_DETAIL_BOUNDED_OUTPUT_STREAM_HPP
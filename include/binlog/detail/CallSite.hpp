@@ -0,0 +1,42 @@
+#ifndef BINLOG_DETAIL_CALL_SITE_HPP
+#define BINLOG_DETAIL_CALL_SITE_HPP
+
+#include <binlog/Severity.hpp>
+
+#include <atomic>
+#include <cstdint>
+
+namespace binlog {
+namespace detail {
+
+/**
+ * Static state of a log statement, see BINLOG_CREATE_SOURCE_AND_EVENT_IF.
+ *
+ * `state` caches whether the call site is enabled in a Session:
+ *
+ *    address of the session     // enabled in that session
+ *    address of the session | 1 // disabled in that session
+ *    0                          // unknown, ask the session
+ *
+ * The session registers the call site on first use,
+ * and updates `state` if its severity rules change.
+ * Therefore, checking if a call site is enabled is
+ * a single relaxed load and a comparison.
+ */
+struct CallSite
+{
+  constexpr CallSite(Severity severity_, const char* category_)
+    :severity(severity_),
+     category(category_)
+  {}
+
+  std::atomic<std::uintptr_t> state{0};  // NOLINT
+  std::atomic<std::uint64_t> sourceId{0}; // NOLINT set when the EventSource is added
+  const Severity severity;                // NOLINT
+  const char* const category;             // NOLINT
+};
+
+} // namespace detail
+} // namespace binlog
+
+#endif // BINLOG_DETAIL_CALL_SITE_HPP
@@ -0,0 +1,156 @@
+#ifndef BINLOG_DETAIL_COMPACT_EVENTS_HPP
+#define BINLOG_DETAIL_COMPACT_EVENTS_HPP
+
+#include <binlog/Entries.hpp>
+#include <binlog/Range.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring> // memcpy
+#include <stdexcept>
+#include <unordered_map>
+
+namespace binlog {
+namespace detail {
+
+/** @returns the number of bytes writeVarint writes for `value` */
+inline std::size_t varintSize(std::uint64_t value)
+{
+  std::size_t size = 1;
+  while (value >= 0x80) { value >>= 7; ++size; }
+  return size;
+}
+
+/**
+ * Write `value` to `dst` as an unsigned LEB128 varint:
+ * 7 bits per byte, least significant group first,
+ * the most significant bit of each byte is set if more bytes follow.
+ *
+ * @pre [dst, dst + varintSize(value)) is writable
+ * @returns the end of the written bytes
+ */
+inline char* writeVarint(std::uint64_t value, char* dst)
+{
+  while (value >= 0x80)
+  {
+    *dst++ = char((value & 0x7F) | 0x80);
+    value >>= 7;
+  }
+  *dst++ = char(value);
+  return dst;
+}
+
+/**
+ * Read a varint written by writeVarint from `input`.
+ *
+ * @throws std::runtime_error if `input` ends before the varint,
+ *         or the varint is longer than 10 bytes.
+ */
+inline std::uint64_t readVarint(Range& input)
+{
+  std::uint64_t result = 0;
+  for (unsigned shift = 0; shift < 64; shift += 7)
+  {
+    const std::uint8_t byte = input.read<std::uint8_t>();
+    result |= std::uint64_t(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) { return result; }
+  }
+
+  throw std::runtime_error("Invalid varint, longer than 10 bytes");
+}
+
+/** Map the two's complement signed `value` to an unsigned one: 0, -1, 1, -2, ... -> 0, 1, 2, 3, ... */
+inline std::uint64_t zigzag(std::uint64_t value)
+{
+  return (value << 1) ^ (0 - (value >> 63));
+}
+
+/** The inverse of zigzag */
+inline std::uint64_t unzigzag(std::uint64_t value)
+{
+  return (value >> 1) ^ (0 - (value & 1));
+}
+
+/** The argument tags of counter events, see BINLOG_COUNTER_WC */
+constexpr const char* counterArgumentTags = "{binlog::Counter`value'l}";
+
+/** An event decoded from a CompactEvents entry */
+struct CompactEvent
+{
+  std::uint64_t sourceId = 0;
+  std::uint64_t clockValue = 0;
+  Range arguments;
+};
+
+/** @returns true if EventStream can read CompactEvents entries of `version` */
+inline bool isSupportedCompactVersion(std::uint8_t version)
+{
+  return version >= CompactEvents::minFormatVersion && version <= CompactEvents::formatVersion;
+}
+
+/** The state of decoding the events of a CompactEvents entry, see nextCompactEvent */
+struct CompactDecoder
+{
+  explicit CompactDecoder(std::uint8_t version_ = CompactEvents::formatVersion)
+    :version(version_)
+  {}
+
+  std::uint8_t version;         // of the entry
+  std::uint64_t clock = 0;      // of the previous event of the entry
+  std::unordered_map<std::uint64_t, std::uint64_t> counters; // the previous value of each counter source
+  char counterValue[sizeof(std::uint64_t)] = {}; // the arguments of the last counter event decoded
+};
+
+/**
+ * Decode the next event of `events`, the remaining payload of a CompactEvents entry.
+ *
+ * `decoder` must be created for the entry (with the version of it),
+ * it is updated by each decoded event. The arguments of a counter event
+ * are valid until the next call with the same decoder.
+ * On success, the decoded event is dropped from `events`.
+ * If the size of the event can not be read, `events` is emptied.
+ *
+ * @see CompactEvents for the format
+ * @pre ! events.empty()
+ * @throws std::runtime_error if the event is invalid
+ */
+inline CompactEvent nextCompactEvent(Range& events, CompactDecoder& decoder)
+{
+  Range event;
+  try
+  {
+    const std::uint64_t size = readVarint(events);
+    event = Range(events.view(std::size_t(size)), std::size_t(size));
+  }
+  catch (...)
+  {
+    events = Range{}; // the next event can not be found
+    throw;
+  }
+
+  CompactEvent result;
+  const std::uint64_t id = readVarint(event);
+  const bool counter = decoder.version >= 3 && (id & 1) != 0;
+  result.sourceId = (decoder.version >= 3) ? id >> 1 : id;
+  decoder.clock += unzigzag(readVarint(event));
+  result.clockValue = decoder.clock;
+
+  if (counter)
+  {
+    std::uint64_t& value = decoder.counters[result.sourceId];
+    value += unzigzag(readVarint(event));
+    if (! event.empty()) { throw std::runtime_error("Invalid counter event, has extra bytes"); }
+    memcpy(decoder.counterValue, &value, sizeof(value));
+    result.arguments = Range(decoder.counterValue, sizeof(decoder.counterValue));
+  }
+  else
+  {
+    result.arguments = event;
+  }
+  return result;
+}
+
+} // namespace detail
+} // namespace binlog
+
+#endif // BINLOG_DETAIL_COMPACT_EVENTS_HPP
@@ -0,0 +1,95 @@
+#ifndef BINLOG_DETAIL_COMPILE_TIME_SEVERITY_HPP
+#define BINLOG_DETAIL_COMPILE_TIME_SEVERITY_HPP
+
+#include <binlog/Severity.hpp>
+
+#include <initializer_list>
+#include <type_traits> // integral_constant
+
+/**
+ * Log statements below a compile time minimum severity are removed from the program.
+ *
+ * BINLOG_COMPILE_MIN_SEVERITY: the name of a binlog::Severity enumerator,
+ * e.g: -DBINLOG_COMPILE_MIN_SEVERITY=info removes the trace and debug statements.
+ * By default, every statement is compiled in.
+ *
+ * BINLOG_COMPILE_CATEGORY_MIN_SEVERITY: a list of {"category", binlog::Severity::x} pairs,
+ * the minimum severity of the named categories, overriding BINLOG_COMPILE_MIN_SEVERITY, e.g:
+ *
+ *    #define BINLOG_COMPILE_CATEGORY_MIN_SEVERITY {"orders", binlog::Severity::trace}, {"net", binlog::Severity::warning}
+ *
+ * Both are read where the log statements are expanded: define them before including
+ * the binlog headers, usually for the whole program (e.g: by the build system).
+ * A removed statement creates no call site, no event source, and does not evaluate its arguments.
+ * If `if constexpr` is available (C++17), its serialization code is not even instantiated,
+ * otherwise it is left for the optimizer to remove, as unreachable code.
+ * The runtime severity configuration of the Session can only disable further statements.
+ */
+
+#ifndef BINLOG_COMPILE_MIN_SEVERITY
+  #define BINLOG_COMPILE_MIN_SEVERITY trace
+#endif
+
+#ifndef BINLOG_COMPILE_CATEGORY_MIN_SEVERITY
+  #define BINLOG_COMPILE_CATEGORY_MIN_SEVERITY
+#endif
+
+#ifdef __cpp_if_constexpr
+  #define BINLOG_DETAIL_IF_CONSTEXPR if constexpr
+#else
+  #define BINLOG_DETAIL_IF_CONSTEXPR if
+#endif
+
+/**
+ * Begin a statement executed only if a log statement of
+ * `severity` and `category` is compiled in, see above.
+ * The configuration is expanded here, in the translation unit of the log statement:
+ * the functions below do not depend on it.
+ *
+ * @pre severity must be a constant expression
+ */
+#define BINLOG_DETAIL_IF_COMPILED_IN(severity, category)                        \
+  BINLOG_DETAIL_IF_CONSTEXPR (std::integral_constant<bool,                      \
+    binlog::detail::isCompiledIn(severity, #category, {                         \
+      binlog::detail::CategorySeverity{nullptr, binlog::Severity::BINLOG_COMPILE_MIN_SEVERITY}, \
+      BINLOG_COMPILE_CATEGORY_MIN_SEVERITY                                      \
+    })                                                                          \
+  >::value)                                                                     \
+  /**/
+
+namespace binlog {
+namespace detail {
+
+struct CategorySeverity
+{
+  const char* category;
+  Severity severity;
+};
+
+constexpr bool cxStringEqual(const char* a, const char* b)
+{
+  while (*a != '\0' && *a == *b) { ++a; ++b; }
+  return *a == *b;
+}
+
+/**
+ * @param config the default (null category) first, then the configured categories
+ * @returns true if a log statement of `severity` and `category` is compiled in
+ */
+constexpr bool isCompiledIn(Severity severity, const char* category, std::initializer_list<CategorySeverity> config)
+{
+  Severity minSeverity = config.begin()->severity;
+  for (const CategorySeverity& entry : config)
+  {
+    if (entry.category != nullptr && cxStringEqual(entry.category, category))
+    {
+      minSeverity = entry.severity;
+    }
+  }
+  return severity >= minSeverity;
+}
+
+} // namespace detail
+} // namespace binlog
+
+#endif // BINLOG_DETAIL_COMPILE_TIME_SEVERITY_HPP
@@ -0,0 +1,68 @@
+#ifndef BINLOG_DETAIL_CONCURRENCY_HPP
+#define BINLOG_DETAIL_CONCURRENCY_HPP
+
+/**
+ * The synchronization primitives of Session and its queues.
+ *
+ * By default, Session is thread-safe. If BINLOG_SINGLE_THREADED is defined
+ * (for the whole program, linked with the binlog_st library, built with
+ * the same definition), every Session
+ * is used by a single thread only (e.g: writers and the consumer of a backtest
+ * run on the same thread): Mutex does not lock, and the queue indices and
+ * the other shared flags are accessed by relaxed (plain) loads and stores,
+ * instead of acquire loads, release stores and locked read-modify-writes.
+ * Starting a BackgroundConsumer, or writing or consuming a session
+ * from a second thread is undefined behavior in this mode.
+ */
+
+#include <atomic>
+#include <mutex>
+
+namespace binlog {
+namespace detail {
+
+#ifdef BINLOG_SINGLE_THREADED
+
+/** Models Lockable, does nothing */
+struct NullMutex
+{
+  void lock() {}
+  void unlock() {}
+  bool try_lock() { return true; } // NOLINT(readability-identifier-naming) Lockable
+};
+
+using Mutex = NullMutex;
+
+constexpr std::memory_order memoryOrderAcquire = std::memory_order_relaxed;
+constexpr std::memory_order memoryOrderRelease = std::memory_order_relaxed;
+constexpr std::memory_order memoryOrderAcqRel = std::memory_order_relaxed;
+
+/** Set the bits of `mask` in `word` */
+template <typename T>
+void atomicOr(std::atomic<T>& word, T mask, std::memory_order /* order */)
+{
+  // no other thread: a plain load and store is enough, avoid the locked instruction
+  word.store(word.load(std::memory_order_relaxed) | mask, std::memory_order_relaxed);
+}
+
+#else
+
+using Mutex = std::mutex;
+
+constexpr std::memory_order memoryOrderAcquire = std::memory_order_acquire;
+constexpr std::memory_order memoryOrderRelease = std::memory_order_release;
+constexpr std::memory_order memoryOrderAcqRel = std::memory_order_acq_rel;
+
+/** Set the bits of `mask` in `word` */
+template <typename T>
+void atomicOr(std::atomic<T>& word, T mask, std::memory_order order)
+{
+  word.fetch_or(mask, order);
+}
+
+#endif
+
+} // namespace detail
+} // namespace binlog
+
+#endif // BINLOG_DETAIL_CONCURRENCY_HPP
@@ -0,0 +1,22 @@
+#ifndef BINLOG_DETAIL_CRC32C_HPP
+#define BINLOG_DETAIL_CRC32C_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace binlog {
+namespace detail {
+
+/**
+ * @returns the CRC32C (Castagnoli) checksum of [data, data+size),
+ *          continuing the checksum `crc` of the preceding bytes.
+ *
+ * Uses the crc32 instruction of SSE 4.2 if available at runtime
+ * (x86-64, built by gcc or clang), a lookup table otherwise.
+ */
+std::uint32_t crc32c(const char* data, std::size_t size, std::uint32_t crc = 0);
+
+} // namespace detail
+} // namespace binlog
+
+#endif // BINLOG_DETAIL_CRC32C_HPP
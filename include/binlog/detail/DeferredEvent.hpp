@@ -0,0 +1,142 @@
+#ifndef BINLOG_DETAIL_DEFERRED_EVENT_HPP
+#define BINLOG_DETAIL_DEFERRED_EVENT_HPP
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring> // memcpy
+
+namespace binlog {
+namespace detail {
+
+/**
+ * Queue entry of an event with deferred arguments (see DeferredView).
+ *
+ * Such entries never leave the queue: Session::consume
+ * replaces them by regular events, copying the
+ * referenced buffers to the output.
+ *
+ * Layout:
+ *
+ *    u32 size           // size of the entry, excluding this field
+ *    u64 tag            // deferredEventTag
+ *    u32 n              // number of deferred arguments
+ *    u32 offset[n]      // offset of the deferred arguments, relative to the payload
+ *    payload            // as a regular event: u64 source id, u64 clock, arguments
+ *
+ * A deferred argument in the payload is:
+ *
+ *    u32 size           // size of the referenced buffer
+ *    u64 address        // address of the referenced buffer
+ *    u64 checksum       // checksum of the referenced buffer, or 0 if not computed
+ *
+ * which is replaced by the serialized buffer:
+ *
+ *    u32 size
+ *    char[size]
+ *
+ * As the referenced buffers are not part of a memory dump, deferred events
+ * are not recovered: readers ignore the special tag.
+ */
+constexpr std::uint64_t deferredEventTag = std::uint64_t(-5);
+
+/** The size of a deferred argument in the queue */
+constexpr std::size_t deferredArgumentSize = sizeof(std::uint32_t) + 2 * sizeof(std::uint64_t);
+
+/** @returns the FNV-1a hash of the given buffer, never 0 */
+inline std::uint64_t deferredChecksum(const char* data, std::size_t size)
+{
+  std::uint64_t hash = 14695981039346656037ULL;
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 1099511628211ULL;
+  }
+  return (hash != 0) ? hash : 1;
+}
+
+/** Read a T from `p` */
+template <typename T>
+T readUnaligned(const char* p)
+{
+  T result;
+  memcpy(&result, p, sizeof(T));
+  return result;
+}
+
+/**
+ * Visit the entries of [begin,end), expand deferred events.
+ *
+ * Calls `write(buffer, size)` with runs of regular entries,
+ * and with the pieces of the expanded deferred events.
+ *
+ * @pre [begin,end) must be a sequence of complete entries
+ */
+template <typename Write>
+void expandDeferredEvents(const char* begin, const char* end, Write&& write)
+{
+  const char* runBegin = begin;
+  const char* p = begin;
+  while (p != end)
+  {
+    const std::uint32_t size = readUnaligned<std::uint32_t>(p);
+    const char* entryEnd = p + sizeof(size) + size;
+    assert(entryEnd <= end);
+
+    if (readUnaligned<std::uint64_t>(p + sizeof(size)) != deferredEventTag)
+    {
+      p = entryEnd;
+      continue;
+    }
+
+    // write the regular entries before this one
+    if (runBegin != p) { write(runBegin, std::size_t(p - runBegin)); }
+
+    const char* offsets = p + sizeof(std::uint32_t) + sizeof(std::uint64_t);
+    const std::uint32_t n = readUnaligned<std::uint32_t>(offsets);
+    offsets += sizeof(n);
+    const char* payload = offsets + n * sizeof(std::uint32_t);
+
+    // compute the size of the expanded event
+    std::uint32_t newSize = std::uint32_t(entryEnd - payload);
+    for (std::uint32_t i = 0; i < n; ++i)
+    {
+      const char* arg = payload + readUnaligned<std::uint32_t>(offsets + i * sizeof(std::uint32_t));
+      newSize += readUnaligned<std::uint32_t>(arg);
+      newSize -= std::uint32_t(deferredArgumentSize - sizeof(std::uint32_t));
+    }
+    write(reinterpret_cast<const char*>(&newSize), sizeof(newSize));
+
+    // write the payload, replacing deferred arguments with the referenced buffers
+    const char* payloadPos = payload;
+    for (std::uint32_t i = 0; i < n; ++i)
+    {
+      const char* arg = payload + readUnaligned<std::uint32_t>(offsets + i * sizeof(std::uint32_t));
+      const std::uint32_t argSize = readUnaligned<std::uint32_t>(arg);
+      const std::uint64_t address = readUnaligned<std::uint64_t>(arg + sizeof(argSize));
+      const char* buffer = reinterpret_cast<const char*>(static_cast<std::uintptr_t>(address));
+
+      // debug mode lifetime check: the buffer must not change until consumed
+      assert(
+        (readUnaligned<std::uint64_t>(arg + sizeof(argSize) + sizeof(address)) == 0 ||
+         readUnaligned<std::uint64_t>(arg + sizeof(argSize) + sizeof(address)) == deferredChecksum(buffer, argSize))
+        && "Buffer of deferred argument changed before consume"
+      );
+
+      write(payloadPos, std::size_t(arg - payloadPos) + sizeof(argSize));
+      if (argSize != 0) { write(buffer, argSize); }
+      payloadPos = arg + deferredArgumentSize;
+    }
+    write(payloadPos, std::size_t(entryEnd - payloadPos));
+
+    p = entryEnd;
+    runBegin = p;
+  }
+
+  if (runBegin != end) { write(runBegin, std::size_t(end - runBegin)); }
+}
+
+} // namespace detail
+} // namespace binlog
+
+#endif // BINLOG_DETAIL_DEFERRED_EVENT_HPP
@@ -0,0 +1,126 @@
+#ifndef BINLOG_DETAIL_EAGER_SOURCE_REGISTRY_HPP
+#define BINLOG_DETAIL_EAGER_SOURCE_REGISTRY_HPP
+
+#include <binlog/Entries.hpp>
+#include <binlog/detail/CallSite.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace binlog {
+namespace detail {
+
+/**
+ * Process wide list of event sources, registered
+ * during static initialization, see BINLOG_EAGER_SOURCE_REGISTRATION.
+ *
+ * The ids of these sources are process wide,
+ * assigned from a range disjoint from the ids
+ * assigned by Session::addEventSource.
+ * Each Session takes every registered source
+ * (and registers the call site of it, if any),
+ * on construction, and before each consume.
+ */
+class EagerSourceRegistry
+{
+public:
+  static constexpr std::uint64_t firstId = std::uint64_t(1) << 62;
+
+  static EagerSourceRegistry& instance()
+  {
+    static EagerSourceRegistry registry;
+    return registry;
+  }
+
+  /**
+   * Add `source` and its `site` (can be nullptr) to the registry.
+   *
+   * `source` and `site` must remain valid as long as the registry is valid.
+   *
+   * @returns the id assigned to `source`
+   */
+  std::uint64_t add(const StaticEventSource& source, CallSite* site)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _sources.push_back(Entry{&source, site});
+    _size.store(_sources.size(), std::memory_order_release);
+    return firstId + _sources.size() - 1;
+  }
+
+  /** @returns the number of registered sources */
+  std::size_t size() const
+  {
+    return _size.load(std::memory_order_acquire);
+  }
+
+  /**
+   * Call `f(id, source, site)` for each source registered
+   * after the first `begin` ones.
+   *
+   * @returns the number of registered sources
+   */
+  template <typename F>
+  std::size_t forEach(std::size_t begin, F&& f) const
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (std::size_t i = begin; i < _sources.size(); ++i)
+    {
+      f(firstId + i, *_sources[i].source, _sources[i].site);
+    }
+    return _sources.size();
+  }
+
+private:
+  struct Entry
+  {
+    const StaticEventSource* source;
+    CallSite* site;
+  };
+
+  mutable std::mutex _mutex;
+  std::vector<Entry> _sources;
+  std::atomic<std::size_t> _size{0};
+};
+
+/**
+ * Registers the event source of a call site
+ * during static initialization.
+ *
+ * `Tag::source()` returns the StaticEventSource of the call site,
+ * `Tag::cachedId()` the std::atomic<std::uint64_t> the call site caches its source id in,
+ * `Tag::callSite()` the CallSite* of the call site (or nullptr).
+ * Referencing `EagerSource<Tag>::id` makes it initialized before main.
+ * If `Enabled` is false, the source is not registered, and `id` is 0.
+ */
+template <typename Tag, bool Enabled = true>
+struct EagerSource
+{
+  static const std::uint64_t id;
+
+  static std::uint64_t registerSource()
+  {
+    const std::uint64_t result = EagerSourceRegistry::instance().add(Tag::source(), Tag::callSite());
+    Tag::cachedId().store(result);
+    return result;
+  }
+};
+
+template <typename Tag, bool Enabled>
+const std::uint64_t EagerSource<Tag, Enabled>::id = EagerSource<Tag, Enabled>::registerSource();
+
+template <typename Tag>
+struct EagerSource<Tag, false>
+{
+  static const std::uint64_t id;
+};
+
+template <typename Tag>
+const std::uint64_t EagerSource<Tag, false>::id = 0;
+
+} // namespace detail
+} // namespace binlog
+
+#endif // BINLOG_DETAIL_EAGER_SOURCE_REGISTRY_HPP
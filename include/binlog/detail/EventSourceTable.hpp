@@ -0,0 +1,161 @@
+#ifndef BINLOG_DETAIL_EVENT_SOURCE_TABLE_HPP
+#define BINLOG_DETAIL_EVENT_SOURCE_TABLE_HPP
+
+#include <binlog/Entries.hpp>
+#include <binlog/Range.hpp>
+#include <binlog/Severity.hpp>
+#include <binlog/detail/CompactEvents.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring> // memcpy
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace binlog {
+namespace detail {
+
+/**
+ * Append an EventSourceTable entry of `sources`,
+ * including the size prefix, to `out`.
+ *
+ * @see EventSourceTable for the format
+ * @pre the size of the entry fits in 32 bits
+ */
+inline void appendEventSourceTable(const std::vector<EventSource>& sources, std::vector<char>& out)
+{
+  std::vector<std::string> strings;
+  strings.reserve(sources.size() * 5);
+  for (const EventSource& source : sources)
+  {
+    strings.push_back(source.category);
+    strings.push_back(source.function);
+    strings.push_back(source.file);
+    strings.push_back(source.formatString);
+    strings.push_back(source.argumentTags);
+  }
+  std::sort(strings.begin(), strings.end());
+  strings.erase(std::unique(strings.begin(), strings.end()), strings.end());
+
+  const auto indexOf = [&strings](const std::string& s)
+  {
+    return std::uint64_t(std::lower_bound(strings.begin(), strings.end(), s) - strings.begin());
+  };
+
+  const std::size_t begin = out.size();
+  out.resize(begin + sizeof(std::uint32_t)); // size, set below
+
+  const std::uint64_t tag = EventSourceTable::Tag;
+  const char* tagBytes = reinterpret_cast<const char*>(&tag);
+  out.insert(out.end(), tagBytes, tagBytes + sizeof(tag));
+  out.push_back(char(EventSourceTable::formatVersion));
+
+  char varint[10];
+  const auto appendVarint = [&out, &varint](std::uint64_t value)
+  {
+    out.insert(out.end(), varint, writeVarint(value, varint));
+  };
+
+  appendVarint(strings.size());
+  const std::string* previous = nullptr;
+  for (const std::string& s : strings)
+  {
+    std::size_t shared = 0;
+    if (previous != nullptr)
+    {
+      const std::size_t maxShared = std::min(previous->size(), s.size());
+      while (shared < maxShared && (*previous)[shared] == s[shared]) { ++shared; }
+    }
+
+    appendVarint(shared);
+    appendVarint(s.size() - shared);
+    out.insert(out.end(), s.begin() + std::ptrdiff_t(shared), s.end());
+    previous = &s;
+  }
+
+  appendVarint(sources.size());
+  for (const EventSource& source : sources)
+  {
+    appendVarint(source.id);
+    appendVarint(std::uint64_t(source.severity));
+    appendVarint(indexOf(source.category));
+    appendVarint(indexOf(source.function));
+    appendVarint(indexOf(source.file));
+    appendVarint(source.line);
+    appendVarint(indexOf(source.formatString));
+    appendVarint(indexOf(source.argumentTags));
+  }
+
+  const std::uint32_t size = std::uint32_t(out.size() - begin - sizeof(size));
+  memcpy(out.data() + begin, &size, sizeof(size));
+}
+
+/**
+ * Decode the sources of `table`, the payload of an EventSourceTable
+ * entry after the tag, and call `f(EventSource&&)` for each.
+ *
+ * @throws std::runtime_error if the entry is invalid, or its version is not supported
+ */
+template <typename F>
+void readEventSourceTable(Range table, F&& f)
+{
+  const std::uint8_t version = table.read<std::uint8_t>();
+  if (version != EventSourceTable::formatVersion)
+  {
+    throw std::runtime_error("Unsupported EventSourceTable version: " + std::to_string(version));
+  }
+
+  const std::uint64_t stringCount = readVarint(table);
+  if (stringCount > table.size()) // each string takes at least two bytes
+  {
+    throw std::runtime_error("Invalid EventSourceTable, too many strings: " + std::to_string(stringCount));
+  }
+
+  std::vector<std::string> strings;
+  strings.reserve(std::size_t(stringCount));
+  for (std::uint64_t i = 0; i < stringCount; ++i)
+  {
+    const std::uint64_t shared = readVarint(table);
+    const std::uint64_t suffixSize = readVarint(table);
+    if (shared != 0 && (strings.empty() || shared > strings.back().size()))
+    {
+      throw std::runtime_error("Invalid EventSourceTable, shared prefix too long: " + std::to_string(shared));
+    }
+
+    std::string s = strings.empty() ? std::string() : strings.back().substr(0, std::size_t(shared));
+    s.append(table.view(std::size_t(suffixSize)), std::size_t(suffixSize));
+    strings.push_back(std::move(s));
+  }
+
+  const auto stringAt = [&strings](std::uint64_t index) -> const std::string&
+  {
+    if (index >= strings.size())
+    {
+      throw std::runtime_error("Invalid EventSourceTable, string index out of range: " + std::to_string(index));
+    }
+    return strings[std::size_t(index)];
+  };
+
+  const std::uint64_t sourceCount = readVarint(table);
+  for (std::uint64_t i = 0; i < sourceCount; ++i)
+  {
+    EventSource source;
+    source.id = readVarint(table);
+    source.severity = Severity(readVarint(table));
+    source.category = stringAt(readVarint(table));
+    source.function = stringAt(readVarint(table));
+    source.file = stringAt(readVarint(table));
+    source.line = readVarint(table);
+    source.formatString = stringAt(readVarint(table));
+    source.argumentTags = stringAt(readVarint(table));
+    f(std::move(source));
+  }
+}
+
+} // namespace detail
+} // namespace binlog
+
+#endif // BINLOG_DETAIL_EVENT_SOURCE_TABLE_HPP
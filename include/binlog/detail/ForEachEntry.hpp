@@ -0,0 +1,46 @@
+#ifndef BINLOG_DETAIL_FOR_EACH_ENTRY_HPP
+#define BINLOG_DETAIL_FOR_EACH_ENTRY_HPP
+
+#include <binlog/Range.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace binlog {
+namespace detail {
+
+/** @returns true if `tag` is the tag of a special entry (not an event) */
+inline bool isSpecialEntryTag(std::uint64_t tag)
+{
+  return (tag & (std::uint64_t(1) << 63)) != 0;
+}
+
+/**
+ * Call `f(entry, tag, payload)` for each of the complete
+ * binlog entries in [buffer, buffer+bufferSize), where
+ * `entry` is the size prefixed entry, `tag` is the tag of the entry,
+ * and `payload` is the rest of the entry after the tag.
+ *
+ * @requires f(Range, std::uint64_t, Range) must be a valid expression
+ * @throws std::runtime_error if `buffer` contains an invalid entry
+ */
+template <typename F>
+void forEachEntry(const char* buffer, std::size_t bufferSize, F&& f)
+{
+  Range entries(buffer, bufferSize);
+
+  while (! entries.empty())
+  {
+    const char* entryBegin = entries.view(0);
+    const std::uint32_t size = entries.read<std::uint32_t>();
+    Range payload(entries.view(size), size);
+    const std::uint64_t tag = payload.read<std::uint64_t>();
+
+    f(Range(entryBegin, sizeof(size) + size), tag, payload);
+  }
+}
+
+} // namespace detail
+} // namespace binlog
+
+#endif // BINLOG_DETAIL_FOR_EACH_ENTRY_HPP
@@ -0,0 +1,291 @@
+#ifndef BINLOG_DETAIL_FORMAT_SPEC_HPP
+#define BINLOG_DETAIL_FORMAT_SPEC_HPP
+
+#include <mserialize/detail/tag_util.hpp>
+#include <mserialize/string_view.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace binlog {
+namespace detail {
+
+/**
+ * The spec of a {:spec} placeholder, a subset of the std::format spec:
+ *
+ *    [[fill]align][sign][#][0][width][.precision][type]
+ *
+ *    align:     < (left), > (right), ^ (center), padded by fill (default: space) to width
+ *    sign:      + (show + for non-negative numbers), - (default), space (show a space)
+ *    #:         alternate form: 0x, 0X, 0b or 0 prefix of x, X, b and o
+ *    0:         pad numbers with zeros to width, after the sign and prefix
+ *    precision: digits after the decimal point of floating point numbers,
+ *               maximum number of characters of strings
+ *    type:      d, x, X, o, b (integers), f, F, e, E, g, G (floating point), s (strings)
+ *
+ * The spec is stored in the format string of the event source, and applied when
+ * the event is printed: the producer logs the value only, e.g: {:08x} or {:.3f}.
+ */
+struct FormatSpec
+{
+  char fill = ' ';
+  char align = 0;          // '<', '>', '^', or 0 (default: numbers right, others left)
+  char sign = 0;           // '+', ' ', or 0
+  bool alternate = false;  // #
+  bool zeroPad = false;    // 0
+  std::uint32_t width = 0;
+  int precision = -1;      // -1 if not set
+  char type = 0;           // 0 if not set
+
+  /** @returns true if this spec does not change the printed value, e.g: of {} or {:} */
+  constexpr bool empty() const
+  {
+    return align == 0 && sign == 0 && ! alternate && ! zeroPad && width == 0 && precision < 0 && type == 0;
+  }
+};
+
+constexpr bool is_format_align(char c)
+{
+  return c == '<' || c == '>' || c == '^';
+}
+
+constexpr bool is_format_type(char c)
+{
+  return c == 'd' || c == 'x' || c == 'X' || c == 'o' || c == 'b'
+      || c == 'f' || c == 'F' || c == 'e' || c == 'E' || c == 'g' || c == 'G'
+      || c == 's';
+}
+
+constexpr bool is_name_start(char c)
+{
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+constexpr bool is_name_char(char c)
+{
+  return is_name_start(c) || (c >= '0' && c <= '9');
+}
+
+/**
+ * Parse the placeholder at the beginning of the null terminated `str`:
+ * {}, {:spec}, {name} or {name:spec}, where name is an identifier
+ * (letters, digits and underscores, not starting with a digit), beginning at `str+1`.
+ *
+ * Named placeholders are substituted by the arguments by position, as the others,
+ * the name is kept in the format string of the event source,
+ * for the readers to refer to the argument by name.
+ *
+ * If `names` is false, {name} and {name:spec} are literal text,
+ * as in the format strings written before named placeholders, see names_are_placeholders.
+ *
+ * @returns the position after the placeholder, sets `spec` and `nameSize` (0 if unnamed),
+ *          or nullptr if `str` does not begin with a placeholder,
+ *          and sets `invalid` if it begins with {: or {name: not followed by a valid spec and }.
+ */
+constexpr const char* parse_placeholder(const char* str, FormatSpec& spec, bool& invalid, std::size_t& nameSize, bool names = true)
+{
+  invalid = false;
+  spec = FormatSpec{};
+  nameSize = 0;
+  if (str[0] != '{') { return nullptr; }
+
+  if (is_name_start(str[1]))
+  {
+    if (! names) { return nullptr; }
+
+    std::size_t n = 1;
+    while (is_name_char(str[1 + n])) { ++n; }
+    if (str[1 + n] != '}' && str[1 + n] != ':') { return nullptr; } // e.g: {a b}, literal
+    nameSize = n;
+  }
+
+  const char* p = str + 1 + nameSize;
+  if (*p == '}') { return p + 1; }
+  if (*p != ':') { nameSize = 0; return nullptr; }
+  ++p;
+
+  // [[fill]align], the fill can be any character but { and }
+  if (p[0] != 0 && p[0] != '{' && p[0] != '}' && is_format_align(p[1]))
+  {
+    spec.fill = p[0];
+    spec.align = p[1];
+    p += 2;
+  }
+  else if (is_format_align(p[0]))
+  {
+    spec.align = p[0];
+    ++p;
+  }
+
+  if (*p == '+' || *p == ' ') { spec.sign = *p++; }
+  else if (*p == '-') { ++p; }
+
+  if (*p == '#') { spec.alternate = true; ++p; }
+  if (*p == '0') { spec.zeroPad = true; ++p; }
+
+  for (; *p >= '0' && *p <= '9'; ++p)
+  {
+    if (spec.width > 100000) { invalid = true; return nullptr; }
+    spec.width = spec.width * 10 + std::uint32_t(*p - '0');
+  }
+
+  if (*p == '.')
+  {
+    ++p;
+    if (*p < '0' || *p > '9') { invalid = true; return nullptr; }
+    spec.precision = 0;
+    for (; *p >= '0' && *p <= '9'; ++p)
+    {
+      if (spec.precision > 100000) { invalid = true; return nullptr; }
+      spec.precision = spec.precision * 10 + (*p - '0');
+    }
+  }
+
+  if (is_format_type(*p)) { spec.type = *p++; }
+
+  if (*p != '}') { invalid = true; return nullptr; }
+  return p + 1;
+}
+
+/** Same as above, ignoring the name */
+constexpr const char* parse_placeholder(const char* str, FormatSpec& spec, bool& invalid)
+{
+  std::size_t nameSize = 0;
+  return parse_placeholder(str, spec, invalid, nameSize);
+}
+
+/** @returns the number of placeholders ({}, {:spec}, {name} or {name:spec}) in the null terminated `str` */
+constexpr std::size_t count_placeholders(const char* str)
+{
+  std::size_t result = 0;
+  FormatSpec spec;
+  bool invalid = false;
+  for (std::size_t i = 0; str[i] != 0;)
+  {
+    const char* end = parse_placeholder(str + i, spec, invalid);
+    if (end != nullptr)
+    {
+      ++result;
+      i = std::size_t(end - str);
+    }
+    else
+    {
+      ++i;
+    }
+  }
+
+  return result;
+}
+
+/** @returns true if [a, a+size) equals [b, b+size) */
+constexpr bool names_equal(const char* a, const char* b, std::size_t size)
+{
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    if (a[i] != b[i]) { return false; }
+  }
+  return true;
+}
+
+/**
+ * @returns the index of the placeholder named [name, name+nameSize)
+ *          of the null terminated `str`, or std::size_t(-1), if there's none.
+ *          The index is the position of the argument substituting the placeholder.
+ */
+constexpr std::size_t find_placeholder(const char* str, const char* name, std::size_t nameSize)
+{
+  std::size_t index = 0;
+  FormatSpec spec;
+  bool invalid = false;
+  std::size_t size = 0;
+  for (std::size_t i = 0; str[i] != 0;)
+  {
+    const char* end = parse_placeholder(str + i, spec, invalid, size);
+    if (end == nullptr)
+    {
+      ++i;
+      continue;
+    }
+
+    if (size == nameSize && nameSize != 0 && names_equal(str + i + 1, name, size)) { return index; }
+    ++index;
+    i = std::size_t(end - str);
+  }
+  return std::size_t(-1);
+}
+
+/**
+ * @returns true if every {: and {name: of the null terminated `str` begins a valid placeholder,
+ *          and the named placeholders have distinct names.
+ */
+constexpr bool placeholders_valid(const char* str)
+{
+  FormatSpec spec;
+  bool invalid = false;
+  std::size_t nameSize = 0;
+  std::size_t index = 0;
+  for (std::size_t i = 0; str[i] != 0;)
+  {
+    const char* end = parse_placeholder(str + i, spec, invalid, nameSize);
+    if (invalid) { return false; }
+    if (end == nullptr)
+    {
+      ++i;
+      continue;
+    }
+
+    if (nameSize != 0 && find_placeholder(str, str + i + 1, nameSize) != index) { return false; } // duplicate
+    ++index;
+    i = std::size_t(end - str);
+  }
+  return true;
+}
+
+/**
+ * @returns true if the {name} and {name:spec} placeholders of `formatString`
+ *          substitute arguments, given the concatenated tags of the arguments.
+ *
+ * In format strings written before named placeholders, {name} is literal text.
+ * Those are told apart by the number of placeholders, that matches
+ * the number of arguments, if the names are placeholders.
+ */
+inline bool names_are_placeholders(const std::string& formatString, const std::string& argumentTags)
+{
+  std::size_t argumentCount = 0;
+  mserialize::string_view tags(argumentTags.data(), argumentTags.size());
+  while (! tags.empty())
+  {
+    mserialize::detail::tag_pop(tags);
+    ++argumentCount;
+  }
+  return count_placeholders(formatString.c_str()) == argumentCount;
+}
+
+/** @returns the names of the placeholders of `str`, in order, an empty string for the unnamed ones */
+inline std::vector<std::string> placeholder_names(const std::string& str)
+{
+  std::vector<std::string> result;
+  FormatSpec spec;
+  bool invalid = false;
+  std::size_t nameSize = 0;
+  for (std::size_t i = 0; i < str.size();)
+  {
+    const char* end = parse_placeholder(str.c_str() + i, spec, invalid, nameSize);
+    if (end == nullptr)
+    {
+      ++i;
+      continue;
+    }
+
+    result.emplace_back(str, i + 1, nameSize);
+    i = std::size_t(end - str.c_str());
+  }
+  return result;
+}
+
+} // namespace detail
+} // namespace binlog
+
+#endif // BINLOG_DETAIL_FORMAT_SPEC_HPP
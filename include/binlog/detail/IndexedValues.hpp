@@ -0,0 +1,92 @@
+#ifndef BINLOG_DETAIL_INDEXED_VALUES_HPP
+#define BINLOG_DETAIL_INDEXED_VALUES_HPP
+
+#include <binlog/Range.hpp>
+
+#include <mserialize/Visitor.hpp>
+#include <mserialize/string_view.hpp>
+#include <mserialize/visit.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace binlog {
+namespace detail {
+
+/** Calls `f(data, size)` with the integers (as decimal text) and strings it visits */
+template <typename F>
+class IndexedValueVisitor
+{
+public:
+  explicit IndexedValueVisitor(F& f) :_f(f) {}
+
+  template <typename T>
+  void visit(T value)
+  {
+    visitValue(value, std::is_integral<T>{});
+  }
+
+  void visit(bool) {}
+  void visit(char) {}
+
+  template <typename T, typename InputStream>
+  bool visit(T, InputStream&) { return false; }
+
+  /** Strings are sequences of chars */
+  template <typename InputStream>
+  bool visit(mserialize::Visitor::SequenceBegin sb, InputStream& input)
+  {
+    if (sb.tag != "c") { return false; }
+    _f(input.view(sb.size), sb.size);
+    return true;
+  }
+
+private:
+  template <typename T>
+  void visitValue(T value, std::true_type /* integral */)
+  {
+    char buffer[24];
+    char* end = buffer + sizeof(buffer);
+    char* p = end;
+
+    const bool negative = value < T{0};
+    std::uint64_t magnitude = (negative) ? 0 - std::uint64_t(value) : std::uint64_t(value);
+    do
+    {
+      *--p = char('0' + magnitude % 10);
+      magnitude /= 10;
+    } while (magnitude != 0);
+    if (negative) { *--p = '-'; }
+
+    _f(p, std::size_t(end - p));
+  }
+
+  template <typename T>
+  void visitValue(T, std::false_type /* not integral */) {}
+
+  F& _f;
+};
+
+/**
+ * Call `f(data, size)` for each integer (as decimal text, e.g: "-42")
+ * and string argument in `arguments`, serialized according to `tags`,
+ * also the ones nested in sequences, tuples and structures.
+ * Floating point, bool and char arguments are skipped.
+ *
+ * These values are indexed by IndexedOutputStream, and searched by `bread -F`.
+ *
+ * @throws std::runtime_error if `arguments` does not match `tags`
+ */
+template <typename F>
+void forEachIndexedValue(mserialize::string_view tags, Range arguments, F&& f)
+{
+  IndexedValueVisitor<F> visitor(f);
+  const std::string tuple = "(" + std::string(tags.data(), tags.size()) + ")";
+  mserialize::visit(mserialize::string_view(tuple.data(), tuple.size()), visitor, arguments);
+}
+
+} // namespace detail
+} // namespace binlog
+
+#endif // BINLOG_DETAIL_INDEXED_VALUES_HPP
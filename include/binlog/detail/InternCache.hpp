@@ -0,0 +1,69 @@
+#ifndef BINLOG_DETAIL_INTERN_CACHE_HPP
+#define BINLOG_DETAIL_INTERN_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring> // memcmp
+#include <string>
+#include <unordered_map>
+
+namespace binlog {
+namespace detail {
+
+/**
+ * Maps strings to the ids assigned to them by Session::addInternedString.
+ *
+ * Looked up by a pointer and a size, to not construct
+ * a std::string for each interned argument of an event.
+ * Not thread-safe, owned by a single writer.
+ */
+class InternCache
+{
+public:
+  /** @returns the id of the string [data, data+size), or 0, if it is not cached */
+  std::uint64_t find(const char* data, std::size_t size) const
+  {
+    const auto range = _entries.equal_range(hash(data, size));
+    for (auto it = range.first; it != range.second; ++it)
+    {
+      const std::string& value = it->second.value;
+      if (value.size() == size && (size == 0 || memcmp(value.data(), data, size) == 0))
+      {
+        return it->second.id;
+      }
+    }
+    return 0;
+  }
+
+  /** Cache `id` for the string [data, data+size) */
+  void insert(const char* data, std::size_t size, std::uint64_t id)
+  {
+    _entries.emplace(hash(data, size), Entry{std::string(data, size), id});
+  }
+
+private:
+  /** FNV-1a */
+  static std::size_t hash(const char* data, std::size_t size)
+  {
+    std::uint64_t result = 0xcbf29ce484222325;
+    for (std::size_t i = 0; i < size; ++i)
+    {
+      result ^= std::uint8_t(data[i]);
+      result *= 0x100000001b3;
+    }
+    return std::size_t(result);
+  }
+
+  struct Entry
+  {
+    std::string value;
+    std::uint64_t id;
+  };
+
+  std::unordered_multimap<std::size_t, Entry> _entries; // by hash of value
+};
+
+} // namespace detail
+} // namespace binlog
+
+#endif // BINLOG_DETAIL_INTERN_CACHE_HPP
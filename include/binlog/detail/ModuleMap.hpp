@@ -0,0 +1,94 @@
+#ifndef BINLOG_DETAIL_MODULE_MAP_HPP
+#define BINLOG_DETAIL_MODULE_MAP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio> // snprintf
+#include <string>
+
+#ifdef __linux__
+  #include <link.h> // dl_iterate_phdr
+  #include <unistd.h> // readlink
+#endif
+
+namespace binlog {
+namespace detail {
+
+/**
+ * @returns a number that changes if a module (the executable
+ *          or a shared library) is loaded or unloaded, or 0,
+ *          if modules cannot be enumerated on this platform.
+ */
+inline std::uint64_t moduleGeneration()
+{
+#ifdef __linux__
+  std::uint64_t result = 0;
+  dl_iterate_phdr([](dl_phdr_info* info, std::size_t, void* data) -> int
+  {
+    *static_cast<std::uint64_t*>(data) = info->dlpi_adds + info->dlpi_subs;
+    return 1; // the counters are the same in each module, stop
+  }, &result);
+  return result;
+#else
+  return 0;
+#endif
+}
+
+/**
+ * @returns the loaded modules, one line each: "begin end base path\n",
+ *          where [begin, end) is the address range of the loadable segments,
+ *          and base is the load address, which symbol values are relative to,
+ *          all in hex. Empty if modules cannot be enumerated on this platform.
+ *
+ * Read by PrettyPrinter, to print the frames of a binlog::Stacktrace.
+ */
+inline std::string loadedModules()
+{
+  std::string result;
+
+#ifdef __linux__
+  dl_iterate_phdr([](dl_phdr_info* info, std::size_t, void* data) -> int
+  {
+    std::uint64_t begin = ~std::uint64_t(0);
+    std::uint64_t end = 0;
+    for (int i = 0; i < info->dlpi_phnum; ++i)
+    {
+      const auto& ph = info->dlpi_phdr[i];
+      if (ph.p_type != PT_LOAD) { continue; }
+      const std::uint64_t segment = std::uint64_t(info->dlpi_addr + ph.p_vaddr);
+      if (segment < begin) { begin = segment; }
+      if (segment + ph.p_memsz > end) { end = segment + ph.p_memsz; }
+    }
+    if (begin >= end) { return 0; }
+
+    std::string path = (info->dlpi_name != nullptr) ? info->dlpi_name : "";
+    if (path.empty())
+    {
+      // the main program
+      char buffer[4096];
+      const ssize_t size = readlink("/proc/self/exe", buffer, sizeof(buffer));
+      if (size > 0) { path.assign(buffer, std::size_t(size)); }
+    }
+
+    char range[64];
+    snprintf(range, sizeof(range), "%llx %llx %llx ",
+      static_cast<unsigned long long>(begin), // NOLINT(google-runtime-int)
+      static_cast<unsigned long long>(end),   // NOLINT(google-runtime-int)
+      static_cast<unsigned long long>(info->dlpi_addr) // NOLINT(google-runtime-int)
+    );
+
+    std::string& out = *static_cast<std::string*>(data);
+    out += range;
+    out += path;
+    out += '\n';
+    return 0;
+  }, &result);
+#endif
+
+  return result;
+}
+
+} // namespace detail
+} // namespace binlog
+
+#endif // BINLOG_DETAIL_MODULE_MAP_HPP
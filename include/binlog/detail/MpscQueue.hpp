@@ -0,0 +1,208 @@
+#ifndef BINLOG_DETAIL_MPSC_QUEUE_HPP
+#define BINLOG_DETAIL_MPSC_QUEUE_HPP
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring> // memset
+#include <vector>
+
+namespace binlog {
+namespace detail {
+
+/**
+ * A multi producer, single consumer, concurrent queue of size prefixed entries.
+ *
+ * Unlike Queue, this queue can be written by several threads concurrently,
+ * without locking:
+ *
+ *    MpscQueue q(buffer, sizeof(buffer));
+ *
+ *    // on any thread:
+ *    if (char* payload = q.beginWrite(16))
+ *    {
+ *      memcpy(payload, data, 16);
+ *      q.endWrite(payload, 16);
+ *    }
+ *    // else: queue is full
+ *
+ *    // on the consumer thread:
+ *    std::vector<char> entries;
+ *    const std::uint64_t end = q.beginRead(entries); // [size|payload] entries
+ *    consume(entries);
+ *    q.endRead(end);
+ *
+ * Internally, the queue maintains two monotonic byte positions:
+ *  - W: the end of the reserved entries, moved by the writers
+ *  - R: the end of the consumed entries, moved by the reader
+ *
+ * A writer reserves an entry by moving W (by compare and swap,
+ * to fail if the reservation would overwrite unconsumed entries),
+ * writes the payload, then commits the entry by storing its size prefix.
+ * Each entry starts at a 4 byte aligned position, so the size prefix
+ * can be stored atomically: a zero size marks an uncommitted entry.
+ * If an entry does not fit before the end of the buffer, the writer
+ * marks the rest of the buffer as skipped, and continues at the beginning.
+ *
+ * The reader copies the committed entries from R to the first uncommitted one,
+ * dropping the alignment padding, then zeroes the consumed area, to make
+ * the uncommitted entries recognizable again, and moves R.
+ * A writer preempted before committing stalls the reader (but not the other writers)
+ * until it commits.
+ */
+class MpscQueue
+{
+public:
+  static constexpr std::uint32_t skipMarker = std::uint32_t(-1);
+
+  /**
+   * Construct a queue using the provided `buffer`.
+   *
+   * @pre [buffer,buffer+capacity) must be valid, `buffer` must be 4 byte aligned
+   */
+  MpscQueue(char* buffer, std::size_t capacity)
+    :_buffer(buffer),
+     _capacity(capacity / alignment * alignment)
+  {
+    assert(reinterpret_cast<std::uintptr_t>(buffer) % alignment == 0);
+    memset(_buffer, 0, _capacity);
+  }
+
+  MpscQueue(const MpscQueue&) = delete;
+  void operator=(const MpscQueue&) = delete;
+
+  /** @returns the number of bytes the queue can store, including size prefixes and padding */
+  std::size_t capacity() const { return _capacity; }
+
+  /**
+   * Reserve an entry of `size` bytes (excluding the size prefix).
+   *
+   * @returns a pointer to the payload of the entry, to be committed by endWrite,
+   *          or nullptr, if the queue does not have enough free space.
+   */
+  char* beginWrite(std::uint32_t size) noexcept
+  {
+    assert(size != 0 && size != skipMarker);
+
+    const std::uint64_t entrySize = alignedSize(sizeof(std::uint32_t) + std::uint64_t(size));
+    if (entrySize > _capacity) { return nullptr; }
+
+    std::uint64_t w = _writeIndex.load(std::memory_order_relaxed);
+    std::uint64_t skipSize = 0;
+    do
+    {
+      const std::uint64_t offset = w % _capacity;
+      skipSize = (offset + entrySize > _capacity) ? _capacity - offset : 0;
+      if (w + skipSize + entrySize - _readIndex.load(std::memory_order_acquire) > _capacity)
+      {
+        return nullptr;
+      }
+    } while (! _writeIndex.compare_exchange_weak(w, w + skipSize + entrySize, std::memory_order_relaxed));
+
+    if (skipSize != 0)
+    {
+      sizePrefix(w % _capacity).store(skipMarker, std::memory_order_release);
+      w += skipSize;
+    }
+
+    return _buffer + w % _capacity + sizeof(std::uint32_t);
+  }
+
+  /** Make the entry returned by beginWrite available to read */
+  void endWrite(char* payload, std::uint32_t size) noexcept
+  {
+    const std::size_t offset = std::size_t(payload - _buffer) - sizeof(std::uint32_t);
+    sizePrefix(offset).store(size, std::memory_order_release);
+  }
+
+  /**
+   * Append the committed entries, [uint32_t size][size bytes] each, to `out`.
+   *
+   * Entries are appended until `out` would grow by more than `maxSize` bytes,
+   * but if `atLeastOne` is true, the first committed entry is appended anyway.
+   *
+   * @returns the position to be passed to endRead
+   */
+  std::uint64_t beginRead(std::vector<char>& out, std::size_t maxSize = std::size_t(-1), bool atLeastOne = true)
+  {
+    const std::size_t outBegin = out.size();
+    const std::uint64_t w = _writeIndex.load(std::memory_order_acquire);
+    std::uint64_t r = _readIndex.load(std::memory_order_relaxed);
+
+    while (r < w)
+    {
+      const std::size_t offset = std::size_t(r % _capacity);
+      const std::uint32_t size = sizePrefix(offset).load(std::memory_order_acquire);
+      if (size == 0) { break; } // not committed yet
+
+      if (size == skipMarker)
+      {
+        r += _capacity - offset;
+        continue;
+      }
+
+      const std::size_t copied = out.size() - outBegin;
+      if (copied + sizeof(std::uint32_t) + size > maxSize && ! (atLeastOne && copied == 0)) { break; } // over budget
+
+      const char* entry = _buffer + offset;
+      out.insert(out.end(), entry, entry + sizeof(std::uint32_t) + size);
+      r += alignedSize(sizeof(std::uint32_t) + std::uint64_t(size));
+    }
+
+    return r;
+  }
+
+  /** @returns true if every reserved entry is before `end`, returned by beginRead */
+  bool readAll(std::uint64_t end) const
+  {
+    return end == _writeIndex.load(std::memory_order_acquire);
+  }
+
+  /** Make the entries read by beginRead, until `end`, available to write. */
+  void endRead(std::uint64_t end)
+  {
+    const std::uint64_t r = _readIndex.load(std::memory_order_relaxed);
+    if (end == r) { return; }
+
+    const std::size_t begin = std::size_t(r % _capacity);
+    const std::size_t endOffset = std::size_t(end % _capacity);
+    if (begin < endOffset)
+    {
+      memset(_buffer + begin, 0, endOffset - begin);
+    }
+    else // wrapped around
+    {
+      memset(_buffer + begin, 0, _capacity - begin);
+      memset(_buffer, 0, endOffset);
+    }
+
+    _readIndex.store(end, std::memory_order_release);
+  }
+
+private:
+  static constexpr std::uint64_t alignment = sizeof(std::uint32_t);
+  static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t), "size prefix must be accessible atomically");
+
+  static std::uint64_t alignedSize(std::uint64_t size)
+  {
+    return (size + alignment - 1) / alignment * alignment;
+  }
+
+  std::atomic<std::uint32_t>& sizePrefix(std::size_t offset)
+  {
+    return *reinterpret_cast<std::atomic<std::uint32_t>*>(_buffer + offset); // NOLINT
+  }
+
+  char* _buffer;
+  std::size_t _capacity;
+
+  std::atomic<std::uint64_t> _writeIndex{0};
+  char _writerPadding[64]; // separates the index of the writers and the reader // NOLINT
+  std::atomic<std::uint64_t> _readIndex{0};
+};
+
+} // namespace detail
+} // namespace binlog
+
+#endif // BINLOG_DETAIL_MPSC_QUEUE_HPP
@@ -0,0 +1,90 @@
+#ifndef BINLOG_DETAIL_NON_TEMPORAL_HPP
+#define BINLOG_DETAIL_NON_TEMPORAL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring> // memcpy
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+  #define BINLOG_HAS_NON_TEMPORAL_STORES
+  #include <emmintrin.h> // NOLINT _mm_stream_si128, _mm_sfence
+#endif
+
+namespace binlog {
+namespace detail {
+
+/**
+ * Copy [src, src+size) to `dst`, bypassing the cache of the caller if possible.
+ *
+ * Uses non-temporal (streaming) stores on x86-64, memcpy elsewhere.
+ * The destination lines are not pulled into the cache, the working set
+ * of the caller is not evicted by large copies.
+ * The stores are weakly ordered: call nonTemporalFence
+ * before publishing the copied bytes to an other thread.
+ */
+inline void nonTemporalCopy(char* dst, const void* src, std::size_t size)
+{
+#ifdef BINLOG_HAS_NON_TEMPORAL_STORES
+  const char* s = static_cast<const char*>(src);
+
+  // streaming stores need 16 byte aligned destinations
+  const std::size_t head = (16 - (reinterpret_cast<std::uintptr_t>(dst) & 15)) & 15;
+  if (head >= size)
+  {
+    memcpy(dst, s, size);
+    return;
+  }
+  memcpy(dst, s, head);
+  dst += head;
+  s += head;
+  size -= head;
+
+  for (; size >= 64; size -= 64, dst += 64, s += 64)
+  {
+    const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 16));
+    const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 32));
+    const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 48));
+    _mm_stream_si128(reinterpret_cast<__m128i*>(dst), a);
+    _mm_stream_si128(reinterpret_cast<__m128i*>(dst + 16), b);
+    _mm_stream_si128(reinterpret_cast<__m128i*>(dst + 32), c);
+    _mm_stream_si128(reinterpret_cast<__m128i*>(dst + 48), d);
+  }
+
+  for (; size >= 16; size -= 16, dst += 16, s += 16)
+  {
+    _mm_stream_si128(reinterpret_cast<__m128i*>(dst), _mm_loadu_si128(reinterpret_cast<const __m128i*>(s)));
+  }
+
+  memcpy(dst, s, size);
+#else
+  memcpy(dst, src, size);
+#endif
+}
+
+/** Order the preceding non-temporal stores before the following stores, see nonTemporalCopy */
+inline void nonTemporalFence()
+{
+#ifdef BINLOG_HAS_NON_TEMPORAL_STORES
+  _mm_sfence();
+#endif
+}
+
+/** Hint the processor to load [p, p+size) into the cache (best effort) */
+inline void prefetchRange(const char* p, std::size_t size)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  for (std::size_t offset = 0; offset < size; offset += 64)
+  {
+    __builtin_prefetch(p + offset);
+  }
+#else
+  static_cast<void>(p);
+  static_cast<void>(size);
+#endif
+}
+
+} // namespace detail
+} // namespace binlog
+
+#endif // BINLOG_DETAIL_NON_TEMPORAL_HPP
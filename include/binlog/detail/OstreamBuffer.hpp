@@ -55,6 +55,14 @@ public:
   OstreamBuffer& operator<<(std::uint32_t v) { writeUnsigned(v); return *this; }
   OstreamBuffer& operator<<(std::uint64_t v) { writeUnsigned(v); return *this; }
 
+  /**
+   * Write floats and doubles as printf("%.*g", P) would,
+   * where P is the number of digits of the shortest
+   * representation that reads back as the same value, but at least 6:
+   * values printed by %g without loss are printed the same way.
+   * Long doubles are written by printf("%Lg").
+   */
+  OstreamBuffer& operator<<(float);
   OstreamBuffer& operator<<(double);
   OstreamBuffer& operator<<(long double);
 
@@ -76,6 +84,20 @@ public:
     return *this;
   }
 
+  /**
+   * Write each byte of [data, data+size) as two lowercase hexadecimal digits,
+   * e.g: {0x0a, 0xff} as "0aff".
+   */
+  void writeHex(const char* data, std::size_t size);
+
+  /**
+   * Write `value` divided by 10^`scale` exactly, with `scale` fractional digits,
+   * e.g: (-12345, 2) as "-123.45", (5, 3) as "0.005", (7, 0) as "7".
+   *
+   * @pre scale <= 19
+   */
+  void writeFixedPoint(std::int64_t value, unsigned scale);
+
   void flush();
 
 private:
@@ -0,0 +1,31 @@
+#ifndef BINLOG_DETAIL_PROBES_HPP
+#define BINLOG_DETAIL_PROBES_HPP
+
+/**
+ * Static tracepoints (USDT probes) of the hot paths, for bpftrace, perf, or SystemTap.
+ *
+ * Disabled by default. If BINLOG_USDT_PROBES is defined (for the whole program),
+ * the probes are compiled in, using <sys/sdt.h> (e.g: from systemtap-sdt-dev).
+ * A probe costs a single nop instruction if no tracer is attached.
+ * Probes of the provider `binlog`:
+ *
+ *    add_event(source id, size)           // SessionWriter added an event of `size` bytes
+ *    replace_channel(old capacity, new capacity, success) // SessionWriter replaced its queue
+ *    consume(channels polled, bytes consumed)             // Session::consume finished
+ *
+ * Example:
+ *
+ *    bpftrace -e 'usdt:./myapp:binlog:add_event { @size = hist(arg1); }'
+ */
+
+#ifdef BINLOG_USDT_PROBES
+  #include <sys/sdt.h> // NOLINT
+
+  #define BINLOG_DETAIL_PROBE2(name, a, b) DTRACE_PROBE2(binlog, name, a, b)
+  #define BINLOG_DETAIL_PROBE3(name, a, b, c) DTRACE_PROBE3(binlog, name, a, b, c)
+#else
+  #define BINLOG_DETAIL_PROBE2(name, a, b) static_cast<void>(0)
+  #define BINLOG_DETAIL_PROBE3(name, a, b, c) static_cast<void>(0)
+#endif
+
+#endif // BINLOG_DETAIL_PROBES_HPP
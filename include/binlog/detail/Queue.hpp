@@ -89,19 +89,48 @@ namespace detail {
  * The writer continues writing the beginning of the queue.
  * The reader will notice that E is reached, so it will
  * also wrap around, starting again from the beginning.
+ *
+ * If the queue holds size prefixed entries, the writer can also
+ * make space by discarding the oldest entries (see QueueWriter::beginOverwrite),
+ * moving R forward entry by entry - while the reader does not read the queue.
+ * This turns the queue into a ring, which keeps the most recent entries.
+ *
+ * If the buffer is mirrored, i.e: the `capacity` bytes after the buffer
+ * map the same memory as the buffer itself (see MirroredChannelAllocator),
+ * the writer does not wrap by abandoning the end of the buffer:
+ * writes and reads continue past the end, into the mirror,
+ * and every read and write is a single contiguous span.
+ * The indices remain below capacity, E is always capacity.
+ * As the mirror is not part of memory dumps in general,
+ * the data of a mirrored queue can be still recovered as two spans.
+ *
+ * To avoid false sharing, the members written by the writer
+ * and the member written by the reader are separated by
+ * a cache line of padding, and the latter is followed by another one,
+ * to keep it away from the buffer (often placed right after the queue).
+ * Padding is used instead of alignas, to keep the alignment
+ * of the queue natural: the placement of the queue
+ * in a Session channel must remain recoverable from memory dumps.
+ * The indices of the other side are not polled:
+ * the writer loads R only if its current contiguous writable arena is exhausted,
+ * the reader loads W once per read batch.
  */
 struct Queue
 {
+  static constexpr std::size_t cacheLineSize = 64;
+
   /**
    * Construct a queue using the provided `buffer`.
    *
-   * @pre [buffer,buffer+capacity) must be valid
+   * @pre [buffer,buffer+capacity) must be valid,
+   *      and if `mirrored_`, [buffer+capacity,buffer+2*capacity) must map the same memory
    */
-  explicit Queue(char* buffer_, std::size_t capacity_)
+  explicit Queue(char* buffer_, std::size_t capacity_, bool mirrored_ = false)
     :writeIndex(0),
-     dataEnd(0),
+     dataEnd(mirrored_ ? capacity_ : 0),
      capacity(capacity_),
      buffer(buffer_),
+     mirrored(mirrored_),
      readIndex(0)
   {}
 
@@ -110,9 +139,14 @@ struct Queue
   std::size_t dataEnd;                 /**< No valid data after this index */
   std::size_t capacity;                /**< Buffer size */
   char* buffer;                        /**< Unmanaged underlying buffer */
+  bool mirrored;                       /**< If true, the buffer is followed by its mirror */
+
+  char writerPadding[cacheLineSize - sizeof(bool)]; /**< Separates the members of the writer and the reader */
 
   // members written by Reader
   std::atomic<std::size_t> readIndex;  /**< Next index to read */
+
+  char readerPadding[cacheLineSize - sizeof(std::atomic<std::size_t>)]; /**< Separates readIndex from data placed after the queue */
 };
 
 } // namespace detail
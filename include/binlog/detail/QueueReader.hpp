@@ -1,6 +1,7 @@
 #ifndef BINLOG_DETAIL_QUEUE_READER_HPP
 #define BINLOG_DETAIL_QUEUE_READER_HPP
 
+#include <binlog/detail/Concurrency.hpp>
 #include <binlog/detail/Queue.hpp>
 
 #include <atomic>
@@ -38,43 +39,78 @@ public:
    * this method returns two buffers.
    * If the first buffer is empty, the queue was empty,
    * if the second part is empty, there was no wrap-around.
+   * The second part of a mirrored queue is always empty.
    *
    * @returns A two-buffer view of the readable data
    */
   ReadResult beginRead()
   {
-    const std::size_t w = _queue->writeIndex.load(std::memory_order_acquire);
+    const std::size_t w = _queue->writeIndex.load(memoryOrderAcquire);
     const std::size_t r = _queue->readIndex.load(std::memory_order_relaxed);
 
     _readEnd = w;
 
     if (r <= w)  // [...R######W...]
     {
-      return ReadResult{buffer() + r, w - r, nullptr, 0};
+      return setRead(r, ReadResult{buffer() + r, w - r, nullptr, 0});
+    }
+
+    if (_queue->mirrored) // [###W...R###][###W...R###], read into the mirror
+    {
+      return setRead(r, ReadResult{buffer() + r, _queue->capacity - r + w, nullptr, 0});
     }
 
     if (r < _queue->dataEnd)  // [###W...R###E..]
     {
-      return ReadResult{
+      return setRead(r, ReadResult{
         buffer() + r, _queue->dataEnd - r,
         buffer(), w
-      };
+      });
     }
 
     // [###W......RE..]
-    return ReadResult{buffer(), w, nullptr, 0};
+    return setRead(0, ReadResult{buffer(), w, nullptr, 0});
   }
 
   /** Make the consumed parts of the internal buffer available to write. */
   void endRead()
   {
-    _queue->readIndex.store(_readEnd, std::memory_order_release);
+    _queue->readIndex.store(_readEnd, memoryOrderRelease);
+  }
+
+  /**
+   * Make the first `size` bytes of the last beginRead result
+   * available to write. The rest remains readable by the next beginRead.
+   *
+   * @pre size <= beginRead().size()
+   */
+  void endRead(std::size_t size)
+  {
+    if (size == _readSize) { endRead(); }
+    else if (size < _readSize1)
+    {
+      std::size_t r = _readBegin + size;
+      if (r >= _queue->capacity) { r -= _queue->capacity; } // mirrored, continue at the beginning
+      _queue->readIndex.store(r, memoryOrderRelease);
+    }
+    else { _queue->readIndex.store(size - _readSize1, memoryOrderRelease); } // continue at the beginning
   }
 
 private:
   char* buffer() { return _queue->buffer; }
 
+  ReadResult setRead(std::size_t begin, const ReadResult& result)
+  {
+    _readBegin = begin;
+    _readSize1 = result.size1;
+    _readSize = result.size();
+    return result;
+  }
+
   Queue* _queue;
+  std::size_t _readBegin = 0; // the position of the last read, see endRead(size)
+  std::size_t _readSize1 = 0;
+  std::size_t _readSize = 0;
   std::size_t _readEnd = 0;
 };
 
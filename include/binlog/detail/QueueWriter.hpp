@@ -1,6 +1,8 @@
 #ifndef BINLOG_DETAIL_QUEUE_WRITER_HPP
 #define BINLOG_DETAIL_QUEUE_WRITER_HPP
 
+#include <binlog/detail/Concurrency.hpp>
+#include <binlog/detail/NonTemporal.hpp>
 #include <binlog/detail/Queue.hpp>
 
 #include <atomic>
@@ -29,6 +31,17 @@ public:
   /** @returns the maximum number of bytes the queue can store */
   std::size_t capacity() const { return _queue->capacity; }
 
+  /**
+   * Copy writes of at least `threshold` bytes by non-temporal stores,
+   * bypassing the cache of the writer, see nonTemporalCopy.
+   *
+   * @param threshold 0 (the default) disables non-temporal writes
+   */
+  void setNonTemporalThreshold(std::size_t threshold)
+  {
+    _nonTemporalThreshold = (threshold != 0) ? threshold : std::size_t{noThreshold};
+  }
+
   /** @returns the number of bytes currently available for write */
   std::size_t writeCapacity() const
   {
@@ -39,7 +52,7 @@ public:
   std::size_t unreadWriteSize() const
   {
     const std::size_t w = _queue->writeIndex.load(std::memory_order_relaxed);
-    const std::size_t r = _queue->readIndex.load(std::memory_order_acquire);
+    const std::size_t r = _queue->readIndex.load(memoryOrderAcquire);
 
     return (r <= w)
       ? std::size_t(w - r)
@@ -63,6 +76,27 @@ public:
       : size <= maximizeWriteCapacity();
   }
 
+  /**
+   * Like beginWrite, but if the free space is not enough,
+   * discard the oldest entries of the queue, until `size` bytes fit.
+   *
+   * The queue must hold size prefixed entries: [uint32_t size][size bytes],
+   * and each committed write must end on an entry boundary.
+   * The read index is moved entry by entry, therefore
+   * it always points to the oldest intact entry.
+   *
+   * @pre the reader does not read the queue concurrently
+   * @returns `size` <= writeCapacity()
+   */
+  bool beginOverwrite(std::size_t size)
+  {
+    while (! beginWrite(size))
+    {
+      if (! discardOldest()) { return false; }
+    }
+    return true;
+  }
+
   /**
    * Copy the range [src,src+size) to the internal write buffer.
    *
@@ -75,11 +109,47 @@ public:
   {
     assert(_writePos + size <= _writeEnd);
 
-    void* result = memcpy(_writePos, src, size);
+    void* result = _writePos;
+    if (size >= _nonTemporalThreshold)
+    {
+      nonTemporalCopy(_writePos, src, size);
+      _nonTemporalPending = true;
+    }
+    else
+    {
+      memcpy(_writePos, src, size);
+    }
+    _writePos += size;
+    return result;
+  }
+
+  /**
+   * Reserve `size` bytes of the internal write buffer, to be written by the caller.
+   *
+   * Like writeBuffer, but without copying: the caller
+   * writes the bytes in place, e.g: by a decoder.
+   *
+   * @pre writeCapacity() >= `size`
+   * @post writeCapacity() -= `size`
+   * @returns A pointer to the reserved `size` bytes,
+   * which pointer remains valid until the next `beginWrite()` or `endWrite()`.
+   */
+  char* reserveBuffer(std::size_t size)
+  {
+    assert(_writePos + size <= _writeEnd);
+
+    char* result = _writePos;
     _writePos += size;
     return result;
   }
 
+  /**
+   * @returns a pointer to the beginning of the internal write buffer,
+   * to write at most writeCapacity() bytes in place.
+   * The written bytes are to be claimed by reserveBuffer.
+   */
+  char* writeBegin() { return _writePos; }
+
   /** Same as writeBuffer(src, size) */
   void* write(const void* src, std::streamsize size)
   {
@@ -89,8 +159,15 @@ public:
   /** Make the written parts of the internal buffer available to read. */
   void endWrite()
   {
-    const std::size_t newW = std::size_t(_writePos - buffer());
-    _queue->writeIndex.store(newW, std::memory_order_release);
+    if (_nonTemporalPending) // make the streamed bytes visible before the index
+    {
+      nonTemporalFence();
+      _nonTemporalPending = false;
+    }
+
+    std::size_t newW = std::size_t(_writePos - buffer());
+    if (newW >= _queue->capacity && _queue->mirrored) { newW -= _queue->capacity; } // continue in the mirror
+    _queue->writeIndex.store(newW, memoryOrderRelease);
   }
 
 private:
@@ -107,9 +184,15 @@ private:
   std::size_t maximizeWriteCapacity()
   {
     const std::size_t w = _queue->writeIndex.load(std::memory_order_relaxed);
-    const std::size_t r = _queue->readIndex.load(std::memory_order_acquire);
+    const std::size_t r = _queue->readIndex.load(memoryOrderAcquire);
 
-    if (w < r) // [####W.....R###E..]
+    if (_queue->mirrored) // the free bytes are contiguous, crossing the end into the mirror
+    {
+      const std::size_t used = (r <= w) ? w - r : _queue->capacity - r + w;
+      _writePos = buffer() + w;
+      _writeEnd = buffer() + w + (_queue->capacity - used - 1);
+    }
+    else if (w < r) // [####W.....R###E..]
     {
       _writePos = buffer() + w;
       _writeEnd = buffer() + r - 1;
@@ -135,12 +218,48 @@ private:
     return writeCapacity();
   }
 
+  /**
+   * Move the read index past the oldest entry.
+   *
+   * @pre the reader does not read the queue concurrently
+   * @returns false if the queue is empty
+   */
+  bool discardOldest()
+  {
+    const std::size_t w = _queue->writeIndex.load(std::memory_order_relaxed);
+    std::size_t r = _queue->readIndex.load(memoryOrderAcquire);
+
+    if (r > w && r == _queue->dataEnd) // [###W......RE..], wrap around, as the reader would
+    {
+      r = 0;
+    }
+    else if (r == w) // empty
+    {
+      return false;
+    }
+    else
+    {
+      std::uint32_t entrySize = 0;
+      memcpy(&entrySize, buffer() + r, sizeof(entrySize));
+      r += sizeof(entrySize) + entrySize;
+      if (r >= _queue->capacity && _queue->mirrored) { r -= _queue->capacity; }
+    }
+
+    _queue->readIndex.store(r, memoryOrderRelease);
+    return true;
+  }
+
   char* buffer() { return _queue->buffer; }
 
+  static constexpr std::size_t noThreshold = ~std::size_t{0};
+
   Queue* _queue;
 
   char* _writePos;
   char* _writeEnd;
+
+  std::size_t _nonTemporalThreshold = noThreshold;
+  bool _nonTemporalPending = false; /**< If true, uncommitted writes used non-temporal stores */
 };
 
 } // namespace detail
@@ -0,0 +1,39 @@
+#ifndef BINLOG_DETAIL_RDTSC_HPP
+#define BINLOG_DETAIL_RDTSC_HPP
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+  #include <intrin.h> // NOLINT __rdtsc, __cpuid
+  #define BINLOG_DETAIL_HAS_RDTSC 1
+#elif defined(__i386__) || defined(__x86_64__)
+  #include <cpuid.h> // NOLINT __get_cpuid
+  #include <x86intrin.h> // NOLINT __rdtsc
+  #define BINLOG_DETAIL_HAS_RDTSC 1
+#endif
+
+namespace binlog {
+namespace detail {
+
+/**
+ * @returns the current value of the Time Stamp Counter,
+ * or the nanoseconds of std::chrono::steady_clock if there is no TSC.
+ *
+ * Only meaningful as a difference, to measure short durations.
+ */
+inline std::uint64_t rdtsc()
+{
+  #ifdef BINLOG_DETAIL_HAS_RDTSC
+    return std::uint64_t(__rdtsc());
+  #else
+    return std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()
+    ).count());
+  #endif
+}
+
+} // namespace detail
+} // namespace binlog
+
+#endif // BINLOG_DETAIL_RDTSC_HPP
@@ -75,6 +75,19 @@ public:
 
   mapped_type* end() const { return nullptr; }
 
+  /** Call `f(key, value)` for each element, in increasing order of the keys */
+  template <typename F>
+  void forEach(F&& f) const
+  {
+    for (std::size_t si = 0; si < _segments.size(); ++si)
+    {
+      for (std::size_t vi = 0; vi < _segments[si].size(); ++vi)
+      {
+        f(_offsets[si] + vi, _segments[si][vi]);
+      }
+    }
+  }
+
   const mapped_type* find(const key_type& key) const
   {
     const key_type si = segmentIndex(key);
@@ -0,0 +1,51 @@
+#ifndef BINLOG_DETAIL_SERIALIZATION_VIEW_HPP
+#define BINLOG_DETAIL_SERIALIZATION_VIEW_HPP
+
+#include <mserialize/detail/type_traits.hpp>
+#include <mserialize/serialize.hpp>
+
+#include <type_traits>
+#include <utility> // declval
+
+namespace binlog {
+namespace detail {
+
+/**
+ * A CustomSerializer<T> can provide:
+ *
+ *     static View view(const T& t);
+ *
+ * where View serializes to the same bytes as `t`,
+ * but is cheaper to measure and serialize, e.g: a string_view
+ * that remembers the result of strlen, instead of a const char*.
+ * SessionWriter::addEvent takes the view of such arguments once,
+ * and uses it to compute the size of the event and to serialize it.
+ */
+template <typename T, typename = void>
+struct has_serialization_view : std::false_type {};
+
+template <typename T>
+struct has_serialization_view<T, mserialize::detail::void_t<
+  decltype(mserialize::CustomSerializer<T>::view(std::declval<const T&>()))
+>> : std::true_type {};
+
+template <typename T>
+const T& serialization_view(const T& t, std::false_type) { return t; }
+
+template <typename T>
+auto serialization_view(const T& t, std::true_type)
+{
+  return mserialize::CustomSerializer<T>::view(t);
+}
+
+/** @returns the serialization view of `t` if available, `t` otherwise */
+template <typename T>
+decltype(auto) serialization_view(const T& t)
+{
+  return serialization_view(t, has_serialization_view<T>{});
+}
+
+} // namespace detail
+} // namespace binlog
+
+#endif // BINLOG_DETAIL_SERIALIZATION_VIEW_HPP
@@ -0,0 +1,62 @@
+#ifndef BINLOG_DETAIL_SOURCE_ID_MAP_HPP
+#define BINLOG_DETAIL_SOURCE_ID_MAP_HPP
+
+#include <algorithm> // max
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace binlog {
+namespace detail {
+
+/**
+ * Maps event source ids to values of T, T{} if not set.
+ *
+ * Source ids are allocated densely by Session, ids below
+ * maxDenseId are stored in a vector, indexed by id,
+ * larger ones (of unusual streams) in a map.
+ */
+template <typename T>
+class SourceIdMap
+{
+public:
+  static constexpr std::uint64_t maxDenseId = std::uint64_t(1) << 24;
+
+  void set(std::uint64_t id, T value)
+  {
+    if (id < maxDenseId)
+    {
+      if (id >= _dense.size())
+      {
+        _dense.resize((std::max)(std::size_t(id) + 1, 2 * _dense.size()));
+      }
+      _dense[std::size_t(id)] = value;
+    }
+    else
+    {
+      _sparse[id] = value;
+    }
+  }
+
+  /** @returns the value of `id`, or T{}, if it was not set */
+  T get(std::uint64_t id) const
+  {
+    if (id < _dense.size()) { return _dense[std::size_t(id)]; }
+    if (id < maxDenseId) { return T{}; }
+    const auto it = _sparse.find(id);
+    return (it != _sparse.end()) ? it->second : T{};
+  }
+
+private:
+  std::vector<T> _dense;
+  std::map<std::uint64_t, T> _sparse;
+};
+
+template <typename T>
+constexpr std::uint64_t SourceIdMap<T>::maxDenseId;
+
+} // namespace detail
+} // namespace binlog
+
+#endif // BINLOG_DETAIL_SOURCE_ID_MAP_HPP
@@ -0,0 +1,68 @@
+#ifndef BINLOG_DETAIL_STABLE_SOURCE_ID_HPP
+#define BINLOG_DETAIL_STABLE_SOURCE_ID_HPP
+
+#include <binlog/Severity.hpp>
+
+#include <cstdint>
+
+namespace binlog {
+namespace detail {
+
+/**
+ * Ids derived from the content of the event source, see Session::setStableSourceIds,
+ * have this bit set. The range of them is disjoint from the ids assigned
+ * in first-hit order (below) and of the EagerSourceRegistry (above).
+ */
+constexpr std::uint64_t stableSourceIdBit = std::uint64_t(1) << 61;
+
+/** @returns true if `id` is derived from the content of its event source */
+constexpr bool isStableSourceId(std::uint64_t id)
+{
+  return (id & (stableSourceIdBit | (std::uint64_t(3) << 62))) == stableSourceIdBit;
+}
+
+/** @returns `hash` updated with the bytes of `str` and a terminating zero, FNV-1a */
+constexpr std::uint64_t fnv1aString(std::uint64_t hash, const char* str)
+{
+  for (; *str != '\0'; ++str)
+  {
+    hash = (hash ^ static_cast<unsigned char>(*str)) * 1099511628211ULL;
+  }
+  return hash * 1099511628211ULL;
+}
+
+/** @returns `hash` updated with the 8 bytes of `value`, least significant first, FNV-1a */
+constexpr std::uint64_t fnv1aInteger(std::uint64_t hash, std::uint64_t value)
+{
+  for (int i = 0; i < 8; ++i)
+  {
+    hash = (hash ^ ((value >> (8 * i)) & 0xFF)) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+/**
+ * @returns the id of the event source made of the given fields,
+ *          the same in every process and run, see isStableSourceId.
+ *          Can be computed at compile time.
+ */
+constexpr std::uint64_t stableSourceId(
+  Severity severity, const char* category, const char* function,
+  const char* file, std::uint64_t line, const char* formatString, const char* argumentTags
+)
+{
+  std::uint64_t hash = 14695981039346656037ULL;
+  hash = fnv1aInteger(hash, std::uint64_t(severity));
+  hash = fnv1aString(hash, category);
+  hash = fnv1aString(hash, function);
+  hash = fnv1aString(hash, file);
+  hash = fnv1aInteger(hash, line);
+  hash = fnv1aString(hash, formatString);
+  hash = fnv1aString(hash, argumentTags);
+  return (hash & (stableSourceIdBit - 1)) | stableSourceIdBit;
+}
+
+} // namespace detail
+} // namespace binlog
+
+#endif // BINLOG_DETAIL_STABLE_SOURCE_ID_HPP
@@ -0,0 +1,55 @@
+#ifndef BINLOG_DETAIL_SYMBOLIZER_HPP
+#define BINLOG_DETAIL_SYMBOLIZER_HPP
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace binlog {
+namespace detail {
+
+/**
+ * Find the functions of code addresses, by the symbol tables of ELF files.
+ *
+ * Reads the .symtab and .dynsym sections of each module once,
+ * when first asked, and caches the result of each lookup.
+ * Names are demangled, if possible.
+ * Only 64 bit ELF files are supported, other files have no symbols.
+ * Not thread-safe.
+ */
+class Symbolizer
+{
+public:
+  /**
+   * @param path of the module (executable or shared library)
+   * @param offset of a code address, relative to the load address of the module
+   * @returns "function+0xoffset" of the function containing `offset`, or empty, if unknown
+   */
+  const std::string& symbolize(const std::string& path, std::uint64_t offset);
+
+private:
+  struct Symbol
+  {
+    std::uint64_t begin;
+    std::uint64_t size;
+    std::string name; // mangled
+  };
+
+  struct Module
+  {
+    std::vector<Symbol> symbols; // sorted by begin
+    std::unordered_map<std::uint64_t, std::string> results; // by offset
+  };
+
+  /** Read the function symbols of the ELF file at `path` to `module` */
+  static void readSymbols(const std::string& path, Module& module);
+
+  std::map<std::string, Module> _modules; // by path
+};
+
+} // namespace detail
+} // namespace binlog
+
+#endif // BINLOG_DETAIL_SYMBOLIZER_HPP
@@ -1,9 +1,13 @@
 #ifndef BINLOG_DETAIL_VECTOR_OUTPUT_STREAM_HPP
 #define BINLOG_DETAIL_VECTOR_OUTPUT_STREAM_HPP
 
+#include <algorithm> // max, upper_bound
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <deque>
 #include <ios> // streamsize
+#include <iterator>
 #include <vector>
 
 namespace binlog {
@@ -91,6 +95,29 @@ public:
     return *this;
   }
 
+  /** Remove the data, keep the header */
+  void clear()
+  {
+    _vector.resize(HeaderSize);
+    updateSize();
+  }
+
+  /** Make room for `capacity` bytes of data, without reallocation on write */
+  void reserve(std::size_t capacity)
+  {
+    if (_vector.capacity() >= HeaderSize + capacity) { return; }
+
+    const std::uint64_t magic = clearMagic();
+    _vector.reserve(HeaderSize + capacity);
+    setMagic(magic);
+  }
+
+  /** @returns the number of bytes the data can grow to without reallocation */
+  std::size_t capacity() const
+  {
+    return _vector.capacity() - HeaderSize;
+  }
+
   const char* data() const
   {
     return _vector.data() + HeaderSize;
@@ -129,6 +156,91 @@ private:
   std::vector<char> _vector;
 };
 
+/**
+ * Like a RecoverableVectorOutputStream, but the data is stored
+ * in segments, each a RecoverableVectorOutputStream of fixed capacity.
+ *
+ * Writes never reallocate (and copy) the data already written:
+ * the cost of a write does not depend on the size of the stream.
+ * The bytes of a write are stored in a single segment, therefore if every
+ * write is a complete entry, each segment is a valid binlog stream,
+ * recoverable on its own (with the same magic and id).
+ *
+ * @models mserialize::OutputStream
+ */
+class SegmentedRecoverableOutputStream
+{
+public:
+  /** Segments are allocated for `segmentCapacity` bytes, or the size of the write, if larger */
+  SegmentedRecoverableOutputStream(std::uint64_t magic, void* id, std::size_t segmentCapacity = 1 << 16)
+    :_magic(magic),
+     _id(id),
+     _segmentCapacity(segmentCapacity)
+  {}
+
+  SegmentedRecoverableOutputStream& write(const char* buffer, std::streamsize size)
+  {
+    const std::size_t usize = std::size_t(size);
+    if (_segments.empty() || _segments.back().capacity() - _segments.back().size() < usize)
+    {
+      _segments.emplace_back(_magic, _id);
+      _segments.back().reserve((std::max)(_segmentCapacity, usize));
+      _segmentBegins.push_back(_size);
+    }
+
+    _segments.back().write(buffer, size);
+    _size += usize;
+    return *this;
+  }
+
+  /** @returns the number of bytes written, in all segments */
+  std::size_t size() const { return _size; }
+
+  std::streamsize ssize() const { return std::streamsize(_size); }
+
+  std::size_t segmentCount() const { return _segments.size(); }
+
+  /**
+   * Call `f(const char* data, std::size_t size)` for each
+   * contiguous piece of the bytes [begin, end) of the stream, in order.
+   *
+   * @pre begin <= end <= size()
+   */
+  template <typename F>
+  void forEachPiece(std::size_t begin, std::size_t end, F&& f) const
+  {
+    if (begin == end) { return; }
+
+    auto it = std::upper_bound(_segmentBegins.begin(), _segmentBegins.end(), begin);
+    std::size_t i = std::size_t(std::distance(_segmentBegins.begin(), it)) - 1;
+    for (; i < _segments.size() && _segmentBegins[i] < end; ++i)
+    {
+      const std::size_t segmentBegin = _segmentBegins[i];
+      const std::size_t from = (std::max)(begin, segmentBegin) - segmentBegin;
+      const std::size_t to = (std::min)(end - segmentBegin, _segments[i].size());
+      f(_segments[i].data() + from, to - from);
+    }
+  }
+
+  /** Write the bytes [begin, end) of the stream to `out` @pre begin <= end <= size() */
+  template <typename OutputStream>
+  void copyTo(std::size_t begin, std::size_t end, OutputStream& out) const
+  {
+    forEachPiece(begin, end, [&out](const char* data, std::size_t size)
+    {
+      out.write(data, std::streamsize(size));
+    });
+  }
+
+private:
+  std::uint64_t _magic;
+  void* _id;
+  std::size_t _segmentCapacity;
+  std::deque<RecoverableVectorOutputStream> _segments; // deque: segments are never moved
+  std::vector<std::size_t> _segmentBegins; // offset of the first byte of each segment in the stream
+  std::size_t _size = 0;
+};
+
 } // namespace detail
 } // namespace binlog
 
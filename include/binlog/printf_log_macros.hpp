@@ -0,0 +1,347 @@
+#ifndef BINLOG_PRINTF_LOG_MACROS_HPP
+#define BINLOG_PRINTF_LOG_MACROS_HPP
+
+#include <binlog/NanoLogCpp.h>
+#include <binlog/Severity.hpp>
+#include <binlog/Time.hpp>
+#include <binlog/create_source_and_event.hpp>
+#include <binlog/default_session.hpp> // default_thread_local_writer
+#include <binlog/detail/CallSite.hpp>
+#include <binlog/detail/CompileTimeSeverity.hpp>
+#include <binlog/detail/FormatSpec.hpp>
+
+#include <mserialize/detail/preprocessor.hpp>
+#include <mserialize/tag.hpp>
+
+#include <cstddef>
+#include <type_traits> // integral_constant
+
+/**
+ * BINLOG_CREATE_SOURCE_AND_EVENT_PRINTF(writer, severity, category, clock, format, args...)
+ *
+ * Like BINLOG_CREATE_SOURCE_AND_EVENT_IF, but `format` is a printf style
+ * format string literal, e.g: "px=%.2f qty=%d".
+ *
+ * The format string is validated and converted to the {} form compile time:
+ * each conversion specification is replaced by a {} placeholder, and %% by %.
+ * The number of conversions must match the number of arguments,
+ * and each conversion must match the type of the corresponding argument:
+ *
+ *  - d,i,u,o,x,X,c: integer, character, bool or enum
+ *  - f,F,e,E,g,G,a,A: floating point
+ *  - s: anything but arithmetic types (e.g: strings, containers, structures)
+ *  - p: anything but arithmetic types (e.g: pointers, binlog::address)
+ *
+ * Flags, width, precision and length are accepted, but not applied:
+ * the arguments are printed the same way as by the other log macros.
+ * The dynamic width and precision (*), %n, and the {} sequence
+ * in `format` are not supported.
+ */
+#define BINLOG_CREATE_SOURCE_AND_EVENT_PRINTF(writer, severity, category, clock, /* format, */ ...) \
+  do {                                                                          \
+    struct _binlog_printf_format                                                \
+    {                                                                           \
+      static constexpr const char* str() { return MSERIALIZE_FIRST(__VA_ARGS__); } \
+    };                                                                          \
+    using _binlog_format = binlog::detail::PrintfFormat<_binlog_printf_format>; \
+    static_assert(_binlog_format::valid,                                        \
+      "Invalid printf format string (*, %n and {} are not supported)"           \
+    );                                                                          \
+    static_assert(                                                              \
+      _binlog_format::conversionCount+1 ==                                      \
+      decltype(binlog::detail::count_arguments(__VA_ARGS__))::value,            \
+      "Number of printf conversions in format string must match number of arguments" \
+    );                                                                          \
+    static_assert(                                                              \
+      binlog::detail::printf_arguments_match(_binlog_printf_format::str(),      \
+        decltype(binlog::detail::printf_argument_kinds(__VA_ARGS__))::value),   \
+      "printf conversion does not match the type of the argument"               \
+    );                                                                          \
+    BINLOG_DETAIL_IF_COMPILED_IN(severity, category)                            \
+    {                                                                           \
+      static binlog::detail::CallSite _binlog_site{severity, #category};        \
+      if (writer.session().isEnabled(_binlog_site))                             \
+      {                                                                         \
+        BINLOG_DETAIL_CREATE_SOURCE_AND_EVENT_WITH_FORMAT(                      \
+          _binlog_site.sourceId, &_binlog_site, writer, severity, category, clock, \
+          _binlog_format::value.data, __VA_ARGS__                               \
+        );                                                                      \
+      }                                                                         \
+    }                                                                           \
+  } while (false)                                                               \
+  /**/
+
+/**
+ * BINLOG_<SEVERITY>_PRINTF_WC(writer, category, format, args...)
+ *
+ * Like BINLOG_<SEVERITY>_WC, but `format` is a printf style format string,
+ * see BINLOG_CREATE_SOURCE_AND_EVENT_PRINTF.
+ */
+
+#define BINLOG_TRACE_PRINTF_WC(writer, category, ...)                           \
+  BINLOG_CREATE_SOURCE_AND_EVENT_PRINTF(                                        \
+    writer, binlog::Severity::trace, category,                                  \
+    binlog::clockNow(),                                                         \
+    __VA_ARGS__                                                                 \
+  )                                                                             \
+  /**/
+
+#define BINLOG_DEBUG_PRINTF_WC(writer, category, ...)                           \
+  BINLOG_CREATE_SOURCE_AND_EVENT_PRINTF(                                        \
+    writer, binlog::Severity::debug, category,                                  \
+    binlog::clockNow(),                                                         \
+    __VA_ARGS__                                                                 \
+  )                                                                             \
+  /**/
+
+#define BINLOG_INFO_PRINTF_WC(writer, category, ...)                            \
+  BINLOG_CREATE_SOURCE_AND_EVENT_PRINTF(                                        \
+    writer, binlog::Severity::info, category,                                   \
+    binlog::clockNow(),                                                         \
+    __VA_ARGS__                                                                 \
+  )                                                                             \
+  /**/
+
+#define BINLOG_WARN_PRINTF_WC(writer, category, ...)                            \
+  BINLOG_CREATE_SOURCE_AND_EVENT_PRINTF(                                        \
+    writer, binlog::Severity::warning, category,                                \
+    binlog::clockNow(),                                                         \
+    __VA_ARGS__                                                                 \
+  )                                                                             \
+  /**/
+
+#define BINLOG_ERROR_PRINTF_WC(writer, category, ...)                           \
+  BINLOG_CREATE_SOURCE_AND_EVENT_PRINTF(                                        \
+    writer, binlog::Severity::error, category,                                  \
+    binlog::clockNow(),                                                         \
+    __VA_ARGS__                                                                 \
+  )                                                                             \
+  /**/
+
+#define BINLOG_CRITICAL_PRINTF_WC(writer, category, ...)                        \
+  BINLOG_CREATE_SOURCE_AND_EVENT_PRINTF(                                        \
+    writer, binlog::Severity::critical, category,                               \
+    binlog::clockNow(),                                                         \
+    __VA_ARGS__                                                                 \
+  )                                                                             \
+  /**/
+
+/**
+ * BINLOG_<SEVERITY>_PRINTF(format, args...)
+ *
+ * Like BINLOG_<SEVERITY>, but `format` is a printf style format string,
+ * see BINLOG_CREATE_SOURCE_AND_EVENT_PRINTF.
+ */
+
+#define BINLOG_TRACE_PRINTF(...)    BINLOG_TRACE_PRINTF_WC(   binlog::default_thread_local_writer(), main, __VA_ARGS__)
+#define BINLOG_DEBUG_PRINTF(...)    BINLOG_DEBUG_PRINTF_WC(   binlog::default_thread_local_writer(), main, __VA_ARGS__)
+#define BINLOG_INFO_PRINTF(...)     BINLOG_INFO_PRINTF_WC(    binlog::default_thread_local_writer(), main, __VA_ARGS__)
+#define BINLOG_WARN_PRINTF(...)     BINLOG_WARN_PRINTF_WC(    binlog::default_thread_local_writer(), main, __VA_ARGS__)
+#define BINLOG_ERROR_PRINTF(...)    BINLOG_ERROR_PRINTF_WC(   binlog::default_thread_local_writer(), main, __VA_ARGS__)
+#define BINLOG_CRITICAL_PRINTF(...) BINLOG_CRITICAL_PRINTF_WC(binlog::default_thread_local_writer(), main, __VA_ARGS__)
+
+namespace binlog {
+namespace detail {
+
+/** @returns the position after the conversion specification beginning at fmt[pos] (after the %) */
+constexpr std::size_t printf_skip_conversion(const char* fmt, std::size_t pos)
+{
+  while (fmt[pos] != 0 && ! NanoLogInternal::isTerminal(fmt[pos])) { ++pos; }
+  return (fmt[pos] != 0) ? pos + 1 : pos;
+}
+
+/** @returns the number of conversion specifications (excluding %%) in `fmt` */
+constexpr std::size_t printf_conversion_count(const char* fmt)
+{
+  std::size_t result = 0;
+  std::size_t i = 0;
+  while (fmt[i] != 0)
+  {
+    if (fmt[i] == '%' && fmt[i+1] == '%')
+    {
+      i += 2;
+    }
+    else if (fmt[i] == '%')
+    {
+      ++result;
+      i = printf_skip_conversion(fmt, i+1);
+    }
+    else
+    {
+      ++i;
+    }
+  }
+  return result;
+}
+
+/**
+ * @returns true if every conversion of `fmt` is valid,
+ * and none of them takes a dynamic width or precision.
+ */
+constexpr bool printf_format_valid(const char* fmt)
+{
+  FormatSpec spec;
+  bool invalid = false;
+  for (std::size_t i = 0; fmt[i] != 0; ++i)
+  {
+    if (parse_placeholder(fmt + i, spec, invalid) != nullptr || invalid) { return false; } // would be a placeholder
+  }
+
+  // each parameter of NanoLog corresponds to a conversion, if no * is used
+  return std::size_t(NanoLogInternal::getNumParams(fmt)) == printf_conversion_count(fmt);
+}
+
+/** @returns the size of `fmt` converted to the {} form */
+constexpr std::size_t printf_converted_size(const char* fmt)
+{
+  std::size_t result = 0;
+  std::size_t i = 0;
+  while (fmt[i] != 0)
+  {
+    if (fmt[i] == '%' && fmt[i+1] == '%')
+    {
+      ++result;
+      i += 2;
+    }
+    else if (fmt[i] == '%')
+    {
+      result += 2;
+      i = printf_skip_conversion(fmt, i+1);
+    }
+    else
+    {
+      ++result;
+      ++i;
+    }
+  }
+  return result;
+}
+
+/** A null terminated string of N characters, computed compile time */
+template <std::size_t N>
+struct PrintfConvertedFormat
+{
+  char data[N+1];
+};
+
+/** @returns `fmt` converted to the {} form, N must be printf_converted_size(fmt) */
+template <std::size_t N>
+constexpr PrintfConvertedFormat<N> printf_convert(const char* fmt)
+{
+  PrintfConvertedFormat<N> result{};
+  std::size_t out = 0;
+  std::size_t i = 0;
+  while (fmt[i] != 0)
+  {
+    if (fmt[i] == '%' && fmt[i+1] == '%')
+    {
+      result.data[out++] = '%';
+      i += 2;
+    }
+    else if (fmt[i] == '%')
+    {
+      result.data[out++] = '{';
+      result.data[out++] = '}';
+      i = printf_skip_conversion(fmt, i+1);
+    }
+    else
+    {
+      result.data[out++] = fmt[i++];
+    }
+  }
+  result.data[out] = 0;
+  return result;
+}
+
+/** The printf format string Format::str() converted to the {} form, computed compile time */
+template <typename Format>
+struct PrintfFormat
+{
+  static constexpr bool valid = printf_format_valid(Format::str());
+  static constexpr std::size_t conversionCount = printf_conversion_count(Format::str());
+
+  using type = PrintfConvertedFormat<printf_converted_size(Format::str())>;
+  static constexpr type value = printf_convert<printf_converted_size(Format::str())>(Format::str());
+};
+
+template <typename Format>
+constexpr bool PrintfFormat<Format>::valid;
+
+template <typename Format>
+constexpr std::size_t PrintfFormat<Format>::conversionCount;
+
+template <typename Format>
+constexpr typename PrintfFormat<Format>::type PrintfFormat<Format>::value;
+
+/**
+ * @returns the kind of T, as printf sees it:
+ * 'i' (integral or enum), 'f' (floating point) or '?' (anything else)
+ */
+template <typename T>
+constexpr char printf_argument_kind()
+{
+  const char t = mserialize::tag<T>()[0];
+  return (t == 'y' || t == 'c' || t == 'b' || t == 's' || t == 'i' || t == 'l'
+       || t == 'B' || t == 'S' || t == 'I' || t == 'L' || t == 'q' || t == 'Q' || t == '/') ? 'i'
+       : (t == 'f' || t == 'd' || t == 'D') ? 'f'
+       : '?';
+}
+
+/** The printf_argument_kind of each T..., computed compile time */
+template <typename... T>
+struct PrintfArgumentKinds
+{
+  static constexpr char value[sizeof...(T)+1] = {printf_argument_kind<T>()..., 0};
+};
+
+template <typename... T>
+constexpr char PrintfArgumentKinds<T...>::value[sizeof...(T)+1];
+
+// Only used in unevaluated context, the arguments are not evaluated.
+// The first argument (the format string) is dropped.
+template <typename Unused, typename... T>
+constexpr PrintfArgumentKinds<T...> printf_argument_kinds(Unused&&, T&&...) { return {}; } // Implementation should be omitted but cannot be on MSVC
+
+/** @returns true if the conversion `terminal` accepts an argument of `kind` */
+constexpr bool printf_conversion_accepts(char terminal, char kind)
+{
+  return (terminal == 's' || terminal == 'p') ? kind == '?'
+       : (terminal == 'f' || terminal == 'F' || terminal == 'e' || terminal == 'E'
+       || terminal == 'g' || terminal == 'G' || terminal == 'a' || terminal == 'A') ? kind == 'f'
+       : kind == 'i';
+}
+
+/**
+ * @returns true if each conversion of `fmt` accepts
+ * the argument of the corresponding kind in `kinds`.
+ * The number of arguments is not checked.
+ */
+constexpr bool printf_arguments_match(const char* fmt, const char* kinds)
+{
+  std::size_t k = 0;
+  std::size_t i = 0;
+  while (fmt[i] != 0)
+  {
+    if (fmt[i] == '%' && fmt[i+1] == '%')
+    {
+      i += 2;
+    }
+    else if (fmt[i] == '%')
+    {
+      i = printf_skip_conversion(fmt, i+1);
+      if (kinds[k] == 0) { return true; } // too few arguments, reported elsewhere
+      if (! printf_conversion_accepts(fmt[i-1], kinds[k])) { return false; }
+      ++k;
+    }
+    else
+    {
+      ++i;
+    }
+  }
+  return true;
+}
+
+} // namespace detail
+} // namespace binlog
+
+#endif // BINLOG_PRINTF_LOG_MACROS_HPP
@@ -0,0 +1,291 @@
+#ifndef BINLOG_SAMPLED_LOG_MACROS_HPP
+#define BINLOG_SAMPLED_LOG_MACROS_HPP
+
+#include <binlog/Severity.hpp>
+#include <binlog/Time.hpp>
+#include <binlog/create_source_and_event_if.hpp>
+#include <binlog/default_session.hpp> // default_thread_local_writer
+
+#include <mserialize/detail/preprocessor.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <utility> // exchange
+
+/**
+ * BINLOG_CREATE_SOURCE_AND_EVENT_EVERY_N(writer, severity, category, clock, n, format, args...)
+ *
+ * Like BINLOG_CREATE_SOURCE_AND_EVENT_IF, but only every `n`th call
+ * of the call site (per thread) adds an event. The first call adds an event.
+ *
+ * The number of events suppressed since the previous added event
+ * (by the same thread) is added to the event, as an additional argument:
+ * `format` is extended with " ({} suppressed)".
+ *
+ * The arguments of suppressed events are not evaluated.
+ */
+#define BINLOG_CREATE_SOURCE_AND_EVENT_EVERY_N(writer, severity, category, clock, n, ...) \
+  BINLOG_DETAIL_CREATE_SOURCE_AND_SAMPLED_EVENT(                                 \
+    writer, severity, category, clock, binlog::detail::EveryN, sample(n), __VA_ARGS__ \
+  )                                                                             \
+  /**/
+
+/**
+ * BINLOG_CREATE_SOURCE_AND_EVENT_RATE_LIMITED(writer, severity, category, clock, maxPerSecond, format, args...)
+ *
+ * Like BINLOG_CREATE_SOURCE_AND_EVENT_IF, but the call site adds
+ * at most `maxPerSecond` events in each one second long window (per thread).
+ *
+ * The number of events suppressed since the previous added event
+ * (by the same thread) is added to the event, as an additional argument:
+ * `format` is extended with " ({} suppressed)".
+ *
+ * The arguments of suppressed events are not evaluated.
+ */
+#define BINLOG_CREATE_SOURCE_AND_EVENT_RATE_LIMITED(writer, severity, category, clock, maxPerSecond, ...) \
+  BINLOG_DETAIL_CREATE_SOURCE_AND_SAMPLED_EVENT(                                 \
+    writer, severity, category, clock, binlog::detail::RateLimiter, sample(maxPerSecond), __VA_ARGS__ \
+  )                                                                             \
+  /**/
+
+#define BINLOG_DETAIL_CREATE_SOURCE_AND_SAMPLED_EVENT(writer, severity, category, clock, sampler, sample, ...) \
+  do {                                                                          \
+    static_assert(                                                              \
+      binlog::detail::count_placeholders(MSERIALIZE_FIRST(__VA_ARGS__))+1 ==    \
+      decltype(binlog::detail::count_arguments(__VA_ARGS__))::value,            \
+      "Number of {} placeholders in format string must match number of arugments" \
+    );                                                                          \
+    static_assert(                                                              \
+      binlog::detail::placeholders_valid(MSERIALIZE_FIRST(__VA_ARGS__)),        \
+      "Invalid or duplicate placeholder in format string, expected: {[name][:[[fill]align][sign][#][0][width][.precision][type]]}" \
+    );                                                                          \
+    BINLOG_DETAIL_IF_COMPILED_IN(severity, category)                            \
+    {                                                                           \
+      static binlog::detail::CallSite _binlog_site{severity, #category};        \
+      static thread_local sampler _binlog_sampler;                              \
+      if (writer.session().isEnabled(_binlog_site) && _binlog_sampler.sample)   \
+      {                                                                         \
+        using _binlog_arguments = decltype(binlog::detail::argument_tags(__VA_ARGS__, std::uint64_t{})); \
+        static const binlog::StaticEventSource _binlog_source{                  \
+          severity, #category, __func__, __FILE__, std::uint64_t(__LINE__),     /* NOLINT */ \
+          MSERIALIZE_FIRST(__VA_ARGS__) " ({} suppressed)",                     \
+          _binlog_arguments::value.data()                                       \
+        };                                                                      \
+        std::uint64_t _binlog_sid_v = _binlog_site.sourceId.load(std::memory_order_relaxed); \
+        if (_binlog_sid_v == 0 && ! _binlog_arguments::hasConstant)             \
+        {                                                                       \
+          _binlog_sid_v = writer.session().addEventSource(_binlog_source);      \
+          _binlog_site.sourceId.store(_binlog_sid_v);                           \
+        }                                                                       \
+        BINLOG_DETAIL_ADD_EVENT(                                                \
+          _binlog_source, writer,                                               \
+          (binlog::detail::CachedSourceId{_binlog_sid_v, _binlog_site.sourceId, _binlog_source}), \
+          clock, __VA_ARGS__, _binlog_sampler.takeSuppressed()                  \
+        );                                                                      \
+      }                                                                         \
+    }                                                                           \
+  } while (false)                                                               \
+  /**/
+
+/**
+ * BINLOG_<SEVERITY>_EVERY_N_WC(writer, category, n, format, args...)
+ *
+ * Like BINLOG_<SEVERITY>_WC, but only every `n`th call of the call site (per thread) adds an event.
+ * The number of suppressed events is added to the format string and the arguments,
+ * see BINLOG_CREATE_SOURCE_AND_EVENT_EVERY_N.
+ */
+
+#define BINLOG_TRACE_EVERY_N_WC(writer, category, n, ...)                       \
+  BINLOG_CREATE_SOURCE_AND_EVENT_EVERY_N(                                       \
+    writer, binlog::Severity::trace, category,                                  \
+    binlog::clockNow(), n,                                                      \
+    __VA_ARGS__                                                                 \
+  )                                                                             \
+  /**/
+
+#define BINLOG_DEBUG_EVERY_N_WC(writer, category, n, ...)                       \
+  BINLOG_CREATE_SOURCE_AND_EVENT_EVERY_N(                                       \
+    writer, binlog::Severity::debug, category,                                  \
+    binlog::clockNow(), n,                                                      \
+    __VA_ARGS__                                                                 \
+  )                                                                             \
+  /**/
+
+#define BINLOG_INFO_EVERY_N_WC(writer, category, n, ...)                        \
+  BINLOG_CREATE_SOURCE_AND_EVENT_EVERY_N(                                       \
+    writer, binlog::Severity::info, category,                                   \
+    binlog::clockNow(), n,                                                      \
+    __VA_ARGS__                                                                 \
+  )                                                                             \
+  /**/
+
+#define BINLOG_WARN_EVERY_N_WC(writer, category, n, ...)                        \
+  BINLOG_CREATE_SOURCE_AND_EVENT_EVERY_N(                                       \
+    writer, binlog::Severity::warning, category,                                \
+    binlog::clockNow(), n,                                                      \
+    __VA_ARGS__                                                                 \
+  )                                                                             \
+  /**/
+
+#define BINLOG_ERROR_EVERY_N_WC(writer, category, n, ...)                       \
+  BINLOG_CREATE_SOURCE_AND_EVENT_EVERY_N(                                       \
+    writer, binlog::Severity::error, category,                                  \
+    binlog::clockNow(), n,                                                      \
+    __VA_ARGS__                                                                 \
+  )                                                                             \
+  /**/
+
+#define BINLOG_CRITICAL_EVERY_N_WC(writer, category, n, ...)                    \
+  BINLOG_CREATE_SOURCE_AND_EVENT_EVERY_N(                                       \
+    writer, binlog::Severity::critical, category,                               \
+    binlog::clockNow(), n,                                                      \
+    __VA_ARGS__                                                                 \
+  )                                                                             \
+  /**/
+
+/**
+ * BINLOG_<SEVERITY>_EVERY_N(n, format, args...)
+ *
+ * Like BINLOG_<SEVERITY>, but only every `n`th call of the call site (per thread) adds an event.
+ * The number of suppressed events is added to the format string and the arguments,
+ * see BINLOG_CREATE_SOURCE_AND_EVENT_EVERY_N.
+ */
+
+#define BINLOG_TRACE_EVERY_N(n, ...)    BINLOG_TRACE_EVERY_N_WC(binlog::default_thread_local_writer(), main, n, __VA_ARGS__)
+#define BINLOG_DEBUG_EVERY_N(n, ...)    BINLOG_DEBUG_EVERY_N_WC(binlog::default_thread_local_writer(), main, n, __VA_ARGS__)
+#define BINLOG_INFO_EVERY_N(n, ...)     BINLOG_INFO_EVERY_N_WC(binlog::default_thread_local_writer(), main, n, __VA_ARGS__)
+#define BINLOG_WARN_EVERY_N(n, ...)     BINLOG_WARN_EVERY_N_WC(binlog::default_thread_local_writer(), main, n, __VA_ARGS__)
+#define BINLOG_ERROR_EVERY_N(n, ...)    BINLOG_ERROR_EVERY_N_WC(binlog::default_thread_local_writer(), main, n, __VA_ARGS__)
+#define BINLOG_CRITICAL_EVERY_N(n, ...) BINLOG_CRITICAL_EVERY_N_WC(binlog::default_thread_local_writer(), main, n, __VA_ARGS__)
+
+/**
+ * BINLOG_<SEVERITY>_RATE_LIMITED_WC(writer, category, maxPerSecond, format, args...)
+ *
+ * Like BINLOG_<SEVERITY>_WC, but the call site adds at most `maxPerSecond` events per second (per thread).
+ * The number of suppressed events is added to the format string and the arguments,
+ * see BINLOG_CREATE_SOURCE_AND_EVENT_RATE_LIMITED.
+ */
+
+#define BINLOG_TRACE_RATE_LIMITED_WC(writer, category, maxPerSecond, ...)       \
+  BINLOG_CREATE_SOURCE_AND_EVENT_RATE_LIMITED(                                  \
+    writer, binlog::Severity::trace, category,                                  \
+    binlog::clockNow(), maxPerSecond,                                           \
+    __VA_ARGS__                                                                 \
+  )                                                                             \
+  /**/
+
+#define BINLOG_DEBUG_RATE_LIMITED_WC(writer, category, maxPerSecond, ...)       \
+  BINLOG_CREATE_SOURCE_AND_EVENT_RATE_LIMITED(                                  \
+    writer, binlog::Severity::debug, category,                                  \
+    binlog::clockNow(), maxPerSecond,                                           \
+    __VA_ARGS__                                                                 \
+  )                                                                             \
+  /**/
+
+#define BINLOG_INFO_RATE_LIMITED_WC(writer, category, maxPerSecond, ...)        \
+  BINLOG_CREATE_SOURCE_AND_EVENT_RATE_LIMITED(                                  \
+    writer, binlog::Severity::info, category,                                   \
+    binlog::clockNow(), maxPerSecond,                                           \
+    __VA_ARGS__                                                                 \
+  )                                                                             \
+  /**/
+
+#define BINLOG_WARN_RATE_LIMITED_WC(writer, category, maxPerSecond, ...)        \
+  BINLOG_CREATE_SOURCE_AND_EVENT_RATE_LIMITED(                                  \
+    writer, binlog::Severity::warning, category,                                \
+    binlog::clockNow(), maxPerSecond,                                           \
+    __VA_ARGS__                                                                 \
+  )                                                                             \
+  /**/
+
+#define BINLOG_ERROR_RATE_LIMITED_WC(writer, category, maxPerSecond, ...)       \
+  BINLOG_CREATE_SOURCE_AND_EVENT_RATE_LIMITED(                                  \
+    writer, binlog::Severity::error, category,                                  \
+    binlog::clockNow(), maxPerSecond,                                           \
+    __VA_ARGS__                                                                 \
+  )                                                                             \
+  /**/
+
+#define BINLOG_CRITICAL_RATE_LIMITED_WC(writer, category, maxPerSecond, ...)    \
+  BINLOG_CREATE_SOURCE_AND_EVENT_RATE_LIMITED(                                  \
+    writer, binlog::Severity::critical, category,                               \
+    binlog::clockNow(), maxPerSecond,                                           \
+    __VA_ARGS__                                                                 \
+  )                                                                             \
+  /**/
+
+/**
+ * BINLOG_<SEVERITY>_RATE_LIMITED(maxPerSecond, format, args...)
+ *
+ * Like BINLOG_<SEVERITY>, but the call site adds at most `maxPerSecond` events per second (per thread).
+ * The number of suppressed events is added to the format string and the arguments,
+ * see BINLOG_CREATE_SOURCE_AND_EVENT_RATE_LIMITED.
+ */
+
+#define BINLOG_TRACE_RATE_LIMITED(maxPerSecond, ...)    BINLOG_TRACE_RATE_LIMITED_WC(binlog::default_thread_local_writer(), main, maxPerSecond, __VA_ARGS__)
+#define BINLOG_DEBUG_RATE_LIMITED(maxPerSecond, ...)    BINLOG_DEBUG_RATE_LIMITED_WC(binlog::default_thread_local_writer(), main, maxPerSecond, __VA_ARGS__)
+#define BINLOG_INFO_RATE_LIMITED(maxPerSecond, ...)     BINLOG_INFO_RATE_LIMITED_WC(binlog::default_thread_local_writer(), main, maxPerSecond, __VA_ARGS__)
+#define BINLOG_WARN_RATE_LIMITED(maxPerSecond, ...)     BINLOG_WARN_RATE_LIMITED_WC(binlog::default_thread_local_writer(), main, maxPerSecond, __VA_ARGS__)
+#define BINLOG_ERROR_RATE_LIMITED(maxPerSecond, ...)    BINLOG_ERROR_RATE_LIMITED_WC(binlog::default_thread_local_writer(), main, maxPerSecond, __VA_ARGS__)
+#define BINLOG_CRITICAL_RATE_LIMITED(maxPerSecond, ...) BINLOG_CRITICAL_RATE_LIMITED_WC(binlog::default_thread_local_writer(), main, maxPerSecond, __VA_ARGS__)
+
+namespace binlog {
+namespace detail {
+
+/** Per thread state of a BINLOG_CREATE_SOURCE_AND_EVENT_EVERY_N call site */
+class EveryN
+{
+public:
+  /** @returns true for every `n`th call, starting with the first */
+  bool sample(std::uint64_t n)
+  {
+    if (_count++ % n == 0) { return true; }
+    ++_suppressed;
+    return false;
+  }
+
+  /** @returns the number of events suppressed since the last call */
+  std::uint64_t takeSuppressed() { return std::exchange(_suppressed, 0); }
+
+private:
+  std::uint64_t _count = 0;
+  std::uint64_t _suppressed = 0;
+};
+
+/** Per thread state of a BINLOG_CREATE_SOURCE_AND_EVENT_RATE_LIMITED call site */
+class RateLimiter
+{
+public:
+  /** @returns true if less than `maxPerSecond` events were sampled in the current window */
+  bool sample(std::uint64_t maxPerSecond)
+  {
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (now - _windowBegin >= std::chrono::seconds(1))
+    {
+      _windowBegin = now;
+      _count = 0;
+    }
+
+    if (_count < maxPerSecond)
+    {
+      ++_count;
+      return true;
+    }
+
+    ++_suppressed;
+    return false;
+  }
+
+  /** @returns the number of events suppressed since the last call */
+  std::uint64_t takeSuppressed() { return std::exchange(_suppressed, 0); }
+
+private:
+  std::chrono::steady_clock::time_point _windowBegin;
+  std::uint64_t _count = 0;
+  std::uint64_t _suppressed = 0;
+};
+
+} // namespace detail
+} // namespace binlog
+
+#endif // BINLOG_SAMPLED_LOG_MACROS_HPP
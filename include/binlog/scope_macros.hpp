@@ -0,0 +1,199 @@
+#ifndef BINLOG_SCOPE_MACROS_HPP
+#define BINLOG_SCOPE_MACROS_HPP
+
+#include <binlog/Entries.hpp> // StaticEventSource
+#include <binlog/Severity.hpp>
+#include <binlog/Time.hpp>
+#include <binlog/create_source_and_event.hpp>
+#include <binlog/default_session.hpp> // default_thread_local_writer
+#include <binlog/detail/CallSite.hpp>
+
+#include <mserialize/detail/preprocessor.hpp>
+#include <mserialize/make_struct_serializable.hpp>
+#include <mserialize/make_struct_tag.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new> // placement new
+#include <tuple>
+#include <type_traits> // aligned_storage
+#include <utility> // forward, declval
+
+/**
+ * BINLOG_SCOPE_WC(writer, category, format, args...)
+ *
+ * Measure the time spent in the enclosing scope:
+ * at scope exit, add a single event to `writer`, timestamped by the clock
+ * at scope entry, with `args...` and the duration of the scope,
+ * in clock ticks, as an additional binlog::ScopeDuration argument:
+ * `format` is extended with " ({})".
+ *
+ * The event has severity info, it is added if the call site is enabled
+ * at scope entry, see BINLOG_CREATE_SOURCE_AND_EVENT_IF.
+ * The arguments are evaluated and copied at scope entry (if enabled),
+ * and serialized at scope exit, on the same writer.
+ * The events are timestamped using binlog::clockNow().
+ *
+ * `bread -T` converts the scope events to Chrome trace JSON, to view them
+ * as flame charts, per writer.
+ *
+ * Example:
+ *
+ *    void handle(const Order& order)
+ *    {
+ *      BINLOG_SCOPE_C(orders, "handle order {}", order.id);
+ *      // ...
+ *    } // the event is added here: "handle order 123 (1500ns)"
+ *
+ * @param writer binlog::SessionWriter
+ * @param category arbitrary valid symbol name
+ * @param format string literal with {} placeholders
+ * @param args... any number of copyable, serializable, tagged, log arguments. Can be empty
+ */
+#define BINLOG_SCOPE_WC(writer, category, ...)                                  \
+  BINLOG_DETAIL_SCOPE(                                                          \
+    MSERIALIZE_CAT(_binlog_scope_, __LINE__), writer, binlog::Severity::info, category, __VA_ARGS__ \
+  )                                                                             \
+  /**/
+
+/** Same as BINLOG_SCOPE_WC, using the default writer */
+#define BINLOG_SCOPE_C(category, ...) BINLOG_SCOPE_WC(binlog::default_thread_local_writer(), category, __VA_ARGS__)
+
+/** Same as BINLOG_SCOPE_WC, using the default writer and the main category */
+#define BINLOG_SCOPE(...) BINLOG_SCOPE_WC(binlog::default_thread_local_writer(), main, __VA_ARGS__)
+
+/**
+ * Declares `name` (a binlog::detail::Scope) and its static call site and event source,
+ * in the enclosing scope: unlike the other macros, this is not a single statement.
+ */
+#define BINLOG_DETAIL_SCOPE(name, writer, severity, category, /* format, */ ...)         \
+  static_assert(                                                                         \
+    binlog::detail::count_placeholders(MSERIALIZE_FIRST(__VA_ARGS__))+1 ==               \
+    decltype(binlog::detail::count_arguments(__VA_ARGS__))::value,                       \
+    "Number of {} placeholders in format string must match number of arugments"          \
+  );                                                                                     \
+  static_assert(                                                                         \
+    binlog::detail::placeholders_valid(MSERIALIZE_FIRST(__VA_ARGS__)),                   \
+    "Invalid or duplicate placeholder in format string, expected: {[name][:[[fill]align][sign][#][0][width][.precision][type]]}" \
+  );                                                                                     \
+  static_assert(                                                                         \
+    ! decltype(binlog::detail::argument_tags(__VA_ARGS__))::hasConstant,                 \
+    "Scope macros do not support binlog::constant arguments"                             \
+  );                                                                                     \
+  static binlog::detail::CallSite MSERIALIZE_CAT(name, _site){severity, #category};      \
+  static const binlog::StaticEventSource MSERIALIZE_CAT(name, _source){                  \
+    severity, #category, __func__, __FILE__, std::uint64_t(__LINE__),                    /* NOLINT */ \
+    MSERIALIZE_FIRST(__VA_ARGS__) " ({})",                                               \
+    decltype(binlog::detail::argument_tags(__VA_ARGS__, binlog::ScopeDuration{}))::value.data() \
+  };                                                                                     \
+  auto&& name = binlog::detail::makeScope(                                               \
+    writer, MSERIALIZE_CAT(name, _site), MSERIALIZE_CAT(name, _source),                  \
+    [&]() { return binlog::detail::tupleIgnoreFirst(__VA_ARGS__); }                      \
+  );                                                                                     \
+  static_cast<void>(name)                                                                \
+  /**/
+
+namespace binlog {
+
+/**
+ * The duration of a scope, see BINLOG_SCOPE_WC,
+ * in clock ticks (see ClockSync::clockFrequency).
+ *
+ * bread shows it as nanoseconds, if the clock frequency is known.
+ */
+struct ScopeDuration
+{
+  std::uint64_t ticks; // NOLINT
+};
+
+namespace detail {
+
+// The first argument (the format string) is dropped, like addEventIgnoreFirst
+template <typename Unused, typename... T>
+std::tuple<typename std::decay<T>::type...> tupleIgnoreFirst(Unused&&, T&&... t)
+{
+  return std::tuple<typename std::decay<T>::type...>(std::forward<T>(t)...);
+}
+
+/**
+ * Adds an event of a static source to `writer` on destruction,
+ * with the arguments taken on construction, see BINLOG_SCOPE_WC.
+ */
+template <typename Writer, typename Arguments>
+class Scope
+{
+public:
+  /** Takes the arguments from `arguments()` and the start clock, if `site` is enabled */
+  template <typename F>
+  Scope(Writer& writer, CallSite& site, const StaticEventSource& source, F&& arguments) // NOLINT(bugprone-forwarding-reference-overload)
+    :_writer(writer),
+     _site(site),
+     _source(source),
+     _enabled(writer.session().isEnabled(site))
+  {
+    if (_enabled)
+    {
+      new (&_arguments) Arguments(arguments());
+      _start = clockNow();
+    }
+  }
+
+  Scope(const Scope&) = delete;
+  void operator=(const Scope&) = delete;
+
+  ~Scope()
+  {
+    if (! _enabled) { return; }
+
+    const std::uint64_t end = clockNow();
+    try
+    {
+      std::uint64_t sid = _site.sourceId.load(std::memory_order_relaxed);
+      if (sid == 0)
+      {
+        sid = _writer.session().addEventSource(_source);
+        _site.sourceId.store(sid);
+      }
+      addEvent(sid, ScopeDuration{end - _start}, std::make_index_sequence<std::tuple_size<Arguments>::value>{});
+    }
+    catch (...) {} // NOLINT(bugprone-empty-catch) a destructor must not throw
+
+    arguments().~Arguments();
+  }
+
+private:
+  Arguments& arguments() { return *reinterpret_cast<Arguments*>(&_arguments); }
+
+  template <std::size_t... I>
+  void addEvent(std::uint64_t sid, ScopeDuration duration, std::index_sequence<I...>)
+  {
+    _writer.addEvent(sid, _start, std::get<I>(arguments())..., duration);
+  }
+
+  Writer& _writer;
+  CallSite& _site;
+  const StaticEventSource& _source;
+  bool _enabled;
+  std::uint64_t _start = 0;
+  typename std::aligned_storage<sizeof(Arguments), alignof(Arguments)>::type _arguments; // constructed if _enabled
+};
+
+/**
+ * @returns a Scope, constructed in place: the result
+ * is bound to a reference, Scope is not copied or moved.
+ */
+template <typename Writer, typename F>
+Scope<Writer, decltype(std::declval<F&>()())>
+makeScope(Writer& writer, CallSite& site, const StaticEventSource& source, F&& arguments)
+{
+  return {writer, site, source, std::forward<F>(arguments)};
+}
+
+} // namespace detail
+} // namespace binlog
+
+MSERIALIZE_MAKE_STRUCT_SERIALIZABLE(binlog::ScopeDuration, ticks)
+MSERIALIZE_MAKE_STRUCT_TAG(binlog::ScopeDuration, ticks)
+
+#endif // BINLOG_SCOPE_MACROS_HPP
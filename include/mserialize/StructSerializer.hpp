@@ -3,6 +3,9 @@
 
 #include <mserialize/serialize.hpp>
 
+#include <cstddef>
+#include <initializer_list>
+#include <ios> // streamsize
 #include <type_traits>
 
 namespace mserialize {
@@ -47,6 +50,31 @@ template <typename T, typename Ret>
 auto serializable_member(Ret (T::*getter)() const noexcept) -> decltype(getter);
 #endif
 
+namespace detail {
+
+/** True if Member is a pointer to a data member with a trivial serializer */
+template <typename Member, typename = void>
+struct is_trivial_data_member : std::false_type
+{
+  static constexpr std::size_t size = 0;
+};
+
+template <typename Field, typename U>
+struct is_trivial_data_member<Field U::*, std::enable_if_t<! std::is_function<Field>::value>>
+  :has_trivial_serializer<std::remove_cv_t<Field>>
+{
+  static constexpr std::size_t size = sizeof(Field);
+};
+
+constexpr std::size_t sum_sizes(std::initializer_list<std::size_t> sizes)
+{
+  std::size_t result = 0;
+  for (const std::size_t size : sizes) { result += size; }
+  return result;
+}
+
+} // namespace detail
+
 /**
  * Serialize the given members of a custom type `T`.
  *
@@ -88,14 +116,80 @@ auto serializable_member(Ret (T::*getter)() const noexcept) -> decltype(getter);
 template <typename T, typename... Members>
 struct StructSerializer
 {
+  /**
+   * True if every member is a data member, serialized as its
+   * object representation, and the members cover every byte of `T`
+   * (i.e: there's no padding, and no member is omitted).
+   *
+   * Then the serialized form of `T` is the same as its object representation,
+   * if the members are listed in declaration order (see is_layout_order),
+   * and `T` is serialized by a single write. Sequences of such `T`
+   * are also serialized by a single write, if their data is contiguous.
+   */
+  static constexpr bool is_layout_serializable =
+       std::is_trivially_copyable<T>::value
+    && detail::conjunction<detail::is_trivial_data_member<typename Members::value_type>...>::value
+    && detail::sum_sizes({std::size_t{0}, detail::is_trivial_data_member<typename Members::value_type>::size...}) == sizeof(T);
+
   template <typename OutputStream>
   static void serialize(const T& t, OutputStream& ostream)
+  {
+    serialize_impl(std::integral_constant<bool, is_layout_serializable>{}, t, ostream);
+  }
+
+  static std::size_t serialized_size(const T& t)
+  {
+    return serialized_size_impl(std::integral_constant<bool, is_layout_serializable>{}, t);
+  }
+
+  /**
+   * @returns true if the members are laid out in the listed order, one after the other.
+   * Only depends on the type of `t`, the optimizer is expected to fold it to a constant.
+   * @pre is_layout_serializable
+   */
+  static bool is_layout_order(const T& t)
+  {
+    const char* base = reinterpret_cast<const char*>(&t);
+    std::size_t offset = 0;
+    bool result = true;
+
+    using swallow = int[];
+    (void)swallow{1, (
+      result = result && member_address(t, Members::value) == base + offset,
+      offset += detail::is_trivial_data_member<typename Members::value_type>::size,
+      int{}
+    )...};
+
+    return result;
+  }
+
+private:
+  template <typename OutputStream>
+  static void serialize_impl(std::true_type /* layout serializable */, const T& t, OutputStream& ostream)
+  {
+    if (is_layout_order(t))
+    {
+      ostream.write(reinterpret_cast<const char*>(&t), std::streamsize(sizeof(T)));
+    }
+    else
+    {
+      serialize_impl(std::false_type{}, t, ostream);
+    }
+  }
+
+  template <typename OutputStream>
+  static void serialize_impl(std::false_type /* serialize member by member */, const T& t, OutputStream& ostream)
   {
     using swallow = int[];
     (void)swallow{1, (serialize_member(t, Members::value, ostream), int{})...};
   }
 
-  static std::size_t serialized_size(const T& t)
+  static std::size_t serialized_size_impl(std::true_type /* layout serializable */, const T&)
+  {
+    return sizeof(T);
+  }
+
+  static std::size_t serialized_size_impl(std::false_type /* sum member sizes */, const T& t)
   {
     const std::size_t field_sizes[] = {0, serialized_size_member(t, Members::value)...};
 
@@ -104,7 +198,12 @@ struct StructSerializer
     return result;
   }
 
-private:
+  template <typename U, typename Field>
+  static const char* member_address(const T& t, Field U::*field)
+  {
+    return reinterpret_cast<const char*>(&(t.*field));
+  }
+
   // U might be the base of T, if T got adopted through a concept
 
   template <typename U, typename Field, typename OutputStream>
@@ -148,6 +247,9 @@ private:
 #endif
 };
 
+template <typename T, typename... Members>
+constexpr bool StructSerializer<T, Members...>::is_layout_serializable;
+
 } // namespace mserialize
 
 #endif // MSERIALIZE_STRUCT_SERIALIZER_HPP
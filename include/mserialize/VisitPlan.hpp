@@ -0,0 +1,539 @@
+#ifndef MSERIALIZE_VISIT_PLAN_HPP
+#define MSERIALIZE_VISIT_PLAN_HPP
+
+#include <mserialize/singular.hpp>
+#include <mserialize/string_view.hpp>
+
+#include <mserialize/detail/tag_util.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace mserialize {
+namespace detail {
+
+/** @returns true if the arithmetic `tag` is of a signed integer type */
+inline bool is_signed_integer_tag(char tag)
+{
+  return tag == 'b' || tag == 's' || tag == 'i' || tag == 'l'
+      || (tag == 'c' && std::is_signed<char>::value);
+}
+
+/**
+ * Map integers to std::uint64_t, keeping the order
+ * of both signed and unsigned values.
+ */
+template <typename Integer>
+std::enable_if_t<std::is_signed<Integer>::value, std::uint64_t>
+enum_key(Integer v)
+{
+  return std::uint64_t(std::int64_t(v)) ^ (std::uint64_t(1) << 63);
+}
+
+template <typename Integer>
+std::enable_if_t<! std::is_signed<Integer>::value, std::uint64_t>
+enum_key(Integer v)
+{
+  return std::uint64_t(v);
+}
+
+/**
+ * Parse the hexadecimal `value` of an enumerator,
+ * as written by write_integer_as_hex, to `key`.
+ *
+ * @param underlying_tag the tag of the underlying type of the enum
+ * @returns false if `value` is not a hexadecimal integer
+ */
+inline bool parse_enum_key(char underlying_tag, string_view value, std::uint64_t& key)
+{
+  const bool negative = ! value.empty() && value.front() == '-';
+  if (negative) { value.remove_prefix(1); }
+  if (value.empty() || value.size() > 16) { return false; }
+
+  std::uint64_t magnitude = 0;
+  for (const char c : value)
+  {
+    unsigned digit = 0;
+    if (c >= '0' && c <= '9') { digit = unsigned(c - '0'); }
+    else if (c >= 'A' && c <= 'F') { digit = unsigned(c - 'A' + 10); }
+    else { return false; }
+    magnitude = magnitude * 16 + digit;
+  }
+
+  if (is_signed_integer_tag(underlying_tag))
+  {
+    if (negative && magnitude > (std::uint64_t(1) << 63)) { return false; }
+    if (! negative && magnitude >= (std::uint64_t(1) << 63)) { return false; }
+    const std::uint64_t bits = negative ? std::uint64_t(0) - magnitude : magnitude;
+    key = bits ^ (std::uint64_t(1) << 63);
+    return true;
+  }
+
+  if (negative) { return false; }
+  key = magnitude;
+  return true;
+}
+
+} // namespace detail
+
+/**
+ * A type tag, compiled for visitation.
+ *
+ * mserialize::visit(tag, ...) parses the tag while visiting:
+ * it looks for element tags, tuple and struct boundaries,
+ * and enumerator names each time it is called.
+ * VisitPlan does the parsing once, and stores the result
+ * as a flat array of operations, to be executed by
+ * mserialize::visit(plan, ...) any number of times,
+ * with any visitor:
+ *
+ *     const mserialize::VisitPlan plan(tag);
+ *     for (...) { mserialize::visit(plan, visitor, istream); }
+ *
+ * Visiting with a plan calls the same visitor methods,
+ * with the same arguments, and throws the same errors,
+ * as visiting with the tag the plan was compiled from.
+ * Invalid tags are accepted by the constructor,
+ * the errors are reported on visitation.
+ */
+class VisitPlan
+{
+public:
+  enum class OpCode : std::uint8_t
+  {
+    Empty,          /**< Empty tag, visits nothing */
+    Arithmetic,     /**< `arithmetic` holds the tag */
+    Sequence,       /**< Element is the next op */
+    Tuple,          /**< Elements are the ops in (index, end) */
+    Variant,        /**< Options are `options[target, target+count)` */
+    Null,           /**< Option `0` of a variant */
+    Struct,         /**< Fields are the ops in (index, end) */
+    StructRef,      /**< Visit the Struct at `target` (recursive struct) */
+    Field,          /**< Field type is the next op */
+    Enum,           /**< Enumerators are described by `enums[target]` */
+    Invalid,        /**< Throws on visitation */
+    RecursionLimit, /**< Throws on visitation */
+  };
+
+  /** Part of the compiled tag */
+  struct Slice
+  {
+    std::uint32_t begin = 0;
+    std::uint32_t size = 0;
+  };
+
+  struct Op
+  {
+    OpCode code = OpCode::Empty;
+    char arithmetic = 0;       /**< Tag of Arithmetic ops, underlying tag of Enum ops */
+    bool singular = false;     /**< Sequence: all elements are serialized using 0 bytes */
+    std::uint32_t end = 0;     /**< Index of the first op after the subtree of this op */
+    std::uint32_t fixed_size = 0; /**< Serialized size of the subtree, or variable_size */
+    std::uint32_t target = 0;
+    std::uint32_t count = 0;
+    Slice tag;                 /**< The tag given to the visitor, e.g: elem tag of Sequence */
+    Slice name;                /**< Name of Struct, StructRef, Field and Enum ops */
+  };
+
+  struct Option
+  {
+    std::uint32_t op = 0;      /**< Index of the root op of the option */
+    Slice tag;
+  };
+
+  struct Enumerator
+  {
+    Slice value;               /**< Hexadecimal value */
+    Slice name;
+    std::uint64_t key = 0;     /**< Value as given by detail::enum_key */
+  };
+
+  /** Lookup table of the enumerators of an enum, by value */
+  struct EnumTable
+  {
+    std::uint32_t first = 0;   /**< enumerators[first, first+count) belong to this enum */
+    std::uint32_t count = 0;
+    bool sorted = false;       /**< Enumerators are sorted by key, else compare values as strings */
+    std::uint64_t min_key = 0;
+    std::uint32_t dense_first = 0; /**< dense[dense_first + key - min_key] is an enumerators index or no_enumerator */
+    std::uint32_t dense_size = 0;  /**< 0 if not dense */
+  };
+
+  static constexpr std::uint32_t no_enumerator = ~std::uint32_t(0);
+
+  /** Op::fixed_size of ops whose objects are not always serialized using the same number of bytes */
+  static constexpr std::uint32_t variable_size = ~std::uint32_t(0);
+
+  /** Compile the empty tag */
+  VisitPlan() = default;
+
+  /**
+   * Compile `tag`.
+   *
+   * @param max_recursion the maximum nesting of the visited objects,
+   *   visitation throws std::runtime_error above it.
+   */
+  explicit VisitPlan(string_view tag, int max_recursion = 2048)
+    :_tag(tag.data(), tag.size()),
+     _max_recursion(max_recursion)
+  {
+    compile(string_view(_tag.data(), _tag.size()), max_recursion);
+  }
+
+  /** @returns the tag this plan was compiled from */
+  string_view tag() const { return string_view(_tag.data(), _tag.size()); }
+
+  int max_recursion() const { return _max_recursion; }
+
+  /** @returns the operations, the root is at index 0, if any */
+  const std::vector<Op>& ops() const { return _ops; }
+
+  const std::vector<Option>& options() const { return _options; }
+
+  const std::vector<Enumerator>& enumerators() const { return _enumerators; }
+
+  const std::vector<EnumTable>& enums() const { return _enums; }
+
+  const std::vector<std::uint32_t>& dense() const { return _dense; }
+
+  /**
+   * @returns the index of the first enumerator of `table`
+   *   with the given `key` and hexadecimal `value`,
+   *   or no_enumerator if there is no such enumerator.
+   */
+  std::uint32_t find_enumerator(const EnumTable& table, std::uint64_t key, string_view value) const
+  {
+    if (table.dense_size != 0)
+    {
+      const std::uint64_t offset = key - table.min_key;
+      return (key >= table.min_key && offset < table.dense_size)
+        ? _dense[table.dense_first + std::size_t(offset)]
+        : no_enumerator;
+    }
+
+    const auto begin = _enumerators.begin() + table.first;
+    const auto end = begin + table.count;
+
+    if (table.sorted)
+    {
+      const auto it = std::lower_bound(begin, end, key,
+        [](const Enumerator& e, std::uint64_t k) { return e.key < k; }
+      );
+      return (it != end && it->key == key) ? std::uint32_t(it - _enumerators.begin()) : no_enumerator;
+    }
+
+    for (auto it = begin; it != end; ++it)
+    {
+      if (str(it->value) == value) { return std::uint32_t(it - _enumerators.begin()); }
+    }
+    return no_enumerator;
+  }
+
+  string_view str(Slice s) const
+  {
+    return string_view(_tag.data() + s.begin, s.size);
+  }
+
+  /** @returns the serialized size of an arithmetic tag, or variable_size */
+  static std::uint32_t arithmetic_size(char tag)
+  {
+    switch (tag)
+    {
+    case 'y': case 'c': case 'b': case 'B': return 1;
+    case 's': case 'S': return 2;
+    case 'i': case 'I': case 'f': return 4;
+    case 'l': case 'L': case 'd': return 8;
+    case 'D': return sizeof(long double);
+    default: return variable_size; // packed integers or invalid tags
+    }
+  }
+
+private:
+  // non-recursive struct definitions, by the position of their fields
+  struct CompiledStruct
+  {
+    const char* fields;
+    std::uint32_t op;
+  };
+
+  Slice slice(string_view s) const
+  {
+    return Slice{std::uint32_t(s.data() - _tag.data()), std::uint32_t(s.size())};
+  }
+
+  std::uint32_t push(OpCode code, string_view tag)
+  {
+    Op op;
+    op.code = code;
+    op.tag = slice(tag);
+    _ops.push_back(op);
+    return std::uint32_t(_ops.size() - 1);
+  }
+
+  void compile(string_view full_tag, int max_recursion)
+  {
+    std::vector<CompiledStruct> structs;
+    if (! full_tag.empty()) { compile_op(full_tag, full_tag, max_recursion, structs); }
+
+    // the children of each op follow it: compute their sizes first
+    for (std::size_t i = _ops.size(); i-- != 0;)
+    {
+      _ops[i].fixed_size = compute_fixed_size(std::uint32_t(i));
+    }
+  }
+
+  /** @pre the fixed_size of the ops after `index` is computed */
+  std::uint32_t compute_fixed_size(std::uint32_t index) const
+  {
+    const Op& op = _ops[index];
+    switch (op.code)
+    {
+    case OpCode::Empty:
+      return 0;
+    case OpCode::Arithmetic:
+    case OpCode::Enum:
+      return arithmetic_size(op.arithmetic);
+    case OpCode::Field:
+      return _ops[index + 1].fixed_size;
+    case OpCode::Tuple:
+    case OpCode::Struct:
+    {
+      std::uint64_t sum = 0;
+      for (std::uint32_t elem = index + 1; elem != op.end; elem = _ops[elem].end)
+      {
+        sum += _ops[elem].fixed_size; // variable_size makes the sum too large
+      }
+      return (sum < variable_size) ? std::uint32_t(sum) : std::uint32_t{variable_size};
+    }
+    default: // sequences, variants, recursive structs and invalid tags
+      return variable_size;
+    }
+  }
+
+  // mirrors detail::visit_impl
+  void compile_op(string_view full_tag, string_view tag, int max_recursion, std::vector<CompiledStruct>& structs)
+  {
+    if (max_recursion == 0)
+    {
+      const std::uint32_t i = push(OpCode::RecursionLimit, tag);
+      _ops[i].end = i + 1;
+      return;
+    }
+
+    if (tag.empty())
+    {
+      const std::uint32_t i = push(OpCode::Empty, tag);
+      _ops[i].end = i + 1;
+      return;
+    }
+
+    switch (tag.front())
+    {
+    case '[': compile_sequence(full_tag, tag, max_recursion - 1, structs); break;
+    case '(': compile_tuple(full_tag, tag, max_recursion - 1, structs); break;
+    case '<': compile_variant(full_tag, tag, max_recursion - 1, structs); break;
+    case '{': compile_struct(full_tag, tag, max_recursion - 1, structs); break;
+    case '/': compile_enum(tag); break;
+    default:  compile_arithmetic(tag); break;
+    }
+  }
+
+  void compile_arithmetic(string_view tag)
+  {
+    const bool valid = string_view("ycbsilBSILqQfdD").find(tag.front()) != string_view::npos;
+    const std::uint32_t i = push(valid ? OpCode::Arithmetic : OpCode::Invalid, string_view(tag.data(), 1));
+    _ops[i].arithmetic = tag.front();
+    _ops[i].end = i + 1;
+  }
+
+  void compile_sequence(string_view full_tag, string_view tag, int max_recursion, std::vector<CompiledStruct>& structs)
+  {
+    tag.remove_prefix(1); // drop [
+    const string_view elem_tag = detail::tag_pop(tag);
+
+    const std::uint32_t i = push(OpCode::Sequence, elem_tag);
+    try
+    {
+      _ops[i].singular = singular(full_tag, elem_tag, max_recursion);
+    }
+    catch (const std::runtime_error&)
+    {
+      // too deep to tell, visiting the elements one by one throws the same
+    }
+
+    compile_op(full_tag, elem_tag, max_recursion, structs);
+    _ops[i].end = std::uint32_t(_ops.size());
+  }
+
+  void compile_tuple(string_view full_tag, string_view tag, int max_recursion, std::vector<CompiledStruct>& structs)
+  {
+    tag.remove_prefix(1); // drop (
+    tag.remove_suffix(1); // drop )
+
+    const std::uint32_t i = push(OpCode::Tuple, tag);
+    for (string_view elem_tag = detail::tag_pop(tag); ! elem_tag.empty(); elem_tag = detail::tag_pop(tag))
+    {
+      compile_op(full_tag, elem_tag, max_recursion, structs);
+    }
+    _ops[i].end = std::uint32_t(_ops.size());
+  }
+
+  void compile_variant(string_view full_tag, string_view tag, int max_recursion, std::vector<CompiledStruct>& structs)
+  {
+    tag.remove_prefix(1); // drop <
+    tag.remove_suffix(1); // drop >
+
+    const std::uint32_t i = push(OpCode::Variant, tag);
+
+    // nested variants add options while compiling, collect these first
+    std::vector<Option> options;
+    for (string_view option_tag = detail::tag_pop(tag); ! option_tag.empty(); option_tag = detail::tag_pop(tag))
+    {
+      options.push_back(Option{std::uint32_t(_ops.size()), slice(option_tag)});
+      if (option_tag == "0")
+      {
+        const std::uint32_t o = push(OpCode::Null, option_tag);
+        _ops[o].arithmetic = '0';
+        _ops[o].end = o + 1;
+      }
+      else
+      {
+        compile_op(full_tag, option_tag, max_recursion, structs);
+      }
+    }
+
+    _ops[i].target = std::uint32_t(_options.size());
+    _ops[i].count = std::uint32_t(options.size());
+    _options.insert(_options.end(), options.begin(), options.end());
+    _ops[i].end = std::uint32_t(_ops.size());
+  }
+
+  void compile_struct(string_view full_tag, string_view tag, int max_recursion, std::vector<CompiledStruct>& structs)
+  {
+    tag.remove_suffix(1); // drop }
+
+    string_view intro = detail::remove_prefix_before(tag, '`');
+
+    if (tag.empty())
+    {
+      // perhaps a recursive struct?
+      tag = detail::resolve_recursive_tag(full_tag, intro);
+    }
+
+    intro.remove_prefix(1); // drop {
+
+    if (! tag.empty())
+    {
+      for (const CompiledStruct& s : structs)
+      {
+        if (s.fields != tag.data()) { continue; }
+
+        // the definition is already being compiled: reference it
+        const std::uint32_t i = push(OpCode::StructRef, tag);
+        _ops[i].name = slice(intro);
+        _ops[i].target = s.op;
+        _ops[i].end = i + 1;
+        return;
+      }
+    }
+
+    const std::uint32_t i = push(OpCode::Struct, tag);
+    _ops[i].name = slice(intro);
+    if (! tag.empty()) { structs.push_back(CompiledStruct{tag.data(), i}); }
+
+    while (! tag.empty())
+    {
+      const string_view field_name = detail::tag_pop_label(tag);
+      const string_view field_tag = detail::tag_pop(tag);
+
+      const std::uint32_t f = push(OpCode::Field, field_tag);
+      _ops[f].name = slice(field_name);
+      compile_op(full_tag, field_tag, max_recursion, structs);
+      _ops[f].end = std::uint32_t(_ops.size());
+    }
+
+    _ops[i].end = std::uint32_t(_ops.size());
+  }
+
+  // mirrors detail::visit_enum
+  void compile_enum(string_view tag)
+  {
+    const string_view full_enum_tag = tag;
+    tag.remove_prefix(1); // drop slash
+    tag.remove_suffix(1); // drop backslash
+
+    if (tag.empty())
+    {
+      const std::uint32_t i = push(OpCode::Invalid, full_enum_tag);
+      _ops[i].end = i + 1;
+      return;
+    }
+
+    const std::uint32_t i = push(OpCode::Enum, full_enum_tag);
+    _ops[i].arithmetic = tag[0];
+    _ops[i].end = i + 1;
+
+    tag.remove_prefix((std::min)(tag.size(), std::size_t(2))); // drop underlying_type_tag and `
+    _ops[i].name = slice(detail::remove_prefix_before(tag, '\''));
+
+    // tag = 'value`name'value`name'...
+    if (! tag.empty()) { tag.remove_prefix(1); } // drop '
+
+    EnumTable table;
+    table.first = std::uint32_t(_enumerators.size());
+    table.sorted = true;
+    while (! tag.empty())
+    {
+      const string_view value = detail::remove_prefix_before(tag, '`');
+      if (tag.empty()) { break; }
+      const string_view name = detail::tag_pop_label(tag);
+
+      Enumerator e{slice(value), slice(name), 0};
+      table.sorted = detail::parse_enum_key(_ops[i].arithmetic, value, e.key) && table.sorted;
+      _enumerators.push_back(e);
+    }
+    table.count = std::uint32_t(_enumerators.size()) - table.first;
+
+    if (table.sorted && table.count != 0)
+    {
+      const auto begin = _enumerators.begin() + table.first;
+      const auto end = _enumerators.end();
+
+      // stable: the first of the enumerators with the same value is found, as by visit(tag)
+      std::stable_sort(begin, end, [](const Enumerator& a, const Enumerator& b) { return a.key < b.key; });
+
+      table.min_key = begin->key;
+      const std::uint64_t range = (end - 1)->key - table.min_key;
+      if (range < 2 * std::uint64_t(table.count) + 8)
+      {
+        table.dense_first = std::uint32_t(_dense.size());
+        table.dense_size = std::uint32_t(range + 1);
+        _dense.resize(_dense.size() + table.dense_size, std::uint32_t{no_enumerator});
+        for (std::uint32_t k = table.count; k-- != 0;) // backwards: the first one wins
+        {
+          const Enumerator& e = _enumerators[table.first + k];
+          _dense[table.dense_first + std::size_t(e.key - table.min_key)] = table.first + k;
+        }
+      }
+    }
+
+    _ops[i].target = std::uint32_t(_enums.size());
+    _enums.push_back(table);
+  }
+
+  std::string _tag;
+  int _max_recursion = 2048;
+  std::vector<Op> _ops;
+  std::vector<Option> _options;
+  std::vector<Enumerator> _enumerators;
+  std::vector<EnumTable> _enums;
+  std::vector<std::uint32_t> _dense;
+};
+
+} // namespace mserialize
+
+#endif // MSERIALIZE_VISIT_PLAN_HPP
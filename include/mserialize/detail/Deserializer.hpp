@@ -3,14 +3,21 @@
 
 #include <mserialize/detail/sequence_traits.hpp>
 #include <mserialize/detail/type_traits.hpp>
+#include <mserialize/sequence_view.hpp>
+#include <mserialize/string_view.hpp>
 
 #include <cassert>
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <stdexcept>
 #include <string> // to_string
 #include <type_traits>
-#include <utility> // move
+#include <utility> // declval, move, pair
+
+#if __cplusplus >= 201703L
+  #include <string_view>
+#endif
 
 namespace mserialize {
 
@@ -81,6 +88,35 @@ struct BuiltinDeserializer<Enum, enable_spec_if<std::is_enum<Enum>>>
   :TrivialDeserializer<Enum>
 {};
 
+// Element maker - creates the elements of sequences deserialized one by one, before insertion.
+// Allocator-aware elements (e.g: std::pmr::string of a std::pmr::set) get the allocator
+// of the sequence, to be allocated from the same memory resource (e.g: an arena),
+// and to be moved, not copied, when inserted.
+
+template <typename T, typename Sequence, typename = void>
+struct ElementMaker
+{
+  static T make(const Sequence& /* s */) { return T{}; }
+};
+
+template <typename T, typename Sequence>
+struct ElementMaker<T, Sequence, enable_spec_if<
+  std::uses_allocator<T, typename Sequence::allocator_type>
+>>
+{
+  static T make(const Sequence& s) { return T(typename T::allocator_type(s.get_allocator())); }
+};
+
+// e.g: map value_type
+template <typename K, typename V, typename Sequence>
+struct ElementMaker<std::pair<K, V>, Sequence>
+{
+  static std::pair<K, V> make(const Sequence& s)
+  {
+    return std::pair<K, V>(ElementMaker<K, Sequence>::make(s), ElementMaker<V, Sequence>::make(s));
+  }
+};
+
 // Sequence deserializer
 
 template <typename Sequence>
@@ -110,7 +146,7 @@ private:
 
     while (size--)
     {
-      T elem;
+      T elem = ElementMaker<T, Sequence>::make(s);
       mserialize::deserialize(elem, istream);
       s.insert(std::move(elem));
     }
@@ -200,6 +236,67 @@ private:
   }
 };
 
+// View deserializers - reference the serialized bytes, without copying them,
+// if the input stream provides direct access, e.g: binlog::Range
+
+template <typename InputStream, typename = void>
+struct has_view : std::false_type {};
+
+template <typename InputStream>
+struct has_view<InputStream, void_t<decltype(
+  static_cast<const char*>(std::declval<InputStream&>().view(std::size_t{}))
+)>> : std::true_type {};
+
+template <typename T, typename InputStream>
+const char* deserialize_view(std::uint32_t& size, InputStream& istream)
+{
+  static_assert(has_view<InputStream>::value,
+    "Deserializing into a view requires an InputStream with `const char* view(size)`, e.g: binlog::Range");
+
+  mserialize::deserialize(size, istream);
+  return istream.view(std::size_t{size} * sizeof(T));
+}
+
+template <>
+struct BuiltinDeserializer<string_view>
+{
+  template <typename InputStream>
+  static void deserialize(string_view& s, InputStream& istream)
+  {
+    std::uint32_t size = 0;
+    const char* data = deserialize_view<char>(size, istream);
+    s = string_view(data, size);
+  }
+};
+
+#if __cplusplus >= 201703L
+
+template <>
+struct BuiltinDeserializer<std::string_view>
+{
+  template <typename InputStream>
+  static void deserialize(std::string_view& s, InputStream& istream)
+  {
+    std::uint32_t size = 0;
+    const char* data = deserialize_view<char>(size, istream);
+    s = std::string_view(data, size);
+  }
+};
+
+#endif
+
+template <typename T>
+struct BuiltinDeserializer<sequence_view<T>>
+{
+  template <typename InputStream>
+  static void deserialize(sequence_view<T>& s, InputStream& istream)
+  {
+    std::uint32_t size = 0;
+    const char* data = deserialize_view<T>(size, istream);
+    s = sequence_view<T>(data, size);
+  }
+};
+
 // Tuple deserializer
 
 template <typename... E, template <class...> class Tuple>
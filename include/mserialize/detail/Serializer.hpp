@@ -78,6 +78,22 @@ struct TrivialSerializer
   }
 };
 
+// has_trivial_serializer: T is serialized as its object representation, sizeof(T) bytes
+
+template <typename T>
+using has_trivial_serializer = std::is_base_of<TrivialSerializer<T>, typename Serializer<T>::type>;
+
+// is_layout_serializable: T is serialized as its object representation,
+// if Serializer<T>::type::is_layout_order(t) holds, e.g: an adapted struct without padding
+
+template <typename T, typename = void>
+struct is_layout_serializable : std::false_type {};
+
+template <typename T>
+struct is_layout_serializable<T, enable_spec_if<
+  std::integral_constant<bool, Serializer<T>::type::is_layout_serializable>
+>> : std::true_type {};
+
 // Arithmetic serializer
 
 template <typename Arithmetic>
@@ -119,7 +135,10 @@ struct BuiltinSerializer<Sequence, enable_spec_if<
     // However, that would need a lot of code, so we just
     // let the optimizer do the job.
     return sizeof(std::uint32_t)
-         + sizeof_elems(std::is_arithmetic<sequence_data_t<const Sequence>>{}, s);
+         + sizeof_elems(std::integral_constant<bool,
+             std::is_arithmetic<sequence_data_t<const Sequence>>::value
+          || is_layout_serializable<value_type>::value
+           >{}, s);
   }
 
 private:
@@ -128,15 +147,42 @@ private:
   template <typename OutputStream>
   static void serialize_elems(
     std::false_type /* no batch copy */,
-    const Sequence& s, std::uint32_t /* size */, OutputStream& ostream
+    const Sequence& s, std::uint32_t size, OutputStream& ostream
   )
   {
+    using layout_copy = conjunction<
+      sequence_has_contiguous_data<const Sequence>,
+      is_layout_serializable<value_type>
+    >;
+    if (serialize_layout(layout_copy{}, s, size, ostream)) { return; }
+
     for (auto&& elem : s)
     {
       mserialize::serialize<value_type>(elem, ostream);
     }
   }
 
+  template <typename OutputStream>
+  static bool serialize_layout(
+    std::true_type /* elements might be copied at once */,
+    const Sequence& s, std::uint32_t size, OutputStream& ostream
+  )
+  {
+    // the layout depends only on the type, checking the first element is enough
+    const auto* data = sequence_data(s);
+    if (size == 0 || ! Serializer<value_type>::type::is_layout_order(*data)) { return false; }
+
+    const std::size_t serialized_size = sizeof(value_type) * size;
+    ostream.write(reinterpret_cast<const char*>(data), std::streamsize(serialized_size));
+    return true;
+  }
+
+  template <typename OutputStream>
+  static bool serialize_layout(std::false_type, const Sequence&, std::uint32_t, OutputStream&)
+  {
+    return false;
+  }
+
   template <typename OutputStream>
   static void serialize_elems(
     std::true_type /* batch copy */,
@@ -168,11 +214,11 @@ private:
   }
 
   static std::size_t sizeof_elems(
-    std::true_type /* value_type is arithmetic */,
+    std::true_type /* value_type is arithmetic or layout serializable */,
     const Sequence& s
   )
   {
-    return std::size_t(sequence_size(s)) * sizeof(sequence_data_t<const Sequence>);
+    return std::size_t(sequence_size(s)) * sizeof(value_type);
   }
 };
 
@@ -4,6 +4,7 @@
 #include <mserialize/cx_string.hpp>
 #include <mserialize/detail/sequence_traits.hpp>
 #include <mserialize/detail/type_traits.hpp>
+#include <mserialize/sequence_view.hpp>
 
 #include <type_traits>
 
@@ -96,6 +97,20 @@ struct BuiltinTag<Sequence, enable_spec_if<
   }
 };
 
+// Sequence view tag - same as of the viewed sequence
+
+template <typename T>
+struct BuiltinTag<sequence_view<T>>
+{
+  static constexpr auto tag_string()
+  {
+    return cx_strcat(
+      make_cx_string("["),
+      Tag<T>::type::tag_string()
+    );
+  }
+};
+
 // Tuple tag
 
 template <typename... E, template <class...> class Tuple>
@@ -1,14 +1,20 @@
 #ifndef MSERIALIZE_DETAIL_VISIT_HPP
 #define MSERIALIZE_DETAIL_VISIT_HPP
 
+#include <mserialize/VisitPlan.hpp>
 #include <mserialize/Visitor.hpp>
 #include <mserialize/deserialize.hpp>
 #include <mserialize/singular.hpp>
 
 #include <mserialize/detail/integer_to_hex.hpp>
+#include <mserialize/detail/packed_integer.hpp>
 #include <mserialize/detail/tag_util.hpp>
+#include <mserialize/detail/type_traits.hpp>
 
+#include <cstddef>
+#include <cstdint>
 #include <type_traits>
+#include <utility> // declval
 
 namespace mserialize {
 namespace detail {
@@ -45,11 +51,35 @@ public:
   }
 };
 
+/** Convert a single visited integer to a hex string and to an enum_key */
+class EnumValue
+{
+  IntegerToHex _hex;
+  std::uint64_t _key = 0;
+
+public:
+  template <typename Integer>
+  std::enable_if_t<std::is_integral<Integer>::value>
+  visit(Integer v)
+  {
+    _hex.visit(v);
+    _key = enum_key(v);
+  }
+
+  template <typename T>
+  std::enable_if_t<!std::is_integral<T>::value>
+  visit(T) {}
+
+  string_view hex() const { return _hex.value(); }
+
+  std::uint64_t key() const { return _key; }
+};
+
 // forward declaration
 template <typename Visitor, typename InputStream>
 void visit_impl(string_view full_tag, string_view tag, Visitor& visitor, InputStream& istream, int max_recursion);
 
-/** @pre tag in "ycbsilBSILfdD" */
+/** @pre tag in "ycbsilBSILqQfdD" */
 template <typename Visitor, typename InputStream>
 void visit_arithmetic(char tag, Visitor& visitor, InputStream& istream)
 {
@@ -68,6 +98,9 @@ void visit_arithmetic(char tag, Visitor& visitor, InputStream& istream)
   case 'I': std::uint32_t I; mserialize::deserialize(I, istream); visitor.visit(I); break;
   case 'L': std::uint64_t L; mserialize::deserialize(L, istream); visitor.visit(L); break;
 
+  case 'q': { const std::int64_t q = std::int64_t(deserialize_packed(istream)); visitor.visit(q); break; }
+  case 'Q': { const std::uint64_t Q = deserialize_packed(istream); visitor.visit(Q); break; }
+
   case 'f': float f;       mserialize::deserialize(f, istream); visitor.visit(f); break;
   case 'd': double d;      mserialize::deserialize(d, istream); visitor.visit(d); break;
   case 'D': long double D; mserialize::deserialize(D, istream); visitor.visit(D); break;
@@ -276,6 +309,252 @@ void visit_impl(const string_view full_tag, string_view tag, Visitor& visitor, I
   }
 }
 
+/**
+ * True if InputStream tells the number of remaining bytes by size(),
+ * and can read them by read_unchecked(char*, size_t), like binlog::Range.
+ */
+template <typename InputStream, typename = void>
+struct has_unchecked_read : std::false_type {};
+
+template <typename InputStream>
+struct has_unchecked_read<InputStream, void_t<
+  decltype(std::declval<const InputStream&>().size()),
+  decltype(std::declval<InputStream&>().read_unchecked(std::declval<char*>(), std::size_t{}))
+>> : std::true_type {};
+
+/** @returns true if `size` bytes can be read from `istream` by read_unchecked */
+template <typename InputStream>
+std::enable_if_t<has_unchecked_read<InputStream>::value, bool>
+can_read_unchecked(const InputStream& istream, std::uint64_t size)
+{
+  return size <= istream.size();
+}
+
+template <typename InputStream>
+std::enable_if_t<! has_unchecked_read<InputStream>::value, bool>
+can_read_unchecked(const InputStream& /* istream */, std::uint64_t /* size */)
+{
+  return false;
+}
+
+/** @pre can_read_unchecked(istream, sizeof(T)) */
+template <typename T, typename InputStream>
+std::enable_if_t<has_unchecked_read<InputStream>::value, T>
+read_unchecked(InputStream& istream)
+{
+  T t;
+  istream.read_unchecked(reinterpret_cast<char*>(&t), sizeof(T));
+  return t;
+}
+
+template <typename T, typename InputStream>
+std::enable_if_t<! has_unchecked_read<InputStream>::value, T>
+read_unchecked(InputStream& istream)
+{
+  T t;
+  mserialize::deserialize(t, istream);
+  return t;
+}
+
+/**
+ * Same as visit_arithmetic, without checking the size of `istream` for each value.
+ *
+ * @pre can_read_unchecked(istream, VisitPlan::arithmetic_size(tag))
+ */
+template <typename Visitor, typename InputStream>
+void visit_arithmetic_unchecked(char tag, Visitor& visitor, InputStream& istream)
+{
+  switch(tag)
+  {
+  case 'y': visitor.visit(read_unchecked<bool>(istream)); break;
+  case 'c': visitor.visit(read_unchecked<char>(istream)); break;
+
+  case 'b': visitor.visit(read_unchecked<std::int8_t >(istream)); break;
+  case 's': visitor.visit(read_unchecked<std::int16_t>(istream)); break;
+  case 'i': visitor.visit(read_unchecked<std::int32_t>(istream)); break;
+  case 'l': visitor.visit(read_unchecked<std::int64_t>(istream)); break;
+
+  case 'B': visitor.visit(read_unchecked<std::uint8_t >(istream)); break;
+  case 'S': visitor.visit(read_unchecked<std::uint16_t>(istream)); break;
+  case 'I': visitor.visit(read_unchecked<std::uint32_t>(istream)); break;
+  case 'L': visitor.visit(read_unchecked<std::uint64_t>(istream)); break;
+
+  case 'f': visitor.visit(read_unchecked<float      >(istream)); break;
+  case 'd': visitor.visit(read_unchecked<double     >(istream)); break;
+  case 'D': visitor.visit(read_unchecked<long double>(istream)); break;
+  default: visit_arithmetic(tag, visitor, istream); break; // not of fixed size
+  }
+}
+
+/**
+ * Visit the object described by `plan.ops()[index]`.
+ *
+ * Calls the same visitor methods in the same order
+ * as visit_impl does with the tag `plan` was compiled from.
+ *
+ * Tuples, structs and sequences of objects of fixed size (see VisitPlan::Op::fixed_size)
+ * are checked to fit `istream` once, their elements are then read by read_unchecked,
+ * if `istream` supports it. If they do not fit, the elements are read one by one,
+ * and the same error is raised at the same element, as without the check.
+ *
+ * @param validated true if the object is known to fit `istream`
+ * @pre index < plan.ops().size()
+ * @throws std::runtime_error if max_recursion is 0
+ */
+template <typename Visitor, typename InputStream>
+void visit_plan_impl(const VisitPlan& plan, std::uint32_t index, Visitor& visitor, InputStream& istream, int max_recursion, bool validated = false)
+{
+  if (max_recursion == 0) { throw std::runtime_error("Recursion limit exceeded while visiting tag: " + plan.tag().to_string()); }
+
+  using OpCode = VisitPlan::OpCode;
+  const VisitPlan::Op* op = &plan.ops()[index];
+
+  switch (op->code)
+  {
+  case OpCode::Empty:
+  case OpCode::Field: // Field ops are visited by their Struct
+    break;
+  case OpCode::Arithmetic:
+    if (validated) { visit_arithmetic_unchecked(op->arithmetic, visitor, istream); }
+    else { visit_arithmetic(op->arithmetic, visitor, istream); }
+    break;
+  case OpCode::Sequence:
+  {
+    std::uint32_t size;
+    mserialize::deserialize(size, istream);
+    const string_view elem_tag = plan.str(op->tag);
+
+    const bool skip = visitor.visit(mserialize::Visitor::SequenceBegin{size, elem_tag}, istream);
+    if (skip) { return; }
+
+    const std::uint32_t elem = index + 1;
+    const std::uint32_t elem_size = plan.ops()[elem].fixed_size;
+    const bool elems_validated = elem_size != VisitPlan::variable_size
+      && can_read_unchecked(istream, std::uint64_t(size) * elem_size);
+
+    if (size > 32 && op->singular)
+    {
+      // every elem in the seq are the same and serialized using 0 bytes.
+      // visit the first one only, to prevent little input generating huge output
+      visitor.visit(mserialize::Visitor::RepeatBegin{size, elem_tag});
+      visit_plan_impl(plan, elem, visitor, istream, max_recursion - 1);
+      visitor.visit(mserialize::Visitor::RepeatEnd{size, elem_tag});
+    }
+    else if (plan.ops()[elem].code == OpCode::Arithmetic && max_recursion > 1)
+    {
+      // run of arithmetic values, no need to dispatch on each
+      const char elem_arithmetic = plan.ops()[elem].arithmetic;
+      if (elems_validated)
+      {
+        while (size--) { visit_arithmetic_unchecked(elem_arithmetic, visitor, istream); }
+      }
+      else
+      {
+        while (size--) { visit_arithmetic(elem_arithmetic, visitor, istream); }
+      }
+    }
+    else
+    {
+      while (size--)
+      {
+        visit_plan_impl(plan, elem, visitor, istream, max_recursion - 1, elems_validated);
+      }
+    }
+
+    visitor.visit(mserialize::Visitor::SequenceEnd{});
+    break;
+  }
+  case OpCode::Tuple:
+  {
+    const bool skip = visitor.visit(mserialize::Visitor::TupleBegin{plan.str(op->tag)}, istream);
+    if (skip) { return; }
+
+    const bool elems_validated = validated
+      || (op->fixed_size != VisitPlan::variable_size && can_read_unchecked(istream, op->fixed_size));
+    for (std::uint32_t elem = index + 1; elem != op->end; elem = plan.ops()[elem].end)
+    {
+      visit_plan_impl(plan, elem, visitor, istream, max_recursion - 1, elems_validated);
+    }
+
+    visitor.visit(mserialize::Visitor::TupleEnd{});
+    break;
+  }
+  case OpCode::Variant:
+  {
+    std::uint8_t discriminator;
+    mserialize::deserialize(discriminator, istream);
+
+    const VisitPlan::Option* option = (discriminator < op->count)
+      ? &plan.options()[op->target + discriminator]
+      : nullptr;
+    const string_view option_tag = option ? plan.str(option->tag) : string_view{};
+
+    const bool skip = visitor.visit(mserialize::Visitor::VariantBegin{discriminator, option_tag}, istream);
+    if (skip) { return; }
+
+    if (option != nullptr && plan.ops()[option->op].code == OpCode::Null)
+    {
+      visitor.visit(mserialize::Visitor::Null{});
+    }
+    else if (option != nullptr)
+    {
+      visit_plan_impl(plan, option->op, visitor, istream, max_recursion - 1);
+    }
+
+    visitor.visit(mserialize::Visitor::VariantEnd{});
+    break;
+  }
+  case OpCode::StructRef:
+  case OpCode::Struct:
+  {
+    if (op->code == OpCode::StructRef)
+    {
+      index = op->target;
+      op = &plan.ops()[index];
+    }
+
+    const bool skip = visitor.visit(mserialize::Visitor::StructBegin{plan.str(op->name), plan.str(op->tag)}, istream);
+    if (skip) { return; }
+
+    const bool fields_validated = validated
+      || (op->fixed_size != VisitPlan::variable_size && can_read_unchecked(istream, op->fixed_size));
+    for (std::uint32_t field = index + 1; field != op->end; field = plan.ops()[field].end)
+    {
+      const VisitPlan::Op& field_op = plan.ops()[field];
+      visitor.visit(mserialize::Visitor::FieldBegin{plan.str(field_op.name), plan.str(field_op.tag)});
+      visit_plan_impl(plan, field + 1, visitor, istream, max_recursion - 1, fields_validated);
+      visitor.visit(mserialize::Visitor::FieldEnd{});
+    }
+
+    visitor.visit(mserialize::Visitor::StructEnd{});
+    break;
+  }
+  case OpCode::Enum:
+  {
+    // convert the discriminator to hex
+    EnumValue value;
+    if (validated) { visit_arithmetic_unchecked(op->arithmetic, value, istream); }
+    else { visit_arithmetic(op->arithmetic, value, istream); }
+
+    const VisitPlan::EnumTable& table = plan.enums()[op->target];
+    const std::uint32_t e = plan.find_enumerator(table, value.key(), value.hex());
+    const string_view enumerator = (e != VisitPlan::no_enumerator) ? plan.str(plan.enumerators()[e].name) : string_view{};
+
+    visitor.visit(mserialize::Visitor::Enum{plan.str(op->name), enumerator, op->arithmetic, value.hex()});
+    break;
+  }
+  case OpCode::Invalid:
+  case OpCode::Null: // Null is only valid as a variant option, handled above
+    if (plan.str(op->tag).front() == '/')
+    {
+      throw std::runtime_error("Invalid enum tag: ''");
+    }
+    throw std::runtime_error(std::string("Invalid arithmetic tag: ") + op->arithmetic);
+  case OpCode::RecursionLimit:
+    throw std::runtime_error("Recursion limit exceeded while visiting tag: " + plan.tag().to_string());
+  }
+}
+
 } // namespace detail
 } // namespace mserialize
 
@@ -0,0 +1,93 @@
+#ifndef MSERIALIZE_DETAIL_PACKED_INTEGER_HPP
+#define MSERIALIZE_DETAIL_PACKED_INTEGER_HPP
+
+#include <mserialize/deserialize.hpp>
+#include <mserialize/serialize.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <ios> // streamsize
+#include <stdexcept>
+#include <string>
+
+namespace mserialize {
+namespace detail {
+
+/*
+ * Packed integers (tags 'q' and 'Q') are serialized as a header byte,
+ * followed by the significant bytes of the magnitude, little endian:
+ *
+ *    u8 header   // low nibble: number of bytes (0..8), bit 4: negative
+ *    u8[n]       // magnitude
+ *
+ * Negative numbers are negated, so that small negative numbers take
+ * few bytes as well. The decoded value is negated back, modulo 2^64.
+ */
+
+constexpr std::uint8_t packed_negative_flag = 0x10;
+
+/** @returns the number of significant bytes of `magnitude` */
+inline std::size_t packed_byte_count(std::uint64_t magnitude)
+{
+  std::size_t result = 0;
+  while (magnitude != 0) { magnitude >>= 8; ++result; }
+  return result;
+}
+
+/** @returns the value to pack, and sets `negative`, if `value` (two's complement) is less than zero */
+inline std::uint64_t packed_magnitude(std::uint64_t value, bool is_signed, bool& negative)
+{
+  negative = is_signed && (value >> 63) != 0;
+  return negative ? 0 - value : value;
+}
+
+/** Serialize `magnitude` as a packed integer to `ostream` */
+template <typename OutputStream>
+void serialize_packed(std::uint64_t magnitude, bool negative, OutputStream& ostream)
+{
+  const std::size_t count = packed_byte_count(magnitude);
+
+  char buffer[1 + sizeof(magnitude)];
+  buffer[0] = char(count | (negative ? packed_negative_flag : 0u));
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    buffer[1 + i] = char(magnitude & 0xFF);
+    magnitude >>= 8;
+  }
+
+  ostream.write(buffer, std::streamsize(1 + count));
+}
+
+/**
+ * Deserialize an integer serialized by serialize_packed from `istream`.
+ *
+ * @returns the two's complement representation of the integer
+ * @throws std::runtime_error if the header is invalid, or `istream` ends too early
+ */
+template <typename InputStream>
+std::uint64_t deserialize_packed(InputStream& istream)
+{
+  std::uint8_t header = 0;
+  mserialize::deserialize(header, istream);
+
+  const std::size_t count = header & 0x0F;
+  if (count > sizeof(std::uint64_t) || (header & ~(0x0F | packed_negative_flag)) != 0)
+  {
+    throw std::runtime_error("Invalid packed integer header: " + std::to_string(header));
+  }
+
+  std::uint64_t result = 0;
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    std::uint8_t byte = 0;
+    mserialize::deserialize(byte, istream);
+    result |= std::uint64_t(byte) << (8 * i);
+  }
+
+  return (header & packed_negative_flag) ? 0 - result : result;
+}
+
+} // namespace detail
+} // namespace mserialize
+
+#endif // MSERIALIZE_DETAIL_PACKED_INTEGER_HPP
@@ -0,0 +1,59 @@
+#ifndef MSERIALIZE_SEQUENCE_VIEW_HPP
+#define MSERIALIZE_SEQUENCE_VIEW_HPP
+
+#include <cstddef>
+#include <cstring> // memcpy
+#include <type_traits>
+
+namespace mserialize {
+
+/**
+ * Non-owning view of a serialized sequence of arithmetic values.
+ *
+ * A serialized `std::vector<T>` (or any other sequence of arithmetic `T`)
+ * can be deserialized into a sequence_view<T> without copying the elements,
+ * if the input stream provides direct access to its bytes (e.g: binlog::Range),
+ * see mserialize::deserialize.
+ *
+ * The elements are not necessarily aligned in the input,
+ * therefore they are accessed by copy, not by reference.
+ * The view is valid as long as the underlying input is valid.
+ */
+template <typename T>
+class sequence_view
+{
+  static_assert(std::is_arithmetic<T>::value, "sequence_view requires an arithmetic value type");
+
+public:
+  using value_type = T;
+  using size_type = std::size_t;
+
+  sequence_view() = default;
+
+  /** View `size` elements, serialized at `data` */
+  sequence_view(const char* data, size_type size)
+    :_data(data), _size(size)
+  {}
+
+  size_type size() const noexcept { return _size; }
+  bool empty()     const noexcept { return _size == 0; }
+
+  /** @returns a copy of the element at `pos` @pre pos < size() */
+  T operator[](size_type pos) const noexcept
+  {
+    T result;
+    memcpy(&result, _data + pos * sizeof(T), sizeof(T));
+    return result;
+  }
+
+  /** @returns the serialized elements, size() * sizeof(T) bytes */
+  const char* data() const noexcept { return _data; }
+
+private:
+  const char* _data = nullptr;
+  size_type _size = 0;
+};
+
+} // namespace mserialize
+
+#endif // MSERIALIZE_SEQUENCE_VIEW_HPP
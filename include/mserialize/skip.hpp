@@ -0,0 +1,190 @@
+#ifndef MSERIALIZE_SKIP_HPP
+#define MSERIALIZE_SKIP_HPP
+
+#include <mserialize/VisitPlan.hpp>
+#include <mserialize/deserialize.hpp>
+#include <mserialize/string_view.hpp>
+
+#include <mserialize/detail/packed_integer.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <ios> // streamsize
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+namespace mserialize {
+namespace detail {
+
+/** Drop `size` bytes of `istream`, without copying them if it has a view (see has_view) */
+template <typename InputStream>
+std::enable_if_t<has_view<InputStream>::value>
+skip_bytes(InputStream& istream, std::uint64_t size)
+{
+  if (size > std::uint64_t(~std::size_t(0))) { throw std::runtime_error("Skipped object is too large"); }
+  istream.view(std::size_t(size));
+}
+
+template <typename InputStream>
+std::enable_if_t<! has_view<InputStream>::value>
+skip_bytes(InputStream& istream, std::uint64_t size)
+{
+  char buffer[256];
+  while (size != 0)
+  {
+    const std::uint64_t chunk = (size < sizeof(buffer)) ? size : sizeof(buffer);
+    istream.read(buffer, std::streamsize(chunk));
+    size -= chunk;
+  }
+}
+
+/**
+ * Drop the object described by `plan.ops()[index]` from `istream`.
+ *
+ * Objects of fixed size (see VisitPlan::Op::fixed_size) are dropped at once,
+ * only the size prefixes, variant discriminators and packed integers are read.
+ *
+ * @pre index < plan.ops().size()
+ * @throws std::runtime_error if max_recursion is 0
+ */
+template <typename InputStream>
+void skip_plan_impl(const VisitPlan& plan, std::uint32_t index, InputStream& istream, int max_recursion)
+{
+  if (max_recursion == 0) { throw std::runtime_error("Recursion limit exceeded while visiting tag: " + plan.tag().to_string()); }
+
+  using OpCode = VisitPlan::OpCode;
+  const VisitPlan::Op* op = &plan.ops()[index];
+
+  if (op->fixed_size != VisitPlan::variable_size)
+  {
+    skip_bytes(istream, op->fixed_size);
+    return;
+  }
+
+  switch (op->code)
+  {
+  case OpCode::Empty:
+  case OpCode::Field: // Field ops are skipped by their Struct
+    break;
+  case OpCode::Arithmetic:
+  case OpCode::Enum:
+    // not of fixed size: packed integer, or invalid
+    if (op->arithmetic != 'q' && op->arithmetic != 'Q')
+    {
+      throw std::runtime_error(std::string("Invalid arithmetic tag: ") + op->arithmetic);
+    }
+    deserialize_packed(istream);
+    break;
+  case OpCode::Sequence:
+  {
+    std::uint32_t size;
+    mserialize::deserialize(size, istream);
+
+    const std::uint32_t elem = index + 1;
+    const std::uint32_t elem_size = plan.ops()[elem].fixed_size;
+    if (elem_size != VisitPlan::variable_size && max_recursion > 1)
+    {
+      skip_bytes(istream, std::uint64_t(size) * elem_size);
+    }
+    else
+    {
+      while (size--)
+      {
+        skip_plan_impl(plan, elem, istream, max_recursion - 1);
+      }
+    }
+    break;
+  }
+  case OpCode::Tuple:
+    for (std::uint32_t elem = index + 1; elem != op->end; elem = plan.ops()[elem].end)
+    {
+      skip_plan_impl(plan, elem, istream, max_recursion - 1);
+    }
+    break;
+  case OpCode::Variant:
+  {
+    std::uint8_t discriminator;
+    mserialize::deserialize(discriminator, istream);
+
+    // out of range discriminators have no value, as in visit
+    if (discriminator < op->count)
+    {
+      const std::uint32_t option = plan.options()[op->target + discriminator].op;
+      if (plan.ops()[option].code != OpCode::Null)
+      {
+        skip_plan_impl(plan, option, istream, max_recursion - 1);
+      }
+    }
+    break;
+  }
+  case OpCode::StructRef:
+  case OpCode::Struct:
+  {
+    if (op->code == OpCode::StructRef)
+    {
+      index = op->target;
+      op = &plan.ops()[index];
+    }
+
+    for (std::uint32_t field = index + 1; field != op->end; field = plan.ops()[field].end)
+    {
+      skip_plan_impl(plan, field + 1, istream, max_recursion - 1);
+    }
+    break;
+  }
+  case OpCode::Invalid:
+  case OpCode::Null: // Null is only valid as a variant option, handled above
+    if (plan.str(op->tag).front() == '/')
+    {
+      throw std::runtime_error("Invalid enum tag: ''");
+    }
+    throw std::runtime_error(std::string("Invalid arithmetic tag: ") + op->arithmetic);
+  case OpCode::RecursionLimit:
+    throw std::runtime_error("Recursion limit exceeded while visiting tag: " + plan.tag().to_string());
+  }
+}
+
+} // namespace detail
+
+/**
+ * Drop the serialized object described by `plan` from `istream`,
+ * without visiting or deserializing its values.
+ *
+ * Same as visiting the object with a visitor that ignores every value,
+ * but objects of fixed size, and sequences of them, are dropped at once,
+ * e.g: skipping a vector<double> reads its size only.
+ * Drops the bytes by `istream.view(size)` if available (e.g: binlog::Range),
+ * or else reads them.
+ * `plan` can be reused for any number of skips.
+ *
+ * @requires `istream` must model the mserialize::InputStream concept.
+ * @pre `istream` must contain a serialized object,
+ *   whose type tag is `plan.tag()`.
+ * @throws std::exception if reading of `istream` fails.
+ * @throws std::runtime_error if the object is too deeply nested,
+ *   or plan.tag() is syntactically invalid, as visit does.
+ */
+template <typename InputStream>
+void skip(const VisitPlan& plan, InputStream& istream)
+{
+  if (plan.ops().empty()) { return; }
+  detail::skip_plan_impl(plan, 0, istream, plan.max_recursion());
+}
+
+/**
+ * Drop the serialized object of type `tag` from `istream`.
+ *
+ * Compiles `tag` on each call: to skip objects
+ * of the same tag repeatedly, compile a VisitPlan once,
+ * and call skip(plan, istream).
+ */
+template <typename InputStream>
+void skip(string_view tag, InputStream& istream)
+{
+  skip(VisitPlan(tag), istream);
+}
+
+} // namespace mserialize
+
+#endif // MSERIALIZE_SKIP_HPP
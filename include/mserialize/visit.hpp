@@ -3,6 +3,8 @@
 
 #include <mserialize/detail/Visit.hpp>
 
+#include <mserialize/VisitPlan.hpp>
+
 #include <mserialize/cx_string.hpp>
 #include <mserialize/string_view.hpp>
 
@@ -28,6 +30,30 @@ void visit(string_view tag, Visitor& visitor, InputStream& istream)
   detail::visit_impl(tag, tag, visitor, istream, 2048);
 }
 
+/**
+ * Visit the serialized objects in `istream`,
+ * as described by the precompiled `plan`.
+ *
+ * Same as visit(plan.tag(), visitor, istream),
+ * without parsing the tag again.
+ * `plan` can be reused for any number of visits.
+ *
+ * @requires `visitor` to model the Visitor concept, see Vistor.hpp
+ * @requires `istream` must model the mserialize::InputStream concept.
+ * @pre `istream` must contain a serialized object,
+ *   whose type tag is `plan.tag()`.
+ * @throws std::exception if reading of `istream` fails.
+ * @throws std::runtime_error if the object is too deeply nested,
+ *   to prevent stack overflow.
+ * @throws std::runtime_error if plan.tag() is syntactically invalid
+ */
+template <typename Visitor, typename InputStream>
+void visit(const VisitPlan& plan, Visitor& visitor, InputStream& istream)
+{
+  if (plan.ops().empty()) { return; }
+  detail::visit_plan_impl(plan, 0, visitor, istream, plan.max_recursion());
+}
+
 } // namespace mserialize
 
 #endif // MSERIALIZE_VISIT_HPP
@@ -0,0 +1,127 @@
+#include <binlog/AsyncTextOutputStream.hpp>
+
+#include <utility> // move, swap
+
+namespace binlog {
+
+AsyncTextOutputStream::AsyncTextOutputStream(
+  std::ostream& out,
+  std::string eventFormat,
+  std::string dateFormat
+)
+  :AsyncTextOutputStream(out, std::move(eventFormat), std::move(dateFormat), Options{})
+{}
+
+AsyncTextOutputStream::AsyncTextOutputStream(
+  std::ostream& out,
+  std::string eventFormat,
+  std::string dateFormat,
+  Options options
+)
+  :_out(out),
+   _text(out, std::move(eventFormat), std::move(dateFormat)),
+   _options(options),
+   _thread([this]() { run(); })
+{}
+
+AsyncTextOutputStream::~AsyncTextOutputStream()
+{
+  try
+  {
+    close();
+  }
+  catch (...) {} // NOLINT(bugprone-empty-catch) destructor must not throw
+}
+
+AsyncTextOutputStream& AsyncTextOutputStream::write(const char* data, std::streamsize ssize)
+{
+  const std::size_t size = std::size_t(ssize);
+  if (size == 0) { return *this; }
+
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    // a single write larger than the limit is accepted if nothing else is pending
+    _cv.wait(lock, [&]() { return _pending.empty() || _pending.size() + size <= _options.maxPendingBytes; });
+    throwIfFailed();
+    _pending.insert(_pending.end(), data, data + size);
+  }
+  _cv.notify_all();
+
+  return *this;
+}
+
+void AsyncTextOutputStream::flush()
+{
+  std::unique_lock<std::mutex> lock(_mutex);
+  _cv.wait(lock, [this]() { return _pending.empty() && ! _busy; });
+
+  // the formatter thread does not touch _out while the lock is held and nothing is pending
+  _out.flush();
+  throwIfFailed();
+}
+
+void AsyncTextOutputStream::close()
+{
+  if (! _thread.joinable()) { return; }
+
+  // the formatter thread converts the pending data before stopping
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stop = true;
+  }
+  _cv.notify_all();
+  _thread.join();
+
+  _out.flush();
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  throwIfFailed();
+}
+
+void AsyncTextOutputStream::throwIfFailed()
+{
+  // the error is reported once: TextOutputStream can continue after invalid input
+  if (_error)
+  {
+    std::exception_ptr error = _error;
+    _error = nullptr;
+    std::rethrow_exception(error);
+  }
+}
+
+void AsyncTextOutputStream::run()
+{
+  std::vector<char> work;
+
+  while (true)
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _cv.wait(lock, [this]() { return ! _pending.empty() || _stop; });
+    if (_pending.empty()) { break; } // stop
+
+    // keep the capacity of both buffers, to avoid allocations
+    std::swap(work, _pending);
+    _busy = true;
+    lock.unlock();
+    _cv.notify_all(); // writers waiting for space
+
+    std::exception_ptr error;
+    try
+    {
+      _text.write(work.data(), std::streamsize(work.size()));
+    }
+    catch (...)
+    {
+      error = std::current_exception();
+    }
+    work.clear();
+
+    lock.lock();
+    if (error) { _error = error; }
+    _busy = false;
+    lock.unlock();
+    _cv.notify_all();
+  }
+}
+
+} // namespace binlog
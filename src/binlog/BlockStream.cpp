@@ -0,0 +1,214 @@
+#include <binlog/BlockStream.hpp>
+
+#include <binlog/Entries.hpp>
+
+#include <binlog/detail/CompactEvents.hpp>
+#include <binlog/detail/Crc32c.hpp>
+#include <binlog/detail/ForEachEntry.hpp>
+
+#include <algorithm> // min, max
+#include <cstring> // memcpy, memchr
+#include <ostream>
+
+namespace binlog {
+
+namespace {
+
+static_assert(blockHeaderSize == 4 * sizeof(std::uint32_t) + 3 * sizeof(std::uint64_t), "invalid header size");
+constexpr std::size_t crcOffset = 2 * sizeof(std::uint32_t);
+constexpr std::size_t crcBegin = 3 * sizeof(std::uint32_t); // the checksummed bytes begin here
+
+void serializeHeader(const BlockHeader& header, char* out)
+{
+  memcpy(out +  0, &header.magic, sizeof(header.magic));
+  memcpy(out +  4, &header.size, sizeof(header.size));
+  memcpy(out +  8, &header.crc, sizeof(header.crc));
+  memcpy(out + 12, &header.reserved, sizeof(header.reserved));
+  memcpy(out + 16, &header.firstClock, sizeof(header.firstClock));
+  memcpy(out + 24, &header.lastClock, sizeof(header.lastClock));
+  memcpy(out + 32, &header.writerId, sizeof(header.writerId));
+}
+
+void deserializeHeader(const char* in, BlockHeader& header)
+{
+  memcpy(&header.magic, in +  0, sizeof(header.magic));
+  memcpy(&header.size, in +  4, sizeof(header.size));
+  memcpy(&header.crc, in +  8, sizeof(header.crc));
+  memcpy(&header.reserved, in + 12, sizeof(header.reserved));
+  memcpy(&header.firstClock, in + 16, sizeof(header.firstClock));
+  memcpy(&header.lastClock, in + 24, sizeof(header.lastClock));
+  memcpy(&header.writerId, in + 32, sizeof(header.writerId));
+}
+
+/** Extend [first, last] by `clock` */
+void addClock(std::uint64_t clock, bool& hasClock, std::uint64_t& first, std::uint64_t& last)
+{
+  first = (hasClock) ? (std::min)(first, clock) : clock;
+  last = (hasClock) ? (std::max)(last, clock) : clock;
+  hasClock = true;
+}
+
+} // namespace
+
+bool readBlockHeader(Range input, BlockHeader& header)
+{
+  if (input.size() < blockHeaderSize) { return false; }
+
+  const char* data = input.view(blockHeaderSize);
+  BlockHeader result;
+  deserializeHeader(data, result);
+  if (result.magic != blockMagic || result.size > input.size()) { return false; }
+
+  const std::uint32_t crc = detail::crc32c(data + crcBegin, blockHeaderSize - crcBegin);
+  if (detail::crc32c(input.view(result.size), result.size, crc) != result.crc) { return false; }
+
+  header = result;
+  return true;
+}
+
+std::size_t findBlock(const char* data, std::size_t size, std::size_t offset)
+{
+  while (offset < size)
+  {
+    const void* candidate = memchr(data + offset, blockMagic & 0xFF, size - offset);
+    if (candidate == nullptr) { break; }
+    offset = std::size_t(static_cast<const char*>(candidate) - data);
+
+    BlockHeader header;
+    if (readBlockHeader(Range{data + offset, size - offset}, header)) { return offset; }
+    ++offset;
+  }
+  return size;
+}
+
+BlockOutputStream::BlockOutputStream(std::ostream& out)
+  :_out(out)
+{}
+
+BlockOutputStream::~BlockOutputStream()
+{
+  try
+  {
+    flush();
+  }
+  catch (...) {} // NOLINT(bugprone-empty-catch) destructor must not throw
+}
+
+BlockOutputStream& BlockOutputStream::write(const char* data, std::streamsize size)
+{
+  _buffer.insert(_buffer.end(), data, data + size);
+  return *this;
+}
+
+void BlockOutputStream::flush()
+{
+  std::size_t blockBegin = 0;
+  std::uint64_t writerId = noWriterId;
+  bool hasClock = false;
+  std::uint64_t firstClock = 0;
+  std::uint64_t lastClock = 0;
+
+  std::size_t pos = 0;
+  while (_buffer.size() - pos >= sizeof(std::uint32_t))
+  {
+    std::uint32_t entrySize = 0;
+    memcpy(&entrySize, _buffer.data() + pos, sizeof(entrySize));
+    if (_buffer.size() - pos - sizeof(entrySize) < entrySize) { break; } // incomplete entry
+
+    Range payload(_buffer.data() + pos + sizeof(entrySize), entrySize);
+    if (payload.size() >= sizeof(std::uint64_t))
+    {
+      const std::uint64_t tag = payload.read<std::uint64_t>();
+      if (tag == WriterProp::Tag)
+      {
+        if (pos != blockBegin)
+        {
+          writeBlock(blockBegin, pos, writerId, firstClock, lastClock);
+          blockBegin = pos;
+          hasClock = false;
+          firstClock = lastClock = 0;
+        }
+        writerId = (payload.size() >= sizeof(std::uint64_t)) ? payload.read<std::uint64_t>() : noWriterId;
+      }
+      else if (! detail::isSpecialEntryTag(tag) && payload.size() >= sizeof(std::uint64_t))
+      {
+        addClock(payload.read<std::uint64_t>(), hasClock, firstClock, lastClock);
+      }
+      else if (tag == CompactEvents::Tag && ! payload.empty())
+      {
+        const std::uint8_t version = payload.read<std::uint8_t>();
+        detail::CompactDecoder decoder(version);
+        try
+        {
+          while (detail::isSupportedCompactVersion(version) && ! payload.empty())
+          {
+            const detail::CompactEvent event = detail::nextCompactEvent(payload, decoder);
+            addClock(event.clockValue, hasClock, firstClock, lastClock);
+          }
+        }
+        catch (const std::exception&) {} // NOLINT(bugprone-empty-catch) the clocks of a damaged entry are not known
+      }
+    }
+
+    pos += sizeof(entrySize) + entrySize;
+  }
+
+  if (pos != blockBegin)
+  {
+    writeBlock(blockBegin, pos, writerId, firstClock, lastClock);
+  }
+
+  _buffer.erase(_buffer.begin(), _buffer.begin() + std::ptrdiff_t(pos));
+}
+
+void BlockOutputStream::writeBlock(std::size_t begin, std::size_t end, std::uint64_t writerId,
+                                   std::uint64_t firstClock, std::uint64_t lastClock)
+{
+  BlockHeader header;
+  header.magic = blockMagic;
+  header.size = std::uint32_t(end - begin);
+  header.firstClock = firstClock;
+  header.lastClock = lastClock;
+  header.writerId = writerId;
+
+  char buffer[blockHeaderSize];
+  serializeHeader(header, buffer);
+  const std::uint32_t crc = detail::crc32c(buffer + crcBegin, blockHeaderSize - crcBegin);
+  header.crc = detail::crc32c(_buffer.data() + begin, end - begin, crc);
+  memcpy(buffer + crcOffset, &header.crc, sizeof(header.crc));
+
+  _out.write(buffer, std::streamsize(blockHeaderSize));
+  _out.write(_buffer.data() + begin, std::streamsize(end - begin));
+}
+
+BlockEntryStream::BlockEntryStream(Range input)
+  :_data(input.view(0)),
+   _size(input.size()),
+   _entries(Range{})
+{}
+
+Range BlockEntryStream::nextEntryPayload()
+{
+  while (true)
+  {
+    const Range entry = _entries.nextEntryPayload();
+    if (! entry.empty()) { return entry; }
+    if (_pos >= _size) { return {}; }
+
+    BlockHeader header;
+    if (readBlockHeader(Range{_data + _pos, _size - _pos}, header))
+    {
+      _entries = RangeEntryStream(Range{_data + _pos + blockHeaderSize, header.size});
+      _pos += blockHeaderSize + header.size;
+    }
+    else
+    {
+      // damaged block: resync at the next valid one
+      const std::size_t next = findBlock(_data, _size, _pos + 1);
+      _skippedBytes += next - _pos;
+      _pos = next;
+    }
+  }
+}
+
+} // namespace binlog
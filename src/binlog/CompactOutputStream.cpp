@@ -0,0 +1,237 @@
+#include <binlog/CompactOutputStream.hpp>
+
+#include <binlog/Entries.hpp>
+#include <binlog/detail/CompactEvents.hpp>
+#include <binlog/detail/EventSourceTable.hpp>
+
+#include <mserialize/deserialize.hpp>
+
+#include <cstring> // memcpy
+#include <exception>
+#include <ostream>
+#include <utility>
+
+namespace binlog {
+
+namespace {
+
+/** Begin a new CompactEvents entry after this size, to limit the work of readers skipping it */
+constexpr std::size_t maxCompactEventsSize = 1 << 20;
+
+template <typename T>
+void append(std::vector<char>& buffer, const T& value)
+{
+  const char* p = reinterpret_cast<const char*>(&value);
+  buffer.insert(buffer.end(), p, p + sizeof(value));
+}
+
+} // namespace
+
+constexpr std::size_t CompactOutputStream::noPos;
+
+CompactOutputStream::CompactOutputStream(std::ostream& out)
+  :_out(out)
+{}
+
+CompactOutputStream::~CompactOutputStream()
+{
+  try
+  {
+    flush();
+  }
+  catch (...) {} // NOLINT(bugprone-empty-catch) destructor must not throw
+}
+
+CompactOutputStream& CompactOutputStream::write(const char* data, std::streamsize size)
+{
+  if (_partial.empty())
+  {
+    const std::size_t written = writeEntries(data, std::size_t(size));
+    _partial.insert(_partial.end(), data + written, data + size);
+  }
+  else
+  {
+    _partial.insert(_partial.end(), data, data + size);
+    const std::size_t written = writeEntries(_partial.data(), _partial.size());
+    _partial.erase(_partial.begin(), _partial.begin() + std::ptrdiff_t(written));
+  }
+
+  return *this;
+}
+
+void CompactOutputStream::flush()
+{
+  endEventSourceTable();
+  endCompactEvents();
+  endWriterPropBatch();
+
+  if (_buffer.empty()) { return; }
+
+  _out.write(_buffer.data(), std::streamsize(_buffer.size()));
+  _buffer.clear();
+}
+
+std::size_t CompactOutputStream::writeEntries(const char* data, std::size_t size)
+{
+  std::size_t pos = 0;
+  while (size - pos >= sizeof(std::uint32_t))
+  {
+    std::uint32_t entrySize = 0;
+    memcpy(&entrySize, data + pos, sizeof(entrySize));
+    if (size - pos - sizeof(entrySize) < entrySize) { break; } // incomplete
+
+    writeEntry(data + pos + sizeof(entrySize), entrySize);
+    pos += sizeof(entrySize) + entrySize;
+  }
+  return pos;
+}
+
+void CompactOutputStream::writeEntry(const char* payload, std::uint32_t size)
+{
+  std::uint64_t tag = 0;
+  if (size >= sizeof(tag)) { memcpy(&tag, payload, sizeof(tag)); }
+
+  if (tag == EventSource::Tag)
+  {
+    EventSource source;
+    if (readEventSource(payload, size, source) && _eventSourceTables)
+    {
+      endCompactEvents();
+      endWriterPropBatch();
+      _tableSources.push_back(std::move(source));
+      _tableSourcesSize += size;
+      if (_tableSourcesSize >= maxCompactEventsSize) { endEventSourceTable(); }
+      return;
+    }
+  }
+
+  endEventSourceTable();
+
+  const bool special = (tag & (std::uint64_t(1) << 63)) != 0;
+  if (! special && size >= 2 * sizeof(std::uint64_t))
+  {
+    writeEvent(payload, size);
+    return;
+  }
+
+  // special (or invalid) entry, copy as is
+  endCompactEvents();
+  endWriterPropBatch();
+
+  append(_buffer, size);
+  _buffer.insert(_buffer.end(), payload, payload + size);
+
+  if (tag == WriterProp::Tag && size >= 2 * sizeof(std::uint64_t))
+  {
+    _writerPropEnd = _buffer.size(); // batchSize is the last field
+  }
+}
+
+void CompactOutputStream::writeEvent(const char* payload, std::uint32_t size)
+{
+  if (_compactBegin == noPos)
+  {
+    _compactBegin = _buffer.size();
+    append(_buffer, std::uint32_t{0}); // size, set by endCompactEvents
+    const std::uint64_t tag = CompactEvents::Tag;
+    const std::uint8_t version = CompactEvents::formatVersion;
+    append(_buffer, tag);
+    append(_buffer, version);
+    _clock = 0;
+    _counterValues.clear();
+  }
+
+  std::uint64_t eventSourceId = 0;
+  std::uint64_t clock = 0;
+  memcpy(&eventSourceId, payload, sizeof(eventSourceId));
+  memcpy(&clock, payload + sizeof(eventSourceId), sizeof(clock));
+  const char* arguments = payload + sizeof(eventSourceId) + sizeof(clock);
+  const std::size_t argumentsSize = size - sizeof(eventSourceId) - sizeof(clock);
+
+  const std::uint64_t clockDelta = detail::zigzag(clock - _clock);
+  _clock = clock;
+
+  const bool counter = argumentsSize == sizeof(std::uint64_t) && _counterSources.count(eventSourceId) != 0;
+  const std::uint64_t id = (eventSourceId << 1) | (counter ? 1 : 0); // the top bit of event source ids is 0
+
+  std::uint64_t valueDelta = 0;
+  if (counter)
+  {
+    std::uint64_t value = 0;
+    memcpy(&value, arguments, sizeof(value));
+    std::uint64_t& previous = _counterValues[eventSourceId];
+    valueDelta = detail::zigzag(value - previous);
+    previous = value;
+  }
+
+  const std::size_t eventSize = detail::varintSize(id) + detail::varintSize(clockDelta)
+    + (counter ? detail::varintSize(valueDelta) : argumentsSize);
+
+  const std::size_t oldSize = _buffer.size();
+  _buffer.resize(oldSize + detail::varintSize(eventSize) + eventSize);
+  char* dst = _buffer.data() + oldSize;
+  dst = detail::writeVarint(eventSize, dst);
+  dst = detail::writeVarint(id, dst);
+  dst = detail::writeVarint(clockDelta, dst);
+  if (counter)
+  {
+    detail::writeVarint(valueDelta, dst);
+  }
+  else
+  {
+    memcpy(dst, arguments, argumentsSize);
+  }
+
+  if (_buffer.size() - _compactBegin >= maxCompactEventsSize) { endCompactEvents(); }
+}
+
+bool CompactOutputStream::readEventSource(const char* payload, std::uint32_t size, EventSource& source)
+{
+  try
+  {
+    Range range(payload + sizeof(std::uint64_t), size - sizeof(std::uint64_t));
+    mserialize::deserialize(source, range);
+    if (source.argumentTags == detail::counterArgumentTags)
+    {
+      _counterSources.insert(source.id);
+    }
+    else
+    {
+      _counterSources.erase(source.id); // redefined
+    }
+    return true;
+  }
+  catch (const std::exception&) // the reader reports the invalid source
+  {
+    return false;
+  }
+}
+
+void CompactOutputStream::endEventSourceTable()
+{
+  if (_tableSources.empty()) { return; }
+
+  detail::appendEventSourceTable(_tableSources, _buffer);
+  _tableSources.clear();
+  _tableSourcesSize = 0;
+}
+
+void CompactOutputStream::endCompactEvents()
+{
+  if (_compactBegin == noPos) { return; }
+
+  const std::uint32_t size = std::uint32_t(_buffer.size() - _compactBegin - sizeof(size));
+  memcpy(_buffer.data() + _compactBegin, &size, sizeof(size));
+  _compactBegin = noPos;
+}
+
+void CompactOutputStream::endWriterPropBatch()
+{
+  if (_writerPropEnd == noPos) { return; }
+
+  const std::uint64_t batchSize = _buffer.size() - _writerPropEnd;
+  memcpy(_buffer.data() + _writerPropEnd - sizeof(batchSize), &batchSize, sizeof(batchSize));
+  _writerPropEnd = noPos;
+}
+
+} // namespace binlog
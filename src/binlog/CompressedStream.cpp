@@ -0,0 +1,418 @@
+#include <binlog/CompressedStream.hpp>
+
+#include <zlib.h>
+
+#include <algorithm> // find_if, sort
+#include <cstring> // memcpy
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility> // move
+
+namespace binlog {
+
+namespace {
+
+constexpr std::size_t frameHeaderSize = 4 * sizeof(std::uint32_t);
+
+/** Size of the DICTID field of the zlib header, present if compressed with a dictionary */
+constexpr std::size_t dictionaryIdSize = 4;
+
+/** Like compress2, but compress with a preset `dictionary` */
+int compressWithDictionary(
+  Bytef* dest, uLongf* destLen, const Bytef* source, uLong sourceLen,
+  int level, const std::string& dictionary
+)
+{
+  z_stream stream{};
+  int rc = deflateInit(&stream, level);
+  if (rc != Z_OK) { return rc; }
+
+  rc = deflateSetDictionary(&stream, reinterpret_cast<const Bytef*>(dictionary.data()), uInt(dictionary.size()));
+  if (rc == Z_OK)
+  {
+    stream.next_in = const_cast<Bytef*>(source); // NOLINT(cppcoreguidelines-pro-type-const-cast) not written by zlib
+    stream.avail_in = uInt(sourceLen);
+    stream.next_out = dest;
+    stream.avail_out = uInt(*destLen);
+    rc = deflate(&stream, Z_FINISH);
+    rc = (rc == Z_STREAM_END) ? Z_OK : (rc == Z_OK) ? Z_BUF_ERROR : rc;
+    *destLen = stream.total_out;
+  }
+
+  deflateEnd(&stream);
+  return rc;
+}
+
+/**
+ * Like uncompress, but if the source was compressed with a preset dictionary,
+ * use the one of `dictionaries` with the matching id.
+ * If there is none, returns Z_NEED_DICT, and sets `dictionaryId` to the missing id.
+ */
+int uncompressWithDictionary(
+  Bytef* dest, uLongf* destLen, const Bytef* source, uLong sourceLen,
+  const std::vector<std::string>& dictionaries, std::uint32_t& dictionaryId
+)
+{
+  z_stream stream{};
+  int rc = inflateInit(&stream);
+  if (rc != Z_OK) { return rc; }
+
+  stream.next_in = const_cast<Bytef*>(source); // NOLINT(cppcoreguidelines-pro-type-const-cast) not written by zlib
+  stream.avail_in = uInt(sourceLen);
+  stream.next_out = dest;
+  stream.avail_out = uInt(*destLen);
+  rc = inflate(&stream, Z_FINISH);
+
+  if (rc == Z_NEED_DICT)
+  {
+    dictionaryId = std::uint32_t(stream.adler);
+    const auto it = std::find_if(dictionaries.begin(), dictionaries.end(),
+      [&](const std::string& dictionary) { return compressionDictionaryId(dictionary) == dictionaryId; }
+    );
+    if (it != dictionaries.end())
+    {
+      rc = inflateSetDictionary(&stream, reinterpret_cast<const Bytef*>(it->data()), uInt(it->size()));
+      if (rc == Z_OK) { rc = inflate(&stream, Z_FINISH); }
+    }
+  }
+
+  rc = (rc == Z_STREAM_END) ? Z_OK : (rc == Z_OK) ? Z_BUF_ERROR : rc;
+  *destLen = stream.total_out;
+  inflateEnd(&stream);
+  return rc;
+}
+
+/** @returns the 8 bytes of `str` at `pos` as an integer */
+std::uint64_t dmerAt(const std::string& str, std::size_t pos)
+{
+  std::uint64_t result = 0;
+  memcpy(&result, str.data() + pos, sizeof(result));
+  return result;
+}
+
+/** A substring of a sample, selected to the dictionary */
+struct Segment
+{
+  const std::string* sample;
+  std::size_t begin;
+  std::size_t size;
+  std::uint64_t score;
+};
+
+} // namespace
+
+std::string trainCompressionDictionary(const std::vector<std::string>& samples, std::size_t maxSize)
+{
+  constexpr std::size_t d = sizeof(std::uint64_t); // length of the counted substrings (dmers)
+  constexpr std::size_t k = 64;                     // length of the segments taken
+
+  // how many times each dmer occurs in the samples
+  std::unordered_map<std::uint64_t, std::uint32_t> frequency;
+  std::size_t totalSize = 0;
+  for (const std::string& sample : samples)
+  {
+    for (std::size_t i = 0; i + d <= sample.size(); ++i) { ++frequency[dmerAt(sample, i)]; }
+    totalSize += sample.size();
+  }
+
+  // dmers occurring only once are worthless in the dictionary
+  const auto value = [&](std::uint64_t dmer) -> std::uint64_t
+  {
+    const std::uint32_t f = frequency[dmer];
+    return (f > 1) ? f : 0;
+  };
+
+  const std::size_t epochCount = (std::max)(std::size_t{1}, maxSize / k);
+  const std::size_t epochSize = (std::max)(k, totalSize / epochCount);
+
+  std::vector<Segment> segments;
+  std::unordered_map<std::uint64_t, std::uint32_t> active; // dmers of the current window, and their count
+  for (const std::string& sample : samples)
+  {
+    for (std::size_t epoch = 0; epoch + d <= sample.size(); epoch += epochSize)
+    {
+      // find the window of the epoch with the highest total value of distinct dmers
+      const std::size_t epochEnd = (std::min)(sample.size(), epoch + epochSize);
+      const std::size_t segmentSize = (std::min)(k, epochEnd - epoch);
+      const std::size_t dmerCount = segmentSize - d + 1;
+
+      active.clear();
+      std::uint64_t score = 0;
+      Segment best{&sample, epoch, segmentSize, 0};
+      for (std::size_t i = epoch; i + d <= epochEnd; ++i)
+      {
+        const std::uint64_t dmer = dmerAt(sample, i);
+        if (active[dmer]++ == 0) { score += value(dmer); }
+
+        if (i >= epoch + dmerCount)
+        {
+          const std::uint64_t old = dmerAt(sample, i - dmerCount);
+          if (--active[old] == 0)
+          {
+            score -= value(old);
+            active.erase(old);
+          }
+        }
+
+        if (i + 1 >= epoch + dmerCount && score > best.score)
+        {
+          best.begin = i + 1 - dmerCount;
+          best.score = score;
+        }
+      }
+
+      if (best.score == 0) { continue; }
+
+      // the content of the segment is covered, prefer others in the next epochs
+      for (std::size_t i = best.begin; i + d <= best.begin + best.size; ++i)
+      {
+        frequency[dmerAt(sample, i)] = 0;
+      }
+      segments.push_back(best);
+    }
+  }
+
+  // the most valuable segments last, nearest to the compressed data
+  std::sort(segments.begin(), segments.end(),
+    [](const Segment& a, const Segment& b) { return a.score > b.score; }
+  );
+  std::size_t size = 0;
+  std::size_t count = 0;
+  while (count < segments.size() && size + segments[count].size <= maxSize)
+  {
+    size += segments[count].size;
+    ++count;
+  }
+
+  std::string result;
+  result.reserve(size);
+  for (std::size_t i = count; i-- > 0;)
+  {
+    result.append(segments[i].sample->data() + segments[i].begin, segments[i].size);
+  }
+  return result;
+}
+
+std::uint32_t compressionDictionaryId(const std::string& dictionary)
+{
+  const uLong initial = adler32(0, nullptr, 0);
+  return std::uint32_t(adler32(initial, reinterpret_cast<const Bytef*>(dictionary.data()), uInt(dictionary.size())));
+}
+
+void compressFrame(const char* data, std::size_t size, std::vector<char>& frame, int level)
+{
+  const std::size_t begin = frame.size();
+  uLongf compressedSize = compressBound(uLong(size));
+  frame.resize(begin + frameHeaderSize + compressedSize);
+
+  const int rc = compress2(
+    reinterpret_cast<Bytef*>(frame.data() + begin + frameHeaderSize), &compressedSize,
+    reinterpret_cast<const Bytef*>(data), uLong(size), level
+  );
+  if (rc != Z_OK)
+  {
+    frame.resize(begin);
+    throw std::runtime_error("Failed to compress frame, zlib error: " + std::to_string(rc));
+  }
+
+  const std::uint32_t header[4] = {
+    compressedFrameMagic,
+    static_cast<std::uint32_t>(CompressionCodec::deflate),
+    std::uint32_t(compressedSize),
+    std::uint32_t(size),
+  };
+  memcpy(frame.data() + begin, header, sizeof(header));
+  frame.resize(begin + frameHeaderSize + compressedSize);
+}
+
+void decompressFrame(const char* data, std::size_t size, std::vector<char>& out)
+{
+  std::uint32_t header[4] = {};
+  if (size < sizeof(header))
+  {
+    throw std::runtime_error("Failed to decompress frame, incomplete header of " + std::to_string(size) + " bytes");
+  }
+  memcpy(header, data, sizeof(header));
+
+  if (header[0] != compressedFrameMagic)
+  {
+    throw std::runtime_error("Invalid frame, magic mismatch");
+  }
+  if (header[1] != static_cast<std::uint32_t>(CompressionCodec::deflate))
+  {
+    throw std::runtime_error("Unsupported codec in frame: " + std::to_string(header[1]));
+  }
+
+  const std::uint32_t compressedSize = header[2];
+  const std::uint32_t uncompressedSize = header[3];
+  if (size - sizeof(header) < compressedSize)
+  {
+    throw std::runtime_error("Failed to decompress frame, only got " + std::to_string(size - sizeof(header))
+      + " bytes, expected " + std::to_string(compressedSize));
+  }
+
+  const std::size_t begin = out.size();
+  out.resize(begin + uncompressedSize);
+
+  uLongf destSize = uncompressedSize;
+  const int rc = uncompress(
+    reinterpret_cast<Bytef*>(out.data() + begin), &destSize,
+    reinterpret_cast<const Bytef*>(data + sizeof(header)), uLong(compressedSize)
+  );
+  if (rc != Z_OK || destSize != uncompressedSize)
+  {
+    out.resize(begin);
+    throw std::runtime_error("Failed to decompress frame, zlib error: " + std::to_string(rc));
+  }
+}
+
+CompressedOutputStream::CompressedOutputStream(std::ostream& out, int level, std::string dictionary)
+  :_out(out),
+   _level(level),
+   _dictionary(std::move(dictionary))
+{}
+
+CompressedOutputStream::~CompressedOutputStream()
+{
+  try
+  {
+    flush();
+  }
+  catch (...) {} // NOLINT(bugprone-empty-catch) destructor must not throw
+}
+
+CompressedOutputStream& CompressedOutputStream::write(const char* data, std::streamsize size)
+{
+  _buffer.insert(_buffer.end(), data, data + size);
+  return *this;
+}
+
+void CompressedOutputStream::flush()
+{
+  if (_buffer.empty()) { return; }
+
+  const uLong sourceSize = uLong(_buffer.size());
+  uLongf compressedSize = compressBound(sourceSize) + dictionaryIdSize;
+  _frame.resize(frameHeaderSize + compressedSize);
+
+  Bytef* dest = reinterpret_cast<Bytef*>(_frame.data() + frameHeaderSize);
+  const Bytef* source = reinterpret_cast<const Bytef*>(_buffer.data());
+  const int rc = (_dictionary.empty())
+    ? compress2(dest, &compressedSize, source, sourceSize, _level)
+    : compressWithDictionary(dest, &compressedSize, source, sourceSize, _level, _dictionary);
+  if (rc != Z_OK)
+  {
+    throw std::runtime_error("Failed to compress frame, zlib error: " + std::to_string(rc));
+  }
+
+  const std::uint32_t header[4] = {
+    compressedFrameMagic,
+    static_cast<std::uint32_t>(CompressionCodec::deflate),
+    std::uint32_t(compressedSize),
+    std::uint32_t(sourceSize),
+  };
+  memcpy(_frame.data(), header, sizeof(header));
+
+  _out.write(_frame.data(), std::streamsize(frameHeaderSize + compressedSize));
+  _buffer.clear();
+}
+
+CompressedEntryStream::CompressedEntryStream(std::istream& input)
+  :_input(input)
+{}
+
+void CompressedEntryStream::addDictionary(std::string dictionary)
+{
+  _dictionaries.push_back(std::move(dictionary));
+}
+
+Range CompressedEntryStream::nextEntryPayload()
+{
+  while (true)
+  {
+    std::uint32_t size = 0;
+    const std::size_t available = _buffer.size() - _pos;
+    if (available >= sizeof(size))
+    {
+      memcpy(&size, _buffer.data() + _pos, sizeof(size));
+      if (available - sizeof(size) >= size)
+      {
+        const char* payload = _buffer.data() + _pos + sizeof(size);
+        _pos += sizeof(size) + size;
+        return Range{payload, size};
+      }
+    }
+
+    if (! readFrame())
+    {
+      if (available == 0) { return {}; }
+      _pos = _buffer.size(); // drop the incomplete entry
+      throw std::runtime_error("Compressed input ends with an incomplete entry of "
+        + std::to_string(available) + " bytes");
+    }
+  }
+}
+
+bool CompressedEntryStream::readFrame()
+{
+  std::uint32_t header[4];
+  _input.read(reinterpret_cast<char*>(header), sizeof(header));
+  if (_input.gcount() == 0) { return false; }
+  if (std::size_t(_input.gcount()) != sizeof(header))
+  {
+    throw std::runtime_error("Failed to read frame header from compressed input, only got "
+      + std::to_string(_input.gcount()) + " bytes");
+  }
+
+  if (header[0] != compressedFrameMagic)
+  {
+    throw std::runtime_error("Invalid frame in compressed input, magic mismatch");
+  }
+  if (header[1] != static_cast<std::uint32_t>(CompressionCodec::deflate))
+  {
+    throw std::runtime_error("Unsupported codec in compressed input: " + std::to_string(header[1]));
+  }
+
+  const std::uint32_t compressedSize = header[2];
+  const std::uint32_t uncompressedSize = header[3];
+
+  _frame.resize(compressedSize);
+  _input.read(_frame.data(), std::streamsize(compressedSize));
+  if (std::size_t(_input.gcount()) != compressedSize)
+  {
+    throw std::runtime_error("Failed to read frame from compressed input, only got "
+      + std::to_string(_input.gcount()) + " bytes, expected " + std::to_string(compressedSize));
+  }
+
+  // keep the incomplete entry, if any, drop the processed ones
+  _buffer.erase(_buffer.begin(), _buffer.begin() + std::ptrdiff_t(_pos));
+  _pos = 0;
+
+  const std::size_t prevSize = _buffer.size();
+  _buffer.resize(prevSize + uncompressedSize);
+
+  uLongf destSize = uncompressedSize;
+  std::uint32_t dictionaryId = 0;
+  const int rc = uncompressWithDictionary(
+    reinterpret_cast<Bytef*>(_buffer.data() + prevSize), &destSize,
+    reinterpret_cast<const Bytef*>(_frame.data()), uLong(compressedSize),
+    _dictionaries, dictionaryId
+  );
+  if (rc != Z_OK || destSize != uncompressedSize)
+  {
+    _buffer.resize(prevSize);
+    if (rc == Z_NEED_DICT)
+    {
+      throw std::runtime_error("Failed to decompress frame, compressed with an unknown dictionary, id: "
+        + std::to_string(dictionaryId));
+    }
+    throw std::runtime_error("Failed to decompress frame, zlib error: " + std::to_string(rc));
+  }
+
+  return true;
+}
+
+} // namespace binlog
@@ -0,0 +1,88 @@
+#include <binlog/Dictionary.hpp>
+
+#include <binlog/Entries.hpp>
+
+#include <mserialize/deserialize.hpp>
+
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <utility> // move
+
+namespace binlog {
+
+std::uint64_t dictionaryHash(const char* data, std::size_t size)
+{
+  std::uint64_t result = 0xcbf29ce484222325;
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    result ^= std::uint8_t(data[i]);
+    result *= 0x100000001b3;
+  }
+  return result;
+}
+
+std::string dictionaryPath(const std::string& directory, std::uint64_t hash)
+{
+  static const char digits[] = "0123456789abcdef";
+  std::string name(16, '0');
+  for (std::size_t i = 0; i < name.size(); ++i)
+  {
+    name[name.size() - 1 - i] = digits[(hash >> (4 * i)) & 0xF];
+  }
+  name += ".bdict";
+
+  if (directory.empty()) { return name; }
+  return directory + "/" + name;
+}
+
+DictionaryEntryStream::DictionaryEntryStream(EntryStream& input, std::string directory)
+  :_input(input),
+   _directory(std::move(directory)),
+   _dictionaryEntries(Range{})
+{}
+
+Range DictionaryEntryStream::nextEntryPayload()
+{
+  while (true)
+  {
+    const Range entry = _dictionaryEntries.nextEntryPayload();
+    if (! entry.empty()) { return entry; }
+
+    const Range payload = _input.nextEntryPayload();
+    Range tagRange = payload;
+    if (tagRange.size() < sizeof(std::uint64_t) || tagRange.read<std::uint64_t>() != DictionaryReference::Tag)
+    {
+      return payload;
+    }
+
+    loadDictionary(tagRange);
+  }
+}
+
+void DictionaryEntryStream::loadDictionary(Range reference)
+{
+  DictionaryReference ref;
+  mserialize::deserialize(ref, reference);
+  if (! _loadedHashes.insert(ref.hash).second) { return; } // already read
+
+  const std::string path = dictionaryPath(_directory, ref.hash);
+  std::ifstream file(path, std::ios_base::in | std::ios_base::binary);
+  if (! file)
+  {
+    _loadedHashes.erase(ref.hash);
+    throw std::runtime_error("Failed to open dictionary: " + path);
+  }
+
+  _dictionary.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  if (dictionaryHash(_dictionary.data(), _dictionary.size()) != ref.hash)
+  {
+    _loadedHashes.erase(ref.hash);
+    _dictionary.clear();
+    throw std::runtime_error("Dictionary content does not match its hash: " + path);
+  }
+
+  _dictionaryEntries = RangeEntryStream(Range{_dictionary.data(), _dictionary.size()});
+}
+
+} // namespace binlog
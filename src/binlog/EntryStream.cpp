@@ -1,8 +1,27 @@
 #include <binlog/EntryStream.hpp>
 
+#include <algorithm> // min
+#include <condition_variable>
 #include <cstdint>
+#include <cstring> // memcpy
+#include <deque>
+#include <exception>
 #include <istream>
+#include <mutex>
 #include <stdexcept>
+#include <streambuf>
+#include <utility> // swap
+
+#ifdef _WIN32
+  #define WIN32_LEAN_AND_MEAN
+  #define NOMINMAX
+  #include <windows.h> // NOLINT CreateFile, CreateFileMapping, MapViewOfFile
+#else // assume POSIX
+  #include <fcntl.h> // NOLINT open
+  #include <sys/mman.h> // NOLINT mmap
+  #include <sys/stat.h> // NOLINT fstat
+  #include <unistd.h> // NOLINT close
+#endif
 
 namespace binlog {
 
@@ -45,6 +64,195 @@ void IstreamEntryStream::rewind(std::streamsize size)
   _input.seekg(-1 * size, std::ios_base::cur);
 }
 
+struct ReadaheadEntryStream::Shared
+{
+  std::mutex mutex; // guards the members below
+  std::condition_variable cv;
+
+  std::deque<std::vector<char>> blocks; // blocks read, but not yet processed
+  std::vector<std::vector<char>> freeBlocks; // processed blocks, for reuse
+  bool eof = false;
+  bool stop = false;
+  std::exception_ptr error;
+};
+
+namespace {
+
+/**
+ * Read at most `size` bytes of `input` to `buffer`.
+ *
+ * Blocks until at least a single byte is available,
+ * then reads only the readily available bytes.
+ *
+ * @returns the number of bytes read, 0 on eof
+ */
+std::size_t readAvailable(std::streambuf& input, char* buffer, std::size_t size)
+{
+  std::size_t result = 0;
+  while (result < size)
+  {
+    const std::streamsize available = input.in_avail();
+    if (available > 0)
+    {
+      const std::streamsize count = (std::min)(available, std::streamsize(size - result));
+      result += std::size_t(input.sgetn(buffer + result, count));
+    }
+    else if (result != 0)
+    {
+      break; // do not wait for more, hand over what we have
+    }
+    else if (std::streambuf::traits_type::eq_int_type(input.sgetc(), std::streambuf::traits_type::eof()))
+    {
+      break; // no more bytes
+    }
+  }
+  return result;
+}
+} // namespace
+
+ReadaheadEntryStream::ReadaheadEntryStream(std::istream& input, std::size_t blockSize)
+  :_shared(std::make_shared<Shared>())
+{
+  _thread = std::thread([shared = _shared, &input, blockSize]()
+  {
+    readBlocks(*shared, input, blockSize);
+  });
+}
+
+ReadaheadEntryStream::~ReadaheadEntryStream()
+{
+  {
+    std::lock_guard<std::mutex> lock(_shared->mutex);
+    _shared->stop = true;
+  }
+  _shared->cv.notify_all();
+  _thread.join();
+}
+
+Range ReadaheadEntryStream::nextEntryPayload()
+{
+  // skip processed blocks
+  while (_blockPos == _block.size())
+  {
+    if (! nextBlock()) { return {}; } // eof
+  }
+
+  std::uint32_t size;
+
+  // fast path: the entry is in the current block
+  const std::size_t available = _block.size() - _blockPos;
+  if (available >= sizeof(size))
+  {
+    memcpy(&size, _block.data() + _blockPos, sizeof(size));
+    if (available - sizeof(size) >= size)
+    {
+      const char* payload = _block.data() + _blockPos + sizeof(size);
+      _blockPos += sizeof(size) + size;
+      return Range{payload, size};
+    }
+  }
+
+  // slow path: the entry spans blocks, assemble it in _entry
+  _entry.clear();
+  const auto fill = [this](std::size_t entrySize)
+  {
+    while (_entry.size() < entrySize)
+    {
+      if (_blockPos == _block.size() && ! nextBlock()) { return false; }
+
+      const std::size_t count = (std::min)(entrySize - _entry.size(), _block.size() - _blockPos);
+      _entry.insert(_entry.end(), _block.data() + _blockPos, _block.data() + _blockPos + count);
+      _blockPos += count;
+    }
+    return true;
+  };
+
+  if (! fill(sizeof(size)))
+  {
+    throw std::runtime_error("Failed to read entry size from istream, only got "
+      + std::to_string(_entry.size()) + " bytes, expected " + std::to_string(sizeof(size)));
+  }
+
+  memcpy(&size, _entry.data(), sizeof(size));
+  if (! fill(sizeof(size) + size))
+  {
+    throw std::runtime_error("Failed to read entry payload from istream, only got "
+      + std::to_string(_entry.size() - sizeof(size)) + " bytes, expected " + std::to_string(size));
+  }
+
+  return Range{_entry.data() + sizeof(size), size};
+}
+
+bool ReadaheadEntryStream::nextBlock()
+{
+  std::unique_lock<std::mutex> lock(_shared->mutex);
+  _shared->cv.wait(lock, [this]() { return ! _shared->blocks.empty() || _shared->eof; });
+
+  if (_shared->blocks.empty())
+  {
+    if (_shared->error) { std::rethrow_exception(_shared->error); }
+    return false;
+  }
+
+  _shared->freeBlocks.push_back(std::move(_block));
+  _block = std::move(_shared->blocks.front());
+  _shared->blocks.pop_front();
+  _blockPos = 0;
+
+  lock.unlock();
+  _shared->cv.notify_all();
+  return true;
+}
+
+void ReadaheadEntryStream::readBlocks(Shared& shared, std::istream& input, std::size_t blockSize)
+{
+  // at most this many blocks are read ahead
+  constexpr std::size_t maxPendingBlocks = 2;
+
+  try
+  {
+    std::streambuf* streambuf = input.rdbuf();
+
+    while (streambuf != nullptr)
+    {
+      std::vector<char> block;
+      {
+        std::unique_lock<std::mutex> lock(shared.mutex);
+        shared.cv.wait(lock, [&shared]() { return shared.blocks.size() < maxPendingBlocks || shared.stop; });
+        if (shared.stop) { break; }
+
+        if (! shared.freeBlocks.empty())
+        {
+          std::swap(block, shared.freeBlocks.back());
+          shared.freeBlocks.pop_back();
+        }
+      }
+
+      block.resize(blockSize);
+      const std::size_t size = readAvailable(*streambuf, block.data(), block.size());
+      if (size == 0) { break; } // eof
+      block.resize(size);
+
+      {
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        shared.blocks.push_back(std::move(block));
+      }
+      shared.cv.notify_all();
+    }
+  }
+  catch (...)
+  {
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    shared.error = std::current_exception();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    shared.eof = true;
+  }
+  shared.cv.notify_all();
+}
+
 RangeEntryStream::RangeEntryStream(Range input)
   :_input(input)
 {}
@@ -56,4 +264,125 @@ Range RangeEntryStream::nextEntryPayload()
   return Range{_input.view(size), size};
 }
 
+namespace {
+
+#ifdef _WIN32
+
+/** Close `handle` on scope exit */
+struct HandleGuard
+{
+  HANDLE handle;
+  ~HandleGuard() { if (handle != nullptr && handle != INVALID_HANDLE_VALUE) { CloseHandle(handle); } }
+};
+
+#else
+
+/** Close `fd` on scope exit */
+struct FdGuard
+{
+  int fd;
+  ~FdGuard() { if (fd >= 0) { close(fd); } }
+};
+
+#endif
+
+} // namespace
+
+MmapEntryStream::MmapEntryStream(const std::string& path)
+{
+  #ifdef _WIN32
+    HandleGuard file{CreateFileA(
+      path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+      OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr
+    )};
+    if (file.handle == INVALID_HANDLE_VALUE)
+    {
+      throw std::runtime_error("Failed to open file for mapping: " + path);
+    }
+
+    LARGE_INTEGER fileSize;
+    if (GetFileType(file.handle) != FILE_TYPE_DISK || ! GetFileSizeEx(file.handle, &fileSize))
+    {
+      throw std::runtime_error("Not a regular file, can not be mapped: " + path);
+    }
+
+    _size = std::size_t(fileSize.QuadPart);
+    if (_size == 0) { return; } // empty files can not be mapped
+
+    HandleGuard mapping{CreateFileMappingA(file.handle, nullptr, PAGE_READONLY, 0, 0, nullptr)};
+    if (mapping.handle == nullptr)
+    {
+      throw std::runtime_error("Failed to create file mapping: " + path);
+    }
+
+    _data = static_cast<const char*>(MapViewOfFile(mapping.handle, FILE_MAP_READ, 0, 0, 0));
+    if (_data == nullptr)
+    {
+      throw std::runtime_error("Failed to map view of file: " + path);
+    }
+  #else
+    FdGuard file{open(path.c_str(), O_RDONLY)}; // NOLINT(cppcoreguidelines-pro-type-vararg)
+    if (file.fd < 0)
+    {
+      throw std::runtime_error("Failed to open file for mapping: " + path);
+    }
+
+    struct stat st{};
+    if (fstat(file.fd, &st) != 0 || ! S_ISREG(st.st_mode))
+    {
+      throw std::runtime_error("Not a regular file, can not be mapped: " + path);
+    }
+
+    _size = std::size_t(st.st_size);
+    if (_size == 0) { return; } // empty files can not be mapped
+
+    void* data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, file.fd, 0);
+    if (data == MAP_FAILED)
+    {
+      throw std::runtime_error("Failed to map file: " + path);
+    }
+
+    #ifdef MADV_SEQUENTIAL
+      madvise(data, _size, MADV_SEQUENTIAL);
+    #endif
+
+    _data = static_cast<const char*>(data);
+  #endif
+}
+
+MmapEntryStream::~MmapEntryStream()
+{
+  if (_data == nullptr) { return; }
+
+  #ifdef _WIN32
+    UnmapViewOfFile(_data);
+  #else
+    munmap(const_cast<char*>(_data), _size);
+  #endif
+}
+
+Range MmapEntryStream::nextEntryPayload()
+{
+  const std::size_t remaining = _size - _pos;
+  if (remaining == 0) { return {}; } // eof
+
+  std::uint32_t size;
+  if (remaining < sizeof(size))
+  {
+    throw std::runtime_error("Failed to read entry size from file, only got "
+      + std::to_string(remaining) + " bytes, expected " + std::to_string(sizeof(size)));
+  }
+  memcpy(&size, _data + _pos, sizeof(size));
+
+  if (remaining - sizeof(size) < size)
+  {
+    throw std::runtime_error("Failed to read entry payload from file, only got "
+      + std::to_string(remaining - sizeof(size)) + " bytes, expected " + std::to_string(size));
+  }
+
+  const char* payload = _data + _pos + sizeof(size);
+  _pos += sizeof(size) + size;
+  return Range{payload, size};
+}
+
 } // namespace binlog
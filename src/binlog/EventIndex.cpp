@@ -0,0 +1,186 @@
+#include <binlog/EventIndex.hpp>
+
+#include <mserialize/deserialize.hpp>
+
+#include <algorithm> // lower_bound, max, upper_bound
+#include <cstring> // memcpy
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace binlog {
+
+constexpr std::size_t EventIndex::clockBlockSize;
+
+EventIndex::EventIndex(Range input)
+  :_data(input.view(0))
+{
+  const char* const begin = _data;
+
+  std::map<std::pair<std::uint64_t, std::string>, std::uint32_t> writerPropIndex;
+  std::uint32_t writerProp = 0;
+  std::uint32_t clockSync = 0;
+  _writerProps.emplace_back();
+  _clockSyncs.emplace_back();
+  writerPropIndex.emplace(std::make_pair(std::uint64_t(0), std::string()), 0);
+  _contexts.push_back(Context{0, 0, 0});
+
+  std::uint64_t maxClock = 0;
+
+  while (! input.empty())
+  {
+    const char* entry = input.view(0);
+    const std::uint32_t size = input.read<std::uint32_t>();
+    Range payload(input.view(size), size);
+    const std::uint64_t tag = payload.read<std::uint64_t>();
+
+    if ((tag & (std::uint64_t(1) << 63)) == 0)
+    {
+      const std::uint64_t clock = payload.read<std::uint64_t>();
+      maxClock = (std::max)(maxClock, clock);
+
+      _offsets.push_back(std::uint64_t(entry - begin));
+      if (_offsets.size() % clockBlockSize == 0) { _maxClocks.push_back(maxClock); }
+      continue;
+    }
+
+    switch (tag)
+    {
+    case WriterProp::Tag:
+    {
+      WriterProp wp;
+      mserialize::deserialize(wp, payload);
+      wp.batchSize = 0;
+      const auto it = writerPropIndex.emplace(
+        std::make_pair(wp.id, wp.name), std::uint32_t(_writerProps.size())
+      ).first;
+      if (it->second == _writerProps.size()) { _writerProps.push_back(std::move(wp)); }
+      writerProp = it->second;
+      setContext(writerProp, clockSync);
+      break;
+    }
+    case ClockSync::Tag:
+    {
+      ClockSync cs;
+      mserialize::deserialize(cs, payload);
+      clockSync = std::uint32_t(_clockSyncs.size());
+      _clockSyncs.push_back(std::move(cs));
+      setContext(writerProp, clockSync);
+      break;
+    }
+    case CompactEvents::Tag:
+      throw std::runtime_error("EventIndex does not support compact events, offset: " + std::to_string(entry - begin));
+    case DictionaryReference::Tag:
+      throw std::runtime_error("EventIndex does not support dictionary references, offset: " + std::to_string(entry - begin));
+    default:
+      // event sources, interned strings, etc.
+      _eventStream.forEachEvent(Range(entry, sizeof(size) + size), [](const Event&) {});
+      break;
+    }
+  }
+
+  if (_offsets.size() % clockBlockSize != 0) { _maxClocks.push_back(maxClock); }
+}
+
+void EventIndex::setContext(std::uint32_t writerProp, std::uint32_t clockSync)
+{
+  Context& last = _contexts.back();
+  if (last.writerProp == writerProp && last.clockSync == clockSync) { return; }
+
+  if (last.firstEvent == _offsets.size())
+  {
+    // no event since the last change
+    last.writerProp = writerProp;
+    last.clockSync = clockSync;
+  }
+  else
+  {
+    _contexts.push_back(Context{_offsets.size(), writerProp, clockSync});
+  }
+}
+
+const EventIndex::Context& EventIndex::contextAt(std::size_t i) const
+{
+  // the last context starting at or before i
+  const auto it = std::upper_bound(_contexts.begin(), _contexts.end(), std::uint64_t(i),
+    [](std::uint64_t event, const Context& context) { return event < context.firstEvent; }
+  );
+  return *(it - 1);
+}
+
+const Event& EventIndex::eventAt(std::size_t i)
+{
+  const char* entry = _data + _offsets[i];
+  std::uint32_t size = 0;
+  memcpy(&size, entry, sizeof(size));
+
+  _eventStream.forEachEvent(Range(entry, sizeof(size) + size), [this](const Event& event) { _event = event; });
+  return _event;
+}
+
+const WriterProp& EventIndex::writerPropAt(std::size_t i) const
+{
+  return _writerProps[contextAt(i).writerProp];
+}
+
+const ClockSync& EventIndex::clockSyncAt(std::size_t i) const
+{
+  return _clockSyncs[contextAt(i).clockSync];
+}
+
+std::uint64_t EventIndex::clockAt(std::size_t i) const
+{
+  // [size][tag][clock]
+  std::uint64_t clock = 0;
+  memcpy(&clock, _data + _offsets[i] + sizeof(std::uint32_t) + sizeof(std::uint64_t), sizeof(clock));
+  return clock;
+}
+
+std::size_t EventIndex::findClock(std::uint64_t clockValue) const
+{
+  // the first block, where the largest clock so far reaches clockValue
+  const auto block = std::lower_bound(_maxClocks.begin(), _maxClocks.end(), clockValue);
+  if (block == _maxClocks.end()) { return size(); }
+
+  const std::size_t end = (std::min)(size(), std::size_t(block - _maxClocks.begin() + 1) * clockBlockSize);
+  for (std::size_t i = std::size_t(block - _maxClocks.begin()) * clockBlockSize; i < end; ++i)
+  {
+    if (clockAt(i) >= clockValue) { return i; }
+  }
+  return size(); // unreachable, the block has an event of at least clockValue
+}
+
+EventLineCache::EventLineCache(EventIndex& index, PrettyPrinter& printer, std::size_t capacity)
+  :_index(index),
+   _printer(printer),
+   _capacity((std::max)(capacity, std::size_t(1)))
+{}
+
+const std::string& EventLineCache::line(std::size_t i)
+{
+  const auto it = _positions.find(i);
+  if (it != _positions.end())
+  {
+    _lines.splice(_lines.begin(), _lines, it->second);
+    return it->second->second;
+  }
+
+  std::ostringstream str;
+  _printer.printEvent(str, _index.eventAt(i), _index.writerPropAt(i), _index.clockSyncAt(i));
+  std::string text = str.str();
+  if (! text.empty() && text.back() == '\n') { text.pop_back(); }
+
+  if (_lines.size() >= _capacity)
+  {
+    _positions.erase(_lines.back().first);
+    _lines.pop_back();
+  }
+
+  _lines.emplace_front(i, std::move(text));
+  _positions[i] = _lines.begin();
+  return _lines.front().second;
+}
+
+} // namespace binlog
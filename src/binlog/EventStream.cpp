@@ -1,13 +1,28 @@
 #include <binlog/EventStream.hpp>
 
+#include <binlog/detail/CompactEvents.hpp>
+#include <binlog/detail/EventSourceTable.hpp>
+
 #include <mserialize/deserialize.hpp>
 
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
 namespace binlog {
 
 const Event* EventStream::nextEvent(EntryStream& input)
 {
   while (true)
   {
+    if (! _compactEvents.empty())
+    {
+      readCompactEvent();
+      return &_event;
+    }
+
     Range range = input.nextEntryPayload();
     if (range.empty()) { return nullptr; }
 
@@ -16,20 +31,7 @@ const Event* EventStream::nextEvent(EntryStream& input)
 
     if (special)
     {
-      switch (tag)
-      {
-        case EventSource::Tag:
-          readEventSource(range);
-          break;
-        case WriterProp::Tag:
-          readWriterProp(range);
-          break;
-        case ClockSync::Tag:
-          readClockSync(range);
-          break;
-        // default: ignore unkown special entries
-        // to be forward compatible.
-      }
+      readSpecialEntry(tag, range);
     }
     else
     {
@@ -39,19 +41,222 @@ const Event* EventStream::nextEvent(EntryStream& input)
   }
 }
 
+void EventStream::loadMetadata(EntryStream& input)
+{
+  if (nextEvent(input) != nullptr)
+  {
+    throw std::runtime_error("Metadata stream contains an event of source: " + std::to_string(_event.source->id));
+  }
+}
+
+void EventStream::writeCheckpoint(std::ostream& out, std::uint64_t offset) const
+{
+  if (! _compactEvents.empty())
+  {
+    throw std::runtime_error("Cannot write checkpoint in the middle of a CompactEvents entry");
+  }
+
+  for (const EventSource& eventSource : _denseEventSources)
+  {
+    if (eventSource.id == 0)
+    {
+      // pending: write the serialized source as it is
+      const std::string& serialized = eventSource.category;
+      const std::uint32_t size = std::uint32_t(sizeof(EventSource::Tag) + serialized.size());
+      const std::uint64_t tag = EventSource::Tag;
+      out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+      out.write(reinterpret_cast<const char*>(&tag), sizeof(tag));
+      out.write(serialized.data(), std::streamsize(serialized.size()));
+    }
+    else
+    {
+      serializeSizePrefixedTagged(eventSource, out);
+    }
+  }
+  _eventSources.forEach([&out](std::uint64_t, const EventSource& eventSource)
+  {
+    serializeSizePrefixedTagged(eventSource, out);
+  });
+  _internedStrings.forEach([&out](std::uint64_t id, const std::string& value)
+  {
+    serializeSizePrefixedTagged(InternedString{id, value}, out);
+  });
+
+  serializeSizePrefixedTagged(_clockCorrection, out);
+  serializeSizePrefixedTagged(_clockSync, out);
+  serializeSizePrefixedTagged(_writerProp, out);
+  if (! _writerProp.context.empty()) { serializeSizePrefixedTagged(WriterContext{_writerProp.context}, out); }
+  if (_droppedEventCount != 0) { serializeSizePrefixedTagged(DroppedEvents{_droppedEventCount}, out); }
+  if (_repeatedEventCount != 0) { serializeSizePrefixedTagged(RepeatedEvents{_repeatedEventCount, 0}, out); }
+
+  serializeSizePrefixedTagged(Checkpoint{offset}, out);
+}
+
+std::uint64_t EventStream::readCheckpoint(EntryStream& input)
+{
+  // read into a new state, to leave *this unchanged on error
+  EventStream state;
+
+  while (true)
+  {
+    Range range = input.nextEntryPayload();
+    if (range.empty()) { throw std::runtime_error("Checkpoint entry not found"); }
+
+    const std::uint64_t tag = range.read<std::uint64_t>();
+    if (tag == Checkpoint::Tag)
+    {
+      Checkpoint checkpoint;
+      mserialize::deserialize(checkpoint, range);
+      *this = std::move(state);
+      return checkpoint.offset;
+    }
+
+    if ((tag & (std::uint64_t(1) << 63)) == 0 || tag == CompactEvents::Tag)
+    {
+      throw std::runtime_error("Checkpoint contains an event, tag: " + std::to_string(tag));
+    }
+
+    state.readSpecialEntry(tag, range);
+  }
+}
+
+void EventStream::readSpecialEntry(std::uint64_t tag, Range range)
+{
+  switch (tag)
+  {
+    case EventSource::Tag:
+      readEventSource(range);
+      break;
+    case EventSourceTable::Tag:
+      readEventSourceTable(range);
+      break;
+    case WriterProp::Tag:
+      readWriterProp(range);
+      break;
+    case WriterContext::Tag:
+      readWriterContext(range);
+      break;
+    case ClockSync::Tag:
+      readClockSync(range);
+      break;
+    case ClockCorrection::Tag:
+      readClockCorrection(range);
+      break;
+    case DroppedEvents::Tag:
+      readDroppedEvents(range);
+      break;
+    case CompactEvents::Tag:
+      readCompactEvents(range);
+      break;
+    case RepeatedEvents::Tag:
+      readRepeatedEvents(range);
+      break;
+    case InternedString::Tag:
+      readInternedString(range);
+      break;
+    // default: ignore unkown special entries
+    // to be forward compatible.
+  }
+}
+
 void EventStream::readEventSource(Range range)
 {
+  // Validate the entry without allocating: read the fixed size fields, skip the strings.
+  // Sources of the next dense id (or a redefined one) are kept serialized,
+  // as most sources of large logfiles are never needed by a filtered reader.
+  Range serialized = range;
+  const std::uint64_t id = range.read<std::uint64_t>();
+  range.read<std::uint16_t>(); // severity
+  for (int i = 0; i < 3; ++i) { range.view(range.read<std::uint32_t>()); } // category, function, file
+  range.read<std::uint64_t>(); // line
+  for (int i = 0; i < 2; ++i) { range.view(range.read<std::uint32_t>()); } // formatString, argumentTags
+
+  const bool dense = id - 1 < _denseEventSources.size()
+    || (id == _denseEventSources.size() + 1 && _eventSources.find(id) == _eventSources.end());
+  if (! dense)
+  {
+    EventSource eventSource;
+    mserialize::deserialize(eventSource, serialized);
+    addEventSource(std::move(eventSource));
+    return;
+  }
+
+  EventSource pending;
+  const std::size_t size = serialized.size() - range.size();
+  pending.category.assign(serialized.view(size), size);
+  if (id - 1 < _denseEventSources.size())
+  {
+    _denseEventSources[std::size_t(id - 1)] = std::move(pending);
+  }
+  else
+  {
+    _denseEventSources.push_back(std::move(pending));
+  }
+}
+
+void EventStream::readPendingEventSource(std::size_t index)
+{
+  EventSource& pending = _denseEventSources[index];
+  Range serialized(pending.category.data(), pending.category.size());
   EventSource eventSource;
-  mserialize::deserialize(eventSource, range);
-  _eventSources.emplace(eventSource.id, std::move(eventSource));
+  mserialize::deserialize(eventSource, serialized); // validated by readEventSource
+  pending = std::move(eventSource);
+}
+
+void EventStream::readEventSourceTable(Range range)
+{
+  detail::readEventSourceTable(range, [this](EventSource&& eventSource)
+  {
+    addEventSource(std::move(eventSource));
+  });
+}
+
+void EventStream::addEventSource(EventSource&& eventSource)
+{
+  // Session assigns ids densely from 1: keep those in a vector,
+  // indexed by id - 1, to make the lookup of each event cheap.
+  // Every other id (e.g: of merged or sparse streams) goes to _eventSources,
+  // each id is kept at one place only.
+  const std::uint64_t id = eventSource.id;
+  if (id - 1 < _denseEventSources.size())
+  {
+    _denseEventSources[id - 1] = std::move(eventSource);
+  }
+  else if (id == _denseEventSources.size() + 1 && _eventSources.find(id) == _eventSources.end())
+  {
+    _denseEventSources.push_back(std::move(eventSource));
+  }
+  else
+  {
+    _eventSources.emplace(id, std::move(eventSource));
+  }
 }
 
 void EventStream::readWriterProp(Range range)
 {
-  // Make sure _writerProp is updated only if deserialize does not throw
-  WriterProp wp;
-  mserialize::deserialize(wp, range);
-  _writerProp = std::move(wp);
+  // Read in place, without allocating: every batch of every channel has one,
+  // usually with the same name as one of the recent batches.
+  // Make sure _writerProp is updated only if the entry is valid.
+  const std::uint64_t id = range.read<std::uint64_t>();
+  const std::uint32_t nameSize = range.read<std::uint32_t>();
+  const char* name = range.view(nameSize);
+  const std::uint64_t batchSize = range.read<std::uint64_t>();
+
+  _writerProp.id = id;
+  if (_writerProp.name.size() != nameSize || _writerProp.name.compare(0, nameSize, name, nameSize) != 0)
+  {
+    _writerProp.name.assign(name, nameSize); // reuses the capacity of the previous name
+  }
+  _writerProp.batchSize = batchSize;
+  _writerProp.context.clear(); // until the next WriterContext entry
+}
+
+void EventStream::readWriterContext(Range range)
+{
+  // Read in place: the consumer repeats the context of the writer in every batch
+  const std::uint32_t contextSize = range.read<std::uint32_t>();
+  const char* context = range.view(contextSize);
+  _writerProp.context.assign(context, contextSize); // reuses the capacity of the previous context
 }
 
 void EventStream::readClockSync(Range range)
@@ -60,19 +265,57 @@ void EventStream::readClockSync(Range range)
   ClockSync clockSync;
   mserialize::deserialize(clockSync, range);
   _clockSync = std::move(clockSync);
+  _clockConverter = ClockConverter(_clockSync);
+}
+
+void EventStream::readClockCorrection(Range range)
+{
+  ClockCorrection clockCorrection;
+  mserialize::deserialize(clockCorrection, range);
+  _clockCorrection = clockCorrection;
 }
 
-void EventStream::readEvent(std::uint64_t eventSourceId, Range range)
+void EventStream::readDroppedEvents(Range range)
 {
-  auto&& it = _eventSources.find(eventSourceId);
-  if (it == _eventSources.end())
+  DroppedEvents droppedEvents;
+  mserialize::deserialize(droppedEvents, range);
+  _droppedEventCount += droppedEvents.count;
+}
+
+void EventStream::readRepeatedEvents(Range range)
+{
+  RepeatedEvents repeatedEvents;
+  mserialize::deserialize(repeatedEvents, range);
+  _repeatedEventCount += repeatedEvents.count;
+}
+
+void EventStream::readInternedString(Range range)
+{
+  InternedString internedString;
+  mserialize::deserialize(internedString, range);
+  _internedStrings.emplace(internedString.id, std::move(internedString.value));
+}
+
+void EventStream::readCompactEvents(Range range)
+{
+  const std::uint8_t version = range.read<std::uint8_t>();
+  if (! detail::isSupportedCompactVersion(version))
   {
-    throw std::runtime_error("Event has invalid source id: " + std::to_string(eventSourceId));
+    throw std::runtime_error("Unsupported CompactEvents version: " + std::to_string(version));
   }
 
-  _event.source = it;
-  _event.clockValue = range.read<std::uint64_t>();
-  _event.arguments = range;
+  _compactEvents = range;
+  _compactDecoder = detail::CompactDecoder(version);
+}
+
+void EventStream::readCompactEvent()
+{
+  const detail::CompactEvent ce = detail::nextCompactEvent(_compactEvents, _compactDecoder);
+
+  _event.source = &findEventSource(ce.sourceId);
+  _event.clockValue = ce.clockValue;
+  _event.arguments = ce.arguments;
+  _event.internedStrings = &_internedStrings;
 }
 
 } // namespace binlog
@@ -0,0 +1,168 @@
+#include <binlog/FileOutputStream.hpp>
+
+#include <algorithm> // min
+#include <cerrno>
+#include <cstring> // strerror
+#include <stdexcept>
+
+#ifdef _WIN32
+  #define WIN32_LEAN_AND_MEAN
+  #define NOMINMAX
+  #include <windows.h> // NOLINT CreateFile, WriteFile, ReOpenFile
+#else // assume POSIX
+  #include <fcntl.h> // NOLINT open
+  #include <limits.h> // NOLINT IOV_MAX
+  #include <sys/uio.h> // NOLINT writev
+  #include <unistd.h> // NOLINT write, close
+#endif
+
+namespace binlog {
+
+namespace {
+
+#ifndef _WIN32
+
+#ifdef IOV_MAX
+constexpr std::size_t maxIovecCount = IOV_MAX;
+#else
+constexpr std::size_t maxIovecCount = 1024;
+#endif
+
+[[noreturn]] void throwWriteError()
+{
+  throw std::runtime_error(std::string("Failed to write file: ") + std::strerror(errno));
+}
+
+#endif
+
+} // namespace
+
+FileOutputStream::FileOutputStream(const std::string& path, bool append)
+{
+  #ifdef _WIN32
+    _access = append ? FILE_APPEND_DATA : GENERIC_WRITE;
+    // FILE_SHARE_WRITE: setDirectIo reopens the file for writing, while _handle is open
+    _handle = CreateFileA(
+      path.c_str(), _access, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+      append ? OPEN_ALWAYS : CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr
+    );
+    if (_handle == INVALID_HANDLE_VALUE)
+    {
+      throw std::runtime_error("Failed to open file for writing: " + path);
+    }
+  #else
+    const int flags = O_WRONLY | O_CREAT | O_CLOEXEC | (append ? O_APPEND : O_TRUNC);
+    _fd = open(path.c_str(), flags, 0644); // NOLINT(cppcoreguidelines-pro-type-vararg)
+    if (_fd < 0)
+    {
+      throw std::runtime_error("Failed to open file for writing: " + path + ": " + std::strerror(errno));
+    }
+  #endif
+}
+
+FileOutputStream::~FileOutputStream()
+{
+  #ifdef _WIN32
+    CloseHandle(_handle);
+  #else
+    close(_fd);
+  #endif
+}
+
+FileOutputStream& FileOutputStream::write(const char* data, std::streamsize size)
+{
+  const ConstBuffer buffer{data, std::size_t(size)};
+  writev(&buffer, 1);
+  return *this;
+}
+
+void FileOutputStream::writev(const ConstBuffer* buffers, std::size_t count)
+{
+  #ifdef _WIN32
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      const char* data = buffers[i].data;
+      std::size_t size = buffers[i].size;
+      while (size != 0)
+      {
+        DWORD written = 0;
+        const DWORD chunk = DWORD((std::min)(size, std::size_t(1) << 30));
+        if (! WriteFile(_handle, data, chunk, &written, nullptr))
+        {
+          throw std::runtime_error("Failed to write file");
+        }
+        data += written;
+        size -= written;
+      }
+    }
+  #else
+    iovec iov[256];
+    constexpr std::size_t batchSize = (std::min)(sizeof(iov) / sizeof(iov[0]), maxIovecCount);
+
+    std::size_t offset = 0; // already written bytes of buffers[0]
+    while (count != 0)
+    {
+      const std::size_t n = (std::min)(count, batchSize);
+      for (std::size_t i = 0; i < n; ++i)
+      {
+        const std::size_t skip = (i == 0) ? offset : 0;
+        iov[i].iov_base = const_cast<char*>(buffers[i].data) + skip; // NOLINT(cppcoreguidelines-pro-type-const-cast)
+        iov[i].iov_len = buffers[i].size - skip;
+      }
+
+      const ssize_t result = ::writev(_fd, iov, int(n));
+      if (result < 0)
+      {
+        if (errno == EINTR) { continue; }
+        throwWriteError();
+      }
+
+      // skip the written buffers, remember the offset in the first not completely written one
+      std::size_t written = std::size_t(result);
+      while (count != 0 && written >= buffers[0].size - offset)
+      {
+        written -= buffers[0].size - offset;
+        offset = 0;
+        ++buffers;
+        --count;
+      }
+      offset += written;
+    }
+  #endif
+}
+
+bool FileOutputStream::setDirectIo(bool enable)
+{
+  #if defined(_WIN32)
+    if (enable == _directIo) { return true; }
+
+    // the flag can not be changed on an open handle: reopen the file,
+    // and move the file pointer of the new handle to the current position
+    LARGE_INTEGER position{};
+    if (! SetFilePointerEx(_handle, LARGE_INTEGER{}, &position, FILE_CURRENT)) { return false; }
+
+    const DWORD flags = enable ? FILE_FLAG_NO_BUFFERING : 0;
+    // FILE_SHARE_WRITE: _handle is still open for writing, and shares write access
+    HANDLE handle = ReOpenFile(_handle, _access, FILE_SHARE_READ | FILE_SHARE_WRITE, flags);
+    if (handle == INVALID_HANDLE_VALUE) { return false; }
+    if (! SetFilePointerEx(handle, position, nullptr, FILE_BEGIN))
+    {
+      CloseHandle(handle);
+      return false;
+    }
+
+    CloseHandle(_handle);
+    _handle = handle;
+    _directIo = enable;
+    return true;
+  #elif ! defined(O_DIRECT)
+    return ! enable;
+  #else
+    const int flags = fcntl(_fd, F_GETFL); // NOLINT(cppcoreguidelines-pro-type-vararg)
+    if (flags < 0) { return false; }
+    const int newFlags = enable ? (flags | O_DIRECT) : (flags & ~O_DIRECT);
+    return newFlags == flags || fcntl(_fd, F_SETFL, newFlags) == 0; // NOLINT(cppcoreguidelines-pro-type-vararg)
+  #endif
+}
+
+} // namespace binlog
@@ -0,0 +1,224 @@
+#include <binlog/FileSink.hpp>
+
+#include <algorithm> // max, min
+#include <cstdint>
+#include <cstdio> // rename
+#include <cstring> // memcpy
+#include <stdexcept>
+#include <utility> // move
+
+namespace binlog {
+
+constexpr std::size_t FileSink::alignment;
+
+FileSink::FileSink(const std::string& path, Options options)
+  :_options(options)
+{
+  _options.bufferSize = (std::max)(
+    (_options.bufferSize + alignment - 1) / alignment * alignment,
+    alignment
+  );
+
+  _options.bufferCount = (std::max)(_options.bufferCount, std::size_t{2});
+  for (std::size_t i = 0; i < _options.bufferCount; ++i)
+  {
+    _storage.emplace_back(new char[_options.bufferSize + alignment]);
+    const std::uintptr_t address = reinterpret_cast<std::uintptr_t>(_storage.back().get());
+    const std::uintptr_t padding = (alignment - address % alignment) % alignment;
+    _freeBuffers.push_back(_storage.back().get() + padding);
+  }
+
+  _current = _freeBuffers.back();
+  _freeBuffers.pop_back();
+
+  openFile(path);
+
+  _thread = std::thread([this]() { run(); });
+}
+
+FileSink::FileSink(const std::string& path)
+  :FileSink(path, Options{})
+{}
+
+FileSink::~FileSink()
+{
+  try
+  {
+    close();
+  }
+  catch (...) {} // NOLINT(bugprone-empty-catch) destructor must not throw
+}
+
+FileSink& FileSink::write(const char* data, std::streamsize ssize)
+{
+  std::size_t size = std::size_t(ssize);
+  while (size != 0)
+  {
+    const std::size_t n = (std::min)(size, _options.bufferSize - _size);
+    memcpy(_current + _size, data, n);
+    _size += n;
+    data += n;
+    size -= n;
+
+    if (_size == _options.bufferSize)
+    {
+      handOver(_size, false, {}, {});
+    }
+  }
+
+  return *this;
+}
+
+void FileSink::flush()
+{
+  // in direct I/O mode, only whole blocks can be written to the open file
+  const std::size_t size = _options.directIo ? _size / alignment * alignment : _size;
+  if (size != 0)
+  {
+    handOver(size, false, {}, {});
+  }
+  waitIdle();
+}
+
+void FileSink::rotate(const std::string& path, const std::string& renameClosedTo)
+{
+  handOver(_size, true, renameClosedTo, path);
+}
+
+void FileSink::close()
+{
+  if (! _thread.joinable()) { return; }
+
+  // the I/O thread finishes the jobs before stopping
+  std::exception_ptr error;
+  try
+  {
+    handOver(_size, true, {}, {});
+  }
+  catch (...)
+  {
+    error = std::current_exception();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stop = true;
+  }
+  _cv.notify_all();
+  _thread.join();
+
+  if (error) { std::rethrow_exception(error); }
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  throwIfFailed();
+}
+
+void FileSink::handOver(std::size_t size, bool closeFile, std::string renamePath, std::string nextPath)
+{
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _cv.wait(lock, [this]() { return ! _freeBuffers.empty() || _error; });
+    throwIfFailed();
+
+    char* next = _freeBuffers.back();
+    _freeBuffers.pop_back();
+
+    // the I/O thread reads only the first `size` bytes of _current, copy the rest
+    const std::size_t rest = _size - size;
+    memcpy(next, _current + size, rest);
+
+    _jobs.push_back(Job{_current, size, closeFile, std::move(renamePath), std::move(nextPath)});
+    _current = next;
+    _size = rest;
+  }
+  _cv.notify_all();
+}
+
+void FileSink::waitIdle()
+{
+  std::unique_lock<std::mutex> lock(_mutex);
+  _cv.wait(lock, [this]() { return (_jobs.empty() && ! _busy) || _error; });
+  throwIfFailed();
+}
+
+void FileSink::throwIfFailed()
+{
+  // the error is sticky: the state of the file is unknown after a failed write
+  if (_error) { std::rethrow_exception(_error); }
+}
+
+void FileSink::run()
+{
+  while (true)
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _cv.wait(lock, [this]() { return ! _jobs.empty() || _stop; });
+    if (_jobs.empty()) { break; } // stop
+
+    const Job job = std::move(_jobs.front());
+    _jobs.pop_front();
+    const bool failed = bool(_error);
+    _busy = true;
+    lock.unlock();
+
+    std::exception_ptr error;
+    if (! failed)
+    {
+      try
+      {
+        runJob(job);
+      }
+      catch (...)
+      {
+        error = std::current_exception();
+      }
+    }
+
+    lock.lock();
+    if (error) { _error = error; }
+    _freeBuffers.push_back(job.data);
+    _busy = false;
+    lock.unlock();
+    _cv.notify_all();
+  }
+}
+
+void FileSink::runJob(const Job& job)
+{
+  if (job.size != 0)
+  {
+    if (! _file) { throw std::runtime_error("FileSink has no open file"); }
+
+    const std::size_t aligned = job.size / alignment * alignment;
+    if (_directIo && aligned != job.size)
+    {
+      // the last incomplete block of the file, write it bypassing direct I/O
+      _file->write(job.data, std::streamsize(aligned));
+      _directIo = ! _file->setDirectIo(false);
+      _file->write(job.data + aligned, std::streamsize(job.size - aligned));
+    }
+    else
+    {
+      _file->write(job.data, std::streamsize(job.size));
+    }
+  }
+
+  if (job.closeFile)
+  {
+    _file.reset();
+    if (! job.renamePath.empty() && std::rename(_path.c_str(), job.renamePath.c_str()) != 0)
+    {
+      throw std::runtime_error("Failed to rename " + _path + " to " + job.renamePath);
+    }
+    if (! job.nextPath.empty()) { openFile(job.nextPath); }
+  }
+}
+
+void FileSink::openFile(const std::string& path)
+{
+  _file.reset(new FileOutputStream(path));
+  _path = path;
+  _directIo = _options.directIo && _file->setDirectIo(true);
+}
+
+} // namespace binlog
@@ -0,0 +1,185 @@
+#include <binlog/FollowEntryStream.hpp>
+
+#ifndef _WIN32 // assume POSIX
+
+#include <algorithm> // min
+#include <cerrno>
+#include <cstdint>
+#include <cstring> // memcpy, strerror
+#include <stdexcept>
+#include <thread>
+#include <utility> // move
+
+#include <fcntl.h> // NOLINT open
+#include <sys/stat.h> // NOLINT fstat, stat
+#include <unistd.h> // NOLINT read, close, lseek
+
+#ifdef __linux__
+  #include <poll.h> // NOLINT poll
+  #include <sys/inotify.h> // NOLINT inotify_init1
+#endif
+
+namespace binlog {
+
+namespace {
+
+constexpr std::size_t readSize = std::size_t{1} << 16;
+
+/** Wait this long between checks, if inotify is not available */
+constexpr std::chrono::milliseconds pollInterval{10};
+
+/** Check if the file was replaced at least this often, even if inotify is available */
+constexpr std::chrono::milliseconds recheckInterval{100};
+
+[[noreturn]] void throwError(const std::string& what, const std::string& path)
+{
+  throw std::runtime_error(what + " " + path + ": " + std::strerror(errno)); // NOLINT(concurrency-mt-unsafe)
+}
+
+std::string directoryOf(const std::string& path)
+{
+  const std::size_t slash = path.find_last_of('/');
+  if (slash == std::string::npos) { return "."; }
+  return (slash == 0) ? "/" : path.substr(0, slash);
+}
+
+} // namespace
+
+FollowEntryStream::FollowEntryStream(std::string path, Options options)
+  :_path(std::move(path)),
+   _options(std::move(options))
+{
+  open();
+
+#ifdef __linux__
+  // watch the directory, to be notified about replacing the file as well
+  _inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (_inotify >= 0)
+  {
+    const std::uint32_t mask = IN_MODIFY | IN_CREATE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE | IN_CLOSE_WRITE;
+    if (inotify_add_watch(_inotify, directoryOf(_path).data(), mask) < 0)
+    {
+      close(_inotify);
+      _inotify = -1; // fall back to polling
+    }
+  }
+#endif
+}
+
+FollowEntryStream::FollowEntryStream(std::string path)
+  :FollowEntryStream(std::move(path), Options{})
+{}
+
+FollowEntryStream::~FollowEntryStream()
+{
+  if (_inotify >= 0) { close(_inotify); }
+  close(_fd);
+}
+
+Range FollowEntryStream::nextEntryPayload()
+{
+  auto idleSince = std::chrono::steady_clock::now();
+  while (true)
+  {
+    const std::size_t available = _buffer.size() - _begin;
+    if (available >= sizeof(std::uint32_t))
+    {
+      std::uint32_t size = 0;
+      memcpy(&size, _buffer.data() + _begin, sizeof(size));
+      if (available - sizeof(size) >= size)
+      {
+        const Range result(_buffer.data() + _begin + sizeof(size), size);
+        _begin += sizeof(size) + size;
+        return result;
+      }
+    }
+
+    if (readAvailable() || reopenIfReplaced())
+    {
+      idleSince = std::chrono::steady_clock::now();
+      continue;
+    }
+
+    const auto idle = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - idleSince);
+    if (idle >= _options.idleTimeout) { return Range{}; }
+
+    if (_options.beforeWait) { _options.beforeWait(); }
+    wait((std::min)(_options.idleTimeout - idle, (_inotify >= 0) ? recheckInterval : pollInterval));
+  }
+}
+
+bool FollowEntryStream::readAvailable()
+{
+  // drop the entries already returned
+  _buffer.erase(_buffer.begin(), _buffer.begin() + std::ptrdiff_t(_begin));
+  _begin = 0;
+
+  const std::size_t oldSize = _buffer.size();
+  _buffer.resize(oldSize + readSize);
+  const ssize_t result = read(_fd, _buffer.data() + oldSize, readSize);
+  _buffer.resize(oldSize + std::size_t((std::max)(result, ssize_t{0})));
+
+  if (result < 0 && errno != EINTR && errno != EAGAIN) { throwError("Failed to read", _path); }
+  return result > 0;
+}
+
+bool FollowEntryStream::reopenIfReplaced()
+{
+  struct stat current = {};
+  struct stat opened = {};
+  if (stat(_path.data(), &current) != 0 || fstat(_fd, &opened) != 0)
+  {
+    return false; // e.g: renamed, but not yet recreated, keep reading the old file
+  }
+
+  if (current.st_ino != opened.st_ino || current.st_dev != opened.st_dev)
+  {
+    // replaced, the old file is completely read: an incomplete entry at its end is never completed
+    close(_fd);
+    _fd = -1;
+    open();
+  }
+  else if (lseek(_fd, 0, SEEK_CUR) > current.st_size)
+  {
+    // truncated
+    if (lseek(_fd, 0, SEEK_SET) != 0) { throwError("Failed to seek", _path); }
+  }
+  else
+  {
+    return false;
+  }
+
+  _buffer.clear();
+  _begin = 0;
+  ++_reopenCount;
+  return true;
+}
+
+void FollowEntryStream::open()
+{
+  _fd = ::open(_path.data(), O_RDONLY | O_CLOEXEC); // NOLINT(cppcoreguidelines-pro-type-vararg)
+  if (_fd < 0) { throwError("Failed to open", _path); }
+}
+
+void FollowEntryStream::wait(std::chrono::milliseconds timeout)
+{
+#ifdef __linux__
+  if (_inotify >= 0)
+  {
+    pollfd fd = {_inotify, POLLIN, 0};
+    if (poll(&fd, 1, int(timeout.count())) > 0)
+    {
+      // drain the events, the file is checked anyway
+      alignas(inotify_event) char events[4096];
+      while (read(_inotify, events, sizeof(events)) > 0) {}
+    }
+    return;
+  }
+#endif
+
+  std::this_thread::sleep_for(timeout);
+}
+
+} // namespace binlog
+
+#endif // _WIN32
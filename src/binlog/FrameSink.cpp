@@ -0,0 +1,165 @@
+#include <binlog/FrameSink.hpp>
+
+#include <algorithm> // min
+#include <cstddef> // ptrdiff_t
+#include <cstring> // memcpy
+#include <utility> // move
+
+namespace binlog {
+
+FrameSink::FrameSink(Acquire acquire, Transmit transmit)
+  :_acquire(std::move(acquire)),
+   _transmit(std::move(transmit))
+{}
+
+FrameSink& FrameSink::write(const char* data, std::streamsize ssize)
+{
+  std::size_t size = std::size_t(ssize);
+  bool dropping = false; // until the end of this call, if no buffer is available
+
+  while (size != 0)
+  {
+    if (! dropping && ! openFrame())
+    {
+      dropping = true;
+      ++_sequence; // make the receiver notice the gap
+    }
+
+    const bool entryStart = _sizePrefixBytes == 0 && _entryRemaining == 0;
+    if (entryStart && ! dropping && _firstEntry == noEntryStart)
+    {
+      _firstEntry = std::uint32_t(_used - frameHeaderSize);
+    }
+
+    // bytes to write now: until the end of the frame, and of the size prefix or the entry
+    std::size_t n = dropping ? size : (std::min)(size, _buffer.size - _used);
+    if (_entryRemaining == 0)
+    {
+      // the size prefix might be split between frames and write calls
+      n = (std::min)(n, sizeof(_sizePrefix) - _sizePrefixBytes);
+      memcpy(_sizePrefix + _sizePrefixBytes, data, n);
+      _sizePrefixBytes += n;
+      if (_sizePrefixBytes == sizeof(_sizePrefix))
+      {
+        std::uint32_t entrySize = 0;
+        memcpy(&entrySize, _sizePrefix, sizeof(entrySize));
+        _entryRemaining = entrySize;
+        _sizePrefixBytes = 0;
+      }
+    }
+    else
+    {
+      n = std::size_t((std::min)(std::uint64_t(n), _entryRemaining));
+      _entryRemaining -= n;
+    }
+
+    if (dropping)
+    {
+      _droppedBytes += n;
+    }
+    else
+    {
+      memcpy(_buffer.data + _used, data, n);
+      _used += n;
+      if (_used == _buffer.size) { transmitFrame(); }
+    }
+
+    data += n;
+    size -= n;
+  }
+
+  return *this;
+}
+
+void FrameSink::flush()
+{
+  if (_buffer.data != nullptr && _used > frameHeaderSize) { transmitFrame(); }
+}
+
+bool FrameSink::openFrame()
+{
+  if (_buffer.data != nullptr) { return true; }
+
+  const Buffer buffer = _acquire();
+  if (buffer.data == nullptr || buffer.size <= frameHeaderSize) { return false; }
+
+  _buffer = buffer;
+  _used = frameHeaderSize;
+  _firstEntry = noEntryStart;
+  return true;
+}
+
+void FrameSink::transmitFrame()
+{
+  const std::uint32_t size = std::uint32_t(_used - frameHeaderSize);
+  memcpy(_buffer.data, &_sequence, sizeof(_sequence));
+  memcpy(_buffer.data + 4, &size, sizeof(size));
+  memcpy(_buffer.data + 8, &_firstEntry, sizeof(_firstEntry));
+
+  char* data = _buffer.data;
+  _buffer = Buffer{nullptr, 0};
+  ++_sequence;
+  ++_frameCount;
+  _transmit(data, _used);
+}
+
+bool FrameReassembler::add(const char* frame, std::size_t size)
+{
+  if (size < frameHeaderSize) { return false; }
+
+  std::uint32_t sequence = 0;
+  std::uint32_t payloadSize = 0;
+  std::uint32_t firstEntry = 0;
+  memcpy(&sequence, frame, sizeof(sequence));
+  memcpy(&payloadSize, frame + 4, sizeof(payloadSize));
+  memcpy(&firstEntry, frame + 8, sizeof(firstEntry));
+  if (payloadSize > size - frameHeaderSize) { return false; }
+  if (firstEntry != noEntryStart && firstEntry > payloadSize) { return false; }
+
+  if (_started && sequence != _sequence)
+  {
+    _lostFrameCount += std::uint32_t(sequence - _sequence);
+    _synced = false;
+  }
+  _started = true;
+  _sequence = sequence + 1;
+
+  const char* payload = frame + frameHeaderSize;
+  if (! _synced)
+  {
+    _pending.clear();
+    if (firstEntry == noEntryStart) { return true; } // no entry begins in this frame
+    payload += firstEntry;
+    payloadSize -= firstEntry;
+    _synced = true;
+  }
+
+  _pending.insert(_pending.end(), payload, payload + payloadSize);
+  completeEntries();
+  return true;
+}
+
+std::vector<char> FrameReassembler::takeEntries()
+{
+  std::vector<char> result;
+  result.swap(_entries);
+  return result;
+}
+
+void FrameReassembler::completeEntries()
+{
+  std::size_t pos = 0;
+  while (_pending.size() - pos >= sizeof(std::uint32_t))
+  {
+    std::uint32_t entrySize = 0;
+    memcpy(&entrySize, _pending.data() + pos, sizeof(entrySize));
+    const std::size_t end = pos + sizeof(entrySize) + entrySize;
+    if (end > _pending.size()) { break; }
+    pos = end;
+  }
+
+  _entries.insert(_entries.end(), _pending.begin(), _pending.begin() + std::ptrdiff_t(pos));
+  _pending.erase(_pending.begin(), _pending.begin() + std::ptrdiff_t(pos));
+}
+
+} // namespace binlog
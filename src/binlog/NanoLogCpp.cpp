@@ -15,10 +15,7 @@
 #include "binlog/NanoLogCpp.h"
 #include <cstdint>
 #include <cstring>
-
-#include <algorithm>
-#include <iostream>
-#include <utility>
+#include <cwchar>
 
 
  /***
@@ -36,193 +33,6 @@
   */
 namespace NanoLogInternal {
 
-	/**
-	 * Checks whether a character is with the terminal set of format specifier
-	 * characters according to the printf specification:
-	 * http://www.cplusplus.com/reference/cstdio/printf/
-	 *
-	 * \param c
-	 *      character to check
-	 * \return
-	 *      true if the character is in the set, indicating the end of the specifier
-	 */
-	inline bool isTerminal(char c)
-	{
-		return c == 'd' || c == 'i'
-			|| c == 'u' || c == 'o'
-			|| c == 'x' || c == 'X'
-			|| c == 'f' || c == 'F'
-			|| c == 'e' || c == 'E'
-			|| c == 'g' || c == 'G'
-			|| c == 'a' || c == 'A'
-			|| c == 'c' || c == 'p'
-			|| c == '%' || c == 's'
-			|| c == 'n';
-	}
-
-	/**
-	 * Checks whether a character is in the set of characters that specifies
-	 * a flag according to the printf specification:
-	 * http://www.cplusplus.com/reference/cstdio/printf/
-	 *
-	 * \param c
-	 *      character to check
-	 * \return
-	 *      true if the character is in the set
-	 */
-	inline bool isFlag(char c)
-	{
-		return c == '-' || c == '+' || c == ' ' || c == '#' || c == '0';
-	}
-
-	/**
-	 * Checks whether a character is in the set of characters that specifies
-	 * a length field according to the printf specification:
-	 * http://www.cplusplus.com/reference/cstdio/printf/
-	 *
-	 * \param c
-	 *      character to check
-	 * \return
-	 *      true if the character is in the set
-	 */
-	inline bool isLength(char c)
-	{
-		return c == 'h' || c == 'l' || c == 'j'
-			|| c == 'z' || c == 't' || c == 'L';
-	}
-
-	/**
-	 * Checks whether a character is a digit (0-9) or not.
-	 *
-	 * \param c
-	 *      character to check
-	 * \return
-	 *      true if the character is a digit
-	 */
-	inline bool isDigit(char c) {
-		return (c >= '0' && c <= '9');
-	}
-
-	/**
-	 * Analyzes a static printf style format string and extracts type information
-	 * about the p-th parameter that would be used in a corresponding NANO_LOG()
-	 * invocation.
-	 *
-	 * \tparam N
-	 *      Length of the static format string (automatically deduced)
-	 * \param fmt
-	 *      Format string to parse
-	 * \param paramNum
-	 *      p-th parameter to return type information for (starts from zero)
-	 * \return
-	 *      Returns an ParamType enum describing the type of the parameter
-	 */
-	std::vector<ParamType> getParamInfo(const char* fmt, int N)
-	{
-		std::vector<ParamType> Params;
-		int pos = 0;
-		while (pos < N - 1) {
-
-			// The code below searches for something that looks like a printf
-			// specifier (i.e. something that follows the format of
-			// %<flags><width>.<precision><length><terminal>). We only care
-			// about precision and type, so everything else is ignored.
-			if (fmt[pos] != '%') {
-				++pos;
-				continue;
-			}
-			else {
-				// Note: gcc++ 5,6,7,8 seems to hang whenever one uses the construct
-				// "if (...) {... continue; }" without an else in constexpr
-				// functions. Hence, we have the code here wrapped in an else {...}
-				// I reported this bug to the developers here
-				// https://gcc.gnu.org/bugzilla/show_bug.cgi?id=86767
-				++pos;
-
-				// Two %'s in a row => Comment
-				if (fmt[pos] == '%') {
-					++pos;
-					continue;
-				}
-				else {
-
-					// Consume flags
-					while (NanoLogInternal::isFlag(fmt[pos]))
-						++pos;
-
-					// Consume width
-					if (fmt[pos] == '*') {
-						Params.push_back(ParamType::DYNAMIC_WIDTH);
-						++pos;
-					}
-					else {
-						while (NanoLogInternal::isDigit(fmt[pos]))
-							++pos;
-					}
-
-					// Consume precision
-					bool hasDynamicPrecision = false;
-					int precision = -1;
-					if (fmt[pos] == '.') {
-						++pos;  // consume '.'
-
-						if (fmt[pos] == '*') {
-							Params.push_back(ParamType::DYNAMIC_PRECISION);
-							hasDynamicPrecision = true;
-							++pos;
-						}
-						else {
-							precision = 0;
-							while (NanoLogInternal::isDigit(fmt[pos])) {
-								precision = 10 * precision + (fmt[pos] - '0');
-								++pos;
-							}
-						}
-					}
-
-					// consume length
-					while (isLength(fmt[pos]))
-						++pos;
-
-					// Consume terminal
-					if (!NanoLogInternal::isTerminal(fmt[pos])) {
-						Params.push_back(ParamType::INVALID);
-						//throw std::invalid_argument(
-						//        "Unrecognized format specifier after %");
-					}
-
-					// Fail on %n specifiers (i.e. store position to address) since
-					// we cannot know the position without formatting.
-					if (fmt[pos] == 'n') {
-						Params.push_back(ParamType::INVALID);
-						/* throw std::invalid_argument(
-								 "%n specifiers are not support in NanoLog!");*/
-					}
-
-					if (fmt[pos] != 's')
-					{
-						Params.push_back(ParamType::NON_STRING);
-					}
-					else if (hasDynamicPrecision)
-					{
-						Params.push_back(ParamType::STRING_WITH_DYNAMIC_PRECISION);
-					}
-					else if (precision == -1)
-					{
-						Params.push_back(ParamType::STRING_WITH_NO_PRECISION);
-					}
-					else
-					{
-						Params.push_back(ParamType(precision));
-					}
-					++pos;
-				}
-			}
-		}
-
-		return Params;
-	}
-
 	/**
 	 * For a single non-string, non-void pointer argument, return the number
 	 * of bytes needed to represent the full-width type without compression.
@@ -262,8 +72,8 @@ namespace NanoLogInternal {
 	 */
 	inline size_t
 		getArgSize(const ParamType,
-			uint64_t& previousPrecision,
-			size_t& stringSize,
+			uint64_t& /* previousPrecision */,
+			size_t& /* stringSize */,
 			const void*)
 	{
 		return sizeof(void*);
@@ -7,12 +7,24 @@
 #include <mserialize/string_view.hpp>
 #include <mserialize/visit.hpp>
 
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
-#include <cstdio>
+#include <cstdio> // snprintf
 #include <cstdlib> // abs
+#include <cstring> // strlen
 #include <iomanip> // setw
 #include <ostream>
+#include <sstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+  #define WIN32_LEAN_AND_MEAN
+  #define NOMINMAX
+  #include <windows.h> // NOLINT LoadLibraryA, GetProcAddress
+#else // assume POSIX
+  #include <dlfcn.h> // NOLINT dlopen, dlsym
+#endif
 
 namespace {
 
@@ -36,32 +48,47 @@ bool useLocaltime(const std::string& format)
   return true;
 }
 
-// Given path=foo/bar/baz.cpp, write baz.cpp to out,
-// or the full path if no path separator (/ or \) found.
-void printFilename(binlog::detail::OstreamBuffer& out, const std::string& path)
+constexpr char digitPairs[] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
+// write `i` to dst[0,2), zero padded
+void writeTwoDigits(char* dst, int i)
 {
-  std::size_t i = path.size();
-  while (i != 0)
-  {
-    if (path[i-1] == '/' || path[i-1] == '\\') { break; }
-    --i;
-  }
-  out.write(path.data() + i, path.size() - i);
+  dst[0] = digitPairs[2 * i];
+  dst[1] = digitPairs[2 * i + 1];
+}
+
+// write `i` to dst[0,9), zero padded
+void writeNineDigits(char* dst, int i)
+{
+  assert(0 <= i && i < 1'000'000'000);
+  dst[0] = char('0' + i / 100'000'000);
+  const int r = i % 100'000'000;
+  writeTwoDigits(dst + 1, r / 1'000'000);
+  writeTwoDigits(dst + 3, r / 10'000 % 100);
+  writeTwoDigits(dst + 5, r / 100 % 100);
+  writeTwoDigits(dst + 7, r % 100);
 }
 
 void printTwoDigits(binlog::detail::OstreamBuffer& out, int i)
 {
   assert(0 <= i && i < 100);
-  const int b = i % 10;
-  const int a = (i - b) / 10;
-  const char digits[2]{char('0' + a), char('0' + b)};
-  out.write(digits, 2);
+  out.write(digitPairs + 2 * i, 2);
 }
 
 void printNineDigits(binlog::detail::OstreamBuffer& out, int i)
 {
-  char buf[16];
-  (void)snprintf(buf, sizeof(buf), "%.9d", i);
+  char buf[9];
+  writeNineDigits(buf, i);
   out.write(buf, 9);
 }
 
@@ -78,6 +105,84 @@ void printTimeZoneOffset(binlog::detail::OstreamBuffer& out, int seconds)
   printTwoDigits(out, mins < 100 ? mins : 0);
 }
 
+// The value of an arithmetic argument, formatted according to a FormatSpec
+struct ArithmeticValue
+{
+  enum class Kind { Other, Signed, Unsigned, Float }; // bool and char are Other
+
+  Kind kind = Kind::Other;
+  std::int64_t i = 0;
+  std::uint64_t u = 0;
+  long double f = 0;
+
+  void visit(bool) {}
+  void visit(char) {}
+
+  void visit(std::int8_t v)  { kind = Kind::Signed; i = v; }
+  void visit(std::int16_t v) { kind = Kind::Signed; i = v; }
+  void visit(std::int32_t v) { kind = Kind::Signed; i = v; }
+  void visit(std::int64_t v) { kind = Kind::Signed; i = v; }
+
+  void visit(std::uint8_t v)  { kind = Kind::Unsigned; u = v; }
+  void visit(std::uint16_t v) { kind = Kind::Unsigned; u = v; }
+  void visit(std::uint32_t v) { kind = Kind::Unsigned; u = v; }
+  void visit(std::uint64_t v) { kind = Kind::Unsigned; u = v; }
+
+  void visit(float v)       { kind = Kind::Float; f = v; }
+  void visit(double v)      { kind = Kind::Float; f = v; }
+  void visit(long double v) { kind = Kind::Float; f = v; }
+};
+
+bool isFloatType(char type)
+{
+  return type == 'f' || type == 'F' || type == 'e' || type == 'E' || type == 'g' || type == 'G';
+}
+
+// append `value` to `out` in the base of the integer `type` (d, x, X, o, b)
+void appendInteger(std::string& out, std::uint64_t value, char type)
+{
+  const unsigned base = (type == 'x' || type == 'X') ? 16u : (type == 'o') ? 8u : (type == 'b') ? 2u : 10u;
+  const char* digits = (type == 'X') ? "0123456789ABCDEF" : "0123456789abcdef";
+
+  char buf[64];
+  std::size_t size = 0;
+  do
+  {
+    buf[size++] = digits[value % base];
+    value /= base;
+  } while (value != 0);
+
+  while (size != 0) { out.push_back(buf[--size]); }
+}
+
+// append `value` to `out` as printf does, with the precision and float `type` of `spec`
+void appendFloat(std::string& out, long double value, const binlog::detail::FormatSpec& spec)
+{
+  char format[8] = {'%'};
+  std::size_t f = 1;
+  if (spec.alternate) { format[f++] = '#'; }
+  format[f++] = '.';
+  format[f++] = '*';
+  format[f++] = 'L';
+  format[f++] = (spec.type != 0) ? spec.type : 'g';
+
+  // without type, the precision is the number of significant digits, as of std::format
+  const int precision = (spec.precision >= 0) ? spec.precision : 6;
+  const int size = std::snprintf(nullptr, 0, format, precision, value);
+  if (size <= 0) { return; }
+
+  const std::size_t begin = out.size();
+  out.resize(begin + std::size_t(size) + 1);
+  std::snprintf(&out[begin], std::size_t(size) + 1, format, precision, value);
+  out.resize(begin + std::size_t(size));
+}
+
+// write `size` copies of `fill`
+void writeFill(binlog::detail::OstreamBuffer& out, char fill, std::size_t size)
+{
+  for (std::size_t i = 0; i < size; ++i) { out.put(fill); }
+}
+
 } // namespace
 
 namespace binlog {
@@ -85,9 +190,135 @@ namespace binlog {
 PrettyPrinter::PrettyPrinter(std::string eventFormat, std::string timeFormat)
   :_eventFormat(std::move(eventFormat)),
    _timeFormat(std::move(timeFormat)),
+   _eventFormatOps(compileFormat(_eventFormat)),
+   _timeFormatOps(compileFormat(_timeFormat)),
    _useLocaltime(useLocaltime(_eventFormat)),
    _clockSync(nullptr)
-{}
+{
+  addBuiltinStructPrinters();
+}
+
+void PrettyPrinter::addStructPrinter(std::string name, std::string fieldTags, StructPrinter printer)
+{
+  const auto key = std::make_pair(std::move(name), std::move(fieldTags));
+  const auto it = _structPrinterIds.find(key);
+  StructPrinterEntry entry{StructPrinterKind::custom, nullptr, 0, std::move(printer)};
+  if (it != _structPrinterIds.end())
+  {
+    _structPrinters[it->second] = std::move(entry);
+  }
+  else
+  {
+    _structPrinterIds.emplace(key, std::uint32_t(_structPrinters.size()));
+    _structPrinters.push_back(std::move(entry));
+  }
+
+  // the printers are resolved when a source is first seen, resolve them again
+  _sourceCaches = detail::SegmentedMap<SourceCache>();
+  _eventSourceCache = nullptr;
+}
+
+void PrettyPrinter::addEnumPrinter(std::string name, EnumPrinter printer)
+{
+  _enumPrinters[std::move(name)] = std::move(printer);
+}
+
+void PrettyPrinter::loadPrinterPlugin(const std::string& path)
+{
+  using PluginFunction = void (*)(PrettyPrinter&);
+
+#ifdef _WIN32
+  HMODULE module = LoadLibraryA(path.c_str());
+  if (module == nullptr)
+  {
+    throw std::runtime_error("Failed to load printer plugin: " + path + ", error: " + std::to_string(GetLastError()));
+  }
+  const auto function = reinterpret_cast<PluginFunction>(GetProcAddress(module, "binlog_printer_plugin")); // NOLINT
+#else
+  void* module = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+  if (module == nullptr)
+  {
+    throw std::runtime_error("Failed to load printer plugin: " + std::string(dlerror()));
+  }
+  const auto function = reinterpret_cast<PluginFunction>(dlsym(module, "binlog_printer_plugin")); // NOLINT
+#endif
+
+  if (function == nullptr)
+  {
+    throw std::runtime_error("Printer plugin does not define binlog_printer_plugin: " + path);
+  }
+
+  function(*this);
+}
+
+void PrettyPrinter::addAddressModule(std::string path, std::uint64_t base)
+{
+  auto entry = std::make_pair(base, std::move(path));
+  _addressModules.insert(std::upper_bound(_addressModules.begin(), _addressModules.end(), entry), std::move(entry));
+}
+
+void PrettyPrinter::addBuiltinStructPrinters()
+{
+  const auto add = [this](std::string name, const char* tag, StructPrinterKind kind, const char* suffix, unsigned scale = 0)
+  {
+    _structPrinterIds.emplace(std::make_pair(std::move(name), std::string(tag)), std::uint32_t(_structPrinters.size()));
+    _structPrinters.push_back(StructPrinterEntry{kind, suffix, scale, StructPrinter()});
+  };
+
+  add("binlog::address", "`value'L", StructPrinterKind::address, nullptr);
+  add("std::chrono::system_clock::time_point", "`ns'l", StructPrinterKind::timePoint, nullptr);
+
+  const std::pair<const char*, const char*> durations[] = {
+    {"std::chrono::duration<Rep,std::nano>", "ns"},
+    {"std::chrono::duration<Rep,std::micro>", "us"},
+    {"std::chrono::duration<Rep,std::milli>", "ms"},
+    {"std::chrono::duration<Rep,std::ratio<1>>", "s"},
+    {"std::chrono::duration<Rep,std::ratio<60>>", "m"},
+    {"std::chrono::duration<Rep,std::ratio<3600>>", "h"},
+  };
+  for (const auto& duration : durations)
+  {
+    add(duration.first, "`count'l", StructPrinterKind::duration, duration.second);
+    add(duration.first, "`count'i", StructPrinterKind::duration32, duration.second);  // on MSVC, for minutes and hours
+  }
+
+  add("binlog::Counter", "`value'l", StructPrinterKind::counter, nullptr);
+  add("binlog::ScopeDuration", "`ticks'L", StructPrinterKind::scopeDuration, nullptr);
+  add("binlog::TruncatedString", "`value'[c`size'L", StructPrinterKind::truncatedString, nullptr);
+  add("binlog::InternedStringId", "`id'L", StructPrinterKind::internedString, nullptr);
+  add("binlog::Stacktrace", "`modules'L`frames'[L", StructPrinterKind::stacktrace, nullptr);
+  add("std::filesystem::path", "`str'[c", StructPrinterKind::string, nullptr);
+  add("std::filesystem::directory_entry", "`path'{std::filesystem::path`str'[c}", StructPrinterKind::string, nullptr);
+  add("std::error_code", "`message'[c", StructPrinterKind::string, nullptr);
+
+  for (unsigned scale = 0; scale <= 18; ++scale)
+  {
+    add("binlog::Decimal<" + std::to_string(scale) + ">", "`value'l", StructPrinterKind::decimal, nullptr, scale);
+  }
+
+  _fixedStringPrinter = std::uint32_t(_structPrinters.size());
+  _structPrinters.push_back(StructPrinterEntry{StructPrinterKind::fixedString, nullptr, 0, StructPrinter()});
+}
+
+std::uint32_t PrettyPrinter::findStructPrinter(mserialize::string_view name, mserialize::string_view tag) const
+{
+  const auto it = _structPrinterIds.find(std::make_pair(
+    std::string(name.data(), name.size()), std::string(tag.data(), tag.size())
+  ));
+  if (it != _structPrinterIds.end()) { return it->second; }
+
+  // `size'B`data'(cc...c), N times c
+  const mserialize::string_view fixedStringPrefix = "`size'B`data'(";
+  if (name == "binlog::FixedString"
+      && tag.size() > fixedStringPrefix.size() + 1
+      && tag.starts_with(fixedStringPrefix) && tag.ends_with(')')
+      && std::all_of(tag.begin() + fixedStringPrefix.size(), tag.end() - 1, [](char c) { return c == 'c'; }))
+  {
+    return _fixedStringPrinter;
+  }
+
+  return noStructPrinter;
+}
 
 void PrettyPrinter::printEvent(
   std::ostream& ostr,
@@ -97,94 +328,288 @@ void PrettyPrinter::printEvent(
 )
 {
   detail::OstreamBuffer out(ostr);
+  printEvent(out, event, writerProp, clockSync);
+}
+
+void PrettyPrinter::printEvent(
+  detail::OstreamBuffer& out,
+  const Event& event,
+  const WriterProp& writerProp,
+  const ClockSync& clockSync
+)
+{
   _clockSync = &clockSync;
+  _internedStrings = event.internedStrings;
+  _eventSourceCache = nullptr;
 
-  for (std::size_t i = 0; i < _eventFormat.size(); ++i)
+  for (const FormatOp& op : _eventFormatOps)
   {
-    const char c = _eventFormat[i];
-    if (c == '%' && ++i != _eventFormat.size())
+    if (op.spec == 0)
     {
-      const char spec = _eventFormat[i];
-      printEventField(out, spec, event, writerProp);
+      out.write(_eventFormat.data() + op.begin, op.size);
     }
     else
     {
-      out.put(c);
+      printEventField(out, op.spec, event, writerProp);
     }
   }
 }
 
+std::vector<PrettyPrinter::FormatOp> PrettyPrinter::compileFormat(const std::string& format)
+{
+  std::vector<FormatOp> result;
+
+  std::size_t literalBegin = 0;
+  for (std::size_t i = 0; i < format.size(); ++i)
+  {
+    // a closing % is a literal
+    if (format[i] == '%' && i + 1 != format.size())
+    {
+      if (literalBegin != i)
+      {
+        result.push_back(FormatOp{0, literalBegin, i - literalBegin});
+      }
+      result.push_back(FormatOp{format[i+1], 0, 0});
+      ++i;
+      literalBegin = i + 1;
+    }
+  }
+
+  if (literalBegin != format.size())
+  {
+    result.push_back(FormatOp{0, literalBegin, format.size() - literalBegin});
+  }
+
+  return result;
+}
+
 bool PrettyPrinter::printStruct(detail::OstreamBuffer& out, mserialize::Visitor::StructBegin sb, Range& input) const
 {
-  if (sb.name == "binlog::address" && sb.tag == "`value'L")
+  std::uint32_t id = noStructPrinter;
+
+  const mserialize::string_view planTag = (_visitedPlan != nullptr) ? _visitedPlan->tag() : mserialize::string_view();
+  if (sb.name.data() >= planTag.data() && sb.name.data() < planTag.data() + planTag.size())
   {
-    const std::uint64_t value = input.read<std::uint64_t>();
-    mserialize::detail::IntegerToHex tohex;
-    tohex.visit(value);
-    out << "0x" << tohex.value();
-    return true;
+    // the struct of the argument being printed, resolved by sourceCache
+    const std::uint32_t position = std::uint32_t(sb.name.data() - planTag.data());
+    const auto it = std::lower_bound(
+      _visitedStructPrinters->begin(), _visitedStructPrinters->end(), position,
+      [](const std::pair<std::uint32_t, std::uint32_t>& entry, std::uint32_t p) { return entry.first < p; }
+    );
+    id = (it != _visitedStructPrinters->end() && it->first == position) ? it->second : findStructPrinter(sb.name, sb.tag);
   }
+  else
+  {
+    id = findStructPrinter(sb.name, sb.tag);
+  }
+
+  return id != noStructPrinter && printStruct(_structPrinters[id], sb, out, input);
+}
+
+bool PrettyPrinter::printEnum(detail::OstreamBuffer& out, mserialize::Visitor::Enum e) const
+{
+  if (_enumPrinters.empty()) { return false; }
+
+  const auto it = _enumPrinters.find(e.name.to_string());
+  if (it == _enumPrinters.end()) { return false; }
+
+  // e.value is hexadecimal, negative values are prefixed by '-', e.g: "1F", "-1"
+  const bool negative = ! e.value.empty() && e.value.front() == '-';
+  std::uint64_t value = 0;
+  for (std::size_t i = negative ? 1 : 0; i < e.value.size(); ++i)
+  {
+    const char c = e.value[i];
+    value = value * 16 + std::uint64_t((c <= '9') ? c - '0' : c - 'A' + 10);
+  }
+  if (negative) { value = std::uint64_t(0) - value; }
 
-  if (sb.name == "std::chrono::system_clock::time_point" && sb.tag == "`ns'l")
+  return it->second(out, std::int64_t(value), e.enumerator);
+}
+
+bool PrettyPrinter::printStruct(const StructPrinterEntry& printer, mserialize::Visitor::StructBegin sb, detail::OstreamBuffer& out, Range& input) const
+{
+  switch (printer.kind)
+  {
+  case StructPrinterKind::address:
+    printAddress(out, input.read<std::uint64_t>());
+    return true;
+  case StructPrinterKind::timePoint:
   {
     if (_clockSync == nullptr) { return false; }
 
-    BrokenDownTime bdt{};
     const auto sinceEpoch = std::chrono::nanoseconds{input.read<std::int64_t>()};
 
     if (_useLocaltime)
     {
       const std::chrono::nanoseconds sinceEpochTz = sinceEpoch + std::chrono::seconds{_clockSync->tzOffset};
-      nsSinceEpochToBrokenDownTimeUTC(sinceEpochTz, bdt);
-      printTime(out, bdt, _clockSync->tzOffset, _clockSync->tzName.data());
+      printTime(out, sinceEpochTz, _clockSync->tzOffset, _clockSync->tzName.data(), _localTimeCache);
     }
     else
     {
-      nsSinceEpochToBrokenDownTimeUTC(sinceEpoch, bdt);
-      printTime(out, bdt, 0, "UTC");
+      printTime(out, sinceEpoch, 0, "UTC", _utcTimeCache);
     }
     return true;
   }
-
-  if (sb.name.starts_with("std::chrono::duration<Rep,"))
+  case StructPrinterKind::duration:
+    out << input.read<std::int64_t>() << printer.suffix;
+    return true;
+  case StructPrinterKind::duration32:
+    out << input.read<std::int32_t>() << printer.suffix;
+    return true;
+  case StructPrinterKind::counter:
+    out << input.read<std::int64_t>();
+    return true;
+  case StructPrinterKind::scopeDuration:
   {
-    const char* suffix =
-      sb.name.ends_with("std::nano>") ? "ns" :
-      sb.name.ends_with("std::micro>") ? "us" :
-      sb.name.ends_with("std::milli>") ? "ms" :
-      sb.name.ends_with("std::ratio<1>>") ? "s" :
-      sb.name.ends_with("std::ratio<60>>") ? "m" :
-      sb.name.ends_with("std::ratio<3600>>") ? "h" :
-      nullptr;
-    if (suffix != nullptr)
+    const std::uint64_t ticks = input.read<std::uint64_t>();
+    if (_clockSync != nullptr && std::int64_t(_clockSync->clockFrequency) > 0)
     {
-      if (sb.tag == "`count'l")
-      {
-        const std::int64_t count = input.read<std::int64_t>();
-        out << count << suffix;
-        return true;
-      }
-      if (sb.tag == "`count'i") // on MSVC, for minutes and hours
-      {
-        const std::int32_t count = input.read<std::int32_t>();
-        out << count << suffix;
-        return true;
-      }
+      out << ticksToNanoseconds(_clockSync->clockFrequency, std::int64_t(ticks)).count() << "ns";
     }
+    else
+    {
+      out << ticks << " ticks";
+    }
+    return true;
+  }
+  case StructPrinterKind::truncatedString:
+  {
+    const std::uint32_t prefixSize = input.read<std::uint32_t>();
+    out.write(input.view(prefixSize), prefixSize);
+    const std::uint64_t size = input.read<std::uint64_t>();
+    if (size > prefixSize)
+    {
+      out << "... (" << size << " bytes)";
+    }
+    return true;
   }
+  case StructPrinterKind::internedString:
+  {
+    if (_internedStrings == nullptr) { return false; }
 
-  if ((sb.name == "std::filesystem::path" && sb.tag == "`str'[c")
-  || (sb.name == "std::filesystem::directory_entry" && sb.tag == "`path'{std::filesystem::path`str'[c}")
-  || (sb.name == "std::error_code" && sb.tag == "`message'[c")
-  ) {
+    Range copy = input; // leave input unchanged if the string is unknown
+    const std::string* value = _internedStrings->find(copy.read<std::uint64_t>());
+    if (value == _internedStrings->end()) { return false; }
+
+    input = copy;
+    out.write(value->data(), value->size());
+    return true;
+  }
+  case StructPrinterKind::string:
+  {
     const std::uint32_t size = input.read<std::uint32_t>();
     out.write(input.view(size), size);
     return true;
   }
+  case StructPrinterKind::decimal:
+    out.writeFixedPoint(input.read<std::int64_t>(), printer.scale);
+    return true;
+  case StructPrinterKind::fixedString:
+  {
+    const std::size_t capacity = sb.tag.size() - sizeof("`size'B`data'()") + 1;
+    const std::size_t size = (std::min)(std::size_t(input.read<std::uint8_t>()), capacity);
+    const char* data = input.view(capacity);
+    out.write(data, size);
+    return true;
+  }
+  case StructPrinterKind::stacktrace:
+    printStacktrace(out, input);
+    return true;
+  case StructPrinterKind::custom:
+    return printer.custom(out, input);
+  }
 
   return false;
 }
 
+const std::vector<PrettyPrinter::LoadedModule>* PrettyPrinter::loadedModules(std::uint64_t id) const
+{
+  if (id == 0 || _internedStrings == nullptr) { return nullptr; }
+
+  const std::string* text = _internedStrings->find(id);
+  if (text == _internedStrings->end()) { return nullptr; }
+
+  auto it = _loadedModules.find(*text);
+  if (it != _loadedModules.end()) { return &it->second; }
+
+  std::vector<LoadedModule> modules;
+  std::istringstream lines(*text);
+  std::string line;
+  while (std::getline(lines, line))
+  {
+    std::istringstream fields(line);
+    LoadedModule module{};
+    fields >> std::hex >> module.begin >> module.end >> module.base;
+    fields.get(); // the separator, the path might contain spaces
+    std::getline(fields, module.path);
+    if (fields || fields.eof()) { modules.push_back(std::move(module)); }
+  }
+
+  return &_loadedModules.emplace(*text, std::move(modules)).first->second;
+}
+
+void PrettyPrinter::printStacktrace(detail::OstreamBuffer& out, Range& input) const
+{
+  const std::vector<LoadedModule>* modules = loadedModules(input.read<std::uint64_t>());
+  const std::uint32_t size = input.read<std::uint32_t>();
+
+  out << '[';
+  for (std::uint32_t i = 0; i < size; ++i)
+  {
+    if (i != 0) { out << ", "; }
+
+    const std::uint64_t frame = input.read<std::uint64_t>();
+    mserialize::detail::IntegerToHex tohex;
+
+    const LoadedModule* module = nullptr;
+    if (modules != nullptr)
+    {
+      for (const LoadedModule& m : *modules)
+      {
+        if (frame >= m.begin && frame < m.end) { module = &m; break; }
+      }
+    }
+
+    if (module == nullptr)
+    {
+      tohex.visit(frame);
+      out << "0x" << tohex.value();
+      continue;
+    }
+
+    // frames are return addresses: look up the call instruction before them
+    const std::uint64_t offset = frame - module->base;
+    const std::string& function = _symbolizer.symbolize(module->path, offset - 1);
+    const std::size_t filenameBegin = module->path.find_last_of('/') + 1; // npos + 1 == 0
+    tohex.visit(offset);
+
+    if (! function.empty()) { out << function << " ("; }
+    out.write(module->path.data() + filenameBegin, module->path.size() - filenameBegin);
+    out << "+0x" << tohex.value();
+    if (! function.empty()) { out << ')'; }
+  }
+  out << ']';
+}
+
+void PrettyPrinter::printAddress(detail::OstreamBuffer& out, std::uint64_t address) const
+{
+  mserialize::detail::IntegerToHex tohex;
+  tohex.visit(address);
+  out << "0x" << tohex.value();
+
+  const auto after = std::upper_bound(_addressModules.begin(), _addressModules.end(), address,
+    [](std::uint64_t a, const std::pair<std::uint64_t, std::string>& module) { return a < module.first; }
+  );
+  if (after == _addressModules.begin()) { return; }
+
+  const auto& module = *(after - 1);
+  const std::string& function = _symbolizer.symbolize(module.second, address - module.first);
+  if (! function.empty())
+  {
+    out << " (" << function << ')';
+  }
+}
+
 void PrettyPrinter::printEventField(
   detail::OstreamBuffer& out,
   char spec,
@@ -210,8 +635,12 @@ void PrettyPrinter::printEventField(
     out << event.source->file;
     break;
   case 'G':
-    printFilename(out, event.source->file);
+  {
+    const std::string& file = event.source->file;
+    const std::size_t begin = sourceCache(event).filenameBegin;
+    out.write(file.data() + begin, file.size() - begin);
     break;
+  }
   case 'L':
     out << event.source->line;
     break;
@@ -227,6 +656,9 @@ void PrettyPrinter::printEventField(
   case 't':
     out << writerProp.id;
     break;
+  case 'c':
+    out << writerProp.context;
+    break;
   case 'd':
     printProducerLocalTime(out, event.clockValue);
     break;
@@ -237,7 +669,10 @@ void PrettyPrinter::printEventField(
     out << event.clockValue;
     break;
   case 'm':
-    printEventMessage(out, event);
+    printEventMessage(out, event, false);
+    break;
+  case 'h':
+    printEventMessage(out, event, true);
     break;
   case '%':
     out.put('%');
@@ -248,40 +683,197 @@ void PrettyPrinter::printEventField(
   }
 }
 
-void PrettyPrinter::printEventMessage(detail::OstreamBuffer& out, const Event& event) const
+void PrettyPrinter::printEventMessage(detail::OstreamBuffer& out, const Event& event, bool hexBytes) const
 {
-  mserialize::string_view tags = event.source->argumentTags;
+  const SourceCache& cache = sourceCache(event);
+  const std::string& fmt = cache.formatString;
+
   Range args = event.arguments;
-  ToStringVisitor visitor(out, this);
+  ToStringVisitor visitor(out, this, hexBytes);
 
-  const std::string& fmt = event.source->formatString;
-  for (std::size_t i = 0; i < fmt.size(); ++i)
+  for (std::size_t i = 0; i < cache.argumentPlans.size(); ++i)
   {
-    const char c = fmt[i];
-    if (c == '{' && fmt[i+1] == '}')
+    out.write(fmt.data() + cache.literals[i].first, cache.literals[i].second);
+    _visitedPlan = &cache.argumentPlans[i];
+    _visitedStructPrinters = &cache.structPrinters[i];
+    if (cache.specs[i].empty())
     {
-      const mserialize::string_view tag = mserialize::detail::tag_pop(tags);
-      mserialize::visit(tag, visitor, args);
-      ++i; // skip }
+      mserialize::visit(cache.argumentPlans[i], visitor, args);
     }
     else
     {
-      out.put(c);
+      printFormattedArgument(out, cache.specs[i], cache.argumentPlans[i], args, hexBytes);
     }
   }
+  _visitedPlan = nullptr;
+  out.write(fmt.data() + cache.literals.back().first, cache.literals.back().second);
 }
 
-void PrettyPrinter::printProducerLocalTime(detail::OstreamBuffer& out, std::uint64_t clockValue) const
+void PrettyPrinter::printFormattedArgument(
+  detail::OstreamBuffer& out,
+  const detail::FormatSpec& spec,
+  const mserialize::VisitPlan& plan,
+  Range& args,
+  bool hexBytes
+) const
 {
-  // TODO(benedek) perf: cache bdt, update instead of complete recompute
+  using Kind = ArithmeticValue::Kind;
 
+  ArithmeticValue value;
+  Range valueArgs = args;
+  if (plan.ops().size() == 1 && plan.ops()[0].code == mserialize::VisitPlan::OpCode::Arithmetic)
+  {
+    mserialize::detail::visit_arithmetic(plan.ops()[0].arithmetic, value, valueArgs);
+  }
+
+  std::string text;     // the value, without the sign and the base prefix if it is a number
+  const char* prefix = ""; // base prefix of integers, e.g: 0x
+  bool negative = false;
+
+  const bool isInteger = value.kind == Kind::Signed || value.kind == Kind::Unsigned;
+  if (isInteger && ! isFloatType(spec.type))
+  {
+    negative = value.kind == Kind::Signed && value.i < 0;
+    const std::uint64_t magnitude = (value.kind == Kind::Unsigned) ? value.u
+      : negative ? ~std::uint64_t(value.i) + 1 : std::uint64_t(value.i);
+    appendInteger(text, magnitude, spec.type);
+
+    if (spec.alternate)
+    {
+      prefix = (spec.type == 'x') ? "0x" : (spec.type == 'X') ? "0X" : (spec.type == 'b') ? "0b" : (spec.type == 'o') ? "0" : "";
+    }
+    args = valueArgs;
+  }
+  else if (isInteger || (value.kind == Kind::Float && (isFloatType(spec.type) || (spec.type == 0 && spec.precision >= 0))))
+  {
+    long double f = value.f;
+    if (value.kind == Kind::Signed) { f = static_cast<long double>(value.i); }
+    if (value.kind == Kind::Unsigned) { f = static_cast<long double>(value.u); }
+
+    appendFloat(text, f, spec);
+    args = valueArgs;
+  }
+  else
+  {
+    // anything else, e.g: a string, a struct, or a number without type
+    std::ostringstream str;
+    {
+      detail::OstreamBuffer buf(str);
+      ToStringVisitor visitor(buf, this, hexBytes);
+      mserialize::visit(plan, visitor, args);
+    }
+    text = str.str();
+
+    // the precision of strings is the maximum number of bytes, not splitting UTF-8 characters
+    if (spec.precision >= 0 && plan.tag() == mserialize::string_view("[c") && text.size() > std::size_t(spec.precision))
+    {
+      std::size_t size = std::size_t(spec.precision);
+      while (size != 0 && (static_cast<unsigned char>(text[size]) & 0xC0) == 0x80) { --size; }
+      text.resize(size);
+    }
+  }
+
+  const bool isNumber = value.kind != Kind::Other;
+  if (isNumber && ! text.empty() && text.front() == '-')
+  {
+    negative = true;
+    text.erase(0, 1);
+  }
+
+  const char sign = negative ? '-' : (isNumber) ? spec.sign : char(0);
+  const std::size_t prefixSize = (sign != 0 ? 1 : 0) + std::strlen(prefix);
+  const std::size_t size = prefixSize + text.size();
+  const std::size_t padding = (spec.width > size) ? spec.width - size : 0;
+
+  // zero padding goes between the prefix and the digits, not applied to nan and inf
+  const bool zeroPad = isNumber && spec.zeroPad && spec.align == 0
+    && ! text.empty() && text.front() >= '0' && text.front() <= '9';
+
+  const char align = (spec.align != 0) ? spec.align : (isNumber) ? '>' : '<';
+  const std::size_t before = (zeroPad) ? 0 : (align == '>') ? padding : (align == '^') ? padding / 2 : 0;
+  const std::size_t after = (zeroPad) ? 0 : padding - before;
+
+  writeFill(out, spec.fill, before);
+  if (sign != 0) { out.put(sign); }
+  out << prefix;
+  if (zeroPad) { writeFill(out, '0', padding); }
+  out.write(text.data(), text.size());
+  writeFill(out, spec.fill, after);
+}
+
+const PrettyPrinter::SourceCache& PrettyPrinter::sourceCache(const Event& event) const
+{
+  if (_eventSourceCache != nullptr) { return *_eventSourceCache; }
+
+  const EventSource& source = *event.source;
+  const SourceCache* cached = _sourceCaches.find(source.id);
+  if (cached != _sourceCaches.end()
+      && cached->formatString == source.formatString
+      && cached->argumentTags == source.argumentTags
+      && cached->file == source.file)
+  {
+    _eventSourceCache = cached;
+    return *cached;
+  }
+
+  SourceCache cache;
+  cache.formatString = source.formatString;
+  cache.argumentTags = source.argumentTags;
+  cache.file = source.file;
+
+  // Given path=foo/bar/baz.cpp, the file name is baz.cpp,
+  // or the full path if no path separator (/ or \) found.
+  std::size_t f = cache.file.size();
+  while (f != 0 && cache.file[f-1] != '/' && cache.file[f-1] != '\\') { --f; }
+  cache.filenameBegin = f;
+
+  const std::string& fmt = cache.formatString;
+  mserialize::string_view tags = cache.argumentTags;
+  std::size_t literalBegin = 0;
+  detail::FormatSpec spec;
+  bool invalid = false;
+  std::size_t nameSize = 0;
+  const bool names = detail::names_are_placeholders(fmt, cache.argumentTags); // {name} was literal in older logfiles
+  for (std::size_t i = 0; i < fmt.size(); ++i)
+  {
+    const char* end = detail::parse_placeholder(fmt.c_str() + i, spec, invalid, nameSize, names);
+    if (end != nullptr)
+    {
+      cache.literals.emplace_back(literalBegin, i - literalBegin);
+      cache.argumentPlans.emplace_back(mserialize::detail::tag_pop(tags));
+      cache.specs.push_back(spec);
+      literalBegin = std::size_t(end - fmt.c_str());
+      i = literalBegin - 1; // skip the placeholder
+    }
+  }
+  cache.literals.emplace_back(literalBegin, fmt.size() - literalBegin);
+
+  // resolve the printers of the structs once, by their position in the plan:
+  // printStruct finds them without comparing the names
+  for (const mserialize::VisitPlan& plan : cache.argumentPlans)
+  {
+    cache.structPrinters.emplace_back();
+    for (const mserialize::VisitPlan::Op& op : plan.ops())
+    {
+      if (op.code != mserialize::VisitPlan::OpCode::Struct) { continue; }
+      const std::uint32_t id = findStructPrinter(plan.str(op.name), plan.str(op.tag));
+      cache.structPrinters.back().emplace_back(op.name.begin, id);
+    }
+    std::sort(cache.structPrinters.back().begin(), cache.structPrinters.back().end());
+  }
+
+  _sourceCaches.emplace(source.id, std::move(cache));
+  _eventSourceCache = _sourceCaches.find(source.id);
+  return *_eventSourceCache;
+}
+
+void PrettyPrinter::printProducerLocalTime(detail::OstreamBuffer& out, std::uint64_t clockValue) const
+{
   if (std::int64_t(_clockSync->clockFrequency) > 0)
   {
-    BrokenDownTime bdt{};
     const std::chrono::nanoseconds sinceEpoch = clockToNsSinceEpoch(*_clockSync, clockValue);
     const std::chrono::nanoseconds sinceEpochTz = sinceEpoch + std::chrono::seconds{_clockSync->tzOffset};
-    nsSinceEpochToBrokenDownTimeUTC(sinceEpochTz, bdt);
-    printTime(out, bdt, _clockSync->tzOffset, _clockSync->tzName.data());
+    printTime(out, sinceEpochTz, _clockSync->tzOffset, _clockSync->tzName.data(), _localTimeCache);
   }
   else
   {
@@ -291,14 +883,10 @@ void PrettyPrinter::printProducerLocalTime(detail::OstreamBuffer& out, std::uint
 
 void PrettyPrinter::printUTCTime(detail::OstreamBuffer& out, std::uint64_t clockValue) const
 {
-  // TODO(benedek) perf: cache bdt, update instead of complete recompute
-
   if (std::int64_t(_clockSync->clockFrequency) > 0)
   {
-    BrokenDownTime bdt{};
     const std::chrono::nanoseconds sinceEpoch = clockToNsSinceEpoch(*_clockSync, clockValue);
-    nsSinceEpochToBrokenDownTimeUTC(sinceEpoch, bdt);
-    printTime(out, bdt, 0, "UTC");
+    printTime(out, sinceEpoch, 0, "UTC", _utcTimeCache);
   }
   else
   {
@@ -306,19 +894,88 @@ void PrettyPrinter::printUTCTime(detail::OstreamBuffer& out, std::uint64_t clock
   }
 }
 
+void PrettyPrinter::printTime(
+  detail::OstreamBuffer& out,
+  std::chrono::nanoseconds sinceEpoch,
+  int tzoffset,
+  const char* tzname,
+  TimeCache& cache
+) const
+{
+  if (sinceEpoch.count() < 0)
+  {
+    // not cached, rare
+    BrokenDownTime bdt{};
+    nsSinceEpochToBrokenDownTimeUTC(sinceEpoch, bdt);
+    printTime(out, bdt, tzoffset, tzname);
+    return;
+  }
+
+  const std::chrono::seconds second = std::chrono::duration_cast<std::chrono::seconds>(sinceEpoch);
+  if (second.count() != cache.second || tzoffset != cache.tzoffset || cache.tzname != tzname)
+  {
+    updateTimeCache(cache, second.count(), tzoffset, tzname);
+  }
+
+  char nanoseconds[9];
+  writeNineDigits(nanoseconds, int((sinceEpoch - second).count()));
+
+  std::size_t begin = 0;
+  for (const std::size_t pos : cache.nanosecondPositions)
+  {
+    out.write(cache.text.data() + begin, pos - begin);
+    out.write(nanoseconds, sizeof(nanoseconds));
+    begin = pos + sizeof(nanoseconds);
+  }
+  out.write(cache.text.data() + begin, cache.text.size() - begin);
+}
+
+void PrettyPrinter::updateTimeCache(TimeCache& cache, std::int64_t second, int tzoffset, const char* tzname) const
+{
+  BrokenDownTime bdt{};
+  nsSinceEpochToBrokenDownTimeUTC(std::chrono::seconds{second}, bdt);
+
+  std::ostringstream stream;
+  cache.nanosecondPositions.clear();
+
+  {
+    detail::OstreamBuffer out(stream);
+    for (const FormatOp& op : _timeFormatOps)
+    {
+      if (op.spec == 'N')
+      {
+        out.flush();
+        cache.nanosecondPositions.push_back(std::size_t(stream.tellp()));
+      }
+
+      if (op.spec == 0)
+      {
+        out.write(_timeFormat.data() + op.begin, op.size);
+      }
+      else
+      {
+        printTimeField(out, op.spec, bdt, tzoffset, tzname);
+      }
+    }
+  }
+
+  cache.second = second;
+  cache.tzoffset = tzoffset;
+  cache.tzname = tzname;
+  cache.text = stream.str();
+}
+
 void PrettyPrinter::printTime(detail::OstreamBuffer& out, BrokenDownTime& bdt, int tzoffset, const char* tzname) const
 {
-  for (std::size_t i = 0; i < _timeFormat.size(); ++i)
+  for (const FormatOp& op : _timeFormatOps)
   {
-    const char c = _timeFormat[i];
-    if (c == '%' && ++i != _timeFormat.size())
+    if (op.spec == 0)
     {
-      const char spec = _timeFormat[i];
-      printTimeField(out, spec, bdt, tzoffset, tzname);
+      out.write(_timeFormat.data() + op.begin, op.size);
     }
     else
     {
-      out.put(c);
+      printTimeField(out, op.spec, bdt, tzoffset, tzname);
     }
   }
 }
@@ -0,0 +1,253 @@
+#include <binlog/RotatingFileSink.hpp>
+
+#include <binlog/Dictionary.hpp>
+#include <binlog/Entries.hpp>
+
+#include <binlog/detail/VectorOutputStream.hpp>
+
+#include <algorithm> // min
+#include <cstdio> // rename
+#include <cstring> // memcpy
+#include <fstream>
+#include <stdexcept>
+#include <utility> // move
+
+namespace binlog {
+
+RotatingFileSink::RotatingFileSink(std::string path, Options options)
+  :_sink(path, options.sink),
+   _path(std::move(path)),
+   _options(options),
+   _fileOpened(std::chrono::steady_clock::now())
+{}
+
+RotatingFileSink::RotatingFileSink(std::string path)
+  :RotatingFileSink(std::move(path), Options{})
+{}
+
+RotatingFileSink& RotatingFileSink::write(const char* data, std::streamsize ssize)
+{
+  std::size_t size = std::size_t(ssize);
+  while (size != 0)
+  {
+    if (_headerSize < _headerTarget)
+    {
+      const std::size_t n = (std::min)(size, _headerTarget - _headerSize);
+      memcpy(_header + _headerSize, data, n);
+      _headerSize += n;
+      data += n;
+      size -= n;
+
+      if (_headerSize == sizeof(std::uint32_t) && _headerTarget == sizeof(std::uint32_t))
+      {
+        // entry size is known, read the tag as well
+        std::uint32_t entrySize = 0;
+        memcpy(&entrySize, _header, sizeof(entrySize));
+        const std::size_t tagSize = (std::min)(std::size_t(entrySize), sizeof(std::uint64_t));
+        _headerTarget += tagSize;
+        _remaining = entrySize - tagSize;
+      }
+
+      if (_headerSize == _headerTarget)
+      {
+        entryHeader();
+        if (_remaining == 0) { entryEnd(); }
+      }
+    }
+    else
+    {
+      const std::size_t n = std::size_t((std::min)(std::uint64_t(size), _remaining));
+      writeEntryData(data, n);
+      _remaining -= n;
+      data += n;
+      size -= n;
+
+      if (_remaining == 0) { entryEnd(); }
+    }
+  }
+
+  return *this;
+}
+
+void RotatingFileSink::entryHeader()
+{
+  _kind = EntryKind::other;
+  if (_headerSize == sizeof(_header))
+  {
+    std::uint64_t tag = 0;
+    memcpy(&tag, _header + sizeof(std::uint32_t), sizeof(tag));
+
+    if (tag == EventSource::Tag) { _kind = EntryKind::eventSource; }
+    else if (tag == ClockSync::Tag) { _kind = EntryKind::clockSync; }
+    else if (tag == ClockCorrection::Tag) { _kind = EntryKind::clockCorrection; }
+    else if (tag == InternedString::Tag) { _kind = EntryKind::internedString; }
+    else if ((tag >> 63) == 0) { _kind = EntryKind::event; }
+
+    // rotate only between the batches of writers
+    if ((tag == WriterProp::Tag || _kind == EntryKind::eventSource
+         || _kind == EntryKind::clockSync || _kind == EntryKind::clockCorrection)
+        && shouldRotate())
+    {
+      rotate();
+    }
+
+    if (_kind == EntryKind::event && _options.onlyReferencedSources)
+    {
+      writeSource(tag);
+    }
+  }
+
+  if (isKept(_kind))
+  {
+    _entry.assign(_header, _header + _headerSize);
+  }
+
+  // with onlyReferencedSources, sources are written before the first event referencing them
+  _writeEntry = ! (_kind == EntryKind::eventSource && _options.onlyReferencedSources);
+  if (_writeEntry) { writeToFile(_header, _headerSize); }
+}
+
+void RotatingFileSink::writeEntryData(const char* data, std::size_t size)
+{
+  if (isKept(_kind))
+  {
+    _entry.insert(_entry.end(), data, data + size);
+  }
+
+  if (_writeEntry) { writeToFile(data, size); }
+}
+
+void RotatingFileSink::entryEnd()
+{
+  if (_kind == EntryKind::clockSync)
+  {
+    _clockSync.swap(_entry);
+  }
+  else if (_kind == EntryKind::clockCorrection)
+  {
+    _clockCorrection.swap(_entry);
+  }
+  else if (_kind == EntryKind::eventSource && _entry.size() >= sizeof(_header) + sizeof(std::uint64_t))
+  {
+    std::uint64_t id = 0;
+    memcpy(&id, _entry.data() + sizeof(_header), sizeof(id));
+
+    // a source consumed again (by reconsumeMetadata) is kept only once
+    if (_sourceRanges.count(id) == 0)
+    {
+      _sourceRanges[id] = SourceRange{_sources.size(), _entry.size()};
+      _sources.insert(_sources.end(), _entry.begin(), _entry.end());
+    }
+  }
+  else if (_kind == EntryKind::internedString && _entry.size() >= sizeof(_header) + sizeof(std::uint64_t))
+  {
+    std::uint64_t id = 0;
+    memcpy(&id, _entry.data() + sizeof(_header), sizeof(id));
+
+    if (_internedStringIds.insert(id).second)
+    {
+      _internedStrings.insert(_internedStrings.end(), _entry.begin(), _entry.end());
+    }
+  }
+
+  _entry.clear();
+  _headerSize = 0;
+  _headerTarget = sizeof(std::uint32_t);
+  _kind = EntryKind::other;
+  _writeEntry = true;
+}
+
+bool RotatingFileSink::shouldRotate() const
+{
+  if (_fileSize == _metadataSize) { return false; } // nothing new to rotate
+
+  return _rotationRequested
+    || (_options.maxFileSize != 0 && _fileSize >= _options.maxFileSize)
+    || (_options.maxFileAge.count() != 0
+        && std::chrono::steady_clock::now() - _fileOpened >= _options.maxFileAge);
+}
+
+void RotatingFileSink::rotate()
+{
+  ++_rotationCount;
+  _sink.rotate(_path, _path + "." + std::to_string(_rotationCount));
+
+  _rotationRequested = false;
+  _fileOpened = std::chrono::steady_clock::now();
+  _fileSize = 0;
+  _writtenSources.clear();
+
+  // make the new file self contained, without the Session (and its lock)
+  writeToFile(_clockCorrection.data(), _clockCorrection.size());
+  writeToFile(_clockSync.data(), _clockSync.size());
+  if (! _options.dictionaryDirectory.empty())
+  {
+    if (! _sources.empty() || ! _internedStrings.empty())
+    {
+      detail::VectorOutputStream reference;
+      serializeSizePrefixedTagged(DictionaryReference{writeDictionary()}, reference);
+      writeToFile(reference.data(), std::size_t(reference.ssize()));
+
+      for (const auto& source : _sourceRanges) { _writtenSources.insert(source.first); }
+    }
+    _metadataSize = _fileSize;
+    return;
+  }
+  if (! _options.onlyReferencedSources)
+  {
+    writeToFile(_sources.data(), _sources.size());
+  }
+  writeToFile(_internedStrings.data(), _internedStrings.size()); // even if onlyReferencedSources
+  _metadataSize = _fileSize;
+}
+
+std::uint64_t RotatingFileSink::writeDictionary()
+{
+  // sources and interned strings are only appended: same size, same content
+  const std::size_t size = _sources.size() + _internedStrings.size();
+  if (size == _dictionarySize) { return _dictionaryHash; }
+
+  std::vector<char> content(_sources);
+  content.insert(content.end(), _internedStrings.begin(), _internedStrings.end());
+  const std::uint64_t hash = dictionaryHash(content.data(), content.size());
+
+  const std::string path = dictionaryPath(_options.dictionaryDirectory, hash);
+  if (! std::ifstream(path)) // content addressed: an existing dictionary is complete
+  {
+    // write to a temporary file first, concurrent readers never see a partial dictionary
+    const std::string tmpPath = path + ".tmp";
+    {
+      std::ofstream file(tmpPath, std::ios_base::out | std::ios_base::binary);
+      file.write(content.data(), std::streamsize(content.size()));
+      if (! file) { throw std::runtime_error("Failed to write dictionary: " + tmpPath); }
+    }
+    if (std::rename(tmpPath.data(), path.data()) != 0)
+    {
+      throw std::runtime_error("Failed to rename " + tmpPath + " to " + path);
+    }
+  }
+
+  _dictionarySize = size;
+  _dictionaryHash = hash;
+  return hash;
+}
+
+void RotatingFileSink::writeSource(std::uint64_t id)
+{
+  if (! _writtenSources.insert(id).second) { return; }
+
+  const auto it = _sourceRanges.find(id);
+  if (it != _sourceRanges.end())
+  {
+    writeToFile(_sources.data() + it->second.offset, it->second.size);
+  }
+}
+
+void RotatingFileSink::writeToFile(const char* data, std::size_t size)
+{
+  if (size == 0) { return; }
+  _sink.write(data, std::streamsize(size));
+  _fileSize += size;
+}
+
+} // namespace binlog
@@ -0,0 +1,125 @@
+#include <binlog/SeriesEntryStream.hpp>
+
+#include <binlog/Entries.hpp>
+
+#include <fstream>
+#include <utility> // move
+
+namespace binlog {
+
+namespace {
+
+/** Map the file at `path`, and load its pages, by reading a byte of each */
+std::unique_ptr<MmapEntryStream> mapAndLoad(const std::string& path)
+{
+  std::unique_ptr<MmapEntryStream> result(new MmapEntryStream(path));
+
+  constexpr std::size_t pageSize = 4096;
+  const char* data = result->data();
+  volatile char sink = 0;
+  for (std::size_t i = 0; i < result->size(); i += pageSize)
+  {
+    sink = data[i];
+  }
+  static_cast<void>(sink);
+
+  return result;
+}
+
+} // namespace
+
+SeriesEntryStream::SeriesEntryStream(std::vector<std::string> paths)
+  :_paths(std::move(paths))
+{
+  if (! _paths.empty())
+  {
+    _current.reset(new MmapEntryStream(_paths.front()));
+    _next = 1;
+    prefetch();
+  }
+}
+
+SeriesEntryStream::~SeriesEntryStream()
+{
+  if (_prefetched.valid()) { _prefetched.wait(); }
+}
+
+Range SeriesEntryStream::nextEntryPayload()
+{
+  while (_current)
+  {
+    Range payload = _current->nextEntryPayload();
+    if (payload.empty())
+    {
+      // the current file is done, continue with the next one
+      _current.reset();
+      if (_prefetched.valid())
+      {
+        _current = _prefetched.get();
+        ++_next;
+        prefetch();
+      }
+    }
+    else if (! isDuplicate(payload))
+    {
+      return payload;
+    }
+    else
+    {
+      ++_skippedEntryCount;
+    }
+  }
+
+  return Range{};
+}
+
+std::vector<std::string> SeriesEntryStream::rotatedFiles(const std::string& path)
+{
+  std::vector<std::string> result;
+  for (std::size_t i = 1; ; ++i)
+  {
+    std::string rotated = path + "." + std::to_string(i);
+    if (! std::ifstream(rotated)) { break; }
+    result.push_back(std::move(rotated));
+  }
+
+  if (std::ifstream(path)) { result.push_back(path); }
+  return result;
+}
+
+void SeriesEntryStream::prefetch()
+{
+  if (_next < _paths.size())
+  {
+    _prefetched = std::async(std::launch::async, mapAndLoad, _paths[_next]);
+  }
+}
+
+bool SeriesEntryStream::isDuplicate(Range payload)
+{
+  const std::size_t size = payload.size();
+  const char* data = payload.view(0);
+  const std::uint64_t tag = payload.read<std::uint64_t>();
+
+  switch (tag)
+  {
+  case EventSource::Tag:
+  case InternedString::Tag:
+  {
+    std::unordered_map<std::uint64_t, std::string>& known = (tag == EventSource::Tag) ? _sources : _internedStrings;
+    const std::uint64_t id = payload.read<std::uint64_t>();
+    std::string& entry = known[id];
+    if (entry.size() == size && entry.compare(0, size, data, size) == 0) { return true; }
+    entry.assign(data, size);
+    return false;
+  }
+  case ClockSync::Tag:
+    if (_clockSync.size() == size && _clockSync.compare(0, size, data, size) == 0) { return true; }
+    _clockSync.assign(data, size);
+    return false;
+  default:
+    return false;
+  }
+}
+
+} // namespace binlog
@@ -0,0 +1,263 @@
+#include <binlog/SharedMemoryStream.hpp>
+
+#ifndef _WIN32 // assume POSIX
+
+#include <algorithm> // min
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring> // memcpy, strerror
+#include <new> // placement new
+#include <stdexcept>
+#include <thread>
+#include <utility> // move
+
+#include <fcntl.h> // NOLINT O_CREAT
+#include <signal.h> // NOLINT kill
+#include <sys/mman.h> // NOLINT shm_open, mmap
+#include <sys/stat.h> // NOLINT fstat
+#include <unistd.h> // NOLINT ftruncate, getpid
+
+namespace binlog {
+
+namespace {
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "atomics shared between processes must be lock free");
+
+constexpr std::uint64_t segmentMagic = 0xFE216F7A6F38BFBE;
+
+/**
+ * Placed at the beginning of the segment, followed by the queue buffer.
+ *
+ * The read and write positions grow monotonically,
+ * the buffer index is the position modulo capacity.
+ * The members written by the writer and the reader
+ * are separated by padding, to avoid false sharing.
+ */
+struct SegmentHeader
+{
+  std::atomic<std::uint64_t> magic;        /**< set last, when the segment is initialized */
+  std::uint64_t capacity;                  /**< size of the buffer following the header */
+  std::int64_t writerPid;                  /**< process that created the segment */
+
+  // members written by the writer
+  std::atomic<std::uint64_t> writePos;     /**< bytes written so far */
+  std::atomic<std::uint64_t> writerClosed; /**< non-zero if the writer is destroyed */
+  char writerPadding[64];
+
+  // members written by the reader
+  std::atomic<std::uint64_t> readPos;      /**< bytes read so far */
+  char readerPadding[64];
+};
+
+SegmentHeader& header(char* segment)
+{
+  return *reinterpret_cast<SegmentHeader*>(segment); // NOLINT
+}
+
+char* buffer(char* segment)
+{
+  return segment + sizeof(SegmentHeader);
+}
+
+[[noreturn]] void throwError(const std::string& what, const std::string& name)
+{
+  throw std::runtime_error(what + " " + name + ": " + std::strerror(errno)); // NOLINT(concurrency-mt-unsafe)
+}
+
+char* mapSegment(int fd, std::size_t size, const std::string& name)
+{
+  void* segment = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  const int mapErrno = errno;
+  close(fd);
+  if (segment == MAP_FAILED)
+  {
+    errno = mapErrno;
+    throwError("Failed to map shared memory", name);
+  }
+  return static_cast<char*>(segment);
+}
+
+} // namespace
+
+SharedMemoryOutputStream::SharedMemoryOutputStream(std::string name, std::size_t capacity)
+  :_name(std::move(name)),
+   _segment(nullptr),
+   _segmentSize(sizeof(SegmentHeader) + capacity)
+{
+  if (capacity == 0) { throw std::runtime_error("Shared memory capacity must be positive: " + _name); }
+
+  // a reader still attached to the stale segment keeps its mapping
+  shm_unlink(_name.c_str());
+
+  const int fd = shm_open(_name.c_str(), O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+  if (fd < 0) { throwError("Failed to create shared memory", _name); }
+
+  if (ftruncate(fd, off_t(_segmentSize)) != 0)
+  {
+    const int truncErrno = errno;
+    close(fd);
+    shm_unlink(_name.c_str());
+    errno = truncErrno;
+    throwError("Failed to resize shared memory", _name);
+  }
+
+  try
+  {
+    _segment = mapSegment(fd, _segmentSize, _name);
+  }
+  catch (...)
+  {
+    shm_unlink(_name.c_str());
+    throw;
+  }
+
+  // ftruncate zero fills the segment
+  SegmentHeader* h = new (_segment) SegmentHeader;
+  h->capacity = capacity;
+  h->writerPid = std::int64_t(getpid());
+  h->writePos.store(0, std::memory_order_relaxed);
+  h->writerClosed.store(0, std::memory_order_relaxed);
+  h->readPos.store(0, std::memory_order_relaxed);
+  h->magic.store(segmentMagic, std::memory_order_release);
+}
+
+SharedMemoryOutputStream::~SharedMemoryOutputStream()
+{
+  header(_segment).writerClosed.store(1, std::memory_order_release);
+  munmap(_segment, _segmentSize);
+}
+
+SharedMemoryOutputStream& SharedMemoryOutputStream::write(const char* data, std::streamsize ssize)
+{
+  SegmentHeader& h = header(_segment);
+  char* const buf = buffer(_segment);
+  const std::uint64_t cap = h.capacity;
+
+  std::size_t size = std::size_t(ssize);
+  std::uint64_t writePos = h.writePos.load(std::memory_order_relaxed);
+  std::chrono::microseconds backoff(1);
+
+  while (size != 0)
+  {
+    const std::uint64_t readPos = h.readPos.load(std::memory_order_acquire);
+    const std::uint64_t freeSpace = cap - (writePos - readPos);
+    if (freeSpace == 0)
+    {
+      // the reader is in an other process, poll
+      std::this_thread::sleep_for(backoff);
+      backoff = (std::min)(backoff * 2, std::chrono::microseconds(1000));
+      continue;
+    }
+    backoff = std::chrono::microseconds(1);
+
+    const std::size_t n = std::size_t((std::min)(std::uint64_t(size), freeSpace));
+    const std::size_t index = std::size_t(writePos % cap);
+    const std::size_t n1 = (std::min)(n, std::size_t(cap) - index);
+    memcpy(buf + index, data, n1);
+    memcpy(buf, data + n1, n - n1);
+
+    writePos += n;
+    h.writePos.store(writePos, std::memory_order_release);
+    data += n;
+    size -= n;
+  }
+
+  return *this;
+}
+
+std::size_t SharedMemoryOutputStream::capacity() const
+{
+  return std::size_t(header(_segment).capacity);
+}
+
+SharedMemoryInputStream::SharedMemoryInputStream(std::string name)
+  :_name(std::move(name)),
+   _segment(nullptr),
+   _segmentSize(0),
+   _inode(0)
+{
+  const int fd = shm_open(_name.c_str(), O_RDWR, 0);
+  if (fd < 0) { throwError("Failed to open shared memory", _name); }
+
+  struct stat st = {};
+  if (fstat(fd, &st) != 0)
+  {
+    const int statErrno = errno;
+    close(fd);
+    errno = statErrno;
+    throwError("Failed to stat shared memory", _name);
+  }
+
+  _segmentSize = std::size_t(st.st_size);
+  _inode = std::uint64_t(st.st_ino);
+  if (_segmentSize <= sizeof(SegmentHeader))
+  {
+    close(fd);
+    throw std::runtime_error("Shared memory is not a binlog stream: " + _name);
+  }
+
+  _segment = mapSegment(fd, _segmentSize, _name);
+
+  const SegmentHeader& h = header(_segment);
+  if (h.magic.load(std::memory_order_acquire) != segmentMagic
+   || h.capacity != _segmentSize - sizeof(SegmentHeader))
+  {
+    munmap(_segment, _segmentSize);
+    throw std::runtime_error("Shared memory is not a binlog stream: " + _name);
+  }
+}
+
+SharedMemoryInputStream::~SharedMemoryInputStream()
+{
+  munmap(_segment, _segmentSize);
+}
+
+bool SharedMemoryInputStream::writerClosed() const
+{
+  const SegmentHeader& h = header(_segment);
+  if (h.writerClosed.load(std::memory_order_acquire) != 0) { return true; }
+
+  // the writer process crashed, or exited without destroying the writer
+  return kill(pid_t(h.writerPid), 0) != 0 && errno == ESRCH;
+}
+
+void SharedMemoryInputStream::unlink()
+{
+  const int fd = shm_open(_name.c_str(), O_RDONLY, 0);
+  if (fd < 0) { return; } // already removed
+
+  struct stat st = {};
+  const bool same = fstat(fd, &st) == 0 && std::uint64_t(st.st_ino) == _inode;
+  close(fd);
+
+  if (same) { shm_unlink(_name.c_str()); }
+}
+
+void SharedMemoryInputStream::beginRead(ConstBuffer& first, ConstBuffer& second)
+{
+  const SegmentHeader& h = header(_segment);
+  const char* const buf = buffer(_segment);
+  const std::uint64_t cap = h.capacity;
+
+  const std::uint64_t readPos = h.readPos.load(std::memory_order_relaxed);
+  const std::uint64_t writePos = h.writePos.load(std::memory_order_acquire);
+  const std::size_t size = std::size_t(writePos - readPos);
+
+  const std::size_t index = std::size_t(readPos % cap);
+  const std::size_t size1 = (std::min)(size, std::size_t(cap) - index);
+  first = ConstBuffer{buf + index, size1};
+  second = ConstBuffer{buf, size - size1};
+}
+
+void SharedMemoryInputStream::endRead(std::size_t size)
+{
+  SegmentHeader& h = header(_segment);
+  const std::uint64_t readPos = h.readPos.load(std::memory_order_relaxed);
+  h.readPos.store(readPos + size, std::memory_order_release);
+}
+
+} // namespace binlog
+
+#endif // _WIN32
@@ -0,0 +1,216 @@
+#include <binlog/TcpSink.hpp>
+
+#ifndef _WIN32 // assume POSIX
+
+#include <binlog/Session.hpp>
+#include <binlog/detail/VectorOutputStream.hpp>
+
+#ifdef BINLOG_HAS_ZLIB
+  #include <binlog/CompressedStream.hpp>
+  #include <sstream>
+#endif
+
+#include <cerrno>
+#include <cstring> // memcpy
+#include <stdexcept>
+#include <utility> // move
+
+#include <netdb.h> // NOLINT getaddrinfo
+#include <netinet/in.h> // NOLINT IPPROTO_TCP
+#include <netinet/tcp.h> // NOLINT TCP_NODELAY
+#include <sys/socket.h> // NOLINT socket, connect, send
+#include <unistd.h> // NOLINT close, gethostname, getpid
+
+namespace binlog {
+
+namespace {
+
+#ifdef MSG_NOSIGNAL
+  constexpr int sendFlags = MSG_NOSIGNAL; // report a closed connection as an error, not by SIGPIPE
+#else
+  constexpr int sendFlags = 0;
+#endif
+
+#ifdef SOCK_CLOEXEC
+  constexpr int socketFlags = SOCK_CLOEXEC;
+#else
+  constexpr int socketFlags = 0;
+#endif
+
+std::string defaultName()
+{
+  char hostname[256] = {};
+  if (gethostname(hostname, sizeof(hostname) - 1) != 0) { hostname[0] = '\0'; }
+  return std::string(hostname) + "." + std::to_string(getpid());
+}
+
+void appendU32(std::vector<char>& out, std::uint32_t value)
+{
+  const char* bytes = reinterpret_cast<const char*>(&value);
+  out.insert(out.end(), bytes, bytes + sizeof(value));
+}
+
+} // namespace
+
+TcpSink::TcpSink(Session& session, std::string host, std::uint16_t port, Options options)
+  :_session(session),
+   _host(std::move(host)),
+   _port(port),
+   _options(std::move(options))
+{
+#ifndef BINLOG_HAS_ZLIB
+  if (_options.compress)
+  {
+    throw std::runtime_error("Compression is not supported, binlog is built without zlib");
+  }
+#endif
+
+  if (_options.name.empty()) { _options.name = defaultName(); }
+}
+
+TcpSink::TcpSink(Session& session, std::string host, std::uint16_t port)
+  :TcpSink(session, std::move(host), port, Options{})
+{}
+
+TcpSink::~TcpSink()
+{
+  disconnect();
+}
+
+TcpSink& TcpSink::write(const char* data, std::streamsize size)
+{
+  _batch.insert(_batch.end(), data, data + size);
+  return *this;
+}
+
+void TcpSink::flush()
+{
+  if (! _batch.empty())
+  {
+    addBatch(_batch.data(), _batch.size(), false);
+    _batch.clear();
+  }
+
+  if (_fd < 0 && ! connect())
+  {
+    if (_pending.size() > _options.maxBufferSize)
+    {
+      _droppedBytes += _pending.size();
+      _pending.clear();
+    }
+    return;
+  }
+
+  if (_pending.empty()) { return; }
+
+  if (sendAll(_pending.data(), _pending.size()))
+  {
+    _pending.clear();
+  }
+  else
+  {
+    disconnect(); // keep the batches, to resend them after reconnecting
+  }
+}
+
+bool TcpSink::connect()
+{
+  const auto now = std::chrono::steady_clock::now();
+  if (_connectionCount != 0 && now < _nextConnect) { return false; }
+  _nextConnect = now + _options.reconnectInterval;
+
+  addrinfo hints = {};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* addresses = nullptr;
+  if (getaddrinfo(_host.data(), std::to_string(_port).data(), &hints, &addresses) != 0) { return false; }
+
+  for (const addrinfo* address = addresses; address != nullptr && _fd < 0; address = address->ai_next)
+  {
+    _fd = socket(address->ai_family, address->ai_socktype | socketFlags, address->ai_protocol);
+    if (_fd < 0) { continue; }
+    if (::connect(_fd, address->ai_addr, address->ai_addrlen) != 0)
+    {
+      close(_fd);
+      _fd = -1;
+    }
+  }
+  freeaddrinfo(addresses);
+  if (_fd < 0) { return false; }
+
+  const int noDelay = 1;
+  setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+  ++_connectionCount;
+
+  // hello
+  std::vector<char> hello;
+  appendU32(hello, tcpSinkMagic);
+  appendU32(hello, tcpSinkVersion);
+  appendU32(hello, std::uint32_t(_options.name.size()));
+  hello.insert(hello.end(), _options.name.begin(), _options.name.end());
+  if (! sendAll(hello.data(), hello.size()))
+  {
+    disconnect();
+    return false;
+  }
+
+  // the stream of the new connection starts with the metadata
+  detail::VectorOutputStream metadata;
+  _session.reconsumeMetadata(metadata);
+  if (! metadata.vector.empty())
+  {
+    addBatch(metadata.data(), metadata.vector.size(), true);
+  }
+
+  return true;
+}
+
+void TcpSink::disconnect()
+{
+  if (_fd >= 0)
+  {
+    close(_fd);
+    _fd = -1;
+  }
+}
+
+void TcpSink::addBatch(const char* data, std::size_t size, bool front)
+{
+  std::vector<char> compressed;
+#ifdef BINLOG_HAS_ZLIB
+  if (_options.compress)
+  {
+    std::ostringstream frame;
+    {
+      CompressedOutputStream output(frame, 1, _options.compressionDictionary);
+      output.write(data, std::streamsize(size));
+    }
+    const std::string str = frame.str();
+    compressed.assign(str.begin(), str.end());
+    data = compressed.data();
+    size = compressed.size();
+  }
+#endif
+
+  _pending.insert((front) ? _pending.begin() : _pending.end(), data, data + size);
+}
+
+bool TcpSink::sendAll(const char* data, std::size_t size)
+{
+  while (size != 0)
+  {
+    const ssize_t sent = send(_fd, data, size, sendFlags);
+    if (sent < 0)
+    {
+      if (errno == EINTR) { continue; }
+      return false;
+    }
+    data += sent;
+    size -= std::size_t(sent);
+  }
+  return true;
+}
+
+} // namespace binlog
+
+#endif // _WIN32
@@ -3,6 +3,7 @@
 #include <binlog/Entries.hpp> // Event
 #include <binlog/EntryStream.hpp> // RangeEntryStream
 #include <binlog/Range.hpp>
+#include <binlog/detail/OstreamBuffer.hpp>
 
 #include <utility> // move
 
@@ -18,9 +19,12 @@ TextOutputStream& TextOutputStream::write(const char* data, std::streamsize size
   const Range range{data, data + size};
   RangeEntryStream entryStream(range);
 
+  // write the text of the events in large chunks, not one by one.
+  // If an entry is invalid, the events before it are still written.
+  detail::OstreamBuffer out(_out);
   while (const Event* event = _eventStream.nextEvent(entryStream))
   {
-    _printer.printEvent(_out, *event, _eventStream.writerProp(), _eventStream.clockSync());
+    _printer.printEvent(out, *event, _eventStream.writerProp(), _eventStream.clockSync());
   }
 
   return *this;
@@ -1,5 +1,7 @@
 #include <binlog/Time.hpp>
 
+#include <limits>
+
 namespace binlog {
 
 std::chrono::nanoseconds ticksToNanoseconds(std::uint64_t frequency, std::int64_t ticks)
@@ -26,6 +28,70 @@ std::chrono::nanoseconds clockToNsSinceEpoch(const ClockSync& clockSync, std::ui
   return sinceEpoch;
 }
 
+ClockConverter::ClockConverter(const ClockSync& clockSync)
+  :_clockValue(clockSync.clockValue),
+   _frequency(clockSync.clockFrequency),
+   _nsSinceEpoch(std::int64_t(clockSync.nsSinceEpoch))
+{
+  const std::uint64_t d = _frequency;
+  if (d == 0) { return; }
+
+  if (d == std::uint64_t(std::nano::den))
+  {
+    _mode = Mode::nanoseconds;
+    return;
+  }
+
+  // r * 10^9 must fit int64_t, for r < d, as in ticksToNanoseconds
+  _mode = Mode::division;
+  if (d > std::uint64_t(std::numeric_limits<std::int64_t>::max() / std::nano::den)) { return; }
+
+#ifdef __SIZEOF_INT128__
+  _mode = Mode::reciprocal;
+
+  unsigned log2d = 0;
+  while ((d >> log2d) > 1) { ++log2d; }
+  _shift = log2d;
+
+  if ((d & (d - 1)) == 0) { return; } // power of two: shift only
+
+  // m = 2^(64+log2d) / d, the remainder decides if 64 bits of m are precise enough
+  __extension__ typedef unsigned __int128 uint128; // NOLINT(modernize-use-using)
+  const uint128 numerator = uint128(1) << (64 + log2d);
+  std::uint64_t m = std::uint64_t(numerator / d);
+  const std::uint64_t rem = std::uint64_t(numerator % d);
+
+  if (d - rem >= (std::uint64_t(1) << log2d))
+  {
+    // use a 65 bit multiplier, the 65th bit is added by divide
+    m += m;
+    const std::uint64_t twiceRem = rem + rem;
+    if (twiceRem >= d || twiceRem < rem) { m += 1; }
+    _add = true;
+  }
+
+  _magic = m + 1;
+#endif
+}
+
+void ClockConverter::toNsSinceEpoch(const std::uint64_t* clockValues, std::size_t count, std::int64_t* result) const
+{
+  if (_mode == Mode::nanoseconds)
+  {
+    const std::uint64_t offset = std::uint64_t(_nsSinceEpoch) - _clockValue;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      result[i] = std::int64_t(clockValues[i] + offset);
+    }
+    return;
+  }
+
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    result[i] = toNsSinceEpoch(clockValues[i]).count();
+  }
+}
+
 void nsSinceEpochToBrokenDownTimeUTC(std::chrono::nanoseconds sinceEpoch, BrokenDownTime& dst)
 {
   using clock = std::chrono::system_clock;
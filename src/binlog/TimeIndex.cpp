@@ -0,0 +1,338 @@
+#include <binlog/TimeIndex.hpp>
+
+#include <binlog/Entries.hpp>
+#include <binlog/detail/CompactEvents.hpp>
+#include <binlog/detail/EventSourceTable.hpp>
+#include <binlog/detail/IndexedValues.hpp>
+
+#include <mserialize/deserialize.hpp>
+
+#include <algorithm> // min, max
+#include <cstring> // memcpy
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <utility>
+
+namespace binlog {
+
+namespace {
+
+constexpr std::size_t filterRecordBits = 4 * 64;
+constexpr std::uint64_t filterHashCount = 4;
+
+/** Call `f(bit)` for each bit of a filter of `bitCount` bits, set by `value` */
+template <typename F>
+void forEachFilterBit(const char* value, std::size_t size, std::size_t bitCount, F f)
+{
+  // FNV-1a, split to two hashes for double hashing
+  std::uint64_t hash = 14695981039346656037ULL;
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    hash ^= static_cast<unsigned char>(value[i]);
+    hash *= 1099511628211ULL;
+  }
+
+  const std::uint64_t h1 = hash & 0xFFFFFFFF;
+  const std::uint64_t h2 = (hash >> 32) | 1;
+  for (std::uint64_t i = 0; i < filterHashCount; ++i)
+  {
+    f(std::size_t((h1 + i * h2) % bitCount));
+  }
+}
+
+} // namespace
+
+constexpr std::uint64_t TimeIndex::magicRecord;
+constexpr std::uint64_t TimeIndex::blockRecord;
+constexpr std::uint64_t TimeIndex::metadataRecord;
+constexpr std::uint64_t TimeIndex::filterRecord;
+constexpr std::uint64_t TimeIndex::version;
+
+TimeIndex TimeIndex::read(std::istream& input)
+{
+  TimeIndex result;
+
+  std::uint64_t record[5];
+  bool first = true;
+  std::vector<std::uint64_t> filter; // of the next block
+  while (input.read(reinterpret_cast<char*>(record), sizeof(record)))
+  {
+    if (first)
+    {
+      if (record[0] != magicRecord || record[1] != version)
+      {
+        throw std::runtime_error("Input is not a time index of a supported version");
+      }
+      first = false;
+      continue;
+    }
+
+    switch (record[0])
+    {
+    case blockRecord:
+      result.blocks.push_back(Block{record[1], record[2], record[3], record[4]});
+      result.filters.push_back(std::move(filter));
+      filter.clear();
+      break;
+    case metadataRecord:
+      result.metadata.push_back(Metadata{record[1], record[2], record[3]});
+      break;
+    case filterRecord:
+      filter.insert(filter.end(), record + 1, record + 5);
+      break;
+    // default: ignore unknown records to be forward compatible
+    }
+  }
+
+  if (first)
+  {
+    throw std::runtime_error("Time index is empty");
+  }
+
+  return result;
+}
+
+bool TimeIndex::blockMayContain(std::size_t block, const std::string& value) const
+{
+  const std::vector<std::uint64_t>& filter = filters[block];
+  if (filter.empty()) { return true; }
+
+  bool result = true;
+  forEachFilterBit(value.data(), value.size(), filter.size() * 64, [&](std::size_t bit)
+  {
+    result = result && (filter[bit / 64] & (std::uint64_t(1) << (bit % 64))) != 0;
+  });
+  return result;
+}
+
+bool TimeIndex::hasFilters() const
+{
+  return std::any_of(filters.begin(), filters.end(),
+    [](const std::vector<std::uint64_t>& filter) { return ! filter.empty(); }
+  );
+}
+
+IndexedOutputStream::IndexedOutputStream(std::ostream& output, std::ostream& index, std::size_t blockSize, std::size_t filterBits)
+  :_output(output),
+   _index(index),
+   _blockSize(blockSize),
+   _filter((filterBits + filterRecordBits - 1) / filterRecordBits * 4)
+{
+  writeRecord(TimeIndex::magicRecord, TimeIndex::version, 0, 0, 0);
+}
+
+IndexedOutputStream::~IndexedOutputStream()
+{
+  // an incomplete entry is not part of the last block
+  const std::uint64_t end = (_headerSize == 0) ? _offset : _entryOffset;
+  if (end != _blockOffset) { closeBlock(end); }
+  _index.flush();
+}
+
+IndexedOutputStream& IndexedOutputStream::write(const char* data, std::streamsize ssize)
+{
+  _output.write(data, ssize);
+
+  std::size_t size = std::size_t(ssize);
+  while (size != 0)
+  {
+    if (_headerTarget == 0 || _headerSize != _headerTarget)
+    {
+      // read the header of the entry
+      if (_headerSize == 0) { _entryOffset = _offset; }
+
+      const std::size_t target = (_headerTarget == 0) ? sizeof(std::uint32_t) : _headerTarget;
+      const std::size_t count = (std::min)(target - _headerSize, size);
+      memcpy(_header + _headerSize, data, count);
+      _headerSize += count;
+      data += count;
+      size -= count;
+      _offset += count;
+
+      if (_headerTarget == 0 && _headerSize == sizeof(std::uint32_t))
+      {
+        std::uint32_t entrySize;
+        memcpy(&entrySize, _header, sizeof(entrySize));
+        const std::size_t headerPayload = (std::min)(std::size_t(entrySize), sizeof(_header) - sizeof(entrySize));
+        _headerTarget = sizeof(entrySize) + headerPayload;
+        _remaining = entrySize - headerPayload;
+      }
+
+      if (_headerTarget != 0 && _headerSize == _headerTarget)
+      {
+        entryHeader();
+        if (_remaining == 0) { entryEnd(); }
+      }
+    }
+    else
+    {
+      // skip the rest of the entry
+      const std::size_t count = std::size_t((std::min)(_remaining, std::uint64_t(size)));
+      if (_copyEntry) { _entry.insert(_entry.end(), data, data + count); }
+      data += count;
+      size -= count;
+      _offset += count;
+      _remaining -= count;
+
+      if (_remaining == 0) { entryEnd(); }
+    }
+  }
+
+  return *this;
+}
+
+void IndexedOutputStream::entryHeader()
+{
+  std::uint32_t entrySize;
+  memcpy(&entrySize, _header, sizeof(entrySize));
+
+  std::uint64_t tag;
+  if (entrySize < sizeof(tag)) { return; } // not a valid entry
+
+  memcpy(&tag, _header + sizeof(entrySize), sizeof(tag));
+  const bool special = (tag & (std::uint64_t(1) << 63)) != 0;
+  // the clocks of compact events are read from the complete entry
+  _copyEntry = tag == CompactEvents::Tag
+    || (! _filter.empty() && (! special || tag == EventSource::Tag || tag == EventSourceTable::Tag));
+  if (_copyEntry)
+  {
+    _entry.assign(_header + sizeof(entrySize), _header + _headerTarget);
+  }
+
+  if (special)
+  {
+    if (tag == EventSource::Tag || tag == EventSourceTable::Tag || tag == WriterProp::Tag
+     || tag == ClockSync::Tag || tag == InternedString::Tag)
+    {
+      writeRecord(TimeIndex::metadataRecord, _entryOffset, sizeof(entrySize) + entrySize, tag, 0);
+    }
+  }
+  else if (entrySize >= sizeof(tag) + sizeof(std::uint64_t))
+  {
+    std::uint64_t clockValue;
+    memcpy(&clockValue, _header + sizeof(entrySize) + sizeof(tag), sizeof(clockValue));
+    _minClock = (std::min)(_minClock, clockValue);
+    _maxClock = (std::max)(_maxClock, clockValue);
+  }
+}
+
+void IndexedOutputStream::entryEnd()
+{
+  _headerSize = 0;
+  _headerTarget = 0;
+
+  if (_copyEntry)
+  {
+    readEntry();
+    _copyEntry = false;
+  }
+
+  if (_offset - _blockOffset >= _blockSize) { closeBlock(_offset); }
+}
+
+void IndexedOutputStream::readEntry()
+{
+  Range entry(_entry.data(), _entry.size());
+  const std::uint64_t tag = entry.read<std::uint64_t>(); // entryHeader checked the size
+  try
+  {
+    if (tag == EventSource::Tag)
+    {
+      EventSource source;
+      mserialize::deserialize(source, entry);
+      _argumentTags[source.id] = std::move(source.argumentTags);
+    }
+    else if (tag == EventSourceTable::Tag)
+    {
+      detail::readEventSourceTable(entry, [this](EventSource&& source)
+      {
+        _argumentTags[source.id] = std::move(source.argumentTags);
+      });
+    }
+    else if (tag == CompactEvents::Tag)
+    {
+      const std::uint8_t version = entry.read<std::uint8_t>();
+      if (! detail::isSupportedCompactVersion(version))
+      {
+        throw std::runtime_error("Unsupported CompactEvents version");
+      }
+
+      detail::CompactDecoder decoder(version);
+      while (! entry.empty())
+      {
+        const detail::CompactEvent event = detail::nextCompactEvent(entry, decoder);
+        _minClock = (std::min)(_minClock, event.clockValue);
+        _maxClock = (std::max)(_maxClock, event.clockValue);
+        if (! _filter.empty()) { filterEvent(event.sourceId, event.arguments); }
+      }
+    }
+    else
+    {
+      entry.read<std::uint64_t>(); // clock
+      filterEvent(tag, entry);
+    }
+  }
+  catch (const std::exception&)
+  {
+    // invalid entry, the block can not be ruled out
+    _filterValid = false;
+    if (tag == CompactEvents::Tag)
+    {
+      _minClock = 0;
+      _maxClock = std::uint64_t(-1);
+    }
+  }
+}
+
+void IndexedOutputStream::filterEvent(std::uint64_t sourceId, Range arguments)
+{
+  auto tags = _argumentTags.find(sourceId);
+  if (tags == _argumentTags.end())
+  {
+    _filterValid = false;
+    return;
+  }
+
+  const std::size_t bitCount = _filter.size() * 64;
+  detail::forEachIndexedValue(
+    mserialize::string_view(tags->second.data(), tags->second.size()), arguments,
+    [this, bitCount](const char* value, std::size_t size)
+    {
+      forEachFilterBit(value, size, bitCount, [this](std::size_t bit)
+      {
+        _filter[bit / 64] |= std::uint64_t(1) << (bit % 64);
+      });
+    }
+  );
+}
+
+void IndexedOutputStream::closeBlock(std::uint64_t end)
+{
+  if (! _filter.empty())
+  {
+    if (_filterValid)
+    {
+      for (std::size_t i = 0; i < _filter.size(); i += 4)
+      {
+        writeRecord(TimeIndex::filterRecord, _filter[i], _filter[i+1], _filter[i+2], _filter[i+3]);
+      }
+    }
+    std::fill(_filter.begin(), _filter.end(), std::uint64_t(0));
+    _filterValid = true;
+  }
+
+  writeRecord(TimeIndex::blockRecord, _blockOffset, end - _blockOffset, _minClock, _maxClock);
+
+  _blockOffset = end;
+  _minClock = std::uint64_t(-1);
+  _maxClock = 0;
+}
+
+void IndexedOutputStream::writeRecord(std::uint64_t kind, std::uint64_t offset, std::uint64_t size, std::uint64_t a, std::uint64_t b)
+{
+  const std::uint64_t record[5] = {kind, offset, size, a, b};
+  _index.write(reinterpret_cast<const char*>(record), sizeof(record));
+}
+
+} // namespace binlog
@@ -4,12 +4,67 @@
 
 #include <mserialize/detail/tag_util.hpp> // remove_prefix_before
 
+#include <cstdint>
+#include <cstring>
+
 namespace binlog {
 
-ToStringVisitor::ToStringVisitor(detail::OstreamBuffer& out, const PrettyPrinter* pp)
+namespace {
+
+/**
+ * Print a sequence of `size` arithmetic elements of type T,
+ * read at once from `input`, each converted to `Printed`,
+ * in a single loop, the same way element-by-element visitation would.
+ *
+ * @returns false if the sequence is empty or `input` does not hold the elements (and prints nothing):
+ *          the elements are visited one by one, that reports the error, if any.
+ */
+template <typename T, typename Printed = T>
+bool printArithmeticSequence(detail::OstreamBuffer& out, std::size_t size, Range& input)
+{
+  if (size == 0 || input.size() / sizeof(T) < size) { return false; }
+  const char* p = input.view(size * sizeof(T));
+
+  out.put('[');
+  for (std::size_t i = 0; i < size; ++i, p += sizeof(T))
+  {
+    if (i != 0) { out.write(", ", 2); }
+    T v;
+    memcpy(&v, p, sizeof(T));
+    out << Printed(v);
+  }
+  out.put(']');
+  return true;
+}
+
+/** @returns printArithmeticSequence<T> of the arithmetic type T specified by `tag`, or false */
+bool printArithmeticSequence(char tag, std::size_t size, detail::OstreamBuffer& out, Range& input)
+{
+  switch (tag)
+  {
+  case 'y': return printArithmeticSequence<bool>(out, size, input);
+  case 'b': return printArithmeticSequence<std::int8_t, int>(out, size, input);
+  case 's': return printArithmeticSequence<std::int16_t>(out, size, input);
+  case 'i': return printArithmeticSequence<std::int32_t>(out, size, input);
+  case 'l': return printArithmeticSequence<std::int64_t>(out, size, input);
+  case 'B': return printArithmeticSequence<std::uint8_t, unsigned>(out, size, input);
+  case 'S': return printArithmeticSequence<std::uint16_t>(out, size, input);
+  case 'I': return printArithmeticSequence<std::uint32_t>(out, size, input);
+  case 'L': return printArithmeticSequence<std::uint64_t>(out, size, input);
+  case 'f': return printArithmeticSequence<float>(out, size, input);
+  case 'd': return printArithmeticSequence<double>(out, size, input);
+  case 'D': return printArithmeticSequence<long double>(out, size, input);
+  default: return false; // packed integers (q, Q) have variable size
+  }
+}
+
+} // namespace
+
+ToStringVisitor::ToStringVisitor(detail::OstreamBuffer& out, const PrettyPrinter* pp, bool hexBytes)
   :_state(State::Normal),
    _seqDepth(0),
    _emptyStruct(false),
+   _hexBytes(hexBytes),
    _out(out),
    _pp(pp)
 {}
@@ -37,6 +92,19 @@ bool ToStringVisitor::visit(mserialize::Visitor::SequenceBegin sb, Range& input)
     return true;
   }
 
+  if (_hexBytes && sb.tag.size() == 1 && sb.tag[0] == 'B' && sb.size != 0 && input.size() >= sb.size)
+  {
+    _out.write("0x", 2);
+    _out.writeHex(input.view(sb.size), sb.size);
+    return true;
+  }
+
+  if (sb.tag.size() == 1 && printArithmeticSequence(sb.tag[0], sb.size, _out, input))
+  {
+    // skip element-by-element visitation of fixed size arithmetic types
+    return true;
+  }
+
   _out.put('[');
   enterSeq();
 
@@ -72,6 +140,11 @@ void ToStringVisitor::visit(mserialize::Visitor::Null)
 void ToStringVisitor::visit(mserialize::Visitor::Enum e)
 {
   comma();
+  if (_pp != nullptr && _pp->printEnum(_out, e))
+  {
+    return;
+  }
+
   if (e.enumerator.empty())
   {
     _out << "0x" << e.value;
@@ -0,0 +1,79 @@
+#include <binlog/detail/Crc32c.hpp>
+
+#include <array>
+#include <cstring> // memcpy
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+  #define BINLOG_CRC32C_SSE42
+  #include <nmmintrin.h>
+#endif
+
+namespace binlog {
+namespace detail {
+
+namespace {
+
+std::array<std::uint32_t, 256> makeCrc32cTable()
+{
+  std::array<std::uint32_t, 256> table{};
+  for (std::uint32_t i = 0; i < 256; ++i)
+  {
+    std::uint32_t crc = i;
+    for (int bit = 0; bit < 8; ++bit)
+    {
+      crc = (crc & 1) ? (crc >> 1) ^ 0x82F63B78 : crc >> 1; // reversed Castagnoli polynomial
+    }
+    table[i] = crc;
+  }
+  return table;
+}
+
+std::uint32_t crc32cTable(const char* data, std::size_t size, std::uint32_t crc)
+{
+  static const std::array<std::uint32_t, 256> table = makeCrc32cTable();
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    crc = table[(crc ^ std::uint8_t(data[i])) & 0xFF] ^ (crc >> 8);
+  }
+  return crc;
+}
+
+#ifdef BINLOG_CRC32C_SSE42
+
+__attribute__((target("sse4.2")))
+std::uint32_t crc32cSse42(const char* data, std::size_t size, std::uint32_t crc)
+{
+  std::uint64_t crc64 = crc;
+  for (; size >= sizeof(std::uint64_t); size -= sizeof(std::uint64_t), data += sizeof(std::uint64_t))
+  {
+    std::uint64_t word;
+    memcpy(&word, data, sizeof(word));
+    crc64 = _mm_crc32_u64(crc64, word);
+  }
+
+  std::uint32_t crc32 = std::uint32_t(crc64);
+  for (; size != 0; --size, ++data)
+  {
+    crc32 = _mm_crc32_u8(crc32, std::uint8_t(*data));
+  }
+  return crc32;
+}
+
+#endif // BINLOG_CRC32C_SSE42
+
+} // namespace
+
+std::uint32_t crc32c(const char* data, std::size_t size, std::uint32_t crc)
+{
+  crc = ~crc;
+
+#ifdef BINLOG_CRC32C_SSE42
+  static const bool hasSse42 = __builtin_cpu_supports("sse4.2");
+  if (hasSse42) { return ~crc32cSse42(data, size, crc); }
+#endif
+
+  return ~crc32cTable(data, size, crc);
+}
+
+} // namespace detail
+} // namespace binlog
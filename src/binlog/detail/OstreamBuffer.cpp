@@ -1,9 +1,456 @@
 #include <binlog/detail/OstreamBuffer.hpp>
 
+#include <algorithm>
+#include <array>
 #include <cassert>
-#include <cinttypes>
+#include <cstdint>
 #include <cstdio>
 #include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+  #define BINLOG_HEX_SSE2
+  #include <emmintrin.h>
+#endif
+
+namespace {
+
+constexpr char digitPairs[] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
+// write the decimal digits of `v` backwards, ending at `end`
+// @returns the first written char
+template <typename UInt>
+char* writeDecimal(UInt v, char* end)
+{
+  while (v >= 100)
+  {
+    const std::size_t pair = std::size_t(v % 100) * 2;
+    v /= 100;
+    *--end = digitPairs[pair + 1];
+    *--end = digitPairs[pair];
+  }
+  if (v >= 10)
+  {
+    const std::size_t pair = std::size_t(v) * 2;
+    *--end = digitPairs[pair + 1];
+    *--end = digitPairs[pair];
+  }
+  else
+  {
+    *--end = char('0' + v);
+  }
+  return end;
+}
+
+// @returns the number of decimal digits of `v`
+int decimalDigits(std::uint64_t v)
+{
+  int n = 1;
+  for (;;)
+  {
+    if (v < 10) { return n; }
+    if (v < 100) { return n + 1; }
+    if (v < 1000) { return n + 2; }
+    if (v < 10000) { return n + 3; }
+    v /= 10000;
+    n += 4;
+  }
+}
+
+// write the decimal digits of `v` to `p`, without a temporary buffer.
+// Values that fit 32 bits (every int8..int32) use the cheaper 32 bit division.
+// @returns the end of the written digits
+char* writeDecimalAt(std::uint64_t v, char* p)
+{
+  char* const end = p + decimalDigits(v);
+  if (v <= UINT32_MAX)
+  {
+    writeDecimal(std::uint32_t(v), end);
+  }
+  else
+  {
+    writeDecimal(v, end);
+  }
+  return end;
+}
+
+// write each byte of [data, data+size) as two hex digits to `out`
+void writeHexDigitsScalar(const char* data, std::size_t size, char* out)
+{
+  constexpr char hexDigits[] = "0123456789abcdef";
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    const unsigned byte = std::uint8_t(data[i]);
+    *out++ = hexDigits[byte >> 4];
+    *out++ = hexDigits[byte & 0xF];
+  }
+}
+
+#ifdef BINLOG_HEX_SSE2
+
+// SSE2 is part of x86_64: convert 16 bytes to 32 hex digits at once
+void writeHexDigits(const char* data, std::size_t size, char* out)
+{
+  const __m128i lowMask = _mm_set1_epi8(0x0F);
+  const __m128i nine = _mm_set1_epi8(9);
+  const __m128i zero = _mm_set1_epi8('0');
+  const __m128i letterOffset = _mm_set1_epi8('a' - '0' - 10);
+
+  for (; size >= 16; size -= 16, data += 16, out += 32)
+  {
+    const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    const __m128i hi = _mm_and_si128(_mm_srli_epi16(bytes, 4), lowMask);
+    const __m128i lo = _mm_and_si128(bytes, lowMask);
+
+    // interleave: hi0 lo0 hi1 lo1 ...
+    const __m128i nibbles[2] = {_mm_unpacklo_epi8(hi, lo), _mm_unpackhi_epi8(hi, lo)};
+    for (int i = 0; i < 2; ++i)
+    {
+      const __m128i isLetter = _mm_cmpgt_epi8(nibbles[i], nine);
+      const __m128i digits = _mm_add_epi8(_mm_add_epi8(nibbles[i], zero), _mm_and_si128(isLetter, letterOffset));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16 * i), digits);
+    }
+  }
+
+  writeHexDigitsScalar(data, size, out);
+}
+
+#else
+
+void writeHexDigits(const char* data, std::size_t size, char* out)
+{
+  writeHexDigitsScalar(data, size, out);
+}
+
+#endif // BINLOG_HEX_SSE2
+
+// Shortest roundtrip conversion of binary floating point numbers to decimal,
+// using the Schubfach algorithm, see:
+// Raffaello Giulietti: The Schubfach way to render doubles (2020)
+
+// 128 bit approximation of 10^e, for e in [minPow10, maxPow10]:
+// g = floor(10^e / 2^r) + (exact ? 0 : 1), where 2^127 <= g < 2^128
+struct Pow10
+{
+  std::uint64_t hi;
+  std::uint64_t lo;
+  bool exact;
+};
+
+constexpr int minPow10 = -292;
+constexpr int maxPow10 = 324;
+
+// little endian 32 bit limbs
+using BigInt = std::vector<std::uint32_t>;
+
+void bigMul(BigInt& n, std::uint32_t m)
+{
+  std::uint64_t carry = 0;
+  for (std::uint32_t& limb : n)
+  {
+    const std::uint64_t t = std::uint64_t(limb) * m + carry;
+    limb = std::uint32_t(t);
+    carry = t >> 32;
+  }
+  if (carry != 0) { n.push_back(std::uint32_t(carry)); }
+}
+
+void bigDiv(BigInt& n, std::uint32_t d)
+{
+  std::uint64_t rem = 0;
+  for (std::size_t i = n.size(); i-- != 0;)
+  {
+    const std::uint64_t t = (rem << 32) | n[i];
+    n[i] = std::uint32_t(t / d);
+    rem = t % d;
+  }
+  while (! n.empty() && n.back() == 0) { n.pop_back(); }
+}
+
+int bigBitLength(const BigInt& n)
+{
+  int result = int(n.size() - 1) * 32;
+  for (std::uint32_t top = n.back(); top != 0; top >>= 1) { ++result; }
+  return result;
+}
+
+// @returns bit i of n, 0 if i < 0
+std::uint64_t bigBit(const BigInt& n, int i)
+{
+  if (i < 0 || std::size_t(i / 32) >= n.size()) { return 0; }
+  return (n[std::size_t(i / 32)] >> (i % 32)) & 1u;
+}
+
+// @returns the 128 bits of n starting at bit `pos` (can be negative), as (hi, lo)
+Pow10 bigBits128(const BigInt& n, int pos)
+{
+  Pow10 result{0, 0, true};
+  for (int i = 0; i < 64; ++i)
+  {
+    result.lo |= bigBit(n, pos + i) << i;
+    result.hi |= bigBit(n, pos + 64 + i) << i;
+  }
+  for (int i = 0; i < pos; ++i)
+  {
+    if (bigBit(n, i) != 0) { result.exact = false; break; }
+  }
+  if (! result.exact)
+  {
+    ++result.lo;
+    if (result.lo == 0) { ++result.hi; }
+  }
+  return result;
+}
+
+class Pow10Table
+{
+public:
+  static const Pow10Table& instance()
+  {
+    static const Pow10Table table;
+    return table;
+  }
+
+  const Pow10& operator[](int e) const
+  {
+    assert(minPow10 <= e && e <= maxPow10);
+    return _pows[std::size_t(e - minPow10)];
+  }
+
+private:
+  Pow10Table()
+  {
+    // 10^e, e >= 0
+    BigInt n{1};
+    for (int e = 0; e <= maxPow10; ++e)
+    {
+      (*this)[e] = bigBits128(n, bigBitLength(n) - 128);
+      bigMul(n, 10);
+    }
+
+    // 2^m / 10^-e, e < 0
+    constexpr int m = 1216; // 2^m > 10^-minPow10 * 2^128
+    BigInt d(m / 32 + 1, 0);
+    d.back() = 1;
+    for (int e = -1; e >= minPow10; --e)
+    {
+      bigDiv(d, 10);
+      Pow10 p = bigBits128(d, bigBitLength(d) - 128);
+      if (p.exact) // 10^e is never exact: +1 must be added
+      {
+        p.exact = false;
+        ++p.lo;
+        if (p.lo == 0) { ++p.hi; }
+      }
+      (*this)[e] = p;
+    }
+  }
+
+  Pow10& operator[](int e) { return _pows[std::size_t(e - minPow10)]; }
+
+  std::array<Pow10, maxPow10 - minPow10 + 1> _pows{};
+};
+
+// (hi, lo) = a * b
+void mul64(std::uint64_t a, std::uint64_t b, std::uint64_t& hi, std::uint64_t& lo)
+{
+#ifdef __SIZEOF_INT128__
+  __extension__ typedef unsigned __int128 uint128; // NOLINT(modernize-use-using)
+  const uint128 p = uint128(a) * b;
+  hi = std::uint64_t(p >> 64);
+  lo = std::uint64_t(p);
+#else
+  const std::uint64_t a0 = a & 0xFFFFFFFF, a1 = a >> 32;
+  const std::uint64_t b0 = b & 0xFFFFFFFF, b1 = b >> 32;
+  const std::uint64_t p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+  const std::uint64_t mid = (p00 >> 32) + (p01 & 0xFFFFFFFF) + (p10 & 0xFFFFFFFF);
+  hi = p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+  lo = (mid << 32) | (p00 & 0xFFFFFFFF);
+#endif
+}
+
+// floor(g * cp / 2^128), rounded to odd if inexact
+std::uint64_t roundToOdd(const Pow10& g, std::uint64_t cp)
+{
+  std::uint64_t xhi = 0, xlo = 0, yhi = 0, ylo = 0;
+  mul64(g.lo, cp, xhi, xlo);
+  mul64(g.hi, cp, yhi, ylo);
+  const std::uint64_t z = ylo + xhi;
+  const std::uint64_t carry = (z < ylo) ? 1 : 0;
+  const bool inexact = g.exact ? (z != 0 || xlo != 0) : (z > 1);
+  return (yhi + carry) | (inexact ? 1 : 0);
+}
+
+std::int32_t floorDivPow2(std::int32_t x, int n)
+{
+  return (x >= 0) ? (x >> n) : ~(~x >> n);
+}
+
+// value = digits * 10^exponent
+struct Decimal
+{
+  std::uint64_t digits;
+  int exponent;
+};
+
+/**
+ * @returns the shortest decimal, closest to c*2^q among the shortest ones,
+ * that rounds to the binary floating point value given by `significand`
+ * and `biasedExponent`, nonzero and finite.
+ */
+template <int SignificandBits, int ExponentBias>
+Decimal toShortestDecimal(std::uint64_t significand, std::uint32_t biasedExponent)
+{
+  std::uint64_t c = significand;
+  std::int32_t q = 1 - ExponentBias - SignificandBits;
+  if (biasedExponent != 0)
+  {
+    c |= std::uint64_t(1) << SignificandBits;
+    q = std::int32_t(biasedExponent) - ExponentBias - SignificandBits;
+  }
+
+  const bool even = (c % 2) == 0;
+  const bool lowerCloser = (significand == 0 && biasedExponent > 1);
+
+  // the rounding interval of c, scaled by 4
+  const std::uint64_t cbl = 4 * c - 2 + (lowerCloser ? 1 : 0);
+  const std::uint64_t cb = 4 * c;
+  const std::uint64_t cbr = 4 * c + 2;
+
+  // k = floor(log10(3/4 * 2^q)) or floor(log10(2^q))
+  const std::int32_t k = lowerCloser
+    ? floorDivPow2(q * 1262611 - 524031, 22)
+    : floorDivPow2(q * 315653, 20);
+  // h = q + floor(log2(10^-k)) + 1, in [1, 4]
+  const int h = int(q + floorDivPow2(-k * 1741647, 19) + 1);
+
+  const Pow10& g = Pow10Table::instance()[-k];
+  const std::uint64_t vbl = roundToOdd(g, cbl << h);
+  const std::uint64_t vb = roundToOdd(g, cb << h);
+  const std::uint64_t vbr = roundToOdd(g, cbr << h);
+
+  const std::uint64_t lower = vbl + (even ? 0 : 1);
+  const std::uint64_t upper = vbr - (even ? 0 : 1);
+
+  const std::uint64_t s = vb / 4;
+  if (s >= 10)
+  {
+    // a single digit shorter, if one of those is in the interval
+    const std::uint64_t sp = s / 10;
+    const bool upInside = lower <= 40 * sp;
+    const bool wpInside = 40 * sp + 40 <= upper;
+    if (upInside != wpInside) { return Decimal{wpInside ? sp + 1 : sp, int(k) + 1}; }
+  }
+
+  const bool uInside = lower <= 4 * s;
+  const bool wInside = 4 * s + 4 <= upper;
+  if (uInside != wInside) { return Decimal{wInside ? s + 1 : s, int(k)}; }
+
+  // both in the interval, take the closest one, ties to even
+  const std::uint64_t mid = 4 * s + 2;
+  const bool roundUp = vb > mid || (vb == mid && (s & 1) != 0);
+  return Decimal{roundUp ? s + 1 : s, int(k)};
+}
+
+/**
+ * Write `d` to `p`, as printf("%.*g", P) would,
+ * where P is the number of digits of `d`, but at least 6.
+ *
+ * @returns the end of the written sequence, at most 26 chars
+ */
+char* writeDecimal(Decimal d, bool negative, char* p)
+{
+  while (d.digits % 10 == 0) { d.digits /= 10; ++d.exponent; }
+
+  char digitsBuf[20];
+  char* const digitsEnd = digitsBuf + sizeof(digitsBuf);
+  const char* digits = writeDecimal(d.digits, digitsEnd);
+  const int n = int(digitsEnd - digits);
+
+  // value = d1.d2d3... * 10^x
+  const int x = d.exponent + n - 1;
+  const int precision = (n > 6) ? n : 6;
+
+  if (negative) { *p++ = '-'; }
+
+  if (x < -4 || x >= precision)
+  {
+    *p++ = *digits++;
+    if (n > 1)
+    {
+      *p++ = '.';
+      memcpy(p, digits, std::size_t(n - 1));
+      p += n - 1;
+    }
+    *p++ = 'e';
+    *p++ = (x < 0) ? '-' : '+';
+    const int absX = (x < 0) ? -x : x;
+    if (absX < 10) { *p++ = '0'; }
+    char expBuf[4];
+    const char* exp = writeDecimal(std::uint64_t(absX), expBuf + 4);
+    memcpy(p, exp, std::size_t(expBuf + 4 - exp));
+    p += expBuf + 4 - exp;
+  }
+  else if (x < 0)
+  {
+    *p++ = '0';
+    *p++ = '.';
+    for (int i = -1; i > x; --i) { *p++ = '0'; }
+    memcpy(p, digits, std::size_t(n));
+    p += n;
+  }
+  else if (n <= x + 1)
+  {
+    memcpy(p, digits, std::size_t(n));
+    p += n;
+    for (int i = n; i <= x; ++i) { *p++ = '0'; }
+  }
+  else
+  {
+    memcpy(p, digits, std::size_t(x + 1));
+    p += x + 1;
+    *p++ = '.';
+    memcpy(p, digits + x + 1, std::size_t(n - x - 1));
+    p += n - x - 1;
+  }
+
+  return p;
+}
+
+// inf, nan, and zero are written as printf("%g") would
+template <int SignificandBits, int ExponentBias>
+char* writeShortest(std::uint64_t significand, std::uint32_t biasedExponent, bool negative, char* p)
+{
+  constexpr std::uint32_t maxExponent = 2 * ExponentBias + 1;
+  if (biasedExponent == maxExponent)
+  {
+    if (negative) { *p++ = '-'; }
+    memcpy(p, (significand == 0) ? "inf" : "nan", 3);
+    return p + 3;
+  }
+
+  if (biasedExponent == 0 && significand == 0)
+  {
+    if (negative) { *p++ = '-'; }
+    *p++ = '0';
+    return p;
+  }
+
+  const Decimal d = toShortestDecimal<SignificandBits, ExponentBias>(significand, biasedExponent);
+  return writeDecimal(d, negative, p);
+}
+
+} // namespace
 
 namespace binlog {
 namespace detail {
@@ -44,10 +491,25 @@ OstreamBuffer& OstreamBuffer::operator<<(bool b)
            return *this << "false";
 }
 
+OstreamBuffer& OstreamBuffer::operator<<(float v)
+{
+  static_assert(sizeof(float) == 4, "float must be IEEE 754 binary32");
+  std::uint32_t bits = 0;
+  memcpy(&bits, &v, sizeof(bits));
+
+  reserve(32);
+  _p = writeShortest<23, 127>(bits & 0x7FFFFF, (bits >> 23) & 0xFF, (bits >> 31) != 0, _p);
+  return *this;
+}
+
 OstreamBuffer& OstreamBuffer::operator<<(double v)
 {
-  reserve(64);
-  _p += snprintf(_p, 64, "%g", v);
+  static_assert(sizeof(double) == 8, "double must be IEEE 754 binary64");
+  std::uint64_t bits = 0;
+  memcpy(&bits, &v, sizeof(bits));
+
+  reserve(32);
+  _p = writeShortest<52, 1023>(bits & 0xFFFFFFFFFFFFF, std::uint32_t(bits >> 52) & 0x7FF, (bits >> 63) != 0, _p);
   return *this;
 }
 
@@ -60,16 +522,63 @@ OstreamBuffer& OstreamBuffer::operator<<(long double v)
 
 void OstreamBuffer::writeSigned(std::int64_t v)
 {
-  // TODO(benedek) perf: use a faster than printf int-to-string solution
-  reserve(32);
-  _p += snprintf(_p, 32, "%" PRId64, v);
+  reserve(20); // "-9223372036854775808"
+  if (v < 0)
+  {
+    *_p++ = '-';
+    _p = writeDecimalAt(std::uint64_t(0) - std::uint64_t(v), _p);
+  }
+  else
+  {
+    _p = writeDecimalAt(std::uint64_t(v), _p);
+  }
 }
 
 void OstreamBuffer::writeUnsigned(std::uint64_t v)
 {
-  // TODO(benedek) perf: use a faster than printf uint-to-string solution
-  reserve(32);
-  _p += snprintf(_p, 32, "%" PRIu64, v);
+  reserve(20); // "18446744073709551615"
+  _p = writeDecimalAt(v, _p);
+}
+
+void OstreamBuffer::writeFixedPoint(std::int64_t value, unsigned scale)
+{
+  assert(scale <= 19);
+
+  reserve(22); // "-0.9223372036854775808"
+  std::uint64_t magnitude = std::uint64_t(value);
+  if (value < 0)
+  {
+    *_p++ = '-';
+    magnitude = std::uint64_t(0) - magnitude;
+  }
+
+  std::uint64_t divisor = 1;
+  for (unsigned i = 0; i < scale && i < 19; ++i) { divisor *= 10; }
+
+  _p = writeDecimalAt(magnitude / divisor, _p);
+  if (scale != 0)
+  {
+    *_p++ = '.';
+    char* const end = _p + scale;
+    char* const begin = writeDecimal(magnitude % divisor, end);
+    std::fill(_p, begin, '0'); // leading zeros of the fraction
+    _p = end;
+  }
+}
+
+void OstreamBuffer::writeHex(const char* data, std::size_t size)
+{
+  // convert chunks fitting the buffer
+  const std::size_t maxChunk = _buf.size() / 2;
+  while (size != 0)
+  {
+    const std::size_t chunk = (std::min)(size, maxChunk);
+    reserve(chunk * 2);
+    writeHexDigits(data, chunk, _p);
+    _p += chunk * 2;
+    data += chunk;
+    size -= chunk;
+  }
 }
 
 void OstreamBuffer::reserve(std::size_t n)
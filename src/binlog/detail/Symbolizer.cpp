@@ -0,0 +1,172 @@
+#include <binlog/detail/Symbolizer.hpp>
+
+#include <mserialize/detail/Visit.hpp> // IntegerToHex
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib> // free
+#include <cstring> // memcmp
+#include <fstream>
+#include <memory>
+
+#if defined(__GNUC__)
+  #include <cxxabi.h>
+  #define BINLOG_HAS_CXA_DEMANGLE
+#endif
+
+namespace {
+
+// ELF64 layout, see elf(5): not using <elf.h>, to read the logs on any platform
+
+struct ElfHeader
+{
+  unsigned char ident[16];
+  std::uint16_t type;
+  std::uint16_t machine;
+  std::uint32_t version;
+  std::uint64_t entry;
+  std::uint64_t phoff;
+  std::uint64_t shoff;
+  std::uint32_t flags;
+  std::uint16_t ehsize;
+  std::uint16_t phentsize;
+  std::uint16_t phnum;
+  std::uint16_t shentsize;
+  std::uint16_t shnum;
+  std::uint16_t shstrndx;
+};
+
+struct SectionHeader
+{
+  std::uint32_t name;
+  std::uint32_t type;
+  std::uint64_t flags;
+  std::uint64_t addr;
+  std::uint64_t offset;
+  std::uint64_t size;
+  std::uint32_t link;
+  std::uint32_t info;
+  std::uint64_t addralign;
+  std::uint64_t entsize;
+};
+
+struct SymbolEntry
+{
+  std::uint32_t name;
+  unsigned char info;
+  unsigned char other;
+  std::uint16_t shndx;
+  std::uint64_t value;
+  std::uint64_t size;
+};
+
+constexpr std::uint32_t sectionSymtab = 2;
+constexpr std::uint32_t sectionDynsym = 11;
+constexpr unsigned char symbolFunc = 2;
+constexpr unsigned char classElf64 = 2;
+
+bool readAt(std::ifstream& file, std::uint64_t offset, void* buffer, std::size_t size)
+{
+  file.seekg(std::streamoff(offset));
+  file.read(static_cast<char*>(buffer), std::streamsize(size));
+  return bool(file);
+}
+
+std::string demangle(const std::string& name)
+{
+#ifdef BINLOG_HAS_CXA_DEMANGLE
+  int status = 0;
+  std::unique_ptr<char, void(*)(void*)> demangled(
+    abi::__cxa_demangle(name.c_str(), nullptr, nullptr, &status), std::free
+  );
+  if (status == 0 && demangled) { return demangled.get(); }
+#endif
+  return name;
+}
+
+} // namespace
+
+namespace binlog {
+namespace detail {
+
+const std::string& Symbolizer::symbolize(const std::string& path, std::uint64_t offset)
+{
+  auto it = _modules.find(path);
+  if (it == _modules.end())
+  {
+    it = _modules.emplace(path, Module{}).first;
+    readSymbols(path, it->second);
+  }
+
+  Module& module = it->second;
+  const auto cached = module.results.find(offset);
+  if (cached != module.results.end()) { return cached->second; }
+
+  std::string& result = module.results[offset];
+
+  // the first symbol after offset, then step back
+  const auto after = std::upper_bound(module.symbols.begin(), module.symbols.end(), offset,
+    [](std::uint64_t o, const Symbol& s) { return o < s.begin; }
+  );
+  if (after != module.symbols.begin())
+  {
+    const Symbol& symbol = *(after - 1);
+    if (symbol.size == 0 || offset < symbol.begin + symbol.size)
+    {
+      mserialize::detail::IntegerToHex tohex;
+      tohex.visit(offset - symbol.begin);
+      const mserialize::string_view hex = tohex.value();
+
+      result = demangle(symbol.name);
+      result += "+0x";
+      result.append(hex.data(), hex.size());
+    }
+  }
+
+  return result;
+}
+
+void Symbolizer::readSymbols(const std::string& path, Module& module)
+{
+  std::ifstream file(path, std::ios::binary);
+  if (! file) { return; }
+
+  ElfHeader header{};
+  if (! readAt(file, 0, &header, sizeof(header))) { return; }
+  if (memcmp(header.ident, "\x7f" "ELF", 4) != 0 || header.ident[4] != classElf64) { return; }
+  if (header.shentsize != sizeof(SectionHeader) || header.shnum == 0) { return; }
+
+  std::vector<SectionHeader> sections(header.shnum);
+  if (! readAt(file, header.shoff, sections.data(), sections.size() * sizeof(SectionHeader))) { return; }
+
+  for (const SectionHeader& section : sections)
+  {
+    if (section.type != sectionSymtab && section.type != sectionDynsym) { continue; }
+    if (section.entsize != sizeof(SymbolEntry) || section.link >= sections.size()) { continue; }
+
+    std::vector<SymbolEntry> symbols(section.size / sizeof(SymbolEntry));
+    const SectionHeader& strtab = sections[section.link];
+    std::vector<char> names(strtab.size + 1, '\0'); // terminated, even if the section is not
+    if (! readAt(file, section.offset, symbols.data(), symbols.size() * sizeof(SymbolEntry))) { continue; }
+    if (! readAt(file, strtab.offset, names.data(), strtab.size)) { continue; }
+
+    for (const SymbolEntry& symbol : symbols)
+    {
+      if ((symbol.info & 0xf) != symbolFunc || symbol.value == 0 || symbol.name >= strtab.size) { continue; }
+      module.symbols.push_back(Symbol{symbol.value, symbol.size, std::string(names.data() + symbol.name)});
+    }
+  }
+
+  // .dynsym repeats the exported symbols of .symtab
+  std::sort(module.symbols.begin(), module.symbols.end(), [](const Symbol& a, const Symbol& b)
+  {
+    return a.begin < b.begin || (a.begin == b.begin && a.size > b.size);
+  });
+  module.symbols.erase(std::unique(module.symbols.begin(), module.symbols.end(), [](const Symbol& a, const Symbol& b)
+  {
+    return a.begin == b.begin;
+  }), module.symbols.end());
+}
+
+} // namespace detail
+} // namespace binlog
@@ -148,6 +148,17 @@ TEST_CASE("DateFormat")
   CHECK(expected == actual);
 }
 
+TEST_CASE("MultipleLogfiles")
+{
+  // the text of the logfiles is written in the order of the arguments
+  std::ostringstream cmd;
+  const std::string path = g_src_dir + "data/dateformat.blog";
+  cmd << g_bread_path << " -j 2 -f \"%u %m\" -d \"%Y-%m-%dT%H:%M:%S.%NZ\" " << path << " " << path << " " << path;
+  const std::string actual = executePipeline(cmd.str());
+  const std::string line = "2019-12-02T13:38:33.602967233Z Hello\n";
+  CHECK(line + line + line == actual);
+}
+
 TEST_CASE("RecoverMetadataAndData")
 {
   // check gdb
@@ -0,0 +1,251 @@
+// Generate a synthetic logfile, to measure bread and the tools on files
+// resembling real ones: many sources, many writers, skewed event frequency.
+
+#include "getopt.hpp"
+
+#include <binlog/Entries.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath> // pow
+#include <cstdint>
+#include <cstdlib> // strtod, strtoull
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+void showHelp()
+{
+  std::cout <<
+    "GenerateLogfile -- write a synthetic binary logfile\n"
+    "\n"
+    "Synopsis:\n"
+    "  GenerateLogfile [-s sources] [-w writers] [-a arguments] [-z skew] [-c clock] [-n size] [-r seed] [-o outputfile]\n"
+    "\n"
+    "Options:\n"
+    "  -s sources     Number of event sources (default: 10000)\n"
+    "  -w writers     Number of writers (default: 100)\n"
+    "  -a arguments   Argument mix of the sources, each source takes one of the letters, at random:\n"
+    "                 i: int, d: double, s: string, v: vector of ints, m: int, double and string,\n"
+    "                 e: no arguments. Repeat a letter to make it more frequent (default: iiddssvme)\n"
+    "  -z skew        Exponent of the Zipf distribution of the event frequency of the sources,\n"
+    "                 0 means uniform (default: 1)\n"
+    "  -c clock       steady: timestamps increase by 1-1000ns per event,\n"
+    "                 jitter: as steady, but the timestamps of writers differ by up to 10us,\n"
+    "                 none: no clock sync, timestamps are shown raw (default: steady)\n"
+    "  -n size        Approximate size of the output, with an optional K, M or G suffix (default: 300M)\n"
+    "  -r seed        Seed of the random generator (default: 1)\n"
+    "  -o outputfile  Path of the logfile to write. If '-' or unspecified, write to stdout\n"
+    "  -h             Show this help\n"
+    "\n"
+    "Example:\n"
+    "  GenerateLogfile -s 50000 -w 300 -z 1.2 -n 10G -o large.blog\n";
+}
+
+/** @returns `str` (e.g: 300M) in bytes, or 0 if invalid */
+std::uint64_t parseSize(const char* str)
+{
+  char* end = nullptr;
+  std::uint64_t result = std::strtoull(str, &end, 10);
+  const std::string suffixes = "KMG";
+  const std::size_t suffix = suffixes.find(*end);
+  if (*end != '\0' && suffix != std::string::npos)
+  {
+    result <<= 10 * (suffix + 1);
+    ++end;
+  }
+  return (*end == '\0') ? result : 0;
+}
+
+struct Config
+{
+  std::size_t sourceCount = 10000;
+  std::size_t writerCount = 100;
+  std::string arguments = "iiddssvme";
+  double skew = 1;
+  std::string clock = "steady";
+  std::uint64_t size = std::uint64_t{300} << 20;
+  std::uint64_t seed = 1;
+};
+
+/** Values of the arguments, picked by the events at random */
+struct Values
+{
+  std::vector<std::string> strings{"", "a", "hello", "order accepted", "connection reset by peer",
+    "the quick brown fox jumps over the lazy dog", std::string(200, 'x')};
+  std::vector<int> numbers{1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+};
+
+void addEvent(binlog::SessionWriter& writer, std::uint64_t sourceId, char arguments, std::uint64_t clock,
+  std::mt19937_64& random, const Values& values)
+{
+  const int i = int(random() % 100000);
+  const double d = double(random() % 1000000) / 100.0;
+  const std::string& s = values.strings[random() % values.strings.size()];
+
+  switch (arguments)
+  {
+    case 'i': writer.addEvent(sourceId, clock, i); break;
+    case 'd': writer.addEvent(sourceId, clock, d); break;
+    case 's': writer.addEvent(sourceId, clock, s); break;
+    case 'v': writer.addEvent(sourceId, clock, values.numbers); break;
+    case 'm': writer.addEvent(sourceId, clock, i, d, s); break;
+    default:  writer.addEvent(sourceId, clock); break;
+  }
+}
+
+void generate(const Config& config, std::ostream& out)
+{
+  std::mt19937_64 random(config.seed);
+  const Values values;
+
+  binlog::Session session;
+  const std::uint64_t startNs = std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::system_clock::now().time_since_epoch()
+  ).count());
+  const std::uint64_t startClock = std::uint64_t{1} << 40;
+  const bool noClock = config.clock == "none";
+  session.setClockSync(binlog::ClockSync{startClock, noClock ? 0u : 1000000000u, startNs, 0, "UTC"});
+
+  // sources, with the arguments they take
+  static const char* formats[] = {"", " value: {}", " {} at {} of {}"};
+  static const char* categories[] = {"main", "orders", "network", "storage", "risk", "audit"};
+  static const binlog::Severity severities[] = {
+    binlog::Severity::trace, binlog::Severity::debug, binlog::Severity::info,
+    binlog::Severity::info, binlog::Severity::info, binlog::Severity::warning, binlog::Severity::error,
+  };
+  std::vector<std::uint64_t> sourceIds;
+  std::vector<char> sourceArguments;
+  for (std::size_t i = 0; i < config.sourceCount; ++i)
+  {
+    const char arguments = config.arguments[random() % config.arguments.size()];
+    const char* tags = (arguments == 'i') ? "i" : (arguments == 'd') ? "d"
+      : (arguments == 's') ? "[c" : (arguments == 'v') ? "[i" : (arguments == 'm') ? "id[c" : "";
+    const char* format = formats[(arguments == 'm') ? 2 : (arguments == 'e') ? 0 : 1];
+
+    sourceIds.push_back(session.addEventSource(binlog::EventSource{
+      0,
+      severities[random() % (sizeof(severities) / sizeof(severities[0]))],
+      categories[random() % (sizeof(categories) / sizeof(categories[0]))],
+      "function" + std::to_string(i),
+      "src/module" + std::to_string(i % 97) + ".cpp",
+      i + 1,
+      "Event " + std::to_string(i) + format,
+      tags,
+    }));
+    sourceArguments.push_back(arguments);
+  }
+
+  // writers, with their clock offset
+  std::vector<std::unique_ptr<binlog::SessionWriter>> writers;
+  std::vector<std::uint64_t> writerOffsets;
+  for (std::size_t i = 0; i < config.writerCount; ++i)
+  {
+    writers.emplace_back(new binlog::SessionWriter(session, 1 << 16, i + 1, "writer" + std::to_string(i)));
+    writerOffsets.push_back((config.clock == "jitter") ? random() % 10000 : 0);
+  }
+
+  // rank k (1-based) has weight 1/k^skew
+  std::vector<double> weights;
+  weights.reserve(config.sourceCount);
+  for (std::size_t k = 1; k <= config.sourceCount; ++k)
+  {
+    weights.push_back(1.0 / std::pow(double(k), config.skew));
+  }
+  std::discrete_distribution<std::size_t> sourceDistribution(weights.begin(), weights.end());
+
+  std::uint64_t size = 0;
+  std::uint64_t clock = startClock;
+  while (size < config.size)
+  {
+    for (int i = 0; i < 4096; ++i)
+    {
+      clock += 1 + random() % 1000;
+      const std::size_t source = sourceDistribution(random);
+      const std::size_t writer = random() % writers.size();
+      addEvent(*writers[writer], sourceIds[source], sourceArguments[source],
+        clock + writerOffsets[writer], random, values);
+    }
+
+    size += session.consume(out).bytesConsumed;
+  }
+}
+
+} // namespace
+
+int main(int argc, /*const*/ char* argv[])
+{
+  Config config;
+  std::string outputPath = "-";
+
+  int opt;
+  while ((opt = getopt(argc, argv, "s:w:a:z:c:n:r:o:h")) != -1) // NOLINT(concurrency-mt-unsafe)
+  {
+    switch (opt)
+    {
+    case 's':
+      config.sourceCount = std::size_t(std::strtoull(optarg, nullptr, 10));
+      break;
+    case 'w':
+      config.writerCount = std::size_t(std::strtoull(optarg, nullptr, 10));
+      break;
+    case 'a':
+      config.arguments = optarg;
+      break;
+    case 'z':
+      config.skew = std::strtod(optarg, nullptr);
+      break;
+    case 'c':
+      config.clock = optarg;
+      break;
+    case 'n':
+      config.size = parseSize(optarg);
+      break;
+    case 'r':
+      config.seed = std::strtoull(optarg, nullptr, 10);
+      break;
+    case 'o':
+      outputPath = optarg;
+      break;
+    case 'h':
+      showHelp();
+      return 0;
+    default:
+      // getopt prints a useful error message by default (opterr is set)
+      showHelp();
+      return 1;
+    }
+  }
+
+  const bool validArguments = ! config.arguments.empty() &&
+    config.arguments.find_first_not_of("idsvme") == std::string::npos;
+  const bool validClock = config.clock == "steady" || config.clock == "jitter" || config.clock == "none";
+  if (config.sourceCount == 0 || config.writerCount == 0 || ! validArguments || ! validClock || config.size == 0)
+  {
+    std::cerr << "[GenerateLogfile] Invalid option value\n";
+    showHelp();
+    return 1;
+  }
+
+  std::ofstream outputFile;
+  if (outputPath != "-")
+  {
+    outputFile.open(outputPath, std::ofstream::out | std::ofstream::binary);
+    if (! outputFile)
+    {
+      std::cerr << "[GenerateLogfile] Failed to open '" << outputPath << "' for writing\n";
+      return 2;
+    }
+  }
+  std::ostream& output = (outputFile.is_open()) ? outputFile : std::cout;
+
+  generate(config, output);
+  return 0;
+}
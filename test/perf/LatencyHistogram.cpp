@@ -0,0 +1,265 @@
+// Measure the latency distribution of adding events, at a fixed rate,
+// with different queue sizes, argument mixes and consumers.
+//
+// Usage: LatencyHistogram [calls per second per thread] [seconds per configuration] [threads]
+//
+// Each producer thread (pinned to a CPU, on Linux) adds an event every 1/rate seconds,
+// and records the TSC ticks each call took in a log-linear histogram.
+// A call that takes longer than the interval delays the calls after it:
+// their latency is recorded as if they were issued on schedule
+// (correction for coordinated omission, as HdrHistogram does).
+
+#include <binlog/BackgroundConsumer.hpp>
+#include <binlog/Entries.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/TscClock.hpp>
+#include <binlog/detail/Rdtsc.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib> // strtoull
+#include <ios> // streamsize
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+  #include <pthread.h> // NOLINT pthread_setaffinity_np
+  #include <sched.h> // NOLINT cpu_set_t
+#endif
+
+namespace {
+
+/**
+ * Histogram of values with a relative precision of 1/32:
+ * values below 64 have a bucket each, larger values
+ * are grouped by their most significant 6 bits.
+ */
+class Histogram
+{
+public:
+  void record(std::uint64_t value)
+  {
+    ++_buckets[bucket(value)];
+    ++_count;
+    _max = (std::max)(_max, value);
+  }
+
+  /** Record `value`, and the values of the calls it delayed, if it is longer than `interval` */
+  void recordCorrected(std::uint64_t value, std::uint64_t interval)
+  {
+    record(value);
+    if (interval == 0) { return; }
+    for (std::uint64_t missing = value; missing > interval; )
+    {
+      missing -= interval;
+      record(missing);
+    }
+  }
+
+  void add(const Histogram& rhs)
+  {
+    for (std::size_t i = 0; i < _buckets.size(); ++i) { _buckets[i] += rhs._buckets[i]; }
+    _count += rhs._count;
+    _max = (std::max)(_max, rhs._max);
+  }
+
+  /** @returns the upper bound of the bucket of the `p` quantile (0 <= p <= 1) */
+  std::uint64_t percentile(double p) const
+  {
+    const std::uint64_t target = (std::max)(std::uint64_t(1), std::uint64_t(p * double(_count) + 0.5));
+    std::uint64_t sum = 0;
+    for (std::size_t i = 0; i < _buckets.size(); ++i)
+    {
+      sum += _buckets[i];
+      if (sum >= target) { return (std::min)(upperBound(i), _max); }
+    }
+    return _max;
+  }
+
+  std::uint64_t count() const { return _count; }
+  std::uint64_t max() const { return _max; }
+
+private:
+  static constexpr unsigned subBits = 5;
+  static constexpr std::size_t linear = std::size_t(2) << subBits; // 64
+  static constexpr std::size_t subCount = std::size_t(1) << subBits; // 32
+
+  static unsigned msb(std::uint64_t value)
+  {
+    unsigned result = 0;
+    while (value >>= 1) { ++result; }
+    return result;
+  }
+
+  static std::size_t bucket(std::uint64_t value)
+  {
+    if (value < linear) { return std::size_t(value); }
+    const unsigned shift = msb(value) - subBits;
+    return linear + (shift - 1) * subCount + std::size_t(value >> shift) - subCount;
+  }
+
+  static std::uint64_t upperBound(std::size_t index)
+  {
+    if (index < linear) { return index; }
+    const unsigned shift = unsigned((index - linear) / subCount) + 1;
+    const std::uint64_t top = (index - linear) % subCount + subCount;
+    return ((top + 1) << shift) - 1;
+  }
+
+  std::array<std::uint64_t, linear + (64 - subBits - 1) * subCount> _buckets = {};
+  std::uint64_t _count = 0;
+  std::uint64_t _max = 0;
+};
+
+void pinThread(unsigned cpu)
+{
+  #ifdef __linux__
+    const unsigned cpuCount = (std::max)(1u, std::thread::hardware_concurrency());
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu % cpuCount, &cpus);
+    (void)pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+  #else
+    (void)cpu;
+  #endif
+}
+
+struct NullOstream
+{
+  NullOstream& write(const char*, std::streamsize) { return *this; }
+};
+
+enum class Arguments { oneInt, mixed, longString };
+
+const char* toString(Arguments arguments)
+{
+  switch (arguments)
+  {
+    case Arguments::oneInt:     return "int";
+    case Arguments::mixed:      return "int,double,string";
+    case Arguments::longString: return "string(128)";
+  }
+  return "?";
+}
+
+struct Consumer
+{
+  const char* name;
+  binlog::BackgroundConsumer::Options options;
+};
+
+struct Config
+{
+  std::uint64_t rate;           // calls per second per thread
+  std::chrono::seconds duration;
+  unsigned threadCount;
+};
+
+/** Add events at `interval` ticks to `writer` until `end`, record the ticks of each call */
+void produce(binlog::SessionWriter& writer, std::uint64_t sourceId, Arguments arguments,
+  std::uint64_t interval, std::uint64_t end, Histogram& histogram)
+{
+  const std::string longString(128, 'x');
+  int i = 0;
+  for (std::uint64_t next = binlog::detail::rdtsc(); next < end; next += interval)
+  {
+    while (binlog::detail::rdtsc() < next) {} // spin, to keep the caches and the CPU warm
+    const std::uint64_t start = binlog::detail::rdtsc();
+
+    switch (arguments)
+    {
+      case Arguments::oneInt:     writer.addEvent(sourceId, start, ++i); break;
+      case Arguments::mixed:      writer.addEvent(sourceId, start, ++i, 3.14, "hello"); break;
+      case Arguments::longString: writer.addEvent(sourceId, start, longString); break;
+    }
+
+    const std::uint64_t stop = binlog::detail::rdtsc();
+    // a late call is measured from its scheduled start
+    histogram.recordCorrected(stop - (std::min)(start, next), interval);
+  }
+}
+
+Histogram run(const Config& config, std::size_t queueCapacity, Arguments arguments, const Consumer& consumer)
+{
+  binlog::Session session;
+  const char* tags = (arguments == Arguments::oneInt) ? "i" : (arguments == Arguments::mixed) ? "id[c" : "[c";
+  const std::uint64_t sourceId = session.addEventSource(binlog::EventSource{
+    0, binlog::Severity::info, "perf", "produce", "LatencyHistogram.cpp", 1, "{}", tags
+  });
+
+  NullOstream out;
+  binlog::BackgroundConsumer backgroundConsumer(session, out, consumer.options);
+
+  const std::uint64_t frequency = binlog::tscFrequency();
+  const std::uint64_t interval = frequency / config.rate;
+  const std::uint64_t end = binlog::detail::rdtsc() + frequency * std::uint64_t(config.duration.count());
+
+  std::vector<Histogram> histograms(config.threadCount);
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < config.threadCount; ++t)
+  {
+    threads.emplace_back([&, t]()
+    {
+      pinThread(t + 1); // the consumer is on cpu 0
+      binlog::SessionWriter writer(session, queueCapacity, t);
+      produce(writer, sourceId, arguments, interval, end, histograms[t]);
+    });
+  }
+  for (std::thread& thread : threads) { thread.join(); }
+  backgroundConsumer.stop();
+
+  Histogram result;
+  for (const Histogram& histogram : histograms) { result.add(histogram); }
+  return result;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  Config config{200000, std::chrono::seconds{1}, 2};
+  if (argc > 1) { config.rate = (std::max)(1ull, std::strtoull(argv[1], nullptr, 10)); }
+  if (argc > 2) { config.duration = std::chrono::seconds{std::strtoll(argv[2], nullptr, 10)}; }
+  if (argc > 3) { config.threadCount = (std::max)(1u, unsigned(std::strtoul(argv[3], nullptr, 10))); }
+
+  binlog::BackgroundConsumer::Options busy;
+  busy.minPollInterval = busy.maxPollInterval = std::chrono::microseconds{0};
+  busy.cpu = 0;
+  binlog::BackgroundConsumer::Options adaptive;
+  adaptive.cpu = 0;
+  binlog::BackgroundConsumer::Options slow;
+  slow.minPollInterval = slow.maxPollInterval = std::chrono::microseconds{10000};
+  slow.cpu = 0;
+  const std::vector<Consumer> consumers{{"busy", busy}, {"adaptive", adaptive}, {"10ms", slow}};
+
+  const double nsPerTick = 1e9 / double(binlog::tscFrequency());
+  std::printf("%llu calls/s per thread, %u threads, %llds per configuration, latencies in ns\n\n",
+    static_cast<unsigned long long>(config.rate), config.threadCount, static_cast<long long>(config.duration.count())); // NOLINT(google-runtime-int)
+  std::printf("%8s %-18s %-9s %10s %8s %8s %8s %8s %8s %10s\n",
+    "queue", "arguments", "consumer", "calls", "p50", "p90", "p99", "p99.9", "p99.99", "max");
+
+  for (const std::size_t queueCapacity : {std::size_t{4096}, std::size_t{1} << 16, std::size_t{1} << 20})
+  {
+    for (const Arguments arguments : {Arguments::oneInt, Arguments::mixed, Arguments::longString})
+    {
+      for (const Consumer& consumer : consumers)
+      {
+        const Histogram h = run(config, queueCapacity, arguments, consumer);
+        const auto ns = [nsPerTick](std::uint64_t ticks) { return double(ticks) * nsPerTick; };
+        std::printf("%8zu %-18s %-9s %10llu %8.0f %8.0f %8.0f %8.0f %8.0f %10.0f\n",
+          queueCapacity, toString(arguments), consumer.name, static_cast<unsigned long long>(h.count()), // NOLINT(google-runtime-int)
+          ns(h.percentile(0.5)), ns(h.percentile(0.9)), ns(h.percentile(0.99)),
+          ns(h.percentile(0.999)), ns(h.percentile(0.9999)), ns(h.max()));
+        std::fflush(stdout);
+      }
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,320 @@
+#include <binlog/Entries.hpp>
+#include <binlog/PackedInteger.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/detail/Rdtsc.hpp>
+#include <binlog/detail/VectorOutputStream.hpp>
+
+#include <mserialize/detail/packed_integer.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio> // snprintf
+#include <cstring>
+#include <ios> // streamsize
+#include <string>
+#include <vector>
+
+// Compare the cost of the same log statements in three loggers:
+//
+//  - binlog: serialize the arguments on the producer, copy them to the logfile on the consumer,
+//  - NanoLog style: copy the raw arguments on the producer, and compact them on the consumer
+//    (integers nibble packed, timestamps delta encoded),
+//  - text: format the message on the producer (snprintf), copy text on the consumer,
+//    as a conventional synchronous formatting logger (fmt/spdlog style) does.
+//
+// BM_produce_* measures the producer cost, BM_consume_* the consumer,
+// with the bytes_per_event of the output.
+// Arg: index of the statement, see `statements`.
+
+namespace {
+
+struct Statement
+{
+  const char* format;       // binlog format
+  const char* printfFormat; // NanoLog and text format
+  const char* tags;         // binlog tags, also tells NanoLog the argument types (i, d or [c)
+};
+
+const Statement statements[] = {
+  {"Single int: {}", "Single int: %d", "i"},
+  {"Three small ints: {} {} {}", "Three small ints: %d %d %d", "iii"},
+  {"int {} double {} string {}", "int %d double %f string %s", "id[c"},
+};
+
+const char* const stringArgument = "hello world";
+
+struct CountingOstream
+{
+  std::size_t size = 0;
+  CountingOstream& write(const char*, std::streamsize n) { size += std::size_t(n); return *this; }
+};
+
+class BinlogLogger
+{
+public:
+  explicit BinlogLogger(bool packedIntegers)
+    :_writer(_session, 1 << 20),
+     _packed(packedIntegers)
+  {
+    for (const Statement& s : statements)
+    {
+      std::string tags = s.tags;
+      if (_packed) { for (char& c : tags) { if (c == 'i') { c = 'q'; } } }
+      _sourceIds.push_back(_session.addEventSource(binlog::EventSource{
+        0, binlog::Severity::info, "perf", "f", "PerftestComparison.cpp", 1, s.format, tags
+      }));
+    }
+  }
+
+  void log(std::size_t statement, int i)
+  {
+    const std::uint64_t clock = binlog::detail::rdtsc();
+    const std::uint64_t id = _sourceIds[statement];
+    if (_packed)
+    {
+      switch (statement)
+      {
+        case 0: _writer.addEvent(id, clock, binlog::packed(i)); break;
+        case 1: _writer.addEvent(id, clock, binlog::packed(i % 10), binlog::packed(i % 100), binlog::packed(7)); break;
+        default: _writer.addEvent(id, clock, binlog::packed(i), 3.14, stringArgument); break;
+      }
+    }
+    else
+    {
+      switch (statement)
+      {
+        case 0: _writer.addEvent(id, clock, i); break;
+        case 1: _writer.addEvent(id, clock, i % 10, i % 100, 7); break;
+        default: _writer.addEvent(id, clock, i, 3.14, stringArgument); break;
+      }
+    }
+  }
+
+  /** @returns the number of bytes added to the output */
+  std::size_t consume()
+  {
+    CountingOstream out;
+    _session.consume(out);
+    return out.size;
+  }
+
+private:
+  binlog::Session _session;
+  binlog::SessionWriter _writer;
+  bool _packed;
+  std::vector<std::uint64_t> _sourceIds;
+};
+
+/** The raw arguments are copied on the producer, and packed on the consumer, like NanoLog does */
+class NanoLogStyleLogger
+{
+public:
+  NanoLogStyleLogger() { _staging.resize(1 << 20); }
+
+  void log(std::size_t statement, int i)
+  {
+    const std::uint64_t clock = binlog::detail::rdtsc();
+    const std::uint32_t formatId = std::uint32_t(statement);
+    store(formatId);
+    store(clock);
+
+    switch (statement)
+    {
+      case 0: store(i); break;
+      case 1: store(i % 10); store(i % 100); store(7); break;
+      default:
+        store(i);
+        store(3.14);
+        const std::size_t size = std::strlen(stringArgument) + 1;
+        std::memcpy(_staging.data() + _pos, stringArgument, size);
+        _pos += size;
+        break;
+    }
+  }
+
+  /** @returns the number of bytes added to the output */
+  std::size_t consume()
+  {
+    _output.clear();
+    std::size_t pos = 0;
+    while (pos < _pos)
+    {
+      const std::uint32_t formatId = load<std::uint32_t>(pos);
+      const std::uint64_t clock = load<std::uint64_t>(pos);
+      pack(std::uint64_t{formatId});
+      pack(clock - _lastClock);
+      _lastClock = clock;
+
+      for (const char* tag = statements[formatId].tags; *tag != 0; ++tag)
+      {
+        switch (*tag)
+        {
+          case 'i': pack(std::int64_t{load<int>(pos)}); break;
+          case 'd':
+          {
+            const double d = load<double>(pos);
+            _output.write(reinterpret_cast<const char*>(&d), sizeof(d));
+            break;
+          }
+          default: // [c
+          {
+            const char* str = _staging.data() + pos;
+            const std::size_t size = std::strlen(str) + 1;
+            _output.write(str, std::streamsize(size));
+            pos += size;
+            ++tag;
+            break;
+          }
+        }
+      }
+    }
+    _pos = 0;
+    benchmark::DoNotOptimize(_output.data());
+    return _output.vector.size();
+  }
+
+private:
+  template <typename T>
+  void store(T value)
+  {
+    std::memcpy(_staging.data() + _pos, &value, sizeof(value));
+    _pos += sizeof(value);
+  }
+
+  template <typename T>
+  T load(std::size_t& pos) const
+  {
+    T value;
+    std::memcpy(&value, _staging.data() + pos, sizeof(value));
+    pos += sizeof(value);
+    return value;
+  }
+
+  void pack(std::int64_t value)
+  {
+    bool negative = false;
+    const std::uint64_t magnitude = mserialize::detail::packed_magnitude(std::uint64_t(value), true, negative);
+    mserialize::detail::serialize_packed(magnitude, negative, _output);
+  }
+
+  void pack(std::uint64_t value)
+  {
+    mserialize::detail::serialize_packed(value, false, _output);
+  }
+
+  std::vector<char> _staging;
+  std::size_t _pos = 0;
+  std::uint64_t _lastClock = 0;
+  binlog::detail::VectorOutputStream _output;
+};
+
+/** The message is formatted on the producer */
+class TextLogger
+{
+public:
+  TextLogger() { _buffer.resize(1 << 20); }
+
+  void log(std::size_t statement, int i)
+  {
+    const std::uint64_t clock = binlog::detail::rdtsc();
+    char* out = _buffer.data() + _pos;
+    const std::size_t capacity = _buffer.size() - _pos;
+    int size = std::snprintf(out, capacity, "%llu INFO ", static_cast<unsigned long long>(clock)); // NOLINT(google-runtime-int)
+    const char* format = statements[statement].printfFormat;
+    switch (statement)
+    {
+      case 0: size += std::snprintf(out + size, capacity - std::size_t(size), format, i); break;
+      case 1: size += std::snprintf(out + size, capacity - std::size_t(size), format, i % 10, i % 100, 7); break;
+      default: size += std::snprintf(out + size, capacity - std::size_t(size), format, i, 3.14, stringArgument); break;
+    }
+    out[size++] = '\n';
+    _pos += std::size_t(size);
+  }
+
+  /** @returns the number of bytes added to the output */
+  std::size_t consume()
+  {
+    CountingOstream out;
+    out.write(_buffer.data(), std::streamsize(_pos));
+    benchmark::DoNotOptimize(_buffer.data());
+    _pos = 0;
+    return out.size;
+  }
+
+private:
+  std::vector<char> _buffer;
+  std::size_t _pos = 0;
+};
+
+constexpr int batchSize = 2048;
+
+template <typename Logger>
+void produce(benchmark::State& state, Logger& logger)
+{
+  const std::size_t statement = std::size_t(state.range(0));
+  int i = 0;
+  for (auto _ : state)
+  {
+    logger.log(statement, ++i);
+
+    // drain the buffers, otherwise allocation (or overflow) will be timed
+    if (i % batchSize == 0)
+    {
+      state.PauseTiming();
+      logger.consume();
+      state.ResumeTiming();
+    }
+  }
+  state.SetLabel(statements[statement].printfFormat);
+}
+
+template <typename Logger>
+void consume(benchmark::State& state, Logger& logger)
+{
+  const std::size_t statement = std::size_t(state.range(0));
+  logger.log(statement, 0);
+  logger.consume(); // binlog: consume the metadata
+
+  std::size_t bytes = 0;
+  int i = 0;
+  for (auto _ : state)
+  {
+    state.PauseTiming();
+    for (int j = 0; j < batchSize; ++j) { logger.log(statement, ++i); }
+    state.ResumeTiming();
+
+    bytes += logger.consume();
+  }
+
+  const double events = double(state.iterations()) * batchSize;
+  state.SetItemsProcessed(std::int64_t(events));
+  state.counters["bytes_per_event"] = double(bytes) / events;
+  state.SetLabel(statements[statement].printfFormat);
+}
+
+void BM_produce_binlog(benchmark::State& state) { BinlogLogger logger(false); produce(state, logger); }
+void BM_produce_binlogPacked(benchmark::State& state) { BinlogLogger logger(true); produce(state, logger); }
+void BM_produce_nanoLogStyle(benchmark::State& state) { NanoLogStyleLogger logger; produce(state, logger); }
+void BM_produce_text(benchmark::State& state) { TextLogger logger; produce(state, logger); }
+
+void BM_consume_binlog(benchmark::State& state) { BinlogLogger logger(false); consume(state, logger); }
+void BM_consume_binlogPacked(benchmark::State& state) { BinlogLogger logger(true); consume(state, logger); }
+void BM_consume_nanoLogStyle(benchmark::State& state) { NanoLogStyleLogger logger; consume(state, logger); }
+void BM_consume_text(benchmark::State& state) { TextLogger logger; consume(state, logger); }
+
+BENCHMARK(BM_produce_binlog)->DenseRange(0, 2); // NOLINT
+BENCHMARK(BM_produce_binlogPacked)->DenseRange(0, 2); // NOLINT
+BENCHMARK(BM_produce_nanoLogStyle)->DenseRange(0, 2); // NOLINT
+BENCHMARK(BM_produce_text)->DenseRange(0, 2); // NOLINT
+
+BENCHMARK(BM_consume_binlog)->DenseRange(0, 2); // NOLINT
+BENCHMARK(BM_consume_binlogPacked)->DenseRange(0, 2); // NOLINT
+BENCHMARK(BM_consume_nanoLogStyle)->DenseRange(0, 2); // NOLINT
+BENCHMARK(BM_consume_text)->DenseRange(0, 2); // NOLINT
+
+} // namespace
+
+BENCHMARK_MAIN();
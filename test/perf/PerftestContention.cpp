@@ -0,0 +1,219 @@
+#include <binlog/Entries.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/TscClock.hpp>
+#include <binlog/detail/Rdtsc.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ios> // streamsize
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Multiple producers, and a consumer running concurrently with them.
+// Each benchmark runs with 1..N producer threads, and reports the
+// per thread throughput (events_per_thread) and the latency
+// percentiles of the producer operation (p50/p99/p999, in nanoseconds).
+
+namespace {
+
+struct NullOstream
+{
+  NullOstream& write(const char*, std::streamsize) { return *this; }
+};
+
+/**
+ * The session of the producers, and its consumer thread,
+ * started by the first producer, stopped by the last one.
+ */
+class Context
+{
+public:
+  explicit Context(binlog::Session::ShrinkPolicy shrinkPolicy = {})
+  {
+    _session.setShrinkPolicy(shrinkPolicy);
+    intSource = _session.addEventSource(binlog::EventSource{
+      0, binlog::Severity::info, "perf", "f", "PerftestContention.cpp", 1, "Single int: {}", "i"
+    });
+    stringSource = _session.addEventSource(binlog::EventSource{
+      0, binlog::Severity::info, "perf", "f", "PerftestContention.cpp", 2, "String: {}", "[c"
+    });
+  }
+
+  // the session lives until the end of the program,
+  // writers of the benchmark threads might still refer to it
+  // after the last benchmark iteration.
+  binlog::Session& session() { return _session; }
+
+  void enter()
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_producerCount++ == 0)
+    {
+      _stop.store(false);
+      _consumer = std::thread([this]()
+      {
+        NullOstream out;
+        while (! _stop.load(std::memory_order_relaxed))
+        {
+          if (_session.consume(out).bytesConsumed == 0) { std::this_thread::yield(); }
+        }
+        _session.consume(out);
+      });
+    }
+  }
+
+  void leave()
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (--_producerCount == 0)
+    {
+      _stop.store(true);
+      _consumer.join();
+    }
+  }
+
+  std::uint64_t intSource = 0;     // NOLINT
+  std::uint64_t stringSource = 0;  // NOLINT
+
+private:
+  binlog::Session _session;
+  std::mutex _mutex;
+  int _producerCount = 0;
+  std::atomic<bool> _stop{false};
+  std::thread _consumer;
+};
+
+/** Latency samples of a single thread */
+class Latencies
+{
+public:
+  Latencies() { _samples.reserve(maxSamples); }
+
+  void add(std::uint64_t ticks)
+  {
+    if (_samples.size() < maxSamples) { _samples.push_back(ticks); }
+  }
+
+  /** Report the percentiles, averaged over the threads */
+  void report(benchmark::State& state)
+  {
+    if (_samples.empty()) { return; }
+    std::sort(_samples.begin(), _samples.end());
+
+    const double nsPerTick = 1e9 / double(binlog::tscFrequency());
+    const auto percentile = [&](double p)
+    {
+      const std::size_t i = (std::min)(_samples.size() - 1, std::size_t(double(_samples.size()) * p));
+      return benchmark::Counter(double(_samples[i]) * nsPerTick, benchmark::Counter::kAvgThreads);
+    };
+
+    state.counters["p50_ns"] = percentile(0.5);
+    state.counters["p99_ns"] = percentile(0.99);
+    state.counters["p999_ns"] = percentile(0.999);
+    state.counters["events_per_thread"] = benchmark::Counter(
+      double(state.iterations()), benchmark::Counter::kIsRate | benchmark::Counter::kAvgThreads
+    );
+  }
+
+private:
+  static constexpr std::size_t maxSamples = 1 << 20;
+  std::vector<std::uint64_t> _samples;
+};
+
+constexpr std::size_t Latencies::maxSamples;
+
+/** Add an int event, @returns the ticks it took */
+std::uint64_t timedAddEvent(binlog::SessionWriter& writer, std::uint64_t sourceId, int i)
+{
+  const std::uint64_t start = binlog::detail::rdtsc();
+  writer.addEvent(sourceId, start, i);
+  return binlog::detail::rdtsc() - start;
+}
+
+// Many short lived writers: each creates and closes a channel,
+// contending on the session mutex with each other and the consumer.
+void BM_writerWarmup(benchmark::State& state)
+{
+  static Context ctx;
+  ctx.enter();
+
+  Latencies latencies;
+  int i = 0;
+  for (auto _ : state)
+  {
+    const std::uint64_t start = binlog::detail::rdtsc();
+    {
+      binlog::SessionWriter writer(ctx.session(), 4096, std::uint64_t(state.thread_index()));
+      writer.addEvent(ctx.intSource, start, ++i);
+    }
+    latencies.add(binlog::detail::rdtsc() - start);
+  }
+
+  ctx.leave();
+  latencies.report(state);
+}
+BENCHMARK(BM_writerWarmup)->ThreadRange(1, 8)->UseRealTime(); // NOLINT
+
+// Long lived writers, the consumer reads the queues they are writing
+void BM_addEventLiveConsumer(benchmark::State& state)
+{
+  static Context ctx;
+  ctx.enter();
+
+  Latencies latencies;
+  {
+    binlog::SessionWriter writer(ctx.session(), 1 << 20, std::uint64_t(state.thread_index()));
+    int i = 0;
+    for (auto _ : state)
+    {
+      latencies.add(timedAddEvent(writer, ctx.intSource, ++i));
+    }
+  }
+
+  ctx.leave();
+  latencies.report(state);
+}
+BENCHMARK(BM_addEventLiveConsumer)->ThreadRange(1, 8)->UseRealTime(); // NOLINT
+
+// Small queues: a large event every 64 events grows the queue (replaceChannel),
+// and the shrink policy makes the writer replace it again when it is idle.
+void BM_replaceChannel(benchmark::State& state)
+{
+  static Context ctx(binlog::Session::ShrinkPolicy{1, 8});
+  ctx.enter();
+
+  const std::string large(2048, 'x');
+  Latencies latencies;
+  {
+    binlog::SessionWriter writer(ctx.session(), 1024, std::uint64_t(state.thread_index()));
+    int i = 0;
+    for (auto _ : state)
+    {
+      if (++i % 64 == 0)
+      {
+        const std::uint64_t start = binlog::detail::rdtsc();
+        writer.addEvent(ctx.stringSource, start, large);
+        latencies.add(binlog::detail::rdtsc() - start);
+      }
+      else
+      {
+        latencies.add(timedAddEvent(writer, ctx.intSource, i));
+      }
+    }
+  }
+
+  ctx.leave();
+  latencies.report(state);
+}
+BENCHMARK(BM_replaceChannel)->ThreadRange(1, 8)->UseRealTime(); // NOLINT
+
+} // namespace
+
+BENCHMARK_MAIN();
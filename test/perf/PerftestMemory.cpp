@@ -0,0 +1,138 @@
+#include <binlog/Entries.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ios> // streamsize
+#include <string>
+#include <thread>
+#include <vector>
+
+// Memory footprint of typical writer patterns, as reported by Session::memoryUsage:
+// peak_bytes is the largest total seen while the pattern runs,
+// steady_bytes is the total after the pattern settles.
+// The time of the benchmarks is not relevant.
+
+namespace {
+
+struct NullOstream
+{
+  NullOstream& write(const char*, std::streamsize) { return *this; }
+};
+
+void report(benchmark::State& state, std::size_t peak, const binlog::Session::MemoryUsage& steady)
+{
+  state.counters["peak_bytes"] = double(peak);
+  state.counters["steady_bytes"] = double(steady.totalBytes());
+  state.counters["steady_channels"] = double(steady.channelCount);
+  state.counters["steady_source_bytes"] = double(steady.sourceBytes);
+}
+
+std::uint64_t addSource(binlog::Session& session, std::size_t line)
+{
+  return session.addEventSource(binlog::EventSource{
+    0, binlog::Severity::info, "perf", "f", "PerftestMemory.cpp", line, "Event {} {}", "i[c"
+  });
+}
+
+// Arg 0: number of threads, each of them writes 1000 events to its own writer, then exits.
+// Arg 1: queue capacity of the writers
+void BM_threads(benchmark::State& state)
+{
+  const std::size_t threadCount = std::size_t(state.range(0));
+  const std::size_t queueCapacity = std::size_t(state.range(1));
+
+  for (auto _ : state)
+  {
+    binlog::Session session;
+    const std::uint64_t sourceId = addSource(session, 1);
+    NullOstream out;
+
+    std::atomic<std::size_t> ready{0};
+    std::atomic<bool> done{false};
+    std::vector<std::thread> threads;
+    for (std::size_t t = 0; t < threadCount; ++t)
+    {
+      threads.emplace_back([&, t]()
+      {
+        binlog::SessionWriter writer(session, queueCapacity, t, "writer" + std::to_string(t));
+        for (int i = 0; i < 1000; ++i) { writer.addEvent(sourceId, 0, i, std::string("hello")); }
+        ++ready;
+        while (! done.load()) { std::this_thread::yield(); }
+      });
+    }
+
+    // every writer is alive
+    while (ready.load() != threadCount) { session.consume(out); }
+    session.consume(out);
+    const std::size_t peak = session.memoryUsage().totalBytes();
+
+    done.store(true);
+    for (std::thread& thread : threads) { thread.join(); }
+    session.consume(out); // remove the closed channels
+
+    report(state, peak, session.memoryUsage());
+  }
+}
+BENCHMARK(BM_threads)->Args({1, 1 << 20})->Args({16, 1 << 20})->Args({16, 1 << 16})->Args({256, 1 << 16})->Iterations(1); // NOLINT
+
+// A single writer with a small queue, a burst of events grows it (not consumed meanwhile),
+// then the writer goes back to a few events per consume.
+// Arg 0: size of the string argument of the 4096 events in the burst
+// Arg 1: 1 if the session asks the writer to shrink its queue, see Session::setShrinkPolicy
+void BM_burst(benchmark::State& state)
+{
+  const std::size_t payloadSize = std::size_t(state.range(0));
+  const bool shrink = state.range(1) != 0;
+
+  for (auto _ : state)
+  {
+    binlog::Session session;
+    if (shrink) { session.setShrinkPolicy(binlog::Session::ShrinkPolicy{4, 8}); }
+    const std::uint64_t sourceId = addSource(session, 1);
+    NullOstream out;
+
+    binlog::SessionWriter writer(session, 4096);
+    const std::string payload(payloadSize, 'x');
+    for (int i = 0; i < 4096; ++i) { writer.addEvent(sourceId, 0, i, payload); }
+    std::size_t peak = session.memoryUsage().totalBytes();
+    session.consume(out);
+
+    for (int i = 0; i < 64; ++i)
+    {
+      writer.addEvent(sourceId, 0, i, std::string("small"));
+      session.consume(out);
+      peak = (std::max)(peak, session.memoryUsage().totalBytes());
+    }
+
+    report(state, peak, session.memoryUsage());
+  }
+}
+BENCHMARK(BM_burst)->Args({64, 0})->Args({64, 1})->Args({1 << 14, 0})->Args({1 << 14, 1})->Iterations(1); // NOLINT
+
+// Many distinct event sources, before and after consuming them
+// Arg: number of sources
+void BM_sources(benchmark::State& state)
+{
+  const std::size_t sourceCount = std::size_t(state.range(0));
+
+  for (auto _ : state)
+  {
+    binlog::Session session;
+    NullOstream out;
+    for (std::size_t i = 0; i < sourceCount; ++i) { addSource(session, i); }
+    const std::size_t peak = session.memoryUsage().totalBytes();
+    session.consume(out);
+    report(state, peak, session.memoryUsage());
+  }
+}
+BENCHMARK(BM_sources)->Arg(1000)->Arg(100000)->Iterations(1); // NOLINT
+
+} // namespace
+
+BENCHMARK_MAIN();
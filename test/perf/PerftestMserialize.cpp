@@ -0,0 +1,251 @@
+#include <binlog/PackedInteger.hpp>
+#include <binlog/Range.hpp>
+#include <binlog/detail/Queue.hpp>
+#include <binlog/detail/QueueReader.hpp>
+#include <binlog/detail/QueueWriter.hpp>
+#include <binlog/detail/VectorOutputStream.hpp>
+
+#include <mserialize/deserialize.hpp>
+#include <mserialize/make_struct_deserializable.hpp>
+#include <mserialize/make_struct_serializable.hpp>
+#include <mserialize/make_struct_tag.hpp>
+#include <mserialize/serialize.hpp>
+#include <mserialize/skip.hpp>
+#include <mserialize/tag.hpp>
+#include <mserialize/visit.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#if __cplusplus >= 201703L
+  #include <binlog/adapt_stdvariant.hpp>
+  #include <variant>
+#endif
+
+// Cost of mserialize::serialize (to a VectorOutputStream and to a QueueWriter),
+// serialized_size, deserialize and visit, for each type family:
+// arithmetic, strings, sequences, maps, tuples, optionals, variants (C++17),
+// adapted structs, custom serializers (PackedInteger), and nested structures.
+
+namespace {
+
+struct Order
+{
+  std::uint64_t id;
+  double price;
+  std::string symbol;
+  std::vector<int> fills;
+};
+
+} // namespace
+
+MSERIALIZE_MAKE_STRUCT_SERIALIZABLE(Order, id, price, symbol, fills)
+MSERIALIZE_MAKE_STRUCT_DESERIALIZABLE(Order, id, price, symbol, fills)
+MSERIALIZE_MAKE_STRUCT_TAG(Order, id, price, symbol, fills)
+
+namespace {
+
+// Values to benchmark: each has a `type` and a `make()` function
+
+struct Int { using type = int; static type make() { return 123456; } };
+struct String { using type = std::string; static type make() { return std::string(32, 'x'); } };
+struct SmallVector { using type = std::vector<int>; static type make() { return type(16, 7); } };
+struct LargeVector { using type = std::vector<int>; static type make() { return type(4096, 7); } };
+struct StringVector { using type = std::vector<std::string>; static type make() { return type(16, "hello world"); } };
+
+struct Map
+{
+  using type = std::map<int, std::string>;
+  static type make()
+  {
+    type result;
+    for (int i = 0; i < 16; ++i) { result.emplace(i, "value " + std::to_string(i)); }
+    return result;
+  }
+};
+
+struct Tuple
+{
+  using type = std::tuple<int, double, std::string>;
+  static type make() { return type{1, 2.5, "three"}; }
+};
+
+struct Optional
+{
+  using type = std::unique_ptr<int>;
+  static type make() { return type(new int(123)); }
+};
+
+struct Struct
+{
+  using type = Order;
+  static type make() { return Order{123, 101.25, "AAPL", {100, 200, 300}}; }
+};
+
+struct NestedStructs
+{
+  using type = std::vector<Order>;
+  static type make() { return type(64, Struct::make()); }
+};
+
+struct Packed
+{
+  using type = binlog::PackedInteger<std::int64_t>;
+  static type make() { return binlog::packed(std::int64_t{123456}); }
+};
+
+#if __cplusplus >= 201703L
+struct Variant
+{
+  using type = std::variant<int, std::string, double>;
+  static type make() { return type{std::string("variant")}; }
+};
+#endif
+
+/** Does nothing with the values, the visitation itself is timed */
+struct NullVisitor
+{
+  template <typename T>
+  void visit(T value) { benchmark::DoNotOptimize(value); }
+
+  template <typename T>
+  bool visit(T, binlog::Range&) { return false; }
+};
+
+template <typename Value>
+void BM_serializeVector(benchmark::State& state)
+{
+  const typename Value::type value = Value::make();
+  binlog::detail::VectorOutputStream out;
+  for (auto _ : state)
+  {
+    out.clear();
+    mserialize::serialize(value, out);
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetBytesProcessed(std::int64_t(state.iterations()) * out.ssize());
+}
+
+template <typename Value>
+void BM_serializeQueue(benchmark::State& state)
+{
+  const typename Value::type value = Value::make();
+  std::vector<char> buffer(1 << 20);
+  binlog::detail::Queue queue(buffer.data(), buffer.size());
+  binlog::detail::QueueWriter writer(queue);
+  binlog::detail::QueueReader reader(queue);
+
+  const std::size_t size = mserialize::serialized_size(value);
+  for (auto _ : state)
+  {
+    if (! writer.beginWrite(size))
+    {
+      reader.beginRead();
+      reader.endRead();
+      writer.beginWrite(size);
+    }
+    mserialize::serialize(value, writer);
+    writer.endWrite();
+  }
+  state.SetBytesProcessed(std::int64_t(state.iterations()) * std::int64_t(size));
+}
+
+template <typename Value>
+void BM_serializedSize(benchmark::State& state)
+{
+  const typename Value::type value = Value::make();
+  for (auto _ : state)
+  {
+    benchmark::DoNotOptimize(mserialize::serialized_size(value));
+  }
+}
+
+/** @returns the serialized `Value::make()` */
+template <typename Value>
+std::vector<char> serialized()
+{
+  binlog::detail::VectorOutputStream out;
+  mserialize::serialize(Value::make(), out);
+  return out.vector;
+}
+
+template <typename Value>
+void BM_deserialize(benchmark::State& state)
+{
+  const std::vector<char> buffer = serialized<Value>();
+  typename Value::type value{};
+  for (auto _ : state)
+  {
+    binlog::Range input(buffer.data(), buffer.size());
+    mserialize::deserialize(value, input);
+    benchmark::DoNotOptimize(value);
+  }
+  state.SetBytesProcessed(std::int64_t(state.iterations()) * std::int64_t(buffer.size()));
+}
+
+template <typename Value>
+void BM_visit(benchmark::State& state)
+{
+  const std::vector<char> buffer = serialized<Value>();
+  const auto tag = mserialize::tag<typename Value::type>();
+  NullVisitor visitor;
+  for (auto _ : state)
+  {
+    binlog::Range input(buffer.data(), buffer.size());
+    mserialize::visit(tag, visitor, input);
+  }
+  state.SetBytesProcessed(std::int64_t(state.iterations()) * std::int64_t(buffer.size()));
+}
+
+template <typename Value>
+void BM_skip(benchmark::State& state)
+{
+  const std::vector<char> buffer = serialized<Value>();
+  const mserialize::VisitPlan plan(mserialize::tag<typename Value::type>());
+  for (auto _ : state)
+  {
+    binlog::Range input(buffer.data(), buffer.size());
+    mserialize::skip(plan, input);
+    benchmark::DoNotOptimize(input);
+  }
+  state.SetBytesProcessed(std::int64_t(state.iterations()) * std::int64_t(buffer.size()));
+}
+
+#define PERFTEST_SERIALIZE(Value)                       \
+  BENCHMARK_TEMPLATE(BM_serializeVector, Value);        \
+  BENCHMARK_TEMPLATE(BM_serializeQueue, Value);         \
+  BENCHMARK_TEMPLATE(BM_serializedSize, Value);         \
+  BENCHMARK_TEMPLATE(BM_visit, Value);                  \
+  BENCHMARK_TEMPLATE(BM_skip, Value)                    \
+  /**/
+
+#define PERFTEST_ALL(Value)                             \
+  PERFTEST_SERIALIZE(Value);                            \
+  BENCHMARK_TEMPLATE(BM_deserialize, Value)             \
+  /**/
+
+PERFTEST_ALL(Int); // NOLINT
+PERFTEST_ALL(String); // NOLINT
+PERFTEST_ALL(SmallVector); // NOLINT
+PERFTEST_ALL(LargeVector); // NOLINT
+PERFTEST_ALL(StringVector); // NOLINT
+PERFTEST_ALL(Map); // NOLINT
+PERFTEST_ALL(Tuple); // NOLINT
+PERFTEST_ALL(Optional); // NOLINT
+PERFTEST_ALL(Struct); // NOLINT
+PERFTEST_ALL(NestedStructs); // NOLINT
+PERFTEST_SERIALIZE(Packed); // NOLINT serialize only, as logged
+
+#if __cplusplus >= 201703L
+PERFTEST_SERIALIZE(Variant); // NOLINT serialize only, as logged
+#endif
+
+} // namespace
+
+BENCHMARK_MAIN();
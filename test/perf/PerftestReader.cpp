@@ -0,0 +1,189 @@
+#include <binlog/binlog.hpp>
+
+#include <binlog/EntryStream.hpp>
+#include <binlog/EventStream.hpp>
+#include <binlog/PrettyPrinter.hpp>
+#include <binlog/Range.hpp>
+#include <binlog/ToStringVisitor.hpp>
+#include <binlog/adapt_enum.hpp>
+#include <binlog/adapt_struct.hpp>
+#include <binlog/detail/OstreamBuffer.hpp>
+
+#include <mserialize/visit.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <utility>
+#include <vector>
+
+// The reading half: parse entries, decode events, convert arguments
+// and pretty print events of a generated, in memory logfile.
+// The logfile mixes argument types like LargeLogfile, and adds structs,
+// enums and containers. Each benchmark reports items_per_second (entries or events).
+
+namespace {
+
+enum class Side { Buy, Sell };
+
+struct Order
+{
+  std::uint64_t id;
+  Side side;
+  double price;
+  int quantity;
+  std::string symbol;
+};
+
+} // namespace
+
+BINLOG_ADAPT_ENUM(Side, Buy, Sell)
+BINLOG_ADAPT_STRUCT(Order, id, side, price, quantity, symbol)
+
+namespace {
+
+/** Discards the characters, to time the printing only */
+class NullBuffer : public std::streambuf
+{
+protected:
+  int_type overflow(int_type c) override { return c; }
+  std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+/** @returns a logfile of about 8MB, generated once */
+const std::string& logfile()
+{
+  static const std::string result = []()
+  {
+    binlog::Session session;
+    binlog::SessionWriter writer(session, 1 << 20);
+
+    const std::vector<int> numbers{1,2,3,4,5,6,7,8};
+    const std::map<std::string, double> prices{{"AAPL", 172.5}, {"MSFT", 310.25}, {"GOOG", 135.75}};
+
+    std::ostringstream out;
+    for (int i = 0; out.tellp() < 8 * 1024 * 1024; ++i)
+    {
+      BINLOG_INFO_W(writer, "int {} bool {} char {}", i, true, 'X');
+      BINLOG_DEBUG_W(writer, "More strings {} {} abc {}", "aaaaaaaaaaa", "bb", "ccccccccccccccccccccccccc");
+      BINLOG_INFO_W(writer, "Three doubles: {} {} {}", 1.5 * i, 2.25, -3.125e10);
+      BINLOG_INFO_W(writer, "New order: {}", Order{std::uint64_t(i), Side::Buy, 101.25, 100, "AAPL"});
+      BINLOG_WARN_W(writer, "Side {} rejected", Side::Sell);
+      BINLOG_INFO_W(writer, "Look, numbers: {}", numbers);
+      BINLOG_INFO_W(writer, "Prices: {}", prices);
+
+      if (i % 256 == 0) { session.consume(out); }
+    }
+    session.consume(out);
+    return out.str();
+  }();
+  return result;
+}
+
+binlog::Range logfileRange()
+{
+  const std::string& data = logfile();
+  return binlog::Range(data.data(), data.size());
+}
+
+void BM_istreamEntryStream(benchmark::State& state)
+{
+  std::int64_t entries = 0;
+  for (auto _ : state)
+  {
+    std::istringstream input(logfile());
+    binlog::IstreamEntryStream entryStream(input);
+    for (binlog::Range entry = entryStream.nextEntryPayload(); ! entry.empty(); entry = entryStream.nextEntryPayload())
+    {
+      ++entries;
+    }
+  }
+  state.SetItemsProcessed(entries);
+}
+BENCHMARK(BM_istreamEntryStream); // NOLINT
+
+void BM_eventStreamNextEvent(benchmark::State& state)
+{
+  std::int64_t events = 0;
+  for (auto _ : state)
+  {
+    binlog::RangeEntryStream entryStream(logfileRange());
+    binlog::EventStream eventStream;
+    while (const binlog::Event* event = eventStream.nextEvent(entryStream))
+    {
+      benchmark::DoNotOptimize(event->clockValue);
+      ++events;
+    }
+  }
+  state.SetItemsProcessed(events);
+}
+BENCHMARK(BM_eventStreamNextEvent); // NOLINT
+
+void BM_toStringVisitor(benchmark::State& state)
+{
+  // decode the events once, only the conversion of the arguments is timed
+  binlog::RangeEntryStream entryStream(logfileRange());
+  binlog::EventStream eventStream;
+  std::vector<std::pair<std::string, binlog::Range>> arguments;
+  while (const binlog::Event* event = eventStream.nextEvent(entryStream))
+  {
+    arguments.emplace_back(event->source->argumentTags, event->arguments);
+  }
+
+  NullBuffer nullBuffer;
+  std::ostream out(&nullBuffer);
+  std::int64_t events = 0;
+  for (auto _ : state)
+  {
+    binlog::detail::OstreamBuffer buffer(out);
+    for (const auto& tagAndArgs : arguments)
+    {
+      binlog::Range args = tagAndArgs.second;
+      binlog::ToStringVisitor visitor(buffer);
+      mserialize::visit(tagAndArgs.first, visitor, args);
+    }
+    events += std::int64_t(arguments.size());
+  }
+  state.SetItemsProcessed(events);
+}
+BENCHMARK(BM_toStringVisitor); // NOLINT
+
+// Arg: index of the event format
+void BM_prettyPrinterPrintEvent(benchmark::State& state)
+{
+  static const char* formats[] = {
+    "%m\n",
+    "%S %C [%d] %n %m (%G:%L)\n",
+    "%u %I %S %C %F %M %P %T %r %m\n",
+  };
+  const char* format = formats[state.range(0)];
+  std::string label(format);
+  label.pop_back(); // newline
+  state.SetLabel(label);
+
+  NullBuffer nullBuffer;
+  std::ostream out(&nullBuffer);
+  std::int64_t events = 0;
+  for (auto _ : state)
+  {
+    binlog::RangeEntryStream entryStream(logfileRange());
+    binlog::EventStream eventStream;
+    binlog::PrettyPrinter printer(format, "%Y-%m-%d %H:%M:%S.%N");
+    while (const binlog::Event* event = eventStream.nextEvent(entryStream))
+    {
+      printer.printEvent(out, *event, eventStream.writerProp(), eventStream.clockSync());
+      ++events;
+    }
+  }
+  state.SetItemsProcessed(events);
+}
+BENCHMARK(BM_prettyPrinterPrintEvent)->DenseRange(0, 2); // NOLINT
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -4,6 +4,8 @@
 
 #include <array>
 #include <ios> // streamsize
+#include <string>
+#include <vector>
 
 #ifdef _WIN32
   #include <intrin.h>
@@ -49,6 +51,25 @@ void BM_addEvent(benchmark::State& state)
 }
 BENCHMARK(BM_addEvent); // NOLINT
 
+void BM_addEventDefaultWriter(benchmark::State& state)
+{
+  // the same as BM_addEvent, using the writer of the basic log macros
+  for (int i = 0; state.KeepRunning(); ++i)
+  {
+    BINLOG_INFO("Single int: {}", i);
+
+    if (i == 2048)
+    {
+      state.PauseTiming();
+      i = 0;
+      NullOstream out;
+      binlog::consume(out);
+      state.ResumeTiming();
+    }
+  }
+}
+BENCHMARK(BM_addEventDefaultWriter); // NOLINT
+
 void BM_addEventPoisonCache(benchmark::State& state)
 {
   binlog::Session session;
@@ -79,6 +100,43 @@ void BM_addEventPoisonCache(benchmark::State& state)
 }
 BENCHMARK(BM_addEventPoisonCache); // NOLINT
 
+// Logging large payloads evicts the working set of the application,
+// unless the writer copies them by non-temporal stores.
+// The time of the application touching its working set is measured.
+void BM_workingSetAfterLargeEvent(benchmark::State& state)
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 1 << 22);
+  writer.setNonTemporalThreshold(std::size_t(state.range(0)));
+
+  const std::string payload(1 << 20, 'x');
+  std::vector<char> workingSet(256 * 1024);
+
+  for (int i = 0; state.KeepRunning(); ++i)
+  {
+    state.PauseTiming();
+
+    BINLOG_INFO_W(writer, "Payload: {}", payload);
+
+    // flush the queue, otherwise queue allocation will be timed
+    if (i == 8)
+    {
+      i = 0;
+      NullOstream out;
+      session.consume(out);
+    }
+
+    state.ResumeTiming();
+
+    // Simulate the application reading its working set, a byte per cache line
+    for (std::size_t j = 0; j < workingSet.size(); j += 64)
+    {
+      benchmark::DoNotOptimize(workingSet[j]);
+    }
+  }
+}
+BENCHMARK(BM_workingSetAfterLargeEvent)->Arg(0)->Arg(4096); // NOLINT
+
 void BM_addEventNoClock(benchmark::State& state)
 {
   binlog::Session session;
@@ -149,6 +207,62 @@ void BM_addEvent_ThreeFloatArguments(benchmark::State& state)
 }
 BENCHMARK(BM_addEvent_ThreeFloatArguments); // NOLINT
 
+// All arguments are fixed size: the size of the event is computed
+// at compile time, and the event is copied to the queue at once
+void BM_addEvent_SixArithmeticArguments(benchmark::State& state)
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session);
+
+  const int a = 123;
+  const double b = 4.56;
+  const char c = 'x';
+
+  for (int i = 0; state.KeepRunning(); ++i)
+  {
+    BINLOG_INFO_W(writer, "Six numbers: {} {} {} {} {} {}", i, a, b, c, a, b);
+
+    // flush the queue, otherwise queue allocation will be timed
+    if (i == 2048)
+    {
+      state.PauseTiming();
+      i = 0;
+      NullOstream out;
+      session.consume(out);
+      state.ResumeTiming();
+    }
+  }
+}
+BENCHMARK(BM_addEvent_SixArithmeticArguments); // NOLINT
+
+// Same as above, but an argument of variable size takes the runtime path
+void BM_addEvent_SixArithmeticArgumentsAndString(benchmark::State& state)
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session);
+
+  const int a = 123;
+  const double b = 4.56;
+  const char c = 'x';
+  const std::string s = "foobar";
+
+  for (int i = 0; state.KeepRunning(); ++i)
+  {
+    BINLOG_INFO_W(writer, "Six numbers: {} {} {} {} {} {} and {}", i, a, b, c, a, b, s);
+
+    // flush the queue, otherwise queue allocation will be timed
+    if (i == 2048)
+    {
+      state.PauseTiming();
+      i = 0;
+      NullOstream out;
+      session.consume(out);
+      state.ResumeTiming();
+    }
+  }
+}
+BENCHMARK(BM_addEvent_SixArithmeticArgumentsAndString); // NOLINT
+
 void BM_addEvent_OneStringArgument(benchmark::State& state)
 {
   binlog::Session session;
@@ -0,0 +1,131 @@
+#include <binlog/Entries.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/advanced_log_macros.hpp>
+#include <binlog/detail/Rdtsc.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ios> // streamsize
+#include <string>
+#include <thread>
+#include <utility> // index_sequence
+
+// Cost of the first execution of log statements (registering their event source),
+// and of the first log statement of a new thread (allocating its channel).
+//
+// The call sites are generated: each instantiation of callSite<Set, I>
+// is a distinct log statement. A call site is registered once per process,
+// therefore the first hit benchmarks run a single iteration,
+// on a distinct set of call sites each.
+
+namespace {
+
+constexpr std::size_t callSitesPerSet = 1024;
+
+struct NullOstream
+{
+  NullOstream& write(const char*, std::streamsize) { return *this; }
+};
+
+binlog::Session& session()
+{
+  static binlog::Session result;
+  return result;
+}
+
+template <int Set, std::size_t I>
+void callSite(binlog::SessionWriter& writer)
+{
+  BINLOG_INFO_W(writer, "Call site {} of set {}", I, Set);
+}
+
+template <int Set, std::size_t... I>
+void hitAll(binlog::SessionWriter& writer, std::index_sequence<I...>)
+{
+  const int hits[] = {(callSite<Set, I>(writer), 0)...};
+  static_cast<void>(hits);
+}
+
+/** @returns the nanoseconds it took to hit each call site of `Set` once */
+template <int Set>
+double hitSet(binlog::SessionWriter& writer)
+{
+  const auto start = std::chrono::steady_clock::now();
+  hitAll<Set>(writer, std::make_index_sequence<callSitesPerSet>{});
+  return double(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+// First (registering) and second hit of distinct call sites,
+// by each thread at the same time (Set), the threads contend on the session mutex.
+template <int Set>
+void BM_firstHit(benchmark::State& state)
+{
+  // the queue is large enough, the events are not consumed during the benchmark
+  binlog::SessionWriter writer(session(), 1 << 24, std::uint64_t(state.thread_index()));
+
+  for (auto _ : state)
+  {
+    const double first = hitSet<Set>(writer);
+    const double warm = hitSet<Set>(writer);
+    state.SetIterationTime(first / 1e9);
+
+    state.counters["first_hit_ns"] = benchmark::Counter(first / callSitesPerSet, benchmark::Counter::kAvgThreads);
+    state.counters["warm_hit_ns"] = benchmark::Counter(warm / callSitesPerSet, benchmark::Counter::kAvgThreads);
+  }
+}
+BENCHMARK_TEMPLATE(BM_firstHit, 0)->Iterations(1)->Threads(1)->UseManualTime(); // NOLINT
+BENCHMARK_TEMPLATE(BM_firstHit, 1)->Iterations(1)->Threads(2)->UseManualTime(); // NOLINT
+BENCHMARK_TEMPLATE(BM_firstHit, 2)->Iterations(1)->Threads(4)->UseManualTime(); // NOLINT
+BENCHMARK_TEMPLATE(BM_firstHit, 3)->Iterations(1)->Threads(8)->UseManualTime(); // NOLINT
+
+// Registration alone, repeatable: add distinct sources to the same session
+void BM_addEventSource(benchmark::State& state)
+{
+  static binlog::Session session;
+  const std::string function = "function" + std::to_string(state.thread_index());
+  std::uint64_t line = 0;
+  for (auto _ : state)
+  {
+    benchmark::DoNotOptimize(session.addEventSource(binlog::EventSource{
+      0, binlog::Severity::info, "warmup", function, "PerftestWarmup.cpp", ++line, "Source {}", "i"
+    }));
+  }
+}
+BENCHMARK(BM_addEventSource)->ThreadRange(1, 8); // NOLINT
+
+// A new thread creates a writer (allocating a channel), and logs its first event.
+// Arg: queue capacity
+void BM_newThreadFirstLog(benchmark::State& state)
+{
+  binlog::Session session;
+  const std::uint64_t sourceId = session.addEventSource(binlog::EventSource{
+    0, binlog::Severity::info, "warmup", "f", "PerftestWarmup.cpp", 1, "Hello {}", "i"
+  });
+  const std::size_t queueCapacity = std::size_t(state.range(0));
+
+  NullOstream out;
+  for (auto _ : state)
+  {
+    std::chrono::steady_clock::duration elapsed{};
+    std::thread thread([&]()
+    {
+      const auto start = std::chrono::steady_clock::now();
+      binlog::SessionWriter writer(session, queueCapacity);
+      writer.addEvent(sourceId, binlog::detail::rdtsc(), 1);
+      elapsed = std::chrono::steady_clock::now() - start;
+    });
+    thread.join();
+    state.SetIterationTime(std::chrono::duration<double>(elapsed).count());
+
+    session.consume(out); // release the closed channel
+  }
+}
+BENCHMARK(BM_newThreadFirstLog)->Arg(1 << 12)->Arg(1 << 16)->Arg(1 << 20)->UseManualTime(); // NOLINT
+
+} // namespace
+
+BENCHMARK_MAIN();
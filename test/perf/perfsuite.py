@@ -0,0 +1,121 @@
+"""
+Run the performance tests, write the results to a single JSON file,
+and compare them to a baseline (a previous result file).
+
+Usage:
+
+  perfsuite.py --build-dir BUILD [--out results.json] [--baseline baseline.json] [--tolerance 10]
+
+Exits with 1 if a benchmark of the baseline got slower than the tolerance allows,
+or if it is missing from the results.
+"""
+
+import argparse
+import json
+import os
+import shutil
+import subprocess
+import sys
+
+# The benchmarks of the suite, Google Benchmark binaries in the build directory.
+# PerftestWarmup and PerftestMemory are not included: their single iterations
+# are not stable enough to compare (warmup) or their time is not relevant (memory).
+BENCHMARKS = [
+  'PerftestQueue',
+  'PerftestSessionWriter',
+  'PerftestContention',
+  'PerftestComparison',
+  'PerftestMserialize',
+  'PerftestReader',
+]
+
+def run_benchmark(path, cpu, repetitions, min_time):
+  """Run the benchmark at `path`, pinned to `cpu` if possible, return its results"""
+  command = [
+    path,
+    '--benchmark_format=json',
+    '--benchmark_repetitions=%d' % repetitions,
+    '--benchmark_report_aggregates_only=true',
+  ]
+  if min_time:
+    command.append('--benchmark_min_time=%s' % min_time)
+  if cpu is not None and shutil.which('taskset'):
+    command = ['taskset', '-c', str(cpu)] + command
+
+  output = subprocess.run(command, check=True, stdout=subprocess.PIPE).stdout
+  return json.loads(output)
+
+def median_times(result):
+  """@returns {benchmark name: median real time (ns)} of `result`"""
+  times = {}
+  for benchmark in result['benchmarks']:
+    if benchmark.get('aggregate_name', 'median') != 'median':
+      continue
+    factor = {'ns': 1, 'us': 1e3, 'ms': 1e6, 's': 1e9}[benchmark.get('time_unit', 'ns')]
+    times[benchmark['run_name']] = benchmark['real_time'] * factor
+  return times
+
+def compare(baseline, results, tolerance):
+  """Print the change of each benchmark, @returns the number of regressions"""
+  regressions = 0
+  for name, base in sorted(baseline.items()):
+    current = results.get(name)
+    if current is None:
+      print('%-60s missing' % name)
+      regressions += 1
+      continue
+
+    change = (current - base) / base * 100 if base else 0
+    status = 'REGRESSION' if change > tolerance else ''
+    if status:
+      regressions += 1
+    print('%-60s %12.1f ns %12.1f ns %+7.1f%% %s' % (name, base, current, change, status))
+  return regressions
+
+def main():
+  parser = argparse.ArgumentParser(description='Run the performance tests, compare them to a baseline')
+  parser.add_argument('--build-dir', required=True, help='Directory of the benchmark binaries')
+  parser.add_argument('--out', default='PerfSuite.json', help='Path of the result file to write')
+  parser.add_argument('--baseline', help='Previous result file to compare to')
+  parser.add_argument('--tolerance', type=float, default=10, help='Allowed slowdown, in percent of the baseline')
+  parser.add_argument('--cpu', type=int, help='CPU to pin the benchmarks to (with taskset), default: the last one, -1: do not pin')
+  parser.add_argument('--repetitions', type=int, default=5, help='Number of runs of each benchmark, the median is compared')
+  parser.add_argument('--min-time', help='Passed to --benchmark_min_time')
+  args = parser.parse_args()
+
+  cpu = args.cpu
+  if cpu is None and hasattr(os, 'sched_getaffinity'):
+    cpu = max(os.sched_getaffinity(0))
+  elif cpu is not None and cpu < 0:
+    cpu = None
+
+  suite = {'context': None, 'benchmarks': []}
+  for name in BENCHMARKS:
+    path = os.path.join(args.build_dir, name)
+    if not os.path.exists(path):
+      print('Benchmark not found: %s' % path, file=sys.stderr)
+      return 2
+
+    print('Run %s' % name, file=sys.stderr)
+    result = run_benchmark(path, cpu, args.repetitions, args.min_time)
+    suite['context'] = suite['context'] or result['context']
+    for benchmark in result['benchmarks']:
+      benchmark['run_name'] = name + '/' + benchmark['run_name']
+      suite['benchmarks'].append(benchmark)
+
+  with open(args.out, 'w') as out:
+    json.dump(suite, out, indent=2)
+  print('Results written to %s' % args.out, file=sys.stderr)
+
+  if args.baseline:
+    with open(args.baseline) as baseline_file:
+      baseline = json.load(baseline_file)
+    regressions = compare(median_times(baseline), median_times(suite), args.tolerance)
+    if regressions:
+      print('%d regressions (tolerance: %g%%)' % (regressions, args.tolerance), file=sys.stderr)
+      return 1
+
+  return 0
+
+if __name__ == '__main__':
+  sys.exit(main())
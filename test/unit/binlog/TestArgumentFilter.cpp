@@ -0,0 +1,164 @@
+#include <binlog/ArgumentFilter.hpp>
+
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/advanced_log_macros.hpp>
+
+#include "test_utils.hpp"
+
+#include <doctest/doctest.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Comparison = binlog::ArgumentFilter::Comparison;
+
+struct FilterAdapter
+{
+  binlog::ArgumentFilter& filter;
+  TestStream stream;
+
+  FilterAdapter& write(const char* buffer, std::streamsize size)
+  {
+    const std::size_t oldSize = stream.buffer.size();
+    const std::size_t writeSize = filter.writeAllowed(buffer, std::size_t(size), stream);
+    CHECK(oldSize + writeSize == stream.buffer.size());
+    return *this;
+  }
+};
+
+std::vector<std::string> filterEvents(binlog::Session& session, binlog::ArgumentFilter& filter)
+{
+  FilterAdapter adapter{filter, {}};
+  session.consume(adapter);
+  return streamToEvents(adapter.stream, "%C %m");
+}
+
+binlog::ArgumentFilter::Condition condition(const char* category, std::size_t argument, Comparison comparison, std::string value)
+{
+  const std::string c = category;
+  return {[c](const binlog::EventSource& source) { return source.category == c; }, argument, comparison, std::move(value)};
+}
+
+} // namespace
+
+TEST_CASE("argument_filter_drop_matching")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+
+  // drop heartbeats of status OK
+  binlog::ArgumentFilter filter({condition("heartbeat", 0, Comparison::notEqual, "OK")});
+
+  for (const char* status : {"OK", "DEGRADED", "OK", "O", "OKAY"})
+  {
+    BINLOG_INFO_WC(writer, heartbeat, "status {}", std::string(status));
+  }
+  BINLOG_INFO_WC(writer, main, "status {}", std::string("OK"));
+
+  CHECK(filterEvents(session, filter) == std::vector<std::string>{
+    "heartbeat status DEGRADED",
+    "heartbeat status O",
+    "heartbeat status OKAY",
+    "main status OK",
+  });
+  CHECK(filter.droppedEvents() == 2);
+}
+
+TEST_CASE("argument_filter_fixed_offset")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+
+  // keep orders of account 42 only
+  binlog::ArgumentFilter filter({condition("orders", 1, Comparison::equal, "42")});
+
+  for (std::uint32_t account : {41u, 42u, 43u, 42u})
+  {
+    BINLOG_INFO_WC(writer, orders, "Order {} of account {} at {}", 7, account, 1.5);
+  }
+
+  CHECK(filterEvents(session, filter) == std::vector<std::string>{
+    "orders Order 7 of account 42 at 1.5",
+    "orders Order 7 of account 42 at 1.5",
+  });
+}
+
+TEST_CASE("argument_filter_variable_offset")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+
+  binlog::ArgumentFilter filter({
+    condition("orders", 2, Comparison::greaterEqual, "-10"),
+    condition("orders", 2, Comparison::less, "100"),
+  });
+
+  BINLOG_INFO_WC(writer, orders, "{} {} {}", std::string("a"), std::vector<int>{1, 2}, -11);
+  BINLOG_INFO_WC(writer, orders, "{} {} {}", std::string("bb"), std::vector<int>{}, -10);
+  BINLOG_INFO_WC(writer, orders, "{} {} {}", std::string(""), std::vector<int>{3}, 99);
+  BINLOG_INFO_WC(writer, orders, "{} {} {}", std::string("ccc"), std::vector<int>{4, 5, 6}, 100);
+
+  CHECK(filterEvents(session, filter) == std::vector<std::string>{
+    "orders bb [] -10",
+    "orders  [3] 99",
+  });
+}
+
+TEST_CASE("argument_filter_types")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+
+  binlog::ArgumentFilter filter({
+    condition("unsigned", 0, Comparison::greater, "-1"),
+    condition("unsigned", 0, Comparison::lessEqual, "18446744073709551615"),
+    condition("double", 0, Comparison::greater, "0.25"),
+    condition("char", 0, Comparison::equal, "x"),
+    condition("bool", 0, Comparison::equal, "true"),
+    condition("int8", 0, Comparison::less, "0"),
+  });
+
+  BINLOG_INFO_WC(writer, unsigned, "{}", std::uint64_t(18446744073709551615ull));
+  BINLOG_INFO_WC(writer, double, "{}", 0.25);
+  BINLOG_INFO_WC(writer, double, "{}", 0.5);
+  BINLOG_INFO_WC(writer, char, "{}", 'x');
+  BINLOG_INFO_WC(writer, char, "{}", 'y');
+  BINLOG_INFO_WC(writer, bool, "{}", false);
+  BINLOG_INFO_WC(writer, bool, "{}", true);
+  BINLOG_INFO_WC(writer, int8, "{}", std::int8_t(-1));
+  BINLOG_INFO_WC(writer, int8, "{}", std::int8_t(1));
+
+  CHECK(filterEvents(session, filter) == std::vector<std::string>{
+    "unsigned 18446744073709551615",
+    "double 0.5",
+    "char x",
+    "bool true",
+    "int8 -1",
+  });
+}
+
+TEST_CASE("argument_filter_not_comparable")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+
+  // invalid value, missing argument, or not comparable: only notEqual holds
+  binlog::ArgumentFilter filter({
+    condition("invalid", 0, Comparison::equal, "abc"),
+    condition("missing", 3, Comparison::less, "1"),
+    condition("vector", 0, Comparison::equal, "1"),
+    condition("other", 0, Comparison::notEqual, "abc"),
+  });
+
+  BINLOG_INFO_WC(writer, invalid, "{}", 123);
+  BINLOG_INFO_WC(writer, missing, "{}", 0);
+  BINLOG_INFO_WC(writer, vector, "{}", std::vector<int>{1});
+  BINLOG_INFO_WC(writer, other, "{}", 123);
+
+  CHECK(filterEvents(session, filter) == std::vector<std::string>{"other 123"});
+  CHECK(filter.droppedEvents() == 3);
+}
@@ -0,0 +1,124 @@
+#include <binlog/AsyncOutputStream.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/advanced_log_macros.hpp>
+
+#include <doctest/doctest.h>
+
+#include <condition_variable>
+#include <ios>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+/** Blocks write until released */
+struct BlockedStream
+{
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool released = false;
+  bool fail = false;
+  std::string data;
+
+  BlockedStream& write(const char* buffer, std::streamsize size)
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this]() { return released; });
+    if (fail) { throw std::runtime_error("write failed"); }
+    data.append(buffer, std::size_t(size));
+    return *this;
+  }
+
+  void flush() {}
+
+  void release(bool fail_ = false)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      released = true;
+      fail = fail_;
+    }
+    cv.notify_all();
+  }
+};
+
+std::vector<std::string> toEvents(const std::string& data)
+{
+  TestStream stream;
+  stream.write(data.data(), std::streamsize(data.size()));
+  return streamToEvents(stream, "%m");
+}
+
+} // namespace
+
+TEST_CASE("consume")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 512);
+
+  std::ostringstream out;
+  {
+    binlog::AsyncOutputStream<std::ostringstream> output(out);
+
+    BINLOG_INFO_W(writer, "Hello {}!", std::string{"Async"});
+    session.consume(output);
+
+    BINLOG_INFO_W(writer, "Number: {}", 123);
+    session.consume(output);
+  } // destructor writes the pending data
+
+  CHECK(toEvents(out.str()) == std::vector<std::string>{"Hello Async!", "Number: 123"});
+}
+
+TEST_CASE("release_queue_before_write")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 128);
+  writer.setOverflowPolicy(binlog::SessionWriter::OverflowPolicy::drop); // do not grow the queue
+
+  BlockedStream out;
+  binlog::AsyncOutputStream<BlockedStream> output(out);
+
+  int count = 0;
+  while (writer.addEvent(1, 0, count)) { ++count; } // fill the queue
+  CHECK(count > 0);
+
+  session.consume(output); // returns, although `out` is blocked
+
+  // the queue space is released
+  int countAgain = 0;
+  while (writer.addEvent(1, 0, countAgain)) { ++countAgain; }
+  CHECK(countAgain >= count - 1); // the free space might wrap around the end of the queue
+
+  session.consume(output);
+  CHECK(output.pendingBytes() != 0);
+
+  out.release();
+  output.flush();
+  CHECK(output.pendingBytes() == 0);
+  CHECK(! out.data.empty());
+}
+
+TEST_CASE("report_write_error")
+{
+  BlockedStream out;
+  binlog::AsyncOutputStream<BlockedStream> output(out);
+
+  output.write("abc", 3);
+  out.release(true);
+
+  CHECK_THROWS_AS(output.flush(), std::runtime_error);
+  output.flush(); // reported once
+
+  out.fail = false;
+  output.write("def", 3);
+  output.close();
+  CHECK(out.data == "def");
+}
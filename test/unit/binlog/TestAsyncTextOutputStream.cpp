@@ -0,0 +1,114 @@
+#include <binlog/AsyncTextOutputStream.hpp>
+
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/TextOutputStream.hpp>
+#include <binlog/advanced_log_macros.hpp>
+
+#include <doctest/doctest.h>
+
+#include <array>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+TEST_CASE("empty")
+{
+  std::ostringstream out;
+  binlog::AsyncTextOutputStream text(out);
+
+  text.write(nullptr, 0);
+  text.flush();
+
+  CHECK(out.str() == "");
+}
+
+TEST_CASE("same_as_sync")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 512);
+
+  std::ostringstream binary;
+  for (int i = 0; i < 100; ++i)
+  {
+    BINLOG_INFO_W(writer, "Hello {}: {}", i, std::array<int, 3>{i, i+1, i+2});
+    session.consume(binary);
+  }
+  const std::string data = binary.str();
+
+  std::ostringstream syncOut;
+  binlog::TextOutputStream sync(syncOut, "%S %m\n");
+  sync.write(data.data(), std::streamsize(data.size()));
+
+  std::ostringstream asyncOut;
+  binlog::AsyncTextOutputStream async(asyncOut, "%S %m\n");
+  async.write(data.data(), std::streamsize(data.size()));
+  async.flush();
+
+  CHECK(asyncOut.str() == syncOut.str());
+  CHECK(asyncOut.str().substr(0, 29) == "INFO Hello 0: [0, 1, 2]\nINFO ");
+}
+
+TEST_CASE("consume")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 512);
+
+  std::ostringstream out;
+  {
+    binlog::AsyncTextOutputStream text(out, "%S %m\n");
+    session.consume(text);
+
+    BINLOG_INFO_W(writer, "Hello {}!", std::string{"Text"});
+    session.consume(text);
+
+    BINLOG_INFO_W(writer, "Numbers: {}", std::array<int, 6>{1, 1, 2, 3, 5, 7});
+    session.consume(text);
+  } // destructor converts the pending data
+
+  CHECK(out.str() == "INFO Hello Text!\n" "INFO Numbers: [1, 1, 2, 3, 5, 7]\n");
+}
+
+TEST_CASE("small_pending_buffer")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 512);
+
+  std::ostringstream out;
+  binlog::AsyncTextOutputStream::Options options;
+  options.maxPendingBytes = 64; // smaller than a single consume
+  binlog::AsyncTextOutputStream text(out, "%m\n", "%Y", options);
+
+  std::string expected;
+  for (int i = 0; i < 200; ++i)
+  {
+    BINLOG_INFO_W(writer, "{}", i);
+    session.consume(text);
+    expected += std::to_string(i) + "\n";
+  }
+  text.close();
+
+  CHECK(out.str() == expected);
+}
+
+TEST_CASE("corruption_allows_progress")
+{
+  std::ostringstream out;
+  binlog::AsyncTextOutputStream text(out, "%S %m\n");
+
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 512);
+  session.consume(text);
+
+  // corruption is signalled, once
+  text.write("foobar", 6);
+  CHECK_THROWS_AS(text.flush(), std::runtime_error);
+  text.flush();
+
+  // but allows progress
+  BINLOG_INFO_W(writer, "Hello {}!", std::string{"Text"});
+  session.consume(text);
+  text.close();
+
+  CHECK(out.str() == "INFO Hello Text!\n");
+}
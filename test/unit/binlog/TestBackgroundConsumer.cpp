@@ -0,0 +1,229 @@
+#include <binlog/BackgroundConsumer.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/advanced_log_macros.hpp>
+
+#include <doctest/doctest.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+/** Thread safe stream, to check the progress of the consumer */
+struct SyncStream
+{
+  std::mutex mutex;
+  std::condition_variable cv;
+  TestStream stream;
+  std::size_t flushCount = 0;
+
+  SyncStream& write(const char* data, std::streamsize size)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stream.write(data, size);
+    }
+    cv.notify_all();
+    return *this;
+  }
+
+  void flush()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    ++flushCount;
+  }
+
+  /** @returns true if at least `size` bytes are written within `timeout` */
+  bool waitFor(std::size_t size, std::chrono::seconds timeout)
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    return cv.wait_for(lock, timeout, [&]() { return stream.buffer.size() >= size; });
+  }
+
+  std::size_t size()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stream.buffer.size();
+  }
+};
+
+struct ThrowingStream
+{
+  ThrowingStream& write(const char*, std::streamsize)
+  {
+    throw std::runtime_error("write failed");
+  }
+};
+
+} // namespace
+
+TEST_CASE("consume_in_background")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+  SyncStream out;
+
+  binlog::BackgroundConsumer::Options options;
+  options.maxPollInterval = std::chrono::milliseconds(1);
+  binlog::BackgroundConsumer consumer(session, out, options);
+
+  BINLOG_INFO_W(writer, "Hello {}", 1);
+  CHECK(out.waitFor(1, std::chrono::seconds(10)));
+
+  BINLOG_INFO_W(writer, "Hello {}", 2);
+  BINLOG_INFO_W(writer, "Hello {}", 3);
+  consumer.stop();
+
+  CHECK(consumer.totalBytesConsumed() == out.size());
+  CHECK(out.flushCount == 1);
+  CHECK(streamToEvents(out.stream, "%m") == std::vector<std::string>{"Hello 1", "Hello 2", "Hello 3"});
+
+  // stop is idempotent
+  consumer.stop();
+}
+
+TEST_CASE("stop_consumes_everything")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+  SyncStream out;
+
+  binlog::BackgroundConsumer::Options options;
+  options.minPollInterval = std::chrono::hours(1);
+  options.maxPollInterval = std::chrono::hours(1);
+
+  std::vector<std::string> expected;
+  {
+    binlog::BackgroundConsumer consumer(session, out, options);
+    for (int i = 0; i < 100; ++i)
+    {
+      BINLOG_INFO_W(writer, "Hello {}", i);
+      expected.push_back("Hello " + std::to_string(i));
+    }
+  } // destructor stops
+
+  CHECK(streamToEvents(out.stream, "%m") == expected);
+}
+
+TEST_CASE("wakeup_at_watermark")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+  writer.setWakeupWatermark(2048);
+  SyncStream out;
+
+  BINLOG_INFO_W(writer, "Hello");
+
+  // without wakeups, nothing would be consumed for an hour
+  binlog::BackgroundConsumer::Options options;
+  options.minPollInterval = std::chrono::hours(1);
+  options.maxPollInterval = std::chrono::hours(1);
+  binlog::BackgroundConsumer consumer(session, out, options);
+
+  // the first poll happens when the consumer starts
+  CHECK(out.waitFor(1, std::chrono::seconds(10)));
+  const std::size_t initialSize = out.size();
+
+  // fill the queue above the watermark
+  const std::string payload(100, 'x');
+  for (int i = 0; i < 30; ++i)
+  {
+    BINLOG_INFO_W(writer, "{}", payload);
+  }
+
+  CHECK(out.waitFor(initialSize + 2048, std::chrono::seconds(10)));
+  consumer.stop();
+}
+
+TEST_CASE("consumer_error")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+  ThrowingStream out;
+
+  binlog::BackgroundConsumer consumer(session, out);
+  BINLOG_INFO_W(writer, "Hello");
+
+  CHECK_THROWS_AS(consumer.stop(), std::runtime_error);
+}
+
+TEST_CASE("load_shedding")
+{
+  binlog::Session session;
+  session.setCategoryMinSeverity("db", binlog::Severity::debug);
+  binlog::SessionWriter writer(session, 1024);
+  SyncStream out;
+
+  binlog::BackgroundConsumer::Options options;
+  options.maxPollInterval = std::chrono::milliseconds(1);
+  options.shedQueueFill = 0.5;
+  options.shedCategoryMinSeverity = {{"net", binlog::Severity::error}};
+  options.restoreDelay = std::chrono::milliseconds(50);
+
+  // fill the queue before the consumer starts
+  for (int i = 0; i < 30; ++i) { BINLOG_INFO_W(writer, "Hello {}", i); }
+
+  binlog::BackgroundConsumer consumer(session, out, options);
+  for (int i = 0; i < 1000 && ! consumer.isShedding(); ++i)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  // either still shedding, or already restored: wait for the restore
+  for (int i = 0; i < 10000 && consumer.isShedding(); ++i)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  CHECK(! consumer.isShedding());
+  CHECK(session.minSeverity() == binlog::Severity::trace);
+  CHECK(session.categoryMinSeverities() == std::map<std::string, binlog::Severity>{{"db", binlog::Severity::debug}});
+
+  consumer.stop();
+
+  const std::vector<std::string> events = streamToEvents(out.stream, "%C %m");
+  REQUIRE(events.size() == 32);
+  CHECK(events[30] == "binlog Load shedding started, a queue was 70% full, min severity raised to WARN");
+  CHECK(events[31] == "binlog Load shedding stopped, min severity restored to TRAC");
+}
+
+TEST_CASE("load_shedding_raises_severities")
+{
+  binlog::Session session;
+  session.setCategoryMinSeverity("db", binlog::Severity::debug);
+  binlog::SessionWriter writer(session, 1024);
+  SyncStream out;
+
+  binlog::BackgroundConsumer::Options options;
+  options.maxPollInterval = std::chrono::milliseconds(1);
+  options.shedQueueFill = 0.5;
+  options.shedCategoryMinSeverity = {{"net", binlog::Severity::error}};
+  options.restoreDelay = std::chrono::hours(1);
+
+  for (int i = 0; i < 30; ++i) { BINLOG_INFO_W(writer, "Hello {}", i); }
+
+  binlog::BackgroundConsumer consumer(session, out, options);
+  for (int i = 0; i < 10000 && ! consumer.isShedding(); ++i)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  REQUIRE(consumer.isShedding());
+  CHECK(session.minSeverity() == binlog::Severity::warning);
+  CHECK(session.categoryMinSeverities() == std::map<std::string, binlog::Severity>{
+    {"db", binlog::Severity::warning}, {"net", binlog::Severity::error}
+  });
+
+  // restored on stop
+  consumer.stop();
+  CHECK(session.minSeverity() == binlog::Severity::trace);
+  CHECK(session.categoryMinSeverities() == std::map<std::string, binlog::Severity>{{"db", binlog::Severity::debug}});
+}
@@ -0,0 +1,154 @@
+#include <binlog/BlockStream.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/detail/Crc32c.hpp>
+
+#include <doctest/doctest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int eventCount = 20; // per writer, consumed in 4 batches
+
+std::string writeBlocks()
+{
+  binlog::Session session;
+  session.setClockSync(binlog::ClockSync{0, 1000000000, 0, 0, "UTC"});
+  binlog::SessionWriter writerA(session, 4096, 1, "A");
+  binlog::SessionWriter writerB(session, 4096, 2, "B");
+  const std::uint64_t a = addEventSource<int>(session, binlog::Severity::info, "main", "a {}");
+  const std::uint64_t b = addEventSource<int>(session, binlog::Severity::info, "main", "b {}");
+
+  std::ostringstream stream;
+  binlog::BlockOutputStream output(stream);
+  for (int i = 0; i < eventCount; ++i)
+  {
+    const std::uint64_t clock = std::uint64_t(i + 1) * 1000;
+    CHECK(writerA.addEvent(a, clock, i));
+    CHECK(writerB.addEvent(b, clock + 1, i));
+    if (i % (eventCount / 4) == eventCount / 4 - 1)
+    {
+      session.consume(output);
+      output.flush();
+    }
+  }
+  return stream.str();
+}
+
+/** @returns the messages of writeBlocks: each batch has the events of A, then of B */
+std::vector<std::string> expectedEvents()
+{
+  std::vector<std::string> result;
+  for (int batch = 0; batch < 4; ++batch)
+  {
+    for (const char* name : {"a", "b"})
+    {
+      for (int i = batch * (eventCount / 4); i < (batch + 1) * (eventCount / 4); ++i)
+      {
+        result.push_back(std::string(name) + " " + std::to_string(i));
+      }
+    }
+  }
+  return result;
+}
+
+std::vector<std::size_t> blockOffsets(const std::string& stream)
+{
+  std::vector<std::size_t> result;
+  for (std::size_t pos = binlog::findBlock(stream.data(), stream.size(), 0); pos < stream.size();
+       pos = binlog::findBlock(stream.data(), stream.size(), pos + 1))
+  {
+    result.push_back(pos);
+  }
+  return result;
+}
+
+} // namespace
+
+TEST_CASE("crc32c")
+{
+  const std::string input = "123456789";
+  CHECK(binlog::detail::crc32c(input.data(), input.size()) == 0xE3069283);
+
+  // continued
+  const std::uint32_t crc = binlog::detail::crc32c(input.data(), 4);
+  CHECK(binlog::detail::crc32c(input.data() + 4, 5, crc) == 0xE3069283);
+
+  const std::string longer(1000, 'x');
+  CHECK(binlog::detail::crc32c(longer.data(), longer.size())
+    == binlog::detail::crc32c(longer.data() + 3, longer.size() - 3, binlog::detail::crc32c(longer.data(), 3)));
+}
+
+TEST_CASE("block_roundtrip")
+{
+  const std::string stream = writeBlocks();
+
+  binlog::BlockEntryStream entryStream(binlog::Range{stream.data(), stream.size()});
+  CHECK(streamToEvents(entryStream, "%m") == expectedEvents());
+  CHECK(entryStream.skippedBytes() == 0);
+}
+
+TEST_CASE("block_headers")
+{
+  const std::string stream = writeBlocks();
+
+  // per batch: metadata, writer A, writer B
+  const std::vector<std::size_t> offsets = blockOffsets(stream);
+  REQUIRE(offsets.size() >= 9);
+
+  std::size_t writerBlocks = 0;
+  for (std::size_t offset : offsets)
+  {
+    binlog::BlockHeader header;
+    REQUIRE(binlog::readBlockHeader(binlog::Range{stream.data() + offset, stream.size() - offset}, header));
+    if (header.writerId == 1 || header.writerId == 2)
+    {
+      ++writerBlocks;
+      CHECK(header.firstClock % 1000 == header.writerId - 1);
+      CHECK(header.lastClock - header.firstClock == 4000); // 5 events per writer and batch
+    }
+  }
+  CHECK(writerBlocks == 8);
+}
+
+TEST_CASE("block_damaged")
+{
+  std::string stream = writeBlocks();
+
+  // damage the last block
+  const std::vector<std::size_t> offsets = blockOffsets(stream);
+  REQUIRE(! offsets.empty());
+  stream[offsets.back() + 50] ^= 0x55;
+
+  binlog::BlockEntryStream entryStream(binlog::Range{stream.data(), stream.size()});
+  const std::vector<std::string> events = streamToEvents(entryStream, "%m");
+  CHECK(entryStream.skippedBytes() == stream.size() - offsets.back());
+
+  // the events of the damaged block are dropped, only them
+  std::vector<std::string> expected = expectedEvents();
+  expected.resize(expected.size() - 5);
+  CHECK(events == expected);
+}
+
+TEST_CASE("block_resync")
+{
+  std::string stream = writeBlocks();
+
+  // damage the header of the first block: reading resumes at the second one
+  const std::vector<std::size_t> offsets = blockOffsets(stream);
+  REQUIRE(offsets.size() >= 2);
+  stream[offsets.front() + 1] ^= 0x55;
+  CHECK(binlog::findBlock(stream.data(), stream.size(), 0) == offsets[1]);
+
+  binlog::BlockEntryStream entryStream(binlog::Range{stream.data(), stream.size()});
+  CHECK(entryStream.nextEntryPayload().size() != 0);
+  CHECK(entryStream.skippedBytes() == offsets[1]);
+}
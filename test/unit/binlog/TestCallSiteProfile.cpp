@@ -0,0 +1,78 @@
+// The log statements of this file are profiled
+#define BINLOG_CALL_SITE_PROFILING
+
+#include <binlog/CallSiteProfile.hpp>
+
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/advanced_log_macros.hpp>
+
+#include <doctest/doctest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+void logSmall(binlog::SessionWriter& writer, int i)
+{
+  BINLOG_INFO_WC(writer, profile, "small {}", i);
+}
+
+void logLarge(binlog::SessionWriter& writer, const std::string& str)
+{
+  BINLOG_INFO_WC(writer, profile, "large {}", str);
+}
+
+/** @returns the profile of the log statement with `format` */
+binlog::CallSiteProfile findProfile(const char* format)
+{
+  const std::vector<binlog::CallSiteProfile> profiles = binlog::callSiteProfiles();
+  const auto it = std::find_if(profiles.begin(), profiles.end(), [format](const binlog::CallSiteProfile& p)
+  {
+    return std::strcmp(p.source->formatString, format) == 0;
+  });
+  return (it != profiles.end()) ? *it : binlog::CallSiteProfile{};
+}
+
+} // namespace
+
+TEST_CASE("call_site_profile")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 1 << 20);
+
+  for (int i = 0; i < 100; ++i) { logSmall(writer, i); }
+
+  // the events of a thread are kept after the thread exits
+  std::thread thread([&session]()
+  {
+    binlog::SessionWriter threadWriter(session, 1 << 20);
+    for (int i = 0; i < 10; ++i) { logLarge(threadWriter, std::string(4096, 'x')); }
+  });
+  thread.join();
+
+  const binlog::CallSiteProfile small = findProfile("small {}");
+  REQUIRE(small.source != nullptr);
+  CHECK(std::strcmp(small.source->function, "logSmall") == 0);
+  CHECK(small.count == 100);
+  CHECK(small.maxTicks <= small.totalTicks);
+  CHECK(std::accumulate(small.histogram.begin(), small.histogram.end(), std::uint64_t{0}) == small.count);
+
+  const binlog::CallSiteProfile large = findProfile("large {}");
+  REQUIRE(large.source != nullptr);
+  CHECK(large.count == 10);
+  CHECK(std::accumulate(large.histogram.begin(), large.histogram.end(), std::uint64_t{0}) == large.count);
+
+  // sorted by total cost
+  const std::vector<binlog::CallSiteProfile> profiles = binlog::callSiteProfiles();
+  CHECK(std::is_sorted(profiles.begin(), profiles.end(), [](const binlog::CallSiteProfile& a, const binlog::CallSiteProfile& b)
+  {
+    return a.totalTicks > b.totalTicks;
+  }));
+}
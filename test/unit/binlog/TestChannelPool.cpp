@@ -0,0 +1,116 @@
+#include <binlog/ChannelPool.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/advanced_log_macros.hpp>
+
+#include <doctest/doctest.h>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct CountingAllocator : binlog::HeapChannelAllocator
+{
+  std::size_t allocations = 0;
+  std::size_t deallocations = 0;
+
+  char* allocate(std::size_t size) override
+  {
+    ++allocations;
+    return HeapChannelAllocator::allocate(size);
+  }
+
+  void deallocate(char* block, std::size_t size) noexcept override
+  {
+    ++deallocations;
+    HeapChannelAllocator::deallocate(block, size);
+  }
+};
+
+} // namespace
+
+TEST_CASE("preallocate_and_release")
+{
+  auto upstream = std::make_shared<CountingAllocator>();
+
+  {
+    binlog::ChannelPool pool(128, 3, 2, upstream);
+    CHECK(upstream->allocations == 6);
+    CHECK(pool.freeBlockCount() == 6);
+  }
+
+  CHECK(upstream->deallocations == 6);
+}
+
+TEST_CASE("recycle_blocks")
+{
+  auto upstream = std::make_shared<CountingAllocator>();
+  auto pool = std::make_shared<binlog::ChannelPool>(128, 2, 1, upstream);
+
+  const std::size_t size = binlog::Session::Channel::allocationSize(128);
+  char* block1 = pool->allocate(size);
+  CHECK(pool->freeBlockCount() == 1);
+
+  // class is exhausted, allocate from upstream
+  char* block2 = pool->allocate(size);
+  CHECK(upstream->allocations == 3);
+
+  pool->deallocate(block1, size);
+  pool->deallocate(block2, size);
+  CHECK(pool->freeBlockCount() == 3);
+  CHECK(upstream->deallocations == 0);
+
+  // reused in lifo order
+  CHECK(pool->allocate(size) == block2);
+  CHECK(pool->allocate(size - 1) == block1);
+  pool->deallocate(block1, size - 1);
+  pool->deallocate(block2, size);
+}
+
+TEST_CASE("smallest_fitting_class")
+{
+  auto upstream = std::make_shared<CountingAllocator>();
+  binlog::ChannelPool pool(128, 2, 1, upstream);
+
+  // fits the second class only
+  char* block = pool.allocate(binlog::Session::Channel::allocationSize(200));
+  CHECK(upstream->allocations == 2);
+  CHECK(pool.freeBlockCount() == 1);
+  pool.deallocate(block, binlog::Session::Channel::allocationSize(200));
+
+  // does not fit any class
+  const std::size_t largeSize = binlog::Session::Channel::allocationSize(1024);
+  block = pool.allocate(largeSize);
+  CHECK(upstream->allocations == 3);
+  pool.deallocate(block, largeSize);
+  CHECK(upstream->deallocations == 1);
+  CHECK(pool.freeBlockCount() == 2);
+}
+
+TEST_CASE("session_with_pool")
+{
+  auto upstream = std::make_shared<CountingAllocator>();
+  auto pool = std::make_shared<binlog::ChannelPool>(128, 2, 1, upstream);
+  binlog::Session session(pool);
+
+  {
+    binlog::SessionWriter writer(session, 128);
+    CHECK(pool->freeBlockCount() == 1);
+
+    BINLOG_INFO_W(writer, "Hello {}", 1);
+    BINLOG_INFO_W(writer, "Hello {}", 2);
+    CHECK(pool->freeBlockCount() == 1);
+  }
+
+  CHECK(getEvents(session, "%m") == std::vector<std::string>{"Hello 1", "Hello 2"});
+
+  // closed channels are returned to the pool by consume
+  CHECK(pool->freeBlockCount() == 2);
+  CHECK(upstream->allocations == 2);
+}
@@ -0,0 +1,157 @@
+#include <chunks.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/Entries.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+
+#include <doctest/doctest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring> // memcpy
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+/** @returns a logfile of events of two writers, consumed in multiple batches */
+std::string logEvents()
+{
+  binlog::Session session;
+  binlog::SessionWriter writerA(session, 4096);
+  binlog::SessionWriter writerB(session, 4096);
+  writerA.setName("A");
+  writerB.setName("B");
+  const std::uint64_t a = addEventSource<int>(session, binlog::Severity::info, "main", "A {}");
+  const std::uint64_t b = addEventSource<int, std::string>(session, binlog::Severity::warning, "main", "B {} {}");
+
+  // a string argument that looks like a sequence of entries: a size prefix and the tag of an event
+  std::string fake;
+  for (int i = 0; i < 10; ++i)
+  {
+    const std::uint32_t size = 16;
+    const std::uint64_t tag = 1;
+    fake.append(reinterpret_cast<const char*>(&size), sizeof(size));
+    fake.append(reinterpret_cast<const char*>(&tag), sizeof(tag));
+    fake.append(8, '\0');
+  }
+
+  std::ostringstream stream;
+  for (int i = 0; i < 300; ++i)
+  {
+    const std::uint64_t clock = std::uint64_t(i);
+    CHECK(writerA.addEvent(a, clock, i));
+    if (i % 3 == 0) { CHECK(writerB.addEvent(b, clock, i, fake)); }
+    if (i % 17 == 16) { session.consume(stream); }
+  }
+  session.consume(stream);
+  return stream.str();
+}
+
+struct Entries
+{
+  std::vector<std::size_t> offsets;  // of every entry
+  std::vector<std::size_t> metadata; // of the special entries
+  std::size_t end = 0;               // after the last valid entry
+};
+
+/** Read the entries of [data, data+size) sequentially */
+Entries readEntries(const char* data, std::size_t size)
+{
+  Entries result;
+  std::size_t offset = 0;
+  while (size - offset >= sizeof(std::uint32_t) + sizeof(std::uint64_t))
+  {
+    std::uint32_t entrySize = 0;
+    memcpy(&entrySize, data + offset, sizeof(entrySize));
+    if (entrySize > size - offset - sizeof(entrySize)) { break; }
+
+    result.offsets.push_back(offset);
+    const std::uint64_t tag = entryTag(data, offset);
+    if ((tag >> 63) != 0 && tag != binlog::CompactEvents::Tag) { result.metadata.push_back(offset); }
+    offset += sizeof(entrySize) + entrySize;
+  }
+  result.end = offset;
+  return result;
+}
+
+/** Check that `chunks` cover the entries of `expected` in order */
+void checkChunks(const char* data, const std::vector<EntryChunk>& chunks, const Entries& expected)
+{
+  std::size_t offset = 0;
+  std::vector<std::size_t> metadata;
+  for (const EntryChunk& chunk : chunks)
+  {
+    CHECK(chunk.begin == offset);
+    offset = chunk.end;
+    metadata.insert(metadata.end(), chunk.metadata.begin(), chunk.metadata.end());
+  }
+  CHECK(offset == expected.end);
+  CHECK(metadata == expected.metadata);
+  CHECK(! hasMetadata(data, chunks, binlog::DictionaryReference::Tag));
+  CHECK(hasMetadata(data, chunks, binlog::WriterProp::Tag));
+}
+
+} // namespace
+
+TEST_CASE("find_entry_boundary")
+{
+  const std::string logfile = logEvents();
+  const Entries entries = readEntries(logfile.data(), logfile.size());
+  REQUIRE(entries.end == logfile.size());
+
+  // the boundaries are found from the offsets before them,
+  // unless the fake entries of a string argument are found first
+  for (std::size_t i = 1; i < entries.offsets.size(); i += 37)
+  {
+    const std::size_t boundary = entries.offsets[i];
+    CHECK(findEntryBoundary(logfile.data(), logfile.size(), boundary) == boundary);
+
+    const std::size_t found = findEntryBoundary(logfile.data(), logfile.size(), entries.offsets[i - 1] + 1);
+    CHECK(found > entries.offsets[i - 1]);
+    CHECK(found <= boundary);
+  }
+
+  CHECK(findEntryBoundary(logfile.data(), logfile.size(), logfile.size() - 1) == logfile.size());
+}
+
+TEST_CASE("split_entries")
+{
+  const std::string logfile = logEvents();
+  const Entries entries = readEntries(logfile.data(), logfile.size());
+
+  // small chunks start in the fake entries of the string arguments as well
+  for (const std::size_t chunkSize : {std::size_t{7}, std::size_t{100}, std::size_t{1000}, std::size_t{1} << 20})
+  {
+    for (const std::size_t threadCount : {std::size_t{1}, std::size_t{4}})
+    {
+      const std::vector<EntryChunk> chunks = splitEntries(logfile.data(), logfile.size(), chunkSize, threadCount);
+      checkChunks(logfile.data(), chunks, entries);
+      REQUIRE(! chunks.empty());
+      CHECK(chunks.back().complete);
+    }
+  }
+}
+
+TEST_CASE("split_entries_incomplete")
+{
+  std::string logfile = logEvents();
+  logfile.resize(logfile.size() - 5); // truncate the last entry
+  const Entries entries = readEntries(logfile.data(), logfile.size());
+  REQUIRE(entries.end < logfile.size());
+
+  const std::vector<EntryChunk> chunks = splitEntries(logfile.data(), logfile.size(), 512, 3);
+  checkChunks(logfile.data(), chunks, entries);
+  REQUIRE(! chunks.empty());
+  CHECK(! chunks.back().complete);
+  for (std::size_t i = 0; i + 1 < chunks.size(); ++i) { CHECK(chunks[i].complete); }
+}
+
+TEST_CASE("split_entries_empty")
+{
+  const char* data = "";
+  CHECK(splitEntries(data, 0, 100, 2).empty());
+}
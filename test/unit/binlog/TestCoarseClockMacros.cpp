@@ -0,0 +1,98 @@
+#include <binlog/coarse_clock_macros.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/Time.hpp>
+
+#include <doctest/doctest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::uint64_t absDiff(std::uint64_t a, std::uint64_t b)
+{
+  return (a > b) ? a - b : b - a;
+}
+
+} // namespace
+
+TEST_CASE("coarse_clock_now")
+{
+  const std::uint64_t a = binlog::coarseClockNow();
+  const std::uint64_t b = binlog::coarseClockNow();
+  CHECK(a <= b);
+
+  // precise to the timer tick
+  const std::uint64_t ms100 = std::uint64_t(std::chrono::nanoseconds(std::chrono::milliseconds(100)).count());
+  CHECK(absDiff(binlog::coarseClockNow(), binlog::clockNow()) < ms100);
+}
+
+TEST_CASE("cached_clock_is_updated_by_consume")
+{
+  binlog::Session session;
+  std::ostringstream out;
+
+  const std::uint64_t before = binlog::clockNow();
+  session.consume(out);
+  const std::uint64_t cached = binlog::cachedClockNow();
+  const std::uint64_t after = binlog::clockNow();
+
+  CHECK(before <= cached);
+  CHECK(cached <= after);
+
+  // not updated until the next consume
+  CHECK(binlog::cachedClockNow() == cached);
+
+  binlog::updateCachedClock();
+  CHECK(cached <= binlog::cachedClockNow());
+}
+
+TEST_CASE("coarse_and_cached_macros")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+
+  BINLOG_INFO_COARSE_WC(writer, coarse, "Hello {}", std::string("coarse"));
+  BINLOG_INFO_CACHED_WC(writer, cached, "Hello {}", std::string("cached"));
+
+  session.setMinSeverity(binlog::Severity::warning);
+  BINLOG_INFO_COARSE_WC(writer, coarse, "Disabled");
+  BINLOG_INFO_CACHED_WC(writer, cached, "Disabled");
+  BINLOG_ERROR_COARSE_WC(writer, coarse, "Enabled");
+  BINLOG_ERROR_CACHED_WC(writer, cached, "Enabled");
+
+  const std::vector<std::string> expectedEvents{
+    "coarse INFO Hello coarse",
+    "cached INFO Hello cached",
+    "coarse ERRO Enabled",
+    "cached ERRO Enabled",
+  };
+  CHECK(getEvents(session, "%C %S %m") == expectedEvents);
+}
+
+TEST_CASE("coarse_and_cached_timestamps_use_system_clock_sync")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+
+  std::ostringstream out;
+  session.consume(out); // update the cached clock
+
+  const std::uint64_t before = binlog::cachedClockNow();
+  BINLOG_INFO_COARSE_WC(writer, main, "a");
+  BINLOG_INFO_CACHED_WC(writer, main, "b");
+
+  // %r: clock value, same as nanoseconds since epoch with systemClockSync
+  const std::vector<std::string> events = getEvents(session, "%r");
+  REQUIRE(events.size() == 2);
+  const std::uint64_t ms100 = std::uint64_t(std::chrono::nanoseconds(std::chrono::milliseconds(100)).count());
+  CHECK(absDiff(std::stoull(events[0]), before) < ms100);
+  CHECK(std::stoull(events[1]) == before);
+}
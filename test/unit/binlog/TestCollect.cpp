@@ -0,0 +1,152 @@
+#include <collect.hpp>
+
+#ifndef _WIN32
+
+#include "test_utils.hpp"
+
+#include <binlog/EntryStream.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/TcpSink.hpp>
+#include <binlog/advanced_log_macros.hpp>
+
+#include <doctest/doctest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio> // remove
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h> // NOLINT close
+
+namespace {
+
+std::string hello(const std::string& name)
+{
+  std::string result;
+  for (const std::uint32_t value : {binlog::tcpSinkMagic, binlog::tcpSinkVersion, std::uint32_t(name.size())})
+  {
+    result.append(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+  return result + name;
+}
+
+std::string entry(const std::string& payload)
+{
+  const std::uint32_t size = std::uint32_t(payload.size());
+  return std::string(reinterpret_cast<const char*>(&size), sizeof(size)) + payload;
+}
+
+std::vector<std::string> readEvents(const std::string& path)
+{
+  std::ifstream file(path, std::ios_base::in | std::ios_base::binary);
+  binlog::IstreamEntryStream entryStream(file);
+  return streamToEvents(entryStream, "%m");
+}
+
+} // namespace
+
+TEST_CASE("collector_stream")
+{
+  CollectorStream stream;
+  const std::string data = hello("host.42") + entry("first") + entry("second");
+
+  // hello split between receives
+  stream.receive(data.data(), 5);
+  CHECK(! stream.hasName());
+  stream.receive(data.data() + 5, data.size() - 5 - 3);
+  CHECK(stream.hasName());
+  CHECK(stream.name() == "host.42");
+
+  // only complete entries
+  CHECK(std::string(stream.unitData(), stream.unitSize()) == entry("first"));
+  stream.takeUnits();
+  CHECK(stream.unitSize() == 0);
+  stream.receive(data.data() + data.size() - 3, 3);
+  CHECK(std::string(stream.unitData(), stream.unitSize()) == entry("second"));
+
+  CollectorStream invalid;
+  const std::string garbage(16, 'x');
+  CHECK_THROWS_AS(invalid.receive(garbage.data(), garbage.size()), std::runtime_error);
+}
+
+TEST_CASE("collector_sanitize_name")
+{
+  CHECK(sanitizeName("host-1.example_com.42") == "host-1.example_com.42");
+  CHECK(sanitizeName("../etc/passwd") == "_.._etc_passwd");
+  CHECK(sanitizeName("") == "_");
+}
+
+TEST_CASE("tcp_sink_to_collector")
+{
+  const std::string path = "./binlog_test_collect.blog";
+  std::remove(path.data());
+
+  const int listenFd = listenTcp(0);
+  const std::uint16_t port = localPort(listenFd);
+  std::atomic<bool> stop{false};
+  std::thread collector([&]() { collect(listenFd, ".", stop); });
+
+  {
+    binlog::Session session;
+    binlog::SessionWriter writer(session, 4096);
+
+    binlog::TcpSink::Options options;
+    options.name = "binlog_test_collect";
+    binlog::TcpSink sink(session, "127.0.0.1", port, options);
+
+    for (int i = 0; i < 3; ++i)
+    {
+      BINLOG_INFO_W(writer, "Hello {}", i);
+      session.consume(sink);
+      sink.flush();
+    }
+    CHECK(sink.connected());
+    CHECK(sink.connectionCount() == 1);
+    CHECK(sink.droppedBytes() == 0);
+  }
+
+  // wait for the collector to write the events
+  const std::vector<std::string> expected{"Hello 0", "Hello 1", "Hello 2"};
+  std::vector<std::string> events;
+  for (int i = 0; i < 500 && events != expected; ++i)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    events = readEvents(path);
+  }
+  CHECK(events == expected);
+
+  stop = true;
+  collector.join();
+  close(listenFd);
+  std::remove(path.data());
+}
+
+TEST_CASE("tcp_sink_unreachable")
+{
+  // a port nobody listens on
+  const int listenFd = listenTcp(0);
+  const std::uint16_t port = localPort(listenFd);
+  close(listenFd);
+
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+
+  binlog::TcpSink::Options options;
+  options.maxBufferSize = 1;
+  binlog::TcpSink sink(session, "127.0.0.1", port, options);
+
+  BINLOG_INFO_W(writer, "Lost");
+  session.consume(sink);
+  sink.flush();
+
+  CHECK(! sink.connected());
+  CHECK(sink.droppedBytes() != 0);
+}
+
+#endif // _WIN32
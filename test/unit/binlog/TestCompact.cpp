@@ -0,0 +1,125 @@
+#include <compact.hpp>
+#include <printers.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/CompressedStream.hpp>
+#include <binlog/EntryStream.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/TimeIndex.hpp>
+
+#include <doctest/doctest.h>
+
+#include <algorithm> // is_sorted
+#include <chrono>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+/** @returns a logfile of 200 events of two writers, the events of B are consumed after the later events of A */
+std::string logEvents()
+{
+  binlog::Session session;
+  session.setClockSync(binlog::ClockSync{0, 1000000000, 0, 0, "UTC"});
+  binlog::SessionWriter writerA(session, 4096, 1, "A");
+  binlog::SessionWriter writerB(session, 4096, 2, "B");
+  const std::uint64_t order = addEventSource<int>(session, binlog::Severity::info, "orders", "Order {}");
+  const std::uint64_t route = addEventSource<int, std::string>(session, binlog::Severity::warning, "router", "Route {} {}");
+
+  std::ostringstream stream;
+  for (int i = 0; i < 100; ++i)
+  {
+    const std::uint64_t clock = std::uint64_t(i) * 2000000000;
+    CHECK(writerA.addEvent(order, clock + 1000000000, i));
+    CHECK(writerB.addEvent(route, clock, i, std::string("XNAS")));
+    if (i % 10 == 9) { session.consume(stream); }
+  }
+  return stream.str();
+}
+
+std::string compact(const CompactOptions& options, std::ostream* index = nullptr)
+{
+  std::istringstream input(logEvents());
+  binlog::IstreamEntryStream entryStream(input);
+  std::ostringstream output;
+  compactEntries(entryStream, output, index, options);
+  return output.str();
+}
+
+std::vector<std::string> events(const std::string& logfile)
+{
+  std::istringstream input(logfile);
+  binlog::IstreamEntryStream entryStream(input);
+  return streamToEvents(entryStream, "%d %n %m");
+}
+
+} // namespace
+
+TEST_CASE("compact_entries")
+{
+  const std::string result = compact(CompactOptions{});
+
+  CHECK(events(result) == events(logEvents()));
+  CHECK(result.size() < logEvents().size() * 2 / 3);
+
+  CompactOptions smallBatches;
+  smallBatches.blockSize = 100;
+  smallBatches.eventSourceTables = false;
+  CHECK(events(compact(smallBatches)) == events(logEvents()));
+}
+
+TEST_CASE("compact_entries_sorted")
+{
+  CompactOptions options;
+  options.sortByTime = true;
+  const std::vector<std::string> result = events(compact(options));
+
+  REQUIRE(result.size() == 200);
+
+  // writer B appears after the events of the first batch of A,
+  // its earlier events are still ordered by time (see mergeEvents)
+  CHECK(std::is_sorted(result.begin(), result.end()));
+}
+
+TEST_CASE("compact_entries_index")
+{
+  CompactOptions options;
+  options.blockSize = 256;
+  options.filterBits = 256;
+
+  std::stringstream indexStream;
+  const std::string logfile = compact(options, &indexStream);
+  const binlog::TimeIndex index = binlog::TimeIndex::read(indexStream);
+  REQUIRE(index.blocks.size() > 2);
+  CHECK(index.hasFilters());
+
+  // the index selects the events of the window from the compact logfile
+  const TimeWindow window{std::chrono::seconds(100), std::chrono::seconds(103)};
+  std::ostringstream output;
+  printEvents(logfile.data(), logfile.size(), index, output, "%n %m\n", "", window);
+  CHECK(output.str() == "A Order 50\nA Order 51\nB Route 50 XNAS\nB Route 51 XNAS\n");
+}
+
+#ifdef BINLOG_HAS_ZLIB
+
+TEST_CASE("compact_entries_compressed")
+{
+  CompactOptions options;
+  options.compressionLevel = 6;
+  options.blockSize = 1000;
+
+  std::stringstream index;
+  const std::string result = compact(options, &index);
+  CHECK(index.str().empty()); // compressed frames are not indexed
+
+  std::istringstream input(result);
+  binlog::CompressedEntryStream entryStream(input);
+  CHECK(streamToEvents(entryStream, "%d %n %m") == events(logEvents()));
+  CHECK(result.size() < compact(CompactOptions{}).size());
+}
+
+#endif // BINLOG_HAS_ZLIB
@@ -0,0 +1,293 @@
+#include <binlog/CompactOutputStream.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/Entries.hpp>
+#include <binlog/EntryStream.hpp>
+#include <binlog/EventStream.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/advanced_log_macros.hpp>
+#include <binlog/counter_macros.hpp>
+
+#include <mserialize/deserialize.hpp>
+
+#include <doctest/doctest.h>
+
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+/** @returns the entries consumed from a session with two writers */
+TestStream consumeEvents()
+{
+  binlog::Session session;
+  binlog::SessionWriter writerA(session, 4096, 1, "A");
+  binlog::SessionWriter writerB(session, 4096, 2, "B");
+
+  binlog::EventSource eventSource{
+    0, binlog::Severity::info, "cat", "fun", "file", 123, "a={} b={}", "i[c"
+  };
+  eventSource.id = session.addEventSource(eventSource);
+
+  TestStream stream;
+  for (std::uint64_t i = 0; i < 100; ++i)
+  {
+    const std::uint64_t clock = 1'000'000'000'000 + i * 10 - (i % 3); // not monotonic
+    CHECK(writerA.addEvent(eventSource.id, clock, int(i), std::string("x")));
+    CHECK(writerB.addEvent(eventSource.id, clock + 5, int(i), std::string("y")));
+    if (i % 10 == 0) { session.consume(stream); }
+  }
+  session.consume(stream);
+  return stream;
+}
+
+/** @returns the entries consumed from a session with a counter of `count` values, and an other event */
+TestStream consumeCounters(int count)
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 1 << 16, 1, "W");
+
+  TestStream stream;
+  for (int i = 0; i < count; ++i)
+  {
+    BINLOG_COUNTER_WC(writer, queue, "depth", 1'000'000'000 + (i % 7) - 3 * (i % 2));
+    if (i % 100 == 0) { BINLOG_INFO_WC(writer, queue, "i={}", i); }
+    if (i % 500 == 0) { session.consume(stream); }
+  }
+  session.consume(stream);
+  return stream;
+}
+
+} // namespace
+
+TEST_CASE("compact_empty")
+{
+  std::ostringstream stream;
+  {
+    binlog::CompactOutputStream output(stream);
+    output.flush();
+  }
+  CHECK(stream.str().empty());
+}
+
+TEST_CASE("compact_roundtrip")
+{
+  TestStream regular = consumeEvents();
+
+  std::stringstream stream;
+  {
+    binlog::CompactOutputStream output(stream);
+    output.write(regular.buffer.data(), std::streamsize(regular.buffer.size()));
+  } // flush by destructor
+
+  // a regular event takes 4+8+8+4+(4+1) = 29 bytes, a compact one about 13,
+  // metadata is not changed
+  CHECK(stream.str().size() * 10 < regular.buffer.size() * 6);
+
+  const std::vector<std::string> expected = streamToEvents(regular, "%r %n %m");
+  CHECK(expected.size() == 200);
+
+  binlog::IstreamEntryStream entryStream(stream);
+  CHECK(streamToEvents(entryStream, "%r %n %m") == expected);
+}
+
+TEST_CASE("compact_entry_split")
+{
+  TestStream regular = consumeEvents();
+
+  std::stringstream stream;
+  binlog::CompactOutputStream output(stream);
+  for (const char c : regular.buffer)
+  {
+    output.write(&c, 1);
+  }
+  output.flush();
+
+  const std::vector<std::string> expected = streamToEvents(regular, "%r %n %m");
+  binlog::IstreamEntryStream entryStream(stream);
+  CHECK(streamToEvents(entryStream, "%r %n %m") == expected);
+}
+
+TEST_CASE("compact_writerprop_batch_size")
+{
+  TestStream regular = consumeEvents();
+
+  std::stringstream stream;
+  {
+    binlog::CompactOutputStream output(stream);
+    output.write(regular.buffer.data(), std::streamsize(regular.buffer.size()));
+  }
+
+  // batchSize points to the next WriterProp, or the end of the stream
+  const std::string data = stream.str();
+  binlog::RangeEntryStream entryStream(binlog::Range(data.data(), data.size()));
+  std::size_t writerPropCount = 0;
+  while (true)
+  {
+    binlog::Range range = entryStream.nextEntryPayload();
+    if (range.empty()) { break; }
+
+    const std::uint64_t tag = range.read<std::uint64_t>();
+    if (tag == binlog::WriterProp::Tag)
+    {
+      ++writerPropCount;
+      binlog::WriterProp wp;
+      mserialize::deserialize(wp, range);
+      CHECK(wp.batchSize != 0);
+
+      // skip the batch
+      binlog::Range batch = entryStream.nextEntryPayload();
+      CHECK(batch.size() + sizeof(std::uint32_t) == wp.batchSize);
+      const std::uint64_t batchTag = batch.read<std::uint64_t>();
+      CHECK(batchTag == std::uint64_t(binlog::CompactEvents::Tag));
+    }
+  }
+  CHECK(writerPropCount == 22);
+}
+
+TEST_CASE("compact_invalid_version")
+{
+  std::string data;
+  const std::uint32_t size = 9;
+  const std::uint64_t tag = binlog::CompactEvents::Tag;
+  const std::uint8_t version = 99;
+  data.append(reinterpret_cast<const char*>(&size), sizeof(size));
+  data.append(reinterpret_cast<const char*>(&tag), sizeof(tag));
+  data.append(reinterpret_cast<const char*>(&version), sizeof(version));
+
+  binlog::RangeEntryStream entryStream(binlog::Range(data.data(), data.size()));
+  binlog::EventStream eventStream;
+  CHECK_THROWS_AS(eventStream.nextEvent(entryStream), std::runtime_error);
+}
+
+TEST_CASE("compact_counters")
+{
+  TestStream regular = consumeCounters(1000);
+
+  std::stringstream stream;
+  {
+    binlog::CompactOutputStream output(stream);
+    output.write(regular.buffer.data(), std::streamsize(regular.buffer.size()));
+  }
+
+  // a regular counter event takes 4+8+8+8 = 28 bytes, a compact one about 6
+  CHECK(stream.str().size() * 3 < regular.buffer.size());
+
+  const std::vector<std::string> expected = streamToEvents(regular, "%r %C %m");
+  CHECK(expected.size() == 1010);
+  CHECK(expected[0].substr(expected[0].find(' ')) == " queue depth=1000000000");
+  CHECK(expected[1].substr(expected[1].find(' ')) == " queue i=0");
+  CHECK(expected[2].substr(expected[2].find(' ')) == " queue depth=999999998");
+
+  binlog::IstreamEntryStream entryStream(stream);
+  CHECK(streamToEvents(entryStream, "%r %C %m") == expected);
+}
+
+TEST_CASE("compact_for_each_event")
+{
+  TestStream regular = consumeEvents();
+
+  std::stringstream stream;
+  {
+    binlog::CompactOutputStream output(stream);
+    output.write(regular.buffer.data(), std::streamsize(regular.buffer.size()));
+  }
+
+  // the events of the compact entries are passed one by one, with their writer
+  std::vector<std::string> expected;
+  {
+    binlog::EventStream eventStream;
+    while (const binlog::Event* event = eventStream.nextEvent(regular))
+    {
+      expected.push_back(eventStream.writerProp().name + std::to_string(event->clockValue));
+    }
+  }
+  CHECK(expected.size() == 200);
+
+  const std::string data = stream.str();
+  binlog::EventStream eventStream;
+  std::vector<std::string> actual;
+  eventStream.forEachEvent(binlog::Range(data.data(), data.size()), [&](const binlog::Event& event)
+  {
+    actual.push_back(eventStream.writerProp().name + std::to_string(event.clockValue));
+  });
+  CHECK(actual == expected);
+}
+
+TEST_CASE("compact_event_source_tables")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096, 1, "W");
+
+  TestStream regular;
+  for (int i = 0; i < 50; ++i)
+  {
+    const binlog::EventSource eventSource{
+      0, binlog::Severity::info, "category", "void app::process(const Request&)",
+      "/home/user/project/src/app/process.cpp", std::uint64_t(100 + i),
+      "request " + std::to_string(i) + " value={}", "i"
+    };
+    const std::uint64_t id = session.addEventSource(eventSource);
+    CHECK(writer.addEvent(id, std::uint64_t(i), i));
+    if (i % 10 == 9) { session.consume(regular); }
+  }
+
+  std::stringstream plain;
+  std::stringstream tables;
+  {
+    binlog::CompactOutputStream plainOutput(plain);
+    plainOutput.write(regular.buffer.data(), std::streamsize(regular.buffer.size()));
+
+    binlog::CompactOutputStream tablesOutput(tables);
+    tablesOutput.setEventSourceTables(true);
+    tablesOutput.write(regular.buffer.data(), std::streamsize(regular.buffer.size()));
+  }
+
+  // the shared strings of the sources are written once per table
+  CHECK(tables.str().size() * 2 < plain.str().size());
+
+  // no EventSource entries remain, one table per batch of sources
+  const std::string data = tables.str();
+  binlog::RangeEntryStream entryStream(binlog::Range(data.data(), data.size()));
+  std::size_t tableCount = 0;
+  while (true)
+  {
+    binlog::Range range = entryStream.nextEntryPayload();
+    if (range.empty()) { break; }
+
+    const std::uint64_t tag = range.read<std::uint64_t>();
+    CHECK(tag != std::uint64_t(binlog::EventSource::Tag));
+    if (tag == binlog::EventSourceTable::Tag) { ++tableCount; }
+  }
+  CHECK(tableCount == 5);
+
+  const std::vector<std::string> expected = streamToEvents(regular, "%n %S %C %M %F:%L %m");
+  CHECK(expected.size() == 50);
+  CHECK(expected[7] == "W INFO category void app::process(const Request&) /home/user/project/src/app/process.cpp:107 request 7 value=7");
+
+  binlog::IstreamEntryStream tablesStream(tables);
+  CHECK(streamToEvents(tablesStream, "%n %S %C %M %F:%L %m") == expected);
+}
+
+TEST_CASE("compact_event_source_table_invalid")
+{
+  std::string data;
+  const std::uint64_t tag = binlog::EventSourceTable::Tag;
+  const auto append = [&data](const char* p, std::size_t n) { data.append(p, n); };
+
+  // version 1, one string, one source referring to string 1
+  const char payload[] = {1, 1, 0, 1, 'a', 1, 1, 32, 0, 0, 0, 1, 0, 1};
+  const std::uint32_t size = std::uint32_t(sizeof(tag) + sizeof(payload));
+  append(reinterpret_cast<const char*>(&size), sizeof(size));
+  append(reinterpret_cast<const char*>(&tag), sizeof(tag));
+  append(payload, sizeof(payload));
+
+  binlog::RangeEntryStream entryStream(binlog::Range(data.data(), data.size()));
+  binlog::EventStream eventStream;
+  CHECK_THROWS_AS(eventStream.nextEvent(entryStream), std::runtime_error);
+}
@@ -0,0 +1,55 @@
+// The log statements of this file below the configured severities are removed
+#define BINLOG_COMPILE_MIN_SEVERITY info
+#define BINLOG_COMPILE_CATEGORY_MIN_SEVERITY {"verbose", binlog::Severity::trace}, {"quiet", binlog::Severity::error}
+
+#include <binlog/advanced_log_macros.hpp>
+#include <binlog/printf_log_macros.hpp>
+#include <binlog/sampled_log_macros.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/detail/CompileTimeSeverity.hpp>
+
+#include <doctest/doctest.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+int evaluated(int& count)
+{
+  return ++count;
+}
+
+} // namespace
+
+TEST_CASE("remove_statements_below_compile_time_severity")
+{
+  binlog::Session session;
+  session.setMinSeverity(binlog::Severity::trace);
+  binlog::SessionWriter writer(session);
+
+  int count = 0;
+  BINLOG_TRACE_W(writer, "main trace {}", evaluated(count));
+  BINLOG_DEBUG_W(writer, "main debug {}", evaluated(count));
+  BINLOG_INFO_W(writer, "main info {}", evaluated(count));
+  BINLOG_TRACE_WC(writer, verbose, "verbose trace {}", evaluated(count));
+  BINLOG_WARN_WC(writer, quiet, "quiet warning {}", evaluated(count));
+  BINLOG_ERROR_WC(writer, quiet, "quiet error {}", evaluated(count));
+  BINLOG_DEBUG_PRINTF_WC(writer, main, "printf debug %d", evaluated(count));
+  BINLOG_INFO_PRINTF_WC(writer, main, "printf info %d", evaluated(count));
+  BINLOG_DEBUG_EVERY_N_WC(writer, main, 1, "sampled debug {}", evaluated(count));
+  BINLOG_INFO_EVERY_N_WC(writer, main, 1, "sampled info {}", evaluated(count));
+
+  CHECK(count == 5); // arguments of removed statements are not evaluated
+  CHECK(getEvents(session, "%m") == std::vector<std::string>{
+    "main info 1",
+    "verbose trace 2",
+    "quiet error 3",
+    "printf info 4",
+    "sampled info 5 (0 suppressed)",
+  });
+}
@@ -0,0 +1,244 @@
+#ifdef BINLOG_HAS_ZLIB
+
+#include <binlog/CompressedStream.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/advanced_log_macros.hpp>
+
+#include <doctest/doctest.h>
+
+#include <cstdint>
+#include <cstring> // memcpy
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+TEST_CASE("compressed_empty")
+{
+  std::stringstream stream;
+  {
+    binlog::CompressedOutputStream output(stream);
+    output.flush();
+  }
+  CHECK(stream.str().empty());
+
+  binlog::CompressedEntryStream entryStream(stream);
+  CHECK(entryStream.nextEntryPayload().empty());
+}
+
+TEST_CASE("compressed_roundtrip")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+
+  std::stringstream stream;
+  std::vector<std::string> expected;
+  {
+    binlog::CompressedOutputStream output(stream);
+    for (int i = 0; i < 100; ++i)
+    {
+      BINLOG_INFO_W(writer, "Hello {} {}", i, std::string(100, 'x'));
+      expected.push_back("Hello " + std::to_string(i) + " " + std::string(100, 'x'));
+      if (i % 10 == 0)
+      {
+        session.consume(output);
+        output.flush();
+      }
+    }
+    session.consume(output);
+  } // flush by destructor
+
+  // compressed well
+  CHECK(stream.str().size() < 100 * 100 / 2);
+
+  // frames are independent
+  std::uint32_t magic;
+  memcpy(&magic, stream.str().data(), sizeof(magic));
+  CHECK(magic == binlog::compressedFrameMagic);
+
+  binlog::CompressedEntryStream entryStream(stream);
+  CHECK(streamToEvents(entryStream, "%m") == expected);
+}
+
+TEST_CASE("compressed_entry_spans_frames")
+{
+  const std::uint32_t size = 5;
+
+  std::stringstream stream;
+  {
+    binlog::CompressedOutputStream output(stream);
+    output.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    output.write("ab", 2);
+    output.flush();
+    output.write("cde", 3);
+  }
+
+  binlog::CompressedEntryStream entryStream(stream);
+  binlog::Range range = entryStream.nextEntryPayload();
+  REQUIRE(range.size() == size);
+  CHECK(std::string(range.view(size), size) == "abcde");
+  CHECK(entryStream.nextEntryPayload().empty());
+}
+
+TEST_CASE("compressed_incomplete")
+{
+  std::string frames;
+  {
+    std::ostringstream stream;
+    binlog::CompressedOutputStream output(stream);
+    const std::uint32_t size = 5;
+    output.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    output.write("ab", 2);
+    output.flush();
+    frames = stream.str();
+  }
+
+  SUBCASE("incomplete entry")
+  {
+    std::istringstream stream(frames);
+    binlog::CompressedEntryStream entryStream(stream);
+    CHECK_THROWS_AS(entryStream.nextEntryPayload(), std::runtime_error);
+  }
+
+  SUBCASE("incomplete frame")
+  {
+    std::istringstream stream(frames.substr(0, frames.size() - 1));
+    binlog::CompressedEntryStream entryStream(stream);
+    CHECK_THROWS_AS(entryStream.nextEntryPayload(), std::runtime_error);
+  }
+
+  SUBCASE("invalid magic")
+  {
+    std::istringstream stream("abcdefghijklmnopqrst");
+    binlog::CompressedEntryStream entryStream(stream);
+    CHECK_THROWS_AS(entryStream.nextEntryPayload(), std::runtime_error);
+  }
+}
+
+namespace {
+
+/** Log `count` events, consume them to `output`, `batchSize` events in a frame */
+template <typename Output>
+void logFrames(binlog::Session& session, binlog::SessionWriter& writer, Output& output, int count, int batchSize)
+{
+  for (int i = 0; i < count; ++i)
+  {
+    BINLOG_INFO_W(writer, "Order {} filled: {} @ {}", i, 100 + i % 7, std::string("XNAS"));
+    if (i % batchSize == batchSize - 1)
+    {
+      session.consume(output);
+      output.flush();
+    }
+  }
+}
+
+} // namespace
+
+TEST_CASE("compressed_dictionary")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+
+  std::ostringstream sample;
+  logFrames(session, writer, sample, 1000, 100);
+  const std::string dictionary = binlog::trainCompressionDictionary({sample.str()}, 4096);
+  CHECK(! dictionary.empty());
+  CHECK(dictionary.size() <= 4096);
+
+  // small frames, with and without dictionary
+  std::stringstream plain;
+  {
+    binlog::CompressedOutputStream output(plain);
+    session.reconsumeMetadata(output);
+    logFrames(session, writer, output, 100, 2);
+  }
+
+  std::stringstream stream;
+  {
+    binlog::CompressedOutputStream output(stream, 1, dictionary);
+    session.reconsumeMetadata(output);
+    logFrames(session, writer, output, 100, 2);
+  }
+
+  CHECK(stream.str().size() < plain.str().size() * 9 / 10);
+
+  SUBCASE("with dictionary")
+  {
+    binlog::CompressedEntryStream entryStream(stream);
+    entryStream.addDictionary(std::string("other dictionary"));
+    entryStream.addDictionary(dictionary);
+    const std::vector<std::string> events = streamToEvents(entryStream, "%m");
+    REQUIRE(events.size() == 100);
+    CHECK(events[0] == "Order 0 filled: 100 @ XNAS");
+    CHECK(events[99] == "Order 99 filled: 101 @ XNAS");
+  }
+
+  SUBCASE("without dictionary")
+  {
+    const std::string message = "Failed to decompress frame, compressed with an unknown dictionary, id: "
+      + std::to_string(binlog::compressionDictionaryId(dictionary));
+    binlog::CompressedEntryStream entryStream(stream);
+    CHECK_THROWS_WITH(entryStream.nextEntryPayload(), message.c_str());
+  }
+}
+
+TEST_CASE("compress_frame")
+{
+  const std::string data = "0123456789" + std::string(1000, 'x');
+  std::vector<char> frames;
+  binlog::compressFrame(data.data(), data.size(), frames);
+  const std::size_t firstSize = frames.size();
+  CHECK(firstSize < data.size() / 2);
+  binlog::compressFrame(data.data(), 10, frames, 9);
+
+  std::vector<char> out(1, 'a');
+  binlog::decompressFrame(frames.data(), firstSize, out);
+  binlog::decompressFrame(frames.data() + firstSize, frames.size() - firstSize, out);
+  CHECK(std::string(out.begin(), out.end()) == "a" + data + "0123456789");
+
+  std::vector<char> empty;
+  CHECK_THROWS_AS(binlog::decompressFrame(frames.data(), firstSize - 1, empty), std::runtime_error);
+  CHECK_THROWS_AS(binlog::decompressFrame(frames.data() + 1, firstSize - 1, empty), std::runtime_error);
+  CHECK(empty.empty());
+}
+
+TEST_CASE("flight_recorder_history_compressed")
+{
+  binlog::Session session;
+  session.setFlightRecorderHistory({std::size_t{1} << 20,
+    [](const char* data, std::size_t size, std::vector<char>& out) { binlog::compressFrame(data, size, out); },
+    [](const char* data, std::size_t size, std::vector<char>& out) { binlog::decompressFrame(data, size, out); }
+  });
+
+  binlog::SessionWriter writer(session, 4096);
+  writer.setFlightRecorder(true, binlog::Severity::no_logs);
+
+  TestStream stream;
+  std::vector<std::string> expected;
+  for (int i = 0; i < 1000; ++i)
+  {
+    BINLOG_INFO_W(writer, "Recorded {} {}", i, std::string(20, 'x'));
+    expected.push_back("Recorded " + std::to_string(i) + " " + std::string(20, 'x'));
+    if (i % 10 == 0) { session.consume(stream); }
+  }
+
+  // about 50 bytes per event: the history and the buffers of the consumer take much less
+  const binlog::Session::MemoryUsage usage = session.memoryUsage();
+  CHECK(usage.consumerBytes < 1000 * 50 / 4);
+
+  session.triggerFlightRecorder();
+  session.consume(stream);
+  CHECK(streamToEvents(stream, "%m") == expected);
+}
+
+TEST_CASE("train_compression_dictionary_no_repeats")
+{
+  CHECK(binlog::trainCompressionDictionary({}).empty());
+  CHECK(binlog::trainCompressionDictionary({std::string("abcdefghijklmnopqrstuvwxyz")}).empty());
+}
+
+#endif // BINLOG_HAS_ZLIB
@@ -5,6 +5,9 @@
 #include <binlog/Session.hpp>
 #include <binlog/SessionWriter.hpp>
 #include <binlog/advanced_log_macros.hpp>
+#include <binlog/detail/SerializationView.hpp>
+
+#include <mserialize/serialize.hpp>
 
 #include <doctest/doctest.h>
 
@@ -19,6 +22,22 @@ TEST_CASE("const_char_ptr_is_string")
   CHECK(getEvents(session, "%m") == std::vector<std::string>{"C string"});
 }
 
+TEST_CASE("const_char_ptr_measured_once")
+{
+  static_assert(binlog::detail::has_serialization_view<const char*>::value, "");
+  static_assert(! binlog::detail::has_serialization_view<int>::value, "");
+
+  // the view serializes to the same bytes
+  const char* str = "C string";
+  const auto view = binlog::detail::serialization_view(str);
+  CHECK(mserialize::serialized_size(view) == mserialize::serialized_size(str));
+
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 128);
+  BINLOG_INFO_W(writer, "{} {} {}", str, 123, std::string("x"));
+  CHECK(getEvents(session, "%m") == std::vector<std::string>{"C string 123 x"});
+}
+
 TEST_CASE("char_array_is_string")
 {
   binlog::Session session;
@@ -0,0 +1,92 @@
+#include <binlog/Constant.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/EventStream.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/advanced_log_macros.hpp>
+#include <binlog/sampled_log_macros.hpp>
+
+#include <mserialize/serialize.hpp>
+#include <mserialize/tag.hpp>
+
+#include <doctest/doctest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+TEST_CASE("constant_is_not_serialized")
+{
+  CHECK(mserialize::serialized_size(binlog::constant("fast")) == 0);
+  CHECK(mserialize::tag<binlog::Constant<int>>() == "");
+  CHECK(binlog::detail::foldConstants("a{} b{} c{}", 1, binlog::constant("x"), binlog::constant(-2)) == "a{} bx c-2");
+  CHECK(binlog::detail::foldConstants("a{:x} b{:>4} c{}", 1, binlog::constant("x"), 2) == "a{:x} bx c{}");
+}
+
+TEST_CASE("constant_log")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 256);
+
+  const std::string name = "engine";
+  constexpr std::uint8_t level = 3;
+  for (int i = 0; i < 2; ++i)
+  {
+    BINLOG_INFO_W(writer, "Mode: {}, i: {}, {} {} {} {}",
+      binlog::constant("fast"), i, binlog::constant(name), binlog::constant(level), binlog::constant(true), binlog::constant('c')
+    );
+  }
+
+  CHECK(getEvents(session, "%m") == std::vector<std::string>{
+    "Mode: fast, i: 0, engine 3 true c",
+    "Mode: fast, i: 1, engine 3 true c",
+  });
+}
+
+TEST_CASE("constant_event_size")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 256);
+
+  BINLOG_INFO_W(writer, "{} {}", binlog::constant("a long constant string, not in the event"), 1);
+  BINLOG_INFO_W(writer, "{}", 1);
+
+  TestStream stream;
+  session.consume(stream);
+  binlog::EventStream eventStream;
+
+  const binlog::Event* e1 = eventStream.nextEvent(stream);
+  REQUIRE(e1 != nullptr);
+  CHECK(e1->source->formatString == "a long constant string, not in the event {}");
+  CHECK(e1->source->argumentTags == "i");
+  const std::size_t size1 = e1->arguments.size();
+
+  const binlog::Event* e2 = eventStream.nextEvent(stream);
+  REQUIRE(e2 != nullptr);
+  CHECK(e2->arguments.size() == size1);
+}
+
+TEST_CASE("constant_args_evaluated_once")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 256);
+
+  int i = 0;
+  BINLOG_INFO_W(writer, "{} {}", binlog::constant(1), ++i);
+  CHECK(i == 1);
+
+  CHECK(getEvents(session, "%m") == std::vector<std::string>{"1 1"});
+}
+
+TEST_CASE("constant_sampled")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 256);
+
+  BINLOG_INFO_EVERY_N_WC(writer, main, 1, "{} {}", binlog::constant("c"), 7);
+
+  CHECK(getEvents(session, "%m") == std::vector<std::string>{"c 7 (0 suppressed)"});
+}
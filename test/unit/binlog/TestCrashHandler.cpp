@@ -0,0 +1,94 @@
+#include <binlog/CrashHandler.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/advanced_log_macros.hpp>
+
+#include <doctest/doctest.h>
+
+#include <cstddef>
+#include <cstdio>
+#include <ios>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+TEST_CASE("write_unconsumed")
+{
+  binlog::Session session;
+  binlog::SessionWriter writerA(session, 4096, 1, "A");
+  binlog::SessionWriter writerB(session, 4096, 2, "B");
+
+  BINLOG_INFO_W(writerA, "Hello {}", 1);
+  TestStream consumed;
+  session.consume(consumed); // not written below
+  BINLOG_INFO_W(writerA, "Hello {}", 2);
+  BINLOG_INFO_W(writerB, "Hello {}", 3);
+
+  TestStream dump;
+  session.writeUnconsumed([&dump](const char* data, std::size_t size)
+  {
+    dump.write(data, std::streamsize(size));
+  });
+  CHECK(streamToEvents(dump, "%n %m") == std::vector<std::string>{"A Hello 2", "B Hello 3"});
+
+  // the queues are not released
+  CHECK(getEvents(session, "%m") == std::vector<std::string>{"Hello 2", "Hello 3"});
+}
+
+#ifndef _WIN32
+
+namespace {
+
+bool g_previousHandlerCalled = false; // NOLINT
+
+void previousHandler(int) { g_previousHandlerCalled = true; }
+
+} // namespace
+
+TEST_CASE("crash_handler")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096, 1, "main");
+  BINLOG_INFO_W(writer, "Before crash {}", 123);
+
+  std::FILE* file = std::tmpfile();
+  REQUIRE(file != nullptr);
+
+  // handles the re-raised signal instead of terminating the test
+  struct sigaction test = {}; // NOLINT
+  struct sigaction original = {}; // NOLINT
+  test.sa_handler = &previousHandler; // NOLINT(cppcoreguidelines-pro-type-union-access)
+  sigemptyset(&test.sa_mask);
+  REQUIRE(sigaction(SIGFPE, &test, &original) == 0);
+
+  {
+    binlog::CrashHandler crashHandler(session, fileno(file));
+    CHECK_THROWS_AS(binlog::CrashHandler(session, fileno(file)), std::runtime_error);
+
+    raise(SIGFPE);
+    CHECK(g_previousHandlerCalled);
+  }
+
+  sigaction(SIGFPE, &original, nullptr);
+
+  // read the written stream
+  TestStream dump;
+  std::rewind(file);
+  char buffer[1024];
+  std::size_t size = 0;
+  while ((size = std::fread(buffer, 1, sizeof(buffer), file)) != 0)
+  {
+    dump.write(buffer, std::streamsize(size));
+  }
+  std::fclose(file);
+
+  CHECK(streamToEvents(dump, "%n %m") == std::vector<std::string>{"main Before crash 123"});
+
+  // can be installed again
+  binlog::CrashHandler another(session, -1);
+}
+
+#endif
@@ -61,6 +61,19 @@ TEST_CASE("several_args")
   CHECK(getEvents(session, "%m") == std::vector<std::string>{"Hello World a=1 b=true c=[2, 3, 4]"});
 }
 
+TEST_CASE("format_spec_args")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 128);
+
+  BINLOG_CREATE_SOURCE_AND_EVENT(
+    writer, binlog::Severity::info, category, 0, "x={:#x} f={:.3f} s={:>6}|",
+    255, 3.14159, std::string("abc")
+  );
+
+  CHECK(getEvents(session, "%m") == std::vector<std::string>{"x=0xff f=3.142 s=   abc|"});
+}
+
 TEST_CASE("severity_and_category")
 {
   binlog::Session session;
@@ -71,6 +84,20 @@ TEST_CASE("severity_and_category")
   CHECK(getEvents(session, "%S %C %m") == std::vector<std::string>{"INFO my_category Hello"});
 }
 
+TEST_CASE("named_placeholders")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 128);
+
+  BINLOG_CREATE_SOURCE_AND_EVENT(
+    writer, binlog::Severity::info, category, 0, "fill px={px:.2f} qty={qty} {}",
+    1.5, 100, std::string("XNAS")
+  );
+
+  CHECK(getEvents(session, "%m") == std::vector<std::string>{"fill px=1.50 qty=100 XNAS"});
+  CHECK(binlog::detail::placeholder_names("fill px={px:.2f} qty={qty} {}") == std::vector<std::string>{"px", "qty", ""});
+}
+
 TEST_CASE("location")
 {
   binlog::Session session;
@@ -182,3 +209,21 @@ static_assert(binlog::detail::count_placeholders("{} foo {} bar {}") == 3, "");
 static_assert(binlog::detail::count_placeholders("{}{}{}") == 3, "");
 static_assert(binlog::detail::count_placeholders("{{}{}{}}") == 3, "");
 static_assert(binlog::detail::count_placeholders("{}{}{}{}{}{}{}{}{}{}") == 10, "");
+static_assert(binlog::detail::count_placeholders("{:x} {:>10} {:.3f}") == 3, "");
+static_assert(binlog::detail::count_placeholders("{:}{:*^+#012.4e}") == 2, "");
+static_assert(binlog::detail::count_placeholders("{:q} {x-y} {1}") == 0, "");
+static_assert(binlog::detail::count_placeholders("{x} {px:>8} {_q1:.2f} {a b}") == 3, "");
+
+static_assert(binlog::detail::find_placeholder("a={} px={px} qty={qty:x}", "qty", 3) == 2, "");
+static_assert(binlog::detail::find_placeholder("a={} px={px} qty={qty:x}", "px", 2) == 1, "");
+static_assert(binlog::detail::find_placeholder("a={} px={px} qty={qty:x}", "p", 1) == std::size_t(-1), "");
+static_assert(binlog::detail::find_placeholder("a={} px={px} qty={qty:x}", "", 0) == std::size_t(-1), "");
+
+static_assert(binlog::detail::placeholders_valid("{} {:x} {:<8} {:.2} {:08.3f} {x} {"), "");
+static_assert(! binlog::detail::placeholders_valid("{:q}"), "");
+static_assert(! binlog::detail::placeholders_valid("{:x"), "");
+static_assert(! binlog::detail::placeholders_valid("{:.f}"), "");
+static_assert(binlog::detail::placeholders_valid("{px} {qty:>8} {a b} {px-qty}"), "");
+static_assert(! binlog::detail::placeholders_valid("{px} {px}"), "");
+static_assert(! binlog::detail::placeholders_valid("{px} {px:x}"), "");
+static_assert(! binlog::detail::placeholders_valid("{px:q}"), "");
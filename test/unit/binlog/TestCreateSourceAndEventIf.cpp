@@ -2,12 +2,14 @@
 
 #include "test_utils.hpp"
 
+#include <binlog/EventStream.hpp>
 #include <binlog/Session.hpp>
 #include <binlog/SessionWriter.hpp>
 #include <binlog/Severity.hpp>
 
 #include <doctest/doctest.h>
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -78,3 +80,114 @@ TEST_CASE("no_eval_if_disabled")
 
   CHECK(true); // if reached, we are fine.
 }
+
+TEST_CASE("category_min_severity")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+
+  const auto log = [&writer]()
+  {
+    BINLOG_CREATE_SOURCE_AND_EVENT_IF(writer, binlog::Severity::debug, noisy, 0, "noisy debug");
+    BINLOG_CREATE_SOURCE_AND_EVENT_IF(writer, binlog::Severity::info, noisy, 0, "noisy info");
+    BINLOG_CREATE_SOURCE_AND_EVENT_IF(writer, binlog::Severity::debug, quiet, 0, "quiet debug");
+    BINLOG_CREATE_SOURCE_AND_EVENT_IF(writer, binlog::Severity::info, quiet, 0, "quiet info");
+  };
+
+  session.setMinSeverity(binlog::Severity::info);
+  log();
+
+  // enable debug of a single category
+  session.setCategoryMinSeverity("quiet", binlog::Severity::debug);
+  log();
+
+  // disable a category
+  session.setCategoryMinSeverity("noisy", binlog::Severity::no_logs);
+  log();
+
+  session.resetCategoryMinSeverity("noisy");
+  session.resetCategoryMinSeverity("quiet");
+  log();
+
+  const std::vector<std::string> expectedEvents{
+    "noisy info", "quiet info",
+    "noisy info", "quiet debug", "quiet info",
+    "quiet debug", "quiet info",
+    "noisy info", "quiet info",
+  };
+  CHECK(getEvents(session, "%m") == expectedEvents);
+}
+
+TEST_CASE("source_enabled")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+
+  const auto log = [&writer]()
+  {
+    BINLOG_CREATE_SOURCE_AND_EVENT_IF(writer, binlog::Severity::info, category, 0, "a");
+    BINLOG_CREATE_SOURCE_AND_EVENT_IF(writer, binlog::Severity::info, category, 0, "b");
+  };
+
+  // consume the events logged since the last call, remember the source of "a"
+  TestStream stream;
+  binlog::EventStream eventStream;
+  std::uint64_t sourceIdOfA = 0;
+  const auto newEvents = [&]()
+  {
+    session.consume(stream);
+    std::vector<std::string> result;
+    while (const binlog::Event* event = eventStream.nextEvent(stream))
+    {
+      result.push_back(event->source->formatString);
+      if (result.back() == "a") { sourceIdOfA = event->source->id; }
+    }
+    return result;
+  };
+
+  log();
+  CHECK(newEvents() == std::vector<std::string>{"a", "b"});
+  REQUIRE(sourceIdOfA != 0);
+
+  // disable the source of "a" by its id
+  session.setSourceEnabled(sourceIdOfA, false);
+  log();
+  CHECK(newEvents() == std::vector<std::string>{"b"});
+
+  // enable it even if its severity is disabled
+  session.setMinSeverity(binlog::Severity::no_logs);
+  session.setSourceEnabled(sourceIdOfA, true);
+  log();
+  CHECK(newEvents() == std::vector<std::string>{"a"});
+
+  session.resetSourceEnabled(sourceIdOfA);
+  log();
+  CHECK(newEvents().empty());
+}
+
+TEST_CASE("call_site_of_two_sessions")
+{
+  binlog::Session session1;
+  binlog::SessionWriter writer1(session1, 4096);
+  binlog::Session session2;
+  binlog::SessionWriter writer2(session2, 4096);
+
+  session2.setMinSeverity(binlog::Severity::warning);
+
+  const auto log = [](binlog::SessionWriter& writer)
+  {
+    BINLOG_CREATE_SOURCE_AND_EVENT_IF(writer, binlog::Severity::info, category, 0, "info");
+  };
+
+  log(writer1);
+  log(writer2);
+  log(writer1);
+  session1.setMinSeverity(binlog::Severity::error);
+  log(writer1);
+  log(writer2);
+  session2.setMinSeverity(binlog::Severity::trace);
+  log(writer1);
+
+  CHECK(getEvents(session1, "%m") == std::vector<std::string>{"info", "info"});
+  CHECK(getEvents(session2, "%m").empty());
+}
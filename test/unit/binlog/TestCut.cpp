@@ -0,0 +1,165 @@
+#include <compact.hpp>
+#include <cut.hpp>
+#include <where.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/CompactOutputStream.hpp>
+#include <binlog/Entries.hpp>
+#include <binlog/EntryStream.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+
+#include <doctest/doctest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string logEvents()
+{
+  binlog::Session session;
+  session.setClockSync(binlog::ClockSync{0, 1000000000, 0, 0, "UTC"});
+  binlog::SessionWriter writerA(session, 4096, 1, "A");
+  binlog::SessionWriter writerB(session, 4096, 2, "B");
+  const std::uint64_t a = addEventSource<int>(session, binlog::Severity::info, "orders", "a {}");
+  const std::uint64_t b = addEventSource<int>(session, binlog::Severity::info, "router", "b {}");
+
+  std::ostringstream stream;
+  for (int i = 0; i < 5; ++i)
+  {
+    const std::uint64_t clock = std::uint64_t(i) * 1000000000;
+    CHECK(writerA.addEvent(a, clock, i));
+    CHECK(writerB.addEvent(b, clock, i));
+    session.consume(stream); // a WriterProp before each batch
+  }
+  return stream.str();
+}
+
+TestStream cut(const std::string& logfile, const CutSelection& selection, std::size_t expectedCount)
+{
+  std::istringstream input(logfile);
+  binlog::IstreamEntryStream entryStream(input);
+  std::ostringstream output;
+  CHECK(cutEvents(entryStream, output, selection) == expectedCount);
+
+  TestStream result;
+  const std::string str = output.str();
+  result.write(str.data(), std::streamsize(str.size()));
+  return result;
+}
+
+/** @returns the events of `stream`, without moving its read position */
+std::vector<std::string> events(TestStream& stream)
+{
+  const std::size_t readPos = stream.readPos;
+  std::vector<std::string> result = streamToEvents(stream, "%n %u %m");
+  stream.readPos = readPos;
+  return result;
+}
+
+} // namespace
+
+TEST_CASE("cut_everything")
+{
+  TestStream result = cut(logEvents(), CutSelection{}, 10);
+  CHECK(events(result).size() == 10);
+  CHECK(countTags(result, binlog::EventSource::Tag) == 2);
+  CHECK(countTags(result, binlog::ClockSync::Tag) == 1);
+}
+
+TEST_CASE("cut_window")
+{
+  CutSelection selection;
+  selection.window.from = std::chrono::seconds{1};
+  selection.window.to = std::chrono::seconds{2};
+
+  TestStream result = cut(logEvents(), selection, 4);
+  const std::vector<std::string> expected{
+    "A 1970.01.01 00:00:01 a 1",
+    "B 1970.01.01 00:00:01 b 1",
+    "A 1970.01.01 00:00:02 a 2",
+    "B 1970.01.01 00:00:02 b 2",
+  };
+  CHECK(events(result) == expected);
+}
+
+TEST_CASE("cut_writer")
+{
+  CutSelection selection;
+  selection.writerName = "B";
+
+  TestStream result = cut(logEvents(), selection, 5);
+  CHECK(events(result).size() == 5);
+  CHECK(countTags(result, binlog::EventSource::Tag) == 1); // only the source of b
+  CHECK(countTags(result, binlog::WriterProp::Tag) == 1);  // repeated WriterProp of B written once
+}
+
+TEST_CASE("cut_where")
+{
+  const WherePredicate where("category==orders && arg0>=3");
+  CutSelection selection;
+  selection.where = &where;
+
+  TestStream result = cut(logEvents(), selection, 2);
+  const std::vector<std::string> expected{
+    "A 1970.01.01 00:00:03 a 3",
+    "A 1970.01.01 00:00:04 a 4",
+  };
+  CHECK(events(result) == expected);
+  CHECK(countTags(result, binlog::EventSource::Tag) == 1);
+}
+
+TEST_CASE("cut_compact")
+{
+  const std::string regular = logEvents();
+  std::ostringstream compact;
+  {
+    binlog::CompactOutputStream output(compact);
+    output.write(regular.data(), std::streamsize(regular.size()));
+  }
+
+  CutSelection selection;
+  selection.window.from = std::chrono::seconds{3};
+
+  TestStream result = cut(compact.str(), selection, 4);
+  CHECK(countTags(result, binlog::CompactEvents::Tag) == 0);
+  const std::vector<std::string> expected{
+    "A 1970.01.01 00:00:03 a 3",
+    "B 1970.01.01 00:00:03 b 3",
+    "A 1970.01.01 00:00:04 a 4",
+    "B 1970.01.01 00:00:04 b 4",
+  };
+  CHECK(events(result) == expected);
+}
+
+TEST_CASE("cut_bcompact_output")
+{
+  // front coded event sources, see CompactOptions::eventSourceTables
+  std::istringstream input(logEvents());
+  binlog::IstreamEntryStream entryStream(input);
+  std::ostringstream compacted;
+  compactEntries(entryStream, compacted, nullptr, CompactOptions{});
+  const std::string logfile = compacted.str();
+  TestStream compactedStream;
+  compactedStream.write(logfile.data(), std::streamsize(logfile.size()));
+  CHECK(countTags(compactedStream, binlog::EventSourceTable::Tag) != 0);
+
+  const WherePredicate where("category==router");
+  CutSelection selection;
+  selection.window.to = std::chrono::seconds{1};
+  selection.where = &where;
+
+  TestStream result = cut(logfile, selection, 2);
+  const std::vector<std::string> expected{
+    "B 1970.01.01 00:00:00 b 0",
+    "B 1970.01.01 00:00:01 b 1",
+  };
+  CHECK(events(result) == expected);
+  CHECK(countTags(result, binlog::EventSourceTable::Tag) == 0);
+  CHECK(countTags(result, binlog::EventSource::Tag) == 1);
+}
@@ -0,0 +1,42 @@
+#include <binlog/Decimal.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/advanced_log_macros.hpp>
+
+#include <mserialize/serialize.hpp>
+#include <mserialize/tag.hpp>
+
+#include <doctest/doctest.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+TEST_CASE("decimal_tag")
+{
+  CHECK(mserialize::serialized_size(binlog::decimal<2>(12345)) == 8);
+  CHECK(mserialize::tag<binlog::Decimal<0>>() == "{binlog::Decimal<0>`value'l}");
+  CHECK(mserialize::tag<binlog::Decimal<2>>() == "{binlog::Decimal<2>`value'l}");
+  CHECK(mserialize::tag<binlog::Decimal<18>>() == "{binlog::Decimal<18>`value'l}");
+}
+
+TEST_CASE("decimal_log")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 128);
+
+  BINLOG_INFO_W(writer, "Price: {}", binlog::decimal<2>(12345));
+  BINLOG_INFO_W(writer, "{} {} {} {}",
+    binlog::decimal<4>(-5), binlog::decimal<0>(42), binlog::decimal<3>(1000), binlog::decimal<18>(INT64_MIN)
+  );
+  BINLOG_INFO_W(writer, "Prices: {}", std::vector<binlog::Decimal<1>>{{1}, {-25}});
+
+  CHECK(getEvents(session, "%m") == std::vector<std::string>{
+    "Price: 123.45",
+    "-0.0005 42 1.000 -9.223372036854775808",
+    "Prices: [0.1, -2.5]",
+  });
+}
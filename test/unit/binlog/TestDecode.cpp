@@ -0,0 +1,52 @@
+#include <binlog/Decode.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/EventStream.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/advanced_log_macros.hpp>
+
+#include <doctest/doctest.h>
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+TEST_CASE("decode_arguments")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+
+  for (int i = 0; i < 3; ++i)
+  {
+    BINLOG_INFO_W(writer, "Fill: {} @ {} {} {}", i, 1.5 * i, std::string("abc"), std::vector<std::uint16_t>{1, 2});
+  }
+  BINLOG_INFO_W(writer, "No arguments");
+
+  TestStream stream;
+  session.consume(stream);
+  binlog::EventStream eventStream;
+
+  for (int i = 0; i < 3; ++i)
+  {
+    const binlog::Event* event = eventStream.nextEvent(stream);
+    REQUIRE(event != nullptr);
+
+    const auto args = binlog::decode<int, double, std::string, std::vector<std::uint16_t>>(*event);
+    CHECK(std::get<0>(args) == i);
+    CHECK(std::get<1>(args) == 1.5 * i);
+    CHECK(std::get<2>(args) == "abc");
+    CHECK(std::get<3>(args) == std::vector<std::uint16_t>{1, 2});
+
+    // the tags must match exactly
+    CHECK_THROWS_AS(binlog::decode<int>(*event), std::runtime_error);
+    CHECK_THROWS_AS((binlog::decode<unsigned, double, std::string, std::vector<std::uint16_t>>(*event)), std::runtime_error);
+  }
+
+  const binlog::Event* event = eventStream.nextEvent(stream);
+  REQUIRE(event != nullptr);
+  CHECK(binlog::decode<>(*event) == std::tuple<>{});
+}
@@ -0,0 +1,82 @@
+#include <binlog/DeferredView.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/advanced_log_macros.hpp>
+
+#include <mserialize/tag.hpp>
+
+#include <doctest/doctest.h>
+
+#include <string>
+#include <vector>
+
+TEST_CASE("copy_on_consume")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 256);
+
+  const std::string snapshot = "Hello";
+  BINLOG_INFO_W(writer, "Snapshot: {}", binlog::deferred_view(snapshot.data(), snapshot.size()));
+
+  CHECK(getEvents(session, "%m") == std::vector<std::string>{"Snapshot: Hello"});
+}
+
+TEST_CASE("mixed_arguments")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 256);
+
+  const std::string a = "foo";
+  const std::string b = "barbaz";
+  const std::string empty;
+
+  BINLOG_INFO_W(writer, "First");
+  BINLOG_INFO_W(writer, "{} {} {} {} [{}] {}",
+    1, binlog::deferred_view(a.data(), a.size()), std::string("str"),
+    binlog::deferred_view(b.data(), b.size()), binlog::deferred_view(empty.data(), 0), 2.5
+  );
+  BINLOG_INFO_W(writer, "Last {}", std::string("regular"));
+
+  CHECK(getEvents(session, "%m") == std::vector<std::string>{
+    "First",
+    "1 foo str barbaz [] 2.5",
+    "Last regular",
+  });
+}
+
+TEST_CASE("deferred_after_wrap_around")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 256);
+
+  const std::string snapshot(40, 'x');
+
+  TestStream stream;
+  // add and consume enough events to make the data wrap around the end of the queue
+  for (int i = 0; i < 20; ++i)
+  {
+    BINLOG_INFO_W(writer, "{} {}", i, binlog::deferred_view(snapshot.data(), snapshot.size()));
+    BINLOG_INFO_W(writer, "{}", i);
+    session.consume(stream);
+  }
+
+  const std::vector<std::string> events = streamToEvents(stream, "%m");
+  REQUIRE(events.size() == 40);
+  CHECK(events[38] == "19 " + snapshot);
+  CHECK(events[39] == "19");
+}
+
+TEST_CASE("serialize_by_value")
+{
+  const std::string snapshot = "abc";
+  const binlog::DeferredView view = binlog::deferred_view(snapshot.data(), snapshot.size());
+
+  TestStream stream;
+  mserialize::serialize(view, stream);
+  CHECK(stream.buffer == std::vector<char>{3, 0, 0, 0, 'a', 'b', 'c'});
+  CHECK(mserialize::serialized_size(view) == 7);
+  CHECK(mserialize::tag<binlog::DeferredView>() == mserialize::tag<std::string>());
+}
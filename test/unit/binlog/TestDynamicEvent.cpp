@@ -0,0 +1,83 @@
+#include <binlog/DynamicEvent.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/TaskWriter.hpp>
+
+#include <doctest/doctest.h>
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+binlog::EventSource makeSource(std::string formatString, std::string argumentTags)
+{
+  return binlog::EventSource{
+    0, binlog::Severity::info, "script", "on_call", "script.lua", 12,
+    std::move(formatString), std::move(argumentTags)
+  };
+}
+
+} // namespace
+
+TEST_CASE("dynamic_event")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+
+  const binlog::DynamicEventSource source(session, makeSource("a={} b={} c={} d={} e={:.2f} f={}", "iL[cyd[c"));
+
+  const std::string str = "hello";
+  const binlog::DynamicArgument args[] = {-7, 42u, str, true, 2.0/3, "x"};
+  CHECK(source.addEvent(writer, 0, args, 6));
+
+  // numbers are converted to the tags of the source
+  const binlog::DynamicArgument args2[] = {3.9, std::int64_t(5), "", 0, 1, ""};
+  CHECK(source.addEvent(writer, 0, args2, 6));
+
+  CHECK(getEvents(session, "%C %F:%L %m") == std::vector<std::string>{
+    "script script.lua:12 a=-7 b=42 c=hello d=true e=0.67 f=x",
+    "script script.lua:12 a=3 b=5 c= d=false e=1.00 f=",
+  });
+}
+
+TEST_CASE("dynamic_event_task_writer")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096, 1, "thread");
+  const binlog::WriterProp context{2, "task", 0};
+  binlog::TaskWriter taskWriter(writer, context);
+
+  const binlog::DynamicEventSource source(session, makeSource("{}", "l"));
+  const binlog::DynamicArgument arg(123);
+  CHECK(source.addEvent(taskWriter, 0, &arg, 1));
+
+  CHECK(getEvents(session, "%n %m") == std::vector<std::string>{"task 123"});
+}
+
+TEST_CASE("dynamic_event_invalid_source")
+{
+  binlog::Session session;
+  CHECK_THROWS_AS(binlog::DynamicEventSource(session, makeSource("{}", "[i")), std::invalid_argument);
+  CHECK_THROWS_AS(binlog::DynamicEventSource(session, makeSource("{}", "(i)")), std::invalid_argument);
+  CHECK_THROWS_AS(binlog::DynamicEventSource(session, makeSource("{} {}", "i")), std::invalid_argument);
+  CHECK_THROWS_AS(binlog::DynamicEventSource(session, makeSource("{:q}", "i")), std::invalid_argument);
+}
+
+TEST_CASE("dynamic_event_invalid_args")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+  const binlog::DynamicEventSource source(session, makeSource("{} {}", "i[c"));
+
+  const binlog::DynamicArgument swapped[] = {"x", 1};
+  CHECK_THROWS_AS(source.addEvent(writer, 0, swapped, 2), std::invalid_argument);
+  CHECK_THROWS_AS(source.addEvent(writer, 0, swapped, 1), std::invalid_argument);
+
+  CHECK(getEvents(session, "%m").empty());
+}
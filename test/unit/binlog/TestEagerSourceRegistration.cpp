@@ -0,0 +1,89 @@
+// The event sources of this file are registered during static initialization
+#define BINLOG_EAGER_SOURCE_REGISTRATION
+
+#include <binlog/advanced_log_macros.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/Entries.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/Severity.hpp>
+#include <binlog/detail/EagerSourceRegistry.hpp>
+
+#include <doctest/doctest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+void neverCalled(binlog::SessionWriter& writer)
+{
+  BINLOG_INFO_WC(writer, eager, "Never called {}", 123);
+}
+
+bool contains(const std::vector<char>& buffer, const char* str)
+{
+  return std::search(buffer.begin(), buffer.end(), str, str + std::strlen(str)) != buffer.end();
+}
+
+} // namespace
+
+TEST_CASE("source_registered_before_first_call")
+{
+  // reference neverCalled, without calling it
+  void (*volatile f)(binlog::SessionWriter&) = neverCalled;
+  static_cast<void>(f);
+
+  CHECK(binlog::detail::EagerSourceRegistry::instance().size() != 0);
+
+  binlog::Session session;
+  TestStream stream;
+  session.consume(stream);
+  CHECK(contains(stream.buffer, "Never called {}"));
+  CHECK(countTags(stream, binlog::EventSource::Tag) >= 1);
+}
+
+TEST_CASE("event_of_eager_source")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+
+  BINLOG_WARN_WC(writer, eager, "Hello {}", std::string("World"));
+  BINLOG_CREATE_SOURCE_AND_EVENT(writer, binlog::Severity::info, eager, 0, "Plain {}", 1);
+
+  const std::vector<std::string> events = getEvents(session, "%I %S %m");
+  REQUIRE(events.size() == 2);
+
+  // eager ids are process wide, from a range disjoint from the session assigned ids
+  const std::uint64_t firstId = binlog::detail::EagerSourceRegistry::firstId;
+  CHECK(std::stoull(events[0]) >= firstId);
+  CHECK(std::stoull(events[1]) >= firstId);
+  CHECK(events[0].substr(events[0].find(' ')) == " WARN Hello World");
+  CHECK(events[1].substr(events[1].find(' ')) == " INFO Plain 1");
+}
+
+TEST_CASE("eager_severity_control")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+
+  auto log = [&writer]()
+  {
+    BINLOG_DEBUG_WC(writer, eager_control, "Debug");
+    BINLOG_INFO_WC(writer, eager_control, "Info");
+  };
+
+  // call sites are registered by the session on construction
+  session.setMinSeverity(binlog::Severity::info);
+  log();
+
+  session.setCategoryMinSeverity("eager_control", binlog::Severity::trace);
+  log();
+
+  CHECK(getEvents(session, "%m") == std::vector<std::string>{"Info", "Debug", "Info"});
+}
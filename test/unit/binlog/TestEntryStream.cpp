@@ -5,8 +5,22 @@
 #include <doctest/doctest.h>
 
 #include <cstdint>
+#include <cstdio> // remove
 #include <cstring> // strncmp
+#include <fstream>
 #include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+void writeFile(const std::string& path, const char* data, std::size_t size)
+{
+  std::ofstream file(path, std::ios_base::out | std::ios_base::binary);
+  file.write(data, std::streamsize(size));
+}
+
+} // namespace
 
 TEST_CASE("istream_empty")
 {
@@ -88,6 +102,106 @@ TEST_CASE("istream_incomplete_payload")
   CHECK(stream.tellg() == 4);
 }
 
+TEST_CASE("readahead_empty")
+{
+  std::istringstream stream;
+  binlog::ReadaheadEntryStream entryStream(stream);
+
+  const binlog::Range empty = entryStream.nextEntryPayload();
+  CHECK(empty.size() == 0);
+}
+
+TEST_CASE("readahead_two_entries")
+{
+  constexpr std::uint32_t size1 = 8;
+  const char payload1[size1] = "abcdefg";
+
+  constexpr std::uint32_t size2 = 4;
+  const char payload2[size2] = "hij";
+
+  std::stringstream stream;
+
+  stream.write(reinterpret_cast<const char*>(&size1), sizeof(size1));
+  stream.write(payload1, sizeof(payload1));
+
+  stream.write(reinterpret_cast<const char*>(&size2), sizeof(size2));
+  stream.write(payload2, sizeof(payload2));
+
+  binlog::ReadaheadEntryStream entryStream(stream);
+
+  binlog::Range range1 = entryStream.nextEntryPayload();
+  CHECK(strncmp(range1.view(size1), payload1, size1) == 0);
+
+  binlog::Range range2 = entryStream.nextEntryPayload();
+  CHECK(strncmp(range2.view(size2), payload2, size2) == 0);
+
+  const binlog::Range empty = entryStream.nextEntryPayload();
+  CHECK(empty.size() == 0);
+}
+
+TEST_CASE("readahead_entries_span_blocks")
+{
+  std::stringstream stream;
+  std::vector<std::string> payloads;
+  for (std::uint32_t size = 0; size < 20; ++size)
+  {
+    payloads.emplace_back(size, char('a' + size));
+    stream.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    stream.write(payloads.back().data(), std::streamsize(size));
+  }
+
+  // blocks smaller than the entries and their sizes
+  binlog::ReadaheadEntryStream entryStream(stream, 3);
+
+  for (const std::string& payload : payloads)
+  {
+    binlog::Range range = entryStream.nextEntryPayload();
+    REQUIRE(range.size() == payload.size());
+    CHECK(std::string(range.view(payload.size()), payload.size()) == payload);
+  }
+
+  const binlog::Range empty = entryStream.nextEntryPayload();
+  CHECK(empty.size() == 0);
+}
+
+TEST_CASE("readahead_incomplete_size")
+{
+  std::stringstream stream;
+  stream.write("ab", 2);
+
+  binlog::ReadaheadEntryStream entryStream(stream);
+
+  CHECK_THROWS_AS(entryStream.nextEntryPayload(), std::runtime_error);
+}
+
+TEST_CASE("readahead_incomplete_payload")
+{
+  constexpr std::uint32_t size1 = 4;
+  const char payload1[size1] = "abc";
+
+  constexpr std::uint32_t size2 = 8;
+  const char payload2[size2-1] = "abcdef";
+
+  std::stringstream stream;
+
+  stream.write(reinterpret_cast<const char*>(&size1), sizeof(size1));
+  stream.write(payload1, sizeof(payload1));
+
+  stream.write(reinterpret_cast<const char*>(&size2), sizeof(size2));
+  stream.write(payload2, std::streamsize(size2-1));
+
+  binlog::ReadaheadEntryStream entryStream(stream, 5);
+
+  binlog::Range range1 = entryStream.nextEntryPayload();
+  CHECK(strncmp(range1.view(size1), payload1, size1) == 0);
+
+  CHECK_THROWS_AS(entryStream.nextEntryPayload(), std::runtime_error);
+
+  // the incomplete entry is dropped
+  const binlog::Range empty = entryStream.nextEntryPayload();
+  CHECK(empty.size() == 0);
+}
+
 TEST_CASE("range_empty")
 {
   binlog::RangeEntryStream entryStream(binlog::Range{});
@@ -157,3 +271,84 @@ TEST_CASE("range_incomplete_payload")
 
   CHECK_THROWS_AS(entryStream.nextEntryPayload(), std::runtime_error);
 }
+
+TEST_CASE("mmap_empty")
+{
+  const std::string path = "binlog_test_entrystream_mmap_empty.blog";
+  writeFile(path, nullptr, 0);
+
+  {
+    binlog::MmapEntryStream entryStream(path);
+    CHECK(entryStream.nextEntryPayload().empty());
+  }
+
+  (void)std::remove(path.data());
+}
+
+TEST_CASE("mmap_two_entries")
+{
+  constexpr std::uint32_t size1 = 8;
+  const char payload1[size1] = "abcdefg";
+
+  constexpr std::uint32_t size2 = 4;
+  const char payload2[size2] = "hij";
+
+  TestStream stream;
+  stream.write(reinterpret_cast<const char*>(&size1), sizeof(size1));
+  stream.write(payload1, sizeof(payload1));
+  stream.write(reinterpret_cast<const char*>(&size2), sizeof(size2));
+  stream.write(payload2, sizeof(payload2));
+
+  const std::string path = "binlog_test_entrystream_mmap_two_entries.blog";
+  writeFile(path, stream.buffer.data(), stream.buffer.size());
+
+  {
+    binlog::MmapEntryStream entryStream(path);
+
+    binlog::Range range1 = entryStream.nextEntryPayload();
+    REQUIRE(range1.size() == size1);
+    CHECK(strncmp(range1.view(size1), payload1, size1) == 0);
+
+    binlog::Range range2 = entryStream.nextEntryPayload();
+    REQUIRE(range2.size() == size2);
+    CHECK(strncmp(range2.view(size2), payload2, size2) == 0);
+
+    CHECK(entryStream.nextEntryPayload().empty());
+  }
+
+  (void)std::remove(path.data());
+}
+
+TEST_CASE("mmap_incomplete_payload")
+{
+  constexpr std::uint32_t size = 8;
+  const char payload[size-1] = "abcdef";
+
+  TestStream stream;
+  stream.write(reinterpret_cast<const char*>(&size), sizeof(size));
+  stream.write(payload, std::streamsize(size-1));
+
+  const std::string path = "binlog_test_entrystream_mmap_incomplete.blog";
+  writeFile(path, stream.buffer.data(), stream.buffer.size());
+
+  {
+    binlog::MmapEntryStream entryStream(path);
+    CHECK_THROWS_AS(entryStream.nextEntryPayload(), std::runtime_error);
+    CHECK_THROWS_AS(entryStream.nextEntryPayload(), std::runtime_error); // state unchanged
+  }
+
+  writeFile(path, "ab", 2);
+
+  {
+    binlog::MmapEntryStream entryStream(path);
+    CHECK_THROWS_AS(entryStream.nextEntryPayload(), std::runtime_error);
+  }
+
+  (void)std::remove(path.data());
+}
+
+TEST_CASE("mmap_not_a_file")
+{
+  CHECK_THROWS_AS(binlog::MmapEntryStream("binlog_test_entrystream_no_such_file.blog"), std::runtime_error);
+  CHECK_THROWS_AS(binlog::MmapEntryStream("."), std::runtime_error);
+}
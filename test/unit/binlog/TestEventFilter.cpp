@@ -89,3 +89,40 @@ TEST_CASE("allow_some")
   };
   CHECK(filterEvents(session, filter) == expectedEvents2);
 }
+
+TEST_CASE("allow_sparse_source_ids")
+{
+  // sources of ids not allocated by Session, dense and sparse
+  TestStream input;
+  for (const std::uint64_t id : {std::uint64_t(3), std::uint64_t(4), std::uint64_t(1) << 40, (std::uint64_t(1) << 40) + 1})
+  {
+    binlog::EventSource source;
+    source.id = id;
+    source.formatString = "Hello";
+    binlog::serializeSizePrefixedTagged(source, input);
+  }
+
+  // events: id and clock
+  const std::uint64_t eventIds[] = {3, 4, 5, std::uint64_t(1) << 40, (std::uint64_t(1) << 40) + 1, 1000};
+  for (const std::uint64_t id : eventIds)
+  {
+    const std::uint32_t size = 2 * sizeof(std::uint64_t);
+    const std::uint64_t clock = 0;
+    input.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    input.write(reinterpret_cast<const char*>(&id), sizeof(id));
+    input.write(reinterpret_cast<const char*>(&clock), sizeof(clock));
+  }
+
+  // allow odd ids
+  binlog::EventFilter filter([](const binlog::EventSource& source) { return source.id % 2 == 1; });
+  TestStream output;
+  filter.writeAllowed(input.buffer.data(), input.buffer.size(), output);
+
+  CHECK(countTags(output, binlog::EventSource::Tag) == 4);
+  CHECK(countTags(output, 3) == 1);
+  CHECK(countTags(output, 4) == 0);
+  CHECK(countTags(output, 5) == 0); // no source
+  CHECK(countTags(output, std::uint64_t(1) << 40) == 0);
+  CHECK(countTags(output, (std::uint64_t(1) << 40) + 1) == 1);
+  CHECK(countTags(output, 1000) == 0);
+}
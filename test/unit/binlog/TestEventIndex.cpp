@@ -0,0 +1,122 @@
+#include <binlog/EventIndex.hpp>
+
+#include <binlog/Entries.hpp>
+#include <binlog/PrettyPrinter.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/create_source_and_event.hpp>
+
+#include "test_utils.hpp"
+
+#include <doctest/doctest.h>
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+void logClock(binlog::SessionWriter& writer, std::uint64_t clock)
+{
+  BINLOG_CREATE_SOURCE_AND_EVENT(writer, binlog::Severity::info, main, clock, "c{}", clock);
+}
+
+/** @returns a logfile of 1000 events, clocks 1..1000, by two writers, consumed in multiple batches */
+const std::vector<char>& logfile()
+{
+  static const std::vector<char> result = []()
+  {
+    binlog::Session session;
+    binlog::SessionWriter even(session, 4096, 0, "even");
+    binlog::SessionWriter odd(session, 4096, 1, "odd");
+
+    TestStream stream;
+    for (std::uint64_t clock = 1; clock <= 1000; ++clock)
+    {
+      logClock((clock % 2 == 0) ? even : odd, clock);
+      if (clock % 10 == 0) { session.consume(stream); }
+    }
+    return stream.buffer;
+  }();
+  return result;
+}
+
+std::uint64_t clockAt(binlog::EventIndex& index, std::size_t i)
+{
+  return index.eventAt(i).clockValue;
+}
+
+} // namespace
+
+TEST_CASE("empty_index")
+{
+  binlog::EventIndex index(binlog::Range{});
+  CHECK(index.size() == 0);
+  CHECK(index.findClock(0) == 0);
+}
+
+TEST_CASE("random_access")
+{
+  const std::vector<char>& data = logfile();
+  binlog::EventIndex index(binlog::Range(data.data(), data.size()));
+  REQUIRE(index.size() == 1000);
+
+  for (std::size_t i : {999u, 0u, 500u, 1u, 257u})
+  {
+    const binlog::Event& event = index.eventAt(i);
+    CHECK(event.source->formatString == "c{}");
+    CHECK(index.writerPropAt(i).name == ((event.clockValue % 2 == 0) ? "even" : "odd"));
+    CHECK(index.writerPropAt(i).id == event.clockValue % 2);
+    CHECK(index.clockSyncAt(i).clockFrequency != 0);
+  }
+
+  // each batch of ten: the even events first, then the odd ones
+  CHECK(clockAt(index, 0) == 2);
+  CHECK(clockAt(index, 4) == 10);
+  CHECK(clockAt(index, 5) == 1);
+  CHECK(clockAt(index, 999) == 999);
+}
+
+TEST_CASE("find_clock")
+{
+  const std::vector<char>& data = logfile();
+  binlog::EventIndex index(binlog::Range(data.data(), data.size()));
+
+  CHECK(index.findClock(0) == 0);
+  CHECK(index.findClock(1) == 0); // 2 is the first event reaching 1
+  CHECK(index.findClock(2) == 0);
+  CHECK(index.findClock(3) == 1);
+  CHECK(index.findClock(10) == 4);
+  CHECK(index.findClock(11) == 10);
+  CHECK(clockAt(index, index.findClock(601)) == 602);
+  CHECK(clockAt(index, index.findClock(602)) == 602);
+  CHECK(clockAt(index, index.findClock(1000)) == 1000);
+  CHECK(index.findClock(1001) == index.size());
+}
+
+TEST_CASE("event_line_cache")
+{
+  const std::vector<char>& data = logfile();
+  binlog::EventIndex index(binlog::Range(data.data(), data.size()));
+  binlog::PrettyPrinter printer("%n %m", "%Y");
+  binlog::EventLineCache lines(index, printer, 2);
+
+  CHECK(lines.line(0) == "even c2");
+  CHECK(lines.line(5) == "odd c1");
+  CHECK(lines.line(0) == "even c2");
+  CHECK(lines.line(999) == "odd c999"); // evicts 5
+  CHECK(lines.line(5) == "odd c1");
+  CHECK(lines.line(0) == "even c2");
+}
+
+TEST_CASE("index_rejects_compact_events")
+{
+  TestStream stream;
+  const std::uint32_t size = sizeof(std::uint64_t);
+  const std::uint64_t tag = binlog::CompactEvents::Tag;
+  stream.write(reinterpret_cast<const char*>(&size), sizeof(size));
+  stream.write(reinterpret_cast<const char*>(&tag), sizeof(tag));
+
+  CHECK_THROWS_AS(binlog::EventIndex(binlog::Range(stream.buffer.data(), stream.buffer.size())), std::runtime_error);
+}
@@ -0,0 +1,150 @@
+#include <binlog/EventQuota.hpp>
+
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/advanced_log_macros.hpp>
+
+#include "test_utils.hpp"
+
+#include <doctest/doctest.h>
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct QuotaAdapter
+{
+  binlog::EventQuota& quota;
+  Clock::time_point now;
+  TestStream stream;
+
+  QuotaAdapter& write(const char* buffer, std::streamsize size)
+  {
+    const std::size_t oldSize = stream.buffer.size();
+    const std::size_t writeSize = quota.writeAllowed(buffer, std::size_t(size), stream, now);
+    CHECK(oldSize + writeSize == stream.buffer.size());
+    return *this;
+  }
+};
+
+// "net" is limited to `bytesPerSecond`, other categories are unlimited
+binlog::EventQuota netQuota(std::uint64_t bytesPerSecond, std::uint32_t sampleOneIn = 0)
+{
+  return binlog::EventQuota(
+    {{"net", bytesPerSecond, sampleOneIn}},
+    [](const binlog::EventSource& source) -> std::size_t {
+      if (source.category == "net") { return 0; }
+      return binlog::EventQuota::noLimit;
+    }
+  );
+}
+
+} // namespace
+
+TEST_CASE("quota_drops_excess_events")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+
+  // each event is 4+8+8+4 = 24 bytes: two fit into the quota
+  binlog::EventQuota quota = netQuota(50);
+  QuotaAdapter adapter{quota, Clock::time_point{}, {}};
+
+  for (int i = 0; i < 5; ++i)
+  {
+    BINLOG_INFO_WC(writer, net, "packet {}", i);
+    BINLOG_INFO_W(writer, "main {}", i);
+  }
+  session.consume(adapter);
+
+  CHECK(streamToEvents(adapter.stream, "%C %m") == std::vector<std::string>{
+    "net packet 0", "main main 0",
+    "net packet 1", "main main 1",
+    "main main 2", "main main 3", "main main 4",
+    "binlog Over quota net: dropped 3 events, 72 bytes",
+  });
+  CHECK(quota.droppedEvents() == 3);
+  CHECK(quota.droppedBytes() == 72);
+}
+
+TEST_CASE("quota_refills_and_summarizes_once_per_second")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+
+  binlog::EventQuota quota = netQuota(24);
+  QuotaAdapter adapter{quota, Clock::time_point{}, {}};
+
+  BINLOG_INFO_WC(writer, net, "a {}", 1);
+  BINLOG_INFO_WC(writer, net, "b {}", 2); // dropped
+  session.consume(adapter);
+
+  // half a second later: half of the bucket is refilled, the next summary is delayed
+  adapter.now += std::chrono::milliseconds(500);
+  BINLOG_INFO_WC(writer, net, "c {}", 3); // dropped
+  session.consume(adapter);
+
+  // a second later: refilled, the delayed summary is written
+  adapter.now += std::chrono::milliseconds(1000);
+  session.consume(adapter);
+  BINLOG_INFO_WC(writer, net, "d {}", 4);
+  BINLOG_INFO_WC(writer, net, "e {}", 5); // dropped
+  BINLOG_INFO_WC(writer, net, "f {}", 6); // dropped
+  session.consume(adapter);
+
+  CHECK(quota.writeSummaries(adapter.stream) != 0);
+  CHECK(quota.writeSummaries(adapter.stream) == 0);
+
+  CHECK(streamToEvents(adapter.stream, "%m") == std::vector<std::string>{
+    "a 1",
+    "Over quota net: dropped 1 events, 24 bytes",
+    "Over quota net: dropped 1 events, 24 bytes",
+    "d 4",
+    "Over quota net: dropped 2 events, 48 bytes",
+  });
+}
+
+TEST_CASE("quota_samples_excess_events")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+
+  binlog::EventQuota quota = netQuota(0, 3);
+  QuotaAdapter adapter{quota, Clock::time_point{}, {}};
+
+  for (int i = 0; i < 7; ++i)
+  {
+    BINLOG_INFO_WC(writer, net, "packet {}", i);
+  }
+  session.consume(adapter);
+
+  CHECK(streamToEvents(adapter.stream, "%m") == std::vector<std::string>{
+    "packet 2", "packet 5",
+    "Over quota net: dropped 5 events, 120 bytes",
+  });
+}
+
+TEST_CASE("quota_write_summaries")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+
+  binlog::EventQuota quota = netQuota(0);
+  QuotaAdapter adapter{quota, Clock::time_point{}, {}};
+
+  BINLOG_INFO_WC(writer, net, "a {}", 1);
+  session.consume(adapter);
+  BINLOG_INFO_WC(writer, net, "b {}", 2);
+  session.consume(adapter); // summary delayed
+
+  quota.writeSummaries(adapter.stream);
+  CHECK(streamToEvents(adapter.stream, "%m") == std::vector<std::string>{
+    "Over quota net: dropped 1 events, 24 bytes",
+    "Over quota net: dropped 1 events, 24 bytes",
+  });
+}
@@ -0,0 +1,102 @@
+#include <binlog/EventRouter.hpp>
+
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/advanced_log_macros.hpp>
+
+#include "test_utils.hpp"
+
+#include <doctest/doctest.h>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct CountingStream
+{
+  TestStream stream;
+  std::size_t writeCount = 0;
+
+  CountingStream& write(const char* buffer, std::streamsize size)
+  {
+    ++writeCount;
+    stream.write(buffer, size);
+    return *this;
+  }
+};
+
+} // namespace
+
+TEST_CASE("route_events")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+
+  CountingStream all;
+  CountingStream errors;
+  CountingStream net;
+  CountingStream none;
+
+  binlog::EventRouter router;
+  router.addOutput([](const binlog::EventSource&) { return true; }, all);
+  router.addOutput([](const binlog::EventSource& s) { return s.severity >= binlog::Severity::error; }, errors);
+  router.addOutput([](const binlog::EventSource& s) { return s.category == "net"; }, net);
+  router.addOutput([](const binlog::EventSource&) { return false; }, none);
+
+  BINLOG_INFO_W(writer, "a");
+  BINLOG_ERROR_W(writer, "b");
+  BINLOG_INFO_WC(writer, net, "c");
+  BINLOG_ERROR_WC(writer, net, "d");
+  BINLOG_INFO_W(writer, "e");
+  session.consume(router);
+
+  CHECK(streamToEvents(all.stream, "%m") == std::vector<std::string>{"a", "b", "c", "d", "e"});
+  CHECK(streamToEvents(errors.stream, "%m") == std::vector<std::string>{"b", "d"});
+  CHECK(streamToEvents(net.stream, "%m") == std::vector<std::string>{"c", "d"});
+
+  // metadata is written to every output
+  CHECK(countTags(none.stream, binlog::EventSource::Tag) == 5);
+  CHECK(countTags(none.stream, binlog::WriterProp::Tag) == 1);
+  CHECK(streamToEvents(none.stream, "%m").empty());
+
+  // contiguous entries are written together:
+  // one write for the sources, the writerProp and the events each
+  CHECK(all.writeCount == 3);
+  CHECK(errors.writeCount == 4); // b and d are not contiguous
+}
+
+TEST_CASE("route_consumed_twice")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+
+  CountingStream errors;
+  binlog::EventRouter router;
+  router.addOutput([](const binlog::EventSource& s) { return s.severity >= binlog::Severity::error; }, errors);
+
+  const auto log = [&writer](int i)
+  {
+    BINLOG_INFO_W(writer, "info {}", i);
+    BINLOG_ERROR_W(writer, "error {}", i);
+  };
+
+  log(1);
+  session.consume(router);
+  log(2);
+  session.consume(router);
+
+  CHECK(streamToEvents(errors.stream, "%m") == std::vector<std::string>{"error 1", "error 2"});
+}
+
+TEST_CASE("route_too_many_outputs")
+{
+  CountingStream out;
+  binlog::EventRouter router;
+  for (std::size_t i = 0; i < binlog::EventRouter::maxOutputCount; ++i)
+  {
+    router.addOutput([](const binlog::EventSource&) { return true; }, out);
+  }
+  CHECK_THROWS_AS(router.addOutput([](const binlog::EventSource&) { return true; }, out), std::runtime_error);
+}
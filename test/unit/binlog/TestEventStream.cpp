@@ -13,9 +13,12 @@
 
 #include <array>
 #include <cstdint>
+#include <cstring> // memcpy
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <tuple>
+#include <vector>
 
 namespace {
 
@@ -239,6 +242,73 @@ TEST_CASE("override_event_source")
   CHECK(*e1->source == eventSource2);
 }
 
+TEST_CASE("dense_and_sparse_sources")
+{
+  // 1-4 are dense; 5 arrives early, and stays sparse with 0 and 6
+  const std::vector<binlog::EventSource> eventSources{
+    testEventSource(1, "a"), testEventSource(2, "b"), testEventSource(5, "c"),
+    testEventSource(0, "d"), testEventSource(3, "e"), testEventSource(4, "f"),
+    testEventSource(2, "g"), testEventSource(5, "h"), testEventSource(6, "i"),
+  };
+  const std::vector<std::uint64_t> eventIds{1, 3, 4, 5, 0, 6, 2};
+  const std::vector<std::string> expected{"a", "e", "f", "h", "d", "i", "g"};
+
+  TestStream stream;
+  for (const binlog::EventSource& eventSource : eventSources)
+  {
+    serializeSizePrefixedTagged(eventSource, stream);
+  }
+
+  TestStream events;
+  for (const std::uint64_t id : eventIds)
+  {
+    serializeSizePrefixed(TestEvent<>{id, 0, {}}, events);
+  }
+  serializeSizePrefixed(TestEvent<>{7, 0, {}}, events);
+
+  binlog::EventStream eventStream;
+  eventStream.loadMetadata(stream);
+
+  // resume from a checkpoint, which must contain each source once
+  std::stringstream checkpoint;
+  eventStream.writeCheckpoint(checkpoint, 0);
+  binlog::EventStream resumed;
+  binlog::IstreamEntryStream checkpointInput(checkpoint);
+  resumed.readCheckpoint(checkpointInput);
+
+  for (const std::string& name : expected)
+  {
+    const binlog::Event* e = resumed.nextEvent(events);
+    REQUIRE(e != nullptr);
+    CHECK(e->source->function == name);
+  }
+
+  CHECK_THROWS_AS(resumed.nextEvent(events), std::runtime_error);
+}
+
+TEST_CASE("read_event_source_invalid")
+{
+  // sources of dense ids are validated on read, deserialized on first use
+  TestStream stream;
+  serializeSizePrefixedTagged(testEventSource(1, "foo", "i"), stream);
+  std::uint32_t size = 0;
+  memcpy(&size, stream.buffer.data(), sizeof(size));
+  size -= 1;
+  memcpy(stream.buffer.data(), &size, sizeof(size));
+  stream.buffer.pop_back(); // truncate argumentTags
+
+  const binlog::EventSource eventSource = testEventSource(1, "bar");
+  serializeSizePrefixedTagged(eventSource, stream);
+  serializeSizePrefixed(TestEvent<>{1, 0, {}}, stream);
+
+  binlog::EventStream eventStream;
+  CHECK_THROWS_AS(eventStream.nextEvent(stream), std::runtime_error);
+
+  const binlog::Event* e = eventStream.nextEvent(stream);
+  REQUIRE(e != nullptr);
+  CHECK(*e->source == eventSource);
+}
+
 TEST_CASE("read_event_invalid_source")
 {
   const binlog::EventSource eventSource = testEventSource(123);
@@ -310,6 +380,33 @@ TEST_CASE("multiple_writerProps")
   CHECK(eventStream.writerProp() == writerProp1);
 }
 
+TEST_CASE("writerProp_updated_in_place")
+{
+  const binlog::EventSource eventSource = testEventSource(123);
+  const binlog::WriterProp writerProp1{1, "a writer with a long name, not stored inline", 100};
+  const binlog::WriterProp writerProp2{1, "a writer with a long name, not stored inline", 200};
+  const binlog::WriterProp writerProp3{2, "bar", 300};
+  const binlog::WriterProp writerProp4{3, "", 400};
+  const TestEvent<> event{123, 0, {}};
+
+  TestStream stream;
+  serializeSizePrefixedTagged(eventSource, stream);
+  for (const binlog::WriterProp* wp : {&writerProp1, &writerProp2, &writerProp3, &writerProp4, &writerProp1})
+  {
+    serializeSizePrefixedTagged(*wp, stream);
+    serializeSizePrefixed(event, stream);
+  }
+
+  binlog::EventStream eventStream;
+  const binlog::WriterProp& current = eventStream.writerProp();
+
+  for (const binlog::WriterProp* wp : {&writerProp1, &writerProp2, &writerProp3, &writerProp4, &writerProp1})
+  {
+    CHECK(eventStream.nextEvent(stream) != nullptr);
+    CHECK(current == *wp);
+  }
+}
+
 TEST_CASE("continue_after_event_invalid_writer_prop")
 {
   const binlog::EventSource eventSource1 = testEventSource(123);
@@ -427,3 +524,152 @@ TEST_CASE("unknown_specials_are_ignored")
   REQUIRE(e1->source != nullptr);
   CHECK(*e1->source == eventSource);
 }
+
+TEST_CASE("checkpoint_resume")
+{
+  const binlog::EventSource eventSource1 = testEventSource(123, "foo");
+  const binlog::EventSource eventSource2 = testEventSource(124, "bar");
+  const binlog::WriterProp writerProp{1, "writer", 0};
+  const binlog::ClockSync clockSync{1, 2, 3, 4, "foo"};
+  const binlog::InternedString internedString{1, "interned"};
+  const binlog::DroppedEvents droppedEvents{5};
+  const TestEvent<> event1{123, 10, {}};
+  const TestEvent<> event2{124, 20, {}};
+
+  TestStream stream;
+  serializeSizePrefixedTagged(eventSource1, stream);
+  serializeSizePrefixedTagged(writerProp, stream);
+  serializeSizePrefixedTagged(clockSync, stream);
+  serializeSizePrefixedTagged(internedString, stream);
+  serializeSizePrefixedTagged(droppedEvents, stream);
+  serializeSizePrefixed(event1, stream);
+  serializeSizePrefixedTagged(eventSource2, stream);
+  serializeSizePrefixed(event2, stream);
+  serializeSizePrefixed(event1, stream);
+
+  std::istringstream file(std::string(stream.buffer.begin(), stream.buffer.end()));
+  binlog::IstreamEntryStream input(file);
+
+  // read the first event, write a checkpoint
+  binlog::EventStream eventStream;
+  REQUIRE(eventStream.nextEvent(input) != nullptr);
+  const std::uint64_t offset = std::uint64_t(file.tellg());
+
+  std::stringstream checkpoint;
+  eventStream.writeCheckpoint(checkpoint, offset);
+
+  // restart: resume from the checkpoint
+  binlog::EventStream resumed;
+  binlog::IstreamEntryStream checkpointInput(checkpoint);
+  CHECK(resumed.readCheckpoint(checkpointInput) == offset);
+  CHECK(resumed.writerProp() == writerProp);
+  CHECK(resumed.clockSync() == clockSync);
+  CHECK(resumed.droppedEventCount() == 5);
+
+  std::istringstream file2(std::string(stream.buffer.begin(), stream.buffer.end()));
+  file2.seekg(std::streamoff(offset));
+  binlog::IstreamEntryStream input2(file2);
+
+  const binlog::Event* e2 = resumed.nextEvent(input2);
+  REQUIRE(e2 != nullptr);
+  CHECK(*e2->source == eventSource2);
+  CHECK(e2->clockValue == 20);
+  REQUIRE(e2->internedStrings != nullptr);
+  REQUIRE(e2->internedStrings->find(1) != e2->internedStrings->end());
+  CHECK(*e2->internedStrings->find(1) == "interned");
+
+  const binlog::Event* e3 = resumed.nextEvent(input2);
+  REQUIRE(e3 != nullptr);
+  CHECK(*e3->source == eventSource1);
+
+  CHECK(resumed.nextEvent(input2) == nullptr);
+}
+
+TEST_CASE("checkpoint_invalid")
+{
+  const binlog::EventSource eventSource = testEventSource(123);
+  const binlog::WriterProp writerProp{1, "writer", 0};
+
+  binlog::EventStream eventStream;
+  {
+    TestStream stream;
+    serializeSizePrefixedTagged(writerProp, stream);
+    serializeSizePrefixedTagged(binlog::Checkpoint{7}, stream);
+    CHECK(eventStream.readCheckpoint(stream) == 7);
+  }
+
+  // no Checkpoint entry
+  TestStream truncated;
+  serializeSizePrefixedTagged(eventSource, truncated);
+  CHECK_THROWS_AS(eventStream.readCheckpoint(truncated), std::runtime_error);
+
+  // event in the checkpoint
+  TestStream withEvent;
+  serializeSizePrefixedTagged(eventSource, withEvent);
+  serializeSizePrefixed(TestEvent<>{123, 0, {}}, withEvent);
+  serializeSizePrefixedTagged(binlog::Checkpoint{8}, withEvent);
+  CHECK_THROWS_AS(eventStream.readCheckpoint(withEvent), std::runtime_error);
+
+  // unchanged
+  CHECK(eventStream.writerProp() == writerProp);
+}
+
+TEST_CASE("for_each_event")
+{
+  const binlog::EventSource eventSource1 = testEventSource(123, "foo");
+  const binlog::EventSource eventSource2 = testEventSource(124, "bar");
+  const binlog::WriterProp writerProp1{1, "w1", 0};
+  const binlog::WriterProp writerProp2{2, "w2", 0};
+
+  TestStream stream;
+  serializeSizePrefixedTagged(eventSource1, stream);
+  serializeSizePrefixedTagged(writerProp1, stream);
+  serializeSizePrefixed(TestEvent<>{123, 1, {}}, stream);
+  serializeSizePrefixedTagged(eventSource2, stream);
+  serializeSizePrefixedTagged(writerProp2, stream);
+  serializeSizePrefixed(TestEvent<>{124, 2, {}}, stream);
+  serializeSizePrefixed(TestEvent<>{123, 3, {}}, stream);
+
+  const std::vector<std::string> expected{"w1 foo 1", "w2 bar 2", "w2 foo 3"};
+
+  SUBCASE("range")
+  {
+    binlog::EventStream eventStream;
+    std::vector<std::string> actual;
+    eventStream.forEachEvent(binlog::Range(stream.buffer.data(), stream.buffer.size()), [&](const binlog::Event& event)
+    {
+      actual.push_back(eventStream.writerProp().name + " " + event.source->formatString + " " + std::to_string(event.clockValue));
+    });
+    CHECK(actual == expected);
+  }
+
+  SUBCASE("stream")
+  {
+    binlog::RangeEntryStream input(binlog::Range(stream.buffer.data(), stream.buffer.size()));
+    binlog::EventStream eventStream;
+    std::vector<std::string> actual;
+    eventStream.readAll(input, [&](const binlog::Event& event)
+    {
+      actual.push_back(eventStream.writerProp().name + " " + event.source->formatString + " " + std::to_string(event.clockValue));
+    });
+    CHECK(actual == expected);
+  }
+}
+
+TEST_CASE("for_each_event_invalid_source")
+{
+  const binlog::EventSource eventSource = testEventSource(123);
+
+  TestStream stream;
+  serializeSizePrefixedTagged(eventSource, stream);
+  serializeSizePrefixed(TestEvent<>{123, 1, {}}, stream);
+  serializeSizePrefixed(TestEvent<>{124, 2, {}}, stream);
+
+  binlog::EventStream eventStream;
+  std::size_t count = 0;
+  CHECK_THROWS_AS(
+    eventStream.forEachEvent(binlog::Range(stream.buffer.data(), stream.buffer.size()), [&](const binlog::Event&) { ++count; }),
+    std::runtime_error
+  );
+  CHECK(count == 1);
+}
@@ -0,0 +1,124 @@
+#include <binlog/EventTail.hpp>
+
+#include <binlog/Range.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/advanced_log_macros.hpp>
+
+#include "test_utils.hpp"
+
+#include <doctest/doctest.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<std::string> snapshotEvents(const binlog::EventTail& tail, const char* eventFormat)
+{
+  TestStream stream;
+  tail.writeSnapshot(stream);
+  return streamToEvents(stream, eventFormat);
+}
+
+} // namespace
+
+TEST_CASE("empty_tail")
+{
+  binlog::EventTail tail(10);
+  CHECK(tail.eventCount() == 0);
+  CHECK(tail.snapshot().empty());
+}
+
+TEST_CASE("tail_keeps_last_events")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+  binlog::EventTail tail(3);
+
+  for (int i = 0; i < 5; ++i)
+  {
+    BINLOG_INFO_W(writer, "a {}", i);
+  }
+  session.consume(tail);
+  CHECK(tail.eventCount() == 3);
+  CHECK(snapshotEvents(tail, "%m") == std::vector<std::string>{"a 2", "a 3", "a 4"});
+
+  // sources added before the kept events are still available
+  BINLOG_WARN_W(writer, "b {}", 5);
+  session.consume(tail);
+  CHECK(snapshotEvents(tail, "%S %m") == std::vector<std::string>{"INFO a 3", "INFO a 4", "WARN b 5"});
+}
+
+TEST_CASE("tail_is_limited_by_bytes")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+
+  // each event is 4+8+8+4 = 24 bytes: two fit
+  binlog::EventTail tail(100, 50);
+
+  for (int i = 0; i < 7; ++i)
+  {
+    BINLOG_INFO_W(writer, "a {}", i);
+  }
+  session.consume(tail);
+  CHECK(tail.eventCount() == 2);
+  CHECK(snapshotEvents(tail, "%m") == std::vector<std::string>{"a 5", "a 6"});
+
+  // events wrapping around the end of the ring buffer
+  BINLOG_INFO_W(writer, "b {}", std::string("xy"));
+  BINLOG_INFO_W(writer, "c {}", 8);
+  session.consume(tail);
+  CHECK(snapshotEvents(tail, "%m") == std::vector<std::string>{"b xy", "c 8"});
+
+  // an event larger than the tail is not kept
+  BINLOG_INFO_W(writer, "d {}", std::string(100, 'x'));
+  session.consume(tail);
+  CHECK(snapshotEvents(tail, "%m") == std::vector<std::string>{"b xy", "c 8"});
+}
+
+TEST_CASE("tail_keeps_writers")
+{
+  binlog::Session session;
+  binlog::SessionWriter w1(session, 4096, 1, "w1");
+  binlog::SessionWriter w2(session, 4096, 2, "w2");
+  binlog::EventTail tail(10);
+
+  BINLOG_INFO_W(w1, "a {}", 1);
+  BINLOG_INFO_W(w2, "b {}", 2);
+  session.consume(tail);
+
+  w1.setName("w1b");
+  BINLOG_INFO_W(w1, "c {}", 3);
+  session.consume(tail);
+  BINLOG_INFO_W(w2, "d {}", 4);
+  session.consume(tail);
+
+  CHECK(snapshotEvents(tail, "%n %m") == std::vector<std::string>{
+    "w1 a 1", "w2 b 2", "w1b c 3", "w2 d 4"
+  });
+}
+
+TEST_CASE("tail_tee")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+  binlog::EventTail tail(2);
+
+  TestStream out;
+  auto tee = tail.tee(out);
+
+  for (int i = 0; i < 4; ++i)
+  {
+    BINLOG_INFO_W(writer, "a {}", i);
+  }
+  session.consume(tee);
+
+  CHECK(streamToEvents(out, "%m") == std::vector<std::string>{"a 0", "a 1", "a 2", "a 3"});
+
+  const std::vector<char> snapshot = tail.snapshot();
+  TestStream stream;
+  stream.write(snapshot.data(), std::streamsize(snapshot.size()));
+  CHECK(streamToEvents(stream, "%m") == std::vector<std::string>{"a 2", "a 3"});
+}
@@ -0,0 +1,176 @@
+#include <extract.hpp>
+
+#include <binlog/EntryStream.hpp>
+#include <binlog/PackedInteger.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/advanced_log_macros.hpp>
+
+#include <doctest/doctest.h>
+
+#include <cstdint>
+#include <cstring> // memcpy
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct ColumnFile
+{
+  std::vector<std::string> names;
+  std::vector<std::string> tags;
+  std::vector<std::uint64_t> rowGroupSizes;
+  std::vector<std::string> data; // of each column, row groups concatenated
+};
+
+template <typename T>
+T readValue(const std::string& in, std::size_t& pos)
+{
+  T result;
+  REQUIRE(pos + sizeof(T) <= in.size());
+  memcpy(&result, in.data() + pos, sizeof(T));
+  pos += sizeof(T);
+  return result;
+}
+
+std::string readString(const std::string& in, std::size_t& pos)
+{
+  const std::uint32_t size = readValue<std::uint32_t>(in, pos);
+  std::string result = in.substr(pos, size);
+  pos += size;
+  return result;
+}
+
+ColumnFile readColumnFile(const std::string& in)
+{
+  ColumnFile result;
+  std::size_t pos = 0;
+  CHECK(readValue<std::uint64_t>(in, pos) == columnFileMagic);
+  CHECK(readValue<std::uint64_t>(in, pos) == 1);
+  const std::uint64_t columnCount = readValue<std::uint64_t>(in, pos);
+  for (std::uint64_t i = 0; i < columnCount; ++i)
+  {
+    result.names.push_back(readString(in, pos));
+    result.tags.push_back(readString(in, pos));
+  }
+  result.data.resize(columnCount);
+
+  while (pos < in.size())
+  {
+    result.rowGroupSizes.push_back(readValue<std::uint64_t>(in, pos));
+    for (std::uint64_t i = 0; i < columnCount; ++i)
+    {
+      const std::uint64_t size = readValue<std::uint64_t>(in, pos);
+      result.data[i] += in.substr(pos, size);
+      pos += size;
+    }
+  }
+
+  return result;
+}
+
+template <typename T>
+std::vector<T> fixedColumn(const std::string& data)
+{
+  std::vector<T> result(data.size() / sizeof(T));
+  memcpy(result.data(), data.data(), data.size());
+  return result;
+}
+
+/** @returns the strings of a [c column of a single row group */
+std::vector<std::string> stringColumn(const std::string& data, std::size_t rowCount)
+{
+  std::vector<std::string> result;
+  const std::size_t base = rowCount * sizeof(std::uint64_t);
+  std::size_t begin = 0;
+  for (std::size_t i = 0; i < rowCount; ++i)
+  {
+    std::uint64_t end = 0;
+    memcpy(&end, data.data() + i * sizeof(end), sizeof(end));
+    result.push_back(data.substr(base + begin, end - begin));
+    begin = end;
+  }
+  return result;
+}
+
+} // namespace
+
+TEST_CASE("extract_columns")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096, 7, "W");
+
+  for (int i = 0; i < 3; ++i)
+  {
+    BINLOG_INFO_WC(writer, orders, "Fill: {} @ {} {} {} {}",
+      i, 1.5 * i, std::string(std::size_t(i), 'x'), std::vector<int>{i, i}, binlog::packed(-i)
+    );
+    BINLOG_INFO_WC(writer, other, "Other: {}", i);
+  }
+
+  std::stringstream logfile;
+  session.consume(logfile);
+
+  binlog::IstreamEntryStream entryStream(logfile);
+  std::ostringstream output;
+  SourceSelector selector;
+  selector.category = "orders";
+  CHECK(extractColumns(entryStream, output, selector, 2) == 3);
+
+  const ColumnFile file = readColumnFile(output.str());
+  CHECK(file.names == std::vector<std::string>{
+    "clock", "time", "writer_id", "writer_name", "source_id", "arg0", "arg1", "arg2", "arg3", "arg4"
+  });
+  CHECK(file.tags == std::vector<std::string>{"L", "l", "L", "[c", "L", "i", "d", "[c", "[c", "l"});
+  CHECK(file.rowGroupSizes == std::vector<std::uint64_t>{2, 1});
+
+  CHECK(fixedColumn<std::uint64_t>(file.data[2]) == std::vector<std::uint64_t>{7, 7, 7});
+  CHECK(fixedColumn<std::int32_t>(file.data[5]) == std::vector<std::int32_t>{0, 1, 2});
+  CHECK(fixedColumn<double>(file.data[6]) == std::vector<double>{0, 1.5, 3});
+  CHECK(fixedColumn<std::int64_t>(file.data[9]) == std::vector<std::int64_t>{0, -1, -2});
+
+  // the first row group only
+  const std::size_t firstSize = 2 * sizeof(std::uint64_t) + 1;
+  CHECK(stringColumn(file.data[7].substr(0, firstSize), 2) == std::vector<std::string>{"", "x"});
+  CHECK(stringColumn(file.data[8], 2) == std::vector<std::string>{"[0, 0]", "[1, 1]"});
+  CHECK(stringColumn(file.data[3], 2) == std::vector<std::string>{"W", "W"});
+}
+
+TEST_CASE("extract_columns_empty")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+  BINLOG_INFO_W(writer, "Hello {}", 1);
+
+  std::stringstream logfile;
+  session.consume(logfile);
+
+  binlog::IstreamEntryStream entryStream(logfile);
+  std::ostringstream output;
+  SourceSelector selector;
+  selector.formatString = "Bye";
+  CHECK(extractColumns(entryStream, output, selector) == 0);
+
+  const ColumnFile file = readColumnFile(output.str());
+  CHECK(file.names.size() == 5);
+  CHECK(file.rowGroupSizes.empty());
+}
+
+TEST_CASE("extract_columns_different_tags")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+  BINLOG_INFO_W(writer, "Value {}", 1);
+  BINLOG_INFO_W(writer, "Value {}", 1.0);
+
+  std::stringstream logfile;
+  session.consume(logfile);
+
+  binlog::IstreamEntryStream entryStream(logfile);
+  std::ostringstream output;
+  SourceSelector selector;
+  selector.formatString = "Value";
+  CHECK_THROWS_AS(extractColumns(entryStream, output, selector), std::runtime_error);
+}
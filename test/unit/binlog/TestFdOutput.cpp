@@ -0,0 +1,96 @@
+#include <fdoutput.hpp>
+
+#include <doctest/doctest.h>
+
+#include <cstdio>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <string>
+
+namespace {
+
+struct TmpFile
+{
+  std::unique_ptr<FILE, int(*)(FILE*)> file{std::tmpfile(), &std::fclose};
+
+  int fd() const { return fileno(file.get()); }
+
+  std::string content() const
+  {
+    std::rewind(file.get());
+    std::string result;
+    char buf[256];
+    while (const std::size_t n = std::fread(buf, 1, sizeof(buf), file.get()))
+    {
+      result.append(buf, n);
+    }
+    return result;
+  }
+};
+
+} // namespace
+
+TEST_CASE("buffered_until_flush")
+{
+  TmpFile tmp;
+  REQUIRE(tmp.file != nullptr);
+
+  FdStreambuf buf(tmp.fd(), 16);
+  std::ostream out(&buf);
+  out << "foo" << 123 << '\n';
+  CHECK(tmp.content() == "");
+
+  out.flush();
+  CHECK(out.good());
+  CHECK(tmp.content() == "foo123\n");
+}
+
+TEST_CASE("writes_larger_than_buffer")
+{
+  TmpFile tmp;
+  REQUIRE(tmp.file != nullptr);
+
+  std::string expected;
+  {
+    FdStreambuf buf(tmp.fd(), 16);
+    std::ostream out(&buf);
+    for (std::size_t size : {1u, 10u, 15u, 16u, 17u, 100u, 3u})
+    {
+      const std::string s(size, char('a' + size % 26));
+      out << s;
+      expected += s;
+    }
+  } // flushed by the destructor
+
+  CHECK(tmp.content() == expected);
+}
+
+TEST_CASE("write_error")
+{
+  FdStreambuf buf(-1, 16);
+  std::ostream out(&buf);
+  out << "foo";
+  CHECK(out.good()); // buffered
+  out.flush();
+  CHECK(out.bad());
+}
+
+TEST_CASE("replace_streambuf")
+{
+  TmpFile tmp;
+  REQUIRE(tmp.file != nullptr);
+
+  std::ostringstream out;
+  std::streambuf* const original = out.rdbuf();
+  FdStreambuf buf(tmp.fd());
+  {
+    const StreambufReplacement replacement(out, buf);
+    out << "foo";
+  }
+
+  CHECK(tmp.content() == "foo");
+  CHECK(out.rdbuf() == original);
+  out << "bar";
+  CHECK(out.str() == "bar");
+}
@@ -0,0 +1,169 @@
+#include <binlog/FileOutputStream.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/ConstBuffer.hpp>
+#include <binlog/DeferredView.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/advanced_log_macros.hpp>
+
+#include <doctest/doctest.h>
+
+#include <cstdio> // remove
+#include <fstream>
+#include <ios>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string readFile(const std::string& path)
+{
+  std::ifstream file(path, std::ios_base::in | std::ios_base::binary);
+  return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+/** Counts write and writev calls */
+struct GatherTestStream
+{
+  TestStream stream;
+  std::size_t writeCount = 0;
+  std::size_t writevCount = 0;
+
+  GatherTestStream& write(const char* data, std::streamsize size)
+  {
+    ++writeCount;
+    stream.write(data, size);
+    return *this;
+  }
+
+  void writev(const binlog::ConstBuffer* buffers, std::size_t count)
+  {
+    ++writevCount;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      stream.write(buffers[i].data, std::streamsize(buffers[i].size));
+    }
+  }
+};
+
+static_assert(binlog::detail::has_writev<GatherTestStream>::value, "");
+static_assert(binlog::detail::has_writev<binlog::FileOutputStream>::value, "");
+static_assert(! binlog::detail::has_writev<TestStream>::value, "");
+
+} // namespace
+
+TEST_CASE("file_write_and_writev")
+{
+  const std::string path = "binlog_test_file_output_stream.blog";
+
+  std::string expected;
+  {
+    binlog::FileOutputStream file(path);
+    file.write("abc", 3);
+    expected += "abc";
+
+    // more buffers than a single writev call takes
+    std::vector<std::string> strings;
+    for (int i = 0; i < 3000; ++i) { strings.push_back(std::to_string(i) + ","); }
+    strings.emplace_back(); // empty buffer
+
+    std::vector<binlog::ConstBuffer> buffers;
+    for (const std::string& s : strings)
+    {
+      buffers.push_back(binlog::ConstBuffer{s.data(), s.size()});
+      expected += s;
+    }
+    file.writev(buffers.data(), buffers.size());
+    file.writev(nullptr, 0);
+  }
+  CHECK(readFile(path) == expected);
+
+  {
+    binlog::FileOutputStream file(path, true);
+    file.write("def", 3);
+  }
+  CHECK(readFile(path) == expected + "def");
+
+  {
+    binlog::FileOutputStream file(path); // truncate
+    file.write("ghi", 3);
+  }
+  CHECK(readFile(path) == "ghi");
+
+  (void)std::remove(path.data());
+}
+
+TEST_CASE("file_open_error")
+{
+  CHECK_THROWS_AS(binlog::FileOutputStream("no_such_dir/binlog_test.blog"), std::runtime_error);
+}
+
+TEST_CASE("consume_by_writev")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 512);
+
+  std::vector<std::string> expected;
+  const auto log = [&writer, &expected](int i)
+  {
+    BINLOG_INFO_W(writer, "Hello {} {}", i, std::string(100, 'x'));
+    expected.push_back("Hello " + std::to_string(i) + " " + std::string(100, 'x'));
+  };
+
+  GatherTestStream out;
+
+  // make the queue data wrap around
+  log(0);
+  log(1);
+  session.consume(out);
+  log(2);
+  log(3);
+  log(4);
+
+  const std::string snapshot(200, 'y');
+  BINLOG_INFO_W(writer, "Deferred {}", binlog::deferred_view(snapshot.data(), snapshot.size()));
+  expected.push_back("Deferred " + snapshot);
+
+  session.consume(out);
+
+  CHECK(out.writeCount == 0);
+  CHECK(out.writevCount == 2);
+  CHECK(streamToEvents(out.stream, "%m") == expected);
+
+  // nothing to write
+  session.consume(out);
+  CHECK(out.writevCount == 2);
+}
+
+TEST_CASE("consume_to_file")
+{
+  const std::string path = "binlog_test_file_output_stream_consume.blog";
+
+  binlog::Session session;
+  std::vector<std::string> expected;
+  {
+    binlog::FileOutputStream file(path);
+    {
+      binlog::SessionWriter writer(session, 4096);
+      for (int i = 0; i < 10; ++i)
+      {
+        BINLOG_INFO_W(writer, "Hello {}", i);
+        expected.push_back("Hello " + std::to_string(i));
+      }
+    } // writer closed
+
+    const binlog::Session::ConsumeResult result = session.consume(file);
+    CHECK(result.channelsRemoved == 1);
+  }
+
+  const std::string content = readFile(path);
+  TestStream stream;
+  stream.write(content.data(), std::streamsize(content.size()));
+  CHECK(streamToEvents(stream, "%m") == expected);
+
+  (void)std::remove(path.data());
+}
@@ -0,0 +1,220 @@
+#include <binlog/FileSink.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/FileOutputStream.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/advanced_log_macros.hpp>
+
+#include <doctest/doctest.h>
+
+#include <algorithm> // copy, min
+#include <cstdio> // remove
+#include <fstream>
+#include <ios>
+#include <iterator>
+#include <memory> // align
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string readFile(const std::string& path)
+{
+  std::ifstream file(path, std::ios_base::in | std::ios_base::binary);
+  return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+std::string testData(std::size_t size)
+{
+  std::string result;
+  for (std::size_t i = 0; result.size() < size; ++i)
+  {
+    result += std::to_string(i) + ",";
+  }
+  result.resize(size);
+  return result;
+}
+
+} // namespace
+
+TEST_CASE("file_sink_write_buffers")
+{
+  const std::string path = "binlog_test_file_sink_write.blog";
+  const std::string data = testData(100000);
+
+  {
+    binlog::FileSink::Options options;
+    options.bufferSize = 1000; // rounded up to alignment
+    binlog::FileSink sink(path, options);
+
+    // pieces of different size, some larger than a buffer
+    std::size_t pos = 0;
+    for (std::size_t size = 1; pos < data.size(); size = size * 3 % 10007)
+    {
+      const std::size_t n = (std::min)(size, data.size() - pos);
+      sink.write(data.data() + pos, std::streamsize(n));
+      pos += n;
+    }
+  }
+
+  CHECK(readFile(path) == data);
+  (void)std::remove(path.data());
+}
+
+TEST_CASE("file_sink_buffer_count")
+{
+  const std::string path = "binlog_test_file_sink_buffer_count.blog";
+  const std::string data = testData(100000);
+
+  for (const std::size_t bufferCount : {std::size_t{0}, std::size_t{5}})
+  {
+    binlog::FileSink::Options options;
+    options.bufferSize = binlog::FileSink::alignment;
+    options.bufferCount = bufferCount; // at least 2
+    binlog::FileSink sink(path, options);
+
+    for (std::size_t pos = 0; pos < data.size(); pos += 1000)
+    {
+      sink.write(data.data() + pos, std::streamsize((std::min)(std::size_t{1000}, data.size() - pos)));
+    }
+    sink.flush();
+    CHECK(readFile(path) == data);
+  }
+
+  (void)std::remove(path.data());
+}
+
+TEST_CASE("file_sink_flush")
+{
+  const std::string path = "binlog_test_file_sink_flush.blog";
+
+  binlog::FileSink sink(path);
+  sink.write("abc", 3);
+  sink.flush();
+  CHECK(readFile(path) == "abc");
+
+  sink.write("def", 3);
+  sink.close();
+  CHECK(readFile(path) == "abcdef");
+
+  sink.close(); // idempotent
+
+  (void)std::remove(path.data());
+}
+
+TEST_CASE("file_sink_direct_io")
+{
+  const std::string path = "binlog_test_file_sink_direct_io.blog";
+  const std::string data = testData(3 * binlog::FileSink::alignment + 100);
+
+  binlog::FileSink::Options options;
+  options.directIo = true;
+  binlog::FileSink sink(path, options);
+
+  sink.write(data.data(), std::streamsize(data.size()));
+  sink.flush();
+
+  // only whole blocks are written by flush
+  CHECK(readFile(path) == data.substr(0, 3 * binlog::FileSink::alignment));
+
+  sink.close();
+  CHECK(readFile(path) == data);
+
+  (void)std::remove(path.data());
+}
+
+TEST_CASE("file_output_stream_direct_io")
+{
+  const std::string path = "binlog_test_file_output_stream_direct_io.blog";
+  const std::size_t alignment = binlog::FileSink::alignment;
+  const std::string data = testData(2 * alignment + 100);
+
+  // direct I/O writes must be aligned
+  std::vector<char> storage(data.size() + alignment);
+  void* ptr = storage.data();
+  std::size_t space = storage.size();
+  char* aligned = static_cast<char*>(std::align(alignment, data.size(), ptr, space));
+  REQUIRE(aligned != nullptr);
+  std::copy(data.begin(), data.end(), aligned);
+
+  {
+    binlog::FileOutputStream file(path);
+    const bool directIo = file.setDirectIo(true);
+    #ifdef _WIN32
+      CHECK(directIo); // the file is reopened with FILE_FLAG_NO_BUFFERING, supported by NTFS
+    #endif
+
+    file.write(aligned, std::streamsize(2 * alignment));
+    if (directIo) { CHECK(file.setDirectIo(false)); }
+    file.write(aligned + 2 * alignment, std::streamsize(data.size() - 2 * alignment));
+  }
+
+  CHECK(readFile(path) == data);
+
+  (void)std::remove(path.data());
+}
+
+TEST_CASE("file_sink_rotate")
+{
+  const std::string path1 = "binlog_test_file_sink_rotate.1.blog";
+  const std::string path2 = "binlog_test_file_sink_rotate.2.blog";
+
+  {
+    binlog::FileSink sink(path1);
+    sink.write("abc", 3);
+    sink.rotate(path2);
+    sink.write("def", 3);
+  }
+
+  CHECK(readFile(path1) == "abc");
+  CHECK(readFile(path2) == "def");
+
+  (void)std::remove(path1.data());
+  (void)std::remove(path2.data());
+}
+
+TEST_CASE("file_sink_errors")
+{
+  CHECK_THROWS_AS(binlog::FileSink("no_such_dir/binlog_test.blog"), std::runtime_error);
+
+  const std::string path = "binlog_test_file_sink_errors.blog";
+  binlog::FileSink sink(path);
+  sink.write("abc", 3);
+  sink.rotate("no_such_dir/binlog_test.blog");
+  sink.write("def", 3);
+  CHECK_THROWS_AS(sink.flush(), std::runtime_error);
+  CHECK_THROWS_AS(sink.close(), std::runtime_error);
+
+  CHECK(readFile(path) == "abc");
+  (void)std::remove(path.data());
+}
+
+TEST_CASE("file_sink_consume")
+{
+  const std::string path = "binlog_test_file_sink_consume.blog";
+
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+
+  std::vector<std::string> expected;
+  {
+    binlog::FileSink sink(path);
+    for (int i = 0; i < 100; ++i)
+    {
+      BINLOG_INFO_W(writer, "Hello {}", i);
+      expected.push_back("Hello " + std::to_string(i));
+      if (i % 10 == 0) { session.consume(sink); }
+    }
+    session.consume(sink);
+  }
+
+  const std::string content = readFile(path);
+  TestStream stream;
+  stream.write(content.data(), std::streamsize(content.size()));
+  CHECK(streamToEvents(stream, "%m") == expected);
+
+  (void)std::remove(path.data());
+}
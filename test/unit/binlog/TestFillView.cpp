@@ -0,0 +1,60 @@
+#include <binlog/FillView.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/advanced_log_macros.hpp>
+
+#include <mserialize/tag.hpp>
+
+#include <doctest/doctest.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+TEST_CASE("fill_in_place")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 128);
+
+  const std::string source = "Hello";
+  int fillCount = 0;
+  const auto view = binlog::fill_view(source.size(), [&](char* dst, std::size_t size)
+  {
+    ++fillCount;
+    memcpy(dst, source.data(), size);
+  });
+
+  BINLOG_INFO_W(writer, "Payload: {} {}", view, 123);
+  CHECK(fillCount == 1);
+
+  CHECK(getEvents(session, "%m") == std::vector<std::string>{"Payload: Hello 123"});
+}
+
+TEST_CASE("fill_empty")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 128);
+
+  const auto view = binlog::fill_view(0, [](char*, std::size_t) {});
+  BINLOG_INFO_W(writer, "Payload: [{}]", view);
+
+  CHECK(getEvents(session, "%m") == std::vector<std::string>{"Payload: []"});
+}
+
+TEST_CASE("fill_other_stream")
+{
+  // streams without reserveBuffer are written via a temporary buffer
+  const auto view = binlog::fill_view(3, [](char* dst, std::size_t size)
+  {
+    memset(dst, 'x', size);
+  });
+
+  TestStream stream;
+  mserialize::serialize(view, stream);
+  CHECK(stream.buffer == std::vector<char>{3, 0, 0, 0, 'x', 'x', 'x'});
+  CHECK(mserialize::serialized_size(view) == 7);
+  CHECK(mserialize::tag<decltype(view)>() == mserialize::tag<std::string>());
+}
@@ -0,0 +1,91 @@
+#include <find.hpp>
+#include <where.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/TimeIndex.hpp>
+
+#include <doctest/doctest.h>
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+/** @returns a logfile of 100 events, consumed in multiple batches */
+std::string logEvents()
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+  const std::uint64_t order = addEventSource<int, std::string>(session, binlog::Severity::info, "main", "Order {} {}");
+
+  std::ostringstream stream;
+  for (int i = 0; i < 100; ++i)
+  {
+    CHECK(writer.addEvent(order, 0, i, "id" + std::to_string(i)));
+    if (i % 10 == 9) { session.consume(stream); }
+  }
+
+  return stream.str();
+}
+
+binlog::TimeIndex indexLogfile(const std::string& logfile, std::size_t filterBits)
+{
+  std::ostringstream copy;
+  std::stringstream indexStream;
+  {
+    binlog::IndexedOutputStream output(copy, indexStream, 256, filterBits);
+    output.write(logfile.data(), std::streamsize(logfile.size()));
+  }
+  return binlog::TimeIndex::read(indexStream);
+}
+
+std::vector<std::string> findEvents(const std::string& logfile, const binlog::TimeIndex& index, const std::string& value, std::size_t& skippedBlockCount)
+{
+  FindEntryStream candidates(logfile.data(), logfile.size(), index, value);
+  const WherePredicate predicate("value==\"" + value + "\"");
+  WhereEntryStream filtered(candidates, predicate);
+  std::vector<std::string> result = streamToEvents(filtered, "%m");
+  skippedBlockCount = candidates.skippedBlockCount();
+  return result;
+}
+
+} // namespace
+
+TEST_CASE("find_with_filters")
+{
+  const std::string logfile = logEvents();
+  const binlog::TimeIndex index = indexLogfile(logfile, 1024);
+  REQUIRE(index.blocks.size() > 4);
+
+  // the event source is replayed from a skipped block
+  std::size_t skipped = 0;
+  CHECK(findEvents(logfile, index, "id77", skipped) == std::vector<std::string>{"Order 77 id77"});
+  CHECK(skipped > index.blocks.size() / 2);
+
+  CHECK(findEvents(logfile, index, "42", skipped) == std::vector<std::string>{"Order 42 id42"});
+  CHECK(findEvents(logfile, index, "no such value", skipped).empty());
+}
+
+TEST_CASE("find_without_filters")
+{
+  const std::string logfile = logEvents();
+  const binlog::TimeIndex index = indexLogfile(logfile, 0);
+
+  std::size_t skipped = 0;
+  CHECK(findEvents(logfile, index, "id77", skipped) == std::vector<std::string>{"Order 77 id77"});
+  CHECK(skipped == 0);
+}
+
+TEST_CASE("find_index_mismatch")
+{
+  const std::string logfile = logEvents();
+  binlog::TimeIndex index = indexLogfile(logfile, 1024);
+  index.blocks.back().size += 1;
+
+  CHECK_THROWS_AS(FindEntryStream(logfile.data(), logfile.size(), index, "id77"), std::runtime_error);
+}
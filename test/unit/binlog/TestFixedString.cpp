@@ -0,0 +1,49 @@
+#include <binlog/FixedString.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/advanced_log_macros.hpp>
+
+#include <mserialize/detail/Serializer.hpp>
+#include <mserialize/serialize.hpp>
+#include <mserialize/tag.hpp>
+
+#include <doctest/doctest.h>
+
+#include <string>
+#include <vector>
+
+TEST_CASE("fixed_string_size")
+{
+  static_assert(sizeof(binlog::FixedString<16>) == 17, "");
+  static_assert(mserialize::detail::has_trivial_serializer<binlog::FixedString<16>>::value, "");
+
+  const std::string large(4096, 'x');
+  CHECK(mserialize::serialized_size(binlog::fixedString<16>(large)) == 17);
+  CHECK(mserialize::serialized_size(binlog::fixedString<16>("short")) == 17);
+  CHECK(mserialize::tag<binlog::FixedString<3>>() == "{binlog::FixedString`size'B`data'(ccc)}");
+
+  const binlog::FixedString<4> s = binlog::fixedString<4>("ab");
+  CHECK(s.size == 2);
+  CHECK(std::string(s.data, 4) == std::string("ab\0\0", 4));
+}
+
+TEST_CASE("fixed_string_log")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 256);
+
+  BINLOG_INFO_W(writer, "Order on {} qty {}", binlog::fixedString<16>("AAPL"), 100);
+  BINLOG_INFO_W(writer, "{} '{}' {}",
+    binlog::fixedString<5>(std::string("Hello World")), binlog::fixedString<1>(""), binlog::fixedString<255>(std::string(300, 'y'))
+  );
+  BINLOG_INFO_W(writer, "Venues: {}", std::vector<binlog::FixedString<4>>{binlog::fixedString<4>("XNYS"), binlog::fixedString<4>("XLON")});
+
+  CHECK(getEvents(session, "%m") == std::vector<std::string>{
+    "Order on AAPL qty 100",
+    "Hello '' " + std::string(255, 'y'),
+    "Venues: [XNYS, XLON]",
+  });
+}
@@ -0,0 +1,120 @@
+#include <binlog/FollowEntryStream.hpp>
+
+#ifndef _WIN32
+
+#include <binlog/Range.hpp>
+
+#include <doctest/doctest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio> // remove, rename
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+binlog::FollowEntryStream::Options shortTimeout()
+{
+  binlog::FollowEntryStream::Options options;
+  options.idleTimeout = std::chrono::milliseconds{20};
+  return options;
+}
+
+/** @returns an entry of `payload`, prefixed by its size */
+std::string entry(const std::string& payload)
+{
+  const std::uint32_t size = std::uint32_t(payload.size());
+  return std::string(reinterpret_cast<const char*>(&size), sizeof(size)) + payload;
+}
+
+void append(const std::string& path, const std::string& data)
+{
+  std::ofstream file(path, std::ios_base::out | std::ios_base::binary | std::ios_base::app);
+  file.write(data.data(), std::streamsize(data.size()));
+}
+
+std::string next(binlog::EntryStream& input)
+{
+  binlog::Range payload = input.nextEntryPayload();
+  const std::size_t size = payload.size();
+  return std::string(payload.view(size), size);
+}
+
+} // namespace
+
+TEST_CASE("follow_growing_file")
+{
+  const std::string path = "binlog_test_follow_growing.blog";
+  std::remove(path.data());
+  append(path, entry("first") + entry("second"));
+
+  binlog::FollowEntryStream input(path, shortTimeout());
+  CHECK(next(input) == "first");
+  CHECK(next(input) == "second");
+  CHECK(next(input).empty()); // idle
+
+  // an incomplete entry is not returned until it is complete
+  const std::string third = entry("third");
+  append(path, third.substr(0, 6));
+  CHECK(next(input).empty());
+  append(path, third.substr(6) + entry("fourth"));
+  CHECK(next(input) == "third");
+  CHECK(next(input) == "fourth");
+  CHECK(next(input).empty());
+
+  CHECK(input.reopenCount() == 0);
+  std::remove(path.data());
+}
+
+TEST_CASE("follow_rotated_file")
+{
+  const std::string path = "binlog_test_follow_rotated.blog";
+  const std::string rotated = path + ".1";
+  std::remove(path.data());
+  std::remove(rotated.data());
+  append(path, entry("a"));
+
+  binlog::FollowEntryStream input(path, shortTimeout());
+  CHECK(next(input) == "a");
+
+  // the rest of the old file is read first
+  append(path, entry("b"));
+  REQUIRE(std::rename(path.data(), rotated.data()) == 0);
+  append(path, entry("c"));
+
+  CHECK(next(input) == "b");
+  CHECK(next(input) == "c");
+  CHECK(next(input).empty());
+  CHECK(input.reopenCount() == 1);
+
+  std::remove(path.data());
+  std::remove(rotated.data());
+}
+
+TEST_CASE("follow_truncated_file")
+{
+  const std::string path = "binlog_test_follow_truncated.blog";
+  std::remove(path.data());
+  append(path, entry("before truncation"));
+
+  binlog::FollowEntryStream input(path, shortTimeout());
+  CHECK(next(input) == "before truncation");
+
+  {
+    std::ofstream file(path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+  }
+  append(path, entry("after"));
+
+  CHECK(next(input) == "after");
+  CHECK(input.reopenCount() == 1);
+  std::remove(path.data());
+}
+
+TEST_CASE("follow_missing_file")
+{
+  CHECK_THROWS_AS(binlog::FollowEntryStream("binlog_test_follow_no_such_file.blog"), std::runtime_error);
+}
+
+#endif // _WIN32
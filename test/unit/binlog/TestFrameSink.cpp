@@ -0,0 +1,202 @@
+#include <binlog/FrameSink.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/EntryStream.hpp>
+#include <binlog/Range.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/advanced_log_macros.hpp>
+
+#include <doctest/doctest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int eventCount = 50;
+
+std::string writeEvents()
+{
+  binlog::Session session;
+  session.setClockSync(binlog::ClockSync{0, 1000000000, 0, 0, "UTC"});
+  binlog::SessionWriter writer(session, 4096, 1, "W");
+  const std::uint64_t source = addEventSource<int>(session, binlog::Severity::info, "main", "event {}");
+  for (int i = 0; i < eventCount; ++i)
+  {
+    CHECK(writer.addEvent(source, std::uint64_t(i), i));
+  }
+
+  std::ostringstream stream;
+  session.consume(stream);
+  return stream.str();
+}
+
+/** Buffers of a fixed size, and the frames transmitted */
+struct Pool
+{
+  explicit Pool(std::size_t bufferSize) :_bufferSize(bufferSize) {}
+
+  binlog::FrameSink::Buffer acquire()
+  {
+    if (available == 0) { return binlog::FrameSink::Buffer{nullptr, 0}; }
+    --available;
+    buffers.emplace_back(_bufferSize);
+    return binlog::FrameSink::Buffer{buffers.back().data(), _bufferSize};
+  }
+
+  void transmit(char* data, std::size_t size)
+  {
+    CHECK(data == buffers.back().data());
+    frames.emplace_back(data, size);
+  }
+
+  std::size_t available = std::size_t(-1);
+  std::vector<std::vector<char>> buffers;
+  std::vector<std::string> frames;
+
+private:
+  std::size_t _bufferSize;
+};
+
+binlog::FrameSink makeSink(Pool& pool)
+{
+  return binlog::FrameSink(
+    [&pool]() { return pool.acquire(); },
+    [&pool](char* data, std::size_t size) { pool.transmit(data, size); }
+  );
+}
+
+/** Write `stream` to `sink`, `chunkSize` bytes at a time */
+void writeChunks(const std::string& stream, std::size_t chunkSize, binlog::FrameSink& sink)
+{
+  for (std::size_t pos = 0; pos < stream.size(); pos += chunkSize)
+  {
+    const std::size_t n = (std::min)(chunkSize, stream.size() - pos);
+    sink.write(stream.data() + pos, std::streamsize(n));
+  }
+  sink.flush();
+}
+
+std::vector<std::string> reassemble(const std::vector<std::string>& frames, binlog::FrameReassembler& reassembler)
+{
+  for (const std::string& frame : frames)
+  {
+    CHECK(reassembler.add(frame.data(), frame.size()));
+  }
+
+  std::vector<char> entries = reassembler.takeEntries();
+  binlog::RangeEntryStream stream(binlog::Range(entries.data(), entries.size()));
+  return streamToEvents(stream, "%m");
+}
+
+std::vector<std::string> expectedEvents()
+{
+  std::vector<std::string> result;
+  for (int i = 0; i < eventCount; ++i) { result.push_back("event " + std::to_string(i)); }
+  return result;
+}
+
+} // namespace
+
+TEST_CASE("frame_sink_split_entries")
+{
+  const std::string stream = writeEvents();
+  for (const std::size_t chunkSize : {std::size_t{1}, std::size_t{7}, std::size_t{4096}})
+  {
+    Pool pool(64);
+    binlog::FrameSink sink = makeSink(pool);
+    writeChunks(stream, chunkSize, sink);
+
+    CHECK(sink.frameCount() == pool.frames.size());
+    CHECK(sink.droppedBytes() == 0);
+    for (std::size_t i = 0; i + 1 < pool.frames.size(); ++i)
+    {
+      CHECK(pool.frames[i].size() == 64); // only the last frame is not full
+    }
+
+    binlog::FrameReassembler reassembler;
+    CHECK(reassemble(pool.frames, reassembler) == expectedEvents());
+    CHECK(reassembler.lostFrameCount() == 0);
+  }
+}
+
+TEST_CASE("frame_sink_consume")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096, 1, "W");
+  BINLOG_CREATE_SOURCE_AND_EVENT(writer, binlog::Severity::info, main, 0, "consumed {}", 123);
+
+  Pool pool(32);
+  binlog::FrameSink sink = makeSink(pool);
+  session.consume(sink);
+  sink.flush();
+
+  binlog::FrameReassembler reassembler;
+  CHECK(reassemble(pool.frames, reassembler) == std::vector<std::string>{"consumed 123"});
+}
+
+TEST_CASE("frame_reassembler_lost_frame")
+{
+  const std::string stream = writeEvents();
+
+  Pool pool(64);
+  binlog::FrameSink sink = makeSink(pool);
+  writeChunks(stream, stream.size(), sink);
+  REQUIRE(pool.frames.size() > 4);
+
+  // lose the first frames: the metadata, and the first events
+  const std::vector<std::string> lastFrames(pool.frames.begin() + 3, pool.frames.end());
+  binlog::FrameReassembler reassembler;
+  for (const std::string& frame : lastFrames)
+  {
+    CHECK(reassembler.add(frame.data(), frame.size()));
+  }
+  CHECK(! reassembler.takeEntries().empty()); // starting at the first entry of the first frame added
+  CHECK(reassembler.lostFrameCount() == 0);     // the first frame added is never a gap
+
+  // lose a frame in the middle: the entries after it remain readable
+  std::vector<std::string> frames = pool.frames;
+  frames.erase(frames.begin() + 4);
+  binlog::FrameReassembler reassembler2;
+  const std::vector<std::string> events = reassemble(frames, reassembler2);
+  CHECK(reassembler2.lostFrameCount() == 1);
+  REQUIRE(! events.empty());
+  CHECK(events.size() < std::size_t(eventCount));
+  CHECK(events.back() == "event " + std::to_string(eventCount - 1));
+
+  // invalid frames
+  CHECK(! reassembler2.add(frames.front().data(), binlog::frameHeaderSize - 1));
+  CHECK(! reassembler2.add(frames.front().data(), binlog::frameHeaderSize + 1));
+}
+
+TEST_CASE("frame_sink_no_buffer")
+{
+  const std::string stream = writeEvents();
+
+  Pool pool(64);
+  pool.available = 2;
+  binlog::FrameSink sink = makeSink(pool);
+  sink.write(stream.data(), std::streamsize(stream.size()));
+  sink.flush();
+
+  CHECK(pool.frames.size() == 2);
+  CHECK(sink.droppedBytes() == stream.size() - 2 * (64 - binlog::frameHeaderSize));
+
+  // the next write takes a buffer again, the gap is visible to the receiver
+  pool.available = std::size_t(-1);
+  writeChunks(stream, stream.size(), sink);
+
+  binlog::FrameReassembler reassembler;
+  const std::vector<std::string> events = reassemble(pool.frames, reassembler);
+  CHECK(reassembler.lostFrameCount() == 1);
+  // the second copy of the stream starts with its metadata
+  REQUIRE(events.size() >= std::size_t(eventCount));
+  const std::vector<std::string> lastEvents(events.end() - eventCount, events.end());
+  CHECK(lastEvents == expectedEvents());
+}
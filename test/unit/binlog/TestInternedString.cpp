@@ -0,0 +1,97 @@
+#include <binlog/InternedString.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/Entries.hpp>
+#include <binlog/EventStream.hpp>
+#include <binlog/PrettyPrinter.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/advanced_log_macros.hpp>
+
+#include <mserialize/tag.hpp>
+
+#include <doctest/doctest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+TEST_CASE("interned_tag")
+{
+  CHECK(mserialize::tag<binlog::InternedStringRef>() == mserialize::tag<binlog::InternedStringId>());
+  CHECK(mserialize::serialized_size(binlog::InternedStringId{123}) == 8);
+}
+
+TEST_CASE("interned_log")
+{
+  binlog::Session session;
+  binlog::SessionWriter writerA(session, 4096);
+  binlog::SessionWriter writerB(session, 4096);
+
+  const std::vector<std::string> symbols{"AAPL", "MSFT", "", "A long symbol, longer than a short string buffer"};
+  std::vector<std::string> expected;
+  for (int i = 0; i < 3; ++i)
+  {
+    for (const std::string& symbol : symbols)
+    {
+      BINLOG_INFO_W(writerA, "A {} {}", binlog::interned(symbol), i);
+      BINLOG_INFO_W(writerB, "B {}", binlog::interned(symbol.c_str()));
+      expected.push_back("A " + symbol + " " + std::to_string(i));
+      expected.push_back("B " + symbol);
+    }
+  }
+
+  TestStream stream;
+  session.consume(stream);
+
+  // each distinct string is added to the stream once, shared by the writers
+  CHECK(countTags(stream, binlog::InternedString::Tag) == symbols.size());
+
+  std::vector<std::string> events = streamToEvents(stream, "%m");
+  std::sort(events.begin(), events.end());
+  std::sort(expected.begin(), expected.end());
+  CHECK(events == expected);
+}
+
+TEST_CASE("interned_event_size")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+
+  const std::string symbol(100, 'x');
+  BINLOG_INFO_W(writer, "{}", binlog::interned(symbol));
+
+  TestStream stream;
+  session.consume(stream);
+
+  binlog::EventStream eventStream;
+  const binlog::Event* event = eventStream.nextEvent(stream);
+  REQUIRE(event != nullptr);
+  CHECK(event->arguments.size() == sizeof(std::uint64_t)); // only the id is copied
+}
+
+TEST_CASE("interned_unknown_id")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+  BINLOG_INFO_W(writer, "{}", binlog::interned("foo"));
+
+  TestStream stream;
+  session.consume(stream);
+
+  binlog::EventStream eventStream;
+  const binlog::Event* event = eventStream.nextEvent(stream);
+  REQUIRE(event != nullptr);
+
+  // without the interned strings, the id is shown
+  binlog::Event copy = *event;
+  copy.internedStrings = nullptr;
+
+  binlog::PrettyPrinter pp("%m", "%Y");
+  std::ostringstream str;
+  pp.printEvent(str, copy);
+  CHECK(str.str() == "binlog::InternedStringId{ id: 1 }");
+}
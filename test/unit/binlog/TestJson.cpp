@@ -0,0 +1,106 @@
+#include <json.hpp>
+
+#include <binlog/EntryStream.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/adapt_enum.hpp>
+#include <binlog/adapt_stdduration.hpp>
+#include <binlog/adapt_struct.hpp>
+#include <binlog/advanced_log_macros.hpp>
+
+#include <doctest/doctest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+struct JsonPoint
+{
+  int x;
+  std::string label;
+};
+
+enum class JsonColor { red, green };
+
+std::string writeJson(binlog::Session& session)
+{
+  std::stringstream stream;
+  session.consume(stream);
+
+  binlog::IstreamEntryStream entryStream(stream);
+  std::ostringstream json;
+  writeJsonEvents(entryStream, json);
+  return json.str();
+}
+
+} // namespace
+
+BINLOG_ADAPT_STRUCT(JsonPoint, x, label)
+BINLOG_ADAPT_ENUM(JsonColor, red, green)
+
+TEST_CASE("json_events")
+{
+  binlog::Session session;
+  session.setClockSync(binlog::ClockSync{0, 1000000000, 0, 0, "UTC"});
+  binlog::SessionWriter writer(session, 4096, 12, "work\"er");
+
+  BINLOG_CREATE_SOURCE_AND_EVENT(writer, binlog::Severity::info, main, 1500000123, "Hello {} {} {}", 7, std::string("a\"b\n\x01"), true);
+  BINLOG_CREATE_SOURCE_AND_EVENT(writer, binlog::Severity::warning, net, 2500000000, "{} {}", std::vector<int>{1, 2}, std::make_tuple('x', 1.5));
+
+  const std::string prefix = "{\"time\":\"1970-01-01T00:00:01.500000123Z\",\"clock\":1500000123,\"writer\":\"work\\\"er\",\"writer_id\":12,";
+  const std::string prefix2 = "{\"time\":\"1970-01-01T00:00:02.500000000Z\",\"clock\":2500000000,\"writer\":\"work\\\"er\",\"writer_id\":12,";
+  const std::string result = writeJson(session);
+
+  std::istringstream lines(result);
+  std::string line1, line2, line3;
+  std::getline(lines, line1);
+  std::getline(lines, line2);
+  CHECK(! std::getline(lines, line3));
+
+  CHECK(line1.substr(0, prefix.size()) == prefix);
+  CHECK(line1.find("\"severity\":\"INFO\",\"category\":\"main\",\"function\":") != std::string::npos);
+  CHECK(line1.find(",\"format\":\"Hello {} {} {}\",\"message\":\"Hello 7 a\\\"b\\n\\u0001 true\",\"args\":[7,\"a\\\"b\\n\\u0001\",true]}") != std::string::npos);
+
+  CHECK(line2.substr(0, prefix2.size()) == prefix2);
+  CHECK(line2.find("\"severity\":\"WARN\",\"category\":\"net\",") != std::string::npos);
+  CHECK(line2.find(",\"message\":\"[1, 2] (x, 1.5)\",\"args\":[[1,2],[\"x\",1.5]]}") != std::string::npos);
+}
+
+TEST_CASE("json_structs_and_enums")
+{
+  binlog::Session session;
+  session.setClockSync(binlog::ClockSync{0, 0, 0, 0, "UTC"}); // no clock sync: time is null
+  binlog::SessionWriter writer(session, 4096, 1, "w");
+
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  const double inf = std::numeric_limits<double>::infinity();
+  BINLOG_CREATE_SOURCE_AND_EVENT(writer, binlog::Severity::info, main, 5, "{} {} {} {} {}",
+    JsonPoint{3, "p"}, JsonColor::green, std::vector<double>{nan, inf, -inf}, std::chrono::milliseconds{10}, std::vector<int>(4, 9));
+
+  const std::string result = writeJson(session);
+  CHECK(result.substr(0, 23) == "{\"time\":null,\"clock\":5,");
+  CHECK(result.find(",\"args\":[{\"x\":3,\"label\":\"p\"},\"green\",[\"nan\",\"inf\",\"-inf\"],\"10ms\",[9,9,9,9]]}\n") != std::string::npos);
+}
+
+TEST_CASE("json_named_arguments")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096, 1, "w");
+
+  BINLOG_CREATE_SOURCE_AND_EVENT(writer, binlog::Severity::info, main, 5, "Fill {} px={px:.1f} qty={qty}", 'a', 1.5, 7);
+
+  const std::string result = writeJson(session);
+  CHECK(result.find(",\"message\":\"Fill a px=1.5 qty=7\",\"args\":[\"a\",1.5,7],\"arg_names\":[null,\"px\",\"qty\"]}\n") != std::string::npos);
+}
+
+TEST_CASE("json_empty")
+{
+  binlog::Session session;
+  CHECK(writeJson(session).empty());
+}
@@ -0,0 +1,217 @@
+#include <merge.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/CompactOutputStream.hpp>
+#include <binlog/Entries.hpp>
+#include <binlog/EntryStream.hpp>
+
+#include <doctest/doctest.h>
+
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+binlog::EventSource eventSource(std::uint64_t id, const char* format)
+{
+  binlog::EventSource source;
+  source.id = id;
+  source.category = "main";
+  source.function = "f";
+  source.file = "merge.cpp";
+  source.line = 1;
+  source.formatString = format;
+  source.argumentTags = "i";
+  return source;
+}
+
+void addEvent(TestStream& stream, std::uint64_t sourceId, std::uint64_t clock, std::int32_t arg)
+{
+  const std::uint32_t size = 2 * sizeof(std::uint64_t) + sizeof(arg);
+  stream.write(reinterpret_cast<const char*>(&size), sizeof(size));
+  stream.write(reinterpret_cast<const char*>(&sourceId), sizeof(sourceId));
+  stream.write(reinterpret_cast<const char*>(&clock), sizeof(clock));
+  stream.write(reinterpret_cast<const char*>(&arg), sizeof(arg));
+}
+
+/** Clock in seconds, a source with the same id as in `secondProcess`, and a source shared with it */
+TestStream firstProcess()
+{
+  TestStream stream;
+  binlog::serializeSizePrefixedTagged(binlog::ClockSync{0, 1000000000, 0, 3600, "CET"}, stream);
+  binlog::serializeSizePrefixedTagged(binlog::WriterProp{1, "P1", 0}, stream);
+  binlog::serializeSizePrefixedTagged(eventSource(1, "a {}"), stream);
+  binlog::serializeSizePrefixedTagged(eventSource(2, "s {}"), stream);
+  addEvent(stream, 1, 0, 0);
+  addEvent(stream, 1, 2000000000, 2);
+  addEvent(stream, 2, 3000000000, 3);
+  addEvent(stream, 1, 4000000000, 4);
+  return stream;
+}
+
+/** Clock in milliseconds, starting at 0.5s, two writers */
+TestStream secondProcess()
+{
+  TestStream stream;
+  binlog::serializeSizePrefixedTagged(binlog::ClockSync{0, 1000, 500000000, 0, "UTC"}, stream);
+  binlog::serializeSizePrefixedTagged(eventSource(2, "s {}"), stream);
+  binlog::serializeSizePrefixedTagged(eventSource(1, "b {}"), stream);
+  binlog::serializeSizePrefixedTagged(binlog::WriterProp{1, "P2", 0}, stream);
+  addEvent(stream, 1, 0, 0);
+  addEvent(stream, 1, 1000, 1);
+  binlog::serializeSizePrefixedTagged(binlog::WriterProp{2, "Q2", 0}, stream);
+  addEvent(stream, 1, 2000, 2);
+  addEvent(stream, 2, 3000, 3);
+  return stream;
+}
+
+TestStream merge(std::vector<TestStream>& inputs, std::size_t expectedCount, std::size_t memoryLimit = std::size_t{1} << 30)
+{
+  std::vector<binlog::EntryStream*> inputPtrs;
+  for (TestStream& input : inputs) { inputPtrs.push_back(&input); }
+
+  std::ostringstream output;
+  CHECK(mergeEvents(inputPtrs, output, memoryLimit) == expectedCount);
+
+  TestStream result;
+  const std::string str = output.str();
+  result.write(str.data(), std::streamsize(str.size()));
+  return result;
+}
+
+/** @returns the events of `stream`, without moving its read position */
+std::vector<std::string> events(TestStream& stream, const char* format = "%n %m")
+{
+  const std::size_t readPos = stream.readPos;
+  std::vector<std::string> result = streamToEvents(stream, format);
+  stream.readPos = readPos;
+  return result;
+}
+
+} // namespace
+
+TEST_CASE("merge_by_time")
+{
+  std::vector<TestStream> inputs{firstProcess(), secondProcess()};
+  TestStream result = merge(inputs, 8);
+
+  const std::vector<std::string> expected{
+    "P1 a 0",
+    "P2 b 0",
+    "P2 b 1",
+    "P1 a 2",
+    "Q2 b 2",
+    "P1 s 3",
+    "Q2 s 3",
+    "P1 a 4",
+  };
+  CHECK(events(result) == expected);
+
+  CHECK(countTags(result, binlog::ClockSync::Tag) == 1);
+  CHECK(countTags(result, binlog::EventSource::Tag) == 3); // s is shared
+}
+
+TEST_CASE("merge_late_writer")
+{
+  // the channel of Q is consumed after P wrote later events
+  TestStream input;
+  binlog::serializeSizePrefixedTagged(binlog::ClockSync{0, 1000, 0, 0, "UTC"}, input);
+  binlog::serializeSizePrefixedTagged(eventSource(1, "a {}"), input);
+  binlog::serializeSizePrefixedTagged(binlog::WriterProp{1, "P", 0}, input);
+  addEvent(input, 1, 1, 1);
+  addEvent(input, 1, 3, 3);
+  addEvent(input, 1, 5, 5);
+  binlog::serializeSizePrefixedTagged(binlog::WriterProp{2, "Q", 0}, input);
+  addEvent(input, 1, 2, 2);
+  addEvent(input, 1, 4, 4);
+  binlog::serializeSizePrefixedTagged(binlog::WriterProp{1, "P", 0}, input);
+  addEvent(input, 1, 6, 6);
+
+  std::vector<TestStream> inputs{std::move(input)};
+  TestStream result = merge(inputs, 6);
+
+  const std::vector<std::string> expected{"P a 1", "Q a 2", "P a 3", "Q a 4", "P a 5", "P a 6"};
+  CHECK(events(result) == expected);
+}
+
+TEST_CASE("merge_event_source_tables")
+{
+  std::vector<TestStream> inputs{firstProcess(), secondProcess()};
+
+  // front code the sources of the first input, e.g: written by bcompact
+  std::ostringstream compact;
+  {
+    binlog::CompactOutputStream output(compact);
+    output.setEventSourceTables(true);
+    const TestStream& first = inputs.front();
+    output.write(first.buffer.data(), std::streamsize(first.buffer.size()));
+  }
+  TestStream compactInput;
+  const std::string str = compact.str();
+  compactInput.write(str.data(), std::streamsize(str.size()));
+  inputs.front() = std::move(compactInput);
+  CHECK(countTags(inputs.front(), binlog::EventSourceTable::Tag) != 0);
+
+  TestStream result = merge(inputs, 8);
+  CHECK(events(result).front() == "P1 a 0");
+  CHECK(countTags(result, binlog::EventSource::Tag) == 3); // s is shared
+}
+
+TEST_CASE("merge_time_zone_of_first_input")
+{
+  std::vector<TestStream> inputs{firstProcess(), secondProcess()};
+  TestStream result = merge(inputs, 8);
+
+  const std::vector<std::string> timestamps = events(result, "%d %r %m");
+  REQUIRE(timestamps.size() == 8);
+  CHECK(timestamps[0] == "1970.01.01 01:00:00 0 a 0");
+  CHECK(timestamps[1] == "1970.01.01 01:00:00 500000000 b 0");
+}
+
+TEST_CASE("merge_memory_limit")
+{
+  std::vector<TestStream> inputs{firstProcess(), secondProcess()};
+  TestStream result = merge(inputs, 8, 0);
+  CHECK(events(result).size() == 8); // not in order, but complete
+}
+
+TEST_CASE("merge_without_clock_sync")
+{
+  TestStream input;
+  binlog::serializeSizePrefixedTagged(eventSource(1, "a {}"), input);
+  addEvent(input, 1, 0, 0);
+
+  std::vector<binlog::EntryStream*> inputs{&input};
+  std::ostringstream output;
+  CHECK_THROWS_AS(mergeEvents(inputs, output), std::runtime_error);
+}
+
+TEST_CASE("merge_clock_corrections")
+{
+  TestStream first;
+  binlog::serializeSizePrefixedTagged(binlog::ClockSync{0, 1000000000, 0, 0, "UTC"}, first);
+  binlog::serializeSizePrefixedTagged(eventSource(1, "a {}"), first);
+  addEvent(first, 1, 0, 0);
+  addEvent(first, 1, 2000000000, 2);
+
+  // the clock of the second host is one second ahead (clock 1s is 2s there), corrected by the session
+  TestStream second;
+  binlog::serializeSizePrefixedTagged(binlog::ClockCorrection{-1000000000, 100}, second);
+  binlog::serializeSizePrefixedTagged(binlog::ClockSync{1000000000, 1000000000, 2000000000 - 1000000000, 0, "UTC"}, second);
+  binlog::serializeSizePrefixedTagged(eventSource(1, "b {}"), second);
+  addEvent(second, 1, 1000000000, 1);
+  addEvent(second, 1, 3000000000, 3);
+
+  std::vector<TestStream> inputs{std::move(first), std::move(second)};
+  TestStream result = merge(inputs, 4);
+
+  const std::vector<std::string> expected{"a 0", "b 1", "a 2", "b 3"};
+  CHECK(events(result, "%m") == expected);
+
+  // a correction before each event of the other input
+  CHECK(countTags(result, binlog::ClockCorrection::Tag) == 3);
+}
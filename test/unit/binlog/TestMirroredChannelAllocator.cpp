@@ -0,0 +1,208 @@
+#include <binlog/MirroredChannelAllocator.hpp>
+
+#ifndef _WIN32
+
+#include "test_utils.hpp"
+
+#include <binlog/ChannelPool.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/advanced_log_macros.hpp>
+#include <binlog/detail/Queue.hpp>
+#include <binlog/detail/QueueReader.hpp>
+#include <binlog/detail/QueueWriter.hpp>
+
+#include <doctest/doctest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+/** A mirrored queue buffer of `capacity` bytes, as a Session::Channel uses it */
+class MirroredBuffer
+{
+public:
+  MirroredBuffer(binlog::MirroredChannelAllocator& allocator, std::size_t capacity)
+    :_allocator(allocator),
+     _size(binlog::Session::Channel::allocationSize(capacity)),
+     _block(allocator.allocate(_size))
+  {}
+
+  ~MirroredBuffer() { _allocator.deallocate(_block, _size); }
+
+  MirroredBuffer(const MirroredBuffer&) = delete;
+  void operator=(const MirroredBuffer&) = delete;
+
+  char* data() { return _block + binlog::Session::Channel::allocationSize(0); }
+
+private:
+  binlog::MirroredChannelAllocator& _allocator;
+  std::size_t _size;
+  char* _block;
+};
+
+void writeBytes(binlog::detail::QueueWriter& w, char c, std::size_t size)
+{
+  REQUIRE(w.beginWrite(size));
+  const std::string data(size, c);
+  w.writeBuffer(data.data(), size);
+  w.endWrite();
+}
+
+} // namespace
+
+TEST_CASE("mirrored_block")
+{
+  binlog::MirroredChannelAllocator allocator;
+  const std::size_t capacity = allocator.mirrorGranularity() * 2;
+  REQUIRE(capacity != 0);
+  CHECK(binlog::Session::Channel::allocationSize(0) < allocator.mirrorGranularity());
+
+  MirroredBuffer buffer(allocator, capacity);
+  CHECK(reinterpret_cast<std::uintptr_t>(buffer.data()) % allocator.mirrorGranularity() == 0);
+  CHECK(reinterpret_cast<std::uintptr_t>(buffer.data() - binlog::Session::Channel::allocationSize(0)) % alignof(std::max_align_t) == 0);
+
+  // the header is writable
+  memset(buffer.data() - binlog::Session::Channel::allocationSize(0), 'h', binlog::Session::Channel::allocationSize(0));
+
+  buffer.data()[0] = 'a';
+  buffer.data()[capacity - 1] = 'b';
+  CHECK(buffer.data()[capacity] == 'a');
+  CHECK(buffer.data()[2 * capacity - 1] == 'b');
+
+  buffer.data()[capacity + 1] = 'c';
+  CHECK(buffer.data()[1] == 'c');
+}
+
+TEST_CASE("mirrored_queue_never_wraps")
+{
+  binlog::MirroredChannelAllocator allocator;
+  const std::size_t capacity = allocator.mirrorGranularity();
+  MirroredBuffer buffer(allocator, capacity);
+
+  binlog::detail::Queue q(buffer.data(), capacity, true);
+  binlog::detail::QueueWriter w(q);
+  binlog::detail::QueueReader r(q);
+
+  writeBytes(w, 'a', capacity - 100);
+  CHECK(r.beginRead().size() == capacity - 100);
+  r.endRead();
+
+  // the whole capacity (but one byte) is writable, across the end of the buffer
+  CHECK(w.beginWrite(capacity - 1));
+  CHECK(! w.beginWrite(capacity));
+  writeBytes(w, 'b', 300);
+  CHECK(q.writeIndex.load() == 200);
+  CHECK(w.unreadWriteSize() == 300);
+
+  // a single span, read into the mirror
+  binlog::detail::QueueReader::ReadResult rr = r.beginRead();
+  CHECK(rr.buffer1 == buffer.data() + capacity - 100);
+  CHECK(rr.size1 == 300);
+  CHECK(rr.size2 == 0);
+  CHECK(std::string(rr.buffer1, rr.size1) == std::string(300, 'b'));
+
+  // partial read, ending past the end of the buffer
+  r.endRead(150);
+  CHECK(q.readIndex.load() == 50);
+  rr = r.beginRead();
+  CHECK(rr.buffer1 == buffer.data() + 50);
+  CHECK(rr.size() == 150);
+  r.endRead();
+
+  CHECK(r.beginRead().size() == 0);
+  CHECK(q.dataEnd == capacity);
+}
+
+TEST_CASE("mirrored_queue_overwrite_oldest")
+{
+  binlog::MirroredChannelAllocator allocator;
+  const std::size_t capacity = allocator.mirrorGranularity();
+  MirroredBuffer buffer(allocator, capacity);
+
+  binlog::detail::Queue q(buffer.data(), capacity, true);
+  binlog::detail::QueueWriter w(q);
+  binlog::detail::QueueReader r(q);
+
+  // entries of 100 bytes: [uint32_t size=96][uint64_t index][88 bytes]
+  for (std::uint64_t i = 0; i < 1000; ++i)
+  {
+    const std::uint32_t size = 96;
+    REQUIRE(w.beginOverwrite(sizeof(size) + size));
+    w.writeBuffer(&size, sizeof(size));
+    w.writeBuffer(&i, sizeof(i));
+    w.writeBuffer(std::string(88, 'x').data(), 88);
+    w.endWrite();
+  }
+
+  // the latest entries are kept, in a single span
+  const binlog::detail::QueueReader::ReadResult rr = r.beginRead();
+  CHECK(rr.size2 == 0);
+  REQUIRE(rr.size1 % 100 == 0);
+  const std::size_t count = rr.size1 / 100;
+  CHECK(count == (capacity - 1) / 100);
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    std::uint64_t index = 0;
+    memcpy(&index, rr.buffer1 + i * 100 + 4, sizeof(index));
+    CHECK(index == 1000 - count + i);
+  }
+}
+
+TEST_CASE("session_with_mirrored_queues")
+{
+  auto allocator = std::make_shared<binlog::MirroredChannelAllocator>();
+  binlog::Session session(allocator);
+
+  const std::size_t capacity = allocator->mirrorGranularity();
+  std::vector<std::string> expected;
+  TestStream stream;
+
+  // rounded up to the page size
+  binlog::SessionWriter writer(session, capacity - 1000);
+
+  // events of more than half of the queue: a wrapping queue would leave
+  // the end of the buffer unused, and grow instead
+  for (int i = 0; i < 20; ++i)
+  {
+    const std::string payload(capacity * 2 / 3, char('a' + i));
+    BINLOG_INFO_W(writer, "{}", payload);
+    expected.push_back(payload);
+    session.consume(stream);
+  }
+
+  CHECK(streamToEvents(stream, "%m") == expected);
+
+  const binlog::Session::Metrics metrics = session.metrics();
+  REQUIRE(metrics.channels.size() == 1);
+  CHECK(metrics.channels[0].capacity == capacity);
+  CHECK(metrics.channels[0].replacementCount == 0);
+}
+
+TEST_CASE("session_with_mirrored_pool")
+{
+  auto allocator = std::make_shared<binlog::MirroredChannelAllocator>();
+  const std::size_t pageSize = allocator->mirrorGranularity();
+  auto pool = std::make_shared<binlog::ChannelPool>(128, 2, 1, allocator);
+  CHECK(pool->mirrorGranularity() == pageSize);
+  CHECK(pool->freeBlockCount() == 2);
+
+  binlog::Session session(pool);
+  {
+    // rounded up to a page, served by the first class
+    binlog::SessionWriter writer(session, 128);
+    CHECK(pool->freeBlockCount() == 1);
+
+    BINLOG_INFO_W(writer, "Hello {}", std::string(pageSize - 200, 'x'));
+    BINLOG_INFO_W(writer, "Hello {}", 2);
+  }
+
+  CHECK(getEvents(session, "%m") == std::vector<std::string>{"Hello " + std::string(pageSize - 200, 'x'), "Hello 2"});
+  CHECK(pool->freeBlockCount() == 2);
+}
+
+#endif // _WIN32
@@ -0,0 +1,171 @@
+#include <binlog/MmapChannelAllocator.hpp>
+
+#ifndef _WIN32
+
+#include "test_utils.hpp"
+
+#include <binlog/ChannelPool.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/advanced_log_macros.hpp>
+
+#include <doctest/doctest.h>
+
+#include <algorithm> // sort
+#include <cstdint>
+#include <cstdlib> // mkdtemp
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <dirent.h> // NOLINT opendir
+#include <unistd.h> // NOLINT rmdir
+
+namespace {
+
+void checkBlock(binlog::MmapChannelAllocator& allocator, std::size_t size)
+{
+  char* block = allocator.allocate(size);
+  REQUIRE(block != nullptr);
+  CHECK(reinterpret_cast<std::uintptr_t>(block) % alignof(std::max_align_t) == 0);
+
+  memset(block, 'x', size);
+  CHECK(block[size - 1] == 'x');
+
+  allocator.deallocate(block, size);
+}
+
+/** @returns the sorted names of the files in `path` with `extension` */
+std::vector<std::string> listFiles(const std::string& path, const std::string& extension)
+{
+  std::vector<std::string> result;
+  DIR* dir = opendir(path.c_str());
+  REQUIRE(dir != nullptr);
+  while (const dirent* entry = readdir(dir)) // NOLINT(concurrency-mt-unsafe)
+  {
+    const std::string name = entry->d_name;
+    if (name.size() > extension.size() && name.compare(name.size() - extension.size(), extension.size(), extension) == 0)
+    {
+      result.push_back(path + "/" + name);
+    }
+  }
+  closedir(dir);
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+std::vector<char> readFile(const std::string& path)
+{
+  std::ifstream file(path, std::ios_base::in | std::ios_base::binary);
+  return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+} // namespace
+
+TEST_CASE("default_options")
+{
+  binlog::MmapChannelAllocator allocator;
+  checkBlock(allocator, 1);
+  checkBlock(allocator, 4096);
+  checkBlock(allocator, 1 << 20);
+}
+
+TEST_CASE("all_options")
+{
+  binlog::MmapChannelAllocator::Options options;
+  options.hugeTlb = true; // falls back to regular pages if there are no reserved huge pages
+  options.transparentHugePages = true;
+  options.lock = true;
+  options.numaNode = 0;
+
+  binlog::MmapChannelAllocator allocator(options);
+  checkBlock(allocator, 128);
+  checkBlock(allocator, (1 << 21) + 1);
+}
+
+TEST_CASE("session_with_mmap_pool")
+{
+  auto allocator = std::make_shared<binlog::MmapChannelAllocator>();
+  auto pool = std::make_shared<binlog::ChannelPool>(128, 1, 1, allocator);
+  binlog::Session session(pool);
+
+  {
+    binlog::SessionWriter writer(session, 128);
+    BINLOG_INFO_W(writer, "Hello {}", 1);
+
+    // grow the queue, allocated from the mmap allocator directly
+    BINLOG_INFO_W(writer, "Hello {}", std::string(200, 'x'));
+  }
+
+  CHECK(getEvents(session, "%m") == std::vector<std::string>{"Hello 1", "Hello " + std::string(200, 'x')});
+  CHECK(pool->freeBlockCount() == 1);
+}
+
+TEST_CASE("file_backed_blocks")
+{
+  char dirTemplate[] = "/tmp/binlog_test_XXXXXX";
+  REQUIRE(mkdtemp(dirTemplate) != nullptr);
+  const std::string dir = dirTemplate;
+
+  binlog::MmapChannelAllocator::Options options;
+  options.directory = dir;
+  auto allocator = std::make_shared<binlog::MmapChannelAllocator>(options);
+
+  {
+    binlog::Session session(allocator);
+    binlog::SessionWriter writer(session, 128);
+    BINLOG_INFO_W(writer, "Consumed {}", 1);
+    CHECK(getEvents(session, "%m") == std::vector<std::string>{"Consumed 1"});
+
+    BINLOG_INFO_W(writer, "Unconsumed {}", 2);
+    BINLOG_WARN_W(writer, "Not yet consumed source {}", 3);
+
+    // recover the unconsumed data from the files, as brecovery does
+    const std::vector<std::string> metadataFiles = listFiles(dir, ".metadata");
+    const std::vector<std::string> queueFiles = listFiles(dir, ".queue");
+    REQUIRE(metadataFiles.size() == 1);
+    REQUIRE(queueFiles.size() == 1);
+
+    const std::vector<char> metadata = readFile(metadataFiles[0]);
+    const std::vector<char> block = readFile(queueFiles[0]);
+
+    const std::size_t metadataHeaderSize = sizeof(std::uint64_t) + sizeof(void*) + sizeof(std::uint64_t);
+    REQUIRE(metadata.size() > metadataHeaderSize);
+    std::uint64_t magic = 0;
+    const binlog::Session* sessionptr = nullptr;
+    std::uint64_t metadataSize = 0;
+    memcpy(&magic, metadata.data(), sizeof(magic));
+    memcpy(&sessionptr, metadata.data() + sizeof(magic), sizeof(sessionptr));
+    memcpy(&metadataSize, metadata.data() + sizeof(magic) + sizeof(sessionptr), sizeof(metadataSize));
+    CHECK(magic == 0xFE214F726E35BDBC);
+    CHECK(sessionptr == &session);
+    CHECK(metadataSize == metadata.size() - metadataHeaderSize);
+
+    const std::size_t queueOffset = sizeof(std::uint64_t) + sizeof(binlog::Session*);
+    REQUIRE(block.size() > queueOffset + sizeof(binlog::detail::Queue));
+    memcpy(&magic, block.data(), sizeof(magic));
+    memcpy(&sessionptr, block.data() + sizeof(magic), sizeof(sessionptr));
+    CHECK(magic == 0xFE213F716D34BCBC);
+    CHECK(sessionptr == &session);
+
+    binlog::detail::Queue queue(nullptr, 0);
+    memcpy(static_cast<void*>(&queue), block.data() + queueOffset, sizeof(queue));
+    REQUIRE(queue.readIndex.load() <= queue.writeIndex.load()); // no wraparound
+
+    TestStream stream;
+    stream.write(metadata.data() + metadataHeaderSize, std::streamsize(metadataSize));
+    const char* unconsumed = block.data() + queueOffset + sizeof(binlog::detail::Queue) + queue.readIndex.load();
+    stream.write(unconsumed, std::streamsize(queue.writeIndex.load() - queue.readIndex.load()));
+    CHECK(streamToEvents(stream, "%m") == std::vector<std::string>{"Unconsumed 2", "Not yet consumed source 3"});
+  }
+
+  // closed channels and destroyed sessions leave no files behind
+  CHECK(listFiles(dir, ".queue").empty());
+  CHECK(listFiles(dir, ".metadata").empty());
+  CHECK(rmdir(dir.c_str()) == 0);
+}
+
+#endif // _WIN32
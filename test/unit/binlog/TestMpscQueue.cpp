@@ -0,0 +1,165 @@
+#include <binlog/detail/MpscQueue.hpp>
+
+#include <doctest/doctest.h>
+
+#include <cstdint>
+#include <cstring> // memcpy
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+bool writeq(binlog::detail::MpscQueue& q, const std::string& payload)
+{
+  char* entry = q.beginWrite(std::uint32_t(payload.size()));
+  if (entry == nullptr) { return false; }
+  memcpy(entry, payload.data(), payload.size());
+  q.endWrite(entry, std::uint32_t(payload.size()));
+  return true;
+}
+
+/** Read the entries, return their payloads */
+std::vector<std::string> readq(binlog::detail::MpscQueue& q, std::size_t maxSize = std::size_t(-1))
+{
+  std::vector<char> entries;
+  const std::uint64_t end = q.beginRead(entries, maxSize);
+  q.endRead(end);
+
+  std::vector<std::string> result;
+  for (std::size_t i = 0; i < entries.size();)
+  {
+    std::uint32_t size = 0;
+    memcpy(&size, entries.data() + i, sizeof(size));
+    i += sizeof(size);
+    result.emplace_back(entries.data() + i, size);
+    i += size;
+  }
+  return result;
+}
+
+} // namespace
+
+TEST_CASE("mpsc_empty")
+{
+  alignas(8) char buffer[128];
+  binlog::detail::MpscQueue q(buffer, sizeof(buffer));
+  CHECK(q.capacity() == 128);
+  CHECK(readq(q).empty());
+}
+
+TEST_CASE("mpsc_write_read")
+{
+  alignas(8) char buffer[128];
+  binlog::detail::MpscQueue q(buffer, sizeof(buffer));
+
+  CHECK(writeq(q, "foo"));
+  CHECK(writeq(q, "barbaz"));
+  CHECK(readq(q) == std::vector<std::string>{"foo", "barbaz"});
+  CHECK(readq(q).empty());
+}
+
+TEST_CASE("mpsc_read_budget")
+{
+  alignas(8) char buffer[128];
+  binlog::detail::MpscQueue q(buffer, sizeof(buffer));
+
+  CHECK(writeq(q, "foo"));
+  CHECK(writeq(q, "barbaz"));
+  CHECK(writeq(q, "x"));
+
+  CHECK(readq(q, 1) == std::vector<std::string>{"foo"}); // at least one entry
+  CHECK(readq(q, 15) == std::vector<std::string>{"barbaz", "x"});
+  CHECK(readq(q, 15).empty());
+}
+
+TEST_CASE("mpsc_uncommitted_entry_stops_reader")
+{
+  alignas(8) char buffer[128];
+  binlog::detail::MpscQueue q(buffer, sizeof(buffer));
+
+  CHECK(writeq(q, "first"));
+  char* pending = q.beginWrite(6);
+  REQUIRE(pending != nullptr);
+  CHECK(writeq(q, "third"));
+
+  CHECK(readq(q) == std::vector<std::string>{"first"});
+
+  memcpy(pending, "second", 6);
+  q.endWrite(pending, 6);
+  CHECK(readq(q) == std::vector<std::string>{"second", "third"});
+}
+
+TEST_CASE("mpsc_full_and_wrap_around")
+{
+  alignas(8) char buffer[64];
+  binlog::detail::MpscQueue q(buffer, sizeof(buffer));
+
+  // each entry takes 4+20 bytes
+  const std::string payload(20, 'x');
+  CHECK(writeq(q, payload));
+  CHECK(writeq(q, payload));
+  CHECK(! writeq(q, payload)); // 16 bytes left
+  CHECK(! writeq(q, std::string(100, 'y')));
+
+  CHECK(readq(q).size() == 2);
+
+  // 16 bytes are skipped at the end, the entry continues at the beginning
+  CHECK(writeq(q, std::string(30, 'a')));
+  CHECK(! writeq(q, std::string(9, 'b'))); // the skipped bytes are not free until read
+  CHECK(readq(q) == std::vector<std::string>{std::string(30, 'a')});
+
+  CHECK(writeq(q, std::string(9, 'b')));
+  CHECK(writeq(q, std::string(9, 'c'))); // skips 12 bytes
+  CHECK(readq(q) == std::vector<std::string>{std::string(9, 'b'), std::string(9, 'c')});
+
+  for (int i = 0; i < 100; ++i)
+  {
+    CHECK(writeq(q, std::to_string(i)));
+    CHECK(readq(q) == std::vector<std::string>{std::to_string(i)});
+  }
+}
+
+TEST_CASE("mpsc_concurrent_writers")
+{
+  std::vector<char> buffer(4096);
+  binlog::detail::MpscQueue q(buffer.data(), buffer.size());
+
+  const int writerCount = 4;
+  const int messageCount = 10000;
+
+  std::vector<std::thread> writers;
+  for (int t = 0; t < writerCount; ++t)
+  {
+    writers.emplace_back([&q, t]()
+    {
+      for (int i = 0; i < messageCount; ++i)
+      {
+        const std::string payload = std::to_string(t) + ":" + std::to_string(i);
+        while (! writeq(q, payload)) { std::this_thread::yield(); }
+      }
+    });
+  }
+
+  // messages of a writer are read in order
+  std::vector<int> next(writerCount, 0);
+  int readCount = 0;
+  bool inOrder = true;
+  while (readCount < writerCount * messageCount)
+  {
+    for (const std::string& payload : readq(q))
+    {
+      const std::size_t colon = payload.find(':');
+      const int t = std::stoi(payload.substr(0, colon));
+      const int i = std::stoi(payload.substr(colon + 1));
+      inOrder = inOrder && next[std::size_t(t)] == i;
+      next[std::size_t(t)] = i + 1;
+      ++readCount;
+    }
+  }
+
+  for (std::thread& writer : writers) { writer.join(); }
+
+  CHECK(inOrder);
+  CHECK(readq(q).empty());
+}
@@ -0,0 +1,42 @@
+// The log statements of this file call the outlined addEvent
+#define BINLOG_OUTLINE_EVENTS
+
+#include <binlog/Constant.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/advanced_log_macros.hpp>
+#include <binlog/sampled_log_macros.hpp>
+
+#include "test_utils.hpp"
+
+#include <doctest/doctest.h>
+
+#include <string>
+#include <vector>
+
+TEST_CASE("outlined_events")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 128);
+
+  const std::string str(300, 'x'); // larger than the queue: replaces the channel
+  for (int i = 0; i < 2; ++i)
+  {
+    BINLOG_INFO_W(writer, "int {}", i);
+    BINLOG_INFO_W(writer, "int again {}", i + 10);
+    BINLOG_INFO_W(writer, "{} {} {}", str.substr(0, 7), binlog::constant("constant"), str.size());
+  }
+  BINLOG_INFO_W(writer, "str {}", str);
+  BINLOG_INFO_EVERY_N_WC(writer, main, 1, "sampled {}", 1);
+
+  CHECK(getEvents(session, "%m") == std::vector<std::string>{
+    "int 0",
+    "int again 10",
+    "xxxxxxx constant 300",
+    "int 1",
+    "int again 11",
+    "xxxxxxx constant 300",
+    "str " + str,
+    "sampled 1 (0 suppressed)",
+  });
+}
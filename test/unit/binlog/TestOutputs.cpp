@@ -0,0 +1,108 @@
+#include <outputs.hpp>
+
+#include <json.hpp>
+#include <printers.hpp>
+#include <stats.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/EntryStream.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+
+#include <doctest/doctest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string makeLogfile()
+{
+  binlog::Session session;
+  session.setClockSync(binlog::ClockSync{0, 1000000000, 0, 0, "UTC"});
+  binlog::SessionWriter w1(session, 4096, 1, "w1");
+  binlog::SessionWriter w2(session, 4096, 2, "w2");
+  const std::uint64_t a = addEventSource<int, std::string>(session, binlog::Severity::info, "net", "a {} {}");
+  const std::uint64_t b = addEventSource<double>(session, binlog::Severity::warning, "main", "b {}");
+
+  for (int i = 0; i < 100; ++i)
+  {
+    CHECK(w1.addEvent(a, std::uint64_t(i) * 10000000, i, std::string(std::size_t(i % 7), 'x')));
+    CHECK(w2.addEvent(b, std::uint64_t(i) * 20000000, i * 0.5));
+  }
+
+  std::ostringstream logfile;
+  session.consume(logfile);
+  return logfile.str();
+}
+
+const char* const format = "%S %C [%u] %n %m\n";
+const char* const dateFormat = "%Y-%m-%d %H:%M:%S.%N";
+
+} // namespace
+
+TEST_CASE("write_outputs_same_as_separate")
+{
+  const std::string logfile = makeLogfile();
+  std::istringstream input(logfile);
+  binlog::IstreamEntryStream entryStream(input);
+  std::ostringstream text, json, stats, text2;
+  writeOutputs(entryStream, {
+    {OutputKind::text, &text},
+    {OutputKind::json, &json},
+    {OutputKind::stats, &stats},
+    {OutputKind::text, &text2},
+  }, format, dateFormat);
+
+  std::istringstream textInput(logfile);
+  std::ostringstream expectedText;
+  printEvents(textInput, expectedText, format, dateFormat);
+  CHECK(text.str() == expectedText.str());
+  CHECK(text2.str() == expectedText.str());
+
+  std::istringstream jsonInput(logfile);
+  binlog::IstreamEntryStream jsonEntryStream(jsonInput);
+  std::ostringstream expectedJson;
+  writeJsonEvents(jsonEntryStream, expectedJson);
+  CHECK(json.str() == expectedJson.str());
+
+  std::istringstream statsInput(logfile);
+  binlog::IstreamEntryStream statsEntryStream(statsInput);
+  std::ostringstream expectedStats;
+  printStatistics(collectStatistics(statsEntryStream, std::chrono::seconds{1}), expectedStats, 20, std::chrono::seconds{1});
+  CHECK(stats.str() == expectedStats.str());
+}
+
+TEST_CASE("write_outputs_empty_input")
+{
+  std::istringstream input;
+  binlog::IstreamEntryStream entryStream(input);
+  std::ostringstream text, json;
+  writeOutputs(entryStream, {{OutputKind::text, &text}, {OutputKind::json, &json}}, format, dateFormat);
+  CHECK(text.str().empty());
+  CHECK(json.str().empty());
+}
+
+TEST_CASE("parse_output_spec")
+{
+  OutputSpec spec;
+  CHECK(parseOutputSpec("text:a.txt", spec));
+  CHECK(spec.kind == OutputKind::text);
+  CHECK(spec.path == "a.txt");
+
+  CHECK(parseOutputSpec("json:/tmp/a:b.json", spec));
+  CHECK(spec.kind == OutputKind::json);
+  CHECK(spec.path == "/tmp/a:b.json");
+
+  CHECK(parseOutputSpec("stats:-", spec));
+  CHECK(spec.kind == OutputKind::stats);
+
+  CHECK(! parseOutputSpec("text", spec));
+  CHECK(! parseOutputSpec("text:", spec));
+  CHECK(! parseOutputSpec("xml:a.xml", spec));
+  CHECK(! parseOutputSpec(":a", spec));
+}
@@ -0,0 +1,46 @@
+#include <binlog/PackedInteger.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/advanced_log_macros.hpp>
+
+#include <mserialize/serialize.hpp>
+#include <mserialize/tag.hpp>
+
+#include <doctest/doctest.h>
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+TEST_CASE("packed_tag_and_size")
+{
+  CHECK(mserialize::tag<binlog::PackedInteger<int>>() == "q");
+  CHECK(mserialize::tag<binlog::PackedInteger<std::uint16_t>>() == "Q");
+
+  CHECK(mserialize::serialized_size(binlog::packed(0)) == 1);
+  CHECK(mserialize::serialized_size(binlog::packed(100)) == 2);
+  CHECK(mserialize::serialized_size(binlog::packed(-100)) == 2);
+  CHECK(mserialize::serialized_size(binlog::packed(std::int64_t{1} << 40)) == 7);
+  CHECK(mserialize::serialized_size(binlog::packed(std::numeric_limits<std::uint64_t>::max())) == 9);
+}
+
+TEST_CASE("packed_log")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 128);
+
+  BINLOG_INFO_W(writer, "{} {} {} {}",
+    binlog::packed(0), binlog::packed(std::int8_t{-128}), binlog::packed(65535u),
+    binlog::packed(std::numeric_limits<std::int64_t>::min())
+  );
+  BINLOG_INFO_W(writer, "{}", std::vector<binlog::PackedInteger<long>>{{1}, {-2}, {300}});
+
+  CHECK(getEvents(session, "%m") == std::vector<std::string>{
+    "0 -128 65535 -9223372036854775808",
+    "[1, -2, 300]",
+  });
+}
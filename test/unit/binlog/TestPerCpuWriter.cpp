@@ -0,0 +1,71 @@
+#include <binlog/PerCpuWriter.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/Session.hpp>
+#include <binlog/advanced_log_macros.hpp>
+
+#include <doctest/doctest.h>
+
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE("per_cpu_writer_names")
+{
+  binlog::Session session;
+  binlog::PerCpuWriter writer(session, 128, 1, "core");
+  CHECK(writer.writerCount() == 1);
+
+  BINLOG_INFO_W(writer, "Hello {}", 1);
+  CHECK(getEvents(session, "%t %n %m") == std::vector<std::string>{"0 core0 Hello 1"});
+}
+
+TEST_CASE("per_cpu_writer_default_count")
+{
+  binlog::Session session;
+  binlog::PerCpuWriter writer(session, 128);
+  CHECK(writer.writerCount() >= 1);
+}
+
+TEST_CASE("per_cpu_writer_many_threads")
+{
+  binlog::Session session;
+  binlog::PerCpuWriter writer(session, 1 << 20, 2);
+
+  const int threadCount = 8;
+  const int eventCount = 1000;
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < threadCount; ++t)
+  {
+    threads.emplace_back([&writer, t]()
+    {
+      for (int i = 0; i < eventCount; ++i)
+      {
+        BINLOG_INFO_W(writer, "{} {}", t, i);
+      }
+    });
+  }
+  for (std::thread& thread : threads) { thread.join(); }
+
+  // the channel count is bounded by the writers, not by the threads
+  TestStream stream;
+  const binlog::Session::ConsumeResult cr = session.consume(stream);
+  CHECK(cr.channelsPolled <= 2);
+
+  std::vector<std::string> events = streamToEvents(stream, "%m");
+  std::vector<std::string> expectedEvents;
+  for (int t = 0; t < threadCount; ++t)
+  {
+    for (int i = 0; i < eventCount; ++i)
+    {
+      expectedEvents.push_back(std::to_string(t) + " " + std::to_string(i));
+    }
+  }
+
+  std::sort(events.begin(), events.end());
+  std::sort(expectedEvents.begin(), expectedEvents.end());
+  CHECK(events == expectedEvents);
+}
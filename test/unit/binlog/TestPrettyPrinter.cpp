@@ -7,9 +7,12 @@
 
 #include <doctest/doctest.h>
 
+#include <cstdint>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <tuple>
+#include <vector>
 
 namespace {
 
@@ -66,6 +69,15 @@ TEST_CASE_FIXTURE(TestcaseBase, "full_fmt")
   );
 }
 
+TEST_CASE_FIXTURE(TestcaseBase, "writer_context")
+{
+  binlog::PrettyPrinter pp("[%c] %n %m", "");
+  CHECK(print(pp) == "[] writer a: 111, b: foo");
+
+  writerProp.context = "trace-1";
+  CHECK(print(pp) == "[trace-1] writer a: 111, b: foo");
+}
+
 TEST_CASE_FIXTURE(TestcaseBase, "reverse_full_fmt")
 {
   // make sure PP assumes no particular order
@@ -138,6 +150,32 @@ TEST_CASE_FIXTURE(TestcaseBase, "tzoffset")
   CHECK(print(pp) == "+0230");
 }
 
+TEST_CASE_FIXTURE(TestcaseBase, "cached_time")
+{
+  binlog::PrettyPrinter pp("%d|%u", "%H:%M:%S.%N %Z %N");
+  clockSync.clockFrequency = 1'000'000'000; // ns
+
+  event.clockValue = 1'000'000'001;
+  CHECK(print(pp) == "01:30:01.000000001 XYZ 000000001|00:00:01.000000001 UTC 000000001");
+
+  // same second, only the nanoseconds change
+  event.clockValue = 1'987'654'321;
+  CHECK(print(pp) == "01:30:01.987654321 XYZ 987654321|00:00:01.987654321 UTC 987654321");
+
+  // next second
+  event.clockValue = 2'000'000'000;
+  CHECK(print(pp) == "01:30:02.000000000 XYZ 000000000|00:00:02.000000000 UTC 000000000");
+
+  // same second, different time zone
+  clockSync.tzOffset = 0;
+  clockSync.tzName = "ABC";
+  CHECK(print(pp) == "00:00:02.000000000 ABC 000000000|00:00:02.000000000 UTC 000000000");
+
+  // before the epoch
+  event.clockValue = std::uint64_t(-1'000'000'000);
+  CHECK(print(pp) == "23:59:59.000000000 ABC 000000000|23:59:59.000000000 UTC 000000000");
+}
+
 TEST_CASE_FIXTURE(TestcaseBase, "corrupt_argument_tags")
 {
   binlog::PrettyPrinter pp("%m", "");
@@ -172,6 +210,46 @@ TEST_CASE_FIXTURE(TestcaseBase, "curlies_in_event_source_format")
   CHECK(print(pp) == "{ 111_{foo_ {");
 }
 
+TEST_CASE_FIXTURE(TestcaseBase, "named_placeholders")
+{
+  binlog::PrettyPrinter pp("%m", "");
+
+  eventSource.formatString = "a={a:>4} b={b}";
+  CHECK(print(pp) == "a= 111 b=foo");
+}
+
+TEST_CASE_FIXTURE(TestcaseBase, "literal_names_in_event_source_format")
+{
+  binlog::PrettyPrinter pp("%m", "");
+
+  // written before named placeholders: more placeholders than arguments, {name} is literal
+  eventSource.formatString = "literal {x} text {} {y:>3} {}";
+  CHECK(print(pp) == "literal {x} text 111 {y:>3} foo");
+
+  binlog::EventSource onlyLiteral{
+    124, binlog::Severity::info, "cat", "func", "file", 1, "only {x}", ""
+  };
+  event.source = &onlyLiteral;
+  event.arguments = binlog::Range{};
+  CHECK(print(pp) == "only {x}");
+}
+
+TEST_CASE_FIXTURE(TestcaseBase, "source_with_reused_id")
+{
+  binlog::PrettyPrinter pp("%G %m", "");
+  CHECK(print(pp) == "file a: 111, b: foo");
+
+  // same id, different source, e.g: in concatenated logfiles
+  binlog::EventSource other{
+    123, binlog::Severity::info, "cat", "func", "other.cpp", 1, "b={} a={}", "i[c"
+  };
+  event.source = &other;
+  CHECK(print(pp) == "other.cpp b=111 a=foo");
+
+  event.source = &eventSource;
+  CHECK(print(pp) == "file a: 111, b: foo");
+}
+
 TEST_CASE_FIXTURE(TestcaseBase, "closing_percentage")
 {
   binlog::PrettyPrinter pp("%d %", "%Z %");
@@ -179,6 +257,84 @@ TEST_CASE_FIXTURE(TestcaseBase, "closing_percentage")
   CHECK(print(pp) == "XYZ % %");
 }
 
+TEST_CASE_FIXTURE(TestcaseBase, "literals_and_placeholders")
+{
+  binlog::PrettyPrinter pp("[%S]%%%C%%;%L%", "");
+  CHECK(print(pp) == "[INFO]%cat%;456%");
+
+  // the compiled format is reused
+  eventSource.line = 7;
+  CHECK(print(pp) == "[INFO]%cat%;7%");
+}
+
+TEST_CASE_FIXTURE(TestcaseBase, "print_to_buffer")
+{
+  binlog::PrettyPrinter pp("%m\n", "");
+  std::ostringstream str;
+  binlog::detail::OstreamBuffer buf(str);
+  pp.printEvent(buf, event, writerProp, clockSync);
+  pp.printEvent(buf, event, writerProp, clockSync);
+  CHECK(str.str() == "");
+
+  buf.flush();
+  CHECK(str.str() == "a: 111, b: foo\na: 111, b: foo\n");
+}
+
+TEST_CASE_FIXTURE(TestcaseBase, "hex_bytes")
+{
+  eventSource.formatString = "bytes: {} {}";
+  eventSource.argumentTags = "[B[c";
+  std::ostringstream argsBufferStream;
+  mserialize::serialize(std::vector<std::uint8_t>{0xde, 0xad, 0xbe, 0xef}, argsBufferStream);
+  mserialize::serialize(std::string("foo"), argsBufferStream);
+  argsBuffer = argsBufferStream.str();
+  event.arguments = binlog::Range(argsBuffer.data(), argsBuffer.data() + argsBuffer.size());
+
+  binlog::PrettyPrinter pp("%m | %h", "");
+  CHECK(print(pp) == "bytes: [222, 173, 190, 239] foo | bytes: 0xdeadbeef foo");
+}
+
+TEST_CASE_FIXTURE(TestcaseBase, "format_specs")
+{
+  eventSource.formatString = "{:x}|{:#06X}|{:+}|{:b}|{:>5}|{:.3f}|{:08.2f}|{:e}|{:.3}|{:<6}|{:^7}|{:*>5.2}|{:.2f}|{:d}";
+  eventSource.argumentTags = "iIiBi" "dddd" "[c[c[c" "i" "y";
+  std::ostringstream argsBufferStream;
+  mserialize::serialize(255, argsBufferStream);
+  mserialize::serialize(std::uint32_t(0xbeef), argsBufferStream);
+  mserialize::serialize(5, argsBufferStream);
+  mserialize::serialize(std::uint8_t(5), argsBufferStream);
+  mserialize::serialize(-42, argsBufferStream);
+  mserialize::serialize(3.14159, argsBufferStream);
+  mserialize::serialize(-2.5, argsBufferStream);
+  mserialize::serialize(1234.5, argsBufferStream);
+  mserialize::serialize(2.0/3, argsBufferStream);
+  mserialize::serialize(std::string("foo"), argsBufferStream);
+  mserialize::serialize(std::string("mid"), argsBufferStream);
+  mserialize::serialize(std::string("trimmed"), argsBufferStream);
+  mserialize::serialize(7, argsBufferStream);
+  mserialize::serialize(true, argsBufferStream);
+  argsBuffer = argsBufferStream.str();
+  event.arguments = binlog::Range(argsBuffer.data(), argsBuffer.data() + argsBuffer.size());
+
+  binlog::PrettyPrinter pp("%m", "");
+  CHECK(print(pp) == "ff|0XBEEF|+5|101|  -42|3.142|-0002.50|1.234500e+03|0.667|foo   |  mid  |***tr|7.00|true");
+}
+
+TEST_CASE_FIXTURE(TestcaseBase, "format_specs_of_composites")
+{
+  eventSource.formatString = "[{:>10}] [{:_<8}] [{}]";
+  eventSource.argumentTags = "[i(ic)i";
+  std::ostringstream argsBufferStream;
+  mserialize::serialize(std::vector<int>{1, 2}, argsBufferStream);
+  mserialize::serialize(std::make_tuple(3, 'x'), argsBufferStream);
+  mserialize::serialize(4, argsBufferStream);
+  argsBuffer = argsBufferStream.str();
+  event.arguments = binlog::Range(argsBuffer.data(), argsBuffer.data() + argsBuffer.size());
+
+  binlog::PrettyPrinter pp("%m", "");
+  CHECK(print(pp) == "[    [1, 2]] [(3, x)__] [4]");
+}
+
 TEST_CASE_FIXTURE(TestcaseBase, "inline_time_localtime_by_default")
 {
   binlog::PrettyPrinter pp("%m", "%Y-%m-%d %H:%M:%S.%N %z %Z");
@@ -228,3 +384,95 @@ TEST_CASE_FIXTURE(TestcaseBase, "inline_time_utc_if_u")
     "1970-01-01 00:00:00.000000789 +0000 UTC"  // %m
   );
 }
+
+TEST_CASE_FIXTURE(TestcaseBase, "custom_struct_printer")
+{
+  eventSource.formatString = "{} {} {}";
+  eventSource.argumentTags = "{Price`mantissa'l}[{Price`mantissa'l}{binlog::address`value'L}";
+
+  std::ostringstream argsBufferStream;
+  mserialize::serialize(std::int64_t{12345}, argsBufferStream);
+  mserialize::serialize(std::uint32_t{2}, argsBufferStream);
+  mserialize::serialize(std::int64_t{150}, argsBufferStream);
+  mserialize::serialize(std::int64_t{275}, argsBufferStream);
+  mserialize::serialize(std::uint64_t{255}, argsBufferStream);
+  argsBuffer = argsBufferStream.str();
+  event.arguments = binlog::Range(argsBuffer.data(), argsBuffer.data() + argsBuffer.size());
+
+  binlog::PrettyPrinter pp("%m", "");
+  CHECK(print(pp) == "Price{ mantissa: 12345 } [Price{ mantissa: 150 }, Price{ mantissa: 275 }] 0xFF");
+
+  // added after a source is cached
+  pp.addStructPrinter("Price", "`mantissa'l", [](binlog::detail::OstreamBuffer& out, binlog::Range& input)
+  {
+    const std::int64_t mantissa = input.read<std::int64_t>();
+    out << mantissa / 100 << '.' << mantissa % 100;
+    return true;
+  });
+  CHECK(print(pp) == "123.45 [1.50, 2.75] 0xFF");
+
+  // replace a built-in printer, fall back to the fields
+  pp.addStructPrinter("binlog::address", "`value'L", [](binlog::detail::OstreamBuffer&, binlog::Range&)
+  {
+    return false;
+  });
+  CHECK(print(pp) == "123.45 [1.50, 2.75] binlog::address{ value: 255 }");
+}
+
+TEST_CASE_FIXTURE(TestcaseBase, "custom_enum_printer")
+{
+  eventSource.formatString = "{} {} {}";
+  eventSource.argumentTags = "/i`Flags'1`a'2`b'\\/b`Small'-1`minus_one'\\/L`Flags'\\";
+
+  std::ostringstream argsBufferStream;
+  mserialize::serialize(std::int32_t{3}, argsBufferStream);
+  mserialize::serialize(std::int8_t{-1}, argsBufferStream);
+  mserialize::serialize(std::uint64_t{0xFFFFFFFFFFFFFFFF}, argsBufferStream);
+  argsBuffer = argsBufferStream.str();
+  event.arguments = binlog::Range(argsBuffer.data(), argsBuffer.data() + argsBuffer.size());
+
+  binlog::PrettyPrinter pp("%m", "");
+  CHECK(print(pp) == "0x3 minus_one 0xFFFFFFFFFFFFFFFF");
+
+  pp.addEnumPrinter("Flags", [](binlog::detail::OstreamBuffer& out, std::int64_t value, mserialize::string_view)
+  {
+    out << "flags:" << value;
+    return true;
+  });
+  pp.addEnumPrinter("Small", [](binlog::detail::OstreamBuffer& out, std::int64_t value, mserialize::string_view enumerator)
+  {
+    if (value != -1) { return false; }
+    out << enumerator << '=' << value;
+    return true;
+  });
+  CHECK(print(pp) == "flags:3 minus_one=-1 flags:-1");
+}
+
+TEST_CASE("printer_plugin_errors")
+{
+  binlog::PrettyPrinter pp("%m", "");
+  CHECK_THROWS_AS(pp.loadPrinterPlugin("no_such_plugin.so"), std::runtime_error);
+}
+
+#ifdef BINLOG_TEST_PRINTER_PLUGIN
+
+TEST_CASE_FIXTURE(TestcaseBase, "printer_plugin")
+{
+  eventSource.formatString = "{} {} {}";
+  eventSource.argumentTags = "/i`Permission'1`read'\\/i`Permission'1`read'\\{Symbol`id'i}";
+
+  std::ostringstream argsBufferStream;
+  mserialize::serialize(std::int32_t{5}, argsBufferStream);
+  mserialize::serialize(std::int32_t{0}, argsBufferStream);
+  mserialize::serialize(std::int32_t{2}, argsBufferStream);
+  argsBuffer = argsBufferStream.str();
+  event.arguments = binlog::Range(argsBuffer.data(), argsBuffer.data() + argsBuffer.size());
+
+  binlog::PrettyPrinter pp("%m", "");
+  CHECK(print(pp) == "0x5 0x0 Symbol{ id: 2 }");
+
+  pp.loadPrinterPlugin(BINLOG_TEST_PRINTER_PLUGIN);
+  CHECK(print(pp) == "read|exec 0x0 MSFT");
+}
+
+#endif // BINLOG_TEST_PRINTER_PLUGIN
@@ -1,15 +1,32 @@
 #include <printers.hpp>
 
+#include <chunks.hpp>
+
+#include <binlog/BlockStream.hpp>
+#include <binlog/EntryStream.hpp>
 #include <binlog/Session.hpp>
 #include <binlog/SessionWriter.hpp>
+#include <binlog/TimeIndex.hpp>
 #include <binlog/advanced_log_macros.hpp>
 
 #include <doctest/doctest.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio> // remove
+#include <cstdlib> // mkdtemp
+#include <fstream>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
+#ifndef _WIN32
+  #include <unistd.h> // NOLINT rmdir
+#endif
+
 namespace {
 
 std::vector<std::string> streamToLines(std::istream& input)
@@ -51,6 +68,115 @@ TEST_CASE("print_events")
   CHECK(streamToLines(txtstream) == expected);
 }
 
+TEST_CASE("print_events_parallel")
+{
+  binlog::Session session;
+  binlog::SessionWriter writerA(session, 4096);
+  binlog::SessionWriter writerB(session, 4096);
+  writerA.setName("A");
+  writerB.setName("B");
+
+  // enough events to fill multiple chunks,
+  // with event sources and writer props spread across them
+  std::stringstream binstream;
+  const std::string padding(100, 'x');
+  for (int i = 0; i < 30000; ++i)
+  {
+    BINLOG_INFO_W(writerA, "A {} {}", i, padding);
+    if (i % 3 == 0) { BINLOG_WARN_W(writerB, "B {}", i); }
+    if (i % 10 == 0) { session.consume(binstream); }
+    if (i == 20000) { BINLOG_ERROR_W(writerB, "A late event source"); }
+  }
+  session.consume(binstream);
+
+  const std::string format = "%S %n %m\n";
+
+  std::stringstream expected;
+  {
+    binlog::IstreamEntryStream entryStream(binstream);
+    printEvents(entryStream, expected, format, "");
+  }
+
+  for (std::size_t threadCount : {std::size_t{1}, std::size_t{2}, std::size_t{3}})
+  {
+    binstream.clear();
+    binstream.seekg(0);
+    binlog::IstreamEntryStream entryStream(binstream);
+
+    std::stringstream txtstream;
+    printEvents(entryStream, txtstream, format, "", threadCount);
+    CHECK(txtstream.str() == expected.str());
+  }
+
+  CHECK(expected.str().find("ERRO B A late event source\n") != std::string::npos);
+}
+
+TEST_CASE("print_events_chunks")
+{
+  binlog::Session session;
+  binlog::SessionWriter writerA(session, 4096);
+  binlog::SessionWriter writerB(session, 4096);
+  writerA.setName("A");
+  writerB.setName("B");
+
+  std::ostringstream binstream;
+  for (int i = 0; i < 3000; ++i)
+  {
+    BINLOG_INFO_W(writerA, "A {}", i);
+    if (i % 3 == 0) { BINLOG_WARN_W(writerB, "B {}", i); }
+    if (i % 10 == 0) { session.consume(binstream); }
+    if (i == 2000) { BINLOG_ERROR_W(writerB, "A late event source"); }
+  }
+  session.consume(binstream);
+  std::string logfile = binstream.str();
+
+  const std::string format = "%S %n %m\n";
+  std::stringstream expected;
+  {
+    binlog::RangeEntryStream entryStream(binlog::Range(logfile.data(), logfile.size()));
+    printEvents(entryStream, expected, format, "");
+  }
+
+  for (std::size_t threadCount : {std::size_t{1}, std::size_t{3}})
+  {
+    const std::vector<EntryChunk> chunks = splitEntries(logfile.data(), logfile.size(), 1000, threadCount);
+    std::stringstream txtstream;
+    printEvents(logfile.data(), logfile.size(), chunks, txtstream, format, "", threadCount);
+    CHECK(txtstream.str() == expected.str());
+  }
+
+  // the events before an incomplete entry are printed
+  logfile.resize(logfile.size() - 3);
+  const std::vector<EntryChunk> chunks = splitEntries(logfile.data(), logfile.size(), 1000, 2);
+  std::stringstream txtstream;
+  CHECK_THROWS_AS(printEvents(logfile.data(), logfile.size(), chunks, txtstream, format, "", 2), std::runtime_error);
+  CHECK(expected.str().compare(0, txtstream.str().size(), txtstream.str()) == 0);
+  CHECK(txtstream.str().size() > expected.str().size() / 2);
+}
+
+TEST_CASE("print_events_parallel_incomplete_entry")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 512);
+
+  BINLOG_INFO_W(writer, "Hello {}", std::string("World"));
+  BINLOG_WARN_W(writer, "foobar {}", 123);
+
+  std::stringstream binstream;
+  session.consume(binstream);
+  binstream.write("\xff\xff", 2); // incomplete size
+
+  binlog::IstreamEntryStream entryStream(binstream);
+  std::stringstream txtstream;
+  CHECK_THROWS_AS(printEvents(entryStream, txtstream, "%S %m\n", "", 2), std::runtime_error);
+
+  const std::vector<std::string> expected{
+    "INFO Hello World",
+    "WARN foobar 123",
+  };
+  CHECK(streamToLines(txtstream) == expected);
+}
+
 TEST_CASE("print_sorted_events")
 {
   binlog::Session session;
@@ -77,3 +203,326 @@ TEST_CASE("print_sorted_events")
   };
   CHECK(streamToLines(txtstream) == expected);
 }
+
+TEST_CASE("print_sorted_events_spill")
+{
+  binlog::Session session;
+  binlog::SessionWriter writerA(session, 4096);
+  binlog::SessionWriter writerB(session, 4096);
+  writerA.setName("A");
+  writerB.setName("B");
+
+  // logClock registers its event source in the first session only
+  const auto log = [](binlog::SessionWriter& writer, std::uint64_t clock)
+  {
+    BINLOG_CREATE_SOURCE_AND_EVENT(writer, binlog::Severity::info, main, clock, "{}", clock);
+  };
+
+  std::stringstream binstream;
+  for (std::uint64_t i = 1; i <= 100; ++i)
+  {
+    log(writerA, 2 * i);
+    log(writerB, 2 * (101 - i) + 1);
+    if (i % 7 == 0) { session.consume(binstream); }
+  }
+  log(writerA, 100); // equal clocks remain in input order
+  session.consume(binstream);
+
+  std::vector<std::string> expected;
+  for (std::uint64_t clock = 2; clock <= 201; ++clock)
+  {
+    const std::string name = (clock % 2 == 0) ? "A " : "B ";
+    expected.push_back(name + std::to_string(clock));
+    if (clock == 100) { expected.push_back("A 100"); }
+  }
+
+  for (std::size_t memoryLimit : {std::size_t{1}, std::size_t{500}, std::size_t{1} << 20})
+  {
+    binstream.clear();
+    binstream.seekg(0);
+    binlog::IstreamEntryStream entryStream(binstream);
+
+    std::stringstream txtstream;
+    printSortedEvents(entryStream, txtstream, "%n %m\n", "", memoryLimit);
+    CHECK(streamToLines(txtstream) == expected);
+  }
+}
+
+TEST_CASE("print_stream_sorted_events")
+{
+  binlog::Session session;
+  binlog::SessionWriter writerA(session, 4096);
+  binlog::SessionWriter writerB(session, 4096);
+  writerA.setName("A");
+  writerB.setName("B");
+
+  const auto log = [](binlog::SessionWriter& writer, std::uint64_t clock)
+  {
+    BINLOG_CREATE_SOURCE_AND_EVENT(writer, binlog::Severity::info, main, clock, "{}", clock);
+  };
+
+  // writers must be known to hold back the events of others
+  std::stringstream binstream;
+  log(writerB, 1);
+  session.consume(binstream);
+  log(writerA, 2);
+  session.consume(binstream);
+
+  // writers are consumed in batches, B lags behind A
+  for (std::uint64_t i = 1; i <= 100; ++i)
+  {
+    log(writerA, 2 * i + 10);
+    log(writerB, 2 * i + 1);
+    if (i % 7 == 0) { session.consume(binstream); }
+  }
+  session.consume(binstream);
+
+  std::vector<std::string> expected{"B 1", "A 2"};
+  for (std::uint64_t clock = 3; clock <= 210; ++clock)
+  {
+    if (clock % 2 == 1 && clock <= 201) { expected.push_back("B " + std::to_string(clock)); }
+    if (clock % 2 == 0 && clock >= 12) { expected.push_back("A " + std::to_string(clock)); }
+  }
+
+  ReorderWindow unlimited;
+  ReorderWindow large;
+  large.eventCount = 1000;
+  ReorderWindow time;
+  time.time = std::chrono::nanoseconds{1000}; // no clock sync, clocks are taken as nanoseconds
+
+  for (const ReorderWindow& window : {unlimited, large, time})
+  {
+    binstream.clear();
+    binstream.seekg(0);
+    binlog::IstreamEntryStream entryStream(binstream);
+
+    std::stringstream txtstream;
+    printStreamSortedEvents(entryStream, txtstream, "%n %m\n", "", window, false);
+    CHECK(streamToLines(txtstream) == expected);
+  }
+
+  // a small window loses the order, but not the events
+  ReorderWindow small;
+  small.eventCount = 2;
+  binstream.clear();
+  binstream.seekg(0);
+  binlog::IstreamEntryStream entryStream(binstream);
+
+  std::stringstream txtstream;
+  printStreamSortedEvents(entryStream, txtstream, "%n %m\n", "", small, false);
+  std::vector<std::string> lines = streamToLines(txtstream);
+  CHECK(lines != expected);
+  std::sort(lines.begin(), lines.end());
+  std::sort(expected.begin(), expected.end());
+  CHECK(lines == expected);
+}
+
+TEST_CASE("print_stream_sorted_events_late_writer")
+{
+  binlog::Session session;
+  binlog::SessionWriter writerA(session, 4096);
+  writerA.setName("A");
+
+  const auto log = [](binlog::SessionWriter& writer, std::uint64_t clock)
+  {
+    BINLOG_CREATE_SOURCE_AND_EVENT(writer, binlog::Severity::info, main, clock, "{}", clock);
+  };
+
+  // B first appears after A wrote later events
+  std::stringstream binstream;
+  for (std::uint64_t clock = 10; clock <= 100; clock += 10) { log(writerA, clock); }
+  session.consume(binstream);
+
+  binlog::SessionWriter writerB(session, 4096);
+  writerB.setName("B");
+  log(writerB, 55);
+  log(writerB, 105);
+  session.consume(binstream);
+
+  ReorderWindow time;
+  time.time = std::chrono::nanoseconds{50}; // no clock sync, clocks are taken as nanoseconds
+  binlog::IstreamEntryStream entryStream(binstream);
+
+  std::stringstream txtstream;
+  printStreamSortedEvents(entryStream, txtstream, "%n %m\n", "", time, false);
+  const std::vector<std::string> expected{
+    "A 10", "A 20", "A 30", "A 40", "A 50", "B 55", "A 60", "A 70", "A 80", "A 90", "A 100", "B 105"
+  };
+  CHECK(streamToLines(txtstream) == expected);
+}
+
+TEST_CASE("print_events_in_window")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+
+  // a clock ticking in nanoseconds, from the epoch
+  session.setClockSync(binlog::ClockSync{0, 1000000000, 0, 0, "UTC"});
+
+  const auto log = [](binlog::SessionWriter& w, std::uint64_t clock)
+  {
+    BINLOG_CREATE_SOURCE_AND_EVENT(w, binlog::Severity::info, main, clock, "{}", clock);
+  };
+
+  std::ostringstream binstream;
+  std::ostringstream indexstream;
+  {
+    binlog::IndexedOutputStream output(binstream, indexstream, 256);
+    for (std::uint64_t clock = 1; clock <= 100; ++clock)
+    {
+      log(writer, clock);
+      if (clock % 10 == 0) { session.consume(output); }
+    }
+  }
+
+  const std::string logfile = binstream.str();
+  std::istringstream indexInput(indexstream.str());
+  const binlog::TimeIndex index = binlog::TimeIndex::read(indexInput);
+
+  const auto printWindow = [&](std::int64_t from, std::int64_t to, bool useIndex)
+  {
+    const TimeWindow window{std::chrono::nanoseconds(from), std::chrono::nanoseconds(to)};
+    std::stringstream txtstream;
+    if (useIndex)
+    {
+      printEvents(logfile.data(), logfile.size(), index, txtstream, "%m\n", "", window);
+    }
+    else
+    {
+      binlog::RangeEntryStream entryStream(binlog::Range(logfile.data(), logfile.size()));
+      printEvents(entryStream, txtstream, "%m\n", "", window);
+    }
+    return streamToLines(txtstream);
+  };
+
+  std::vector<std::string> expected;
+  for (int i = 25; i <= 60; ++i) { expected.push_back(std::to_string(i)); }
+
+  for (bool useIndex : {false, true})
+  {
+    CHECK(printWindow(25, 60, useIndex) == expected);
+    CHECK(printWindow(0, 1, useIndex) == std::vector<std::string>{"1"});
+    CHECK(printWindow(100, 200, useIndex) == std::vector<std::string>{"100"});
+    CHECK(printWindow(101, 200, useIndex).empty());
+  }
+}
+
+TEST_CASE("print_block_events_in_window")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+
+  // a clock ticking in nanoseconds, from the epoch
+  session.setClockSync(binlog::ClockSync{0, 1000000000, 0, 0, "UTC"});
+
+  const auto log = [](binlog::SessionWriter& w, std::uint64_t clock)
+  {
+    BINLOG_CREATE_SOURCE_AND_EVENT(w, binlog::Severity::info, main, clock, "{}", clock);
+  };
+
+  // a block per batch, the event source is in the first one
+  std::ostringstream binstream;
+  {
+    binlog::BlockOutputStream output(binstream);
+    for (std::uint64_t clock = 1; clock <= 100; ++clock)
+    {
+      log(writer, clock);
+      if (clock % 10 == 0)
+      {
+        session.consume(output);
+        output.flush();
+      }
+    }
+  }
+  const std::string logfile = binstream.str();
+
+  const auto printWindow = [&](std::int64_t from, std::int64_t to)
+  {
+    const TimeWindow window{std::chrono::nanoseconds(from), std::chrono::nanoseconds(to)};
+    std::stringstream txtstream;
+    CHECK(printBlockEvents(logfile.data(), logfile.size(), txtstream, "%m\n", "", window) == 0);
+    return streamToLines(txtstream);
+  };
+
+  std::vector<std::string> expected;
+  for (int i = 25; i <= 60; ++i) { expected.push_back(std::to_string(i)); }
+
+  CHECK(printWindow(25, 60) == expected);
+  CHECK(printWindow(0, 1) == std::vector<std::string>{"1"});
+  CHECK(printWindow(91, 91) == std::vector<std::string>{"91"});
+  CHECK(printWindow(100, 200) == std::vector<std::string>{"100"});
+  CHECK(printWindow(101, 200).empty());
+}
+
+#ifndef _WIN32
+
+namespace {
+
+std::vector<std::string> fileToLines(const std::string& path)
+{
+  std::ifstream file(path);
+  return streamToLines(file);
+}
+
+} // namespace
+
+TEST_CASE("print_split_events")
+{
+  char dirTemplate[] = "/tmp/binlog_test_XXXXXX";
+  REQUIRE(mkdtemp(dirTemplate) != nullptr);
+  const std::string dir = dirTemplate;
+
+  binlog::Session session;
+  binlog::SessionWriter writerA(session, 512, 1, "A");
+  binlog::SessionWriter writerB(session, 512, 2, "B/x");
+
+  BINLOG_INFO_WC(writerA, orders, "a1");
+  BINLOG_WARN_WC(writerB, orders, "b1");
+  BINLOG_INFO_WC(writerB, fills, "b2");
+  BINLOG_INFO_WC(writerA, fills, "a2");
+
+  std::stringstream binstream;
+  session.consume(binstream);
+  const std::string logfile = binstream.str();
+
+  const auto split = [&](SplitBy splitBy, std::size_t bufferSize)
+  {
+    binlog::RangeEntryStream input(binlog::Range(logfile.data(), logfile.size()));
+    return printSplitEvents(input, dir, splitBy, "%m\n", "", bufferSize);
+  };
+
+  // events of each writer are consumed together
+  CHECK(split(SplitBy::writer, 1 << 16) == 2);
+  CHECK(fileToLines(dir + "/1_A.txt") == std::vector<std::string>{"a1", "a2"});
+  CHECK(fileToLines(dir + "/2_B_x.txt") == std::vector<std::string>{"b1", "b2"});
+
+  CHECK(split(SplitBy::category, 0) == 2);
+  CHECK(fileToLines(dir + "/orders.txt") == std::vector<std::string>{"a1", "b1"});
+  CHECK(fileToLines(dir + "/fills.txt") == std::vector<std::string>{"a2", "b2"});
+
+  CHECK(split(SplitBy::severity, 1) == 2);
+  CHECK(fileToLines(dir + "/INFO.txt") == std::vector<std::string>{"a1", "a2", "b2"});
+  CHECK(fileToLines(dir + "/WARN.txt") == std::vector<std::string>{"b1"});
+
+  for (const char* name : {"1_A", "2_B_x", "orders", "fills", "INFO", "WARN"})
+  {
+    CHECK(std::remove((dir + "/" + name + ".txt").c_str()) == 0);
+  }
+  CHECK(rmdir(dir.c_str()) == 0);
+}
+
+TEST_CASE("print_split_events_no_directory")
+{
+  std::stringstream binstream;
+  {
+    binlog::Session session;
+    binlog::SessionWriter writer(session, 512);
+    BINLOG_INFO_W(writer, "Hello");
+    session.consume(binstream);
+  }
+
+  binlog::IstreamEntryStream input(binstream);
+  CHECK_THROWS_AS(printSplitEvents(input, "/nonexistent/directory", SplitBy::severity, "%m\n", ""), std::runtime_error);
+}
+
+#endif // !_WIN32
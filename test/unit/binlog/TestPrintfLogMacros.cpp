@@ -0,0 +1,89 @@
+#include <binlog/printf_log_macros.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/NanoLogCpp.h>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+
+#include <doctest/doctest.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace {
+
+using NanoLogInternal::ParamType;
+using NanoLogInternal::getNumParams;
+using NanoLogInternal::getParamInfo;
+
+static_assert(getNumParams("no params %%") == 0, "");
+static_assert(getNumParams("%d %5.2f %s") == 3, "");
+static_assert(getNumParams("%*.*s") == 3, "");
+static_assert(getParamInfo("%d %s", 0) == ParamType::NON_STRING, "");
+static_assert(getParamInfo("%d %s", 1) == ParamType::STRING_WITH_NO_PRECISION, "");
+static_assert(getParamInfo("%.10s", 0) == ParamType(10), "");
+static_assert(getParamInfo("%*.*s", 0) == ParamType::DYNAMIC_WIDTH, "");
+static_assert(getParamInfo("%*.*s", 1) == ParamType::DYNAMIC_PRECISION, "");
+static_assert(getParamInfo("%*.*s", 2) == ParamType::STRING_WITH_DYNAMIC_PRECISION, "");
+static_assert(getParamInfo("%d", 1) == ParamType::INVALID, "");
+static_assert(getParamInfo("%n", 0) == ParamType::INVALID, "");
+static_assert(getParamInfo("%y", 0) == ParamType::INVALID, "");
+static_assert(getParamInfo("100%", 0) == ParamType::INVALID, "");
+
+struct Format { static constexpr const char* str() { return "px=%.2f qty=%-5lld %s 100%%"; } };
+
+static_assert(binlog::detail::PrintfFormat<Format>::valid, "");
+static_assert(binlog::detail::PrintfFormat<Format>::conversionCount == 3, "");
+
+static_assert(! binlog::detail::printf_format_valid("%*d"), "");
+static_assert(! binlog::detail::printf_format_valid("%.*s"), "");
+static_assert(! binlog::detail::printf_format_valid("%n"), "");
+static_assert(! binlog::detail::printf_format_valid("%d {}"), "");
+static_assert(! binlog::detail::printf_format_valid("%"), "");
+
+static_assert(binlog::detail::printf_arguments_match("%d %c %u %x", "iiii"), "");
+static_assert(binlog::detail::printf_arguments_match("%f %lg", "ff"), "");
+static_assert(binlog::detail::printf_arguments_match("%s %p", "??"), "");
+static_assert(! binlog::detail::printf_arguments_match("%d", "f"), "");
+static_assert(! binlog::detail::printf_arguments_match("%f", "i"), "");
+static_assert(! binlog::detail::printf_arguments_match("%s", "i"), "");
+
+} // namespace
+
+TEST_CASE("printf_convert_format")
+{
+  CHECK(std::string(binlog::detail::PrintfFormat<Format>::value.data) == "px={} qty={} {} 100%");
+}
+
+TEST_CASE("printf_log")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+
+  BINLOG_INFO_PRINTF_WC(writer, printf, "Hello %s!", std::string("World"));
+  BINLOG_WARN_PRINTF_WC(writer, printf, "px=%.2f qty=%d side=%c", 1.5, 100, 'B');
+  BINLOG_ERROR_PRINTF_WC(writer, printf, "100%% done, %lu items in %s", std::uint64_t{7}, std::vector<int>{1, 2});
+  BINLOG_INFO_PRINTF_WC(writer, printf, "No arguments");
+
+  const std::vector<std::string> expectedEvents{
+    "printf INFO Hello World!",
+    "printf WARN px=1.5 qty=100 side=B",
+    "printf ERRO 100% done, 7 items in [1, 2]",
+    "printf INFO No arguments",
+  };
+  CHECK(getEvents(session, "%C %S %m") == expectedEvents);
+}
+
+TEST_CASE("printf_disabled")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+  session.setMinSeverity(binlog::Severity::warning);
+
+  BINLOG_INFO_PRINTF_WC(writer, printf, "%d", 1);
+  BINLOG_ERROR_PRINTF_WC(writer, printf, "%d", 2);
+
+  CHECK(getEvents(session, "%m") == std::vector<std::string>{"2"});
+}
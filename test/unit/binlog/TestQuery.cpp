@@ -0,0 +1,178 @@
+#include <query.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/EntryStream.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/TimeIndex.hpp>
+
+#include <doctest/doctest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+/** @returns a logfile of 240 events of two writers, one per second, consumed in multiple batches */
+std::string logEvents()
+{
+  binlog::Session session;
+  session.setClockSync(binlog::ClockSync{0, 1000000000, 0, 0, "UTC"});
+  binlog::SessionWriter writerA(session, 4096, 1, "A");
+  binlog::SessionWriter writerB(session, 4096, 2, "B");
+  const std::uint64_t latency = addEventSource<int>(session, binlog::Severity::info, "orders", "Latency {} us");
+  const std::uint64_t reject = addEventSource<std::string>(session, binlog::Severity::warning, "router", "Reject {}");
+
+  std::ostringstream stream;
+  for (int i = 0; i < 120; ++i)
+  {
+    const std::uint64_t clock = std::uint64_t(i) * 1000000000;
+    CHECK(writerA.addEvent(latency, clock, i));
+    CHECK(writerB.addEvent(reject, clock, "id" + std::to_string(i)));
+    if (i % 10 == 9) { session.consume(stream); }
+  }
+  return stream.str();
+}
+
+QueryResult query(const Query& q, const TimeWindow* window = nullptr)
+{
+  std::istringstream input(logEvents());
+  binlog::IstreamEntryStream entryStream(input);
+  return runQuery(q, entryStream, window);
+}
+
+std::string print(const Query& q, const QueryResult& result)
+{
+  std::ostringstream output;
+  printQueryResult(q, result, output);
+  return output.str();
+}
+
+std::string query(const std::string& text)
+{
+  const Query q(text);
+  return print(q, query(q));
+}
+
+} // namespace
+
+TEST_CASE("query_parse")
+{
+  const Query q("SELECT category, count, max(arg0) where severity>=warning group by time(60), category");
+  REQUIRE(q.columns().size() == 4);
+  CHECK(q.columns()[0].field == Query::Field::time);
+  CHECK(q.columns()[0].interval == std::chrono::seconds(60));
+  CHECK(q.columns()[1].field == Query::Field::category);
+  CHECK(q.columns()[2].aggregate == Query::Aggregate::count);
+  CHECK(q.columns()[3].aggregate == Query::Aggregate::max);
+  CHECK(q.columns()[3].argumentIndex == 0);
+  CHECK(q.columns()[3].name == "max(arg0)");
+  REQUIRE(q.where() != nullptr);
+
+  CHECK(Query("select count").where() == nullptr);
+  CHECK(Query("select max(arg.px)").columns()[0].argumentName == "px");
+  CHECK(Query("select count where format~\"where\" group by file").columns().size() == 2);
+
+  for (const char* invalid : {
+    "", "count", "select", "select count,", "select foo", "select max(x)", "select sum(arg)", "select sum(arg.)",
+    "select time(0)", "select time(x)", "select time(1), time(2)", "select writer, writer",
+    "select count where", "select count where category=", "select count group by count",
+  })
+  {
+    CAPTURE(invalid);
+    CHECK_THROWS_AS(Query{invalid}, std::runtime_error);
+  }
+}
+
+TEST_CASE("query_group_by_time")
+{
+  CHECK(query("select time(60), category, count") ==
+    "time(60)\tcategory\tcount\n"
+    "1970-01-01T00:00:00Z\torders\t60\n"
+    "1970-01-01T00:00:00Z\trouter\t60\n"
+    "1970-01-01T00:01:00Z\torders\t60\n"
+    "1970-01-01T00:01:00Z\trouter\t60\n"
+  );
+
+  CHECK(query("select count where severity>=warning group by time(100)") ==
+    "time(100)\tcount\n"
+    "1970-01-01T00:00:00Z\t100\n"
+    "1970-01-01T00:01:40Z\t20\n"
+  );
+}
+
+TEST_CASE("query_aggregates")
+{
+  CHECK(query("select writer, severity, count, min(arg0), max(arg0), sum(arg0)") ==
+    "writer\tseverity\tcount\tmin(arg0)\tmax(arg0)\tsum(arg0)\n"
+    "A\tINFO\t120\t0\t119\t7140\n"
+    "B\tWARN\t120\t-\t-\t0\n"
+  );
+
+  CHECK(query("select max(arg0), count where category==orders && arg0<10") ==
+    "max(arg0)\tcount\n"
+    "9\t10\n"
+  );
+
+  CHECK(query("select count where category==nosuch") == "count\n");
+}
+
+TEST_CASE("query_window")
+{
+  const Query q("select writer, count, min(arg0)");
+  const TimeWindow window{std::chrono::seconds(30), std::chrono::seconds(89)};
+  CHECK(print(q, query(q, &window)) ==
+    "writer\tcount\tmin(arg0)\n"
+    "A\t60\t30\n"
+    "B\t60\t-\n"
+  );
+}
+
+TEST_CASE("query_merge")
+{
+  const Query q("select category, count, min(arg0), max(arg0)");
+  const QueryResult part = query(q);
+
+  QueryResult total;
+  total.merge(part, q);
+  total.merge(part, q);
+  CHECK(total.eventCount == 480);
+  CHECK(print(q, total) ==
+    "category\tcount\tmin(arg0)\tmax(arg0)\n"
+    "orders\t240\t0\t119\n"
+    "router\t240\t-\t-\n"
+  );
+}
+
+TEST_CASE("query_with_index")
+{
+  const std::string logfile = logEvents();
+  std::ostringstream copy;
+  std::stringstream indexStream;
+  {
+    binlog::IndexedOutputStream output(copy, indexStream, 256, 1024);
+    output.write(logfile.data(), std::streamsize(logfile.size()));
+  }
+  const binlog::TimeIndex index = binlog::TimeIndex::read(indexStream);
+  REQUIRE(index.blocks.size() > 4);
+
+  // filters rule out blocks without the value
+  const Query byValue("select writer, count where value==id77");
+  const QueryResult valueResult = runQuery(byValue, logfile.data(), logfile.size(), index, nullptr);
+  CHECK(print(byValue, valueResult) == "writer\tcount\nB\t1\n");
+  CHECK(valueResult.skippedBlockCount > index.blocks.size() / 2);
+
+  // block clocks rule out blocks outside of the window
+  const Query byTime("select time(10), count where category==orders");
+  const TimeWindow window{std::chrono::seconds(100), std::chrono::seconds(109)};
+  const QueryResult timeResult = runQuery(byTime, logfile.data(), logfile.size(), index, &window);
+  CHECK(print(byTime, timeResult) == "time(10)\tcount\n1970-01-01T00:01:40Z\t10\n");
+  CHECK(timeResult.skippedBlockCount > index.blocks.size() / 2);
+
+  // without pushdown, the results are the same
+  CHECK(print(byTime, query(byTime, &window)) == print(byTime, timeResult));
+}
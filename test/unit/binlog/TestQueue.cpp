@@ -5,7 +5,8 @@
 #include <doctest/doctest.h>
 
 #include <array>
-#include <cstring> // memcmp
+#include <cstdint>
+#include <cstring> // memcmp, memcpy
 #include <random>
 #include <thread>
 #include <vector>
@@ -131,6 +132,24 @@ TEST_CASE("capacity")
   CHECK(r.capacity() == 1024);
 }
 
+TEST_CASE("no_false_sharing")
+{
+  std::array<char, 128> buffer{};
+  binlog::detail::Queue q(buffer.data(), buffer.size());
+
+  const char* begin = reinterpret_cast<const char*>(&q);
+  const char* writerEnd = reinterpret_cast<const char*>(&q.buffer + 1);
+  const char* reader = reinterpret_cast<const char*>(&q.readIndex);
+  const char* end = begin + sizeof(q);
+
+  // regardless of the alignment of q, members of the writer and the reader
+  // are separated by at least a cache line
+  CHECK(reinterpret_cast<const char*>(&q.writeIndex) == begin);
+  CHECK(reader - writerEnd >= std::ptrdiff_t(binlog::detail::Queue::cacheLineSize));
+  CHECK(end - reader >= std::ptrdiff_t(binlog::detail::Queue::cacheLineSize));
+  CHECK(alignof(binlog::detail::Queue) <= alignof(std::uint64_t));
+}
+
 TEST_CASE("full_capacity")
 {
   char buffer[1024];
@@ -271,3 +290,124 @@ TEST_CASE("transmit_more")
     }
   }
 }
+
+TEST_CASE("partial_read")
+{
+  char buffer[100];
+  binlog::detail::Queue q(buffer, 100);
+  binlog::detail::QueueWriter w(q);
+  binlog::detail::QueueReader r(q);
+
+  writeq(w, 60);
+  readq(r, 60);
+
+  // wrap around: [40 bytes]....[30 bytes]
+  writeq(w, 30);
+  writeq(w, 40);
+
+  auto rr = r.beginRead();
+  CHECK(rr.size1 == 30);
+  CHECK(rr.size2 == 40);
+  r.endRead(10);
+
+  rr = r.beginRead();
+  CHECK(rr.size1 == 20);
+  CHECK(rr.size2 == 40);
+  r.endRead(20); // the end of the first part
+
+  rr = r.beginRead();
+  CHECK(rr.buffer1 == buffer);
+  CHECK(rr.size1 == 40);
+  CHECK(rr.size2 == 0);
+  r.endRead(15);
+
+  rr = r.beginRead();
+  CHECK(rr.buffer1 == buffer + 15);
+  CHECK(rr.size() == 25);
+  r.endRead(25);
+
+  CHECK(r.beginRead().size() == 0);
+}
+
+TEST_CASE("overwrite_oldest")
+{
+  std::array<char, 100> buffer{};
+  binlog::detail::Queue q(buffer.data(), buffer.size());
+  binlog::detail::QueueWriter w(q);
+  binlog::detail::QueueReader r(q);
+
+  // entries: [uint32_t size=8][uint64_t index]
+  const auto writeEntry = [&w](std::uint64_t index)
+  {
+    const std::uint32_t size = sizeof(index);
+    REQUIRE(w.beginOverwrite(sizeof(size) + size));
+    w.writeBuffer(&size, sizeof(size));
+    w.writeBuffer(&index, sizeof(index));
+    w.endWrite();
+  };
+
+  const auto readEntries = [&r]()
+  {
+    std::vector<std::uint64_t> result;
+    const auto rr = r.beginRead();
+    std::vector<char> data(rr.buffer1, rr.buffer1 + rr.size1);
+    data.insert(data.end(), rr.buffer2, rr.buffer2 + rr.size2);
+    for (std::size_t pos = 0; pos < data.size(); pos += 12)
+    {
+      std::uint32_t size = 0;
+      memcpy(&size, data.data() + pos, sizeof(size));
+      CHECK(size == 8);
+      std::uint64_t index = 0;
+      memcpy(&index, data.data() + pos + 4, sizeof(index));
+      result.push_back(index);
+    }
+    r.endRead();
+    return result;
+  };
+
+  // many times the capacity: the oldest entries are discarded, the queue keeps the latest ones
+  for (std::uint64_t i = 0; i < 50; ++i) { writeEntry(i); }
+
+  const std::vector<std::uint64_t> entries = readEntries();
+  REQUIRE(! entries.empty());
+  CHECK(entries.size() >= 4); // at least half of the queue is kept
+  for (std::size_t i = 0; i < entries.size(); ++i)
+  {
+    CHECK(entries[i] == 50 - entries.size() + i);
+  }
+
+  // continue after read
+  writeEntry(50);
+  CHECK(readEntries() == std::vector<std::uint64_t>{50});
+
+  // does not fit even if empty
+  CHECK(! w.beginOverwrite(100));
+}
+
+TEST_CASE("non_temporal_write")
+{
+  std::vector<char> source(1000);
+  for (std::size_t i = 0; i < source.size(); ++i) { source[i] = char(i * 7); }
+
+  // every destination alignment, sizes around the 16 and 64 byte blocks
+  for (std::size_t offset = 0; offset < 16; ++offset)
+  {
+    for (const std::size_t size : {1U, 15U, 16U, 17U, 63U, 64U, 65U, 200U, 999U})
+    {
+      std::vector<char> buffer(1024, '.');
+      binlog::detail::Queue q(buffer.data(), buffer.size());
+      binlog::detail::QueueWriter w(q);
+      w.setNonTemporalThreshold(16);
+
+      writeq(w, offset);
+      REQUIRE(w.beginWrite(size));
+      CHECK(w.writeBuffer(source.data(), size) == buffer.data() + offset);
+      w.endWrite();
+
+      CAPTURE(offset);
+      CAPTURE(size);
+      CHECK(memcmp(buffer.data() + offset, source.data(), size) == 0);
+      CHECK(buffer[offset + size] == '.');
+    }
+  }
+}
@@ -0,0 +1,145 @@
+#include <binlog/RepeatCollapsingStream.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/Entries.hpp>
+#include <binlog/EventStream.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/advanced_log_macros.hpp>
+
+#include <mserialize/deserialize.hpp>
+
+#include <doctest/doctest.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+TEST_CASE("collapse_repeats")
+{
+  binlog::Session session;
+  binlog::SessionWriter writerA(session, 4096, 1, "A");
+  binlog::SessionWriter writerB(session, 4096, 2, "B");
+
+  for (int i = 0; i < 10; ++i)
+  {
+    BINLOG_INFO_W(writerA, "Error {}", 1);
+    BINLOG_INFO_W(writerB, "Error {}", 1); // interleaved, but collapsed per writer
+  }
+  for (int i = 2; i < 4; ++i)
+  {
+    BINLOG_INFO_W(writerA, "Error {}", 2); // same arguments, but different sources: not collapsed
+    BINLOG_INFO_W(writerA, "Error {}", i);
+  }
+
+  TestStream stream;
+  binlog::RepeatCollapsingStream<TestStream> output(stream);
+  session.consume(output);
+  output.flush();
+
+  CHECK(output.collapsedEventCount() == 9 + 9);
+  CHECK(countTags(stream, binlog::RepeatedEvents::Tag) == 2);
+
+  CHECK(streamToEvents(stream, "%n %m") == std::vector<std::string>{
+    "A Error 1",
+    "A Error 2",
+    "A Error 2",
+    "A Error 2",
+    "A Error 3",
+    "B Error 1",
+  });
+}
+
+TEST_CASE("collapse_repeats_across_consume")
+{
+  binlog::Session session;
+  binlog::SessionWriter writerA(session, 4096, 1, "A");
+  binlog::SessionWriter writerB(session, 4096, 2, "B");
+
+  binlog::EventSource eventSource{0, binlog::Severity::info, "cat", "fun", "file", 1, "{}", "[c"};
+  eventSource.id = session.addEventSource(eventSource);
+
+  TestStream stream;
+  binlog::RepeatCollapsingStream<TestStream> output(stream);
+
+  for (int i = 0; i < 3; ++i)
+  {
+    for (int j = 0; j < 5; ++j)
+    {
+      CHECK(writerA.addEvent(eventSource.id, std::uint64_t(i * 10 + j), std::string("x")));
+    }
+    CHECK(writerB.addEvent(eventSource.id, std::uint64_t(i), std::to_string(i)));
+    session.consume(output);
+  }
+  CHECK(writerA.addEvent(eventSource.id, 100, std::string("z")));
+  session.consume(output);
+
+  // the run of A is counted when A logs a different event,
+  // in the context of A, even if B logged in between
+  std::vector<std::uint64_t> repeats; // count and last clock of each RepeatedEvents
+  std::string repeatsWriter;          // name of the WriterProp before the RepeatedEvents
+  std::string writerName;
+  while (binlog::Range payload = stream.nextEntryPayload())
+  {
+    const std::uint64_t tag = payload.read<std::uint64_t>();
+    if (tag == binlog::WriterProp::Tag)
+    {
+      binlog::WriterProp wp;
+      mserialize::deserialize(wp, payload);
+      CHECK(wp.batchSize == 0);
+      writerName = wp.name;
+    }
+    else if (tag == binlog::RepeatedEvents::Tag)
+    {
+      repeats.push_back(payload.read<std::uint64_t>());
+      repeats.push_back(payload.read<std::uint64_t>());
+      repeatsWriter = writerName;
+    }
+  }
+  stream.readPos = 0;
+
+  CHECK(repeats == std::vector<std::uint64_t>{14, 24});
+  CHECK(repeatsWriter == "A");
+
+  CHECK(streamToEvents(stream, "%n %r %m") == std::vector<std::string>{
+    "A 0 x",
+    "B 0 0",
+    "B 1 1",
+    "B 2 2",
+    "A 100 z",
+  });
+
+  stream.readPos = 0;
+  binlog::EventStream eventStream;
+  while (eventStream.nextEvent(stream) != nullptr) {}
+  CHECK(eventStream.repeatedEventCount() == 14);
+}
+
+TEST_CASE("collapse_repeats_in_context")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096, 1, "A");
+
+  binlog::EventSource eventSource{0, binlog::Severity::info, "cat", "fun", "file", 1, "{}", "[c"};
+  eventSource.id = session.addEventSource(eventSource);
+
+  TestStream stream;
+  binlog::RepeatCollapsingStream<TestStream> output(stream);
+
+  CHECK(writer.setContext("x"));
+  CHECK(writer.addEvent(eventSource.id, 0, std::string("e")));
+  CHECK(writer.addEvent(eventSource.id, 1, std::string("e")));
+  session.consume(output);
+  CHECK(writer.addEvent(eventSource.id, 2, std::string("e"))); // the repeated context does not break the run
+  CHECK(writer.setContext("y"));
+  CHECK(writer.addEvent(eventSource.id, 3, std::string("e")));
+  session.consume(output);
+  output.flush();
+
+  CHECK(output.collapsedEventCount() == 2);
+  CHECK(streamToEvents(stream, "%c %r %m") == std::vector<std::string>{
+    "x 0 e",
+    "y 3 e",
+  });
+}
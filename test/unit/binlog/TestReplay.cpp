@@ -0,0 +1,102 @@
+#include <replay.hpp>
+
+#include <binlog/EntryStream.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+
+#include "test_utils.hpp"
+
+#include <doctest/doctest.h>
+
+#include <algorithm> // sort
+#include <chrono>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string makeLogfile()
+{
+  binlog::Session session;
+  session.setClockSync(binlog::ClockSync{0, 1000000000, 0, 0, "UTC"});
+  binlog::SessionWriter w1(session, 4096, 1, "w1");
+  binlog::SessionWriter w2(session, 4096, 2, "w2");
+  const std::uint64_t a = addEventSource<int, std::string>(session, binlog::Severity::info, "net", "a {} {}");
+  const std::uint64_t b = addEventSource<double>(session, binlog::Severity::warning, "main", "b {}");
+
+  // clock ticks in nanoseconds, events at 0, 20ms and 100ms
+  CHECK(w1.addEvent(a, 0, 1, std::string("x")));
+  CHECK(w2.addEvent(b, 20000000, 2.5));
+  CHECK(w1.addEvent(a, 100000000, 3, std::string("yz")));
+
+  std::ostringstream logfile;
+  session.consume(logfile);
+  return logfile.str();
+}
+
+std::vector<std::string> sortedEvents(const std::string& logfile, const char* eventFormat)
+{
+  std::istringstream stream(logfile);
+  binlog::IstreamEntryStream entryStream(stream);
+  std::vector<std::string> events = streamToEvents(entryStream, eventFormat);
+  std::sort(events.begin(), events.end());
+  return events;
+}
+
+} // namespace
+
+TEST_CASE("replay_events")
+{
+  const std::string logfile = makeLogfile();
+  std::istringstream input(logfile);
+  binlog::IstreamEntryStream entryStream(input);
+  std::ostringstream output;
+
+  const ReplayStats stats = replay(entryStream, output, 0, 4096);
+  CHECK(stats.eventCount == 3);
+  CHECK(stats.droppedEventCount == 0);
+  CHECK(stats.byteCount == output.str().size());
+
+  // the writers of the replayed events are consumed in any order
+  const std::vector<std::string> expected{
+    "w1 1 INFO net a 1 x",
+    "w1 1 INFO net a 3 yz",
+    "w2 2 WARN main b 2.5",
+  };
+  CHECK(sortedEvents(logfile, "%n %t %S %C %m") == expected);
+  CHECK(sortedEvents(output.str(), "%n %t %S %C %m") == expected);
+}
+
+TEST_CASE("replay_pacing")
+{
+  // the last event is 100ms after the first
+  std::istringstream input(makeLogfile());
+  binlog::IstreamEntryStream entryStream(input);
+  std::ostringstream output;
+
+  const ReplayStats stats = replay(entryStream, output, 2, 4096);
+  CHECK(stats.eventCount == 3);
+  CHECK(stats.elapsed >= std::chrono::milliseconds(50));
+}
+
+TEST_CASE("replay_stats")
+{
+  ReplayStats stats;
+  stats.eventCount = 1000;
+  stats.droppedEventCount = 2;
+  stats.byteCount = 1 << 20;
+  stats.elapsed = std::chrono::milliseconds(500);
+
+  std::ostringstream out;
+  printReplayStats(stats, out);
+  CHECK(out.str() ==
+    "Replayed events: 1000\n"
+    "Dropped events:  2\n"
+    "Consumed bytes:  1048576\n"
+    "Elapsed time:    0.500 s\n"
+    "Event rate:      2000 events/s\n"
+    "Throughput:      2.000 MiB/s\n"
+  );
+}
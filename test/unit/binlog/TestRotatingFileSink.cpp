@@ -0,0 +1,250 @@
+#include <binlog/RotatingFileSink.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/Dictionary.hpp>
+#include <binlog/Entries.hpp>
+#include <binlog/EventStream.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/advanced_log_macros.hpp>
+
+#include <doctest/doctest.h>
+
+#include <cstdio> // remove
+#include <fstream>
+#include <ios>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+
+TestStream readFile(const std::string& path)
+{
+  std::ifstream file(path, std::ios_base::in | std::ios_base::binary);
+  const std::string content{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+
+  TestStream result;
+  result.write(content.data(), std::streamsize(content.size()));
+  return result;
+}
+
+/** @returns the hash of the first DictionaryReference in `file`, without moving its read position */
+std::uint64_t referencedDictionary(TestStream& file)
+{
+  const std::size_t readPos = file.readPos;
+  std::uint64_t hash = 0;
+  for (binlog::Range entry = file.nextEntryPayload(); ! entry.empty(); entry = file.nextEntryPayload())
+  {
+    if (entry.read<std::uint64_t>() == binlog::DictionaryReference::Tag)
+    {
+      hash = entry.read<std::uint64_t>();
+      break;
+    }
+  }
+  file.readPos = readPos;
+  return hash;
+}
+
+} // namespace
+
+TEST_CASE("rotate_by_size")
+{
+  const std::string path = "binlog_test_rotating_sink_size.blog";
+
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+  const auto log = [&writer](int i) { BINLOG_INFO_W(writer, "Hello {}", i); };
+
+  std::size_t rotationCount = 0;
+  {
+    binlog::RotatingFileSink::Options options;
+    options.maxFileSize = 1000;
+    binlog::RotatingFileSink sink(path, options);
+
+    for (int i = 0; i < 100; ++i)
+    {
+      log(i);
+      session.consume(sink);
+    }
+
+    rotationCount = sink.rotationCount();
+  }
+
+  REQUIRE(rotationCount > 2);
+
+  // every file is self contained
+  std::vector<std::string> events;
+  for (std::size_t i = 1; i <= rotationCount + 1; ++i)
+  {
+    const std::string filePath = (i <= rotationCount) ? path + "." + std::to_string(i) : path;
+    TestStream file = readFile(filePath);
+    CHECK(file.buffer.size() < 1000 + 200);
+    CHECK(countTags(file, binlog::ClockSync::Tag) == 1);
+
+    const std::vector<std::string> fileEvents = streamToEvents(file, "%m");
+    CHECK(! fileEvents.empty());
+    events.insert(events.end(), fileEvents.begin(), fileEvents.end());
+
+    (void)std::remove(filePath.data());
+  }
+
+  std::vector<std::string> expected;
+  for (int i = 0; i < 100; ++i) { expected.push_back("Hello " + std::to_string(i)); }
+  CHECK(events == expected);
+}
+
+TEST_CASE("rotate_only_referenced_sources")
+{
+  const std::string path = "binlog_test_rotating_sink_sources.blog";
+
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+
+  {
+    binlog::RotatingFileSink::Options options;
+    options.onlyReferencedSources = true;
+    binlog::RotatingFileSink sink(path, options);
+
+    BINLOG_INFO_W(writer, "a");
+    BINLOG_INFO_W(writer, "b");
+    session.consume(sink);
+
+    sink.requestRotation();
+
+    BINLOG_INFO_W(writer, "c");
+    BINLOG_INFO_W(writer, "d");
+    session.consume(sink);
+
+    sink.requestRotation();
+
+    BINLOG_INFO_W(writer, "d");
+    session.consume(sink);
+    CHECK(sink.rotationCount() == 2);
+  }
+
+  TestStream file1 = readFile(path + ".1");
+  CHECK(countTags(file1, binlog::EventSource::Tag) == 2);
+  CHECK(streamToEvents(file1, "%m") == std::vector<std::string>{"a", "b"});
+
+  TestStream file2 = readFile(path + ".2");
+  CHECK(countTags(file2, binlog::EventSource::Tag) == 2);
+  CHECK(streamToEvents(file2, "%m") == std::vector<std::string>{"c", "d"});
+
+  TestStream file3 = readFile(path);
+  CHECK(countTags(file3, binlog::EventSource::Tag) == 1);
+  CHECK(streamToEvents(file3, "%m") == std::vector<std::string>{"d"});
+
+  (void)std::remove((path + ".1").data());
+  (void)std::remove((path + ".2").data());
+  (void)std::remove(path.data());
+}
+
+TEST_CASE("rotating_sink_split_writes")
+{
+  const std::string path = "binlog_test_rotating_sink_split.blog";
+
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+  TestStream input;
+  for (int i = 0; i < 10; ++i)
+  {
+    BINLOG_INFO_W(writer, "Hello {}", i);
+    session.consume(input);
+  }
+
+  {
+    binlog::RotatingFileSink::Options options;
+    options.onlyReferencedSources = true;
+    binlog::RotatingFileSink sink(path, options);
+
+    // entries split at every byte, rotate in the middle
+    for (std::size_t i = 0; i < input.buffer.size(); ++i)
+    {
+      if (i == input.buffer.size() / 2) { sink.requestRotation(); }
+      sink.write(input.buffer.data() + i, 1);
+    }
+    CHECK(sink.rotationCount() == 1);
+  }
+
+  TestStream file1 = readFile(path + ".1");
+  TestStream file2 = readFile(path);
+  std::vector<std::string> events = streamToEvents(file1, "%m");
+  const std::vector<std::string> events2 = streamToEvents(file2, "%m");
+  CHECK(! events.empty());
+  CHECK(! events2.empty());
+  events.insert(events.end(), events2.begin(), events2.end());
+
+  CHECK(events == streamToEvents(input, "%m"));
+
+  (void)std::remove((path + ".1").data());
+  (void)std::remove(path.data());
+}
+
+TEST_CASE("rotate_with_dictionary")
+{
+  const std::string path = "binlog_test_rotating_sink_dictionary.blog";
+
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+  const auto logC = [&writer]() { BINLOG_INFO_W(writer, "c"); };
+
+  {
+    binlog::RotatingFileSink::Options options;
+    options.dictionaryDirectory = ".";
+    binlog::RotatingFileSink sink(path, options);
+
+    BINLOG_INFO_W(writer, "a");
+    BINLOG_INFO_W(writer, "b");
+    session.consume(sink);
+
+    sink.requestRotation();
+
+    logC();
+    session.consume(sink);
+
+    sink.requestRotation();
+
+    logC();
+    session.consume(sink);
+    CHECK(sink.rotationCount() == 2);
+  }
+
+  // the source of c is new in file2, written to it as usual
+  TestStream file2 = readFile(path + ".2");
+  CHECK(countTags(file2, binlog::EventSource::Tag) == 1);
+  CHECK(countTags(file2, binlog::DictionaryReference::Tag) == 1);
+
+  TestStream file3 = readFile(path);
+  CHECK(countTags(file3, binlog::EventSource::Tag) == 0);
+  CHECK(countTags(file3, binlog::DictionaryReference::Tag) == 1);
+
+  const std::uint64_t hash2 = referencedDictionary(file2);
+  const std::uint64_t hash3 = referencedDictionary(file3);
+  CHECK(hash2 != hash3); // the second dictionary has the source of c as well
+
+  {
+    // the dictionary is resolved by DictionaryEntryStream
+    const std::size_t readPos = file3.readPos;
+    binlog::DictionaryEntryStream input(file3, ".");
+    CHECK(streamToEvents(input, "%m") == std::vector<std::string>{"c"});
+    file3.readPos = readPos;
+  }
+
+  {
+    // or preloaded by EventStream
+    binlog::MmapEntryStream dictionary(binlog::dictionaryPath(".", hash3));
+    binlog::EventStream eventStream;
+    eventStream.loadMetadata(dictionary);
+    const binlog::Event* event = eventStream.nextEvent(file3);
+    REQUIRE(event != nullptr);
+    CHECK(event->source->formatString == "c");
+  }
+
+  (void)std::remove((path + ".1").data());
+  (void)std::remove((path + ".2").data());
+  (void)std::remove(path.data());
+  (void)std::remove(binlog::dictionaryPath(".", hash2).data());
+  (void)std::remove(binlog::dictionaryPath(".", hash3).data());
+}
@@ -0,0 +1,97 @@
+#include <binlog/sampled_log_macros.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/Severity.hpp>
+
+#include <doctest/doctest.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+int failIfCalled()
+{
+  FAIL("Argument of suppressed event evaluated");
+  return 0;
+}
+
+} // namespace
+
+TEST_CASE("every_n")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+
+  for (int i = 0; i < 10; ++i)
+  {
+    BINLOG_INFO_EVERY_N_WC(writer, sampled, 4, "i={}", i);
+  }
+
+  const std::vector<std::string> expectedEvents{
+    "sampled INFO i=0 (0 suppressed)",
+    "sampled INFO i=4 (3 suppressed)",
+    "sampled INFO i=8 (3 suppressed)",
+  };
+  CHECK(getEvents(session, "%C %S %m") == expectedEvents);
+}
+
+TEST_CASE("every_n_no_args")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+
+  for (int i = 0; i < 3; ++i)
+  {
+    BINLOG_CREATE_SOURCE_AND_EVENT_EVERY_N(writer, binlog::Severity::warning, main, 0, 2, "Hello");
+  }
+
+  const std::vector<std::string> expectedEvents{
+    "WARN Hello (0 suppressed)",
+    "WARN Hello (1 suppressed)",
+  };
+  CHECK(getEvents(session, "%S %m") == expectedEvents);
+}
+
+TEST_CASE("rate_limited")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+
+  // the loop is expected to complete in less than a second
+  for (int i = 0; i < 100; ++i)
+  {
+    BINLOG_ERROR_RATE_LIMITED_WC(writer, limited, 3, "i={}", i);
+  }
+
+  const std::vector<std::string> expectedEvents{
+    "ERRO i=0 (0 suppressed)",
+    "ERRO i=1 (0 suppressed)",
+    "ERRO i=2 (0 suppressed)",
+  };
+  CHECK(getEvents(session, "%S %m") == expectedEvents);
+}
+
+TEST_CASE("no_eval_if_suppressed")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+
+  for (int i = 0; i < 6; ++i)
+  {
+    BINLOG_INFO_EVERY_N_WC(writer, main, 5, "{}", (i % 5 == 0) ? i : failIfCalled());
+  }
+
+  // disabled severity: the arguments are not evaluated
+  session.setMinSeverity(binlog::Severity::warning);
+  BINLOG_INFO_RATE_LIMITED_WC(writer, main, 10, "{}", failIfCalled());
+
+  const std::vector<std::string> expectedEvents{
+    "0 (0 suppressed)",
+    "5 (4 suppressed)",
+  };
+  CHECK(getEvents(session, "%m") == expectedEvents);
+}
@@ -0,0 +1,95 @@
+#include <binlog/scope_macros.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/advanced_log_macros.hpp>
+#include <binlog/Severity.hpp>
+
+#include <doctest/doctest.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace {
+
+int failIfCalled()
+{
+  FAIL("Argument of disabled scope evaluated");
+  return 0;
+}
+
+bool startsWith(const std::string& str, const std::string& prefix)
+{
+  return str.compare(0, prefix.size(), prefix) == 0;
+}
+
+bool endsWith(const std::string& str, const std::string& suffix)
+{
+  return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+} // namespace
+
+TEST_CASE("scope")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+
+  {
+    std::string name = "outer";
+    BINLOG_SCOPE_WC(writer, spans, "{} {}", name, 1);
+    name = "changed"; // arguments are copied at scope entry
+
+    {
+      BINLOG_SCOPE_WC(writer, spans, "inner");
+    }
+  }
+
+  const std::vector<std::string> events = getEvents(session, "%C %S %m");
+  REQUIRE(events.size() == 2);
+  // the inner scope ends first
+  CHECK(startsWith(events[0], "spans INFO inner ("));
+  CHECK(endsWith(events[0], "ns)"));
+  CHECK(startsWith(events[1], "spans INFO outer 1 ("));
+  CHECK(endsWith(events[1], "ns)"));
+}
+
+TEST_CASE("scope_timestamp_is_entry")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+
+  std::uint64_t before = 0;
+  {
+    before = binlog::clockNow();
+    BINLOG_SCOPE_WC(writer, spans, "timed");
+    BINLOG_INFO_WC(writer, spans, "inside");
+  }
+
+  // the scope event is added at exit, after the event inside, with the clock of the entry
+  const std::vector<std::string> events = getEvents(session, "%m %r");
+  REQUIRE(events.size() == 2);
+  CHECK(startsWith(events[0], "inside "));
+  const std::string scopeEvent = events[1];
+  REQUIRE(startsWith(scopeEvent, "timed ("));
+  const std::uint64_t clock = std::stoull(scopeEvent.substr(scopeEvent.rfind(' ') + 1));
+  const std::uint64_t insideClock = std::stoull(events[0].substr(events[0].rfind(' ') + 1));
+  CHECK(before <= clock);
+  CHECK(clock <= insideClock);
+}
+
+TEST_CASE("scope_disabled")
+{
+  binlog::Session session;
+  session.setMinSeverity(binlog::Severity::warning);
+  binlog::SessionWriter writer(session, 4096);
+
+  {
+    BINLOG_SCOPE_WC(writer, spans, "disabled {}", failIfCalled());
+  }
+
+  CHECK(getEvents(session, "%m").empty());
+}
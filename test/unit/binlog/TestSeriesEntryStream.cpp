@@ -0,0 +1,72 @@
+#include <binlog/SeriesEntryStream.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/RotatingFileSink.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/advanced_log_macros.hpp>
+
+#include <doctest/doctest.h>
+
+#include <cstddef>
+#include <cstdio> // remove
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+TEST_CASE("series_of_rotated_files")
+{
+  const std::string path = "binlog_test_series_rotated.blog";
+
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+
+  std::size_t rotationCount = 0;
+  {
+    binlog::RotatingFileSink::Options options;
+    options.maxFileSize = 1000;
+    binlog::RotatingFileSink sink(path, options);
+
+    for (int i = 0; i < 100; ++i)
+    {
+      BINLOG_INFO_W(writer, "Hello {}", i);
+      session.consume(sink);
+    }
+
+    rotationCount = sink.rotationCount();
+  }
+  REQUIRE(rotationCount > 2);
+
+  const std::vector<std::string> paths = binlog::SeriesEntryStream::rotatedFiles(path);
+  REQUIRE(paths.size() == rotationCount + 1);
+  CHECK(paths.front() == path + ".1");
+  CHECK(paths.back() == path);
+
+  binlog::SeriesEntryStream input(paths);
+  const std::vector<std::string> events = streamToEvents(input, "%m");
+
+  std::vector<std::string> expected;
+  for (int i = 0; i < 100; ++i) { expected.push_back("Hello " + std::to_string(i)); }
+  CHECK(events == expected);
+
+  CHECK(input.fileCount() == paths.size());
+  // the event source and the clock sync of each rotated file
+  CHECK(input.skippedEntryCount() >= 2 * rotationCount);
+
+  for (const std::string& p : paths) { (void)std::remove(p.data()); }
+}
+
+TEST_CASE("series_empty")
+{
+  CHECK(binlog::SeriesEntryStream::rotatedFiles("binlog_test_series_missing.blog").empty());
+
+  binlog::SeriesEntryStream input({});
+  CHECK(input.nextEntryPayload().empty());
+  CHECK(input.fileCount() == 0);
+}
+
+TEST_CASE("series_missing_file")
+{
+  CHECK_THROWS_AS(binlog::SeriesEntryStream({"binlog_test_series_missing.blog"}), std::runtime_error);
+}
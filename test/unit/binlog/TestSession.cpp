@@ -1,10 +1,22 @@
 #include <binlog/Session.hpp>
 
+#include "test_utils.hpp"
+
 #include <binlog/Entries.hpp>
+#include <binlog/EventStream.hpp>
+#include <binlog/SessionWriter.hpp>
 
 #include <doctest/doctest.h>
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <ios> // streamsize
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
 
 namespace {
 
@@ -13,6 +25,20 @@ struct NullOstream
   NullOstream& write(const char*, std::streamsize) { return *this; }
 };
 
+// Blocks in the first call of write until `release` is set
+struct BlockingOstream
+{
+  std::atomic<bool> entered{false};
+  std::atomic<bool> release{false};
+
+  BlockingOstream& write(const char*, std::streamsize)
+  {
+    entered.store(true);
+    while (! release.load()) { std::this_thread::yield(); }
+    return *this;
+  }
+};
+
 } // namespace
 
 TEST_CASE("channel_lifecycle")
@@ -52,6 +78,112 @@ TEST_CASE("channel_lifecycle")
   CHECK(cr.channelsRemoved == 0);
 }
 
+TEST_CASE("unnotified_channel_polled_by_every_consume")
+{
+  binlog::Session session;
+  NullOstream out;
+
+  std::shared_ptr<binlog::Session::Channel> ch = session.createChannel(128);
+  for (int i = 0; i < 3; ++i)
+  {
+    CHECK(session.consume(out).channelsPolled == 1);
+  }
+
+  // closed without notification: removed by the next consume
+  ch.reset();
+  const binlog::Session::ConsumeResult cr = session.consume(out);
+  CHECK(cr.channelsPolled == 1);
+  CHECK(cr.channelsRemoved == 1);
+}
+
+TEST_CASE("notified_channel_polled_periodically")
+{
+  binlog::Session session;
+  NullOstream out;
+
+  std::shared_ptr<binlog::Session::Channel> ch = session.createChannel(128);
+  ch->notifyConsumer();
+  binlog::Session::ConsumeResult cr = session.consume(out);
+  CHECK(cr.channelsPolled == 1);
+
+  // polled again, in case a commit raced with the previous consume
+  cr = session.consume(out);
+  CHECK(cr.channelsPolled == 1);
+
+  // idle channels that notified before are not polled
+  cr = session.consume(out);
+  CHECK(cr.channelsPolled == 0);
+
+  // closed without notification: found by a full poll
+  ch.reset();
+  std::size_t channelsRemoved = 0;
+  for (std::uint64_t i = 0; i < binlog::Session::fullPollInterval; ++i)
+  {
+    channelsRemoved += session.consume(out).channelsRemoved;
+  }
+  CHECK(channelsRemoved == 1);
+}
+
+TEST_CASE("remove_many_channels")
+{
+  binlog::Session session;
+  NullOstream out;
+
+  // the channels notify the consumer, like writers, to be skipped while idle
+  const auto createChannel = [&session]()
+  {
+    std::shared_ptr<binlog::Session::Channel> channel = session.createChannel(128);
+    channel->notifyConsumer();
+    return channel;
+  };
+
+  std::vector<std::shared_ptr<binlog::Session::Channel>> channels;
+  for (int i = 0; i < 100; ++i) { channels.push_back(createChannel()); }
+
+  binlog::Session::ConsumeResult cr = session.consume(out);
+  CHECK(cr.channelsPolled == 100);
+  cr = session.consume(out);
+  CHECK(cr.channelsPolled == 100); // polled again after the notification
+
+  // close every other channel
+  for (std::size_t i = 0; i < channels.size(); i += 2)
+  {
+    channels[i]->notifyClosing();
+    channels[i].reset();
+  }
+
+  cr = session.consume(out);
+  CHECK(cr.channelsPolled == 50);
+  CHECK(cr.channelsRemoved == 50);
+
+  // every remaining channel is polled once by a full poll
+  std::size_t channelsPolled = 0;
+  for (std::uint64_t i = 0; i < binlog::Session::fullPollInterval; ++i)
+  {
+    cr = session.consume(out);
+    channelsPolled += cr.channelsPolled;
+    CHECK(cr.channelsRemoved == 0);
+  }
+  CHECK(channelsPolled == 50);
+
+  // the slots of the removed channels are reused
+  for (std::size_t i = 0; i < channels.size(); i += 2) { channels[i] = createChannel(); }
+  cr = session.consume(out);
+  CHECK(cr.channelsPolled == 50);
+
+  channels.clear();
+  channelsPolled = 0;
+  std::size_t channelsRemoved = 0;
+  for (std::uint64_t i = 0; i < binlog::Session::fullPollInterval; ++i)
+  {
+    cr = session.consume(out);
+    channelsPolled += cr.channelsPolled;
+    channelsRemoved += cr.channelsRemoved;
+  }
+  CHECK(channelsPolled == 100);
+  CHECK(channelsRemoved == 100);
+}
+
 TEST_CASE("set_channel_name")
 {
   binlog::Session session;
@@ -61,6 +193,49 @@ TEST_CASE("set_channel_name")
   CHECK(ch->writerProp.name == "Sio");
 }
 
+TEST_CASE("memory_usage")
+{
+  binlog::Session session;
+  NullOstream out;
+
+  const binlog::Session::MemoryUsage empty = session.memoryUsage();
+  CHECK(empty.channelCount == 0);
+  CHECK(empty.channelBytes == 0);
+  CHECK(empty.sourceBytes == 0);
+
+  // new channels, not yet consumed, are counted
+  std::shared_ptr<binlog::Session::Channel> ch1 = session.createChannel(4096);
+  std::shared_ptr<binlog::Session::Channel> ch2 = session.createChannel(1024);
+  session.setChannelWriterName(*ch1, std::string(100, 'w'));
+  binlog::Session::MemoryUsage usage = session.memoryUsage();
+  CHECK(usage.channelCount == 2);
+  CHECK(usage.channelBytes >= 5120);
+  CHECK(usage.writerPropBytes >= 100);
+
+  // consumed channels as well
+  session.addEventSource(binlog::EventSource{0, binlog::Severity::info, "cat", "fun", "file", 1, "format", ""});
+  session.addInternedString("interned");
+  session.consume(out);
+  usage = session.memoryUsage();
+  CHECK(usage.channelCount == 2);
+  CHECK(usage.channelBytes >= 5120);
+  CHECK(usage.writerPropBytes >= 200); // writerProp and its consumed copy
+  CHECK(usage.sourceBytes > 20);
+  CHECK(usage.internedStringBytes >= 8);
+  CHECK(usage.consumerBytes > 0);
+  CHECK(usage.totalBytes() == usage.channelBytes + usage.writerPropBytes + usage.sourceBytes
+    + usage.internedStringBytes + usage.consumerBytes);
+
+  // removed channels are not
+  const std::size_t channelBytes = usage.channelBytes;
+  ch1->notifyClosing();
+  ch1.reset();
+  session.consume(out);
+  usage = session.memoryUsage();
+  CHECK(usage.channelCount == 1);
+  CHECK(usage.channelBytes < channelBytes - 4096);
+}
+
 TEST_CASE("min_severity")
 {
   binlog::Session session;
@@ -84,4 +259,239 @@ TEST_CASE("sources_consumed_once")
   CHECK(cr.bytesConsumed == 0);
 }
 
+TEST_CASE("static_event_source")
+{
+  const binlog::StaticEventSource staticSource{
+    binlog::Severity::warning, "cat", "fun", "file", 123, "Hello {} {}", "[ci"
+  };
+  binlog::EventSource eventSource{
+    0, binlog::Severity::warning, "cat", "fun", "file", 123, "Hello {} {}", "[ci"
+  };
+
+  binlog::Session session;
+  CHECK(session.addEventSource(staticSource) == 1);
+  CHECK(session.addEventSource(eventSource) == 2);
+
+  TestStream out;
+  session.consume(out);
+
+  // serialized the same way as the equivalent EventSource
+  TestStream expected;
+  eventSource.id = 1;
+  binlog::serializeSizePrefixedTagged(eventSource, expected);
+  eventSource.id = 2;
+  binlog::serializeSizePrefixedTagged(eventSource, expected);
+  REQUIRE(out.buffer.size() > expected.buffer.size()); // the ClockSync precedes the sources
+  const std::vector<char> sources(out.buffer.end() - std::ptrdiff_t(expected.buffer.size()), out.buffer.end());
+  CHECK(sources == expected.buffer);
+}
+
+TEST_CASE("event_source_batch")
+{
+  const binlog::StaticEventSource sources[] = {
+    {binlog::Severity::info, "cat", "fun", "file", 1, "a {}", "i"},
+    {binlog::Severity::warning, "cat", "fun", "file", 2, "b", ""},
+    {binlog::Severity::error, "cat2", "fun", "file", 3, "c {}", "[c"},
+  };
+
+  binlog::Session session;
+  CHECK(session.addEventSource(sources[0]) == 1);
+  const std::uint64_t firstId = session.addEventSources(sources, 3);
+  CHECK(firstId == 2);
+  CHECK(session.addEventSource(sources[1]) == 5);
+  CHECK(session.addEventSources(sources, 0) == 6);
+  CHECK(session.eventSourceSeverity(firstId + 2) == binlog::Severity::error);
+
+  binlog::SessionWriter writer(session, 4096);
+  CHECK(writer.addEvent(firstId + 0, 0, 7));
+  CHECK(writer.addEvent(firstId + 1, 0));
+  CHECK(writer.addEvent(firstId + 2, 0, std::string("x")));
+  CHECK(getEvents(session, "%L %S %m") == std::vector<std::string>{
+    "1 INFO a 7", "2 WARN b", "3 ERRO c x"
+  });
+}
+
+TEST_CASE("stable_source_ids")
+{
+  const binlog::StaticEventSource sources[] = {
+    {binlog::Severity::info, "cat", "fun", "file", 1, "a {}", "i"},
+    {binlog::Severity::warning, "cat", "fun", "file", 2, "b", ""},
+  };
+  const binlog::EventSource dynamicSource{
+    0, binlog::Severity::info, "cat", "fun", "file", 1, "a {}", "i"
+  };
+
+  constexpr std::uint64_t expectedId = binlog::detail::stableSourceId(
+    binlog::Severity::info, "cat", "fun", "file", 1, "a {}", "i"
+  );
+  static_assert(binlog::detail::isStableSourceId(expectedId), "computed at compile time");
+
+  std::uint64_t idA = 0;
+  std::uint64_t idB = 0;
+  {
+    binlog::Session session;
+    session.setStableSourceIds(true);
+    idA = session.addEventSource(sources[0]);
+    idB = session.addEventSource(sources[1]);
+    CHECK(idA == expectedId);
+    CHECK(idA != idB);
+    CHECK(binlog::detail::isStableSourceId(idB));
+
+    // equal sources share the id, and added once
+    CHECK(session.addEventSource(dynamicSource) == idA);
+    CHECK(session.eventSourceSeverity(idB) == binlog::Severity::warning);
+
+    binlog::SessionWriter writer(session, 4096);
+    CHECK(writer.addEvent(idA, 0, 7));
+    CHECK(writer.addEvent(idB, 0));
+    CHECK(getEvents(session, "%L %S %m") == std::vector<std::string>{"1 INFO a 7", "2 WARN b"});
+  }
+
+  // same ids in another session, in different order
+  binlog::Session session;
+  session.setStableSourceIds(true);
+  CHECK(session.addEventSource(sources[1]) == idB);
+  CHECK(session.addEventSource(sources[0]) == idA);
+
+  // first-hit order if disabled
+  session.setStableSourceIds(false);
+  CHECK(session.addEventSource(sources[0]) == 1);
+}
+
+TEST_CASE("many_event_sources")
+{
+  // the metadata spans several segments, added between consumes
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 1 << 20);
+  TestStream out;
+  for (int i = 0; i < 5000; ++i)
+  {
+    const binlog::EventSource eventSource{
+      0, binlog::Severity::info, "cat", "fun", "file", std::uint64_t(i), "source " + std::to_string(i), ""
+    };
+    const std::uint64_t id = session.addEventSource(eventSource);
+    CHECK(writer.addEvent(id, 0));
+    if (i % 1000 == 999) { session.consume(out); }
+  }
+
+  const std::vector<std::string> events = streamToEvents(out, "%m");
+  REQUIRE(events.size() == 5000);
+  for (std::size_t i = 0; i < events.size(); i += 499)
+  {
+    CHECK(events[i] == "source " + std::to_string(i));
+  }
+
+  // every source is written again, in order
+  TestStream again;
+  session.reconsumeMetadata(again);
+  binlog::Range range(again.buffer.data(), again.buffer.size());
+  std::uint64_t nextId = 1;
+  while (! range.empty())
+  {
+    const std::uint32_t size = range.read<std::uint32_t>();
+    binlog::Range entry(range.view(size), size);
+    if (entry.read<std::uint64_t>() == binlog::EventSource::Tag)
+    {
+      CHECK(entry.read<std::uint64_t>() == nextId);
+      ++nextId;
+    }
+  }
+  CHECK(nextId == 5001);
+}
+
+TEST_CASE("clock_sync_refresh")
+{
+  binlog::Session session;
+
+  std::uint64_t calls = 0;
+  session.setClockSyncRefresh([&calls]() {
+    ++calls;
+    return binlog::ClockSync{calls, 1, calls, 0, "UTC"};
+  }, std::chrono::nanoseconds(0));
+
+  // every consume refreshes the clock sync, only the latest is consumed
+  for (std::uint64_t i = 1; i <= 3; ++i)
+  {
+    TestStream out;
+    session.consume(out);
+    CHECK(calls == i);
+    CHECK(countTags(out, binlog::ClockSync::Tag) == 1);
+  }
+
+  // the next refresh is due in an hour: only the first consume refreshes
+  session.setClockSyncRefresh([&calls]() {
+    ++calls;
+    return binlog::ClockSync{};
+  }, std::chrono::hours(1));
+
+  TestStream out1;
+  session.consume(out1);
+  CHECK(calls == 4);
+  CHECK(countTags(out1, binlog::ClockSync::Tag) == 1);
+
+  TestStream out2;
+  session.consume(out2);
+  CHECK(calls == 4);
+  CHECK(countTags(out2, binlog::ClockSync::Tag) == 0);
+
+  // disabled
+  session.setClockSyncRefresh({}, std::chrono::nanoseconds(0));
+  TestStream out3;
+  session.consume(out3);
+  CHECK(calls == 4);
+}
+
+TEST_CASE("clock_correction")
+{
+  binlog::Session session;
+  session.setClockSync(binlog::ClockSync{0, 1, 1000, 0, "UTC"});
+  session.setClockCorrection(std::chrono::nanoseconds(-200), std::chrono::nanoseconds(50));
+
+  TestStream out;
+  session.consume(out);
+  CHECK(countTags(out, binlog::ClockCorrection::Tag) == 1);
+  CHECK(countTags(out, binlog::ClockSync::Tag) == 1);
+
+  binlog::EventStream eventStream;
+  eventStream.loadMetadata(out);
+  CHECK(eventStream.clockSync().nsSinceEpoch == 800);
+  CHECK(eventStream.clockCorrection().offset == -200);
+  CHECK(eventStream.clockCorrection().uncertainty == 50);
+
+  // the correction is applied to the later clock syncs as well
+  session.setClockSync(binlog::ClockSync{0, 1, 2000, 0, "UTC"});
+  TestStream out2;
+  session.consume(out2);
+  binlog::EventStream eventStream2;
+  eventStream2.loadMetadata(out2);
+  CHECK(eventStream2.clockSync().nsSinceEpoch == 1800);
+  CHECK(eventStream2.clockCorrection().offset == -200);
+}
+
 // addEventSource and consume are further tested in TestSessionWriter.cpp
+
+TEST_CASE("add_while_consuming")
+{
+  binlog::Session session;
+  binlog::EventSource eventSource;
+  session.addEventSource(eventSource);
+
+  BlockingOstream out;
+  std::thread consumer([&session, &out]() { session.consume(out); });
+
+  while (! out.entered.load()) { std::this_thread::yield(); }
+
+  // consumer is blocked in write: writers must not wait for it
+  CHECK(session.addEventSource(eventSource) == 2);
+  std::shared_ptr<binlog::Session::Channel> ch = session.createChannel(128);
+  session.setChannelWriterName(*ch, "Sio");
+  session.setClockSync(binlog::ClockSync{});
+
+  out.release.store(true);
+  consumer.join();
+
+  NullOstream nout;
+  const binlog::Session::ConsumeResult cr = session.consume(nout);
+  CHECK(cr.bytesConsumed != 0); // new source and clock sync
+  CHECK(cr.channelsPolled == 1);
+}
@@ -0,0 +1,103 @@
+#include <binlog/SessionGroup.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/Entries.hpp>
+#include <binlog/InternedString.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/advanced_log_macros.hpp>
+
+#include <doctest/doctest.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+void logA(binlog::SessionWriter& writer, const char* str)
+{
+  BINLOG_INFO_W(writer, "A {}", binlog::interned(str));
+}
+
+void logB(binlog::SessionWriter& writer, const char* str)
+{
+  BINLOG_INFO_W(writer, "B {}", binlog::interned(str));
+}
+
+} // namespace
+
+TEST_CASE("consume_sessions")
+{
+  binlog::Session sessionA;
+  binlog::Session sessionB;
+  binlog::SessionWriter writerA(sessionA, 4096, 1, "A");
+  binlog::SessionWriter writerB(sessionB, 4096, 2, "B");
+
+  binlog::SessionGroup group;
+  group.add(sessionA);
+  group.add(sessionB);
+
+  // the first source and interned string of each session has the same id
+  logA(writerA, "foo");
+  logB(writerB, "bar");
+  BINLOG_INFO_W(writerB, "B {} {}", 2, binlog::interned("baz"));
+
+  TestStream stream;
+  const binlog::Session::ConsumeResult cr = group.consume(stream);
+  CHECK(cr.bytesConsumed == stream.buffer.size());
+  CHECK(cr.totalBytesConsumed == stream.buffer.size());
+  CHECK(cr.channelsPolled == 2);
+
+  CHECK(streamToEvents(stream, "%I %n %m") == std::vector<std::string>{
+    "1 A A foo", "2 B B bar", "3 B B 2 baz",
+  });
+
+  // sources added before are not repeated, new ones get new ids
+  logA(writerA, "foo");
+  BINLOG_INFO_W(writerA, "A2 {}", binlog::interned("qux"));
+  logB(writerB, "bar");
+
+  const binlog::Session::ConsumeResult cr2 = group.consume(stream);
+  CHECK(cr2.totalBytesConsumed == stream.buffer.size());
+
+  stream.readPos = 0;
+  CHECK(streamToEvents(stream, "%I %m") == std::vector<std::string>{
+    "1 A foo", "2 B bar", "3 B 2 baz",
+    "1 A foo", "4 A2 qux", "2 B bar",
+  });
+
+  stream.readPos = 0;
+  CHECK(countTags(stream, binlog::EventSource::Tag) == 4);
+  CHECK(countTags(stream, binlog::InternedString::Tag) == 4);
+
+  // the clock sync of the session is repeated before its events, as the clocks might differ
+  CHECK(countTags(stream, binlog::ClockSync::Tag) == 4);
+}
+
+TEST_CASE("reconsume_metadata")
+{
+  binlog::Session sessionA;
+  binlog::Session sessionB;
+  binlog::SessionWriter writerA(sessionA, 4096);
+  binlog::SessionWriter writerB(sessionB, 4096);
+
+  binlog::SessionGroup group;
+  group.add(sessionA);
+  group.add(sessionB);
+
+  BINLOG_INFO_W(writerA, "A {}", binlog::interned("foo"));
+  BINLOG_INFO_W(writerB, "B {}", binlog::interned("bar"));
+
+  TestStream first;
+  group.consume(first);
+
+  // e.g: rotation to a new file
+  TestStream second;
+  group.reconsumeMetadata(second);
+  BINLOG_INFO_W(writerB, "B2 {}", binlog::interned("bar"));
+  BINLOG_INFO_W(writerA, "A2 {}", binlog::interned("foo"));
+  group.consume(second);
+
+  CHECK(streamToEvents(second, "%I %m") == std::vector<std::string>{"3 A2 foo", "4 B2 bar"});
+}
@@ -2,12 +2,21 @@
 
 #include <binlog/SessionWriter.hpp>
 
+#include <binlog/EventStream.hpp>
+
 #include "test_utils.hpp"
 
 #include <doctest/doctest.h>
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iterator> // reverse_iterator
+#include <memory>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <thread>
 #include <vector>
@@ -27,6 +36,50 @@ TEST_CASE("add_event")
   CHECK(getEvents(session, "%m") == std::vector<std::string>{"a=456 b=foo"});
 }
 
+TEST_CASE("add_fixed_size_event")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 128);
+
+  binlog::EventSource eventSource{
+    0, binlog::Severity::info, "cat", "fun", "file", 123, "a={} b={} c={} d={}", "iycd"
+  };
+  eventSource.id = session.addEventSource(eventSource);
+
+  const int a = 456;
+  const bool b = true;
+  char c = 'x';
+  CHECK(writer.addEvent(eventSource.id, 0, a, b, c, 7.5));
+
+  CHECK(getEvents(session, "%m") == std::vector<std::string>{"a=456 b=true c=x d=7.5"});
+}
+
+TEST_CASE("add_event_in_place")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 128);
+
+  binlog::EventSource eventSource{
+    0, binlog::Severity::info, "cat", "fun", "file", 123, "a={} b={}", "[[ci"
+  };
+  eventSource.id = session.addEventSource(eventSource);
+
+  // serialized in place, the size of the vector is not computed first
+  const std::vector<std::string> strings{"foo", "bar"};
+  CHECK(writer.addEvent(eventSource.id, 0, strings, 1));
+
+  // does not fit into the free space of the queue, falls back to reserving the size
+  const std::vector<std::string> large(10, std::string(20, 'x'));
+  CHECK(writer.addEvent(eventSource.id, 0, large, 2));
+
+  TestStream stream;
+  session.consume(stream);
+  const std::vector<std::string> events = streamToEvents(stream, "%m");
+  REQUIRE(events.size() == 2);
+  CHECK(events[0] == "a=[foo, bar] b=1");
+  CHECK(events[1].size() == std::string("a=[] b=2").size() + 10 * 20 + 9 * 2);
+}
+
 TEST_CASE("add_event_with_time")
 {
   binlog::Session session;
@@ -107,6 +160,220 @@ TEST_CASE("add_event_with_writer_id_name")
   CHECK(getEvents(session, "%t %n %m") == std::vector<std::string>{"111 John a=456 b=foo"});
 }
 
+TEST_CASE("rename_writer_after_consume")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 128, 111, "John");
+
+  binlog::EventSource eventSource{
+    0, binlog::Severity::info, "cat", "fun", "file", 123, "a={}", "i"
+  };
+  eventSource.id = session.addEventSource(eventSource);
+
+  TestStream stream;
+  CHECK(writer.addEvent(eventSource.id, 0, 1));
+  session.consume(stream);
+
+  writer.setId(222);
+  writer.setName("Jane");
+  CHECK(writer.addEvent(eventSource.id, 0, 2));
+  CHECK(writer.addEvent(eventSource.id, 0, 3));
+  session.consume(stream);
+
+  CHECK(streamToEvents(stream, "%t %n %m") == std::vector<std::string>{
+    "111 John a=1", "222 Jane a=2", "222 Jane a=3"
+  });
+}
+
+TEST_CASE("add_task_event")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096, 1, "T");
+
+  binlog::EventSource eventSource{
+    0, binlog::Severity::info, "cat", "fun", "file", 123, "a={}", "i"
+  };
+  eventSource.id = session.addEventSource(eventSource);
+
+  const binlog::WriterProp taskA{10, "A", 0};
+  const binlog::WriterProp taskB{20, "B", 0};
+
+  TestStream stream;
+  CHECK(writer.addEvent(eventSource.id, 0, 1));
+  CHECK(writer.addTaskEvent(taskA, eventSource.id, 0, 2));
+  session.consume(stream);
+
+  // the next batch continues in the context of the last event
+  CHECK(writer.addTaskEvent(taskA, eventSource.id, 0, 3));
+  session.consume(stream);
+
+  CHECK(writer.addEvent(eventSource.id, 0, 4));
+  CHECK(writer.addTaskEvent(taskB, eventSource.id, 0, 5));
+  CHECK(writer.addTaskEvent(taskA, eventSource.id, 0, 6));
+  session.consume(stream);
+
+  CHECK(writer.addEvent(eventSource.id, 0, 7));
+  session.consume(stream);
+
+  CHECK(streamToEvents(stream, "%t %n %m") == std::vector<std::string>{
+    "1 T a=1", "10 A a=2", "10 A a=3", "1 T a=4", "20 B a=5", "10 A a=6", "1 T a=7"
+  });
+}
+
+TEST_CASE("add_task_event_grow")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 128, 1, "T");
+
+  binlog::EventSource eventSource{
+    0, binlog::Severity::info, "cat", "fun", "file", 123, "a={}", "i"
+  };
+  eventSource.id = session.addEventSource(eventSource);
+
+  // the queue is replaced while in the context of the task
+  const binlog::WriterProp task{10, "A", 0};
+  std::vector<std::string> expectedEvents;
+  for (int i = 0; i < 100; ++i)
+  {
+    CHECK(writer.addTaskEvent(task, eventSource.id, 0, i));
+    expectedEvents.push_back("10 A a=" + std::to_string(i));
+  }
+
+  TestStream stream;
+  session.consume(stream);
+  CHECK(streamToEvents(stream, "%t %n %m") == expectedEvents);
+}
+
+TEST_CASE("set_context")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096, 1, "T");
+
+  binlog::EventSource eventSource{
+    0, binlog::Severity::info, "cat", "fun", "file", 123, "a={}", "i"
+  };
+  eventSource.id = session.addEventSource(eventSource);
+
+  const binlog::WriterProp task{10, "A", 0};
+
+  TestStream stream;
+  CHECK(writer.addEvent(eventSource.id, 0, 1));
+  CHECK(writer.setContext("trace-1"));
+  CHECK(writer.context() == "trace-1");
+  CHECK(writer.addEvent(eventSource.id, 0, 2));
+  CHECK(writer.addEvent(eventSource.id, 0, 3));
+  session.consume(stream);
+
+  // the next batch continues in the context of the writer
+  CHECK(writer.addEvent(eventSource.id, 0, 4));
+  CHECK(writer.addTaskEvent(task, eventSource.id, 0, 5));
+  CHECK(writer.addEvent(eventSource.id, 0, 6));
+  CHECK(writer.setContext("trace-2"));
+  CHECK(writer.addEvent(eventSource.id, 0, 7));
+  session.consume(stream);
+
+  CHECK(writer.setContext(""));
+  CHECK(writer.addEvent(eventSource.id, 0, 8));
+  session.consume(stream);
+
+  CHECK(streamToEvents(stream, "%n %c %m") == std::vector<std::string>{
+    "T  a=1", "T trace-1 a=2", "T trace-1 a=3", "T trace-1 a=4",
+    "A  a=5", "T trace-1 a=6", "T trace-2 a=7", "T  a=8"
+  });
+}
+
+TEST_CASE("set_context_written_once_per_batch")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+
+  binlog::EventSource eventSource{
+    0, binlog::Severity::info, "cat", "fun", "file", 123, "a={}", "i"
+  };
+  eventSource.id = session.addEventSource(eventSource);
+
+  CHECK(writer.setContext("4bf92f3577b34da6a3ce929d0e0e4736"));
+  CHECK(writer.setContext("4bf92f3577b34da6a3ce929d0e0e4736")); // unchanged, not written
+
+  TestStream stream;
+  for (int i = 0; i < 100; ++i)
+  {
+    CHECK(writer.addEvent(eventSource.id, 0, i));
+  }
+  session.consume(stream);
+  CHECK(countTags(stream, binlog::WriterContext::Tag) == 1);
+
+  // a batch can be read on its own (with the metadata)
+  TestStream batch;
+  CHECK(writer.addEvent(eventSource.id, 0, 100));
+  session.reconsumeMetadata(batch);
+  session.consume(batch);
+  CHECK(countTags(batch, binlog::WriterContext::Tag) == 1);
+  CHECK(streamToEvents(batch, "%c %m") == std::vector<std::string>{
+    "4bf92f3577b34da6a3ce929d0e0e4736 a=100"
+  });
+}
+
+TEST_CASE("set_context_grow")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 128, 1, "T");
+
+  binlog::EventSource eventSource{
+    0, binlog::Severity::info, "cat", "fun", "file", 123, "a={}", "i"
+  };
+  eventSource.id = session.addEventSource(eventSource);
+
+  // the queue is replaced in the context
+  CHECK(writer.setContext("ctx"));
+  std::vector<std::string> expectedEvents;
+  for (int i = 0; i < 100; ++i)
+  {
+    CHECK(writer.addEvent(eventSource.id, 0, i));
+    expectedEvents.push_back("ctx a=" + std::to_string(i));
+  }
+
+  TestStream stream;
+  session.consume(stream);
+  CHECK(streamToEvents(stream, "%c %m") == expectedEvents);
+}
+
+TEST_CASE("set_context_queue_full")
+{
+  const std::string context(64, 'c');
+  const binlog::WriterProp task{10, "A", 0};
+
+  // leave gaps of different sizes at the end of the full queue
+  for (std::size_t padding = 0; padding < 64; ++padding)
+  {
+    binlog::Session session;
+    binlog::SessionWriter writer(session, 512, 1, "T");
+    writer.setOverflowPolicy(binlog::SessionWriter::OverflowPolicy::drop);
+
+    binlog::EventSource eventSource{
+      0, binlog::Severity::info, "cat", "fun", "file", 123, "{}", "[c"
+    };
+    eventSource.id = session.addEventSource(eventSource);
+
+    CHECK(writer.setContext(context));
+    const std::string taskArgument(padding, 'x');
+    while (writer.addTaskEvent(task, eventSource.id, 0, taskArgument)) {}
+
+    // the props of the writer and its context are added together, or not at all
+    for (int i = 0; i < 3; ++i) { writer.addEvent(eventSource.id, 0, std::string("y")); }
+
+    TestStream stream;
+    session.consume(stream);
+    CHECK(writer.addEvent(eventSource.id, 0, std::string("z")));
+    session.consume(stream);
+
+    for (const std::string& event : streamToEvents(stream, "%n %c %m"))
+    {
+      if (event[0] == 'T') { CHECK(event.substr(0, 3 + context.size()) == "T " + context + " "); }
+    }
+  }
+}
+
 TEST_CASE("add_event_with_writer_id_name_ctor")
 {
   binlog::Session session;
@@ -306,67 +573,932 @@ TEST_CASE("queue_is_full")
   CHECK(streamToEvents(stream, "%t %n %m") == expectedEvents);
 }
 
-TEST_CASE("move_ctor")
+TEST_CASE("poll_notified_writers")
 {
   binlog::Session session;
-  binlog::SessionWriter writerToBeMoved(session, 128);
-  binlog::SessionWriter writer(std::move(writerToBeMoved));
+  binlog::SessionWriter writer1(session, 128);
+  binlog::SessionWriter writer2(session, 128);
 
-  // no channel is closed
-  std::ostringstream out;
-  const binlog::Session::ConsumeResult cr = session.consume(out);
+  binlog::EventSource eventSource{
+    0, binlog::Severity::info, "cat", "fun", "file", 123, "a={}", "i"
+  };
+  eventSource.id = session.addEventSource(eventSource);
+
+  TestStream stream;
+  binlog::Session::ConsumeResult cr = session.consume(stream);
+  CHECK(cr.channelsPolled == 2);
+  cr = session.consume(stream);
+  CHECK(cr.channelsPolled == 2); // polled again after the notification of the constructor
+
+  // writer2 is idle: not polled
+  CHECK(writer1.addEvent(eventSource.id, 0, 1));
+  cr = session.consume(stream);
   CHECK(cr.channelsPolled == 1);
-  CHECK(cr.channelsRemoved == 0);
 
-  // channel is still operational
+  // polled again, in case a commit raced with the previous consume
+  cr = session.consume(stream);
+  CHECK(cr.channelsPolled == 1);
+
+  cr = session.consume(stream);
+  CHECK(cr.channelsPolled == 0);
+
+  CHECK(writer2.addEvent(eventSource.id, 0, 2));
+  cr = session.consume(stream);
+  CHECK(cr.channelsPolled == 1);
+
+  CHECK(streamToEvents(stream, "%m") == std::vector<std::string>{"a=1", "a=2"});
+}
+
+TEST_CASE("shrink_idle_queue")
+{
+  binlog::Session session;
+  binlog::Session::ShrinkPolicy policy;
+  policy.idleConsumeCount = 2;
+  session.setShrinkPolicy(policy);
+
+  binlog::SessionWriter writer(session, 128);
+  writer.setOverflowPolicy(binlog::SessionWriter::OverflowPolicy::drop);
+
   binlog::EventSource eventSource{
-    0, binlog::Severity::info, "cat", "fun", "file", 123, "a={} b={}", "i[c"
+    0, binlog::Severity::info, "cat", "fun", "file", 123, "a={}", "i"
   };
   eventSource.id = session.addEventSource(eventSource);
 
-  CHECK(writer.addEvent(eventSource.id, 0, 456, std::string("foo")));
+  // grow the queue by a large event
+  TestStream stream;
+  CHECK(writer.addEvent(eventSource.id, 0, std::string(200, 'x')) == false);
+  writer.setOverflowPolicy(binlog::SessionWriter::OverflowPolicy::grow);
+  CHECK(writer.addEvent(eventSource.id, 0, std::string(200, 'x')));
+  writer.setOverflowPolicy(binlog::SessionWriter::OverflowPolicy::drop);
+  session.consume(stream);
 
-  CHECK(getEvents(session, "%m") == std::vector<std::string>{"a=456 b=foo"});
+  // busy: the queue is not shrunk
+  CHECK(writer.addEvent(eventSource.id, 0, std::string(200, 'x')));
+  session.consume(stream);
+  CHECK(writer.addEvent(eventSource.id, 0, std::string(200, 'x')));
+
+  // idle for a full poll interval
+  for (std::uint64_t i = 0; i < binlog::Session::fullPollInterval; ++i) { session.consume(stream); }
+
+  // the next event shrinks the queue: each event takes 4+8+8+4 = 24 bytes, 5 fits into the initial queue
+  std::size_t added = 0;
+  for (int i = 0; i < 10; ++i)
+  {
+    if (writer.addEvent(eventSource.id, 0, i)) { ++added; }
+  }
+  CHECK(added == 5);
 }
 
-TEST_CASE("move_assign")
+TEST_CASE("spill_oversized_event")
 {
   binlog::Session session;
-  binlog::SessionWriter writer1(session, 128);
-  binlog::SessionWriter writer2(session, 128);
+  binlog::SessionWriter writer(session, 128);
+  writer.setSpillOversizedEvents(true);
 
-  writer1.setName("W1");
-  writer2.setName("W2");
+  binlog::EventSource eventSource{
+    0, binlog::Severity::info, "cat", "fun", "file", 123, "a={}", "[c"
+  };
+  eventSource.id = session.addEventSource(eventSource);
+
+  // the oversized event is written to a temporary channel,
+  // the next event returns to a channel of the initial capacity
+  CHECK(writer.addEvent(eventSource.id, 0, std::string("x")));
+  CHECK(writer.addEvent(eventSource.id, 0, std::string(1000, 'y')));
+  CHECK(writer.addEvent(eventSource.id, 0, std::string("z")));
+
+  TestStream stream;
+  session.consume(stream);
+  session.consume(stream); // the replaced channels are removed
+
+  const std::vector<std::string> events = streamToEvents(stream, "%m");
+  CHECK(events == std::vector<std::string>{"a=x", "a=" + std::string(1000, 'y'), "a=z"});
+
+  const binlog::Session::Metrics metrics = session.metrics();
+  REQUIRE(metrics.channels.size() == 1);
+  CHECK(metrics.channels.front().capacity == 128);
+  CHECK(metrics.channels.front().replacementCount == 2);
+}
+
+TEST_CASE("non_temporal_arguments")
+{
+  binlog::Session session;
+  session.setConsumerPrefetch(4096);
+  binlog::SessionWriter writerA(session, 4096);
+  binlog::SessionWriter writerB(session, 4096);
+  writerA.setNonTemporalThreshold(64);
 
   binlog::EventSource eventSource{
-    0, binlog::Severity::info, "cat", "fun", "file", 123, "a={} b={}", "i[c"
+    0, binlog::Severity::info, "cat", "fun", "file", 123, "a={}", "[c"
   };
   eventSource.id = session.addEventSource(eventSource);
 
-  CHECK(writer1.addEvent(eventSource.id, 0, 123, std::string("foo")));
-  CHECK(writer2.addEvent(eventSource.id, 0, 456, std::string("bar")));
+  // strings of every size and alignment around the threshold, also growing the queue
+  std::vector<std::string> expected;
+  TestStream stream;
+  for (const std::size_t size : {0U, 1U, 15U, 63U, 64U, 65U, 100U, 1000U, 5000U, 10000U})
+  {
+    const std::string a(size, char('a' + size % 26));
+    const std::string b(size + 3, 'b');
+    CHECK(writerA.addEvent(eventSource.id, 0, a));
+    CHECK(writerB.addEvent(eventSource.id, 0, b));
+    CHECK(writerA.addEvent(eventSource.id, 0, std::string(7, 'x')));
+    expected.push_back("a=" + a);
+    expected.push_back("a=" + b);
+    expected.push_back("a=xxxxxxx");
+    session.consume(stream);
+  }
 
-  writer2 = std::move(writer1);
-  CHECK(writer2.addEvent(eventSource.id, 0, 789, std::string("baz")));
+  std::vector<std::string> events = streamToEvents(stream, "%m");
+  std::sort(events.begin(), events.end());
+  std::sort(expected.begin(), expected.end());
+  CHECK(events == expected);
+}
 
-  const std::vector<std::string> expectedEvents{
-    "W1 a=123 b=foo",
-    "W1 a=789 b=baz",
-    "W2 a=456 b=bar",
+TEST_CASE("session_metrics")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 128, 7, "Seven");
+
+  binlog::EventSource eventSource{
+    0, binlog::Severity::info, "cat", "fun", "file", 123, "a={}", "i"
   };
-  CHECK(getEvents(session, "%n %m") == expectedEvents);
+  eventSource.id = session.addEventSource(eventSource);
+
+  // grow the queue twice, then drop an event
+  CHECK(writer.addEvent(eventSource.id, 0, std::string(200, 'x')));
+  CHECK(writer.addEvent(eventSource.id, 0, std::string(400, 'x')));
+  writer.setOverflowPolicy(binlog::SessionWriter::OverflowPolicy::drop);
+  CHECK(writer.addEvent(eventSource.id, 0, std::string(1000, 'x')) == false);
+
+  TestStream stream;
+  session.consume(stream);
+  session.consume(stream); // the replaced channels are removed
+
+  const binlog::Session::Metrics metrics = session.metrics();
+  CHECK(metrics.consumeCount == 2);
+  CHECK(metrics.droppedEventCount == 1);
+  CHECK(metrics.totalBytesConsumed == stream.buffer.size());
+
+  REQUIRE(metrics.channels.size() == 1);
+  const binlog::Session::Metrics::ChannelMetrics& channel = metrics.channels.front();
+  CHECK(channel.writerProp.name == "Seven");
+  CHECK(channel.capacity >= 800);
+  CHECK(channel.replacementCount == 2);
+  CHECK(channel.droppedEventCount == 1);
+  CHECK(channel.bytesConsumed > 400);
+  CHECK(channel.highWaterMark == channel.bytesConsumed); // consumed at once
+
+  std::uint64_t durationCount = 0;
+  std::uint64_t bytesCount = 0;
+  for (std::size_t b = 0; b < binlog::Session::Metrics::histogramSize; ++b)
+  {
+    durationCount += metrics.consumeDurations[b];
+    bytesCount += metrics.consumeBytes[b];
+  }
+  CHECK(durationCount == 2);
+  CHECK(bytesCount == 2);
 }
 
-TEST_CASE("swap_writers_of_different_sessions")
+TEST_CASE("session_telemetry")
 {
-  binlog::Session sa;
-  binlog::SessionWriter wa(sa, 128);
+  binlog::Session session;
+  session.setClockSync(binlog::ClockSync{0, 1000000000, 0, 0, "UTC"});
+  session.setTelemetry(2, []() -> std::uint64_t { return 5000; });
+  binlog::SessionWriter writer(session, 128, 7, "Seven");
 
-  binlog::Session sb;
-  binlog::SessionWriter wb(sb, 128);
+  binlog::EventSource eventSource{
+    0, binlog::Severity::info, "cat", "fun", "file", 123, "a={}", "i"
+  };
+  eventSource.id = session.addEventSource(eventSource);
+  CHECK(writer.addEvent(eventSource.id, 1000, 1));
 
-  std::swap(wa, wb);
-  // at this point, wa references a channel of sb,
-  // but sb is destructed first. ASAN will detect
-  // if wa accesses a destructed channel.
+  TestStream stream;
+  const auto getEvents = [&stream](const char* format)
+  {
+    stream.readPos = 0;
+    return streamToEvents(stream, format);
+  };
+
+  // every second consume writes telemetry
+  session.consume(stream);
+  CHECK(getEvents("%n %C %m") == std::vector<std::string>{"Seven cat a=1"});
+
+  session.consume(stream);
+  const std::vector<std::string> events = getEvents("%n %C %m");
+  REQUIRE(events.size() == 3);
+  CHECK(events[1] == "binlog binlog writer=7 Seven capacity=128 highWaterMark=24 bytesConsumed=24 droppedEvents=0 replacements=0");
+  CHECK(events[2].find("binlog binlog consumeCount=2 totalBytesConsumed=") == 0);
+  CHECK(events[2].find(" droppedEvents=0 maxLagNs=4000") != std::string::npos);
+
+  // disabled
+  session.setTelemetry(0);
+  session.consume(stream);
+  session.consume(stream);
+  CHECK(getEvents("%m").size() == 3);
+}
+
+TEST_CASE("priority_lane")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 128, 7, "Seven");
+  writer.setOverflowPolicy(binlog::SessionWriter::OverflowPolicy::drop);
+  writer.setPriorityLane(128, binlog::Severity::error);
+
+  binlog::EventSource info{
+    0, binlog::Severity::info, "cat", "fun", "file", 123, "a={}", "i"
+  };
+  info.id = session.addEventSource(info);
+
+  binlog::EventSource error{
+    0, binlog::Severity::error, "cat", "fun", "file", 124, "e={}", "i"
+  };
+  error.id = session.addEventSource(error);
+
+  // fill the queue, 5 events fit, see overflow_policy_drop
+  for (int i = 0; i < 10; ++i) { writer.addEvent(info.id, 0, i); }
+
+  // the error is added to the priority lane, and consumed first
+  CHECK(writer.addEvent(error.id, 0, 99));
+  TestStream stream;
+  session.consume(stream);
+
+  // disabled lane: events are consumed in order
+  writer.setPriorityLane(0);
+  CHECK(writer.addEvent(info.id, 0, 5));
+  CHECK(writer.addEvent(error.id, 0, 6));
+  session.consume(stream);
+
+  CHECK(streamToEvents(stream, "%n %m") == std::vector<std::string>{
+    "Seven e=99", "Seven a=0", "Seven a=1", "Seven a=2", "Seven a=3", "Seven a=4",
+    "Seven a=5", "Seven e=6"
+  });
+}
+
+TEST_CASE("consume_budget")
+{
+  binlog::Session session;
+  binlog::SessionWriter writerA(session, 4096, 1, "A");
+  std::unique_ptr<binlog::SessionWriter> writerB(new binlog::SessionWriter(session, 4096, 2, "B"));
+
+  binlog::EventSource eventSource{
+    0, binlog::Severity::info, "cat", "fun", "file", 123, "a={}", "i"
+  };
+  eventSource.id = session.addEventSource(eventSource);
+
+  for (int i = 0; i < 10; ++i)
+  {
+    CHECK(writerA.addEvent(eventSource.id, 0, i));
+    CHECK(writerB->addEvent(eventSource.id, 0, i));
+  }
+  writerB.reset(); // closed, but not removed until consumed completely
+
+  // each event is 4+8+8+4 = 24 bytes, at least one is consumed by each call
+  TestStream stream;
+  for (int i = 0; i < 8; ++i)
+  {
+    const binlog::Session::ConsumeResult cr = session.consume(stream, 30);
+    CHECK(cr.channelsRemoved == 0);
+  }
+
+  // both writers got their turn
+  const std::vector<std::string> first = streamToEvents(stream, "%n %m");
+  CHECK(first.size() == 8);
+  CHECK(std::count(first.begin(), first.end(), "A a=0") == 1);
+  CHECK(std::count(first.begin(), first.end(), "B a=0") == 1);
+
+  // the rest is consumed in order, the closed writer is removed
+  CHECK(session.consume(stream).channelsRemoved == 1);
+  stream.readPos = 0;
+  const std::vector<std::string> all = streamToEvents(stream, "%n %m");
+  CHECK(all.size() == 20);
+  std::vector<std::string> a;
+  std::vector<std::string> b;
+  for (const std::string& e : all) { ((e[0] == 'A') ? a : b).push_back(e); }
+  for (std::size_t i = 0; i < 10; ++i)
+  {
+    CHECK(a[i] == "A a=" + std::to_string(i));
+    CHECK(b[i] == "B a=" + std::to_string(i));
+  }
+}
+
+TEST_CASE("move_ctor")
+{
+  binlog::Session session;
+  binlog::SessionWriter writerToBeMoved(session, 128);
+  binlog::SessionWriter writer(std::move(writerToBeMoved));
+
+  // no channel is closed
+  std::ostringstream out;
+  const binlog::Session::ConsumeResult cr = session.consume(out);
+  CHECK(cr.channelsPolled == 1);
+  CHECK(cr.channelsRemoved == 0);
+
+  // channel is still operational
+  binlog::EventSource eventSource{
+    0, binlog::Severity::info, "cat", "fun", "file", 123, "a={} b={}", "i[c"
+  };
+  eventSource.id = session.addEventSource(eventSource);
+
+  CHECK(writer.addEvent(eventSource.id, 0, 456, std::string("foo")));
+
+  CHECK(getEvents(session, "%m") == std::vector<std::string>{"a=456 b=foo"});
+}
+
+TEST_CASE("move_assign")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer1(session, 128);
+  binlog::SessionWriter writer2(session, 128);
+
+  writer1.setName("W1");
+  writer2.setName("W2");
+
+  binlog::EventSource eventSource{
+    0, binlog::Severity::info, "cat", "fun", "file", 123, "a={} b={}", "i[c"
+  };
+  eventSource.id = session.addEventSource(eventSource);
+
+  CHECK(writer1.addEvent(eventSource.id, 0, 123, std::string("foo")));
+  CHECK(writer2.addEvent(eventSource.id, 0, 456, std::string("bar")));
+
+  writer2 = std::move(writer1);
+  CHECK(writer2.addEvent(eventSource.id, 0, 789, std::string("baz")));
+
+  // the replaced channel of writer2 is closed, removed when consumed
+  TestStream stream;
+  const binlog::Session::ConsumeResult cr = session.consume(stream);
+  CHECK(cr.channelsRemoved == 1);
+
+  const std::vector<std::string> expectedEvents{
+    "W1 a=123 b=foo",
+    "W1 a=789 b=baz",
+    "W2 a=456 b=bar",
+  };
+  CHECK(streamToEvents(stream, "%n %m") == expectedEvents);
+  CHECK(session.consume(stream).channelsPolled == 1);
+}
+
+TEST_CASE("swap_writers_of_different_sessions")
+{
+  binlog::Session sa;
+  binlog::SessionWriter wa(sa, 128);
+
+  binlog::Session sb;
+  binlog::SessionWriter wb(sb, 128);
+
+  std::swap(wa, wb);
+  // at this point, wa references a channel of sb,
+  // but sb is destructed first. ASAN will detect
+  // if wa accesses a destructed channel.
+}
+
+TEST_CASE("consume_shards")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer1(session, 128, 1, "W1");
+  binlog::SessionWriter writer2(session, 128, 2, "W2");
+
+  binlog::EventSource eventSource{
+    0, binlog::Severity::info, "cat", "fun", "file", 123, "a={}", "i"
+  };
+  eventSource.id = session.addEventSource(eventSource);
+
+  // writer1 replaces its channel, events remain in the same shard
+  for (int i = 0; i < 32; ++i)
+  {
+    CHECK(writer1.addEvent(eventSource.id, 0, i));
+  }
+  CHECK(writer2.addEvent(eventSource.id, 0, 123));
+
+  TestStream stream0;
+  TestStream stream1;
+  session.consume(stream0, 0, 2);
+  session.consume(stream1, 1, 2);
+
+  std::vector<std::string> expectedEvents0;
+  for (int i = 0; i < 32; ++i)
+  {
+    expectedEvents0.push_back("W1 a=" + std::to_string(i));
+  }
+
+  // both outputs are self contained
+  CHECK(streamToEvents(stream0, "%n %m") == expectedEvents0);
+  CHECK(streamToEvents(stream1, "%n %m") == std::vector<std::string>{"W2 a=123"});
+}
+
+TEST_CASE("consume_shards_from_threads")
+{
+  binlog::Session session;
+
+  binlog::EventSource eventSource{
+    0, binlog::Severity::info, "cat", "fun", "file", 123, "a={}", "i"
+  };
+  eventSource.id = session.addEventSource(eventSource);
+
+  auto writeEvents = [&eventSource, &session](const char* name)
+  {
+    binlog::SessionWriter writer(session, 4096);
+    writer.setName(name);
+
+    for (int i = 0; i < 1000; ++i)
+    {
+      while (! writer.addEvent(eventSource.id, 0, i)) { std::this_thread::yield(); }
+    }
+  };
+
+  std::thread threadA(writeEvents, "A");
+  std::thread threadB(writeEvents, "B");
+
+  TestStream outs[2];
+  std::atomic<bool> write_done{false};
+  auto consume = [&session, &outs, &write_done](std::size_t shardIndex)
+  {
+    while (! write_done.load())
+    {
+      session.consume(outs[shardIndex], shardIndex, 2);
+    }
+
+    session.consume(outs[shardIndex], shardIndex, 2);
+  };
+
+  std::thread consumer0(consume, 0);
+  std::thread consumer1(consume, 1);
+
+  threadA.join();
+  threadB.join();
+  write_done.store(true);
+
+  consumer0.join();
+  consumer1.join();
+
+  // each writer is consumed by exactly one shard
+  const std::vector<std::string> events0 = streamToEvents(outs[0], "%n %m");
+  const std::vector<std::string> events1 = streamToEvents(outs[1], "%n %m");
+  CHECK(events0.size() == 1000);
+  CHECK(events1.size() == 1000);
+  CHECK(events0.front().at(0) != events1.front().at(0));
+}
+
+TEST_CASE("overflow_policy_drop")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 128, 7, "Seven");
+  writer.setOverflowPolicy(binlog::SessionWriter::OverflowPolicy::drop);
+
+  binlog::EventSource eventSource{
+    0, binlog::Severity::info, "cat", "fun", "file", 123, "a={}", "i"
+  };
+  eventSource.id = session.addEventSource(eventSource);
+
+  // each event is 4+8+8+4 = 24 bytes, 5 fits into the queue
+  std::size_t added = 0;
+  for (int i = 0; i < 10; ++i)
+  {
+    if (writer.addEvent(eventSource.id, 0, i)) { ++added; }
+  }
+  CHECK(added == 5);
+
+  TestStream stream;
+  const binlog::Session::ConsumeResult cr = session.consume(stream);
+  CHECK(cr.channelsPolled == 1); // no new channel is created
+
+  binlog::EventStream eventStream;
+  std::size_t eventCount = 0;
+  while (eventStream.nextEvent(stream) != nullptr) { ++eventCount; }
+  CHECK(eventCount == 5);
+  CHECK(eventStream.droppedEventCount() == 5);
+  CHECK(eventStream.writerProp().name == "Seven");
+
+  // drop count is reset by consume, even if there are no events
+  CHECK(! writer.addEvent(eventSource.id, 0, std::vector<int>(100)));
+  TestStream stream2;
+  session.consume(stream2);
+  CHECK(countTags(stream2, binlog::DroppedEvents::Tag) == 1);
+  CHECK(countTags(stream2, binlog::WriterProp::Tag) == 1);
+}
+
+TEST_CASE("overflow_policy_spin")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 128);
+  writer.setOverflowPolicy(binlog::SessionWriter::OverflowPolicy::spin, 16);
+
+  binlog::EventSource eventSource{
+    0, binlog::Severity::info, "cat", "fun", "file", 123, "a={}", "i"
+  };
+  eventSource.id = session.addEventSource(eventSource);
+
+  for (int i = 0; i < 5; ++i)
+  {
+    CHECK(writer.addEvent(eventSource.id, 0, i));
+  }
+  CHECK(! writer.addEvent(eventSource.id, 0, 5)); // no consumer, spinning fails
+
+  TestStream stream;
+  session.consume(stream);
+  CHECK(countTags(stream, binlog::DroppedEvents::Tag) == 1);
+}
+
+TEST_CASE("overflow_policy_block")
+{
+  binlog::Session session;
+
+  binlog::EventSource eventSource{
+    0, binlog::Severity::info, "cat", "fun", "file", 123, "a={}", "i"
+  };
+  eventSource.id = session.addEventSource(eventSource);
+
+  std::atomic<bool> write_done{false};
+  std::thread producer([&session, &eventSource, &write_done]()
+  {
+    binlog::SessionWriter writer(session, 128);
+    writer.setOverflowPolicy(binlog::SessionWriter::OverflowPolicy::block);
+    for (int i = 0; i < 1000; ++i)
+    {
+      if (! writer.addEvent(eventSource.id, 0, i)) { break; }
+    }
+    write_done.store(true);
+  });
+
+  TestStream stream;
+  while (! write_done.load())
+  {
+    session.consume(stream);
+  }
+  producer.join();
+  session.consume(stream);
+
+  const std::vector<std::string> events = streamToEvents(stream, "%m");
+  CHECK(events.size() == 1000);
+  CHECK(events.back() == "a=999");
+  CHECK(countTags(stream, binlog::DroppedEvents::Tag) == 0);
+}
+
+TEST_CASE("batch_commits_at_end")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 1024);
+
+  binlog::EventSource eventSource{
+    0, binlog::Severity::info, "cat", "fun", "file", 123, "a={}", "i"
+  };
+  eventSource.id = session.addEventSource(eventSource);
+
+  TestStream stream;
+  session.consume(stream); // consume metadata
+
+  {
+    auto batch = writer.beginBatch(3 * 24);
+    CHECK(writer.addEvent(eventSource.id, 0, 1));
+    CHECK(writer.addEvent(eventSource.id, 0, 2));
+
+    {
+      auto nested = writer.beginBatch();
+      CHECK(writer.addEvent(eventSource.id, 0, 3));
+    }
+
+    // not committed yet
+    CHECK(session.consume(stream).bytesConsumed == 0);
+  }
+
+  CHECK(session.consume(stream).bytesConsumed != 0);
+
+  // no batch, commit immediately
+  CHECK(writer.addEvent(eventSource.id, 0, 4));
+  session.consume(stream);
+
+  CHECK(streamToEvents(stream, "%m") == std::vector<std::string>{"a=1", "a=2", "a=3", "a=4"});
+}
+
+TEST_CASE("batch_larger_than_queue")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 128);
+
+  binlog::EventSource eventSource{
+    0, binlog::Severity::info, "cat", "fun", "file", 123, "a={}", "i"
+  };
+  eventSource.id = session.addEventSource(eventSource);
+
+  // each event is 24 bytes, the queue is replaced while the batch is alive:
+  // events of the batch are committed in parts, none is lost
+  std::vector<std::string> expectedEvents;
+  {
+    auto batch = writer.beginBatch();
+    for (int i = 0; i < 20; ++i)
+    {
+      CHECK(writer.addEvent(eventSource.id, 0, i));
+      expectedEvents.push_back("a=" + std::to_string(i));
+    }
+  }
+
+  CHECK(getEvents(session, "%m") == expectedEvents);
+}
+
+TEST_CASE("batch_overflow")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 128);
+  writer.setOverflowPolicy(binlog::SessionWriter::OverflowPolicy::drop);
+
+  binlog::EventSource eventSource{
+    0, binlog::Severity::info, "cat", "fun", "file", 123, "a={}", "i"
+  };
+  eventSource.id = session.addEventSource(eventSource);
+
+  TestStream stream;
+  session.consume(stream); // consume metadata
+
+  {
+    auto batch = writer.beginBatch();
+
+    // each event is 24 bytes, 5 fits into the queue
+    for (int i = 0; i < 5; ++i)
+    {
+      CHECK(writer.addEvent(eventSource.id, 0, i));
+    }
+    CHECK(session.consume(stream).bytesConsumed == 0);
+
+    // the batch is committed before the overflow is handled
+    CHECK(! writer.addEvent(eventSource.id, 0, 5));
+    CHECK(session.consume(stream).bytesConsumed != 0);
+
+    // consumer made space
+    CHECK(writer.addEvent(eventSource.id, 0, 6));
+  }
+
+  session.consume(stream);
+  CHECK(streamToEvents(stream, "%m") == std::vector<std::string>{"a=0", "a=1", "a=2", "a=3", "a=4", "a=6"});
+}
+
+TEST_CASE("consume_in_place")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer1(session, 128, 1, "W1");
+  binlog::SessionWriter writer2(session, 128, 2, "W2");
+
+  binlog::EventSource eventSource{
+    0, binlog::Severity::info, "cat", "fun", "file", 123, "a={}", "i"
+  };
+  eventSource.id = session.addEventSource(eventSource);
+
+  CHECK(writer1.addEvent(eventSource.id, 0, 1));
+  CHECK(writer1.addEvent(eventSource.id, 0, 2));
+  CHECK(writer2.addEvent(eventSource.id, 0, 3));
+
+  // frame the data as consume does
+  TestStream stream;
+  std::vector<std::string> names;
+  const binlog::Session::ConsumeResult cr = session.consumeInPlace(stream,
+    [&stream, &names](const binlog::Session::ChannelData& data)
+    {
+      CHECK(data.writerProp->batchSize == data.size());
+      CHECK(data.droppedEventCount == 0);
+      names.push_back(data.writerProp->name);
+      binlog::serializeSizePrefixedTagged(*data.writerProp, stream);
+      stream.write(data.buffer1, std::streamsize(data.size1));
+      stream.write(data.buffer2, std::streamsize(data.size2));
+    }
+  );
+
+  CHECK(cr.channelsPolled == 2);
+  CHECK(names == std::vector<std::string>{"W1", "W2"});
+  CHECK(streamToEvents(stream, "%n %m") == std::vector<std::string>{"W1 a=1", "W1 a=2", "W2 a=3"});
+
+  // the data is released
+  int calls = 0;
+  TestStream stream2;
+  session.consumeInPlace(stream2, [&calls](const binlog::Session::ChannelData&) { ++calls; });
+  CHECK(calls == 0);
+  CHECK(stream2.buffer.empty());
+}
+
+TEST_CASE("consume_in_place_throw")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 128, 7, "Seven");
+  writer.setOverflowPolicy(binlog::SessionWriter::OverflowPolicy::drop);
+
+  binlog::EventSource eventSource{
+    0, binlog::Severity::info, "cat", "fun", "file", 123, "a={}", "i"
+  };
+  eventSource.id = session.addEventSource(eventSource);
+
+  CHECK(writer.addEvent(eventSource.id, 0, 1));
+  CHECK(! writer.addEvent(eventSource.id, 0, std::vector<int>(100)));
+
+  // a throwing callback does not commit the read
+  TestStream metadata;
+  CHECK_THROWS_AS(
+    session.consumeInPlace(metadata, [](const binlog::Session::ChannelData&) { throw std::runtime_error("busy"); }),
+    std::runtime_error
+  );
+  CHECK(! metadata.buffer.empty());
+
+  std::size_t size = 0;
+  std::uint64_t dropped = 0;
+  session.consumeInPlace(metadata, [&](const binlog::Session::ChannelData& data)
+  {
+    size += data.size();
+    dropped += data.droppedEventCount;
+  });
+  CHECK(size == 24); // 4+8+8+4
+  CHECK(dropped == 1);
+}
+
+TEST_CASE("flight_recorder")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 128);
+  writer.setFlightRecorder(true, binlog::Severity::no_logs);
+
+  binlog::EventSource eventSource{
+    0, binlog::Severity::info, "cat", "fun", "file", 123, "a={}", "i"
+  };
+  eventSource.id = session.addEventSource(eventSource);
+
+  // each event is 4+8+8+4 = 24 bytes, at most 5 fits into the queue
+  for (int i = 0; i < 100; ++i)
+  {
+    CHECK(writer.addEvent(eventSource.id, 0, i));
+  }
+
+  // consume to the same stream, to keep the metadata, return the new events only
+  TestStream stream;
+  std::size_t eventCount = 0;
+  const auto consumeEvents = [&]()
+  {
+    session.consume(stream);
+    stream.readPos = 0;
+    std::vector<std::string> events = streamToEvents(stream, "%m");
+    events.erase(events.begin(), events.begin() + std::ptrdiff_t(eventCount));
+    eventCount += events.size();
+    return events;
+  };
+
+  // not triggered, not consumed
+  CHECK(consumeEvents().empty());
+
+  // the most recent events are kept
+  session.triggerFlightRecorder();
+  const std::vector<std::string> events = consumeEvents();
+  REQUIRE(events.size() >= 2);
+  for (std::size_t i = 0; i < events.size(); ++i)
+  {
+    CHECK(events[i] == "a=" + std::to_string(100 - events.size() + i));
+  }
+
+  // a trigger consumes once
+  CHECK(writer.addEvent(eventSource.id, 0, 100));
+  CHECK(consumeEvents().empty());
+  session.triggerFlightRecorder();
+  CHECK(consumeEvents() == std::vector<std::string>{"a=100"});
+
+  // back to normal
+  writer.setFlightRecorder(false);
+  CHECK(writer.addEvent(eventSource.id, 0, 101));
+  CHECK(consumeEvents() == std::vector<std::string>{"a=101"});
+}
+
+TEST_CASE("flight_recorder_history")
+{
+  // the codec reverses the segments: the history must be decoded to be readable
+  binlog::Session session;
+  const auto reverse = [](const char* data, std::size_t size, std::vector<char>& out)
+  {
+    out.insert(out.end(), std::reverse_iterator<const char*>(data + size), std::reverse_iterator<const char*>(data));
+  };
+  session.setFlightRecorderHistory({1000, reverse, reverse});
+
+  binlog::SessionWriter writer(session, 128);
+  writer.setFlightRecorder(true, binlog::Severity::no_logs);
+
+  binlog::EventSource eventSource{
+    0, binlog::Severity::info, "cat", "fun", "file", 123, "a={}", "i"
+  };
+  eventSource.id = session.addEventSource(eventSource);
+
+  // each event is 4+8+8+4 = 24 bytes, at most 5 fits into the queue,
+  // but the consumer moves them to the history, before they are overwritten
+  TestStream stream;
+  for (int i = 0; i < 100; ++i)
+  {
+    CHECK(writer.addEvent(eventSource.id, 0, i));
+    session.consume(stream);
+  }
+
+  // not triggered, not consumed
+  CHECK(streamToEvents(stream, "%m").empty());
+
+  // the history holds at most 1000 bytes of segments, a segment is
+  // a WriterProp (32 bytes) and 3 events: 9 segments, and the queue
+  session.triggerFlightRecorder();
+  stream.readPos = 0;
+  session.consume(stream);
+  const std::vector<std::string> events = streamToEvents(stream, "%m");
+  CHECK(events.size() > 20);
+  CHECK(events.size() < 30);
+  for (std::size_t i = 0; i < events.size(); ++i)
+  {
+    CHECK(events[i] == "a=" + std::to_string(100 - events.size() + i));
+  }
+
+  // the history is consumed once
+  CHECK(writer.addEvent(eventSource.id, 0, 100));
+  session.triggerFlightRecorder();
+  stream.readPos = 0;
+  session.consume(stream);
+  const std::vector<std::string> allEvents = streamToEvents(stream, "%m");
+  REQUIRE(allEvents.size() == events.size() + 1);
+  CHECK(allEvents.back() == "a=100");
+}
+
+TEST_CASE("flight_recorder_severity_trigger")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 128);
+  writer.setFlightRecorder(true);
+
+  bool wokenUp = false;
+  session.setConsumerWakeup([&wokenUp]() { wokenUp = true; });
+
+  binlog::EventSource info{
+    0, binlog::Severity::info, "cat", "fun", "file", 123, "info {}", "i"
+  };
+  info.id = session.addEventSource(info);
+
+  binlog::EventSource error{
+    0, binlog::Severity::error, "cat", "fun", "file", 123, "error {}", "i"
+  };
+  error.id = session.addEventSource(error);
+
+  CHECK(writer.addEvent(info.id, 0, 1));
+  CHECK(writer.addEvent(info.id, 0, 2));
+  TestStream stream;
+  session.consume(stream);
+  CHECK(streamToEvents(stream, "%m").empty());
+  CHECK(! wokenUp);
+
+  CHECK(writer.addEvent(error.id, 0, 3));
+  CHECK(wokenUp);
+  stream.readPos = 0;
+  session.consume(stream);
+  CHECK(streamToEvents(stream, "%m") == std::vector<std::string>{"info 1", "info 2", "error 3"});
+}
+
+TEST_CASE("flight_recorder_concurrent_dump")
+{
+  binlog::Session session;
+
+  binlog::EventSource eventSource{
+    0, binlog::Severity::info, "cat", "fun", "file", 123, "{}", "i"
+  };
+  eventSource.id = session.addEventSource(eventSource);
+
+  // producer states: 0: writing, 1: done, 2: final event added
+  std::atomic<int> state{0};
+  std::atomic<bool> stop{false};
+  std::thread producer([&session, &eventSource, &state, &stop]()
+  {
+    binlog::SessionWriter writer(session, 256);
+    writer.setFlightRecorder(true, binlog::Severity::no_logs);
+    for (int i = 0; i < 100000; ++i)
+    {
+      writer.addEvent(eventSource.id, 0, i);
+    }
+    state = 1;
+
+    // events added while the queue is read might be dropped,
+    // add the final one when no dump is in progress
+    while (! stop) { std::this_thread::yield(); }
+    writer.addEvent(eventSource.id, 0, 100000);
+    state = 2;
+    while (stop) { std::this_thread::yield(); } // keep the writer alive until the last dump
+  });
+
+  TestStream stream;
+  bool finished = false;
+  while (! finished)
+  {
+    finished = (state == 1);
+    session.triggerFlightRecorder();
+    session.consume(stream);
+  }
+
+  stop = true;
+  while (state != 2) { std::this_thread::yield(); }
+  session.triggerFlightRecorder();
+  session.consume(stream);
+  stop = false;
+  producer.join();
+
+  // the dumped events must be intact, and increasing
+  int last = -1;
+  for (const std::string& event : streamToEvents(stream, "%m"))
+  {
+    const int value = std::stoi(event);
+    if (value <= last) { FAIL("Unexpected event order: ", last, " ", value); }
+    last = value;
+  }
+  CHECK(last == 100000);
 }
@@ -0,0 +1,81 @@
+#include <binlog/ShardedFileSink.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/advanced_log_macros.hpp>
+
+#include <doctest/doctest.h>
+
+#include <cstdio> // remove
+#include <fstream>
+#include <ios>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<std::string> readEvents(const std::string& path)
+{
+  std::ifstream file(path, std::ios_base::in | std::ios_base::binary);
+  const std::string content{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+
+  TestStream stream;
+  stream.write(content.data(), std::streamsize(content.size()));
+  return streamToEvents(stream, "%n %m");
+}
+
+} // namespace
+
+TEST_CASE("shard_path")
+{
+  CHECK(binlog::ShardedFileSink::shardPath("logfile.blog", 3) == "logfile-3.blog");
+  CHECK(binlog::ShardedFileSink::shardPath("dir/logfile", 0) == "dir/logfile-0");
+  CHECK(binlog::ShardedFileSink::shardPath("dir.d/logfile", 1) == "dir.d/logfile-1");
+  CHECK(binlog::ShardedFileSink::shardPath(".blog", 2) == ".blog-2");
+}
+
+TEST_CASE("sharded_file_sink")
+{
+  const std::string path = "binlog_test_sharded_sink.blog";
+
+  binlog::Session session;
+  binlog::SessionWriter w0(session, 512, 0, "w0");
+  binlog::SessionWriter w1(session, 512, 0, "w1");
+  binlog::SessionWriter w2(session, 512, 0, "w2");
+
+  {
+    binlog::ShardedFileSink sink(path, 2);
+    CHECK(sink.shardCount() == 2);
+
+    for (int i = 0; i < 3; ++i)
+    {
+      BINLOG_INFO_W(w0, "a {}", i);
+      BINLOG_INFO_W(w1, "b {}", i);
+      BINLOG_INFO_W(w2, "c {}", i);
+      const binlog::Session::ConsumeResult result = sink.consume(session);
+      CHECK(result.channelsPolled == 3);
+      CHECK(result.totalBytesConsumed > 0);
+    }
+
+    sink.close();
+  }
+
+  // each file has every event of its writers, and the metadata to read them
+  const std::vector<std::string> shard0 = readEvents(binlog::ShardedFileSink::shardPath(path, 0));
+  const std::vector<std::string> shard1 = readEvents(binlog::ShardedFileSink::shardPath(path, 1));
+
+  CHECK(shard0 == std::vector<std::string>{"w0 a 0", "w2 c 0", "w0 a 1", "w2 c 1", "w0 a 2", "w2 c 2"});
+  CHECK(shard1 == std::vector<std::string>{"w1 b 0", "w1 b 1", "w1 b 2"});
+
+  (void)std::remove(binlog::ShardedFileSink::shardPath(path, 0).data());
+  (void)std::remove(binlog::ShardedFileSink::shardPath(path, 1).data());
+}
+
+TEST_CASE("sharded_file_sink_invalid")
+{
+  CHECK_THROWS_AS(binlog::ShardedFileSink("binlog_test_sharded_sink_invalid.blog", 0), std::runtime_error);
+}
@@ -0,0 +1,133 @@
+#include <binlog/SharedMemoryStream.hpp>
+
+#ifndef _WIN32
+
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+
+#include "test_utils.hpp"
+
+#include <doctest/doctest.h>
+
+#include <algorithm> // min
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h> // NOLINT getpid
+
+namespace {
+
+std::string segmentName(const char* test)
+{
+  return "/binlog_test_" + std::to_string(getpid()) + "_" + test;
+}
+
+} // namespace
+
+TEST_CASE("write_and_read")
+{
+  const std::string name = segmentName("write_and_read");
+  binlog::SharedMemoryOutputStream out(name, 64);
+  CHECK(out.capacity() == 64);
+
+  binlog::SharedMemoryInputStream in(name);
+  CHECK(! in.writerClosed());
+
+  TestStream stream;
+  CHECK(in.consume(stream) == 0);
+
+  out.write("foo", 3);
+  out.write("bar", 3);
+  CHECK(in.consume(stream) == 6);
+  CHECK(std::string(stream.buffer.begin(), stream.buffer.end()) == "foobar");
+
+  in.unlink();
+}
+
+TEST_CASE("open_missing")
+{
+  CHECK_THROWS_AS(binlog::SharedMemoryInputStream(segmentName("open_missing")), std::runtime_error);
+}
+
+TEST_CASE("writer_closed")
+{
+  const std::string name = segmentName("writer_closed");
+
+  std::unique_ptr<binlog::SharedMemoryOutputStream> out(new binlog::SharedMemoryOutputStream(name, 16));
+  out->write("last words", 10);
+  out.reset();
+
+  // the data survives the writer
+  binlog::SharedMemoryInputStream in(name);
+  CHECK(in.writerClosed());
+
+  TestStream stream;
+  CHECK(in.consume(stream) == 10);
+  CHECK(std::string(stream.buffer.begin(), stream.buffer.end()) == "last words");
+
+  in.unlink();
+  CHECK_THROWS_AS(binlog::SharedMemoryInputStream{name}, std::runtime_error);
+}
+
+TEST_CASE("wrap_around_with_concurrent_reader")
+{
+  const std::string name = segmentName("wrap_around");
+  binlog::SharedMemoryOutputStream out(name, 37); // not a divisor of the written sizes
+  binlog::SharedMemoryInputStream in(name);
+
+  std::string expected;
+  for (int i = 0; i < 1000; ++i)
+  {
+    expected += std::to_string(i) + ",";
+  }
+
+  TestStream stream;
+  std::thread reader([&]() {
+    while (stream.buffer.size() < expected.size())
+    {
+      if (in.consume(stream) == 0) { std::this_thread::yield(); }
+    }
+  });
+
+  // writes larger than the capacity block until the reader makes space
+  for (std::size_t i = 0; i < expected.size(); i += 50)
+  {
+    const std::size_t size = (std::min)(std::size_t(50), expected.size() - i);
+    out.write(expected.data() + i, std::streamsize(size));
+  }
+
+  reader.join();
+  CHECK(std::string(stream.buffer.begin(), stream.buffer.end()) == expected);
+
+  in.unlink();
+}
+
+TEST_CASE("consume_session")
+{
+  const std::string name = segmentName("consume_session");
+  binlog::SharedMemoryOutputStream out(name, 4096);
+
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 128, 1, "W1");
+
+  binlog::EventSource eventSource{
+    0, binlog::Severity::info, "cat", "fun", "file", 123, "a={}", "i"
+  };
+  eventSource.id = session.addEventSource(eventSource);
+  CHECK(writer.addEvent(eventSource.id, 0, 1));
+  CHECK(writer.addEvent(eventSource.id, 0, 2));
+  session.consume(out);
+
+  binlog::SharedMemoryInputStream in(name);
+  TestStream stream;
+  in.consume(stream);
+  CHECK(streamToEvents(stream, "%n %m") == std::vector<std::string>{"W1 a=1", "W1 a=2"});
+
+  in.unlink();
+}
+
+#endif // _WIN32
@@ -0,0 +1,91 @@
+#include <binlog/SharedWriter.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/EventStream.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/advanced_log_macros.hpp>
+
+#include <doctest/doctest.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE("shared_writer_add_event")
+{
+  binlog::Session session;
+  binlog::SharedWriter writer(session, 128, 7, "shared");
+
+  BINLOG_INFO_W(writer, "Hello {} {}", 1, std::string("foo"));
+  CHECK(getEvents(session, "%t %n %m") == std::vector<std::string>{"7 shared Hello 1 foo"});
+}
+
+TEST_CASE("shared_writer_drops_if_full")
+{
+  binlog::Session session;
+  binlog::SharedWriter writer(session, 128);
+
+  binlog::EventSource eventSource{
+    0, binlog::Severity::info, "cat", "fun", "file", 123, "a={}", "i"
+  };
+  eventSource.id = session.addEventSource(eventSource);
+
+  // each event takes 4+8+8+4 = 24 bytes
+  std::size_t added = 0;
+  for (int i = 0; i < 10; ++i)
+  {
+    if (writer.addEvent(eventSource.id, 0, i)) { ++added; }
+  }
+  CHECK(added == 5);
+
+  TestStream stream;
+  session.consume(stream);
+
+  binlog::EventStream eventStream;
+  std::size_t eventCount = 0;
+  while (eventStream.nextEvent(stream) != nullptr) { ++eventCount; }
+  CHECK(eventCount == 5);
+  CHECK(eventStream.droppedEventCount() == 5);
+}
+
+TEST_CASE("shared_writer_many_threads")
+{
+  binlog::Session session;
+  binlog::SharedWriter writer(session, 4096);
+
+  const int threadCount = 4;
+  const int eventCount = 1000;
+
+  TestStream stream;
+  std::atomic<int> running{threadCount};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < threadCount; ++t)
+  {
+    threads.emplace_back([&writer, &running, t]()
+    {
+      for (int i = 0; i < eventCount; ++i)
+      {
+        BINLOG_INFO_W(writer, "{} {}", t, i);
+      }
+      running.fetch_sub(1);
+    });
+  }
+
+  // consume concurrently, the queue is too small to hold every event
+  while (running.load() != 0) { session.consume(stream); }
+  for (std::thread& thread : threads) { thread.join(); }
+  session.consume(stream);
+
+  // some events might be dropped, but the others are intact
+  std::vector<std::string> events = streamToEvents(stream, "%m");
+  CHECK(! events.empty());
+  for (const std::string& event : events)
+  {
+    const std::size_t space = event.find(' ');
+    REQUIRE(space != std::string::npos);
+    CHECK(std::stoi(event.substr(0, space)) < threadCount);
+    CHECK(std::stoi(event.substr(space + 1)) < eventCount);
+  }
+}
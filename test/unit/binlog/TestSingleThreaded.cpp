@@ -0,0 +1,58 @@
+// Compiled with BINLOG_SINGLE_THREADED defined for the whole test executable
+
+#include <binlog/advanced_log_macros.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/detail/Concurrency.hpp>
+
+#include <doctest/doctest.h>
+
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#ifndef BINLOG_SINGLE_THREADED
+  #error "BINLOG_SINGLE_THREADED must be defined"
+#endif
+
+static_assert(std::is_same<binlog::detail::Mutex, binlog::detail::NullMutex>::value, "");
+
+TEST_CASE("write_and_consume_on_the_same_thread")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096, 1, "W");
+
+  std::vector<std::string> expected;
+  TestStream stream;
+  for (int i = 0; i < 100; ++i)
+  {
+    BINLOG_INFO_W(writer, "Hello {}", i);
+    expected.push_back("W Hello " + std::to_string(i));
+    if (i % 7 == 0) { session.consume(stream); }
+  }
+  session.consume(stream);
+
+  CHECK(streamToEvents(stream, "%n %m") == expected);
+}
+
+TEST_CASE("queue_wraps_around")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 256);
+  writer.setOverflowPolicy(binlog::SessionWriter::OverflowPolicy::drop);
+
+  TestStream stream;
+  std::vector<std::string> expected;
+  for (int i = 0; i < 1000; ++i)
+  {
+    BINLOG_INFO_W(writer, "{}", std::string(std::size_t(i % 30), 'x'));
+    expected.push_back(std::string(std::size_t(i % 30), 'x'));
+    session.consume(stream);
+  }
+
+  CHECK(streamToEvents(stream, "%m") == expected);
+  CHECK(session.metrics().droppedEventCount == 0);
+}
@@ -0,0 +1,136 @@
+#include <binlog/Stacktrace.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/Address.hpp>
+#include <binlog/EventStream.hpp>
+#include <binlog/PrettyPrinter.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/advanced_log_macros.hpp>
+#include <binlog/detail/ModuleMap.hpp>
+
+#include <mserialize/tag.hpp>
+
+#include <doctest/doctest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__GNUC__)
+  #define TEST_NOINLINE __attribute__((noinline))
+#else
+  #define TEST_NOINLINE
+#endif
+
+TEST_NOINLINE binlog::Stacktrace binlogTestCaptureStacktrace()
+{
+  binlog::Stacktrace result = binlog::stacktrace();
+  asm volatile("" ::: "memory"); // NOLINT prevent tail call
+  return result;
+}
+
+TEST_CASE("stacktrace_tag")
+{
+  CHECK(mserialize::tag<binlog::Stacktrace>() == mserialize::tag<binlog::StacktraceView>());
+}
+
+#ifdef BINLOG_DETAIL_HAS_UNWIND
+
+TEST_CASE("capture")
+{
+  const binlog::Stacktrace trace = binlogTestCaptureStacktrace();
+  CHECK(trace.size > 1);
+  CHECK(trace.size <= std::size_t{binlog::Stacktrace::maxDepth});
+
+  const binlog::Stacktrace skipped = binlog::stacktrace(1);
+  CHECK(skipped.size < std::size_t{binlog::Stacktrace::maxDepth});
+}
+
+#endif
+
+#ifdef __linux__
+
+TEST_CASE("symbolize")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+
+  BINLOG_INFO_W(writer, "Trace: {}", binlogTestCaptureStacktrace());
+  BINLOG_INFO_W(writer, "Trace: {}", binlogTestCaptureStacktrace()); // module map interned once
+
+  TestStream stream;
+  session.consume(stream);
+
+  CHECK(countTags(stream, binlog::InternedString::Tag) == 1);
+
+  const std::vector<std::string> events = streamToEvents(stream, "%m");
+  REQUIRE(events.size() == 2);
+  for (const std::string& event : events)
+  {
+    CAPTURE(event);
+    CHECK(event.find("Trace: [binlogTestCaptureStacktrace()+0x") == 0);
+    CHECK(event.find(" (UnitTest+0x") != std::string::npos);
+  }
+}
+
+TEST_CASE("address_module")
+{
+  // the load address of the test executable
+  const std::string modules = binlog::detail::loadedModules();
+  const std::size_t line = modules.rfind('\n', modules.find("UnitTest"));
+  std::istringstream fields(modules.substr(line + 1)); // npos + 1 == 0
+  std::uint64_t begin = 0, end = 0, base = 0; // NOLINT(readability-isolate-declaration)
+  fields >> std::hex >> begin >> end >> base;
+
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+  const auto fptr = &binlogTestCaptureStacktrace;
+  BINLOG_INFO_W(writer, "Handler: {}", binlog::address(reinterpret_cast<void*>(fptr))); // NOLINT
+  BINLOG_INFO_W(writer, "Unknown: {}", binlog::address(reinterpret_cast<void*>(0x123))); // NOLINT
+
+  TestStream stream;
+  session.consume(stream);
+
+  binlog::EventStream eventStream;
+  binlog::PrettyPrinter pp("%m\n", "");
+  pp.addAddressModule("/proc/self/exe", base);
+
+  std::ostringstream out;
+  while (const binlog::Event* event = eventStream.nextEvent(stream))
+  {
+    pp.printEvent(out, *event);
+  }
+
+  const std::string text = out.str();
+  CAPTURE(text);
+  CHECK(text.find(" (binlogTestCaptureStacktrace()+0x0)\n") != std::string::npos);
+  CHECK(text.find("Unknown: 0x123\n") != std::string::npos);
+}
+
+TEST_CASE("loaded_modules")
+{
+  const std::string modules = binlog::detail::loadedModules();
+  CHECK(modules.find("UnitTest") != std::string::npos);
+  CHECK(binlog::detail::moduleGeneration() != 0);
+}
+
+#endif
+
+TEST_CASE("without_modules")
+{
+  binlog::Stacktrace trace;
+  trace.size = 2;
+  trace.frames[0] = 0x123;
+  trace.frames[1] = 0xabc;
+
+  // frames outside of the loaded modules are shown as addresses
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+  BINLOG_INFO_W(writer, "Trace: {}", trace);
+
+  CHECK(getEvents(session, "%m") == std::vector<std::string>{"Trace: [0x123, 0xABC]"});
+}
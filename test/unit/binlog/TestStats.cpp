@@ -0,0 +1,101 @@
+#include <stats.hpp>
+
+#include <binlog/EntryStream.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/advanced_log_macros.hpp>
+
+#include <doctest/doctest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <sstream>
+#include <string>
+
+namespace {
+
+void logClock(binlog::SessionWriter& writer, std::uint64_t clock)
+{
+  BINLOG_CREATE_SOURCE_AND_EVENT(writer, binlog::Severity::info, main, clock, "{}", clock);
+}
+
+} // namespace
+
+TEST_CASE("collect_statistics")
+{
+  binlog::Session session;
+  session.setClockSync(binlog::ClockSync{0, 1000000000, 0, 0, "UTC"});
+  binlog::SessionWriter writer(session, 4096, 1, "A");
+  binlog::SessionWriter writer2(session, 4096, 2, "B");
+
+  // clock ticks in nanoseconds, events at 0.5s, 1.5s, 1.6s, 2.5s
+  logClock(writer, 500000000);
+  logClock(writer, 1500000000);
+  logClock(writer2, 1600000000);
+  BINLOG_CREATE_SOURCE_AND_EVENT(writer2, binlog::Severity::warning, orders, 2500000000, "{} {}", std::string("abc"), 'x');
+
+  std::stringstream logfile;
+  session.consume(logfile);
+  const std::uint64_t logfileSize = std::uint64_t(logfile.str().size());
+
+  binlog::IstreamEntryStream entryStream(logfile);
+  const Statistics stats = collectStatistics(entryStream, std::chrono::seconds{1});
+
+  CHECK(stats.eventCount == 4);
+  CHECK(stats.byteCount == 3 * 8 + 4 + 3 + 1);
+  CHECK(stats.entryByteCount == logfileSize);
+  CHECK(stats.untimedEventCount == 0);
+
+  REQUIRE(stats.sources.size() == 2);
+  CHECK(stats.sources[0].eventCount == 3);
+  CHECK(stats.sources[0].byteCount == 3 * 8);
+  CHECK(stats.sources[0].severity == "INFO");
+  CHECK(stats.sources[1].eventCount == 1);
+  CHECK(stats.sources[1].byteCount == 8);
+  CHECK(stats.sources[1].category == "orders");
+  CHECK(stats.sources[1].formatString == "{} {}");
+
+  REQUIRE(stats.writers.size() == 2);
+  CHECK(stats.writers[0].name == "A");
+  CHECK(stats.writers[0].eventCount == 2);
+  CHECK(stats.writers[1].name == "B");
+  CHECK(stats.writers[1].eventCount == 2);
+  CHECK(stats.writers[1].byteCount == 16);
+
+  const std::map<std::int64_t, std::uint64_t> expectedRate{
+    {0, 1}, {1000000000, 2}, {2000000000, 1},
+  };
+  CHECK(stats.rate == expectedRate);
+
+  std::ostringstream output;
+  printStatistics(stats, output, 1, std::chrono::seconds{1});
+  const std::string text = output.str();
+  CHECK(text.find("Events: 4, argument bytes: 32") == 0);
+  CHECK(text.find("1970-01-01 00:00:01Z           2\n") != std::string::npos);
+  CHECK(text.find("orders") == std::string::npos); // only the top source is shown
+}
+
+TEST_CASE("collect_statistics_concatenated")
+{
+  // the same source ids are assigned by both sessions to different sources
+  std::stringstream logfile;
+  for (int i = 0; i < 2; ++i)
+  {
+    binlog::Session session;
+    binlog::SessionWriter writer(session, 4096);
+    if (i == 0) { BINLOG_INFO_W(writer, "First {}", 1); }
+    else { for (int j = 0; j < 2; ++j) { BINLOG_INFO_W(writer, "Second {}", j); } }
+    session.consume(logfile);
+  }
+
+  binlog::IstreamEntryStream entryStream(logfile);
+  const Statistics stats = collectStatistics(entryStream, std::chrono::seconds{1});
+
+  REQUIRE(stats.sources.size() == 2);
+  CHECK(stats.sources[0].id == stats.sources[1].id);
+  CHECK(stats.sources[0].formatString == "First {}");
+  CHECK(stats.sources[0].eventCount == 1);
+  CHECK(stats.sources[1].formatString == "Second {}");
+  CHECK(stats.sources[1].eventCount == 2);
+}
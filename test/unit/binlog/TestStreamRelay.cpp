@@ -0,0 +1,109 @@
+#include <binlog/StreamRelay.hpp>
+
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/advanced_log_macros.hpp>
+
+#include "test_utils.hpp"
+
+#include <doctest/doctest.h>
+
+#include <algorithm> // min
+#include <cstddef>
+#include <cstdint>
+#include <cstring> // memcpy
+#include <string>
+#include <vector>
+
+namespace {
+
+/** @returns the consumed stream of a child process */
+TestStream makeChildStream()
+{
+  binlog::Session child;
+  binlog::SessionWriter w1(child, 4096, 1, "w1");
+  binlog::SessionWriter w2(child, 4096, 2, "w2");
+  const std::uint64_t a = addEventSource<int, std::string>(child, binlog::Severity::info, "net", "a {} {}");
+  const std::uint64_t b = addEventSource<double>(child, binlog::Severity::warning, "main", "b {}");
+
+  CHECK(w1.addEvent(a, 0, 1, std::string("x")));
+  CHECK(w2.addEvent(b, 0, 2.5));
+  CHECK(w1.addEvent(a, 0, 3, std::string("yz")));
+
+  TestStream stream;
+  child.consume(stream);
+  return stream;
+}
+
+} // namespace
+
+TEST_CASE("relay_injects_events")
+{
+  const TestStream child = makeChildStream();
+
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096, 0, "parent");
+  BINLOG_INFO_W(writer, "p {}", 0);
+  CHECK(getEvents(session, "%n %S %C %m") == std::vector<std::string>{"parent INFO main p 0"});
+
+  binlog::StreamRelay relay(session, "child/");
+  relay.write(child.buffer.data(), std::streamsize(child.buffer.size()));
+  CHECK(relay.injectedEvents() == 3);
+  CHECK(relay.droppedEvents() == 0);
+
+  CHECK(getEvents(session, "%n %S %C %m") == std::vector<std::string>{
+    "child/w1 INFO net a 1 x",
+    "child/w1 INFO net a 3 yz",
+    "child/w2 WARN main b 2.5",
+  });
+
+  // the sources of the parent are not affected
+  BINLOG_INFO_W(writer, "p {}", 1);
+  CHECK(getEvents(session, "%n %m") == std::vector<std::string>{"parent p 1"});
+}
+
+TEST_CASE("relay_partial_writes")
+{
+  const TestStream child = makeChildStream();
+
+  for (std::size_t chunkSize : {std::size_t(1), std::size_t(3), std::size_t(7), std::size_t(100)})
+  {
+    binlog::Session session;
+    binlog::StreamRelay relay(session, "");
+
+    for (std::size_t i = 0; i < child.buffer.size(); i += chunkSize)
+    {
+      const std::size_t n = (std::min)(chunkSize, child.buffer.size() - i);
+      relay.write(child.buffer.data() + i, std::streamsize(n));
+    }
+
+    CHECK(relay.injectedEvents() == 3);
+    CHECK(getEvents(session, "%n %m") == std::vector<std::string>{
+      "w1 a 1 x", "w1 a 3 yz", "w2 b 2.5",
+    });
+  }
+}
+
+TEST_CASE("relay_drops_events_of_unknown_sources")
+{
+  const TestStream child = makeChildStream();
+
+  // skip the sources of the child
+  binlog::Session session;
+  binlog::StreamRelay relay(session, "");
+  std::size_t pos = 0;
+  while (true)
+  {
+    std::uint32_t size = 0;
+    std::uint64_t tag = 0;
+    memcpy(&size, child.buffer.data() + pos, sizeof(size));
+    memcpy(&tag, child.buffer.data() + pos + sizeof(size), sizeof(tag));
+    if (tag != binlog::EventSource::Tag && tag != binlog::ClockSync::Tag) { break; }
+    pos += sizeof(size) + size;
+  }
+  relay.write(child.buffer.data() + pos, std::streamsize(child.buffer.size() - pos));
+
+  CHECK(relay.injectedEvents() == 0);
+  CHECK(relay.droppedEvents() == 3);
+  CHECK(getEvents(session, "%m").empty());
+}
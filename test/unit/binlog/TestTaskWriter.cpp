@@ -0,0 +1,39 @@
+#include <binlog/TaskWriter.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/advanced_log_macros.hpp>
+
+#include <doctest/doctest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE("task_writer_migrates_between_threads")
+{
+  binlog::Session session;
+  const binlog::WriterProp context{42, "task", 0};
+
+  // the task runs on two threads, using the writer of each
+  auto runTaskPart = [&session, &context](const char* threadName, int i)
+  {
+    binlog::SessionWriter threadWriter(session, 128, 0, threadName);
+    BINLOG_INFO_W(threadWriter, "thread event");
+
+    binlog::TaskWriter writer(threadWriter, context);
+    BINLOG_INFO_W(writer, "task event {}", i);
+  };
+
+  std::thread t1(runTaskPart, "T1", 1);
+  t1.join();
+  std::thread t2(runTaskPart, "T2", 2);
+  t2.join();
+
+  CHECK(getEvents(session, "%t %n %m") == std::vector<std::string>{
+    "0 T1 thread event", "42 task task event 1",
+    "0 T2 thread event", "42 task task event 2",
+  });
+}
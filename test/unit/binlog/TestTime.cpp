@@ -3,10 +3,13 @@
 #include <doctest/doctest.h>
 
 #include <chrono>
+#include <cstdint>
 #include <ctime>
 #include <iomanip>
+#include <random>
 #include <sstream>
 #include <string>
+#include <vector>
 
 namespace {
 
@@ -108,6 +111,55 @@ TEST_CASE("clock_to_ns")
   CHECK(binlog::clockToNsSinceEpoch(clockSync, 3508909323) == std::chrono::seconds{2739538800});
 }
 
+TEST_CASE("clock_converter_same_as_clock_to_ns")
+{
+  const std::uint64_t frequencies[] = {
+    1, 3, 7, 1000, 1'000'000, 1'000'000'000, 1'000'000'001, 999'999'999,
+    2'500'000'000, 2'899'999'999, 3'000'000'000, 1u << 20, 1ull << 33,
+    9'223'372'036, 9'223'372'037, 12'000'000'000, 1ull << 62,
+  };
+
+  std::mt19937_64 random(42);
+  for (const std::uint64_t frequency : frequencies)
+  {
+    const binlog::ClockSync clockSync{123456789, frequency, 1569902400'000000000, 0, ""};
+    const binlog::ClockConverter converter(clockSync);
+    REQUIRE(converter.valid());
+
+    // elapsed seconds must fit the result
+    const std::uint64_t maxTicks = (frequency < (1ull << 62) / 8'000'000'000) ? frequency * 8'000'000'000 : 1ull << 62;
+    std::vector<std::uint64_t> clockValues{
+      clockSync.clockValue, clockSync.clockValue + 1, clockSync.clockValue - 1,
+      clockSync.clockValue + frequency, clockSync.clockValue - frequency,
+      clockSync.clockValue + frequency - 1, clockSync.clockValue - frequency + 1,
+    };
+    for (int i = 0; i < 1000; ++i)
+    {
+      const std::uint64_t ticks = random() % maxTicks;
+      clockValues.push_back((i % 2 != 0) ? clockSync.clockValue + ticks : clockSync.clockValue - ticks);
+    }
+
+    std::vector<std::int64_t> batch(clockValues.size());
+    converter.toNsSinceEpoch(clockValues.data(), clockValues.size(), batch.data());
+
+    for (std::size_t i = 0; i < clockValues.size(); ++i)
+    {
+      const std::chrono::nanoseconds expected = binlog::clockToNsSinceEpoch(clockSync, clockValues[i]);
+      CHECK(converter.toNsSinceEpoch(clockValues[i]) == expected);
+      CHECK(batch[i] == expected.count());
+    }
+  }
+}
+
+TEST_CASE("clock_converter_default")
+{
+  const binlog::ClockConverter converter;
+  CHECK(! converter.valid());
+
+  const binlog::ClockConverter zeroFrequency(binlog::ClockSync{123, 0, 456, 0, ""});
+  CHECK(! zeroFrequency.valid());
+}
+
 TEST_CASE("ns_to_gmt")
 {
   binlog::BrokenDownTime bdt{};
@@ -0,0 +1,238 @@
+#include <binlog/TimeIndex.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/CompactOutputStream.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+
+#include <doctest/doctest.h>
+
+#include <algorithm> // min, max
+#include <cstdint>
+#include <cstring> // memcpy
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+/** @returns a logfile with 100 events, clocks 1..100, consumed in multiple batches */
+std::string logEvents()
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+  const std::uint64_t source = addEventSource<std::uint64_t>(session, binlog::Severity::info, "main", "{}");
+
+  std::ostringstream logfile;
+  for (std::uint64_t clock = 1; clock <= 100; ++clock)
+  {
+    CHECK(writer.addEvent(source, clock, clock));
+    if (clock % 10 == 0) { session.consume(logfile); }
+  }
+
+  return logfile.str();
+}
+
+/** @returns the events of logEvents, written through an IndexedOutputStream */
+std::string makeLogfile(std::ostream& index, std::size_t blockSize, std::size_t filterBits = 0)
+{
+  const std::string events = logEvents();
+
+  std::ostringstream logfile;
+  {
+    binlog::IndexedOutputStream output(logfile, index, blockSize, filterBits);
+    output.write(events.data(), std::streamsize(events.size()));
+  }
+
+  return logfile.str();
+}
+
+} // namespace
+
+TEST_CASE("index_blocks_and_metadata")
+{
+  std::stringstream indexStream;
+  const std::string logfile = makeLogfile(indexStream, 256);
+
+  const binlog::TimeIndex index = binlog::TimeIndex::read(indexStream);
+  REQUIRE(index.blocks.size() > 2);
+
+  // blocks are contiguous and cover the logfile
+  std::uint64_t offset = 0;
+  std::uint64_t prevMaxClock = 0;
+  for (const binlog::TimeIndex::Block& block : index.blocks)
+  {
+    CHECK(block.offset == offset);
+    CHECK(block.minClock <= block.maxClock);
+    CHECK(block.minClock > prevMaxClock);
+    offset += block.size;
+    prevMaxClock = block.maxClock;
+  }
+  CHECK(offset == logfile.size());
+  CHECK(index.blocks.front().minClock == 1);
+  CHECK(index.blocks.back().maxClock == 100);
+
+  // metadata points to entries of the logfile
+  bool hasEventSource = false;
+  bool hasWriterProp = false;
+  bool hasClockSync = false;
+  for (const binlog::TimeIndex::Metadata& metadata : index.metadata)
+  {
+    REQUIRE(metadata.offset + metadata.size <= logfile.size());
+
+    std::uint32_t size;
+    std::uint64_t tag;
+    memcpy(&size, logfile.data() + metadata.offset, sizeof(size));
+    memcpy(&tag, logfile.data() + metadata.offset + sizeof(size), sizeof(tag));
+    CHECK(size + sizeof(size) == metadata.size);
+    CHECK(tag == metadata.tag);
+
+    hasEventSource |= (tag == binlog::EventSource::Tag);
+    hasWriterProp |= (tag == binlog::WriterProp::Tag);
+    hasClockSync |= (tag == binlog::ClockSync::Tag);
+  }
+  CHECK(hasEventSource);
+  CHECK(hasWriterProp);
+  CHECK(hasClockSync);
+}
+
+TEST_CASE("index_filters")
+{
+  std::stringstream indexStream;
+  makeLogfile(indexStream, 256, 512);
+
+  const binlog::TimeIndex index = binlog::TimeIndex::read(indexStream);
+  REQUIRE(index.filters.size() == index.blocks.size());
+  CHECK(index.hasFilters());
+
+  for (std::size_t i = 0; i < index.blocks.size(); ++i)
+  {
+    const binlog::TimeIndex::Block& block = index.blocks[i];
+    CHECK(index.filters[i].size() == 8); // 512 bits
+
+    // no false negatives: the clocks are logged as the argument
+    for (std::uint64_t clock = block.minClock; clock <= block.maxClock; ++clock)
+    {
+      CHECK(index.blockMayContain(i, std::to_string(clock)));
+    }
+  }
+
+  // values are ruled out by most blocks
+  std::size_t candidates = 0;
+  for (std::size_t i = 0; i < index.blocks.size(); ++i)
+  {
+    if (index.blockMayContain(i, "57")) { ++candidates; }
+  }
+  CHECK(candidates >= 1);
+  CHECK(candidates < 3);
+}
+
+TEST_CASE("index_without_filters")
+{
+  std::stringstream indexStream;
+  makeLogfile(indexStream, 256);
+
+  const binlog::TimeIndex index = binlog::TimeIndex::read(indexStream);
+  CHECK(index.filters.size() == index.blocks.size());
+  CHECK(! index.hasFilters());
+  CHECK(index.blockMayContain(0, "no such value"));
+}
+
+TEST_CASE("index_compact_events")
+{
+  std::ostringstream compact;
+  {
+    binlog::CompactOutputStream output(compact);
+    output.setEventSourceTables(true);
+    const std::string regular = logEvents();
+    output.write(regular.data(), std::streamsize(regular.size()));
+  }
+  const std::string events = compact.str();
+
+  std::stringstream indexStream;
+  std::ostringstream logfile;
+  {
+    binlog::IndexedOutputStream output(logfile, indexStream, 64, 256);
+    output.write(events.data(), std::streamsize(events.size()));
+  }
+
+  const binlog::TimeIndex index = binlog::TimeIndex::read(indexStream);
+  REQUIRE(index.blocks.size() > 2);
+
+  // the clocks of the compact events are indexed
+  std::uint64_t minClock = std::uint64_t(-1);
+  std::uint64_t maxClock = 0;
+  for (std::size_t i = 0; i < index.blocks.size(); ++i)
+  {
+    const binlog::TimeIndex::Block& block = index.blocks[i];
+    if (block.minClock > block.maxClock) { continue; } // no events
+    minClock = (std::min)(minClock, block.minClock);
+    maxClock = (std::max)(maxClock, block.maxClock);
+
+    // the argument tags are read from the event source table
+    CHECK(! index.filters[i].empty());
+    for (std::uint64_t clock = block.minClock; clock <= block.maxClock; ++clock)
+    {
+      CHECK(index.blockMayContain(i, std::to_string(clock)));
+    }
+  }
+  CHECK(minClock == 1);
+  CHECK(maxClock == 100);
+
+  bool hasEventSourceTable = false;
+  for (const binlog::TimeIndex::Metadata& metadata : index.metadata)
+  {
+    hasEventSourceTable |= (metadata.tag == binlog::EventSourceTable::Tag);
+  }
+  CHECK(hasEventSourceTable);
+}
+
+TEST_CASE("index_split_writes")
+{
+  for (const std::size_t filterBits : {std::size_t{0}, std::size_t{256}})
+  {
+    CAPTURE(filterBits);
+
+    std::stringstream expected;
+    const std::string logfile = makeLogfile(expected, 256, filterBits);
+
+    // the same index is written if entries are split between write calls
+    std::ostringstream logfileCopy;
+    std::ostringstream index;
+    {
+      binlog::IndexedOutputStream output(logfileCopy, index, 256, filterBits);
+      for (char c : logfile)
+      {
+        output.write(&c, 1);
+      }
+    }
+
+    CHECK(logfileCopy.str() == logfile);
+    CHECK(index.str() == expected.str());
+  }
+}
+
+TEST_CASE("index_incomplete_entry")
+{
+  std::ostringstream logfile;
+  std::stringstream indexStream;
+  {
+    binlog::IndexedOutputStream output(logfile, indexStream);
+    output.write("\x10\x00\x00\x00" "abcd", 8);
+  }
+
+  // the incomplete entry is not indexed
+  const binlog::TimeIndex index = binlog::TimeIndex::read(indexStream);
+  CHECK(index.blocks.empty());
+  CHECK(index.metadata.empty());
+}
+
+TEST_CASE("index_invalid")
+{
+  std::stringstream empty;
+  CHECK_THROWS_AS(binlog::TimeIndex::read(empty), std::runtime_error);
+
+  std::stringstream garbage(std::string(40, 'x'));
+  CHECK_THROWS_AS(binlog::TimeIndex::read(garbage), std::runtime_error);
+}
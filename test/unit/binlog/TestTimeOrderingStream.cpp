@@ -0,0 +1,164 @@
+#include <binlog/TimeOrderingStream.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/Entries.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+
+#include <doctest/doctest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace {
+
+binlog::ClockSync nanosecondClock()
+{
+  return binlog::ClockSync{0, 1000000000, 0, 0, "UTC"};
+}
+
+} // namespace
+
+TEST_CASE("order_events_of_writers")
+{
+  binlog::Session session;
+  session.setClockSync(nanosecondClock());
+
+  binlog::SessionWriter writerA(session, 4096, 1, "A");
+  binlog::SessionWriter writerB(session, 4096, 2, "B");
+
+  binlog::EventSource eventSource{0, binlog::Severity::info, "cat", "fun", "file", 1, "{}", "[c"};
+  eventSource.id = session.addEventSource(eventSource);
+
+  CHECK(writerA.addEvent(eventSource.id, 10, std::string("a1")));
+  CHECK(writerA.addEvent(eventSource.id, 30, std::string("a2")));
+  CHECK(writerB.addEvent(eventSource.id, 20, std::string("b1")));
+  CHECK(writerB.addEvent(eventSource.id, 30, std::string("b2")));
+
+  TestStream stream;
+  binlog::TimeOrderingStream<TestStream> output(stream, std::chrono::nanoseconds(100));
+  session.consume(output);
+  CHECK(output.bufferedBytes() != 0); // within the window
+
+  output.flush();
+  CHECK(output.bufferedBytes() == 0);
+  CHECK(output.lateEventCount() == 0);
+
+  CHECK(streamToEvents(stream, "%n %r %m") == std::vector<std::string>{
+    "A 10 a1",
+    "B 20 b1",
+    "A 30 a2", // equal clocks: input order
+    "B 30 b2",
+  });
+}
+
+TEST_CASE("write_events_older_than_window")
+{
+  binlog::Session session;
+  session.setClockSync(nanosecondClock());
+
+  binlog::SessionWriter writerA(session, 4096, 1, "A");
+  binlog::SessionWriter writerB(session, 4096, 2, "B");
+
+  binlog::EventSource eventSource{0, binlog::Severity::info, "cat", "fun", "file", 1, "{}", "[c"};
+  eventSource.id = session.addEventSource(eventSource);
+
+  TestStream stream;
+  binlog::TimeOrderingStream<TestStream> output(stream, std::chrono::nanoseconds(100));
+
+  CHECK(writerA.addEvent(eventSource.id, 100, std::string("a1")));
+  CHECK(writerB.addEvent(eventSource.id, 50, std::string("b1")));
+  session.consume(output);
+  CHECK(streamToEvents(stream, "%n %r %m").empty());
+
+  stream.readPos = 0;
+  CHECK(writerA.addEvent(eventSource.id, 180, std::string("a2")));
+  CHECK(writerB.addEvent(eventSource.id, 120, std::string("b2")));
+  session.consume(output); // writes the events at or before 80
+
+  CHECK(streamToEvents(stream, "%n %r %m") == std::vector<std::string>{
+    "B 50 b1",
+  });
+
+  stream.readPos = 0;
+  CHECK(writerB.addEvent(eventSource.id, 40, std::string("b3"))); // late, and out of order in B
+  session.consume(output);
+  output.flush();
+
+  CHECK(output.lateEventCount() == 0); // b3 is ordered after b2, as B wrote it after
+  CHECK(streamToEvents(stream, "%n %r %m") == std::vector<std::string>{
+    "B 50 b1",
+    "A 100 a1",
+    "B 120 b2",
+    "B 40 b3",
+    "A 180 a2",
+  });
+}
+
+TEST_CASE("count_late_events")
+{
+  binlog::Session session;
+  session.setClockSync(nanosecondClock());
+
+  binlog::SessionWriter writerA(session, 4096, 1, "A");
+  binlog::SessionWriter writerB(session, 4096, 2, "B");
+
+  binlog::EventSource eventSource{0, binlog::Severity::info, "cat", "fun", "file", 1, "{}", "[c"};
+  eventSource.id = session.addEventSource(eventSource);
+
+  TestStream stream;
+  binlog::TimeOrderingStream<TestStream> output(stream, std::chrono::nanoseconds(10));
+
+  CHECK(writerA.addEvent(eventSource.id, 100, std::string("a1")));
+  CHECK(writerA.addEvent(eventSource.id, 200, std::string("a2")));
+  session.consume(output); // writes a1
+  CHECK(writerB.addEvent(eventSource.id, 50, std::string("b1"))); // older than the window
+  session.consume(output);
+  output.flush();
+
+  CHECK(output.lateEventCount() == 1);
+  CHECK(streamToEvents(stream, "%n %r %m") == std::vector<std::string>{
+    "A 100 a1",
+    "B 50 b1",
+    "A 200 a2",
+  });
+}
+
+TEST_CASE("order_events_with_writer_contexts")
+{
+  binlog::Session session;
+  session.setClockSync(nanosecondClock());
+
+  binlog::SessionWriter writerA(session, 4096, 1, "A");
+  binlog::SessionWriter writerB(session, 4096, 2, "B");
+
+  binlog::EventSource eventSource{0, binlog::Severity::info, "cat", "fun", "file", 1, "{}", "[c"};
+  eventSource.id = session.addEventSource(eventSource);
+
+  CHECK(writerA.setContext("x"));
+  CHECK(writerA.addEvent(eventSource.id, 10, std::string("a1")));
+  CHECK(writerA.setContext("y"));
+  CHECK(writerA.addEvent(eventSource.id, 30, std::string("a2")));
+  CHECK(writerB.addEvent(eventSource.id, 20, std::string("b1")));
+
+  TestStream stream;
+  binlog::TimeOrderingStream<TestStream> output(stream, std::chrono::nanoseconds(100));
+  session.consume(output);
+
+  CHECK(writerA.addEvent(eventSource.id, 40, std::string("a3")));
+  session.consume(output);
+  output.flush();
+
+  // the context of A is restored after the event of B,
+  // the context repeated by the second batch is not written
+  CHECK(countTags(stream, binlog::WriterContext::Tag) == 3);
+  CHECK(streamToEvents(stream, "%n %c %m") == std::vector<std::string>{
+    "A x a1",
+    "B  b1",
+    "A y a2",
+    "A y a3",
+  });
+}
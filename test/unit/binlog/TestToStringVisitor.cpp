@@ -90,6 +90,62 @@ TEST_CASE_FIXTURE(TestcaseBase, "sequence_of_char")
   CHECK(result() == "abc");
 }
 
+TEST_CASE_FIXTURE(TestcaseBase, "contiguous_sequence_of_arithmetic")
+{
+  const std::int32_t ints[] = {1, -2, 3};
+  input = binlog::Range(reinterpret_cast<const char*>(ints), sizeof(ints));
+  CHECK(visitor.visit(V::SequenceBegin{3, "i"}, input));
+  CHECK(input.size() == 0);
+
+  const std::int8_t bytes[] = {-1, 65};
+  input = binlog::Range(reinterpret_cast<const char*>(bytes), sizeof(bytes));
+  CHECK(visitor.visit(V::SequenceBegin{2, "b"}, input));
+
+  const double doubles[] = {1.5, 0.1};
+  input = binlog::Range(reinterpret_cast<const char*>(doubles), sizeof(doubles));
+  CHECK(visitor.visit(V::SequenceBegin{2, "d"}, input));
+
+  const bool bools[] = {true, false};
+  input = binlog::Range(reinterpret_cast<const char*>(bools), sizeof(bools));
+  CHECK(visitor.visit(V::SequenceBegin{2, "y"}, input));
+
+  CHECK(result() == "[1, -2, 3][-1, 65][1.5, 0.1][true, false]");
+}
+
+TEST_CASE("hex_bytes")
+{
+  std::ostringstream str;
+  binlog::detail::OstreamBuffer buf{str};
+  binlog::ToStringVisitor visitor(buf, nullptr, true);
+  using V = mserialize::Visitor;
+
+  const std::uint8_t bytes[] = {0x0a, 0x1b, 0xff};
+  binlog::Range input(reinterpret_cast<const char*>(bytes), sizeof(bytes));
+  visitor.visit(V::SequenceBegin{2, "[B"}, input);
+  CHECK(visitor.visit(V::SequenceBegin{3, "B"}, input));
+  visitor.visit(V::SequenceBegin{0, "B"}, input);
+  visitor.visit(V::SequenceEnd{});
+  visitor.visit(V::SequenceEnd{});
+
+  // other types are not affected
+  visitor.visit(std::uint8_t(10));
+
+  buf.flush();
+  CHECK(str.str() == "[0x0a1bff, []]10");
+}
+
+TEST_CASE_FIXTURE(TestcaseBase, "seq_of_contiguous_seq_of_int")
+{
+  const std::uint16_t shorts[] = {1, 2, 3, 4};
+  input = binlog::Range(reinterpret_cast<const char*>(shorts), sizeof(shorts));
+  visitor.visit(V::SequenceBegin{2, "[S"}, input);
+  CHECK(visitor.visit(V::SequenceBegin{2, "S"}, input));
+  CHECK(visitor.visit(V::SequenceBegin{2, "S"}, input));
+  visitor.visit(V::SequenceEnd{});
+
+  CHECK(result() == "[[1, 2], [3, 4]]");
+}
+
 TEST_CASE_FIXTURE(TestcaseBase, "seq_of_seq_of_int")
 {
   visitor.visit(V::SequenceBegin{3, "[i"}, input);
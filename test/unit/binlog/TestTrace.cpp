@@ -0,0 +1,58 @@
+#include <trace.hpp>
+
+#include <binlog/EntryStream.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/advanced_log_macros.hpp>
+#include <binlog/scope_macros.hpp>
+
+#include <doctest/doctest.h>
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+namespace {
+
+void logScope(binlog::SessionWriter& writer, std::uint64_t clock, std::uint64_t ticks)
+{
+  // like BINLOG_SCOPE_WC, with a fixed clock and duration
+  BINLOG_CREATE_SOURCE_AND_EVENT(writer, binlog::Severity::info, spans, clock, "order \"{}\" ({})", 7, binlog::ScopeDuration{ticks});
+}
+
+std::string writeTrace(binlog::Session& session)
+{
+  std::stringstream stream;
+  session.consume(stream);
+
+  binlog::IstreamEntryStream entryStream(stream);
+  std::ostringstream trace;
+  writeChromeTrace(entryStream, trace);
+  return trace.str();
+}
+
+} // namespace
+
+TEST_CASE("chrome_trace")
+{
+  binlog::Session session;
+  session.setClockSync(binlog::ClockSync{0, 1000000000, 0, 0, "UTC"});
+  binlog::SessionWriter writer(session, 4096, 12, "worker");
+
+  logScope(writer, 1500, 2500);
+  BINLOG_CREATE_SOURCE_AND_EVENT(writer, binlog::Severity::info, main, 5000, "done");
+
+  const std::string expected =
+    "{\"traceEvents\":[\n"
+    "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":12,\"args\":{\"name\":\"worker\"}},\n"
+    "{\"name\":\"order \\\"7\\\"\",\"cat\":\"spans\",\"ph\":\"X\",\"ts\":1.500,\"dur\":2.500,\"pid\":1,\"tid\":12},\n"
+    "{\"name\":\"done\",\"cat\":\"main\",\"ph\":\"i\",\"ts\":5.000,\"s\":\"t\",\"pid\":1,\"tid\":12}\n"
+    "]}\n";
+  CHECK(writeTrace(session) == expected);
+}
+
+TEST_CASE("chrome_trace_empty")
+{
+  binlog::Session session;
+  CHECK(writeTrace(session) == "{\"traceEvents\":[\n]}\n");
+}
@@ -0,0 +1,40 @@
+#include <binlog/TruncatedString.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/advanced_log_macros.hpp>
+
+#include <mserialize/serialize.hpp>
+#include <mserialize/tag.hpp>
+
+#include <doctest/doctest.h>
+
+#include <string>
+#include <vector>
+
+TEST_CASE("truncate_size")
+{
+  const std::string large(4096, 'x');
+  CHECK(mserialize::serialized_size(binlog::truncate<32>(large)) == 4 + 32 + 8);
+  CHECK(mserialize::serialized_size(binlog::truncate<32>("short")) == 4 + 5 + 8);
+  CHECK(mserialize::tag<binlog::TruncatedString<32>>() == mserialize::tag<binlog::TruncatedString<64>>());
+}
+
+TEST_CASE("truncate_log")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 128);
+
+  const std::string request = "GET /index.html HTTP/1.1" + std::string(4096, ' ');
+  BINLOG_INFO_W(writer, "Request: {}", binlog::truncate<24>(request));
+  BINLOG_INFO_W(writer, "{} {} {}",
+    binlog::truncate<5>("Hello World"), binlog::truncate<5>(std::string("Hello")), binlog::truncate<0>("")
+  );
+
+  CHECK(getEvents(session, "%m") == std::vector<std::string>{
+    "Request: GET /index.html HTTP/1.1... (4120 bytes)",
+    "Hello... (11 bytes) Hello ",
+  });
+}
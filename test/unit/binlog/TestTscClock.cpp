@@ -0,0 +1,75 @@
+#include <binlog/TscClock.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+#include <binlog/Time.hpp>
+
+#include <doctest/doctest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+TEST_CASE("tsc_frequency")
+{
+  const std::uint64_t a = binlog::tscNow();
+  const std::uint64_t b = binlog::tscNow();
+  CHECK(a <= b);
+
+  const std::uint64_t frequency = binlog::calibrateTscFrequency(std::chrono::milliseconds(5));
+  CHECK(frequency > 1'000'000); // at least 1 MHz
+
+  // measured once, then cached
+  CHECK(binlog::tscFrequency() != 0);
+  CHECK(binlog::tscFrequency() == binlog::tscFrequency());
+
+  static_cast<void>(binlog::hasInvariantTsc()); // platform dependent
+}
+
+TEST_CASE("tsc_clock_sync_measures_utc")
+{
+  const binlog::ClockSync clockSync = binlog::tscClockSync();
+  CHECK(clockSync.clockFrequency == binlog::tscFrequency());
+
+  const std::chrono::nanoseconds tscTime = binlog::clockToNsSinceEpoch(clockSync, binlog::tscNow());
+  const std::chrono::nanoseconds systemTime{binlog::clockNow()};
+
+  // the calibration is approximate, allow some time to elapse the between the two clock reads
+  const std::chrono::nanoseconds diff = (tscTime > systemTime) ? tscTime - systemTime : systemTime - tscTime;
+  CHECK(diff < std::chrono::milliseconds(100));
+}
+
+TEST_CASE("tsc_macros")
+{
+  binlog::Session session;
+  session.setClockSync(binlog::tscClockSync());
+  binlog::SessionWriter writer(session, 4096);
+
+  BINLOG_INFO_TSC_WC(writer, tsc, "Hello {}", std::string("TSC"));
+
+  session.setMinSeverity(binlog::Severity::warning);
+  BINLOG_INFO_TSC_WC(writer, tsc, "Disabled");
+  BINLOG_ERROR_TSC_WC(writer, tsc, "Enabled");
+
+  const std::vector<std::string> expectedEvents{
+    "tsc INFO Hello TSC",
+    "tsc ERRO Enabled",
+  };
+  CHECK(getEvents(session, "%C %S %m") == expectedEvents);
+}
+
+TEST_CASE("tsc_clock_sync_source")
+{
+  binlog::TscClockSyncSource source;
+  const binlog::ClockSync a = source();
+  const binlog::ClockSync b = source();
+
+  // less than a second apart: the frequency is not yet refined
+  CHECK(a.clockFrequency == binlog::tscFrequency());
+  CHECK(b.clockFrequency == binlog::tscFrequency());
+  CHECK(a.clockValue <= b.clockValue);
+  CHECK(a.nsSinceEpoch <= b.nsSinceEpoch);
+}
@@ -0,0 +1,217 @@
+#include <where.hpp>
+
+#include "test_utils.hpp"
+
+#include <binlog/CompactOutputStream.hpp>
+#include <binlog/EntryStream.hpp>
+#include <binlog/PackedInteger.hpp>
+#include <binlog/Session.hpp>
+#include <binlog/SessionWriter.hpp>
+
+#include <doctest/doctest.h>
+
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<std::string> filterEvents(std::istream& input, const std::string& expression)
+{
+  const WherePredicate predicate(expression);
+  binlog::IstreamEntryStream entryStream(input);
+  WhereEntryStream filtered(entryStream, predicate);
+  return streamToEvents(filtered, "%S %C %m");
+}
+
+std::string logEvents()
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+
+  const std::uint64_t order = addEventSource<int, std::string>(session, binlog::Severity::info, "orders", "Order {} {}", __FILE__);
+  const std::uint64_t route = addEventSource<std::string, binlog::PackedInteger<int>, double>(session, binlog::Severity::warning, "router", "Route {} {} {}", __FILE__);
+  const std::uint64_t failure = addEventSource<>(session, binlog::Severity::error, "main", "Failure", __FILE__);
+
+  for (int i = 0; i < 4; ++i)
+  {
+    CHECK(writer.addEvent(order, 0, i, std::string(std::size_t(i), 'x')));
+    CHECK(writer.addEvent(route, 0, std::string("a"), binlog::packed(-i), 0.5 * i));
+  }
+  CHECK(writer.addEvent(failure, 0));
+
+  std::ostringstream stream;
+  session.consume(stream);
+  return stream.str();
+}
+
+} // namespace
+
+TEST_CASE("where_source")
+{
+  const std::string logfile = logEvents();
+  const auto filter = [&logfile](const std::string& expression)
+  {
+    std::istringstream input(logfile);
+    return filterEvents(input, expression);
+  };
+
+  CHECK(filter("severity>=error") == std::vector<std::string>{"ERRO main Failure"});
+  CHECK(filter("severity == WARN && ! format~\"Order\"").size() == 4);
+  CHECK(filter("category==orders || severity>warning").size() == 5);
+  CHECK(filter("(category==orders || category==router) && id>1000").empty());
+  CHECK(filter("file~TestWhere && category!=main").size() == 8);
+}
+
+TEST_CASE("where_arguments")
+{
+  const std::string logfile = logEvents();
+  const auto filter = [&logfile](const std::string& expression)
+  {
+    std::istringstream input(logfile);
+    return filterEvents(input, expression);
+  };
+
+  CHECK(filter("category==orders && arg0>=2") == std::vector<std::string>{
+    "INFO orders Order 2 xx",
+    "INFO orders Order 3 xxx",
+  });
+
+  // after a string: skipped, not at a fixed offset
+  CHECK(filter("arg1<-1") == std::vector<std::string>{
+    "WARN router Route a -2 1",
+    "WARN router Route a -3 1.5",
+  });
+  CHECK(filter("arg2==0.5") == std::vector<std::string>{"WARN router Route a -1 0.5"});
+
+  // strings, and missing arguments are never matched
+  CHECK(filter("category==orders && arg1==0").empty());
+  CHECK(filter("arg5>0").empty());
+  CHECK(filter("! arg5>0").size() == 9);
+}
+
+TEST_CASE("where_any_value")
+{
+  const std::string logfile = logEvents();
+  const auto filter = [&logfile](const std::string& expression)
+  {
+    std::istringstream input(logfile);
+    return filterEvents(input, expression);
+  };
+
+  // strings, and integers by their decimal representation
+  CHECK(filter("value==xx") == std::vector<std::string>{"INFO orders Order 2 xx"});
+  CHECK(filter("value==2") == std::vector<std::string>{"INFO orders Order 2 xx"});
+  CHECK(filter("value==\"-3\"") == std::vector<std::string>{"WARN router Route a -3 1.5"});
+  CHECK(filter("value==a").size() == 4);
+  CHECK(filter("value!=a").size() == 5);
+
+  // floating point numbers are not matched
+  CHECK(filter("value==0.5").empty());
+}
+
+TEST_CASE("where_message")
+{
+  const std::string logfile = logEvents();
+  const auto filter = [&logfile](const std::string& expression)
+  {
+    std::istringstream input(logfile);
+    return filterEvents(input, expression);
+  };
+
+  // in the format string
+  CHECK(filter("message~Order").size() == 4);
+  CHECK(filter("message~Fail") == std::vector<std::string>{"ERRO main Failure"});
+
+  // in a string argument
+  CHECK(filter("message~xx") == std::vector<std::string>{
+    "INFO orders Order 2 xx",
+    "INFO orders Order 3 xxx",
+  });
+
+  // spanning text and arguments, or in a formatted number
+  CHECK(filter("message~\"r 3\"") == std::vector<std::string>{"INFO orders Order 3 xxx"});
+  CHECK(filter("message~\"a -2\"") == std::vector<std::string>{"WARN router Route a -2 1"});
+  CHECK(filter("message~1.5") == std::vector<std::string>{"WARN router Route a -3 1.5"});
+
+  CHECK(filter("message~zz").empty());
+  CHECK(filter("! message~Route").size() == 5);
+}
+
+TEST_CASE("where_message_source")
+{
+  const binlog::EventSource source{1, binlog::Severity::info, "c", "f", "file", 1, "Value: {:x}", "i"};
+
+  CHECK(WherePredicate("message~Value").bind(source).alwaysTrue());
+  CHECK(WherePredicate("message~Other").bind(source).alwaysFalse()); // not in a number
+  CHECK(WherePredicate("message~\": 1\"").bind(source).matches(binlog::Range{}) == false); // invalid arguments
+  CHECK(! WherePredicate("message~ff").bind(source).alwaysFalse());
+}
+
+TEST_CASE("where_named_arguments")
+{
+  binlog::Session session;
+  binlog::SessionWriter writer(session, 4096);
+  const std::uint64_t fill = addEventSource<std::string, double, int>(session, binlog::Severity::info, "main", "Fill {venue} px={px} qty={qty}");
+  const std::uint64_t cancel = addEventSource<int>(session, binlog::Severity::info, "main", "Cancel qty={qty}");
+  // written before named placeholders: {qty} is literal
+  const std::uint64_t old = addEventSource<int>(session, binlog::Severity::info, "main", "Old {qty} {}");
+  for (int i = 0; i < 3; ++i)
+  {
+    CHECK(writer.addEvent(fill, 0, std::string("XNAS"), 10.5 + i, i));
+    CHECK(writer.addEvent(cancel, 0, 10 * i));
+    CHECK(writer.addEvent(old, 0, i));
+  }
+  std::ostringstream stream;
+  session.consume(stream);
+  const std::string logfile = stream.str();
+
+  const auto filter = [&logfile](const std::string& expression)
+  {
+    std::istringstream input(logfile);
+    return filterEvents(input, expression);
+  };
+
+  // the position of the named argument is resolved for each source
+  CHECK(filter("arg.qty>=1 && arg.qty<20") == std::vector<std::string>{
+    "INFO main Fill XNAS px=11.5 qty=1",
+    "INFO main Cancel qty=10",
+    "INFO main Fill XNAS px=12.5 qty=2",
+  });
+  CHECK(filter("arg.px>12") == std::vector<std::string>{"INFO main Fill XNAS px=12.5 qty=2"});
+  CHECK(filter("message~\"Old {qty} 2\"") == std::vector<std::string>{"INFO main Old {qty} 2"});
+
+  // strings, and unknown names are never matched
+  CHECK(filter("arg.venue==0").empty());
+  CHECK(filter("arg.price>0").empty());
+}
+
+TEST_CASE("where_compact")
+{
+  const std::string logfile = logEvents();
+
+  std::stringstream compact;
+  {
+    binlog::CompactOutputStream output(compact);
+    output.write(logfile.data(), std::streamsize(logfile.size()));
+  }
+
+  CHECK(filterEvents(compact, "category==orders && arg0>=2") == std::vector<std::string>{
+    "INFO orders Order 2 xx",
+    "INFO orders Order 3 xxx",
+  });
+}
+
+TEST_CASE("where_invalid_expression")
+{
+  for (const char* expression : {
+    "", "severity", "severity>", "severity>=urgent", "line~1", "arg0>x",
+    "foo==1", "arg.>1", "value>1", "value~x", "message==x", "category==orders &&", "(category==orders", "category==\"orders", "a=b",
+  })
+  {
+    CAPTURE(expression);
+    CHECK_THROWS_AS(WherePredicate{expression}, std::runtime_error);
+  }
+}
@@ -2,7 +2,13 @@
 
 #include <doctest/doctest.h>
 
+#include <cmath>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
 #include <sstream>
 
 namespace {
@@ -85,3 +91,141 @@ TEST_CASE_FIXTURE(TestcaseBase, "shift_op")
 
   CHECK(toString("foobar") == "foobar");
 }
+
+TEST_CASE_FIXTURE(TestcaseBase, "integers")
+{
+  CHECK(toString<std::int8_t>(-128) == "-128");
+  CHECK(toString<std::int64_t>(0) == "0");
+  CHECK(toString<std::int64_t>(-9) == "-9");
+  CHECK(toString<std::int64_t>(std::numeric_limits<std::int64_t>::min()) == "-9223372036854775808");
+  CHECK(toString<std::int64_t>(std::numeric_limits<std::int64_t>::max()) == "9223372036854775807");
+  CHECK(toString<std::uint64_t>(std::numeric_limits<std::uint64_t>::max()) == "18446744073709551615");
+  CHECK(toString<std::uint32_t>(1000000000) == "1000000000");
+}
+
+TEST_CASE_FIXTURE(TestcaseBase, "integer_digit_boundaries")
+{
+  std::uint64_t pow10 = 1;
+  std::string digits = "1";
+  for (int i = 0; i < 19; ++i)
+  {
+    CHECK(toString(pow10) == digits);
+    CHECK(toString(pow10 - 1) == std::string(digits.size() - 1, '9').append(pow10 == 1 ? "0" : ""));
+    CHECK(toString(-std::int64_t(pow10)) == "-" + digits);
+    pow10 *= 10;
+    digits += '0';
+  }
+
+  CHECK(toString<std::uint32_t>(std::numeric_limits<std::uint32_t>::max()) == "4294967295");
+  CHECK(toString<std::uint64_t>(std::uint64_t{std::numeric_limits<std::uint32_t>::max()} + 1) == "4294967296");
+  CHECK(toString<std::int32_t>(std::numeric_limits<std::int32_t>::min()) == "-2147483648");
+  CHECK(toString<std::uint8_t>(255) == "255");
+  CHECK(toString<std::int16_t>(-32768) == "-32768");
+}
+
+TEST_CASE_FIXTURE(TestcaseBase, "hex")
+{
+  // sizes below, at and above the 16 byte blocks, and above the internal buffer size
+  for (std::size_t size : {0u, 1u, 15u, 16u, 17u, 33u, 511u, 512u, 513u, 2000u})
+  {
+    std::string bytes(size, '\0');
+    std::string expected;
+    for (std::size_t i = 0; i < size; ++i)
+    {
+      bytes[i] = char(i * 37 + 11);
+      char hex[3];
+      snprintf(hex, sizeof(hex), "%02x", unsigned(std::uint8_t(bytes[i])));
+      expected += hex;
+    }
+
+    buf.writeHex(bytes.data(), bytes.size());
+    CHECK(result() == expected);
+    str.str({});
+  }
+}
+
+TEST_CASE_FIXTURE(TestcaseBase, "fixed_point")
+{
+  const auto fixedPoint = [this](std::int64_t value, unsigned scale)
+  {
+    buf.writeFixedPoint(value, scale);
+    std::string s = result();
+    str.str({});
+    return s;
+  };
+
+  CHECK(fixedPoint(0, 0) == "0");
+  CHECK(fixedPoint(0, 2) == "0.00");
+  CHECK(fixedPoint(12345, 2) == "123.45");
+  CHECK(fixedPoint(-12345, 2) == "-123.45");
+  CHECK(fixedPoint(5, 3) == "0.005");
+  CHECK(fixedPoint(-5, 3) == "-0.005");
+  CHECK(fixedPoint(1000, 3) == "1.000");
+  CHECK(fixedPoint(7, 0) == "7");
+  CHECK(fixedPoint(INT64_MAX, 0) == "9223372036854775807");
+  CHECK(fixedPoint(INT64_MIN, 18) == "-9.223372036854775808");
+  CHECK(fixedPoint(INT64_MIN, 19) == "-0.9223372036854775808");
+}
+
+TEST_CASE_FIXTURE(TestcaseBase, "shortest_roundtrip_double")
+{
+  // same as %g
+  CHECK(toString(0.5) == "0.5");
+  CHECK(toString(100.0) == "100");
+  CHECK(toString(123456.0) == "123456");
+  CHECK(toString(1e6) == "1e+06");
+  CHECK(toString(1e16) == "1e+16");
+  CHECK(toString(0.0001) == "0.0001");
+  CHECK(toString(0.00001) == "1e-05");
+  CHECK(toString(-1.5e-300) == "-1.5e-300");
+  CHECK(toString(-0.0) == "-0");
+
+  // more digits than %g
+  CHECK(toString(0.1 + 0.2) == "0.30000000000000004");
+  CHECK(toString(1234567.0) == "1234567");
+  CHECK(toString(3.14159265358979) == "3.14159265358979");
+  CHECK(toString(123456789012345680.0) == "1.2345678901234568e+17");
+  CHECK(toString(std::numeric_limits<double>::max()) == "1.7976931348623157e+308");
+  CHECK(toString(std::numeric_limits<double>::min()) == "2.2250738585072014e-308");
+  CHECK(toString(std::numeric_limits<double>::denorm_min()) == "5e-324");
+
+  CHECK(toString(std::numeric_limits<double>::infinity()) == "inf");
+  CHECK(toString(-std::numeric_limits<double>::infinity()) == "-inf");
+  CHECK(toString(std::numeric_limits<double>::quiet_NaN()) == "nan");
+}
+
+TEST_CASE_FIXTURE(TestcaseBase, "shortest_roundtrip_float")
+{
+  CHECK(toString(0.1f) == "0.1");
+  CHECK(toString(16777216.0f) == "16777216");
+  CHECK(toString(1e10f) == "1e+10");
+  CHECK(toString(3.4028235e38f) == "3.4028235e+38");
+  CHECK(toString(std::numeric_limits<float>::denorm_min()) == "1e-45");
+  CHECK(toString(-std::numeric_limits<float>::infinity()) == "-inf");
+}
+
+TEST_CASE_FIXTURE(TestcaseBase, "shortest_roundtrip_random")
+{
+  std::mt19937_64 rng(1234);
+  for (int i = 0; i < 10000; ++i)
+  {
+    const std::uint64_t bits = rng();
+
+    double d = 0;
+    memcpy(&d, &bits, sizeof(d));
+    if (std::isfinite(d))
+    {
+      const std::string s = toString(d);
+      CHECK(std::strtod(s.c_str(), nullptr) == d);
+    }
+
+    float f = 0;
+    const std::uint32_t fbits = std::uint32_t(bits >> 32);
+    memcpy(&f, &fbits, sizeof(f));
+    if (std::isfinite(f))
+    {
+      const std::string s = toString(f);
+      CHECK(std::strtof(s.c_str(), nullptr) == f);
+    }
+  }
+}
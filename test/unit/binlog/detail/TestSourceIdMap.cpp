@@ -0,0 +1,31 @@
+#include <binlog/detail/SourceIdMap.hpp>
+
+#include <doctest/doctest.h>
+
+#include <cstdint>
+
+using IdMap = binlog::detail::SourceIdMap<std::uint32_t>;
+
+TEST_CASE("source_id_map_dense_and_sparse")
+{
+  IdMap m;
+  CHECK(m.get(0) == 0);
+  CHECK(m.get(123) == 0);
+  CHECK(m.get(std::uint64_t(-1)) == 0);
+
+  m.set(1, 10);
+  m.set(100, 20);
+  m.set(IdMap::maxDenseId, 30);       // sparse, the vector is not resized
+  m.set(std::uint64_t(-1) >> 1, 40);
+
+  CHECK(m.get(1) == 10);
+  CHECK(m.get(2) == 0);
+  CHECK(m.get(100) == 20);
+  CHECK(m.get(IdMap::maxDenseId - 1) == 0);
+  CHECK(m.get(IdMap::maxDenseId) == 30);
+  CHECK(m.get(IdMap::maxDenseId + 1) == 0);
+  CHECK(m.get(std::uint64_t(-1) >> 1) == 40);
+
+  m.set(1, 11);
+  CHECK(m.get(1) == 11);
+}
@@ -0,0 +1,104 @@
+#include <binlog/detail/VectorOutputStream.hpp>
+
+#include <doctest/doctest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using binlog::detail::SegmentedRecoverableOutputStream;
+
+namespace {
+
+std::string copy(const SegmentedRecoverableOutputStream& s, std::size_t begin, std::size_t end)
+{
+  std::string result;
+  s.forEachPiece(begin, end, [&result](const char* data, std::size_t size) { result.append(data, size); });
+  return result;
+}
+
+} // namespace
+
+TEST_CASE("segmented_empty")
+{
+  const SegmentedRecoverableOutputStream s(123, nullptr, 16);
+  CHECK(s.size() == 0);
+  CHECK(s.segmentCount() == 0);
+  CHECK(copy(s, 0, 0).empty());
+}
+
+TEST_CASE("segmented_writes_not_split")
+{
+  SegmentedRecoverableOutputStream s(123, nullptr, 16);
+
+  std::string expected;
+  const std::vector<std::string> writes{"abcdefgh", "ijklmn", "opq", "rstuvwxyz0123456789", "AB"};
+  for (const std::string& w : writes)
+  {
+    s.write(w.data(), std::streamsize(w.size()));
+    expected += w;
+  }
+
+  // abcdefgh|ijklmn / opq / rstuvwxyz0123456789 (larger than a segment) / AB
+  CHECK(s.size() == expected.size());
+  CHECK(s.segmentCount() == 4);
+
+  for (std::size_t begin = 0; begin <= expected.size(); ++begin)
+  {
+    for (std::size_t end = begin; end <= expected.size(); ++end)
+    {
+      CHECK(copy(s, begin, end) == expected.substr(begin, end - begin));
+    }
+  }
+}
+
+TEST_CASE("segmented_pieces_are_segments")
+{
+  SegmentedRecoverableOutputStream s(123, nullptr, 8);
+  s.write("abcd", 4);
+  s.write("efgh", 4);
+  s.write("ijkl", 4);
+
+  std::vector<std::string> pieces;
+  s.forEachPiece(2, 10, [&pieces](const char* data, std::size_t size) { pieces.emplace_back(data, size); });
+  CHECK(pieces == std::vector<std::string>{"cdefgh", "ij"});
+
+  std::string out;
+  struct StringStream
+  {
+    std::string& str;
+    StringStream& write(const char* data, std::streamsize size) { str.append(data, std::size_t(size)); return *this; }
+  } stream{out};
+  s.copyTo(0, s.size(), stream);
+  CHECK(out == "abcdefghijkl");
+}
+
+TEST_CASE("segmented_recoverable_header")
+{
+  const std::uint64_t magic = 0xFE214F726E35BDBC;
+  int id = 0;
+  SegmentedRecoverableOutputStream s(magic, &id, 8);
+  s.write("abcdef", 6);
+  s.write("ghijkl", 6);
+
+  // each segment has its own header: [u64 magic|ptr id|u64 size]
+  constexpr std::size_t headerSize = sizeof(std::uint64_t) + sizeof(void*) + sizeof(std::uint64_t);
+  std::size_t segmentCount = 0;
+  s.forEachPiece(0, s.size(), [&](const char* data, std::size_t size)
+  {
+    const char* header = data - headerSize;
+    std::uint64_t m = 0;
+    void* p = nullptr;
+    std::uint64_t sz = 0;
+    memcpy(&m, header, sizeof(m));
+    memcpy(&p, header + sizeof(m), sizeof(p));
+    memcpy(&sz, header + sizeof(m) + sizeof(p), sizeof(sz));
+    CHECK(m == magic);
+    CHECK(p == &id);
+    CHECK(sz == size);
+    ++segmentCount;
+  });
+  CHECK(segmentCount == 2);
+}
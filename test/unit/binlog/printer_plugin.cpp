@@ -0,0 +1,31 @@
+// A printer plugin, loaded by TestPrettyPrinter, see PrettyPrinter::loadPrinterPlugin
+
+#include <binlog/PrettyPrinter.hpp>
+#include <binlog/Range.hpp>
+
+#include <mserialize/string_view.hpp>
+
+#include <cstdint>
+
+extern "C" void binlog_printer_plugin(binlog::PrettyPrinter& printer)
+{
+  // bitflags
+  printer.addEnumPrinter("Permission", [](binlog::detail::OstreamBuffer& out, std::int64_t value, mserialize::string_view)
+  {
+    if (value == 0) { return false; }
+
+    const char* separator = "";
+    if (value & 1) { out << separator << "read"; separator = "|"; }
+    if (value & 2) { out << separator << "write"; separator = "|"; }
+    if (value & 4) { out << separator << "exec"; }
+    return true;
+  });
+
+  // ids of symbols
+  printer.addStructPrinter("Symbol", "`id'i", [](binlog::detail::OstreamBuffer& out, binlog::Range& input)
+  {
+    const std::int32_t id = input.read<std::int32_t>();
+    out << ((id == 1) ? "AAPL" : (id == 2) ? "MSFT" : "?");
+    return true;
+  });
+}
@@ -26,7 +26,7 @@ binlog::Range TestStream::nextEntryPayload()
   return result;
 }
 
-std::vector<std::string> streamToEvents(TestStream& input, const char* eventFormat)
+std::vector<std::string> streamToEvents(binlog::EntryStream& input, const char* eventFormat)
 {
   std::vector<std::string> result;
 
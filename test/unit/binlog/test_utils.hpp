@@ -3,6 +3,8 @@
 
 #include <binlog/EntryStream.hpp>
 #include <binlog/Session.hpp>
+#include <binlog/Severity.hpp>
+#include <binlog/create_source_and_event.hpp> // ArgumentTags
 
 #include <chrono>
 #include <cstdint>
@@ -22,7 +24,7 @@ struct TestStream : binlog::EntryStream
 };
 
 /** Pretty print the events of a binlog stream `input` according to `eventFormat` */
-std::vector<std::string> streamToEvents(TestStream& input, const char* eventFormat);
+std::vector<std::string> streamToEvents(binlog::EntryStream& input, const char* eventFormat);
 
 /** Consume `session`, pretty print the consumed events according to `eventFormat` */
 std::vector<std::string> getEvents(binlog::Session& session, const char* eventFormat);
@@ -30,6 +32,27 @@ std::vector<std::string> getEvents(binlog::Session& session, const char* eventFo
 /** Convert `tp` to local time string representation */
 std::string timePointToString(std::chrono::system_clock::time_point tp);
 
+/**
+ * Add an event source of `Args` arguments to `session`,
+ * to log events by SessionWriter::addEvent.
+ *
+ * Unlike the log macros, which add the source of a call site
+ * to a single session, it can be called for every session,
+ * so each test case can log to a fresh session.
+ *
+ * @returns the id of the added source
+ */
+template <typename... Args>
+std::uint64_t addEventSource(
+  binlog::Session& session, binlog::Severity severity,
+  const char* category, const char* formatString, const char* file = ""
+)
+{
+  return session.addEventSource(binlog::EventSource{
+    0, severity, category, "", file, 0, formatString, binlog::detail::ArgumentTags<Args...>::value.data()
+  });
+}
+
 /** Count the binlog entries in `input` with tag = `tagToCount` */
 std::size_t countTags(TestStream& input, std::uint64_t tagToCount);
 
@@ -4,7 +4,9 @@
 #include "test_type_lists.hpp"
 
 #include <mserialize/deserialize.hpp>
+#include <mserialize/sequence_view.hpp>
 #include <mserialize/serialize.hpp>
+#include <mserialize/string_view.hpp>
 
 #include <mserialize/make_derived_struct_deserializable.hpp>
 #include <mserialize/make_derived_struct_serializable.hpp>
@@ -32,12 +34,20 @@
 #include <deque>
 #include <forward_list>
 #include <list>
+#include <map>
 #include <memory>
+#include <set>
 #include <string>
 #include <tuple>
 #include <utility> // pair
 #include <vector>
 
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<memory_resource>)
+  #include <memory_resource>
+#endif
+#endif
+
 namespace {
 
 template <typename In, typename Out>
@@ -308,6 +318,153 @@ TEST_CASE("string")
   }
 }
 
+namespace {
+
+// A stateful allocator without default constructor, taking memory from an arena
+struct Arena
+{
+  std::vector<std::unique_ptr<char[]>> blocks;
+};
+
+template <typename T>
+struct ArenaAllocator
+{
+  using value_type = T;
+
+  explicit ArenaAllocator(Arena& a) :arena(&a) {}
+
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) :arena(other.arena) {} // NOLINT(google-explicit-constructor)
+
+  T* allocate(std::size_t n)
+  {
+    arena->blocks.emplace_back(new char[n * sizeof(T)]);
+    return reinterpret_cast<T*>(arena->blocks.back().get());
+  }
+
+  void deallocate(T*, std::size_t) {}
+
+  Arena* arena;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.arena == b.arena; }
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.arena != b.arena; }
+
+using ArenaString = std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>>;
+
+} // namespace
+
+TEST_CASE("allocator_aware_elements")
+{
+  const std::set<std::string> inSet{"a", "long string, not stored inline by the string object"};
+  const std::map<std::string, std::string> inMap{{"a", "b"}, {"long key, not stored inline", "long value, not stored inline"}};
+
+  Arena arena;
+  const ArenaAllocator<char> alloc(arena);
+
+  std::set<ArenaString, std::less<ArenaString>, ArenaAllocator<ArenaString>> outSet(alloc);
+  roundtrip_into(inSet, outSet);
+  CHECK(deep_container_equal(inSet, outSet, container_equal()));
+
+  std::map<ArenaString, ArenaString, std::less<ArenaString>, ArenaAllocator<std::pair<const ArenaString, ArenaString>>> outMap(alloc);
+  roundtrip_into(inMap, outMap);
+  REQUIRE(outMap.size() == inMap.size());
+  for (const auto& kv : outMap)
+  {
+    CHECK(inMap.at(std::string(kv.first.data(), kv.first.size())) == std::string(kv.second.data(), kv.second.size()));
+    CHECK(kv.first.get_allocator() == alloc);
+    CHECK(kv.second.get_allocator() == alloc);
+  }
+
+  // every element is allocated from the arena
+  for (const ArenaString& str : outSet) { CHECK(str.get_allocator() == alloc); }
+  CHECK(! arena.blocks.empty());
+}
+
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<memory_resource>)
+
+TEST_CASE("pmr_containers")
+{
+  const std::vector<std::string> inVector{"a", "long string, not stored inline by the string object"};
+  const std::map<std::string, std::vector<int>> inMap{{"long key, not stored inline", {1, 2, 3}}};
+
+  char buffer[4096];
+  std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+
+  std::pmr::vector<std::pmr::string> outVector(&arena);
+  roundtrip_into(inVector, outVector);
+  CHECK(deep_container_equal(inVector, outVector, container_equal()));
+
+  std::pmr::map<std::pmr::string, std::pmr::vector<int>> outMap(&arena);
+  roundtrip_into(inMap, outMap);
+  REQUIRE(outMap.size() == 1);
+  CHECK(outMap.begin()->first == inMap.begin()->first.data());
+  CHECK(outMap.begin()->second.size() == 3);
+  CHECK(outMap.begin()->first.get_allocator().resource() == &arena);
+  CHECK(outMap.begin()->second.get_allocator().resource() == &arena);
+}
+
+#endif
+#endif
+
+TEST_CASE("views")
+{
+  const std::tuple<std::string, std::vector<std::int64_t>, std::vector<char>> in{
+    "a string, not copied", {-1, 1, 1 << 20, std::numeric_limits<std::int64_t>::max()}, {}
+  };
+
+  std::stringstream stream;
+  OutputStream ostream{stream};
+  mserialize::serialize(in, ostream);
+  const std::string buffer = stream.str();
+
+  std::tuple<mserialize::string_view, mserialize::sequence_view<std::int64_t>, mserialize::sequence_view<char>> out;
+  ViewInputStream istream{buffer};
+  mserialize::deserialize(out, istream);
+  CHECK(istream.pos == buffer.size());
+
+  const mserialize::string_view str = std::get<0>(out);
+  CHECK(str.to_string() == std::get<0>(in));
+  CHECK(str.data() > buffer.data());
+  CHECK(str.data() < buffer.data() + buffer.size());
+
+  const mserialize::sequence_view<std::int64_t> numbers = std::get<1>(out);
+  REQUIRE(numbers.size() == std::get<1>(in).size());
+  for (std::size_t i = 0; i < numbers.size(); ++i)
+  {
+    CHECK(numbers[i] == std::get<1>(in)[i]);
+  }
+
+  CHECK(std::get<2>(out).empty());
+
+  // truncated input
+  const std::string prefix = buffer.substr(0, 10);
+  ViewInputStream truncated{prefix};
+  CHECK_THROWS_AS(mserialize::deserialize(out, truncated), std::runtime_error);
+}
+
+#if __cplusplus >= 201703L
+
+TEST_CASE("std_string_view")
+{
+  std::stringstream stream;
+  OutputStream ostream{stream};
+  mserialize::serialize(std::string("foobar"), ostream);
+  const std::string buffer = stream.str();
+
+  std::string_view out;
+  ViewInputStream istream{buffer};
+  mserialize::deserialize(out, istream);
+  CHECK(out == "foobar");
+  CHECK(out.data() == buffer.data() + sizeof(std::uint32_t));
+}
+
+#endif
+
 TEST_CASE("tuples")
 {
   // empty
@@ -734,6 +891,80 @@ MSERIALIZE_MAKE_TEMPLATE_DESERIALIZABLE((typename A, typename B), (test::NsPair<
 MSERIALIZE_MAKE_TEMPLATE_SERIALIZABLE((typename T, std::size_t N), (Array<T,N>), a)
 MSERIALIZE_MAKE_TEMPLATE_DESERIALIZABLE((typename T, std::size_t N), (Array<T,N>), a)
 
+struct Tick
+{
+  std::int64_t time;
+  std::int32_t price;
+  std::int32_t size;
+
+  friend bool operator==(const Tick& a, const Tick& b)
+  {
+    return a.time == b.time && a.price == b.price && a.size == b.size;
+  }
+};
+
+struct ReorderedTick { std::int64_t time; std::int32_t price; std::int32_t size; }; // listed in a different order
+struct PaddedTick { std::int64_t time; std::int32_t price; };
+struct PartialTick { std::int64_t time; std::int32_t price; std::int32_t size; };
+
+MSERIALIZE_MAKE_STRUCT_SERIALIZABLE(Tick, time, price, size)
+MSERIALIZE_MAKE_STRUCT_DESERIALIZABLE(Tick, time, price, size)
+
+MSERIALIZE_MAKE_STRUCT_SERIALIZABLE(ReorderedTick, size, time, price)
+MSERIALIZE_MAKE_STRUCT_DESERIALIZABLE(ReorderedTick, size, time, price)
+
+MSERIALIZE_MAKE_STRUCT_SERIALIZABLE(PaddedTick, time, price)
+MSERIALIZE_MAKE_STRUCT_SERIALIZABLE(PartialTick, time, size)
+
+TEST_CASE("layout_serializable_struct")
+{
+  static_assert(mserialize::detail::is_layout_serializable<Tick>::value, "");
+  static_assert(mserialize::detail::is_layout_serializable<ReorderedTick>::value, "");
+  static_assert(! mserialize::detail::is_layout_serializable<PaddedTick>::value, "");
+  static_assert(! mserialize::detail::is_layout_serializable<PartialTick>::value, "");
+  static_assert(! mserialize::detail::is_layout_serializable<Vehicle>::value, "");
+
+  const Tick tick{1234567890123, -100, 7};
+  CHECK(roundtrip(tick) == tick);
+
+  // serialized as the object representation
+  std::stringstream stream;
+  OutputStream ostream{stream};
+  mserialize::serialize(tick, ostream);
+  CHECK(stream.str() == std::string(reinterpret_cast<const char*>(&tick), sizeof(tick)));
+
+  // listed out of order, serialized member by member
+  ReorderedTick reordered;
+  reordered.time = 1;
+  reordered.price = 2;
+  reordered.size = 3;
+  CHECK(mserialize::CustomSerializer<ReorderedTick>::is_layout_order(reordered) == false);
+  const ReorderedTick reorderedOut = roundtrip(reordered);
+  CHECK(reorderedOut.time == 1);
+  CHECK(reorderedOut.price == 2);
+  CHECK(reorderedOut.size == 3);
+}
+
+TEST_CASE("layout_serializable_sequence")
+{
+  const std::vector<Tick> ticks{{1, 2, 3}, {4, 5, 6}, {7, 8, 9}};
+  CHECK(roundtrip(ticks) == ticks);
+  CHECK(mserialize::serialized_size(ticks) == 4 + 3 * sizeof(Tick));
+
+  const std::list<Tick> tickList(ticks.begin(), ticks.end());
+  CHECK(roundtrip(tickList) == tickList);
+
+  std::vector<ReorderedTick> reordered(2, ReorderedTick{0, 0, 0});
+  reordered[0].time = 1;
+  reordered[1].size = 2;
+  const std::vector<ReorderedTick> out = roundtrip(reordered);
+  REQUIRE(out.size() == 2);
+  CHECK(out[0].time == 1);
+  CHECK(out[1].size == 2);
+
+  CHECK(roundtrip(std::vector<Tick>{}).empty());
+}
+
 TEST_CASE("manual_specialization")
 {
   const Person in{33, "John"};
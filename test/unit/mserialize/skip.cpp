@@ -0,0 +1,171 @@
+#include "test_streams.hpp"
+
+#include <mserialize/serialize.hpp>
+#include <mserialize/skip.hpp>
+#include <mserialize/tag.hpp>
+#include <mserialize/visit.hpp>
+
+#include <doctest/doctest.h>
+
+#include <cstdint>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+/** Consumes a value of any tag, without looking at it */
+struct NullVisitor
+{
+  template <typename T>
+  void visit(T) {}
+
+  template <typename T, typename InputStream>
+  bool visit(T, InputStream&) { return false; }
+};
+
+/** @returns `values` serialized one after the other */
+template <typename... Values>
+std::string serialize_values(const Values&... values)
+{
+  std::stringstream stream;
+  int dummy[] = {0, (mserialize::serialize(values, stream), 0)...};
+  static_cast<void>(dummy);
+  return stream.str();
+}
+
+/**
+ * Skip an object of `tag` at the beginning of `serialized`,
+ * followed by a trailing int, by a stream with and without view.
+ * Check that the object is skipped the same way it is visited.
+ *
+ * @returns the number of reads done by the stream without view
+ */
+int skip_and_visit(const std::string& tag, const std::string& object)
+{
+  const std::string serialized = object + serialize_values(std::int32_t(1234));
+  const mserialize::VisitPlan plan(tag);
+
+  // skip with view
+  ViewInputStream view_stream{serialized};
+  mserialize::skip(plan, view_stream);
+  CHECK(view_stream.pos == object.size());
+
+  // skip without view, reads the values
+  UncheckedInputStream read_stream{serialized};
+  mserialize::skip(plan, read_stream);
+  CHECK(read_stream.pos == object.size());
+
+  // the same as visit
+  ViewInputStream visit_stream{serialized};
+  NullVisitor visitor;
+  mserialize::visit(plan, visitor, visit_stream);
+  CHECK(visit_stream.pos == object.size());
+
+  // the object is skipped completely
+  std::int32_t trailing = 0;
+  mserialize::deserialize(trailing, view_stream);
+  CHECK(trailing == 1234);
+
+  return read_stream.checked_reads;
+}
+
+} // namespace
+
+TEST_CASE("skip_arithmetic")
+{
+  CHECK(skip_and_visit("y", serialize_values(true)) == 1);
+  CHECK(skip_and_visit("i", serialize_values(std::int32_t(7))) == 1);
+  CHECK(skip_and_visit("D", serialize_values(1.5L)) == 1);
+  CHECK(skip_and_visit("Q", serialize_values(std::uint8_t(2), std::uint16_t(300))) == 3); // packed: header, 2 bytes
+}
+
+TEST_CASE("skip_sequence")
+{
+  const std::vector<double> doubles(1000, 1.5);
+  skip_and_visit(mserialize::tag<std::vector<double>>().data(), serialize_values(doubles));
+  CHECK(skip_and_visit("[i", serialize_values(std::uint32_t(0))) == 1);
+  CHECK(skip_and_visit("[c", serialize_values(std::string("foobar"))) == 2);
+
+  const std::vector<std::string> strings{"a", "bc", "def"};
+  CHECK(skip_and_visit("[[c", serialize_values(strings)) == 7);
+
+  const std::vector<std::tuple<int, char>> tuples{{1, 'a'}, {2, 'b'}};
+  CHECK(skip_and_visit("[(ic)", serialize_values(tuples)) == 2);
+
+  const std::map<int, std::string> map{{1, "a"}, {2, "b"}};
+  CHECK(skip_and_visit(mserialize::tag<std::map<int, std::string>>().data(), serialize_values(map)) == 7);
+
+  // singular elements
+  CHECK(skip_and_visit("[()", serialize_values(std::uint32_t(1000000))) == 1);
+}
+
+TEST_CASE("skip_tuple_and_struct")
+{
+  CHECK(skip_and_visit("()", "") == 0);
+  CHECK(skip_and_visit("(iy)", serialize_values(std::int32_t(1), true)) == 1);
+  CHECK(skip_and_visit("(i[c)", serialize_values(std::int32_t(1), std::string("foo"))) == 3);
+  CHECK(skip_and_visit("{A`a'i`b'[c}", serialize_values(std::int32_t(1), std::string("foo"))) == 3);
+  CHECK(skip_and_visit("{A`a'i`b'(sc)}", serialize_values(std::int32_t(1), std::int16_t(2), 'c')) == 1);
+  CHECK(skip_and_visit("/i`E'1`A'\\", serialize_values(std::int32_t(1))) == 1);
+  CHECK(skip_and_visit("/Q`E'1`A'\\", serialize_values(std::uint8_t(1), std::uint8_t(1))) == 2);
+}
+
+TEST_CASE("skip_variant")
+{
+  const std::string tag = "<0i[c>";
+  CHECK(skip_and_visit(tag, serialize_values(std::uint8_t(0))) == 1);
+  CHECK(skip_and_visit(tag, serialize_values(std::uint8_t(1), std::int32_t(7))) == 2);
+  CHECK(skip_and_visit(tag, serialize_values(std::uint8_t(2), std::string("foo"))) == 3);
+  CHECK(skip_and_visit(tag, serialize_values(std::uint8_t(3))) == 1); // out of range
+}
+
+TEST_CASE("skip_recursive_struct")
+{
+  // R{r: [R]}: a root with one child, and a leaf
+  const std::string tag = "{R`v'i`r'[{R}}";
+  CHECK(skip_and_visit(tag, serialize_values(std::int32_t(1), std::uint32_t(1), std::int32_t(2), std::uint32_t(0))) == 4);
+}
+
+TEST_CASE("skip_by_tag")
+{
+  const std::string serialized = serialize_values(std::string("foo"), std::int32_t(1));
+  ViewInputStream stream{serialized};
+  mserialize::skip(mserialize::string_view("[c"), stream);
+  CHECK(stream.pos == 7);
+
+  // empty tag: nothing to skip
+  mserialize::skip(mserialize::string_view(""), stream);
+  CHECK(stream.pos == 7);
+}
+
+TEST_CASE("skip_errors")
+{
+  const std::string serialized = serialize_values(std::uint32_t(3), std::int32_t(1));
+
+  // not enough bytes
+  ViewInputStream stream{serialized};
+  CHECK_THROWS_AS(mserialize::skip(mserialize::VisitPlan("[i"), stream), std::runtime_error);
+
+  // invalid tags
+  ViewInputStream stream2{serialized};
+  CHECK_THROWS_AS(mserialize::skip(mserialize::VisitPlan("X"), stream2), std::runtime_error);
+  CHECK_THROWS_AS(mserialize::skip(mserialize::VisitPlan("/\\"), stream2), std::runtime_error);
+  CHECK_THROWS_AS(mserialize::skip(mserialize::VisitPlan("{R`r'{R}}", 128), stream2), std::runtime_error);
+
+  // invalid tags are only reported if skipped
+  const std::string empty = serialize_values(std::uint32_t(0));
+  ViewInputStream stream3{empty};
+  mserialize::skip(mserialize::VisitPlan("[X"), stream3);
+  CHECK(stream3.pos == 4);
+
+  // too deep
+  const std::string tag = std::string(2048, '[') + "i";
+  std::string deep;
+  for (int i = 0; i < 2049; ++i) { deep += serialize_values(std::uint32_t(1)); }
+  ViewInputStream stream4{deep};
+  CHECK_THROWS_AS(mserialize::skip(mserialize::VisitPlan(tag), stream4), std::runtime_error);
+}
@@ -5,6 +5,8 @@
 #include <mserialize/make_enum_tag.hpp>
 #include <mserialize/make_struct_tag.hpp>
 #include <mserialize/make_template_tag.hpp>
+#include <mserialize/sequence_view.hpp>
+#include <mserialize/string_view.hpp>
 #include <mserialize/tag.hpp>
 
 #include <cstdint>
@@ -46,6 +48,8 @@ static_assert(mserialize::tag<long double>() == "D", "");
 static_assert(mserialize::tag<std::vector<int>>() == "[i", "");
 static_assert(mserialize::tag<std::vector<float>>() == "[f", "");
 static_assert(mserialize::tag<std::vector<bool>>() == "[y", "");
+static_assert(mserialize::tag<mserialize::string_view>() == "[c", "");
+static_assert(mserialize::tag<mserialize::sequence_view<std::uint32_t>>() == "[I", "");
 
 static_assert(mserialize::tag<std::pair<int, double>>() == "(id)", "");
 static_assert(mserialize::tag<std::tuple<>>() == "()", "");
@@ -1,8 +1,12 @@
 #ifndef TEST_UNIT_MSERIALIZE_TEST_STREAMS_HPP
 #define TEST_UNIT_MSERIALIZE_TEST_STREAMS_HPP
 
+#include <cstddef>
+#include <cstring> // memcpy
 #include <ios> // streamsize
 #include <sstream>
+#include <stdexcept>
+#include <string>
 
 // In tests, do not use std streams directly,
 // to make sure tested code only accesses
@@ -30,4 +34,53 @@ struct InputStream
   }
 };
 
+// InputStream with direct access to its bytes, like binlog::Range
+struct ViewInputStream
+{
+  const std::string& buffer;
+  std::size_t pos = 0;
+
+  const char* view(std::size_t size)
+  {
+    if (buffer.size() - pos < size) { throw std::runtime_error("ViewInputStream: not enough bytes"); }
+    const char* result = buffer.data() + pos;
+    pos += size;
+    return result;
+  }
+
+  ViewInputStream& read(char* buf, std::streamsize size)
+  {
+    memcpy(buf, view(std::size_t(size)), std::size_t(size));
+    return *this;
+  }
+};
+
+// InputStream with unchecked reads, like binlog::Range, counting the checked reads
+struct UncheckedInputStream
+{
+  const std::string& buffer;
+  std::size_t pos = 0;
+  int checked_reads = 0;
+  int unchecked_reads = 0;
+
+  std::size_t size() const { return buffer.size() - pos; }
+
+  UncheckedInputStream& read(char* buf, std::streamsize size)
+  {
+    ++checked_reads;
+    if (this->size() < std::size_t(size)) { throw std::runtime_error("UncheckedInputStream: not enough bytes"); }
+    memcpy(buf, buffer.data() + pos, std::size_t(size));
+    pos += std::size_t(size);
+    return *this;
+  }
+
+  void read_unchecked(char* buf, std::size_t size)
+  {
+    ++unchecked_reads;
+    if (this->size() < size) { throw std::logic_error("UncheckedInputStream: unchecked read out of bounds"); }
+    memcpy(buf, buffer.data() + pos, size);
+    pos += size;
+  }
+};
+
 #endif // TEST_UNIT_MSERIALIZE_TEST_STREAMS_HPP
@@ -3,6 +3,7 @@
 #include "test_structs.hpp"
 #include "test_type_lists.hpp"
 
+#include <mserialize/detail/packed_integer.hpp>
 #include <mserialize/make_enum_tag.hpp>
 #include <mserialize/serialize.hpp>
 #include <mserialize/tag.hpp>
@@ -122,13 +123,56 @@ serialize_and_visit(const T& in)
   OutputStream ostream{stream};
   mserialize::serialize(in, ostream);
 
+  const std::string serialized = stream.str();
+
   // visit
   Visitor visitor;
   InputStream istream{stream};
   const auto tag = mserialize::tag<T>();
   mserialize::visit(tag, visitor, istream);
 
-  return visitor.value();
+  // visit the compiled tag, must be the same
+  std::stringstream stream2(serialized);
+  stream2.exceptions(std::ios_base::failbit);
+  Visitor plan_visitor;
+  InputStream istream2{stream2};
+  const mserialize::VisitPlan plan(tag);
+  mserialize::visit(plan, plan_visitor, istream2);
+
+  typename Visitor::value_type result = visitor.value();
+  CHECK(plan_visitor.value() == result);
+  return result;
+}
+
+/** Visit `serialized` by `tag` and by a VisitPlan of `tag`, check that the results are the same */
+template <typename Visitor>
+typename Visitor::value_type
+visit_tag_and_plan(const std::string& tag, const std::string& serialized)
+{
+  std::stringstream stream1(serialized);
+  stream1.exceptions(std::ios_base::failbit);
+  Visitor visitor1;
+  mserialize::visit(tag, visitor1, stream1);
+
+  std::stringstream stream2(serialized);
+  stream2.exceptions(std::ios_base::failbit);
+  Visitor visitor2;
+  const mserialize::VisitPlan plan(tag);
+  mserialize::visit(plan, visitor2, stream2);
+
+  typename Visitor::value_type result = visitor1.value();
+  CHECK(visitor2.value() == result);
+  return result;
+}
+
+/** @returns `values` serialized one after the other */
+template <typename... Values>
+std::string serialize_values(const Values&... values)
+{
+  std::stringstream stream;
+  int dummy[] = {0, (mserialize::serialize(values, stream), 0)...};
+  static_cast<void>(dummy);
+  return stream.str();
 }
 
 enum class OpaqueEnum : std::int32_t
@@ -194,6 +238,36 @@ TEST_CASE("invalid_arithmetic")
   CHECK_THROWS_AS(mserialize::visit("X", visitor, stream), std::runtime_error);
 }
 
+TEST_CASE("packed_integer")
+{
+  const std::int64_t signedValues[] = {
+    0, 1, -1, 127, -128, 255, 256, -65536,
+    std::numeric_limits<std::int64_t>::min(), std::numeric_limits<std::int64_t>::max()
+  };
+  for (const std::int64_t in : signedValues)
+  {
+    bool negative = false;
+    const std::uint64_t magnitude = mserialize::detail::packed_magnitude(std::uint64_t(in), true, negative);
+    std::ostringstream stream;
+    mserialize::detail::serialize_packed(magnitude, negative, stream);
+    CHECK(stream.str().size() == 1 + mserialize::detail::packed_byte_count(magnitude));
+    CHECK(visit_tag_and_plan<ToString>("q", stream.str()) == std::to_string(in) + ' ');
+  }
+
+  const std::uint64_t unsignedValues[] = {0, 1, 255, 256, std::numeric_limits<std::uint64_t>::max()};
+  for (const std::uint64_t in : unsignedValues)
+  {
+    std::ostringstream stream;
+    mserialize::detail::serialize_packed(in, false, stream);
+    CHECK(visit_tag_and_plan<ToString>("Q", stream.str()) == std::to_string(in) + ' ');
+  }
+
+  // more than 8 bytes
+  CountingVisitor visitor;
+  std::stringstream stream("\x09");
+  CHECK_THROWS_AS(mserialize::visit("q", visitor, stream), std::runtime_error);
+}
+
 TEST_CASE("empty_vector_of_int")
 {
   const std::vector<int> in;
@@ -609,6 +683,201 @@ TEST_CASE("empty_prefix_of_containing_struct")
   CHECK(visitor.value() == "StB(FooBar,`f'{Foo}) { f({Foo}): StB(Foo,) { } , } ");
 }
 
+TEST_CASE("visit_plan_same_as_tag")
+{
+  auto serialize = [](auto... values)
+  {
+    std::stringstream stream;
+    int dummy[] = {(mserialize::serialize(values, stream), 0)...};
+    static_cast<void>(dummy);
+    return stream.str();
+  };
+
+  // variant: valid options, null, out of range discriminator
+  CHECK(visit_tag_and_plan<ToString>("<i[c0>", serialize(std::uint8_t(0), std::int32_t(7))) == "VB(0,i)< 7 > ");
+  CHECK(visit_tag_and_plan<ToString>("<i[c0>", serialize(std::uint8_t(1), std::uint32_t(1), 'a')) == "VB(1,[c)< SB(1,c)[ a ] > ");
+  CHECK(visit_tag_and_plan<ToString>("<i[c0>", serialize(std::uint8_t(2))) == "VB(2,0)< {null} > ");
+  CHECK(visit_tag_and_plan<ToString>("<i[c0>", serialize(std::uint8_t(5))) == "VB(5,)< > ");
+
+  // nested variants
+  CHECK(visit_tag_and_plan<ToString>("(<<0i>y><c0>)", serialize(std::uint8_t(0), std::uint8_t(1), std::int32_t(3), std::uint8_t(1)))
+    == "TB(<<0i>y><c0>)( VB(0,<0i>)< VB(1,i)< 3 > > VB(1,0)< {null} > ) ");
+
+  // unknown enumerator
+  CHECK(visit_tag_and_plan<ToString>("/i`E'1`A'2`B'\\", serialize(std::int32_t(2))) == "E(E::B,i,0x2) ");
+  CHECK(visit_tag_and_plan<ToString>("/i`E'1`A'2`B'\\", serialize(std::int32_t(3))) == "E(E::,i,0x3) ");
+  CHECK(visit_tag_and_plan<ToString>("/i`E'\\", serialize(std::int32_t(1))) == "E(E::,i,0x1) ");
+
+  // struct defined before a reference
+  CHECK(visit_tag_and_plan<ToString>("({A`a'i}{A})", serialize(std::int32_t(1), std::int32_t(2)))
+    == "TB({A`a'i}{A})( StB(A,`a'i) { a(i): 1 , } StB(A,`a'i) { a(i): 2 , } ) ");
+
+  // recursive struct in a sequence
+  CHECK(visit_tag_and_plan<ToString>("[{R`r'[{R}}", serialize(std::uint32_t(1), std::uint32_t(0)))
+    == "SB(1,{R`r'[{R}})[ StB(R,`r'[{R}) { r([{R}): SB(0,{R})[ ] , } ] ");
+
+  // singular and not singular sequences
+  CHECK(visit_tag_and_plan<ToString>("[()", serialize(std::uint32_t(33))) == "SB(33,())[ RB(33,())( TB()( ) ) ] ");
+  CHECK(visit_tag_and_plan<ToString>("[y", serialize(std::uint32_t(2), true, false)) == "SB(2,y)[ true false ] ");
+}
+
+TEST_CASE("visit_plan_enum_lookup")
+{
+  auto visit_enum = [](const std::string& tag, auto value)
+  {
+    std::stringstream stream;
+    mserialize::serialize(value, stream);
+    return visit_tag_and_plan<ToString>(tag, stream.str());
+  };
+
+  // dense, negative values
+  const std::string dense = "/b`D'-2`M'-1`N'0`Z'1`P'\\";
+  CHECK(visit_enum(dense, std::int8_t(-2)) == "E(D::M,b,0x-2) ");
+  CHECK(visit_enum(dense, std::int8_t(0)) == "E(D::Z,b,0x0) ");
+  CHECK(visit_enum(dense, std::int8_t(1)) == "E(D::P,b,0x1) ");
+  CHECK(visit_enum(dense, std::int8_t(-3)) == "E(D::,b,0x-3) ");
+  CHECK(visit_enum(dense, std::int8_t(2)) == "E(D::,b,0x2) ");
+
+  // sparse, unsorted
+  const std::string sparse = "/L`S'2710`C'1`A'64`B'FFFFFFFFFFFFFFFF`D'\\";
+  CHECK(visit_enum(sparse, std::uint64_t(1)) == "E(S::A,L,0x1) ");
+  CHECK(visit_enum(sparse, std::uint64_t(100)) == "E(S::B,L,0x64) ");
+  CHECK(visit_enum(sparse, std::uint64_t(10000)) == "E(S::C,L,0x2710) ");
+  CHECK(visit_enum(sparse, std::uint64_t(-1)) == "E(S::D,L,0xFFFFFFFFFFFFFFFF) ");
+  CHECK(visit_enum(sparse, std::uint64_t(2)) == "E(S::,L,0x2) ");
+
+  // aliases: the first one wins
+  CHECK(visit_enum("/i`A'1`X'1`Y'\\", std::int32_t(1)) == "E(A::X,i,0x1) ");
+  CHECK(visit_enum("/i`A'5`X'1`Y'1`Z'\\", std::int32_t(1)) == "E(A::Y,i,0x1) ");
+
+  // not a hex value: textual lookup
+  CHECK(visit_enum("/i`T'1`X'zz`Y'\\", std::int32_t(1)) == "E(T::X,i,0x1) ");
+}
+
+TEST_CASE("visit_plan_reuse")
+{
+  const mserialize::VisitPlan plan(mserialize::tag<std::vector<Element>>());
+  CHECK(plan.tag() == mserialize::tag<std::vector<Element>>());
+
+  for (int i = 0; i < 3; ++i)
+  {
+    std::stringstream stream;
+    stream.exceptions(std::ios_base::failbit);
+    mserialize::serialize(std::vector<Element>(std::size_t(i), Element{"X", i}), stream);
+
+    ToString visitor;
+    mserialize::visit(plan, visitor, stream);
+
+    std::string expected = "SB(" + std::to_string(i) + ",{Element`name'[c`number'i})[ ";
+    for (int j = 0; j < i; ++j)
+    {
+      expected += "StB(Element,`name'[c`number'i) { name([c): SB(1,c)[ X ] , number(i): " + std::to_string(i) + " , } ";
+    }
+    expected += "] ";
+    CHECK(visitor.value() == expected);
+  }
+}
+
+TEST_CASE("visit_plan_errors")
+{
+  CountingVisitor visitor;
+  std::stringstream stream;
+  mserialize::serialize(std::uint64_t(1), stream);
+
+  CHECK_THROWS_AS(mserialize::visit(mserialize::VisitPlan("X"), visitor, stream), std::runtime_error);
+  CHECK_THROWS_AS(mserialize::visit(mserialize::VisitPlan("0"), visitor, stream), std::runtime_error);
+  CHECK_THROWS_AS(mserialize::visit(mserialize::VisitPlan("/\\"), visitor, stream), std::runtime_error);
+  CHECK_THROWS_AS(mserialize::visit(mserialize::VisitPlan("{R`r'{R}}", 128), visitor, stream), std::runtime_error);
+
+  // invalid tags are only reported if visited
+  std::stringstream empty_seq;
+  mserialize::serialize(std::uint32_t(0), empty_seq);
+  mserialize::visit(mserialize::VisitPlan("[X"), visitor, empty_seq);
+
+  // too deep
+  const std::string tag = std::string(2048, '[') + "i";
+  std::stringstream deep;
+  for (int i = 0; i < 2049; ++i)
+  {
+    mserialize::serialize(std::int32_t(1), deep);
+  }
+  CHECK_THROWS_AS(mserialize::visit(mserialize::VisitPlan(tag), visitor, deep), std::runtime_error);
+}
+
+TEST_CASE("visit_plan_fixed_size")
+{
+  const auto fixed_size = [](const char* tag) { return mserialize::VisitPlan(tag).ops().front().fixed_size; };
+  const std::uint32_t variable = mserialize::VisitPlan::variable_size;
+
+  CHECK(fixed_size("y") == 1);
+  CHECK(fixed_size("i") == 4);
+  CHECK(fixed_size("D") == sizeof(long double));
+  CHECK(fixed_size("q") == variable);
+  CHECK(fixed_size("X") == variable);
+  CHECK(fixed_size("()") == 0);
+  CHECK(fixed_size("(iyS)") == 7);
+  CHECK(fixed_size("{A`a'i`b'(sc)}") == 7);
+  CHECK(fixed_size("/s`E'1`A'\\") == 2);
+  CHECK(fixed_size("(i[c)") == variable);
+  CHECK(fixed_size("[i") == variable);
+  CHECK(fixed_size("<0i>") == variable);
+  CHECK(fixed_size("{R`r'<0{R}>}") == variable);
+
+  const mserialize::VisitPlan plan("[(ii)");
+  REQUIRE(plan.ops().size() == 4);
+  CHECK(plan.ops()[1].fixed_size == 8);
+}
+
+TEST_CASE("visit_plan_unchecked_read")
+{
+  // Visit `serialized` by `tag`, and by a plan, reading `serialized` from an UncheckedInputStream
+  const auto visit_unchecked = [](const std::string& tag, const std::string& serialized, int expected_checked_reads)
+  {
+    const std::string expected = visit_tag_and_plan<ToString>(tag, serialized);
+
+    UncheckedInputStream stream{serialized};
+    ToString visitor;
+    mserialize::visit(mserialize::VisitPlan(tag), visitor, stream);
+    CHECK(visitor.value() == expected);
+    CHECK(stream.size() == 0);
+    CHECK(stream.checked_reads == expected_checked_reads);
+  };
+
+  // every value of objects of fixed size is read unchecked
+  visit_unchecked("(iyS)", serialize_values(std::int32_t(1), true, std::uint16_t(2)), 0);
+  visit_unchecked("{A`a'i`b'(sc)}", serialize_values(std::int32_t(1), std::int16_t(2), 'c'), 0);
+  visit_unchecked("(/i`E'1`A'2`B'\\d)", serialize_values(std::int32_t(2), 1.5), 0);
+
+  // sequences of fixed size elements are checked once, their size is read checked
+  visit_unchecked("[i", serialize_values(std::uint32_t(3), std::int32_t(1), std::int32_t(2), std::int32_t(3)), 1);
+  visit_unchecked("[(iy)", serialize_values(std::uint32_t(2), std::int32_t(1), true, std::int32_t(2), false), 1);
+
+  // variable size parts are read checked
+  visit_unchecked("(i[c)", serialize_values(std::int32_t(1), std::uint32_t(2), 'a', 'b'), 2);
+  visit_unchecked("(iq)", serialize_values(std::int32_t(1), std::uint8_t(1), std::uint8_t(5)), 3); // packed: header, 1 byte
+  visit_unchecked("<0(ii)>", serialize_values(std::uint8_t(1), std::int32_t(1), std::int32_t(2)), 1);
+}
+
+TEST_CASE("visit_plan_unchecked_read_truncated")
+{
+  // not enough bytes for the tuple: read one by one, fail at the third value
+  const std::string serialized = serialize_values(std::int32_t(1), std::int32_t(2), std::int16_t(3));
+
+  UncheckedInputStream stream{serialized};
+  ToString visitor;
+  CHECK_THROWS_AS(mserialize::visit(mserialize::VisitPlan("(iii)"), visitor, stream), std::runtime_error);
+  CHECK(visitor.value() == "TB(iii)( 1 2 ");
+  CHECK(stream.unchecked_reads == 0);
+
+  // sequence size too large
+  const std::string seq = serialize_values(std::uint32_t(3), std::int32_t(1), std::int32_t(2));
+  UncheckedInputStream seq_stream{seq};
+  ToString seq_visitor;
+  CHECK_THROWS_AS(mserialize::visit(mserialize::VisitPlan("[i"), seq_visitor, seq_stream), std::runtime_error);
+  CHECK(seq_visitor.value() == "SB(3,i)[ 1 2 ");
+  CHECK(seq_stream.unchecked_reads == 0);
+}
+
 // derived struct serialization and visitation
 
 #ifndef _WIN32